@@ -55,6 +55,7 @@ testScripts=(
   'wallet_mergetoaddress.py',491,1402
   'wallet_mergetoaddress_2.py',975,2539
   'wallet.py',131,559
+  'multiwallet.py',35,95
   'wallet_nullifiers.py',109,352
   'wallet_1941.py',53,170
   'wallet_grothtx.py',91,239
@@ -116,6 +117,9 @@ testScripts=(
   'sc_cert_quality_wallet.py',101,250
   'ws_messages.py',71,173
   'ws_getsidechainversions.py',47,138
+  'ws_binary.py',25,60
+  'ws_blockrange.py',27,64
+  'ws_scfilter.py',45,120
   'sc_cert_ceasing_split.py',66,161
   'sc_async_proof_verifier.py',97,217
   'sc_quality_blockchain.py',86,244
@@ -135,6 +139,10 @@ testScripts=(
   'tlsprotocols.py',12,34
   'mempool_double_spend.py',21,60
   'getblockmerkleroots.py',67,156
+  'getblockconnectstats.py',10,30
+  'replaymessages.py',10,30
+  'sc_activity_index.py',30,70
+  'txreconciliation.py',15,40
   'sc_block_partitions.py',60,153
   'sc_cert_bwt_amount_rounding.py',30,73
   'sc_csw_eviction_from_mempool.py',124,349
@@ -154,6 +162,8 @@ testScripts=(
   'sc_cert_addressindex.py',128,275
   'sc_cert_addrmempool.py',46,110
   'getblockexpanded.py',191,395
+  'verifydb.py',12,25
+  'cli_batch.py',10,20
   'sc_rpc_cmds_json_output.py',68,187
   'sc_version.py',104,347
   'sc_getscgenesisinfo.py',86,269
@@ -196,6 +206,7 @@ testScriptsExt=(
   'headers_10.py',36,72
   'checkblockatheight.py',103,236
   'sc_big_block.py',92,247
+  'sc_load_generator.py',90,240
 );
 
 if [ "x$ENABLE_ZMQ" = "x1" ]; then
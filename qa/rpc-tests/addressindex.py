@@ -239,6 +239,14 @@ class AddressIndexTest(BitcoinTestFramework):
         assert_equal(utxos3[1]["height"], 264)
         assert_equal(utxos3[2]["height"], 265)
 
+        # Check the pages of utxos, resumed with their cursor
+        page1 = self.nodes[1].getaddressutxos({"addresses": [address2], "limit": 2})
+        assert_equal(len(page1["utxos"]), 2)
+        assert_equal(page1["utxos"], utxos3[:2])
+        page2 = self.nodes[1].getaddressutxos({"addresses": [address2], "limit": 2, "cursor": page1["next"]})
+        assert_equal(page2["utxos"], utxos3[2:])
+        assert_equal(page2["next"], None)
+
         # Check mempool indexing
         print("Testing mempool indexing...")
 
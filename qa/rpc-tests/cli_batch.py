@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017 The Zen Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+# Exercise the -batch mode of zen-cli, sending the commands of stdin in JSON-RPC batches
+
+import os
+import subprocess
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, initialize_chain_clean, start_nodes
+
+class CliBatchTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self, split=False):
+        self.nodes = start_nodes(1, self.options.tmpdir)
+        self.is_network_split = False
+
+    def run_batch(self, commands, extra_args=[]):
+        datadir = os.path.join(self.options.tmpdir, "node0")
+        proc = subprocess.Popen([os.getenv("BITCOINCLI", "zen-cli"), "-datadir=" + datadir, "-batch"] + extra_args,
+                                stdin=subprocess.PIPE, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                                universal_newlines=True)
+        out, err = proc.communicate("\n".join(commands) + "\n")
+        return proc.returncode, out, err
+
+    def run_test(self):
+        self.nodes[0].generate(5)
+        genesis = self.nodes[0].getblockhash(0)
+        header = self.nodes[0].getblockheader(genesis, False)
+
+        commands = [
+            "getblockcount",
+            "",
+            "getblockhash 0",
+            '["getblockheader", "%s", false]' % genesis,
+            "getblockhash 1000",
+            "getblockhash 5",
+        ]
+        expected = "5\n%s\n%s\n%s\n" % (genesis, header, self.nodes[0].getblockhash(5))
+
+        # the results in the order of the commands, whatever the size of the batches
+        for batch_size in [100, 2, 1]:
+            code, out, err = self.run_batch(commands, ["-batchsize=%d" % batch_size])
+            assert_equal(out, expected)
+            assert("error code: -8" in err)
+            assert_equal(code, 8)
+
+        code, out, err = self.run_batch(["getblockcount"])
+        assert_equal((code, out, err), (0, "5\n", ""))
+
+if __name__ == '__main__':
+    CliBatchTest().main()
@@ -0,0 +1,66 @@
+#!/usr/bin/env python3
+# Copyright (c) 2014 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+# Exercise the getblockconnectstats RPC function
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import JSONRPCException
+from test_framework.util import assert_equal, assert_true, initialize_chain_clean, start_node
+
+MAX_STATS = 5
+
+class GetBlockConnectStatsTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self, split=False):
+        self.nodes = [start_node(0, self.options.tmpdir, extra_args=['-blockconnectstats=%d' % MAX_STATS])]
+        self.is_network_split = False
+
+    def run_test(self):
+        stats = self.nodes[0].getblockconnectstats()
+        assert_equal(stats["blocks"], 0)
+        assert_equal(stats["stages"]["total"], {})
+
+        # only the last blocks are kept
+        self.nodes[0].generate(MAX_STATS + 3)
+        stats = self.nodes[0].getblockconnectstats()
+        assert_equal(stats["blocks"], MAX_STATS)
+        assert_equal(stats["firstheight"], 4)
+        assert_equal(stats["lastheight"], MAX_STATS + 3)
+        assert_equal(stats["disconnects"], 0)
+        total = stats["stages"]["total"]
+        assert_true(total["p50us"] <= total["p90us"] <= total["p99us"] <= total["maxus"])
+        assert_true(total["maxus"] > 0)
+        assert_true(stats["stages"]["connecttotal"]["maxus"] <= total["maxus"])
+        # the coinbase alone
+        assert_equal(stats["content"]["txs"]["max"], 1)
+        assert_equal(stats["content"]["certs"]["max"], 0)
+        assert_equal(stats["content"]["sidechains"]["max"], 0)
+
+        stats = self.nodes[0].getblockconnectstats(2)
+        assert_equal(stats["blocks"], 2)
+        assert_equal(stats["firstheight"], MAX_STATS + 2)
+
+        # a disconnection takes the place of the oldest block
+        self.nodes[0].invalidateblock(self.nodes[0].getbestblockhash())
+        stats = self.nodes[0].getblockconnectstats()
+        assert_equal(stats["blocks"], MAX_STATS - 1)
+        assert_equal(stats["disconnects"], 1)
+        assert_true(stats["disconnecttime"]["maxus"] > 0)
+        # the tip was just connected, its block and undo data are still in memory
+        assert_equal(stats["disconnectsfromcache"], 1)
+        assert_true("maxus" in stats["disconnectreadtime"])
+
+        try:
+            self.nodes[0].getblockconnectstats(-1)
+            assert(False)
+        except JSONRPCException as e:
+            assert_true("nblocks" in e.error['message'])
+
+if __name__ == '__main__':
+    GetBlockConnectStatsTest().main()
@@ -4,8 +4,9 @@
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import JSONRPCException
 from test_framework.util import initialize_chain_clean, start_nodes, \
-    connect_nodes_bi
+    connect_nodes_bi, assert_equal, assert_raises
 
 
 class GetBlockTemplateTest(BitcoinTestFramework):
@@ -61,5 +62,30 @@ class GetBlockTemplateTest(BitcoinTestFramework):
         assert('supernodes' in tmpl['coinbasetxn'])
         assert('securenodes' in tmpl['coinbasetxn'])
 
+        # Test 7: one template body for several payout addresses
+        node.sendtoaddress(self.nodes[1].getnewaddress(), 1)
+        addresses = [node.getnewaddress(), node.getnewaddress(), self.nodes[1].getnewaddress()]
+        tmpl = node.getblocktemplate()
+        payouts = node.getblocktemplatepayouts(addresses)
+        assert_equal(payouts['previousblockhash'], tmpl['previousblockhash'])
+        assert_equal(payouts['height'], tmpl['height'])
+        assert_equal([tx['hash'] for tx in payouts['transactions']], [tx['hash'] for tx in tmpl['transactions']])
+        assert_equal(len(payouts['transactions']), 1)
+        assert_equal(len(payouts['payouts']), 3)
+        coinbases = set()
+        for payout, address in zip(payouts['payouts'], addresses):
+            assert_equal(payout['address'], address)
+            coinbase = payout['coinbasetxn']
+            assert_equal(coinbase['fee'], tmpl['coinbasetxn']['fee'])
+            assert_equal(coinbase['communityfund'], tmpl['coinbasetxn']['communityfund'])
+            decoded = node.decoderawtransaction(coinbase['data'])
+            assert_equal(decoded['vout'][0]['scriptPubKey']['addresses'], [address])
+            coinbases.add(coinbase['hash'])
+            roots = node.getblockmerkleroots([coinbase['data']] + [tx['data'] for tx in payouts['transactions']], [])
+            assert_equal(payout['merkleTree'], roots['merkleTree'])
+        assert_equal(len(coinbases), 3)
+        assert_raises(JSONRPCException, node.getblocktemplatepayouts, ["notanaddress"])
+        assert_raises(JSONRPCException, node.getblocktemplatepayouts, [])
+
 if __name__ == '__main__':
     GetBlockTemplateTest().main()
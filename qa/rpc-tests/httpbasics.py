@@ -98,5 +98,18 @@ class HTTPBasicsTest (BitcoinTestFramework):
         assert_equal(b'"error":null' in out1, True)
         assert_equal(conn.sock!=None, True) # connection must be closed because bitcoind should use keep-alive by default
 
+        # the requests are counted in the class of their method, a batch in its lowest priority one
+        conn.request('POST', '/', '[{"method": "getbestblockhash"}, {"method": "getblock", "params": ["' +
+                     self.nodes[2].getbestblockhash() + '"]}]', headers)
+        out1 = conn.getresponse().read()
+        assert_equal(b'"error":null' in out1, True)
+        rpcinfo = self.nodes[2].getrpcinfo()
+        assert_equal([c['name'] for c in rpcinfo['classes']], ['mining', 'cheap', 'wallet', 'heavy'])
+        classes = dict((c['name'], c) for c in rpcinfo['classes'])
+        assert_equal(classes['mining']['maxrunning'], rpcinfo['threads'])
+        assert(classes['heavy']['done'] >= 1)
+        assert(classes['cheap']['done'] >= 1)
+        assert_equal(classes['cheap']['running'], 1) # the getrpcinfo call itself
+
 if __name__ == '__main__':
     HTTPBasicsTest().main()
@@ -97,6 +97,18 @@ class MerkleBlockTest(BitcoinTestFramework):
         # ...or if we have a -txindex
         assert_equal(self.nodes[2].verifytxoutproof(self.nodes[3].gettxoutproof([txid_spent])), [txid_spent])
 
+        # the batch of proofs gives the same proofs, and an error for those which can not be found
+        proofs = self.nodes[2].gettxoutproofs([{"txid": txid_spent, "blockhash": blockhash}, {"txid": txid_unspent}, {"txid": txid_spent}])
+        assert_equal(len(proofs), 3)
+        assert_equal(proofs[0]["txid"], txid_spent)
+        assert_equal(proofs[0]["blockhash"], blockhash)
+        assert_equal(proofs[0]["proof"], self.nodes[2].gettxoutproof([txid_spent], blockhash))
+        assert_equal(proofs[1]["proof"], self.nodes[2].gettxoutproof([txid_unspent]))
+        assert("proof" not in proofs[2])
+        assert_equal(proofs[2]["error"]["code"], -5)
+        verified = self.nodes[2].verifytxoutproofs([proofs[0]["proof"], proofs[1]["proof"]])
+        assert_equal(verified, [{"txids": [txid_spent]}, {"txids": [txid_unspent]}])
+
         # send funds to node 2, it will use them for sending a certificate
         tx0 = self.nodes[0].createrawtransaction([node0utxos.pop()], {self.nodes[2].getnewaddress(): 11.4375})
         self.nodes[0].sendrawtransaction(self.nodes[0].signrawtransaction(tx0)["hex"])
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017 The Zen Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+# Exercise the wallets loaded side by side with -wallet given more than once
+
+from decimal import Decimal
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import AuthServiceProxy, JSONRPCException
+from test_framework.util import assert_equal, assert_true, initialize_chain_clean, start_node, \
+    stop_node, wait_bitcoinds, rpc_url
+
+WALLETS = ["wallet.dat", "w1.dat", "w2.dat"]
+
+class MultiWalletTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self, split=False):
+        self.nodes = [start_node(0, self.options.tmpdir, extra_args=['-wallet=%s' % w for w in WALLETS])]
+        self.is_network_split = False
+
+    def wallet(self, name):
+        return AuthServiceProxy(rpc_url(0) + "/wallet/" + name)
+
+    def run_test(self):
+        node = self.nodes[0]
+        assert_equal(node.listwallets(), WALLETS)
+
+        w0 = self.wallet("wallet.dat")
+        w1 = self.wallet("w1.dat")
+        w2 = self.wallet("w2.dat")
+
+        # the calls not sent to a wallet are for the first one
+        node.generate(101)
+        assert_equal(node.getbalance(), w0.getbalance())
+        assert_true(w0.getbalance() > 0)
+        assert_equal(w1.getbalance(), 0)
+        assert_equal(w2.getbalance(), 0)
+
+        # each wallet has keys of its own
+        addr1 = w1.getnewaddress()
+        assert_true(w1.validateaddress(addr1)["ismine"])
+        assert_true(not w2.validateaddress(addr1)["ismine"])
+        assert_true(not node.validateaddress(addr1)["ismine"])
+
+        w0.sendtoaddress(addr1, Decimal("2.0"))
+        node.generate(1)
+        assert_equal(w1.getbalance(), Decimal("2.0"))
+        assert_equal(w2.getbalance(), 0)
+        assert_equal(len(w1.listtransactions()), 1)
+        assert_equal(len(w2.listtransactions()), 0)
+
+        w1.sendtoaddress(w2.getnewaddress(), Decimal("1.0"))
+        node.generate(1)
+        assert_equal(w2.getbalance(), Decimal("1.0"))
+        assert_true(w1.getbalance() < Decimal("1.0"))
+
+        # a wallet not loaded
+        try:
+            self.wallet("missing.dat").getbalance()
+            assert(False)
+        except JSONRPCException as e:
+            assert_equal(e.error['code'], -18)
+
+        # the wallets are all there after a restart
+        balances = [self.wallet(w).getbalance() for w in WALLETS]
+        stop_node(node, 0)
+        wait_bitcoinds()
+        self.setup_network()
+        assert_equal(self.nodes[0].listwallets(), WALLETS)
+        assert_equal([self.wallet(w).getbalance() for w in WALLETS], balances)
+
+
+if __name__ == '__main__':
+    MultiWalletTest().main()
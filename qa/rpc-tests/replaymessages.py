@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+# Copyright (c) 2014 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+# Exercise -capturemessages and the replaymessages RPC function
+
+import os
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import JSONRPCException
+from test_framework.util import assert_equal, assert_true, start_node, stop_node, \
+    connect_nodes_bi, sync_mempools
+
+class ReplayMessagesTest(BitcoinTestFramework):
+
+    def setup_network(self, split=False):
+        # node2 is not connected, it only gets the messages node0 captured
+        self.nodes = []
+        self.nodes.append(start_node(0, self.options.tmpdir, extra_args=['-capturemessages=capture.dat']))
+        self.nodes.append(start_node(1, self.options.tmpdir))
+        self.nodes.append(start_node(2, self.options.tmpdir))
+        connect_nodes_bi(self.nodes, 0, 1)
+        self.is_network_split = False
+        self.sync_all()
+
+    def run_test(self):
+        txid = self.nodes[1].sendtoaddress(self.nodes[0].getnewaddress(), 1)
+        sync_mempools(self.nodes[0:2])
+        assert_true(txid not in self.nodes[2].getrawmempool())
+
+        # the capture is complete once node0 stopped
+        stop_node(self.nodes[0], 0)
+        capture = os.path.join(self.options.tmpdir, "node0", "regtest", "capture.dat")
+        stats = self.nodes[2].replaymessages(capture)
+        assert_true(stats["messages"] > 0)
+        assert_true(stats["peers"] >= 1)
+        assert_equal(stats["skipped"], 0)
+        assert_true(stats["messagespersecond"] > 0)
+        assert_true("version" in stats["commands"])
+        tx = stats["commands"]["tx"]
+        assert_true(tx["count"] >= 1)
+        assert_true(tx["p50us"] <= tx["p90us"] <= tx["p99us"] <= tx["maxus"])
+        assert_true("cs_main" in stats["lockwait"])
+        # the replayed transaction was admitted as it was by node0
+        assert_true(txid in self.nodes[2].getrawmempool())
+
+        try:
+            self.nodes[2].replaymessages("nocapture.dat")
+            assert(False)
+        except JSONRPCException as e:
+            assert_true("can not open" in e.error['message'])
+
+        self.nodes[0] = start_node(0, self.options.tmpdir)
+
+if __name__ == '__main__':
+    ReplayMessagesTest().main()
@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+# Copyright (c) 2014 The Bitcoin Core developers
+# Copyright (c) 2018 The Zencash developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+# Exercise the -scindex sidechain activity index and the getscactivity RPC function
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.authproxy import JSONRPCException
+from test_framework.util import assert_equal, assert_true, initialize_chain_clean, start_nodes, \
+    connect_nodes_bi, mark_logs
+from test_framework.test_framework import ForkHeights
+from test_framework.mc_test.mc_test import *
+from decimal import Decimal
+import time
+
+DEBUG_MODE = 1
+NUMB_OF_NODES = 2
+EPOCH_LENGTH = 10
+
+
+class sc_activity_index(BitcoinTestFramework):
+
+    def setup_chain(self, split=False):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, NUMB_OF_NODES)
+
+    def setup_network(self, split=False):
+        # only the first node has the index
+        self.nodes = start_nodes(NUMB_OF_NODES, self.options.tmpdir,
+                                 extra_args=[['-scindex', '-debug=sc'], ['-debug=sc']])
+        connect_nodes_bi(self.nodes, 0, 1)
+        self.is_network_split = split
+        self.sync_all()
+
+    def wait_activity(self, scid, fromHeight, toHeight):
+        # the index is built in the background
+        for _ in range(100):
+            try:
+                return self.nodes[0].getscactivity(scid, fromHeight, toHeight)
+            except JSONRPCException as e:
+                assert_true("still being built" in e.error['message'])
+            time.sleep(0.1)
+        assert_true(False)
+
+    def run_test(self):
+        mark_logs("Node 0 generates {} blocks".format(ForkHeights['MINIMAL_SC'] + 1), self.nodes, DEBUG_MODE)
+        self.nodes[0].generate(ForkHeights['MINIMAL_SC'] + 1)
+        self.sync_all()
+
+        mcTest = CertTestUtils(self.options.tmpdir, self.options.srcdir)
+        vk = mcTest.generate_params("sc1")
+        constant = generate_random_field_element_hex()
+
+        creation_amount = Decimal("2.0")
+        ret = self.nodes[0].sc_create({
+            "version": 0,
+            "withdrawalEpochLength": EPOCH_LENGTH,
+            "toaddress": "dada",
+            "amount": creation_amount,
+            "wCertVk": vk,
+            "constant": constant,
+            "mainchainBackwardTransferRequestDataLength": 1
+        })
+        scid = ret['scid']
+        creation_tx = ret['txid']
+        self.sync_all()
+        creation_height = self.nodes[0].getblockcount() + 1
+        self.nodes[0].generate(1)
+        self.sync_all()
+
+        mark_logs("Node 0 sends a forward transfer and a backward transfer request", self.nodes, DEBUG_MODE)
+        ft_amount = Decimal("0.5")
+        mc_return_address = self.nodes[0].getnewaddress()
+        ft_tx = self.nodes[0].sc_send([{'toaddress': "abcd", 'amount': ft_amount, "scid": scid,
+                                        "mcReturnAddress": mc_return_address}], {"fee": Decimal("0.0001")})
+        mc_dest_address = self.nodes[0].getnewaddress()
+        bwtr_tx = self.nodes[0].sc_request_transfer([{'vScRequestData': [generate_random_field_element_hex()],
+                                                      'scFee': Decimal("0.001"), 'scid': scid,
+                                                      'mcDestinationAddress': mc_dest_address}], {"fee": Decimal("0.0001")})
+        self.sync_all()
+        activity_height = self.nodes[0].getblockcount() + 1
+        activity_block = self.nodes[0].generate(1)[0]
+        self.nodes[0].generate(1)
+        self.sync_all()
+
+        ret = self.wait_activity(scid, 0, 1000)
+        assert_equal(ret['scid'], scid)
+        assert_equal(ret['toheight'], self.nodes[0].getblockcount())
+        activity = ret['activity']
+        assert_equal(len(activity), 3)
+        assert_equal(activity[0]['type'], "creation")
+        assert_equal(activity[0]['txid'], creation_tx)
+        assert_equal(activity[0]['height'], creation_height)
+        assert_equal(activity[0]['value'], creation_amount)
+        by_type = {entry['type']: entry for entry in activity[1:]}
+        assert_equal(by_type['forwardtransfer']['txid'], ft_tx)
+        assert_equal(by_type['forwardtransfer']['value'], ft_amount)
+        assert_equal(by_type['forwardtransfer']['mcReturnAddress'], mc_return_address)
+        assert_equal(by_type['bwtrequest']['txid'], bwtr_tx)
+        assert_equal(by_type['bwtrequest']['scFee'], Decimal("0.001"))
+        assert_equal(by_type['bwtrequest']['mcDestinationAddress'], mc_dest_address)
+        for entry in activity[1:]:
+            assert_equal(entry['height'], activity_height)
+            assert_equal(entry['blockhash'], activity_block)
+
+        # the range is inclusive
+        assert_equal(len(self.wait_activity(scid, creation_height, creation_height)['activity']), 1)
+        assert_equal(len(self.wait_activity(scid, creation_height + 1, activity_height)['activity']), 2)
+        assert_equal(len(self.wait_activity(scid, activity_height + 1, 1000)['activity']), 0)
+
+        mark_logs("The entries of a block reorganized away are not returned", self.nodes, DEBUG_MODE)
+        self.nodes[0].invalidateblock(activity_block)
+        assert_equal(len(self.wait_activity(scid, 0, 1000)['activity']), 1)
+        self.nodes[0].reconsiderblock(activity_block)
+        assert_equal(len(self.wait_activity(scid, 0, 1000)['activity']), 3)
+
+        try:
+            self.nodes[0].getscactivity(scid, 10, 5)
+            assert_true(False)
+        except JSONRPCException as e:
+            assert_true("Invalid height range" in e.error['message'])
+
+        try:
+            self.nodes[1].getscactivity(scid, 0, 1000)
+            assert_true(False)
+        except JSONRPCException as e:
+            assert_true("-scindex" in e.error['message'])
+
+
+if __name__ == '__main__':
+    sc_activity_index().main()
@@ -408,8 +408,11 @@ class AsyncProofVerifierTest(BitcoinTestFramework):
         assert_true(final_raw_tx in self.nodes[1].getrawmempool())
 
         # Get the current async proof verifier statistics
+        # (the proof cache is expected to be used by 'ConnectBlock()', so it is checked separately)
         node0_initial_stats = self.nodes[0].getproofverifierstats()
         node1_initial_stats = self.nodes[1].getproofverifierstats()
+        node1_initial_cache_stats = node1_initial_stats.pop("proofCache")
+        node0_initial_stats.pop("proofCache")
 
         # Generate one block containing the last CSW transaction (currently in the mempool)
         mark_logs("Generate one block...", self.nodes, DEBUG_MODE)
@@ -425,8 +428,15 @@ class AsyncProofVerifierTest(BitcoinTestFramework):
         # by comparing its current statistics with the initial ones.
         # This way we are also sure that it has not been called by 'CreateNewBlock()'
         # since we generated a block to include the CSW transaction.
-        assert_equal(node0_initial_stats, self.nodes[0].getproofverifierstats())
-        assert_equal(node1_initial_stats, self.nodes[1].getproofverifierstats())
+        node0_stats = self.nodes[0].getproofverifierstats()
+        node1_stats = self.nodes[1].getproofverifierstats()
+        node1_cache_stats = node1_stats.pop("proofCache")
+        node0_stats.pop("proofCache")
+        assert_equal(node0_initial_stats, node0_stats)
+        assert_equal(node1_initial_stats, node1_stats)
+
+        # Check that the CSW proof verified when accepted into the mempool has been found in the cache
+        assert_true(node1_cache_stats["hits"] > node1_initial_cache_stats["hits"])
 
         # Disconnect one block
         mark_logs("Disconnect one block...", self.nodes, DEBUG_MODE)
@@ -441,8 +451,12 @@ class AsyncProofVerifierTest(BitcoinTestFramework):
 
         # Check that the async proof verifier has not been called by 'DisconnectTip()'
         # by comparing its current statistics with the initial ones.
-        assert_equal(node0_initial_stats, self.nodes[0].getproofverifierstats())
-        assert_equal(node1_initial_stats, self.nodes[1].getproofverifierstats())
+        node0_stats = self.nodes[0].getproofverifierstats()
+        node1_stats = self.nodes[1].getproofverifierstats()
+        node0_stats.pop("proofCache")
+        node1_stats.pop("proofCache")
+        assert_equal(node0_initial_stats, node0_stats)
+        assert_equal(node1_initial_stats, node1_stats)
 
 
 if __name__ == '__main__':
@@ -17,8 +17,11 @@ from test_framework.test_framework import ForkHeights, MINER_REWARD_POST_H200
 from test_framework.mc_test.mc_test import *
 
 from decimal import Decimal
+import http.client
+import json
 import pprint
 import time
+import urllib.parse
 
 NUMB_OF_NODES = 3
 DEBUG_MODE = 1
@@ -26,6 +29,13 @@ EPOCH_LENGTH = 6
 CERT_FEE = Decimal('0.0001')
 
 
+def rest_get(node, path, headers={}):
+    url = urllib.parse.urlparse(node.url)
+    conn = http.client.HTTPConnection(url.hostname, url.port)
+    conn.request('GET', path, headers=headers)
+    return conn.getresponse()
+
+
 # Create one-input, one-output, no-fee transaction:
 class CswNullifierTest(BitcoinTestFramework):
 
@@ -35,7 +45,7 @@ class CswNullifierTest(BitcoinTestFramework):
 
     def setup_network(self, split=False):
         self.nodes = start_nodes(NUMB_OF_NODES, self.options.tmpdir,
-                                 extra_args=[["-sccoinsmaturity=0", '-scproofqueuesize=0', '-logtimemicros=1', '-debug=sc', '-debug=py',
+                                 extra_args=[["-sccoinsmaturity=0", '-scproofqueuesize=0', '-logtimemicros=1', '-debug=sc', '-debug=py', '-rest',
                                               '-debug=mempool', '-debug=net', '-debug=bench']] * NUMB_OF_NODES)
 
         if not split:
@@ -226,6 +236,29 @@ class CswNullifierTest(BitcoinTestFramework):
         res = self.nodes[0].checkcswnullifier(scid, null1)
         assert_equal(res['data'], 'true')
 
+        mark_logs("Check nullifier and sidechain over REST...", self.nodes, DEBUG_MODE)
+        resp = rest_get(self.nodes[0], "/rest/cswnullifier/{}/{}.json".format(scid, null1))
+        assert_equal(resp.status, 200)
+        etag = resp.getheader('ETag')
+        assert_equal(etag, '"' + self.nodes[0].getbestblockhash() + '"')
+        assert_true(json.loads(resp.read().decode('utf-8'))['exists'])
+        resp = rest_get(self.nodes[0], "/rest/cswnullifier/{}/{}.bin".format(scid, null1))
+        assert_equal(resp.read(), b'\x01')
+        resp = rest_get(self.nodes[0], "/rest/cswnullifier/{}/{}.hex".format(scid, null1), {'If-None-Match': etag})
+        assert_equal(resp.status, 304)
+        resp = rest_get(self.nodes[0], "/rest/cswnullifier/{}/{}.json".format(scid, "00" * 32))
+        assert_equal(resp.status, 200)
+        assert_false(json.loads(resp.read().decode('utf-8'))['exists'])
+
+        resp = rest_get(self.nodes[0], "/rest/sidechain/{}.json".format(scid))
+        assert_equal(resp.status, 200)
+        sc_rest = json.loads(resp.read().decode('utf-8'), parse_float=Decimal)
+        sc_rpc = self.nodes[0].getscinfo(scid)['items'][0]
+        assert_equal(sc_rest['balance'], sc_rpc['balance'])
+        assert_equal(sc_rest['state'], sc_rpc['state'])
+        assert_equal(sc_rest['lastCertificateHash'], sc_rpc['lastCertificateHash'])
+        assert_equal(rest_get(self.nodes[0], "/rest/sidechain/{}.hex".format("11" * 32)).status, 404)
+
         n2_bal = self.nodes[2].getbalance()
         mark_logs("Check Node2 has the expected balance...", self.nodes, DEBUG_MODE)
         assert_equal(n2_bal, sc_csw_amount)
@@ -9,7 +9,7 @@ from test_framework.authproxy import JSONRPCException
 from test_framework.util import assert_equal, initialize_chain_clean, \
     start_nodes, stop_nodes, get_epoch_data, \
     sync_blocks, sync_mempools, connect_nodes_bi, wait_bitcoinds, mark_logs, \
-    assert_true, swap_bytes
+    assert_true, assert_false, swap_bytes
 from test_framework.mc_test.mc_test import CertTestUtils, generate_random_field_element_hex
 from test_framework.blockchainhelper import BlockchainHelper, SidechainParameters
 import pprint
@@ -216,6 +216,23 @@ class sc_getscinfo(BitcoinTestFramework):
             assert_equal(scids_alive[count], item['scid'])
             count += 1
 
+        #------------------------------------------------------------------------------------------
+        page_size = 3
+        mark_logs(f"Get all sidechains in pages of {page_size} following the cursor", self.nodes, DEBUG_MODE)
+        scids_paged = []
+        sc_info = self.nodes[1].getscinfo("*", False, False, 0, page_size)
+        while True:
+            for item in sc_info['items']:
+                # the non-verbose output has no fee lists
+                assert_false('scFees' in item)
+                scids_paged.append(item['scid'])
+            if 'nextCursor' not in sc_info:
+                break
+            assert_equal(sc_info['nextCursor'], scids_paged[-1])
+            sc_info = self.nodes[1].getscinfo("*", False, False, 0, page_size, sc_info['nextCursor'])
+            assert_equal(sc_info['totalItems'], NUM_OF_SIDECHAINS - len(scids_paged))
+        assert_equal(scids_paged, scids_all)
+
         # negative tests
         mark_logs("Negative tests", self.nodes, DEBUG_MODE)
         #------------------------------------------------------------------------------------------
@@ -249,6 +266,12 @@ class sc_getscinfo(BitcoinTestFramework):
         except JSONRPCException as e:
             print(e.error['message'])
 
+        try:
+            self.nodes[1].getscinfo("*", False, True, 0, -1, "not-an-scid")
+            assert_true(False)
+        except JSONRPCException as e:
+            print(e.error['message'])
+
         try:
             # this is ok because the interval is legal
             self.nodes[1].getscinfo("*", False, True, NUM_ALIVE, 100)
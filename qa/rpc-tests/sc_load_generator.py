@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017 The Zen Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+'''
+Generates a configurable sidechain workload on a regtest node, to measure ConnectBlock, the mempool
+and the miner under sidechain traffic rather than under the coinbase-only blocks of regtest.
+
+1. the sidechains are created, --sc-per-tx creation outputs per transaction, all in the same block
+   so that their epochs are aligned;
+2. for --epochs epochs, every block is preceded by a flood of forward transfers and backward transfer
+   requests to random sidechains, and every epoch boundary by a storm of certificates, one for each
+   sidechain alive;
+3. the last --ceasing sidechains are certified in the first epoch only: after the others they cease,
+   then --csws ceased sidechain withdrawals are sent for each of them, in a single transaction.
+
+The time of each phase is printed, with the getblockconnectstats summary of its blocks, and also
+written as JSON with --output-json. Run with small values it is a smoke test of the sidechain paths,
+for example:
+
+    sc_load_generator.py --sidechains=500 --ft-txs=50 --fts-per-tx=100 --epochs=3 --output-json=load.json
+
+Proofs are created with the mc_test tool for keys shared by all the sidechains, so their generation
+does not grow with the sidechains.
+'''
+
+from decimal import Decimal
+import json
+import random
+import time
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.test_framework import ForkHeights
+from test_framework.util import assert_equal, assert_true, initialize_chain_clean, start_nodes, \
+    mark_logs, get_epoch_data, swap_bytes
+from test_framework.mc_test.mc_test import CertTestUtils, CSWTestUtils, generate_random_field_element_hex
+
+DEBUG_MODE = 1
+SC_KEYS_TAG = "load"
+SC_CREATION_AMOUNT = Decimal("1.0")
+FT_AMOUNT = Decimal("0.0001")
+BWTR_SC_FEE = Decimal("0.00001")
+# the sidechain fees set by the certificates, the transfers must not fall below them
+CERT_FT_FEE = Decimal("0")
+CERT_MBTR_FEE = Decimal("0")
+CERT_FEE = Decimal("0.00001")
+TX_FEE = Decimal("0.0001")
+CSW_AMOUNT = Decimal("0.00001")
+
+class ScLoadGenerator(BitcoinTestFramework):
+
+    def add_options(self, parser):
+        parser.add_option("--sidechains", dest="sidechains", default=20, type="int",
+                          help="Number of sidechains created (default 20)")
+        parser.add_option("--sc-per-tx", dest="sc_per_tx", default=10, type="int",
+                          help="Sidechain creation outputs per transaction (default 10)")
+        parser.add_option("--epoch-length", dest="epoch_length", default=10, type="int",
+                          help="Withdrawal epoch length of the sidechains (default 10)")
+        parser.add_option("--epochs", dest="epochs", default=2, type="int",
+                          help="Epochs of traffic, each closed by a certificate storm (default 2)")
+        parser.add_option("--ft-txs", dest="ft_txs", default=5, type="int",
+                          help="Forward transfer transactions before each block (default 5)")
+        parser.add_option("--fts-per-tx", dest="fts_per_tx", default=10, type="int",
+                          help="Forward transfers per transaction (default 10)")
+        parser.add_option("--bwtr-txs", dest="bwtr_txs", default=5, type="int",
+                          help="Backward transfer request transactions before each block (default 5)")
+        parser.add_option("--bwtrs-per-tx", dest="bwtrs_per_tx", default=10, type="int",
+                          help="Backward transfer requests per transaction (default 10)")
+        parser.add_option("--ceasing", dest="ceasing", default=2, type="int",
+                          help="Sidechains left to cease, among the ones created (default 2)")
+        parser.add_option("--csws", dest="csws", default=3, type="int",
+                          help="Ceased sidechain withdrawals for each ceased sidechain (default 3)")
+        parser.add_option("--output-json", dest="output_json", default="",
+                          help="Write the results of the phases to this file in JSON format")
+
+    def setup_chain(self):
+        print("Initializing test directory " + self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self, split=False):
+        # the connection stats are kept for all the blocks of a phase
+        self.nodes = start_nodes(1, self.options.tmpdir, extra_args=[['-logtimemicros=1', '-debug=py', '-debug=bench',
+                                 '-blockconnectstats=100000', '-maxorphantx=100000', '-sccoinsmaturity=0']])
+        self.is_network_split = split
+
+    def run_phase(self, name, work):
+        '''Runs the work of a phase, then reports its time and the connection of the blocks it mined'''
+        node = self.nodes[0]
+        height = node.getblockcount()
+        start = time.time()
+        work()
+        elapsed = time.time() - start
+        blocks = node.getblockcount() - height
+        result = {"phase": name, "seconds": round(elapsed, 3), "blocks": blocks, "mempool": node.getmempoolinfo()["size"]}
+        if blocks > 0:
+            stats = node.getblockconnectstats(blocks)
+            result["connect"] = {stage: stats["stages"][stage] for stage in ["connect", "verify", "commtree", "batchverify", "total"]}
+            result["content"] = stats["content"]
+        mark_logs("{}: {:.3f}s, {} blocks".format(name, elapsed, blocks), self.nodes, DEBUG_MODE)
+        if blocks > 0:
+            total = result["connect"]["total"]
+            print("    connect total avg {}us p50 {}us p90 {}us max {}us".format(
+                total["avgus"], total["p50us"], total["p90us"], total["maxus"]))
+        self.results.append(result)
+
+    def generate_block(self):
+        # the block must take every transaction sent, the phases would mix otherwise
+        node = self.nodes[0]
+        node.generate(1)
+        assert_equal(node.getmempoolinfo()["size"], 0)
+
+    def create_sidechains(self):
+        node = self.nodes[0]
+        for first in range(0, self.options.sidechains, self.options.sc_per_tx):
+            sc_cr = [{
+                "version": 0,
+                "epoch_length": self.options.epoch_length,
+                "amount": SC_CREATION_AMOUNT,
+                "address": "%064x" % (first + n + 1),
+                "wCertVk": self.cert_vk,
+                "wCeasedVk": self.csw_vk,
+                "constant": self.constant,
+                "mainchainBackwardTransferRequestDataLength": 1
+            } for n in range(min(self.options.sc_per_tx, self.options.sidechains - first))]
+            rawtx = node.createrawtransaction([], {}, [], sc_cr)
+            funded_tx = node.fundrawtransaction(rawtx)
+            signed_tx = node.signrawtransaction(funded_tx['hex'])
+            txid = node.sendrawtransaction(signed_tx['hex'])
+            self.scids += [out['scid'] for out in node.getrawtransaction(txid, 1)['vsc_ccout']]
+        self.generate_block()
+
+        heights = set(node.getscinfo(scid)['items'][0]['createdAtBlockHeight'] for scid in self.scids)
+        assert_equal(len(heights), 1)
+
+    def send_transfers(self, alive):
+        node = self.nodes[0]
+        for _ in range(self.options.ft_txs):
+            outputs = [{'toaddress': "abcd", 'amount': FT_AMOUNT, "scid": random.choice(alive), "mcReturnAddress": self.mc_address}
+                       for _ in range(self.options.fts_per_tx)]
+            node.sc_send(outputs, {"fee": TX_FEE})
+        for _ in range(self.options.bwtr_txs):
+            outputs = [{'vScRequestData': [generate_random_field_element_hex()], 'scFee': BWTR_SC_FEE, 'scid': random.choice(alive),
+                        'mcDestinationAddress': self.mc_address} for _ in range(self.options.bwtrs_per_tx)]
+            node.sc_request_transfer(outputs, {"fee": TX_FEE})
+
+    def send_certificates(self, scids):
+        node = self.nodes[0]
+        for scid in scids:
+            epoch_number, epoch_cum_tree_hash, _ = get_epoch_data(scid, node, self.options.epoch_length)
+            proof = self.cert_utils.create_test_proof(SC_KEYS_TAG, str(swap_bytes(scid)), epoch_number, 1, CERT_MBTR_FEE, CERT_FT_FEE,
+                                                      epoch_cum_tree_hash, constant=self.constant, pks=[], amounts=[])
+            assert_true(proof is not None)
+            node.sc_send_certificate(scid, epoch_number, 1, epoch_cum_tree_hash, proof, [], CERT_FT_FEE, CERT_MBTR_FEE, CERT_FEE)
+
+    def run_epoch(self, alive, certified):
+        # the certificates of the previous epoch are sent in the first block of the next one
+        for _ in range(self.options.epoch_length - 1):
+            self.send_transfers(alive)
+            self.generate_block()
+        self.send_certificates(certified)
+        self.generate_block()
+
+    def send_csws(self, scids):
+        node = self.nodes[0]
+        for scid in scids:
+            act_cert_data = node.getactivecertdatahash(scid)['certDataHash']
+            ceasing_cum_tree = node.getceasingcumsccommtreehash(scid)['ceasingCumScTxCommTree']
+            sc_csws = []
+            for _ in range(self.options.csws):
+                nullifier = generate_random_field_element_hex()
+                proof = self.csw_utils.create_test_proof(SC_KEYS_TAG, CSW_AMOUNT, str(swap_bytes(scid)), nullifier, self.mc_address,
+                                                         ceasing_cum_tree, cert_data_hash=act_cert_data, constant=self.constant)
+                assert_true(proof is not None)
+                sc_csws.append({"amount": CSW_AMOUNT, "senderAddress": self.mc_address, "scId": scid, "epoch": 0,
+                                "nullifier": nullifier, "activeCertData": act_cert_data,
+                                "ceasingCumScTxCommTree": ceasing_cum_tree, "scProof": proof})
+            rawtx = node.createrawtransaction([], {self.mc_address: CSW_AMOUNT * self.options.csws}, sc_csws)
+            funded_tx = node.fundrawtransaction(rawtx)
+            signed_tx = node.signrawtransaction(funded_tx['hex'], None, None, "NONE")
+            node.sendrawtransaction(signed_tx['hex'])
+
+    def run_test(self):
+        node = self.nodes[0]
+        # the ceasing sidechains need the certificate of the first epoch for their withdrawals
+        assert_true(0 <= self.options.ceasing < self.options.sidechains)
+        assert_true(self.options.epochs > 0)
+        self.results = []
+        self.scids = []
+
+        # enough coinbases for the whole load, which are mature once the sidechain fork is reached
+        mark_logs("Reaching the sidechain fork", self.nodes, DEBUG_MODE)
+        node.generate(ForkHeights['MINIMAL_SC'] + 100)
+        self.mc_address = node.getnewaddress()
+
+        self.cert_utils = CertTestUtils(self.options.tmpdir, self.options.srcdir)
+        self.csw_utils = CSWTestUtils(self.options.tmpdir, self.options.srcdir)
+        self.cert_vk = self.cert_utils.generate_params(SC_KEYS_TAG)
+        self.csw_vk = self.csw_utils.generate_params(SC_KEYS_TAG)
+        self.constant = generate_random_field_element_hex()
+
+        self.run_phase("create %d sidechains" % self.options.sidechains, self.create_sidechains)
+
+        ceasing = self.scids[len(self.scids) - self.options.ceasing:]
+        alive = self.scids[:len(self.scids) - self.options.ceasing]
+        for epoch in range(self.options.epochs):
+            certified = self.scids if epoch == 0 else alive
+            self.run_phase("epoch %d, %d certificates" % (epoch, len(certified)),
+                           lambda: self.run_epoch(certified, certified))
+
+        if ceasing and self.options.csws > 0:
+            def cease():
+                while node.getscinfo(ceasing[0])['items'][0]['state'] != "CEASED":
+                    self.run_epoch(alive, alive)
+            self.run_phase("cease %d sidechains" % len(ceasing), cease)
+            for scid in ceasing:
+                assert_equal(node.getscinfo(scid)['items'][0]['state'], "CEASED")
+
+            def csws():
+                self.send_csws(ceasing)
+                self.generate_block()
+            self.run_phase("%d ceased sidechain withdrawals" % (len(ceasing) * self.options.csws), csws)
+
+        if self.options.output_json:
+            with open(self.options.output_json, "w") as f:
+                json.dump({"options": vars(self.options), "phases": self.results}, f, indent=2)
+
+
+if __name__ == '__main__':
+    ScLoadGenerator().main()
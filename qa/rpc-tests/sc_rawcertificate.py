@@ -15,6 +15,7 @@ from decimal import *
 import operator
 import pprint
 from random import randrange
+import struct
 
 import time
 
@@ -176,6 +177,20 @@ class sc_rawcert(BitcoinTestFramework):
             print("\n======> ", errorString)
             assert_true(False)
 
+        mark_logs("Node0 creates the same raw certificate with the packed list of backward transfers", self.nodes, DEBUG_MODE)
+        pkh_node2 = self.nodes[0].validateaddress(addr_node2)['scriptPubKey'][6:46]
+        packed_bwt_outs = struct.pack('<q', int(bt_amount * 100000000)).hex() + pkh_node2
+        assert_equal(raw_cert, self.nodes[0].createrawcertificate(raw_inputs, raw_outs, packed_bwt_outs, raw_params))
+
+        mark_logs("Node0 tries a packed list with a truncated entry, expecting failure", self.nodes, DEBUG_MODE)
+        try:
+            self.nodes[0].createrawcertificate(raw_inputs, raw_outs, packed_bwt_outs[:-2], raw_params)
+            assert_true(False)
+        except JSONRPCException as e:
+            errorString = e.error['message']
+            print("======> ", errorString, "\n")
+            assert_true("must be a multiple of" in errorString)
+
         decoded_cert_pre = self.nodes[0].decoderawtransaction(raw_cert)
         decoded_cert_pre_list = sorted(decoded_cert_pre.items())
 
@@ -108,6 +108,9 @@ class SpentIndexTest(BitcoinTestFramework):
         assert_equal(txVerbose3["vin"][0]["address"], address2)
         assert_equal(txVerbose3["vin"][0]["value"], Decimal(unspent[0]["amount"]))
         assert_equal(txVerbose3["vin"][0]["valueZat"], amount)
+        # the outputs spent in the mempool
+        assert_equal(self.nodes[1].getrawtransaction(txid, 1)["vout"][0]["spentTxId"], txid2)
+        assert("spentTxId" not in txVerbose3["vout"][0])
 
         # Check the database index
         block_hash = self.nodes[0].generate(1)
@@ -117,6 +120,12 @@ class SpentIndexTest(BitcoinTestFramework):
         assert_equal(txVerbose4["vin"][0]["address"], address2)
         assert_equal(txVerbose4["vin"][0]["value"], Decimal(unspent[0]["amount"]))
         assert_equal(txVerbose4["vin"][0]["valueZat"], amount)
+        # the outputs spent in the blocks
+        txVerbose5 = self.nodes[3].getrawtransaction(txid, 1)
+        assert_equal(txVerbose5["vout"][0]["spentTxId"], txid2)
+        assert_equal(txVerbose5["vout"][0]["spentIndex"], 0)
+        assert_equal(txVerbose5["vout"][0]["spentHeight"], 107)
+        assert("spentTxId" not in txVerbose4["vout"][0])
 
 
         # Check block deltas
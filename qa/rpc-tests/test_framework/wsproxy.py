@@ -24,6 +24,7 @@ def __func():
 log = logging.getLogger("HorizenWebsocket")
 
 EVT_UPDATE_TIP = 0
+EVT_NEW_BLOCK_TEMPLATE = 1
 EVT_UNDEFINED = 0xff
 
 REQ_GET_SINGLE_BLOCK = 0
@@ -33,6 +34,11 @@ REQ_SEND_CERTIFICATE = 3
 REQ_GET_BLOCK_HEADERS = 4
 REQ_GET_TOP_QUALITY_CERTIFICATES = 5
 REQ_GET_SIDECHAIN_VERSIONS = 6
+REQ_SET_BINARY_MODE = 7
+REQ_GET_BLOCK_RANGE = 8
+REQ_BLOCK_RANGE_CREDIT = 9
+REQ_SET_SC_FILTER = 10
+REQ_SUBMIT_CERTIFICATE = 11
 REQ_UNDEFINED = 0xff
 
 MSG_EVENT = 0
@@ -54,6 +54,29 @@ class TimestampIndexTest(BitcoinTestFramework):
 
         assert_equal(hashes, blockhashes)
 
+        print("Checking the range queries without the timestamp index...")
+        assert_equal(self.nodes[0].getblockhashes(high, low), blockhashes)
+        options = {"noOrphans": True, "logicalTimes": True}
+        assert_equal(self.nodes[0].getblockhashes(high, low, options), self.nodes[1].getblockhashes(high, low, options))
+        # the same query again is answered from the cache, the narrower ones by searching the chain
+        assert_equal(self.nodes[0].getblockhashes(high, low, options), self.nodes[1].getblockhashes(high, low, options))
+        mid = self.nodes[1].getblock(blockhashes[40])["time"]
+        assert_equal(self.nodes[0].getblockhashes(mid, low), self.nodes[1].getblockhashes(mid, low))
+        assert_equal(self.nodes[0].getblockhashes(low, high), [])
+
+        print("Enabling the timestamp index of node 2, without a reindex...")
+        stop_node(self.nodes[2], 2)
+        self.nodes[2] = start_node(2, self.options.tmpdir, ["-debug", "-timestampindex"])
+        # the index is built in the background from the blocks already connected
+        for _ in range(60):
+            try:
+                hashes = self.nodes[2].getblockhashes(high, low)
+                break
+            except JSONRPCException as e:
+                assert("still being built" in e.error['message'])
+                time.sleep(1)
+        assert_equal(hashes, blockhashes)
+
         print("Passed\n")
 
 
@@ -0,0 +1,57 @@
+#!/usr/bin/env python3
+# Copyright (c) 2014 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+# Exercise -txreconciliation: the transactions are reconciled with the peers supporting it, and
+# announced to the others
+
+import time
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_true, start_node, connect_nodes, sync_mempools
+
+RECON_ARGS = ['-txreconciliation', '-reconfloodpeers=0', '-debug=net']
+
+class TxReconciliationTest(BitcoinTestFramework):
+
+    def setup_network(self, split=False):
+        # node0 -> node1 -> node2 reconcile, node3 does not
+        self.nodes = []
+        for i in range(3):
+            self.nodes.append(start_node(i, self.options.tmpdir, extra_args=RECON_ARGS))
+        self.nodes.append(start_node(3, self.options.tmpdir))
+        connect_nodes(self.nodes[0], 1)
+        connect_nodes(self.nodes[1], 2)
+        connect_nodes(self.nodes[0], 3)
+        self.is_network_split = False
+        self.sync_all()
+
+    def recon_peers(self, node):
+        return [peer['txreconciliation'] for peer in node.getpeerinfo()]
+
+    def run_test(self):
+        # the negotiation follows the verack
+        while not all(recon['enabled'] for recon in self.recon_peers(self.nodes[1])):
+            time.sleep(0.1)
+        for recon in self.recon_peers(self.nodes[1]):
+            assert_equal(recon['flood'], False)
+        # node0 reconciles with node1 only
+        assert_equal(sorted(recon['enabled'] for recon in self.recon_peers(self.nodes[0])), [False, True])
+        assert_true(not any(recon['enabled'] for recon in self.recon_peers(self.nodes[3])))
+
+        # node1 answers the reconciliations of node0, and asks node2 for them
+        txids = [self.nodes[1].sendtoaddress(self.nodes[3].getnewaddress(), 1) for _ in range(3)]
+        sync_mempools(self.nodes)
+        for node in self.nodes:
+            for txid in txids:
+                assert_true(txid in node.getrawmempool())
+
+        # the transactions got through the reconciliations
+        while sum(recon['rounds'] for recon in self.recon_peers(self.nodes[1])) == 0:
+            time.sleep(0.5)
+
+        self.sync_all()
+
+if __name__ == '__main__':
+    TxReconciliationTest().main()
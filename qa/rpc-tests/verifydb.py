@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017 The Zen Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+# Exercise the verification of the last blocks at startup, with the coins checks in the background
+
+import time
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, initialize_chain_clean, start_node, stop_node
+
+CHECK_BLOCKS = 20
+
+class VerifyDBTest(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory "+self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, 1)
+
+    def setup_network(self, split=False):
+        self.nodes = [start_node(0, self.options.tmpdir)]
+        self.is_network_split = False
+
+    def restart_node(self, extra_args):
+        stop_node(self.nodes[0], 0)
+        self.nodes[0] = start_node(0, self.options.tmpdir, extra_args=extra_args)
+
+    def run_test(self):
+        self.nodes[0].generate(CHECK_BLOCKS + 10)
+
+        # all the levels at startup
+        self.restart_node(['-checklevel=4', '-checkblocks=%d' % CHECK_BLOCKS])
+        verification = self.nodes[0].getblockchaininfo()["startupverification"]
+        assert_equal(verification["state"], "done")
+        assert_equal(verification["level"], 4)
+        assert_equal(verification["blocks"], CHECK_BLOCKS + 1)
+        assert_equal(verification["checked"], CHECK_BLOCKS + 1)
+        assert_equal(verification["disconnected"], CHECK_BLOCKS + 1)
+        assert_equal(verification["reconnected"], CHECK_BLOCKS + 1)
+
+        # the coins checks once the node is up
+        self.restart_node(['-checklevel=4', '-checkblocks=%d' % CHECK_BLOCKS, '-checkblocksbackground'])
+        for _ in range(100):
+            verification = self.nodes[0].getblockchaininfo()["startupverification"]
+            if verification["state"] != "background":
+                break
+            time.sleep(0.1)
+        assert_equal(verification["state"], "done")
+        assert_equal(verification["checked"], CHECK_BLOCKS + 1)
+        assert_equal(verification["reconnected"], CHECK_BLOCKS + 1)
+
+        # no time to verify anything
+        self.restart_node(['-checklevel=2', '-checkblocks=%d' % CHECK_BLOCKS, '-checkblocksseconds=1'])
+        verification = self.nodes[0].getblockchaininfo()["startupverification"]
+        assert(verification["state"] in ("done", "stopped"))
+        assert_equal(verification["disconnected"], 0)
+
+if __name__ == '__main__':
+    VerifyDBTest().main()
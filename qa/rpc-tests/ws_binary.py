@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+# Copyright (c) 2014 The Bitcoin Core developers
+# Copyright (c) 2018 The Zencash developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, initialize_chain_clean, start_nodes, mark_logs
+from test_framework.wsproxy import MSG_REQUEST, MSG_RESPONSE, MSG_EVENT, MSG_ERROR, EVT_UPDATE_TIP, \
+    REQ_GET_SINGLE_BLOCK, REQ_GET_BLOCK_HEADERS, REQ_SET_BINARY_MODE, REQ_SUBMIT_CERTIFICATE
+from websocket import ABNF
+from websocket import create_connection
+import binascii
+import json
+import struct
+
+DEBUG_MODE = 1
+NUMB_OF_NODES = 1
+
+
+def read_compact_size(data, pos):
+    n = data[pos]
+    if n < 253:
+        return n, pos + 1
+    if n == 253:
+        return struct.unpack("<H", data[pos + 1:pos + 3])[0], pos + 3
+    if n == 254:
+        return struct.unpack("<I", data[pos + 1:pos + 5])[0], pos + 5
+    return struct.unpack("<Q", data[pos + 1:pos + 9])[0], pos + 9
+
+def parse_binary_frame(data):
+    # msgType, eventType/requestType, requestId, height, hash, then the payload
+    msg_type, type = data[0], data[1]
+    n, pos = read_compact_size(data, 2)
+    request_id = data[pos:pos + n].decode()
+    pos += n
+    height = struct.unpack("<i", data[pos:pos + 4])[0]
+    pos += 4
+    hash = binascii.hexlify(data[pos:pos + 32][::-1]).decode()
+    pos += 32
+    return msg_type, type, request_id, height, hash, data[pos:]
+
+def request(ws, request_id, request_type, payload):
+    msg = {'msgType': MSG_REQUEST, 'requestId': request_id, 'requestType': request_type, 'requestPayload': payload}
+    ws.send(json.dumps(msg))
+
+class ws_binary(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory " + self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, NUMB_OF_NODES)
+
+    def setup_network(self, split=False):
+        self.nodes = start_nodes(NUMB_OF_NODES, self.options.tmpdir,
+                                 extra_args = [['-websocket=1', '-debug=ws', '-logtimemicros=1']] * NUMB_OF_NODES)
+        self.is_network_split = split
+        self.sync_all()
+
+    def run_test(self):
+
+        '''
+        The blocks and the headers are sent as raw bytes once the binary mode is negotiated
+        '''
+
+        self.nodes[0].generate(5)
+        ws = create_connection(self.nodes[0].get_wsurl())
+
+        mark_logs("Blocks are sent as hex in JSON by default", self.nodes, DEBUG_MODE)
+        request(ws, "req_1", REQ_GET_SINGLE_BLOCK, {'height': 3})
+        rsp = json.loads(ws.recv())
+        assert_equal(rsp['msgType'], MSG_RESPONSE)
+        assert_equal(rsp['responsePayload']['block'], self.nodes[0].getblock("3", 0))
+
+        mark_logs("Switch to the binary mode", self.nodes, DEBUG_MODE)
+        request(ws, "req_2", REQ_SET_BINARY_MODE, {'binary': True})
+        rsp = json.loads(ws.recv())
+        assert_equal(rsp['requestId'], "req_2")
+        assert_equal(rsp['responsePayload']['binary'], True)
+
+        mark_logs("Get a block in a binary frame", self.nodes, DEBUG_MODE)
+        hash3 = self.nodes[0].getblockhash(3)
+        request(ws, "req_3", REQ_GET_SINGLE_BLOCK, {'hash': hash3})
+        msg_type, type, request_id, height, hash, payload = parse_binary_frame(ws.recv())
+        assert_equal((msg_type, type, request_id, height, hash), (MSG_RESPONSE, REQ_GET_SINGLE_BLOCK, "req_3", 3, hash3))
+        assert_equal(binascii.hexlify(payload).decode(), self.nodes[0].getblock(hash3, 0))
+
+        mark_logs("Get headers in a binary frame", self.nodes, DEBUG_MODE)
+        hashes = [self.nodes[0].getblockhash(h) for h in (2, 4)]
+        request(ws, "req_4", REQ_GET_BLOCK_HEADERS, {'hashes': hashes})
+        msg_type, type, request_id, height, hash, payload = parse_binary_frame(ws.recv())
+        assert_equal((msg_type, type, request_id, height, hash), (MSG_RESPONSE, REQ_GET_BLOCK_HEADERS, "req_4", 2, hashes[0]))
+        headers = [self.nodes[0].getblockheader(h, False) for h in hashes]
+        n, pos = read_compact_size(payload, 0)
+        assert_equal(n, 2)
+        assert_equal(binascii.hexlify(payload[pos:]).decode(), "".join(headers))
+
+        mark_logs("Get the tip update event in a binary frame", self.nodes, DEBUG_MODE)
+        tip = self.nodes[0].generate(1)[0]
+        msg_type, type, request_id, height, hash, payload = parse_binary_frame(ws.recv())
+        assert_equal((msg_type, type, request_id, height, hash), (MSG_EVENT, EVT_UPDATE_TIP, "", 6, tip))
+        assert_equal(binascii.hexlify(payload).decode(), self.nodes[0].getblock(tip, 0))
+
+        mark_logs("Switch back to JSON", self.nodes, DEBUG_MODE)
+        request(ws, "req_5", REQ_SET_BINARY_MODE, {'binary': False})
+        rsp = json.loads(ws.recv())
+        assert_equal(rsp['responsePayload']['binary'], False)
+        tip = self.nodes[0].generate(1)[0]
+        evt = json.loads(ws.recv())
+        assert_equal(evt['eventPayload']['hash'], tip)
+
+        mark_logs("A certificate that can not be read is refused with the requestId", self.nodes, DEBUG_MODE)
+        frame = bytes([REQ_SUBMIT_CERTIFICATE, len("cert_1")]) + b"cert_1" + b"\x01\x02\x03"
+        ws.send(frame, ABNF.OPCODE_BINARY)
+        rsp = json.loads(ws.recv())
+        assert_equal(rsp['msgType'], MSG_ERROR)
+        assert_equal(rsp['requestId'], "cert_1")
+
+        mark_logs("Only the certificates can be sent in a binary frame", self.nodes, DEBUG_MODE)
+        frame = bytes([REQ_GET_SINGLE_BLOCK, len("req_6")]) + b"req_6"
+        ws.send(frame, ABNF.OPCODE_BINARY)
+        rsp = json.loads(ws.recv())
+        assert_equal(rsp['msgType'], MSG_ERROR)
+
+        ws.close()
+
+
+if __name__ == '__main__':
+    ws_binary().main()
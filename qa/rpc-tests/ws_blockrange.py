@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+# Copyright (c) 2014 The Bitcoin Core developers
+# Copyright (c) 2018 The Zencash developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, initialize_chain_clean, start_nodes, mark_logs
+from test_framework.wsproxy import MSG_REQUEST, MSG_RESPONSE, MSG_ERROR, \
+    REQ_GET_BLOCK_RANGE, REQ_BLOCK_RANGE_CREDIT
+from websocket import create_connection
+from websocket._exceptions import WebSocketTimeoutException
+import json
+
+DEBUG_MODE = 1
+NUMB_OF_NODES = 1
+
+
+def request(ws, request_id, request_type, payload):
+    msg = {'msgType': MSG_REQUEST, 'requestId': request_id, 'requestType': request_type, 'requestPayload': payload}
+    ws.send(json.dumps(msg))
+
+class ws_blockrange(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory " + self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, NUMB_OF_NODES)
+
+    def setup_network(self, split=False):
+        self.nodes = start_nodes(NUMB_OF_NODES, self.options.tmpdir,
+                                 extra_args = [['-websocket=1', '-debug=ws', '-logtimemicros=1']] * NUMB_OF_NODES)
+        self.is_network_split = split
+        self.sync_all()
+
+    def check_blocks(self, ws, request_id, heights):
+        for h in heights:
+            rsp = json.loads(ws.recv())
+            assert_equal(rsp['msgType'], MSG_RESPONSE)
+            assert_equal(rsp['requestId'], request_id)
+            assert_equal(rsp['responsePayload']['height'], h)
+            assert_equal(rsp['responsePayload']['hash'], self.nodes[0].getblockhash(h))
+            assert_equal(rsp['responsePayload']['block'], self.nodes[0].getblock(str(h), 0))
+
+    def run_test(self):
+
+        '''
+        A range of blocks is streamed as long as the client grants credit for it
+        '''
+
+        self.nodes[0].generate(30)
+        ws = create_connection(self.nodes[0].get_wsurl())
+
+        mark_logs("Request 25 blocks from height 3, with credit for 10", self.nodes, DEBUG_MODE)
+        request(ws, "range_1", REQ_GET_BLOCK_RANGE, {'height': 3, 'limit': 25, 'credit': 10})
+        self.check_blocks(ws, "range_1", range(3, 13))
+
+        mark_logs("Nothing more comes without credit", self.nodes, DEBUG_MODE)
+        ws.settimeout(2)
+        try:
+            ws.recv()
+            assert(False)
+        except WebSocketTimeoutException:
+            pass
+        ws.settimeout(None)
+
+        mark_logs("A second range is refused while the first is in progress", self.nodes, DEBUG_MODE)
+        request(ws, "range_2", REQ_GET_BLOCK_RANGE, {'height': 0, 'limit': 5})
+        rsp = json.loads(ws.recv())
+        assert_equal(rsp['msgType'], MSG_ERROR)
+        assert_equal(rsp['requestId'], "range_2")
+
+        mark_logs("Grant credit for the rest of the range", self.nodes, DEBUG_MODE)
+        request(ws, "range_1", REQ_BLOCK_RANGE_CREDIT, {'credit': 20})
+        self.check_blocks(ws, "range_1", range(13, 28))
+        rsp = json.loads(ws.recv())
+        assert_equal(rsp['requestId'], "range_1")
+        assert_equal(rsp['responsePayload']['completed'], True)
+        assert_equal(rsp['responsePayload']['endHeight'], 27)
+
+        mark_logs("A range past the tip ends at the tip", self.nodes, DEBUG_MODE)
+        request(ws, "range_3", REQ_GET_BLOCK_RANGE, {'height': 28, 'limit': 100})
+        self.check_blocks(ws, "range_3", range(28, 31))
+        rsp = json.loads(ws.recv())
+        assert_equal(rsp['responsePayload']['endHeight'], 30)
+
+        mark_logs("The connection is listed by getwsinfo, with nothing left to send", self.nodes, DEBUG_MODE)
+        info = self.nodes[0].getwsinfo()
+        assert_equal(len(info), 1)
+        assert_equal(info[0]['queuedframes'], 0)
+        assert_equal(info[0]['queuedbytes'], 0)
+        assert_equal(info[0]['dropped'], 0)
+        assert(info[0]['sentframes'] >= 31)
+        assert(info[0]['recvframes'] >= 3)
+
+        mark_logs("getwsserverinfo has timed the block range requests and their answers", self.nodes, DEBUG_MODE)
+        srvinfo = self.nodes[0].getwsserverinfo()
+        assert_equal(srvinfo['connections'], 1)
+        assert_equal(srvinfo['recvframes'], info[0]['recvframes'])
+        assert(srvinfo['sentframes'] >= info[0]['sentframes'])
+        blockrange = srvinfo['requests']['getblockrange']
+        assert_equal(blockrange['parse']['count'], blockrange['handler']['count'])
+        assert(blockrange['parse']['count'] >= 3)
+        assert_equal(sum(blockrange['parse']['buckets'].values()), blockrange['parse']['count'])
+        assert(srvinfo['output']['response']['write']['count'] >= 31)
+
+        ws.close()
+
+
+if __name__ == '__main__':
+    ws_blockrange().main()
@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+# Copyright (c) 2014 The Bitcoin Core developers
+# Copyright (c) 2018 The Zencash developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+from test_framework.test_framework import ForkHeights, BitcoinTestFramework
+from test_framework.util import assert_equal, initialize_chain_clean, start_nodes, mark_logs
+from test_framework.blockchainhelper import BlockchainHelper, SidechainParameters
+from test_framework.wsproxy import MSG_REQUEST, MSG_EVENT, EVT_UPDATE_TIP, REQ_GET_SINGLE_BLOCK, REQ_SET_SC_FILTER
+from websocket import create_connection
+import hashlib
+import json
+
+DEBUG_MODE = 1
+NUMB_OF_NODES = 1
+
+
+def request(ws, request_id, request_type, payload):
+    msg = {'msgType': MSG_REQUEST, 'requestId': request_id, 'requestType': request_type, 'requestPayload': payload}
+    ws.send(json.dumps(msg))
+
+def recv_response(ws, request_id):
+    # skip the events
+    while True:
+        msg = json.loads(ws.recv())
+        if msg.get('requestId') == request_id:
+            return msg
+
+def recv_tip_event(ws):
+    while True:
+        msg = json.loads(ws.recv())
+        if msg['msgType'] == MSG_EVENT and msg['eventType'] == EVT_UPDATE_TIP:
+            return msg['eventPayload']
+
+def merkle_root_from_branch(hash_hex, branch, index):
+    h = bytes.fromhex(hash_hex)[::-1]
+    for b in branch:
+        b = bytes.fromhex(b)[::-1]
+        data = b + h if index & 1 else h + b
+        h = hashlib.sha256(hashlib.sha256(data).digest()).digest()
+        index >>= 1
+    return h[::-1].hex()
+
+class ws_scfilter(BitcoinTestFramework):
+
+    def setup_chain(self):
+        print("Initializing test directory " + self.options.tmpdir)
+        initialize_chain_clean(self.options.tmpdir, NUMB_OF_NODES)
+
+    def setup_network(self, split=False):
+        self.nodes = start_nodes(NUMB_OF_NODES, self.options.tmpdir,
+                                 extra_args = [['-websocket=1', '-debug=ws', '-debug=sc', '-logtimemicros=1']] * NUMB_OF_NODES)
+        self.is_network_split = split
+        self.sync_all()
+
+    def check_filtered_block(self, filtered, expected_txids):
+        block = self.nodes[0].getblock(filtered['hash'])
+        assert_equal(filtered['txCount'], len(block['tx']) + len(block.get('cert', [])))
+        assert_equal(len(filtered['txs']), len(expected_txids))
+        for entry, txid in zip(filtered['txs'], expected_txids):
+            assert_equal(self.nodes[0].decoderawtransaction(entry['tx'])['txid'], txid)
+            assert_equal(block['tx'][entry['index']], txid)
+            assert_equal(merkle_root_from_branch(txid, entry['merkleBranch'], entry['index']), block['merkleroot'])
+        assert_equal(len(filtered['certs']), 0)
+
+    def run_test(self):
+
+        '''
+        The blocks are filtered for the sidechains a connection subscribed to
+        '''
+
+        test_helper = BlockchainHelper(self)
+        self.nodes[0].generate(ForkHeights['NON_CEASING_SC'])
+        ws = create_connection(self.nodes[0].get_wsurl())
+
+        mark_logs("Node 0 creates two sidechains", self.nodes, DEBUG_MODE)
+        test_helper.create_sidechain("sc1", SidechainParameters["DEFAULT_SC_V0"])
+        test_helper.create_sidechain("sc2", SidechainParameters["DEFAULT_SC_V0"])
+        scid1 = test_helper.get_sidechain_id("sc1")
+        creation_tx1 = test_helper.sidechain_map["sc1"]["creation_tx_id"]
+
+        mark_logs("Subscribe to sidechain 1", self.nodes, DEBUG_MODE)
+        request(ws, "filter_1", REQ_SET_SC_FILTER, {'scIds': [scid1]})
+        assert_equal(recv_response(ws, "filter_1")['responsePayload']['scIds'], 1)
+
+        mark_logs("The tip event only carries the creation of sidechain 1", self.nodes, DEBUG_MODE)
+        tip = self.nodes[0].generate(1)[0]
+        filtered = recv_tip_event(ws)
+        assert_equal(filtered['hash'], tip)
+        self.check_filtered_block(filtered, [creation_tx1])
+
+        mark_logs("A block without sidechain 1 transactions only carries its header", self.nodes, DEBUG_MODE)
+        tip = self.nodes[0].generate(1)[0]
+        filtered = recv_tip_event(ws)
+        assert_equal(filtered['hash'], tip)
+        self.check_filtered_block(filtered, [])
+
+        mark_logs("Single blocks are filtered too", self.nodes, DEBUG_MODE)
+        creation_height = self.nodes[0].getblockcount() - 1
+        request(ws, "block_1", REQ_GET_SINGLE_BLOCK, {'height': creation_height})
+        self.check_filtered_block(recv_response(ws, "block_1")['responsePayload'], [creation_tx1])
+
+        mark_logs("Unsubscribe: the blocks are sent in full again", self.nodes, DEBUG_MODE)
+        request(ws, "filter_2", REQ_SET_SC_FILTER, {'scIds': []})
+        assert_equal(recv_response(ws, "filter_2")['responsePayload']['scIds'], 0)
+        request(ws, "block_2", REQ_GET_SINGLE_BLOCK, {'height': creation_height})
+        rsp = recv_response(ws, "block_2")
+        assert_equal(rsp['responsePayload']['block'], self.nodes[0].getblock(str(creation_height), 0))
+
+        ws.close()
+
+
+if __name__ == '__main__':
+    ws_scfilter().main()
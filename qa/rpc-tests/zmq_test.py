@@ -23,8 +23,13 @@ class ZMQTest(BitcoinTestFramework):
         self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashblock")
         self.zmqSubSocket.setsockopt(zmq.SUBSCRIBE, b"hashtx")
         self.zmqSubSocket.connect("tcp://127.0.0.1:%i" % self.port)
+        self.zmqSeqSocket = self.zmqContext.socket(zmq.SUB)
+        self.zmqSeqSocket.setsockopt(zmq.SUBSCRIBE, b"sequence")
+        self.zmqSeqSocket.setsockopt(zmq.RCVTIMEO, 60000)
+        self.zmqSeqSocket.connect("tcp://127.0.0.1:%i" % (self.port + 1))
         return start_nodes(4, self.options.tmpdir, extra_args=[
-            ['-zmqpubhashtx=tcp://127.0.0.1:'+str(self.port), '-zmqpubhashblock=tcp://127.0.0.1:'+str(self.port)],
+            ['-zmqpubhashtx=tcp://127.0.0.1:'+str(self.port), '-zmqpubhashblock=tcp://127.0.0.1:'+str(self.port),
+             '-zmqpubsequence=tcp://127.0.0.1:'+str(self.port + 1)],
             [],
             [],
             []
@@ -90,6 +95,36 @@ class ZMQTest(BitcoinTestFramework):
 
         assert_equal(hashRPC, hashZMQ) #blockhash from generate must be equal to the hash received over zmq
 
+        # the mempool changes follow the mempool returned with its sequence
+        mempool = self.nodes[0].getrawmempool(False, True)
+        assert_equal(mempool['txids'], [hashRPC])
+        seq = mempool['mempool_sequence']
+        (label, mempool_seq, reason) = self.recv_sequence_until(hashRPC)
+        assert_equal(label, b"A")
+        assert_equal(mempool_seq, seq)
+
+        blockhash = self.nodes[1].generate(1)[0]
+        self.sync_all()
+        (label, mempool_seq, reason) = self.recv_sequence_until(hashRPC)
+        assert_equal(label, b"R")
+        assert_equal(mempool_seq, seq + 1)
+        assert_equal(reason, 4) # included in a block
+        (label, mempool_seq, reason) = self.recv_sequence_until(blockhash)
+        assert_equal(label, b"C")
+        assert_equal(self.nodes[0].getrawmempool(False, True), {'txids': [], 'mempool_sequence': seq + 1})
+
+    def recv_sequence_until(self, hash):
+        # skip the messages of the other hashes, e.g. of the blocks connected before
+        while True:
+            msg = self.zmqSeqSocket.recv_multipart()
+            assert_equal(msg[0], b"sequence")
+            body = msg[1]
+            label = body[32:33]
+            mempool_seq = struct.unpack('<Q', body[33:41])[0] if label in (b"A", b"R") else None
+            reason = body[41] if label == b"R" else None
+            if body[:32].hex() == hash:
+                return (label, mempool_seq, reason)
+
 
 if __name__ == '__main__':
     ZMQTest ().main ()
@@ -10,6 +10,8 @@
 #include "amount.h"
 #include "script/script.h"
 
+#include <map>
+
 enum class AddressType {
     UNKNOWN = 0,
     PUBKEY = 1,
@@ -229,6 +231,93 @@ struct CAddressIndexIteratorKey {
     }
 };
 
+/**
+ * The running balance of an address, kept along with its address index entries so that it can be
+ * returned without iterating over them: the sums of the entries without maturity, and those of the
+ * certificate backward transfers by maturity height, as they are mature or not depending on the tip.
+ * The superseded backward transfers (negative maturity height) are not counted.
+ */
+struct CAddressBalanceValue {
+    //! The sum of the amounts, and of the positive amounts only
+    struct Sums {
+        CAmount balance;
+        CAmount received;
+
+        Sums() : balance(0), received(0) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+            READWRITE(balance);
+            READWRITE(received);
+        }
+
+        void Add(CAmount satoshis, int sign) {
+            balance += sign * satoshis;
+            if (satoshis > 0)
+                received += sign * satoshis;
+        }
+
+        bool IsNull() const {
+            return balance == 0 && received == 0;
+        }
+    };
+
+    Sums immediate;
+    std::map<int, Sums> mapMaturing;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(immediate);
+        READWRITE(mapMaturing);
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        immediate = Sums();
+        mapMaturing.clear();
+    }
+
+    bool IsNull() const {
+        return immediate.IsNull() && mapMaturing.empty();
+    }
+
+    //! Add (sign 1) or remove (sign -1) the contribution of an address index entry
+    void Add(const CAddressIndexValue& value, int sign) {
+        if (value.IsNull() || value.maturityHeight < 0)
+            return;
+        if (value.maturityHeight == 0) {
+            immediate.Add(value.satoshis, sign);
+            return;
+        }
+        Sums& sums = mapMaturing[value.maturityHeight];
+        sums.Add(value.satoshis, sign);
+        if (sums.IsNull())
+            mapMaturing.erase(value.maturityHeight);
+    }
+
+    //! The balance and received amounts with the tip at nTipHeight, those immature being added only if fIncludeImmature
+    void Get(int nTipHeight, bool fIncludeImmature, CAmount& balance, CAmount& received, CAmount& immature) const {
+        balance += immediate.balance;
+        received += immediate.received;
+        for (const auto& [maturityHeight, sums] : mapMaturing) {
+            if (maturityHeight > nTipHeight) {
+                immature += sums.balance;
+                if (!fIncludeImmature)
+                    continue;
+            }
+            balance += sums.balance;
+            received += sums.received;
+        }
+    }
+};
+
 struct CAddressIndexIteratorHeightKey {
     AddressType type;
     uint160 hashBytes;
@@ -373,6 +462,27 @@ struct CMempoolAddressDeltaKeyCompare
     }
 };
 
+/** The address of mempool deltas, keying the per-address buckets of the mempool address index */
+struct CMempoolAddressKey
+{
+    AddressType type;
+    uint160 addressBytes;
+
+    CMempoolAddressKey(AddressType addressType, uint160 addressHash) {
+        type = addressType;
+        addressBytes = addressHash;
+    }
+
+    explicit CMempoolAddressKey(const CMempoolAddressDeltaKey& deltaKey) {
+        type = deltaKey.type;
+        addressBytes = deltaKey.addressBytes;
+    }
+
+    bool operator==(const CMempoolAddressKey& other) const {
+        return type == other.type && addressBytes == other.addressBytes;
+    }
+};
+
 //! \brief Retrieves from script type the associated address type
 //! \param [in] scriptType: the script type used to determine address type
 //! \return addressType: the associated address type
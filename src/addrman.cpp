@@ -353,9 +353,9 @@ CAddrInfo CAddrMan::Select_(bool newOnly)
                 if (i % kRetriesBetweenSleep == 0 && !nKey.IsNull())
                     MilliSleep(kRetrySleepInterval);
             }
-            int nId = vvTried[nKBucket][nKBucketPos];
-            assert(mapInfo.count(nId) == 1);
-            CAddrInfo& info = mapInfo[nId];
+            std::map<int, CAddrInfo>::const_iterator it = mapInfo.find(vvTried[nKBucket][nKBucketPos]);
+            assert(it != mapInfo.end());
+            const CAddrInfo& info = it->second;
             if (RandomInt(1 << 30) < fChanceFactor * info.GetChance() * (1 << 30))
                 return info;
             fChanceFactor *= 1.2;
@@ -375,9 +375,9 @@ CAddrInfo CAddrMan::Select_(bool newOnly)
                 if (i % kRetriesBetweenSleep == 0 && !nKey.IsNull())
                     MilliSleep(kRetrySleepInterval);
             }
-            int nId = vvNew[nUBucket][nUBucketPos];
-            assert(mapInfo.count(nId) == 1);
-            CAddrInfo& info = mapInfo[nId];
+            std::map<int, CAddrInfo>::const_iterator it = mapInfo.find(vvNew[nUBucket][nUBucketPos]);
+            assert(it != mapInfo.end());
+            const CAddrInfo& info = it->second;
             if (RandomInt(1 << 30) < fChanceFactor * info.GetChance() * (1 << 30))
                 return info;
             fChanceFactor *= 1.2;
@@ -471,16 +471,19 @@ void CAddrMan::GetAddr_(std::vector<CAddress>& vAddr)
     if (nNodes > ADDRMAN_GETADDR_MAX)
         nNodes = ADDRMAN_GETADDR_MAX;
 
-    // gather a list of random nodes, skipping those of low quality
-    for (unsigned int n = 0; n < vRandom.size(); n++) {
+    // gather a list of random nodes, skipping those of low quality. The shuffle is done on a copy of
+    // vRandom, the tables are only read, under the shared lock.
+    std::vector<int> vShuffled(vRandom);
+    for (unsigned int n = 0; n < vShuffled.size(); n++) {
         if (vAddr.size() >= nNodes)
             break;
 
-        int nRndPos = RandomInt(vRandom.size() - n) + n;
-        SwapRandom(n, nRndPos);
-        assert(mapInfo.count(vRandom[n]) == 1);
+        int nRndPos = RandomInt(vShuffled.size() - n) + n;
+        std::swap(vShuffled[n], vShuffled[nRndPos]);
 
-        const CAddrInfo& ai = mapInfo[vRandom[n]];
+        std::map<int, CAddrInfo>::const_iterator it = mapInfo.find(vShuffled[n]);
+        assert(it != mapInfo.end());
+        const CAddrInfo& ai = it->second;
         if (!ai.IsTerrible())
             vAddr.push_back(ai);
     }
@@ -17,6 +17,9 @@
 #include <stdint.h>
 #include <vector>
 
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
 /**
  * Extended statistics about a CAddress
  */
@@ -168,12 +171,19 @@ public:
 
 /** 
  * Stochastical (IP) address manager 
+ *
+ * The reads (Select, GetAddr and the serialization for peers.dat) share the lock of the inner data
+ * structures, so that choosing an address to connect to never waits for a dump of the tables.
+ * The lock is not recursive.
  */
 class CAddrMan
 {
 private:
-    //! critical section to protect the inner data structures
-    mutable CCriticalSection cs;
+    //! lock protecting the inner data structures, shared by the reads
+    mutable boost::shared_mutex cs;
+
+    //! number of changes of the tables, to skip the dumps of unchanged tables
+    uint64_t nChanges;
 
     //! last used nId
     int nIdCount;
@@ -232,6 +242,7 @@ protected:
     void Attempt_(const CService &addr, int64_t nTime);
 
     //! Select an address to connect to, if newOnly is set to true, only the new table is selected from.
+    //! Only reads the tables.
     CAddrInfo Select_(bool newOnly);
 
     //! Wraps GetRandInt to allow tests to override RandomInt and make it determinismistic.
@@ -242,7 +253,7 @@ protected:
     int Check_();
 #endif
 
-    //! Select several addresses at once.
+    //! Select several addresses at once. Only reads the tables.
     void GetAddr_(std::vector<CAddress> &vAddr);
 
     //! Mark an entry as currently-connected-to.
@@ -281,7 +292,7 @@ public:
     template<typename Stream>
     void Serialize(Stream &s, int nType, int nVersionDummy) const
     {
-        LOCK(cs);
+        boost::shared_lock<boost::shared_mutex> lock(cs);
 
         unsigned char nVersion = 1;
         s << nVersion;
@@ -331,7 +342,7 @@ public:
     template<typename Stream>
     void Unserialize(Stream& s, int nType, int nVersionDummy)
     {
-        LOCK(cs);
+        boost::unique_lock<boost::shared_mutex> lock(cs);
 
         Clear();
 
@@ -457,6 +468,7 @@ public:
         nIdCount = 0;
         nTried = 0;
         nNew = 0;
+        nChanges = 0;
     }
 
     CAddrMan()
@@ -475,16 +487,20 @@ public:
         return vRandom.size();
     }
 
-    //! Consistency check
+    //! Return the number of changes of the tables so far: the tables did not change if it is the same.
+    uint64_t GetChanges() const
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs);
+        return nChanges;
+    }
+
+    //! Consistency check, with the lock held
     void Check()
     {
 #ifdef DEBUG_ADDRMAN
-        {
-            LOCK(cs);
-            int err;
-            if ((err=Check_()))
-                LogPrintf("ADDRMAN CONSISTENCY CHECK FAILED!!! err=%i\n", err);
-        }
+        int err;
+        if ((err=Check_()))
+            LogPrintf("ADDRMAN CONSISTENCY CHECK FAILED!!! err=%i\n", err);
 #endif
     }
 
@@ -493,9 +509,10 @@ public:
     {
         bool fRet = false;
         {
-            LOCK(cs);
+            boost::unique_lock<boost::shared_mutex> lock(cs);
             Check();
             fRet |= Add_(addr, source, nTimePenalty);
+            nChanges += fRet;
             Check();
         }
         if (fRet)
@@ -508,10 +525,11 @@ public:
     {
         int nAdd = 0;
         {
-            LOCK(cs);
+            boost::unique_lock<boost::shared_mutex> lock(cs);
             Check();
             for (std::vector<CAddress>::const_iterator it = vAddr.begin(); it != vAddr.end(); it++)
                 nAdd += Add_(*it, source, nTimePenalty) ? 1 : 0;
+            nChanges += nAdd;
             Check();
         }
         if (nAdd)
@@ -523,9 +541,10 @@ public:
     void Good(const CService &addr, int64_t nTime = GetTime())
     {
         {
-            LOCK(cs);
+            boost::unique_lock<boost::shared_mutex> lock(cs);
             Check();
             Good_(addr, nTime);
+            nChanges++;
             Check();
         }
     }
@@ -534,9 +553,10 @@ public:
     void Attempt(const CService &addr, int64_t nTime = GetTime())
     {
         {
-            LOCK(cs);
+            boost::unique_lock<boost::shared_mutex> lock(cs);
             Check();
             Attempt_(addr, nTime);
+            nChanges++;
             Check();
         }
     }
@@ -548,7 +568,7 @@ public:
     {
         CAddrInfo addrRet;
         {
-            LOCK(cs);
+            boost::shared_lock<boost::shared_mutex> lock(cs);
             Check();
             addrRet = Select_(newOnly);
             Check();
@@ -559,13 +579,13 @@ public:
     //! Return a bunch of addresses, selected at random.
     std::vector<CAddress> GetAddr()
     {
-        Check();
         std::vector<CAddress> vAddr;
         {
-            LOCK(cs);
+            boost::shared_lock<boost::shared_mutex> lock(cs);
+            Check();
             GetAddr_(vAddr);
+            Check();
         }
-        Check();
         return vAddr;
     }
 
@@ -573,9 +593,10 @@ public:
     void Connected(const CService &addr, int64_t nTime = GetTime())
     {
         {
-            LOCK(cs);
+            boost::unique_lock<boost::shared_mutex> lock(cs);
             Check();
             Connected_(addr, nTime);
+            nChanges++;
             Check();
         }
     }
@@ -19,3 +19,18 @@ bool AMQPAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool AMQPAbstractNotifier::NotifyCertificate(const CScCertificate &/*certificate*/)
+{
+    return true;
+}
+
+bool AMQPAbstractNotifier::NotifyCertStatus(const CScCertificateStatusUpdateInfo &/*certStatusInfo*/)
+{
+    return true;
+}
+
+bool AMQPAbstractNotifier::NotifySidechainEvents(int /*nHeight*/, const CSidechainEvents &/*scEvents*/, bool /*fConnected*/)
+{
+    return true;
+}
@@ -8,6 +8,8 @@
 #include "amqpconfig.h"
 
 class CBlockIndex;
+class CSidechainEvents;
+struct CScCertificateStatusUpdateInfo;
 class AMQPAbstractNotifier;
 
 typedef AMQPAbstractNotifier* (*AMQPNotifierFactory)();
@@ -34,6 +36,11 @@ public:
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyCertificate(const CScCertificate &certificate);
+    //! A certificate became the top quality one of its epoch, or stopped being it
+    virtual bool NotifyCertStatus(const CScCertificateStatusUpdateInfo &certStatusInfo);
+    //! Sidechains matured or ceased at nHeight, or no more with !fConnected
+    virtual bool NotifySidechainEvents(int nHeight, const CSidechainEvents &scEvents, bool fConnected);
 
 protected:
     std::string type;
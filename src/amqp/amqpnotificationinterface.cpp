@@ -49,6 +49,9 @@ AMQPNotificationInterface* AMQPNotificationInterface::CreateWithArguments(const
     factories["pubhashtx"] = AMQPAbstractNotifier::Create<AMQPPublishHashTransactionNotifier>;
     factories["pubrawblock"] = AMQPAbstractNotifier::Create<AMQPPublishRawBlockNotifier>;
     factories["pubrawtx"] = AMQPAbstractNotifier::Create<AMQPPublishRawTransactionNotifier>;
+    factories["pubhashcert"] = AMQPAbstractNotifier::Create<AMQPPublishHashCertificateNotifier>;
+    factories["pubrawcert"] = AMQPAbstractNotifier::Create<AMQPPublishRawCertificateNotifier>;
+    factories["pubscevent"] = AMQPAbstractNotifier::Create<AMQPPublishSidechainEventNotifier>;
 
     for (std::map<std::string, AMQPNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i) {
         std::map<std::string, std::string>::const_iterator j = args.find("-amqp" + i->first);
@@ -134,3 +137,42 @@ void AMQPNotificationInterface::SyncTransaction(const CTransaction &tx, const CB
         }
     }
 }
+
+void AMQPNotificationInterface::SyncCertificate(const CScCertificate &cert, const CBlock *pblock, int bwtMaturityDepth)
+{
+    for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ) {
+        AMQPAbstractNotifier *notifier = *i;
+        if (notifier->NotifyCertificate(cert)) {
+            i++;
+        } else {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
+}
+
+void AMQPNotificationInterface::SyncCertStatusInfo(const CScCertificateStatusUpdateInfo &certStatusInfo)
+{
+    for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ) {
+        AMQPAbstractNotifier *notifier = *i;
+        if (notifier->NotifyCertStatus(certStatusInfo)) {
+            i++;
+        } else {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
+}
+
+void AMQPNotificationInterface::SyncSidechainEvents(int nHeight, const CSidechainEvents &scEvents, bool fConnected)
+{
+    for (std::list<AMQPAbstractNotifier*>::iterator i = notifiers.begin(); i != notifiers.end(); ) {
+        AMQPAbstractNotifier *notifier = *i;
+        if (notifier->NotifySidechainEvents(nHeight, scEvents, fConnected)) {
+            i++;
+        } else {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
+}
@@ -9,6 +9,9 @@
 #include <string>
 #include <map>
 
+//! The messages waiting for the broker per address, beyond which the overflow policy applies
+static const unsigned int DEFAULT_AMQP_MAX_QUEUED = 10000;
+
 class CBlockIndex;
 class AMQPAbstractNotifier;
 
@@ -26,6 +29,9 @@ protected:
     // CValidationInterface
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
     void UpdatedBlockTip(const CBlockIndex *pindex);
+    void SyncCertificate(const CScCertificate &cert, const CBlock *pblock, int bwtMaturityDepth);
+    void SyncCertStatusInfo(const CScCertificateStatusUpdateInfo &certStatusInfo);
+    void SyncSidechainEvents(int nHeight, const CSidechainEvents &scEvents, bool fConnected);
 
 private:
     AMQPNotificationInterface();
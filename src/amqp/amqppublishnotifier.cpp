@@ -3,8 +3,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "amqppublishnotifier.h"
+#include "amqpnotificationinterface.h"
+#include "blockfilemap.h"
 #include "main.h"
+#include "sc/sidechain.h"
 #include "util.h"
+#include "crypto/common.h"
 
 #include "amqpsender.h"
 
@@ -17,6 +21,21 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_HASHCERT  = "hashcert";
+static const char *MSG_RAWCERT   = "rawcert";
+static const char *MSG_SCEVENT   = "scevent";
+
+//! The first byte of a scevent message
+static const unsigned char SCEVENT_CERT_STATUS = 0;
+static const unsigned char SCEVENT_MATURED     = 1;
+static const unsigned char SCEVENT_CEASED      = 2;
+
+//! Append hash in RPC byte order, as the hashes of the other messages
+static void AppendHash(std::vector<unsigned char> &data, const uint256 &hash)
+{
+    for (unsigned int i = 0; i < 32; i++)
+        data.push_back(hash.begin()[31 - i]);
+}
 
 // Invoke this method from a new thread to run the proton container event loop.
 void AMQPAbstractPublishNotifier::SpawnProtonContainer()
@@ -45,7 +64,9 @@ bool AMQPAbstractPublishNotifier::Initialize()
 
     if (i == mapPublishNotifiers.end()) {
         try {
-            handler_ = std::make_shared<AMQPSender>(address);
+            // the messages are queued for the container thread, a full queue drops the oldest unless -amqpdropnewest
+            handler_ = std::make_shared<AMQPSender>(address, GetArg("-amqpmaxqueued", DEFAULT_AMQP_MAX_QUEUED),
+                                                    GetBoolArg("-amqpdropnewest", false));
             thread_ = std::make_shared<std::thread>(&AMQPAbstractPublishNotifier::SpawnProtonContainer, this);
         }
         catch (std::exception &e) {
@@ -89,6 +110,9 @@ void AMQPAbstractPublishNotifier::Shutdown()
                 thread_->join();
             }
         }
+        LogPrint("amqp", "amqp: %s sent %u messages in %u batches, dropped %u, left %u unsent (at most %u queued)\n",
+                 GetAddress(), handler_->getSent(), handler_->getBatches(), handler_->getDropped(),
+                 handler_->getQueued(), handler_->getMaxQueued());
     }
 }
 
@@ -106,6 +130,13 @@ bool AMQPAbstractPublishNotifier::SendMessage(const char *command, const void* d
         props.put("x-opt-sequence-number", sequence_);
         handler_->publish(message);
 
+        // the queue only overflows when the broker can't keep up, report it once per power of two drops
+        uint64_t nDropped = handler_->getDropped();
+        if (nDropped > 0 && (nDropped & (nDropped - 1)) == 0 && nDropped != nDroppedLogged_) {
+            nDroppedLogged_ = nDropped;
+            LogPrintf("amqp: queue full for %s, %u messages dropped so far\n", GetAddress(), nDropped);
+        }
+
     } catch (proton::error_condition &e) {
         LogPrint("amqp", "amqp: error : %s\n", e.what());
         return false;
@@ -152,19 +183,14 @@ bool AMQPPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     LogPrint("amqp", "amqp: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex)) {
-            LogPrint("amqp", "amqp: Can't read block from disk\n");
-            return false;
-        }
-
-        ss << block;
+    // the bytes of the block as accepted, shared with the other notifiers, when it is the last one
+    CRawBlock rawBlock;
+    if (!GetRawBlock(rawBlock, pindex)) {
+        LogPrint("amqp", "amqp: Can't read block from disk\n");
+        return false;
     }
 
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_RAWBLOCK, rawBlock.begin(), rawBlock.size());
 }
 
 bool AMQPPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
@@ -175,3 +201,59 @@ bool AMQPPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool AMQPPublishHashCertificateNotifier::NotifyCertificate(const CScCertificate &certificate)
+{
+    uint256 hash = certificate.GetHash();
+    LogPrint("amqp", "amqp: Publish hashcert %s\n", hash.GetHex());
+    char data[32];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    return SendMessage(MSG_HASHCERT, data, 32);
+}
+
+bool AMQPPublishRawCertificateNotifier::NotifyCertificate(const CScCertificate &certificate)
+{
+    uint256 hash = certificate.GetHash();
+    LogPrint("amqp", "amqp: Publish rawcert %s\n", hash.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << certificate;
+    return SendMessage(MSG_RAWCERT, &(*ss.begin()), ss.size());
+}
+
+bool AMQPPublishSidechainEventNotifier::NotifyCertStatus(const CScCertificateStatusUpdateInfo &certStatusInfo)
+{
+    LogPrint("amqp", "amqp: Publish scevent for certificate %s of sidechain %s\n", certStatusInfo.certHash.GetHex(), certStatusInfo.scId.GetHex());
+    std::vector<unsigned char> data(1, SCEVENT_CERT_STATUS);
+    AppendHash(data, certStatusInfo.scId);
+    AppendHash(data, certStatusInfo.certHash);
+    unsigned char buf[8];
+    WriteLE32(buf, certStatusInfo.certEpoch);
+    data.insert(data.end(), buf, buf + 4);
+    WriteLE64(buf, certStatusInfo.certQuality);
+    data.insert(data.end(), buf, buf + 8);
+    data.push_back(certStatusInfo.bwtState);
+    return SendMessage(MSG_SCEVENT, data.data(), data.size());
+}
+
+static bool SendSidechainEvents(AMQPAbstractPublishNotifier *notifier, const std::set<uint256> &scIds, unsigned char type, int nHeight, bool fConnected)
+{
+    for (const uint256 &scId : scIds) {
+        LogPrint("amqp", "amqp: Publish scevent %d for sidechain %s at height %d%s\n", (int)type, scId.GetHex(), nHeight, fConnected ? "" : " (disconnected)");
+        std::vector<unsigned char> data(1, type);
+        AppendHash(data, scId);
+        unsigned char buf[4];
+        WriteLE32(buf, nHeight);
+        data.insert(data.end(), buf, buf + 4);
+        data.push_back(fConnected ? 1 : 0);
+        if (!notifier->SendMessage(MSG_SCEVENT, data.data(), data.size()))
+            return false;
+    }
+    return true;
+}
+
+bool AMQPPublishSidechainEventNotifier::NotifySidechainEvents(int nHeight, const CSidechainEvents &scEvents, bool fConnected)
+{
+    return SendSidechainEvents(this, scEvents.maturingScs, SCEVENT_MATURED, nHeight, fConnected) &&
+           SendSidechainEvents(this, scEvents.ceasingScs, SCEVENT_CEASED, nHeight, fConnected);
+}
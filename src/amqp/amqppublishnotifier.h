@@ -18,6 +18,7 @@ class AMQPAbstractPublishNotifier : public AMQPAbstractNotifier
 {
 private:
     uint64_t sequence_;                         // memory only, per notifier instance: upcounting message sequence number
+    uint64_t nDroppedLogged_ = 0;               // the dropped messages count last logged
 
     std::shared_ptr<std::thread> thread_;       // proton container thread, may be shared between notifiers
     std::shared_ptr<AMQPSender> handler_;      // proton container message handler, may be shared between notifiers
@@ -53,4 +54,27 @@ public:
     bool NotifyTransaction(const CTransaction &transaction);
 };
 
+class AMQPPublishHashCertificateNotifier : public AMQPAbstractPublishNotifier
+{
+public:
+    bool NotifyCertificate(const CScCertificate &certificate);
+};
+
+class AMQPPublishRawCertificateNotifier : public AMQPAbstractPublishNotifier
+{
+public:
+    bool NotifyCertificate(const CScCertificate &certificate);
+};
+
+/**
+ * "scevent": a message per sidechain maturing or ceasing, and per certificate becoming or no more being the
+ * top quality one of its epoch, as the sidechains can be followed without polling getscinfo.
+ */
+class AMQPPublishSidechainEventNotifier : public AMQPAbstractPublishNotifier
+{
+public:
+    bool NotifyCertStatus(const CScCertificateStatusUpdateInfo &certStatusInfo);
+    bool NotifySidechainEvents(int nHeight, const CSidechainEvents &scEvents, bool fConnected);
+};
+
 #endif // ZCASH_AMQP_AMQPPUBLISHNOTIFIER_H
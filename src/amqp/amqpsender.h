@@ -7,23 +7,58 @@
 
 #include "amqpconfig.h"
 
+#include <proton/work_queue.hpp>
+
+#include <algorithm>
+#include <atomic>
 #include <deque>
+#include <iterator>
 #include <memory>
+#include <mutex>
 #include <future>
 #include <iostream>
+#include <vector>
+
+//! The messages sent at most per dispatch on the container thread, handed to the transport at once
+static const size_t AMQP_MAX_BATCH = 256;
 
+/**
+ * Publishes the messages from the proton container thread: publish() only queues them, so that a slow broker
+ * or a reconnection never blocks the notifications. The queue is bounded, a message published when it is full
+ * evicts the oldest one queued or, with fDropNewest, is dropped itself.
+ */
 class AMQPSender : public proton::messaging_handler {
   private:
-    std::deque<proton::message> messages_; 
+    std::deque<proton::message> messages_;
     proton::url url_;
     proton::connection conn_;
     proton::sender sender_;
     std::mutex lock_;
     std::atomic<bool> terminated_ = {false};
 
+    const size_t maxQueued_;
+    const bool fDropNewest_;
+    //! the work queue of the connection, to run the sends on the container thread; guarded by lock_
+    proton::work_queue* workQueue_ = nullptr;
+    //! whether a dispatch has been added to the work queue and not run yet; guarded by lock_
+    bool dispatchPending_ = false;
+
+    std::atomic<uint64_t> nSent_ = {0};
+    std::atomic<uint64_t> nDropped_ = {0};
+    std::atomic<uint64_t> nBatches_ = {0};
+    std::atomic<size_t> nMaxQueued_ = {0};
+
+    // Ask the container thread to dispatch, once for all the messages queued meanwhile
+    void scheduleDispatch() {
+        if (dispatchPending_ || workQueue_ == nullptr)
+            return;
+        dispatchPending_ = workQueue_->add([this]() { dispatch(); });
+    }
+
   public:
 
-    AMQPSender(const std::string& url) : url_(url) {}
+    AMQPSender(const std::string& url, size_t maxQueued, bool fDropNewest) :
+        url_(url), maxQueued_(std::max<size_t>(maxQueued, 1)), fDropNewest_(fDropNewest) {}
 
     // Callback to initialize the container when run() is invoked
     void on_container_start(proton::container& c) override {
@@ -31,59 +66,85 @@ class AMQPSender : public proton::messaging_handler {
         proton::connection_options opts = proton::connection_options().idle_timeout(t);
         conn_ = c.connect(url_, opts);
         sender_ = conn_.open_sender(url_.path());
+        std::lock_guard<std::mutex> guard(lock_);
+        workQueue_ = &conn_.work_queue();
     }
 
-    // Remote end signals when the local end can send (i.e. has credit) 
+    // Remote end signals when the local end can send (i.e. has credit)
     void on_sendable(proton::sender &s) override {
         dispatch();
     }
 
-    // Publish message by adding to queue and trying to dispatch it
+    // Queue the message for the container thread, never waiting for the broker
     void publish(const proton::message &m) {
-        add_message(m);
-        dispatch();
-    }
+        if (isTerminated()) {
+            throw std::runtime_error("amqp connection was terminated");
+        }
 
-    // Add message to queue
-    void add_message(const proton::message &m) {
         std::lock_guard<std::mutex> guard(lock_);
+        if (messages_.size() >= maxQueued_) {
+            nDropped_++;
+            if (fDropNewest_)
+                return;
+            messages_.pop_front();
+        }
         messages_.push_back(m);
+        if (messages_.size() > nMaxQueued_.load())
+            nMaxQueued_.store(messages_.size());
+        scheduleDispatch();
     }
 
-    // Send messages in queue
+    /**
+     * Send the messages queued, as many as the credit allows, on the container thread. They are taken a batch at
+     * a time, then sent without the lock: the transport writes the whole batch to the broker at once.
+     */
     void dispatch() {
-        std::lock_guard<std::mutex> guard(lock_);
-
-        if (isTerminated()) {
-            throw std::runtime_error("amqp connection was terminated");
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            dispatchPending_ = false;
         }
-
-        if (!conn_.active()) {
-            throw std::runtime_error("amqp connection is not active");
-        }
-
-        while (messages_.size() > 0) {
-            if (sender_.credit()) {
-                const proton::message& m = messages_.front();
-                sender_.send(m);
-                messages_.pop_front();
-            } else {
-                break;
+        if (!conn_.active() || !sender_.active())
+            return; // on_sendable dispatches once connected
+
+        std::vector<proton::message> batch;
+        while (sender_.credit() > 0) {
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                size_t n = std::min<size_t>(std::min<size_t>(messages_.size(), sender_.credit()), AMQP_MAX_BATCH);
+                if (n == 0)
+                    break;
+                batch.assign(std::make_move_iterator(messages_.begin()), std::make_move_iterator(messages_.begin() + n));
+                messages_.erase(messages_.begin(), messages_.begin() + n);
             }
+            for (const proton::message& m : batch)
+                sender_.send(m);
+            nSent_ += batch.size();
+            nBatches_++;
         }
     }
 
-    // Close connection to remote end.  Container event-loop, by default, will auto-stop.
+    // Close connection to remote end, once what the credit allows is sent.  Container event-loop, by default, will auto-stop.
     void terminate() {
         std::lock_guard<std::mutex> guard(lock_);
-        conn_.close();
-        terminated_.store(true);
+        if (terminated_.exchange(true))
+            return;
+        if (workQueue_ == nullptr || !workQueue_->add([this]() { dispatch(); conn_.close(); }))
+            conn_.close();
     }
 
     bool isTerminated() const {
         return terminated_.load();
     }
 
+    uint64_t getSent() const { return nSent_.load(); }
+    uint64_t getDropped() const { return nDropped_.load(); }
+    uint64_t getBatches() const { return nBatches_.load(); }
+    size_t getMaxQueued() const { return nMaxQueued_.load(); }
+    size_t getQueued() {
+        std::lock_guard<std::mutex> guard(lock_);
+        return messages_.size();
+    }
+
     void on_transport_error(proton::transport &t) override {
         t.connection().close();
         throw t.error();
@@ -19,6 +19,14 @@
 
 using namespace std;
 
+/** The call that created an async operation, with the URI of its request, which selects the wallet it is for */
+struct AsyncRPCRequest
+{
+    std::string method;
+    UniValue params;
+    std::string uri;
+};
+
 /**
  * AsyncRPCOperation objects are submitted to the AsyncRPCQueue for processing.
  * 
@@ -65,6 +73,35 @@ public:
     // Override this method to add data to the default status object.
     virtual UniValue getStatus() const;
 
+    // Override this method to have the operation run before the waiting ones of a lower priority.
+    virtual int getPriority() const {
+        return 0;
+    }
+
+    // The call that created the operation, so that the queue can save it should it not have run at shutdown.
+    // The operation runs for the wallet of the URI, as the call did.
+    void setRequest(const std::string& method, const UniValue& params, const std::string& uri = "/") {
+        std::lock_guard<std::mutex> guard(lock_);
+        request_method_ = method;
+        request_params_ = params;
+        request_uri_ = uri;
+    }
+
+    std::string getRequestMethod() const {
+        std::lock_guard<std::mutex> guard(lock_);
+        return request_method_;
+    }
+
+    UniValue getRequestParams() const {
+        std::lock_guard<std::mutex> guard(lock_);
+        return request_params_;
+    }
+
+    std::string getRequestURI() const {
+        std::lock_guard<std::mutex> guard(lock_);
+        return request_uri_;
+    }
+
     UniValue getError() const;
     
     UniValue getResult() const;
@@ -147,6 +184,10 @@ private:
     // Initialized in the operation constructor, never to be modified again.
     AsyncRPCOperationId id_;
     int64_t creation_time_;
+
+    std::string request_method_;
+    UniValue request_params_;
+    std::string request_uri_ = "/";
 };
 
 #endif /* ASYNCRPCOPERATION_H */
@@ -4,8 +4,14 @@
 
 #include "asyncrpcqueue.h"
 
+#include <algorithm>
+
 static std::atomic<size_t> workerCounter(0);
 
+static int64_t secondsSinceEpoch() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
 /**
  * Static method to return the shared/default queue.
  */
@@ -23,21 +29,36 @@ AsyncRPCQueue::~AsyncRPCQueue() {
 }
 
 /**
- * A worker will execute this method on a new thread
+ * A worker will execute this method on a new thread.
+ * A worker started on demand exits once it has waited ASYNC_RPC_WORKER_IDLE_TIMEOUT seconds for an operation.
  */
-void AsyncRPCQueue::run(size_t workerId) {
+void AsyncRPCQueue::run(size_t workerId, Worker* worker, bool onDemand) {
 
     while (true) {
         AsyncRPCOperationId key;
         std::shared_ptr<AsyncRPCOperation> operation;
         {
             std::unique_lock<std::mutex> guard(lock_);
-            while (operation_id_queue_.empty() && !isClosed() && !isFinishing()) {
-                this->condition_.wait(guard);
+            bool idleTimeout = false;
+            idle_workers_++;
+            while (operation_id_queue_.empty() && !isClosed() && !isFinishing() && !idleTimeout) {
+                if (onDemand) {
+                    idleTimeout = (this->condition_.wait_for(guard, std::chrono::seconds(ASYNC_RPC_WORKER_IDLE_TIMEOUT)) == std::cv_status::timeout);
+                } else {
+                    this->condition_.wait(guard);
+                }
+            }
+            idle_workers_--;
+
+            // Exit if this worker is no longer needed
+            if (idleTimeout && operation_id_queue_.empty()) {
+                worker->done = true;
+                break;
             }
 
             // Exit if the queue is empty and we are finishing up
             if (isFinishing() && operation_id_queue_.empty()) {
+                worker->done = true;
                 break;
             }
 
@@ -46,11 +67,12 @@ void AsyncRPCQueue::run(size_t workerId) {
                 while (!operation_id_queue_.empty()) {
                     operation_id_queue_.pop();
                 }
+                worker->done = true;
                 break;
             }
 
             // Get operation id
-            key = operation_id_queue_.front();
+            key = operation_id_queue_.top().id;
             operation_id_queue_.pop();
 
             // Search operation map
@@ -67,6 +89,47 @@ void AsyncRPCQueue::run(size_t workerId) {
         } else {
             operation->main();
         }
+
+        if (operation) {
+            std::lock_guard<std::mutex> guard(lock_);
+            finished_operations_.emplace_back(secondsSinceEpoch(), key);
+            prune_finished_operations();
+        }
+    }
+}
+
+/**
+ * Spawn a worker thread, after joining those started on demand which have exited since.
+ * lock_ must be held.
+ */
+void AsyncRPCQueue::start_worker(bool onDemand) {
+    for (std::list<Worker>::iterator it = workers_.begin(); it != workers_.end(); ) {
+        if (it->done) {
+            // the worker only had to return after releasing the lock
+            it->thread.join();
+            it = workers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    workers_.emplace_back();
+    Worker& worker = workers_.back();
+    worker.thread = std::thread(&AsyncRPCQueue::run, this, ++workerCounter, &worker, onDemand);
+}
+
+/**
+ * Forget the finished operations beyond the limits of the results store, the oldest first.
+ * lock_ must be held.
+ */
+void AsyncRPCQueue::prune_finished_operations() {
+    int64_t now = secondsSinceEpoch();
+    while (!finished_operations_.empty() &&
+           ((max_results_ > 0 && finished_operations_.size() > max_results_) ||
+            (result_ttl_ > 0 && finished_operations_.front().first + result_ttl_ <= now))) {
+        // the operation may already be gone, popped after reading its result
+        operation_map_.erase(finished_operations_.front().second);
+        finished_operations_.pop_front();
     }
 }
 
@@ -91,7 +154,15 @@ void AsyncRPCQueue::addOperation(const std::shared_ptr<AsyncRPCOperation> &ptrOp
 
     AsyncRPCOperationId id = ptrOperation->getId();
     operation_map_.emplace(id, ptrOperation);
-    operation_id_queue_.push(id);
+    operation_id_queue_.push(AsyncRPCQueuedOperation{ptrOperation->getPriority(), operation_sequence_++, id});
+
+    // Should all the workers be busy, one more if allowed
+    size_t numWorkers = std::count_if(workers_.begin(), workers_.end(), [](const Worker& w) { return !w.done; });
+    if (operation_id_queue_.size() > idle_workers_ && numWorkers < max_workers_) {
+        start_worker(true);
+    }
+
+    prune_finished_operations();
     this->condition_.notify_one();
 }
 
@@ -176,15 +247,33 @@ size_t AsyncRPCQueue::getOperationCount() const {
  */
 void AsyncRPCQueue::addWorker() {
     std::lock_guard<std::mutex> guard(lock_);
-    workers_.emplace_back( std::thread(&AsyncRPCQueue::run, this, ++workerCounter) );
+    start_worker(false);
+}
+
+/**
+ * Let addOperation() spawn workers, up to n of them
+ */
+void AsyncRPCQueue::setMaxWorkers(size_t n) {
+    std::lock_guard<std::mutex> guard(lock_);
+    max_workers_ = n;
+}
+
+/**
+ * Bound the finished operations kept for their status and result
+ */
+void AsyncRPCQueue::setResultLimits(size_t maxResults, int64_t ttl) {
+    std::lock_guard<std::mutex> guard(lock_);
+    max_results_ = maxResults;
+    result_ttl_ = ttl;
+    prune_finished_operations();
 }
 
 /**
- * Return the number of worker threads spawned by the queue
+ * Return the number of worker threads spawned by the queue and still running
  */
 size_t AsyncRPCQueue::getNumberOfWorkers() const {
     std::lock_guard<std::mutex> guard(lock_);
-    return workers_.size();
+    return std::count_if(workers_.begin(), workers_.end(), [](const Worker& w) { return !w.done; });
 }
 
 /**
@@ -199,6 +288,24 @@ std::vector<AsyncRPCOperationId> AsyncRPCQueue::getAllOperationIds() const {
     return v;
 }
 
+/**
+ * Return the method, params and URI of the operations still waiting for a worker, which were given them.
+ */
+std::vector<AsyncRPCRequest> AsyncRPCQueue::getPendingRequests() const {
+    std::lock_guard<std::mutex> guard(lock_);
+    std::vector<AsyncRPCRequest> v;
+    std::priority_queue<AsyncRPCQueuedOperation> queue = operation_id_queue_;
+    for (; !queue.empty(); queue.pop()) {
+        AsyncRPCOperationMap::const_iterator iter = operation_map_.find(queue.top().id);
+        if (iter == operation_map_.end() || !iter->second->isReady())
+            continue;
+        std::string method = iter->second->getRequestMethod();
+        if (!method.empty())
+            v.push_back(AsyncRPCRequest{method, iter->second->getRequestParams(), iter->second->getRequestURI()});
+    }
+    return v;
+}
+
 /**
  * Calling thread will close and wait for worker threads to join.
  */
@@ -219,15 +326,20 @@ void AsyncRPCQueue::finishAndWait() {
  * Block current thread until all operations are finished or the queue has closed.
  */
 void AsyncRPCQueue::wait_for_worker_threads() {
-    // Notify any workers who are waiting, so they see the updated queue state
+    // Notify any workers who are waiting, so they see the updated queue state.
+    // No worker is added once the queue is closed or finishing, so the list does not change while joining.
+    std::vector<std::thread*> threads;
     {
         std::lock_guard<std::mutex> guard(lock_);
         this->condition_.notify_all();
+        for (Worker & w : this->workers_) {
+            threads.push_back(&w.thread);
+        }
     }
-        
-    for (std::thread & t : this->workers_) {
-        if (t.joinable()) {
-            t.join();
+
+    for (std::thread* t : threads) {
+        if (t->joinable()) {
+            t->join();
         }
     }
 }
@@ -10,6 +10,8 @@
 #include <iostream>
 #include <string>
 #include <chrono>
+#include <deque>
+#include <list>
 #include <queue>
 #include <unordered_map>
 #include <vector>
@@ -21,6 +23,23 @@
 
 typedef std::unordered_map<AsyncRPCOperationId, std::shared_ptr<AsyncRPCOperation> > AsyncRPCOperationMap; 
 
+/** An operation waiting for a worker: those of a higher priority first, then in the order they were added */
+struct AsyncRPCQueuedOperation {
+    int priority;
+    uint64_t sequence;
+    AsyncRPCOperationId id;
+
+    // std::priority_queue hands out the greatest first
+    bool operator<(const AsyncRPCQueuedOperation& other) const {
+        if (priority != other.priority)
+            return priority < other.priority;
+        return sequence > other.sequence;
+    }
+};
+
+/** The seconds a worker started on demand waits for an operation before it exits */
+static const int64_t ASYNC_RPC_WORKER_IDLE_TIMEOUT = 60;
+
 
 class AsyncRPCQueue {
 public:
@@ -36,6 +55,10 @@ public:
     AsyncRPCQueue& operator=(AsyncRPCQueue &&) = delete;      // Move assign
 
     void addWorker();
+    // Start workers on demand, while operations wait and there are fewer than n workers. 0, the default, never does.
+    void setMaxWorkers(size_t n);
+    // Keep at most maxResults finished operations, for at most ttl seconds after they finished. 0 is no limit.
+    void setResultLimits(size_t maxResults, int64_t ttl);
     size_t getNumberOfWorkers() const;
     bool isClosed() const;
     bool isFinishing() const;
@@ -49,11 +72,21 @@ public:
     std::shared_ptr<AsyncRPCOperation> popOperationForId(AsyncRPCOperationId);
     void addOperation(const std::shared_ptr<AsyncRPCOperation> &ptrOperation);
     std::vector<AsyncRPCOperationId> getAllOperationIds() const;
+    // The calls that created the operations not started yet, in the order they would run
+    std::vector<AsyncRPCRequest> getPendingRequests() const;
 
 private:
+    struct Worker {
+        std::thread thread;
+        bool done = false;
+    };
+
     // addWorker() will spawn a new thread on run())
-    void run(size_t workerId);
+    void run(size_t workerId, Worker* worker, bool onDemand);
     void wait_for_worker_threads();
+    // The following expect lock_ to be held
+    void start_worker(bool onDemand);
+    void prune_finished_operations();
 
     // Why this is not a recursive lock: http://www.zaval.org/resources/library/butenhof1.html
     mutable std::mutex lock_;
@@ -61,8 +94,15 @@ private:
     std::atomic<bool> closed_;
     std::atomic<bool> finish_;
     AsyncRPCOperationMap operation_map_;
-    std::queue <AsyncRPCOperationId> operation_id_queue_;
-    std::vector<std::thread> workers_;
+    std::priority_queue<AsyncRPCQueuedOperation> operation_id_queue_;
+    uint64_t operation_sequence_ = 0;
+    // the ids of the finished operations, with the time they finished, the oldest first
+    std::deque<std::pair<int64_t, AsyncRPCOperationId> > finished_operations_;
+    size_t max_results_ = 0;
+    int64_t result_ttl_ = 0;
+    std::list<Worker> workers_;
+    size_t idle_workers_ = 0;
+    size_t max_workers_ = 0;
 };
 
 #endif
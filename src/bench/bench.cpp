@@ -0,0 +1,116 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "clientversion.h"
+#include "tinyformat.h"
+
+#include <univalue.h>
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <iostream>
+
+namespace benchmark {
+
+double BenchResult::Min() const
+{
+    return *std::min_element(vElapsed.begin(), vElapsed.end());
+}
+
+double BenchResult::Median() const
+{
+    std::vector<double> vSorted(vElapsed);
+    std::sort(vSorted.begin(), vSorted.end());
+    size_t nMid = vSorted.size() / 2;
+    return (vSorted.size() % 2) ? vSorted[nMid] : (vSorted[nMid - 1] + vSorted[nMid]) / 2;
+}
+
+double BenchResult::Max() const
+{
+    return *std::max_element(vElapsed.begin(), vElapsed.end());
+}
+
+BenchRunner::BenchmarkMap& BenchRunner::benchmarks()
+{
+    static BenchmarkMap benchmarks_map;
+    return benchmarks_map;
+}
+
+BenchRunner::BenchRunner(const std::string& name, BenchFunction func, uint64_t nIterations)
+{
+    benchmarks().insert(std::make_pair(name, Bench{func, nIterations}));
+}
+
+std::vector<std::string> BenchRunner::List(const std::regex& filter)
+{
+    std::vector<std::string> vNames;
+    for (const auto& p : benchmarks()) {
+        if (std::regex_match(p.first, filter))
+            vNames.push_back(p.first);
+    }
+    return vNames;
+}
+
+std::vector<BenchResult> BenchRunner::RunAll(const std::regex& filter, unsigned int nEvals, double scaling)
+{
+    std::vector<BenchResult> results;
+    for (const auto& p : benchmarks()) {
+        if (!std::regex_match(p.first, filter))
+            continue;
+
+        BenchResult result;
+        result.name = p.first;
+        result.nIterations = std::max<uint64_t>(1, std::llround(p.second.nIterations * scaling));
+        for (unsigned int n = 0; n < std::max(nEvals, 1u); n++) {
+            State state(result.nIterations);
+            p.second.func(state);
+            // the body must run until KeepRunning() returns false, the time is not taken otherwise
+            assert(!state.KeepRunning());
+            result.vElapsed.push_back(state.Elapsed() / result.nIterations);
+        }
+        results.push_back(result);
+    }
+    return results;
+}
+
+void PrintResults(const std::vector<BenchResult>& results)
+{
+    std::cout << strprintf("%-32s %10s %6s %14s %14s %14s\n", "# Benchmark", "iterations", "evals", "min(s)", "median(s)", "max(s)");
+    for (const BenchResult& result : results) {
+        std::cout << strprintf("%-32s %10d %6d %14.9f %14.9f %14.9f\n", result.name, result.nIterations,
+                               result.vElapsed.size(), result.Min(), result.Median(), result.Max());
+    }
+}
+
+std::string ResultsToJSON(const std::vector<BenchResult>& results, unsigned int nEvals, double scaling)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("version", FormatFullVersion()));
+    obj.push_back(Pair("evals", (int)nEvals));
+    obj.push_back(Pair("scaling", scaling));
+
+    UniValue benchmarks(UniValue::VARR);
+    for (const BenchResult& result : results) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("name", result.name));
+        entry.push_back(Pair("iterations", (uint64_t)result.nIterations));
+        // seconds per iteration
+        entry.push_back(Pair("min", result.Min()));
+        entry.push_back(Pair("median", result.Median()));
+        entry.push_back(Pair("max", result.Max()));
+        UniValue elapsed(UniValue::VARR);
+        for (double d : result.vElapsed)
+            elapsed.push_back(d);
+        entry.push_back(Pair("evaluations", elapsed));
+        benchmarks.push_back(entry);
+    }
+    obj.push_back(Pair("benchmarks", benchmarks));
+
+    return obj.write(2) + "\n";
+}
+
+} // namespace benchmark
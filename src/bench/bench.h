@@ -0,0 +1,114 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BENCH_BENCH_H
+#define BITCOIN_BENCH_BENCH_H
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+
+/**
+ * A minimal benchmark framework for the hot paths of the node, run by bench_zen.
+ *
+ * A benchmark is a function registered with BENCHMARK(name, iterations), which runs its body
+ * while state.KeepRunning() returns true:
+ *
+ *     static void CodeToBenchmark(benchmark::State& state)
+ *     {
+ *         ... setup, not measured ...
+ *         while (state.KeepRunning()) {
+ *             ... the code measured ...
+ *         }
+ *     }
+ *     BENCHMARK(CodeToBenchmark, 1000);
+ *
+ * Each evaluation calls the function once, running the body for the given iterations (multiplied
+ * by the -scaling factor). The minimum, median and maximum time of an iteration over the evaluations
+ * are reported, so that a run can be compared with the one of a previous release.
+ */
+namespace benchmark {
+
+typedef std::chrono::steady_clock clock;
+
+class State
+{
+public:
+    explicit State(uint64_t nIterationsIn) : nIterations(nIterationsIn) {}
+
+    //! Returns true while the iterations requested are not over, timing them from the first call
+    bool KeepRunning()
+    {
+        if (nCount == 0)
+            beginTime = clock::now();
+        if (nCount == nIterations) {
+            endTime = clock::now();
+            return false;
+        }
+        ++nCount;
+        return true;
+    }
+
+    //! The iterations a single evaluation runs, e.g. to prepare that many distinct inputs
+    uint64_t Iterations() const { return nIterations; }
+    //! Seconds taken by the iterations, once KeepRunning() has returned false
+    double Elapsed() const { return std::chrono::duration<double>(endTime - beginTime).count(); }
+
+private:
+    const uint64_t nIterations;
+    uint64_t nCount = 0;
+    clock::time_point beginTime;
+    clock::time_point endTime;
+};
+
+typedef std::function<void(State&)> BenchFunction;
+
+struct BenchResult
+{
+    std::string name;
+    uint64_t nIterations;
+    //! Seconds per iteration, one for each evaluation
+    std::vector<double> vElapsed;
+
+    double Min() const;
+    double Median() const;
+    double Max() const;
+};
+
+class BenchRunner
+{
+    struct Bench
+    {
+        BenchFunction func;
+        uint64_t nIterations;
+    };
+    typedef std::map<std::string, Bench> BenchmarkMap;
+    static BenchmarkMap& benchmarks();
+
+public:
+    BenchRunner(const std::string& name, BenchFunction func, uint64_t nIterations);
+
+    //! The names of the benchmarks registered, in the order they are run
+    static std::vector<std::string> List(const std::regex& filter);
+    static std::vector<BenchResult> RunAll(const std::regex& filter, unsigned int nEvals, double scaling);
+};
+
+//! Prints a table of the results, one benchmark per line
+void PrintResults(const std::vector<BenchResult>& results);
+//! The results as a JSON document, with the version of the node and the parameters of the run
+std::string ResultsToJSON(const std::vector<BenchResult>& results, unsigned int nEvals, double scaling);
+
+} // namespace benchmark
+
+// BENCHMARK(foo, num_iters) registers foo, running num_iters iterations for each evaluation
+#define BENCHMARK(n, num_iters) \
+    benchmark::BenchRunner BOOST_PP_CAT(bench_, BOOST_PP_CAT(__LINE__, n))(BOOST_PP_STRINGIZE(n), n, num_iters);
+
+#endif // BITCOIN_BENCH_BENCH_H
@@ -0,0 +1,98 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+#include "key.h"
+#include "pubkey.h"
+#include "sc/sidechain.h"
+#include "util.h"
+
+#include <fstream>
+#include <iostream>
+
+#include <boost/filesystem.hpp>
+#include <boost/scoped_ptr.hpp>
+
+static const int DEFAULT_BENCH_EVALUATIONS = 5;
+static const char* DEFAULT_BENCH_FILTER = ".*";
+
+static std::string HelpMessageBench()
+{
+    std::string strUsage;
+    strUsage += HelpMessageGroup(_("Options:"));
+    strUsage += HelpMessageOpt("-?", _("This help message"));
+    strUsage += HelpMessageOpt("-list", _("List the benchmarks selected by -filter, without running them"));
+    strUsage += HelpMessageOpt("-filter=<regex>", strprintf(_("Run only the benchmarks whose name matches the regular expression (default: %s)"), DEFAULT_BENCH_FILTER));
+    strUsage += HelpMessageOpt("-evals=<n>", strprintf(_("Number of evaluations of each benchmark, the minimum, median and maximum over them are reported (default: %d)"), DEFAULT_BENCH_EVALUATIONS));
+    strUsage += HelpMessageOpt("-scaling=<n>", _("Multiply the iterations of each evaluation by this factor (default: 1.0)"));
+    strUsage += HelpMessageOpt("-output_json=<file>", _("Also write the results to <file> in JSON format, \"-\" for the standard output"));
+    return strUsage;
+}
+
+int main(int argc, char** argv)
+{
+    SetupEnvironment();
+    ParseParameters(argc, argv);
+    if (mapArgs.count("-?") || mapArgs.count("-h") || mapArgs.count("-help")) {
+        std::cout << _("Horizen benchmarks version") << " " << FormatFullVersion() << "\n\n"
+                  << _("Usage:") << "\n  bench_zen [options]\n\n" << HelpMessageBench();
+        return 0;
+    }
+
+    const unsigned int nEvals = std::max<int64_t>(1, GetArg("-evals", DEFAULT_BENCH_EVALUATIONS));
+    const double scaling = atof(GetArg("-scaling", "1.0").c_str());
+    std::regex filter;
+    try {
+        filter = std::regex(GetArg("-filter", DEFAULT_BENCH_FILTER));
+    } catch (const std::regex_error& e) {
+        std::cerr << "Error: invalid -filter: " << e.what() << "\n";
+        return 1;
+    }
+
+    if (GetBoolArg("-list", false)) {
+        for (const std::string& name : benchmark::BenchRunner::List(filter))
+            std::cout << name << "\n";
+        return 0;
+    }
+
+    // The benchmarks work on a synthetic regtest chain, in a data directory of their own
+    boost::filesystem::path pathTemp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::create_directories(pathTemp);
+    mapArgs["-datadir"] = pathTemp.string();
+    fPrintToDebugLog = false;
+
+    assert(init_and_check_sodium() != -1);
+    SHA256AutoDetect();
+    ECC_Start();
+    boost::scoped_ptr<ECCVerifyHandle> verifyHandle(new ECCVerifyHandle());
+    SelectParams(CBaseChainParams::REGTEST);
+    assert(Sidechain::InitDLogKeys());
+
+    std::vector<benchmark::BenchResult> results = benchmark::BenchRunner::RunAll(filter, nEvals, scaling);
+    benchmark::PrintResults(results);
+
+    const std::string strJSON = GetArg("-output_json", "");
+    if (strJSON == "-") {
+        std::cout << benchmark::ResultsToJSON(results, nEvals, scaling);
+    } else if (!strJSON.empty()) {
+        std::ofstream file(strJSON);
+        file << benchmark::ResultsToJSON(results, nEvals, scaling);
+        if (!file) {
+            std::cerr << "Error: could not write the results to " << strJSON << "\n";
+            return 1;
+        }
+    }
+
+    verifyHandle.reset();
+    ECC_Stop();
+
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(pathTemp, ec);
+    return 0;
+}
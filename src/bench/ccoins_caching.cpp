@@ -0,0 +1,114 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "coins.h"
+#include "main.h"
+#include "primitives/transaction.h"
+#include "random.h"
+#include "script/script.h"
+#include "undo.h"
+
+#include <assert.h>
+
+static const size_t CACHED_COINS = 10000;
+static const size_t TX_INPUTS = 10;
+
+/**
+ * The coins of the benchmarks, cached on top of an empty view as the coins tip is on top of the
+ * database. Each iteration reads them through a cache of its own, as a block or a mempool check does.
+ */
+class CCoinsBenchView
+{
+public:
+    CCoinsBenchView() : tip(&base)
+    {
+        script << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0x01) << OP_EQUALVERIFY << OP_CHECKSIG;
+        for (size_t n = 0; n < CACHED_COINS; n++) {
+            CMutableTransaction mtx;
+            mtx.nVersion = TRANSPARENT_TX_VERSION;
+            mtx.vin.resize(1);
+            mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+            mtx.addOut(CTxOut(1000, script));
+            CTransaction tx(mtx);
+            tip.ModifyCoins(tx.GetHash())->From(tx, 1);
+            vTxids.push_back(tx.GetHash());
+        }
+    }
+
+    //! A transaction spending TX_INPUTS of the coins, starting from the nFirst-th
+    CTransaction CreateSpendingTx(size_t nFirst) const
+    {
+        CMutableTransaction mtx;
+        mtx.nVersion = TRANSPARENT_TX_VERSION;
+        for (size_t n = 0; n < TX_INPUTS; n++)
+            mtx.vin.push_back(CTxIn(COutPoint(vTxids[(nFirst + n) % vTxids.size()], 0)));
+        mtx.addOut(CTxOut(900 * TX_INPUTS, script));
+        return CTransaction(mtx);
+    }
+
+    CCoinsView base;
+    CCoinsViewCache tip;
+    std::vector<uint256> vTxids;
+    CScript script;
+};
+
+static CCoinsBenchView& GetCoinsBenchView()
+{
+    static CCoinsBenchView view;
+    return view;
+}
+
+// Checks that the inputs of a transaction exist and sums their value, as for a mempool check
+static void CCoinsCaching(benchmark::State& state)
+{
+    CCoinsBenchView& view = GetCoinsBenchView();
+    const CTransaction tx = view.CreateSpendingTx(0);
+    while (state.KeepRunning()) {
+        CCoinsViewCache cache(&view.tip);
+        assert(cache.HaveInputs(tx));
+        assert(cache.GetValueIn(tx) == 1000 * TX_INPUTS);
+    }
+}
+
+// Spends the inputs of a transaction and adds its outputs, as when a block is connected
+static void CCoinsUpdate(benchmark::State& state)
+{
+    CCoinsBenchView& view = GetCoinsBenchView();
+    std::vector<CTransaction> vTx;
+    for (size_t n = 0; n < CACHED_COINS / TX_INPUTS; n++)
+        vTx.push_back(view.CreateSpendingTx(n * TX_INPUTS));
+
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        CCoinsViewCache cache(&view.tip);
+        CTxUndo txundo;
+        UpdateCoins(vTx[n++ % vTx.size()], cache, txundo, 2);
+        assert(txundo.vprevout.size() == TX_INPUTS);
+    }
+}
+
+// Writes the coins modified by a child cache back to its parent, as each block connected does
+static void CCoinsFlush(benchmark::State& state)
+{
+    CCoinsBenchView& view = GetCoinsBenchView();
+    CCoinsViewCache parent(&view.tip);
+    while (state.KeepRunning()) {
+        CCoinsViewCache cache(&parent);
+        for (size_t n = 0; n < TX_INPUTS; n++) {
+            CMutableTransaction mtx;
+            mtx.vin.resize(1);
+            mtx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+            mtx.addOut(CTxOut(1000, view.script));
+            CTransaction tx(mtx);
+            cache.ModifyCoins(tx.GetHash())->From(tx, 2);
+        }
+        assert(cache.Flush());
+    }
+}
+
+BENCHMARK(CCoinsCaching, 100000);
+BENCHMARK(CCoinsUpdate, 50000);
+BENCHMARK(CCoinsFlush, 20000);
@@ -0,0 +1,75 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "amount.h"
+#include "main.h"
+#include "random.h"
+#include "wallet/wallet.h"
+
+#include <assert.h>
+#include <memory>
+
+static const size_t BENCH_WALLET_COINS = 2000;
+
+/**
+ * The coins of a wallet, as AvailableCoins() returns them to coin selection: the transactions
+ * have no inputs, so that they are not from the wallet and are selected at any depth.
+ */
+class CCoinSelectionBench
+{
+public:
+    //! nUnit is the granularity of the values, a changeless selection is likely with whole cents
+    CCoinSelectionBench(CAmount nUnitIn) : nUnit(nUnitIn)
+    {
+        for (size_t n = 0; n < BENCH_WALLET_COINS; n++) {
+            CMutableTransaction mtx;
+            // so that all transactions get different hashes
+            mtx.nLockTime = n;
+            mtx.addOut(CTxOut((1 + GetRand(COIN / nUnit)) * nUnit, CScript()));
+            vWtx.emplace_back(new CWalletTx(&wallet, mtx));
+            vCoins.push_back(COutput(vWtx.back().get(), 0, 6, true));
+            nTotal += mtx.getVout()[0].nValue;
+        }
+    }
+
+    //! Selects coins for about half of the wallet, returns the change left
+    CAmount Select() const
+    {
+        std::set<std::pair<const CWalletTransactionBase*, unsigned int> > setCoins;
+        CAmount nValue = 0;
+        const CAmount nTarget = nTotal / 2 / nUnit * nUnit;
+        LOCK(wallet.cs_wallet);
+        assert(wallet.SelectCoinsMinConf(nTarget, 1, 6, vCoins, setCoins, nValue));
+        return nValue - nTarget;
+    }
+
+private:
+    const CAmount nUnit;
+    CWallet wallet;
+    std::vector<std::unique_ptr<CWalletTx> > vWtx;
+    std::vector<COutput> vCoins;
+    CAmount nTotal = 0;
+};
+
+// Whole cents, a subset needing no change is found by the branch and bound search
+static void CoinSelectionChangeless(benchmark::State& state)
+{
+    const CCoinSelectionBench bench(CENT);
+    const CAmount nDust = CTxOut(0, GetScriptForDestination(CKeyID(), false)).GetDustThreshold(::minRelayTxFee);
+    while (state.KeepRunning())
+        assert(bench.Select() < nDust);
+}
+
+// Values of any satoshi, the search mostly runs out of tries and the stochastic approximation makes change
+static void CoinSelectionWithChange(benchmark::State& state)
+{
+    const CCoinSelectionBench bench(1);
+    while (state.KeepRunning())
+        bench.Select();
+}
+
+BENCHMARK(CoinSelectionChangeless, 200);
+BENCHMARK(CoinSelectionWithChange, 20);
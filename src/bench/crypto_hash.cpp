@@ -0,0 +1,117 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "chainparams.h"
+#include "crypto/equihash.h"
+#include "crypto/sha256.h"
+#include "hash.h"
+#include "pow.h"
+#include "primitives/block.h"
+#include "streams.h"
+#include "version.h"
+
+#include <assert.h>
+
+/* Number of bytes to hash per iteration */
+static const uint64_t BUFFER_SIZE = 1000*1000;
+
+static void SHA256_1MB(benchmark::State& state)
+{
+    uint8_t hash[CSHA256::OUTPUT_SIZE];
+    std::vector<uint8_t> in(BUFFER_SIZE, 0);
+    while (state.KeepRunning())
+        CSHA256().Write(in.data(), in.size()).Finalize(hash);
+}
+
+static void SHA256_32b(benchmark::State& state)
+{
+    std::vector<uint8_t> in(32, 0);
+    while (state.KeepRunning())
+        CSHA256().Write(in.data(), in.size()).Finalize(in.data());
+}
+
+// The double SHA256 of 1024 pairs of hashes, as computed for each level of the merkle trees
+static void SHA256D64_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(64 * 1024, 0);
+    while (state.KeepRunning())
+        SHA256D64(in.data(), in.data(), 1024);
+}
+
+// The double SHA256 of a block header, as computed for each header received
+static void SHA256D_BlockHeader(benchmark::State& state)
+{
+    CBlockHeader header = Params(CBaseChainParams::MAIN).GenesisBlock().GetBlockHeader();
+    uint256 hash;
+    while (state.KeepRunning()) {
+        hash = header.GetHash();
+        header.nNonce = hash;
+    }
+}
+
+// The merkle root of the leaves of a large block, only the root or all the nodes of the tree
+static void MerkleRoot(benchmark::State& state)
+{
+    std::vector<uint256> vLeaves(9001);
+    for (size_t n = 0; n < vLeaves.size(); n++)
+        vLeaves[n] = ArithToUint256(n + 1);
+    while (state.KeepRunning())
+        vLeaves[0] = CBlock::ComputeMerkleRoot(vLeaves);
+}
+
+static void MerkleTree(benchmark::State& state)
+{
+    std::vector<uint256> vLeaves(9001);
+    for (size_t n = 0; n < vLeaves.size(); n++)
+        vLeaves[n] = ArithToUint256(n + 1);
+    while (state.KeepRunning()) {
+        std::vector<uint256> vMerkleTree(vLeaves);
+        vLeaves[0] = CBlock::BuildMerkleTree(vMerkleTree, vLeaves.size());
+    }
+}
+
+static void EquihashVerify(benchmark::State& state)
+{
+    const CChainParams& params = Params(CBaseChainParams::MAIN);
+    const CBlockHeader header = params.GenesisBlock().GetBlockHeader();
+    while (state.KeepRunning()) {
+        // a solution already checked is served by the cache otherwise
+        ClearEquihashCache();
+        assert(CheckEquihashSolution(&header, params));
+    }
+}
+
+// The same check on the solution with the index hashes computed one by one from the libsodium state
+static void EquihashVerifyState(benchmark::State& state)
+{
+    const CChainParams& params = Params(CBaseChainParams::MAIN);
+    const CBlockHeader header = params.GenesisBlock().GetBlockHeader();
+    const unsigned int n = params.EquihashN();
+    const unsigned int k = params.EquihashK();
+
+    CEquihashInput I{header};
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << I;
+    ss << header.nNonce;
+    while (state.KeepRunning()) {
+        crypto_generichash_blake2b_state eh_state;
+        EhInitialiseState(n, k, eh_state);
+        crypto_generichash_blake2b_update(&eh_state, (unsigned char*)&ss[0], ss.size());
+        bool isValid;
+        EhIsValidSolution(n, k, eh_state, header.nSolution, isValid);
+        assert(isValid);
+    }
+}
+
+BENCHMARK(SHA256_1MB, 340);
+BENCHMARK(SHA256_32b, 4700000);
+BENCHMARK(SHA256D64_1024, 1000);
+BENCHMARK(SHA256D_BlockHeader, 100000);
+BENCHMARK(MerkleRoot, 800);
+BENCHMARK(MerkleTree, 800);
+BENCHMARK(EquihashVerify, 50);
+BENCHMARK(EquihashVerifyState, 50);
@@ -0,0 +1,69 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "leveldbwrapper.h"
+#include "random.h"
+#include "uint256.h"
+#include "util.h"
+
+#include <assert.h>
+
+#include <boost/filesystem.hpp>
+
+static const size_t BENCH_DB_CACHE = 8 << 20;
+static const size_t BLOCK_COINS = 250;
+static const size_t BLOCK_SIDECHAINS = 4;
+static const size_t BLOCK_CSW_NULLIFIERS = 8;
+
+/**
+ * Writes the batches the node flushes to the chainstate at each block, with the key patterns of txdb: the coins
+ * of the transactions by txid, the sidechains and the nullifiers of the ceased sidechain withdrawals, all keyed by
+ * random hashes, and the best block. The keys being random, the compactions of the lower levels overlap the
+ * whole key space, which is what the write buffer, the level-0 triggers and the subcompactions change.
+ */
+static void WriteChainstateBatches(benchmark::State& state, const CLevelDBTuning& tuning)
+{
+    const boost::filesystem::path path = GetTempPath() / strprintf("bench_leveldb_%s", GetRandHash().ToString());
+    {
+        CLevelDBWrapper db(path, BENCH_DB_CACHE, 64, false, true, tuning);
+        const std::vector<unsigned char> vchCoins(120, 0x01);
+        const std::vector<unsigned char> vchSidechain(400, 0x02);
+        const std::vector<unsigned char> vchNullifier(1, 0x03);
+
+        while (state.KeepRunning()) {
+            CLevelDBBatch batch;
+            for (size_t n = 0; n < BLOCK_COINS; n++)
+                batch.Write(std::make_pair('c', GetRandHash()), vchCoins);
+            for (size_t n = 0; n < BLOCK_SIDECHAINS; n++)
+                batch.Write(std::make_pair('i', GetRandHash()), vchSidechain);
+            for (size_t n = 0; n < BLOCK_CSW_NULLIFIERS; n++)
+                batch.Write(std::make_pair('n', GetRandHash()), vchNullifier);
+            batch.Write('B', GetRandHash());
+            assert(db.WriteBatch(batch));
+        }
+    }
+    boost::filesystem::remove_all(path);
+}
+
+static void LevelDBChainstateDefault(benchmark::State& state)
+{
+    WriteChainstateBatches(state, CLevelDBTuning());
+}
+
+// Larger memtables and level-0 triggers, and the compactions split in four concurrent ranges
+static void LevelDBChainstateTuned(benchmark::State& state)
+{
+    CLevelDBTuning tuning;
+    tuning.nWriteBufferSize = 16 << 20;
+    tuning.nL0CompactionTrigger = 8;
+    tuning.nL0SlowdownTrigger = 16;
+    tuning.nL0StopTrigger = 24;
+    tuning.nSubcompactions = 4;
+    WriteChainstateBatches(state, tuning);
+}
+
+BENCHMARK(LevelDBChainstateDefault, 2000);
+BENCHMARK(LevelDBChainstateTuned, 2000);
@@ -0,0 +1,123 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "sc/proofcache.h"
+#include "sc/proofverifier.h"
+#include "tinyformat.h"
+
+#include <gtest/libzendoo_test_files.h>
+#include <gtest/tx_creation_utils.h>
+
+#include <algorithm>
+#include <assert.h>
+
+using namespace blockchain_test_utils;
+
+static const size_t BENCH_PROOFS_BATCH = 8;
+
+/**
+ * A proof verifier whose queue is filled directly with prebuilt items,
+ * so that only the verification itself is measured.
+ */
+class CBenchProofVerifier : public CScProofVerifier
+{
+public:
+    CBenchProofVerifier() : CScProofVerifier(Verification::Strict, Priority::High) {}
+
+    void AddItem(const uint256& hash, const boost::variant<CCertProofVerifierInput, std::vector<CCswProofVerifierInput>>& input)
+    {
+        CProofVerifierItem item;
+        item.txHash = hash;
+        item.node = nullptr;
+        item.result = ProofVerificationResult::Unknown;
+        item.proofInput = input;
+        proofQueue[item.txHash] = item;
+    }
+
+    bool Verify(bool fBatch)
+    {
+        // proofs verified by a previous iteration must not be served by the cache
+        CScProofVerificationCache::GetInstance().Clear();
+        if (fBatch)
+            return BatchVerify();
+
+        NormalVerify(proofQueue);
+        return std::all_of(proofQueue.begin(), proofQueue.end(),
+                           [](const std::pair<const uint256, CProofVerifierItem>& entry)
+                           { return entry.second.result == ProofVerificationResult::Passed; });
+    }
+};
+
+// The same values used by the unit tests, with a valid Darlin test proof
+static const CCertProofVerifierInput& GetBenchCertInput()
+{
+    static CCertProofVerifierInput input;
+    if (input.proof.IsNull()) {
+        const BlockchainTestManager& manager = BlockchainTestManager::GetInstance();
+        manager.GenerateSidechainTestParameters(ProvingSystem::Darlin, TestCircuitType::Certificate, false);
+
+        input.certHash = uint256S("cccc");
+        input.scId = uint256S("aaaa");
+        input.constant = CFieldElement(SAMPLE_FIELD);
+        input.epochNumber = 7;
+        input.quality = 10;
+        input.endEpochCumScTxCommTreeRoot = CFieldElement(SAMPLE_FIELD);
+        input.mainchainBackwardTransferRequestScFee = 1;
+        input.forwardTransferScFee = 1;
+        input.verificationKey = manager.GetTestVerificationKey(ProvingSystem::Darlin, TestCircuitType::Certificate);
+        input.proof = manager.GenerateTestCertificateProof(input, ProvingSystem::Darlin);
+    }
+    return input;
+}
+
+static const CCswProofVerifierInput& GetBenchCswInput()
+{
+    static CCswProofVerifierInput input;
+    if (input.proof.IsNull()) {
+        const BlockchainTestManager& manager = BlockchainTestManager::GetInstance();
+        manager.GenerateSidechainTestParameters(ProvingSystem::Darlin, TestCircuitType::CSW, false);
+
+        input.scId = uint256S("aaaa");
+        input.constant = CFieldElement(SAMPLE_FIELD);
+        input.ceasingCumScTxCommTree = CFieldElement(SAMPLE_FIELD);
+        input.certDataHash = CFieldElement(SAMPLE_FIELD);
+        input.nValue = CAmount(15);
+        input.nullifier = CFieldElement(SAMPLE_FIELD);
+        input.verificationKey = manager.GetTestVerificationKey(ProvingSystem::Darlin, TestCircuitType::CSW);
+        input.proof = manager.GenerateTestCswProof(input, ProvingSystem::Darlin);
+    }
+    return input;
+}
+
+static void ScCertProofVerify(benchmark::State& state)
+{
+    CBenchProofVerifier verifier;
+    verifier.AddItem(GetBenchCertInput().certHash, GetBenchCertInput());
+    while (state.KeepRunning())
+        assert(verifier.Verify(false));
+}
+
+// The same proof is queued under different hashes: the batch verifier processes each entry as a separate proof anyway
+static void ScCertProofsBatchVerify(benchmark::State& state)
+{
+    CBenchProofVerifier verifier;
+    for (size_t n = 0; n < BENCH_PROOFS_BATCH; n++)
+        verifier.AddItem(uint256S(strprintf("%x", n + 1)), GetBenchCertInput());
+    while (state.KeepRunning())
+        assert(verifier.Verify(true));
+}
+
+static void ScCswProofVerify(benchmark::State& state)
+{
+    CBenchProofVerifier verifier;
+    verifier.AddItem(uint256S("dddd"), std::vector<CCswProofVerifierInput>{GetBenchCswInput()});
+    while (state.KeepRunning())
+        assert(verifier.Verify(false));
+}
+
+BENCHMARK(ScCertProofVerify, 10);
+BENCHMARK(ScCertProofsBatchVerify, 5);
+BENCHMARK(ScCswProofVerify, 10);
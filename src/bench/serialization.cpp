@@ -0,0 +1,82 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "random.h"
+#include "script/script.h"
+#include "streams.h"
+#include "version.h"
+
+#include <assert.h>
+
+static const size_t TX_INPUTS = 10;
+static const size_t TX_OUTPUTS = 2;
+static const size_t BLOCK_TXS = 1000;
+
+// A transparent transaction of the usual size, with P2PKH sized scripts
+static CTransaction CreateSerializationTx()
+{
+    CMutableTransaction mtx;
+    mtx.nVersion = TRANSPARENT_TX_VERSION;
+    mtx.vin.resize(TX_INPUTS);
+    for (CTxIn& in : mtx.vin) {
+        in.prevout = COutPoint(GetRandHash(), 0);
+        in.scriptSig = CScript() << std::vector<unsigned char>(72, 0x30) << std::vector<unsigned char>(33, 0x02);
+    }
+    mtx.resizeOut(TX_OUTPUTS);
+    for (size_t n = 0; n < TX_OUTPUTS; n++) {
+        mtx.getOut(n).nValue = 1000;
+        mtx.getOut(n).scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0x01)
+                                               << OP_EQUALVERIFY << OP_CHECKSIG;
+    }
+    return CTransaction(mtx);
+}
+
+static void SerializeTransaction(benchmark::State& state)
+{
+    const CTransaction tx = CreateSerializationTx();
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    while (state.KeepRunning()) {
+        stream << tx;
+        stream.clear();
+    }
+}
+
+static void DeserializeTransaction(benchmark::State& state)
+{
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << CreateSerializationTx();
+    const CDataStream data(stream);
+    while (state.KeepRunning()) {
+        CDataStream input(data);
+        CTransaction tx;
+        input >> tx;
+        assert(tx.GetVin().size() == TX_INPUTS);
+    }
+}
+
+// The block is deserialized into a fresh object, then its transactions are hashed, as when it is received
+static void DeserializeBlock(benchmark::State& state)
+{
+    CBlock block;
+    for (size_t n = 0; n < BLOCK_TXS; n++)
+        block.vtx.push_back(CreateSerializationTx());
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << block;
+    const CDataStream data(stream);
+    while (state.KeepRunning()) {
+        CDataStream input(data);
+        CBlock blockIn;
+        input >> blockIn;
+        blockIn.BuildMerkleTree();
+        assert(blockIn.vtx.size() == BLOCK_TXS);
+    }
+}
+
+BENCHMARK(SerializeTransaction, 100000);
+BENCHMARK(DeserializeTransaction, 50000);
+BENCHMARK(DeserializeBlock, 20);
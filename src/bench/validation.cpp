@@ -0,0 +1,182 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chainparams.h"
+#include "coins.h"
+#include "consensus/validation.h"
+#include "key.h"
+#include "keystore.h"
+#include "main.h"
+#include "miner.h"
+#include "pow.h"
+#include "script/sign.h"
+#include "script/standard.h"
+#include "txdb.h"
+#include "txmempool.h"
+#include "zen/forkmanager.h"
+
+#include <assert.h>
+#include <memory>
+
+/** The height of the synthetic chain, past the sidechain forks of regtest */
+static const int BENCH_CHAIN_HEIGHT = 500;
+/** The transactions in the mempool, and in the blocks created from it */
+static const size_t BENCH_BLOCK_TXS = 200;
+static const CAmount BENCH_COIN_VALUE = 100000;
+static const CAmount BENCH_TX_FEE = 10000;
+
+/**
+ * A regtest chain of block indexes only, with the coins tip and the block tree in memory: the
+ * benchmarks run the validation code on transactions spending coins written directly to the tip.
+ */
+class CBenchChain
+{
+public:
+    static CBenchChain& GetInstance()
+    {
+        static CBenchChain instance;
+        return instance;
+    }
+
+    /** Creates nTxs transactions, each spending a new coin of the tip to a replay protected P2PKH output */
+    std::vector<CTransaction> CreateSpendingTxs(size_t nTxs)
+    {
+        LOCK(cs_main);
+        std::vector<CTransaction> vTx;
+        for (size_t n = 0; n < nTxs; n++) {
+            const uint256 hashCoin = GetRandHash();
+            {
+                CCoinsModifier coins = pcoinsTip->ModifyCoins(hashCoin);
+                coins->fCoinBase = false;
+                coins->nVersion = TRANSPARENT_TX_VERSION;
+                coins->nHeight = 1;
+                coins->vout.assign(1, CTxOut(BENCH_COIN_VALUE, script));
+            }
+
+            CMutableTransaction mtx;
+            mtx.nVersion = TRANSPARENT_TX_VERSION;
+            mtx.vin.push_back(CTxIn(COutPoint(hashCoin, 0)));
+            mtx.addOut(CTxOut(BENCH_COIN_VALUE - BENCH_TX_FEE, script));
+            assert(SignSignature(keystore, script, mtx, 0));
+            vTx.push_back(CTransaction(mtx));
+        }
+        return vTx;
+    }
+
+    //! A block on top of the chain with the transactions of the mempool, as created for the miners
+    const CBlock& GetBlock() const { return block; }
+    const CScript& GetScript() const { return script; }
+
+private:
+    CBenchChain()
+    {
+        InitChain();
+        InitCoinsTip();
+
+        key.MakeNewKey(true);
+        keystore.AddKey(key);
+        // the replay protection references a block of the chain, which must be set first
+        script = GetScriptForDestination(key.GetPubKey().GetID());
+
+        for (const CTransaction& tx : CreateSpendingTxs(BENCH_BLOCK_TXS))
+            assert(mempool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, BENCH_TX_FEE, GetTime(), 0.0, BENCH_CHAIN_HEIGHT)));
+
+        std::unique_ptr<CBlockTemplate> pblocktemplate(CreateNewBlock(script));
+        assert(pblocktemplate);
+        block = pblocktemplate->block;
+        assert(block.vtx.size() == BENCH_BLOCK_TXS + 1);
+    }
+
+    // The block indexes are owned by mapBlockIndex, which deletes them at exit
+    void InitChain()
+    {
+        LOCK(cs_main);
+        const Consensus::Params& consensus = Params().GetConsensus();
+        const int64_t nTimeTip = GetTime() - consensus.nPowTargetSpacing;
+        CBlockIndex* pindexPrev = nullptr;
+        for (int height = 0; height <= BENCH_CHAIN_HEIGHT; height++) {
+            CBlockIndex* pindex = new CBlockIndex();
+            pindex->nHeight = height;
+            pindex->pprev = pindexPrev;
+            // the times end now, blocks too far ahead of the median time past are rejected otherwise
+            pindex->nTime = nTimeTip - (BENCH_CHAIN_HEIGHT - height) * consensus.nPowTargetSpacing;
+            pindex->nBits = UintToArith256(consensus.powLimit).GetCompact();
+            pindex->nChainWork = pindexPrev ? pindexPrev->nChainWork + GetBlockProof(*pindexPrev) : arith_uint256(0);
+            pindex->nVersion = zen::ForkManager::getInstance().getNewBlockVersion(height);
+
+            BlockMap::iterator mi = mapBlockIndex.insert(std::make_pair(ArithToUint256(height + 1), pindex)).first;
+            pindex->phashBlock = &(mi->first);
+            pindex->BuildSkip();
+            pindexPrev = pindex;
+        }
+        chainActive.SetTip(pindexPrev);
+        pindexBestHeader = pindexPrev;
+    }
+
+    void InitCoinsTip()
+    {
+        LOCK(cs_main);
+        pblocktree = new CBlockTreeDB(1 << 20, DEFAULT_DB_MAX_OPEN_FILES, true);
+        pcoinsdbview = new CCoinsViewDB(1 << 23, DEFAULT_DB_MAX_OPEN_FILES, true);
+        pcoinsTip = new CCoinsViewCache(pcoinsdbview);
+
+        ZCIncrementalMerkleTree tree;
+        tree.append(GetRandHash());
+        pcoinsTip->PushAnchor(tree);
+        pcoinsTip->SetBestBlock(chainActive.Tip()->GetBlockHash());
+    }
+
+    CKey key;
+    CBasicKeyStore keystore;
+    CScript script;
+    CBlock block;
+};
+
+// Accepts to an empty mempool transactions never seen before, whose scripts are not cached
+static void MempoolAcceptTx(benchmark::State& state)
+{
+    std::vector<CTransaction> vTx = CBenchChain::GetInstance().CreateSpendingTxs(state.Iterations());
+
+    LOCK(cs_main);
+    CTxMemPool pool(::minRelayTxFee);
+    size_t n = 0;
+    while (state.KeepRunning()) {
+        CValidationState validationState;
+        assert(AcceptTxToMemoryPool(pool, validationState, vTx[n++], LimitFreeFlag::OFF, RejectAbsurdFeeFlag::OFF,
+                                    MempoolProofVerificationFlag::SYNC) == MempoolReturnValue::VALID);
+    }
+}
+
+// Creates the template of a block with the transactions of the mempool, including its validity test
+static void CreateNewBlockTemplate(benchmark::State& state)
+{
+    CBenchChain& chain = CBenchChain::GetInstance();
+    while (state.KeepRunning()) {
+        std::unique_ptr<CBlockTemplate> pblocktemplate(CreateNewBlock(chain.GetScript()));
+        assert(pblocktemplate->block.vtx.size() == BENCH_BLOCK_TXS + 1);
+    }
+}
+
+// Connects the block on top of the chain without writing it, the signatures are cached after the first iteration
+static void ConnectBlockCheckOnly(benchmark::State& state)
+{
+    const CBlock& block = CBenchChain::GetInstance().GetBlock();
+
+    LOCK(cs_main);
+    CBlockIndex index(block);
+    index.pprev = chainActive.Tip();
+    index.nHeight = chainActive.Height() + 1;
+    while (state.KeepRunning()) {
+        CCoinsViewCache view(pcoinsTip);
+        CValidationState validationState;
+        assert(ConnectBlock(block, validationState, &index, view, chainActive, flagBlockProcessingType::CHECK_ONLY,
+                            flagScRelatedChecks::ON, flagScProofVerification::ON, flagLevelDBIndexesWrite::OFF));
+    }
+}
+
+BENCHMARK(MempoolAcceptTx, 500);
+BENCHMARK(CreateNewBlockTemplate, 20);
+BENCHMARK(ConnectBlockCheckOnly, 20);
@@ -10,7 +10,9 @@
 #include "util.h"
 #include "utilstrencodings.h"
 
+#include <boost/algorithm/string.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <iostream>
 #include <stdio.h>
 
 #include <event2/buffer.h>
@@ -22,6 +24,7 @@
 using namespace std;
 
 static const int DEFAULT_HTTP_CLIENT_TIMEOUT=900;
+static const int DEFAULT_BATCH_SIZE=100;
 
 std::string HelpMessageCli()
 {
@@ -38,7 +41,11 @@ std::string HelpMessageCli()
     strUsage += HelpMessageOpt("-rpcwait", _("Wait for RPC server to start"));
     strUsage += HelpMessageOpt("-rpcuser=<user>", _("Username for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcpassword=<pw>", _("Password for JSON-RPC connections"));
+    strUsage += HelpMessageOpt("-rpcwallet=<file>", _("Send wallet RPC calls to the wallet of <file>, among the ones loaded by the node with -wallet"));
     strUsage += HelpMessageOpt("-rpcclienttimeout=<n>", strprintf(_("Timeout in seconds during HTTP requests, or 0 for no timeout. (default: %d)"), DEFAULT_HTTP_CLIENT_TIMEOUT));
+    strUsage += HelpMessageOpt("-batch", _("Read the commands from standard input, one per line, as \"<command> [params]\" or a JSON array "
+                                           "[\"command\", param, ...], send them over a single connection as JSON-RPC batches and print the results in order"));
+    strUsage += HelpMessageOpt("-batchsize=<n>", strprintf(_("Number of commands sent in each batch with -batch (default: %d)"), DEFAULT_BATCH_SIZE));
 
     return strUsage;
 }
@@ -68,13 +75,14 @@ static bool AppInitRPC(int argc, char* argv[])
     // Parameters
     //
     ParseParameters(argc, argv);
-    if (argc<2 || mapArgs.count("-?") || mapArgs.count("-h") || mapArgs.count("-help") || mapArgs.count("-version")) {
+    if ((argc<2 && !mapArgs.count("-batch")) || mapArgs.count("-?") || mapArgs.count("-h") || mapArgs.count("-help") || mapArgs.count("-version")) {
         std::string strUsage = _("Horizen RPC client version") + " " + FormatFullVersion() + "\n";
         if (!mapArgs.count("-version")) {
             strUsage += "\n" + _("Usage:") + "\n" +
                   "  zen-cli [options] <command> [params]  " + _("Send command to horizen") + "\n" +
                   "  zen-cli [options] help                " + _("List commands") + "\n" +
-                  "  zen-cli [options] help <command>      " + _("Get help for a command") + "\n";
+                  "  zen-cli [options] help <command>      " + _("Get help for a command") + "\n" +
+                  "  zen-cli [options] -batch              " + _("Send the commands read from standard input") + "\n";
 
             strUsage += "\n" + HelpMessageCli();
         } else {
@@ -173,28 +181,40 @@ static void http_error_cb(enum evhttp_request_error err, void *ctx)
 }
 #endif
 
-UniValue CallRPC(const string& strMethod, const UniValue& params)
+/**
+ * A connection to the RPC server. Kept alive, it carries all the requests posted through it,
+ * the credentials being looked up once.
+ */
+class CRPCConnection
+{
+public:
+    explicit CRPCConnection(bool fKeepAliveIn = false);
+
+    //! Post a JSON-RPC request, or batch of requests, and parse the reply
+    UniValue Post(const std::string& strRequest);
+
+private:
+    std::string host;
+    std::string strRPCUserColonPass;
+    std::string endpoint;
+    bool fKeepAlive;
+    raii_event_base base;
+    raii_evhttp_connection evcon;
+};
+
+CRPCConnection::CRPCConnection(bool fKeepAliveIn) : fKeepAlive(fKeepAliveIn)
 {
-    std::string host = GetArg("-rpcconnect", "127.0.0.1");
+    host = GetArg("-rpcconnect", "127.0.0.1");
     int port = GetArg("-rpcport", BaseParams().RPCPort());
 
     // Obtain event base
-    raii_event_base base = obtain_event_base();
+    base = obtain_event_base();
 
     // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
+    evcon = obtain_evhttp_connection_base(base.get(), host, port);
     evhttp_connection_set_timeout(evcon.get(), GetArg("-rpcclienttimeout", DEFAULT_HTTP_CLIENT_TIMEOUT));
 
-    HTTPReply response;
-    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
-    if (req == NULL)
-        throw runtime_error("create http request failed");
-#if LIBEVENT_VERSION_NUMBER >= 0x02010300
-    evhttp_request_set_error_cb(req.get(), http_error_cb);
-#endif
-
     // Get credentials
-    std::string strRPCUserColonPass;
     if (mapArgs["-rpcpassword"] == "") {
         // Try fall back to cookie-based authentication if no password is provided
         if (!GetAuthCookie(&strRPCUserColonPass)) {
@@ -208,19 +228,34 @@ UniValue CallRPC(const string& strMethod, const UniValue& params)
         strRPCUserColonPass = mapArgs["-rpcuser"] + ":" + mapArgs["-rpcpassword"];
     }
 
+    // the calls for a wallet in particular are sent to its endpoint
+    endpoint = "/";
+    if (mapArgs.count("-rpcwallet"))
+        endpoint = "/wallet/" + mapArgs["-rpcwallet"];
+}
+
+UniValue CRPCConnection::Post(const std::string& strRequest)
+{
+    HTTPReply response;
+    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
+    if (req == NULL)
+        throw runtime_error("create http request failed");
+#if LIBEVENT_VERSION_NUMBER >= 0x02010300
+    evhttp_request_set_error_cb(req.get(), http_error_cb);
+#endif
+
     struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
     assert(output_headers);
     evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
+    evhttp_add_header(output_headers, "Connection", fKeepAlive ? "keep-alive" : "close");
     evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(strRPCUserColonPass)).c_str());
 
     // Attach request data
-    std::string strRequest = JSONRPCRequest(strMethod, params, 1);
     struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
     assert(output_buffer);
     evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
 
-    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, "/");
+    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, endpoint.c_str());
     req.release(); // ownership moved to evcon in above call
     if (r != 0) {
         throw CConnectionFailed("send http request failed");
@@ -241,6 +276,13 @@ UniValue CallRPC(const string& strMethod, const UniValue& params)
     UniValue valReply(UniValue::VSTR);
     if (!valReply.read(response.body))
         throw runtime_error("couldn't parse reply from server");
+    return valReply;
+}
+
+UniValue CallRPC(const string& strMethod, const UniValue& params)
+{
+    CRPCConnection connection;
+    UniValue valReply = connection.Post(JSONRPCRequest(strMethod, params, 1));
     const UniValue& reply = valReply.get_obj();
     if (reply.empty())
         throw runtime_error("expected reply to have result, error and id properties");
@@ -248,6 +290,133 @@ UniValue CallRPC(const string& strMethod, const UniValue& params)
     return reply;
 }
 
+//! The text printed for the result of a call
+static std::string FormatResult(const UniValue& result)
+{
+    if (result.isNull())
+        return "";
+    else if (result.isStr())
+        return result.get_str();
+    else
+        return result.write(2);
+}
+
+//! The text printed for the error of a call
+static std::string FormatError(const UniValue& error)
+{
+    if (!error.isObject())
+        return "error: " + error.write();
+
+    UniValue errCode = find_value(error, "code");
+    UniValue errMsg  = find_value(error, "message");
+    std::string strPrint = errCode.isNull() ? "" : "error code: "+errCode.getValStr()+"\n";
+    if (errMsg.isStr())
+        strPrint += "error message:\n"+errMsg.get_str();
+    return strPrint;
+}
+
+//! The JSON-RPC request of a line of -batch, the id being set by the caller
+static UniValue ParseBatchLine(const std::string& strLine)
+{
+    std::string strMethod;
+    UniValue params(UniValue::VARR);
+
+    if (strLine[0] == '[') {
+        UniValue command;
+        if (!command.read(strLine) || !command.isArray() || command.empty() || !command[0].isStr())
+            throw runtime_error("invalid command: " + strLine);
+        strMethod = command[0].get_str();
+        for (size_t i = 1; i < command.size(); i++)
+            params.push_back(command[i]);
+    } else {
+        std::vector<std::string> vArgs;
+        boost::split(vArgs, strLine, boost::is_any_of(" \t"), boost::token_compress_on);
+        strMethod = vArgs[0];
+        params = RPCConvertValues(strMethod, std::vector<std::string>(vArgs.begin() + 1, vArgs.end()));
+    }
+
+    UniValue request(UniValue::VOBJ);
+    request.pushKV("method", strMethod);
+    request.pushKV("params", params);
+    return request;
+}
+
+/**
+ * Send the commands of stdin in JSON-RPC batches of -batchsize, over a single keep-alive connection, and print
+ * the results in the order of the commands. The return code is the one of the first failed command.
+ */
+static int BatchRPC()
+{
+    const int nBatchSize = std::max(1, (int)GetArg("-batchsize", DEFAULT_BATCH_SIZE));
+    const bool fWait = GetBoolArg("-rpcwait", false);
+    CRPCConnection connection(true);
+    int nRet = 0;
+
+    std::string strLine;
+    bool fEOF = false;
+    while (!fEOF) {
+        UniValue batch(UniValue::VARR);
+        while (batch.size() < (size_t)nBatchSize) {
+            if (!std::getline(std::cin, strLine)) {
+                fEOF = true;
+                break;
+            }
+            boost::algorithm::trim(strLine);
+            if (strLine.empty())
+                continue;
+            UniValue request = ParseBatchLine(strLine);
+            request.pushKV("id", (int)batch.size());
+            batch.push_back(request);
+        }
+        if (batch.empty())
+            break;
+
+        UniValue replies;
+        while (true) {
+            try {
+                replies = connection.Post(batch.write());
+                break;
+            }
+            catch (const CConnectionFailed&) {
+                if (fWait)
+                    MilliSleep(1000);
+                else
+                    throw;
+            }
+        }
+        if (!replies.isArray())
+            throw runtime_error("expected a batch reply from server: " + FormatError(find_value(replies, "error")));
+
+        // the replies may come in any order
+        std::vector<UniValue> vReplies(batch.size());
+        for (size_t i = 0; i < replies.size(); i++) {
+            const UniValue& id = find_value(replies[i], "id");
+            if (!id.isNum() || id.get_int() < 0 || (size_t)id.get_int() >= vReplies.size())
+                throw runtime_error("unexpected reply id from server");
+            vReplies[id.get_int()] = replies[i];
+        }
+
+        for (const UniValue& reply : vReplies) {
+            if (!reply.isObject())
+                throw runtime_error("expected reply to have result, error and id properties");
+            const UniValue& error = find_value(reply, "error");
+            if (!error.isNull()) {
+                fflush(stdout);
+                fprintf(stderr, "%s\n", FormatError(error).c_str());
+                if (nRet == 0)
+                    nRet = error.isObject() && find_value(error, "code").isNum() ? abs(find_value(error, "code").get_int()) : EXIT_FAILURE;
+            } else {
+                std::string strPrint = FormatResult(find_value(reply, "result"));
+                if (strPrint != "")
+                    fprintf(stdout, "%s\n", strPrint.c_str());
+            }
+        }
+        fflush(stdout);
+    }
+
+    return nRet;
+}
+
 int CommandLineRPC(int argc, char *argv[])
 {
     string strPrint;
@@ -283,25 +452,11 @@ int CommandLineRPC(int argc, char *argv[])
                     int code = error["code"].get_int();
                     if (fWait && code == RPC_IN_WARMUP)
                         throw CConnectionFailed("server in warmup");
-                    strPrint = "error: " + error.write();
+                    strPrint = FormatError(error);
                     nRet = abs(code);
-                    if (error.isObject())
-                    {
-                        UniValue errCode = find_value(error, "code");
-                        UniValue errMsg  = find_value(error, "message");
-                        strPrint = errCode.isNull() ? "" : "error code: "+errCode.getValStr()+"\n";
-
-                        if (errMsg.isStr())
-                            strPrint += "error message:\n"+errMsg.get_str();
-                    }
                 } else {
                     // Result
-                    if (result.isNull())
-                        strPrint = "";
-                    else if (result.isStr())
-                        strPrint = result.get_str();
-                    else
-                        strPrint = result.write(2);
+                    strPrint = FormatResult(result);
                 }
                 // Connection succeeded, no need to retry.
                 break;
@@ -354,7 +509,15 @@ int main(int argc, char* argv[])
 
     int ret = EXIT_FAILURE;
     try {
-        ret = CommandLineRPC(argc, argv);
+        if (GetBoolArg("-batch", false)) {
+            try {
+                ret = BatchRPC();
+            }
+            catch (const std::runtime_error& e) {
+                fprintf(stderr, "error: %s\n", e.what());
+            }
+        } else
+            ret = CommandLineRPC(argc, argv);
     }
     catch (const std::exception& e) {
         PrintExceptionContinue(&e, "CommandLineRPC()");
@@ -19,6 +19,8 @@
 
 #include <stdio.h>
 
+#include <iostream>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/assign/list_of.hpp>
 
@@ -50,12 +52,17 @@ static bool AppInitRawTx(int argc, char* argv[])
             _("Usage:") + "\n" +
               "  zen-tx [options] <hex-tx> [commands]  " + _("Update hex-encoded zencash transaction") + "\n" +
               "  zen-tx [options] -create [commands]   " + _("Create hex-encoded zencash transaction") + "\n" +
+              "  zen-tx [options] -bulk [commands]     " + _("Update the transactions of the jobs read from standard input, one per line") + "\n" +
               "\n";
 
         fprintf(stdout, "%s", strUsage.c_str());
 
         strUsage = HelpMessageGroup(_("Options:"));
         strUsage += HelpMessageOpt("-?", _("This help message"));
+        strUsage += HelpMessageOpt("-bulk", _("Read the jobs from standard input, one per line, and write one result line for each, "
+            "the error message prefixed by \"error: \" for a failed job. A job is a hex-encoded transaction, or a JSON object "
+            "{\"hex\":HEX-TX,\"commands\":[COMMAND,...]}, without hex for a new, empty TX. The commands given are applied to every "
+            "job before its own ones, the registers they set being shared by the jobs"));
         strUsage += HelpMessageOpt("-create", _("Create new, empty TX."));
         strUsage += HelpMessageOpt("-json", _("Select JSON output"));
         strUsage += HelpMessageOpt("-txid", _("Output only the hex-encoded transaction id of the resultant transaction."));
@@ -494,6 +501,9 @@ public:
     }
 };
 
+//! Started once for all the jobs in bulk mode
+static boost::scoped_ptr<Secp256k1Init> eccBulk;
+
 // TODO: do we need to have prossibility to add CSW inputs and CC outputs?
 static void MutateTx(CMutableTransaction& tx, const string& command,
                      const string& commandVal)
@@ -518,7 +528,7 @@ static void MutateTx(CMutableTransaction& tx, const string& command,
         MutateTxAddOutScript(tx, commandVal);
 
     else if (command == "sign") {
-        if (!ecc) { ecc.reset(new Secp256k1Init()); }
+        if (!ecc && !eccBulk) { ecc.reset(new Secp256k1Init()); }
         MutateTxSign(tx, commandVal);
     }
 
@@ -532,12 +542,27 @@ static void MutateTx(CMutableTransaction& tx, const string& command,
         throw runtime_error("unknown command");
 }
 
-static void OutputTxJSON(const CTransaction& tx)
+// Apply a command of the KEY=VALUE form
+static void MutateTxArg(CMutableTransaction& tx, const string& arg)
+{
+    string key, value;
+    size_t eqpos = arg.find('=');
+    if (eqpos == string::npos)
+        key = arg;
+    else {
+        key = arg.substr(0, eqpos);
+        value = arg.substr(eqpos + 1);
+    }
+
+    MutateTx(tx, key, value);
+}
+
+static void OutputTxJSON(const CTransaction& tx, unsigned int nIndent)
 {
     UniValue entry(UniValue::VOBJ);
     TxToUniv(tx, uint256(), entry);
 
-    string jsonOutput = entry.write(4);
+    string jsonOutput = entry.write(nIndent);
     fprintf(stdout, "%s\n", jsonOutput.c_str());
 }
 
@@ -555,10 +580,11 @@ static void OutputTxHex(const CTransaction& tx)
     fprintf(stdout, "%s\n", strHex.c_str());
 }
 
-static void OutputTx(const CTransaction& tx)
+// The JSON is written on a single line in bulk mode, one line per job
+static void OutputTx(const CTransaction& tx, bool fBulk = false)
 {
     if (GetBoolArg("-json", false))
-        OutputTxJSON(tx);
+        OutputTxJSON(tx, fBulk ? 0 : 4);
     else if (GetBoolArg("-txid", false))
         OutputTxHash(tx);
     else
@@ -619,19 +645,8 @@ static int CommandLineRawTx(int argc, char* argv[])
 
         CMutableTransaction tx(txDecodeTmp);
 
-        for (int i = startArg; i < argc; i++) {
-            string arg = argv[i];
-            string key, value;
-            size_t eqpos = arg.find('=');
-            if (eqpos == string::npos)
-                key = arg;
-            else {
-                key = arg.substr(0, eqpos);
-                value = arg.substr(eqpos + 1);
-            }
-
-            MutateTx(tx, key, value);
-        }
+        for (int i = startArg; i < argc; i++)
+            MutateTxArg(tx, argv[i]);
 
         OutputTx(tx);
     }
@@ -654,6 +669,91 @@ static int CommandLineRawTx(int argc, char* argv[])
     return nRet;
 }
 
+static void BulkTxJob(const string& strJob, const vector<string>& vBaseCommands)
+{
+    CTransaction txDecodeTmp;
+    vector<string> vCommands(vBaseCommands);
+
+    if (strJob[0] == '{') {
+        UniValue job;
+        if (!job.read(strJob) || !job.isObject())
+            throw runtime_error("invalid job JSON");
+
+        const UniValue& hex = find_value(job, "hex");
+        if (!hex.isNull() && (!hex.isStr() || !DecodeHexTx(txDecodeTmp, hex.get_str())))
+            throw runtime_error("invalid transaction encoding");
+
+        const UniValue& commands = find_value(job, "commands");
+        if (!commands.isNull()) {
+            if (!commands.isArray())
+                throw runtime_error("job commands must be an array");
+            for (size_t i = 0; i < commands.size(); i++) {
+                if (!commands[i].isStr())
+                    throw runtime_error("job command not a string");
+                vCommands.push_back(commands[i].get_str());
+            }
+        }
+    } else if (!DecodeHexTx(txDecodeTmp, strJob))
+        throw runtime_error("invalid transaction encoding");
+
+    CMutableTransaction tx(txDecodeTmp);
+    for (const string& command : vCommands)
+        MutateTxArg(tx, command);
+
+    OutputTx(tx, true);
+}
+
+/**
+ * Process the jobs read from stdin in a single run, paying the startup and the secp256k1 context initialisation once.
+ * A job setting registers does not change them for the following ones.
+ */
+static int BulkRawTx(int argc, char* argv[])
+{
+    // Skip switches
+    while (argc > 1 && IsSwitchChar(argv[1][0])) {
+        argc--;
+        argv++;
+    }
+
+    eccBulk.reset(new Secp256k1Init());
+
+    // the register commands are applied once, the other ones to every transaction
+    vector<string> vBaseCommands;
+    CMutableTransaction txRegisters;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (boost::algorithm::starts_with(arg, "load=") || boost::algorithm::starts_with(arg, "set="))
+            MutateTxArg(txRegisters, arg);
+        else
+            vBaseCommands.push_back(arg);
+    }
+    const map<string,UniValue> baseRegisters(registers);
+
+    int nRet = 0;
+    string strJob;
+    while (std::getline(std::cin, strJob)) {
+        boost::algorithm::trim(strJob);
+        if (strJob.empty())
+            continue;
+
+        try {
+            BulkTxJob(strJob, vBaseCommands);
+        }
+        catch (const std::exception& e) {
+            fprintf(stdout, "error: %s\n", e.what());
+            nRet = EXIT_FAILURE;
+        }
+        registers = baseRegisters;
+        fflush(stdout);
+    }
+
+    eccBulk.reset();
+    if (std::cin.bad())
+        throw runtime_error("error reading stdin");
+
+    return nRet;
+}
+
 int main(int argc, char* argv[])
 {
     SetupEnvironment();
@@ -672,7 +772,10 @@ int main(int argc, char* argv[])
 
     int ret = EXIT_FAILURE;
     try {
-        ret = CommandLineRawTx(argc, argv);
+        if (GetBoolArg("-bulk", false))
+            ret = BulkRawTx(argc, argv);
+        else
+            ret = CommandLineRawTx(argc, argv);
     }
     catch (const std::exception& e) {
         PrintExceptionContinue(&e, "CommandLineRawTx()");
@@ -0,0 +1,119 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+
+#include "core_memusage.h"
+#include "primitives/block.h"
+
+CRecentBlockCache recentBlockCache(DEFAULT_BLOCK_CACHE_SIZE << 20);
+
+CRecentBlockCache::CachedBlock& CRecentBlockCache::Touch(const uint256& hash)
+{
+    AssertLockHeld(cs);
+    auto it = mapBlocks.find(hash);
+    if (it != mapBlocks.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        return *it->second;
+    }
+
+    CachedBlock entry;
+    entry.hash = hash;
+    lru.push_front(entry);
+    mapBlocks[hash] = lru.begin();
+    return lru.front();
+}
+
+void CRecentBlockCache::Evict()
+{
+    AssertLockHeld(cs);
+    // the entry just added stays, whatever its size
+    while (nBytes > nMaxBytes && lru.size() > 1) {
+        const CachedBlock& entry = lru.back();
+        nBytes -= entry.nBytes;
+        mapBlocks.erase(entry.hash);
+        lru.pop_back();
+    }
+}
+
+void CRecentBlockCache::AddBlock(const uint256& hash, const std::shared_ptr<const CBlock>& pblock)
+{
+    LOCK(cs);
+    if (nMaxBytes == 0)
+        return;
+    CachedBlock& entry = Touch(hash);
+    if (entry.block)
+        return;
+    entry.block = pblock;
+    const size_t nBlockBytes = sizeof(CBlock) + RecursiveDynamicUsage(*pblock);
+    entry.nBytes += nBlockBytes;
+    nBytes += nBlockBytes;
+    Evict();
+}
+
+void CRecentBlockCache::AddRaw(const uint256& hash, const std::shared_ptr<const std::vector<char> >& praw)
+{
+    LOCK(cs);
+    if (nMaxBytes == 0)
+        return;
+    CachedBlock& entry = Touch(hash);
+    if (entry.raw)
+        return;
+    entry.raw = praw;
+    entry.nBytes += praw->size();
+    nBytes += praw->size();
+    Evict();
+}
+
+std::shared_ptr<const CBlock> CRecentBlockCache::GetBlock(const uint256& hash)
+{
+    LOCK(cs);
+    auto it = mapBlocks.find(hash);
+    if (it == mapBlocks.end() || !it->second->block)
+        return nullptr;
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->block;
+}
+
+std::shared_ptr<const std::vector<char> > CRecentBlockCache::GetRaw(const uint256& hash)
+{
+    LOCK(cs);
+    auto it = mapBlocks.find(hash);
+    if (it == mapBlocks.end() || !it->second->raw)
+        return nullptr;
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->raw;
+}
+
+void CRecentBlockCache::Clear()
+{
+    LOCK(cs);
+    lru.clear();
+    mapBlocks.clear();
+    nBytes = 0;
+}
+
+void CRecentBlockCache::SetMaxBytes(size_t nMaxBytesIn)
+{
+    LOCK(cs);
+    nMaxBytes = nMaxBytesIn;
+    if (nMaxBytes == 0) {
+        lru.clear();
+        mapBlocks.clear();
+        nBytes = 0;
+    }
+    Evict();
+}
+
+size_t CRecentBlockCache::Size() const
+{
+    LOCK(cs);
+    return lru.size();
+}
+
+size_t CRecentBlockCache::Bytes() const
+{
+    LOCK(cs);
+    return nBytes;
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKCACHE_H
+#define BITCOIN_BLOCKCACHE_H
+
+#include "hash.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class CBlock;
+
+/** The size in MiB of the recent blocks cache, by default */
+static const unsigned int DEFAULT_BLOCK_CACHE_SIZE = 32;
+
+/**
+ * The blocks recently accepted and connected, deserialized and as their bytes on disk, shared by their readers.
+ *
+ * Just after a new tip arrives, the same blocks are asked for by the peers (getdata), the notifiers (ZMQ, AMQP),
+ * the websocket, REST, getblock and the wallet. Each would otherwise read them from disk and deserialize them,
+ * checking their Equihash solution again.
+ *
+ * The bytes are added when the block is written to disk, the block itself when it is connected; the entries are keyed
+ * by block hash, so none can be stale. The cache is bounded in bytes, the least recently used entries are evicted first.
+ */
+class CRecentBlockCache
+{
+public:
+    explicit CRecentBlockCache(size_t nMaxBytesIn) : nMaxBytes(nMaxBytesIn) {}
+
+    void AddBlock(const uint256& hash, const std::shared_ptr<const CBlock>& pblock);
+    void AddRaw(const uint256& hash, const std::shared_ptr<const std::vector<char> >& praw);
+
+    //! The block of hash if cached, null otherwise
+    std::shared_ptr<const CBlock> GetBlock(const uint256& hash);
+    //! The bytes of the block of hash if cached, null otherwise
+    std::shared_ptr<const std::vector<char> > GetRaw(const uint256& hash);
+
+    void Clear();
+    void SetMaxBytes(size_t nMaxBytesIn);
+
+    size_t Size() const;
+    size_t Bytes() const;
+
+private:
+    struct CachedBlock
+    {
+        uint256 hash;
+        std::shared_ptr<const CBlock> block;
+        std::shared_ptr<const std::vector<char> > raw;
+        size_t nBytes = 0;
+    };
+
+    mutable CCriticalSection cs;
+    size_t nMaxBytes;
+    size_t nBytes = 0;
+    //! the most recently used first
+    std::list<CachedBlock> lru;
+    std::unordered_map<uint256, std::list<CachedBlock>::iterator, ObjectHasher> mapBlocks;
+
+    //! The entry of hash, added if missing, as the most recently used
+    CachedBlock& Touch(const uint256& hash);
+    void Evict();
+};
+
+/** The recent blocks of this node */
+extern CRecentBlockCache recentBlockCache;
+
+#endif // BITCOIN_BLOCKCACHE_H
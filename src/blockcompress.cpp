@@ -0,0 +1,172 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcompress.h"
+
+#include "crypto/common.h"
+
+#include <algorithm>
+#include <string.h>
+
+/**
+ * The LZ stream is a sequence of (literals, match) pairs, each made of:
+ * - a token byte, the number of literals in the high nibble and the match length minus
+ *   MIN_MATCH in the low one, 15 meaning that more length bytes follow (255 meaning more again);
+ * - the more literals length bytes, then the literals;
+ * - the match offset (3 bytes, little endian), then the more match length bytes.
+ * The last pair has the literals only: the stream ends after them.
+ */
+namespace {
+
+const size_t HEADER_SIZE = 1 + 4;
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = (1 << 24) - 1;
+const unsigned int HASH_BITS = 16;
+
+uint32_t HashAt(const unsigned char* p)
+{
+    return (ReadLE32(p) * 2654435761U) >> (32 - HASH_BITS);
+}
+
+void WriteLength(std::vector<char>& vOut, size_t nLength)
+{
+    for (; nLength >= 255; nLength -= 255)
+        vOut.push_back((char)255);
+    vOut.push_back((char)nLength);
+}
+
+bool ReadLength(const unsigned char*& p, const unsigned char* pend, size_t& nLength)
+{
+    unsigned char c;
+    do {
+        if (p == pend)
+            return false;
+        c = *p++;
+        nLength += c;
+    } while (c == 255);
+    return true;
+}
+
+void WriteSequence(std::vector<char>& vOut, const unsigned char* pLiterals, size_t nLiterals, size_t nOffset, size_t nMatch)
+{
+    const size_t nMatchCode = nMatch > 0 ? nMatch - MIN_MATCH : 0;
+    vOut.push_back((char)((std::min(nLiterals, (size_t)15) << 4) | std::min(nMatchCode, (size_t)15)));
+    if (nLiterals >= 15)
+        WriteLength(vOut, nLiterals - 15);
+    vOut.insert(vOut.end(), (const char*)pLiterals, (const char*)pLiterals + nLiterals);
+    if (nMatch == 0)
+        return;
+    vOut.push_back((char)(nOffset & 0xff));
+    vOut.push_back((char)((nOffset >> 8) & 0xff));
+    vOut.push_back((char)((nOffset >> 16) & 0xff));
+    if (nMatchCode >= 15)
+        WriteLength(vOut, nMatchCode - 15);
+}
+
+}
+
+bool CompressBlockData(const char* pdata, size_t nSize, std::vector<char>& vOut)
+{
+    if (nSize > 0xffffffff)
+        return false;
+
+    const unsigned char* const pbegin = (const unsigned char*)pdata;
+    const unsigned char* const pend = pbegin + nSize;
+
+    vOut.clear();
+    vOut.reserve(HEADER_SIZE + nSize / 2);
+    vOut.push_back((char)BLOCK_COMPRESSION_LZ);
+    unsigned char vchSize[4];
+    WriteLE32(vchSize, (uint32_t)nSize);
+    vOut.insert(vOut.end(), (const char*)vchSize, (const char*)vchSize + 4);
+
+    // the last position where each hash of 4 bytes was seen, plus one (zero for none)
+    std::vector<uint32_t> vHashTable(1 << HASH_BITS, 0);
+
+    const unsigned char* pLiterals = pbegin;
+    const unsigned char* p = pbegin;
+    while (p + MIN_MATCH <= pend) {
+        const uint32_t nHash = HashAt(p);
+        const uint32_t nCandidate = vHashTable[nHash];
+        vHashTable[nHash] = (uint32_t)(p - pbegin) + 1;
+
+        if (nCandidate == 0) {
+            p++;
+            continue;
+        }
+        const unsigned char* pMatch = pbegin + nCandidate - 1;
+        const size_t nOffset = p - pMatch;
+        if (nOffset > MAX_OFFSET || memcmp(pMatch, p, MIN_MATCH) != 0) {
+            p++;
+            continue;
+        }
+
+        size_t nMatch = MIN_MATCH;
+        while (p + nMatch < pend && pMatch[nMatch] == p[nMatch])
+            nMatch++;
+
+        WriteSequence(vOut, pLiterals, p - pLiterals, nOffset, nMatch);
+        if (vOut.size() >= nSize)
+            return false;
+
+        // remember the positions within the match, so that the following data can refer to them
+        const unsigned char* pMatchEnd = p + nMatch;
+        for (p++; p < pMatchEnd && p + MIN_MATCH <= pend; p++)
+            vHashTable[HashAt(p)] = (uint32_t)(p - pbegin) + 1;
+        p = pMatchEnd;
+        pLiterals = p;
+    }
+    WriteSequence(vOut, pLiterals, pend - pLiterals, 0, 0);
+
+    return vOut.size() < nSize;
+}
+
+bool DecompressBlockData(const char* pdata, size_t nSize, size_t nMaxSize, std::vector<char>& vOut)
+{
+    vOut.clear();
+    if (nSize < HEADER_SIZE || pdata[0] != (char)BLOCK_COMPRESSION_LZ)
+        return false;
+
+    const unsigned char* p = (const unsigned char*)pdata + 1;
+    const unsigned char* const pend = (const unsigned char*)pdata + nSize;
+    const size_t nDecompressedSize = ReadLE32(p);
+    p += 4;
+    if (nDecompressedSize > nMaxSize)
+        return false;
+    vOut.reserve(nDecompressedSize);
+
+    while (p < pend) {
+        const unsigned char nToken = *p++;
+
+        size_t nLiterals = nToken >> 4;
+        if (nLiterals == 15 && !ReadLength(p, pend, nLiterals))
+            return false;
+        if (nLiterals > (size_t)(pend - p) || nLiterals > nDecompressedSize - vOut.size())
+            return false;
+        vOut.insert(vOut.end(), (const char*)p, (const char*)p + nLiterals);
+        p += nLiterals;
+
+        // the last sequence has no match
+        if (p == pend)
+            break;
+
+        if (pend - p < 3)
+            return false;
+        const size_t nOffset = p[0] | (p[1] << 8) | (p[2] << 16);
+        p += 3;
+        size_t nMatch = nToken & 0x0f;
+        if (nMatch == 15 && !ReadLength(p, pend, nMatch))
+            return false;
+        nMatch += MIN_MATCH;
+        if (nOffset == 0 || nOffset > vOut.size() || nMatch > nDecompressedSize - vOut.size())
+            return false;
+
+        // the match may overlap the bytes it produces
+        size_t nFrom = vOut.size() - nOffset;
+        for (size_t i = 0; i < nMatch; i++)
+            vOut.push_back(vOut[nFrom + i]);
+    }
+
+    return vOut.size() == nDecompressedSize;
+}
@@ -0,0 +1,33 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKCOMPRESS_H
+#define BITCOIN_BLOCKCOMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Compression of the block and undo records of the block files (see -compressblockfiles).
+ *
+ * The compressed data starts with the compression method and the size of the data once
+ * decompressed, so that other methods can be added while the existing records stay readable.
+ * The only method is an LZ77 variant with offsets reaching back over the whole record:
+ * certificates with many backward transfers and the repeated verification keys of
+ * sidechain creations are mostly found again earlier in the same block.
+ */
+
+enum BlockCompressionMethod
+{
+    BLOCK_COMPRESSION_LZ = 1,
+};
+
+/** Compress nSize bytes at pdata into vOut; false, with vOut unspecified, if they would not get smaller */
+bool CompressBlockData(const char* pdata, size_t nSize, std::vector<char>& vOut);
+
+/** Decompress nSize bytes at pdata into vOut; false if they are corrupt or decompress to more than nMaxSize bytes */
+bool DecompressBlockData(const char* pdata, size_t nSize, size_t nMaxSize, std::vector<char>& vOut);
+
+#endif // BITCOIN_BLOCKCOMPRESS_H
@@ -0,0 +1,198 @@
+// Copyright (c) 2016 The Bitcoin Core developers
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockencodings.h"
+
+#include "consensus/consensus.h"
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+#include "hash.h"
+#include "random.h"
+#include "streams.h"
+#include "txmempool.h"
+#include "util.h"
+
+#include <unordered_map>
+
+//! More transactions and certificates than could fit in a block
+static const size_t MAX_COMPACT_BLOCK_TX_COUNT = MAX_BLOCK_SIZE / MIN_TX_SIZE;
+
+CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block) :
+        nonce(GetRand(std::numeric_limits<uint64_t>::max())),
+        header(block.GetBlockHeader())
+{
+    FillShortTxIDSelector();
+
+    // the coinbase can not be in the mempool of the peer
+    assert(!block.vtx.empty());
+    PrefilledTransaction coinbase;
+    coinbase.index = 0;
+    coinbase.tx = block.vtx[0];
+    prefilledtxn.push_back(coinbase);
+
+    shorttxids.reserve(block.vtx.size() - 1);
+    for (size_t i = 1; i < block.vtx.size(); i++)
+        shorttxids.push_back(GetShortID(block.vtx[i].GetHash()));
+
+    shortcertids.reserve(block.vcert.size());
+    for (const CScCertificate& cert : block.vcert)
+        shortcertids.push_back(GetShortID(cert.GetHash()));
+}
+
+void CBlockHeaderAndShortTxIDs::FillShortTxIDSelector() const
+{
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << header << nonce;
+    CSHA256 hasher;
+    hasher.Write((unsigned char*)&(*stream.begin()), stream.end() - stream.begin());
+    uint256 shorttxidhash;
+    hasher.Finalize(shorttxidhash.begin());
+    shorttxidk0 = ReadLE64(shorttxidhash.begin());
+    shorttxidk1 = ReadLE64(shorttxidhash.begin() + 8);
+}
+
+uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& hash) const
+{
+    return SipHashUint256(shorttxidk0, shorttxidk1, hash) & 0xffffffffffffULL;
+}
+
+ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock)
+{
+    if (cmpctblock.header.IsNull() || cmpctblock.BlockTxCount() == 0)
+        return ReadStatus::INVALID;
+    if (cmpctblock.BlockTxCount() + cmpctblock.BlockCertCount() > MAX_COMPACT_BLOCK_TX_COUNT)
+        return ReadStatus::INVALID;
+
+    assert(header.IsNull() && txn_available.empty() && cert_available.empty());
+    header = cmpctblock.header;
+    txn_available.resize(cmpctblock.BlockTxCount());
+    cert_available.resize(cmpctblock.BlockCertCount());
+
+    int64_t nLastPrefilledIndex = -1;
+    for (const PrefilledTransaction& prefilled : cmpctblock.prefilledtxn) {
+        // the prefilled transactions come in order, and within the transactions of the block
+        if ((int64_t)prefilled.index <= nLastPrefilledIndex || prefilled.index >= txn_available.size())
+            return ReadStatus::INVALID;
+        nLastPrefilledIndex = prefilled.index;
+        txn_available[prefilled.index] = std::make_shared<const CTransaction>(prefilled.tx);
+    }
+    prefilled_count = cmpctblock.prefilledtxn.size();
+
+    // The short ids to the index in the block of their transaction or certificate: the transactions
+    // not prefilled first, in order, then the certificates
+    std::unordered_map<uint64_t, uint32_t> mapShortIDs;
+    mapShortIDs.reserve(cmpctblock.shorttxids.size() + cmpctblock.shortcertids.size());
+    uint32_t nIndexOffset = 0;
+    for (size_t i = 0; i < cmpctblock.shorttxids.size(); i++) {
+        while (txn_available[i + nIndexOffset])
+            nIndexOffset++;
+        mapShortIDs[cmpctblock.shorttxids[i]] = i + nIndexOffset;
+    }
+    for (size_t i = 0; i < cmpctblock.shortcertids.size(); i++)
+        mapShortIDs[cmpctblock.shortcertids[i]] = txn_available.size() + i;
+
+    // Two entries with the same short id can not be told apart: get the block in full. In the unlikely
+    // case the collision was by chance this only costs a round-trip, another nonce will be used next time.
+    if (mapShortIDs.size() != cmpctblock.shorttxids.size() + cmpctblock.shortcertids.size())
+        return ReadStatus::FAILED;
+
+    // An index found twice in the mempool, for different transactions, is left to be requested
+    std::vector<bool> vHaveDuplicate(GetTxCount(), false);
+    {
+        LOCK(pool->cs);
+        for (const auto& entry : pool->mapTx) {
+            std::unordered_map<uint64_t, uint32_t>::const_iterator it = mapShortIDs.find(cmpctblock.GetShortID(entry.first));
+            if (it == mapShortIDs.end() || it->second >= txn_available.size())
+                continue;
+            std::shared_ptr<const CTransaction>& txn = txn_available[it->second];
+            if (!txn && !vHaveDuplicate[it->second]) {
+                txn = entry.second.GetSharedTx();
+                mempool_count++;
+            } else if (txn && txn->GetHash() != entry.first) {
+                txn.reset();
+                vHaveDuplicate[it->second] = true;
+                mempool_count--;
+            }
+        }
+        for (const auto& entry : pool->mapCertificate) {
+            std::unordered_map<uint64_t, uint32_t>::const_iterator it = mapShortIDs.find(cmpctblock.GetShortID(entry.first));
+            if (it == mapShortIDs.end() || it->second < txn_available.size())
+                continue;
+            std::shared_ptr<const CScCertificate>& cert = cert_available[it->second - txn_available.size()];
+            if (!cert && !vHaveDuplicate[it->second]) {
+                cert = entry.second.GetSharedCertificate();
+                mempool_count++;
+            } else if (cert && cert->GetHash() != entry.first) {
+                cert.reset();
+                vHaveDuplicate[it->second] = true;
+                mempool_count--;
+            }
+        }
+    }
+
+    LogPrint("cmpctblock", "%s: block %s rebuilt with %u prefilled and %u mempool of %u transactions and certificates\n",
+             __func__, header.GetHash().ToString(), prefilled_count, mempool_count, GetTxCount());
+
+    return ReadStatus::OK;
+}
+
+bool PartiallyDownloadedBlock::IsTxAvailable(size_t index) const
+{
+    assert(!header.IsNull());
+    if (index < txn_available.size())
+        return txn_available[index] != nullptr;
+    assert(index < GetTxCount());
+    return cert_available[index - txn_available.size()] != nullptr;
+}
+
+ReadStatus PartiallyDownloadedBlock::FillBlock(CBlock& block, const std::vector<CTransaction>& vtx_missing,
+                                               const std::vector<CScCertificate>& vcert_missing)
+{
+    assert(!header.IsNull());
+    block.SetNull();
+    block.SetBlockHeader(header);
+
+    size_t nTxMissing = 0;
+    block.vtx.resize(txn_available.size());
+    for (size_t i = 0; i < txn_available.size(); i++) {
+        if (txn_available[i]) {
+            block.vtx[i] = *txn_available[i];
+        } else {
+            if (nTxMissing >= vtx_missing.size())
+                return ReadStatus::INVALID;
+            block.vtx[i] = vtx_missing[nTxMissing++];
+        }
+    }
+    size_t nCertMissing = 0;
+    block.vcert.resize(cert_available.size());
+    for (size_t i = 0; i < cert_available.size(); i++) {
+        if (cert_available[i]) {
+            block.vcert[i] = *cert_available[i];
+        } else {
+            if (nCertMissing >= vcert_missing.size())
+                return ReadStatus::INVALID;
+            block.vcert[i] = vcert_missing[nCertMissing++];
+        }
+    }
+
+    // Make sure we can't call FillBlock again
+    header.SetNull();
+    txn_available.clear();
+    cert_available.clear();
+
+    if (nTxMissing != vtx_missing.size() || nCertMissing != vcert_missing.size())
+        return ReadStatus::INVALID;
+
+    // A wrong transaction can only come from a short id collision, it is not the fault of the peer:
+    // the block is checked in full when processed
+    bool fMutated = false;
+    if (block.ComputeMerkleRoot(&fMutated) != block.hashMerkleRoot || fMutated)
+        return ReadStatus::FAILED;
+
+    LogPrint("cmpctblock", "%s: block %s completed with %u transactions and %u certificates from the peer\n",
+             __func__, block.GetHash().ToString(), vtx_missing.size(), vcert_missing.size());
+
+    return ReadStatus::OK;
+}
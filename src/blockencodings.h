@@ -0,0 +1,244 @@
+// Copyright (c) 2016 The Bitcoin Core developers
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKENCODINGS_H
+#define BITCOIN_BLOCKENCODINGS_H
+
+#include "primitives/block.h"
+#include "primitives/certificate.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+class CTxMemPool;
+
+/** The version of the compact block encoding, negotiated with "sendcmpct" */
+static const uint64_t CMPCTBLOCKS_VERSION = 1;
+
+/**
+ * A compact block refers to its transactions and certificates by 6 bytes short ids, so that a peer can
+ * rebuild it from its mempool. The ones the peer can not have, like the coinbase, are sent along.
+ *
+ * Indexes address the transactions and the certificates of a block as one sequence: the transactions
+ * first, then the certificates, as they are in the block and in its merkle tree.
+ */
+
+template <typename Stream>
+void SerializeShortIDs(Stream& s, const std::vector<uint64_t>& ids)
+{
+    WriteCompactSize(s, ids.size());
+    for (const uint64_t& id : ids) {
+        ser_writedata32(s, id & 0xffffffff);
+        ser_writedata16(s, (id >> 32) & 0xffff);
+    }
+}
+
+template <typename Stream>
+void UnserializeShortIDs(Stream& s, std::vector<uint64_t>& ids)
+{
+    uint64_t nCount = ReadCompactSize(s);
+    ids.clear();
+    while (ids.size() < nCount) {
+        // grow step by step, not trusting the count before the data is there
+        ids.reserve(std::min<uint64_t>(nCount, ids.size() + 1000));
+        uint64_t lsb = ser_readdata32(s);
+        uint64_t msb = ser_readdata16(s);
+        ids.push_back((msb << 32) | lsb);
+    }
+}
+
+/**
+ * Indexes of a block, serialized as the differences between consecutive ones minus one, so that every
+ * entry is usually a single byte.
+ */
+template <typename Stream>
+void SerializeDifferentialIndexes(Stream& s, const std::vector<uint32_t>& indexes)
+{
+    WriteCompactSize(s, indexes.size());
+    for (size_t i = 0; i < indexes.size(); i++)
+        WriteCompactSize(s, indexes[i] - (i == 0 ? 0 : (indexes[i - 1] + 1)));
+}
+
+template <typename Stream>
+void UnserializeDifferentialIndexes(Stream& s, std::vector<uint32_t>& indexes)
+{
+    uint64_t nCount = ReadCompactSize(s);
+    indexes.clear();
+    uint64_t nOffset = 0;
+    while (indexes.size() < nCount) {
+        uint64_t nIndex = ReadCompactSize(s) + nOffset;
+        if (nIndex > std::numeric_limits<uint32_t>::max())
+            throw std::ios_base::failure("index overflowed 32 bits");
+        indexes.push_back(nIndex);
+        nOffset = nIndex + 1;
+    }
+}
+
+/** A transaction sent along with a compact block, with its index in the block */
+struct PrefilledTransaction
+{
+    uint32_t index;
+    CTransaction tx;
+
+    // the index is a compact size, so the reading and the writing can not share a SerializationOp
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return GetSizeOfCompactSize(index) + ::GetSerializeSize(tx, nType, nVersion);
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        WriteCompactSize(s, index);
+        ::Serialize(s, tx, nType, nVersion);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        uint64_t nIndex = ReadCompactSize(s);
+        if (nIndex > std::numeric_limits<uint32_t>::max())
+            throw std::ios_base::failure("index overflowed 32 bits");
+        index = nIndex;
+        ::Unserialize(s, tx, nType, nVersion);
+    }
+};
+
+enum class ReadStatus
+{
+    OK,
+    INVALID, //! the peer sent something invalid
+    FAILED,  //! the block can not be rebuilt, it has to be downloaded in full
+};
+
+class CBlockHeaderAndShortTxIDs
+{
+private:
+    mutable uint64_t shorttxidk0, shorttxidk1;
+    uint64_t nonce;
+
+    void FillShortTxIDSelector() const;
+
+    friend class PartiallyDownloadedBlock;
+
+protected:
+    //! the short ids of the transactions not prefilled, in order
+    std::vector<uint64_t> shorttxids;
+    std::vector<PrefilledTransaction> prefilledtxn;
+    //! the short ids of all the certificates, in order
+    std::vector<uint64_t> shortcertids;
+
+public:
+    CBlockHeader header;
+
+    // Dummy for deserialization
+    CBlockHeaderAndShortTxIDs() {}
+
+    //! The compact block of block, with its coinbase prefilled
+    explicit CBlockHeaderAndShortTxIDs(const CBlock& block);
+
+    uint64_t GetShortID(const uint256& hash) const;
+
+    size_t BlockTxCount() const { return shorttxids.size() + prefilledtxn.size(); }
+    size_t BlockCertCount() const { return shortcertids.size(); }
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        CSizeComputer s(nType, nVersion);
+        Serialize(s, nType, nVersion);
+        return s.size();
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        ::Serialize(s, header, nType, nVersion);
+        ::Serialize(s, nonce, nType, nVersion);
+        SerializeShortIDs(s, shorttxids);
+        ::Serialize(s, prefilledtxn, nType, nVersion);
+        SerializeShortIDs(s, shortcertids);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        ::Unserialize(s, header, nType, nVersion);
+        ::Unserialize(s, nonce, nType, nVersion);
+        UnserializeShortIDs(s, shorttxids);
+        ::Unserialize(s, prefilledtxn, nType, nVersion);
+        UnserializeShortIDs(s, shortcertids);
+        FillShortTxIDSelector();
+    }
+};
+
+/** "getblocktxn": the transactions and certificates of a compact block a peer could not find */
+class BlockTransactionsRequest
+{
+public:
+    uint256 blockhash;
+    std::vector<uint32_t> indexes;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        CSizeComputer s(nType, nVersion);
+        Serialize(s, nType, nVersion);
+        return s.size();
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        ::Serialize(s, blockhash, nType, nVersion);
+        SerializeDifferentialIndexes(s, indexes);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        ::Unserialize(s, blockhash, nType, nVersion);
+        UnserializeDifferentialIndexes(s, indexes);
+    }
+};
+
+/** "blocktxn": the answer to a "getblocktxn", in the order of the requested indexes */
+class BlockTransactions
+{
+public:
+    uint256 blockhash;
+    std::vector<CTransaction> txn;
+    std::vector<CScCertificate> certs;
+
+    BlockTransactions() {}
+    explicit BlockTransactions(const BlockTransactionsRequest& req) : blockhash(req.blockhash) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(blockhash);
+        READWRITE(txn);
+        READWRITE(certs);
+    }
+};
+
+/** A block being rebuilt from a compact block, the mempool and then the missing transactions and certificates */
+class PartiallyDownloadedBlock
+{
+protected:
+    std::vector<std::shared_ptr<const CTransaction> > txn_available;
+    std::vector<std::shared_ptr<const CScCertificate> > cert_available;
+    size_t prefilled_count = 0, mempool_count = 0;
+    CTxMemPool* pool;
+
+public:
+    CBlockHeader header;
+
+    explicit PartiallyDownloadedBlock(CTxMemPool* poolIn) : pool(poolIn) {}
+
+    ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock);
+    //! Whether the transaction or certificate at index of the block is already there
+    bool IsTxAvailable(size_t index) const;
+    size_t GetTxCount() const { return txn_available.size() + cert_available.size(); }
+    /**
+     * Complete the block with the missing transactions and certificates, in order. FAILED if the block
+     * does not match its merkle root, probably because of a short id collision.
+     */
+    ReadStatus FillBlock(CBlock& block, const std::vector<CTransaction>& vtx_missing, const std::vector<CScCertificate>& vcert_missing);
+};
+
+#endif // BITCOIN_BLOCKENCODINGS_H
@@ -0,0 +1,87 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+
+#include "util.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CMappedFile::~CMappedFile()
+{
+#ifndef WIN32
+    munmap(const_cast<char*>(pdata), nSize);
+#endif
+}
+
+std::shared_ptr<const CMappedFile> CMappedFile::Map(const boost::filesystem::path& path)
+{
+#ifndef WIN32
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1)
+        return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps the file referenced
+    close(fd);
+    if (p == MAP_FAILED) {
+        LogPrint("db", "%s():%d - unable to map %s\n", __func__, __LINE__, path.string());
+        return nullptr;
+    }
+    // the blocks are mostly read whole, and served in sequence to the syncing peers
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+    return std::shared_ptr<const CMappedFile>(new CMappedFile(static_cast<const char*>(p), st.st_size));
+#else
+    return nullptr;
+#endif
+}
+
+std::shared_ptr<const CMappedFile> CBlockFileMapper::Get(const boost::filesystem::path& path, size_t nEnd)
+{
+    LOCK(cs);
+    const std::string strPath = path.string();
+    auto it = mapFiles.find(strPath);
+    if (it == mapFiles.end() || it->second.file->size() < nEnd) {
+        std::shared_ptr<const CMappedFile> file = CMappedFile::Map(path);
+        if (!file || file->size() < nEnd)
+            return nullptr;
+
+        if (it == mapFiles.end()) {
+            if (mapFiles.size() >= nMaxFiles) {
+                auto itOldest = mapFiles.begin();
+                for (auto itEntry = mapFiles.begin(); itEntry != mapFiles.end(); ++itEntry)
+                    if (itEntry->second.nLastUse < itOldest->second.nLastUse)
+                        itOldest = itEntry;
+                mapFiles.erase(itOldest);
+            }
+            it = mapFiles.insert(std::make_pair(strPath, MappedEntry())).first;
+        }
+        it->second.file = file;
+    }
+    it->second.nLastUse = ++nUseCounter;
+    return it->second.file;
+}
+
+void CBlockFileMapper::Forget(const boost::filesystem::path& path)
+{
+    LOCK(cs);
+    mapFiles.erase(path.string());
+}
+
+void CBlockFileMapper::Clear()
+{
+    LOCK(cs);
+    mapFiles.clear();
+}
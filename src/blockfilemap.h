@@ -0,0 +1,120 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILEMAP_H
+#define BITCOIN_BLOCKFILEMAP_H
+
+#include "sync.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+/**
+ * A read-only memory mapping of a whole file, unmapped when the last reference to it goes away.
+ * The file must only ever be appended to while mapped: the mapped bytes never change.
+ */
+class CMappedFile
+{
+private:
+    const char* pdata;
+    size_t nSize;
+
+    CMappedFile(const char* pdataIn, size_t nSizeIn) : pdata(pdataIn), nSize(nSizeIn) {}
+    CMappedFile(const CMappedFile&) = delete;
+    CMappedFile& operator=(const CMappedFile&) = delete;
+
+public:
+    ~CMappedFile();
+
+    //! Map the file, null if it can't be mapped (e.g. missing, empty, or not supported on this platform)
+    static std::shared_ptr<const CMappedFile> Map(const boost::filesystem::path& path);
+
+    const char* data() const { return pdata; }
+    size_t size() const { return nSize; }
+};
+
+/**
+ * The serialized bytes of a block, as stored in its block file (see ReadRawBlockFromDisk): in the
+ * mapped file when it is, otherwise read into a buffer. It serializes as these bytes, so that it
+ * can be relayed or returned without deserializing the whole block.
+ */
+class CRawBlock
+{
+public:
+    //! The mapped block file holding the bytes, kept mapped as long as they are used
+    std::shared_ptr<const CMappedFile> file;
+    //! The bytes read from the block file, when not mapped
+    std::vector<char> vBuffer;
+    //! The bytes of a block kept in memory since it was accepted, shared with their other readers (see GetRawBlock)
+    std::shared_ptr<const std::vector<char> > shared;
+    const char* pdata;
+    size_t nSize;
+
+    CRawBlock() { SetNull(); }
+
+    void SetNull()
+    {
+        file.reset();
+        vBuffer.clear();
+        shared.reset();
+        pdata = nullptr;
+        nSize = 0;
+    }
+
+    const char* begin() const { return pdata; }
+    const char* end() const { return pdata + nSize; }
+    size_t size() const { return nSize; }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        return nSize;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        if (nSize > 0)
+            s.write(pdata, nSize);
+    }
+};
+
+/**
+ * Cache of the memory mapped block (blk) and undo (rev) files, see ReadBlockFromDisk.
+ * The least recently used mappings are dropped beyond the maximum number of files, those
+ * still referenced by a reader are only unmapped once it is done with them.
+ */
+class CBlockFileMapper
+{
+private:
+    struct MappedEntry
+    {
+        std::shared_ptr<const CMappedFile> file;
+        uint64_t nLastUse;
+    };
+
+    mutable CCriticalSection cs;
+    std::map<std::string, MappedEntry> mapFiles;
+    const size_t nMaxFiles;
+    uint64_t nUseCounter;
+
+public:
+    explicit CBlockFileMapper(size_t nMaxFilesIn) : nMaxFiles(nMaxFilesIn), nUseCounter(0) {}
+
+    /** The mapping of the file covering at least its first nEnd bytes, mapped again if the file grew; null if the file is shorter */
+    std::shared_ptr<const CMappedFile> Get(const boost::filesystem::path& path, size_t nEnd);
+
+    //! Drop the mapping of the file, e.g. when it is deleted
+    void Forget(const boost::filesystem::path& path);
+
+    //! Drop all the mappings
+    void Clear();
+};
+
+#endif // BITCOIN_BLOCKFILEMAP_H
@@ -0,0 +1,358 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+
+#include "crypto/common.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "script/script.h"
+#include "streams.h"
+#include "undo.h"
+#include "version.h"
+
+#include <algorithm>
+#include <ios>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+//! The parameters of the basic filter, BIP 158
+const uint8_t BASIC_FILTER_P = 19;
+const uint32_t BASIC_FILTER_M = 784931;
+
+const std::string BASIC_FILTER_NAME = "basic";
+const std::string UNKNOWN_FILTER_NAME = "";
+
+/** Writes a stream of bits, the most significant first */
+class BitStreamWriter
+{
+public:
+    explicit BitStreamWriter(std::vector<unsigned char>& outIn) : out(outIn), buffer(0), offset(0) {}
+
+    //! Write the nBits (up to 64) least significant bits of data
+    void Write(uint64_t data, int nBits)
+    {
+        while (nBits > 0) {
+            const int bits = std::min(8 - offset, nBits);
+            buffer |= (data << (64 - nBits)) >> (64 - 8 + offset);
+            offset += bits;
+            nBits -= bits;
+            if (offset == 8)
+                Flush();
+        }
+    }
+
+    //! Write the bits buffered, padding the last byte with zeroes
+    void Flush()
+    {
+        if (offset == 0)
+            return;
+        out.push_back(buffer);
+        buffer = 0;
+        offset = 0;
+    }
+
+private:
+    std::vector<unsigned char>& out;
+    uint8_t buffer;
+    int offset;
+};
+
+/** Reads a stream of bits, the most significant first */
+class BitStreamReader
+{
+public:
+    BitStreamReader(const std::vector<unsigned char>& inIn, size_t posIn) : in(inIn), pos(posIn), buffer(0), offset(8) {}
+
+    //! Read nBits (up to 64) bits, throwing std::ios_base::failure past the end of the data
+    uint64_t Read(int nBits)
+    {
+        uint64_t data = 0;
+        while (nBits > 0) {
+            if (offset == 8) {
+                if (pos >= in.size())
+                    throw std::ios_base::failure("GCSFilter: end of data");
+                buffer = in[pos++];
+                offset = 0;
+            }
+            const int bits = std::min(8 - offset, nBits);
+            data <<= bits;
+            data |= static_cast<uint8_t>(buffer << offset) >> (8 - bits);
+            offset += bits;
+            nBits -= bits;
+        }
+        return data;
+    }
+
+private:
+    const std::vector<unsigned char>& in;
+    size_t pos;
+    uint8_t buffer;
+    int offset;
+};
+
+void GolombRiceEncode(BitStreamWriter& writer, uint8_t nP, uint64_t x)
+{
+    // the quotient in unary, as ones terminated by a zero, then the remainder in nP bits
+    uint64_t q = x >> nP;
+    while (q > 0) {
+        const int nBits = q <= 64 ? static_cast<int>(q) : 64;
+        writer.Write(~0ULL, nBits);
+        q -= nBits;
+    }
+    writer.Write(0, 1);
+    writer.Write(x, nP);
+}
+
+uint64_t GolombRiceDecode(BitStreamReader& reader, uint8_t nP)
+{
+    uint64_t q = 0;
+    while (reader.Read(1) == 1)
+        ++q;
+    const uint64_t r = reader.Read(nP);
+    return (q << nP) + r;
+}
+
+//! (x * n) >> 64, mapping a uniform 64 bit x into [0, n) without a division
+uint64_t MapIntoRange(uint64_t x, uint64_t n)
+{
+#ifdef __SIZEOF_INT128__
+    return (static_cast<unsigned __int128>(x) * static_cast<unsigned __int128>(n)) >> 64;
+#else
+    const uint64_t xHi = x >> 32, xLo = x & 0xFFFFFFFF;
+    const uint64_t nHi = n >> 32, nLo = n & 0xFFFFFFFF;
+    const uint64_t hiHi = xHi * nHi, hiLo = xHi * nLo, loHi = xLo * nHi, loLo = xLo * nLo;
+    const uint64_t mid = (loLo >> 32) + (hiLo & 0xFFFFFFFF) + (loHi & 0xFFFFFFFF);
+    return hiHi + (hiLo >> 32) + (loHi >> 32) + (mid >> 32);
+#endif
+}
+
+//! The position of the coded differences in an encoding, after N
+size_t DecodeN(const std::vector<unsigned char>& encoded, uint64_t& nN)
+{
+    // a CompactSize takes 9 bytes at most
+    const size_t nPrefix = std::min(encoded.size(), (size_t)9);
+    CDataStream stream((const char*)encoded.data(), (const char*)encoded.data() + nPrefix, SER_NETWORK, PROTOCOL_VERSION);
+    nN = ReadCompactSize(stream);
+    return nPrefix - stream.size();
+}
+
+void AddScript(GCSFilter::ElementSet& elements, const CScript& script)
+{
+    if (script.empty() || script[0] == OP_RETURN)
+        return;
+    elements.emplace(script.begin(), script.end());
+}
+
+void AddHash(GCSFilter::ElementSet& elements, const uint256& hash)
+{
+    elements.emplace(hash.begin(), hash.end());
+}
+
+GCSFilter::ElementSet BasicFilterElements(const CBlock& block, const CBlockUndo& blockUndo)
+{
+    GCSFilter::ElementSet elements;
+
+    for (const CTransaction& tx : block.vtx) {
+        for (const CTxOut& txout : tx.GetVout())
+            AddScript(elements, txout.scriptPubKey);
+
+        for (unsigned int pos = 0; pos < tx.GetVscCcOut().size(); ++pos)
+            AddHash(elements, tx.GetScIdFromScCcOut(pos));
+        for (const CTxForwardTransferOut& ft : tx.GetVftCcOut())
+            AddHash(elements, ft.GetScId());
+        for (const CBwtRequestOut& bwtr : tx.GetVBwtRequestOut())
+            AddHash(elements, bwtr.GetScId());
+        for (const CTxCeasedSidechainWithdrawalInput& csw : tx.GetVcswCcIn()) {
+            AddHash(elements, csw.scId);
+            const std::vector<unsigned char>& nullifier = csw.nullifier.GetByteArray();
+            elements.emplace(nullifier.begin(), nullifier.end());
+        }
+    }
+
+    for (const CScCertificate& cert : block.vcert) {
+        // the backward transfers too, they are outputs of the certificate
+        for (const CTxOut& txout : cert.GetVout())
+            AddScript(elements, txout.scriptPubKey);
+        AddHash(elements, cert.GetScId());
+    }
+
+    // the outputs spent by the transactions but the coinbase, then by the certificates
+    for (const CTxUndo& txundo : blockUndo.vtxundo) {
+        for (const CTxInUndo& prevout : txundo.vprevout)
+            AddScript(elements, prevout.txout.scriptPubKey);
+    }
+
+    return elements;
+}
+
+} // anon namespace
+
+GCSFilter::GCSFilter(const Params& paramsIn) : params(paramsIn), nN(0), nF(0)
+{
+    // the encoding of the empty set, N = 0
+    encoded.push_back(0);
+}
+
+GCSFilter::GCSFilter(const Params& paramsIn, std::vector<unsigned char> encodedIn) :
+    params(paramsIn), encoded(std::move(encodedIn))
+{
+    uint64_t n = 0;
+    const size_t pos = DecodeN(encoded, n);
+    if (n > std::numeric_limits<uint32_t>::max())
+        throw std::ios_base::failure("GCSFilter: N must be < 2^32");
+    nN = static_cast<uint32_t>(n);
+    nF = static_cast<uint64_t>(nN) * params.nM;
+
+    // decode the whole set, for the encoding not to have less elements than N
+    BitStreamReader reader(encoded, pos);
+    for (uint32_t i = 0; i < nN; ++i)
+        GolombRiceDecode(reader, params.nP);
+}
+
+GCSFilter::GCSFilter(const Params& paramsIn, const ElementSet& elements) : params(paramsIn)
+{
+    if (elements.size() > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("GCSFilter: N must be < 2^32");
+    nN = static_cast<uint32_t>(elements.size());
+    nF = static_cast<uint64_t>(nN) * params.nM;
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    WriteCompactSize(stream, nN);
+    encoded.assign(stream.begin(), stream.end());
+    if (elements.empty())
+        return;
+
+    // about P + 2 bits per element
+    encoded.reserve(encoded.size() + (static_cast<size_t>(nN) * (params.nP + 2) + 7) / 8);
+    BitStreamWriter writer(encoded);
+    uint64_t lastValue = 0;
+    for (uint64_t value : BuildHashedSet(elements)) {
+        GolombRiceEncode(writer, params.nP, value - lastValue);
+        lastValue = value;
+    }
+    writer.Flush();
+}
+
+uint64_t GCSFilter::HashToRange(const Element& element) const
+{
+    const uint64_t hash = CSipHasher(params.nSipHashK0, params.nSipHashK1).Write(element.data(), element.size()).Finalize();
+    return MapIntoRange(hash, nF);
+}
+
+std::vector<uint64_t> GCSFilter::BuildHashedSet(const ElementSet& elements) const
+{
+    std::vector<uint64_t> hashedElements;
+    hashedElements.reserve(elements.size());
+    for (const Element& element : elements)
+        hashedElements.push_back(HashToRange(element));
+    std::sort(hashedElements.begin(), hashedElements.end());
+    return hashedElements;
+}
+
+bool GCSFilter::MatchInternal(const uint64_t* elementHashes, size_t size) const
+{
+    uint64_t n = 0;
+    BitStreamReader reader(encoded, DecodeN(encoded, n));
+
+    // walk the sorted set and the sorted query together
+    uint64_t value = 0;
+    size_t hashesIndex = 0;
+    for (uint32_t i = 0; i < nN; ++i) {
+        value += GolombRiceDecode(reader, params.nP);
+
+        while (true) {
+            if (hashesIndex == size)
+                return false;
+            if (elementHashes[hashesIndex] == value)
+                return true;
+            if (elementHashes[hashesIndex] > value)
+                break;
+            hashesIndex++;
+        }
+    }
+    return false;
+}
+
+bool GCSFilter::Match(const Element& element) const
+{
+    if (nN == 0)
+        return false;
+    const uint64_t query = HashToRange(element);
+    return MatchInternal(&query, 1);
+}
+
+bool GCSFilter::MatchAny(const ElementSet& elements) const
+{
+    if (nN == 0 || elements.empty())
+        return false;
+    const std::vector<uint64_t> queries = BuildHashedSet(elements);
+    return MatchInternal(queries.data(), queries.size());
+}
+
+const std::string& BlockFilterTypeName(BlockFilterType filterType)
+{
+    switch (filterType) {
+    case BlockFilterType::BASIC:
+        return BASIC_FILTER_NAME;
+    default:
+        return UNKNOWN_FILTER_NAME;
+    }
+}
+
+bool BlockFilterTypeByName(const std::string& name, BlockFilterType& filterType)
+{
+    if (name == BASIC_FILTER_NAME) {
+        filterType = BlockFilterType::BASIC;
+        return true;
+    }
+    return false;
+}
+
+BlockFilter::BlockFilter(BlockFilterType filterTypeIn, const uint256& blockHashIn, std::vector<unsigned char> filterIn) :
+    filterType(filterTypeIn), blockHash(blockHashIn)
+{
+    GCSFilter::Params params;
+    if (!BuildParams(params))
+        throw std::invalid_argument("BlockFilter: unknown filter type");
+    filter = GCSFilter(params, std::move(filterIn));
+}
+
+BlockFilter::BlockFilter(BlockFilterType filterTypeIn, const CBlock& block, const CBlockUndo& blockUndo) :
+    filterType(filterTypeIn), blockHash(block.GetHash())
+{
+    GCSFilter::Params params;
+    if (!BuildParams(params))
+        throw std::invalid_argument("BlockFilter: unknown filter type");
+    filter = GCSFilter(params, BasicFilterElements(block, blockUndo));
+}
+
+bool BlockFilter::BuildParams(GCSFilter::Params& params) const
+{
+    switch (filterType) {
+    case BlockFilterType::BASIC:
+        // keyed with the first 16 bytes of the block hash
+        params.nSipHashK0 = ReadLE64(blockHash.begin());
+        params.nSipHashK1 = ReadLE64(blockHash.begin() + 8);
+        params.nP = BASIC_FILTER_P;
+        params.nM = BASIC_FILTER_M;
+        return true;
+    default:
+        return false;
+    }
+}
+
+uint256 BlockFilter::GetHash() const
+{
+    const std::vector<unsigned char>& data = GetEncodedFilter();
+    return Hash(data.begin(), data.end());
+}
+
+uint256 BlockFilter::ComputeHeader(const uint256& prevHeader) const
+{
+    const uint256 filterHash = GetHash();
+    return Hash(filterHash.begin(), filterHash.end(), prevHeader.begin(), prevHeader.end());
+}
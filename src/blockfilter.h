@@ -0,0 +1,121 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILTER_H
+#define BITCOIN_BLOCKFILTER_H
+
+#include "uint256.h"
+
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class CBlock;
+class CBlockUndo;
+
+/**
+ * Golomb-coded set, the compact probabilistic set of byte strings of BIP 158.
+ *
+ * The elements are hashed with SipHash into [0, N * M), sorted, and the differences between consecutive hashes are
+ * Golomb-Rice coded with parameter P. An element not in the set matches with a probability of about 1 / M.
+ * The encoding is the CompactSize N followed by the coded differences.
+ */
+class GCSFilter
+{
+public:
+    typedef std::vector<unsigned char> Element;
+    typedef std::set<Element> ElementSet;
+
+    struct Params
+    {
+        uint64_t nSipHashK0;
+        uint64_t nSipHashK1;
+        uint8_t nP;  /**< Golomb-Rice coding parameter */
+        uint32_t nM; /**< inverse false positive rate */
+
+        Params(uint64_t nSipHashK0In = 0, uint64_t nSipHashK1In = 0, uint8_t nPIn = 0, uint32_t nMIn = 1) :
+            nSipHashK0(nSipHashK0In), nSipHashK1(nSipHashK1In), nP(nPIn), nM(nMIn) {}
+    };
+
+    //! The empty set
+    explicit GCSFilter(const Params& params = Params());
+
+    //! The set of an encoding, throwing std::ios_base::failure if malformed
+    GCSFilter(const Params& params, std::vector<unsigned char> encodedIn);
+
+    GCSFilter(const Params& params, const ElementSet& elements);
+
+    uint32_t GetN() const { return nN; }
+    const Params& GetParams() const { return params; }
+    const std::vector<unsigned char>& GetEncoded() const { return encoded; }
+
+    //! Whether element may be in the set, false positives happen with probability 1 / M
+    bool Match(const Element& element) const;
+
+    //! Whether any of elements may be in the set, decoding the set only once
+    bool MatchAny(const ElementSet& elements) const;
+
+private:
+    Params params;
+    uint32_t nN;  /**< the number of elements */
+    uint64_t nF;  /**< the range of the hashes, N * M */
+    std::vector<unsigned char> encoded;
+
+    uint64_t HashToRange(const Element& element) const;
+    std::vector<uint64_t> BuildHashedSet(const ElementSet& elements) const;
+    bool MatchInternal(const uint64_t* elementHashes, size_t size) const;
+};
+
+enum class BlockFilterType : uint8_t
+{
+    BASIC = 0,
+    INVALID = 255,
+};
+
+//! The name of a filter type, as used by REST, empty for an unknown type
+const std::string& BlockFilterTypeName(BlockFilterType filterType);
+
+//! The filter type of a name, false if unknown
+bool BlockFilterTypeByName(const std::string& name, BlockFilterType& filterType);
+
+/**
+ * The compact filter of a block, BIP 157/158, for light clients to find the blocks of interest to them.
+ *
+ * The basic filter has the scripts of the outputs of the transactions and certificates of the block, but the empty and
+ * the OP_RETURN ones, and the scripts of the outputs they spend, as BIP 158; and the sidechain data light clients and
+ * sidechain connectors track: the ids of the sidechains created, funded by forward transfers, asked backward transfers
+ * or certified in the block, and the sidechain ids and nullifiers of the ceased sidechain withdrawals.
+ */
+class BlockFilter
+{
+public:
+    BlockFilter() : filterType(BlockFilterType::INVALID) {}
+
+    //! The filter of a block from its encoding, throwing std::ios_base::failure if malformed
+    BlockFilter(BlockFilterType filterTypeIn, const uint256& blockHashIn, std::vector<unsigned char> filterIn);
+
+    //! The filter of a block, with the undo data of its transactions and certificates
+    BlockFilter(BlockFilterType filterTypeIn, const CBlock& block, const CBlockUndo& blockUndo);
+
+    BlockFilterType GetFilterType() const { return filterType; }
+    const uint256& GetBlockHash() const { return blockHash; }
+    const GCSFilter& GetFilter() const { return filter; }
+    const std::vector<unsigned char>& GetEncodedFilter() const { return filter.GetEncoded(); }
+
+    //! The double SHA256 of the encoded filter
+    uint256 GetHash() const;
+
+    //! The filter header, committing to the filter and to the header of the filter of the previous block
+    uint256 ComputeHeader(const uint256& prevHeader) const;
+
+private:
+    BlockFilterType filterType;
+    uint256 blockHash;
+    GCSFilter filter;
+
+    bool BuildParams(GCSFilter::Params& params) const;
+};
+
+#endif // BITCOIN_BLOCKFILTER_H
@@ -0,0 +1,73 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilterindexer.h"
+
+#include "blockfilter.h"
+#include "main.h"
+#include "txdb.h"
+#include "undo.h"
+#include "util.h"
+
+//! Name of the block database string holding the hash of the last block of the block filter index
+static const std::string BLOCK_FILTER_INDEX_BEST = "blockfilterindexbest";
+
+CBlockFilterIndexer* pBlockFilterIndexer = NULL;
+
+CBlockFilterIndexer::CBlockFilterIndexer() : CBaseIndexer("block filter", BLOCK_FILTER_INDEX_BEST, "horizen-bfindex")
+{
+}
+
+bool CBlockFilterIndexer::ResetProgress()
+{
+    return CBaseIndexer::ResetProgress(BLOCK_FILTER_INDEX_BEST);
+}
+
+bool CBlockFilterIndexer::LookupFilter(const uint256& blockHash, std::vector<unsigned char>& filter)
+{
+    return pblocktree->ReadBlockFilter(blockHash, filter);
+}
+
+bool CBlockFilterIndexer::LookupFilterHeader(const uint256& blockHash, uint256& filterHash, uint256& filterHeader)
+{
+    return pblocktree->ReadBlockFilterHeader(blockHash, filterHash, filterHeader);
+}
+
+bool CBlockFilterIndexer::LoadBlock(const CBlockIndex* pindex)
+{
+    uint256 filterHash;
+    headerBest.SetNull();
+    return pblocktree->ReadBlockFilterHeader(pindex->GetBlockHash(), filterHash, headerBest);
+}
+
+bool CBlockFilterIndexer::WriteBlock(const CBlockIndex* pindex)
+{
+    CDiskBlockPos blockPos, undoPos;
+    {
+        LOCK(cs_main);
+        blockPos = pindex->GetBlockPos();
+        undoPos = pindex->GetUndoPos();
+    }
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, blockPos) || block.GetHash() != pindex->GetBlockHash())
+        return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+
+    CBlockUndo blockUndo(block.nVersion == BLOCK_VERSION_SC_SUPPORT ? IncludeScAttributes::ON : IncludeScAttributes::OFF);
+    if (pindex->pprev != NULL) {
+        if (undoPos.IsNull() || !UndoReadFromDisk(blockUndo, undoPos, pindex->pprev->GetBlockHash()))
+            return error("%s: failed to read the undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+    }
+    // one entry for each transaction but the coinbase, and for each certificate
+    if (blockUndo.vtxundo.size() != block.vtx.size() - 1 + block.vcert.size())
+        return error("%s: the undo data do not match block %s", __func__, pindex->GetBlockHash().ToString());
+
+    const BlockFilter filter(BlockFilterType::BASIC, block, blockUndo);
+    const uint256 header = filter.ComputeHeader(pindex->pprev != NULL ? headerBest : uint256());
+    if (!pblocktree->WriteBlockFilterIndex(pindex->GetBlockHash(), filter.GetHash(), header, filter.GetEncodedFilter()))
+        return error("%s: failed to write block filter index", __func__);
+
+    headerBest = header;
+    return true;
+}
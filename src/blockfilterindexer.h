@@ -0,0 +1,46 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKFILTERINDEXER_H
+#define BITCOIN_BLOCKFILTERINDEXER_H
+
+#include "indexer.h"
+#include "uint256.h"
+
+#include <vector>
+
+/**
+ * Builds the index of the basic compact filters of the blocks, BIP 157/158, in the background, see CBaseIndexer.
+ *
+ * The filter of a block is built from the block and its undo data, and kept with its hash and its header, so that
+ * the filters and the headers are served to the light clients by a lookup, whatever the number of peers.
+ */
+class CBlockFilterIndexer : public CBaseIndexer
+{
+public:
+    CBlockFilterIndexer();
+    ~CBlockFilterIndexer() { Stop(); }
+
+    //! Forget the block the index is synced to, for it to be built from the genesis when (re)enabled
+    static bool ResetProgress();
+
+    //! The encoded filter of a block, false if it is not indexed (yet)
+    static bool LookupFilter(const uint256& blockHash, std::vector<unsigned char>& filter);
+
+    //! The hash and the header of the filter of a block, false if it is not indexed (yet)
+    static bool LookupFilterHeader(const uint256& blockHash, uint256& filterHash, uint256& filterHeader);
+
+protected:
+    bool LoadBlock(const CBlockIndex* pindex) override;
+    bool WriteBlock(const CBlockIndex* pindex) override;
+
+private:
+    //! The filter header of the last block indexed, only accessed by the indexer thread once started
+    uint256 headerBest;
+};
+
+/** The block filter indexer, running if -blockfilterindex is enabled */
+extern CBlockFilterIndexer* pBlockFilterIndexer;
+
+#endif // BITCOIN_BLOCKFILTERINDEXER_H
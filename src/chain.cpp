@@ -4,11 +4,52 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chain.h"
+#include "main.h"
+#include "txdb.h"
 
+#include <list>
+#include <map>
 #include <stdexcept>
 
 using namespace std;
 
+namespace {
+
+//! Enough solutions for the longest headers replies, see MAX_HEADERS_RESULTS
+const size_t MAX_SOLUTION_CACHE_SIZE = 2000;
+
+//! The solutions recently read back from the block tree db, the most recently used first
+std::list<std::pair<uint256, std::vector<unsigned char>>> lruSolutions GUARDED_BY(cs_main);
+std::map<uint256, std::list<std::pair<uint256, std::vector<unsigned char>>>::iterator> mapSolutions GUARDED_BY(cs_main);
+
+}
+
+std::vector<unsigned char> CBlockIndex::GetSolution() const
+{
+    if (HasSolution())
+        return nSolution;
+
+    AssertLockHeld(cs_main);
+    const uint256 hash = GetBlockHash();
+    auto it = mapSolutions.find(hash);
+    if (it != mapSolutions.end()) {
+        lruSolutions.splice(lruSolutions.begin(), lruSolutions, it->second);
+        return it->second->second;
+    }
+
+    CDiskBlockIndex dbindex;
+    if (pblocktree == nullptr || !pblocktree->ReadDiskBlockIndex(hash, dbindex))
+        throw std::runtime_error(strprintf("%s: failed to read the index entry of block %s", __func__, hash.ToString()));
+
+    lruSolutions.emplace_front(hash, dbindex.nSolution);
+    mapSolutions[hash] = lruSolutions.begin();
+    if (lruSolutions.size() > MAX_SOLUTION_CACHE_SIZE) {
+        mapSolutions.erase(lruSolutions.back().first);
+        lruSolutions.pop_back();
+    }
+    return dbindex.nSolution;
+}
+
 /**
  * CChain implementation
  */
@@ -43,11 +84,28 @@ CBlockLocator CChain::GetLocator(const CBlockIndex *pindex) const {
 }
 
 const CBlockIndex *CChain::FindFork(const CBlockIndex *pindex) const {
+    if (pindex == NULL)
+        return NULL;
     if (pindex->nHeight > Height())
         pindex = pindex->GetAncestor(Height());
-    while (pindex && !Contains(pindex))
-        pindex = pindex->pprev;
-    return pindex;
+    if (pindex == NULL || Contains(pindex))
+        return pindex;
+
+    // The ancestors in this chain are the ones up to the fork height, so the fork is found
+    // with a binary search on the heights, each step a skip list lookup, instead of walking
+    // back the whole branch.
+    const CBlockIndex *pgenesis = pindex->GetAncestor(0);
+    if (pgenesis == NULL || !Contains(pgenesis))
+        return NULL;
+    int nLow = 0, nHigh = pindex->nHeight;
+    while (nHigh - nLow > 1) {
+        int nMid = nLow + (nHigh - nLow) / 2;
+        if (Contains(pindex->GetAncestor(nMid)))
+            nLow = nMid;
+        else
+            nHigh = nMid;
+    }
+    return pindex->GetAncestor(nLow);
 }
 
 /** Turn the lowest '1' bit in the binary representation of a number into a '0'. */
@@ -112,3 +170,33 @@ void CHistoricalChain::SetTip(CBlockIndex *pindex)
 {
     throw std::runtime_error("Cannot SetTip of a CHistoricalChain!");
 }
+
+CBlockHashSnapshot::CBlockHashSnapshot(const CChain& chainIn, int nDepth, const CBlockHashSnapshot* prev) : CChainSnapshot(chainIn)
+{
+    const int nTipHeight = Height();
+    nFirstHeight = std::max(0, nTipHeight - std::max(nDepth, 0) + 1);
+    vHashes.resize(nTipHeight + 1 - nFirstHeight);
+
+    const CBlockIndex *pindex = Tip();
+    for (int nHeight = nTipHeight; nHeight >= nFirstHeight; nHeight--, pindex = pindex->pprev) {
+        if (prev != NULL && nHeight >= prev->nFirstHeight && nHeight <= prev->Height() &&
+            prev->vHashes[nHeight - prev->nFirstHeight] == pindex->GetBlockHash()) {
+            // the two chains are the same from this block down
+            const int nLow = std::max(nFirstHeight, prev->nFirstHeight);
+            std::copy(prev->vHashes.begin() + (nLow - prev->nFirstHeight), prev->vHashes.begin() + (nHeight + 1 - prev->nFirstHeight),
+                      vHashes.begin() + (nLow - nFirstHeight));
+            if (nLow == nFirstHeight)
+                break;
+            nHeight = nLow;
+            pindex = pindex->GetAncestor(nLow);
+            prev = NULL;
+            continue;
+        }
+        vHashes[nHeight - nFirstHeight] = pindex->GetBlockHash();
+    }
+}
+
+void CBlockHashSnapshot::SetTip(CBlockIndex *pindex)
+{
+    throw std::runtime_error("Cannot SetTip of a CBlockHashSnapshot!");
+}
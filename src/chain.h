@@ -11,6 +11,9 @@
 #include "tinyformat.h"
 #include "uint256.h"
 
+#include <algorithm>
+#include <functional>
+#include <new>
 #include <vector>
 #include <optional>
 
@@ -127,6 +130,8 @@ enum BlockStatus: uint32_t {
 class CBlockIndex
 {
 public:
+    // The fields walked by the chain selection and the ancestor lookups come first, together in memory
+
     //! pointer to the hash of the block, if any. Memory is owned by this CBlockIndex
     const uint256* phashBlock;
 
@@ -139,23 +144,12 @@ public:
     //! height of the entry in the chain. The genesis block has height 0
     int nHeight;
 
-    //! Which # file this block is stored in (blk?????.dat)
-    int nFile;
-
-    //! Byte offset within blk?????.dat where this block's data is stored
-    unsigned int nDataPos;
-
-    //! Byte offset within rev?????.dat where this block's undo data is stored
-    unsigned int nUndoPos;
+    //! Verification status of this block. See enum BlockStatus
+    unsigned int nStatus;
 
     //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
     arith_uint256 nChainWork;
 
-    int64_t nChainDelay;
-
-    //! Cumulative Hash Block Sidechain Transaction Commitment Tree
-    CFieldElement scCumTreeHash;
-
     //! Number of transactions in this block.
     //! Note: in a potential headers-first mode, this number cannot be relied upon
     unsigned int nTx;
@@ -165,8 +159,22 @@ public:
     //! Change to 64-bit type when necessary; won't happen before 2030
     unsigned int nChainTx;
 
-    //! Verification status of this block. See enum BlockStatus
-    unsigned int nStatus;
+    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
+    uint32_t nSequenceId;
+
+    //! Which # file this block is stored in (blk?????.dat)
+    int nFile;
+
+    //! Byte offset within blk?????.dat where this block's data is stored
+    unsigned int nDataPos;
+
+    //! Byte offset within rev?????.dat where this block's undo data is stored
+    unsigned int nUndoPos;
+
+    int64_t nChainDelay;
+
+    //! Cumulative Hash Block Sidechain Transaction Commitment Tree
+    CFieldElement scCumTreeHash;
 
     //! The anchor for the tree state up to the start of this block
     uint256 hashAnchor;
@@ -190,11 +198,9 @@ public:
     unsigned int nTime;
     unsigned int nBits;
     uint256 nNonce;
+    //! Equihash solution, only kept in memory until the entry is written to the block tree db, see GetSolution
     std::vector<unsigned char> nSolution;
 
-    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
-    uint32_t nSequenceId;
-
     void SetNull()
     {
         phashBlock = NULL;
@@ -273,10 +279,25 @@ public:
         block.nTime          = nTime;
         block.nBits          = nBits;
         block.nNonce         = nNonce;
-        block.nSolution      = nSolution;
+        block.nSolution      = GetSolution();
         return block;
     }
 
+    //! Whether the Equihash solution is in memory
+    bool HasSolution() const
+    {
+        return !nSolution.empty();
+    }
+
+    //! Release the memory of the Equihash solution, once the entry is in the block tree db
+    void TrimSolution()
+    {
+        std::vector<unsigned char>().swap(nSolution);
+    }
+
+    //! The Equihash solution, read back from the block tree db if trimmed (which requires cs_main)
+    std::vector<unsigned char> GetSolution() const;
+
     uint256 GetBlockHash() const
     {
         return *phashBlock;
@@ -342,6 +363,71 @@ public:
     const CBlockIndex* GetAncestor(int height) const;
 };
 
+/**
+ * Storage for the entries of the block index: they are constructed in chunks of contiguous memory rather
+ * than allocated one by one, so that the headers received in a row are next to each other, and they keep
+ * their address until the whole arena is cleared.
+ */
+class CBlockIndexArena
+{
+public:
+    static const size_t CHUNK_SIZE = 4096;
+
+    CBlockIndexArena() : nUsedInLast(CHUNK_SIZE) {}
+    ~CBlockIndexArena() { Clear(); }
+    CBlockIndexArena(const CBlockIndexArena&) = delete;
+    CBlockIndexArena& operator=(const CBlockIndexArena&) = delete;
+
+    template <typename... Args>
+    CBlockIndex* Create(Args&&... args)
+    {
+        if (nUsedInLast == CHUNK_SIZE) {
+            // reserved first, the new chunk is not leaked if the vectors cannot grow
+            vChunks.reserve(vChunks.size() + 1);
+            vChunksByAddress.reserve(vChunks.size() + 1);
+            CBlockIndex* pchunk = static_cast<CBlockIndex*>(::operator new(CHUNK_SIZE * sizeof(CBlockIndex)));
+            vChunks.push_back(pchunk);
+            vChunksByAddress.insert(std::upper_bound(vChunksByAddress.begin(), vChunksByAddress.end(), pchunk, std::less<CBlockIndex*>()), pchunk);
+            nUsedInLast = 0;
+        }
+        CBlockIndex* pindex = new (vChunks.back() + nUsedInLast) CBlockIndex(std::forward<Args>(args)...);
+        nUsedInLast++;
+        return pindex;
+    }
+
+    //! Whether the entry was constructed by this arena, rather than allocated on its own
+    bool Owns(const CBlockIndex* pindex) const
+    {
+        std::vector<CBlockIndex*>::const_iterator it = std::upper_bound(vChunksByAddress.begin(), vChunksByAddress.end(), pindex, std::less<const CBlockIndex*>());
+        return it != vChunksByAddress.begin() && std::less<const CBlockIndex*>()(pindex, *(it - 1) + CHUNK_SIZE);
+    }
+
+    size_t Size() const
+    {
+        return vChunks.empty() ? 0 : (vChunks.size() - 1) * CHUNK_SIZE + nUsedInLast;
+    }
+
+    //! Destroys all the entries, none of them can be referenced anymore
+    void Clear()
+    {
+        for (size_t n = 0; n < vChunks.size(); n++) {
+            const size_t nUsed = (n + 1 < vChunks.size()) ? CHUNK_SIZE : nUsedInLast;
+            for (size_t i = 0; i < nUsed; i++)
+                vChunks[n][i].~CBlockIndex();
+            ::operator delete(vChunks[n]);
+        }
+        vChunks.clear();
+        vChunksByAddress.clear();
+        nUsedInLast = CHUNK_SIZE;
+    }
+
+private:
+    //! in order of allocation, the last one is being filled
+    std::vector<CBlockIndex*> vChunks;
+    std::vector<CBlockIndex*> vChunksByAddress;
+    size_t nUsedInLast;
+};
+
 /** Used to marshal pointers into hashes for db storage. */
 class CDiskBlockIndex : public CBlockIndex
 {
@@ -354,6 +440,8 @@ public:
 
     explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
+        if (!HasSolution())
+            nSolution = pindex->GetSolution();
     }
 
     ADD_SERIALIZE_METHODS;
@@ -469,6 +557,12 @@ public:
         return vChain.size() - 1;
     }
 
+    /** Returns the hash of the block at a particular height in this chain, or NULL if no such height exists. */
+    virtual const uint256 *GetBlockHash(int nHeight) const {
+        const CBlockIndex *pindex = (*this)[nHeight];
+        return pindex ? pindex->phashBlock : NULL;
+    }
+
     /** Set/initialize a chain with a given tip. */
     virtual void SetTip(CBlockIndex *pindex) {
         if (pindex == NULL) {
@@ -514,4 +608,62 @@ private:
     void SetTip(CBlockIndex *pindex);
 };
 
+/**
+ * The active chain as it was when the snapshot was taken, for the read-only RPCs to work outside cs_main:
+ * only the tip is kept, and the blocks below it are found through the skip list of their block index
+ * entries, which never change once connected, nor go away. Taking the snapshot needs cs_main, using it does not.
+ */
+class CChainSnapshot : public CChain {
+private:
+    CBlockIndex *pindexTip;
+
+public:
+    CChainSnapshot() : pindexTip(NULL) { }
+    explicit CChainSnapshot(const CChain& chainIn) : pindexTip(chainIn.Tip()) { }
+
+    CBlockIndex *operator[](int nHeight) const {
+        if (nHeight < 0 || nHeight > Height()) {
+            return NULL;
+        }
+        return pindexTip->GetAncestor(nHeight);
+    }
+
+    int Height() const {
+        return pindexTip ? pindexTip->nHeight : -1;
+    }
+
+    void SetTip(CBlockIndex *pindex) {
+        pindexTip = pindex;
+    }
+};
+
+/**
+ * A CChainSnapshot also holding the hashes of its most recent blocks, down to nDepth blocks below the tip, for the
+ * OP_CHECKBLOCKATHEIGHT checks of the script check threads to be lookups in an array of their own, not in the
+ * block index: below that depth they pass without looking at the hash. Taking the snapshot needs cs_main, using
+ * it does not.
+ */
+class CBlockHashSnapshot : public CChainSnapshot {
+private:
+    int nFirstHeight;
+    std::vector<uint256> vHashes; //!< by height from nFirstHeight
+
+public:
+    /** The snapshot of chainIn, copying the hashes of prev still in it rather than reading them again */
+    CBlockHashSnapshot(const CChain& chainIn, int nDepth, const CBlockHashSnapshot* prev = NULL);
+
+    const uint256 *GetBlockHash(int nHeight) const {
+        if (nHeight >= nFirstHeight && nHeight <= Height())
+            return &vHashes[nHeight - nFirstHeight];
+        return CChainSnapshot::GetBlockHash(nHeight);
+    }
+
+    /** The lowest height whose hash is held */
+    int GetFirstHeight() const {
+        return nFirstHeight;
+    }
+
+    void SetTip(CBlockIndex *pindex);
+};
+
 #endif // BITCOIN_CHAIN_H
@@ -6,9 +6,12 @@
 #define BITCOIN_CHECKQUEUE_H
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
 #include <vector>
 
-#include <boost/foreach.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
@@ -16,21 +19,58 @@
 template <typename T>
 class CCheckQueueControl;
 
-/** 
+/**
+ * A generic verification job for a CCheckQueue, for the checks which are not script checks
+ * (e.g. csw or certificate proof jobs), wrapping any callable returning a bool.
+ */
+class CCheckJob
+{
+private:
+    std::function<bool()> job;
+
+public:
+    CCheckJob() {}
+    explicit CCheckJob(std::function<bool()> jobIn) : job(std::move(jobIn)) {}
+
+    bool operator()() { return !job || job(); }
+    void swap(CCheckJob& other) { job.swap(other.job); }
+};
+
+/**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
-  * operator(), returning a bool.
+  * operator(), returning a bool, and a swap().
   *
   * One thread (the master) is assumed to push batches of verifications
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Each worker has its own deque, the master spreads the verifications over them. A worker
+  * takes batches from the front of its own deque and, once it is empty, steals from the back
+  * of the others, so that the workers only contend on a deque when one of them runs dry.
+  * The batch size adapts to the observed cost of a verification, so that a batch lasts about
+  * BATCH_TARGET_MICROS: cheap checks go in large batches, expensive ones in small batches
+  * which keep the workers balanced until the end.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
-    //! Mutex to protect the inner state
+    //! The maximum number of worker deques, further workers share them
+    static const unsigned int MAX_WORKER_QUEUES = 64;
+
+    //! The time a batch of verifications should take, when their cost is known
+    static const int64_t BATCH_TARGET_MICROS = 200;
+
+    //! The deque of a worker, and the mutex protecting it
+    struct WorkerQueue
+    {
+        boost::mutex mutex;
+        std::deque<T> checks;
+    };
+
+    //! Mutex to make the workers and the master sleep and wake up
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,25 +79,30 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
+    //! The deques of the workers. The one of index 0 belongs to the master.
+    WorkerQueue workerQueues[MAX_WORKER_QUEUES];
+
+    //! The number of workers which ever joined, assigning them their deques
+    std::atomic<unsigned int> nWorkers;
 
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
+    //! Where the next verifications added are spread from
+    unsigned int nNextQueue;
 
     //! The total number of workers (including the master).
-    int nTotal;
+    std::atomic<int> nTotal;
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk;
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo;
+
+    //! Number of verifications still in the deques
+    std::atomic<unsigned int> nQueued;
 
     //! Whether we're shutting down.
     bool fQuit;
@@ -65,30 +110,76 @@ private:
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    //! Moving average of the cost of a verification, in nanoseconds (0 until one is measured)
+    std::atomic<int64_t> nCheckCostNanos;
+
+    /** The number of verifications to take at once, given the ones still queued */
+    unsigned int BatchSize() const
+    {
+        unsigned int nMax = nBatchSize;
+        const int64_t nCost = nCheckCostNanos.load(std::memory_order_relaxed);
+        if (nCost > 0)
+            nMax = (unsigned int)std::max<int64_t>(1, std::min<int64_t>(nBatchSize, BATCH_TARGET_MICROS * 1000 / nCost));
+
+        // Do not try to do everything at once, but aim for increasingly smaller batches so
+        // all workers finish approximately simultaneously.
+        return std::max(1U, std::min(nMax, nQueued.load(std::memory_order_relaxed) / (nTotal.load(std::memory_order_relaxed) + 1)));
+    }
+
+    /** Move up to nMax verifications, from the front of the deque when it is the worker's own, from the back otherwise */
+    static void Take(WorkerQueue& workerQueue, std::vector<T>& vChecks, unsigned int nMax, bool fOwn)
+    {
+        boost::unique_lock<boost::mutex> lock(workerQueue.mutex);
+        // steal at most half of the verifications of another worker
+        if (!fOwn)
+            nMax = std::min<unsigned int>(nMax, (workerQueue.checks.size() + 1) / 2);
+        while (vChecks.size() < nMax && !workerQueue.checks.empty())
+        {
+            vChecks.push_back(T());
+            if (fOwn) {
+                vChecks.back().swap(workerQueue.checks.front());
+                workerQueue.checks.pop_front();
+            } else {
+                vChecks.back().swap(workerQueue.checks.back());
+                workerQueue.checks.pop_back();
+            }
+        }
+    }
+
+    /** Fill vChecks with a batch from the worker's own deque, or stolen from the other ones */
+    void GetBatch(unsigned int nQueue, std::vector<T>& vChecks)
+    {
+        const unsigned int nMax = BatchSize();
+        const unsigned int nQueues = std::min(nWorkers.load(), MAX_WORKER_QUEUES);
+        Take(workerQueues[nQueue], vChecks, nMax, true);
+        for (unsigned int i = 1; i < nQueues && vChecks.empty(); i++)
+            Take(workerQueues[(nQueue + i) % nQueues], vChecks, nMax, false);
+        nQueued -= vChecks.size();
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
+        const unsigned int nQueue = fMaster ? 0 : std::max(1U, nWorkers++) % MAX_WORKER_QUEUES;
         boost::condition_variable& cond = fMaster ? condMaster : condWorker;
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
+        nTotal++;
+        unsigned int nDone = 0;
         do {
+            if (nDone > 0 || nQueued == 0)
             {
                 boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
+                // first do the clean-up tasks (but not if we're just starting)
+                if (nDone > 0) {
+                    nTodo -= nDone;
+                    nDone = 0;
                     if (nTodo == 0 && !fMaster)
                         // We processed the last element; inform the master it can exit and return the result
                         condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
                 }
                 // logically, the do loop starts here
-                while (queue.empty()) {
+                while (nQueued == 0) {
                     if ((fMaster || fQuit) && nTodo == 0) {
                         nTotal--;
                         bool fRet = fAllOk;
@@ -98,37 +189,43 @@ private:
                         // return the current status
                         return fRet;
                     }
-                    nIdle++;
                     cond.wait(lock); // wait
-                    nIdle--;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
                 }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
             }
-            // execute work
-            BOOST_FOREACH (T& check, vChecks)
-                if (fOk)
-                    fOk = check();
+            // the deques are only locked one at a time, while moving a batch out
+            GetBatch(nQueue, vChecks);
+            if (vChecks.empty())
+                continue;
+
+            // execute work, unless a verification already failed
+            bool fOk = fAllOk;
+            unsigned int nChecked = 0;
+            const auto start = std::chrono::steady_clock::now();
+            for (T& check : vChecks) {
+                if (!fOk)
+                    break;
+                fOk = check();
+                nChecked++;
+            }
+            if (nChecked > 0) {
+                const int64_t nCost = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count() / nChecked;
+                const int64_t nAverage = nCheckCostNanos.load(std::memory_order_relaxed);
+                nCheckCostNanos.store(nAverage == 0 ? std::max<int64_t>(1, nCost) : std::max<int64_t>(1, (nAverage * 7 + nCost) / 8),
+                                      std::memory_order_relaxed);
+            }
+            if (!fOk)
+                fAllOk = false;
+
+            nDone = vChecks.size();
             vChecks.clear();
         } while (true);
     }
 
 public:
     //! Create a new check queue
-    CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), fQuit(false), nBatchSize(nBatchSizeIn) {}
+    CCheckQueue(unsigned int nBatchSizeIn) : nWorkers(1), nNextQueue(0), nTotal(0), fAllOk(true), nTodo(0), nQueued(0),
+        fQuit(false), nBatchSize(nBatchSizeIn), nCheckCostNanos(0) {}
 
     //! Worker thread
     void Thread()
@@ -145,15 +242,31 @@ public:
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        BOOST_FOREACH (T& check, vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty())
+            return;
+
+        // Spread them in chunks over the deques of the workers, including the master's one
+        const unsigned int nQueues = std::min(nWorkers.load(), MAX_WORKER_QUEUES);
+        const size_t nChunk = std::max<size_t>(1, vChecks.size() / nQueues);
+        // count them before they can be taken, so that nQueued never underflows
         nTodo += vChecks.size();
+        nQueued += vChecks.size();
+        for (size_t nStart = 0; nStart < vChecks.size(); nStart += nChunk)
+        {
+            WorkerQueue& workerQueue = workerQueues[nNextQueue];
+            nNextQueue = (nNextQueue + 1) % nQueues;
+
+            boost::unique_lock<boost::mutex> lock(workerQueue.mutex);
+            for (size_t i = nStart; i < std::min(nStart + nChunk, vChecks.size()); i++) {
+                workerQueue.checks.push_back(T());
+                vChecks[i].swap(workerQueue.checks.back());
+            }
+        }
+
+        boost::unique_lock<boost::mutex> lock(mutex);
         if (vChecks.size() == 1)
             condWorker.notify_one();
-        else if (vChecks.size() > 1)
+        else
             condWorker.notify_all();
     }
 
@@ -161,15 +274,16 @@ public:
     {
     }
 
+    //! Whether no verification is pending. Workers may still be on their way to sleep, which is harmless here.
     bool IsIdle()
     {
         boost::unique_lock<boost::mutex> lock(mutex);
-        return (nTotal == nIdle && nTodo == 0 && fAllOk == true);
+        return (nTodo == 0 && nQueued == 0 && fAllOk == true);
     }
 
 };
 
-/** 
+/**
  * RAII-style controller object for a CCheckQueue that guarantees the passed
  * queue is finished before continuing.
  */
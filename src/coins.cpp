@@ -20,6 +20,7 @@
 
 #include "txdb.h"
 #include "maturityheightindex.h"
+#include "checkqueue.h"
 
 std::string CCoins::ToString() const
 {
@@ -204,6 +205,8 @@ bool CCoinsView::GetSidechain(const uint256& scId, CSidechain& info)
 bool CCoinsView::HaveSidechainEvents(int height)                                const { return false; }
 bool CCoinsView::GetSidechainEvents(int height, CSidechainEvents& scEvent)      const { return false; }
 void CCoinsView::GetScIds(std::set<uint256>& scIdsList)                         const { scIdsList.clear(); return; }
+void CCoinsView::GetScIdsByCeasingHeight(int minHeight, int maxHeight,
+                                         std::set<uint256>& scIdsList)          const { scIdsList.clear(); return; }
 bool CCoinsView::CheckQuality(const CScCertificate& cert)                       const { return false; }
 uint256 CCoinsView::GetBestBlock()                                              const { return uint256(); }
 uint256 CCoinsView::GetBestAnchor()                                             const { return uint256(); }
@@ -215,6 +218,7 @@ bool CCoinsView::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock,
                             CNullifiersMap &mapNullifiers, CSidechainsMap& mapSidechains,
                             CSidechainEventsMap& mapSidechainEvents,
                             CCswNullifiersMap& cswNullifiers)                         { return false; }
+bool CCoinsView::Sync()                                                               { return true; }
 bool CCoinsView::GetStats(CCoinsStats &stats)                                   const { return false; }
 
 
@@ -229,6 +233,8 @@ bool CCoinsViewBacked::GetSidechain(const uint256& scId, CSidechain& info)
 bool CCoinsViewBacked::HaveSidechainEvents(int height)                                 const { return base->HaveSidechainEvents(height); }
 bool CCoinsViewBacked::GetSidechainEvents(int height, CSidechainEvents& scEvents)      const { return base->GetSidechainEvents(height, scEvents); }
 void CCoinsViewBacked::GetScIds(std::set<uint256>& scIdsList)                          const { return base->GetScIds(scIdsList); }
+void CCoinsViewBacked::GetScIdsByCeasingHeight(int minHeight, int maxHeight,
+                                               std::set<uint256>& scIdsList)           const { return base->GetScIdsByCeasingHeight(minHeight, maxHeight, scIdsList); }
 bool CCoinsViewBacked::CheckQuality(const CScCertificate& cert)                        const { return base->CheckQuality(cert); }
 uint256 CCoinsViewBacked::GetBestBlock()                                               const { return base->GetBestBlock(); }
 uint256 CCoinsViewBacked::GetBestAnchor()                                              const { return base->GetBestAnchor(); }
@@ -244,6 +250,7 @@ bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock,
                                   CCswNullifiersMap& cswNullifiers) { return base->BatchWrite(mapCoins, hashBlock, hashAnchor,
                                                                                               mapAnchors, mapNullifiers, mapSidechains,
                                                                                               mapSidechainEvents, cswNullifiers); }
+bool CCoinsViewBacked::Sync()                                                              { return base->Sync(); }
 bool CCoinsViewBacked::GetStats(CCoinsStats &stats)                                  const { return base->GetStats(stats); }
 
 CCoinsKeyHasher::CCoinsKeyHasher() : salt(GetRandHash()) {}
@@ -280,8 +287,10 @@ size_t CCoinsViewCache::DynamicMemoryUsage() const {
 
 CCoinsMap::const_iterator CCoinsViewCache::FetchCoins(const uint256 &txid) const {
     CCoinsMap::iterator it = cacheCoins.find(txid);
-    if (it != cacheCoins.end())
+    if (it != cacheCoins.end()) {
+        it->second.flags |= CCoinsCacheEntry::RECENT;
         return it;
+    }
     CCoins tmp;
     if (!base->GetCoins(txid, tmp))
         return cacheCoins.end();
@@ -292,6 +301,7 @@ CCoinsMap::const_iterator CCoinsViewCache::FetchCoins(const uint256 &txid) const
         // version as fresh.
         ret->second.flags = CCoinsCacheEntry::FRESH;
     }
+    ret->second.flags |= CCoinsCacheEntry::RECENT;
     cachedCoinsUsage += ret->second.coins.DynamicMemoryUsage();
     return ret;
 }
@@ -494,7 +504,7 @@ CCoinsModifier CCoinsViewCache::ModifyCoins(const uint256 &txid) {
         cachedCoinUsage = ret.first->second.coins.DynamicMemoryUsage();
     }
     // Assume that whenever ModifyCoins is called, the entry will be modified.
-    ret.first->second.flags |= CCoinsCacheEntry::DIRTY;
+    ret.first->second.flags |= CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::RECENT;
     return CCoinsModifier(*this, ret.first, cachedCoinUsage);
 }
 
@@ -507,6 +517,64 @@ const CCoins* CCoinsViewCache::AccessCoins(const uint256 &txid) const {
     }
 }
 
+void CCoinsViewCache::Prefetch(const std::vector<uint256>& txids, const std::vector<uint256>& scIds, CCheckQueue<CCheckJob>* pqueue) const
+{
+    if (pqueue == NULL)
+        return;
+
+    std::vector<uint256> vMissingCoins;
+    for (const uint256& txid : txids)
+        if (cacheCoins.find(txid) == cacheCoins.end())
+            vMissingCoins.push_back(txid);
+    std::sort(vMissingCoins.begin(), vMissingCoins.end());
+    vMissingCoins.erase(std::unique(vMissingCoins.begin(), vMissingCoins.end()), vMissingCoins.end());
+
+    std::vector<uint256> vMissingScs;
+    for (const uint256& scId : scIds)
+        if (cacheSidechains.find(scId) == cacheSidechains.end())
+            vMissingScs.push_back(scId);
+    std::sort(vMissingScs.begin(), vMissingScs.end());
+    vMissingScs.erase(std::unique(vMissingScs.begin(), vMissingScs.end()), vMissingScs.end());
+
+    if (vMissingCoins.empty() && vMissingScs.empty())
+        return;
+
+    // each job fills its own slot, the cache is only filled afterwards, by this thread
+    std::vector<CCoins> vCoins(vMissingCoins.size());
+    std::vector<char> vCoinsFound(vMissingCoins.size(), 0);
+    std::vector<CSidechain> vScs(vMissingScs.size());
+    std::vector<char> vScsFound(vMissingScs.size(), 0);
+    {
+        std::vector<CCheckJob> vJobs;
+        vJobs.reserve(vMissingCoins.size() + vMissingScs.size());
+        for (size_t i = 0; i < vMissingCoins.size(); i++)
+            vJobs.push_back(CCheckJob([&, i]() { vCoinsFound[i] = base->GetCoins(vMissingCoins[i], vCoins[i]); return true; }));
+        for (size_t i = 0; i < vMissingScs.size(); i++)
+            vJobs.push_back(CCheckJob([&, i]() { vScsFound[i] = base->GetSidechain(vMissingScs[i], vScs[i]); return true; }));
+        CCheckQueueControl<CCheckJob> control(pqueue);
+        control.Add(vJobs);
+        control.Wait();
+    }
+
+    // as FetchCoins and FetchSidechains do with what they read
+    for (size_t i = 0; i < vMissingCoins.size(); i++) {
+        if (!vCoinsFound[i])
+            continue;
+        CCoinsMap::iterator ret = cacheCoins.insert(std::make_pair(vMissingCoins[i], CCoinsCacheEntry())).first;
+        vCoins[i].swap(ret->second.coins);
+        if (ret->second.coins.IsPruned())
+            ret->second.flags = CCoinsCacheEntry::FRESH;
+        cachedCoinsUsage += ret->second.coins.DynamicMemoryUsage();
+    }
+    for (size_t i = 0; i < vMissingScs.size(); i++) {
+        if (!vScsFound[i])
+            continue;
+        CSidechainsMap::iterator ret =
+            cacheSidechains.insert(std::make_pair(vMissingScs[i], CSidechainsCacheEntry(vScs[i], CSidechainsCacheEntry::Flags::DEFAULT))).first;
+        cachedCoinsUsage += ret->second.sidechain.DynamicMemoryUsage();
+    }
+}
+
 bool CCoinsViewCache::HaveCoins(const uint256 &txid) const {
     CCoinsMap::const_iterator it = FetchCoins(txid);
     // We're using vtx.empty() instead of IsPruned here for performance reasons,
@@ -533,6 +601,13 @@ void CCoinsViewCache::SetBestBlock(const uint256 &hashBlockIn) {
     hashBlock = hashBlockIn;
 }
 
+void CCoinsViewCache::ResetBestBlock() {
+    assert(cacheCoins.empty() && cacheAnchors.empty() && cacheNullifiers.empty() && cacheSidechains.empty() &&
+           cacheSidechainEvents.empty() && cacheCswNullifiers.empty());
+    hashBlock.SetNull();
+    hashAnchor.SetNull();
+}
+
 bool CCoinsViewCache::HaveCswNullifier(const uint256& scId, const CFieldElement &nullifier) const {
     std::pair<uint256, CFieldElement> key = std::make_pair(scId, nullifier);
 
@@ -582,7 +657,7 @@ size_t CCoinsViewCache::WriteCoins(const uint256& key, CCoinsCacheEntry& value)
                 CCoinsCacheEntry& entry = this->cacheCoins[key];
                 entry.coins.swap(value.coins);
                 res += entry.coins.DynamicMemoryUsage();
-                    entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+                    entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH | CCoinsCacheEntry::RECENT;
                 }
         } else 
         {
@@ -599,7 +674,7 @@ size_t CCoinsViewCache::WriteCoins(const uint256& key, CCoinsCacheEntry& value)
                 res -= itUs->second.coins.DynamicMemoryUsage();
                 itUs->second.coins.swap(value.coins);
                 res += itUs->second.coins.DynamicMemoryUsage();
-                    itUs->second.flags |= CCoinsCacheEntry::DIRTY;
+                    itUs->second.flags |= CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::RECENT;
                 }
             }
         }
@@ -723,6 +798,27 @@ void CCoinsViewCache::GetScIds(std::set<uint256>& scIdsList) const
     return;
 }
 
+void CCoinsViewCache::GetScIdsByCeasingHeight(int minHeight, int maxHeight, std::set<uint256>& scIdsList) const
+{
+    base->GetScIdsByCeasingHeight(minHeight, maxHeight, scIdsList);
+
+    // Cached sidechains override the persisted ones, whose ceasing height may have changed
+    for (const auto& entry: cacheSidechains)
+    {
+        scIdsList.erase(entry.first);
+
+        if (entry.second.flag == CSidechainsCacheEntry::Flags::ERASED || !entry.second.sidechain.isCreationConfirmed())
+            continue;
+
+        int ceasingHeight = entry.second.sidechain.GetScheduledCeasingHeight();
+
+        if (ceasingHeight >= minHeight && ceasingHeight <= maxHeight)
+            scIdsList.insert(entry.first);
+    }
+
+    return;
+}
+
 bool CCoinsViewCache::CheckQuality(const CScCertificate& cert) const
 {
     // check in blockchain if a better cert is already there for this epoch
@@ -793,15 +889,17 @@ bool CCoinsViewCache::UpdateSidechain(const CTransaction& tx, const CBlock& bloc
         scIt->second.sidechain.lastTopQualityCertView.forwardTransferScFee = cr.forwardTransferScFee;
         scIt->second.sidechain.lastTopQualityCertView.mainchainBackwardTransferRequestScFee = cr.mainchainBackwardTransferRequestScFee;
 
-        scIt->second.sidechain.fixedParams.version = cr.version;
-        scIt->second.sidechain.fixedParams.withdrawalEpochLength = cr.withdrawalEpochLength;
-        scIt->second.sidechain.fixedParams.customData = cr.customData;
-        scIt->second.sidechain.fixedParams.constant = cr.constant;
-        scIt->second.sidechain.fixedParams.wCertVk = cr.wCertVk;
-        scIt->second.sidechain.fixedParams.wCeasedVk = cr.wCeasedVk;
-        scIt->second.sidechain.fixedParams.vFieldElementCertificateFieldConfig = cr.vFieldElementCertificateFieldConfig;
-        scIt->second.sidechain.fixedParams.vBitVectorCertificateFieldConfig = cr.vBitVectorCertificateFieldConfig;
-        scIt->second.sidechain.fixedParams.mainchainBackwardTransferRequestDataLength = cr.mainchainBackwardTransferRequestDataLength;
+        Sidechain::ScFixedParameters& fixedParams = scIt->second.sidechain.ModifyFixedParams();
+        fixedParams.version = cr.version;
+        fixedParams.withdrawalEpochLength = cr.withdrawalEpochLength;
+        fixedParams.customData = cr.customData;
+        fixedParams.constant = cr.constant;
+        fixedParams.wCertVk = cr.wCertVk;
+        fixedParams.wCeasedVk = cr.wCeasedVk;
+        fixedParams.vFieldElementCertificateFieldConfig = cr.vFieldElementCertificateFieldConfig;
+        fixedParams.vBitVectorCertificateFieldConfig = cr.vBitVectorCertificateFieldConfig;
+        fixedParams.mainchainBackwardTransferRequestDataLength = cr.mainchainBackwardTransferRequestDataLength;
+        scIt->second.sidechain.InternFixedParams(scId);
 
         scIt->second.sidechain.InitScFees();
 
@@ -1228,7 +1326,7 @@ CValidationState::Code CCoinsViewCache::IsCertApplicableToState(const CScCertifi
         return CValidationState::Code::INSUFFICIENT_SCID_FUNDS;
     }
 
-    size_t proof_plus_vk_size = sidechain.fixedParams.wCertVk.GetByteArray().size() + cert.scProof.GetByteArray().size();
+    size_t proof_plus_vk_size = sidechain.GetFixedParams().wCertVk.GetByteArray().size() + cert.scProof.GetByteArray().size();
     if (proof_plus_vk_size > Sidechain::MAX_PROOF_PLUS_VK_SIZE)
     {
         LogPrintf("%s():%d - ERROR: Cert [%s]\n proof plus vk size (%d) exceeded the limit %d\n",
@@ -1466,18 +1564,18 @@ CValidationState::Code CCoinsViewCache::IsScTxApplicableToState(const CTransacti
          * Check that the size of the Request Data field element is the same specified
          * during sidechain creation.
          */
-        if (mbtr.vScRequestData.size() != sidechain.fixedParams.mainchainBackwardTransferRequestDataLength)
+        if (mbtr.vScRequestData.size() != sidechain.GetFixedParams().mainchainBackwardTransferRequestDataLength)
         {
             LogPrintf("%s():%d - ERROR: Invalid tx[%s] : MBTR request data size [%d] must be equal to the size specified "
                          "during sidechain creation [%d] for scId[%s]\n",
-                    __func__, __LINE__, txHash.ToString(), mbtr.vScRequestData.size(), sidechain.fixedParams.mainchainBackwardTransferRequestDataLength, scId.ToString());
+                    __func__, __LINE__, txHash.ToString(), mbtr.vScRequestData.size(), sidechain.GetFixedParams().mainchainBackwardTransferRequestDataLength, scId.ToString());
             return CValidationState::Code::INVALID_AND_BAN;
         }
 
         /**
          * Check that MBTRs are allowed (i.e. the MBTR data length is greater than zero).
          */
-        if (sidechain.fixedParams.mainchainBackwardTransferRequestDataLength == 0)
+        if (sidechain.GetFixedParams().mainchainBackwardTransferRequestDataLength == 0)
         {
             LogPrintf("%s():%d - ERROR: mbtr is not allowed for scId[%s]\n",  __func__, __LINE__, scId.ToString());
             return CValidationState::Code::INVALID_AND_BAN;
@@ -1517,34 +1615,53 @@ CValidationState::Code CCoinsViewCache::IsScTxApplicableToState(const CTransacti
     }
 
     // Check CSW inputs
-    // Key is Sc id, value - total amount of coins to be withdrawn by Tx CSWs for given sidechain
-    std::map<uint256, CAmount> cswTotalBalances;
-    for(const CTxCeasedSidechainWithdrawalInput& csw: tx.GetVcswCcIn())
+    // A tx can withdraw many nullifiers from the same ceased sidechain: the sidechain, its state, active cert
+    // view and ceasing cumulative tree hash are fetched once, with the first of its inputs, not for every input
+    struct CswSidechainData
     {
         CSidechain sidechain;
-        if (!GetSidechain(csw.scId, sidechain))
+        CScCertificateView certView;
+        CFieldElement ceasingCumTreeHash;
+        CAmount totalAmount = 0; // total amount of coins to be withdrawn by Tx CSWs for the sidechain
+    };
+    std::map<uint256, CswSidechainData> cswSidechains;
+    for(const CTxCeasedSidechainWithdrawalInput& csw: tx.GetVcswCcIn())
+    {
+        auto itCswSc = cswSidechains.find(csw.scId);
+        if (itCswSc == cswSidechains.end())
         {
-            LogPrintf("%s():%d - ERROR: tx[%s] CSW input [%s]\n refers to unknown scId\n",
-                __func__, __LINE__, tx.ToString(), csw.ToString());
-            return CValidationState::Code::SCID_NOT_FOUND;
-        }
+            CSidechain sidechain;
+            if (!GetSidechain(csw.scId, sidechain))
+            {
+                LogPrintf("%s():%d - ERROR: tx[%s] CSW input [%s]\n refers to unknown scId\n",
+                    __func__, __LINE__, tx.ToString(), csw.ToString());
+                return CValidationState::Code::SCID_NOT_FOUND;
+            }
 
-        auto s = sidechain.GetState(*this);
-        if (s != CSidechain::State::CEASED)
-        {
-            LogPrintf("%s():%d - ERROR: Tx[%s] CSW input [%s]\n cannot be accepted, sidechain is not ceased\n",
-                __func__, __LINE__, tx.ToString(), csw.ToString());
-            return CValidationState::Code::INVALID;
-        }
+            auto s = sidechain.GetState(*this);
+            if (s != CSidechain::State::CEASED)
+            {
+                LogPrintf("%s():%d - ERROR: Tx[%s] CSW input [%s]\n cannot be accepted, sidechain is not ceased\n",
+                    __func__, __LINE__, tx.ToString(), csw.ToString());
+                return CValidationState::Code::INVALID;
+            }
 
-        if(!sidechain.fixedParams.wCeasedVk.has_value())
-        {
-            LogPrintf("%s():%d - ERROR: Tx[%s] CSW input [%s]\n refers to SC without CSW support\n",
-                __func__, __LINE__, tx.GetHash().ToString(), csw.ToString());
-            return CValidationState::Code::INVALID_AND_BAN;
+            if(!sidechain.GetFixedParams().wCeasedVk.has_value())
+            {
+                LogPrintf("%s():%d - ERROR: Tx[%s] CSW input [%s]\n refers to SC without CSW support\n",
+                    __func__, __LINE__, tx.GetHash().ToString(), csw.ToString());
+                return CValidationState::Code::INVALID_AND_BAN;
+            }
+
+            itCswSc = cswSidechains.emplace(csw.scId, CswSidechainData()).first;
+            itCswSc->second.sidechain = std::move(sidechain);
+            itCswSc->second.certView = this->GetActiveCertView(csw.scId);
+            itCswSc->second.ceasingCumTreeHash = GetCeasingCumTreeHash(csw.scId);
         }
+        CswSidechainData& cswSc = itCswSc->second;
+        const CSidechain& sidechain = cswSc.sidechain;
 
-        size_t proof_plus_vk_size = sidechain.fixedParams.wCeasedVk.value().GetByteArray().size() + csw.scProof.GetByteArray().size();
+        size_t proof_plus_vk_size = sidechain.GetFixedParams().wCeasedVk.value().GetByteArray().size() + csw.scProof.GetByteArray().size();
         if(proof_plus_vk_size > Sidechain::MAX_PROOF_PLUS_VK_SIZE)
         {
             LogPrintf("%s():%d - ERROR: Tx[%s] CSW input [%s]\n proof plus vk size (%d) exceeded the limit %d\n",
@@ -1552,14 +1669,13 @@ CValidationState::Code CCoinsViewCache::IsScTxApplicableToState(const CTransacti
             return CValidationState::Code::INVALID_AND_BAN;
         }
 
-        // add a new balance entry in the map or increment it if already there
-        cswTotalBalances[csw.scId] += csw.nValue;
+        cswSc.totalAmount += csw.nValue;
 
         // Check that SC CSW balances don't exceed the SC balance
-        if(cswTotalBalances[csw.scId] > sidechain.balance)
+        if(cswSc.totalAmount > sidechain.balance)
         {
             LogPrintf("%s():%d - ERROR: Tx[%s] CSW inputs total amount[%s] is greater than sc[%s] total balance[%s]\n",
-                __func__, __LINE__, tx.ToString(), FormatMoney(cswTotalBalances[csw.scId]), csw.scId.ToString(), FormatMoney(sidechain.balance));
+                __func__, __LINE__, tx.ToString(), FormatMoney(cswSc.totalAmount), csw.scId.ToString(), FormatMoney(sidechain.balance));
             return CValidationState::Code::INSUFFICIENT_SCID_FUNDS;
         }
 
@@ -1569,17 +1685,16 @@ CValidationState::Code CCoinsViewCache::IsScTxApplicableToState(const CTransacti
             return CValidationState::Code::INVALID;
         }
 
-        CScCertificateView certView = this->GetActiveCertView(csw.scId);
         // note: it's also fine to have an empty actCertDataHash fe obj 
         // in this case both certView.certDataHash, csw.actCertDataHash have to be == CFieldElement() to be valid
-        if (certView.certDataHash != csw.actCertDataHash)
+        if (cswSc.certView.certDataHash != csw.actCertDataHash)
         {
             LogPrintf("%s():%d - ERROR: Tx[%s] CSW input [%s]\n active cert data hash does not match\n",
                 __func__, __LINE__, tx.ToString(), csw.ToString());
             return CValidationState::Code::ACTIVE_CERT_DATA_HASH;
         }
 
-        if (GetCeasingCumTreeHash(csw.scId) != csw.ceasingCumScTxCommTree)
+        if (cswSc.ceasingCumTreeHash != csw.ceasingCumScTxCommTree)
         {
             LogPrintf("%s():%d - ERROR: Tx[%s] CSW input [%s]\n ceased cum Tree hash does not match\n",
                 __func__, __LINE__, tx.ToString(), csw.ToString());
@@ -1847,7 +1962,7 @@ bool CCoinsViewCache::UpdateSidechain(const CScCertificate& cert, CBlockUndo& bl
     currentSc.lastTopQualityCertReferencedEpoch = cert.epochNumber;
     currentSc.lastTopQualityCertQuality         = cert.quality;
     currentSc.lastTopQualityCertBwtAmount       = bwtTotalAmount;
-    currentSc.lastTopQualityCertView            = CScCertificateView(cert, currentSc.fixedParams);
+    currentSc.lastTopQualityCertView            = CScCertificateView(cert, currentSc.GetFixedParams());
 
     if (currentSc.isNonCeasing()) {
         currentSc.lastInclusionHeight = blockHeight;
@@ -2149,21 +2264,27 @@ bool CCoinsViewCache::HandleSidechainEvents(int height, CBlockUndo& blockUndo, s
 
         assert(HaveSidechain(maturingScId));
         CSidechainsMap::iterator scMaturingIt = ModifySidechain(maturingScId);
-        assert(scMaturingIt->second.sidechain.mImmatureAmounts.count(height));
+        CSidechain& maturingSc = scMaturingIt->second.sidechain;
+
+        // the amounts maturing now are the oldest ones, at the front of the map
+        auto immatureAmountIt = maturingSc.mImmatureAmounts.find(height);
+        assert(immatureAmountIt != maturingSc.mImmatureAmounts.end());
+        const CAmount maturedAmount = immatureAmountIt->second;
 
         // Temporary assert: for SC version 2 we should never be here
-        assert(!scMaturingIt->second.sidechain.isNonCeasing());
+        assert(!maturingSc.isNonCeasing());
 
-        scMaturingIt->second.sidechain.balance += scMaturingIt->second.sidechain.mImmatureAmounts.at(height);
+        maturingSc.balance += maturedAmount;
         LogPrint("sc", "%s():%d - SIDECHAIN-EVENT: scId=%s balance updated to: %s\n",
-            __func__, __LINE__, maturingScId.ToString(), FormatMoney(scMaturingIt->second.sidechain.balance));
+            __func__, __LINE__, maturingScId.ToString(), FormatMoney(maturingSc.balance));
 
-        blockUndo.scUndoDatabyScId[maturingScId].appliedMaturedAmount = scMaturingIt->second.sidechain.mImmatureAmounts[height];
-        blockUndo.scUndoDatabyScId[maturingScId].contentBitMask |= CSidechainUndoData::AvailableSections::MATURED_AMOUNTS;
+        CSidechainUndoData& scUndoData = blockUndo.scUndoDatabyScId[maturingScId];
+        scUndoData.appliedMaturedAmount = maturedAmount;
+        scUndoData.contentBitMask |= CSidechainUndoData::AvailableSections::MATURED_AMOUNTS;
         LogPrint("sc", "%s():%d - SIDECHAIN-EVENT: adding immature amount %s for scId=%s in blockundo\n",
-            __func__, __LINE__, FormatMoney(scMaturingIt->second.sidechain.mImmatureAmounts[height]), maturingScId.ToString());
+            __func__, __LINE__, FormatMoney(maturedAmount), maturingScId.ToString());
 
-        scMaturingIt->second.sidechain.mImmatureAmounts.erase(height);
+        maturingSc.mImmatureAmounts.erase(immatureAmountIt);
         scMaturingIt->second.flag = CSidechainsCacheEntry::Flags::DIRTY;
     }
 
@@ -2346,12 +2467,117 @@ bool CCoinsViewCache::Flush() {
     return fOk;
 }
 
+void CCoinsViewCache::Reset(CCoinsView* baseIn) {
+    assert(!hasModifier);
+    cacheCoins.reset();
+    cacheSidechains.clear();
+    cacheSidechainEvents.clear();
+    cacheAnchors.clear();
+    cacheNullifiers.clear();
+    cacheCswNullifiers.clear();
+    cachedCoinsUsage = 0;
+    hashBlock.SetNull();
+    hashAnchor.SetNull();
+    SetBackend(*baseIn);
+}
+
+CCoinsViewCachePool::CLease CCoinsViewCachePool::Acquire() {
+    std::unique_ptr<CCoinsViewCache> view;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!vIdle.empty()) {
+            view = std::move(vIdle.back());
+            vIdle.pop_back();
+        }
+    }
+    if (!view)
+        view.reset(new CCoinsViewCache(&empty));
+    return CLease(this, std::move(view));
+}
+
+void CCoinsViewCachePool::Release(std::unique_ptr<CCoinsViewCache> view) {
+    view->Reset(&empty);
+    // the views of the transactions with many inputs are not worth their memory
+    if (view->DynamicMemoryUsage() > nMaxIdleUsage)
+        return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (vIdle.size() < nMaxIdle)
+        vIdle.push_back(std::move(view));
+}
+
+bool CCoinsViewCache::FlushAndTrim(size_t nTargetUsage) {
+    assert(!hasModifier);
+    // The modified coins about to be evicted are moved to the batch, the others copied: they stay as clean entries
+    CCoinsMap mapWrite;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end();) {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
+            ++it;
+            continue;
+        }
+        CCoinsCacheEntry& entry = mapWrite[it->first];
+        if ((it->second.flags & CCoinsCacheEntry::RECENT) && !it->second.coins.IsPruned()) {
+            entry = it->second;
+            it->second.flags &= ~(CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH);
+            ++it;
+        } else {
+            entry.coins.swap(it->second.coins);
+            entry.flags = it->second.flags;
+            cacheCoins.erase(it++);
+        }
+    }
+    bool fOk = base->BatchWrite(mapWrite, hashBlock, hashAnchor, cacheAnchors, cacheNullifiers, cacheSidechains, cacheSidechainEvents, cacheCswNullifiers);
+    cacheSidechains.clear();
+    cacheSidechainEvents.clear();
+    cacheAnchors.clear();
+    cacheNullifiers.clear();
+    cacheCswNullifiers.clear();
+
+    cachedCoinsUsage = 0;
+    for (CCoinsMap::const_iterator it = cacheCoins.begin(); it != cacheCoins.end(); ++it)
+        cachedCoinsUsage += it->second.coins.DynamicMemoryUsage();
+
+    // Second chance: the first sweep clears the access bits, the second evicts what the first one kept
+    size_t nEvicted = 0;
+    for (int nSweep = 0; nSweep < 2 && CoinsEntriesUsage() > nTargetUsage; nSweep++) {
+        for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end() && CoinsEntriesUsage() > nTargetUsage;) {
+            if (it->second.flags & CCoinsCacheEntry::RECENT) {
+                it->second.flags &= ~CCoinsCacheEntry::RECENT;
+                ++it;
+                continue;
+            }
+            cachedCoinsUsage -= it->second.coins.DynamicMemoryUsage();
+            cacheCoins.erase(it++);
+            nEvicted++;
+        }
+    }
+
+    // The erased slots are only reused by the map, it is rebuilt to release them. The entries left are judged
+    // on the accesses until the next call
+    CCoinsMap mapKept;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end(); ++it) {
+        it->second.flags &= ~CCoinsCacheEntry::RECENT;
+        if (nEvicted > 0) {
+            CCoinsCacheEntry& entry = mapKept[it->first];
+            entry.coins.swap(it->second.coins);
+            entry.flags = it->second.flags;
+        }
+    }
+    if (nEvicted > 0)
+        cacheCoins.swap(mapKept);
+    return fOk;
+}
+
+size_t CCoinsViewCache::CoinsEntriesUsage() const {
+    return cacheCoins.size() * memusage::MallocUsage(sizeof(CCoinsMap::value_type)) + cachedCoinsUsage;
+}
+
 bool CCoinsViewCache::DecrementImmatureAmount(const uint256& scId, const CSidechainsMap::iterator& targetEntry, CAmount nValue, int maturityHeight)
 {
     // get the map of immature amounts, they are indexed by height
     auto& iaMap = targetEntry->second.sidechain.mImmatureAmounts;
+    auto iaIt = iaMap.find(maturityHeight);
 
-    if (!iaMap.count(maturityHeight) )
+    if (iaIt == iaMap.end())
     {
         // should not happen
         LogPrintf("ERROR %s():%d - could not find immature balance at height%d\n",
@@ -2360,9 +2586,9 @@ bool CCoinsViewCache::DecrementImmatureAmount(const uint256& scId, const CSidech
     }
 
     LogPrint("sc", "%s():%d - immature amount before: %s\n",
-        __func__, __LINE__, FormatMoney(iaMap[maturityHeight]));
+        __func__, __LINE__, FormatMoney(iaIt->second));
 
-    if (iaMap[maturityHeight] < nValue)
+    if (iaIt->second < nValue)
     {
         // should not happen either
         LogPrintf("ERROR %s():%d - negative balance at height=%d\n",
@@ -2370,16 +2596,15 @@ bool CCoinsViewCache::DecrementImmatureAmount(const uint256& scId, const CSidech
         return false;
     }
 
-    iaMap[maturityHeight] -= nValue;
+    iaIt->second -= nValue;
     targetEntry->second.flag = CSidechainsCacheEntry::Flags::DIRTY;
 
     LogPrint("sc", "%s():%d - immature amount after: %s\n",
-        __func__, __LINE__, FormatMoney(iaMap[maturityHeight]));
+        __func__, __LINE__, FormatMoney(iaIt->second));
 
-    if (iaMap[maturityHeight] == 0)
+    if (iaIt->second == 0)
     {
-        iaMap.erase(maturityHeight);
-        targetEntry->second.flag = CSidechainsCacheEntry::Flags::DIRTY;
+        iaMap.erase(iaIt);
         LogPrint("sc", "%s():%d - removed entry height=%d from immature amounts in memory\n",
             __func__, __LINE__, maturityHeight );
     }
@@ -2432,9 +2657,7 @@ bool CCoinsViewCache::HaveJoinSplitRequirements(const CTransactionBase& txBase)
             return false;
         }
 
-        for(const uint256& commitment: joinsplit.commitments) {
-            tree.append(commitment);
-        }
+        tree.append(joinsplit.commitments.begin(), joinsplit.commitments.end());
 
         intermediates.insert(std::make_pair(tree.root(), tree));
     }
@@ -8,12 +8,16 @@
 
 #include "compressor.h"
 #include "core_memusage.h"
+#include "flathashmap.h"
 #include "memusage.h"
 #include "serialize.h"
 #include "uint256.h"
 
 #include <assert.h>
 #include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include <boost/unordered_map.hpp>
 #include "zcash/IncrementalMerkleTree.hpp"
@@ -25,6 +29,8 @@ class CBlockTreeDB;
 class CTxInUndo;
 class CSidechainUndoData;
 class CScProofVerifier;
+class CCheckJob;
+template <typename T> class CCheckQueue;
 
 struct CTxIndexValue;
 struct CMaturityHeightValue;
@@ -318,6 +324,7 @@ struct CCoinsCacheEntry
     enum Flags {
         DIRTY = (1 << 0), // This cache entry is potentially different from the version in the parent view.
         FRESH = (1 << 1), // The parent view does not have this entry (or it is pruned).
+        RECENT = (1 << 2), // Accessed since the last sweep of FlushAndTrim, which keeps it for another one.
     };
 
     CCoinsCacheEntry() : coins(), flags(0) {}
@@ -456,7 +463,7 @@ struct CCswNullifiersCacheEntry: public CImmutableSidechainCacheEntry
     CCswNullifiersCacheEntry(Flags _flag = Flags::DEFAULT): CImmutableSidechainCacheEntry(_flag) {}
 };
 
-typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher>      CCoinsMap;
+typedef FlatHashMap<uint256, CCoinsCacheEntry, CCoinsKeyHasher>               CCoinsMap;
 typedef boost::unordered_map<uint256, CAnchorsCacheEntry, CCoinsKeyHasher>    CAnchorsMap;
 typedef boost::unordered_map<uint256, CNullifiersCacheEntry, CCoinsKeyHasher> CNullifiersMap;
 
@@ -473,8 +480,12 @@ struct CCoinsStats
     uint64_t nSerializedSize;
     uint256 hashSerialized;
     CAmount nTotalAmount;
+    uint64_t nCswNullifierFilterElements;
+    uint64_t nCswNullifierFilterUsage;
+    double dCswNullifierFilterFPRate;
 
-    CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0) {}
+    CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0),
+        nCswNullifierFilterElements(0), nCswNullifierFilterUsage(0), dCswNullifierFilterFPRate(0.0) {}
 };
 
 
@@ -510,6 +521,9 @@ public:
     //! Retrieve all the known sidechain ids
     virtual void GetScIds(std::set<uint256>& scIdsList) const;
 
+    //! Retrieve the ids of the confirmed sidechains whose scheduled ceasing height is in [minHeight, maxHeight]
+    virtual void GetScIdsByCeasingHeight(int minHeight, int maxHeight, std::set<uint256>& scIdsList) const;
+
     //! Check if cert has enough quality to be accepted
     virtual bool CheckQuality(const CScCertificate& cert) const;
 
@@ -534,6 +548,9 @@ public:
                             CSidechainEventsMap& mapCeasedScs,
                             CCswNullifiersMap& cswNullifiers);
 
+    //! Wait until the modifications already accepted by BatchWrite are persisted, in case it completes them asynchronously
+    virtual bool Sync();
+
     //! Calculate statistics about the unspent transaction output set
     virtual bool GetStats(CCoinsStats &stats) const;
 
@@ -559,6 +576,8 @@ public:
     bool HaveSidechainEvents(int height)                               const override;
     bool GetSidechainEvents(int height, CSidechainEvents& scEvents)    const override;
     void GetScIds(std::set<uint256>& scIdsList)                        const override;
+    void GetScIdsByCeasingHeight(int minHeight, int maxHeight,
+                                 std::set<uint256>& scIdsList)         const override;
     bool CheckQuality(const CScCertificate& cert)                      const override;
     uint256 GetBestBlock()                                             const override;
     uint256 GetBestAnchor()                                            const override;
@@ -573,6 +592,7 @@ public:
                     CSidechainsMap& mapSidechains,
                     CSidechainEventsMap& mapCeasedScs,
                     CCswNullifiersMap& cswNullifiers)                  override;
+    bool Sync()                                                              override;
     bool GetStats(CCoinsStats &stats)                                  const override;
 };
 
@@ -637,6 +657,8 @@ public:
     uint256 GetBestAnchor()                                            const override;
     int GetHeight() const; // Return view height, which is inputs.GetBestBlock() (aka parent block) one.
     void SetBestBlock(const uint256 &hashBlock);
+    //! Forget the best block and anchor, to read them again from the base view after the latter has been replaced. Requires an empty cache.
+    void ResetBestBlock();
     size_t WriteCoins(const uint256& key, CCoinsCacheEntry& value);
     bool BatchWrite(CCoinsMap &mapCoins,
                     const uint256 &hashBlock,
@@ -673,6 +695,14 @@ public:
      */
     CCoinsModifier ModifyCoins(const uint256 &txid);
 
+    /**
+     * Read in advance the coins of txids and the sidechains of scIds missing from this cache,
+     * as jobs of pqueue, so that the reads of the base view run in parallel rather than one at
+     * a time as they are needed. The base view must support concurrent reads, as the database
+     * does. Nothing is read without a queue.
+     */
+    void Prefetch(const std::vector<uint256>& txids, const std::vector<uint256>& scIds, CCheckQueue<CCheckJob>* pqueue) const;
+
     /**
      * Push the modifications applied to this cache to its base.
      * Failure to call this method before destruction will cause the changes to be forgotten.
@@ -683,6 +713,8 @@ public:
     bool HaveSidechain(const uint256& scId)                           const override;
     bool GetSidechain(const uint256 & scId, CSidechain& targetSidechain) const override;
     void GetScIds(std::set<uint256>& scIdsList)                       const override;
+    void GetScIdsByCeasingHeight(int minHeight, int maxHeight,
+                                 std::set<uint256>& scIdsList)        const override;
 
     CValidationState::Code IsScTxApplicableToState(const CTransaction& tx, Sidechain::ScFeeCheckFlag scCheckTypeconst, const CCoinsViewCache* pcoinsView = nullptr) const;
     bool CheckScTxTiming(const uint256& scId) const;
@@ -762,6 +794,19 @@ public:
 
     bool Flush();
 
+    //! Drop the whole content, modifications included, to be used again on baseIn: the coins map keeps its memory
+    void Reset(CCoinsView* baseIn);
+
+    /**
+     * Write the modifications to the base view as Flush, but keep the coins: the ones not accessed since the
+     * previous call are evicted, the oldest first as a CLOCK sweep, only until the cache is within nTargetUsage
+     * bytes, so that the entries in use stay in memory.
+     */
+    bool FlushAndTrim(size_t nTargetUsage);
+
+    //! The memory of the coins entries as FlushAndTrim counts it, the map rebuilt without its free slots
+    size_t CoinsEntriesUsage() const;
+
     //! Calculate the size of the cache (in number of transactions)
     unsigned int GetCacheSize() const;
 
@@ -805,4 +850,50 @@ private:
     bool DecrementImmatureAmount(const uint256& scId, const CSidechainsMap::iterator& targetEntry, CAmount nValue, int maturityHeight);
 };
 
+/**
+ * The views over an empty view the mempool admissions cache the inputs of a transaction in, reset and used again
+ * by the next admissions rather than built and destroyed for each transaction: their maps keep the chunks and the
+ * index they allocated.
+ */
+class CCoinsViewCachePool
+{
+public:
+    //! The idle views kept, and the memory above which a view is destroyed rather than kept
+    CCoinsViewCachePool(size_t nMaxIdleIn, size_t nMaxIdleUsageIn) : nMaxIdle(nMaxIdleIn), nMaxIdleUsage(nMaxIdleUsageIn) {}
+
+    //! A view of the pool, given back to it when destroyed
+    class CLease
+    {
+    public:
+        CLease(CCoinsViewCachePool* poolIn, std::unique_ptr<CCoinsViewCache> viewIn) : pool(poolIn), view(std::move(viewIn)) {}
+        CLease(CLease&& other) : pool(other.pool), view(std::move(other.view)) {}
+        ~CLease() { if (view) pool->Release(std::move(view)); }
+
+        CCoinsViewCache& operator*() const { return *view; }
+        CCoinsViewCache* operator->() const { return view.get(); }
+
+    private:
+        CLease(const CLease&);
+        CLease& operator=(const CLease&);
+
+        CCoinsViewCachePool* pool;
+        std::unique_ptr<CCoinsViewCache> view;
+    };
+
+    //! An empty view, over GetEmptyView()
+    CLease Acquire();
+
+    //! The view to switch the backend of a leased view back to, once done with the view of the mempool
+    CCoinsView& GetEmptyView() { return empty; }
+
+private:
+    void Release(std::unique_ptr<CCoinsViewCache> view);
+
+    CCoinsView empty;
+    std::mutex mutex;
+    std::vector<std::unique_ptr<CCoinsViewCache> > vIdle;
+    const size_t nMaxIdle;
+    const size_t nMaxIdleUsage;
+};
+
 #endif // BITCOIN_COINS_H
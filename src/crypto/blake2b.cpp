@@ -0,0 +1,173 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/blake2b.h"
+
+#include "crypto/common.h"
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(ENABLE_AVX2)
+namespace blake2b_avx2
+{
+void CompressLast_4way(uint64_t out[4][8], const uint64_t h[8], const unsigned char blocks[4][128], uint64_t t);
+}
+#endif
+
+namespace blake2b
+{
+const uint64_t IV[8] = {
+    0x6a09e667f3bcc908ull, 0xbb67ae8584caa73bull, 0x3c6ef372fe94f82bull, 0xa54ff53a5f1d36f1ull,
+    0x510e527fade682d1ull, 0x9b05688c2b3e6c1full, 0x1f83d9abfb41bd6bull, 0x5be0cd19137e2179ull
+};
+
+const uint8_t SIGMA[12][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3}
+};
+
+uint64_t inline RotR(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+void inline G(uint64_t& a, uint64_t& b, uint64_t& c, uint64_t& d, uint64_t x, uint64_t y)
+{
+    a = a + b + x;
+    d = RotR(d ^ a, 32);
+    c = c + d;
+    b = RotR(b ^ c, 24);
+    a = a + b + y;
+    d = RotR(d ^ a, 16);
+    c = c + d;
+    b = RotR(b ^ c, 63);
+}
+
+/** Compress a block into h, t being the bytes hashed including the block. */
+void Compress(uint64_t* h, const unsigned char* block, uint64_t t, bool fLast)
+{
+    uint64_t m[16], v[16];
+    for (int i = 0; i < 16; i++)
+        m[i] = ReadLE64(block + 8 * i);
+    for (int i = 0; i < 8; i++) {
+        v[i] = h[i];
+        v[i + 8] = IV[i];
+    }
+    // the messages of the Equihash hashes are well below 2^64 bytes
+    v[12] ^= t;
+    if (fLast)
+        v[14] = ~v[14];
+
+    for (int r = 0; r < 12; r++) {
+        const uint8_t* s = SIGMA[r];
+        G(v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+        G(v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+        G(v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+        G(v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+        G(v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+        G(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+        G(v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+        G(v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+    }
+
+    for (int i = 0; i < 8; i++)
+        h[i] ^= v[i] ^ v[i + 8];
+}
+
+#if defined(ENABLE_AVX2)
+bool HaveAVX2()
+{
+#if defined(__x86_64__) || defined(__amd64__)
+    // the check of the CPU features also covers the saving of the AVX registers by the OS
+    static const bool fHaveAVX2 = __builtin_cpu_supports("avx2");
+    return fHaveAVX2;
+#else
+    return false;
+#endif
+}
+#endif
+
+} // namespace blake2b
+
+CBlake2bPrefix::CBlake2bPrefix(size_t outLenIn, const unsigned char personal[PERSONAL_SIZE], const unsigned char* prefix, size_t prefixLen) :
+    nCompressed(0), bufLen(0), outLen(outLenIn)
+{
+    assert(outLen > 0 && outLen <= OUTPUT_SIZE_MAX);
+    for (int i = 0; i < 8; i++)
+        h[i] = blake2b::IV[i];
+    // the parameter block: digest length, no key, fanout and depth 1, no salt
+    h[0] ^= 0x01010000ull ^ outLen;
+    h[6] ^= ReadLE64(personal);
+    h[7] ^= ReadLE64(personal + 8);
+
+    // the suffix follows, so that every full block of the prefix is compressed as not the last
+    while (prefixLen >= BLOCK_SIZE) {
+        nCompressed += BLOCK_SIZE;
+        blake2b::Compress(h, prefix, nCompressed, false);
+        prefix += BLOCK_SIZE;
+        prefixLen -= BLOCK_SIZE;
+    }
+    memcpy(buf, prefix, prefixLen);
+    bufLen = prefixLen;
+}
+
+void CBlake2bPrefix::HashSuffix(uint32_t suffix, unsigned char* out) const
+{
+    uint64_t hs[8];
+    memcpy(hs, h, sizeof(hs));
+    unsigned char block[2 * BLOCK_SIZE] = {};
+    memcpy(block, buf, bufLen);
+    WriteLE32(block + bufLen, suffix);
+
+    const size_t len = bufLen + sizeof(suffix);
+    if (len > BLOCK_SIZE) {
+        blake2b::Compress(hs, block, nCompressed + BLOCK_SIZE, false);
+        blake2b::Compress(hs, block + BLOCK_SIZE, nCompressed + len, true);
+    } else {
+        blake2b::Compress(hs, block, nCompressed + len, true);
+    }
+
+    unsigned char hash[OUTPUT_SIZE_MAX];
+    for (int i = 0; i < 8; i++)
+        WriteLE64(hash + 8 * i, hs[i]);
+    memcpy(out, hash, outLen);
+}
+
+void CBlake2bPrefix::HashSuffixes(const uint32_t* suffixes, size_t count, unsigned char* out) const
+{
+#if defined(ENABLE_AVX2)
+    // the four messages must end in the same block
+    if (blake2b::HaveAVX2() && bufLen + sizeof(uint32_t) <= BLOCK_SIZE) {
+        unsigned char blocks[4][BLOCK_SIZE] = {};
+        for (int lane = 0; lane < 4; lane++)
+            memcpy(blocks[lane], buf, bufLen);
+        const uint64_t t = nCompressed + bufLen + sizeof(uint32_t);
+        while (count >= 4) {
+            uint64_t hs[4][8];
+            for (int lane = 0; lane < 4; lane++)
+                WriteLE32(blocks[lane] + bufLen, suffixes[lane]);
+            blake2b_avx2::CompressLast_4way(hs, h, blocks, t);
+            for (int lane = 0; lane < 4; lane++) {
+                unsigned char hash[OUTPUT_SIZE_MAX];
+                for (int i = 0; i < 8; i++)
+                    WriteLE64(hash + 8 * i, hs[lane][i]);
+                memcpy(out + lane * outLen, hash, outLen);
+            }
+            suffixes += 4;
+            out += 4 * outLen;
+            count -= 4;
+        }
+    }
+#endif
+    for (size_t i = 0; i < count; i++)
+        HashSuffix(suffixes[i], out + i * outLen);
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_BLAKE2B_H
+#define BITCOIN_CRYPTO_BLAKE2B_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/**
+ * The personalized BLAKE2b hashes of many messages made of the same prefix and of a different
+ * 32-bit suffix, as the Equihash hashes of the indices: the full blocks of the prefix are
+ * compressed once, then the last blocks of the messages are compressed four at a time when
+ * the CPU supports AVX2.
+ */
+class CBlake2bPrefix
+{
+public:
+    static const size_t BLOCK_SIZE = 128;
+    static const size_t PERSONAL_SIZE = 16;
+    static const size_t OUTPUT_SIZE_MAX = 64;
+
+    CBlake2bPrefix(size_t outLenIn, const unsigned char personal[PERSONAL_SIZE], const unsigned char* prefix, size_t prefixLen);
+
+    /** The hashes of the prefix followed by each suffix, little endian, outLen bytes each at out */
+    void HashSuffixes(const uint32_t* suffixes, size_t count, unsigned char* out) const;
+
+private:
+    uint64_t h[8];
+    //! the bytes of the prefix compressed in h
+    uint64_t nCompressed;
+    unsigned char buf[BLOCK_SIZE];
+    size_t bufLen;
+    size_t outLen;
+
+    void HashSuffix(uint32_t suffix, unsigned char* out) const;
+};
+
+#endif // BITCOIN_CRYPTO_BLAKE2B_H
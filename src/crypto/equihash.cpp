@@ -17,6 +17,7 @@
 #endif
 
 #include "compat/endian.h"
+#include "crypto/blake2b.h"
 #include "crypto/equihash.h"
 #include "util.h"
 
@@ -29,15 +30,25 @@
 
 EhSolverCancelledException solver_cancelled;
 
-template<unsigned int N, unsigned int K>
-int Equihash<N,K>::InitialiseState(eh_HashState& base_state)
+/** The number of index hashes computed together by the multi-lane BLAKE2b */
+static const size_t EH_HASH_BATCH = 16;
+
+static void GetPersonalization(unsigned int N, unsigned int K, unsigned char personalization[crypto_generichash_blake2b_PERSONALBYTES])
 {
+    BOOST_STATIC_ASSERT(crypto_generichash_blake2b_PERSONALBYTES == CBlake2bPrefix::PERSONAL_SIZE);
     uint32_t le_N = htole32(N);
     uint32_t le_K = htole32(K);
-    unsigned char personalization[crypto_generichash_blake2b_PERSONALBYTES] = {};
+    memset(personalization, 0, crypto_generichash_blake2b_PERSONALBYTES);
     memcpy(personalization, "ZcashPoW", 8);
     memcpy(personalization+8,  &le_N, 4);
     memcpy(personalization+12, &le_K, 4);
+}
+
+template<unsigned int N, unsigned int K>
+int Equihash<N,K>::InitialiseState(eh_HashState& base_state)
+{
+    unsigned char personalization[crypto_generichash_blake2b_PERSONALBYTES];
+    GetPersonalization(N, K, personalization);
     return crypto_generichash_blake2b_init_salt_personal(&base_state,
                                                          NULL, 0, // No key.
                                                          (512/N)*N/8,
@@ -725,6 +736,54 @@ invalidsolution:
 }
 #endif // ENABLE_MINING
 
+/**
+ * Check the tree of a solution on the expanded hashes of its indices, the rows of each subtree being
+ * combined in place into the row of its first leaf. The indices of a valid tree are in the order of the
+ * solution and all distinct, so two subtrees are ordered by their first indices and the indices can be
+ * checked for duplicates all at once: the result is the same as checking the pairs level by level.
+ */
+template<unsigned int N, unsigned int K>
+static bool IsValidSolutionTree(const std::vector<eh_index>& indices, unsigned char (*rows)[Equihash<N,K>::HashLength])
+{
+    const size_t collisionLen = Equihash<N,K>::CollisionByteLength;
+    const size_t hashLen = Equihash<N,K>::HashLength;
+    assert(indices.size() == ((size_t)1 << K));
+
+    for (size_t r = 0; r < K; r++) {
+        const size_t width = (size_t)1 << r;
+        const size_t begin = r * collisionLen;
+        for (size_t left = 0; left < indices.size(); left += 2 * width) {
+            const size_t right = left + width;
+            if (memcmp(rows[left] + begin, rows[right] + begin, collisionLen) != 0) {
+                LogPrint("pow", "Invalid solution: invalid collision length between StepRows\n");
+                LogPrint("pow", "X[i]   = %s\n", HexStr(rows[left] + begin, rows[left] + hashLen));
+                LogPrint("pow", "X[i+1] = %s\n", HexStr(rows[right] + begin, rows[right] + hashLen));
+                return false;
+            }
+            if (indices[right] < indices[left]) {
+                LogPrint("pow", "Invalid solution: Index tree incorrectly ordered\n");
+                return false;
+            }
+            for (size_t i = begin + collisionLen; i < hashLen; i++)
+                rows[left][i] ^= rows[right][i];
+        }
+    }
+
+    eh_index sorted[1 << K];
+    std::copy(indices.begin(), indices.end(), sorted);
+    std::sort(sorted, sorted + indices.size());
+    if (std::adjacent_find(sorted, sorted + indices.size()) != sorted + indices.size()) {
+        LogPrint("pow", "Invalid solution: duplicate indices\n");
+        return false;
+    }
+
+    for (size_t i = K * collisionLen; i < hashLen; i++) {
+        if (rows[0][i] != 0)
+            return false;
+    }
+    return true;
+}
+
 template<unsigned int N, unsigned int K>
 bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln)
 {
@@ -734,43 +793,46 @@ bool Equihash<N,K>::IsValidSolution(const eh_HashState& base_state, std::vector<
         return false;
     }
 
-    std::vector<FullStepRow<FinalFullWidth>> X;
-    X.reserve(1 << K);
+    std::vector<eh_index> indices = GetIndicesFromMinimal(soln, CollisionBitLength);
+    unsigned char rows[1 << K][HashLength];
     unsigned char tmpHash[HashOutput];
-    for (eh_index i : GetIndicesFromMinimal(soln, CollisionBitLength)) {
-        GenerateHash(base_state, i/IndicesPerHashOutput, tmpHash, HashOutput);
-        X.emplace_back(tmpHash+((i % IndicesPerHashOutput) * N/8),
-                       N/8, HashLength, CollisionBitLength, i);
+    for (size_t n = 0; n < indices.size(); n++) {
+        GenerateHash(base_state, indices[n]/IndicesPerHashOutput, tmpHash, HashOutput);
+        ExpandArray(tmpHash+((indices[n] % IndicesPerHashOutput) * N/8), N/8,
+                    rows[n], HashLength, CollisionBitLength);
     }
+    return IsValidSolutionTree<N,K>(indices, rows);
+}
 
-    size_t hashLen = HashLength;
-    size_t lenIndices = sizeof(eh_index);
-    while (X.size() > 1) {
-        std::vector<FullStepRow<FinalFullWidth>> Xc;
-        for (int i = 0; i < X.size(); i += 2) {
-            if (!HasCollision(X[i], X[i+1], CollisionByteLength)) {
-                LogPrint("pow", "Invalid solution: invalid collision length between StepRows\n");
-                LogPrint("pow", "X[i]   = %s\n", X[i].GetHex(hashLen));
-                LogPrint("pow", "X[i+1] = %s\n", X[i+1].GetHex(hashLen));
-                return false;
-            }
-            if (X[i+1].IndicesBefore(X[i], hashLen, lenIndices)) {
-                LogPrint("pow", "Invalid solution: Index tree incorrectly ordered\n");
-                return false;
-            }
-            if (!DistinctIndices(X[i], X[i+1], hashLen, lenIndices)) {
-                LogPrint("pow", "Invalid solution: duplicate indices\n");
-                return false;
-            }
-            Xc.emplace_back(X[i], X[i+1], hashLen, lenIndices, CollisionByteLength);
-        }
-        X = Xc;
-        hashLen -= CollisionByteLength;
-        lenIndices *= 2;
+template<unsigned int N, unsigned int K>
+bool Equihash<N,K>::IsValidSolution(const unsigned char* input, size_t inputLen, const std::vector<unsigned char>& soln)
+{
+    if (soln.size() != SolutionWidth) {
+        LogPrint("pow", "Invalid solution length: %d (expected %d)\n",
+                 soln.size(), SolutionWidth);
+        return false;
     }
 
-    assert(X.size() == 1);
-    return X[0].IsZero(hashLen);
+    std::vector<eh_index> indices = GetIndicesFromMinimal(soln, CollisionBitLength);
+    unsigned char personalization[crypto_generichash_blake2b_PERSONALBYTES];
+    GetPersonalization(N, K, personalization);
+    // H(I||V||... of all the indices, only the blocks after I||V are compressed for each of them
+    const CBlake2bPrefix prefix(HashOutput, personalization, input, inputLen);
+
+    unsigned char rows[1 << K][HashLength];
+    for (size_t first = 0; first < indices.size(); first += EH_HASH_BATCH) {
+        const size_t count = std::min(EH_HASH_BATCH, indices.size() - first);
+        uint32_t hashIndices[EH_HASH_BATCH];
+        unsigned char hashes[EH_HASH_BATCH][HashOutput];
+        for (size_t n = 0; n < count; n++)
+            hashIndices[n] = indices[first+n]/IndicesPerHashOutput;
+        prefix.HashSuffixes(hashIndices, count, hashes[0]);
+        for (size_t n = 0; n < count; n++) {
+            ExpandArray(hashes[n]+((indices[first+n] % IndicesPerHashOutput) * N/8), N/8,
+                        rows[first+n], HashLength, CollisionBitLength);
+        }
+    }
+    return IsValidSolutionTree<N,K>(indices, rows);
 }
 
 // Explicit instantiations for Equihash<96,3>
@@ -784,6 +846,7 @@ template bool Equihash<96,3>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
 template bool Equihash<96,3>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<96,3>::IsValidSolution(const unsigned char* input, size_t inputLen, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<200,9>
 template int Equihash<200,9>::InitialiseState(eh_HashState& base_state);
@@ -796,6 +859,7 @@ template bool Equihash<200,9>::OptimisedSolve(const eh_HashState& base_state,
                                               const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
 template bool Equihash<200,9>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<200,9>::IsValidSolution(const unsigned char* input, size_t inputLen, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<96,5>
 template int Equihash<96,5>::InitialiseState(eh_HashState& base_state);
@@ -808,6 +872,7 @@ template bool Equihash<96,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
 template bool Equihash<96,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<96,5>::IsValidSolution(const unsigned char* input, size_t inputLen, const std::vector<unsigned char>& soln);
 
 // Explicit instantiations for Equihash<48,5>
 template int Equihash<48,5>::InitialiseState(eh_HashState& base_state);
@@ -820,3 +885,4 @@ template bool Equihash<48,5>::OptimisedSolve(const eh_HashState& base_state,
                                              const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
 template bool Equihash<48,5>::IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+template bool Equihash<48,5>::IsValidSolution(const unsigned char* input, size_t inputLen, const std::vector<unsigned char>& soln);
@@ -191,6 +191,8 @@ public:
                         const std::function<bool(EhSolverCancelCheck)> cancelled);
 #endif
     bool IsValidSolution(const eh_HashState& base_state, std::vector<unsigned char> soln);
+    // The same check from the input I||V itself, whose index hashes are computed in batches
+    bool IsValidSolution(const unsigned char* input, size_t inputLen, const std::vector<unsigned char>& soln);
 };
 
 #include "equihash.tcc"
@@ -276,4 +278,20 @@ inline bool EhOptimisedSolveUncancellable(unsigned int n, unsigned int k, const
         throw std::invalid_argument("Unsupported Equihash parameters"); \
     }
 
+inline bool EhIsValidSolutionForInput(unsigned int n, unsigned int k, const unsigned char* input, size_t inputLen,
+                                      const std::vector<unsigned char>& soln)
+{
+    if (n == 96 && k == 3) {
+        return Eh96_3.IsValidSolution(input, inputLen, soln);
+    } else if (n == 200 && k == 9) {
+        return Eh200_9.IsValidSolution(input, inputLen, soln);
+    } else if (n == 96 && k == 5) {
+        return Eh96_5.IsValidSolution(input, inputLen, soln);
+    } else if (n == 48 && k == 5) {
+        return Eh48_5.IsValidSolution(input, inputLen, soln);
+    } else {
+        throw std::invalid_argument("Unsupported Equihash parameters");
+    }
+}
+
 #endif // BITCOIN_EQUIHASH_H
@@ -0,0 +1,178 @@
+// Copyright (c) 2017-2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/muhash.h"
+
+#include "crypto/common.h"
+#include "crypto/sha256.h"
+
+#include <limits>
+
+namespace {
+
+/** 2^3072 - MAX_PRIME_DIFF is the largest prime below 2^3072. */
+const uint64_t MAX_PRIME_DIFF = 1103717;
+
+typedef unsigned __int128 uint128_t;
+
+}
+
+Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE])
+{
+    for (size_t i = 0; i < LIMBS; ++i)
+        limbs[i] = ReadLE64(data + 8 * i);
+}
+
+void Num3072::SetToOne()
+{
+    limbs[0] = 1;
+    for (size_t i = 1; i < LIMBS; ++i)
+        limbs[i] = 0;
+}
+
+bool Num3072::IsOverflow() const
+{
+    if (limbs[0] < std::numeric_limits<uint64_t>::max() - MAX_PRIME_DIFF + 1)
+        return false;
+    for (size_t i = 1; i < LIMBS; ++i) {
+        if (limbs[i] != std::numeric_limits<uint64_t>::max())
+            return false;
+    }
+    return true;
+}
+
+void Num3072::FullReduce()
+{
+    if (!IsOverflow())
+        return;
+
+    // Subtracting the modulus is adding MAX_PRIME_DIFF and dropping the carry out of the top limb
+    uint128_t acc = MAX_PRIME_DIFF;
+    for (size_t i = 0; i < LIMBS; ++i) {
+        acc += limbs[i];
+        limbs[i] = static_cast<uint64_t>(acc);
+        acc >>= 64;
+    }
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    uint64_t product[2 * LIMBS] = {0};
+
+    // Schoolbook multiplication into a 6144 bit product
+    for (size_t i = 0; i < LIMBS; ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < LIMBS; ++j) {
+            uint128_t cur = static_cast<uint128_t>(limbs[i]) * a.limbs[j] + product[i + j] + carry;
+            product[i + j] = static_cast<uint64_t>(cur);
+            carry = static_cast<uint64_t>(cur >> 64);
+        }
+        product[i + LIMBS] = carry;
+    }
+
+    // Reduce using 2^3072 = MAX_PRIME_DIFF (mod p): low + high * MAX_PRIME_DIFF
+    uint64_t carry = 0;
+    for (size_t i = 0; i < LIMBS; ++i) {
+        uint128_t cur = static_cast<uint128_t>(product[LIMBS + i]) * MAX_PRIME_DIFF + product[i] + carry;
+        limbs[i] = static_cast<uint64_t>(cur);
+        carry = static_cast<uint64_t>(cur >> 64);
+    }
+
+    // Fold whatever overflows 3072 bits back, until nothing does
+    while (carry != 0) {
+        uint128_t acc = static_cast<uint128_t>(carry) * MAX_PRIME_DIFF;
+        for (size_t i = 0; i < LIMBS; ++i) {
+            acc += limbs[i];
+            limbs[i] = static_cast<uint64_t>(acc);
+            acc >>= 64;
+        }
+        carry = static_cast<uint64_t>(acc);
+    }
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // Fermat's little theorem: a^-1 = a^(p-2) (mod p), by left to right binary exponentiation
+    uint64_t exponent[LIMBS];
+    exponent[0] = std::numeric_limits<uint64_t>::max() - MAX_PRIME_DIFF - 1;
+    for (size_t i = 1; i < LIMBS; ++i)
+        exponent[i] = std::numeric_limits<uint64_t>::max();
+
+    Num3072 result;
+    for (size_t i = LIMBS; i-- > 0;) {
+        for (int bit = 63; bit >= 0; --bit) {
+            result.Multiply(result);
+            if ((exponent[i] >> bit) & 1)
+                result.Multiply(*this);
+        }
+    }
+    return result;
+}
+
+void Num3072::Divide(const Num3072& a)
+{
+    Multiply(a.GetInverse());
+}
+
+void Num3072::ToBytes(unsigned char (&out)[BYTE_SIZE])
+{
+    FullReduce();
+    for (size_t i = 0; i < LIMBS; ++i)
+        WriteLE64(out + 8 * i, limbs[i]);
+}
+
+Num3072 MuHash3072::ToNum3072(const std::vector<unsigned char>& in)
+{
+    // Expand the SHA256 of the element to 3072 bits in counter mode
+    unsigned char seed[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(in.data(), in.size()).Finalize(seed);
+
+    unsigned char data[Num3072::BYTE_SIZE];
+    static_assert(Num3072::BYTE_SIZE % CSHA256::OUTPUT_SIZE == 0, "Num3072 size must be a multiple of the SHA256 output size");
+    for (uint32_t i = 0; i < Num3072::BYTE_SIZE / CSHA256::OUTPUT_SIZE; ++i) {
+        unsigned char counter[4];
+        WriteLE32(counter, i);
+        CSHA256().Write(seed, sizeof(seed)).Write(counter, sizeof(counter)).Finalize(data + i * CSHA256::OUTPUT_SIZE);
+    }
+    return Num3072(data);
+}
+
+MuHash3072::MuHash3072(const std::vector<unsigned char>& in) : numerator(ToNum3072(in)) {}
+
+MuHash3072& MuHash3072::Insert(const std::vector<unsigned char>& in)
+{
+    numerator.Multiply(ToNum3072(in));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const std::vector<unsigned char>& in)
+{
+    denominator.Multiply(ToNum3072(in));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& mul)
+{
+    numerator.Multiply(mul.numerator);
+    denominator.Multiply(mul.denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& div)
+{
+    numerator.Multiply(div.denominator);
+    denominator.Multiply(div.numerator);
+    return *this;
+}
+
+void MuHash3072::Finalize(uint256& out)
+{
+    // Keep the normalized value, with a denominator of one
+    numerator.Divide(denominator);
+    denominator.SetToOne();
+
+    unsigned char data[Num3072::BYTE_SIZE];
+    numerator.ToBytes(data);
+    CSHA256().Write(data, sizeof(data)).Finalize(out.begin());
+}
@@ -0,0 +1,93 @@
+// Copyright (c) 2017-2020 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_MUHASH_H
+#define BITCOIN_CRYPTO_MUHASH_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <stdint.h>
+#include <vector>
+
+/** A class representing a number modulo the prime 2^3072 - 1103717. */
+class Num3072
+{
+public:
+    static const size_t BYTE_SIZE = 384;
+    static const size_t LIMBS = 48;
+
+    Num3072() { SetToOne(); }
+    explicit Num3072(const unsigned char (&data)[BYTE_SIZE]);
+
+    void SetToOne();
+    void Multiply(const Num3072& a);
+    void Divide(const Num3072& a);
+    void ToBytes(unsigned char (&out)[BYTE_SIZE]);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        for (size_t i = 0; i < LIMBS; ++i)
+            READWRITE(limbs[i]);
+    }
+
+private:
+    /** Limbs in little endian order. The value may exceed the modulus (but not 2^3072) until FullReduce. */
+    uint64_t limbs[LIMBS];
+
+    bool IsOverflow() const;
+    void FullReduce();
+    Num3072 GetInverse() const;
+};
+
+/**
+ * A multiplicative hash of a set of byte strings, as in "Elliptic Curve Multiset Hash" by Maitin-Shepard
+ * et al, but working in the multiplicative group of the integers modulo a 3072 bit prime.
+ *
+ * Elements are hashed to numbers modulo the prime and multiplied together, so the result does not
+ * depend on the order of insertion, elements can be removed by dividing by them, and the hashes of
+ * disjoint sets can be combined by multiplication. This allows to compute the hash of a big set in
+ * parallel chunks, and to keep it up to date incrementally.
+ *
+ * Divisions are deferred to Finalize by keeping a separate denominator, since only multiplications
+ * are cheap.
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+    static Num3072 ToNum3072(const std::vector<unsigned char>& in);
+
+public:
+    /** Create the hash of the empty set. */
+    MuHash3072() {}
+
+    /** Create the hash of a set containing only in. */
+    explicit MuHash3072(const std::vector<unsigned char>& in);
+
+    MuHash3072& Insert(const std::vector<unsigned char>& in);
+    MuHash3072& Remove(const std::vector<unsigned char>& in);
+
+    /** Combine with the hash of a disjoint set (union). */
+    MuHash3072& operator*=(const MuHash3072& mul);
+    /** Combine with the hash of a subset (difference). */
+    MuHash3072& operator/=(const MuHash3072& div);
+
+    /** Compute the 256 bit hash of the set. This performs an expensive modular inversion. */
+    void Finalize(uint256& out);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(numerator);
+        READWRITE(denominator);
+    }
+};
+
+#endif // BITCOIN_CRYPTO_MUHASH_H
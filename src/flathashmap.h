@@ -0,0 +1,390 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_FLATHASHMAP_H
+#define BITCOIN_FLATHASHMAP_H
+
+#include "memusage.h"
+#include "support/largepages.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * STL-like unordered map built on an open-addressing (linear probing) index.
+ *
+ * Values are stored inline in fixed size chunks of slots, so that - like with
+ * a node based map - references and pointers to the elements stay valid until
+ * the element itself is erased, no matter how many other elements are inserted.
+ * The index only holds a 32 bit slot number and 32 bits of the hash for every
+ * bucket: lookups touch a single contiguous array and only dereference a slot
+ * when the hash tag matches, and growing the map never moves the values.
+ *
+ * Iteration walks the slots in storage order. Erasing an element invalidates
+ * only the iterators pointing to it, so the erase(it++) idiom is supported.
+ *
+ * The chunks and the index are allocated through LargePages, on huge pages when
+ * -largepages is enabled.
+ */
+template <typename K, typename V, typename Hash>
+class FlatHashMap
+{
+public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<const K, V> value_type;
+    typedef size_t size_type;
+
+private:
+    static const uint32_t EMPTY_BUCKET = 0xFFFFFFFF;
+    static const uint32_t DELETED_BUCKET = 0xFFFFFFFE;
+    static const size_t CHUNK_SLOTS = 256;
+    static const size_t MIN_BUCKETS = 16;
+
+    struct Bucket
+    {
+        uint32_t slot;
+        uint32_t tag;
+    };
+
+    struct Slot
+    {
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+        size_t hash;
+        bool used;
+
+        value_type& value() { return *std::launder(reinterpret_cast<value_type*>(&storage)); }
+        const value_type& value() const { return *std::launder(reinterpret_cast<const value_type*>(&storage)); }
+    };
+
+    typedef std::vector<Bucket, large_pages_allocator<Bucket>> BucketVector;
+
+    std::vector<Slot*> chunks;
+    BucketVector buckets;
+    std::vector<uint32_t> freeSlots;
+    size_t nSlots;     // high water mark of the allocated slots
+    size_t nElements;
+    size_t nDeleted;   // buckets marked as DELETED_BUCKET
+    Hash hasher;
+
+    Slot& GetSlot(size_t n) { return chunks[n / CHUNK_SLOTS][n % CHUNK_SLOTS]; }
+    const Slot& GetSlot(size_t n) const { return chunks[n / CHUNK_SLOTS][n % CHUNK_SLOTS]; }
+
+    static uint32_t Tag(size_t hash) { return static_cast<uint32_t>(static_cast<uint64_t>(hash) >> 32) ^ static_cast<uint32_t>(hash); }
+
+    size_t FirstUsed(size_t n) const
+    {
+        while (n < nSlots && !GetSlot(n).used)
+            ++n;
+        return n;
+    }
+
+    /** Return the bucket holding key, or the EMPTY/DELETED bucket where it should be placed. */
+    size_t FindBucket(const K& key, size_t hash, bool& found) const
+    {
+        const size_t mask = buckets.size() - 1;
+        const uint32_t tag = Tag(hash);
+        size_t pos = hash & mask;
+        size_t firstDeleted = buckets.size();
+        found = false;
+        while (true) {
+            const Bucket& b = buckets[pos];
+            if (b.slot == EMPTY_BUCKET)
+                return firstDeleted != buckets.size() ? firstDeleted : pos;
+            if (b.slot == DELETED_BUCKET) {
+                if (firstDeleted == buckets.size())
+                    firstDeleted = pos;
+            } else if (b.tag == tag && GetSlot(b.slot).value().first == key) {
+                found = true;
+                return pos;
+            }
+            pos = (pos + 1) & mask;
+        }
+    }
+
+    /** Return the bucket pointing to the given slot, which must be in use. */
+    size_t FindBucketOfSlot(size_t n) const
+    {
+        const size_t mask = buckets.size() - 1;
+        size_t pos = GetSlot(n).hash & mask;
+        while (buckets[pos].slot != n) {
+            assert(buckets[pos].slot != EMPTY_BUCKET);
+            pos = (pos + 1) & mask;
+        }
+        return pos;
+    }
+
+    static size_t AllocationUsage(size_t nBytes)
+    {
+        return LargePages::IsEnabled() ? LargePages::Usage(nBytes) : memusage::MallocUsage(nBytes);
+    }
+
+    void Rehash(size_t nBuckets)
+    {
+        BucketVector newBuckets(nBuckets, Bucket{EMPTY_BUCKET, 0});
+        const size_t mask = nBuckets - 1;
+        for (size_t n = 0; n < nSlots; ++n) {
+            const Slot& slot = GetSlot(n);
+            if (!slot.used)
+                continue;
+            size_t pos = slot.hash & mask;
+            while (newBuckets[pos].slot != EMPTY_BUCKET)
+                pos = (pos + 1) & mask;
+            newBuckets[pos].slot = n;
+            newBuckets[pos].tag = Tag(slot.hash);
+        }
+        buckets.swap(newBuckets);
+        nDeleted = 0;
+    }
+
+    /** Make room for one more element, keeping the load (deleted buckets included) below 7/8. */
+    void Reserve()
+    {
+        if (buckets.empty()) {
+            Rehash(MIN_BUCKETS);
+        } else if ((nElements + nDeleted + 1) * 8 > buckets.size() * 7) {
+            // Only grow when live elements fill the index, otherwise just purge the deleted buckets.
+            Rehash((nElements + 1) * 2 > buckets.size() ? buckets.size() * 2 : buckets.size());
+        }
+    }
+
+    size_t AllocateSlot()
+    {
+        if (!freeSlots.empty()) {
+            size_t n = freeSlots.back();
+            freeSlots.pop_back();
+            return n;
+        }
+        if (nSlots == chunks.size() * CHUNK_SLOTS) {
+            chunks.reserve(chunks.size() + 1);
+            Slot* chunk = static_cast<Slot*>(LargePages::Allocate(sizeof(Slot) * CHUNK_SLOTS));
+            for (size_t i = 0; i < CHUNK_SLOTS; ++i) {
+                Slot* slot = new (&chunk[i]) Slot;
+                slot->used = false;
+            }
+            chunks.push_back(chunk);
+        }
+        return nSlots++;
+    }
+
+    template <typename Map, typename Value>
+    class iterator_base
+    {
+        friend class FlatHashMap;
+        Map* map;
+        size_t pos;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename std::remove_const<Value>::type value_type;
+        typedef ptrdiff_t difference_type;
+        typedef Value* pointer;
+        typedef Value& reference;
+
+        iterator_base() : map(nullptr), pos(0) {}
+        iterator_base(Map* mapIn, size_t posIn) : map(mapIn), pos(posIn) {}
+        template <typename OtherMap, typename OtherValue>
+        iterator_base(const iterator_base<OtherMap, OtherValue>& other) : map(other.map), pos(other.pos) {}
+
+        reference operator*() const { return map->GetSlot(pos).value(); }
+        pointer operator->() const { return &map->GetSlot(pos).value(); }
+        iterator_base& operator++() { pos = map->FirstUsed(pos + 1); return *this; }
+        iterator_base operator++(int) { iterator_base ret = *this; ++(*this); return ret; }
+
+        template <typename OtherMap, typename OtherValue>
+        bool operator==(const iterator_base<OtherMap, OtherValue>& other) const { return pos == other.pos; }
+        template <typename OtherMap, typename OtherValue>
+        bool operator!=(const iterator_base<OtherMap, OtherValue>& other) const { return pos != other.pos; }
+
+        template <typename, typename> friend class iterator_base;
+    };
+
+public:
+    typedef iterator_base<FlatHashMap, value_type> iterator;
+    typedef iterator_base<const FlatHashMap, const value_type> const_iterator;
+
+    FlatHashMap() : nSlots(0), nElements(0), nDeleted(0) {}
+    FlatHashMap(const FlatHashMap& other) : nSlots(0), nElements(0), nDeleted(0), hasher(other.hasher)
+    {
+        for (const_iterator it = other.begin(); it != other.end(); ++it)
+            insert(*it);
+    }
+    FlatHashMap& operator=(const FlatHashMap& other)
+    {
+        if (this != &other) {
+            FlatHashMap tmp(other);
+            swap(tmp);
+        }
+        return *this;
+    }
+    ~FlatHashMap() { clear(); }
+
+    iterator begin() { return iterator(this, FirstUsed(0)); }
+    iterator end() { return iterator(this, nSlots); }
+    const_iterator begin() const { return const_iterator(this, FirstUsed(0)); }
+    const_iterator end() const { return const_iterator(this, nSlots); }
+
+    size_type size() const { return nElements; }
+    bool empty() const { return nElements == 0; }
+    size_type bucket_count() const { return buckets.size(); }
+
+    iterator find(const K& key)
+    {
+        if (nElements == 0)
+            return end();
+        bool found;
+        size_t pos = FindBucket(key, hasher(key), found);
+        return found ? iterator(this, buckets[pos].slot) : end();
+    }
+
+    const_iterator find(const K& key) const
+    {
+        if (nElements == 0)
+            return end();
+        bool found;
+        size_t pos = FindBucket(key, hasher(key), found);
+        return found ? const_iterator(this, buckets[pos].slot) : end();
+    }
+
+    size_type count(const K& key) const { return find(key) != end() ? 1 : 0; }
+
+    std::pair<iterator, bool> insert(const value_type& value)
+    {
+        Reserve();
+        const size_t hash = hasher(value.first);
+        bool found;
+        size_t pos = FindBucket(value.first, hash, found);
+        if (found)
+            return std::make_pair(iterator(this, buckets[pos].slot), false);
+
+        size_t n = AllocateSlot();
+        Slot& slot = GetSlot(n);
+        try {
+            new (&slot.storage) value_type(value);
+        } catch (...) {
+            freeSlots.push_back(n);
+            throw;
+        }
+        slot.hash = hash;
+        slot.used = true;
+        if (buckets[pos].slot == DELETED_BUCKET)
+            --nDeleted;
+        buckets[pos].slot = n;
+        buckets[pos].tag = Tag(hash);
+        ++nElements;
+        return std::make_pair(iterator(this, n), true);
+    }
+
+    std::pair<iterator, bool> emplace(const K& key, const V& value) { return insert(value_type(key, value)); }
+
+    V& operator[](const K& key)
+    {
+        iterator it = find(key);
+        if (it == end())
+            it = insert(value_type(key, V())).first;
+        return it->second;
+    }
+
+    iterator erase(const_iterator it)
+    {
+        const size_t n = it.pos;
+        Slot& slot = GetSlot(n);
+        assert(slot.used);
+        buckets[FindBucketOfSlot(n)].slot = DELETED_BUCKET;
+        ++nDeleted;
+        slot.value().~value_type();
+        slot.used = false;
+        freeSlots.push_back(n);
+        --nElements;
+        return iterator(this, FirstUsed(n + 1));
+    }
+
+    iterator erase(iterator it) { return erase(const_iterator(it)); }
+
+    size_type erase(const K& key)
+    {
+        iterator it = find(key);
+        if (it == end())
+            return 0;
+        erase(it);
+        return 1;
+    }
+
+    /** Destroy all the elements and release the memory held by the map. */
+    void clear()
+    {
+        for (size_t n = 0; n < nSlots; ++n) {
+            Slot& slot = GetSlot(n);
+            if (slot.used) {
+                slot.value().~value_type();
+                slot.used = false;
+            }
+        }
+        for (Slot* chunk : chunks)
+            LargePages::Free(chunk, sizeof(Slot) * CHUNK_SLOTS);
+        std::vector<Slot*>().swap(chunks);
+        BucketVector().swap(buckets);
+        std::vector<uint32_t>().swap(freeSlots);
+        nSlots = 0;
+        nElements = 0;
+        nDeleted = 0;
+    }
+
+    /** Destroy all the elements, keeping the memory of the map for the next ones. */
+    void reset()
+    {
+        for (size_t n = 0; n < nSlots; ++n) {
+            Slot& slot = GetSlot(n);
+            if (slot.used) {
+                slot.value().~value_type();
+                slot.used = false;
+            }
+        }
+        std::fill(buckets.begin(), buckets.end(), Bucket{EMPTY_BUCKET, 0});
+        freeSlots.clear();
+        nSlots = 0;
+        nElements = 0;
+        nDeleted = 0;
+    }
+
+    void swap(FlatHashMap& other)
+    {
+        chunks.swap(other.chunks);
+        buckets.swap(other.buckets);
+        freeSlots.swap(other.freeSlots);
+        std::swap(nSlots, other.nSlots);
+        std::swap(nElements, other.nElements);
+        std::swap(nDeleted, other.nDeleted);
+        std::swap(hasher, other.hasher);
+    }
+
+    /** Heap memory held by the map itself, not accounting for memory owned by the elements. */
+    size_t DynamicMemoryUsage() const
+    {
+        return AllocationUsage(sizeof(Slot) * CHUNK_SLOTS) * chunks.size() +
+               memusage::DynamicUsage(chunks) +
+               (buckets.capacity() ? AllocationUsage(buckets.capacity() * sizeof(Bucket)) : 0) +
+               memusage::DynamicUsage(freeSlots);
+    }
+};
+
+namespace memusage
+{
+
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const FlatHashMap<X, Y, Z>& m)
+{
+    return m.DynamicMemoryUsage();
+}
+
+}
+
+#endif // BITCOIN_FLATHASHMAP_H
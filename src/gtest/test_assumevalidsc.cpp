@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include "main.h"
+
+#include <memory>
+#include <vector>
+
+class AssumeValidScTestSuite : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        originalBestHeader = pindexBestHeader;
+        originalAssumeValidSc = hashAssumeValidSc;
+    }
+
+    void TearDown() override
+    {
+        LOCK(cs_main);
+        for (const std::unique_ptr<CBlockIndex>& pindex : vIndexes)
+            mapBlockIndex.erase(pindex->GetBlockHash());
+        pindexBestHeader = originalBestHeader;
+        hashAssumeValidSc = originalAssumeValidSc;
+    }
+
+    //! A branch of nLength blocks on top of pindexFork (from the height 0 if null), its last block returned
+    CBlockIndex* ExtendChain(CBlockIndex* pindexFork, int nLength)
+    {
+        CBlockIndex* pindexPrev = pindexFork;
+        for (int i = 0; i < nLength; i++) {
+            vIndexes.emplace_back(new CBlockIndex());
+            CBlockIndex* pindex = vIndexes.back().get();
+            pindex->pprev = pindexPrev;
+            pindex->nHeight = pindexPrev == nullptr ? 0 : pindexPrev->nHeight + 1;
+            pindex->BuildSkip();
+            pindex->phashBlock = &mapBlockIndex.insert(std::make_pair(GetRandHash(), pindex)).first->first;
+            pindexPrev = pindex;
+        }
+        return pindexPrev;
+    }
+
+protected:
+    CBlockIndex* originalBestHeader = nullptr;
+    uint256 originalAssumeValidSc;
+    std::vector<std::unique_ptr<CBlockIndex>> vIndexes;
+};
+
+TEST_F(AssumeValidScTestSuite, ProofsAreVerifiedOnlyAfterTheAssumedValidBlock)
+{
+    LOCK(cs_main);
+    CBlockIndex* pindexAssumed = ExtendChain(nullptr, 100);
+    CBlockIndex* pindexTip = ExtendChain(pindexAssumed, 20);
+    pindexBestHeader = pindexTip;
+
+    // not set, every block has its proofs verified
+    hashAssumeValidSc.SetNull();
+    EXPECT_FALSE(IsScProofAssumedValid(pindexAssumed));
+
+    hashAssumeValidSc = pindexAssumed->GetBlockHash();
+    EXPECT_TRUE(IsScProofAssumedValid(pindexAssumed->GetAncestor(0)));
+    EXPECT_TRUE(IsScProofAssumedValid(pindexAssumed->GetAncestor(50)));
+    EXPECT_TRUE(IsScProofAssumedValid(pindexAssumed->pprev));
+    EXPECT_TRUE(IsScProofAssumedValid(pindexAssumed));
+
+    // the first block after the assumed valid one, and the next ones
+    EXPECT_FALSE(IsScProofAssumedValid(pindexTip->GetAncestor(pindexAssumed->nHeight + 1)));
+    EXPECT_FALSE(IsScProofAssumedValid(pindexTip));
+}
+
+TEST_F(AssumeValidScTestSuite, ProofsAreVerifiedOffTheAssumedValidChain)
+{
+    LOCK(cs_main);
+    CBlockIndex* pindexAssumed = ExtendChain(nullptr, 100);
+    pindexBestHeader = ExtendChain(pindexAssumed, 10);
+    hashAssumeValidSc = pindexAssumed->GetBlockHash();
+
+    // a fork below the assumed valid block, at a height it has an ancestor at
+    CBlockIndex* pindexFork = ExtendChain(pindexAssumed->GetAncestor(80), 5);
+    ASSERT_LT(pindexFork->nHeight, pindexAssumed->nHeight);
+    EXPECT_FALSE(IsScProofAssumedValid(pindexFork));
+    EXPECT_TRUE(IsScProofAssumedValid(pindexAssumed->GetAncestor(80)));
+}
+
+TEST_F(AssumeValidScTestSuite, ProofsAreVerifiedIfTheAssumedValidBlockIsNotOnTheBestHeaderChain)
+{
+    LOCK(cs_main);
+    CBlockIndex* pindexCommon = ExtendChain(nullptr, 50);
+    CBlockIndex* pindexAssumed = ExtendChain(pindexCommon, 50);
+    hashAssumeValidSc = pindexAssumed->GetBlockHash();
+    pindexBestHeader = pindexAssumed;
+    EXPECT_TRUE(IsScProofAssumedValid(pindexCommon));
+
+    // the best header chain forks before the assumed valid block
+    pindexBestHeader = ExtendChain(pindexCommon, 60);
+    EXPECT_FALSE(IsScProofAssumedValid(pindexCommon));
+    EXPECT_FALSE(IsScProofAssumedValid(pindexAssumed));
+
+    // an assumed valid block not known at all
+    pindexBestHeader = pindexAssumed;
+    EXPECT_TRUE(IsScProofAssumedValid(pindexCommon));
+    hashAssumeValidSc = GetRandHash();
+    EXPECT_FALSE(IsScProofAssumedValid(pindexCommon));
+}
@@ -1,9 +1,13 @@
 #include <gtest/gtest.h>
 #include <gtest/libzendoo_test_files.h>
 
+#include <algorithm>
+#include <cmath>
+
 #include "primitives/certificate.h"
 #include "primitives/transaction.h"
 #include "sc/asyncproofverifier.h"
+#include "sc/proofcache.h"
 #include "coins.h"
 #include "main.h"
 #include "uint256.h"
@@ -28,9 +32,9 @@ public:
         dummyNode.id = 7;
 
         sidechain.creationBlockHeight = 100;
-        sidechain.fixedParams.withdrawalEpochLength = 20;
-        sidechain.fixedParams.constant = CFieldElement{SAMPLE_FIELD};
-        sidechain.fixedParams.version = 0;
+        sidechain.ModifyFixedParams().withdrawalEpochLength = 20;
+        sidechain.ModifyFixedParams().constant = CFieldElement{SAMPLE_FIELD};
+        sidechain.ModifyFixedParams().version = 0;
         sidechain.lastTopQualityCertHash = uint256S("cccc");
         sidechain.lastTopQualityCertQuality = 100;
         sidechain.lastTopQualityCertReferencedEpoch = -1;
@@ -50,8 +54,8 @@ public:
         BlockchainTestManager::GetInstance().GenerateSidechainTestParameters(testProvingSystem, TestCircuitType::Certificate, false);
         BlockchainTestManager::GetInstance().GenerateSidechainTestParameters(testProvingSystem, TestCircuitType::CSW, false);
 
-        sidechain.fixedParams.wCertVk = BlockchainTestManager::GetInstance().GetTestVerificationKey(testProvingSystem, TestCircuitType::Certificate);
-        sidechain.fixedParams.wCeasedVk = BlockchainTestManager::GetInstance().GetTestVerificationKey(testProvingSystem, TestCircuitType::CSW);
+        sidechain.ModifyFixedParams().wCertVk = BlockchainTestManager::GetInstance().GetTestVerificationKey(testProvingSystem, TestCircuitType::Certificate);
+        sidechain.ModifyFixedParams().wCeasedVk = BlockchainTestManager::GetInstance().GetTestVerificationKey(testProvingSystem, TestCircuitType::CSW);
     };
 
     void TearDown() override
@@ -91,7 +95,7 @@ TEST_F(AsyncProofVerifierTestSuite, Hash_Test)
     blockchain.Reset();
 
     // Store the test sidechain and extend the blockchain to complete at least one epoch. 
-    blockchain.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.fixedParams.withdrawalEpochLength);
+    blockchain.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.GetFixedParams().withdrawalEpochLength);
 
     CTxCeasedSidechainWithdrawalInput input1 = blockchain.CreateCswInput(sidechainId, 1, testProvingSystem);
     CTxCeasedSidechainWithdrawalInput input2 = blockchain.CreateCswInput(sidechainId, 2, testProvingSystem);
@@ -135,7 +139,7 @@ TEST_F(AsyncProofVerifierTestSuite, Check_Valid_Certificate_Proof_Processing)
     blockchain.Reset();
 
     // Store the test sidechain and extend the blockchain to complete at least one epoch. 
-    blockchain.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.fixedParams.withdrawalEpochLength);
+    blockchain.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.GetFixedParams().withdrawalEpochLength);
 
     int epochNumber = 0;
     int64_t quality = 1;
@@ -170,6 +174,57 @@ TEST_F(AsyncProofVerifierTestSuite, Check_Valid_Certificate_Proof_Processing)
     ASSERT_EQ(stats.okCswCounter, 0);
 }
 
+/**
+ * @brief Test that the certificates of a received block are verified speculatively
+ * and that their proofs are stored into the proof verification cache.
+ */
+TEST_F(AsyncProofVerifierTestSuite, Check_Speculative_Block_Verification)
+{
+    BlockchainTestManager& blockchain = BlockchainTestManager::GetInstance();
+    blockchain.Reset();
+    CScProofVerificationCache::GetInstance().Clear();
+
+    blockchain.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.GetFixedParams().withdrawalEpochLength);
+
+    CBlock block;
+    block.vcert.push_back(blockchain.GenerateCertificate(sidechainId, 0, 1, testProvingSystem));
+
+    // A certificate referring to an unknown sidechain is skipped.
+    CMutableScCertificate unknownScCert(block.vcert.at(0));
+    unknownScCert.scId = uint256S("bbbb");
+    block.vcert.push_back(unknownScCert);
+
+    CScAsyncProofVerifier::GetInstance().LoadBlockForSpeculativeVerification(*blockchain.CoinsViewCache(), block);
+
+    TEST_FRIEND_CScAsyncProofVerifier& verifier = TEST_FRIEND_CScAsyncProofVerifier::GetInstance();
+    ASSERT_EQ(verifier.PendingSpeculativeProofs(), 1);
+
+    uint32_t timeout = 60000;
+    while (timeout > 0 && verifier.PendingSpeculativeProofs() > 0)
+    {
+        MilliSleep(100);
+        timeout -= 100;
+    }
+    ASSERT_EQ(verifier.PendingSpeculativeProofs(), 0);
+
+    // Speculative verification doesn't affect the mempool statistics.
+    AsyncProofVerifierStatistics stats = blockchain.GetAsyncProofVerifierStatistics();
+    ASSERT_EQ(stats.okCertCounter, 0);
+    ASSERT_EQ(stats.failedCertCounter, 0);
+
+    CProofVerifierItem item;
+    item.proofInput = CScProofVerifier::CertificateToVerifierItem(block.vcert.at(0), sidechain.GetFixedParams(), nullptr, blockchain.CoinsViewCache().get());
+
+    // The proof is cached as soon as the verification (running outside the queue lock) completes.
+    timeout = 60000;
+    while (timeout > 0 && !CScProofVerificationCache::GetInstance().Contains(item))
+    {
+        MilliSleep(100);
+        timeout -= 100;
+    }
+    ASSERT_TRUE(CScProofVerificationCache::GetInstance().Contains(item));
+}
+
 /**
  * @brief Test async proof verifier batch verification pause on CZendooLowPrioThreadGuard.
  */
@@ -179,7 +234,7 @@ TEST_F(AsyncProofVerifierTestSuite, Check_CZendooLowPrioThreadGuard)
     blockchain.Reset();
 
     // Store the test sidechain and extend the blockchain to complete at least one epoch.
-    blockchain.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.fixedParams.withdrawalEpochLength);
+    blockchain.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.GetFixedParams().withdrawalEpochLength);
 
     int epochNumber = 0;
     int64_t quality = 1;
@@ -249,7 +304,7 @@ TEST_F(AsyncProofVerifierTestSuite, Check_Invalid_Certificate_Proof_Processing)
     blockchain.Reset();
 
     // Store the test sidechain and extend the blockchain to complete at least one epoch. 
-    blockchain.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.fixedParams.withdrawalEpochLength);
+    blockchain.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.GetFixedParams().withdrawalEpochLength);
 
     int epochNumber = 0;
     int64_t quality = 1;
@@ -514,6 +569,85 @@ TEST_F(AsyncProofVerifierTestSuite, Check_One_By_One_Verification)
     ASSERT_EQ(stats.okCswCounter, numberOfValidTransactions);
 }
 
+/**
+ * @brief Test that a batch failing without telling which proof is invalid gets bisected:
+ * only the invalid proof is rejected, its sender is penalized and the batch verifications
+ * are about log2(N), the failed batch not being verified again as a whole.
+ */
+TEST_F(AsyncProofVerifierTestSuite, Check_Bisection_Of_Failed_Batch)
+{
+    const size_t numberOfValidProofs = 16;
+
+    CNode badNode(INVALID_SOCKET, CAddress(), "", true);
+    badNode.id = 8;
+
+    std::map<uint256, CProofVerifierItem> proofs;
+    uint256 invalidHash;
+
+    for (size_t i = 0; i <= numberOfValidProofs; i++)
+    {
+        CMutableTransaction mtx;
+        mtx.nVersion = SC_TX_VERSION;
+        mtx.nLockTime = i;
+
+        CProofVerifierItem item;
+        item.parentPtr = std::make_shared<CTransaction>(mtx);
+        item.txHash = item.parentPtr->GetHash();
+        item.node = i == 0 ? &badNode : &dummyNode;
+        item.result = ProofVerificationResult::Unknown;
+        item.proofInput = std::vector<CCswProofVerifierInput>();
+
+        if (i == 0)
+        {
+            invalidHash = item.txHash;
+        }
+
+        proofs.insert(std::make_pair(item.txHash, item));
+    }
+
+    // The batch fails without details whenever it contains the invalid proof.
+    std::vector<size_t> batchSizes;
+    TEST_FRIEND_CScAsyncProofVerifier::CScAsyncProofVerifierWithOverrides verifier(
+        [&](std::map<uint256, CProofVerifierItem>& batch)
+        {
+            batchSizes.push_back(batch.size());
+
+            if (batch.count(invalidHash) > 0)
+            {
+                return false;
+            }
+
+            for (auto& entry : batch)
+            {
+                entry.second.result = ProofVerificationResult::Passed;
+            }
+
+            return true;
+        },
+        [&](std::map<uint256, CProofVerifierItem>& batch)
+        {
+            for (auto& entry : batch)
+            {
+                entry.second.result = entry.first == invalidHash ? ProofVerificationResult::Failed : ProofVerificationResult::Passed;
+            }
+        });
+
+    verifier.VerifyBatch(proofs);
+
+    ASSERT_TRUE(proofs.empty());
+
+    AsyncProofVerifierStatistics stats = verifier.GetStatistics();
+    ASSERT_EQ(stats.failedCswCounter, 1);
+    ASSERT_EQ(stats.okCswCounter, numberOfValidProofs);
+
+    ASSERT_TRUE(verifier.IsPenalizedNode(badNode.id));
+    ASSERT_FALSE(verifier.IsPenalizedNode(dummyNode.id));
+
+    // The whole set is verified once, then two halves for each of the log2(N) splits.
+    ASSERT_EQ(std::count(batchSizes.begin(), batchSizes.end(), numberOfValidProofs + 1), 1);
+    ASSERT_LE(batchSizes.size(), 1 + 2 * static_cast<size_t>(std::ceil(std::log2(numberOfValidProofs + 1))));
+}
+
 /**
  * @brief Test the move of elements from one queue map to another.
  * 
@@ -582,3 +716,138 @@ TEST_F(AsyncProofVerifierTestSuite, Csw_Queue_Move)
         ASSERT_EQ(tempElement.at(i).scId, inputs.at(i).scId);
     }
 }
+
+/**
+ * @brief Test that the batch policy keeps the fixed thresholds when the adaptive behavior is disabled.
+ */
+TEST(AsyncProofVerifierBatchPolicy, Non_Adaptive_Parameters)
+{
+    CScAsyncProofVerifierBatchPolicy policy(0, 100, 5000, 10);
+    ASSERT_FALSE(policy.IsAdaptive());
+
+    policy.RegisterArrivals(Sidechain::ProvingSystemType::Darlin, 50);
+    policy.Update(0);
+    policy.Update(2000);
+
+    AsyncProofVerifierBatchParameters params = policy.GetParameters();
+    ASSERT_FALSE(params.adaptive);
+    ASSERT_EQ(params.batchSize, 10);
+    ASSERT_EQ(params.batchDelay, 5000);
+    ASSERT_EQ(params.arrivalRate, 0);
+}
+
+/**
+ * @brief Test that the batch policy chooses the delay and the size according to
+ * the observed arrival rate and verification cost.
+ */
+TEST(AsyncProofVerifierBatchPolicy, Adaptive_Parameters)
+{
+    CScAsyncProofVerifierBatchPolicy policy(1000, 100, 5000, 10);
+    ASSERT_TRUE(policy.IsAdaptive());
+
+    // Without any information on the traffic, only the target latency is honoured.
+    AsyncProofVerifierBatchParameters params = policy.GetParameters();
+    ASSERT_EQ(params.batchSize, 10);
+    ASSERT_EQ(params.batchDelay, 1000);
+
+    // 10 Darlin proofs per second, verified in 50 ms each.
+    policy.Update(0);
+    policy.RegisterArrivals(Sidechain::ProvingSystemType::Darlin, 10);
+    policy.Update(1000);
+    policy.RegisterBatch({{Sidechain::ProvingSystemType::Darlin, 10}}, 500);
+
+    params = policy.GetParameters();
+    ASSERT_TRUE(params.adaptive);
+    ASSERT_DOUBLE_EQ(params.arrivalRate, 10);
+    ASSERT_DOUBLE_EQ(params.verificationCost.at(Sidechain::ProvingSystemType::Darlin), 50);
+
+    // W = 1000 / (1 + 50 * 0.01) ms, collecting 0.01 * W proofs.
+    ASSERT_EQ(params.batchDelay, 666);
+    ASSERT_EQ(params.batchSize, 6);
+
+    // Slower proofs shrink the flush deadline.
+    policy.RegisterBatch({{Sidechain::ProvingSystemType::Darlin, 1}}, 550);
+    params = policy.GetParameters();
+    ASSERT_DOUBLE_EQ(params.verificationCost.at(Sidechain::ProvingSystemType::Darlin), 150);
+    ASSERT_EQ(params.batchDelay, 400);
+    ASSERT_EQ(params.batchSize, 4);
+}
+
+/**
+ * @brief Test that the batch policy never exceeds the configured delay bounds.
+ */
+TEST(AsyncProofVerifierBatchPolicy, Adaptive_Parameters_Bounds)
+{
+    CScAsyncProofVerifierBatchPolicy policy(60000, 100, 5000, 10);
+
+    policy.Update(0);
+    policy.RegisterArrivals(Sidechain::ProvingSystemType::CoboundaryMarlin, 1);
+    policy.Update(1000);
+
+    AsyncProofVerifierBatchParameters params = policy.GetParameters();
+    ASSERT_EQ(params.batchDelay, 5000);
+    ASSERT_EQ(params.batchSize, 5);
+
+    // A very high load pushes the delay to the lower bound, but at least one proof is verified.
+    CScAsyncProofVerifierBatchPolicy busyPolicy(10, 100, 5000, 10);
+    busyPolicy.Update(0);
+    busyPolicy.RegisterArrivals(Sidechain::ProvingSystemType::Darlin, 1);
+    busyPolicy.Update(1000);
+
+    params = busyPolicy.GetParameters();
+    ASSERT_EQ(params.batchDelay, 100);
+    ASSERT_EQ(params.batchSize, 1);
+}
+
+/**
+ * @brief Test that top quality certificates are prioritized over any other proof,
+ * and that the remaining proofs are ordered by decreasing fee rate.
+ */
+TEST(AsyncProofVerifierPriority, Sort_By_Priority)
+{
+    auto makeCert = [](const uint256& scId, int32_t epoch, int64_t quality)
+    {
+        CProofVerifierItem item;
+        CCertProofVerifierInput input;
+        input.scId = scId;
+        input.epochNumber = epoch;
+        input.quality = quality;
+        item.proofInput = input;
+        return item;
+    };
+
+    std::map<uint256, CProofVerifierItem> items;
+    std::map<uint256, CFeeRate> feeRates;
+
+    uint256 scA = uint256S("aaaa");
+    uint256 scB = uint256S("bbbb");
+
+    uint256 lowQualityCert = uint256S("01");
+    items[lowQualityCert] = makeCert(scA, 3, 5);
+    feeRates[lowQualityCert] = CFeeRate(100000);
+
+    uint256 topQualityCert = uint256S("02");
+    items[topQualityCert] = makeCert(scA, 3, 7);
+    feeRates[topQualityCert] = CFeeRate(1000);
+
+    uint256 otherScCert = uint256S("03");
+    items[otherScCert] = makeCert(scB, 3, 1);
+    feeRates[otherScCert] = CFeeRate(2000);
+
+    uint256 cheapCsw = uint256S("04");
+    items[cheapCsw].proofInput = std::vector<CCswProofVerifierInput>(1);
+    feeRates[cheapCsw] = CFeeRate(10);
+
+    uint256 expensiveCsw = uint256S("05");
+    items[expensiveCsw].proofInput = std::vector<CCswProofVerifierInput>(1);
+    feeRates[expensiveCsw] = CFeeRate(50000);
+
+    // No fee rate known, it is considered as paying no fee.
+    uint256 unknownFeeCsw = uint256S("06");
+    items[unknownFeeCsw].proofInput = std::vector<CCswProofVerifierInput>(1);
+
+    std::vector<uint256> sorted = CScAsyncProofVerifier::SortByPriority(items, feeRates);
+    std::vector<uint256> expected = {otherScCert, topQualityCert, lowQualityCert, expensiveCsw, cheapCsw, unknownFeeCsw};
+
+    ASSERT_EQ(sorted, expected);
+}
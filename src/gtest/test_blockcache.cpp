@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include "blockcache.h"
+#include "core_memusage.h"
+#include "primitives/block.h"
+
+static std::shared_ptr<const CBlock> MakeBlock(uint32_t nTime, size_t nTxs)
+{
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+    pblock->nTime = nTime;
+    for (size_t n = 0; n < nTxs; n++) {
+        CMutableTransaction tx;
+        tx.addOut(CTxOut(n, CScript() << std::vector<unsigned char>(100, n & 0xff)));
+        pblock->vtx.push_back(tx);
+    }
+    return pblock;
+}
+
+TEST(RecentBlockCache, SharesTheBlockAndItsBytes)
+{
+    CRecentBlockCache cache(1 << 20);
+    std::shared_ptr<const CBlock> pblock = MakeBlock(1, 10);
+    const uint256 hash = pblock->GetHash();
+
+    EXPECT_FALSE(cache.GetBlock(hash));
+    EXPECT_FALSE(cache.GetRaw(hash));
+
+    // the bytes are added when the block is written, the block when connected
+    std::shared_ptr<const std::vector<char> > praw = std::make_shared<const std::vector<char> >(500, 'x');
+    cache.AddRaw(hash, praw);
+    EXPECT_EQ(praw, cache.GetRaw(hash));
+    EXPECT_FALSE(cache.GetBlock(hash));
+
+    cache.AddBlock(hash, pblock);
+    EXPECT_EQ(pblock, cache.GetBlock(hash));
+    EXPECT_EQ(praw, cache.GetRaw(hash));
+    EXPECT_EQ(1U, cache.Size());
+    EXPECT_EQ(500 + sizeof(CBlock) + RecursiveDynamicUsage(*pblock), cache.Bytes());
+
+    // the first ones added stay
+    cache.AddBlock(hash, MakeBlock(1, 10));
+    EXPECT_EQ(pblock, cache.GetBlock(hash));
+
+    cache.Clear();
+    EXPECT_FALSE(cache.GetBlock(hash));
+    EXPECT_EQ(0U, cache.Bytes());
+}
+
+TEST(RecentBlockCache, EvictsTheLeastRecentlyUsed)
+{
+    std::shared_ptr<const CBlock> pblocks[3];
+    for (int i = 0; i < 3; i++)
+        pblocks[i] = MakeBlock(i, 10);
+    const size_t nBlockBytes = sizeof(CBlock) + RecursiveDynamicUsage(*pblocks[0]);
+
+    CRecentBlockCache cache(nBlockBytes * 2);
+    cache.AddBlock(pblocks[0]->GetHash(), pblocks[0]);
+    cache.AddBlock(pblocks[1]->GetHash(), pblocks[1]);
+    // block 0 used last
+    EXPECT_TRUE(cache.GetBlock(pblocks[0]->GetHash()));
+
+    cache.AddBlock(pblocks[2]->GetHash(), pblocks[2]);
+    EXPECT_EQ(2U, cache.Size());
+    EXPECT_TRUE(cache.GetBlock(pblocks[0]->GetHash()));
+    EXPECT_FALSE(cache.GetBlock(pblocks[1]->GetHash()));
+    EXPECT_TRUE(cache.GetBlock(pblocks[2]->GetHash()));
+
+    // the block just added stays, whatever its size
+    cache.SetMaxBytes(1);
+    EXPECT_EQ(1U, cache.Size());
+    std::shared_ptr<const CBlock> pbig = MakeBlock(3, 100);
+    cache.AddBlock(pbig->GetHash(), pbig);
+    EXPECT_EQ(pbig, cache.GetBlock(pbig->GetHash()));
+    EXPECT_EQ(1U, cache.Size());
+
+    // disabled
+    cache.SetMaxBytes(0);
+    EXPECT_EQ(0U, cache.Size());
+    cache.AddBlock(pblocks[0]->GetHash(), pblocks[0]);
+    EXPECT_FALSE(cache.GetBlock(pblocks[0]->GetHash()));
+}
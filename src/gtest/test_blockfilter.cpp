@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include "blockfilter.h"
+#include "primitives/block.h"
+#include "pubkey.h"
+#include "script/standard.h"
+#include "undo.h"
+#include "uint256.h"
+
+#include <gtest/libzendoo_test_files.h>
+
+#include <ios>
+
+namespace {
+
+GCSFilter::Element ElementOf(const uint256& hash)
+{
+    return GCSFilter::Element(hash.begin(), hash.end());
+}
+
+GCSFilter::Element ElementOf(const CScript& script)
+{
+    return GCSFilter::Element(script.begin(), script.end());
+}
+
+CScript ScriptOf(unsigned char seed)
+{
+    return GetScriptForDestination(CKeyID(uint160(std::vector<unsigned char>(20, seed))));
+}
+
+} // anon namespace
+
+TEST(BlockFilter, GCSFilterMatchesItsElements)
+{
+    const GCSFilter::Params params(0x0123456789abcdefULL, 0xfedcba9876543210ULL, 19, 784931);
+
+    GCSFilter::ElementSet included, excluded;
+    for (int i = 0; i < 100; ++i)
+        included.insert(GCSFilter::Element(32, static_cast<unsigned char>(i)));
+    for (int i = 100; i < 110; ++i)
+        excluded.insert(GCSFilter::Element(32, static_cast<unsigned char>(i)));
+
+    const GCSFilter filter(params, included);
+    EXPECT_EQ(filter.GetN(), 100);
+    for (const GCSFilter::Element& element : included)
+        EXPECT_TRUE(filter.Match(element));
+    EXPECT_TRUE(filter.MatchAny(included));
+    EXPECT_FALSE(filter.MatchAny(excluded));
+
+    // the encoding is decoded back to the same set
+    const GCSFilter decoded(params, filter.GetEncoded());
+    EXPECT_EQ(decoded.GetN(), 100);
+    EXPECT_EQ(decoded.GetEncoded(), filter.GetEncoded());
+    for (const GCSFilter::Element& element : included)
+        EXPECT_TRUE(decoded.Match(element));
+}
+
+TEST(BlockFilter, EmptyGCSFilterMatchesNothing)
+{
+    const GCSFilter filter;
+    EXPECT_EQ(filter.GetN(), 0);
+    EXPECT_EQ(filter.GetEncoded(), std::vector<unsigned char>(1, 0));
+    EXPECT_FALSE(filter.Match(GCSFilter::Element(32, 1)));
+    EXPECT_FALSE(filter.MatchAny(GCSFilter::ElementSet{GCSFilter::Element(32, 1)}));
+}
+
+TEST(BlockFilter, MalformedGCSFilterIsRejected)
+{
+    // N = 5, but the data of a single element at most
+    const std::vector<unsigned char> truncated = {5, 0x00, 0x00};
+    EXPECT_THROW(GCSFilter(GCSFilter::Params(0, 0, 19, 784931), truncated), std::ios_base::failure);
+}
+
+TEST(BlockFilter, BasicFilterHasScriptsAndSidechainData)
+{
+    const uint256 ftScId = uint256S("aaaa");
+    const uint256 cswScId = uint256S("bbbb");
+    const uint256 certScId = uint256S("cccc");
+
+    CMutableTransaction coinbase;
+    coinbase.vin.push_back(CTxIn(uint256(), -1));
+    coinbase.addOut(CTxOut(1, ScriptOf(1)));
+
+    // a forward transfer, spending an output whose script is in the undo data
+    CMutableTransaction ft;
+    ft.nVersion = SC_TX_VERSION;
+    ft.vin.push_back(CTxIn(COutPoint(uint256S("1234"), 0)));
+    ft.addOut(CTxOut(1, ScriptOf(2)));
+    ft.addOut(CTxOut(0, CScript() << OP_RETURN << std::vector<unsigned char>(4, 5)));
+    ft.vft_ccout.resize(1);
+    ft.vft_ccout[0].scId = ftScId;
+    ft.vft_ccout[0].nValue = 1;
+
+    CMutableTransaction csw;
+    csw.nVersion = SC_TX_VERSION;
+    csw.vcsw_ccin.resize(1);
+    csw.vcsw_ccin[0].scId = cswScId;
+    csw.vcsw_ccin[0].nValue = 1;
+    csw.vcsw_ccin[0].nullifier = CFieldElement{SAMPLE_FIELD};
+
+    CMutableScCertificate cert;
+    cert.nVersion = SC_CERT_VERSION;
+    cert.scId = certScId;
+
+    CBlock block;
+    block.nVersion = BLOCK_VERSION_SC_SUPPORT;
+    block.vtx.push_back(coinbase);
+    block.vtx.push_back(ft);
+    block.vtx.push_back(csw);
+    block.vcert.push_back(cert);
+
+    CBlockUndo blockUndo(IncludeScAttributes::ON);
+    blockUndo.vtxundo.resize(3);
+    blockUndo.vtxundo[0].vprevout.push_back(CTxInUndo(CTxOut(2, ScriptOf(3))));
+
+    const BlockFilter blockFilter(BlockFilterType::BASIC, block, blockUndo);
+    const GCSFilter& filter = blockFilter.GetFilter();
+    EXPECT_EQ(blockFilter.GetBlockHash(), block.GetHash());
+    EXPECT_TRUE(filter.Match(ElementOf(ScriptOf(1))));
+    EXPECT_TRUE(filter.Match(ElementOf(ScriptOf(2))));
+    EXPECT_TRUE(filter.Match(ElementOf(ScriptOf(3))));
+    EXPECT_TRUE(filter.Match(ElementOf(ftScId)));
+    EXPECT_TRUE(filter.Match(ElementOf(cswScId)));
+    EXPECT_TRUE(filter.Match(ElementOf(certScId)));
+    EXPECT_TRUE(filter.Match(SAMPLE_FIELD));
+    EXPECT_FALSE(filter.Match(ElementOf(ScriptOf(4))));
+    // the two output scripts but the OP_RETURN one, the spent script, the three sidechain ids and the nullifier
+    EXPECT_EQ(filter.GetN(), 7);
+
+    // the filter of the encoding, and the chain of headers
+    const BlockFilter decoded(BlockFilterType::BASIC, block.GetHash(), blockFilter.GetEncodedFilter());
+    EXPECT_EQ(decoded.GetHash(), blockFilter.GetHash());
+    EXPECT_TRUE(decoded.GetFilter().Match(ElementOf(cswScId)));
+    EXPECT_NE(blockFilter.ComputeHeader(uint256()), blockFilter.ComputeHeader(uint256S("01")));
+}
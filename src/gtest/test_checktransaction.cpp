@@ -1181,6 +1181,28 @@ TEST(SidechainsCertificateCustomFields, FieldElementCertificateFieldConfig_Valid
     // FieldElementCertificateFieldConfig::nBits is an uint8_t, testing larger values or negative ones is not possible 
 }
 
+TEST(SidechainsCertificateCustomFields, FieldElementCertificateField_ValidationCache)
+{
+    FieldElementCertificateFieldConfig fieldConfig{10};
+
+    // 2 bytes, the 6 spare bits of the last one are leading zeros (sidechain version 1) but not trailing ones (version 0)
+    FieldElementCertificateField field{std::vector<unsigned char>{0xab, 0x01}};
+    FieldElementCertificateField copiedField{field};
+
+    // the validation is performed per sidechain version
+    EXPECT_FALSE(field.IsValid(fieldConfig, 0));
+    EXPECT_TRUE(field.IsValid(fieldConfig, 1));
+
+    // the validated state is shared with copies made before and after the validation
+    FieldElementCertificateField assignedField;
+    assignedField = field;
+    uint64_t nDeserializations = CFieldElement::GetDeserializationsCount();
+    EXPECT_TRUE(&copiedField.GetFieldElement(fieldConfig, 1) == &field.GetFieldElement(fieldConfig, 1));
+    EXPECT_TRUE(&assignedField.GetFieldElement(fieldConfig, 1) == &field.GetFieldElement(fieldConfig, 1));
+    EXPECT_FALSE(copiedField.IsValid(fieldConfig, 0));
+    EXPECT_EQ(CFieldElement::GetDeserializationsCount(), nDeserializations);
+}
+
 TEST(SidechainsCertificateCustomFields, BitVectorCertificateFieldConfig_Validation)
 {
     BitVectorCertificateFieldConfig negativeSizeBitVector_BitVectorConfig{-1, 12};
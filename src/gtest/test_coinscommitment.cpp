@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+
+#include <txdb.h>
+#include <util.h>
+#include <random.h>
+#include <script/script.h>
+#include <boost/filesystem.hpp>
+
+class CoinsCommitmentTestSuite: public ::testing::Test {
+public:
+    CoinsCommitmentTestSuite():
+        dataDirLocation(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()),
+        chainStateDbSize(2 * 1024 * 1024) {}
+
+    void SetUp() override {
+        boost::filesystem::create_directories(dataDirLocation);
+        mapArgs["-datadir"] = dataDirLocation.string();
+        pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/true));
+    }
+
+    void TearDown() override {
+        pChainStateDb.reset();
+        ClearDatadirCache();
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(dataDirLocation.string(), ec);
+    }
+
+protected:
+    boost::filesystem::path dataDirLocation;
+    const unsigned int chainStateDbSize;
+    std::unique_ptr<CCoinsViewDB> pChainStateDb;
+
+    CCoins CreateCoins(unsigned int nOutputs) {
+        CCoins coins;
+        coins.nVersion = 1;
+        coins.nHeight = 10;
+        for (unsigned int i = 0; i < nOutputs; i++)
+            coins.vout.push_back(CTxOut(i + 1, CScript() << OP_TRUE));
+        return coins;
+    }
+
+    void WriteCoins(CCoinsMap& mapCoins, const uint256& hashBlock) {
+        CAnchorsMap dummyAnchors;
+        CNullifiersMap dummyNullifiers;
+        CSidechainsMap dummySidechains;
+        CSidechainEventsMap dummySidechainEvents;
+        CCswNullifiersMap dummyCswNullifiers;
+        ASSERT_TRUE(pChainStateDb->BatchWrite(mapCoins, hashBlock, uint256(), dummyAnchors, dummyNullifiers,
+                                              dummySidechains, dummySidechainEvents, dummyCswNullifiers));
+    }
+
+    /** Creates, updates and erases coins spread over the whole txid space */
+    void ExerciseCoinsSet(std::vector<uint256>& txids) {
+        CCoinsMap mapCoins;
+        for (unsigned int i = 0; i < 100; i++) {
+            txids.push_back(GetRandHash());
+            mapCoins[txids.back()].coins = CreateCoins(1 + i % 5);
+            mapCoins[txids.back()].flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+        }
+        WriteCoins(mapCoins, uint256S("aaa"));
+
+        for (unsigned int i = 0; i < txids.size(); i += 3) {
+            CCoins coins;
+            ASSERT_TRUE(pChainStateDb->GetCoins(txids[i], coins));
+            if (i % 2)
+                coins.Clear();
+            else
+                coins.Spend(0);
+            mapCoins[txids[i]].coins = coins;
+            mapCoins[txids[i]].flags = CCoinsCacheEntry::DIRTY;
+        }
+        WriteCoins(mapCoins, uint256S("bbb"));
+    }
+
+    void ExpectSameStats(const CCoinsStats& lhs, const CCoinsStats& rhs) {
+        EXPECT_EQ(lhs.hashBlock, rhs.hashBlock);
+        EXPECT_EQ(lhs.nTransactions, rhs.nTransactions);
+        EXPECT_EQ(lhs.nTransactionOutputs, rhs.nTransactionOutputs);
+        EXPECT_EQ(lhs.nSerializedSize, rhs.nSerializedSize);
+        EXPECT_EQ(lhs.hashSerialized, rhs.hashSerialized);
+        EXPECT_EQ(lhs.nTotalAmount, rhs.nTotalAmount);
+    }
+};
+
+TEST_F(CoinsCommitmentTestSuite, RunningCommitmentMatchesScan) {
+    ASSERT_TRUE(pChainStateDb->LoadCoinsCommitment());
+
+    std::vector<uint256> txids;
+    ExerciseCoinsSet(txids);
+
+    CCoinsStats runningStats;
+    ASSERT_TRUE(pChainStateDb->GetStats(runningStats));
+    EXPECT_EQ(runningStats.hashBlock, uint256S("bbb"));
+    EXPECT_GT(runningStats.nTransactions, 0);
+
+    // A view without the running commitment scans the database
+    pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/false));
+    CCoinsStats scannedStats;
+    ASSERT_TRUE(pChainStateDb->GetStats(scannedStats));
+    ExpectSameStats(runningStats, scannedStats);
+
+    // The commitment is persisted with the coins
+    ASSERT_TRUE(pChainStateDb->LoadCoinsCommitment());
+    CCoinsStats loadedStats;
+    ASSERT_TRUE(pChainStateDb->GetStats(loadedStats));
+    ExpectSameStats(runningStats, loadedStats);
+}
+
+TEST_F(CoinsCommitmentTestSuite, RunningCommitmentWithPerTxOutLayout) {
+    ASSERT_TRUE(pChainStateDb->UpgradeToPerTxOutCoins());
+    ASSERT_TRUE(pChainStateDb->LoadCoinsCommitment());
+
+    std::vector<uint256> txids;
+    ExerciseCoinsSet(txids);
+
+    CCoinsStats runningStats;
+    ASSERT_TRUE(pChainStateDb->GetStats(runningStats));
+
+    pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/false));
+    CCoinsStats scannedStats;
+    ASSERT_TRUE(pChainStateDb->GetStats(scannedStats));
+    ExpectSameStats(runningStats, scannedStats);
+}
+
+TEST_F(CoinsCommitmentTestSuite, RunningCommitmentWithHeightBucketLayout) {
+    ASSERT_TRUE(pChainStateDb->UpgradeToPerTxOutCoins());
+    ASSERT_TRUE(pChainStateDb->LoadCoinsCommitment());
+
+    std::vector<uint256> txids;
+    ExerciseCoinsSet(txids);
+
+    CCoinsStats runningStats;
+    ASSERT_TRUE(pChainStateDb->GetStats(runningStats));
+
+    // Moving the outputs to their buckets does not change the coins set
+    pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/false));
+    ASSERT_TRUE(pChainStateDb->UpgradeToHeightBucketCoins());
+    CCoinsStats scannedStats;
+    ASSERT_TRUE(pChainStateDb->GetStats(scannedStats));
+    ExpectSameStats(runningStats, scannedStats);
+}
+
+TEST_F(CoinsCommitmentTestSuite, StaleCommitmentIsRecomputed) {
+    std::vector<uint256> txids;
+    ASSERT_TRUE(pChainStateDb->LoadCoinsCommitment());
+    ExerciseCoinsSet(txids);
+
+    // Coins written without maintaining the commitment leave it behind the best block
+    pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/false));
+    CCoinsMap mapCoins;
+    mapCoins[GetRandHash()].coins = CreateCoins(2);
+    mapCoins.begin()->second.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+    WriteCoins(mapCoins, uint256S("ccc"));
+
+    CCoinsStats scannedStats;
+    ASSERT_TRUE(pChainStateDb->GetStats(scannedStats));
+
+    ASSERT_TRUE(pChainStateDb->LoadCoinsCommitment());
+    CCoinsStats loadedStats;
+    ASSERT_TRUE(pChainStateDb->GetStats(loadedStats));
+    ExpectSameStats(scannedStats, loadedStats);
+    EXPECT_EQ(loadedStats.hashBlock, uint256S("ccc"));
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+
+#include <random.h>
+#include <sc/cswnullifierfilter.h>
+#include <txdb.h>
+#include <util.h>
+#include <boost/filesystem.hpp>
+
+namespace {
+
+CFieldElement RandomNullifier()
+{
+    uint256 value = GetRandHash();
+    std::vector<unsigned char> bytes(value.begin(), value.end());
+    // keep the value below the field modulus
+    bytes.back() = 0;
+    return CFieldElement(bytes);
+}
+
+}
+
+TEST(CswNullifierFilter, InsertedNullifiersAreAlwaysFound) {
+    CCswNullifierFilter filter;
+    uint256 scId = uint256S("aaa");
+
+    // Enough nullifiers to grow the filter beyond its first layer
+    std::vector<CFieldElement> nullifiers;
+    for (unsigned int i = 0; i < 3 * CCswNullifierFilter::INITIAL_CAPACITY; i++) {
+        nullifiers.push_back(RandomNullifier());
+        filter.Insert(scId, nullifiers.back());
+    }
+
+    for (const CFieldElement& nullifier : nullifiers) {
+        EXPECT_TRUE(filter.MaybeContains(scId, nullifier));
+    }
+
+    // Filters are kept per sidechain
+    EXPECT_FALSE(filter.MaybeContains(uint256S("bbb"), nullifiers.front()));
+
+    // Removed nullifiers cannot leave the filter
+    filter.Remove(scId, nullifiers.front());
+    EXPECT_TRUE(filter.MaybeContains(scId, nullifiers.front()));
+
+    CswNullifierFilterStatistics stats = filter.GetStatistics();
+    EXPECT_EQ(stats.elements, nullifiers.size());
+    EXPECT_EQ(stats.removed, 1);
+    EXPECT_GT(stats.memoryUsage, 0);
+
+    filter.Clear();
+    EXPECT_FALSE(filter.MaybeContains(scId, nullifiers.front()));
+    EXPECT_EQ(filter.GetStatistics().elements, 0);
+}
+
+TEST(CswNullifierFilter, FalsePositiveRateIsBounded) {
+    CCswNullifierFilter filter;
+    uint256 scId = uint256S("aaa");
+
+    for (unsigned int i = 0; i < 4 * CCswNullifierFilter::INITIAL_CAPACITY; i++)
+        filter.Insert(scId, RandomNullifier());
+
+    static const unsigned int LOOKUPS = 20000;
+    unsigned int falsePositives = 0;
+    for (unsigned int i = 0; i < LOOKUPS; i++) {
+        if (filter.MaybeContains(scId, RandomNullifier()))
+            falsePositives++;
+    }
+
+    // Layers halve their rate, so the overall rate stays below twice the rate of the first one
+    double fpRate = filter.GetStatistics().fpRate;
+    EXPECT_LT(fpRate, 2 * CCswNullifierFilter::INITIAL_FP_RATE);
+    EXPECT_LT(falsePositives, 10 * fpRate * LOOKUPS + 10);
+}
+
+class CswNullifierFilterDbTestSuite: public ::testing::Test {
+public:
+    CswNullifierFilterDbTestSuite():
+        dataDirLocation(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()),
+        chainStateDbSize(2 * 1024 * 1024) {}
+
+    void SetUp() override {
+        boost::filesystem::create_directories(dataDirLocation);
+        mapArgs["-datadir"] = dataDirLocation.string();
+        pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/true));
+    }
+
+    void TearDown() override {
+        pChainStateDb.reset();
+        ClearDatadirCache();
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(dataDirLocation.string(), ec);
+    }
+
+protected:
+    boost::filesystem::path dataDirLocation;
+    const unsigned int chainStateDbSize;
+    std::unique_ptr<CCoinsViewDB> pChainStateDb;
+
+    void WriteCswNullifier(const uint256& scId, const CFieldElement& nullifier, CCswNullifiersCacheEntry::Flags flag) {
+        CCoinsMap dummyCoins;
+        CAnchorsMap dummyAnchors;
+        CNullifiersMap dummyNullifiers;
+        CSidechainsMap dummySidechains;
+        CSidechainEventsMap dummySidechainEvents;
+        CCswNullifiersMap cswNullifiers;
+        cswNullifiers[std::make_pair(scId, nullifier)] = CCswNullifiersCacheEntry{flag};
+        ASSERT_TRUE(pChainStateDb->BatchWrite(dummyCoins, uint256(), uint256(), dummyAnchors, dummyNullifiers,
+                                              dummySidechains, dummySidechainEvents, cswNullifiers));
+    }
+};
+
+TEST_F(CswNullifierFilterDbTestSuite, FilterIsLoadedAndMaintained) {
+    uint256 scId = uint256S("aaa");
+    CFieldElement storedNullifier = RandomNullifier();
+    CFieldElement newNullifier = RandomNullifier();
+
+    WriteCswNullifier(scId, storedNullifier, CCswNullifiersCacheEntry::Flags::FRESH);
+
+    // Nullifiers already in the database are loaded into the filter
+    ASSERT_TRUE(pChainStateDb->LoadCswNullifierFilter());
+    CCoinsStats stats;
+    ASSERT_TRUE(pChainStateDb->GetStats(stats));
+    EXPECT_EQ(stats.nCswNullifierFilterElements, 1);
+    EXPECT_GT(stats.nCswNullifierFilterUsage, 0);
+    EXPECT_TRUE(pChainStateDb->HaveCswNullifier(scId, storedNullifier));
+    EXPECT_FALSE(pChainStateDb->HaveCswNullifier(scId, newNullifier));
+
+    // Nullifiers written afterwards are inserted
+    WriteCswNullifier(scId, newNullifier, CCswNullifiersCacheEntry::Flags::FRESH);
+    EXPECT_TRUE(pChainStateDb->HaveCswNullifier(scId, newNullifier));
+
+    // Erased nullifiers are still reported by the filter but not by the database
+    WriteCswNullifier(scId, newNullifier, CCswNullifiersCacheEntry::Flags::ERASED);
+    EXPECT_FALSE(pChainStateDb->HaveCswNullifier(scId, newNullifier));
+    EXPECT_TRUE(pChainStateDb->HaveCswNullifier(scId, storedNullifier));
+}
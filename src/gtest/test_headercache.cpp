@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include "chain.h"
+#include "headercache.h"
+#include "main.h"
+#include "streams.h"
+#include "utilstrencodings.h"
+
+static CBlockIndex MakeIndex(uint256* phash, uint32_t nNonce)
+{
+    CBlockIndex index;
+    index.nVersion = 4;
+    index.nTime = 1500000000 + nNonce;
+    index.nBits = 0x1f07ffff;
+    index.nNonce = uint256S(strprintf("%x", nNonce));
+    index.nSolution = std::vector<unsigned char>(1344, nNonce & 0xff);
+    *phash = index.GetBlockHeader().GetHash();
+    index.phashBlock = phash;
+    return index;
+}
+
+static std::string Serialize(const CBlockIndex& index)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << index.GetBlockHeader();
+    return ss.str();
+}
+
+TEST(HeaderCache, ServesTheSerializedHeader)
+{
+    LOCK(cs_main);
+    CBlockHeaderCache cache(1 << 20);
+    uint256 hash;
+    CBlockIndex index = MakeIndex(&hash, 1);
+
+    std::shared_ptr<const std::string> raw = cache.GetRaw(&index);
+    EXPECT_EQ(Serialize(index), *raw);
+    EXPECT_EQ(HexStr(raw->begin(), raw->end()), *cache.GetHex(&index));
+
+    // the same bytes are shared by the next requests
+    EXPECT_EQ(raw, cache.GetRaw(&index));
+    EXPECT_EQ(1U, cache.Size());
+    EXPECT_EQ(raw->size() * 3, cache.Bytes());
+}
+
+TEST(HeaderCache, EvictsTheLeastRecentlyUsed)
+{
+    LOCK(cs_main);
+    uint256 hashes[3];
+    CBlockIndex index0 = MakeIndex(&hashes[0], 10);
+    CBlockIndex index1 = MakeIndex(&hashes[1], 11);
+    CBlockIndex index2 = MakeIndex(&hashes[2], 12);
+    size_t nSize = Serialize(index0).size();
+
+    CBlockHeaderCache cache(2 * nSize);
+    std::shared_ptr<const std::string> raw0 = cache.GetRaw(&index0);
+    cache.GetRaw(&index1);
+    // index0 used again, index1 goes first
+    EXPECT_EQ(raw0, cache.GetRaw(&index0));
+    cache.GetRaw(&index2);
+
+    EXPECT_EQ(2U, cache.Size());
+    EXPECT_EQ(2 * nSize, cache.Bytes());
+    EXPECT_EQ(raw0, cache.GetRaw(&index0));
+    EXPECT_EQ(2U, cache.Size());
+
+    cache.SetMaxBytes(0);
+    EXPECT_EQ(1U, cache.Size());
+}
+
+TEST(HeaderCache, EraseDropsTheEntry)
+{
+    LOCK(cs_main);
+    CBlockHeaderCache cache(1 << 20);
+    uint256 hash;
+    CBlockIndex index = MakeIndex(&hash, 20);
+
+    std::shared_ptr<const std::string> hex = cache.GetHex(&index);
+    cache.Erase(hash);
+    EXPECT_EQ(0U, cache.Size());
+    EXPECT_EQ(0U, cache.Bytes());
+
+    // the callers still holding the bytes keep them
+    std::string raw = Serialize(index);
+    EXPECT_EQ(HexStr(raw.begin(), raw.end()), *hex);
+    cache.Erase(hash);
+    EXPECT_EQ(0U, cache.Size());
+}
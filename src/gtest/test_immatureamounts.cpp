@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <clientversion.h>
+#include <streams.h>
+#include <sc/immatureamounts.h>
+
+#include <map>
+
+using Sidechain::ImmatureAmountsMap;
+
+namespace {
+
+bool SameEntries(const ImmatureAmountsMap& amounts, const std::map<int, CAmount>& reference)
+{
+    return amounts.size() == reference.size() &&
+           std::equal(amounts.begin(), amounts.end(), reference.begin(),
+               [](const ImmatureAmountsMap::value_type& lhs, const std::pair<const int, CAmount>& rhs) {
+                   return lhs.first == rhs.first && lhs.second == rhs.second;
+               });
+}
+
+}
+
+TEST(ImmatureAmountsMap, BehavesAsSortedMap) {
+    ImmatureAmountsMap amounts;
+    std::map<int, CAmount> reference;
+
+    // amounts added at increasing heights, and out of order as when blocks are disconnected
+    for (int height : {110, 111, 111, 115, 105, 113}) {
+        amounts[height] += height;
+        reference[height] += height;
+    }
+    EXPECT_TRUE(SameEntries(amounts, reference));
+
+    EXPECT_EQ(amounts.count(111), 1);
+    EXPECT_EQ(amounts.at(111), 222);
+    EXPECT_EQ(amounts.count(112), 0);
+    EXPECT_THROW(amounts.at(112), std::out_of_range);
+
+    // maturing from the lowest height
+    EXPECT_EQ(amounts.erase(105), 1);
+    reference.erase(105);
+    EXPECT_EQ(amounts.erase(105), 0);
+    amounts.erase(amounts.find(113));
+    reference.erase(113);
+    EXPECT_TRUE(SameEntries(amounts, reference));
+}
+
+TEST(ImmatureAmountsMap, SerializationMatchesMap) {
+    ImmatureAmountsMap amounts;
+    std::map<int, CAmount> reference;
+    for (int height = 200; height > 190; height -= 3) {
+        amounts[height] = height * 10;
+        reference[height] = height * 10;
+    }
+
+    CDataStream ssAmounts(SER_DISK, CLIENT_VERSION);
+    ssAmounts << amounts;
+    CDataStream ssReference(SER_DISK, CLIENT_VERSION);
+    ssReference << reference;
+    EXPECT_EQ(ssAmounts.str(), ssReference.str());
+    EXPECT_EQ(::GetSerializeSize(amounts, SER_DISK, CLIENT_VERSION), ssReference.size());
+
+    ImmatureAmountsMap read;
+    ssReference >> read;
+    EXPECT_TRUE(read == amounts);
+}
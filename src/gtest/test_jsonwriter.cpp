@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include "rpc/jsonwriter.h"
+
+#include <univalue.h>
+
+static UniValue SampleValue()
+{
+    UniValue inner(UniValue::VOBJ);
+    inner.pushKV("quoted \"key\"", "line\nbreak");
+    inner.pushKV("empty", UniValue(UniValue::VARR));
+    inner.pushKV("null", NullUniValue);
+
+    UniValue array(UniValue::VARR);
+    array.push_back(1);
+    array.push_back(inner);
+    array.push_back(UniValue(UniValue::VOBJ));
+    array.push_back(false);
+
+    UniValue value(UniValue::VOBJ);
+    value.pushKV("number", 1.5);
+    value.pushKV("array", array);
+    value.pushKV("string", "\xc3\xa9t\xc3\xa9");
+    return value;
+}
+
+TEST(JSONWriter, StreamWritesAsUniValue) {
+    UniValue value = SampleValue();
+
+    // chunks of a few bytes, for the flushes to happen in the middle of the members
+    std::string strOut;
+    size_t nChunks = 0;
+    JSONStreamWriter writer([&](const char* data, size_t size) { strOut.append(data, size); nChunks++; }, 8);
+    writer.Value(value);
+    writer.Flush();
+
+    EXPECT_EQ(strOut, value.write());
+    EXPECT_GT(nChunks, 1);
+}
+
+TEST(JSONWriter, StreamWritesMembersAsProduced) {
+    std::string strOut;
+    JSONStreamWriter writer([&](const char* data, size_t size) { strOut.append(data, size); });
+    writer.BeginObject();
+    writer.KeyValue("a", 1);
+    writer.Key("b");
+    writer.BeginArray();
+    writer.Value("x");
+    writer.BeginObject();
+    writer.EndObject();
+    writer.EndArray();
+    writer.Key("c");
+    writer.Value(SampleValue());
+    writer.EndObject();
+    writer.Flush();
+
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("a", 1);
+    UniValue b(UniValue::VARR);
+    b.push_back("x");
+    b.push_back(UniValue(UniValue::VOBJ));
+    expected.pushKV("b", b);
+    expected.pushKV("c", SampleValue());
+    EXPECT_EQ(strOut, expected.write());
+}
+
+TEST(JSONWriter, TreeRebuildsTheValue) {
+    UniValue value = SampleValue();
+
+    JSONTreeWriter tree;
+    tree.BeginObject();
+    tree.KeyValue("first", value);
+    tree.Key("second");
+    tree.BeginArray();
+    tree.Value(value);
+    tree.EndArray();
+    tree.EndObject();
+
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("first", value);
+    UniValue second(UniValue::VARR);
+    second.push_back(value);
+    expected.pushKV("second", second);
+    EXPECT_EQ(tree.GetValue().write(), expected.write());
+
+    JSONTreeWriter scalar;
+    scalar.Value("hex");
+    EXPECT_EQ(scalar.GetValue().get_str(), "hex");
+}
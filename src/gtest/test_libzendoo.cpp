@@ -386,6 +386,37 @@ TEST(SidechainsField, CtorWithWrappedPtr)
     EXPECT_EQ(fe_C.getUseCount(), 0);
 }
 
+TEST(SidechainsField, LazyDeserialization)
+{
+    CFieldElement validField {SAMPLE_FIELD};
+    uint64_t initialCount = CFieldElement::GetDeserializationsCount();
+
+    // the field is deserialized only once, even when used through its copies
+    ASSERT_TRUE(validField.IsValid());
+    ASSERT_TRUE(validField.IsValid());
+    CFieldElement copiedField(validField);
+    ASSERT_TRUE(copiedField.GetFieldElement() == validField.GetFieldElement());
+    CFieldElement assignedField{};
+    assignedField = copiedField;
+    ASSERT_TRUE(assignedField.IsValid());
+    EXPECT_EQ(CFieldElement::GetDeserializationsCount(), initialCount + 1);
+
+    // a failed deserialization is not attempted again
+    CFieldElement invalidField {std::vector<unsigned char>(CFieldElement::ByteSize(), 0xff)};
+    ASSERT_FALSE(invalidField.IsValid());
+    ASSERT_FALSE(invalidField.IsValid());
+    EXPECT_EQ(CFieldElement::GetDeserializationsCount(), initialCount + 2);
+
+    // setting the byte array invalidates the memoized state
+    invalidField.SetByteArray(SAMPLE_FIELD);
+    ASSERT_TRUE(invalidField.IsValid());
+    EXPECT_EQ(CFieldElement::GetDeserializationsCount(), initialCount + 3);
+
+    invalidField.SetNull();
+    EXPECT_EQ(invalidField.getUseCount(), 0);
+    ASSERT_FALSE(invalidField.IsValid());
+}
+
 TEST(SidechainsField, ComputeHash_EmptyField)
 {
     std::vector<unsigned char> lhs {
@@ -684,12 +715,12 @@ TEST(SidechainsField, CommitmentComputationFromSerializedBlock)
 
         // 255 bit is the fixed field element configuration used at block generation
         FieldElementCertificateFieldConfig fieldConfig = {255};
-        sidechain.fixedParams.vFieldElementCertificateFieldConfig.push_back(fieldConfig);
-        sidechain.fixedParams.vFieldElementCertificateFieldConfig.push_back(fieldConfig);
+        sidechain.ModifyFixedParams().vFieldElementCertificateFieldConfig.push_back(fieldConfig);
+        sidechain.ModifyFixedParams().vFieldElementCertificateFieldConfig.push_back(fieldConfig);
 
         // (254*4, 151) is the fixed bitvector configuration used at block generation
         BitVectorCertificateFieldConfig bitvectorConfig = {254*4, 151};
-        sidechain.fixedParams.vBitVectorCertificateFieldConfig.push_back(bitvectorConfig);
+        sidechain.ModifyFixedParams().vBitVectorCertificateFieldConfig.push_back(bitvectorConfig);
 
         testManager.StoreSidechainWithCurrentHeight(sidechainId, sidechain, 0);
     }
@@ -2764,22 +2795,22 @@ TEST(CctpLibrary, CommitmentBuilder_toomanyCSW)
 
     CSidechain sidechain;
     sidechain.creationBlockHeight = 100;
-    sidechain.fixedParams.withdrawalEpochLength = 20;
-    sidechain.fixedParams.constant = CFieldElement{SAMPLE_FIELD};
-    sidechain.fixedParams.version = 0;
+    sidechain.ModifyFixedParams().withdrawalEpochLength = 20;
+    sidechain.ModifyFixedParams().constant = CFieldElement{SAMPLE_FIELD};
+    sidechain.ModifyFixedParams().version = 0;
     sidechain.lastTopQualityCertHash = uint256S("cccc");
     sidechain.lastTopQualityCertQuality = 100;
     sidechain.lastTopQualityCertReferencedEpoch = -1;
     sidechain.lastTopQualityCertBwtAmount = 50;
     sidechain.balance = CAmount(100);
-    sidechain.fixedParams.wCertVk = BlockchainTestManager::GetInstance().GetTestVerificationKey(testProvingSystem, TestCircuitType::Certificate);
-    sidechain.fixedParams.wCeasedVk = BlockchainTestManager::GetInstance().GetTestVerificationKey(testProvingSystem, TestCircuitType::CSW);
+    sidechain.ModifyFixedParams().wCertVk = BlockchainTestManager::GetInstance().GetTestVerificationKey(testProvingSystem, TestCircuitType::Certificate);
+    sidechain.ModifyFixedParams().wCeasedVk = BlockchainTestManager::GetInstance().GetTestVerificationKey(testProvingSystem, TestCircuitType::CSW);
     
     BlockchainTestManager& testManager = BlockchainTestManager::GetInstance();
     testManager.Reset();
 
     // Store the test sidechain and extend the blockchain to complete at least one epoch. 
-    testManager.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.fixedParams.withdrawalEpochLength);
+    testManager.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.GetFixedParams().withdrawalEpochLength);
 
     CTxCeasedSidechainWithdrawalInput input1 = testManager.CreateCswInput(sidechainId, 1, testProvingSystem);
 
@@ -2838,22 +2869,22 @@ TEST(CctpLibrary, CommitmentBuilder_sameSC_nevermixCSWandFT)
 
     CSidechain sidechain;
     sidechain.creationBlockHeight = 100;
-    sidechain.fixedParams.withdrawalEpochLength = 20;
-    sidechain.fixedParams.constant = CFieldElement{SAMPLE_FIELD};
-    sidechain.fixedParams.version = 0;
+    sidechain.ModifyFixedParams().withdrawalEpochLength = 20;
+    sidechain.ModifyFixedParams().constant = CFieldElement{SAMPLE_FIELD};
+    sidechain.ModifyFixedParams().version = 0;
     sidechain.lastTopQualityCertHash = uint256S("cccc");
     sidechain.lastTopQualityCertQuality = 100;
     sidechain.lastTopQualityCertReferencedEpoch = -1;
     sidechain.lastTopQualityCertBwtAmount = 50;
     sidechain.balance = CAmount(100);
-    sidechain.fixedParams.wCertVk = BlockchainTestManager::GetInstance().GetTestVerificationKey(testProvingSystem, TestCircuitType::Certificate);
-    sidechain.fixedParams.wCeasedVk = BlockchainTestManager::GetInstance().GetTestVerificationKey(testProvingSystem, TestCircuitType::CSW);
+    sidechain.ModifyFixedParams().wCertVk = BlockchainTestManager::GetInstance().GetTestVerificationKey(testProvingSystem, TestCircuitType::Certificate);
+    sidechain.ModifyFixedParams().wCeasedVk = BlockchainTestManager::GetInstance().GetTestVerificationKey(testProvingSystem, TestCircuitType::CSW);
     
     BlockchainTestManager& testManager = BlockchainTestManager::GetInstance();
     testManager.Reset();
 
     // Store the test sidechain and extend the blockchain to complete at least one epoch. 
-    testManager.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.fixedParams.withdrawalEpochLength);
+    testManager.StoreSidechainWithCurrentHeight(sidechainId, sidechain, sidechain.creationBlockHeight + sidechain.GetFixedParams().withdrawalEpochLength);
 
     CTxCeasedSidechainWithdrawalInput csw = testManager.CreateCswInput(sidechainId, 1, testProvingSystem);
 
@@ -3123,4 +3154,105 @@ TEST(CctpLibrary, CommitmentBuilder_cleanCBSafterrewind)
     // Checking that tx2 has been rewind
     auto cbsRef = guardObj.getCBS();
     ASSERT_EQ(cbsRef.cbsaMap[sidechainId].ft, 10);
-}
\ No newline at end of file
+}
+
+TEST(CctpLibrary, CommitmentBuilder_rewindKeepsSidechainsWithEntities)
+{
+    SidechainTxsCommitmentGuard guardObj;
+
+    uint256 sidechainId = uint256S("abc");
+    CMutableTransaction mtx;
+    mtx.nVersion = SC_TX_VERSION;
+    mtx.vsc_ccout.resize(0);
+    mtx.vft_ccout.resize(0);
+    mtx.vmbtr_out.resize(0);
+    mtx.vcsw_ccin.resize(0);
+    for (int i = 0; i < 2; i++)
+        mtx.vft_ccout.push_back(CTxForwardTransferOut(sidechainId, CAmount(43), uint256S("abba101"), uint160S("abba101")));
+    CTransaction tx(mtx);
+
+    CScCertificate cert = txCreationUtils::createCertificate(sidechainId,
+        /*epochNum*/12, CFieldElement{SAMPLE_FIELD}, /*changeTotalAmount*/0,
+        /*numChangeOut */0, /*bwtTotalAmount*/1, /*numBwt*/1, /*ftScFee*/0, /*mbtrScFee*/0);
+
+    ASSERT_TRUE(guardObj.add(tx));
+    ASSERT_TRUE(guardObj.add(cert));
+
+    // The sidechain still has the certificate
+    guardObj.rewind(tx);
+    ASSERT_EQ(guardObj.getCBS().cbsaMap.size(), 1);
+    ASSERT_EQ(guardObj.getCBS().cbsaMap.at(sidechainId).ft, 0);
+    ASSERT_EQ(guardObj.getCBS().cbsaMap.at(sidechainId).cert, 1);
+
+    // Now it is left without entities
+    guardObj.rewind(cert);
+    ASSERT_EQ(guardObj.getCBS().cbsaMap.size(), 0);
+    ASSERT_EQ(guardObj.getCBS().cbscMap.size(), 0);
+
+    // and can be added again
+    ASSERT_TRUE(guardObj.add(tx));
+    ASSERT_EQ(guardObj.getCBS().cbsaMap.at(sidechainId).ft, 2);
+}
+
+TEST(CctpLibrary, IncrementalCommitmentBuilder_templateRefresh)
+{
+    std::vector<CTransaction> txs;
+    for (int i = 0; i < 4; i++)
+    {
+        CMutableTransaction mtx;
+        mtx.nVersion = SC_TX_VERSION;
+        mtx.vft_ccout.push_back(CTxForwardTransferOut(uint256S("abc" + std::to_string(i % 2)), CAmount(10 + i), uint256S("abba101"), uint160S("abba101")));
+        txs.push_back(CTransaction(mtx));
+    }
+
+    auto buildFromScratch = [](const std::vector<CTransaction>& vtx)
+    {
+        SidechainTxsCommitmentBuilder builder;
+        for (const CTransaction& tx : vtx)
+            EXPECT_TRUE(builder.add(tx));
+        return builder.getCommitment();
+    };
+
+    IncrementalSidechainTxsCommitmentBuilder incrementalBuilder;
+    uint256 tipHash = uint256S("aaaa");
+
+    // First template
+    incrementalBuilder.start(tipHash);
+    ASSERT_TRUE(incrementalBuilder.add(txs[0]));
+    ASSERT_TRUE(incrementalBuilder.add(txs[1]));
+    ASSERT_EQ(incrementalBuilder.getReusedContributions(), 0);
+    ASSERT_EQ(incrementalBuilder.getCommitment(), buildFromScratch({txs[0], txs[1]}));
+
+    // Template refresh with new txs appended
+    incrementalBuilder.start(tipHash);
+    ASSERT_TRUE(incrementalBuilder.add(txs[0]));
+    ASSERT_TRUE(incrementalBuilder.add(txs[1]));
+    ASSERT_TRUE(incrementalBuilder.add(txs[2]));
+    ASSERT_EQ(incrementalBuilder.getReusedContributions(), 2);
+    ASSERT_EQ(incrementalBuilder.getCommitment(), buildFromScratch({txs[0], txs[1], txs[2]}));
+
+    // Template refresh with a tx removed
+    incrementalBuilder.start(tipHash);
+    ASSERT_TRUE(incrementalBuilder.add(txs[0]));
+    ASSERT_TRUE(incrementalBuilder.add(txs[2]));
+    ASSERT_EQ(incrementalBuilder.getReusedContributions(), 1);
+    ASSERT_EQ(incrementalBuilder.getCommitment(), buildFromScratch({txs[0], txs[2]}));
+
+    // Template refresh with a tx rewound
+    incrementalBuilder.start(tipHash);
+    ASSERT_TRUE(incrementalBuilder.add(txs[0]));
+    ASSERT_TRUE(incrementalBuilder.add(txs[2]));
+    incrementalBuilder.rewind(txs[2].GetHash());
+    ASSERT_TRUE(incrementalBuilder.add(txs[3]));
+    ASSERT_EQ(incrementalBuilder.getCommitment(), buildFromScratch({txs[0], txs[3]}));
+
+    // New tip
+    incrementalBuilder.start(uint256S("bbbb"));
+    ASSERT_TRUE(incrementalBuilder.add(txs[0]));
+    ASSERT_EQ(incrementalBuilder.getReusedContributions(), 0);
+    ASSERT_EQ(incrementalBuilder.getCommitment(), buildFromScratch({txs[0]}));
+
+    // Empty template
+    incrementalBuilder.start(uint256S("bbbb"));
+    ASSERT_EQ(incrementalBuilder.getCommitment(), SidechainTxsCommitmentBuilder::getEmptyCommitment());
+}
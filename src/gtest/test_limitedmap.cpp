@@ -75,3 +75,19 @@ TEST(LimitedMap, Deletion) {
     lm.erase("c");
     ASSERT_EQ(lm.size(), 0);
 }
+
+TEST(LimitedMap, Clear) {
+    LimitedMap<const char*, int> lm(2);
+
+    lm.insert(std::make_pair("a", 1));
+    lm.insert(std::make_pair("b", 2));
+
+    lm.clear();
+    ASSERT_TRUE(lm.empty());
+    ASSERT_TRUE(lm.find("a") == lm.end());
+
+    // After clearing, the whole capacity is available again.
+    lm.insert(std::make_pair("c", 0));
+    lm.insert(std::make_pair("d", 0));
+    ASSERT_EQ(lm.size(), 2);
+}
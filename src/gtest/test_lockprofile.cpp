@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include "sync.h"
+#include "utiltime.h"
+
+#include <atomic>
+#include <thread>
+
+static const LockSiteStats* FindSite(const std::vector<LockSiteStats>& vStats, int nLine)
+{
+    for (const LockSiteStats& stats : vStats)
+        if (stats.nLine == nLine && stats.file == __FILE__)
+            return &stats;
+    return nullptr;
+}
+
+TEST(LockProfile, RecordsSites) {
+    CCriticalSection cs;
+    GetLockStats(true);
+
+    // not profiled by default
+    { LOCK(cs); }
+    const int nUnprofiledLine = __LINE__ - 1;
+    EXPECT_EQ(nullptr, FindSite(GetLockStats(), nUnprofiledLine));
+
+    fLockProfile = true;
+    for (int i = 0; i < 3; i++) {
+        LOCK(cs);
+    }
+    const int nLine = __LINE__ - 2;
+    {
+        TRY_LOCK(cs, lockTry);
+        const bool fLocked = lockTry;
+        EXPECT_TRUE(fLocked);
+    }
+    const int nTryLine = __LINE__ - 4;
+
+    // a lock held by another thread is contended
+    std::thread holder;
+    std::atomic<bool> fStarted(false);
+    {
+        ENTER_CRITICAL_SECTION(cs);
+        holder = std::thread([&cs, &fStarted]() {
+            fStarted = true;
+            LOCK(cs);
+        });
+        while (!fStarted)
+            MilliSleep(1);
+        MilliSleep(20);
+        LEAVE_CRITICAL_SECTION(cs);
+    }
+    const int nContendedLine = __LINE__ - 7;
+    holder.join();
+    fLockProfile = false;
+
+    std::vector<LockSiteStats> vStats = GetLockStats(true);
+    const LockSiteStats* site = FindSite(vStats, nLine);
+    ASSERT_NE(nullptr, site);
+    EXPECT_EQ("cs", site->name);
+    EXPECT_EQ(3, site->nLocks);
+    EXPECT_EQ(0, site->nContended);
+
+    site = FindSite(vStats, nTryLine);
+    ASSERT_NE(nullptr, site);
+    EXPECT_EQ(1, site->nLocks);
+
+    site = FindSite(vStats, nContendedLine);
+    ASSERT_NE(nullptr, site);
+    EXPECT_EQ(1, site->nLocks);
+    EXPECT_EQ(1, site->nContended);
+    EXPECT_GE(site->wait.nMaxMicros, 10000);
+    uint64_t nWaits = 0;
+    for (int i = 0; i < LockTimeStats::BUCKETS; i++)
+        nWaits += site->wait.vBuckets[i];
+    EXPECT_EQ(1, nWaits);
+
+    // the reset starts counting again
+    EXPECT_EQ(nullptr, FindSite(GetLockStats(), nLine));
+}
@@ -11,6 +11,7 @@
 
 #include <stdexcept>
 
+#include "arith_uint256.h"
 #include "utilstrencodings.h"
 #include "version.h"
 #include "serialize.h"
@@ -299,3 +300,46 @@ TEST(merkletree, testZeroElements) {
         ASSERT_TRUE(newTree.root() == oldroot);
     }
 }
+
+TEST(merkletree, appendRange) {
+    std::vector<uint256> leaves;
+    for (size_t i = 0; i < 11; i++) {
+        leaves.push_back(ArithToUint256(arith_uint256(i + 1)));
+    }
+
+    // the same tree and root as with the leaves appended one by one, also after a first root is cached
+    ZCTestingIncrementalMerkleTree expected, tree;
+    ZCTestingIncrementalWitness expectedWitness, witness;
+    for (size_t i = 0; i < leaves.size(); i++) {
+        expected.append(leaves[i]);
+        if (i == 2) {
+            expectedWitness = expected.witness();
+        } else if (i > 2) {
+            expectedWitness.append(leaves[i]);
+        }
+        ASSERT_TRUE(expectedWitness.root() == expectedWitness.root());
+    }
+    tree.append(leaves.begin(), leaves.begin() + 3);
+    witness = tree.witness();
+    ASSERT_TRUE(tree.root() == witness.root());
+    tree.append(leaves.begin() + 3, leaves.end());
+    witness.append(leaves.begin() + 3, leaves.end());
+    ASSERT_TRUE(tree == expected);
+    ASSERT_TRUE(tree.root() == expected.root());
+    ASSERT_TRUE(witness == expectedWitness);
+    ASSERT_TRUE(witness.root() == expectedWitness.root());
+    ASSERT_TRUE(witness.root() == tree.root());
+
+    // a deserialized tree does not keep the root of the tree it replaces
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << ZCTestingIncrementalMerkleTree();
+    ss >> tree;
+    ASSERT_TRUE(tree.root() == ZCTestingIncrementalMerkleTree::empty_root());
+
+    // the whole range must fit in the tree
+    std::vector<uint256> more(16 - leaves.size() + 1, uint256S("01"));
+    ASSERT_THROW(expected.append(more.begin(), more.end()), std::runtime_error);
+    ASSERT_TRUE(expected.size() == leaves.size());
+    expected.append(more.begin() + 1, more.end());
+    ASSERT_THROW(expected.append(uint256S("01")), std::runtime_error);
+}
@@ -136,3 +136,28 @@ TEST(Metrics, EstimateNetHeightInner) {
     EXPECT_EQ(150, EstimateNetHeightInner(100, 14100, 50, 12000, 0, 150));
     SetMockTime(0);
 }
+
+static MetricValue testMetricB("zen_test_metric{label=\"b\"}", "A test metric");
+static MetricValue testMetricA("zen_test_metric{label=\"a\"}", "A test metric");
+static MetricValue testGauge("zen_test_gauge", "A test gauge", MetricValue::Type::GAUGE);
+
+TEST(Metrics, MetricValue) {
+    testMetricA.Add();
+    testMetricA.Add(2);
+    testGauge.Set(-7);
+    EXPECT_EQ(3, testMetricA.Get());
+    EXPECT_EQ(-7, testGauge.Get());
+
+    std::string out;
+    AppendRegisteredMetrics(out);
+    // the metrics of a family share their HELP and TYPE lines
+    EXPECT_NE(std::string::npos, out.find(
+        "# HELP zen_test_gauge A test gauge\n"
+        "# TYPE zen_test_gauge gauge\n"
+        "zen_test_gauge -7\n"
+        "# HELP zen_test_metric A test metric\n"
+        "# TYPE zen_test_metric counter\n"
+        "zen_test_metric{label=\"a\"} 3\n"
+        "zen_test_metric{label=\"b\"} 0\n"));
+    EXPECT_NE(std::string::npos, out.find("# TYPE zen_transactions_validated_total counter\n"));
+}
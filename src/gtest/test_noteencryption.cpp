@@ -104,6 +104,51 @@ TEST(noteencryption, api)
     }
 }
 
+TEST(noteencryption, try_decrypt_all)
+{
+    uint256 sk_enc = ZCNoteEncryption::generate_privkey(uint252(uint256S("21035d60bc1983e37950ce4803418a8fb33ea68d5b937ca382ecbae7564d6a07")));
+    uint256 pk_enc = ZCNoteEncryption::generate_pubkey(sk_enc);
+    uint256 sk_enc2 = ZCNoteEncryption::generate_privkey(libzcash::random_uint252());
+    uint256 pk_enc2 = ZCNoteEncryption::generate_pubkey(sk_enc2);
+    uint256 hSig = libzcash::random_uint256();
+
+    std::array<unsigned char, ZC_NOTEPLAINTEXT_SIZE> message;
+    for (size_t i = 0; i < ZC_NOTEPLAINTEXT_SIZE; i++) {
+        message[i] = (unsigned char) i;
+    }
+
+    // The ciphertexts of a JoinSplit, the second one to another key
+    ZCNoteEncryption b = ZCNoteEncryption(hSig);
+    std::array<ZCNoteEncryption::Ciphertext, 3> ciphertexts {
+        b.encrypt(pk_enc, message), b.encrypt(pk_enc2, message), b.encrypt(pk_enc, message)
+    };
+
+    ZCNoteDecryption decrypter(sk_enc);
+    auto plaintexts = decrypter.try_decrypt_all(ciphertexts.data(), ciphertexts.size(), b.get_epk(), hSig);
+    ASSERT_EQ(3, plaintexts.size());
+    ASSERT_TRUE((bool) plaintexts[0]);
+    ASSERT_FALSE((bool) plaintexts[1]);
+    ASSERT_TRUE((bool) plaintexts[2]);
+    ASSERT_TRUE(*plaintexts[0] == message);
+    ASSERT_TRUE(*plaintexts[2] == message);
+    // The same as decrypting them one by one
+    ASSERT_TRUE(*plaintexts[2] == decrypter.decrypt(ciphertexts[2], b.get_epk(), hSig, 2));
+
+    ZCNoteDecryption decrypter2(sk_enc2);
+    plaintexts = decrypter2.try_decrypt_all(ciphertexts.data(), ciphertexts.size(), b.get_epk(), hSig);
+    ASSERT_FALSE((bool) plaintexts[0]);
+    ASSERT_TRUE((bool) plaintexts[1]);
+    ASSERT_FALSE((bool) plaintexts[2]);
+
+    // Wrong seed or ephemeral key
+    plaintexts = decrypter.try_decrypt_all(ciphertexts.data(), ciphertexts.size(), b.get_epk(), uint256S("11035d60bc1983e37950ce4803418a8fb33ea68d5b937ca382ecbae7564d6a77"));
+    ASSERT_FALSE((bool) plaintexts[0]);
+    ASSERT_FALSE((bool) plaintexts[2]);
+    plaintexts = decrypter.try_decrypt_all(ciphertexts.data(), ciphertexts.size(), ZCNoteEncryption(hSig).get_epk(), hSig);
+    ASSERT_FALSE((bool) plaintexts[0]);
+    ASSERT_FALSE((bool) plaintexts[2]);
+}
+
 uint256 test_prf(
     unsigned char distinguisher,
     uint252 seed_x,
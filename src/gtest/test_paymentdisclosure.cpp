@@ -209,3 +209,49 @@ TEST(paymentdisclosure, mainnet) {
     mydb.DebugDumpAllStdout();
 #endif
 }
+
+// The entries written in the background are found before being written, and are on disk once flushed,
+// the database being opened on the first access
+TEST(paymentdisclosure, asyncbatch) {
+    SelectParams(CBaseChainParams::MAIN);
+
+    boost::filesystem::path pathTemp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    boost::filesystem::path pathDB = pathTemp / "paymentdisclosure";
+
+    std::vector<PaymentDisclosureKeyInfo> entries;
+    for (int i = 0; i < 10; i++) {
+        PaymentDisclosureKey key { random_uint256(), (size_t)i, 0};
+        PaymentDisclosureInfo info;
+        info.esk = random_uint256();
+        info.joinSplitPrivKey = random_uint256();
+        info.zaddr = libzcash::SpendingKey::random().address();
+        entries.push_back(PaymentDisclosureKeyInfo(key, info));
+    }
+
+    {
+        PaymentDisclosureDBTest mydb(pathDB);
+        ASSERT_FALSE(boost::filesystem::exists(pathDB));
+
+        mydb.PutBatchAsync(entries);
+        for (const PaymentDisclosureKeyInfo& entry : entries) {
+            PaymentDisclosureInfo info;
+            ASSERT_TRUE(mydb.Get(entry.first, info));
+            ASSERT_EQ(entry.second, info);
+        }
+        ASSERT_TRUE(mydb.Flush());
+        ASSERT_TRUE(boost::filesystem::exists(pathDB));
+
+        // queued again, and left to the destructor
+        mydb.PutBatchAsync(std::vector<PaymentDisclosureKeyInfo>(entries.begin(), entries.begin() + 1));
+    }
+
+    PaymentDisclosureDBTest mydb(pathDB);
+    for (const PaymentDisclosureKeyInfo& entry : entries) {
+        PaymentDisclosureInfo info;
+        ASSERT_TRUE(mydb.Get(entry.first, info));
+        ASSERT_EQ(entry.second, info);
+    }
+    PaymentDisclosureKey missing { random_uint256(), 0, 0};
+    PaymentDisclosureInfo info;
+    ASSERT_FALSE(mydb.Get(missing, info));
+}
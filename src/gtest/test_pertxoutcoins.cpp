@@ -0,0 +1,263 @@
+#include <gtest/gtest.h>
+
+#include <init.h>
+#include <txdb.h>
+#include <pertxoutcoins.h>
+#include <util.h>
+#include <script/script.h>
+#include <boost/filesystem.hpp>
+
+#include <atomic>
+
+extern std::atomic<bool> fRequestShutdown;
+
+//! A coins database whose flush thread fails writing its batches
+class CFailingFlushCoinsViewDB : public CCoinsViewDB
+{
+public:
+    CFailingFlushCoinsViewDB(size_t nCacheSize) : CCoinsViewDB(nCacheSize, DEFAULT_DB_MAX_OPEN_FILES, false, false) {}
+
+protected:
+    bool WriteFlushBatch(CLevelDBBatch& batch) override { return false; }
+};
+
+class PerTxOutCoinsTestSuite: public ::testing::Test {
+public:
+    PerTxOutCoinsTestSuite():
+        dataDirLocation(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()),
+        chainStateDbSize(2 * 1024 * 1024) {}
+
+    void SetUp() override {
+        boost::filesystem::create_directories(dataDirLocation);
+        mapArgs["-datadir"] = dataDirLocation.string();
+        pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/true));
+    }
+
+    void TearDown() override {
+        pChainStateDb.reset();
+        ClearDatadirCache();
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(dataDirLocation.string(), ec);
+    }
+
+protected:
+    boost::filesystem::path dataDirLocation;
+    const unsigned int chainStateDbSize;
+    std::unique_ptr<CCoinsViewDB> pChainStateDb;
+
+    CCoins CreateCoins(unsigned int nOutputs) {
+        CCoins coins;
+        coins.nVersion = 1;
+        coins.nHeight = 10;
+        for (unsigned int i = 0; i < nOutputs; i++)
+            coins.vout.push_back(CTxOut(i + 1, CScript() << OP_TRUE));
+        return coins;
+    }
+
+    void WriteCoins(const uint256& txid, const CCoins& coins) {
+        CCoinsMap mapCoins;
+        mapCoins[txid].coins = coins;
+        mapCoins[txid].flags = CCoinsCacheEntry::DIRTY;
+        CAnchorsMap dummyAnchors;
+        CNullifiersMap dummyNullifiers;
+        CSidechainsMap dummySidechains;
+        CSidechainEventsMap dummySidechainEvents;
+        CCswNullifiersMap dummyCswNullifiers;
+        ASSERT_TRUE(pChainStateDb->BatchWrite(mapCoins, uint256(), uint256(), dummyAnchors, dummyNullifiers,
+                                              dummySidechains, dummySidechainEvents, dummyCswNullifiers));
+    }
+};
+
+TEST_F(PerTxOutCoinsTestSuite, LegacyCoinsAreUpgraded) {
+    uint256 txid1 = uint256S("aaa");
+    uint256 txid2 = uint256S("bbb");
+    CCoins coins1 = CreateCoins(5);
+    CCoins coins2 = CreateCoins(1);
+    coins1.Spend(1);
+
+    ASSERT_FALSE(pChainStateDb->IsPerTxOutCoins());
+    WriteCoins(txid1, coins1);
+    WriteCoins(txid2, coins2);
+
+    EXPECT_TRUE(pChainStateDb->UpgradeToPerTxOutCoins());
+    EXPECT_TRUE(pChainStateDb->IsPerTxOutCoins());
+
+    CCoins readCoins;
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid1, readCoins));
+    EXPECT_EQ(readCoins, coins1);
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid2, readCoins));
+    EXPECT_EQ(readCoins, coins2);
+    EXPECT_FALSE(pChainStateDb->HaveCoins(uint256S("ccc")));
+
+    // The layout is persisted
+    pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/false));
+    EXPECT_TRUE(pChainStateDb->IsPerTxOutCoins());
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid1, readCoins));
+    EXPECT_EQ(readCoins, coins1);
+}
+
+TEST_F(PerTxOutCoinsTestSuite, SpendingOutputsThroughTheCache) {
+    ASSERT_TRUE(pChainStateDb->UpgradeToPerTxOutCoins());
+
+    uint256 txid = uint256S("aaa");
+    CCoins coins = CreateCoins(4);
+    {
+        CCoinsViewCache cache(pChainStateDb.get());
+        *cache.ModifyCoins(txid) = coins;
+        ASSERT_TRUE(cache.Flush());
+    }
+
+    CCoins readCoins;
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid, readCoins));
+    EXPECT_EQ(readCoins, coins);
+
+    // Spend an inner and the last output: trailing spent outputs are dropped
+    {
+        CCoinsViewCache cache(pChainStateDb.get());
+        EXPECT_TRUE(cache.ModifyCoins(txid)->Spend(1));
+        EXPECT_TRUE(cache.ModifyCoins(txid)->Spend(3));
+        ASSERT_TRUE(cache.Flush());
+    }
+    coins.Spend(1);
+    coins.Spend(3);
+
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid, readCoins));
+    EXPECT_EQ(readCoins, coins);
+    EXPECT_EQ(readCoins.vout.size(), 3U);
+
+    // Spending everything removes the coins
+    {
+        CCoinsViewCache cache(pChainStateDb.get());
+        EXPECT_TRUE(cache.ModifyCoins(txid)->Spend(0));
+        EXPECT_TRUE(cache.ModifyCoins(txid)->Spend(2));
+        ASSERT_TRUE(cache.Flush());
+    }
+    EXPECT_FALSE(pChainStateDb->HaveCoins(txid));
+    EXPECT_FALSE(pChainStateDb->GetCoins(txid, readCoins));
+}
+
+TEST_F(PerTxOutCoinsTestSuite, AsyncFlushWithPerTxOutLayout) {
+    ASSERT_TRUE(pChainStateDb->UpgradeToPerTxOutCoins());
+    pChainStateDb->StartAsyncFlush();
+
+    uint256 txid = uint256S("aaa");
+    CCoins coins = CreateCoins(3);
+    uint256 bestBlock = uint256S("1234");
+    {
+        CCoinsViewCache cache(pChainStateDb.get());
+        *cache.ModifyCoins(txid) = coins;
+        cache.SetBestBlock(bestBlock);
+        ASSERT_TRUE(cache.Flush());
+    }
+
+    // Reads are served whether the batch is still in flight or already persisted
+    CCoins readCoins;
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid, readCoins));
+    EXPECT_EQ(readCoins, coins);
+    EXPECT_EQ(pChainStateDb->GetBestBlock(), bestBlock);
+
+    // The next flush spends an output of the coins written by the previous one
+    {
+        CCoinsViewCache cache(pChainStateDb.get());
+        EXPECT_TRUE(cache.ModifyCoins(txid)->Spend(0));
+        ASSERT_TRUE(cache.Flush());
+    }
+    coins.Spend(0);
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid, readCoins));
+    EXPECT_EQ(readCoins, coins);
+    EXPECT_TRUE(pChainStateDb->Sync());
+
+    // Everything is on disk once the flush thread is stopped
+    pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/false));
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid, readCoins));
+    EXPECT_EQ(readCoins, coins);
+    EXPECT_EQ(pChainStateDb->GetBestBlock(), bestBlock);
+}
+
+TEST_F(PerTxOutCoinsTestSuite, FailedAsyncFlushKeepsTheBatchAndShutsDown) {
+    pChainStateDb.reset(new CFailingFlushCoinsViewDB(chainStateDbSize));
+    pChainStateDb->StartAsyncFlush();
+    fRequestShutdown = false;
+
+    uint256 txid = uint256S("aaa");
+    CCoins coins = CreateCoins(3);
+    uint256 bestBlock = uint256S("1234");
+    {
+        CCoinsViewCache cache(pChainStateDb.get());
+        *cache.ModifyCoins(txid) = coins;
+        cache.SetBestBlock(bestBlock);
+        // handed over to the flush thread, the failure comes later
+        ASSERT_TRUE(cache.Flush());
+    }
+
+    EXPECT_FALSE(pChainStateDb->Sync());
+    EXPECT_TRUE(ShutdownRequested());
+
+    // the entries of the failed batch are still served, none is lost
+    CCoins readCoins;
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid, readCoins));
+    EXPECT_EQ(readCoins, coins);
+    EXPECT_EQ(pChainStateDb->GetBestBlock(), bestBlock);
+
+    // and no other batch is accepted
+    {
+        CCoinsViewCache cache(pChainStateDb.get());
+        EXPECT_TRUE(cache.ModifyCoins(txid)->Spend(0));
+        EXPECT_FALSE(cache.Flush());
+    }
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid, readCoins));
+    EXPECT_EQ(readCoins, coins);
+
+    fRequestShutdown = false;
+}
+
+TEST_F(PerTxOutCoinsTestSuite, OutputsAreMovedToHeightBuckets) {
+    ASSERT_TRUE(pChainStateDb->UpgradeToPerTxOutCoins());
+
+    uint256 txid1 = uint256S("aaa");
+    uint256 txid2 = uint256S("bbb");
+    CCoins coins1 = CreateCoins(5);
+    CCoins coins2 = CreateCoins(2);
+    coins2.nHeight = 3 * COINS_HEIGHT_BUCKET_SIZE + 1;
+    coins1.Spend(2);
+    WriteCoins(txid1, coins1);
+    WriteCoins(txid2, coins2);
+
+    ASSERT_FALSE(pChainStateDb->IsHeightBucketCoins());
+    EXPECT_TRUE(pChainStateDb->UpgradeToHeightBucketCoins());
+    EXPECT_TRUE(pChainStateDb->IsHeightBucketCoins());
+
+    CCoins readCoins;
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid1, readCoins));
+    EXPECT_EQ(readCoins, coins1);
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid2, readCoins));
+    EXPECT_EQ(readCoins, coins2);
+
+    // Spending through the cache removes the output from its bucket
+    {
+        CCoinsViewCache cache(pChainStateDb.get());
+        EXPECT_TRUE(cache.ModifyCoins(txid2)->Spend(0));
+        ASSERT_TRUE(cache.Flush());
+    }
+    coins2.Spend(0);
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid2, readCoins));
+    EXPECT_EQ(readCoins, coins2);
+
+    // Coins changing height move to the other bucket, without leftovers in the old one
+    coins1.nHeight = 5 * COINS_HEIGHT_BUCKET_SIZE;
+    WriteCoins(txid1, coins1);
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid1, readCoins));
+    EXPECT_EQ(readCoins, coins1);
+    coins1.nHeight = 10;
+    WriteCoins(txid1, coins1);
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid1, readCoins));
+    EXPECT_EQ(readCoins, coins1);
+
+    // The layout is persisted
+    pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/false));
+    EXPECT_TRUE(pChainStateDb->IsHeightBucketCoins());
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid1, readCoins));
+    EXPECT_EQ(readCoins, coins1);
+    EXPECT_TRUE(pChainStateDb->GetCoins(txid2, readCoins));
+    EXPECT_EQ(readCoins, coins2);
+}
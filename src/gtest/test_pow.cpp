@@ -2,9 +2,12 @@
 
 #include "chain.h"
 #include "chainparams.h"
+#include "checkqueue.h"
 #include "pow.h"
 #include "random.h"
 
+#include <boost/thread.hpp>
+
 TEST(PoW, DifficultyAveraging) {
     SelectParams(CBaseChainParams::MAIN);
     const Consensus::Params& params = Params().GetConsensus();
@@ -68,3 +71,34 @@ TEST(PoW, DifficultyAveraging) {
                                         params),
               GetNextWorkRequired(&blocks[lastBlk], nullptr, params));
 }
+
+TEST(PoW, EquihashSolutionsBatch) {
+    SelectParams(CBaseChainParams::MAIN);
+    const CBlockHeader valid = Params().GenesisBlock().GetBlockHeader();
+    CBlockHeader invalid = valid;
+    invalid.nNonce = ArithToUint256(UintToArith256(invalid.nNonce) + 1);
+
+    ClearEquihashCache();
+    EXPECT_TRUE(CheckEquihashSolution(&valid, Params()));
+    EXPECT_FALSE(CheckEquihashSolution(&invalid, Params()));
+    // the cached solution is still found valid, the invalid one is not cached
+    EXPECT_TRUE(CheckEquihashSolution(&valid, Params()));
+    EXPECT_FALSE(CheckEquihashSolution(&invalid, Params()));
+
+    CCheckQueue<CCheckJob> queue(1);
+    boost::thread_group threads;
+    for (int i = 0; i < 3; i++)
+        threads.create_thread(boost::bind(&CCheckQueue<CCheckJob>::Thread, &queue));
+
+    for (CCheckQueue<CCheckJob>* pqueue : {(CCheckQueue<CCheckJob>*)NULL, &queue}) {
+        ClearEquihashCache();
+        EXPECT_TRUE(CheckEquihashSolutions(std::vector<const CBlockHeader*>(8, &valid), Params(), pqueue));
+        std::vector<const CBlockHeader*> vpblock(8, &valid);
+        vpblock[5] = &invalid;
+        EXPECT_FALSE(CheckEquihashSolutions(vpblock, Params(), pqueue));
+        EXPECT_TRUE(CheckEquihashSolutions(std::vector<const CBlockHeader*>(), Params(), pqueue));
+    }
+
+    threads.interrupt_all();
+    threads.join_all();
+}
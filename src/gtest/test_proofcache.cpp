@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include "sc/proofcache.h"
+#include "util.h"
+
+class ProofVerificationCacheTestSuite : public ::testing::Test
+{
+public:
+    void SetUp() override
+    {
+        CScProofVerificationCache::GetInstance().Clear();
+    }
+
+    void TearDown() override
+    {
+        mapArgs.erase("-maxproofcachesize");
+        CScProofVerificationCache::GetInstance().Clear();
+    }
+
+    static CProofVerifierItem CreateCertItem(uint64_t quality)
+    {
+        CCertProofVerifierInput input;
+        input.proof = CScProof(std::vector<unsigned char>(10, 0xab));
+        input.verificationKey = CScVKey(std::vector<unsigned char>(10, 0xcd));
+        input.scId = uint256S("aaaa");
+        input.epochNumber = 3;
+        input.quality = quality;
+        input.mainchainBackwardTransferRequestScFee = 0;
+        input.forwardTransferScFee = 0;
+
+        CProofVerifierItem item;
+        item.txHash = uint256S(std::to_string(quality));
+        item.node = nullptr;
+        item.result = ProofVerificationResult::Passed;
+        item.proofInput = input;
+        return item;
+    }
+
+    static CProofVerifierItem CreateCswItem(const std::vector<CAmount>& values)
+    {
+        std::vector<CCswProofVerifierInput> inputs;
+
+        for (CAmount value : values)
+        {
+            CCswProofVerifierInput input;
+            input.proof = CScProof(std::vector<unsigned char>(10, 0xab));
+            input.verificationKey = CScVKey(std::vector<unsigned char>(10, 0xcd));
+            input.scId = uint256S("bbbb");
+            input.nValue = value;
+            inputs.push_back(input);
+        }
+
+        CProofVerifierItem item;
+        item.txHash = uint256S("cccc");
+        item.node = nullptr;
+        item.result = ProofVerificationResult::Passed;
+        item.proofInput = inputs;
+        return item;
+    }
+};
+
+/**
+ * @brief Check that a proof is found only if verified against the same public inputs.
+ */
+TEST_F(ProofVerificationCacheTestSuite, Cert_Lookup)
+{
+    CScProofVerificationCache& cache = CScProofVerificationCache::GetInstance();
+
+    CProofVerifierItem item = CreateCertItem(10);
+    ASSERT_FALSE(cache.Contains(item));
+
+    cache.Insert(item);
+    ASSERT_TRUE(cache.Contains(item));
+    ASSERT_FALSE(cache.Contains(CreateCertItem(11)));
+
+    ProofVerificationCacheStatistics stats = cache.GetStatistics();
+    ASSERT_EQ(stats.hits, 1);
+    ASSERT_EQ(stats.misses, 2);
+    ASSERT_EQ(stats.size, 1);
+}
+
+/**
+ * @brief Check that a transaction is found only if all its CSW proofs are in the cache.
+ */
+TEST_F(ProofVerificationCacheTestSuite, Csw_Lookup)
+{
+    CScProofVerificationCache& cache = CScProofVerificationCache::GetInstance();
+
+    cache.Insert(CreateCswItem({1, 2}));
+    ASSERT_EQ(cache.GetStatistics().size, 2);
+
+    ASSERT_TRUE(cache.Contains(CreateCswItem({1})));
+    ASSERT_TRUE(cache.Contains(CreateCswItem({2, 1})));
+    ASSERT_FALSE(cache.Contains(CreateCswItem({1, 3})));
+}
+
+/**
+ * @brief Check that the cache never exceeds the configured size.
+ */
+TEST_F(ProofVerificationCacheTestSuite, Max_Size)
+{
+    CScProofVerificationCache& cache = CScProofVerificationCache::GetInstance();
+
+    mapArgs["-maxproofcachesize"] = "5";
+
+    for (uint64_t quality = 0; quality < 20; quality++)
+    {
+        cache.Insert(CreateCertItem(quality));
+    }
+
+    ASSERT_EQ(cache.GetStatistics().size, 5);
+    ASSERT_TRUE(cache.Contains(CreateCertItem(19)));
+
+    mapArgs["-maxproofcachesize"] = "0";
+    cache.Clear();
+    cache.Insert(CreateCertItem(0));
+    ASSERT_EQ(cache.GetStatistics().size, 0);
+}
+
+/**
+ * @brief Check that the entries of the cache can be restored, as done when the mempool is loaded from disk.
+ */
+TEST_F(ProofVerificationCacheTestSuite, Restore_Entries)
+{
+    CScProofVerificationCache& cache = CScProofVerificationCache::GetInstance();
+
+    cache.Insert(CreateCertItem(7));
+    cache.Insert(CreateCswItem({1, 2}));
+
+    std::vector<CScProofVerificationCache::entry_type> entries = cache.GetEntries();
+    ASSERT_EQ(entries.size(), 3);
+
+    cache.Clear();
+    ASSERT_FALSE(cache.Contains(CreateCertItem(7)));
+
+    cache.AddEntries(entries);
+    ASSERT_EQ(cache.GetStatistics().size, 3);
+    ASSERT_TRUE(cache.Contains(CreateCertItem(7)));
+    ASSERT_TRUE(cache.Contains(CreateCswItem({2, 1})));
+}
+
+/**
+ * @brief Check that the cache entry memoized in a verifier input is the one used for the lookup.
+ */
+TEST_F(ProofVerificationCacheTestSuite, Memoized_Entry)
+{
+    CScProofVerificationCache& cache = CScProofVerificationCache::GetInstance();
+
+    CProofVerifierItem item = CreateCertItem(10);
+    CCertProofVerifierInput& input = boost::get<CCertProofVerifierInput>(item.proofInput);
+    const CScProofVerificationCache::entry_type entry = CScProofVerificationCache::GetEntry(input);
+
+    input.cacheEntry = std::make_shared<const CScProofVerificationCache::entry_type>(entry);
+    ASSERT_TRUE(CScProofVerificationCache::GetEntry(input) == entry);
+
+    cache.Insert(item);
+    ASSERT_TRUE(cache.Contains(CreateCertItem(10)));
+}
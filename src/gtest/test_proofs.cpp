@@ -700,3 +700,39 @@ TEST(proofs, g2_test_vectors)
         ASSERT_TRUE(expected.to_libsnark_g2<curve_G2>() == e);
     }
 }
+
+TEST(proofs, batched_verifier)
+{
+    auto example = libsnark::generate_r1cs_example_with_field_input<curve_Fr>(250, 4);
+    example.constraint_system.swap_AB_if_beneficial();
+    auto kp = libsnark::r1cs_ppzksnark_generator<curve_pp>(example.constraint_system);
+    auto vkprecomp = libsnark::r1cs_ppzksnark_verifier_process_vk(kp.vk);
+
+    PHGRProofBatch batch1, batch2;
+    for (size_t i = 0; i < 4; i++) {
+        auto proof = libsnark::r1cs_ppzksnark_prover<curve_pp>(
+            kp.pk,
+            example.primary_input,
+            example.auxiliary_input,
+            example.constraint_system
+        );
+        auto verifier = ProofVerifier::Batched(i < 2 ? batch1 : batch2);
+        ASSERT_TRUE(verifier.check(kp.vk, vkprecomp, example.primary_input, proof));
+    }
+    ASSERT_EQ(batch1.size(), 2U);
+    ASSERT_TRUE(batch1.verify());
+
+    batch1.append(batch2);
+    ASSERT_EQ(batch1.size(), 4U);
+    ASSERT_TRUE(batch1.verify());
+
+    // the batched verifier accepts a bad proof, which makes its batch fail
+    auto badproof = PHGRProof::random_invalid().to_libsnark_proof<libsnark::r1cs_ppzksnark_proof<curve_pp>>();
+    auto verifier = ProofVerifier::Batched(batch2);
+    ASSERT_TRUE(verifier.check(kp.vk, vkprecomp, example.primary_input, badproof));
+    ASSERT_FALSE(batch2.verify());
+    batch1.append(batch2);
+    ASSERT_FALSE(batch1.verify());
+
+    ASSERT_TRUE(PHGRProofBatch().verify());
+}
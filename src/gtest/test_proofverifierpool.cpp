@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+
+#include "sc/proofverifierpool.h"
+#include "utiltime.h"
+
+/**
+ * @brief Creates a group of tasks that keep a worker busy for a while,
+ * tracking the maximum number of tasks running at the same time.
+ */
+static std::vector<CScProofVerifierPool::Task> CreateTasks(size_t numberOfTasks, std::atomic<int>& running, std::atomic<int>& maxRunning, std::atomic<int>& completed)
+{
+    std::vector<CScProofVerifierPool::Task> tasks;
+
+    for (size_t i = 0; i < numberOfTasks; i++)
+    {
+        tasks.push_back([&]()
+        {
+            int current = ++running;
+            int previousMax = maxRunning.load();
+            while (current > previousMax && !maxRunning.compare_exchange_weak(previousMax, current));
+
+            MilliSleep(50);
+
+            --running;
+            ++completed;
+        });
+    }
+
+    return tasks;
+}
+
+TEST(ProofVerifierPool, TasksRunInlineWhenStopped)
+{
+    CScProofVerifierPool& pool = CScProofVerifierPool::GetInstance();
+    ASSERT_FALSE(pool.IsRunning());
+    ASSERT_EQ(pool.GetNumberOfWorkers(), 1);
+
+    // A single thread doesn't start the pool.
+    pool.Start(1, 0);
+    ASSERT_FALSE(pool.IsRunning());
+
+    boost::thread::id callerId = boost::this_thread::get_id();
+    int executed = 0;
+
+    std::vector<CScProofVerifierPool::Task> tasks;
+    for (int i = 0; i < 3; i++)
+    {
+        tasks.push_back([&]() { ASSERT_EQ(boost::this_thread::get_id(), callerId); executed++; });
+    }
+
+    pool.RunTasks(tasks, false);
+    ASSERT_EQ(executed, 3);
+}
+
+TEST(ProofVerifierPool, ReservedWorkers)
+{
+    CScProofVerifierPool& pool = CScProofVerifierPool::GetInstance();
+    pool.Start(3, 1);
+    ASSERT_TRUE(pool.IsRunning());
+    ASSERT_TRUE(pool.HasReservedWorkers());
+    ASSERT_EQ(pool.GetNumberOfWorkers(), 3);
+
+    std::atomic<int> running(0), maxRunning(0), completed(0);
+
+    // Low priority tasks can't use the reserved worker.
+    pool.RunTasks(CreateTasks(6, running, maxRunning, completed), false);
+    ASSERT_EQ(completed.load(), 6);
+    ASSERT_EQ(maxRunning.load(), 2);
+
+    // High priority tasks can use all the workers.
+    maxRunning = 0;
+    completed = 0;
+    pool.RunTasks(CreateTasks(6, running, maxRunning, completed), true);
+    ASSERT_EQ(completed.load(), 6);
+    ASSERT_EQ(maxRunning.load(), 3);
+
+    pool.Stop();
+    ASSERT_FALSE(pool.IsRunning());
+    ASSERT_FALSE(pool.HasReservedWorkers());
+}
+
+TEST(ProofVerifierPool, AtLeastOneLowPriorityWorker)
+{
+    CScProofVerifierPool& pool = CScProofVerifierPool::GetInstance();
+
+    // Reserving all the workers would starve the low priority tasks.
+    pool.Start(2, 5);
+
+    std::atomic<int> running(0), maxRunning(0), completed(0);
+    pool.RunTasks(CreateTasks(3, running, maxRunning, completed), false);
+    ASSERT_EQ(completed.load(), 3);
+    ASSERT_EQ(maxRunning.load(), 1);
+
+    pool.Stop();
+}
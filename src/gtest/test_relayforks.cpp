@@ -402,3 +402,51 @@ TEST(relayforks_test, getfinality) {
 
     CleanUpAll();
 }
+
+TEST(relayforks_test, globaltipsbytime) {
+    std::vector<CBlockIndex> vIndex(5);
+    for (size_t i = 0; i < vIndex.size(); i++)
+        vIndex[i].nHeight = i % 3;
+
+    CGlobalForkTips tips;
+    for (size_t i = 0; i < vIndex.size(); i++)
+        ASSERT_TRUE(tips.insert(&vIndex[i], 100 + i));
+    // already there, the time is not changed
+    ASSERT_FALSE(tips.insert(&vIndex[0], 1000));
+    ASSERT_EQ(tips.size(), vIndex.size());
+    ASSERT_EQ(tips[&vIndex[0]], 100);
+
+    // still ordered by height
+    ASSERT_EQ(tips.begin()->first->nHeight, 2);
+    int lastHeight = 3;
+    for (const auto& tip : tips) {
+        ASSERT_TRUE(tip.first->nHeight <= lastHeight);
+        lastHeight = tip.first->nHeight;
+    }
+
+    std::vector<const CBlockIndex*> vRecent;
+    tips.GetMostRecent(3, vRecent);
+    ASSERT_EQ(vRecent, std::vector<const CBlockIndex*>({&vIndex[4], &vIndex[3], &vIndex[2]}));
+
+    tips.Update(&vIndex[0], 200);
+    tips.Update(&vIndex[3], 50);
+    ASSERT_TRUE(tips.erase(&vIndex[4]) == 1);
+    ASSERT_TRUE(tips.erase(&vIndex[4]) == 0);
+    ASSERT_EQ(tips[&vIndex[4]], 0);
+    vRecent.clear();
+    tips.GetMostRecent(10, vRecent);
+    ASSERT_EQ(vRecent, std::vector<const CBlockIndex*>({&vIndex[0], &vIndex[2], &vIndex[1], &vIndex[3]}));
+
+    // added by the update if missing
+    tips.Update(&vIndex[4], 300);
+    ASSERT_EQ(tips.count(&vIndex[4]), 1U);
+    vRecent.clear();
+    tips.GetMostRecent(1, vRecent);
+    ASSERT_EQ(vRecent, std::vector<const CBlockIndex*>({&vIndex[4]}));
+
+    tips.clear();
+    ASSERT_EQ(tips.size(), 0U);
+    vRecent.clear();
+    tips.GetMostRecent(10, vRecent);
+    ASSERT_TRUE(vRecent.empty());
+}
@@ -4,12 +4,13 @@
 #include "chain.h"
 #include "chainparams.h"
 #include "clientversion.h"
+#include "main.h"
 #include "primitives/block.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "utilstrencodings.h"
 
-extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false, const CChain& chain = chainActive);
 
 TEST(rpc, check_blockToJSON_returns_minified_solution) {
     SelectParams(CBaseChainParams::TESTNET);
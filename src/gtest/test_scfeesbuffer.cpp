@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <clientversion.h>
+#include <random.h>
+#include <streams.h>
+#include <sc/scfeesbuffer.h>
+
+#include <algorithm>
+#include <deque>
+#include <list>
+#include <memory>
+
+using Sidechain::ScFeeData;
+using Sidechain::ScFeeData_v2;
+using Sidechain::ScFeesBuffer;
+
+TEST(ScFeesBuffer, MinimumMatchesFullScan) {
+    ScFeesBuffer buffer;
+    std::deque<ScFeeData_v2> reference;
+    static const size_t MAX_SIZE = 7;
+    buffer.reserve(MAX_SIZE);
+
+    for (int height = 0; height < 500; height++) {
+        if (reference.size() == MAX_SIZE) {
+            buffer.pop_front();
+            reference.pop_front();
+        }
+        ScFeeData_v2 entry(GetRand(20), GetRand(20), height);
+        buffer.push_back(entry);
+        reference.push_back(entry);
+
+        if (GetRand(3) == 0) {
+            CAmount ft = GetRand(20), mbtr = GetRand(20);
+            buffer.LowerBackFees(ft, mbtr);
+            reference.back().forwardTxScFee = std::min(reference.back().forwardTxScFee, ft);
+            reference.back().mbtrTxScFee    = std::min(reference.back().mbtrTxScFee, mbtr);
+        }
+
+        CAmount minFt = MAX_MONEY, minMbtr = MAX_MONEY;
+        for (const ScFeeData_v2& e : reference) {
+            minFt   = std::min(minFt, e.forwardTxScFee);
+            minMbtr = std::min(minMbtr, e.mbtrTxScFee);
+        }
+        ASSERT_EQ(buffer.GetMinFtScFee(), minFt);
+        ASSERT_EQ(buffer.GetMinMbtrScFee(), minMbtr);
+        ASSERT_TRUE(std::equal(buffer.begin(), buffer.end(), reference.begin()));
+    }
+
+    // A full buffer does not allocate to replace its oldest entry
+    size_t usage = buffer.DynamicMemoryUsage();
+    buffer.pop_front();
+    buffer.push_back(ScFeeData_v2(1, 1, 1000));
+    EXPECT_EQ(buffer.DynamicMemoryUsage(), usage);
+}
+
+TEST(ScFeesBuffer, SerializationMatchesPolymorphicList) {
+    std::list<std::shared_ptr<ScFeeData>> legacy;
+    std::list<std::shared_ptr<ScFeeData>> legacyV2;
+    ScFeesBuffer buffer;
+    ScFeesBuffer bufferV2;
+    for (int i = 0; i < 5; i++) {
+        legacy.emplace_back(new ScFeeData(i, 10 - i));
+        legacyV2.emplace_back(new ScFeeData_v2(i, 10 - i, 100 + i));
+        buffer.push_back(ScFeeData_v2(i, 10 - i, -1));
+        bufferV2.push_back(ScFeeData_v2(i, 10 - i, 100 + i));
+    }
+
+    CDataStream ssLegacy(SER_DISK, CLIENT_VERSION);
+    ::Serialize<CDataStream, ScFeeData, decltype(legacy), ScFeeData>(ssLegacy, legacy, SER_DISK, CLIENT_VERSION);
+    CDataStream ssBuffer(SER_DISK, CLIENT_VERSION);
+    buffer.Serialize(ssBuffer, false, SER_DISK, CLIENT_VERSION);
+    EXPECT_EQ(ssLegacy.str(), ssBuffer.str());
+
+    CDataStream ssLegacyV2(SER_DISK, CLIENT_VERSION);
+    ::Serialize<CDataStream, ScFeeData, decltype(legacyV2), ScFeeData_v2>(ssLegacyV2, legacyV2, SER_DISK, CLIENT_VERSION);
+    CDataStream ssBufferV2(SER_DISK, CLIENT_VERSION);
+    bufferV2.Serialize(ssBufferV2, true, SER_DISK, CLIENT_VERSION);
+    EXPECT_EQ(ssLegacyV2.str(), ssBufferV2.str());
+
+    ScFeesBuffer read;
+    read.Unserialize(ssBufferV2, true, SER_DISK, CLIENT_VERSION);
+    EXPECT_TRUE(read == bufferV2);
+    EXPECT_EQ(read.GetMinFtScFee(), 0);
+    EXPECT_EQ(read.GetMinMbtrScFee(), 6);
+}
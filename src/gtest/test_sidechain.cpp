@@ -558,8 +558,8 @@ TEST_F(SidechainsTestSuite, ScCreationIsNotApplicableToStateIfScIsAlreadyAlive)
     CSidechain initialScState;
     uint256 scId = aTransaction.GetScIdFromScCcOut(0);
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().version = 0;
     int heightWhereAlive = initialScState.GetScheduledCeasingHeight() -1;
 
     storeSidechainWithCurrentHeight(scId, initialScState, heightWhereAlive);
@@ -580,8 +580,8 @@ TEST_F(SidechainsTestSuite, ScCreationIsNotApplicableToStateIfScIsAlreadyCeased)
     CSidechain initialScState;
     uint256 scId = aTransaction.GetScIdFromScCcOut(0);
     initialScState.creationBlockHeight = 200;
-    initialScState.fixedParams.withdrawalEpochLength = 10;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 10;
+    initialScState.ModifyFixedParams().version = 0;
     int heightWhereCeased = initialScState.GetScheduledCeasingHeight();
 
     storeSidechainWithCurrentHeight(scId, initialScState, heightWhereCeased);
@@ -637,8 +637,8 @@ TEST_F(SidechainsTestSuite, ForwardTransferToAliveSCsIsApplicableToState) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().version = 0;
     int heightWhereAlive = initialScState.GetScheduledCeasingHeight() -1;
 
     storeSidechainWithCurrentHeight(scId, initialScState, heightWhereAlive);
@@ -659,8 +659,8 @@ TEST_F(SidechainsTestSuite, ForwardTransferToCeasedSCsIsNotApplicableToState) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().version = 0;
     int heightWhereCeased = initialScState.GetScheduledCeasingHeight();
 
     storeSidechainWithCurrentHeight(scId, initialScState, heightWhereCeased);
@@ -681,9 +681,9 @@ TEST_F(SidechainsTestSuite, McBwtRequestToAliveSidechainWithKeyIsApplicableToSta
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
-    initialScState.fixedParams.mainchainBackwardTransferRequestDataLength = 1;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().mainchainBackwardTransferRequestDataLength = 1;
+    initialScState.ModifyFixedParams().version = 0;
     int heightWhereAlive = initialScState.GetScheduledCeasingHeight()-1;
 
     storeSidechainWithCurrentHeight(scId, initialScState, heightWhereAlive);
@@ -762,8 +762,8 @@ TEST_F(SidechainsTestSuite, McBwtRequestToAliveSidechainWithoutKeyIsNotApplicabl
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().version = 0;
     int heightWhereAlive = initialScState.GetScheduledCeasingHeight()-1;
 
     storeSidechainWithCurrentHeight(scId, initialScState, heightWhereAlive);
@@ -827,8 +827,8 @@ TEST_F(SidechainsTestSuite, McBwtRequestToCeasedSidechainIsNotApplicableToState)
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().version = 0;
     int heightWhereCeased = initialScState.GetScheduledCeasingHeight();
 
     storeSidechainWithCurrentHeight(scId, initialScState, heightWhereCeased);
@@ -852,11 +852,11 @@ TEST_F(SidechainsTestSuite, CSWsToCeasedSidechainIsAccepted) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
-    initialScState.fixedParams.wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
     initialScState.balance = CAmount{1000};
     initialScState.pastEpochTopQualityCertView.certDataHash = CFieldElement{SAMPLE_FIELD};
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().version = 0;
     int heightWhereCeased = initialScState.GetScheduledCeasingHeight();
 
     storeSidechainWithCurrentHeight(scId, initialScState, heightWhereCeased);
@@ -878,9 +878,9 @@ TEST_F(SidechainsTestSuite, CSWsToCeasedSidechainWithWrongActiveCertDataIsRefuse
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
-    initialScState.fixedParams.wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.balance = CAmount{1000};
 
     std::vector<unsigned char> badVec(size_t(CFieldElement::ByteSize()-2), 0xaa);
@@ -904,9 +904,9 @@ TEST_F(SidechainsTestSuite, ExcessiveAmountOfCSWsToCeasedSidechainIsRejected) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
-    initialScState.fixedParams.wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.balance = CAmount{1000};
     int heightWhereCeased = initialScState.GetScheduledCeasingHeight();
 
@@ -925,9 +925,9 @@ TEST_F(SidechainsTestSuite, ValidCeasedCumTreeHashesForCeasedSidechain) {
     CSidechain sc;
     uint256 scId = uint256S("aaaa");
     sc.creationBlockHeight = 1492;
-    sc.fixedParams.withdrawalEpochLength = 14;
-    sc.fixedParams.wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
-    sc.fixedParams.version = 0;
+    sc.ModifyFixedParams().withdrawalEpochLength = 14;
+    sc.ModifyFixedParams().wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
+    sc.ModifyFixedParams().version = 0;
     sc.balance = CAmount{1000};
     int heightWhereCeased = sc.GetScheduledCeasingHeight();
 
@@ -945,9 +945,9 @@ TEST_F(SidechainsTestSuite, InvalidCeasedCumTreeHashesForUnceasedSidechain) {
     CSidechain sc;
     uint256 scId = uint256S("aaaa");
     sc.creationBlockHeight = 1492;
-    sc.fixedParams.withdrawalEpochLength = 14;
-    sc.fixedParams.wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
-    sc.fixedParams.version = 0;
+    sc.ModifyFixedParams().withdrawalEpochLength = 14;
+    sc.ModifyFixedParams().wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
+    sc.ModifyFixedParams().version = 0;
     sc.balance = CAmount{1000};
     int heightWhereCeased = sc.GetScheduledCeasingHeight();
 
@@ -963,9 +963,9 @@ TEST_F(SidechainsTestSuite, InvalidCeasedCumTreeHashesForJustStartedSidechain) {
     CSidechain sc;
     uint256 scId = uint256S("aaaa");
     sc.creationBlockHeight = 1492;
-    sc.fixedParams.withdrawalEpochLength = 14;
-    sc.fixedParams.wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
-    sc.fixedParams.version = 0;
+    sc.ModifyFixedParams().withdrawalEpochLength = 14;
+    sc.ModifyFixedParams().wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
+    sc.ModifyFixedParams().version = 0;
     sc.balance = CAmount{1000};
 
     storeSidechainWithCurrentHeight(scId, sc, sc.creationBlockHeight+1);
@@ -991,9 +991,9 @@ TEST_F(SidechainsTestSuite, CSWsToActiveSidechainIsRefused) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
-    initialScState.fixedParams.wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().wCeasedVk = CScVKey{SAMPLE_CSW_DARLIN_VK};
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.balance = CAmount{1000};
     int heightWhereAlive = initialScState.GetScheduledCeasingHeight()-1;
 
@@ -1574,14 +1574,14 @@ TEST_F(SidechainsTestSuite, GetScIdsOnChainstateDbSelectOnlySidechains) {
     sidechain1.flag = CSidechainsCacheEntry::Flags::FRESH;
     sidechain1.sidechain.balance = CAmount(100);
     sidechain1.sidechain.creationBlockHeight = 1985;
-    sidechain1.sidechain.fixedParams.version = 0;
+    sidechain1.sidechain.ModifyFixedParams().version = 0;
     uint256 scId1 = uint256S("123456789AAA");
 
     CSidechainsCacheEntry sidechain2;
     sidechain2.flag = CSidechainsCacheEntry::Flags::FRESH;
     sidechain2.sidechain.balance = CAmount(100);
     sidechain2.sidechain.creationBlockHeight = 1985;
-    sidechain2.sidechain.fixedParams.version = 0;
+    sidechain2.sidechain.ModifyFixedParams().version = 0;
     uint256 scId2 = uint256S("987654321BBB");
 
     CSidechainsMap mapSidechains;
@@ -1627,6 +1627,95 @@ TEST_F(SidechainsTestSuite, GetScIdsOnChainstateDbSelectOnlySidechains) {
     boost::system::error_code ec;
     boost::filesystem::remove_all(pathTemp.string(), ec);
 }
+TEST_F(SidechainsTestSuite, GetScIdsByCeasingHeightOnChainstateDb) {
+
+    //init a tmp chainstateDb
+    boost::filesystem::path pathTemp(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path());
+    const unsigned int      chainStateDbSize(2 * 1024 * 1024);
+    boost::filesystem::create_directories(pathTemp);
+    mapArgs["-datadir"] = pathTemp.string();
+
+    CCoinsViewDB chainStateDb(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/true);
+    EXPECT_TRUE(chainStateDb.BuildScCeasingIndex());
+    sidechainsView->SetBackend(chainStateDb);
+
+    //Insert in db two sidechains with different ceasing heights
+    CSidechainsCacheEntry sidechain1;
+    sidechain1.flag = CSidechainsCacheEntry::Flags::FRESH;
+    sidechain1.sidechain.creationBlockHeight = 100;
+    sidechain1.sidechain.ModifyFixedParams().version = 0;
+    sidechain1.sidechain.ModifyFixedParams().withdrawalEpochLength = 10;
+    uint256 scId1 = uint256S("123456789AAA");
+
+    CSidechainsCacheEntry sidechain2 = sidechain1;
+    sidechain2.sidechain.ModifyFixedParams().withdrawalEpochLength = 50;
+    uint256 scId2 = uint256S("987654321BBB");
+
+    int ceasingHeight1 = sidechain1.sidechain.GetScheduledCeasingHeight();
+    int ceasingHeight2 = sidechain2.sidechain.GetScheduledCeasingHeight();
+    ASSERT_TRUE(ceasingHeight1 < ceasingHeight2);
+
+    CSidechainsMap mapSidechains;
+    mapSidechains[scId1] = sidechain1;
+    mapSidechains[scId2] = sidechain2;
+
+    CCoinsMap mapCoins;
+    CAnchorsMap dummyAnchorsMap;
+    CNullifiersMap dummyNullifiersMap;
+    CSidechainEventsMap mapCeasingScs;
+    CCswNullifiersMap cswNullifiers;
+
+    chainStateDb.BatchWrite(mapCoins, uint256(), uint256(), dummyAnchorsMap, dummyNullifiersMap, mapSidechains, mapCeasingScs, cswNullifiers);
+
+    std::set<uint256> scIds;
+    chainStateDb.GetScIdsByCeasingHeight(0, ceasingHeight1, scIds);
+    EXPECT_EQ(scIds, std::set<uint256>({scId1}));
+
+    scIds.clear();
+    chainStateDb.GetScIdsByCeasingHeight(ceasingHeight1 + 1, ceasingHeight2, scIds);
+    EXPECT_EQ(scIds, std::set<uint256>({scId2}));
+
+    // A certificate postpones the ceasing of the first sidechain: the index entry is moved
+    sidechain1.flag = CSidechainsCacheEntry::Flags::DIRTY;
+    sidechain1.sidechain.lastTopQualityCertReferencedEpoch = 10;
+    int newCeasingHeight1 = sidechain1.sidechain.GetScheduledCeasingHeight();
+    ASSERT_TRUE(newCeasingHeight1 > ceasingHeight2);
+
+    // Cached changes are visible before being flushed
+    sidechainsView->getSidechainMap()[scId1] = sidechain1;
+
+    scIds.clear();
+    sidechainsView->GetScIdsByCeasingHeight(0, ceasingHeight2, scIds);
+    EXPECT_EQ(scIds, std::set<uint256>({scId2}));
+
+    mapSidechains.clear();
+    mapSidechains[scId1] = sidechain1;
+    chainStateDb.BatchWrite(mapCoins, uint256(), uint256(), dummyAnchorsMap, dummyNullifiersMap, mapSidechains, mapCeasingScs, cswNullifiers);
+
+    scIds.clear();
+    chainStateDb.GetScIdsByCeasingHeight(0, ceasingHeight2, scIds);
+    EXPECT_EQ(scIds, std::set<uint256>({scId2}));
+
+    scIds.clear();
+    chainStateDb.GetScIdsByCeasingHeight(0, newCeasingHeight1, scIds);
+    EXPECT_EQ(scIds, std::set<uint256>({scId1, scId2}));
+
+    // Erased sidechains are removed from the index
+    CSidechainsCacheEntry erased;
+    erased.flag = CSidechainsCacheEntry::Flags::ERASED;
+    mapSidechains.clear();
+    mapSidechains[scId2] = erased;
+    chainStateDb.BatchWrite(mapCoins, uint256(), uint256(), dummyAnchorsMap, dummyNullifiersMap, mapSidechains, mapCeasingScs, cswNullifiers);
+
+    scIds.clear();
+    chainStateDb.GetScIdsByCeasingHeight(0, INT_MAX, scIds);
+    EXPECT_EQ(scIds, std::set<uint256>({scId1}));
+
+    ClearDatadirCache();
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(pathTemp.string(), ec);
+}
+
 /////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////// GetSidechain /////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////
@@ -1883,11 +1972,11 @@ uint256 SidechainsTestSuite::createAndStoreSidechain(CAmount ftScFee, CAmount mb
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
     initialScState.lastTopQualityCertView.forwardTransferScFee = ftScFee;
     initialScState.lastTopQualityCertView.mainchainBackwardTransferRequestScFee = mbtrScFee;
-    initialScState.fixedParams.mainchainBackwardTransferRequestDataLength = mbtrScDataLength;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().mainchainBackwardTransferRequestDataLength = mbtrScDataLength;
+    initialScState.ModifyFixedParams().version = 0;
     int heightWhereAlive = initialScState.GetScheduledCeasingHeight() - 1;
 
     storeSidechainWithCurrentHeight(scId, initialScState, heightWhereAlive);
@@ -2002,7 +2091,7 @@ TEST_F(SidechainsTestSuite, CTxScCreationOutSetsFeesAndDataLength)
     ASSERT_TRUE(sidechainsView->GetSidechain(scId, sc));
     ASSERT_EQ(sc.lastTopQualityCertView.forwardTransferScFee, forwardTransferScFee);
     ASSERT_EQ(sc.lastTopQualityCertView.mainchainBackwardTransferRequestScFee, mainchainBackwardTransferRequestScFee);
-    ASSERT_EQ(sc.fixedParams.mainchainBackwardTransferRequestDataLength, params.mainchainBackwardTransferRequestDataLength);
+    ASSERT_EQ(sc.GetFixedParams().mainchainBackwardTransferRequestDataLength, params.mainchainBackwardTransferRequestDataLength);
 }
 
 TEST_F(SidechainsTestSuite, V2CTxScCreationOutSetsFeesButNotDataLength)
@@ -2030,7 +2119,7 @@ TEST_F(SidechainsTestSuite, V2CTxScCreationOutSetsFeesButNotDataLength)
     ASSERT_TRUE(sidechainsView->GetSidechain(scId, sc));
     ASSERT_EQ(sc.lastTopQualityCertView.forwardTransferScFee, forwardTransferScFee);
     ASSERT_EQ(sc.lastTopQualityCertView.mainchainBackwardTransferRequestScFee, mainchainBackwardTransferRequestScFee);
-    ASSERT_EQ(sc.fixedParams.mainchainBackwardTransferRequestDataLength, 0);
+    ASSERT_EQ(sc.GetFixedParams().mainchainBackwardTransferRequestDataLength, 0);
 }
 
 
@@ -2064,7 +2153,7 @@ TEST_F(SidechainsTestSuite, NewCertificateUpdatesFeesAndDataLength)
     ASSERT_TRUE(sidechainsView->GetSidechain(scId, sc));
     ASSERT_EQ(sc.lastTopQualityCertView.forwardTransferScFee, 0);
     ASSERT_EQ(sc.lastTopQualityCertView.mainchainBackwardTransferRequestScFee, 0);
-    ASSERT_EQ(sc.fixedParams.mainchainBackwardTransferRequestDataLength, 0);
+    ASSERT_EQ(sc.GetFixedParams().mainchainBackwardTransferRequestDataLength, 0);
 
     //Fully mature initial Sc balance
     int coinMaturityHeight = scCreationHeight + sc.getScCoinsMaturity();
@@ -2210,3 +2299,50 @@ TEST_F(SidechainsTestSuite, CertificateViewInitialization)
     CScCertificateView certView;
     ASSERT_TRUE(certView.IsNull());
 }
+
+TEST(SidechainFixedParams, CopiesShareFixedParams)
+{
+    CSidechain sidechain;
+    EXPECT_TRUE(sidechain.GetFixedParams().IsNull());
+
+    sidechain.ModifyFixedParams().version = 0;
+    sidechain.ModifyFixedParams().withdrawalEpochLength = 10;
+    sidechain.ModifyFixedParams().customData = std::vector<unsigned char>(1024, 0xaa);
+
+    // Copies are cheap and see the same parameters
+    CSidechain copy = sidechain;
+    EXPECT_EQ(&copy.GetFixedParams(), &sidechain.GetFixedParams());
+    EXPECT_EQ(copy, sidechain);
+
+    // Modifying a copy does not affect the original
+    copy.ModifyFixedParams().withdrawalEpochLength = 20;
+    EXPECT_NE(&copy.GetFixedParams(), &sidechain.GetFixedParams());
+    EXPECT_EQ(sidechain.GetFixedParams().withdrawalEpochLength, 10);
+    EXPECT_EQ(copy.GetFixedParams().withdrawalEpochLength, 20);
+}
+
+TEST(SidechainFixedParams, DeserializedSidechainsAreInterned)
+{
+    const uint256 scId = uint256S("aaaa");
+
+    CSidechain sidechain;
+    sidechain.ModifyFixedParams().version = 0;
+    sidechain.ModifyFixedParams().withdrawalEpochLength = 10;
+    sidechain.InternFixedParams(scId);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << sidechain;
+    CSidechain readSidechain;
+    ss >> readSidechain;
+    EXPECT_NE(&readSidechain.GetFixedParams(), &sidechain.GetFixedParams());
+
+    readSidechain.InternFixedParams(scId);
+    EXPECT_EQ(&readSidechain.GetFixedParams(), &sidechain.GetFixedParams());
+
+    // Different parameters for the same scId are not shared
+    CSidechain otherSidechain = readSidechain;
+    otherSidechain.ModifyFixedParams().withdrawalEpochLength = 20;
+    otherSidechain.InternFixedParams(scId);
+    EXPECT_EQ(otherSidechain.GetFixedParams().withdrawalEpochLength, 20);
+    EXPECT_NE(&otherSidechain.GetFixedParams(), &sidechain.GetFixedParams());
+}
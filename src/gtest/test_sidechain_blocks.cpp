@@ -90,8 +90,8 @@ TEST_F(SidechainsConnectCertsBlockTestSuite, ConnectBlock_SingleCert_SameEpoch_C
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 300;
-    initialScState.fixedParams.withdrawalEpochLength = 20;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 20;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 100;
     initialScState.lastTopQualityCertReferencedEpoch = 7;
@@ -167,8 +167,8 @@ TEST_F(SidechainsConnectCertsBlockTestSuite, ConnectBlock_SingleCert_DifferentEp
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 300;
-    initialScState.fixedParams.withdrawalEpochLength = 20;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 20;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 100;
     initialScState.lastTopQualityCertReferencedEpoch = 7;
@@ -244,8 +244,8 @@ TEST_F(SidechainsConnectCertsBlockTestSuite, ConnectBlock_MultipleCerts_SameEpoc
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 300;
-    initialScState.fixedParams.withdrawalEpochLength = 20;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 20;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 100;
     initialScState.lastTopQualityCertReferencedEpoch = 7;
@@ -337,8 +337,8 @@ TEST_F(SidechainsConnectCertsBlockTestSuite, ConnectBlock_MultipleCerts_Differen
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 300;
-    initialScState.fixedParams.withdrawalEpochLength = 20;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 20;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 100;
     initialScState.lastTopQualityCertReferencedEpoch = 7;
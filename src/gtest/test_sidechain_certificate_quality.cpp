@@ -73,8 +73,8 @@ TEST_F(SidechainsMultipleCertsTestSuite, Cert_SameEpoch_HigherQuality_SidechainI
 
     // setup sidechain initial state...
     CSidechain initialScState;
-    initialScState.fixedParams.withdrawalEpochLength = 10;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 10;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.creationBlockHeight = 400;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 100;
@@ -117,8 +117,8 @@ TEST_F(SidechainsMultipleCertsTestSuite, Cert_SameEpoch_LowerQuality_SidechainIs
 
     // setup sidechain initial state...
     CSidechain initialScState;
-    initialScState.fixedParams.withdrawalEpochLength = 10;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 10;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.creationBlockHeight = 400;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 100;
@@ -160,8 +160,8 @@ TEST_F(SidechainsMultipleCertsTestSuite, Cert_DifferentEpoch_LowerQuality_Sidech
 
     // setup sidechain initial state...
     CSidechain initialScState;
-    initialScState.fixedParams.withdrawalEpochLength = 10;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 10;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.creationBlockHeight = 400;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 100;
@@ -204,8 +204,8 @@ TEST_F(SidechainsMultipleCertsTestSuite, Cert_SameEpoch_HigherQuality_UndoDataCh
 
     // setup sidechain initial state...
     CSidechain initialScState;
-    initialScState.fixedParams.withdrawalEpochLength = 10;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 10;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.creationBlockHeight = 400;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 100;
@@ -248,8 +248,8 @@ TEST_F(SidechainsMultipleCertsTestSuite, Cert_DifferentEpoch_LowerQuality_UndoDa
 
     // setup sidechain initial state...
     CSidechain initialScState;
-    initialScState.fixedParams.withdrawalEpochLength = 10;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 10;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.creationBlockHeight = 400;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 100;
@@ -291,8 +291,8 @@ TEST_F(SidechainsMultipleCertsTestSuite, V2Cert_SameEpoch_SameQuality_SidechainI
 
     // setup sidechain initial state...
     CSidechain initialScState;
-    initialScState.fixedParams.withdrawalEpochLength = 0;
-    initialScState.fixedParams.version = 2;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 0;
+    initialScState.ModifyFixedParams().version = 2;
     initialScState.creationBlockHeight = 400;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 0;
@@ -327,8 +327,8 @@ TEST_F(SidechainsMultipleCertsTestSuite, V2Cert_SameEpoch_LowerQuality_Sidechain
 
     // setup sidechain initial state...
     CSidechain initialScState;
-    initialScState.fixedParams.withdrawalEpochLength = 0;
-    initialScState.fixedParams.version = 2;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 0;
+    initialScState.ModifyFixedParams().version = 2;
     initialScState.creationBlockHeight = 400;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 1;
@@ -363,8 +363,8 @@ TEST_F(SidechainsMultipleCertsTestSuite, V2Cert_SameEpoch_HigherQuality_Sidechai
 
     // setup sidechain initial state...
     CSidechain initialScState;
-    initialScState.fixedParams.withdrawalEpochLength = 0;
-    initialScState.fixedParams.version = 2;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 0;
+    initialScState.ModifyFixedParams().version = 2;
     initialScState.creationBlockHeight = 400;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 0;
@@ -399,8 +399,8 @@ TEST_F(SidechainsMultipleCertsTestSuite, V2Cert_DifferentEpoch_ZeroQuality_Sidec
 
     // setup sidechain initial state...
     CSidechain initialScState;
-    initialScState.fixedParams.withdrawalEpochLength = 0;
-    initialScState.fixedParams.version = 2;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 0;
+    initialScState.ModifyFixedParams().version = 2;
     initialScState.creationBlockHeight = 400;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 0;
@@ -435,8 +435,8 @@ TEST_F(SidechainsMultipleCertsTestSuite, V2Cert_LowerQuality_DifferentEpoch_Undo
 
     // setup sidechain initial state...
     CSidechain initialScState;
-    initialScState.fixedParams.withdrawalEpochLength = 0;
-    initialScState.fixedParams.version = 2;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 0;
+    initialScState.ModifyFixedParams().version = 2;
     initialScState.creationBlockHeight = 400;
     initialScState.lastTopQualityCertHash = uint256S("cccc");
     initialScState.lastTopQualityCertQuality = 0;
@@ -476,7 +476,7 @@ TEST_F(SidechainsMultipleCertsTestSuite, CheckQualityRejectsLowerQualityCertsInS
     initialScState.lastTopQualityCertHash = uint256S("ddd");
     initialScState.lastTopQualityCertQuality = 100;
     initialScState.lastTopQualityCertReferencedEpoch = 12;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().version = 0;
     uint256 scId = uint256S("aaa");
     storeSidechainWithCurrentHeight(*sidechainsView, scId, initialScState, initialScState.creationBlockHeight);
 
@@ -495,7 +495,7 @@ TEST_F(SidechainsMultipleCertsTestSuite, CheckQualityRejectsEqualQualityCertsInS
     initialScState.lastTopQualityCertHash = uint256S("ddd");
     initialScState.lastTopQualityCertQuality = 100;
     initialScState.lastTopQualityCertReferencedEpoch = 12;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().version = 0;
     uint256 scId = uint256S("aaa");
     storeSidechainWithCurrentHeight(*sidechainsView, scId, initialScState, initialScState.creationBlockHeight);
 
@@ -514,7 +514,7 @@ TEST_F(SidechainsMultipleCertsTestSuite, CheckQualityAcceptsHigherQualityCertsIn
     initialScState.lastTopQualityCertHash = uint256S("ddd");
     initialScState.lastTopQualityCertQuality = 100;
     initialScState.lastTopQualityCertReferencedEpoch = 12;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().version = 0;
     uint256 scId = uint256S("aaa");
     storeSidechainWithCurrentHeight(*sidechainsView, scId, initialScState, initialScState.creationBlockHeight);
 
@@ -533,7 +533,7 @@ TEST_F(SidechainsMultipleCertsTestSuite, CheckAcceptsLowerQualityCertsInDifferen
     initialScState.lastTopQualityCertHash = uint256S("ddd");
     initialScState.lastTopQualityCertQuality = 100;
     initialScState.lastTopQualityCertReferencedEpoch = 12;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().version = 0;
     uint256 scId = uint256S("aaa");
     storeSidechainWithCurrentHeight(*sidechainsView, scId, initialScState, initialScState.creationBlockHeight);
 
@@ -555,7 +555,7 @@ TEST_F(SidechainsMultipleCertsTestSuite, CheckInMempoolDelegateToBackingView) {
     initialScState.lastTopQualityCertHash = uint256S("ddd");
     initialScState.lastTopQualityCertQuality = 100;
     initialScState.lastTopQualityCertReferencedEpoch = 12;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().version = 0;
     uint256 scId = uint256S("aaa");
     storeSidechainWithCurrentHeight(*sidechainsView, scId, initialScState, initialScState.creationBlockHeight);
 
@@ -593,7 +593,7 @@ TEST_F(SidechainsMultipleCertsTestSuite, CertsInMempoolDoNotAffectCheckQuality)
     initialScState.lastTopQualityCertHash = uint256S("ddd");
     initialScState.lastTopQualityCertQuality = 100;
     initialScState.lastTopQualityCertReferencedEpoch = 12;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().version = 0;
     uint256 scId = uint256S("aaa");
     storeSidechainWithCurrentHeight(*sidechainsView, scId, initialScState, initialScState.creationBlockHeight);
 
@@ -827,7 +827,7 @@ TEST_F(SidechainsMultipleCertsTestSuite, HighQualityCertData_EmptyBlock)
     sidechain.lastTopQualityCertQuality = 100;
     sidechain.lastTopQualityCertHash = uint256S("999");
     sidechain.lastTopQualityCertReferencedEpoch = 15;
-    sidechain.fixedParams.version = 0;
+    sidechain.ModifyFixedParams().version = 0;
     uint256 scId = uint256S("aaa");
     storeSidechainWithCurrentHeight(*sidechainsView, scId, sidechain, sidechain.creationBlockHeight);
 
@@ -842,7 +842,7 @@ TEST_F(SidechainsMultipleCertsTestSuite, HighQualityCertData_FirstCert)
     sidechain.lastTopQualityCertQuality = 100;
     sidechain.lastTopQualityCertHash = uint256S("aaa");
     sidechain.lastTopQualityCertReferencedEpoch = -1;
-    sidechain.fixedParams.version = 0;
+    sidechain.ModifyFixedParams().version = 0;
     uint256 scId = uint256S("aaa");
     storeSidechainWithCurrentHeight(*sidechainsView, scId, sidechain, sidechain.creationBlockHeight);
 
@@ -864,7 +864,7 @@ TEST_F(SidechainsMultipleCertsTestSuite, LowQualityCerts_SameScId_DifferentEpoch
     sidechain.lastTopQualityCertQuality = 100;
     sidechain.lastTopQualityCertHash = uint256S("aaa");
     sidechain.lastTopQualityCertReferencedEpoch = 15;
-    sidechain.fixedParams.version = 0;
+    sidechain.ModifyFixedParams().version = 0;
     uint256 scId = uint256S("aaa");
     storeSidechainWithCurrentHeight(*sidechainsView, scId, sidechain, sidechain.creationBlockHeight);
 
@@ -893,7 +893,7 @@ TEST_F(SidechainsMultipleCertsTestSuite, LowQualityCerts_SameScId_SameEpoch)
     sidechain.lastTopQualityCertQuality = 10;
     sidechain.lastTopQualityCertHash = uint256S("aaa");
     sidechain.lastTopQualityCertReferencedEpoch = 15;
-    sidechain.fixedParams.version = 0;
+    sidechain.ModifyFixedParams().version = 0;
     uint256 scId = uint256S("aaa");
     storeSidechainWithCurrentHeight(*sidechainsView, scId, sidechain, sidechain.creationBlockHeight);
 
@@ -924,7 +924,7 @@ TEST_F(SidechainsMultipleCertsTestSuite, LowQualityCerts_MultipleScIds)
     sidechain_A.lastTopQualityCertHash = uint256S("aaa");
     sidechain_A.lastTopQualityCertQuality = 10;
     sidechain_A.lastTopQualityCertReferencedEpoch = 15;
-    sidechain_A.fixedParams.version = 0;
+    sidechain_A.ModifyFixedParams().version = 0;
     uint256 scId_A = uint256S("aaa");
     storeSidechainWithCurrentHeight(*sidechainsView, scId_A, sidechain_A, allScsCreationBlockHeight);
 
@@ -933,7 +933,7 @@ TEST_F(SidechainsMultipleCertsTestSuite, LowQualityCerts_MultipleScIds)
     sidechain_B.lastTopQualityCertHash = uint256S("bbb");
     sidechain_B.lastTopQualityCertQuality = 2;
     sidechain_B.lastTopQualityCertReferencedEpoch = 200;
-    sidechain_B.fixedParams.version = 0;
+    sidechain_B.ModifyFixedParams().version = 0;
     uint256 scId_B = uint256S("bbb");
     storeSidechainWithCurrentHeight(*sidechainsView, scId_B, sidechain_B, allScsCreationBlockHeight);
 
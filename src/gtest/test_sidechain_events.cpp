@@ -53,8 +53,8 @@ TEST_F(SidechainsEventsTestSuite, CertDataHash_EndWindowToEndWindows_WithoutCert
     int initialEpochReferencedByCert = 0;
 
     initialScState.creationBlockHeight = 1;
-    initialScState.fixedParams.withdrawalEpochLength = 5;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 5;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = initialEpochReferencedByCert;
 
     initialScState.pastEpochTopQualityCertView.certDataHash = CFieldElement{std::vector<unsigned char>(CFieldElement::ByteSize(), 'a')};
@@ -89,8 +89,8 @@ TEST_F(SidechainsEventsTestSuite, CertDataHash_EndWindowToEndWindows_WithCert) {
     int initialEpochReferencedByCert = 0;
 
     sidechain.creationBlockHeight = 1;
-    sidechain.fixedParams.withdrawalEpochLength = 100;
-    sidechain.fixedParams.version = 0;
+    sidechain.ModifyFixedParams().withdrawalEpochLength = 100;
+    sidechain.ModifyFixedParams().version = 0;
     sidechain.lastTopQualityCertReferencedEpoch = initialEpochReferencedByCert;
     sidechain.InitScFees();
 
@@ -168,8 +168,8 @@ TEST_F(SidechainsEventsTestSuite, SidechainInItsFirstEpochIsNotCeased) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1912;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = CScCertificate::EPOCH_NULL;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -195,8 +195,8 @@ TEST_F(SidechainsEventsTestSuite, SidechainIsNotCeasedBeforeNextEpochSafeguard)
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1912;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -222,8 +222,8 @@ TEST_F(SidechainsEventsTestSuite, SidechainIsCeasedAtNextEpochSafeguard) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1912;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -250,8 +250,8 @@ TEST_F(SidechainsEventsTestSuite, FullCertMovesSidechainTerminationToNextEpochSa
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1912;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -292,8 +292,8 @@ TEST_F(SidechainsEventsTestSuite, PureBwtCertificateMovesSidechainTerminationToN
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1912;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.balance = CAmount{100};
     initialScState.InitScFees();
@@ -335,8 +335,8 @@ TEST_F(SidechainsEventsTestSuite, NoBwtCertificateMovesSidechainTerminationToNex
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1912;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -377,8 +377,8 @@ TEST_F(SidechainsEventsTestSuite, EmptyCertificateMovesSidechainTerminationToNex
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1912;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -440,8 +440,8 @@ TEST_F(SidechainsEventsTestSuite, CeasingHeightUpdateForFullCert) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1912;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -476,8 +476,8 @@ TEST_F(SidechainsEventsTestSuite, CeasingHeightUpdateForPureBwtCert) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1912;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.balance = CAmount(19);
     initialScState.InitScFees();
@@ -513,8 +513,8 @@ TEST_F(SidechainsEventsTestSuite, CeasingHeightUpdateForNoBwtCert) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1912;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -549,8 +549,8 @@ TEST_F(SidechainsEventsTestSuite, CeasingHeightUpdateForEmptyCertificate) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1912;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -587,8 +587,8 @@ TEST_F(SidechainsEventsTestSuite, FullCertCoinsHaveBwtStrippedOutWhenSidechainCe
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1987;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.balance = CAmount{20};
     initialScState.InitScFees();
@@ -645,8 +645,8 @@ TEST_F(SidechainsEventsTestSuite, PureBwtCoinsAreRemovedWhenSidechainCeases) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 201;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.balance = CAmount{20};
     initialScState.InitScFees();
@@ -713,8 +713,8 @@ TEST_F(SidechainsEventsTestSuite, NoBwtCertificatesCoinsAreNotAffectedByCeasedSi
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 201;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -770,8 +770,8 @@ TEST_F(SidechainsEventsTestSuite, EmptyCertificatesCoinsAreNotAffectedByCeasedSi
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 201;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -826,8 +826,8 @@ TEST_F(SidechainsEventsTestSuite, RestoreFullCertCeasedCoins) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1987;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.balance = CAmount{20};
     initialScState.InitScFees();
@@ -890,8 +890,8 @@ TEST_F(SidechainsEventsTestSuite, RestorePureBwtCeasedCoins) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1987;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.balance = CAmount{20};
     initialScState.InitScFees();
@@ -954,8 +954,8 @@ TEST_F(SidechainsEventsTestSuite, RestoreNoBwtCeasedCoins) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1987;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -1017,8 +1017,8 @@ TEST_F(SidechainsEventsTestSuite, RestoreEmptyCertCeasedCoins) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1987;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -1095,8 +1095,8 @@ TEST_F(SidechainsEventsTestSuite, UndoFullCertUpdatesToCeasingScs) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1987;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.balance = CAmount{20};
     initialScState.InitScFees();
@@ -1147,8 +1147,8 @@ TEST_F(SidechainsEventsTestSuite, UndoPureBwtCertUpdatesToCeasingScs) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1987;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.balance = CAmount{5};
     initialScState.InitScFees();
@@ -1199,8 +1199,8 @@ TEST_F(SidechainsEventsTestSuite, UndoNoBwtCertUpdatesToCeasingScs) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1987;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -1250,8 +1250,8 @@ TEST_F(SidechainsEventsTestSuite, UndoEmptyCertUpdatesToCeasingScs) {
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1987;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
-    initialScState.fixedParams.version = 0;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().version = 0;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     storeSidechainWithCurrentHeight(*view, scId, initialScState, initialScState.creationBlockHeight);
@@ -493,6 +493,51 @@ TEST_F(SidechainsInMempoolTestSuite, SimpleCertRemovalFromMempool) {
     EXPECT_FALSE(mempool.existsCert(cert.GetHash()));
 }
 
+TEST_F(SidechainsInMempoolTestSuite, TopQualityCertFollowsTheCertsInMempool) {
+    //Create and persist sidechain
+    CTransaction scTx = GenerateScTx(CAmount(10));
+    const uint256& scId = scTx.GetScIdFromScCcOut(0);
+    CBlock aBlock;
+    CCoinsViewCache sidechainsView(pcoinsTip);
+    sidechainsView.UpdateSidechain(scTx, aBlock, /*height*/int(1789));
+    sidechainsView.Flush();
+    EXPECT_TRUE(mempool.getTopQualityCert(scId) == nullptr);
+
+    //load two certificates of growing quality in mempool
+    CScCertificate cert1 = txCreationUtils::createCertificate(scId, /*epochNum*/0,
+        CFieldElement{SAMPLE_FIELD}, /*changeTotalAmount*/CAmount(4),/*numChangeOut*/2, /*bwtAmount*/CAmount(6), /*numBwt*/2,
+        /*ftScFee*/0, /*mbtrScFee*/0, /*quality*/3);
+    CCertificateMemPoolEntry certEntry1(cert1, /*fee*/CAmount(5), /*time*/ 1000, /*priority*/1.0, /*height*/1987);
+    mempool.addUnchecked(cert1.GetHash(), certEntry1);
+
+    std::shared_ptr<const CMempoolTopQualityCert> topQualityCert = mempool.getTopQualityCert(scId);
+    ASSERT_TRUE(topQualityCert != nullptr);
+    EXPECT_EQ(cert1.GetHash(), topQualityCert->hash);
+    EXPECT_EQ(3, topQualityCert->quality);
+    EXPECT_EQ(CAmount(5), topQualityCert->fee);
+    EXPECT_EQ(CAmount(6), topQualityCert->bwtAmount);
+
+    CScCertificate cert2 = txCreationUtils::createCertificate(scId, /*epochNum*/0,
+        CFieldElement{SAMPLE_FIELD}, /*changeTotalAmount*/CAmount(3),/*numChangeOut*/2, /*bwtAmount*/CAmount(4), /*numBwt*/2,
+        /*ftScFee*/0, /*mbtrScFee*/0, /*quality*/7);
+    CCertificateMemPoolEntry certEntry2(cert2, /*fee*/CAmount(8), /*time*/ 1001, /*priority*/1.0, /*height*/1987);
+    mempool.addUnchecked(cert2.GetHash(), certEntry2);
+
+    EXPECT_EQ(cert2.GetHash(), mempool.getTopQualityCert(scId)->hash);
+    // the summary taken before is left as it was
+    EXPECT_EQ(cert1.GetHash(), topQualityCert->hash);
+
+    //Remove the top quality certificate, the other one takes its place
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    mempool.remove(cert2, removedTxs, removedCerts, /*fRecursive*/false);
+    ASSERT_TRUE(mempool.getTopQualityCert(scId) != nullptr);
+    EXPECT_EQ(cert1.GetHash(), mempool.getTopQualityCert(scId)->hash);
+
+    mempool.remove(cert1, removedTxs, removedCerts, /*fRecursive*/false);
+    EXPECT_TRUE(mempool.getTopQualityCert(scId) == nullptr);
+}
+
 TEST_F(SidechainsInMempoolTestSuite, ConflictingCertRemovalFromMempool) {
     //Create and persist sidechain
     CTransaction scTx = GenerateScTx(CAmount(10));
@@ -592,6 +637,34 @@ TEST_F(SidechainsInMempoolTestSuite, FwdsAndCertInMempool_FwtRemovalDoesNotAffec
     EXPECT_TRUE(mempool.mapSidechains.at(scId).HasCert(cert.GetHash()));
 }
 
+TEST_F(SidechainsInMempoolTestSuite, SidechainEntryIndexesCertsByQualityAndHash)
+{
+    CSidechainMemPoolEntry scEntry;
+    const uint256 lowHash = uint256S("aa");
+    const uint256 midHash = uint256S("bb");
+    const uint256 topHash = uint256S("cc");
+    scEntry.AddCert(/*quality*/20, midHash);
+    scEntry.AddCert(/*quality*/30, topHash);
+    scEntry.AddCert(/*quality*/10, lowHash);
+
+    EXPECT_TRUE(scEntry.GetTopQualityCert()->second == topHash);
+    ASSERT_TRUE(scEntry.HasCert(midHash));
+    EXPECT_TRUE(scEntry.GetCert(midHash)->first == 20);
+    EXPECT_FALSE(scEntry.HasCert(uint256S("dd")));
+
+    scEntry.EraseCert(topHash);
+    EXPECT_FALSE(scEntry.HasCert(topHash));
+    EXPECT_TRUE(scEntry.GetTopQualityCert()->second == midHash);
+    EXPECT_EQ(scEntry.mBackwardCertificates.size(), scEntry.mCertQualities.size());
+
+    // erasing a cert no longer there does nothing
+    scEntry.EraseCert(topHash);
+    scEntry.EraseCert(lowHash);
+    scEntry.EraseCert(midHash);
+    EXPECT_TRUE(scEntry.mBackwardCertificates.empty());
+    EXPECT_TRUE(scEntry.mCertQualities.empty());
+}
+
 TEST_F(SidechainsInMempoolTestSuite, CertCannotSpendSameQualityCertOutput)
 {
     CNakedCCoinsViewCache sidechainsView(pcoinsTip);
@@ -771,7 +844,7 @@ TEST_F(SidechainsInMempoolTestSuite, UnconfirmedFwtTxToCeasedSidechainsAreRemove
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
     initialScState.balance = CAmount{1000};
     initialScState.InitScFees();
     int heightWhereAlive = initialScState.GetScheduledCeasingHeight() -1;
@@ -816,7 +889,7 @@ TEST_F(SidechainsInMempoolTestSuite, UnconfirmedCsw_LargerThanSidechainBalanceAr
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
     initialScState.balance = CAmount{1000};
     initialScState.InitScFees();
     int heightWhereCeased = initialScState.GetScheduledCeasingHeight();
@@ -866,7 +939,7 @@ TEST_F(SidechainsInMempoolTestSuite, UnconfirmedCswForAliveSidechainsAreRemovedF
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
     initialScState.balance = CAmount{1000};
     initialScState.InitScFees();
     int heightWhereCeased = initialScState.GetScheduledCeasingHeight();
@@ -1138,7 +1211,7 @@ TEST_F(SidechainsInMempoolTestSuite,UnconfirmedFwdsTowardAliveSidechainsAreNotDr
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
     initialScState.InitScFees();
     int heightWhereAlive = initialScState.GetScheduledCeasingHeight() -1;
 
@@ -1176,7 +1249,7 @@ TEST_F(SidechainsInMempoolTestSuite,UnconfirmedFwdsTowardCeasedSidechainsAreDrop
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
     initialScState.InitScFees();
     int heightWhereCeased = initialScState.GetScheduledCeasingHeight();
 
@@ -1214,7 +1287,7 @@ TEST_F(SidechainsInMempoolTestSuite,UnconfirmedMbtrTowardCeasedSidechainIsDroppe
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
     initialScState.InitScFees();
     int heightWhereCeased = initialScState.GetScheduledCeasingHeight();
 
@@ -1256,7 +1329,7 @@ TEST_F(SidechainsInMempoolTestSuite,UnconfirmedCertTowardAliveSidechainIsNotDrop
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 201;
-    initialScState.fixedParams.withdrawalEpochLength = 9;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 9;
     initialScState.lastTopQualityCertReferencedEpoch = 19;
     initialScState.InitScFees();
     int heightWhereAlive = initialScState.GetScheduledCeasingHeight()-1;
@@ -1299,7 +1372,7 @@ TEST_F(SidechainsInMempoolTestSuite,UnconfirmedCertTowardCeasedSidechainIsDroppe
     CSidechain initialScState;
     uint256 scId = uint256S("aaaa");
     initialScState.creationBlockHeight = 1492;
-    initialScState.fixedParams.withdrawalEpochLength = 14;
+    initialScState.ModifyFixedParams().withdrawalEpochLength = 14;
     initialScState.InitScFees();
     int heightWhereCeased = initialScState.GetScheduledCeasingHeight();
 
@@ -2148,7 +2221,7 @@ void SidechainsInMempoolTestSuite::moveSidechainToNextEpoch(uint256 scId, CCoins
     sidechainView.GetSidechain(scId, sidechain);
 
     int32_t currentEpoch = sidechain.lastTopQualityCertReferencedEpoch;
-    int nextEpochHeight = sidechain.GetEndHeightForEpoch(currentEpoch) + sidechain.fixedParams.withdrawalEpochLength;
+    int nextEpochHeight = sidechain.GetEndHeightForEpoch(currentEpoch) + sidechain.GetFixedParams().withdrawalEpochLength;
 
     // Move sidechain
     chainSettingUtils::ExtendChainActiveToHeight(nextEpochHeight);
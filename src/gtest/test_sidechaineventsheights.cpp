@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <txdb.h>
+#include <util.h>
+#include <boost/filesystem.hpp>
+
+class SidechainEventsHeightsTestSuite: public ::testing::Test {
+public:
+    SidechainEventsHeightsTestSuite():
+        dataDirLocation(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()),
+        chainStateDbSize(2 * 1024 * 1024) {}
+
+    void SetUp() override {
+        boost::filesystem::create_directories(dataDirLocation);
+        mapArgs["-datadir"] = dataDirLocation.string();
+        pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/true));
+    }
+
+    void TearDown() override {
+        pChainStateDb.reset();
+        ClearDatadirCache();
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(dataDirLocation.string(), ec);
+    }
+
+protected:
+    boost::filesystem::path dataDirLocation;
+    const unsigned int chainStateDbSize;
+    std::unique_ptr<CCoinsViewDB> pChainStateDb;
+
+    void WriteSidechainEvents(int height, const uint256& ceasingScId, CSidechainEventsCacheEntry::Flags flag) {
+        CCoinsMap dummyCoins;
+        CAnchorsMap dummyAnchors;
+        CNullifiersMap dummyNullifiers;
+        CSidechainsMap dummySidechains;
+        CSidechainEventsMap sidechainEvents;
+        CCswNullifiersMap dummyCswNullifiers;
+        CSidechainEvents scEvents;
+        scEvents.ceasingScs.insert(ceasingScId);
+        sidechainEvents[height] = CSidechainEventsCacheEntry(scEvents, flag);
+        ASSERT_TRUE(pChainStateDb->BatchWrite(dummyCoins, uint256(), uint256(), dummyAnchors, dummyNullifiers,
+                                              dummySidechains, sidechainEvents, dummyCswNullifiers));
+    }
+};
+
+TEST_F(SidechainEventsHeightsTestSuite, HeightsAreLoadedAndMaintained) {
+    const uint256 scId = uint256S("aaa");
+
+    WriteSidechainEvents(10, scId, CSidechainEventsCacheEntry::Flags::FRESH);
+
+    // Heights already in the database are loaded into the bitmap
+    ASSERT_TRUE(pChainStateDb->LoadSidechainEventsHeights());
+    EXPECT_TRUE(pChainStateDb->HaveSidechainEvents(10));
+    EXPECT_FALSE(pChainStateDb->HaveSidechainEvents(9));
+    EXPECT_FALSE(pChainStateDb->HaveSidechainEvents(1000));
+
+    // Heights written afterwards are set, also beyond the loaded ones
+    WriteSidechainEvents(2000, scId, CSidechainEventsCacheEntry::Flags::FRESH);
+    EXPECT_TRUE(pChainStateDb->HaveSidechainEvents(2000));
+    CSidechainEvents scEvents;
+    ASSERT_TRUE(pChainStateDb->GetSidechainEvents(2000, scEvents));
+    EXPECT_TRUE(scEvents.ceasingScs.count(scId));
+
+    // Erased heights are cleared
+    WriteSidechainEvents(10, scId, CSidechainEventsCacheEntry::Flags::ERASED);
+    EXPECT_FALSE(pChainStateDb->HaveSidechainEvents(10));
+    EXPECT_FALSE(pChainStateDb->GetSidechainEvents(10, scEvents));
+
+    // The bitmap reloaded matches the database
+    ASSERT_TRUE(pChainStateDb->LoadSidechainEventsHeights());
+    EXPECT_FALSE(pChainStateDb->HaveSidechainEvents(10));
+    EXPECT_TRUE(pChainStateDb->HaveSidechainEvents(2000));
+}
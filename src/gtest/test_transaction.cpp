@@ -118,3 +118,39 @@ TEST(Transaction, JSDescriptionRandomizedGroth) {
     do_test(true);
 }
 
+
+// The proof computed later from the witness of a joinsplit created without it is the one of the joinsplit
+TEST(Transaction, JSDescriptionDeferredProof) {
+    ZCIncrementalMerkleTree merkleTree;
+
+    libzcash::SpendingKey k = libzcash::SpendingKey::random();
+    libzcash::PaymentAddress addr = k.address();
+
+    libzcash::Note note(addr.a_pk, 100, uint256(), uint256());
+    merkleTree.append(note.cm());
+    uint256 rt = merkleTree.root();
+
+    uint256 joinSplitPubKey;
+    std::array<libzcash::JSInput, ZC_NUM_JS_INPUTS> inputs = {
+        libzcash::JSInput(merkleTree.witness(), note, k),
+        libzcash::JSInput()
+    };
+    std::array<libzcash::JSOutput, ZC_NUM_JS_OUTPUTS> outputs = {
+        libzcash::JSOutput(addr, 60),
+        libzcash::JSOutput(addr, 40)
+    };
+
+    ZCJSProofWitness witness;
+    JSDescription jsdesc(true, *params, joinSplitPubKey, rt, inputs, outputs, 0, 0, false, nullptr, &witness);
+
+    auto verifier = libzcash::ProofVerifier::Strict();
+    EXPECT_FALSE(jsdesc.Verify(*params, verifier, joinSplitPubKey));
+
+    EXPECT_TRUE(witness.makeGrothProof);
+    EXPECT_EQ(rt, witness.rt);
+    for (size_t i = 0; i < ZC_NUM_JS_OUTPUTS; i++)
+        EXPECT_EQ(jsdesc.commitments[i], witness.notes[i].cm());
+
+    jsdesc.proof = params->prove(witness);
+    EXPECT_TRUE(jsdesc.Verify(*params, verifier, joinSplitPubKey));
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+
+#include <clientversion.h>
+#include <streams.h>
+#include <txdb.h>
+#include <util.h>
+#include <random.h>
+#include <script/script.h>
+#include <boost/filesystem.hpp>
+
+class TxOutSetSnapshotTestSuite: public ::testing::Test {
+public:
+    TxOutSetSnapshotTestSuite():
+        dataDirLocation(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()),
+        chainStateDbSize(2 * 1024 * 1024) {}
+
+    void SetUp() override {
+        boost::filesystem::create_directories(dataDirLocation);
+        mapArgs["-datadir"] = dataDirLocation.string();
+        snapshotPath = dataDirLocation / "utxo.dat";
+        pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/true));
+        ASSERT_TRUE(pChainStateDb->LoadCoinsCommitment());
+    }
+
+    void TearDown() override {
+        pChainStateDb.reset();
+        ClearDatadirCache();
+        boost::system::error_code ec;
+        boost::filesystem::remove_all(dataDirLocation.string(), ec);
+    }
+
+protected:
+    boost::filesystem::path dataDirLocation;
+    boost::filesystem::path snapshotPath;
+    const unsigned int chainStateDbSize;
+    std::unique_ptr<CCoinsViewDB> pChainStateDb;
+
+    void WriteCoins(unsigned int nTxs, const uint256& hashBlock) {
+        CCoinsMap mapCoins;
+        for (unsigned int i = 0; i < nTxs; i++) {
+            CCoinsCacheEntry& entry = mapCoins[GetRandHash()];
+            entry.coins.nVersion = 1;
+            entry.coins.nHeight = 10;
+            for (unsigned int j = 0; j <= i % 3; j++)
+                entry.coins.vout.push_back(CTxOut(j + 1, CScript() << OP_TRUE));
+            entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+        }
+        CAnchorsMap dummyAnchors;
+        CNullifiersMap dummyNullifiers;
+        CSidechainsMap dummySidechains;
+        CSidechainEventsMap dummySidechainEvents;
+        CCswNullifiersMap dummyCswNullifiers;
+        ASSERT_TRUE(pChainStateDb->BatchWrite(mapCoins, hashBlock, uint256(), dummyAnchors, dummyNullifiers,
+                                              dummySidechains, dummySidechainEvents, dummyCswNullifiers));
+    }
+
+    void Dump(CTxOutSetSnapshotHeader& header) {
+        CAutoFile fileout(fopen(snapshotPath.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+        ASSERT_FALSE(fileout.IsNull());
+        header.hashBlock = pChainStateDb->GetBestBlock();
+        uint64_t nRecords = 0;
+        ASSERT_TRUE(pChainStateDb->DumpSnapshot(fileout, header, nRecords));
+        EXPECT_GT(nRecords, 0);
+    }
+
+    bool Load(CTxOutSetSnapshotHeader& header, std::string& strError) {
+        CAutoFile filein(fopen(snapshotPath.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+        CTxOutSetSnapshotHeader fileHeader;
+        filein >> fileHeader;
+        EXPECT_EQ(fileHeader.hashSerialized, header.hashSerialized);
+        return pChainStateDb->LoadSnapshot(filein, header, strError);
+    }
+};
+
+TEST_F(TxOutSetSnapshotTestSuite, SnapshotRoundTrip) {
+    // More than one chunk of records
+    WriteCoins(15000, uint256S("aaa"));
+
+    CCoinsStats statsBefore;
+    ASSERT_TRUE(pChainStateDb->GetStats(statsBefore));
+
+    CTxOutSetSnapshotHeader header;
+    Dump(header);
+    EXPECT_EQ(header.hashSerialized, statsBefore.hashSerialized);
+
+    // Loading replaces whatever the database holds
+    pChainStateDb.reset(new CCoinsViewDB(chainStateDbSize, DEFAULT_DB_MAX_OPEN_FILES, false, /*fWipe*/true));
+    ASSERT_TRUE(pChainStateDb->LoadCoinsCommitment());
+    WriteCoins(10, uint256S("bbb"));
+
+    std::string strError;
+    ASSERT_TRUE(Load(header, strError)) << strError;
+    EXPECT_EQ(pChainStateDb->GetBestBlock(), uint256S("aaa"));
+
+    CCoinsStats statsAfter;
+    ASSERT_TRUE(pChainStateDb->GetStats(statsAfter));
+    EXPECT_EQ(statsAfter.hashSerialized, statsBefore.hashSerialized);
+    EXPECT_EQ(statsAfter.nTransactions, statsBefore.nTransactions);
+    EXPECT_EQ(statsAfter.nTransactionOutputs, statsBefore.nTransactionOutputs);
+    EXPECT_EQ(statsAfter.nTotalAmount, statsBefore.nTotalAmount);
+}
+
+TEST_F(TxOutSetSnapshotTestSuite, CorruptedSnapshotIsRejected) {
+    WriteCoins(100, uint256S("aaa"));
+    CTxOutSetSnapshotHeader header;
+    Dump(header);
+
+    // Flip a byte in the middle of the first chunk
+    {
+        FILE* file = fopen(snapshotPath.string().c_str(), "r+b");
+        ASSERT_TRUE(file != NULL);
+        fseek(file, boost::filesystem::file_size(snapshotPath) / 2, SEEK_SET);
+        int byte = fgetc(file);
+        fseek(file, -1, SEEK_CUR);
+        fputc(byte ^ 0xff, file);
+        fclose(file);
+    }
+
+    std::string strError;
+    EXPECT_FALSE(Load(header, strError));
+    EXPECT_NE(strError.find("checksum"), std::string::npos);
+
+    // An aborted load leaves an empty chainstate behind
+    EXPECT_TRUE(pChainStateDb->GetBestBlock().IsNull());
+}
+
+TEST_F(TxOutSetSnapshotTestSuite, CommitmentMismatchIsRejected) {
+    WriteCoins(100, uint256S("aaa"));
+    CTxOutSetSnapshotHeader header;
+    Dump(header);
+
+    std::string strError;
+    CTxOutSetSnapshotHeader forgedHeader = header;
+    forgedHeader.hashSerialized = GetRandHash();
+    {
+        CAutoFile filein(fopen(snapshotPath.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+        CTxOutSetSnapshotHeader fileHeader;
+        filein >> fileHeader;
+        EXPECT_FALSE(pChainStateDb->LoadSnapshot(filein, forgedHeader, strError));
+    }
+    EXPECT_NE(strError.find("commitment"), std::string::npos);
+    EXPECT_TRUE(pChainStateDb->GetBestBlock().IsNull());
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include "txreconciliation.h"
+#include "random.h"
+
+#include <algorithm>
+
+static void EnablePair(CTxReconciliationState& initiator, CTxReconciliationState& responder)
+{
+    initiator.nLocalSalt = 1234;
+    responder.nLocalSalt = 5678;
+    initiator.Enable(responder.nLocalSalt);
+    responder.Enable(initiator.nLocalSalt);
+}
+
+static bool Contains(const std::vector<uint256>& v, const uint256& hash)
+{
+    return std::find(v.begin(), v.end(), hash) != v.end();
+}
+
+TEST(TxReconciliation, SameShortIDsOnBothSides) {
+    CTxReconciliationState initiator, responder;
+    EnablePair(initiator, responder);
+    ASSERT_TRUE(initiator.fEnabled);
+    ASSERT_TRUE(responder.fEnabled);
+
+    uint256 hash = GetRandHash();
+    EXPECT_EQ(initiator.GetShortID(hash), responder.GetShortID(hash));
+
+    // other salts, other short ids
+    CTxReconciliationState other;
+    other.nLocalSalt = 1;
+    other.Enable(2);
+    EXPECT_NE(initiator.GetShortID(hash), other.GetShortID(hash));
+}
+
+TEST(TxReconciliation, Round) {
+    CTxReconciliationState initiator, responder;
+    EnablePair(initiator, responder);
+
+    const uint256 shared = GetRandHash();
+    const uint256 onlyInitiator = GetRandHash();
+    const uint256 onlyResponder = GetRandHash();
+    ASSERT_TRUE(initiator.Add(shared));
+    ASSERT_TRUE(initiator.Add(onlyInitiator));
+    ASSERT_TRUE(responder.Add(shared));
+    ASSERT_TRUE(responder.Add(onlyResponder));
+
+    std::vector<uint256> vAnnounce;
+    std::vector<uint32_t> vRequest = initiator.StartRequest(1, vAnnounce);
+    ASSERT_EQ(vRequest.size(), 2);
+    ASSERT_TRUE(vAnnounce.empty());
+    ASSERT_TRUE(initiator.setPending.empty());
+
+    std::vector<uint32_t> vWanted;
+    std::vector<uint256> vResponderAnnounce, vResponderShared;
+    responder.Respond(vRequest, vWanted, vResponderAnnounce, vResponderShared);
+    ASSERT_EQ(vWanted.size(), 1);
+    EXPECT_EQ(vWanted[0], initiator.GetShortID(onlyInitiator));
+    ASSERT_EQ(vResponderAnnounce.size(), 1);
+    EXPECT_EQ(vResponderAnnounce[0], onlyResponder);
+    ASSERT_EQ(vResponderShared.size(), 1);
+    EXPECT_EQ(vResponderShared[0], shared);
+    EXPECT_TRUE(responder.setPending.empty());
+
+    std::vector<uint256> vShared;
+    ASSERT_TRUE(initiator.Complete(vWanted, vAnnounce, vShared));
+    ASSERT_EQ(vAnnounce.size(), 1);
+    EXPECT_EQ(vAnnounce[0], onlyInitiator);
+    ASSERT_EQ(vShared.size(), 1);
+    EXPECT_EQ(vShared[0], shared);
+    EXPECT_EQ(initiator.nRounds, 1);
+    EXPECT_EQ(initiator.nShared, 1);
+
+    // no reconciliation in flight any more
+    EXPECT_FALSE(initiator.Complete(vWanted, vAnnounce, vShared));
+}
+
+TEST(TxReconciliation, AbortAnnouncesTheSet) {
+    CTxReconciliationState initiator, responder;
+    EnablePair(initiator, responder);
+
+    const uint256 hash = GetRandHash();
+    initiator.Add(hash);
+    std::vector<uint256> vAnnounce;
+    initiator.StartRequest(1, vAnnounce);
+    initiator.Abort(vAnnounce);
+    ASSERT_EQ(vAnnounce.size(), 1);
+    EXPECT_TRUE(Contains(vAnnounce, hash));
+    EXPECT_EQ(initiator.nRequestTime, 0);
+    EXPECT_TRUE(initiator.mapInFlight.empty());
+}
+
+TEST(TxReconciliation, FullSet) {
+    CTxReconciliationState state;
+    state.nLocalSalt = 1;
+    state.Enable(2);
+    for (size_t i = 0; i < MAX_RECON_SET_SIZE; i++)
+        ASSERT_TRUE(state.Add(GetRandHash()));
+    const uint256 first = *state.setPending.begin();
+    // the next ones are to be announced, but those already in the set
+    EXPECT_FALSE(state.Add(GetRandHash()));
+    EXPECT_TRUE(state.Add(first));
+    EXPECT_EQ(state.setPending.size(), MAX_RECON_SET_SIZE);
+}
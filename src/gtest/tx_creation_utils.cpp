@@ -558,7 +558,7 @@ CTxCeasedSidechainWithdrawalInput BlockchainTestManager::CreateCswInput(uint256
     CSidechain sidechain;
     assert(viewCache->GetSidechain(scId, sidechain));
 
-    CCswProofVerifierInput verifierInput = CScProofVerifier::CswInputToVerifierItem(input, nullptr, sidechain.fixedParams, nullptr);
+    CCswProofVerifierInput verifierInput = CScProofVerifier::CswInputToVerifierItem(input, nullptr, sidechain.GetFixedParams(), nullptr);
     input.scProof = GenerateTestCswProof(verifierInput, provingSystem);
 
     return input;
@@ -738,7 +738,7 @@ CScCertificate BlockchainTestManager::GenerateCertificate(uint256 scId, int epoc
     CSidechain sidechain;
     assert(viewCache->GetSidechain(scId, sidechain));
 
-    CCertProofVerifierInput input = CScProofVerifier::CertificateToVerifierItem(res, sidechain.fixedParams, nullptr, viewCache.get());
+    CCertProofVerifierInput input = CScProofVerifier::CertificateToVerifierItem(res, sidechain.GetFixedParams(), nullptr, viewCache.get());
     res.scProof = GenerateTestCertificateProof(input, provingSystem);
 
     return res;
@@ -914,10 +914,10 @@ CScVKey BlockchainTestManager::GetTestVerificationKey(ProvingSystem provingSyste
 CSidechain BlockchainTestManager::GenerateSidechain(uint256 scId, uint8_t version) const
 {
     CSidechain sc;
-    sc.fixedParams.version = version;
-    sc.fixedParams.constant = CFieldElement{SAMPLE_FIELD};
-    sc.fixedParams.wCertVk = GetTestVerificationKey(ProvingSystem::CoboundaryMarlin, TestCircuitType::CertificateNoConstant);
-    sc.fixedParams.wCeasedVk = GetTestVerificationKey(ProvingSystem::CoboundaryMarlin, TestCircuitType::CSWNoConstant);
+    sc.ModifyFixedParams().version = version;
+    sc.ModifyFixedParams().constant = CFieldElement{SAMPLE_FIELD};
+    sc.ModifyFixedParams().wCertVk = GetTestVerificationKey(ProvingSystem::CoboundaryMarlin, TestCircuitType::CertificateNoConstant);
+    sc.ModifyFixedParams().wCeasedVk = GetTestVerificationKey(ProvingSystem::CoboundaryMarlin, TestCircuitType::CSWNoConstant);
     return sc;
 }
 
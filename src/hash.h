@@ -123,21 +123,26 @@ class CHashWriter
 {
 private:
     CHash256 ctx;
+    size_t nSize;
 
 public:
     int nType;
     int nVersion;
 
-    CHashWriter(int nTypeIn, int nVersionIn) : nType(nTypeIn), nVersion(nVersionIn) {}
+    CHashWriter(int nTypeIn, int nVersionIn) : nSize(0), nType(nTypeIn), nVersion(nVersionIn) {}
 
 	int GetType() const { return nType; }
     int GetVersion() const { return nVersion; }
 
     CHashWriter& write(const char *pch, size_t size) {
         ctx.Write((const unsigned char*)pch, size);
+        nSize += size;
         return (*this);
     }
 
+    //! the number of bytes hashed so far
+    size_t size() const { return nSize; }
+
     // invalidates the object
     uint256 GetHash() {
         uint256 result;
@@ -166,6 +171,28 @@ unsigned int MurmurHash3(unsigned int nHashSeed, const std::vector<unsigned char
 
 void BIP32Hash(const ChainCode &chainCode, unsigned int nChild, unsigned char header, const unsigned char data[32], unsigned char output[64]);
 
+/** SipHash-2-4, a fast keyed hash, for short ids that peers can not choose to collide */
+class CSipHasher
+{
+private:
+    uint64_t v[4];
+    uint64_t tmp;
+    int count;
+
+public:
+    /** Construct a SipHash calculator initialized with 128-bit key (k0, k1) */
+    CSipHasher(uint64_t k0, uint64_t k1);
+    /** Hash a 64-bit integer worth of data, only valid when a multiple of 8 bytes has been written so far */
+    CSipHasher& Write(uint64_t data);
+    /** Hash arbitrary bytes */
+    CSipHasher& Write(const unsigned char* data, size_t size);
+    /** Compute the 64-bit SipHash-2-4 of the data written so far. The object remains untouched. */
+    uint64_t Finalize() const;
+};
+
+/** Optimized SipHash-2-4 implementation for uint256, the same as CSipHasher(k0, k1).Write(val.begin(), 32).Finalize() */
+uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
+
 struct ObjectHasher
 {
     size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
@@ -0,0 +1,107 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "headercache.h"
+
+#include "chain.h"
+#include "main.h"
+#include "streams.h"
+#include "utilstrencodings.h"
+
+CBlockHeaderCache headerCache(DEFAULT_HEADER_CACHE_SIZE << 20);
+
+CBlockHeaderCache::CachedHeader& CBlockHeaderCache::Get(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs);
+    const uint256 hash = pindex->GetBlockHash();
+    auto it = mapHeaders.find(hash);
+    if (it != mapHeaders.end()) {
+        lru.splice(lru.begin(), lru, it->second);
+        return *it->second;
+    }
+
+    // the Equihash solution may have to be read from the block tree db
+    AssertLockHeld(cs_main);
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << pindex->GetBlockHeader();
+
+    CachedHeader entry;
+    entry.hash = hash;
+    entry.raw = std::make_shared<const std::string>(ss.begin(), ss.end());
+    lru.push_front(entry);
+    mapHeaders[hash] = lru.begin();
+    nBytes += entry.raw->size();
+    Evict();
+    return lru.front();
+}
+
+void CBlockHeaderCache::Evict()
+{
+    AssertLockHeld(cs);
+    // the entry just used stays, whatever its size
+    while (nBytes > nMaxBytes && lru.size() > 1) {
+        const CachedHeader& entry = lru.back();
+        nBytes -= entry.raw->size() + (entry.hex ? entry.hex->size() : 0);
+        mapHeaders.erase(entry.hash);
+        lru.pop_back();
+    }
+}
+
+std::shared_ptr<const std::string> CBlockHeaderCache::GetRaw(const CBlockIndex* pindex)
+{
+    LOCK(cs);
+    return Get(pindex).raw;
+}
+
+std::shared_ptr<const std::string> CBlockHeaderCache::GetHex(const CBlockIndex* pindex)
+{
+    LOCK(cs);
+    CachedHeader& entry = Get(pindex);
+    if (!entry.hex) {
+        entry.hex = std::make_shared<const std::string>(HexStr(entry.raw->begin(), entry.raw->end()));
+        nBytes += entry.hex->size();
+        std::shared_ptr<const std::string> hex = entry.hex;
+        Evict();
+        return hex;
+    }
+    return entry.hex;
+}
+
+void CBlockHeaderCache::Erase(const uint256& hash)
+{
+    LOCK(cs);
+    auto it = mapHeaders.find(hash);
+    if (it == mapHeaders.end())
+        return;
+    nBytes -= it->second->raw->size() + (it->second->hex ? it->second->hex->size() : 0);
+    lru.erase(it->second);
+    mapHeaders.erase(it);
+}
+
+void CBlockHeaderCache::Clear()
+{
+    LOCK(cs);
+    lru.clear();
+    mapHeaders.clear();
+    nBytes = 0;
+}
+
+void CBlockHeaderCache::SetMaxBytes(size_t nMaxBytesIn)
+{
+    LOCK(cs);
+    nMaxBytes = nMaxBytesIn;
+    Evict();
+}
+
+size_t CBlockHeaderCache::Size() const
+{
+    LOCK(cs);
+    return lru.size();
+}
+
+size_t CBlockHeaderCache::Bytes() const
+{
+    LOCK(cs);
+    return nBytes;
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_HEADERCACHE_H
+#define BITCOIN_HEADERCACHE_H
+
+#include "hash.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+class CBlockIndex;
+
+/** The size in MiB of the serialized headers cache, by default */
+static const unsigned int DEFAULT_HEADER_CACHE_SIZE = 8;
+
+/**
+ * The serialized headers, raw and hex, of the blocks recently asked for by the peers ("headers"), the sidechain
+ * nodes (websocket), the light clients (REST) and getblockheader. They all ask for the same overlapping ranges,
+ * and building a header from its block index entry reads its Equihash solution back from the block tree db
+ * once the entry is trimmed.
+ *
+ * The entries are keyed by block hash, so none can be stale; the ones of the blocks disconnected by a reorg are
+ * dropped all the same, since they are not going to be asked for again. The cache is bounded in bytes, the least
+ * recently used entries are evicted first.
+ */
+class CBlockHeaderCache
+{
+public:
+    explicit CBlockHeaderCache(size_t nMaxBytesIn) : nMaxBytes(nMaxBytesIn) {}
+
+    //! The serialized header of pindex, built if not cached; the caller must hold cs_main
+    std::shared_ptr<const std::string> GetRaw(const CBlockIndex* pindex);
+    //! The same, hex encoded
+    std::shared_ptr<const std::string> GetHex(const CBlockIndex* pindex);
+
+    //! Drop the header of a block disconnected from the active chain
+    void Erase(const uint256& hash);
+    void Clear();
+    void SetMaxBytes(size_t nMaxBytesIn);
+
+    size_t Size() const;
+    size_t Bytes() const;
+
+private:
+    struct CachedHeader
+    {
+        uint256 hash;
+        std::shared_ptr<const std::string> raw;
+        std::shared_ptr<const std::string> hex; //!< encoded on the first request of it
+    };
+
+    mutable CCriticalSection cs;
+    size_t nMaxBytes;
+    size_t nBytes = 0;
+    //! the most recently used first
+    std::list<CachedHeader> lru;
+    std::unordered_map<uint256, std::list<CachedHeader>::iterator, ObjectHasher> mapHeaders;
+
+    CachedHeader& Get(const CBlockIndex* pindex);
+    void Evict();
+};
+
+/** The headers of the active chain served by this node */
+extern CBlockHeaderCache headerCache;
+
+#endif // BITCOIN_HEADERCACHE_H
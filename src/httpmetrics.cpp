@@ -0,0 +1,98 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "httprpc.h"
+
+#include "httpserver.h"
+#include "main.h"
+#include "metrics.h"
+#include "net.h"
+#include "rpc/protocol.h"
+#include "sync.h"
+#include "txmempool.h"
+#include "util.h"
+#include "zen/websocket_server.h"
+
+#include <string>
+
+/** The node's figures in the Prometheus text exposition format, version 0.0.4 */
+static bool HTTPReq_Metrics(HTTPRequest* req, const std::string&)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_BAD_METHOD, "Only GET is supported\r\n");
+        return false;
+    }
+
+    std::string out;
+    AppendRegisteredMetrics(out);
+
+    std::string strFamily;
+    {
+        // a scrape during the connection of a block goes without the chain figures rather than waiting
+        TRY_LOCK(cs_main, lockMain);
+        if (lockMain) {
+            AppendMetric(out, strFamily, "zen_blocks", "Height of the active chain tip", MetricValue::Type::GAUGE, chainActive.Height());
+            AppendMetric(out, strFamily, "zen_coins_cache_usage_bytes", "Memory used by the coins cache",
+                         MetricValue::Type::GAUGE, pcoinsTip != nullptr ? pcoinsTip->DynamicMemoryUsage() : 0);
+        }
+    }
+
+    AppendMetric(out, strFamily, "zen_mempool_transactions", "Transactions and certificates in the mempool",
+                 MetricValue::Type::GAUGE, mempool.size());
+    AppendMetric(out, strFamily, "zen_mempool_bytes", "Serialized size of the mempool", MetricValue::Type::GAUGE, mempool.GetTotalSize());
+    AppendMetric(out, strFamily, "zen_mempool_usage_bytes", "Memory used by the mempool", MetricValue::Type::GAUGE, mempool.DynamicMemoryUsage());
+
+    size_t nInbound = 0, nOutbound = 0;
+    {
+        LOCK(cs_vNodes);
+        for (const CNode* pnode : vNodes)
+            (pnode->fInbound ? nInbound : nOutbound)++;
+    }
+    AppendMetric(out, strFamily, "zen_peers{direction=\"inbound\"}", "Connected peers", MetricValue::Type::GAUGE, nInbound);
+    AppendMetric(out, strFamily, "zen_peers{direction=\"outbound\"}", "Connected peers", MetricValue::Type::GAUGE, nOutbound);
+    AppendMetric(out, strFamily, "zen_network_received_bytes_total", "Bytes received from the peers", MetricValue::Type::COUNTER, CNode::GetTotalBytesRecv());
+    AppendMetric(out, strFamily, "zen_network_sent_bytes_total", "Bytes sent to the peers", MetricValue::Type::COUNTER, CNode::GetTotalBytesSent());
+
+    const std::vector<HTTPWorkClassStats> vClasses = GetHTTPWorkClassStats();
+    typedef std::pair<const char*, const char*> Family;
+    static const std::vector<Family> vRpcFamilies = {
+        {"zen_rpc_requests_total", "RPC requests handled"},
+        {"zen_rpc_rejected_total", "RPC requests refused because the queue of their class was full"},
+        {"zen_rpc_wait_microseconds_total", "Time the RPC requests waited for a worker thread"},
+        {"zen_rpc_run_microseconds_total", "Time spent handling the RPC requests"},
+        {"zen_rpc_queued", "RPC requests waiting for a worker thread"},
+        {"zen_rpc_running", "RPC requests being handled"},
+    };
+    for (size_t i = 0; i < vRpcFamilies.size(); i++) {
+        for (const HTTPWorkClassStats& stats : vClasses) {
+            const double values[] = {(double)stats.nDone, (double)stats.nRejected, (double)stats.nTotalWaitMicros,
+                                     (double)stats.nTotalRunMicros, (double)stats.nQueued, (double)stats.nRunning};
+            AppendMetric(out, strFamily, strprintf("%s{class=\"%s\"}", vRpcFamilies[i].first, stats.name), vRpcFamilies[i].second,
+                         i < 4 ? MetricValue::Type::COUNTER : MetricValue::Type::GAUGE, values[i]);
+        }
+    }
+
+    WsServerStats wsStats;
+    GetWsServerStats(wsStats);
+    AppendMetric(out, strFamily, "zen_websocket_connections", "Open websocket connections", MetricValue::Type::GAUGE, wsStats.nConnections);
+    AppendMetric(out, strFamily, "zen_websocket_accepted_total", "Websocket connections accepted", MetricValue::Type::COUNTER, wsStats.nTotalConnections);
+    AppendMetric(out, strFamily, "zen_websocket_received_bytes_total", "Bytes received on the websocket", MetricValue::Type::COUNTER, wsStats.nRecvBytes);
+    AppendMetric(out, strFamily, "zen_websocket_sent_bytes_total", "Bytes sent on the websocket", MetricValue::Type::COUNTER, wsStats.nSentBytes);
+
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, out);
+    return true;
+}
+
+bool StartHTTPMetrics()
+{
+    RegisterHTTPHandler("/metrics", true, HTTPReq_Metrics);
+    return true;
+}
+
+void StopHTTPMetrics()
+{
+    UnregisterHTTPHandler("/metrics", true);
+}
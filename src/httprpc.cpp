@@ -3,6 +3,7 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "httpserver.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
 #include "random.h"
@@ -13,6 +14,10 @@
 
 #include <boost/algorithm/string.hpp> // boost::trim
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
 /** WWW-Authenticate to present with 401 Unauthorized response */
 static const char* WWW_AUTH_HEADER_DATA = "Basic realm=\"jsonrpc\"";
 
@@ -71,6 +76,8 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
 
     std::string strReply = JSONRPCReply(NullUniValue, objError, id);
 
+    // a result may have been written in part before the error
+    req->DiscardReply();
     req->WriteHeader("Content-Type", "application/json");
     req->WriteReply(nStatus, strReply);
 }
@@ -87,6 +94,110 @@ static bool RPCAuthorized(const std::string& strAuth)
     return TimingResistantEqual(strUserPass, strRPCUserColonPass);
 }
 
+/**
+ * A batch being executed. Its read-only calls are taken in turn by the worker handling the request and by the
+ * workers helping it, stretch by stretch: the other calls are barriers, run alone once the calls before them
+ * are over. The replies are kept in the order of the calls.
+ */
+struct JSONRPCBatch
+{
+    std::mutex cs;
+    std::condition_variable cond;
+    std::vector<UniValue> vReq;
+    std::vector<UniValue> vReply;
+    //! the URI the batch was sent to, for the workers helping
+    std::string strURI;
+    //! the next call to take, the end of the stretch being run, and the calls of the stretch over
+    size_t nNext = 0;
+    size_t nEnd = 0;
+    size_t nFinished = 0;
+
+    //! Run the next call of the stretch, false once they are all taken
+    bool RunNext()
+    {
+        size_t n;
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            if (nNext >= nEnd)
+                return false;
+            n = nNext++;
+        }
+        CRPCRequestURIScope requestScope(strURI);
+        UniValue reply = JSONRPCExecOne(vReq[n]);
+        {
+            std::unique_lock<std::mutex> lock(cs);
+            vReply[n] = reply;
+            nFinished++;
+        }
+        cond.notify_all();
+        return true;
+    }
+};
+
+class JSONRPCBatchHelper : public HTTPClosure
+{
+private:
+    std::shared_ptr<JSONRPCBatch> batch;
+
+public:
+    explicit JSONRPCBatchHelper(const std::shared_ptr<JSONRPCBatch>& batchIn) : batch(batchIn) {}
+
+    void operator()() override
+    {
+        while (batch->RunNext()) {}
+    }
+};
+
+static bool IsReadOnlyCall(const UniValue& req)
+{
+    if (!req.isObject())
+        return false;
+    const UniValue& method = find_value(req, "method");
+    return method.isStr() && tableRPC.isReadOnly(method.get_str());
+}
+
+static std::string JSONRPCExecParallelBatch(const UniValue& vReq)
+{
+    std::shared_ptr<JSONRPCBatch> batch = std::make_shared<JSONRPCBatch>();
+    batch->vReq = vReq.getValues();
+    batch->strURI = GetRPCRequestURI();
+    batch->vReply.resize(batch->vReq.size());
+    size_t nHelpers = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L) - 1;
+
+    for (size_t nBegin = 0; nBegin < batch->vReq.size(); ) {
+        if (!IsReadOnlyCall(batch->vReq[nBegin])) {
+            batch->vReply[nBegin] = JSONRPCExecOne(batch->vReq[nBegin]);
+            nBegin++;
+            continue;
+        }
+        size_t nEnd = nBegin + 1;
+        while (nEnd < batch->vReq.size() && IsReadOnlyCall(batch->vReq[nEnd]))
+            nEnd++;
+        {
+            std::unique_lock<std::mutex> lock(batch->cs);
+            batch->nNext = nBegin;
+            batch->nEnd = nEnd;
+            batch->nFinished = 0;
+        }
+        // the helpers that are not run in time find nothing left to do
+        for (size_t i = 0; i < std::min(nHelpers, nEnd - nBegin - 1); i++) {
+            if (!QueueHTTPWork(new JSONRPCBatchHelper(batch)))
+                break;
+        }
+        while (batch->RunNext()) {}
+        {
+            std::unique_lock<std::mutex> lock(batch->cs);
+            batch->cond.wait(lock, [&batch, nBegin, nEnd]{ return batch->nFinished == nEnd - nBegin; });
+        }
+        nBegin = nEnd;
+    }
+
+    UniValue ret(UniValue::VARR);
+    for (const UniValue& reply : batch->vReply)
+        ret.push_back(reply);
+    return ret.write() + "\n";
+}
+
 static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
 {
     // JSONRPC handles only POST
@@ -115,6 +226,8 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         return false;
     }
 
+    // the calls are for the wallet of the URI, if any
+    CRPCRequestURIScope requestScope(req->GetURI());
     JSONRequest jreq;
     try {
         // Parse request
@@ -127,14 +240,20 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
-            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
-
-            // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            // the reply is written straight to the output buffer, as the result is produced
+            JSONStreamWriter writer([req](const char* data, size_t size) { req->AppendReply(data, size); });
+            writer.BeginObject();
+            writer.Key("result");
+            tableRPC.execute(jreq.strMethod, jreq.params, writer);
+            writer.KeyValue("error", NullUniValue);
+            writer.KeyValue("id", jreq.id);
+            writer.EndObject();
+            writer.Flush();
+            strReply = "\n";
 
         // array of requests
         } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
+            strReply = JSONRPCExecParallelBatch(valRequest.get_array());
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
 
@@ -167,13 +286,87 @@ static bool InitRPCAuthentication()
     return true;
 }
 
+//! Enough of the body to find the methods of the calls of the usual requests
+static const size_t RPC_CLASSIFY_PEEK_SIZE = 64 * 1024;
+
+/**
+ * The class of a request, from the "method" members at the start of its body, not to parse it on the event
+ * thread: a batch is in the class of its lowest priority call. The REST requests are all explorer lookups.
+ */
+static size_t ClassifyHTTPRequest(HTTPRequest* req)
+{
+    // the scrapes of the metrics are answered without locking cs_main for long
+    if (req->GetURI() == "/metrics")
+        return (size_t)RPCMethodClass::CHEAP;
+    if (req->GetURI() != "/" && req->GetURI().compare(0, WALLET_ENDPOINT_BASE.size(), WALLET_ENDPOINT_BASE) != 0)
+        return (size_t)RPCMethodClass::HEAVY;
+
+    static const std::string strKey = "\"method\"";
+    const std::string strBody = req->PeekBody(RPC_CLASSIFY_PEEK_SIZE);
+    bool fFound = false;
+    size_t nClass = 0;
+    for (size_t pos = strBody.find(strKey); pos != std::string::npos; pos = strBody.find(strKey, pos + 1)) {
+        // an escaped quote is within a string
+        if (pos > 0 && strBody[pos - 1] == '\\')
+            continue;
+        size_t nBegin = strBody.find_first_not_of(" \t\r\n", pos + strKey.size());
+        if (nBegin == std::string::npos || strBody[nBegin] != ':')
+            continue;
+        nBegin = strBody.find_first_not_of(" \t\r\n", nBegin + 1);
+        if (nBegin == std::string::npos || strBody[nBegin] != '"')
+            continue;
+        size_t nEnd = strBody.find('"', nBegin + 1);
+        if (nEnd == std::string::npos)
+            break;
+        nClass = std::max(nClass, (size_t)tableRPC.getMethodClass(strBody.substr(nBegin + 1, nEnd - nBegin - 1)));
+        fFound = true;
+    }
+    return fFound ? nClass : (size_t)RPCMethodClass::CHEAP;
+}
+
+/** The classes of the methods, with the threads they can use at once from -rpcclassthreads=<class>:<n> */
+static bool InitRPCWorkClasses()
+{
+    const size_t nThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    std::vector<HTTPWorkClass> vClasses(RPC_METHOD_CLASS_COUNT);
+    for (size_t i = 0; i < RPC_METHOD_CLASS_COUNT; i++) {
+        vClasses[i].name = RPCMethodClassName((RPCMethodClass)i);
+        vClasses[i].nMaxRunning = nThreads;
+    }
+    // by default one thread is kept from the wallet, half of them from the lookups
+    vClasses[(size_t)RPCMethodClass::WALLET].nMaxRunning = std::max(nThreads - 1, (size_t)1);
+    vClasses[(size_t)RPCMethodClass::HEAVY].nMaxRunning = std::max(nThreads / 2, (size_t)1);
+
+    for (const std::string& strArg : mapMultiArgs["-rpcclassthreads"]) {
+        size_t nColon = strArg.find(':');
+        int nMaxRunning = 0;
+        std::vector<HTTPWorkClass>::iterator it = vClasses.end();
+        if (nColon != std::string::npos && ParseInt32(strArg.substr(nColon + 1), &nMaxRunning) && nMaxRunning > 0) {
+            const std::string strName = strArg.substr(0, nColon);
+            it = std::find_if(vClasses.begin(), vClasses.end(), [&strName](const HTTPWorkClass& c) { return c.name == strName; });
+        }
+        if (it == vClasses.end()) {
+            LogPrintf("Invalid -rpcclassthreads=%s, expected <mining|cheap|wallet|heavy>:<n>\n", strArg);
+            return false;
+        }
+        it->nMaxRunning = nMaxRunning;
+    }
+
+    SetHTTPWorkClasses(vClasses, ClassifyHTTPRequest);
+    return true;
+}
+
 bool StartHTTPRPC()
 {
     LogPrint("rpc", "Starting HTTP RPC server\n");
     if (!InitRPCAuthentication())
         return false;
+    if (!InitRPCWorkClasses())
+        return false;
 
     RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    // the calls sent to /wallet/<file> are for the wallet of <file>, among the ones loaded
+    RegisterHTTPHandler(WALLET_ENDPOINT_BASE, false, HTTPReq_JSONRPC);
 
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
@@ -190,6 +383,7 @@ void StopHTTPRPC()
 {
     LogPrint("rpc", "Stopping HTTP RPC server\n");
     UnregisterHTTPHandler("/", true);
+    UnregisterHTTPHandler(WALLET_ENDPOINT_BASE, false);
     if (httpRPCTimerInterface) {
         RPCUnregisterTimerInterface(httpRPCTimerInterface);
         delete httpRPCTimerInterface;
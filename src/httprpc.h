@@ -32,4 +32,12 @@ void InterruptREST();
  */
 void StopREST();
 
+/** Start the HTTP /metrics endpoint, in the Prometheus text format.
+ * Precondition; HTTP has been started.
+ */
+bool StartHTTPMetrics();
+/** Stop the HTTP /metrics endpoint.
+ */
+void StopHTTPMetrics();
+
 #endif
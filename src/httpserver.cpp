@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <string>
 #include <deque>
+#include <limits>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -59,18 +60,34 @@ private:
     HTTPRequestHandler func;
 };
 
+//! The class of the item a worker thread is running, for the closures it queues
+static thread_local size_t nCurrentWorkClass = 0;
+
 /** Simple work queue for distributing work over multiple threads.
- * Work items are simply callable objects.
+ * Work items are simply callable objects, queued by class: see SetHTTPWorkClasses.
  */
 template <typename WorkItem>
 class WorkQueue
 {
 private:
+    struct QueuedItem
+    {
+        WorkItem* item;
+        int64_t nQueuedTime;
+    };
+    struct WorkClass
+    {
+        HTTPWorkClassStats stats;
+        std::deque<QueuedItem> queue;
+    };
+
     /** Mutex protects entire object */
     CWaitableCriticalSection cs;
     CConditionVariable cond;
     /* XXX in C++11 we can use std::unique_ptr here and avoid manual cleanup */
-    std::deque<WorkItem*> queue;
+    std::vector<WorkClass> classes;
+    //! the items queued in all the classes, bounded by maxDepth
+    size_t nQueued;
     bool running;
     size_t maxDepth;
     int numThreads;
@@ -93,30 +110,66 @@ private:
         }
     };
 
+    /** The first class with an item waiting and a worker free for it; cs must be held */
+    bool NextClass(size_t& nClass) const
+    {
+        for (nClass = 0; nClass < classes.size(); nClass++) {
+            const WorkClass& workClass = classes[nClass];
+            if (!workClass.queue.empty() && workClass.stats.nRunning < workClass.stats.nMaxRunning)
+                return true;
+        }
+        return false;
+    }
+
 public:
-    WorkQueue(size_t maxDepth) : running(true),
+    WorkQueue(size_t maxDepth) : classes(1),
+                                 nQueued(0),
+                                 running(true),
                                  maxDepth(maxDepth),
                                  numThreads(0)
     {
+        classes[0].stats.name = "default";
+        classes[0].stats.nMaxRunning = std::numeric_limits<size_t>::max();
     }
     /*( Precondition: worker threads have all stopped
      * (call WaitExit)
      */
     ~WorkQueue()
     {
-        while (!queue.empty()) {
-            delete queue.front();
-            queue.pop_front();
+        for (WorkClass& workClass : classes) {
+            while (!workClass.queue.empty()) {
+                delete workClass.queue.front().item;
+                workClass.queue.pop_front();
+            }
         }
     }
+    /** Replace the classes of the items. Precondition: nothing queued yet */
+    void SetClasses(const std::vector<HTTPWorkClass>& newClasses)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        assert(nQueued == 0 && !newClasses.empty());
+        classes.assign(newClasses.size(), WorkClass());
+        for (size_t i = 0; i < newClasses.size(); i++) {
+            classes[i].stats.name = newClasses[i].name;
+            classes[i].stats.nMaxRunning = std::max(newClasses[i].nMaxRunning, (size_t)1);
+        }
+    }
+    size_t ClassCount()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        return classes.size();
+    }
     /** Enqueue a work item */
-    bool Enqueue(WorkItem* item)
+    bool Enqueue(WorkItem* item, size_t nClass = 0)
     {
         boost::unique_lock<boost::mutex> lock(cs);
-        if (queue.size() >= maxDepth) {
+        WorkClass& workClass = classes[std::min(nClass, classes.size() - 1)];
+        if (nQueued >= maxDepth) {
+            workClass.stats.nRejected++;
             return false;
         }
-        queue.push_back(item);
+        workClass.queue.push_back(QueuedItem{item, GetTimeMicros()});
+        nQueued++;
         cond.notify_one();
         return true;
     }
@@ -126,17 +179,38 @@ public:
         ThreadCounter count(*this);
         while (running) {
             WorkItem* i = 0;
+            size_t nClass;
+            int64_t nStart;
             {
                 boost::unique_lock<boost::mutex> lock(cs);
-                while (running && queue.empty())
+                while (running && !NextClass(nClass))
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = queue.front();
-                queue.pop_front();
+                WorkClass& workClass = classes[nClass];
+                i = workClass.queue.front().item;
+                nStart = GetTimeMicros();
+                int64_t nWait = nStart - workClass.queue.front().nQueuedTime;
+                workClass.queue.pop_front();
+                nQueued--;
+                workClass.stats.nRunning++;
+                workClass.stats.nTotalWaitMicros += nWait;
+                workClass.stats.nMaxWaitMicros = std::max(workClass.stats.nMaxWaitMicros, nWait);
             }
+            nCurrentWorkClass = nClass;
             (*i)();
             delete i;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                HTTPWorkClassStats& stats = classes[nClass].stats;
+                int64_t nRun = GetTimeMicros() - nStart;
+                stats.nRunning--;
+                stats.nDone++;
+                stats.nTotalRunMicros += nRun;
+                stats.nMaxRunMicros = std::max(stats.nMaxRunMicros, nRun);
+            }
+            // an item of the class may have been waiting for this worker
+            cond.notify_all();
         }
     }
     /** Interrupt and exit loops */
@@ -158,7 +232,18 @@ public:
     size_t Depth()
     {
         boost::unique_lock<boost::mutex> lock(cs);
-        return queue.size();
+        return nQueued;
+    }
+
+    std::vector<HTTPWorkClassStats> GetStats()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        std::vector<HTTPWorkClassStats> vStats;
+        for (const WorkClass& workClass : classes) {
+            vStats.push_back(workClass.stats);
+            vStats.back().nQueued = workClass.queue.size();
+        }
+        return vStats;
     }
 };
 
@@ -184,6 +269,8 @@ struct evhttp* eventHTTP = 0;
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
 static WorkQueue<HTTPClosure>* workQueue = 0;
+//! The class of the requests in the work queue, all in the single default class without it
+static HTTPWorkClassifier workClassifier;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -286,9 +373,10 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        size_t nClass = workClassifier ? workClassifier(hreq.get()) : 0;
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(hreq.release(), path, i->handler));
         assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        if (workQueue->Enqueue(item.get(), nClass))
             item.release(); /* if true, queue took ownership */
         else
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
@@ -297,6 +385,31 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
     }
 }
 
+bool QueueHTTPWork(HTTPClosure* item)
+{
+    std::unique_ptr<HTTPClosure> closure(item);
+    if (!workQueue || !workQueue->Enqueue(closure.get(), nCurrentWorkClass))
+        return false;
+    closure.release(); /* the queue took ownership */
+    return true;
+}
+
+void SetHTTPWorkClasses(const std::vector<HTTPWorkClass>& classes, const HTTPWorkClassifier& classifier)
+{
+    assert(workQueue);
+    workQueue->SetClasses(classes);
+    workClassifier = classifier;
+    for (const HTTPWorkClass& workClass : classes)
+        LogPrint("http", "HTTP: work class %s runs on at most %u worker threads\n", workClass.name, workClass.nMaxRunning);
+}
+
+std::vector<HTTPWorkClassStats> GetHTTPWorkClassStats()
+{
+    if (!workQueue)
+        return std::vector<HTTPWorkClassStats>();
+    return workQueue->GetStats();
+}
+
 /** Callback to reject HTTP requests after shutdown. */
 static void http_reject_request_cb(struct evhttp_request* req, void*)
 {
@@ -478,6 +591,7 @@ void StopHTTPServer()
         LogPrint("http", "Waiting for HTTP worker threads to exit\n");
         workQueue->WaitExit();
         delete workQueue;
+        workQueue = 0;
     }
     if (eventBase) {
         LogPrint("http", "Waiting for HTTP event thread to exit\n");
@@ -562,6 +676,18 @@ std::pair<bool, std::string> HTTPRequest::GetHeader(const std::string& hdr)
         return std::make_pair(false, "");
 }
 
+std::string HTTPRequest::PeekBody(size_t nMaxSize)
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    size_t size = std::min(evbuffer_get_length(buf), nMaxSize);
+    const char* data = (const char*)evbuffer_pullup(buf, size);
+    if (!data)
+        return "";
+    return std::string(data, size);
+}
+
 std::string HTTPRequest::ReadBody()
 {
     struct evbuffer* buf = evhttp_request_get_input_buffer(req);
@@ -608,6 +734,22 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+void HTTPRequest::AppendReply(const char* data, size_t size)
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    evbuffer_add(evb, data, size);
+}
+
+void HTTPRequest::DiscardReply()
+{
+    assert(!replySent && req);
+    struct evbuffer* evb = evhttp_request_get_output_buffer(req);
+    assert(evb);
+    evbuffer_drain(evb, evbuffer_get_length(evb));
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
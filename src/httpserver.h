@@ -6,6 +6,7 @@
 #define BITCOIN_HTTPSERVER_H
 
 #include <string>
+#include <vector>
 #include <stdint.h>
 #include <boost/thread.hpp>
 #include <boost/scoped_ptr.hpp>
@@ -91,6 +92,11 @@ public:
      */
     virtual std::pair<bool, std::string> GetHeader(const std::string& hdr);
 
+    /**
+     * Copy of at most nMaxSize bytes at the start of the request body, leaving it to be read.
+     */
+    std::string PeekBody(size_t nMaxSize);
+
     /**
      * Read request body.
      *
@@ -115,6 +121,17 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     virtual void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Append to the body of the reply, for a reply written as it is produced; WriteReply sends it,
+     * followed by its strReply.
+     */
+    virtual void AppendReply(const char* data, size_t size);
+
+    /**
+     * Drop what was appended to the body of the reply, for an error to be sent instead.
+     */
+    virtual void DiscardReply();
 };
 
 /** Event handler closure.
@@ -126,6 +143,48 @@ public:
     virtual ~HTTPClosure() {}
 };
 
+/** Queue a closure for the worker threads, for a handler to spread its work over them.
+ * The closure is owned by the queue, or deleted if the queue is full; it may never run once
+ * the server is interrupted, so the handler must not wait for it to.
+ */
+bool QueueHTTPWork(HTTPClosure* item);
+
+/** A class of requests for the worker threads: at most nMaxRunning of them are handled at once */
+struct HTTPWorkClass
+{
+    std::string name;
+    size_t nMaxRunning;
+};
+
+/** The class of a request, as an index in the classes given to SetHTTPWorkClasses() */
+typedef boost::function<size_t(HTTPRequest* req)> HTTPWorkClassifier;
+
+/**
+ * Set the classes of the requests, in the order of their priority: a free worker takes the oldest request of
+ * the first class with one waiting and not at its limit. The closures queued by a handler are in the class of
+ * its request. Call this between InitHTTPServer and StartHTTPServer; by default all the requests are in a
+ * single class.
+ */
+void SetHTTPWorkClasses(const std::vector<HTTPWorkClass>& classes, const HTTPWorkClassifier& classifier);
+
+struct HTTPWorkClassStats
+{
+    std::string name;
+    size_t nMaxRunning = 0;
+    size_t nRunning = 0;
+    size_t nQueued = 0;
+    uint64_t nDone = 0;
+    //! refused because the queue was full
+    uint64_t nRejected = 0;
+    int64_t nTotalWaitMicros = 0;
+    int64_t nMaxWaitMicros = 0;
+    int64_t nTotalRunMicros = 0;
+    int64_t nMaxRunMicros = 0;
+};
+
+/** The activity of the worker threads for every class of requests, in the order of their priority */
+std::vector<HTTPWorkClassStats> GetHTTPWorkClassStats();
+
 /** Event class. This can be used either as an cross-thread trigger or as a timer.
  */
 class HTTPEvent
@@ -0,0 +1,178 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "indexer.h"
+
+#include "init.h"
+#include "main.h"
+#include "txdb.h"
+#include "util.h"
+
+//! The number of blocks indexed between two records of the indexer progress
+static const int INDEXER_PROGRESS_BLOCKS = 1000;
+
+void CBaseIndexer::Start()
+{
+    if (fStarted)
+        return;
+
+    {
+        LOCK(cs_main);
+        pindexBest = NULL;
+        std::string strBest;
+        if (!pblocktree->ReadString(strBestKey, strBest)) {
+            pindexBest = GetUnrecordedBest();
+        } else if (!strBest.empty()) {
+            BlockMap::const_iterator it = mapBlockIndex.find(uint256S(strBest));
+            if (it != mapBlockIndex.end())
+                pindexBest = it->second;
+        }
+        if (pindexBest != NULL && !LoadBlock(pindexBest)) {
+            // the index does not have the block it was said to be synced to, build it again
+            pindexBest = NULL;
+        }
+    }
+
+    LogPrintf("%s: %s index synced to %s\n", __func__, strName,
+              pindexBest != NULL ? pindexBest->GetBlockHash().ToString() : "nothing yet");
+    if (!WriteProgress())
+        LogPrintf("%s: failed to record the %s index progress\n", __func__, strName);
+
+    fStarted = true;
+    fStop = false;
+    pindexSynced = pindexBest;
+    RegisterValidationInterface(this);
+    thread = boost::thread(&CBaseIndexer::ThreadIndex, this);
+}
+
+void CBaseIndexer::Stop()
+{
+    if (!fStarted)
+        return;
+
+    UnregisterValidationInterface(this);
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStop = true;
+    }
+    condition.notify_all();
+    thread.join();
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fStarted = false;
+    }
+
+    if (!WriteProgress())
+        LogPrintf("%s: failed to record the %s index progress\n", __func__, strName);
+}
+
+bool CBaseIndexer::IsCaughtUp()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return fCaughtUp;
+}
+
+void CBaseIndexer::SyncWithTip()
+{
+    const CBlockIndex* pindexTip = NULL;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+    }
+    if (pindexTip == NULL)
+        return;
+
+    // the active chain only moves to more work, so does the index following it
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (fStarted && !fStop && (pindexSynced == NULL || pindexSynced->nChainWork < pindexTip->nChainWork))
+        condition.wait(lock);
+}
+
+bool CBaseIndexer::ResetProgress(const std::string& strBestKey)
+{
+    return pblocktree->WriteString(strBestKey, "");
+}
+
+void CBaseIndexer::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fTipChanged = true;
+    }
+    condition.notify_all();
+}
+
+bool CBaseIndexer::WriteProgress()
+{
+    // the recorded block must not be ahead of the index entries still queued for writing
+    if (!pblocktree->WaitForIndexWrites())
+        return false;
+    return pblocktree->WriteString(strBestKey, pindexBest != NULL ? pindexBest->GetBlockHash().GetHex() : "");
+}
+
+void CBaseIndexer::ThreadIndex()
+{
+    RenameThread(strThread.c_str());
+
+    int nUnrecorded = 0;
+    while (true)
+    {
+        const CBlockIndex* pindexNext = NULL;
+        {
+            LOCK(cs_main);
+            if (pindexBest != NULL && !chainActive.Contains(pindexBest)) {
+                // reorganized away: continue from the fork point, whose entries are still valid
+                pindexBest = chainActive.FindFork(pindexBest);
+                if (pindexBest != NULL && !LoadBlock(pindexBest))
+                    pindexBest = NULL;
+                boost::unique_lock<boost::mutex> lock(mutex);
+                pindexSynced = pindexBest;
+            }
+            pindexNext = pindexBest != NULL ? chainActive.Next(pindexBest) : chainActive.Genesis();
+        }
+
+        if (pindexNext == NULL) {
+            if (nUnrecorded > 0 && WriteProgress())
+                nUnrecorded = 0;
+
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (!fCaughtUp) {
+                LogPrintf("%s: %s index caught up with the active chain\n", __func__, strName);
+                fCaughtUp = true;
+            }
+            while (!fTipChanged && !fStop)
+                condition.wait(lock);
+            if (fStop)
+                break;
+            fTipChanged = false;
+            continue;
+        }
+
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fStop)
+                break;
+        }
+
+        if (!WriteBlock(pindexNext)) {
+            LogPrintf("%s: stopping the node, the %s index can not be written\n", __func__, strName);
+            StartShutdown();
+            {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                fStop = true;
+            }
+            condition.notify_all();
+            break;
+        }
+        pindexBest = pindexNext;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            pindexSynced = pindexBest;
+        }
+        condition.notify_all();
+
+        if (++nUnrecorded >= INDEXER_PROGRESS_BLOCKS && WriteProgress())
+            nUnrecorded = 0;
+    }
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEXER_H
+#define BITCOIN_INDEXER_H
+
+#include "validationinterface.h"
+
+#include <string>
+
+#include <boost/thread.hpp>
+
+class CBlockIndex;
+
+/**
+ * Builds an index in a background thread, following the active chain from the last block it
+ * indexed, so that block connection does not wait for it and the index can be enabled on a node
+ * with a synced chain, without a reindex.
+ *
+ * The entries are by block, and are still valid when their block is reorganized away: the block
+ * the index is synced to is kept in the block database, and just moved back to the fork point on
+ * reorganizations.
+ */
+class CBaseIndexer : public CValidationInterface
+{
+public:
+    virtual ~CBaseIndexer() {}
+
+    void Start();
+    //! To be called by the destructor of the derived class, the thread calls its methods
+    void Stop();
+
+    //! false until the index reaches the tip of the active chain the first time
+    bool IsCaughtUp();
+
+    //! Wait for the index to have the blocks of the active chain up to its current tip, not holding cs_main
+    void SyncWithTip();
+
+protected:
+    /**
+     * @param strNameIn     the name of the index, for the log
+     * @param strBestKeyIn  the block database string holding the hash of the last block of the index
+     * @param strThreadIn   the name of the indexer thread
+     */
+    CBaseIndexer(const std::string& strNameIn, const std::string& strBestKeyIn, const std::string& strThreadIn) :
+        strName(strNameIn), strBestKey(strBestKeyIn), strThread(strThreadIn) {}
+
+    //! Forget the block the index is synced to, for it to be built from the genesis when (re)enabled
+    static bool ResetProgress(const std::string& strBestKey);
+
+    //! The block the index is synced to when no progress was ever recorded, by default none. cs_main is held
+    virtual const CBlockIndex* GetUnrecordedBest() { return nullptr; }
+
+    //! Load the state of the index at pindex, the block it is synced to; false if the index does not have it. cs_main is held
+    virtual bool LoadBlock(const CBlockIndex* pindex) = 0;
+
+    //! Index pindex, the block of the active chain after the one the index is synced to, or the genesis
+    virtual bool WriteBlock(const CBlockIndex* pindex) = 0;
+
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added) override;
+
+private:
+    CBaseIndexer(const CBaseIndexer&);
+    void operator=(const CBaseIndexer&);
+
+    void ThreadIndex();
+    bool WriteProgress();
+
+    const std::string strName;
+    const std::string strBestKey;
+    const std::string strThread;
+
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    boost::thread thread;
+    bool fStarted = false;
+    bool fStop = false;
+    bool fTipChanged = false;
+    bool fCaughtUp = false;
+    const CBlockIndex* pindexSynced = nullptr; /**< pindexBest, for the other threads */
+
+    //! The last block indexed, only accessed by the indexer thread once started
+    const CBlockIndex* pindexBest = nullptr;
+};
+
+#endif // BITCOIN_INDEXER_H
@@ -9,14 +9,17 @@
 
 #include "init.h"
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "addrman.h"
 #include "amount.h"
 #ifdef ENABLE_MINING
 #include "base58.h"
 #endif
+#include "blockcache.h"
 #include "checkpoints.h"
 #include "compat/sanity.h"
 #include "consensus/validation.h"
+#include "headercache.h"
 #include "httpserver.h"
 #include "httprpc.h"
 #include "key.h"
@@ -24,16 +27,24 @@
 #include "metrics.h"
 #include "miner.h"
 #include "net.h"
+#include "netcapture.h"
 #include "rpc/server.h"
+#include "script/sigcache.h"
 #include "script/standard.h"
+#include "support/largepages.h"
 #include "scheduler.h"
+#include "timestampindexer.h"
+#include "blockfilterindexer.h"
+#include "scactivityindexer.h"
 #include "txdb.h"
+#include "txreconciliation.h"
 #include "torcontrol.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "utilmoneystr.h"
 #include "validationinterface.h"
 #ifdef ENABLE_WALLET
+#include "wallet/asyncjoinsplitproofs.h"
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 #endif
@@ -54,6 +65,7 @@
 #include <boost/thread.hpp>
 #include <openssl/crypto.h>
 
+#include <libsnark/common/parallel.hpp>
 #include <libsnark/common/profiling.hpp>
 
 #if ENABLE_ZMQ
@@ -69,15 +81,21 @@
 #include <zen/forks/fork2_replayprotectionfork.h>
 
 #include "sc/asyncproofverifier.h"
+#include "sc/proofcache.h"
+#include "sc/proofverifierpool.h"
 
 using namespace std;
 
 ZCJoinSplit* pzcashParams = NULL;
+//! Loads the Zcash circuit parameters while the block databases are opened
+static boost::thread threadZCLoadParams;
 
 #ifdef ENABLE_WALLET
 CWallet* pwalletMain = NULL;
+std::vector<CWallet*> vpwallets;
 #endif
 bool fFeeEstimatesInitialized = false;
+static bool fDumpMempoolLater = false;
 
 #if ENABLE_ZMQ
 static CZMQNotificationInterface* pzmqNotificationInterface = NULL;
@@ -164,7 +182,6 @@ public:
     // Writes do not need similar protection, as failure to write is handled by the caller.
 };
 
-static CCoinsViewDB *pcoinsdbview = NULL;
 static CCoinsViewErrorCatcher *pcoinscatcher = NULL;
 static boost::scoped_ptr<ECCVerifyHandle> globalVerifyHandle;
 
@@ -192,15 +209,18 @@ void Shutdown()
     /// module was initialized.
     RenameThread("horizen-shutoff");
     mempool.AddTransactionsUpdated(1);
+    // the scheduler is no longer serviced
+    mempool.SetNotifyScheduler(nullptr);
 
     StopWsServer();
     StopHTTPRPC();
     StopREST();
+    StopHTTPMetrics();
     StopRPC();
     StopHTTPServer();
 #ifdef ENABLE_WALLET
-    if (pwalletMain)
-        pwalletMain->Flush(false);
+    for (CWallet* pwallet : vpwallets)
+        pwallet->Flush(false);
 #endif
 #ifdef ENABLE_MINING
  #ifdef ENABLE_WALLET
@@ -210,8 +230,18 @@ void Shutdown()
  #endif
 #endif
     StopNode();
+    messageCapture.Close();
     StopTorControl();
     UnregisterNodeSignals(GetNodeSignals());
+    CScProofVerifierPool::GetInstance().Stop();
+    // the notifiers read blocks from disk, what is queued for them is delivered before the databases are closed
+    StopValidationInterfaceQueue();
+
+    if (fDumpMempoolLater && GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL))
+    {
+        DumpMempool();
+        fDumpMempoolLater = false;
+    }
 
     if (fFeeEstimatesInitialized)
     {
@@ -224,6 +254,22 @@ void Shutdown()
         fFeeEstimatesInitialized = false;
     }
 
+    if (pTimestampIndexer != NULL) {
+        pTimestampIndexer->Stop();
+        delete pTimestampIndexer;
+        pTimestampIndexer = NULL;
+    }
+    if (pBlockFilterIndexer != NULL) {
+        pBlockFilterIndexer->Stop();
+        delete pBlockFilterIndexer;
+        pBlockFilterIndexer = NULL;
+    }
+    if (pScActivityIndexer != NULL) {
+        pScActivityIndexer->Stop();
+        delete pScActivityIndexer;
+        pScActivityIndexer = NULL;
+    }
+
     {
         LOCK(cs_main);
         if (pcoinsTip != NULL) {
@@ -239,8 +285,8 @@ void Shutdown()
         pblocktree = NULL;
     }
 #ifdef ENABLE_WALLET
-    if (pwalletMain)
-        pwalletMain->Flush(true);
+    for (CWallet* pwallet : vpwallets)
+        pwallet->Flush(true);
 #endif
 
 #if ENABLE_ZMQ
@@ -268,9 +314,13 @@ void Shutdown()
 #endif
     UnregisterAllValidationInterfaces();
 #ifdef ENABLE_WALLET
-    delete pwalletMain;
+    for (CWallet* pwallet : vpwallets)
+        delete pwallet;
+    vpwallets.clear();
     pwalletMain = NULL;
 #endif
+    if (threadZCLoadParams.joinable())
+        threadZCLoadParams.join();
     delete pzcashParams;
     pzcashParams = NULL;
     globalVerifyHandle.reset();
@@ -341,9 +391,15 @@ std::string HelpMessage(HelpMessageMode mode)
     string strUsage = HelpMessageGroup(_("Options:"));
     strUsage += HelpMessageOpt("-?", _("This help message"));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>", _("Execute command when a relevant internal alert is risen or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-assumevalidsc=<hex>", _("If this block is in the chain, assume that it and its ancestors carry valid sidechain certificate and CSW proofs, and skip their verification (all the other checks are still performed)"));
+    strUsage += HelpMessageOpt("-blockconnectstats=<n>", strprintf(_("Keep the time spent on each stage of connecting the last <n> blocks, for getblockconnectstats, 0 to disable (default: %u)"), DEFAULT_BLOCK_CONNECT_STATS));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>", _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
-    strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), 288));
-    strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), 3));
+    strUsage += HelpMessageOpt("-checkblockindexpow", strprintf(_("Check the proof of work of every block index entry when loading it at startup, 0 trusts the local block index for faster restarts (default: %u)"), DEFAULT_CHECKBLOCKINDEXPOW));
+    strUsage += HelpMessageOpt("-checkblocks=<n>", strprintf(_("How many blocks to check at startup (default: %u, 0 = all)"), DEFAULT_CHECKBLOCKS));
+    strUsage += HelpMessageOpt("-checkblocksbackground", strprintf(_("Check the levels 3 and 4 of -checklevel in the background once the node is up, instead of at startup (default: %u)"), DEFAULT_CHECKBLOCKS_BACKGROUND));
+    strUsage += HelpMessageOpt("-checkblocksseconds=<n>", strprintf(_("Stop checking the blocks at startup after <n> seconds, checking fewer than -checkblocks (default: %u, 0 = no limit)"), DEFAULT_CHECKBLOCKS_SECONDS));
+    strUsage += HelpMessageOpt("-checklevel=<n>", strprintf(_("How thorough the block verification of -checkblocks is (0-4, default: %u)"), DEFAULT_CHECKLEVEL));
+    strUsage += HelpMessageOpt("-compressblockfiles", strprintf(_("Write the blocks and undo data compressed to the block and undo files, which previous versions can't read (default: %u)"), DEFAULT_COMPRESS_BLOCK_FILES));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), "zen.conf"));
     if (mode == HMM_BITCOIND)
     {
@@ -355,18 +411,53 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-disabledeprecation=<version>", strprintf(_("Disable block-height node deprecation and automatic shutdown (example: -disabledeprecation=%s)"),
         FormatVersion(CLIENT_VERSION)));
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
-    strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-asynccoinsflush", strprintf(_("Write the coins cache to the database in a background thread, without holding up validation (default: %u)"), DEFAULT_ASYNC_COINS_FLUSH));
+    strUsage += HelpMessageOpt("-coinscommitment", strprintf(_("Keep the statistics and the hash of the unspent outputs set up to date as blocks are connected, so that gettxoutsetinfo does not scan the database (default: %u)"), DEFAULT_COINS_COMMITMENT));
+    strUsage += HelpMessageOpt("-coinsprefetchthreads=<n>", strprintf(_("Set the number of threads reading in parallel the inputs of a block from the coins database before connecting it (0 to %d, 0 = off, default: %d)"),
+        MAX_COINS_PREFETCH_THREADS, DEFAULT_COINS_PREFETCH_THREADS));
+    strUsage += HelpMessageOpt("-cswnullifierfilter", strprintf(_("Keep an in-memory bloom filter of the spent CSW nullifiers, to avoid database lookups for the unspent ones (default: %u)"), DEFAULT_CSW_NULLIFIER_FILTER));
+    strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d), or auto for a quarter of the available memory, "
+        "the coins cache then being written without being emptied and losing only its least used entries"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dbwritebuffer=<n>", strprintf(_("Write buffer size in megabytes of the block index and of the chain state LevelDBs, 0 for a quarter of their cache (default: %u)"), DEFAULT_DB_WRITE_BUFFER));
+    strUsage += HelpMessageOpt("-dbl0compactiontrigger=<n>", strprintf(_("Compact the level-0 tables of the LevelDBs once they are <n> (default: %u)"), DEFAULT_DB_L0_COMPACTION_TRIGGER));
+    strUsage += HelpMessageOpt("-dbl0slowdowntrigger=<n>", strprintf(_("Slow down the writes to a LevelDB having <n> level-0 tables, at least -dbl0compactiontrigger (default: %u)"), DEFAULT_DB_L0_SLOWDOWN_TRIGGER));
+    strUsage += HelpMessageOpt("-dbl0stoptrigger=<n>", strprintf(_("Stop the writes to a LevelDB having <n> level-0 tables until they are compacted, at least -dbl0slowdowntrigger (default: %u)"), DEFAULT_DB_L0_STOP_TRIGGER));
+    strUsage += HelpMessageOpt("-dbsubcompactions=<n>", strprintf(_("Split a compaction of the LevelDBs into up to <n> threads compacting ranges of the keys concurrently (1 to %d, default: %d)"), MAX_DB_SUBCOMPACTIONS, DEFAULT_DB_SUBCOMPACTIONS));
+    strUsage += HelpMessageOpt("-blockcachesize=<n>", strprintf(_("Keep at most <n> MiB of recent blocks in memory, deserialized and serialized, for the peers, the notifiers, the websocket, REST and the RPCs asking for them (default: %u)"), DEFAULT_BLOCK_CACHE_SIZE));
+    strUsage += HelpMessageOpt("-headercachesize=<n>", strprintf(_("Keep at most <n> MiB of serialized block headers in memory, for the headers requests of the peers, the websocket, REST and getblockheader (default: %u)"), DEFAULT_HEADER_CACHE_SIZE));
+    strUsage += HelpMessageOpt("-heightbucketcoins", _("Store the outputs of the per-output coins database under the bucket of their creation height, for the outputs of the recent blocks to be close to each other, "
+            "converting it on startup if needed (implies -pertxoutcoins). Warning: Reverting this setting requires -reindex"));
+    strUsage += HelpMessageOpt("-largepages=<mode>", _("Back the in-memory UTXO set and the signature caches with huge pages on the NUMA node of the validation thread: "
+        "off, transparent, or explicit to use the huge pages reserved in vm.nr_hugepages first (default: off)"));
+    strUsage += HelpMessageOpt("-limitancestorcount=<n>", strprintf(_("Do not accept transactions if the number of their in-mempool ancestors is <n> or more (default: %u, 0 = no limit)"), DEFAULT_ANCESTOR_LIMIT));
+    strUsage += HelpMessageOpt("-limitancestorsize=<n>", strprintf(_("Do not accept transactions whose size with all in-mempool ancestors exceeds <n> kilobytes (default: %u, 0 = no limit)"), DEFAULT_ANCESTOR_SIZE_LIMIT));
+    strUsage += HelpMessageOpt("-limitdescendantcount=<n>", strprintf(_("Do not accept transactions if any ancestor would have <n> or more in-mempool descendants (default: %u, 0 = no limit)"), DEFAULT_DESCENDANT_LIMIT));
+    strUsage += HelpMessageOpt("-limitdescendantsize=<n>", strprintf(_("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u, 0 = no limit)"), DEFAULT_DESCENDANT_SIZE_LIMIT));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-maxorphanpeersize=<n>", strprintf(_("Keep at most <n> kilobytes of unconnectable transactions from a single peer in memory (default: %u)"), DEFAULT_MAX_ORPHAN_PEER_SIZE));
+    strUsage += HelpMessageOpt("-maxorphanpoolsize=<n>", strprintf(_("Keep at most <n> kilobytes of unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_POOL_SIZE));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
+    strUsage += HelpMessageOpt("-mapblockfiles", strprintf(_("Read the block and undo files no longer written to through read-only memory mappings (default: %u)"), DEFAULT_MAP_BLOCK_FILES));
+    strUsage += HelpMessageOpt("-maxmempool=<n>", strprintf(_("Keep the transaction memory pool below <n> megabytes, evicting the packages with the lowest fee rate (default: %u, 0 = no limit)"), DEFAULT_MAX_MEMPOOL_SIZE));
+    strUsage += HelpMessageOpt("-mempoolexpiry=<n>", strprintf(_("Do not keep transactions and certificates in the mempool longer than <n> hours (default: %u, 0 = no expiry)"), DEFAULT_MEMPOOL_EXPIRY));
     strUsage += HelpMessageOpt("-mempooltxinputlimit=<n>", _("Set the maximum number of transparent inputs in a transaction that the mempool will accept (default: 0 = no limit applied)"));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-sigverifywindow=<n>", strprintf(_("Set the window size of the tables precomputed at startup for the signature verification (%d to %d, 0 = built-in, default: %d). "
+            "Larger windows verify faster if the tables fit in the CPU caches, they take 2^(n-2)*128 bytes"),
+        MIN_SIG_VERIFY_WINDOW, MAX_SIG_VERIFY_WINDOW, DEFAULT_SIG_VERIFY_WINDOW));
+    strUsage += HelpMessageOpt("-pertxoutcoins", _("Store the coins database with one record per unspent output, converting it on startup if needed. "
+            "Warning: Reverting this setting requires -reindex"));
+    strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), "zend.pid"));
 #endif
     strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by pruning (deleting) old blocks. This mode disables wallet support and is incompatible with -txindex. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, >%u = target size in MiB to use for block files)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
+    strUsage += HelpMessageOpt("-proverthreads=<n>", strprintf(_("Set the number of threads computing the multi-exponentiations and FFTs of the libsnark JoinSplit proofs "
+        "(0 = auto, <0 = leave that many cores free, default: %d)"), DEFAULT_PROVER_THREADS));
+    strUsage += HelpMessageOpt("-reorgcachesize=<n>", strprintf(_("Keep the last <n> blocks connected in memory with their undo data, so that the short reorgs disconnect them without reading from disk, 0 to disable (default: %u)"), DEFAULT_REORG_CACHE_SIZE));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild block chain index from current blk000??.dat files on startup"));
     strUsage += HelpMessageOpt("-reindexfast", _("Rebuild block chain index from current blk000??.dat files on startup, skipping expensive checks for blocks below checkpoints. It is incompatible with reindex"));
     #if !defined(WIN32)
@@ -376,8 +467,15 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maturityheightindex", strprintf(_("Maintain a maturity height index that stores for every height the cerficates that became mature, used by the getblockexpanded rpc call. It requires -txindex (default: %u)"), DEFAULT_MATURITYHEIGHTINDEX));
 
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
-    strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
+    strUsage += HelpMessageOpt("-addressindexthreads=<n>", strprintf(_("Look up the addresses of an address index rpc call with up to <n> threads at once (1 to %d, default: %d)"), MAX_ADDRESSINDEX_THREADS, DEFAULT_ADDRESSINDEX_THREADS));
+    strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps, built in the background (default: %u)"), DEFAULT_TIMESTAMPINDEX));
+    strUsage += HelpMessageOpt("-scindex", strprintf(_("Maintain the index of the forward transfers, backward transfer requests, ceased sidechain withdrawals and certificates of each sidechain, used by getscactivity, built in the background and incompatible with -prune (default: %u)"), DEFAULT_SCINDEX));
+    strUsage += HelpMessageOpt("-blockfilterindex", strprintf(_("Maintain the index of the compact filters of the blocks (BIP 158), with the sidechain ids and the ceased sidechain withdrawal nullifiers, built in the background and incompatible with -prune (default: %u)"), DEFAULT_BLOCKFILTERINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-separateindexdbs", strprintf(_("Keep each of the above indexes in a LevelDB of its own under blocks/indexes, chosen when the block index is created and so requiring -reindex for an existing one (default: %u)"), DEFAULT_SEPARATE_INDEX_DBS));
+    strUsage += HelpMessageOpt("-indexdbcache=<n>", strprintf(_("Cache size in megabytes of each separate index LevelDB (default: %u)"), DEFAULT_INDEX_DB_CACHE));
+    strUsage += HelpMessageOpt("-indexdbwritebuffer=<n>", strprintf(_("Write buffer size in megabytes of each separate index LevelDB, 0 for a quarter of its cache (default: %u)"), DEFAULT_INDEX_DB_WRITE_BUFFER));
+    strUsage += HelpMessageOpt("-asyncindexwrites", strprintf(_("Write the above indexes in a background thread, letting them lag behind the chain tip until read (default: %u)"), DEFAULT_ASYNC_INDEX_WRITES));
 
     strUsage += HelpMessageOpt("-blocktreedbmaxopenfiles", strprintf(_("Maximum number of open files for the Block Tree LevelDB (default: %u)"), DEFAULT_DB_MAX_OPEN_FILES));
     strUsage += HelpMessageOpt("-coinsviewdbmaxopenfiles", strprintf(_("Maximum number of open files for the Coins View LevelDB (default: %u)"), DEFAULT_DB_MAX_OPEN_FILES));
@@ -387,25 +485,38 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-banscore=<n>", strprintf(_("Threshold for disconnecting misbehaving peers (default: %u)"), 100));
     strUsage += HelpMessageOpt("-bantime=<n>", strprintf(_("Number of seconds to keep misbehaving peers from reconnecting (default: %u)"), 86400));
     strUsage += HelpMessageOpt("-bind=<addr>", _("Bind to given address and always listen on it. Use [host]:port notation for IPv6"));
+    strUsage += HelpMessageOpt("-capturemessages=<file>", _("Record the messages received from the peers to <file>, relative to the data directory, for replaymessages"));
+    strUsage += HelpMessageOpt("-compactblockhbpeer=<netmask>", _("Ask the peers from the given netmask or IP address to announce their new blocks as compact blocks. Can be specified multiple times."));
+    strUsage += HelpMessageOpt("-compactblockhbpeers=<n>", strprintf(_("Number of other peers, among the first to give us new blocks, asked to announce their new blocks as compact blocks (default: %u)"),
+                               DEFAULT_MAX_COMPACT_BLOCK_HB_PEERS));
+    strUsage += HelpMessageOpt("-compactblocks", strprintf(_("Relay blocks as compact blocks, made of the short ids of their transactions and certificates (default: %u)"), DEFAULT_COMPACT_BLOCKS));
     strUsage += HelpMessageOpt("-connect=<ip>", _("Connect only to the specified node(s)"));
     strUsage += HelpMessageOpt("-discover", _("Discover own IP addresses (default: 1 when listening and no -externalip or -proxy)"));
     strUsage += HelpMessageOpt("-dns", _("Allow DNS lookups for -addnode, -seednode and -connect") + " " + _("(default: 1)"));
     strUsage += HelpMessageOpt("-dnsseed", _("Query for peer addresses via DNS lookup, if low on addresses (default: 1 unless -connect)"));
     strUsage += HelpMessageOpt("-externalip=<ip>", _("Specify your own public address"));
     strUsage += HelpMessageOpt("-forcednsseed", strprintf(_("Always query for peer addresses via DNS lookup (default: %u)"), 0));
+    strUsage += HelpMessageOpt("-headerssyncpeers=<n>", strprintf(_("Number of other peers the headers between the checkpoints are downloaded from in parallel, during the initial sync (default: %u, 0 to disable)"),
+                               DEFAULT_HEADERS_SYNC_PEERS));
     strUsage += HelpMessageOpt("-listen", _("Accept connections from outside (default: 1 if no -proxy or -connect)"));
     strUsage += HelpMessageOpt("-listenonion", strprintf(_("Automatically create Tor hidden service (default: %d)"), DEFAULT_LISTEN_ONION));
     strUsage += HelpMessageOpt("-maxconnections=<n>", strprintf(_("Maintain at most <n> connections to peers (default: %u)"), DEFAULT_MAX_PEER_CONNECTIONS));
     strUsage += HelpMessageOpt("-maxreceivebuffer=<n>", strprintf(_("Maximum per-connection receive buffer, <n>*1000 bytes (default: %u)"), 5000));
     strUsage += HelpMessageOpt("-maxsendbuffer=<n>", strprintf(_("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)"), 1000));
+    strUsage += HelpMessageOpt("-maxrelaymemory=<n>", strprintf(_("Keep at most <n> megabytes of the relayed transactions for the requests of the peers, besides the mempool (default: %u)"), DEFAULT_MAX_RELAY_MEMORY));
+    strUsage += HelpMessageOpt("-msghandthreads=<n>", strprintf(_("Number of threads processing the messages of the peers, each peer being served by one at a time (1 to %d, default: %d)"),
+        MAX_MESSAGE_HANDLER_THREADS, DEFAULT_MESSAGE_HANDLER_THREADS));
     strUsage += HelpMessageOpt("-onion=<ip:port>", strprintf(_("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: %s)"), "-proxy"));
     strUsage += HelpMessageOpt("-onlynet=<net>", _("Only connect to nodes in network <net> (ipv4, ipv6 or onion)"));
+    strUsage += HelpMessageOpt("-peerblockfilters", strprintf(_("Serve the compact block filters to peers (BIP 157), it requires -blockfilterindex (default: %u)"), DEFAULT_PEERBLOCKFILTERS));
     strUsage += HelpMessageOpt("-permitbaremultisig", strprintf(_("Relay non-P2SH multisig (default: %u)"), 1));
     strUsage += HelpMessageOpt("-port=<port>", strprintf(_("Listen for connections on <port> (default: %u or testnet: %u)"), 9033, 19033));
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), 1));
+    strUsage += HelpMessageOpt("-reconfloodpeers=<n>", strprintf(_("With -txreconciliation, number of outbound peers the transactions are still announced to straight away (default: %u)"), DEFAULT_RECON_FLOOD_PEERS));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
+    strUsage += HelpMessageOpt("-txreconciliation", strprintf(_("Reconcile the transactions and certificates to announce with the peers supporting it, rather than announcing each of them (default: %u)"), DEFAULT_TXRECONCILIATION));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
     strUsage += HelpMessageOpt("-tlsfallbacknontls=<0 or 1>", _("If a TLS connection fails, the next connection attempt of the same peer (based on IP address) takes place without TLS (default: 1)"));
@@ -417,6 +528,9 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-websocket=<0 or 1>", _("If set to 1 opens a websocket channel listening for client connections (default: 0)"));
     strUsage += HelpMessageOpt("-wsaddress=<ip address>", _("If websocket=1, listen for ws connections at this ip address (default: 127.0.0.1)"));
     strUsage += HelpMessageOpt("-wsport=<port>", _("If websocket=1, listen for ws connections at <wsaddress>:<wsport> (default: 8888)"));
+    strUsage += HelpMessageOpt("-wsthreads=<n>", strprintf(_("If websocket=1, number of threads serving the ws connections (default: %d)"), DEFAULT_WS_THREADS));
+    strUsage += HelpMessageOpt("-wsmaxqueuebytes=<n>", strprintf(_("If websocket=1, bytes waiting to be sent to a ws connection at most before it is handled as slow (default: %u)"), DEFAULT_WS_MAX_QUEUE_BYTES));
+    strUsage += HelpMessageOpt("-wsslowclients=<policy>", strprintf(_("If websocket=1, what happens to a slow ws connection: disconnect it, or drop its events (disconnect|drop, default: %s)"), DEFAULT_WS_SLOW_CLIENTS));
 #ifdef USE_UPNP
 #if USE_UPNP
     strUsage += HelpMessageOpt("-upnp", _("Use UPnP to map the listening port (default: 1 when listening and no -proxy)"));
@@ -431,6 +545,7 @@ std::string HelpMessage(HelpMessageMode mode)
 #ifdef ENABLE_WALLET
     strUsage += HelpMessageGroup(_("Wallet options:"));
     strUsage += HelpMessageOpt("-disablewallet", _("Do not load the wallet and disable wallet RPC calls"));
+    strUsage += HelpMessageOpt("-joinsplitproofthreads=<n>", strprintf(_("Set the number of joinsplit proofs generated at the same time by z_sendmany and z_mergetoaddress (0 = as many as the cores, default: %d)"), DEFAULT_JOINSPLIT_PROOF_THREADS));
     strUsage += HelpMessageOpt("-keypool=<n>", strprintf(_("Set key pool size to <n> (default: %u)"), 100));
     if (showDebug)
         strUsage += HelpMessageOpt("-mintxfee=<amt>", strprintf("Fees (in %s/kB) smaller than this are considered zero fee for transaction creation (default: %s)",
@@ -438,6 +553,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-paytxfee=<amt>", strprintf(_("Fee (in %s/kB) to add to transactions you send (default: %s)"),
         CURRENCY_UNIT, FormatMoney(payTxFee.GetFeePerK())));
     strUsage += HelpMessageOpt("-rescan", _("Rescan the block chain for missing wallet transactions") + " " + _("on startup"));
+    strUsage += HelpMessageOpt("-rescanthreads=<n>", strprintf(_("Set the number of threads reading the blocks and trying to decrypt their notes during the rescans (0 = as many as the cores, default: %d)"), DEFAULT_RESCAN_THREADS));
     strUsage += HelpMessageOpt("-salvagewallet", _("Attempt to recover private keys from a corrupt wallet.dat") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-sendfreetransactions", strprintf(_("Send transactions as zero-fee transactions if possible (default: %u)"), 0));
     strUsage += HelpMessageOpt("-spendzeroconfchange", strprintf(_("Spend unconfirmed change when sending transactions (default: %u)"), 1));
@@ -445,7 +561,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-maxtxfee=<amt>", strprintf(_("Maximum total fees (in %s) to use in a single wallet transaction; setting this too low may abort large transactions (default: %s)"),
         CURRENCY_UNIT, FormatMoney(maxTxFee)));
     strUsage += HelpMessageOpt("-upgradewallet", _("Upgrade wallet to latest format") + " " + _("on startup"));
-    strUsage += HelpMessageOpt("-wallet=<file>", _("Specify wallet file (within data directory)") + " " + strprintf(_("(default: %s)"), "wallet.dat"));
+    strUsage += HelpMessageOpt("-wallet=<file>", _("Specify wallet file (within data directory)") + " " + strprintf(_("(default: %s)"), "wallet.dat") + ". " +
+        _("Can be used multiple times to load multiple wallets, each with its own lock: the RPC calls sent to /wallet/<file> are for the wallet of <file>, the others for the first one"));
     strUsage += HelpMessageOpt("-walletbroadcast", _("Make the wallet broadcast transactions") + " " + strprintf(_("(default: %u)"), true));
     strUsage += HelpMessageOpt("-walletnotify=<cmd>", _("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)"));
     strUsage += HelpMessageOpt("-zapwallettxes=<mode>", _("Delete all wallet transactions and only recover those parts of the blockchain through -rescan on startup") +
@@ -458,6 +575,10 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubhashcert=<address>", _("Enable publish hash certificate in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubrawcert=<address>", _("Enable publish raw certificate in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubscevent=<address>", _("Enable publish sidechain events (maturing, ceasing, top quality certificate changes) in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubsequence=<address>", _("Enable publish mempool changes and block connections, with the mempool sequence, in <address>"));
 #endif
 
 #if ENABLE_PROTON
@@ -466,6 +587,11 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-amqppubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-amqppubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-amqppubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-amqppubhashcert=<address>", _("Enable publish hash certificate in <address>"));
+    strUsage += HelpMessageOpt("-amqppubrawcert=<address>", _("Enable publish raw certificate in <address>"));
+    strUsage += HelpMessageOpt("-amqppubscevent=<address>", _("Enable publish sidechain events (maturing, ceasing, top quality certificate changes) in <address>"));
+    strUsage += HelpMessageOpt("-amqpmaxqueued=<n>", strprintf(_("Keep at most <n> messages per address waiting for the broker (default: %u)"), DEFAULT_AMQP_MAX_QUEUED));
+    strUsage += HelpMessageOpt("-amqpdropnewest", _("When the messages waiting for the broker are too many, drop the new ones rather than the oldest (default: 0)"));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -479,13 +605,15 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-fuzzmessagestest=<n>", "Randomly fuzz 1 of every <n> network messages");
         strUsage += HelpMessageOpt("-flushwallet", strprintf("Run a thread to flush wallet periodically (default: %u)", 1));
         strUsage += HelpMessageOpt("-stopafterblockimport", strprintf("Stop running after importing blocks from disk (default: %u)", 0));
+        strUsage += HelpMessageOpt("-unsafeloadtxoutset", strprintf("Allow loadtxoutset outside -regtest mode, trusting the snapshot without ever validating the chain up to it (default: %u)", 0));
     }
-    string debugCategories = "addrman, alert, bench, cert, coindb, db, estimatefee, fork, http, libevent, lock, mempool, net, partitioncheck, pow, proxy, prune, "
+    string debugCategories = "addrman, alert, bench, cert, cmpctblock, coindb, db, estimatefee, fork, http, libevent, lock, mempool, net, partitioncheck, pow, proxy, prune, "
                              "rand, reindex, rpc, sc, selectcoins, tor, ws, zendoo_mc_cryptolib, zmq, zrpc, zrpcunsafe (implies zrpc)"; // Don't translate these
     strUsage += HelpMessageOpt("-debug=<category>", strprintf(_("Output debugging information (default: %u, supplying <category> is optional)"), 0) + ". " +
         _("If <category> is not supplied or if <category> = 1, output all debugging information.") + " " + _("<category> can be:") + " " + debugCategories + ".");
     strUsage += HelpMessageOpt("-experimentalfeatures", _("Enable use of experimental features"));
     strUsage += HelpMessageOpt("-help-debug", _("Show all debugging options (usage: --help -help-debug)"));
+    strUsage += HelpMessageOpt("-lockprofile", strprintf(_("Record how long each lock site waits for its lock and holds it, for getlockstats (default: %u)"), 0));
     strUsage += HelpMessageOpt("-logips", strprintf(_("Include IP addresses in debug output (default: %u)"), 0));
     strUsage += HelpMessageOpt("-logtimestamps", strprintf(_("Prepend debug output with timestamp (default: %u)"), 1));
     strUsage += HelpMessageOpt("-logtimemicros", strprintf(_("Meaningful if -logtimestamps=1. In debug output timestamp reports microseconds (default: %u)"), 0));
@@ -493,7 +621,8 @@ std::string HelpMessage(HelpMessageMode mode)
     {
         strUsage += HelpMessageOpt("-limitfreerelay=<n>", strprintf("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default: %u)", 15));
         strUsage += HelpMessageOpt("-relaypriority", strprintf("Require high priority for relaying free or low-fee transactions (default: %u)", 0));
-        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit size of signature cache to <n> entries (default: %u)", 50000));
+        strUsage += HelpMessageOpt("-maxsigcachesize=<n>", strprintf("Limit the sum of the signature cache and the script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_SIZE));
+        strUsage += HelpMessageOpt("-maxproofcachesize=<n>", strprintf("Limit size of the verified sidechain proof cache to <n> entries (default: %u)", CScProofVerificationCache::DEFAULT_MAX_SIZE));
     }
     strUsage += HelpMessageOpt("-minrelaytxfee=<amt>", strprintf(_("Fees (in %s/kB) smaller than this are considered zero fee for relaying (default: %s)"),
         CURRENCY_UNIT, FormatMoney(::minRelayTxFee.GetFeePerK())));
@@ -519,6 +648,8 @@ std::string HelpMessage(HelpMessageMode mode)
     
     strUsage += HelpMessageOpt("-blocktxpartitionmaxsize=<n> (regtest only)", strprintf(_("Set maximum partition block size for transcations in bytes (default: %u)"), DEFAULT_BLOCK_TX_PART_MAX_SIZE));
 
+    strUsage += HelpMessageOpt("-blocktemplatefeegain=<amt>", strprintf(_("Wake up getblocktemplate long polls and announce a new block template once the mempool gathered this many fees (in %s) since the latest template, 0 to only do it on new blocks (default: %s)"),
+        CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_TEMPLATE_FEE_GAIN)));
     strUsage += HelpMessageOpt("-blockprioritysize=<n>", strprintf(_("Set maximum size of high-priority/low-fee transactions/certificates in bytes (default: %d)"), DEFAULT_BLOCK_PRIORITY_SIZE));
     strUsage += HelpMessageOpt("-blockmaxcomplexity=<n>",
         strprintf(_("Limit transactions to be included into blocks based on block complexity. "
@@ -533,7 +664,21 @@ std::string HelpMessage(HelpMessageMode mode)
         strprintf(_("The maximum delay in milliseconds between sc proof batch verification requests. (default: %d)"), CScAsyncProofVerifier::BATCH_VERIFICATION_MAX_DELAY));
 
     strUsage += HelpMessageOpt("-scproofqueuesize=<size>",
-        strprintf(_("The threshold size of the sc proof queue that triggers a call to the batch verification. (default: %d)"), CScAsyncProofVerifier::BATCH_VERIFICATION_MAX_SIZE));
+        strprintf(_("The threshold size of the sc proof queue that triggers a call to the batch verification, it also bounds the number of proofs verified by each batch: top quality certificates and then proofs with the highest fee rate are verified first (0 = no bound, default: %d)"), CScAsyncProofVerifier::BATCH_VERIFICATION_MAX_SIZE));
+
+    strUsage += HelpMessageOpt("-scspeculativeproofverification",
+        strprintf(_("Verify the sc proofs of blocks received but not connected yet, so that their connection is faster (default: %u)"), 1));
+
+    strUsage += HelpMessageOpt("-scproofverificationthreads=<n>",
+        strprintf(_("The number of threads verifying sc proofs in parallel, proofs are split by proving system and verification key (1-%d, default: %d)"),
+            CScProofVerifierPool::MAX_NUMBER_OF_THREADS, CScProofVerifierPool::DEFAULT_NUMBER_OF_THREADS));
+
+    strUsage += HelpMessageOpt("-scproofverificationreservedthreads=<n>",
+        _("The number of sc proof verification threads reserved to the validation of blocks, used only if -scproofverificationthreads is greater than 1 (default: 1)"));
+
+    strUsage += HelpMessageOpt("-scproofverificationtargetlatency=<time>",
+        _("Enable the adaptive sc proof batch verification: batch size and delay are chosen from the observed proof arrival rate and verification time "
+          "to keep the latency of each proof under <time> milliseconds, -scproofverificationdelay being the maximum delay. (default: 0, disabled)"));
 
     strUsage += HelpMessageOpt("-cbhsafedepth=<n>",
         "regtest only - Set safe depth for skipping checkblockatheight in txout scripts (default depends on regtest/testnet params)");
@@ -583,11 +728,14 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
     strUsage += HelpMessageOpt("-rest", strprintf(_("Accept public REST requests (default: %u)"), 0));
+    strUsage += HelpMessageOpt("-httpmetrics", strprintf(_("Serve the node metrics in the Prometheus text format at /metrics on the RPC port, to the clients allowed by -rpcallowip (default: %u)"), 0));
     strUsage += HelpMessageOpt("-rpcbind=<addr>", _("Bind to given address to listen for JSON-RPC connections. Use [host]:port notation for IPv6. This option can be specified multiple times (default: bind to all interfaces)"));
     strUsage += HelpMessageOpt("-rpcuser=<user>", _("Username for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcpassword=<pw>", _("Password for JSON-RPC connections"));
     strUsage += HelpMessageOpt("-rpcport=<port>", strprintf(_("Listen for JSON-RPC connections on <port> (default: %u or testnet: %u)"), 8231, 18231));
     strUsage += HelpMessageOpt("-rpcallowip=<ip>", _("Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times"));
+    strUsage += HelpMessageOpt("-rpcclassthreads=<class>:<n>", _("Handle at most <n> requests to the methods of a class at once: mining, cheap, wallet or heavy (explorer lookups and REST), "
+        "in the order of their priority (default: all the threads for mining and cheap, all but one for wallet, half of them for heavy). Can be specified multiple times"));
     strUsage += HelpMessageOpt("-rpcthreads=<n>", strprintf(_("Set the number of threads to service RPC calls (default: %d)"), DEFAULT_HTTP_THREADS));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE));
@@ -595,7 +743,10 @@ std::string HelpMessage(HelpMessageMode mode)
     }
 
     // Disabled until we can lock notes and also tune performance of libsnark which by default uses multiple threads
-    //strUsage += HelpMessageOpt("-rpcasyncthreads=<n>", strprintf(_("Set the number of threads to service Async RPC calls (default: %d)"), 1));
+    strUsage += HelpMessageOpt("-rpcasyncthreads=<n>", strprintf(_("Run up to <n> async operations, like z_sendmany, at once: workers beyond the first are started while operations wait (default: %d)"), 1));
+    strUsage += HelpMessageOpt("-rpcasyncmaxresults=<n>", strprintf(_("Keep the status and result of at most <n> finished async operations, 0 for no limit (default: %u)"), DEFAULT_RPC_ASYNC_MAX_RESULTS));
+    strUsage += HelpMessageOpt("-rpcasyncresultttl=<n>", strprintf(_("Forget a finished async operation <n> seconds after it finished, 0 for never (default: %d)"), DEFAULT_RPC_ASYNC_RESULT_TTL));
+    strUsage += HelpMessageOpt("-rpcasyncresubmit", strprintf(_("Submit again at startup the async operations which had not started at shutdown, saved in asyncops.json (default: %u)"), DEFAULT_RPC_ASYNC_RESUBMIT));
 
     if (mode == HMM_BITCOIND) {
         strUsage += HelpMessageGroup(_("Metrics Options (only if -daemon and -printtoconsole are not set):"));
@@ -757,21 +908,10 @@ void ThreadImport(std::vector<boost::filesystem::path> vImportFiles)
         LogPrintf("Stopping after block import\n");
         StartShutdown();
     }
-}
 
-void ThreadNotifyRecentlyAdded()
-{
-    while (true) {
-        // Run the notifier on an integer second in the steady clock.
-        auto now = std::chrono::steady_clock::now().time_since_epoch();
-        auto nextFire = std::chrono::duration_cast<std::chrono::seconds>(
-            now + std::chrono::seconds(1));
-        std::this_thread::sleep_until(
-            std::chrono::time_point<std::chrono::steady_clock>(nextFire));
-
-        boost::this_thread::interruption_point();
-
-        mempool.NotifyRecentlyAdded();
+    if (GetBoolArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
+        LoadMempool();
+        fDumpMempoolLater = !ShutdownRequested();
     }
 }
 
@@ -852,6 +992,29 @@ static void ZC_LoadParams()
     LogPrintf("Loaded Sapling parameters in %fs seconds.\n", elapsed);
 }
 
+static void ThreadZCLoadParams()
+{
+    RenameThread("horizen-zcparams");
+    int64_t nStart = GetTimeMillis();
+    try {
+        ZC_LoadParams();
+    } catch (const std::exception& e) {
+        InitError(strprintf(_("Error loading the Horizen network parameters: %s"), e.what()));
+    }
+    LogPrintf(" zk-SNARK params %12dms\n", GetTimeMillis() - nStart);
+}
+
+/** Waits for the parameters loaded by ThreadZCLoadParams, false if they could not be loaded. */
+static bool WaitForZCParams()
+{
+    if (threadZCLoadParams.joinable()) {
+        int64_t nStart = GetTimeMillis();
+        threadZCLoadParams.join();
+        LogPrintf("Waited %dms for the zk-SNARK parameters\n", GetTimeMillis() - nStart);
+    }
+    return pzcashParams != NULL;
+}
+
 bool AppInitServers()
 {
     RPCServer::OnStopped(&OnRPCStopped);
@@ -864,6 +1027,8 @@ bool AppInitServers()
         return false;
     if (GetBoolArg("-rest", false) && !StartREST())
         return false;
+    if (GetBoolArg("-httpmetrics", false) && !StartHTTPMetrics())
+        return false;
     if (!StartHTTPServer())
         return false;
     if (GetBoolArg("-websocket", false) && !StartWsServer())
@@ -871,6 +1036,155 @@ bool AppInitServers()
     return true;
 }
 
+#ifdef ENABLE_WALLET
+/**
+ * Loads the wallet of a -wallet file, rescanning the blocks it misses, and registers it for the updates about
+ * the chain. NULL if it can not be used, with the error already reported; the errors which do not stop the
+ * startup at once are added to strErrors.
+ */
+static CWallet* OpenWalletFromFile(const std::string& strWalletFile, std::ostringstream& strErrors)
+{
+    // needed to restore wallet transaction meta data after -zapwallettxes
+    std::vector<std::shared_ptr<CWalletTransactionBase>> vWtx;
+
+    if (GetBoolArg("-zapwallettxes", false)) {
+        uiInterface.InitMessage(_("Zapping all transactions from wallet..."));
+
+        CWallet* pwalletZap = new CWallet(strWalletFile);
+        DBErrors nZapWalletRet = pwalletZap->ZapWalletTx(vWtx);
+        delete pwalletZap;
+        if (nZapWalletRet != DB_LOAD_OK) {
+            uiInterface.InitMessage(strprintf(_("Error loading %s: Wallet corrupted"), strWalletFile));
+            return NULL;
+        }
+    }
+
+    uiInterface.InitMessage(_("Loading wallet..."));
+
+    int64_t nStart = GetTimeMillis();
+    bool fFirstRun = true;
+    CWallet* pwallet = new CWallet(strWalletFile);
+    DBErrors nLoadWalletRet = pwallet->LoadWallet(fFirstRun);
+    if (nLoadWalletRet != DB_LOAD_OK)
+    {
+        if (nLoadWalletRet == DB_CORRUPT)
+            strErrors << _("Error loading wallet.dat: Wallet corrupted") << "\n";
+        else if (nLoadWalletRet == DB_NONCRITICAL_ERROR)
+        {
+            string msg(_("error reading wallet.dat! All keys read correctly, but transaction data"
+                         " or address book entries might be missing or incorrect."));
+
+            bool reindexing = false;
+            pblocktree->ReadReindexing(reindexing);
+            if (reindexing)
+            {
+                msg = string(_("(Reindexing in progress...) ")) + msg;
+            }
+            InitWarning(msg);
+        }
+        else if (nLoadWalletRet == DB_TOO_NEW)
+            strErrors << _("Error loading wallet.dat: Wallet requires newer version of Horizen") << "\n";
+        else if (nLoadWalletRet == DB_NEED_REWRITE)
+        {
+            strErrors << _("Wallet needed to be rewritten: restart Horizen to complete") << "\n";
+            LogPrintf("%s", strErrors.str());
+            delete pwallet;
+            InitError(strErrors.str());
+            return NULL;
+        }
+        else
+            strErrors << _("Error loading wallet.dat") << "\n";
+    }
+
+    if (GetBoolArg("-upgradewallet", fFirstRun))
+    {
+        int nMaxVersion = GetArg("-upgradewallet", 0);
+        if (nMaxVersion == 0) // the -upgradewallet without argument case
+        {
+            LogPrintf("Performing wallet upgrade to %i\n", FEATURE_LATEST);
+            nMaxVersion = CLIENT_VERSION;
+            pwallet->SetMinVersion(FEATURE_LATEST); // permanently upgrade the wallet immediately
+        }
+        else
+            LogPrintf("Allowing wallet upgrade up to %i\n", nMaxVersion);
+        if (nMaxVersion < pwallet->GetVersion())
+            strErrors << _("Cannot downgrade wallet") << "\n";
+        pwallet->SetMaxVersion(nMaxVersion);
+    }
+
+    if (fFirstRun)
+    {
+        // Create new keyUser and set as default key
+        CPubKey newDefaultKey;
+        if (pwallet->GetKeyFromPool(newDefaultKey)) {
+            pwallet->SetDefaultKey(newDefaultKey);
+            if (!pwallet->SetAddressBook(pwallet->vchDefaultKey.GetID(), "", "receive"))
+                strErrors << _("Cannot write default address") << "\n";
+        }
+
+        pwallet->SetBestChain(chainActive.GetLocator());
+    }
+
+    LogPrintf("%s", strErrors.str());
+    LogPrintf(" wallet %s %15dms\n", strWalletFile, GetTimeMillis() - nStart);
+
+    RegisterValidationInterface(pwallet);
+
+    CBlockIndex *pindexRescan = chainActive.Tip();
+    if (GetBoolArg("-rescan", false))
+    {
+        pwallet->ClearNoteWitnessCache();
+        pindexRescan = chainActive.Genesis();
+    }
+    else
+    {
+        CWalletDB walletdb(strWalletFile);
+        CBlockLocator locator;
+        if (walletdb.ReadBestBlock(locator))
+            pindexRescan = FindForkInGlobalIndex(chainActive, locator);
+        else
+            pindexRescan = chainActive.Genesis();
+    }
+    if (chainActive.Tip() && chainActive.Tip() != pindexRescan)
+    {
+        uiInterface.InitMessage(_("Rescanning..."));
+        LogPrintf("Rescanning last %i blocks (from block %i)...\n", chainActive.Height() - pindexRescan->nHeight, pindexRescan->nHeight);
+        nStart = GetTimeMillis();
+        pwallet->ScanForWalletTransactions(pindexRescan, true);
+        LogPrintf(" rescan      %15dms\n", GetTimeMillis() - nStart);
+        pwallet->SetBestChain(chainActive.GetLocator());
+        nWalletDBUpdated++;
+
+        // Restore wallet transaction metadata after -zapwallettxes=1
+        if (GetBoolArg("-zapwallettxes", false) && GetArg("-zapwallettxes", "1") != "2")
+        {
+            CWalletDB walletdb(strWalletFile);
+
+            for(const auto& wtxOld: vWtx)
+            {
+                uint256 hash = wtxOld->getTxBase()->GetHash();
+                auto mi = pwallet->getMapWallet().find(hash);
+                if (mi != pwallet->getMapWallet().end())
+                {
+                    const auto* copyFrom = wtxOld.get();
+                    CWalletTransactionBase* copyTo = mi->second.get();
+                    copyTo->mapValue = copyFrom->mapValue;
+                    copyTo->vOrderForm = copyFrom->vOrderForm;
+                    copyTo->nTimeReceived = copyFrom->nTimeReceived;
+                    copyTo->nTimeSmart = copyFrom->nTimeSmart;
+                    copyTo->fFromMe = copyFrom->fFromMe;
+                    copyTo->strFromAccount = copyFrom->strFromAccount;
+                    copyTo->nOrderPos = copyFrom->nOrderPos;
+                    copyTo->WriteToDisk(&walletdb);
+                }
+            }
+        }
+    }
+    pwallet->SetBroadcastTransactions(GetBoolArg("-walletbroadcast", true));
+    return pwallet;
+}
+#endif // ENABLE_WALLET
+
 /** Initialize bitcoin.
  *  @pre Parameters should be parsed and config file should be read.
  */
@@ -956,6 +1270,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     fLogTimestamps = GetBoolArg("-logtimestamps", true);
     fLogTimeMicros = GetBoolArg("-logtimemicros", false);
     fLogIPs = GetBoolArg("-logips", false);
+    fLockProfile = GetBoolArg("-lockprofile", false);
 
     LogPrintf("Horizen version %s (%s)\n", FormatFullVersion(), CLIENT_DATE);
 
@@ -1028,6 +1343,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (GetArg("-prune", 0)) {
         if (GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        // the filters are built from the blocks and their undo data
+        if (GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+            return InitError(_("Prune mode is incompatible with -blockfilterindex."));
+        if (GetBoolArg("-scindex", DEFAULT_SCINDEX))
+            return InitError(_("Prune mode is incompatible with -scindex."));
 #ifdef ENABLE_WALLET
         if (!GetBoolArg("-disablewallet", false)) {
             if (SoftSetBoolArg("-disablewallet", true))
@@ -1038,6 +1358,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 #endif
     }
 
+    if (GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS) && !GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+        return InitError(_("-peerblockfilters requires -blockfilterindex."));
+
     if (GetBoolArg("-reindex", false) && GetBoolArg("-reindexfast", false))
         return InitError(_("-reindex is incompatible with -reindexfast."));
 
@@ -1096,7 +1419,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Checkmempool and checkblockindex default to true in regtest mode
     mempool.setSanityCheck(GetBoolArg("-checkmempool", chainparams.DefaultConsistencyChecks()));
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
+    fMapBlockFiles = GetBoolArg("-mapblockfiles", DEFAULT_MAP_BLOCK_FILES);
+    fCompressBlockFiles = GetBoolArg("-compressblockfiles", DEFAULT_COMPRESS_BLOCK_FILES);
     fCheckpointsEnabled = GetBoolArg("-checkpoints", true);
+    hashAssumeValidSc = uint256S(GetArg("-assumevalidsc", ""));
+    if (!hashAssumeValidSc.IsNull())
+        LogPrintf("Assuming sidechain proofs valid for the ancestors of block %s\n", hashAssumeValidSc.ToString());
 
     // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
     nScriptCheckThreads = GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
@@ -1107,6 +1435,8 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    nCoinsPrefetchThreads = std::max(0, std::min((int)GetArg("-coinsprefetchthreads", DEFAULT_COINS_PREFETCH_THREADS), MAX_COINS_PREFETCH_THREADS));
+
     fServer = GetBoolArg("-server", false);
 
     // block pruning; get the amount of disk space (in MB) to allot for block & undo files
@@ -1132,6 +1462,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (nConnectTimeout <= 0)
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
 
+    // before any of the caches is allocated
+    LargePages::Mode largePagesMode;
+    if (!LargePages::ParseMode(GetArg("-largepages", "off"), largePagesMode))
+        return InitError(strprintf(_("Invalid -largepages mode: '%s'"), GetArg("-largepages", "")));
+    LargePages::SetMode(largePagesMode);
+
     // Fee-per-kilobyte amount considered the same as "free"
     // If you are mining, be careful setting this:
     // if you set it to zero then
@@ -1147,6 +1483,15 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             return InitError(strprintf(_("Invalid amount for -minrelaytxfee=<amount>: '%s'"), mapArgs["-minrelaytxfee"]));
     }
 
+    if (mapArgs.count("-blocktemplatefeegain"))
+    {
+        CAmount n = 0;
+        if (ParseMoney(mapArgs["-blocktemplatefeegain"], n) && n >= 0)
+            nBlockTemplateFeeGain = n;
+        else
+            return InitError(strprintf(_("Invalid amount for -blocktemplatefeegain=<amount>: '%s'"), mapArgs["-blocktemplatefeegain"]));
+    }
+
 #ifdef ENABLE_WALLET
     if (mapArgs.count("-mintxfee"))
     {
@@ -1188,7 +1533,9 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     bSpendZeroConfChange = GetBoolArg("-spendzeroconfchange", true);
     fSendFreeTransactions = GetBoolArg("-sendfreetransactions", false);
 
-    std::string strWalletFile = GetArg("-wallet", "wallet.dat");
+    std::vector<std::string> vWalletFiles(1, "wallet.dat");
+    if (mapMultiArgs.count("-wallet"))
+        vWalletFiles = mapMultiArgs["-wallet"];
 #endif // ENABLE_WALLET
 
     fIsBareMultisigStd = GetBoolArg("-permitbaremultisig", true);
@@ -1225,18 +1572,31 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         return false;
     }
 
+    // Select the fastest SHA256 implementation the CPU supports
+    std::string sha256_algo = SHA256AutoDetect();
+    LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+
     // Initialize elliptic curve code
+    const int nSigVerifyWindow = GetArg("-sigverifywindow", DEFAULT_SIG_VERIFY_WINDOW);
+    if (nSigVerifyWindow != DEFAULT_SIG_VERIFY_WINDOW &&
+        (nSigVerifyWindow < MIN_SIG_VERIFY_WINDOW || nSigVerifyWindow > MAX_SIG_VERIFY_WINDOW))
+        return InitError(strprintf(_("Invalid -sigverifywindow: '%s'"), GetArg("-sigverifywindow", "")));
     ECC_Start();
-    globalVerifyHandle.reset(new ECCVerifyHandle());
+    globalVerifyHandle.reset(new ECCVerifyHandle(nSigVerifyWindow));
 
     // Sanity check
     if (!InitSanityCheck())
         return InitError(_("Initialization sanity check failed. Zen is shutting down."));
 
 #ifdef ENABLE_WALLET
-    // Wallet file must be a plain filename without a directory
-    if (strWalletFile != boost::filesystem::path(strWalletFile).filename().string())
-        return InitError(strprintf(_("Wallet %s resides outside data directory %s"), strWalletFile, GetDataDir().string()));
+    std::set<std::string> setWalletFiles;
+    for (const std::string& strWalletFile : vWalletFiles) {
+        // Wallet file must be a plain filename without a directory
+        if (strWalletFile != boost::filesystem::path(strWalletFile).filename().string())
+            return InitError(strprintf(_("Wallet %s resides outside data directory %s"), strWalletFile, GetDataDir().string()));
+        if (!setWalletFiles.insert(strWalletFile).second)
+            return InitError(strprintf(_("Wallet %s is given more than once with -wallet"), strWalletFile));
+    }
 #endif
     // Make sure only a single Bitcoin process is using the data directory.
     boost::filesystem::path pathLockFile = GetDataDir() / ".lock";
@@ -1289,13 +1649,21 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
     if (nScriptCheckThreads) {
-        for (int i=0; i<nScriptCheckThreads-1; i++)
+        for (int i=0; i<nScriptCheckThreads-1; i++) {
             threadGroup.create_thread(&ThreadScriptCheck);
+            threadGroup.create_thread(&ThreadBlockCheck);
+        }
     }
 
-    // Start the lightweight task scheduler thread
+    // the thread connecting a block reads its inputs as well, with the prefetch threads
+    LogPrintf("Using %u threads for the block inputs prefetch\n", nCoinsPrefetchThreads);
+    for (int i = 1; i < nCoinsPrefetchThreads; i++)
+        threadGroup.create_thread(&ThreadCoinsPrefetch);
+
+    // Start the lightweight task scheduler threads
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
-    threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    for (int i = 0; i < DEFAULT_SCHEDULER_THREADS; i++)
+        threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
 
     // Count uptime
     MarkStartTime();
@@ -1313,8 +1681,16 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     libsnark::inhibit_profiling_info = true;
     libsnark::inhibit_profiling_counters = true;
 
-    // Initialize Zcash circuit parameters
-    ZC_LoadParams();
+    // -proverthreads=0 means autodetect, like -par
+    int nProverThreads = GetArg("-proverthreads", DEFAULT_PROVER_THREADS);
+    if (nProverThreads <= 0)
+        nProverThreads = std::max(1, nProverThreads + GetNumCores());
+    libsnark::set_num_threads(nProverThreads);
+    LogPrintf("Using %u threads for the libsnark proofs\n", nProverThreads);
+
+    // Initialize Zcash circuit parameters, in parallel with the loading of the block index: the proving key
+    // of the Sprout circuit is not loaded now anyway, it is read from its file by each proof
+    threadZCLoadParams = boost::thread(&ThreadZCLoadParams);
 
     // check type sizes in crypto lib are as expected and assert() in case of failure
     CZendooCctpLibraryChecker::CheckTypeSizes();
@@ -1336,19 +1712,21 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // ********************************************************* Step 5: verify wallet database integrity
 #ifdef ENABLE_WALLET
     if (!fDisableWallet) {
-        LogPrintf("Using wallet %s\n", strWalletFile);
         uiInterface.InitMessage(_("Verifying wallet..."));
 
-        std::string warningString;
-        std::string errorString;
+        for (const std::string& strWalletFile : vWalletFiles) {
+            LogPrintf("Using wallet %s\n", strWalletFile);
+            std::string warningString;
+            std::string errorString;
 
-        if (!CWallet::Verify(strWalletFile, warningString, errorString))
-            return false;
+            if (!CWallet::Verify(strWalletFile, warningString, errorString))
+                return false;
 
-        if (!warningString.empty())
-            InitWarning(warningString);
-        if (!errorString.empty())
-            return InitError(warningString);
+            if (!warningString.empty())
+                InitWarning(warningString);
+            if (!errorString.empty())
+                return InitError(warningString);
+        }
 
     } // (!fDisableWallet)
 #endif // ENABLE_WALLET
@@ -1380,6 +1758,20 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         }
     }
 
+    fCompactBlocks = GetBoolArg("-compactblocks", DEFAULT_COMPACT_BLOCKS);
+    nMaxCompactBlockHBPeers = std::max(0, (int)GetArg("-compactblockhbpeers", DEFAULT_MAX_COMPACT_BLOCK_HB_PEERS));
+    nHeadersSyncPeers = std::max(0, (int)GetArg("-headerssyncpeers", DEFAULT_HEADERS_SYNC_PEERS));
+    fTxReconciliation = GetBoolArg("-txreconciliation", DEFAULT_TXRECONCILIATION);
+    nReconFloodPeers = std::max(0, (int)GetArg("-reconfloodpeers", DEFAULT_RECON_FLOOD_PEERS));
+    if (mapArgs.count("-compactblockhbpeer")) {
+        BOOST_FOREACH(const std::string& net, mapMultiArgs["-compactblockhbpeer"]) {
+            CSubNet subnet(net);
+            if (!subnet.IsValid())
+                return InitError(strprintf(_("Invalid netmask specified in -compactblockhbpeer: '%s'"), net));
+            vCompactBlockHBRanges.push_back(subnet);
+        }
+    }
+
     bool proxyRandomize = GetBoolArg("-proxyrandomize", true);
     // -proxy sets a proxy for all outgoing network traffic
     // -noproxy (or -proxy=0) as well as the empty string can be used to not set a proxy, this is the default
@@ -1476,11 +1868,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             return InitError(strprintf(_("Cannot find trusted certificates directory: '%s'"), pathTLSTrustredDir.string()));
     }
 
+    // the notifiers publishing the updates of the chain get them on a thread of their own
+    StartValidationInterfaceQueue();
+
 #if ENABLE_ZMQ
     pzmqNotificationInterface = CZMQNotificationInterface::CreateWithArguments(mapArgs);
 
     if (pzmqNotificationInterface) {
-        RegisterValidationInterface(pzmqNotificationInterface);
+        RegisterValidationInterface(pzmqNotificationInterface, true);
     }
 #endif
 
@@ -1495,7 +1890,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             return InitError(_("AMQP support requires -experimentalfeatures."));
         }
 
-        RegisterValidationInterface(pAMQPNotificationInterface);
+        RegisterValidationInterface(pAMQPNotificationInterface, true);
     }
 #endif
 
@@ -1540,12 +1935,34 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("* Using %d max open files (coinsviewdb)\n", coinsviewdbMaxOpenFiles);
 
     // cache size calculations
-    int64_t nTotalCache = (GetArg("-dbcache", nDefaultDbCache) << 20);
+    int64_t nTotalCache = 0;
+    fAdaptiveCoinsCache = GetArg("-dbcache", "") == "auto";
+    if (fAdaptiveCoinsCache) {
+        // a quarter of the memory available at startup, not less than the default
+        nTotalCache = std::max(GetAvailableMemory() / 4, nDefaultDbCache << 20);
+    } else {
+        nTotalCache = (GetArg("-dbcache", nDefaultDbCache) << 20);
+    }
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
     nTotalCache = std::min(nTotalCache, nMaxDbCache << 20); // total cache cannot be greater than nMaxDbcache
     int64_t nBlockTreeDBCache = nTotalCache / 8;
 
-    if (GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+    // the separate index databases have their own caches, on top of -dbcache
+    bool fSeparateIndexDBs = GetBoolArg("-separateindexdbs", DEFAULT_SEPARATE_INDEX_DBS);
+    int64_t nIndexDBCache = std::max(GetArg("-indexdbcache", DEFAULT_INDEX_DB_CACHE), nMinDbCache) << 20;
+    int64_t nIndexDBWriteBuffer = std::max(GetArg("-indexdbwritebuffer", DEFAULT_INDEX_DB_WRITE_BUFFER), (int64_t)0) << 20;
+
+    // the writes and compactions of the block index and of the chain state, stalling the initial block download when late
+    CLevelDBTuning dbTuning;
+    dbTuning.nWriteBufferSize = std::max(GetArg("-dbwritebuffer", DEFAULT_DB_WRITE_BUFFER), (int64_t)0) << 20;
+    dbTuning.nL0CompactionTrigger = std::max((int)GetArg("-dbl0compactiontrigger", DEFAULT_DB_L0_COMPACTION_TRIGGER), 1);
+    dbTuning.nL0SlowdownTrigger = std::max((int)GetArg("-dbl0slowdowntrigger", DEFAULT_DB_L0_SLOWDOWN_TRIGGER), dbTuning.nL0CompactionTrigger);
+    dbTuning.nL0StopTrigger = std::max((int)GetArg("-dbl0stoptrigger", DEFAULT_DB_L0_STOP_TRIGGER), dbTuning.nL0SlowdownTrigger);
+    dbTuning.nSubcompactions = std::min(std::max((int)GetArg("-dbsubcompactions", DEFAULT_DB_SUBCOMPACTIONS), 1), MAX_DB_SUBCOMPACTIONS);
+    LogPrintf("* Compacting %d level-0 tables (slowing down at %d, stopping at %d) with up to %d threads\n",
+              dbTuning.nL0CompactionTrigger, dbTuning.nL0SlowdownTrigger, dbTuning.nL0StopTrigger, dbTuning.nSubcompactions);
+
+    if (!fSeparateIndexDBs && (GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || GetBoolArg("-spentindex", DEFAULT_SPENTINDEX))) {
         // enable 3/4 of the cache if addressindex and/or spentindex is enabled
         nBlockTreeDBCache = nTotalCache * 3 / 4;
     } else {
@@ -1561,10 +1978,19 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Max cache setting possible %.1fMiB\n", nMaxDbCache);
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    if (fSeparateIndexDBs)
+        LogPrintf("* Using %.1fMiB for each separate index database\n", nIndexDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
-    LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for in-memory UTXO set%s\n", nCoinCacheUsage * (1.0 / 1024 / 1024),
+              fAdaptiveCoinsCache ? ", evicting its cold entries when full" : "");
+    if (LargePages::IsEnabled())
+        LogPrintf("* Using %s huge pages for in-memory UTXO set and signature caches\n", GetArg("-largepages", ""));
+    recentBlockCache.SetMaxBytes(std::max((int64_t)GetArg("-blockcachesize", DEFAULT_BLOCK_CACHE_SIZE), (int64_t)0) << 20);
+    headerCache.SetMaxBytes(std::max((int64_t)GetArg("-headercachesize", DEFAULT_HEADER_CACHE_SIZE), (int64_t)0) << 20);
 
     bool fLoaded = false;
+    const bool fVerifyCoinsDBInBackground = GetBoolArg("-checkblocksbackground", DEFAULT_CHECKBLOCKS_BACKGROUND);
+    int nVerifyCoinsDBDepth = 0;
     while (!fLoaded) {
         bool fReset = fReindex || fReindexFast;
         std::string strLoadError;
@@ -1580,8 +2006,41 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pcoinscatcher;
                 delete pblocktree;
 
-                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, blocktreedbMaxOpenFiles, false, fReindex || fReindexFast);
-                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, coinsviewdbMaxOpenFiles, false, fReindex || fReindexFast);
+                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, blocktreedbMaxOpenFiles, false, fReindex || fReindexFast,
+                                              fSeparateIndexDBs, nIndexDBCache, nIndexDBWriteBuffer, dbTuning);
+                if (GetBoolArg("-asyncindexwrites", DEFAULT_ASYNC_INDEX_WRITES))
+                    pblocktree->StartAsyncIndexWrites();
+                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, coinsviewdbMaxOpenFiles, false, fReindex || fReindexFast, dbTuning);
+                if (!pcoinsdbview->BuildScCeasingIndex()) {
+                    strLoadError = _("Error building the sidechains ceasing height index");
+                    break;
+                }
+                if ((GetBoolArg("-pertxoutcoins", false) || pcoinsdbview->IsPerTxOutCoins()) &&
+                    !pcoinsdbview->UpgradeToPerTxOutCoins()) {
+                    strLoadError = _("Error converting the coins database to the per-output layout");
+                    break;
+                }
+                if ((GetBoolArg("-heightbucketcoins", false) || pcoinsdbview->IsHeightBucketCoins()) &&
+                    !pcoinsdbview->UpgradeToHeightBucketCoins()) {
+                    strLoadError = _("Error moving the coins outputs to their height buckets");
+                    break;
+                }
+                if (GetBoolArg("-coinscommitment", DEFAULT_COINS_COMMITMENT) &&
+                    !pcoinsdbview->LoadCoinsCommitment()) {
+                    strLoadError = _("Error computing the coins set commitment");
+                    break;
+                }
+                if (GetBoolArg("-cswnullifierfilter", DEFAULT_CSW_NULLIFIER_FILTER) &&
+                    !pcoinsdbview->LoadCswNullifierFilter()) {
+                    strLoadError = _("Error loading the CSW nullifiers filter");
+                    break;
+                }
+                if (!pcoinsdbview->LoadSidechainEventsHeights()) {
+                    strLoadError = _("Error loading the heights of the sidechain events");
+                    break;
+                }
+                if (GetBoolArg("-asynccoinsflush", DEFAULT_ASYNC_COINS_FLUSH))
+                    pcoinsdbview->StartAsyncFlush();
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
 
@@ -1601,6 +2060,10 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
+                // The blocks connected or verified from now on need the parameters for their proofs
+                if (!WaitForZCParams())
+                    return false;
+
                 // If the loaded chain has a wrong genesis, bail out immediately
                 // (we're likely using a testnet datadir, or the other way around).
                 if (!mapBlockIndex.empty() && mapBlockIndex.count(chainparams.GetConsensus().hashGenesisBlock) == 0)
@@ -1635,10 +2098,34 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
-                // Check for changed -timestampindex state
+                // The timestamp index is built in the background, it can be switched on and off at will
                 if (fTimestampIndex != GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -timestampindex");
-                    break;
+                    fTimestampIndex = !fTimestampIndex;
+                    LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled, building it" : "disabled");
+                    if (!pblocktree->WriteFlag("timestampindex", fTimestampIndex) || !CTimestampIndexer::ResetProgress()) {
+                        strLoadError = _("Error writing the timestamp index state");
+                        break;
+                    }
+                }
+
+                // So is the block filter index
+                if (fBlockFilterIndex != GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+                    fBlockFilterIndex = !fBlockFilterIndex;
+                    LogPrintf("%s: block filter index %s\n", __func__, fBlockFilterIndex ? "enabled, building it" : "disabled");
+                    if (!pblocktree->WriteFlag("blockfilterindex", fBlockFilterIndex) || !CBlockFilterIndexer::ResetProgress()) {
+                        strLoadError = _("Error writing the block filter index state");
+                        break;
+                    }
+                }
+
+                // And the sidechain activity index
+                if (fScIndex != GetBoolArg("-scindex", DEFAULT_SCINDEX)) {
+                    fScIndex = !fScIndex;
+                    LogPrintf("%s: sidechain activity index %s\n", __func__, fScIndex ? "enabled, building it" : "disabled");
+                    if (!pblocktree->WriteFlag("scindex", fScIndex) || !CScActivityIndexer::ResetProgress()) {
+                        strLoadError = _("Error writing the sidechain activity index state");
+                        break;
+                    }
                 }
 
                 // Check for changed -spentindex state
@@ -1682,14 +2169,19 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 }
 
                 uiInterface.InitMessage(_("Verifying blocks..."));
-                if (fHavePruned && GetArg("-checkblocks", 288) > MIN_BLOCKS_TO_KEEP) {
+                if (fHavePruned && GetArg("-checkblocks", DEFAULT_CHECKBLOCKS) > MIN_BLOCKS_TO_KEEP) {
                     LogPrintf("Prune: pruned datadir may not have more than %d blocks; -checkblocks=%d may fail\n",
-                        MIN_BLOCKS_TO_KEEP, GetArg("-checkblocks", 288));
+                        MIN_BLOCKS_TO_KEEP, GetArg("-checkblocks", DEFAULT_CHECKBLOCKS));
                 }
-                if (!CVerifyDB().VerifyDB(pcoinsdbview, GetArg("-checklevel", 3),
-                              GetArg("-checkblocks", 288))) {
-                    strLoadError = _("Corrupted block database detected");
-                    break;
+                {
+                    CVerifyDB verifydb;
+                    if (!verifydb.VerifyDB(pcoinsdbview, GetArg("-checklevel", DEFAULT_CHECKLEVEL),
+                                  GetArg("-checkblocks", DEFAULT_CHECKBLOCKS), GetArg("-checkblocksseconds", DEFAULT_CHECKBLOCKS_SECONDS),
+                                  fVerifyCoinsDBInBackground)) {
+                        strLoadError = _("Corrupted block database detected");
+                        break;
+                    }
+                    nVerifyCoinsDBDepth = verifydb.GetCheckedDepth();
                 }
             } catch (const std::exception& e) {
                 if (fDebug) LogPrintf("%s\n", e.what());
@@ -1744,144 +2236,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         pwalletMain = NULL;
         LogPrintf("Wallet disabled!\n");
     } else {
-
-        // needed to restore wallet transaction meta data after -zapwallettxes
-        std::vector<std::shared_ptr<CWalletTransactionBase>> vWtx;
-
-        if (GetBoolArg("-zapwallettxes", false)) {
-            uiInterface.InitMessage(_("Zapping all transactions from wallet..."));
-
-            pwalletMain = new CWallet(strWalletFile);
-            DBErrors nZapWalletRet = pwalletMain->ZapWalletTx(vWtx);
-            if (nZapWalletRet != DB_LOAD_OK) {
-                uiInterface.InitMessage(_("Error loading wallet.dat: Wallet corrupted"));
+        for (const std::string& strWalletFile : vWalletFiles) {
+            CWallet* pwallet = OpenWalletFromFile(strWalletFile, strErrors);
+            if (!pwallet)
                 return false;
-            }
-
-            delete pwalletMain;
-            pwalletMain = NULL;
-        }
-
-        uiInterface.InitMessage(_("Loading wallet..."));
-
-        nStart = GetTimeMillis();
-        bool fFirstRun = true;
-        pwalletMain = new CWallet(strWalletFile);
-        DBErrors nLoadWalletRet = pwalletMain->LoadWallet(fFirstRun);
-        if (nLoadWalletRet != DB_LOAD_OK)
-        {
-            if (nLoadWalletRet == DB_CORRUPT)
-                strErrors << _("Error loading wallet.dat: Wallet corrupted") << "\n";
-            else if (nLoadWalletRet == DB_NONCRITICAL_ERROR)
-            {
-                string msg(_("error reading wallet.dat! All keys read correctly, but transaction data"
-                             " or address book entries might be missing or incorrect."));
-
-                bool reindexing = false;
-                pblocktree->ReadReindexing(reindexing);
-                if (reindexing)
-                {
-                    msg = string(_("(Reindexing in progress...) ")) + msg;
-                }
-                InitWarning(msg);
-            }
-            else if (nLoadWalletRet == DB_TOO_NEW)
-                strErrors << _("Error loading wallet.dat: Wallet requires newer version of Horizen") << "\n";
-            else if (nLoadWalletRet == DB_NEED_REWRITE)
-            {
-                strErrors << _("Wallet needed to be rewritten: restart Horizen to complete") << "\n";
-                LogPrintf("%s", strErrors.str());
-                return InitError(strErrors.str());
-            }
-            else
-                strErrors << _("Error loading wallet.dat") << "\n";
-        }
-
-        if (GetBoolArg("-upgradewallet", fFirstRun))
-        {
-            int nMaxVersion = GetArg("-upgradewallet", 0);
-            if (nMaxVersion == 0) // the -upgradewallet without argument case
-            {
-                LogPrintf("Performing wallet upgrade to %i\n", FEATURE_LATEST);
-                nMaxVersion = CLIENT_VERSION;
-                pwalletMain->SetMinVersion(FEATURE_LATEST); // permanently upgrade the wallet immediately
-            }
-            else
-                LogPrintf("Allowing wallet upgrade up to %i\n", nMaxVersion);
-            if (nMaxVersion < pwalletMain->GetVersion())
-                strErrors << _("Cannot downgrade wallet") << "\n";
-            pwalletMain->SetMaxVersion(nMaxVersion);
-        }
-
-        if (fFirstRun)
-        {
-            // Create new keyUser and set as default key
-            CPubKey newDefaultKey;
-            if (pwalletMain->GetKeyFromPool(newDefaultKey)) {
-                pwalletMain->SetDefaultKey(newDefaultKey);
-                if (!pwalletMain->SetAddressBook(pwalletMain->vchDefaultKey.GetID(), "", "receive"))
-                    strErrors << _("Cannot write default address") << "\n";
-            }
-
-            pwalletMain->SetBestChain(chainActive.GetLocator());
-        }
-
-        LogPrintf("%s", strErrors.str());
-        LogPrintf(" wallet      %15dms\n", GetTimeMillis() - nStart);
-
-        RegisterValidationInterface(pwalletMain);
-
-        CBlockIndex *pindexRescan = chainActive.Tip();
-        if (GetBoolArg("-rescan", false))
-        {
-            pwalletMain->ClearNoteWitnessCache();
-            pindexRescan = chainActive.Genesis();
+            vpwallets.push_back(pwallet);
         }
-        else
-        {
-            CWalletDB walletdb(strWalletFile);
-            CBlockLocator locator;
-            if (walletdb.ReadBestBlock(locator))
-                pindexRescan = FindForkInGlobalIndex(chainActive, locator);
-            else
-                pindexRescan = chainActive.Genesis();
-        }
-        if (chainActive.Tip() && chainActive.Tip() != pindexRescan)
-        {
-            uiInterface.InitMessage(_("Rescanning..."));
-            LogPrintf("Rescanning last %i blocks (from block %i)...\n", chainActive.Height() - pindexRescan->nHeight, pindexRescan->nHeight);
-            nStart = GetTimeMillis();
-            pwalletMain->ScanForWalletTransactions(pindexRescan, true);
-            LogPrintf(" rescan      %15dms\n", GetTimeMillis() - nStart);
-            pwalletMain->SetBestChain(chainActive.GetLocator());
-            nWalletDBUpdated++;
-
-            // Restore wallet transaction metadata after -zapwallettxes=1
-            if (GetBoolArg("-zapwallettxes", false) && GetArg("-zapwallettxes", "1") != "2")
-            {
-                CWalletDB walletdb(strWalletFile);
-
-                for(const auto& wtxOld: vWtx)
-                {
-                    uint256 hash = wtxOld->getTxBase()->GetHash();
-                    auto mi = pwalletMain->getMapWallet().find(hash);
-                    if (mi != pwalletMain->getMapWallet().end())
-                    {
-                        const auto* copyFrom = wtxOld.get();
-                        CWalletTransactionBase* copyTo = mi->second.get();
-                        copyTo->mapValue = copyFrom->mapValue;
-                        copyTo->vOrderForm = copyFrom->vOrderForm;
-                        copyTo->nTimeReceived = copyFrom->nTimeReceived;
-                        copyTo->nTimeSmart = copyFrom->nTimeSmart;
-                        copyTo->fFromMe = copyFrom->fFromMe;
-                        copyTo->strFromAccount = copyFrom->strFromAccount;
-                        copyTo->nOrderPos = copyFrom->nOrderPos;
-                        copyTo->WriteToDisk(&walletdb);
-                    }
-                }
-            }
-        }
-        pwalletMain->SetBroadcastTransactions(GetBoolArg("-walletbroadcast", true));
+        // the calls not for a wallet in particular, and all the other users, are served by the first one
+        pwalletMain = vpwallets[0];
     } // (!fDisableWallet)
 #else // ENABLE_WALLET
     LogPrintf("No wallet support compiled in!\n");
@@ -1925,6 +2287,13 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             uiInterface.InitMessage(_("Pruning blockstore..."));
             PruneAndFlush();
         }
+        // the files are pruned at startup on the flush path, then in the background
+        threadGroup.create_thread(&ThreadPruneBlockFiles);
+    }
+
+    if (GetBoolArg("-peerblockfilters", DEFAULT_PEERBLOCKFILTERS)) {
+        LogPrintf("Setting NODE_COMPACT_FILTERS, serving the block filters\n");
+        nLocalServices |= NODE_COMPACT_FILTERS;
     }
 
     // ********************************************************* Step 10: import blocks
@@ -1932,6 +2301,21 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (mapArgs.count("-blocknotify"))
         uiInterface.NotifyBlockTip.connect(BlockNotifyCallback);
 
+    if (fTimestampIndex) {
+        pTimestampIndexer = new CTimestampIndexer();
+        pTimestampIndexer->Start();
+    }
+
+    if (fBlockFilterIndex) {
+        pBlockFilterIndexer = new CBlockFilterIndexer();
+        pBlockFilterIndexer->Start();
+    }
+
+    if (fScIndex) {
+        pScActivityIndexer = new CScActivityIndexer();
+        pScActivityIndexer->Start();
+    }
+
     uiInterface.InitMessage(_("Activating best chain..."));
     // scan for better chains in the block chain database, that are not yet connected in the active best chain
     CValidationState state;
@@ -1968,13 +2352,24 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("mapAddressBook.size() = %u\n",  pwalletMain ? pwalletMain->mapAddressBook.size() : 0);
 #endif
 
-    // Start the thread that notifies listeners of transactions that have been
-    // recently added to the mempool.
-    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "txnotify", &ThreadNotifyRecentlyAdded));
+    // Notify the listeners of transactions that have been recently added to
+    // the mempool as soon as they are, the ones added meanwhile in the same batch.
+    mempool.SetNotifyScheduler([&scheduler]() {
+        scheduler.schedule(boost::bind(&CTxMemPool::NotifyRecentlyAdded, &mempool), boost::chrono::system_clock::now(), "txnotify");
+    });
 
     if (GetBoolArg("-listenonion", DEFAULT_LISTEN_ONION))
         StartTorControl(threadGroup, scheduler);
 
+    if (mapArgs.count("-capturemessages")) {
+        boost::filesystem::path pathCapture(GetArg("-capturemessages", ""));
+        if (!pathCapture.is_complete())
+            pathCapture = GetDataDir() / pathCapture;
+        if (!messageCapture.Open(pathCapture))
+            return InitError(strprintf(_("Cannot open the message capture file %s"), pathCapture.string()));
+        LogPrintf("Capturing the messages of the peers to %s\n", pathCapture.string());
+    }
+
     StartNode(threadGroup, scheduler);
 
     // Monitor the chain, and alert if we get blocks much quicker or slower than expected
@@ -1998,28 +2393,36 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         fRegtestAllowDustOutput = GetBoolArg("-allowdustoutput", true);
     }
 
+    // Check the coins database against the last blocks verified at startup, now that the node is up
+    if (fVerifyCoinsDBInBackground && nVerifyCoinsDBDepth > 0 && GetArg("-checklevel", DEFAULT_CHECKLEVEL) >= 3)
+        threadGroup.create_thread(boost::bind(&ThreadVerifyCoinsDB, pcoinsdbview, GetArg("-checklevel", DEFAULT_CHECKLEVEL), nVerifyCoinsDBDepth));
+
     // ********************************************************* Step 11: finished
 
     SetRPCWarmupFinished();
     SetDoneLoadingUI();
+    ResubmitAsyncRPCOperations();
 
 #ifdef ENABLE_WALLET
-    if (pwalletMain) {
+    if (!vpwallets.empty()) {
         // Add wallet transactions that aren't already in a block to mapTransactions
-        pwalletMain->ReacceptWalletTransactions();
+        for (CWallet* pwallet : vpwallets)
+            pwallet->ReacceptWalletTransactions();
 
-        // Run a thread to flush wallet periodically
-        threadGroup.create_thread(boost::bind(&ThreadFlushWalletDB, boost::ref(pwalletMain->strWalletFile)));
+        // Flush the wallets periodically
+        if (GetBoolArg("-flushwallet", true))
+            scheduler.scheduleEvery(boost::bind(&MaybeFlushWalletDB, vWalletFiles), boost::chrono::milliseconds(500), "walletflush");
     }
 #endif
 
-    // Start the thread for async sidechain proof verification
-    threadGroup.create_thread(
-            boost::bind(
-                    &CScAsyncProofVerifier::RunPeriodicVerification,
-                    &CScAsyncProofVerifier::GetInstance()
-            )
-    );
+    // Start the pool of threads for parallel sidechain proof verification
+    int nScProofThreads = GetArg("-scproofverificationthreads", CScProofVerifierPool::DEFAULT_NUMBER_OF_THREADS);
+    nScProofThreads = std::max(1, std::min(nScProofThreads, CScProofVerifierPool::MAX_NUMBER_OF_THREADS));
+    int nScProofReservedThreads = std::max(0, static_cast<int>(GetArg("-scproofverificationreservedthreads", 1)));
+    CScProofVerifierPool::GetInstance().Start(nScProofThreads, nScProofReservedThreads);
+
+    // Run the async sidechain proof verification on the scheduler
+    CScAsyncProofVerifier::GetInstance().SchedulePeriodicVerification(scheduler);
 
     return !fRequestShutdown;
 }
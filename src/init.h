@@ -8,12 +8,16 @@
 
 #include "zcash/JoinSplit.hpp"
 #include <string>
+#include <vector>
 
 class CScheduler;
 class CWallet;
 namespace boost { class thread_group; }
 
+//! The first wallet loaded, the only one unless -wallet is given more than once
 extern CWallet*      pwalletMain;
+//! All the wallets loaded, each with its own lock
+extern std::vector<CWallet*> vpwallets;
 extern ZCJoinSplit*  pzcashParams;
 
 void StartShutdown();
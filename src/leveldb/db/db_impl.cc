@@ -71,6 +71,10 @@ struct DBImpl::CompactionState {
 
   uint64_t total_bytes;
 
+  // Position of the scan of the keys, for the grandparent overlap and the
+  // base level checks
+  Compaction::KeyCursor cursor;
+
   Output* current_output() { return &outputs[outputs.size()-1]; }
 
   explicit CompactionState(Compaction* c)
@@ -97,6 +101,12 @@ Options SanitizeOptions(const std::string& dbname,
   ClipToRange(&result.max_open_files,    64 + kNumNonTableCacheFiles, 50000);
   ClipToRange(&result.write_buffer_size, 64<<10,                      1<<30);
   ClipToRange(&result.block_size,        1<<10,                       4<<20);
+  ClipToRange(&result.l0_compaction_trigger, 1,                       1<<10);
+  ClipToRange(&result.l0_slowdown_writes_trigger,
+              result.l0_compaction_trigger,                           1<<10);
+  ClipToRange(&result.l0_stop_writes_trigger,
+              result.l0_slowdown_writes_trigger,                      1<<10);
+  ClipToRange(&result.max_subcompactions, 1,      config::kMaxSubcompactions);
   if (result.info_log == NULL) {
     // Open a log file in the same directory as the db
     src.env->CreateDir(dbname);  // In case it does not exist
@@ -852,6 +862,30 @@ Status DBImpl::InstallCompactionResults(CompactionState* compact) {
   return versions_->LogAndApply(compact->compaction->edit(), &mutex_);
 }
 
+// A range of the keys of a compaction, compacted by a thread of its own
+struct DBImpl::Subcompaction {
+  DBImpl* db;
+  CompactionState* state;
+  const Slice* begin;  // Keys after *begin, NULL means from the first one
+  const Slice* end;    // Keys up to *end, NULL means to the last one
+  Status status;
+
+  // Counts the subcompactions still running
+  port::Mutex* mu;
+  port::CondVar* cv;
+  int* running;
+};
+
+void DBImpl::BGSubcompaction(void* arg) {
+  Subcompaction* sub = reinterpret_cast<Subcompaction*>(arg);
+  sub->status = sub->db->DoCompactionRange(sub->state, sub->begin, sub->end,
+                                           NULL);
+  MutexLock l(sub->mu);
+  if (--*sub->running == 0) {
+    sub->cv->SignalAll();
+  }
+}
+
 Status DBImpl::DoCompactionWork(CompactionState* compact) {
   const uint64_t start_micros = env_->NowMicros();
   int64_t imm_micros = 0;  // Micros spent doing imm_ compactions
@@ -871,11 +905,107 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     compact->smallest_snapshot = snapshots_.oldest()->number_;
   }
 
+  // Split the keys in ranges compacted concurrently, the first one by this
+  // thread, which also compacts the memtable when needed
+  std::vector<Slice> boundaries;
+  compact->compaction->GetRangeBoundaries(options_.max_subcompactions,
+                                          &boundaries);
+  if (!boundaries.empty()) {
+    Log(options_.info_log, "Compacting in %d ranges",
+        static_cast<int>(boundaries.size()) + 1);
+  }
+
   // Release mutex while we're actually doing the compaction work
   mutex_.Unlock();
 
+  port::Mutex subs_mu;
+  port::CondVar subs_cv(&subs_mu);
+  int subs_running = static_cast<int>(boundaries.size());
+  std::vector<Subcompaction> subs(boundaries.size());
+  for (size_t i = 0; i < subs.size(); i++) {
+    Subcompaction& sub = subs[i];
+    sub.db = this;
+    sub.state = new CompactionState(compact->compaction);
+    sub.state->smallest_snapshot = compact->smallest_snapshot;
+    sub.begin = &boundaries[i];
+    sub.end = (i + 1 < boundaries.size()) ? &boundaries[i + 1] : NULL;
+    sub.mu = &subs_mu;
+    sub.cv = &subs_cv;
+    sub.running = &subs_running;
+    env_->StartThread(&DBImpl::BGSubcompaction, &sub);
+  }
+
+  Status status = DoCompactionRange(compact, NULL,
+                                    boundaries.empty() ? NULL : &boundaries[0],
+                                    &imm_micros);
+
+  {
+    MutexLock l(&subs_mu);
+    while (subs_running > 0) {
+      subs_cv.Wait();
+    }
+  }
+  // The outputs of the ranges, in the order of their keys; those of a failed
+  // range too, for CleanupCompaction() to forget them
+  for (size_t i = 0; i < subs.size(); i++) {
+    CompactionState* state = subs[i].state;
+    if (status.ok()) {
+      status = subs[i].status;
+    }
+    if (state->builder != NULL) {
+      state->builder->Abandon();
+      delete state->builder;
+    }
+    delete state->outfile;
+    compact->outputs.insert(compact->outputs.end(),
+                            state->outputs.begin(), state->outputs.end());
+    compact->total_bytes += state->total_bytes;
+    delete state;
+  }
+
+  CompactionStats stats;
+  stats.micros = env_->NowMicros() - start_micros - imm_micros;
+  for (int which = 0; which < 2; which++) {
+    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
+      stats.bytes_read += compact->compaction->input(which, i)->file_size;
+    }
+  }
+  for (size_t i = 0; i < compact->outputs.size(); i++) {
+    stats.bytes_written += compact->outputs[i].file_size;
+  }
+
+  mutex_.Lock();
+  stats_[compact->compaction->level() + 1].Add(stats);
+
+  if (status.ok()) {
+    status = InstallCompactionResults(compact);
+  }
+  if (!status.ok()) {
+    RecordBackgroundError(status);
+  }
+  VersionSet::LevelSummaryStorage tmp;
+  Log(options_.info_log,
+      "compacted to: %s", versions_->LevelSummary(&tmp));
+  return status;
+}
+
+Status DBImpl::DoCompactionRange(CompactionState* compact,
+                                 const Slice* begin, const Slice* end,
+                                 int64_t* imm_micros) {
   Iterator* input = versions_->MakeInputIterator(compact->compaction);
-  input->SeekToFirst();
+  if (begin != NULL) {
+    // The entries of a user key are ordered by decreasing sequence number,
+    // skip them all
+    InternalKey last_of_begin(*begin, 0, static_cast<ValueType>(0));
+    input->Seek(last_of_begin.Encode());
+    while (input->Valid() &&
+           user_comparator()->Compare(ExtractUserKey(input->key()),
+                                      *begin) <= 0) {
+      input->Next();
+    }
+  } else {
+    input->SeekToFirst();
+  }
   Status status;
   ParsedInternalKey ikey;
   std::string current_user_key;
@@ -883,7 +1013,7 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
   SequenceNumber last_sequence_for_key = kMaxSequenceNumber;
   for (; input->Valid() && !shutting_down_.Acquire_Load(); ) {
     // Prioritize immutable compaction work
-    if (has_imm_.NoBarrier_Load() != NULL) {
+    if (imm_micros != NULL && has_imm_.NoBarrier_Load() != NULL) {
       const uint64_t imm_start = env_->NowMicros();
       mutex_.Lock();
       if (imm_ != NULL) {
@@ -891,11 +1021,16 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         bg_cv_.SignalAll();  // Wakeup MakeRoomForWrite() if necessary
       }
       mutex_.Unlock();
-      imm_micros += (env_->NowMicros() - imm_start);
+      *imm_micros += (env_->NowMicros() - imm_start);
     }
 
     Slice key = input->key();
-    if (compact->compaction->ShouldStopBefore(key) &&
+    if (end != NULL && key.size() >= 8 &&
+        user_comparator()->Compare(ExtractUserKey(key), *end) > 0) {
+      // The rest of the keys belong to the next range
+      break;
+    }
+    if (compact->compaction->ShouldStopBefore(key, &compact->cursor) &&
         compact->builder != NULL) {
       status = FinishCompactionOutputFile(compact, input);
       if (!status.ok()) {
@@ -925,7 +1060,8 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         drop = true;    // (A)
       } else if (ikey.type == kTypeDeletion &&
                  ikey.sequence <= compact->smallest_snapshot &&
-                 compact->compaction->IsBaseLevelForKey(ikey.user_key)) {
+                 compact->compaction->IsBaseLevelForKey(ikey.user_key,
+                                                        &compact->cursor)) {
         // For this user key:
         // (1) there is no data in higher levels
         // (2) data in lower levels will have larger sequence numbers
@@ -944,7 +1080,8 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
         "%d smallest_snapshot: %d",
         ikey.user_key.ToString().c_str(),
         (int)ikey.sequence, ikey.type, kTypeValue, drop,
-        compact->compaction->IsBaseLevelForKey(ikey.user_key),
+        compact->compaction->IsBaseLevelForKey(ikey.user_key,
+                                               &compact->cursor),
         (int)last_sequence_for_key, (int)compact->smallest_snapshot);
 #endif
 
@@ -985,31 +1122,6 @@ Status DBImpl::DoCompactionWork(CompactionState* compact) {
     status = input->status();
   }
   delete input;
-  input = NULL;
-
-  CompactionStats stats;
-  stats.micros = env_->NowMicros() - start_micros - imm_micros;
-  for (int which = 0; which < 2; which++) {
-    for (int i = 0; i < compact->compaction->num_input_files(which); i++) {
-      stats.bytes_read += compact->compaction->input(which, i)->file_size;
-    }
-  }
-  for (size_t i = 0; i < compact->outputs.size(); i++) {
-    stats.bytes_written += compact->outputs[i].file_size;
-  }
-
-  mutex_.Lock();
-  stats_[compact->compaction->level() + 1].Add(stats);
-
-  if (status.ok()) {
-    status = InstallCompactionResults(compact);
-  }
-  if (!status.ok()) {
-    RecordBackgroundError(status);
-  }
-  VersionSet::LevelSummaryStorage tmp;
-  Log(options_.info_log,
-      "compacted to: %s", versions_->LevelSummary(&tmp));
   return status;
 }
 
@@ -1295,7 +1407,7 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       break;
     } else if (
         allow_delay &&
-        versions_->NumLevelFiles(0) >= config::kL0_SlowdownWritesTrigger) {
+        versions_->NumLevelFiles(0) >= options_.l0_slowdown_writes_trigger) {
       // We are getting close to hitting a hard limit on the number of
       // L0 files.  Rather than delaying a single write by several
       // seconds when we hit the hard limit, start delaying each
@@ -1315,7 +1427,7 @@ Status DBImpl::MakeRoomForWrite(bool force) {
       // one is still being compacted, so we wait.
       Log(options_.info_log, "Current memtable full; waiting...\n");
       bg_cv_.Wait();
-    } else if (versions_->NumLevelFiles(0) >= config::kL0_StopWritesTrigger) {
+    } else if (versions_->NumLevelFiles(0) >= options_.l0_stop_writes_trigger) {
       // There are too many level-0 files.
       Log(options_.info_log, "Too many L0 files; waiting...\n");
       bg_cv_.Wait();
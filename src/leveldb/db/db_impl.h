@@ -67,6 +67,7 @@ class DBImpl : public DB {
  private:
   friend class DB;
   struct CompactionState;
+  struct Subcompaction;
   struct Writer;
 
   Iterator* NewInternalIterator(const ReadOptions&,
@@ -112,6 +113,13 @@ class DBImpl : public DB {
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
   Status DoCompactionWork(CompactionState* compact)
       EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // Compact the keys of the compaction in the range (*begin, *end] into
+  // the outputs of *compact, without holding mutex_.  imm_micros is NULL
+  // but for the background thread, which compacts the memtable meanwhile.
+  Status DoCompactionRange(CompactionState* compact,
+                           const Slice* begin, const Slice* end,
+                           int64_t* imm_micros);
+  static void BGSubcompaction(void* arg);
 
   Status OpenCompactionOutputFile(CompactionState* compact);
   Status FinishCompactionOutputFile(CompactionState* compact, Iterator* input);
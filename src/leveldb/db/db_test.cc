@@ -195,6 +195,7 @@ class DBTest {
     kDefault,
     kFilter,
     kUncompressed,
+    kSubcompactions,
     kEnd
   };
   int option_config_;
@@ -244,6 +245,9 @@ class DBTest {
       case kUncompressed:
         options.compression = kNoCompression;
         break;
+      case kSubcompactions:
+        options.max_subcompactions = 4;
+        break;
       default:
         break;
     }
@@ -986,6 +990,52 @@ TEST(DBTest, CompactionsGenerateMultipleFiles) {
   }
 }
 
+TEST(DBTest, SubcompactionsKeepAllKeys) {
+  Options options = CurrentOptions();
+  options.write_buffer_size = 100000;  // Small write buffer
+  options.max_subcompactions = 4;
+  options.l0_compaction_trigger = 8;
+  options.l0_slowdown_writes_trigger = 16;
+  options.l0_stop_writes_trigger = 24;
+  Reopen(&options);
+
+  // Overwrites and deletions spread over many level-0 files, merged by the
+  // ranges of the compaction into level-1
+  Random rnd(301);
+  std::map<std::string, std::string> model;
+  for (int round = 0; round < 4; round++) {
+    for (int i = 0; i < 2000; i++) {
+      const std::string key = Key(rnd.Uniform(5000));
+      if (rnd.OneIn(5)) {
+        ASSERT_OK(Delete(key));
+        model.erase(key);
+      } else {
+        const std::string value = RandomString(&rnd, 100);
+        ASSERT_OK(Put(key, value));
+        model[key] = value;
+      }
+    }
+    dbfull()->TEST_CompactMemTable();
+  }
+  ASSERT_GT(NumTableFilesAtLevel(0) + NumTableFilesAtLevel(1), 1);
+  dbfull()->TEST_CompactRange(0, NULL, NULL);
+  ASSERT_EQ(NumTableFilesAtLevel(0), 0);
+  ASSERT_GT(NumTableFilesAtLevel(1), 1);
+
+  for (int i = 0; i < 5000; i++) {
+    std::map<std::string, std::string>::const_iterator it = model.find(Key(i));
+    ASSERT_EQ(Get(Key(i)), it != model.end() ? it->second : "NOT_FOUND");
+  }
+  Iterator* iter = db_->NewIterator(ReadOptions());
+  size_t count = 0;
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    ASSERT_EQ(iter->value().ToString(), model[iter->key().ToString()]);
+    count++;
+  }
+  ASSERT_EQ(count, model.size());
+  delete iter;
+}
+
 TEST(DBTest, RepeatedWritesToSameKey) {
   Options options = CurrentOptions();
   options.env = env_;
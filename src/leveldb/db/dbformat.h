@@ -22,14 +22,20 @@ namespace config {
 static const int kNumLevels = 7;
 
 // Level-0 compaction is started when we hit this many files.
+// Default of Options::l0_compaction_trigger.
 static const int kL0_CompactionTrigger = 4;
 
 // Soft limit on number of level-0 files.  We slow down writes at this point.
+// Default of Options::l0_slowdown_writes_trigger.
 static const int kL0_SlowdownWritesTrigger = 8;
 
 // Maximum number of level-0 files.  We stop writes at this point.
+// Default of Options::l0_stop_writes_trigger.
 static const int kL0_StopWritesTrigger = 12;
 
+// Maximum number of threads of a compaction (Options::max_subcompactions).
+static const int kMaxSubcompactions = 32;
+
 // Maximum level to which a new compacted memtable is pushed if it
 // does not create overlap.  We try to push to level 2 to avoid the
 // relatively expensive level 0=>1 compactions and to avoid some
@@ -1034,7 +1034,7 @@ void VersionSet::Finalize(Version* v) {
       // setting, or very high compression ratios, or lots of
       // overwrites/deletions).
       score = v->files_[level].size() /
-          static_cast<double>(config::kL0_CompactionTrigger);
+          static_cast<double>(std::max(options_->l0_compaction_trigger, 1));
     } else {
       // Compute the ratio of current size to size limit.
       const uint64_t level_bytes = TotalFileSize(v->files_[level]);
@@ -1399,12 +1399,15 @@ Compaction* VersionSet::CompactRange(
 Compaction::Compaction(int level)
     : level_(level),
       max_output_file_size_(MaxFileSizeForLevel(level)),
-      input_version_(NULL),
-      grandparent_index_(0),
-      seen_key_(false),
-      overlapped_bytes_(0) {
+      input_version_(NULL) {
+}
+
+Compaction::KeyCursor::KeyCursor()
+    : grandparent_index(0),
+      seen_key(false),
+      overlapped_bytes(0) {
   for (int i = 0; i < config::kNumLevels; i++) {
-    level_ptrs_[i] = 0;
+    level_ptrs[i] = 0;
   }
 }
 
@@ -1431,13 +1434,14 @@ void Compaction::AddInputDeletions(VersionEdit* edit) {
   }
 }
 
-bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
+bool Compaction::IsBaseLevelForKey(const Slice& user_key,
+                                   KeyCursor* cursor) const {
   // Maybe use binary search to find right entry instead of linear search?
   const Comparator* user_cmp = input_version_->vset_->icmp_.user_comparator();
   for (int lvl = level_ + 2; lvl < config::kNumLevels; lvl++) {
     const std::vector<FileMetaData*>& files = input_version_->files_[lvl];
-    for (; level_ptrs_[lvl] < files.size(); ) {
-      FileMetaData* f = files[level_ptrs_[lvl]];
+    for (; cursor->level_ptrs[lvl] < files.size(); ) {
+      FileMetaData* f = files[cursor->level_ptrs[lvl]];
       if (user_cmp->Compare(user_key, f->largest.user_key()) <= 0) {
         // We've advanced far enough
         if (user_cmp->Compare(user_key, f->smallest.user_key()) >= 0) {
@@ -1446,34 +1450,96 @@ bool Compaction::IsBaseLevelForKey(const Slice& user_key) {
         }
         break;
       }
-      level_ptrs_[lvl]++;
+      cursor->level_ptrs[lvl]++;
     }
   }
   return true;
 }
 
-bool Compaction::ShouldStopBefore(const Slice& internal_key) {
+bool Compaction::ShouldStopBefore(const Slice& internal_key,
+                                  KeyCursor* cursor) const {
   // Scan to find earliest grandparent file that contains key.
   const InternalKeyComparator* icmp = &input_version_->vset_->icmp_;
-  while (grandparent_index_ < grandparents_.size() &&
+  while (cursor->grandparent_index < grandparents_.size() &&
       icmp->Compare(internal_key,
-                    grandparents_[grandparent_index_]->largest.Encode()) > 0) {
-    if (seen_key_) {
-      overlapped_bytes_ += grandparents_[grandparent_index_]->file_size;
+                    grandparents_[cursor->grandparent_index]->largest.Encode()) > 0) {
+    if (cursor->seen_key) {
+      cursor->overlapped_bytes +=
+          grandparents_[cursor->grandparent_index]->file_size;
     }
-    grandparent_index_++;
+    cursor->grandparent_index++;
   }
-  seen_key_ = true;
+  cursor->seen_key = true;
 
-  if (overlapped_bytes_ > kMaxGrandParentOverlapBytes) {
+  if (cursor->overlapped_bytes > kMaxGrandParentOverlapBytes) {
     // Too much overlap for current output; start new output
-    overlapped_bytes_ = 0;
+    cursor->overlapped_bytes = 0;
     return true;
   } else {
     return false;
   }
 }
 
+void Compaction::GetRangeBoundaries(int max_ranges,
+                                    std::vector<Slice>* boundaries) const {
+  if (max_ranges <= 1) {
+    return;
+  }
+
+  // The largest user keys of the input files are the candidates, each one
+  // weighted with the bytes of its file: the files of level+1 do not
+  // overlap, and the level-0 ones are spread over the key range.
+  const Comparator* user_cmp = input_version_->vset_->icmp_.user_comparator();
+  std::vector<std::pair<Slice, uint64_t> > candidates;
+  uint64_t total_bytes = 0;
+  for (int which = 0; which < 2; which++) {
+    for (size_t i = 0; i < inputs_[which].size(); i++) {
+      const FileMetaData* f = inputs_[which][i];
+      candidates.push_back(std::make_pair(f->largest.user_key(), f->file_size));
+      total_bytes += f->file_size;
+    }
+  }
+  if (candidates.size() < 2) {
+    return;
+  }
+  struct ByUserKey {
+    const Comparator* cmp;
+    bool operator()(const std::pair<Slice, uint64_t>& a,
+                    const std::pair<Slice, uint64_t>& b) const {
+      return cmp->Compare(a.first, b.first) < 0;
+    }
+  };
+  ByUserKey by_user_key = { user_cmp };
+  std::sort(candidates.begin(), candidates.end(), by_user_key);
+
+  // A boundary every total_bytes / max_ranges bytes, but after the largest
+  // key of all, which would leave the last range empty
+  const uint64_t range_bytes = total_bytes / max_ranges + 1;
+  uint64_t bytes = 0;
+  uint64_t next_boundary = range_bytes;
+  for (size_t i = 0; i + 1 < candidates.size(); i++) {
+    bytes += candidates[i].second;
+    if (bytes < next_boundary) {
+      continue;
+    }
+    if (boundaries->empty() ||
+        user_cmp->Compare(candidates[i].first, boundaries->back()) > 0) {
+      boundaries->push_back(candidates[i].first);
+      if (static_cast<int>(boundaries->size()) == max_ranges - 1) {
+        break;
+      }
+    }
+    while (next_boundary <= bytes) {
+      next_boundary += range_bytes;
+    }
+  }
+  // The last boundary must be before the largest key, for a non empty range
+  while (!boundaries->empty() &&
+         user_cmp->Compare(boundaries->back(), candidates.back().first) >= 0) {
+    boundaries->pop_back();
+  }
+}
+
 void Compaction::ReleaseInputs() {
   if (input_version_ != NULL) {
     input_version_->Unref();
@@ -135,6 +135,24 @@ struct Options {
   // Default: NULL
   const FilterPolicy* filter_policy;
 
+  // Number of level-0 files that triggers a compaction of level-0, and
+  // with which the writes are slowed down (by 1ms each) or stopped until
+  // the compaction catches up.  Larger values trade reads merging more
+  // level-0 files for less write stalls during bulk loads.
+  //
+  // Default: 4, 8 and 12
+  int l0_compaction_trigger;
+  int l0_slowdown_writes_trigger;
+  int l0_stop_writes_trigger;
+
+  // Maximum number of threads a compaction is split into, each one
+  // compacting a range of the keys.  The level-0 compactions, merging
+  // all the overlapping level-0 files with the level-1 ones, benefit
+  // the most.  1 compacts on the background thread alone.
+  //
+  // Default: 1
+  int max_subcompactions;
+
   // Create an Options object with default values for all fields.
   Options();
 };
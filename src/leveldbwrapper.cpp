@@ -27,11 +27,17 @@ void HandleError(const leveldb::Status& status)
     throw leveldb_error("Unknown database error");
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize, int maxOpenFiles)
+static leveldb::Options GetOptions(size_t nCacheSize, int maxOpenFiles, const CLevelDBTuning& tuning)
 {
     leveldb::Options options;
     options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
+    // up to two write buffers may be held in memory simultaneously
+    options.write_buffer_size = tuning.nWriteBufferSize > 0 ? tuning.nWriteBufferSize : nCacheSize / 4;
+    // LevelDB raises the slowdown and the stop triggers to at least the previous one
+    options.l0_compaction_trigger = tuning.nL0CompactionTrigger;
+    options.l0_slowdown_writes_trigger = tuning.nL0SlowdownTrigger;
+    options.l0_stop_writes_trigger = tuning.nL0StopTrigger;
+    options.max_subcompactions = tuning.nSubcompactions;
     options.filter_policy = leveldb::NewBloomFilterPolicy(10);
 
     // compression is purposely set to leveldb::kNoCompression because stored data is
@@ -52,14 +58,15 @@ static leveldb::Options GetOptions(size_t nCacheSize, int maxOpenFiles)
     return options;
 }
 
-CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, int maxOpenFiles, bool fMemory, bool fWipe)
+CLevelDBWrapper::CLevelDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, int maxOpenFiles, bool fMemory, bool fWipe,
+                                 const CLevelDBTuning& tuning)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize, maxOpenFiles);
+    options = GetOptions(nCacheSize, maxOpenFiles, tuning);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
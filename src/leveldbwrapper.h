@@ -11,6 +11,8 @@
 #include "util.h"
 #include "version.h"
 
+#include <memory>
+
 #include <boost/filesystem/path.hpp>
 
 #include <leveldb/db.h>
@@ -34,6 +36,35 @@
 // 4. zend uses LevelDB version 1.18 which does not check for FD exhaustion
 constexpr unsigned int DEFAULT_DB_MAX_OPEN_FILES = 400;
 
+//! -dbwritebuffer default, for the block tree and the coins databases (MiB, 0 for a quarter of the cache)
+static const int64_t DEFAULT_DB_WRITE_BUFFER = 0;
+//! -dbl0compactiontrigger, -dbl0slowdowntrigger and -dbl0stoptrigger defaults, the LevelDB ones
+static const int DEFAULT_DB_L0_COMPACTION_TRIGGER = 4;
+static const int DEFAULT_DB_L0_SLOWDOWN_TRIGGER = 8;
+static const int DEFAULT_DB_L0_STOP_TRIGGER = 12;
+//! -dbsubcompactions default
+static const int DEFAULT_DB_SUBCOMPACTIONS = 1;
+//! The most -dbsubcompactions can be
+static const int MAX_DB_SUBCOMPACTIONS = 32;
+
+/**
+ * The tuning of the writes and of the compactions of a database.
+ *
+ * The writes are buffered in memory up to nWriteBufferSize, then written as a level-0 table; the level-0 tables
+ * are compacted into the level-1 ones once they are nL0CompactionTrigger, and the writes are slowed down from
+ * nL0SlowdownTrigger of them and stopped at nL0StopTrigger. The bulk writes of the initial block download create
+ * level-0 tables faster than a single thread compacts them: larger triggers and a compaction split into
+ * nSubcompactions threads keep the writes from stalling.
+ */
+struct CLevelDBTuning
+{
+    size_t nWriteBufferSize = 0; //!< a quarter of the cache when zero
+    int nL0CompactionTrigger = DEFAULT_DB_L0_COMPACTION_TRIGGER;
+    int nL0SlowdownTrigger = DEFAULT_DB_L0_SLOWDOWN_TRIGGER;
+    int nL0StopTrigger = DEFAULT_DB_L0_STOP_TRIGGER;
+    int nSubcompactions = DEFAULT_DB_SUBCOMPACTIONS;
+};
+
 class leveldb_error : public std::runtime_error
 {
 public:
@@ -49,34 +80,48 @@ class CLevelDBBatch
 
 private:
     leveldb::WriteBatch batch;
+    //! the records are serialized here before being copied to the batch, the buffer is reused by all of them
+    CPlainSerializeData vchBuffer;
 
 public:
     template <typename K, typename V>
     void Write(const K& key, const V& value)
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(ssKey.GetSerializeSize(key));
-        ssKey << key;
-        leveldb::Slice slKey(&ssKey[0], ssKey.size());
-
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        ssValue.reserve(ssValue.GetSerializeSize(value));
-        ssValue << value;
-        leveldb::Slice slValue(&ssValue[0], ssValue.size());
+        vchBuffer.clear();
+        SerializeAppend(vchBuffer, key, SER_DISK, CLIENT_VERSION);
+        const size_t nKeySize = vchBuffer.size();
+        SerializeAppend(vchBuffer, value, SER_DISK, CLIENT_VERSION);
 
+        leveldb::Slice slKey(vchBuffer.data(), nKeySize);
+        leveldb::Slice slValue(vchBuffer.data() + nKeySize, vchBuffer.size() - nKeySize);
         batch.Put(slKey, slValue);
     }
 
     template <typename K>
     void Erase(const K& key)
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(ssKey.GetSerializeSize(key));
-        ssKey << key;
-        leveldb::Slice slKey(&ssKey[0], ssKey.size());
+        vchBuffer.clear();
+        SerializeAppend(vchBuffer, key, SER_DISK, CLIENT_VERSION);
+
+        leveldb::Slice slKey(vchBuffer.data(), vchBuffer.size());
+        batch.Delete(slKey);
+    }
+
+    //! write an already serialized record, e.g. copied from another database
+    void WriteRaw(const leveldb::Slice& slKey, const leveldb::Slice& slValue)
+    {
+        batch.Put(slKey, slValue);
+    }
 
+    void EraseRaw(const leveldb::Slice& slKey)
+    {
         batch.Delete(slKey);
     }
+
+    void Clear()
+    {
+        batch.Clear();
+    }
 };
 
 class CLevelDBWrapper
@@ -104,16 +149,17 @@ private:
     leveldb::DB* pdb;
 
 public:
-    CLevelDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, int maxOpenFiles, bool fMemory = false, bool fWipe = false);
+    //! tuning sets the write buffer and the compactions, see CLevelDBTuning
+    CLevelDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, int maxOpenFiles, bool fMemory = false, bool fWipe = false,
+                    const CLevelDBTuning& tuning = CLevelDBTuning());
     ~CLevelDBWrapper();
 
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(ssKey.GetSerializeSize(key));
-        ssKey << key;
-        leveldb::Slice slKey(&ssKey[0], ssKey.size());
+        CPlainSerializeData vchKey;
+        SerializeAppend(vchKey, key, SER_DISK, CLIENT_VERSION);
+        leveldb::Slice slKey(vchKey.data(), vchKey.size());
 
         std::string strValue;
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
@@ -124,7 +170,7 @@ public:
             HandleError(status);
         }
         try {
-            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            CSpanReader ssValue(strValue.data(), strValue.size(), SER_DISK, CLIENT_VERSION);
             ssValue >> value;
         } catch (const std::exception&) {
             return false;
@@ -143,10 +189,9 @@ public:
     template <typename K>
     bool Exists(const K& key) const
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(ssKey.GetSerializeSize(key));
-        ssKey << key;
-        leveldb::Slice slKey(&ssKey[0], ssKey.size());
+        CPlainSerializeData vchKey;
+        SerializeAppend(vchKey, key, SER_DISK, CLIENT_VERSION);
+        leveldb::Slice slKey(vchKey.data(), vchKey.size());
 
         std::string strValue;
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
@@ -181,11 +226,37 @@ public:
         return WriteBatch(batch, true);
     }
 
+    //! whether the database holds no key at all
+    bool IsEmpty()
+    {
+        std::unique_ptr<leveldb::Iterator> it(NewIterator());
+        it->SeekToFirst();
+        return !it->Valid();
+    }
+
     // not exactly clean encapsulation, but it's easiest for now
     leveldb::Iterator* NewIterator()
     {
         return pdb->NewIterator(iteroptions);
     }
+
+    //! iterator over the state of the database at the time the snapshot was taken
+    leveldb::Iterator* NewIterator(const leveldb::Snapshot* snapshot)
+    {
+        leveldb::ReadOptions options = iteroptions;
+        options.snapshot = snapshot;
+        return pdb->NewIterator(options);
+    }
+
+    const leveldb::Snapshot* GetSnapshot()
+    {
+        return pdb->GetSnapshot();
+    }
+
+    void ReleaseSnapshot(const leveldb::Snapshot* snapshot)
+    {
+        pdb->ReleaseSnapshot(snapshot);
+    }
 };
 
 #endif // BITCOIN_LEVELDBWRAPPER_H
@@ -93,6 +93,11 @@ public:
         return true;
     }
 
+    void clear() {
+        rmap.clear();
+        map.clear();
+    }
+
     size_type max_size() const { return nMaxSize; }
 };
 
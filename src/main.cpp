@@ -9,13 +9,21 @@
 
 #include "addrman.h"
 #include "arith_uint256.h"
+#include "blockcompress.h"
+#include "blockencodings.h"
+#include "blockfilemap.h"
+#include "blockcache.h"
+#include "blockfilter.h"
+#include "blockfilterindexer.h"
 #include "checkpoints.h"
 #include "checkqueue.h"
 #include "consensus/validation.h"
 #include "deprecation.h"
+#include "headercache.h"
 #include "init.h"
 #include "merkleblock.h"
 #include "metrics.h"
+#include "netcapture.h"
 #include "pow.h"
 #include "txdb.h"
 #include "ui_interface.h"
@@ -29,6 +37,9 @@
 
 #include <sstream>
 #include <algorithm> // std::shuffle
+#include <atomic>
+#include <future>
+#include <limits>
 #include <random>
 #include <regex>
 
@@ -44,6 +55,8 @@
 
 #include "core_io.h"
 #include "sc/asyncproofverifier.h"
+#include "sc/proofcache.h"
+#include "sc/proofverifierpool.h"
 #include "sc/proofverifier.h"
 #include "sc/sidechain.h"
 #include "sc/sidechainTxsCommitmentBuilder.h"
@@ -66,9 +79,11 @@ using namespace std;
 CCriticalSection cs_main;
 
 BlockSet sGlobalForkTips;
-BlockTimeMap mGlobalForkTips;
+CGlobalForkTips mGlobalForkTips;
 
 BlockMap mapBlockIndex;
+//! the entries of mapBlockIndex created here, before instance_of_cmaincleanup which clears them on exit
+static CBlockIndexArena blockIndexArena;
 ScCumTreeRootMap mapCumtreeHeight;
 CChain chainActive;
 CBlockIndex *pindexBestHeader = NULL;
@@ -76,6 +91,21 @@ int64_t nTimeBestReceived = 0;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
+int nCoinsPrefetchThreads = 0;
+uint256 hashAssumeValidSc;
+
+/** The script verification flags of the block transactions and certificates */
+static const unsigned int BLOCK_SCRIPT_VERIFY_FLAGS = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY | SCRIPT_VERIFY_CHECKBLOCKATHEIGHT;
+// Valid scripts with the standard flags are valid with the block ones, see AddMempoolScriptExecutionCache
+static_assert((BLOCK_SCRIPT_VERIFY_FLAGS & ~STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS) == 0,
+              "the block script verification flags must be standard");
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+/** Queue of the context-free transaction and certificate checks of CheckBlock, see CheckBlockTxsAndCerts */
+static CCheckQueue<CCheckJob> blockcheckqueue(16);
+/** Serializes the CheckBlock calls using blockcheckqueue, which may come from several threads */
+static CCriticalSection cs_blockcheckqueue;
+/** Queue of the coins database reads of PrefetchBlockInputs, only used under cs_main */
+static CCheckQueue<CCheckJob> coinsprefetchqueue(16);
 bool fExperimentalMode = false;
 bool fImporting = false;
 bool fReindex = false;
@@ -85,6 +115,8 @@ bool fMaturityHeightIndex = false;
 
 bool fAddressIndex = false;
 bool fTimestampIndex = false;
+bool fBlockFilterIndex = false;
+bool fScIndex = false;
 bool fSpentIndex = false;
 
 bool fHavePruned = false;
@@ -96,15 +128,29 @@ bool fRegtestAllowDustOutput = true;
 //true in case we still have not reached the highest known block from server startup
 bool fIsStartupSyncing = true;
 size_t nCoinCacheUsage = 5000 * 300;
+bool fAdaptiveCoinsCache = false;
 uint64_t nPruneTarget = 0;
 
 /** Fees smaller than this (in satoshi) are considered zero fee (for relaying and mining) */
 CFeeRate minRelayTxFee = CFeeRate(DEFAULT_MIN_RELAY_TX_FEE);
 
+/** Mempool fees gathered since the latest block template that are worth a new one (0 = only on new blocks) */
+CAmount nBlockTemplateFeeGain = DEFAULT_BLOCK_TEMPLATE_FEE_GAIN;
+/** Mempool fees total of the latest block template and of the latest better template announcement */
+static CAmount nBlockTemplateFeesBaseline GUARDED_BY(cs_main) = 0;
+static CAmount nBlockTemplateFeesAnnounced GUARDED_BY(cs_main) = 0;
+
 CTxMemPool mempool(::minRelayTxFee);
 
+/** The views the admissions to the mempool cache the inputs in, a few for the concurrent ones, of at most 1MB each */
+static CCoinsViewCachePool admissionViews(4, 1 << 20);
+
 map<uint256, COrphanTx> mapOrphanTransactions GUARDED_BY(cs_main);;
-map<uint256, set<uint256> > mapOrphanTransactionsByPrev GUARDED_BY(cs_main);;
+map<COutPoint, set<uint256> > mapOrphanTransactionsByPrev GUARDED_BY(cs_main);;
+/** Total serialized size of the orphans, overall and by the peer which sent them */
+static size_t nOrphanTransactionsSize GUARDED_BY(cs_main) = 0;
+static map<NodeId, size_t> mapOrphanTransactionsSizeByPeer GUARDED_BY(cs_main);
+static int64_t nNextOrphanSweep GUARDED_BY(cs_main) = 0;
 
 void EraseOrphansFor(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -189,6 +235,20 @@ namespace {
      */
     bool fCheckForPruning = false;
 
+    /**
+     * The block files picked by FindFilesToPrune and queued to ThreadPruneBlockFiles, left out of the disk
+     * usage until pruned. Their blocks stay readable until then. Guarded by cs_LastBlockFile
+     */
+    std::set<int> setFilesPruning;
+    //! true while ThreadPruneBlockFiles runs, FlushStateToDisk prunes the files itself otherwise
+    std::atomic<bool> fBackgroundPruning(false);
+    boost::mutex csPruneQueue;
+    boost::condition_variable condPruneQueue;
+    std::set<int> setPruneQueue; //! guarded by csPruneQueue
+
+    MetricValue metricBlockFilesBytes("zen_block_files_bytes", "Disk space used by the block and undo files", MetricValue::Type::GAUGE);
+    MetricValue metricPrunedBlockFiles("zen_pruned_block_files_total", "Block files deleted by the pruning");
+
     /**
      * Every received block is assigned a unique and increasing identifier, so we
      * know which one to give priority in case of a fork.
@@ -234,6 +294,7 @@ namespace {
         int64_t nTime;  //! Time of "getdata" request in microseconds.
         bool fValidatedHeaders;  //! Whether this block has validated headers at the time of request.
         int64_t nTimeDisconnect; //! The timeout for this block request (for disconnecting a slow peer)
+        std::shared_ptr<PartiallyDownloadedBlock> partialBlock;  //! Optional, for a block announced as a compact block.
     };
     map<uint256, pair<NodeId, list<QueuedBlock>::iterator> > mapBlocksInFlight;
 
@@ -243,6 +304,9 @@ namespace {
     /** Number of preferable block download peers. */
     int nPreferredDownload = 0;
 
+    /** The peers asked to announce their new blocks as compact blocks, oldest first. Protected by cs_main. */
+    list<NodeId> lNodesAnnouncingHeaderAndIDs;
+
     /** Dirty block index entries. */
     set<CBlockIndex*> setDirtyBlockIndex;
 
@@ -290,11 +354,23 @@ struct CNodeState {
     CBlockIndex *pindexLastCommonBlock;
     //! Whether we've started headers synchronization with this peer.
     bool fSyncStarted;
+    //! Whether we asked this peer for a range of headers, see CHeadersRange.
+    bool fHeadersRangeRequested;
     //! Since when we're stalling block download progress (in microseconds), or 0.
     int64_t nStallingSince;
     list<QueuedBlock> vBlocksInFlight;
     int nBlocksInFlight;
     int nBlocksInFlightValidHeaders;
+    //! The number of blocks that can be in flight from this peer, see UpdateBlockDownloadStats.
+    int nMaxBlocksInFlight;
+    //! The average download rate of the blocks from this peer, in bytes per second, 0 until measured.
+    double dBlockDownloadRate;
+    //! The average size of the blocks downloaded from this peer.
+    double dAvgBlockSize;
+    //! The average time from the request of a block to its arrival, in microseconds.
+    int64_t nBlockLatency;
+    //! When the last block requested from this peer arrived, in microseconds, or 0.
+    int64_t nLastBlockReceived;
     //! Whether we consider this a preferred download peer.
     bool fPreferredDownload;
 
@@ -306,9 +382,15 @@ struct CNodeState {
         hashLastUnknownBlock.SetNull();
         pindexLastCommonBlock = NULL;
         fSyncStarted = false;
+        fHeadersRangeRequested = false;
         nStallingSince = 0;
         nBlocksInFlight = 0;
         nBlocksInFlightValidHeaders = 0;
+        nMaxBlocksInFlight = MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+        dBlockDownloadRate = 0;
+        dAvgBlockSize = 0;
+        nBlockLatency = 0;
+        nLastBlockReceived = 0;
         fPreferredDownload = false;
     }
 };
@@ -316,6 +398,30 @@ struct CNodeState {
 /** Map maintaining per-node state. Requires cs_main. */
 map<NodeId, CNodeState> mapNodeState;
 
+/**
+ * The headers between two checkpoints, downloaded from another peer than the one of the headers sync
+ * while the headers are far behind. They are checked as they come but connected only once the headers
+ * sync reaches the checkpoint the range starts after, see ConnectHeadersRanges.
+ */
+struct CHeadersRange {
+    int nStartHeight;
+    uint256 hashStart;
+    //! the header at nEndHeight, the last one of the range, is the next checkpoint
+    int nEndHeight;
+    uint256 hashEnd;
+    //! the peer the range is requested from, -1 if none
+    NodeId nodeid;
+    int64_t nRequestTime;
+    //! the headers received so far, from nStartHeight + 1
+    std::vector<CBlockHeader> vHeaders;
+
+    bool IsComplete() const { return nStartHeight + (int)vHeaders.size() == nEndHeight; }
+};
+
+/** The ranges of headers not connected yet, in height order. Requires cs_main. */
+static std::vector<CHeadersRange> vHeadersRanges;
+static bool fHeadersRangesCreated = false;
+
 // Requires cs_main.
 CNodeState *State(NodeId pnode) {
     map<NodeId, CNodeState>::iterator it = mapNodeState.find(pnode);
@@ -360,6 +466,11 @@ void FinalizeNode(NodeId nodeid) {
     if (state->fSyncStarted)
         nSyncStarted--;
 
+    BOOST_FOREACH(CHeadersRange& range, vHeadersRanges) {
+        if (range.nodeid == nodeid)
+            range.nodeid = -1;
+    }
+
     if (state->nMisbehavior == 0 && state->fCurrentlyConnected) {
         AddressCurrentlyConnected(state->address);
     }
@@ -368,6 +479,7 @@ void FinalizeNode(NodeId nodeid) {
         mapBlocksInFlight.erase(entry.hash);
     EraseOrphansFor(nodeid);
     nPreferredDownload -= state->fPreferredDownload;
+    lNodesAnnouncingHeaderAndIDs.remove(nodeid);
 
     mapNodeState.erase(nodeid);
 }
@@ -406,6 +518,42 @@ void MarkBlockAsInFlight(NodeId nodeid, const uint256& hash, const Consensus::Pa
     mapBlocksInFlight[hash] = std::make_pair(nodeid, it);
 }
 
+/**
+ * Measure the download of a block of nSize bytes, if it was requested from nodeid: its latency from the
+ * request, and the rate of its transfer since the request, or since the previous block from the peer if
+ * that came later, the requests being served one after the other. The blocks the peer can then have
+ * in flight are those it would download in BLOCK_DOWNLOAD_TARGET_TIME. Requires cs_main.
+ */
+void UpdateBlockDownloadStats(NodeId nodeid, const uint256& hash, size_t nSize) {
+    map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
+    if (itInFlight == mapBlocksInFlight.end() || itInFlight->second.first != nodeid)
+        return;
+    CNodeState *state = State(nodeid);
+    const QueuedBlock& queued = *itInFlight->second.second;
+
+    const int64_t nNow = GetTimeMicros();
+    const int64_t nLatency = nNow - queued.nTime;
+    const int64_t nTransferTime = std::max<int64_t>(nNow - std::max(queued.nTime, state->nLastBlockReceived), 1);
+    const double dRate = nSize * 1000000.0 / nTransferTime;
+    state->nLastBlockReceived = nNow;
+
+    // moving averages, the first block setting them
+    static const double dWeight = 0.2;
+    if (state->dBlockDownloadRate == 0) {
+        state->dBlockDownloadRate = dRate;
+        state->dAvgBlockSize = nSize;
+        state->nBlockLatency = nLatency;
+    } else {
+        state->dBlockDownloadRate += dWeight * (dRate - state->dBlockDownloadRate);
+        state->dAvgBlockSize += dWeight * (nSize - state->dAvgBlockSize);
+        state->nBlockLatency += dWeight * (nLatency - state->nBlockLatency);
+    }
+
+    double dMaxBlocks = state->dBlockDownloadRate * BLOCK_DOWNLOAD_TARGET_TIME / std::max(state->dAvgBlockSize, 1.0);
+    state->nMaxBlocksInFlight = std::max(MIN_BLOCKS_IN_TRANSIT_PER_PEER,
+                                         (int)std::min(dMaxBlocks, (double)MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER));
+}
+
 /** Check whether the last unknown block a peer advertized is not yet known. */
 void ProcessBlockAvailability(NodeId nodeid) {
     CNodeState *state = State(nodeid);
@@ -439,6 +587,81 @@ void UpdateBlockAvailability(NodeId nodeid, const uint256 &hash) {
     }
 }
 
+/** Whether the peer at addr is configured with -compactblockhbpeer */
+bool IsCompactBlockHBPeer(const CNetAddr& addr) {
+    BOOST_FOREACH(const CSubNet& subnet, vCompactBlockHBRanges)
+        if (subnet.Match(addr))
+            return true;
+    return false;
+}
+
+// Requires cs_main.
+/** Ask a peer that just gave us a new tip to announce its next blocks as compact blocks, in place of the
+ *  peer asked the longest ago once there are nMaxCompactBlockHBPeers of them. */
+void MaybeSetPeerAsAnnouncingHeaderAndIDs(CNode* pfrom) {
+    if (!fCompactBlocks || !pfrom->fSupportsCompactBlocks || nMaxCompactBlockHBPeers == 0)
+        return;
+    // The configured peers were asked on connection, and are not counted
+    if (IsCompactBlockHBPeer(pfrom->addr))
+        return;
+
+    NodeId nodeid = pfrom->GetId();
+    list<NodeId>::iterator it = std::find(lNodesAnnouncingHeaderAndIDs.begin(), lNodesAnnouncingHeaderAndIDs.end(), nodeid);
+    if (it != lNodesAnnouncingHeaderAndIDs.end()) {
+        // Already asked: now the last one to be replaced
+        lNodesAnnouncingHeaderAndIDs.splice(lNodesAnnouncingHeaderAndIDs.end(), lNodesAnnouncingHeaderAndIDs, it);
+        return;
+    }
+
+    if (lNodesAnnouncingHeaderAndIDs.size() >= nMaxCompactBlockHBPeers) {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes) {
+            if (pnode->GetId() == lNodesAnnouncingHeaderAndIDs.front()) {
+                pnode->PushMessage("sendcmpct", false, CMPCTBLOCKS_VERSION);
+                break;
+            }
+        }
+        lNodesAnnouncingHeaderAndIDs.pop_front();
+    }
+    LogPrint("cmpctblock", "%s: asking peer=%d to announce its blocks as compact blocks\n", __func__, nodeid);
+    pfrom->PushMessage("sendcmpct", true, CMPCTBLOCKS_VERSION);
+    lNodesAnnouncingHeaderAndIDs.push_back(nodeid);
+}
+
+// Requires pnode->cs_inventory.
+/** The outcome of a reconciliation: the transactions to announce go out with the next inv to the peer, those
+ *  it has are known to it. */
+static void RelayReconciledTxs(CNode* pnode, const std::vector<uint256>& vAnnounce, const std::vector<uint256>& vShared)
+{
+    for (const uint256& hash : vAnnounce)
+        if (!pnode->filterInventoryTxKnown.contains(hash))
+            pnode->setInventoryTxToSend.insert(hash);
+    for (const uint256& hash : vShared)
+        pnode->filterInventoryTxKnown.insert(hash);
+}
+
+/** Start reconciling the transactions with a peer which sent "sendrecon"; the first nReconFloodPeers outbound
+ *  ones still get them flooded, for the latency of the relay. */
+static void EnableTxReconciliation(CNode* pfrom, uint64_t nRemoteSalt)
+{
+    bool fFlood = false;
+    if (!pfrom->fInbound) {
+        unsigned int nFlood = 0;
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes) {
+            LOCK(pnode->cs_inventory);
+            if (pnode->txReconciliation.fFlood)
+                nFlood++;
+        }
+        fFlood = nFlood < nReconFloodPeers;
+    }
+
+    LOCK(pfrom->cs_inventory);
+    pfrom->txReconciliation.Enable(nRemoteSalt);
+    pfrom->txReconciliation.fFlood = fFlood;
+    LogPrint("net", "%s: reconciling the transactions with peer=%d%s\n", __func__, pfrom->id, fFlood ? ", flooding them too" : "");
+}
+
 /** Find the last common ancestor two blocks have.
  *  Both pa and pb must be non-NULL. */
 CBlockIndex* LastCommonAncestor(CBlockIndex* pa, CBlockIndex* pb) {
@@ -459,8 +682,10 @@ CBlockIndex* LastCommonAncestor(CBlockIndex* pa, CBlockIndex* pb) {
 }
 
 /** Update pindexLastCommonBlock and add not-in-flight missing successors to vBlocks, until it has
- *  at most count entries. */
-void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBlockIndex*>& vBlocks, NodeId& nodeStaller) {
+ *  at most count entries. When blocked by the download window, nodeStaller is the peer of pindexStalled,
+ *  the first block in flight. */
+void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBlockIndex*>& vBlocks, NodeId& nodeStaller,
+                              CBlockIndex*& pindexStalled) {
     if (count == 0)
     {
         LogPrint("forks", "%s():%d - peer has too many blocks in fligth\n", __func__, __LINE__);
@@ -499,6 +724,7 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
     int nWindowEnd = state->pindexLastCommonBlock->nHeight + BLOCK_DOWNLOAD_WINDOW;
     int nMaxHeight = std::min<int>(state->pindexBestKnownBlock->nHeight, nWindowEnd + 1);
     NodeId waitingfor = -1;
+    CBlockIndex* pindexWaitingFor = NULL;
     while (pindexWalk->nHeight < nMaxHeight) {
         // Read up to 128 (or more, if more blocks than that are needed) successors of pindexWalk (towards
         // pindexBestKnownBlock) into vToFetch. We fetch 128, because CBlockIndex::GetAncestor may be as expensive
@@ -530,6 +756,7 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
                     if (vBlocks.size() == 0 && waitingfor != nodeid) {
                         // We aren't able to fetch anything, but we would be if the download window was one larger.
                         nodeStaller = waitingfor;
+                        pindexStalled = pindexWaitingFor;
                     }
                     LogPrint("forks", "%s():%d - could not fetch [%s]\n", __func__, __LINE__, pindex->GetBlockHash().ToString() );
                     return;
@@ -541,6 +768,7 @@ void FindNextBlocksToDownload(NodeId nodeid, unsigned int count, std::vector<CBl
             } else if (waitingfor == -1) {
                 // This is the first already-in-flight block.
                 waitingfor = mapBlocksInFlight[pindex->GetBlockHash()].first;
+                pindexWaitingFor = pindex;
             }
         }
     }
@@ -560,6 +788,9 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
         if (queue.pindex)
             stats.vHeightInFlight.push_back(queue.pindex->nHeight);
     }
+    stats.dBlockDownloadRate = state->dBlockDownloadRate;
+    stats.nBlockLatency = state->nBlockLatency;
+    stats.nMaxBlocksInFlight = state->nMaxBlocksInFlight;
     return true;
 }
 
@@ -596,9 +827,13 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
     return chain.Genesis();
 }
 
+CCoinsViewDB *pcoinsdbview = NULL;
 CCoinsViewCache *pcoinsTip = NULL;
 CBlockTreeDB *pblocktree = NULL;
 
+/** The block a txout set snapshot was loaded at, if any: blocks up to it have no data. */
+static uint256 hashTxOutSetSnapshotBase;
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // mapOrphanTransactions
@@ -624,13 +859,31 @@ bool AddOrphanTx(const CTransactionBase& txObj, NodeId peer) EXCLUSIVE_LOCKS_REQ
         return false;
     }
 
-    mapOrphanTransactions[hash].tx = txObj.MakeShared();
-    mapOrphanTransactions[hash].fromPeer = peer;
+    // A single peer can only fill its share of the pool, so that flooding orphans
+    // does not evict the ones received from the other peers
+    size_t nMaxPeerSize = std::max((int64_t)0, GetArg("-maxorphanpeersize", DEFAULT_MAX_ORPHAN_PEER_SIZE)) * 1000;
+    size_t& nPeerSize = mapOrphanTransactionsSizeByPeer[peer];
+    if (nPeerSize + sz > nMaxPeerSize)
+    {
+        LogPrint("mempool", "ignoring orphan tx %s, peer=%d is over its quota (size: %u)\n", hash.ToString(), peer, nPeerSize);
+        if (nPeerSize == 0)
+            mapOrphanTransactionsSizeByPeer.erase(peer);
+        return false;
+    }
+
+    COrphanTx& orphan = mapOrphanTransactions[hash];
+    orphan.tx = txObj.MakeShared();
+    orphan.fromPeer = peer;
+    orphan.nTimeExpire = GetTime() + ORPHAN_TX_EXPIRE_TIME;
+    orphan.nTxSize = sz;
     BOOST_FOREACH(const CTxIn& txin, txObj.GetVin())
-        mapOrphanTransactionsByPrev[txin.prevout.hash].insert(hash);
+        mapOrphanTransactionsByPrev[txin.prevout].insert(hash);
 
-    LogPrint("mempool", "stored orphan tx %s (mapsz %u prevsz %u)\n", hash.ToString(),
-             mapOrphanTransactions.size(), mapOrphanTransactionsByPrev.size());
+    nPeerSize += sz;
+    nOrphanTransactionsSize += sz;
+
+    LogPrint("mempool", "stored orphan tx %s (mapsz %u prevsz %u size %u)\n", hash.ToString(),
+             mapOrphanTransactions.size(), mapOrphanTransactionsByPrev.size(), nOrphanTransactionsSize);
     return true;
 }
 
@@ -641,18 +894,38 @@ void static EraseOrphanTx(uint256 hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
         return;
     BOOST_FOREACH(const CTxIn& txin, it->second.tx->GetVin())
     {
-        map<uint256, set<uint256> >::iterator itPrev = mapOrphanTransactionsByPrev.find(txin.prevout.hash);
+        map<COutPoint, set<uint256> >::iterator itPrev = mapOrphanTransactionsByPrev.find(txin.prevout);
         if (itPrev == mapOrphanTransactionsByPrev.end())
             continue;
         itPrev->second.erase(hash);
         if (itPrev->second.empty())
             mapOrphanTransactionsByPrev.erase(itPrev);
     }
+
+    map<NodeId, size_t>::iterator itPeer = mapOrphanTransactionsSizeByPeer.find(it->second.fromPeer);
+    assert(itPeer != mapOrphanTransactionsSizeByPeer.end() && itPeer->second >= it->second.nTxSize);
+    itPeer->second -= it->second.nTxSize;
+    if (itPeer->second == 0)
+        mapOrphanTransactionsSizeByPeer.erase(itPeer);
+    nOrphanTransactionsSize -= it->second.nTxSize;
+
     mapOrphanTransactions.erase(it);
 }
 
+void static ClearOrphanTxs() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    mapOrphanTransactions.clear();
+    mapOrphanTransactionsByPrev.clear();
+    mapOrphanTransactionsSizeByPeer.clear();
+    nOrphanTransactionsSize = 0;
+    nNextOrphanSweep = 0;
+}
+
 void EraseOrphansFor(NodeId peer)
 {
+    if (!mapOrphanTransactionsSizeByPeer.count(peer))
+        return;
+
     int nErased = 0;
     map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
     while (iter != mapOrphanTransactions.end())
@@ -668,10 +941,34 @@ void EraseOrphansFor(NodeId peer)
 }
 
 
-unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans, size_t nMaxOrphansSize) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     unsigned int nEvicted = 0;
-    while (mapOrphanTransactions.size() > nMaxOrphans)
+
+    int64_t nNow = GetTime();
+    if (nNextOrphanSweep <= nNow)
+    {
+        // Sweep out expired orphan pool entries:
+        int nErased = 0;
+        int64_t nMinExpTime = nNow + ORPHAN_TX_EXPIRE_TIME - ORPHAN_TX_EXPIRE_INTERVAL;
+        map<uint256, COrphanTx>::iterator iter = mapOrphanTransactions.begin();
+        while (iter != mapOrphanTransactions.end())
+        {
+            map<uint256, COrphanTx>::iterator maybeErase = iter++;
+            if (maybeErase->second.nTimeExpire <= nNow)
+            {
+                EraseOrphanTx(maybeErase->first);
+                ++nErased;
+            }
+            else
+                nMinExpTime = std::min(maybeErase->second.nTimeExpire, nMinExpTime);
+        }
+        // Sweep again 5 minutes after the next entry that expires in order to batch the linear scan.
+        nNextOrphanSweep = nMinExpTime + ORPHAN_TX_EXPIRE_INTERVAL;
+        if (nErased > 0) LogPrint("mempool", "Erased %d orphan tx due to expiration\n", nErased);
+    }
+
+    while (mapOrphanTransactions.size() > nMaxOrphans || nOrphanTransactionsSize > nMaxOrphansSize)
     {
         // Evict a random orphan:
         uint256 randomhash = GetRandHash();
@@ -684,6 +981,11 @@ unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans) EXCLUSIVE_LOCKS_REQUIRE
     return nEvicted;
 }
 
+unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    return LimitOrphanTxSize(nMaxOrphans, std::numeric_limits<size_t>::max());
+}
+
 
 bool IsStandardTx(const CTransactionBase& txBase, string& reason, const int nHeight)
 {
@@ -1185,8 +1487,115 @@ void RejectMemoryPoolTxBase(const CValidationState& state, const CTransactionBas
         Misbehaving(pfrom->GetId(), state.GetDoS());
 }
 
+/**
+ * Run the script checks of a mempool candidate on the script check threads, as ConnectBlock does.
+ * Both run under cs_main, hence never share the queue. On failure the caller verifies the inputs again
+ * sequentially, to know which one failed and to set the reject reason and DoS score accordingly.
+ */
+/**
+ * Record the scripts of a transaction or certificate as valid for the next block, after they passed
+ * the standard script verification flags upon the active chain: the block flags are a subset of them.
+ */
+static void AddMempoolScriptExecutionCache(const uint256& hash)
+{
+    AssertLockHeld(cs_main);
+    if (chainActive.Tip() != nullptr)
+        AddScriptExecutionCache(hash, BLOCK_SCRIPT_VERIFY_FLAGS, chainActive.Tip()->GetBlockHash());
+}
+
+/**
+ * Run the script checks of a mempool candidate on the script check threads. The queue is shared with ConnectBlock
+ * and takes one controller at a time: both run under cs_main, which the admissions from any message handler
+ * thread (or the async proof verifier) hold as well.
+ */
+static bool RunMempoolScriptChecks(std::vector<CScriptCheck>& vChecks)
+{
+    AssertLockHeld(cs_main);
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
+/**
+ * Reject an entry paying less than the rolling minimum fee of the pool, which is raised when the pool
+ * is trimmed below -maxmempool.
+ */
+static bool CheckMempoolMinFee(CTxMemPool& pool, CValidationState& state, const uint256& hash,
+    const CAmount& nFees, unsigned int nSize)
+{
+    double dPriorityDelta = 0;
+    CAmount nFeeDelta = 0;
+    pool.ApplyDeltas(hash, dPriorityDelta, nFeeDelta);
+
+    CAmount mempoolRejectFee = pool.GetMinFee(GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000).GetFee(nSize);
+    if (mempoolRejectFee > 0 && nFees + nFeeDelta < mempoolRejectFee)
+    {
+        state.DoS(0, error("%s():%d - [%s] mempool min fee not met, %d < %d",
+                  __func__, __LINE__, hash.ToString(), nFees + nFeeDelta, mempoolRejectFee),
+                  CValidationState::Code::INSUFFICIENT_FEE, "mempool min fee not met");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Apply -mempoolexpiry and -maxmempool after an entry has been added to the pool.
+ * Returns false if the entry itself has been removed.
+ */
+static bool LimitMempoolSize(CTxMemPool& pool, const uint256& hash)
+{
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+
+    int64_t nExpiry = GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY);
+    if (nExpiry > 0)
+    {
+        int nExpired = pool.Expire(GetTime() - nExpiry * 60 * 60, removedTxs, removedCerts);
+        if (nExpired)
+            LogPrint("mempool", "%s():%d - expired %d txes/certs from the mempool\n", __func__, __LINE__, nExpired);
+    }
+
+    int64_t nMaxMempool = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE);
+    if (nMaxMempool > 0)
+        pool.TrimToSize(nMaxMempool * 1000000, removedTxs, removedCerts);
+
+    return pool.exists(hash);
+}
+
+void SetBlockTemplateFeesBaseline(const CAmount& nMempoolFeesAdded)
+{
+    AssertLockHeld(cs_main);
+    nBlockTemplateFeesBaseline = nMempoolFeesAdded;
+    nBlockTemplateFeesAnnounced = std::max(nBlockTemplateFeesAnnounced, nMempoolFeesAdded);
+}
+
+/**
+ * Called after an entry has been added to the mempool: once the fees gathered since the latest block template
+ * (or the latest announcement) reach -blocktemplatefeegain, wake up getblocktemplate long pollers and tell
+ * listeners a better template can be built on the current tip.
+ */
+static void CheckBlockTemplateFeeGain()
+{
+    AssertLockHeld(cs_main);
+    if (nBlockTemplateFeeGain <= 0 || IsInitialBlockDownload())
+        return;
+
+    const CAmount nFeesAdded = mempool.GetFeesAdded();
+    const CAmount nFeeGain = nFeesAdded - nBlockTemplateFeesAnnounced;
+    if (nFeeGain < nBlockTemplateFeeGain)
+        return;
+
+    LogPrint("mempool", "%s():%d - mempool gathered %s fees since latest block template (%s since latest announcement)\n",
+        __func__, __LINE__, FormatMoney(nFeesAdded - nBlockTemplateFeesBaseline), FormatMoney(nFeeGain));
+    nBlockTemplateFeesAnnounced = nFeesAdded;
+
+    cvBlockChange.notify_all();
+    GetMainSignals().UpdatedBlockTemplate(chainActive.Tip(), nFeeGain);
+}
+
 MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationState &state, const CScCertificate &cert,
-    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom)
+    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom,
+    int64_t nAcceptTime)
 {
     AssertLockHeld(cs_main);
 
@@ -1234,8 +1643,8 @@ MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationSt
 
     {
         uint256 certHash = cert.GetHash();
-        CCoinsView dummy;
-        CCoinsViewCache view(&dummy);
+        CCoinsViewCachePool::CLease lease = admissionViews.Acquire();
+        CCoinsViewCache& view = *lease;
 
         CAmount nFees = 0;
         {
@@ -1330,8 +1739,8 @@ MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationSt
                 }
             }
 
-            // we have all inputs cached now, so switch back to dummy, so we don't need to keep lock on mempool
-            view.SetBackend(dummy);
+            // we have all inputs cached now, so switch back to the empty view, so we don't need to keep lock on mempool
+            view.SetBackend(admissionViews.GetEmptyView());
         }
 
         // Check for non-standard pay-to-script-hash in inputs
@@ -1356,7 +1765,7 @@ MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationSt
         double dPriority = view.GetPriority(cert, chainActive.Height());
         LogPrint("mempool", "%s():%d - Computed fee=%lld, prio[%22.8f]\n", __func__, __LINE__, nFees, dPriority);
 
-        CCertificateMemPoolEntry entry(cert, nFees, GetTime(), dPriority, chainActive.Height());
+        CCertificateMemPoolEntry entry(cert, nFees, nAcceptTime != 0 ? nAcceptTime : GetTime(), dPriority, chainActive.Height());
         unsigned int nSize = entry.GetCertificateSize();
 
         // Don't accept it if it can't get into a block
@@ -1371,6 +1780,9 @@ MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationSt
             return MempoolReturnValue::INVALID;
         }
 
+        if (!CheckMempoolMinFee(pool, state, certHash, nFees, nSize))
+            return MempoolReturnValue::INVALID;
+
         // Require that free transactions have sufficient priority to be mined in the next block.
         if (GetBoolArg("-relaypriority", false) &&
             nFees < ::minRelayTxFee.GetFee(nSize) &&
@@ -1416,7 +1828,13 @@ MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationSt
 
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        if (!ContextualCheckCertInputs(cert, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus()))
+        // The signatures of the inputs are verified in parallel when there are more of them.
+        std::vector<CScriptCheck> vChecks;
+        bool fParallelScriptChecks = nScriptCheckThreads && (cert.GetVin().size() > 1);
+        if (!ContextualCheckCertInputs(cert, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus(),
+                                       fParallelScriptChecks ? &vChecks : nullptr) ||
+            (fParallelScriptChecks && !RunMempoolScriptChecks(vChecks) &&
+             !ContextualCheckCertInputs(cert, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus())))
         {
             LogPrintf("%s():%d - ERROR: ConnectInputs failed, cert[%s]\n", __func__, __LINE__, certHash.ToString());
             return MempoolReturnValue::INVALID;
@@ -1437,15 +1855,19 @@ MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationSt
                                 __func__, __LINE__, certHash.ToString());
             return MempoolReturnValue::INVALID;
         }
+        AddMempoolScriptExecutionCache(certHash);
 
         if (fProofVerification == MempoolProofVerificationFlag::ASYNC)
         {
             CScAsyncProofVerifier::GetInstance().LoadDataForCertVerification(view, cert, pfrom);
             return MempoolReturnValue::PARTIALLY_VALIDATED;
         }
-        else if (fProofVerification == MempoolProofVerificationFlag::SYNC)
+        else if (fProofVerification == MempoolProofVerificationFlag::SYNC ||
+                 fProofVerification == MempoolProofVerificationFlag::SYNC_HIGH_PRIORITY)
         {
-            CScProofVerifier scVerifier{CScProofVerifier::Verification::Strict, CScProofVerifier::Priority::Low};
+            CScProofVerifier scVerifier{CScProofVerifier::Verification::Strict,
+                fProofVerification == MempoolProofVerificationFlag::SYNC_HIGH_PRIORITY ?
+                    CScProofVerifier::Priority::High : CScProofVerifier::Priority::Low};
             scVerifier.LoadDataForCertVerification(view, cert);
 
             LogPrint("sc", "%s():%d - calling scVerifier.BatchVerify()\n", __func__, __LINE__);
@@ -1469,6 +1891,13 @@ MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationSt
         // Store transaction in memory
         pool.addUnchecked(certHash, entry, !IsInitialBlockDownload());
 
+        if (!LimitMempoolSize(pool, certHash))
+        {
+            state.DoS(0, error("%s():%d - cert [%s] does not fit in the mempool\n", __func__, __LINE__, certHash.ToString()),
+                CValidationState::Code::INSUFFICIENT_FEE, "mempool full");
+            return MempoolReturnValue::INVALID;
+        }
+
         // Add memory address index
         if (fAddressIndex) {
             pool.addAddressIndex(entry.GetCertificate(), entry.GetTime(), view);
@@ -1480,11 +1909,15 @@ MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationSt
         }
 
     }
+    if (&pool == &mempool)
+        CheckBlockTemplateFeeGain();
+
     return MempoolReturnValue::VALID;
 }
 
 MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx, LimitFreeFlag fLimitFree,
-                        RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom)
+                        RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom,
+                        int64_t nAcceptTime)
 {
     AssertLockHeld(cs_main);
 
@@ -1564,8 +1997,8 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
 
     {
         uint256 hash = tx.GetHash();
-        CCoinsView dummy;
-        CCoinsViewCache view(&dummy);
+        CCoinsViewCachePool::CLease lease = admissionViews.Acquire();
+        CCoinsViewCache& view = *lease;
 
         CAmount nFees = 0;
         {
@@ -1647,8 +2080,8 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
 
             nFees = tx.GetFeeAmount(view.GetValueIn(tx));
 
-            // we have all inputs cached now, so switch back to dummy, so we don't need to keep lock on mempool
-            view.SetBackend(dummy);
+            // we have all inputs cached now, so switch back to the empty view, so we don't need to keep lock on mempool
+            view.SetBackend(admissionViews.GetEmptyView());
         }
 
         // Check for non-standard pay-to-script-hash in inputs
@@ -1678,7 +2111,7 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
         double dPriority = view.GetPriority(tx, chainActive.Height());
         LogPrint("mempool", "%s():%d - tx[%s], Computed fee=%lld, prio[%22.8f]\n", __func__, __LINE__, hash.ToString(), nFees, dPriority);
 
-        CTxMemPoolEntry entry(tx, nFees, GetTime(), dPriority, chainActive.Height(), mempool.HasNoInputsOf(tx));
+        CTxMemPoolEntry entry(tx, nFees, nAcceptTime != 0 ? nAcceptTime : GetTime(), dPriority, chainActive.Height(), mempool.HasNoInputsOf(tx));
         unsigned int nSize = entry.GetTxSize();
 
         // Accept a tx if it contains joinsplits and has at least the default fee specified by z_sendmany.
@@ -1702,6 +2135,21 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
             }
         }
 
+        if (!CheckMempoolMinFee(pool, state, hash, nFees, nSize))
+            return MempoolReturnValue::INVALID;
+
+        std::string errString;
+        if (!pool.checkPackageLimits(tx, nSize,
+                GetArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT), GetArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT) * 1000,
+                GetArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT), GetArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT) * 1000,
+                errString))
+        {
+            state.DoS(0, error("%s():%d - tx [%s] exceeds the mempool package limits: %s",
+                      __func__, __LINE__, hash.ToString(), errString),
+                      CValidationState::Code::NONSTANDARD, "too-long-mempool-chain");
+            return MempoolReturnValue::INVALID;
+        }
+
         // Require that free transactions have sufficient priority to be mined in the next block.
         if (GetBoolArg("-relaypriority", false) &&
             nFees < ::minRelayTxFee.GetFee(nSize) &&
@@ -1747,7 +2195,13 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
 
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
-        if (!ContextualCheckTxInputs(tx, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus()))
+        // The signatures of the inputs are verified in parallel when there are more of them.
+        std::vector<CScriptCheck> vChecks;
+        bool fParallelScriptChecks = nScriptCheckThreads && (tx.GetVin().size() + tx.GetVcswCcIn().size() > 1);
+        if (!ContextualCheckTxInputs(tx, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus(),
+                                     fParallelScriptChecks ? &vChecks : nullptr) ||
+            (fParallelScriptChecks && !RunMempoolScriptChecks(vChecks) &&
+             !ContextualCheckTxInputs(tx, state, view, true, chainActive, STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS, true, Params().GetConsensus())))
         {
             error("%s(): ConnectInputs failed %s", __func__, hash.ToString());
             return MempoolReturnValue::INVALID;
@@ -1767,6 +2221,7 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
             error("%s(): BUG! PLEASE REPORT THIS! ConnectInputs failed against MANDATORY but not STANDARD flags %s", __func__,  hash.ToString());
             return MempoolReturnValue::INVALID;
         }
+        AddMempoolScriptExecutionCache(hash);
 
         // Run the proof verification only if there is at least one CSW input.
         if (tx.GetVcswCcIn().size() > 0)
@@ -1776,9 +2231,12 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
                 CScAsyncProofVerifier::GetInstance().LoadDataForCswVerification(view, tx, pfrom);
                 return MempoolReturnValue::PARTIALLY_VALIDATED;
             }
-            else if (fProofVerification == MempoolProofVerificationFlag::SYNC)
+            else if (fProofVerification == MempoolProofVerificationFlag::SYNC ||
+                     fProofVerification == MempoolProofVerificationFlag::SYNC_HIGH_PRIORITY)
             {
-                CScProofVerifier scVerifier{CScProofVerifier::Verification::Strict, CScProofVerifier::Priority::Low};
+                CScProofVerifier scVerifier{CScProofVerifier::Verification::Strict,
+                    fProofVerification == MempoolProofVerificationFlag::SYNC_HIGH_PRIORITY ?
+                        CScProofVerifier::Priority::High : CScProofVerifier::Priority::Low};
                 scVerifier.LoadDataForCswVerification(view, tx);
 
                 LogPrint("sc", "%s():%d - calling scVerifier.BatchVerify()\n", __func__, __LINE__);
@@ -1795,6 +2253,13 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
 
         pool.addUnchecked(hash, entry, !IsInitialBlockDownload());
 
+        if (!LimitMempoolSize(pool, hash))
+        {
+            state.DoS(0, error("%s():%d - tx [%s] does not fit in the mempool\n", __func__, __LINE__, hash.ToString()),
+                CValidationState::Code::INSUFFICIENT_FEE, "mempool full");
+            return MempoolReturnValue::INVALID;
+        }
+
         // Add memory address index
         if (fAddressIndex) {
             pool.addAddressIndex(entry.GetTx(), entry.GetTime(), view);
@@ -1807,23 +2272,27 @@ MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &stat
 
     }
 
+    if (&pool == &mempool)
+        CheckBlockTemplateFeeGain();
+
     return MempoolReturnValue::VALID;
 }
 
 MempoolReturnValue AcceptTxBaseToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransactionBase &txBase,
-    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom)
+    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom,
+    int64_t nAcceptTime)
 {
     try
     {
         if (txBase.IsCertificate())
         {
             return AcceptCertificateToMemoryPool(pool, state, dynamic_cast<const CScCertificate&>(txBase), fLimitFree,
-                                                 fRejectAbsurdFee, fProofVerification, pfrom);
+                                                 fRejectAbsurdFee, fProofVerification, pfrom, nAcceptTime);
         }
         else
         {
             return AcceptTxToMemoryPool(pool, state, dynamic_cast<const CTransaction&>(txBase), fLimitFree,
-                                        fRejectAbsurdFee, fProofVerification, pfrom);
+                                        fRejectAbsurdFee, fProofVerification, pfrom, nAcceptTime);
         }
     }
     catch (...)
@@ -1834,6 +2303,191 @@ MempoolReturnValue AcceptTxBaseToMemoryPool(CTxMemPool& pool, CValidationState &
     return MempoolReturnValue::INVALID;
 }
 
+static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+static const char* MEMPOOL_FILENAME = "mempool.dat";
+
+bool LoadMempool()
+{
+    const int64_t nExpiryTimeout = GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
+    boost::filesystem::path path = GetDataDir() / MEMPOOL_FILENAME;
+    CAutoFile filein(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+    {
+        LogPrintf("%s: Failed to open mempool file %s, continuing anyway\n", __func__, path.string());
+        return false;
+    }
+
+    int64_t nStart = GetTimeMillis();
+    int64_t nNow = GetTime();
+    unsigned int nLoaded = 0, nFailed = 0, nExpired = 0;
+
+    try
+    {
+        uint64_t nVersion;
+        filein >> nVersion;
+        if (nVersion != MEMPOOL_DUMP_VERSION)
+            return error("%s: unknown mempool file version %d", __func__, nVersion);
+
+        // The proofs of the dumped certificates and CSW inputs were verified before the shutdown: restoring
+        // them into the proof cache spares their verification when the entries are accepted again.
+        uint64_t nProofs;
+        filein >> nProofs;
+        std::vector<CScProofVerificationCache::entry_type> vProofs;
+        vProofs.reserve(std::min<uint64_t>(nProofs, CScProofVerificationCache::DEFAULT_MAX_SIZE));
+        for (uint64_t i = 0; i < nProofs; ++i)
+        {
+            uint256 proofHash, vkHash, inputHash;
+            filein >> proofHash >> vkHash >> inputHash;
+            vProofs.push_back(std::make_tuple(proofHash, vkHash, inputHash));
+        }
+        CScProofVerificationCache::GetInstance().AddEntries(vProofs);
+
+        // The deltas are applied first, so that the prioritised entries get their modified fee when accepted
+        std::map<uint256, std::pair<double, CAmount> > mapDeltas;
+        filein >> mapDeltas;
+        for (const auto& delta : mapDeltas)
+            mempool.PrioritiseTransaction(delta.first, delta.first.ToString(), delta.second.first, delta.second.second);
+
+        // The entries are dumped oldest first, hence the parents usually come before their children. The ones
+        // whose inputs are still missing are tried again once the others are in.
+        std::vector<std::pair<std::shared_ptr<CTransactionBase>, int64_t> > vMissingInputs;
+        uint64_t nEntries;
+        filein >> nEntries;
+        for (uint64_t i = 0; i < nEntries; ++i)
+        {
+            bool fCertificate;
+            filein >> fCertificate;
+            std::shared_ptr<CTransactionBase> txBase;
+            if (fCertificate)
+            {
+                std::shared_ptr<CScCertificate> cert = std::make_shared<CScCertificate>();
+                filein >> *cert;
+                txBase = cert;
+            }
+            else
+            {
+                std::shared_ptr<CTransaction> tx = std::make_shared<CTransaction>();
+                filein >> *tx;
+                txBase = tx;
+            }
+            int64_t nTime;
+            filein >> nTime;
+
+            if (nExpiryTimeout > 0 && nTime <= nNow - nExpiryTimeout)
+            {
+                ++nExpired;
+                continue;
+            }
+
+            CValidationState state;
+            MempoolReturnValue res;
+            {
+                LOCK(cs_main);
+                res = AcceptTxBaseToMemoryPool(mempool, state, *txBase, LimitFreeFlag::OFF, RejectAbsurdFeeFlag::OFF,
+                                               MempoolProofVerificationFlag::SYNC, nullptr, nTime);
+            }
+            if (res == MempoolReturnValue::VALID)
+                ++nLoaded;
+            else if (res == MempoolReturnValue::MISSING_INPUT)
+                vMissingInputs.push_back(std::make_pair(txBase, nTime));
+            else
+                ++nFailed;
+
+            if (ShutdownRequested())
+                return false;
+        }
+
+        bool fProgress = true;
+        while (fProgress && !vMissingInputs.empty())
+        {
+            fProgress = false;
+            std::vector<std::pair<std::shared_ptr<CTransactionBase>, int64_t> > vStillMissing;
+            for (const auto& entry : vMissingInputs)
+            {
+                CValidationState state;
+                MempoolReturnValue res;
+                {
+                    LOCK(cs_main);
+                    res = AcceptTxBaseToMemoryPool(mempool, state, *entry.first, LimitFreeFlag::OFF, RejectAbsurdFeeFlag::OFF,
+                                                   MempoolProofVerificationFlag::SYNC, nullptr, entry.second);
+                }
+                if (res == MempoolReturnValue::VALID)
+                {
+                    ++nLoaded;
+                    fProgress = true;
+                }
+                else if (res == MempoolReturnValue::MISSING_INPUT)
+                    vStillMissing.push_back(entry);
+                else
+                    ++nFailed;
+            }
+            vMissingInputs.swap(vStillMissing);
+        }
+        nFailed += vMissingInputs.size();
+    }
+    catch (const std::exception& e)
+    {
+        LogPrintf("%s: Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", __func__, e.what());
+        return false;
+    }
+
+    LogPrintf("Imported mempool transactions and certificates from disk: %u successes, %u failed, %u expired (%dms)\n",
+              nLoaded, nFailed, nExpired, GetTimeMillis() - nStart);
+    return true;
+}
+
+bool DumpMempool()
+{
+    int64_t nStart = GetTimeMillis();
+
+    // The entries are serialized under the mempool lock, and written out after releasing it
+    CDataStream ssEntries(SER_DISK, CLIENT_VERSION);
+    {
+        LOCK(mempool.cs);
+        ssEntries << mempool.mapDeltas;
+        ssEntries << static_cast<uint64_t>(mempool.mapIndex.size());
+        for (const CMemPoolIndexEntry& entry : mempool.mapIndex.get<entry_time>())
+        {
+            ssEntries << entry.fCertificate;
+            if (entry.fCertificate)
+                ssEntries << mempool.mapCertificate.at(entry.hash).GetCertificate();
+            else
+                ssEntries << mempool.mapTx.at(entry.hash).GetTx();
+            ssEntries << entry.nTime;
+        }
+    }
+    std::vector<CScProofVerificationCache::entry_type> vProofs = CScProofVerificationCache::GetInstance().GetEntries();
+
+    int64_t nMid = GetTimeMillis();
+
+    try
+    {
+        boost::filesystem::path pathTmp = GetDataDir() / (std::string(MEMPOOL_FILENAME) + ".new");
+        FILE* fileout = fopen(pathTmp.string().c_str(), "wb");
+        if (!fileout)
+            return error("%s: Failed to open %s for writing", __func__, pathTmp.string());
+
+        CAutoFile file(fileout, SER_DISK, CLIENT_VERSION);
+        file << MEMPOOL_DUMP_VERSION;
+        file << static_cast<uint64_t>(vProofs.size());
+        for (const CScProofVerificationCache::entry_type& proof : vProofs)
+            file << std::get<0>(proof) << std::get<1>(proof) << std::get<2>(proof);
+        file.write(&ssEntries[0], ssEntries.size());
+
+        FileCommit(file.Get());
+        file.fclose();
+        if (!RenameOver(pathTmp, GetDataDir() / MEMPOOL_FILENAME))
+            return error("%s: Failed to rename %s", __func__, pathTmp.string());
+    }
+    catch (const std::exception& e)
+    {
+        return error("%s: Failed to dump mempool: %s", __func__, e.what());
+    }
+
+    LogPrintf("Dumped mempool: %dms to copy, %dms to dump\n", nMid - nStart, GetTimeMillis() - nMid);
+    return true;
+}
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes)
 {
     if (!fTimestampIndex)
@@ -1859,6 +2513,19 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     return true;
 }
 
+bool GetSpentIndexOutputs(const uint256& txid, unsigned int nOutputs, std::map<unsigned int, CSpentIndexValue> &values)
+{
+    if (!fSpentIndex)
+        return false;
+
+    if (!pblocktree->ReadSpentIndexOutputs(txid, values))
+        return false;
+
+    // the spends in the mempool take precedence, as in GetSpentIndex
+    mempool.getSpentIndexOutputs(txid, nOutputs, values);
+    return true;
+}
+
 bool GetAddressIndex(uint160 addressHash, AddressType type,
                      std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> > &addressIndex, int start, int end)
 {
@@ -1871,6 +2538,18 @@ bool GetAddressIndex(uint160 addressHash, AddressType type,
     return true;
 }
 
+bool GetAddressBalance(uint160 addressHash, AddressType type, CAddressBalanceValue& balance)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    // an address without any entry has no balance record
+    if (!pblocktree->ReadAddressBalance(addressHash, type, balance))
+        balance.SetNull();
+
+    return true;
+}
+
 bool GetAddressUnspent(uint160 addressHash, AddressType type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
 {
@@ -2041,39 +2720,354 @@ bool GetTxBaseObj(const uint256 &hash, std::unique_ptr<CTransactionBase>& pTxBas
 // CBlock and CBlockIndex
 //
 
-bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
-{
-    // Open history file to append
-    CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull())
-        return error("WriteBlockToDisk: OpenBlockFile failed");
+bool fMapBlockFiles = DEFAULT_MAP_BLOCK_FILES;
+bool fCompressBlockFiles = DEFAULT_COMPRESS_BLOCK_FILES;
+bool fCompactBlocks = DEFAULT_COMPACT_BLOCKS;
+unsigned int nMaxCompactBlockHBPeers = DEFAULT_MAX_COMPACT_BLOCK_HB_PEERS;
+unsigned int nHeadersSyncPeers = DEFAULT_HEADERS_SYNC_PEERS;
+bool fTxReconciliation = DEFAULT_TXRECONCILIATION;
+unsigned int nReconFloodPeers = DEFAULT_RECON_FLOOD_PEERS;
+std::vector<CSubNet> vCompactBlockHBRanges;
 
-    // Write index header
-    unsigned int nSize = fileout.GetSerializeSize(block);
-    fileout << FLATDATA(messageStart) << nSize;
+/** The memory mapped block and undo files, only those no longer written to, see GetMappedRecord */
+static CBlockFileMapper blockFileMapper(MAX_MAPPED_BLOCK_FILES);
 
-    // Write block
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0)
-        return error("WriteBlockToDisk: ftell failed");
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+/** The size of the index header written before each block and undo record: the message start and the record size */
+static const size_t DISK_RECORD_HEADER_SIZE = MESSAGE_START_SIZE + sizeof(uint32_t);
 
-    return true;
-}
+FILE* OpenDiskFile(const CDiskBlockPos &pos, const char *prefix, bool fReadOnly);
+
+/**
+ * The blk and rev files appended to, kept open between the writes of their records instead of being opened for
+ * each one, under cs_LastBlockFile. The records are handed to the kernel as soon as written, for the readers of the
+ * files to see them, and committed to disk by FlushBlockFile only, before the block index referring to them is
+ * written: the files written to since the last flush of the state are committed together then, the one left on a
+ * roll-over included, so that during the initial download the fsyncs are coalesced with the flushes of the state.
+ */
+class CBlockFileWriter
+{
+public:
+    //! Of the rev files, as the undo data of the blocks of an earlier blk file may still be written
+    static const size_t MAX_OPEN_FILES = 4;
+
+    ~CBlockFileWriter() { CloseAll(); }
+
+    //! The open file nFile, NULL if it can't be opened
+    FILE* Open(int nFile, bool fUndo)
+    {
+        const FileKey key(nFile, fUndo);
+        std::map<FileKey, FILE*>::iterator it = mapOpen.find(key);
+        if (it != mapOpen.end())
+            return it->second;
+
+        if (mapOpen.size() >= MAX_OPEN_FILES) {
+            // the oldest file, the least likely to be written to again
+            fclose(mapOpen.begin()->second);
+            mapOpen.erase(mapOpen.begin());
+        }
+        FILE* file = OpenDiskFile(CDiskBlockPos(nFile, 0), fUndo ? "rev" : "blk", false);
+        if (file != NULL)
+            mapOpen[key] = file;
+        return file;
+    }
+
+    //! The file of pos, positioned at it to write a record there
+    FILE* Append(const CDiskBlockPos& pos, bool fUndo)
+    {
+        FILE* file = Open(pos.nFile, fUndo);
+        if (file == NULL)
+            return NULL;
+        if (fseek(file, pos.nPos, SEEK_SET)) {
+            LogPrintf("Unable to seek to position %u of %s\n", pos.nPos, GetBlockPosFilename(pos, fUndo ? "rev" : "blk").string());
+            Close(pos.nFile, fUndo);
+            return NULL;
+        }
+        setUnsynced.insert(FileKey(pos.nFile, fUndo));
+        return file;
+    }
+
+    //! Drop the preallocated space of the file beyond nSize
+    void Truncate(int nFile, bool fUndo, unsigned int nSize)
+    {
+        FILE* file = Open(nFile, fUndo);
+        if (file != NULL) {
+            TruncateFile(file, nSize);
+            setUnsynced.insert(FileKey(nFile, fUndo));
+        }
+    }
+
+    //! Commit to disk the files written to since the last commit
+    void Commit()
+    {
+        for (std::set<FileKey>::const_iterator it = setUnsynced.begin(); it != setUnsynced.end(); ++it) {
+            std::map<FileKey, FILE*>::const_iterator itOpen = mapOpen.find(*it);
+            if (itOpen != mapOpen.end()) {
+                FileCommit(itOpen->second);
+                continue;
+            }
+            FILE* file = OpenDiskFile(CDiskBlockPos(it->first, 0), it->second ? "rev" : "blk", true);
+            if (file != NULL) {
+                FileCommit(file);
+                fclose(file);
+            }
+        }
+        setUnsynced.clear();
+    }
+
+    //! Close the file nFile, still to be committed if written to
+    void Close(int nFile, bool fUndo)
+    {
+        std::map<FileKey, FILE*>::iterator it = mapOpen.find(FileKey(nFile, fUndo));
+        if (it != mapOpen.end()) {
+            fclose(it->second);
+            mapOpen.erase(it);
+        }
+    }
+
+    //! Close the blk and rev files nFile, not to be committed, as they are being deleted
+    void Discard(int nFile)
+    {
+        Close(nFile, false);
+        Close(nFile, true);
+        setUnsynced.erase(FileKey(nFile, false));
+        setUnsynced.erase(FileKey(nFile, true));
+    }
+
+    void CloseAll()
+    {
+        for (std::map<FileKey, FILE*>::const_iterator it = mapOpen.begin(); it != mapOpen.end(); ++it)
+            fclose(it->second);
+        mapOpen.clear();
+    }
+
+private:
+    //! The file number, and whether it is the rev file
+    typedef std::pair<int, bool> FileKey;
+
+    std::map<FileKey, FILE*> mapOpen;
+    std::set<FileKey> setUnsynced;
+};
+
+static CBlockFileWriter blockFileWriter;
+
+/** A record being written to a file of blockFileWriter, which keeps it open */
+class CAppendedFile : public CAutoFile
+{
+public:
+    CAppendedFile(FILE* file) : CAutoFile(file, SER_DISK, CLIENT_VERSION) {}
+    ~CAppendedFile() { release(); }
+
+    //! Hand the record written to the kernel, not committing it to disk
+    bool Flush() { return fflush(Get()) == 0; }
+};
+
+/**
+ * The span of the record (block or undo data) at pos in the mapped blk or rev file, as stored after
+ * the index header, and extended by nTrailerSize bytes (e.g. the checksum of the undo data). It is
+ * false if the file can't be mapped, or is still written to: the caller then reads it from the file.
+ */
+static bool GetMappedRecord(const CDiskBlockPos& pos, const char* prefix, size_t nTrailerSize,
+                            std::shared_ptr<const CMappedFile>& file, const char*& pdata, size_t& nSize, bool& fCompressed)
+{
+    if (!fMapBlockFiles || pos.IsNull() || pos.nPos < DISK_RECORD_HEADER_SIZE)
+        return false;
+    {
+        // the last file is preallocated and truncated, and only the mapped bytes of a file must not change
+        LOCK(cs_LastBlockFile);
+        if (pos.nFile >= nLastBlockFile)
+            return false;
+    }
+
+    const boost::filesystem::path path = GetBlockPosFilename(pos, prefix);
+    file = blockFileMapper.Get(path, pos.nPos);
+    if (!file)
+        return false;
+
+    const unsigned char* pheader = reinterpret_cast<const unsigned char*>(file->data() + pos.nPos - DISK_RECORD_HEADER_SIZE);
+    if (memcmp(pheader, Params().MessageStart(), MESSAGE_START_SIZE) != 0)
+        return false;
+    const uint32_t nSizeField = ReadLE32(pheader + MESSAGE_START_SIZE);
+    fCompressed = (nSizeField & DISK_RECORD_COMPRESSED) != 0;
+    nSize = (nSizeField & ~DISK_RECORD_COMPRESSED) + nTrailerSize;
+
+    if (file->size() < pos.nPos + nSize) {
+        file = blockFileMapper.Get(path, pos.nPos + nSize);
+        if (!file)
+            return false;
+    }
+    pdata = file->data() + pos.nPos;
+    return true;
+}
+
+/**
+ * The data of the record at pos in the blk or rev file, followed by its nTrailerSize bytes: in the
+ * mapped file when possible, otherwise read into the buffer of record. A compressed record is
+ * decompressed into the buffer, its data must not exceed nMaxSize bytes.
+ */
+static bool ReadDiskRecord(const CDiskBlockPos& pos, const char* prefix, size_t nTrailerSize, size_t nMaxSize, CRawBlock& record)
+{
+    record.SetNull();
+
+    bool fCompressed = false;
+    if (!GetMappedRecord(pos, prefix, nTrailerSize, record.file, record.pdata, record.nSize, fCompressed)) {
+        record.file.reset();
+        if (pos.IsNull() || pos.nPos < DISK_RECORD_HEADER_SIZE)
+            return error("%s: Invalid position %s", __func__, pos.ToString());
+
+        // Open history file to read, from the index header written before the record
+        CAutoFile filein(OpenDiskFile(CDiskBlockPos(pos.nFile, pos.nPos - DISK_RECORD_HEADER_SIZE), prefix, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("%s: OpenDiskFile failed for %s %s", __func__, prefix, pos.ToString());
+
+        try {
+            CMessageHeader::MessageStartChars messageStart;
+            uint32_t nSizeField = 0;
+            filein >> FLATDATA(messageStart) >> nSizeField;
+            fCompressed = (nSizeField & DISK_RECORD_COMPRESSED) != 0;
+            const size_t nSize = (nSizeField & ~DISK_RECORD_COMPRESSED);
+            if (memcmp(messageStart, Params().MessageStart(), MESSAGE_START_SIZE) != 0 || nSize > nMaxSize)
+                return error("%s: Invalid index header for %s %s", __func__, prefix, pos.ToString());
+
+            record.vBuffer.resize(nSize + nTrailerSize);
+            if (!record.vBuffer.empty())
+                filein.read(&record.vBuffer[0], record.vBuffer.size());
+        }
+        catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s %s", __func__, e.what(), prefix, pos.ToString());
+        }
+        record.pdata = record.vBuffer.data();
+        record.nSize = record.vBuffer.size();
+    }
+
+    if (fCompressed) {
+        const size_t nStoredSize = record.nSize - nTrailerSize;
+        std::vector<char> vData;
+        if (!DecompressBlockData(record.pdata, nStoredSize, nMaxSize, vData))
+            return error("%s: Invalid compressed record for %s %s", __func__, prefix, pos.ToString());
+        vData.insert(vData.end(), record.pdata + nStoredSize, record.pdata + record.nSize);
+
+        record.SetNull();
+        record.vBuffer.swap(vData);
+        record.pdata = record.vBuffer.data();
+        record.nSize = record.vBuffer.size();
+    }
+    return true;
+}
+
+/**
+ * The serialization of obj as written to a block or undo file: compressed when -compressblockfiles and it gets smaller.
+ * The uncompressed serialization is also returned in *pvData, when the record is compressed.
+ */
+template<typename T>
+static void EncodeDiskRecord(const T& obj, std::vector<char>& vRecord, bool& fCompressed, std::vector<char>* pvData = NULL)
+{
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << obj;
+    fCompressed = fCompressBlockFiles && !ss.empty() && CompressBlockData(&ss[0], ss.size(), vRecord);
+    if (!fCompressed)
+        vRecord.assign(ss.begin(), ss.end());
+    else if (pvData != NULL)
+        pvData->assign(ss.begin(), ss.end());
+}
+
+/** Write the index header and then vRecord, setting pos to where the latter starts */
+static bool WriteDiskRecord(CAutoFile& fileout, const std::vector<char>& vRecord, bool fCompressed,
+                            CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+{
+    // Write index header
+    uint32_t nSizeField = vRecord.size() | (fCompressed ? DISK_RECORD_COMPRESSED : 0);
+    fileout << FLATDATA(messageStart) << nSizeField;
+
+    // Write record
+    long fileOutPos = ftell(fileout.Get());
+    if (fileOutPos < 0)
+        return error("%s: ftell failed", __func__);
+    pos.nPos = (unsigned int)fileOutPos;
+    if (!vRecord.empty())
+        fileout.write(&vRecord[0], vRecord.size());
+
+    return true;
+}
+
+/** A block record as read from a block file by LoadBlocksFromExternalFile, see DISK_RECORD_COMPRESSED */
+static bool IsBlockRecordSize(uint32_t nSizeField)
+{
+    if (nSizeField & DISK_RECORD_COMPRESSED)
+        return (nSizeField & ~DISK_RECORD_COMPRESSED) <= MAX_BLOCK_SIZE;
+    return nSizeField >= 80 && nSizeField <= MAX_BLOCK_SIZE;
+}
+
+/** Read the block record whose index header was just read from blkdat, throwing if it is invalid */
+static void ReadBlockRecord(CBufferedFile& blkdat, uint32_t nSizeField, CBlock& block)
+{
+    if (!(nSizeField & DISK_RECORD_COMPRESSED)) {
+        blkdat >> block;
+        return;
+    }
+
+    std::vector<char> vStored(nSizeField & ~DISK_RECORD_COMPRESSED);
+    std::vector<char> vData;
+    if (!vStored.empty())
+        blkdat.read(&vStored[0], vStored.size());
+    if (!DecompressBlockData(vStored.data(), vStored.size(), MAX_BLOCK_SIZE, vData))
+        throw std::ios_base::failure("invalid compressed block record");
+    CSpanReader(vData.data(), vData.size(), SER_DISK, CLIENT_VERSION) >> block;
+}
+
+bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart)
+{
+    LOCK(cs_LastBlockFile);
+
+    // Open history file to append
+    CAppendedFile fileout(blockFileWriter.Append(pos, false));
+    if (fileout.IsNull())
+        return error("WriteBlockToDisk: OpenBlockFile failed");
+
+    // Write index header
+    unsigned int nSize = fileout.GetSerializeSize(block);
+    fileout << FLATDATA(messageStart) << nSize;
+
+    // Write block
+    long fileOutPos = ftell(fileout.Get());
+    if (fileOutPos < 0)
+        return error("WriteBlockToDisk: ftell failed");
+    pos.nPos = (unsigned int)fileOutPos;
+    fileout << block;
+
+    if (!fileout.Flush())
+        return error("WriteBlockToDisk: writing the block failed");
+    return true;
+}
+
+/** Write a block record made by EncodeDiskRecord, whose size plus the index header has been reserved by FindBlockPos */
+static bool WriteBlockToDisk(const std::vector<char>& vRecord, bool fCompressed, CDiskBlockPos& pos,
+                             const CMessageHeader::MessageStartChars& messageStart)
+{
+    LOCK(cs_LastBlockFile);
+
+    // Open history file to append
+    CAppendedFile fileout(blockFileWriter.Append(pos, false));
+    if (fileout.IsNull())
+        return error("WriteBlockToDisk: OpenBlockFile failed");
+
+    if (!WriteDiskRecord(fileout, vRecord, fCompressed, pos, messageStart))
+        return false;
+    if (!fileout.Flush())
+        return error("WriteBlockToDisk: writing the block failed");
+    return true;
+}
 
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    CRawBlock record;
+    if (!ReadDiskRecord(pos, "blk", 0, MAX_BLOCK_SIZE, record))
+        return error("ReadBlockFromDisk: reading the block failed at %s", pos.ToString());
 
     // Read block
     try {
-        filein >> block;
+        CSpanReader(record.begin(), record.size(), SER_DISK, CLIENT_VERSION) >> block;
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
@@ -2087,8 +3081,77 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos)
     return true;
 }
 
+bool ReadRawBlockFromDisk(CRawBlock& rawBlock, const CBlockIndex* pindex)
+{
+    return ReadRawBlockFromDisk(rawBlock, pindex->GetBlockPos(), pindex->GetBlockHash());
+}
+
+bool ReadRawBlockFromDisk(CRawBlock& rawBlock, const CDiskBlockPos& pos, const uint256& hash)
+{
+    if (!ReadDiskRecord(pos, "blk", 0, MAX_BLOCK_SIZE, rawBlock))
+        return error("%s: reading the block failed at %s", __func__, pos.ToString());
+
+    // The header is enough to tell the bytes are those of the block of hash, whose proof of work has been checked
+    CBlockHeader header;
+    try {
+        CSpanReader(rawBlock.begin(), rawBlock.size(), SER_DISK, CLIENT_VERSION) >> header;
+    }
+    catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+    if (header.GetHash() != hash)
+        return error("%s: GetHash() doesn't match index for %s at %s", __func__, hash.ToString(), pos.ToString());
+
+    return true;
+}
+
+/**
+ * The serialization of a recent block, as written to its block file when accepted, from the cache of the recent
+ * blocks: for the notifiers and the peers to send the new tips without reading them back.
+ */
+static bool GetRecentRawBlock(CRawBlock& rawBlock, const uint256& hash)
+{
+    std::shared_ptr<const std::vector<char> > praw = recentBlockCache.GetRaw(hash);
+    if (!praw)
+        return false;
+    rawBlock.SetNull();
+    rawBlock.shared = praw;
+    rawBlock.pdata = praw->data();
+    rawBlock.nSize = praw->size();
+    return true;
+}
+
+//! The block of hash at pos, from the recent blocks if there
+static bool ReadRecentBlockOrFromDisk(CBlock& block, const CDiskBlockPos& pos, const uint256& hash)
+{
+    std::shared_ptr<const CBlock> pcached = recentBlockCache.GetBlock(hash);
+    if (pcached) {
+        block = *pcached;
+        return true;
+    }
+    return ReadBlockFromDisk(block, pos) && block.GetHash() == hash;
+}
+
+bool GetRawBlock(CRawBlock& rawBlock, const CBlockIndex* pindex)
+{
+    if (GetRecentRawBlock(rawBlock, pindex->GetBlockHash()))
+        return true;
+    CDiskBlockPos pos;
+    {
+        LOCK(cs_main);
+        pos = pindex->GetBlockPos();
+    }
+    return ReadRawBlockFromDisk(rawBlock, pos, pindex->GetBlockHash());
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
 {
+    // a recent block, its header checked already
+    std::shared_ptr<const CBlock> pcached = recentBlockCache.GetBlock(pindex->GetBlockHash());
+    if (pcached) {
+        block = *pcached;
+        return true;
+    }
     if (!ReadBlockFromDisk(block, pindex->GetBlockPos()))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
@@ -2254,12 +3317,13 @@ void CheckForkWarningConditionsOnNewFork(CBlockIndex* pindexNewForkTip)
     CheckForkWarningConditions();
 }
 
-// Requires cs_main.
+// Takes cs_main, as the message handler threads call it from any command.
 void Misbehaving(NodeId pnode, int howmuch)
 {
     if (howmuch == 0)
         return;
 
+    LOCK(cs_main);
     CNodeState *state = State(pnode);
     if (state == NULL)
         return;
@@ -2419,31 +3483,31 @@ void UpdateCoins(const CScCertificate& cert, CCoinsViewCache &inputs, CTxUndo &t
     return;
 }
 
-CScriptCheck::CScriptCheck(): ptxTo(0), nIn(0), chain(nullptr),
+CScriptCheck::CScriptCheck(): ptxTo(0), nIn(0),
                               nFlags(0), cacheStore(false),
                               error(SCRIPT_ERR_UNKNOWN_ERROR) {}
 CScriptCheck::CScriptCheck(const CCoins& txFromIn, const CTransactionBase& txToIn,
-                           unsigned int nInIn, const CChain* chainIn,
+                           unsigned int nInIn, std::shared_ptr<const CChain> chainIn,
                            unsigned int nFlagsIn, bool cacheIn):
                             scriptPubKey(txFromIn.vout[txToIn.GetVin()[nInIn].prevout.n].scriptPubKey),
                             ptxTo(&txToIn), nIn(nInIn), chain(chainIn), nFlags(nFlagsIn),
                             cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR) { }
 
 CScriptCheck::CScriptCheck(const CScript& scriptPubKeyIn, const CTransactionBase& txToIn,
-                           unsigned int nInIn, const CChain* chainIn,
+                           unsigned int nInIn, std::shared_ptr<const CChain> chainIn,
                            unsigned int nFlagsIn, bool cacheIn):
                             scriptPubKey(scriptPubKeyIn), ptxTo(&txToIn), nIn(nInIn), chain(chainIn),
                             nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR) { }
 
 bool CScriptCheck::operator()() {
-    return ptxTo->VerifyScript(scriptPubKey, nFlags, nIn, chain, cacheStore, &error);
+    return ptxTo->VerifyScript(scriptPubKey, nFlags, nIn, chain.get(), cacheStore, &error);
 }
 
 void CScriptCheck::swap(CScriptCheck &check) {
     scriptPubKey.swap(check.scriptPubKey);
     std::swap(ptxTo, check.ptxTo);
     std::swap(nIn, check.nIn);
-    std::swap(chain, check.chain);
+    chain.swap(check.chain);
     std::swap(nFlags, check.nFlags);
     std::swap(cacheStore, check.cacheStore);
     std::swap(error, check.error);
@@ -2580,11 +3644,27 @@ bool CheckTxInputs(const CTransactionBase& txBase, CValidationState& state, cons
 }
 }// namespace Consensus
 
+/**
+ * The snapshot of the recent block hashes of chain, shared by the script checks of the transactions, certificates
+ * and blocks until its tip changes, when it is taken again copying from the previous one the hashes still in chain.
+ * The caller holds the lock chain is guarded by, i.e. cs_main for the active chain.
+ */
+static std::shared_ptr<const CChain> GetBlockHashSnapshot(const CChain& chain)
+{
+    static CCriticalSection cs_blockHashSnapshot;
+    static std::shared_ptr<const CBlockHashSnapshot> snapshot;
+
+    LOCK(cs_blockHashSnapshot);
+    if (!snapshot || snapshot->Tip() != chain.Tip())
+        snapshot = std::make_shared<const CBlockHashSnapshot>(chain, getCheckBlockAtHeightSafeDepth(), snapshot.get());
+    return snapshot;
+}
+
 bool InputScriptCheck(const CScript& scriptPubKey, const CTransactionBase& tx, unsigned int nIn,
-                      const CChain& chain, unsigned int flags, bool cacheStore,  CValidationState &state, std::vector<CScriptCheck> *pvChecks)
+                      const std::shared_ptr<const CChain>& chain, unsigned int flags, bool cacheStore,  CValidationState &state, std::vector<CScriptCheck> *pvChecks)
 {
     // Verify signature
-    CScriptCheck check(scriptPubKey, tx, nIn, &chain, flags, cacheStore);
+    CScriptCheck check(scriptPubKey, tx, nIn, chain, flags, cacheStore);
     if (pvChecks) {
         pvChecks->push_back(CScriptCheck());
         check.swap(pvChecks->back());
@@ -2599,7 +3679,7 @@ bool InputScriptCheck(const CScript& scriptPubKey, const CTransactionBase& tx, u
             // arguments; if so, don't trigger DoS protection to
             // avoid splitting the network between upgraded and
             // non-upgraded nodes.
-            CScriptCheck check(scriptPubKey, tx, nIn, &chain,
+            CScriptCheck check(scriptPubKey, tx, nIn, chain,
                     flags & ~STANDARD_CONTEXTUAL_NOT_MANDATORY_VERIFY_FLAGS, cacheStore);
             if (check())
                 return state.Invalid(false, CValidationState::Code::NONSTANDARD, strprintf("non-mandatory-script-verify-flag (%s)", ScriptErrorString(check.GetScriptError())));
@@ -2639,13 +3719,14 @@ bool ContextualCheckTxInputs(const CTransaction& tx, CValidationState &state, co
         // before the last block chain checkpoint. This is safe because block merkle hashes are
         // still computed and checked, and any change will be caught at the next checkpoint.
         if (fScriptChecks) {
+            const std::shared_ptr<const CChain> blockHashes = GetBlockHashSnapshot(chain);
             for (unsigned int i = 0; i < tx.GetVin().size(); i++) {
                 const COutPoint &prevout = tx.GetVin()[i].prevout;
                 const CCoins* coins = inputs.AccessCoins(prevout.hash);
                 assert(coins);
 
                 const CScript& scriptPubKey = coins->vout[tx.GetVin()[i].prevout.n].scriptPubKey;
-                if(!InputScriptCheck(scriptPubKey, tx, i, chain, flags, cacheStore, state, pvChecks)) {
+                if(!InputScriptCheck(scriptPubKey, tx, i, blockHashes, flags, cacheStore, state, pvChecks)) {
                     return false;
                 }
             }
@@ -2653,7 +3734,7 @@ bool ContextualCheckTxInputs(const CTransaction& tx, CValidationState &state, co
             unsigned int vinSize = tx.GetVin().size();
             for (unsigned int i = 0; i < tx.GetVcswCcIn().size(); i++) {
                 const CScript& scriptPubKey = tx.GetVcswCcIn()[i].scriptPubKey();
-                if(!InputScriptCheck(scriptPubKey, tx, i + vinSize, chain, flags, cacheStore, state, pvChecks)) {
+                if(!InputScriptCheck(scriptPubKey, tx, i + vinSize, blockHashes, flags, cacheStore, state, pvChecks)) {
                     return false;
                 }
             }
@@ -2683,13 +3764,14 @@ bool ContextualCheckCertInputs(const CScCertificate& cert, CValidationState &sta
     // before the last block chain checkpoint. This is safe because block merkle hashes are
     // still computed and checked, and any change will be caught at the next checkpoint.
     if (fScriptChecks) {
+        const std::shared_ptr<const CChain> blockHashes = GetBlockHashSnapshot(chain);
         for (unsigned int i = 0; i < cert.GetVin().size(); i++) {
             const COutPoint &prevout = cert.GetVin()[i].prevout;
             const CCoins* coins = inputs.AccessCoins(prevout.hash);
             assert(coins);
 
             const CScript& scriptPubKey = coins->vout[cert.GetVin()[i].prevout.n].scriptPubKey;
-            if(!InputScriptCheck(scriptPubKey, cert, i, chain, flags, cacheStore, state, pvChecks)) {
+            if(!InputScriptCheck(scriptPubKey, cert, i, blockHashes, flags, cacheStore, state, pvChecks)) {
                 return false;
             }
         }
@@ -2700,23 +3782,19 @@ bool ContextualCheckCertInputs(const CScCertificate& cert, CValidationState &sta
 
 namespace {
 
-bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+bool UndoWriteToDisk(const CBlockUndo& blockundo, const std::vector<char>& vRecord, bool fCompressed, CDiskBlockPos& pos,
+                     const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
 {
+    LOCK(cs_LastBlockFile);
+
     // Open history file to append
-    CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
+    CAppendedFile fileout(blockFileWriter.Append(pos, true));
     if (fileout.IsNull())
         return error("%s: OpenUndoFile failed", __func__);
 
-    // Write index header
-    unsigned int nSize = fileout.GetSerializeSize(blockundo);
-    fileout << FLATDATA(messageStart) << nSize;
-
-    // Write undo data
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0)
-        return error("%s: ftell failed", __func__);
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
+    // Write index header and undo data
+    if (!WriteDiskRecord(fileout, vRecord, fCompressed, pos, messageStart))
+        return false;
 
     // calculate & write checksum
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
@@ -2724,21 +3802,43 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     hasher << blockundo;
     fileout << hasher.GetHash();
 
+    if (!fileout.Flush())
+        return error("%s: writing the undo data failed", __func__);
     return true;
 }
 
+/** Abort with a message */
+bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
+{
+    strMiscWarning = strMessage;
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(
+        userMessage.empty() ? _("Error: A fatal internal error occurred, see debug.log for details") : userMessage,
+        "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+    return false;
+}
+
+bool AbortNode(CValidationState& state, const std::string& strMessage, const std::string& userMessage="")
+{
+    AbortNode(strMessage, userMessage);
+    return state.Error(strMessage);
+}
+
+} // anon namespace
+
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("%s: OpenBlockFile failed", __func__);
+    CRawBlock record;
+    if (!ReadDiskRecord(pos, "rev", sizeof(uint256), MAX_SERIALIZED_COMPACT_SIZE, record))
+        return error("%s: reading the undo data failed", __func__);
 
-    // Read block
+    // Read undo data and checksum
     uint256 hashChecksum;
     try {
-        filein >> blockundo;
-        filein >> hashChecksum;
+        CSpanReader reader(record.begin(), record.size(), SER_DISK, CLIENT_VERSION);
+        reader >> blockundo;
+        reader >> hashChecksum;
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s", __func__, e.what());
@@ -2757,28 +3857,8 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
     return true;
 }
 
-/** Abort with a message */
-bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
-{
-    strMiscWarning = strMessage;
-    LogPrintf("*** %s\n", strMessage);
-    uiInterface.ThreadSafeMessageBox(
-        userMessage.empty() ? _("Error: A fatal internal error occurred, see debug.log for details") : userMessage,
-        "", CClientUIInterface::MSG_ERROR);
-    StartShutdown();
-    return false;
-}
-
-bool AbortNode(CValidationState& state, const std::string& strMessage, const std::string& userMessage="")
-{
-    AbortNode(strMessage, userMessage);
-    return state.Error(strMessage);
-}
-
-} // anon namespace
-
 bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, flagLevelDBIndexesWrite explorerIndexesWrite,
-                     bool* pfClean, std::vector<CScCertificateStatusUpdateInfo>* pCertsStateInfo)
+                     bool* pfClean, std::vector<CScCertificateStatusUpdateInfo>* pCertsStateInfo, CBlockUndo* pBlockUndo)
 {
     std::vector<std::pair<CAddressIndexKey, CAddressIndexValue>> addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> addressUnspentIndex;
@@ -2799,13 +3879,15 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
     if (block.nVersion != BLOCK_VERSION_SC_SUPPORT)
         includeSc = IncludeScAttributes::OFF;
 
-    CBlockUndo blockUndo(includeSc);
-
-    CDiskBlockPos pos = pindex->GetUndoPos();
-    if (pos.IsNull())
-        return error("DisconnectBlock(): no undo data available");
-    if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash()))
-        return error("DisconnectBlock(): failure reading undo data");
+    CBlockUndo blockUndoRead(includeSc);
+    if (!pBlockUndo) {
+        CDiskBlockPos pos = pindex->GetUndoPos();
+        if (pos.IsNull())
+            return error("DisconnectBlock(): no undo data available");
+        if (!UndoReadFromDisk(blockUndoRead, pos, pindex->pprev->GetBlockHash()))
+            return error("DisconnectBlock(): failure reading undo data");
+    }
+    CBlockUndo& blockUndo = pBlockUndo ? *pBlockUndo : blockUndoRead;
 
     if (blockUndo.vtxundo.size() != (block.vtx.size() - 1 + block.vcert.size()))
         return error("DisconnectBlock(): block and undo data inconsistent");
@@ -3193,47 +4275,92 @@ void static FlushBlockFile(bool fFinalize = false)
 {
     LOCK(cs_LastBlockFile);
 
-    CDiskBlockPos posOld(nLastBlockFile, 0);
-
-    FILE *fileOld = OpenBlockFile(posOld);
-    if (fileOld) {
-        if (fFinalize)
-            TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nSize);
-        FileCommit(fileOld);
-        fclose(fileOld);
+    if (fFinalize) {
+        // the file left is committed with the others on the next flush of the state, before the block index is written
+        blockFileWriter.Truncate(nLastBlockFile, false, vinfoBlockFile[nLastBlockFile].nSize);
+        blockFileWriter.Truncate(nLastBlockFile, true, vinfoBlockFile[nLastBlockFile].nUndoSize);
+        // no more blocks are written there, unlike the undo data of its blocks not connected yet
+        blockFileWriter.Close(nLastBlockFile, false);
+        return;
     }
 
-    fileOld = OpenUndoFile(posOld);
-    if (fileOld) {
-        if (fFinalize)
-            TruncateFile(fileOld, vinfoBlockFile[nLastBlockFile].nUndoSize);
-        FileCommit(fileOld);
-        fclose(fileOld);
-    }
+    blockFileWriter.Commit();
 }
 
 bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
-
 void ThreadScriptCheck() {
     RenameThread("horizen-scriptch");
     scriptcheckqueue.Thread();
 }
 
-//
-// Called periodically asynchronously; alerts if it smells like
-// we're being fed a bad chain (blocks being generated much
-// too slowly or too quickly).
-//
-void PartitionCheck(bool (*initialDownloadCheck)(), CCriticalSection& cs, const CBlockIndex *const &bestHeader,
-                    int64_t nPowTargetSpacing)
-{
-    if (bestHeader == NULL || initialDownloadCheck()) return;
+void ThreadBlockCheck() {
+    RenameThread("horizen-blockch");
+    blockcheckqueue.Thread();
+}
 
-    static int64_t lastAlertTime = 0;
-    int64_t now = GetTime();
-    if (lastAlertTime > now-60*60*24) return; // Alert at most once per day
+void ThreadCoinsPrefetch() {
+    RenameThread("horizen-prefetch");
+    coinsprefetchqueue.Thread();
+}
+
+/**
+ * Read into the coins tip cache, in parallel, the coins spent by the block and the sidechains it
+ * refers to, which ConnectBlock would otherwise read one at a time from the database as it goes.
+ */
+static void PrefetchBlockInputs(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+
+    if (nCoinsPrefetchThreads == 0)
+        return;
+
+    // the outputs created by the block itself are not in the database
+    std::set<uint256> setBlockHashes;
+    for (const CTransaction& tx : block.vtx)
+        setBlockHashes.insert(tx.GetHash());
+    for (const CScCertificate& cert : block.vcert)
+        setBlockHashes.insert(cert.GetHash());
+
+    std::vector<uint256> vTxids;
+    std::vector<uint256> vScIds;
+    auto addInputs = [&](const CTransactionBase& txBase) {
+        for (const CTxIn& in : txBase.GetVin())
+            if (!setBlockHashes.count(in.prevout.hash))
+                vTxids.push_back(in.prevout.hash);
+    };
+    for (const CTransaction& tx : block.vtx) {
+        if (tx.IsCoinBase())
+            continue;
+        addInputs(tx);
+        for (const CTxForwardTransferOut& ft : tx.GetVftCcOut())
+            vScIds.push_back(ft.GetScId());
+        for (const CBwtRequestOut& mbtr : tx.GetVBwtRequestOut())
+            vScIds.push_back(mbtr.GetScId());
+        for (const CTxCeasedSidechainWithdrawalInput& csw : tx.GetVcswCcIn())
+            vScIds.push_back(csw.scId);
+    }
+    for (const CScCertificate& cert : block.vcert) {
+        addInputs(cert);
+        vScIds.push_back(cert.GetScId());
+    }
+
+    pcoinsTip->Prefetch(vTxids, vScIds, &coinsprefetchqueue);
+}
+
+//
+// Called periodically asynchronously; alerts if it smells like
+// we're being fed a bad chain (blocks being generated much
+// too slowly or too quickly).
+//
+void PartitionCheck(bool (*initialDownloadCheck)(), CCriticalSection& cs, const CBlockIndex *const &bestHeader,
+                    int64_t nPowTargetSpacing)
+{
+    if (bestHeader == NULL || initialDownloadCheck()) return;
+
+    static int64_t lastAlertTime = 0;
+    int64_t now = GetTime();
+    if (lastAlertTime > now-60*60*24) return; // Alert at most once per day
 
     const int SPAN_HOURS=4;
     const int SPAN_SECONDS=SPAN_HOURS*60*60;
@@ -3290,10 +4417,56 @@ static int64_t nTimeIndex = 0;
 static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 
+/** The profiles of the last blocks connected to and disconnected from the tip, at most -blockconnectstats */
+static CCriticalSection cs_blockConnectStats;
+static std::deque<CBlockConnectStats> dequeBlockConnectStats;
+
+static MetricValue metricBlocksDisconnected("zen_blocks_disconnected_total", "Blocks disconnected from the tip");
+static MetricValue metricBlockConnectMicros("zen_block_connect_microseconds_total", "Time spent connecting blocks to the tip");
+static MetricValue metricBlocksConnected("zen_blocks_connected_total", "Blocks connected to the tip");
+
+static void RecordBlockConnectStats(const CBlockConnectStats& stats)
+{
+    if (stats.fDisconnect) {
+        metricBlocksDisconnected.Add();
+    } else {
+        metricBlocksConnected.Add();
+        metricBlockConnectMicros.Add(stats.nTimeTotal);
+    }
+
+    static const size_t nMaxStats = GetArg("-blockconnectstats", DEFAULT_BLOCK_CONNECT_STATS);
+    if (nMaxStats == 0)
+        return;
+    LOCK(cs_blockConnectStats);
+    if (dequeBlockConnectStats.size() >= nMaxStats)
+        dequeBlockConnectStats.pop_front();
+    dequeBlockConnectStats.push_back(stats);
+}
+
+void GetBlockConnectStats(std::vector<CBlockConnectStats>& vStats)
+{
+    LOCK(cs_blockConnectStats);
+    vStats.assign(dequeBlockConnectStats.begin(), dequeBlockConnectStats.end());
+}
+
+bool IsScProofAssumedValid(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    if (hashAssumeValidSc.IsNull() || pindex == nullptr || pindexBestHeader == nullptr)
+        return false;
+
+    // The assumed valid block must be known and on the best header chain: its ancestors are not
+    // spared their proof verification otherwise, and every other check is performed anyway.
+    BlockMap::const_iterator it = mapBlockIndex.find(hashAssumeValidSc);
+    return it != mapBlockIndex.end() &&
+        it->second->GetAncestor(pindex->nHeight) == pindex &&
+        pindexBestHeader->GetAncestor(it->second->nHeight) == it->second;
+}
+
 bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view,
     const CChain& chain, flagBlockProcessingType processingType, flagScRelatedChecks fScRelatedChecks,
     flagScProofVerification fScProofVerification, flagLevelDBIndexesWrite explorerIndexesWrite,
-    std::vector<CScCertificateStatusUpdateInfo>* pCertsStateInfo)
+    std::vector<CScCertificateStatusUpdateInfo>* pCertsStateInfo, CBlockConnectStats* pStats, CBlockUndo* pBlockUndo)
 {
     /**
      * When using CHECK_ONLY there is no need to write explorer indexes.
@@ -3314,6 +4487,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     {
         fScRelatedChecks = flagScRelatedChecks::OFF;
     }
+    const bool fBuildScTxsCommitment = fScRelatedChecks == flagScRelatedChecks::ON && !block.fScTxsCommitmentChecked;
 
     bool fExpensiveChecks = true;
     if (fCheckpointsEnabled) {
@@ -3324,11 +4498,18 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
     }
 
+    if (fScProofVerification == flagScProofVerification::ON && IsScProofAssumedValid(pindex)) {
+        LogPrint("cert", "%s():%d - skipping sc proofs verification of block %s, ancestor of assumed valid block %s\n",
+            __func__, __LINE__, pindex->GetBlockHash().ToString(), hashAssumeValidSc.ToString());
+        fScProofVerification = flagScProofVerification::OFF;
+    }
+
     bool pauseLowPrioZendooThread = (
         fExpensiveChecks &&
         fScRelatedChecks == flagScRelatedChecks::ON &&
         fScProofVerification == flagScProofVerification::ON &&
-        SidechainTxsCommitmentBuilder::getEmptyCommitment() != block.hashScTxsCommitment // no sc related tx/certs
+        SidechainTxsCommitmentBuilder::getEmptyCommitment() != block.hashScTxsCommitment && // no sc related tx/certs
+        !CScProofVerifierPool::GetInstance().HasReservedWorkers() // block proofs run on reserved workers
     );
 
     // if necessary pause rust low priority threads in order to speed up times
@@ -3382,10 +4563,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
 
     // Started enforcing CHECKBLOCKATHEIGHT from block.nVersion=4, that means for all the blocks
-    unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_CHECKLOCKTIMEVERIFY | SCRIPT_VERIFY_CHECKBLOCKATHEIGHT;
+    unsigned int flags = BLOCK_SCRIPT_VERIFY_FLAGS;
 
     // DERSIG (BIP66) is also always enforced, but does not have a flag.
 
+    // Hash of the tip the scripts are checked upon, for the script execution cache
+    const uint256 hashScriptTip = chain.Tip() ? chain.Tip()->GetBlockHash() : uint256();
+
     IncludeScAttributes includeSc = IncludeScAttributes::ON;
 
     if (block.nVersion != BLOCK_VERSION_SC_SUPPORT)
@@ -3540,8 +4724,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
             nFees += tx.GetFeeAmount(view.GetValueIn(tx));
 
+            // No script to run for the transactions already checked when accepted into the mempool
             std::vector<CScriptCheck> vChecks;
-            if (!ContextualCheckTxInputs(tx, state, view, fExpensiveChecks, chain, flags, false, chainparams.GetConsensus(), nScriptCheckThreads ? &vChecks : NULL))
+            const bool fScriptChecks = fExpensiveChecks && !IsScriptExecutionCached(tx.GetHash(), flags, hashScriptTip);
+            if (!ContextualCheckTxInputs(tx, state, view, fScriptChecks, chain, flags, false, chainparams.GetConsensus(), nScriptCheckThreads ? &vChecks : NULL))
                 return false;
 
             control.Add(vChecks);
@@ -3594,16 +4780,14 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
 
         BOOST_FOREACH(const JSDescription &joinsplit, tx.GetVjoinsplit()) {
-            BOOST_FOREACH(const uint256 &note_commitment, joinsplit.commitments) {
-                // Insert the note commitments into our temporary tree.
-                tree.append(note_commitment);
-            }
+            // Insert the note commitments into our temporary tree.
+            tree.append(joinsplit.commitments.begin(), joinsplit.commitments.end());
         }
 
         vTxIndexValues.push_back(std::make_pair(tx.GetHash(), CTxIndexValue(pos, txIdx, 0)));
         pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
 
-        if (fScRelatedChecks == flagScRelatedChecks::ON) {
+        if (fBuildScTxsCommitment) {
             bool retBuilder = scCommitmentBuilder.add(tx);
             if (!retBuilder && ForkManager::getInstance().isNonCeasingSidechainActive(pindex->nHeight))
                 return state.DoS(100, error("%s():%d: cannot add tx to scTxsCommitmentBuilder", __func__, __LINE__),
@@ -3675,8 +4859,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
         nFees += cert.GetFeeAmount(view.GetValueIn(cert));
 
+        // No script to run for the certificates already checked when accepted into the mempool
         std::vector<CScriptCheck> vChecks;
-        if (!ContextualCheckCertInputs(cert, state, view, fExpensiveChecks, chain, flags, false, chainparams.GetConsensus(), nScriptCheckThreads ? &vChecks : NULL))
+        const bool fScriptChecks = fExpensiveChecks && !IsScriptExecutionCached(cert.GetHash(), flags, hashScriptTip);
+        if (!ContextualCheckCertInputs(cert, state, view, fScriptChecks, chain, flags, false, chainparams.GetConsensus(), nScriptCheckThreads ? &vChecks : NULL))
             return false;
 
         control.Add(vChecks);
@@ -3811,7 +4997,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         vTxIndexValues.push_back(std::make_pair(cert.GetHash(), CTxIndexValue(pos, certIdx, certMaturityHeight)));
         pos.nTxOffset += cert.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
 
-        if (fScRelatedChecks == flagScRelatedChecks::ON)
+        if (fBuildScTxsCommitment)
         {
             bool retBuilder = scCommitmentBuilder.add(cert, view);
             if (!retBuilder && ForkManager::getInstance().isNonCeasingSidechainActive(pindex->nHeight))
@@ -3897,6 +5083,34 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                                  __func__, __LINE__, block.vtx[0].GetValueOut(), blockReward),
                         CValidationState::Code::INVALID, "bad-cb-amount");
 
+    // The sc txs commitment and the batch of sc proofs do not depend on the scripts, they are computed
+    // on their own threads while the script check queue drains, and joined before updating the state.
+    // Should the scripts fail, the futures of std::async still wait for their tasks before going out of scope.
+    int64_t deltaCommTreeTime = 0;
+    std::future<uint256> scTxsCommitmentFuture;
+    if (fBuildScTxsCommitment)
+    {
+        scTxsCommitmentFuture = std::async(std::launch::async, [&scCommitmentBuilder, &deltaCommTreeTime]() {
+            int64_t nCommTreeStartTime = GetTimeMicros();
+            const uint256 scTxsCommitment = scCommitmentBuilder.getCommitment();
+            deltaCommTreeTime = GetTimeMicros() - nCommTreeStartTime;
+            return scTxsCommitment;
+        });
+    }
+
+    int64_t deltaBatchVerifyTime = 0;
+    std::future<bool> scBatchVerifyFuture;
+    if (fScProofVerification == flagScProofVerification::ON)
+    {
+        LogPrint("sc", "%s():%d - calling scVerifier.BatchVerify()\n", __func__, __LINE__);
+        scBatchVerifyFuture = std::async(std::launch::async, [&scVerifier, &deltaBatchVerifyTime]() {
+            int64_t nBatchVerifyStartTime = GetTimeMicros();
+            const bool res = scVerifier.BatchVerify();
+            deltaBatchVerifyTime = GetTimeMicros() - nBatchVerifyStartTime;
+            return res;
+        });
+    }
+
     if (!control.Wait())
         return state.DoS(100, false);
 
@@ -3906,12 +5120,10 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     nTimeVerify += deltaVerifyTime;
     LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs] (nScriptCheckThreads=%d)\n", nInputs - 1, 0.001 * deltaVerifyTime, nInputs <= 1 ? 0 : 0.001 * deltaVerifyTime / (nInputs-1), nTimeVerify * 0.000001, nScriptCheckThreads);
 
-    if (fScRelatedChecks == flagScRelatedChecks::ON)
+    if (fBuildScTxsCommitment)
     {
-        int64_t nCommTreeStartTime = GetTimeMicros();
-        const uint256& scTxsCommitment = scCommitmentBuilder.getCommitment();
-        int64_t deltaCommTreeTime = GetTimeMicros() - nCommTreeStartTime;
-        LogPrint("bench", "    - txsCommTree: %.2fms\n", deltaCommTreeTime * 0.001);
+        const uint256 scTxsCommitment = scTxsCommitmentFuture.get();
+        LogPrint("bench", "    - txsCommTree: %.2fms (overlapped with script checks)\n", deltaCommTreeTime * 0.001);
 
         if (block.hashScTxsCommitment != scTxsCommitment)
         {
@@ -3928,17 +5140,16 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     if (fScProofVerification == flagScProofVerification::ON)
     {
-        LogPrint("sc", "%s():%d - calling scVerifier.BatchVerify()\n", __func__, __LINE__);
-        int64_t nBatchVerifyStartTime = GetTimeMicros();
-        if (!scVerifier.BatchVerify())
+        if (!scBatchVerifyFuture.get())
         {
             return state.DoS(100, error("%s():%d - ERROR: sc-related batch proof verification failed", __func__, __LINE__),
                             CValidationState::Code::INVALID_PROOF, "bad-sc-proof");
         }
-        int64_t deltaBatchVerifyTime = GetTimeMicros() - nBatchVerifyStartTime;
-        LogPrint("bench", "    - scBatchVerify: %.2fms\n", deltaBatchVerifyTime * 0.001);
+        LogPrint("bench", "    - scBatchVerify: %.2fms (overlapped with script checks)\n", deltaBatchVerifyTime * 0.001);
     }
 
+    LogPrint("bench", "    - Scripts, txsCommTree and scBatchVerify joined: %.2fms\n", 0.001 * (GetTimeMicros() - nTime1));
+
     int64_t nTime2b = GetTimeMicros();
 
     if (processingType == flagBlockProcessingType::CHECK_ONLY)
@@ -3952,9 +5163,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     {
         if (pindex->GetUndoPos().IsNull()) {
             CDiskBlockPos pos;
-            if (!FindUndoPos(state, pindex->nFile, pos, ::GetSerializeSize(blockundo, SER_DISK, CLIENT_VERSION) + 40))
+            std::vector<char> vUndoRecord;
+            bool fUndoCompressed = false;
+            EncodeDiskRecord(blockundo, vUndoRecord, fUndoCompressed);
+            if (!FindUndoPos(state, pindex->nFile, pos, vUndoRecord.size() + 40))
                 return error("%s():%d: FindUndoPos failed",__func__, __LINE__);
-            if (!UndoWriteToDisk(blockundo, pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
+            if (!UndoWriteToDisk(blockundo, vUndoRecord, fUndoCompressed, pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
                 return AbortNode(state, "Failed to write undo data");
 
             LogPrint("sc", "%s():%d - undo info written on disk\n", __func__, __LINE__);
@@ -3967,6 +5181,9 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         setDirtyBlockIndex.insert(pindex);
     }
 
+    if (pBlockUndo)
+        *pBlockUndo = blockundo;
+
     if (explorerIndexesWrite == flagLevelDBIndexesWrite::ON) {
         if (fTxIndex) {
             if (!pblocktree->WriteTxIndex(vTxIndexValues))
@@ -3996,26 +5213,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             }
         }
 
-        if (fTimestampIndex) {
-            unsigned int logicalTS = pindex->nTime;
-            unsigned int prevLogicalTS = 0;
-
-            // retrieve logical timestamp of the previous block
-            if (pindex->pprev)
-                if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                    LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
-
-            if (logicalTS <= prevLogicalTS) {
-                logicalTS = prevLogicalTS + 1;
-                LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
-            }
-
-            if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-                return AbortNode(state, "Failed to write timestamp index");
-
-            if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-                return AbortNode(state, "Failed to write blockhash index");
-        }
+        // the timestamp index is built by pTimestampIndexer, following the active chain
     }
 
     // add this block to the view's block chain
@@ -4024,6 +5222,34 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     int64_t nTime3 = GetTimeMicros(); nTimeIndex += nTime3 - nTime2b;
     LogPrint("bench", "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2b), nTimeIndex * 0.000001);
 
+    if (pStats != nullptr) {
+        pStats->nTimePreProc = deltaPreProcTime;
+        pStats->nTimeConnect = deltaConnectTime;
+        pStats->nTimeVerify = deltaVerifyTime;
+        pStats->nTimeCommTree = deltaCommTreeTime;
+        pStats->nTimeBatchVerify = deltaBatchVerifyTime;
+        pStats->nTimeIndex = nTime3 - nTime2b;
+        pStats->nTx = block.vtx.size();
+        pStats->nCerts = block.vcert.size();
+        pStats->nInputs = nInputs;
+
+        std::set<uint256> sScIds;
+        for (const CTransaction& tx: block.vtx) {
+            pStats->nCsws += tx.GetVcswCcIn().size();
+            for (const CTxScCreationOut& out: tx.GetVscCcOut())
+                sScIds.insert(out.GetScId());
+            for (const CTxForwardTransferOut& out: tx.GetVftCcOut())
+                sScIds.insert(out.GetScId());
+            for (const CBwtRequestOut& out: tx.GetVBwtRequestOut())
+                sScIds.insert(out.GetScId());
+            for (const CTxCeasedSidechainWithdrawalInput& in: tx.GetVcswCcIn())
+                sScIds.insert(in.scId);
+        }
+        for (const CScCertificate& cert: block.vcert)
+            sScIds.insert(cert.GetScId());
+        pStats->nSidechains = sScIds.size();
+    }
+
     // Watch for changes to the previous coinbase transaction.
     static uint256 hashPrevBestCoinBase;
     GetMainSignals().UpdatedTransaction(hashPrevBestCoinBase);
@@ -4031,6 +5257,8 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     int64_t nTime4 = GetTimeMicros(); nTimeCallbacks += nTime4 - nTime3;
     LogPrint("bench", "    - Callbacks: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeCallbacks * 0.000001);
+    if (pStats != nullptr)
+        pStats->nTimeCallbacks = nTime4 - nTime3;
 
     return true;
 }
@@ -4067,6 +5295,9 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                 pblocktree->WriteFlag("prunedblockfiles", true);
                 fHavePruned = true;
             }
+            // The block index entries are otherwise cleaned up by the pruning thread, after the flush below
+            if (!fBackgroundPruning)
+                PruneBlockFiles(setFilesToPrune);
         }
     }
     int64_t nNow = GetTimeMicros();
@@ -4107,18 +5338,32 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                 setDirtyFileInfo.erase(it++);
             }
             std::vector<const CBlockIndex*> vBlocks;
+            std::vector<CBlockIndex*> vWrittenBlocks;
             vBlocks.reserve(setDirtyBlockIndex.size());
+            vWrittenBlocks.reserve(setDirtyBlockIndex.size());
             for (set<CBlockIndex*>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end(); ) {
                 vBlocks.push_back(*it);
+                vWrittenBlocks.push_back(*it);
                 setDirtyBlockIndex.erase(it++);
             }
+            // the explorer indexes written asynchronously catch up before the block index they go with
+            if (!pblocktree->WaitForIndexWrites()) {
+                return AbortNode(state, "Failed to write to the explorer indexes");
+            }
             if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                 return AbortNode(state, "Files to write to block index database");
             }
+            // The solutions are now on disk, they are read back from there when needed
+            for (CBlockIndex* pindex : vWrittenBlocks)
+                pindex->TrimSolution();
         }
         // Finally remove any pruned files
-        if (fFlushForPrune)
-            UnlinkPrunedFiles(setFilesToPrune);
+        if (fFlushForPrune) {
+            if (fBackgroundPruning)
+                QueueFilesToPrune(setFilesToPrune);
+            else
+                UnlinkPrunedFiles(setFilesToPrune);
+        }
         nLastWrite = nNow;
     }
     // Flush best chain related state. This can only be done if the blocks / block index write was also done.
@@ -4131,7 +5376,16 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
             return state.Error("out of disk space");
         // Flush the chainstate (which may refer to block index entries).
-        if (!pcoinsTip->Flush())
+        // The adaptive cache keeps its hot entries, but when flushing on demand, typically before shutting down
+        if (fAdaptiveCoinsCache && mode != FLUSH_STATE_ALWAYS) {
+            const size_t nTargetUsage = (fCacheLarge || fCacheCritical) ? nCoinCacheUsage / 100 * COINS_CACHE_TRIM_PERCENT : nCoinCacheUsage;
+            if (!pcoinsTip->FlushAndTrim(nTargetUsage))
+                return AbortNode(state, "Failed to write to coin database");
+            LogPrint("coindb", "%s: coins cache trimmed from %u to %u bytes\n", __func__, cacheSize, pcoinsTip->DynamicMemoryUsage());
+        } else if (!pcoinsTip->Flush())
+            return AbortNode(state, "Failed to write to coin database");
+        // Periodic flushes complete in background, the explicit ones are on disk when returning
+        if (mode == FLUSH_STATE_ALWAYS && !pcoinsTip->Sync())
             return AbortNode(state, "Failed to write to coin database");
         nLastFlush = nNow;
     }
@@ -4180,26 +5434,87 @@ void static UpdateTip(CBlockIndex *pindexNew) {
     cvBlockChange.notify_all();
 }
 
+/**
+ * The last blocks connected to the tip with their undo data, at most -reorgcachesize and the tip last, so that a
+ * short reorg between competing tips disconnects them without reading from disk. Guarded by cs_main.
+ */
+struct CReorgCacheEntry
+{
+    uint256 hash;
+    CBlock block;
+    CBlockUndo undo;
+
+    CReorgCacheEntry(const CBlock& blockIn, const CBlockUndo& undoIn) : hash(blockIn.GetHash()), block(blockIn), undo(undoIn) {}
+};
+static std::deque<CReorgCacheEntry> dequeReorgCache;
+
+static void AddToReorgCache(const CBlock& block, const CBlockUndo& undo)
+{
+    static const size_t nMaxEntries = GetArg("-reorgcachesize", DEFAULT_REORG_CACHE_SIZE);
+    if (nMaxEntries == 0)
+        return;
+    if (dequeReorgCache.size() >= nMaxEntries)
+        dequeReorgCache.pop_front();
+    dequeReorgCache.emplace_back(block, undo);
+}
+
 /** Disconnect chainActive's tip. */
 bool static DisconnectTip(CValidationState &state) {
     CBlockIndex *pindexDelete = chainActive.Tip();
     assert(pindexDelete);
+    headerCache.Erase(pindexDelete->GetBlockHash());
     mempool.check(pcoinsTip);
-    // Read block from disk.
+    // Take the block and its undo data from the cache, or read them from disk.
+    int64_t nTimeRead = GetTimeMicros();
     CBlock block;
-    if (!ReadBlockFromDisk(block, pindexDelete))
-        return AbortNode(state, "Failed to read block");
+    CBlockUndo blockUndo(IncludeScAttributes::ON);
+    const bool fFromCache = !dequeReorgCache.empty() && dequeReorgCache.back().hash == pindexDelete->GetBlockHash();
+    if (fFromCache) {
+        block = std::move(dequeReorgCache.back().block);
+        blockUndo = std::move(dequeReorgCache.back().undo);
+        dequeReorgCache.pop_back();
+    } else {
+        // the cache follows the tip, what is left of it belongs to another chain
+        dequeReorgCache.clear();
+        if (!ReadBlockFromDisk(block, pindexDelete))
+            return AbortNode(state, "Failed to read block");
+        blockUndo = CBlockUndo(block.nVersion == BLOCK_VERSION_SC_SUPPORT ? IncludeScAttributes::ON : IncludeScAttributes::OFF);
+        CDiskBlockPos pos = pindexDelete->GetUndoPos();
+        if (pos.IsNull())
+            return error("DisconnectTip(): no undo data available");
+        if (!UndoReadFromDisk(blockUndo, pos, pindexDelete->pprev->GetBlockHash()))
+            return error("DisconnectTip(): failure reading undo data");
+    }
+    nTimeRead = GetTimeMicros() - nTimeRead;
+    LogPrint("bench", "- Load block and undo data%s: %.2fms\n", fFromCache ? " from the reorg cache" : " from disk", nTimeRead * 0.001);
     // Apply the block atomically to the chain state.
     uint256 anchorBeforeDisconnect = pcoinsTip->GetBestAnchor();
     int64_t nStart = GetTimeMicros();
     std::vector<CScCertificateStatusUpdateInfo> certsStateInfo;
     {
         CCoinsViewCache view(pcoinsTip);
-        if (!DisconnectBlock(block, state, pindexDelete, view, flagLevelDBIndexesWrite::ON, nullptr, &certsStateInfo))
+        if (!DisconnectBlock(block, state, pindexDelete, view, flagLevelDBIndexesWrite::ON, nullptr, &certsStateInfo, &blockUndo))
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         assert(view.Flush());
     }
-    LogPrint("bench", "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
+    // the sidechain events handled by the block are scheduled again
+    CSidechainEvents scEvents;
+    if (pcoinsTip->HaveSidechainEvents(pindexDelete->nHeight))
+        pcoinsTip->GetSidechainEvents(pindexDelete->nHeight, scEvents);
+    int64_t nTimeDisconnect = GetTimeMicros() - nStart;
+    LogPrint("bench", "- Disconnect block: %.2fms\n", nTimeDisconnect * 0.001);
+    {
+        CBlockConnectStats stats;
+        stats.hash = pindexDelete->GetBlockHash();
+        stats.nHeight = pindexDelete->nHeight;
+        stats.fDisconnect = true;
+        stats.fFromReorgCache = fFromCache;
+        stats.nTimeReadFromDisk = nTimeRead;
+        stats.nTimeTotal = nTimeDisconnect;
+        stats.nTx = block.vtx.size();
+        stats.nCerts = block.vcert.size();
+        RecordBlockConnectStats(stats);
+    }
 
     std::list<CTransaction> dummyTxs;
     std::list<CScCertificate> dummyCerts;
@@ -4231,7 +5546,7 @@ bool static DisconnectTip(CValidationState &state) {
         {
             LogPrint("sc", "%s():%d - removing tx [%s] from mempool\n[%s]\n",
                 __func__, __LINE__, tx.GetHash().ToString(), tx.ToString());
-            mempool.remove(tx, dummyTxs, dummyCerts, true);
+            mempool.remove(tx, dummyTxs, dummyCerts, true, MemPoolRemovalReason::REORG);
         }
     }
 
@@ -4247,7 +5562,7 @@ bool static DisconnectTip(CValidationState &state) {
             LogPrint("sc", "%s():%d - removing certificate [%s] from mempool\n[%s]\n",
                 __func__, __LINE__, cert.GetHash().ToString(), cert.ToString());
 
-            mempool.remove(cert, dummyTxs, dummyCerts, true);
+            mempool.remove(cert, dummyTxs, dummyCerts, true, MemPoolRemovalReason::REORG);
         }
     }
 
@@ -4269,6 +5584,7 @@ bool static DisconnectTip(CValidationState &state) {
 
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
+    GetMainSignals().BlockSyncBegin();
     for(const CTransaction &tx: block.vtx) {
         SyncWithWallets(tx, nullptr);
     }
@@ -4283,6 +5599,9 @@ bool static DisconnectTip(CValidationState &state) {
         SyncCertStatusUpdate(item);
     }
 
+    if (!scEvents.IsNull())
+        SyncSidechainEventsUpdate(pindexDelete->nHeight, scEvents, false);
+
     // Update cached incremental witnesses
     GetMainSignals().ChainTip(pindexDelete, &block, newTree, false);
     return true;
@@ -4292,19 +5611,23 @@ static int64_t nTimeReadFromDisk = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
+static int64_t nTimeMempoolRemoval = 0;
 static int64_t nTimePostConnect = 0;
 
 /**
  * Connect a new block to chainActive. pblock is either NULL or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
  */
-bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *pblock) {
+bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, const CBlock *pblock) {
     assert(pindexNew->pprev == chainActive.Tip());
     mempool.check(pcoinsTip);
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
     CBlock block;
-    if (!pblock) {
+    std::shared_ptr<const CBlock> pcachedBlock = recentBlockCache.GetBlock(pindexNew->GetBlockHash());
+    if (!pblock && pcachedBlock) {
+        pblock = pcachedBlock.get();
+    } else if (!pblock) {
         if (!ReadBlockFromDisk(block, pindexNew))
             return AbortNode(state, "Failed to read block");
         pblock = &block;
@@ -4316,11 +5639,24 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    CBlockConnectStats stats;
+    stats.hash = pindexNew->GetBlockHash();
+    stats.nHeight = pindexNew->nHeight;
+    stats.nTimeReadFromDisk = nTime2 - nTime1;
     std::vector<CScCertificateStatusUpdateInfo> certsStateInfo;
-    {
+    // the sidechain events of the height are erased while the block is connected
+    CSidechainEvents scEvents;
+    if (pcoinsTip->HaveSidechainEvents(pindexNew->nHeight))
+        pcoinsTip->GetSidechainEvents(pindexNew->nHeight, scEvents);
+    // reorgs are not expected in the initial download, the blocks are not cached for them
+    const bool fCacheForReorg = !IsInitialBlockDownload();
+    CBlockUndo blockUndo(IncludeScAttributes::ON);
+    {
+        PrefetchBlockInputs(*pblock);
         CCoinsViewCache view(pcoinsTip);
         bool rv = ConnectBlock(*pblock, state, pindexNew, view, chainActive, flagBlockProcessingType::COMPLETE,
-                               flagScRelatedChecks::ON, flagScProofVerification::ON, flagLevelDBIndexesWrite::ON, &certsStateInfo);
+                               flagScRelatedChecks::ON, flagScProofVerification::ON, flagLevelDBIndexesWrite::ON, &certsStateInfo,
+                               &stats, fCacheForReorg ? &blockUndo : nullptr);
         GetMainSignals().BlockChecked(*pblock, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -4330,31 +5666,41 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
         mapBlockSource.erase(pindexNew->GetBlockHash());
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
         LogPrint("bench", "  - Connect total: %.2fms [%.2fs]\n", (nTime3 - nTime2) * 0.001, nTimeConnectTotal * 0.000001);
+        stats.nTimeConnectTotal = nTime3 - nTime2;
         assert(view.Flush());
     }
     mapCumtreeHeight.insert(std::make_pair(pindexNew->scCumTreeHash.GetLegacyHash(), pindexNew->nHeight));
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
     LogPrint("bench", "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
+    stats.nTimeFlush = nTime4 - nTime3;
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(state, FLUSH_STATE_IF_NEEDED))
         return false;
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
     LogPrint("bench", "  - Writing chainstate: %.2fms [%.2fs]\n", (nTime5 - nTime4) * 0.001, nTimeChainState * 0.000001);
+    stats.nTimeChainState = nTime5 - nTime4;
 
     // Remove conflicting transactions from the mempool.
     std::list<CTransaction> removedTxs;
     std::list<CScCertificate> removedCerts;
-    mempool.removeForBlock(pblock->vtx, pindexNew->nHeight, removedTxs,  removedCerts, !IsInitialBlockDownload());
-    mempool.removeForBlock(pblock->vcert, pindexNew->nHeight, removedTxs, removedCerts);
-
-    mempool.removeStaleTransactions(pcoinsTip, removedTxs, removedCerts);
-    mempool.removeStaleCertificates(pcoinsTip, removedCerts);
+    mempool.removeForBlock(pblock->vtx, pblock->vcert, pindexNew->nHeight, pcoinsTip, removedTxs, removedCerts,
+                           !IsInitialBlockDownload());
+    int64_t nTime6 = GetTimeMicros(); nTimeMempoolRemoval += nTime6 - nTime5;
+    LogPrint("bench", "  - Mempool removal: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimeMempoolRemoval * 0.000001);
+    stats.nTimeMempoolRemoval = nTime6 - nTime5;
 
     mempool.check(pcoinsTip);
 
     UpdateTip(pindexNew); // Update chainActive & related variables.
+    if (fCacheForReorg) {
+        AddToReorgCache(*pblock, blockUndo);
+        // for the peers, the notifiers, the websocket, REST and the RPCs asking for the new tip
+        if (!pcachedBlock)
+            recentBlockCache.AddBlock(pindexNew->GetBlockHash(), std::make_shared<const CBlock>(*pblock));
+    }
 
     // Tell wallet about transactions and certificates that went from mempool to conflicted:
+    GetMainSignals().BlockSyncBegin();
     for(const CTransaction &tx: removedTxs) {
         SyncWithWallets(tx, nullptr);
     }
@@ -4383,14 +5729,20 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
         SyncCertStatusUpdate(item);
     }
 
+    if (!scEvents.IsNull())
+        SyncSidechainEventsUpdate(pindexNew->nHeight, scEvents, true);
+
     // Update cached incremental witnesses
     GetMainSignals().ChainTip(pindexNew, pblock, oldTree, true);
 
     EnforceNodeDeprecation(pindexNew->nHeight);
 
-    int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
-    LogPrint("bench", "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
-    LogPrint("bench", "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
+    int64_t nTime7 = GetTimeMicros(); nTimePostConnect += nTime7 - nTime6; nTimeTotal += nTime7 - nTime1;
+    LogPrint("bench", "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime7 - nTime6) * 0.001, nTimePostConnect * 0.000001);
+    LogPrint("bench", "- Connect block: %.2fms [%.2fs]\n", (nTime7 - nTime1) * 0.001, nTimeTotal * 0.000001);
+    stats.nTimePostConnect = nTime7 - nTime6;
+    stats.nTimeTotal = nTime7 - nTime1;
+    RecordBlockConnectStats(stats);
     return true;
 }
 
@@ -4466,6 +5818,73 @@ static void PruneBlockIndexCandidates() {
     assert(!setBlockIndexCandidates.empty());
 }
 
+bool LoadTxOutSetSnapshot(CAutoFile& file, const CTxOutSetSnapshotHeader& header, std::string& strError)
+{
+    AssertLockHeld(cs_main);
+
+    if (chainActive.Height() != 0) {
+        strError = "a snapshot can only be loaded by a node without blocks";
+        return false;
+    }
+    // The indexes are built while connecting blocks, which are skipped
+    if (fTxIndex || fAddressIndex || fTimestampIndex || fBlockFilterIndex || fScIndex || fSpentIndex || fMaturityHeightIndex) {
+        strError = "a snapshot cannot be loaded with block indexes enabled";
+        return false;
+    }
+    if (memcmp(header.pchMessageStart, Params().MessageStart(), sizeof(header.pchMessageStart)) != 0) {
+        strError = "the snapshot belongs to a different network";
+        return false;
+    }
+    if (header.nVersion != CTxOutSetSnapshotHeader::CURRENT_VERSION) {
+        strError = strprintf("unsupported snapshot version %d", header.nVersion);
+        return false;
+    }
+
+    BlockMap::iterator mi = mapBlockIndex.find(header.hashBlock);
+    if (mi == mapBlockIndex.end() || !mi->second->IsValid(BLOCK_VALID_TREE)) {
+        strError = strprintf("the header of the snapshot block %s is not known, wait for the headers to be synced",
+                             header.hashBlock.ToString());
+        return false;
+    }
+    CBlockIndex* pindex = mi->second;
+    if ((pindex->nStatus & BLOCK_FAILED_MASK) || pindex->nHeight != header.nHeight || header.nChainTx == 0) {
+        strError = strprintf("the snapshot block %s is invalid or does not match the snapshot", header.hashBlock.ToString());
+        return false;
+    }
+
+    mempool.clear();
+    FlushStateToDisk();
+
+    // Recorded first, so that a crash while loading does not leave a chainstate without its base
+    if (!pblocktree->WriteTxOutSetSnapshotBase(header.hashBlock, header.nChainTx)) {
+        strError = "failed to write to the block tree database";
+        return false;
+    }
+
+    if (!pcoinsdbview->LoadSnapshot(file, header, strError)) {
+        pblocktree->WriteTxOutSetSnapshotBase(uint256(), 0);
+        return false;
+    }
+    pcoinsTip->ResetBestBlock();
+
+    LogPrintf("%s():%d - loaded txout set snapshot at block %s height %d\n",
+              __func__, __LINE__, header.hashBlock.ToString(), header.nHeight);
+
+    // The snapshot block stands for the whole chain up to it
+    pindex->nChainTx = header.nChainTx;
+    pindex->nChainSproutValue = std::nullopt;
+    pindex->hashAnchorEnd = pcoinsTip->GetBestAnchor();
+    pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+    setDirtyBlockIndex.insert(pindex);
+    hashTxOutSetSnapshotBase = header.hashBlock;
+
+    UpdateTip(pindex);
+    setBlockIndexCandidates.insert(pindex);
+    PruneBlockIndexCandidates();
+    FlushStateToDisk();
+    return true;
+}
+
 /**
  * Try to make some progress towards making pindexMostWork the active block.
  * pblock is either NULL or a pointer to a CBlock corresponding to pindexMostWork.
@@ -4585,12 +6004,30 @@ bool ActivateBestChain(CValidationState &state, CBlock *pblock, bool &postponeRe
             // Don't relay blocks if pruning -- could cause a peer to try to download, resulting
             // in a stalled download if the block file is pruned before the request.
             if (nLocalServices & NODE_NETWORK) {
+                // The peers asking for it get the new tip straight away as a compact block, built once for all
+                const CInv invNewTip(MSG_BLOCK, hashNewTip);
+                const bool fHaveNewTip = pblock && pblock->GetHash() == hashNewTip;
+                std::unique_ptr<CSharedMessage> pcmpctblock;
                 LOCK(cs_vNodes);
                 BOOST_FOREACH(CNode* pnode, vNodes)
                 {
                     if (chainActive.Height() > (pnode->nStartingHeight != -1 ? pnode->nStartingHeight - 2000 : nBlockEstimate))
                     {
-                        pnode->PushInventory(CInv(MSG_BLOCK, hashNewTip));
+                        bool fKnown = true;
+                        if (fHaveNewTip && pnode->fPreferHeaderAndIDs) {
+                            LOCK(pnode->cs_inventory);
+                            fKnown = pnode->IsInventoryKnown(invNewTip);
+                        }
+                        if (!fKnown) {
+                            if (!pcmpctblock)
+                                pcmpctblock.reset(new CSharedMessage("cmpctblock", CBlockHeaderAndShortTxIDs(*pblock)));
+                            LogPrint("cmpctblock", "%s():%d - Pushing compact block [%s] to peer=%d\n", __func__, __LINE__,
+                                hashNewTip.ToString(), pnode->GetId());
+                            pnode->PushSharedMessage(*pcmpctblock);
+                            pnode->AddInventoryKnown(invNewTip);
+                        }
+                        else
+                            pnode->PushInventory(invNewTip);
                     }
                     else
                     {
@@ -4711,7 +6148,7 @@ bool addToGlobalForkTips(const CBlockIndex* pindex)
             __func__, __LINE__, pindex->nHeight, pindex->GetBlockHash().ToString());
     }
 
-    return mGlobalForkTips.insert(std::make_pair( pindex, (int)GetTime() )).second;
+    return mGlobalForkTips.insert(pindex, (int)GetTime());
 }
 
 bool updateGlobalForkTips(const CBlockIndex* pindex, bool lookForwardTips)
@@ -4733,7 +6170,7 @@ bool updateGlobalForkTips(const CBlockIndex* pindex, bool lookForwardTips)
     {
         LogPrint("forks", "%s():%d - updating tip in global set: h(%d) [%s]\n",
             __func__, __LINE__, pindex->nHeight, pindex->GetBlockHash().ToString());
-        mGlobalForkTips[pindex] = (int)GetTime();
+        mGlobalForkTips.Update(pindex, (int)GetTime());
         return true;
     }
     else
@@ -4744,6 +6181,7 @@ bool updateGlobalForkTips(const CBlockIndex* pindex, bool lookForwardTips)
         {
             int h = pindex->nHeight;
             bool done = false;
+            std::vector<const CBlockIndex*> vTipsToUpdate;
 
             BOOST_FOREACH(auto mapPair, mGlobalForkTips)
             {
@@ -4760,27 +6198,25 @@ bool updateGlobalForkTips(const CBlockIndex* pindex, bool lookForwardTips)
                     continue;
                 }
 
-                const CBlockIndex* dum = tipIndex;
-                while ( dum != pindex && dum->nHeight >= h)
-                {
-                    dum = dum->pprev;
-                }
-
-                if (dum == pindex)
+                // through the skip list, rather than all the blocks between the tip and the header
+                if (tipIndex->GetAncestor(h) == pindex)
                 {
                     LogPrint("forks", "%s():%d - updating tip access time in global set: h(%d) [%s]\n",
                         __func__, __LINE__, tipIndex->nHeight, tipIndex->GetBlockHash().ToString());
-                    mGlobalForkTips[tipIndex] = (int)GetTime();
+                    vTipsToUpdate.push_back(tipIndex);
                     done |= true;
                 }
                 else
                 {
                     // we must neglect this branch since not linked to the pindex
-                    LogPrint("forks", "%s():%d - stopped at %s h(%d)\n",
-                        __func__, __LINE__, dum->GetBlockHash().ToString(), dum->nHeight);
+                    LogPrint("forks", "%s():%d - tip not descending from h(%d)\n", __func__, __LINE__, h);
                 }
             }
 
+            // not while iterating on the tips, their order by time changes
+            for (const CBlockIndex* tipIndex : vTipsToUpdate)
+                mGlobalForkTips.Update(tipIndex, (int)GetTime());
+
             LogPrint("forks", "%s():%d - exiting done[%d]\n", __func__, __LINE__, done);
             return done;
         }
@@ -4794,21 +6230,58 @@ bool updateGlobalForkTips(const CBlockIndex* pindex, bool lookForwardTips)
 
 int getMostRecentGlobalForkTips(std::vector<uint256>& output)
 {
-    using map_pair = pair<const CBlockIndex*, int>;
+    std::vector<const CBlockIndex*> vTips;
+    mGlobalForkTips.GetMostRecent(MAX_NUM_GLOBAL_FORKS, vTips);
+    for (const CBlockIndex* pindex : vTips)
+        output.push_back(pindex->GetBlockHash());
 
-    std::vector<map_pair> vTemp(begin(mGlobalForkTips), end(mGlobalForkTips));
+    return output.size();
+}
 
-    sort(begin(vTemp), end(vTemp), [](const map_pair& a, const map_pair& b) { return a.second < b.second; });
+int CGlobalForkTips::operator[](const CBlockIndex* pindex) const
+{
+    const_iterator it = mapTips.find(pindex);
+    return it != mapTips.end() ? it->second : 0;
+}
 
-    int count = MAX_NUM_GLOBAL_FORKS;
-    BOOST_REVERSE_FOREACH(auto const &p, vTemp)
-    {
-        output.push_back(p.first->GetBlockHash() );
-        if (--count <= 0)
-            break;
+bool CGlobalForkTips::insert(const CBlockIndex* pindex, int nTime)
+{
+    if (!mapTips.insert(std::make_pair(pindex, nTime)).second)
+        return false;
+    setByTime.insert(std::make_pair(nTime, pindex));
+    return true;
+}
+
+size_t CGlobalForkTips::erase(const CBlockIndex* pindex)
+{
+    BlockTimeMap::iterator it = mapTips.find(pindex);
+    if (it == mapTips.end())
+        return 0;
+    setByTime.erase(std::make_pair(it->second, pindex));
+    mapTips.erase(it);
+    return 1;
+}
+
+void CGlobalForkTips::clear()
+{
+    mapTips.clear();
+    setByTime.clear();
+}
+
+void CGlobalForkTips::Update(const CBlockIndex* pindex, int nTime)
+{
+    std::pair<BlockTimeMap::iterator, bool> ret = mapTips.insert(std::make_pair(pindex, nTime));
+    if (!ret.second) {
+        setByTime.erase(std::make_pair(ret.first->second, pindex));
+        ret.first->second = nTime;
     }
+    setByTime.insert(std::make_pair(nTime, pindex));
+}
 
-    return output.size();
+void CGlobalForkTips::GetMostRecent(size_t nMax, std::vector<const CBlockIndex*>& vTips) const
+{
+    for (auto it = setByTime.rbegin(); it != setByTime.rend() && vTips.size() < nMax; ++it)
+        vTips.push_back(it->second);
 }
 
 CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
@@ -4820,8 +6293,7 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
-    assert(pindexNew);
+    CBlockIndex* pindexNew = blockIndexArena.Create(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -4972,10 +6444,12 @@ bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned int nAdd
     }
 
     vinfoBlockFile.at(nFile).AddBlock(nHeight, nTime);
+    const unsigned int nOldSize = vinfoBlockFile.at(nFile).nSize;
     if (fKnown)
         vinfoBlockFile.at(nFile).nSize = std::max(pos.nPos + nAddSize, vinfoBlockFile.at(nFile).nSize);
     else
         vinfoBlockFile.at(nFile).nSize += nAddSize;
+    metricBlockFilesBytes.Add(vinfoBlockFile.at(nFile).nSize - nOldSize);
 
     if (!fKnown) {
         unsigned int nOldChunks = (pos.nPos + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
@@ -4984,11 +6458,16 @@ bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned int nAdd
             if (fPruneMode)
                 fCheckForPruning = true;
             if (CheckDiskSpace(nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos)) {
-                FILE *file = OpenBlockFile(pos);
-                if (file) {
-                    LogPrintf("Pre-allocating up to position 0x%x in blk%05u.dat\n", nNewChunks * BLOCKFILE_CHUNK_SIZE, pos.nFile);
-                    AllocateFileRange(file, pos.nPos, nNewChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos);
-                    fclose(file);
+                FILE *file = blockFileWriter.Open(pos.nFile, false);
+                // the chunks are allocated BLOCKFILE_PREALLOC_CHUNKS at a time, the file is only as long as that
+                long nAllocated = file && fseek(file, 0, SEEK_END) == 0 ? ftell(file) : 0;
+                if (file && nAllocated < (long)(nNewChunks * BLOCKFILE_CHUNK_SIZE)) {
+                    const unsigned int nMaxChunks = (MAX_BLOCKFILE_SIZE + BLOCKFILE_CHUNK_SIZE - 1) / BLOCKFILE_CHUNK_SIZE;
+                    unsigned int nAllocChunks = std::max(nNewChunks, std::min(nOldChunks + BLOCKFILE_PREALLOC_CHUNKS, nMaxChunks));
+                    if (!CheckDiskSpace(nAllocChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos))
+                        nAllocChunks = nNewChunks;
+                    LogPrintf("Pre-allocating up to position 0x%x in blk%05u.dat\n", nAllocChunks * BLOCKFILE_CHUNK_SIZE, pos.nFile);
+                    AllocateFileRange(file, pos.nPos, nAllocChunks * BLOCKFILE_CHUNK_SIZE - pos.nPos);
                 }
             }
             else
@@ -5009,6 +6488,7 @@ bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigne
     unsigned int nNewSize;
     pos.nPos = vinfoBlockFile[nFile].nUndoSize;
     nNewSize = vinfoBlockFile[nFile].nUndoSize += nAddSize;
+    metricBlockFilesBytes.Add(nAddSize);
     setDirtyFileInfo.insert(nFile);
 
     unsigned int nOldChunks = (pos.nPos + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
@@ -5017,11 +6497,10 @@ bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigne
         if (fPruneMode)
             fCheckForPruning = true;
         if (CheckDiskSpace(nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos)) {
-            FILE *file = OpenUndoFile(pos);
+            FILE *file = blockFileWriter.Open(pos.nFile, true);
             if (file) {
                 LogPrintf("Pre-allocating up to position 0x%x in rev%05u.dat\n", nNewChunks * UNDOFILE_CHUNK_SIZE, pos.nFile);
                 AllocateFileRange(file, pos.nPos, nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos);
-                fclose(file);
             }
         }
         else
@@ -5051,6 +6530,166 @@ bool CheckBlockHeader(const CBlockHeader& block, CValidationState& state, flagCh
     return true;
 }
 
+/**
+ * Check the Equihash solutions and the proof of work of a batch of headers, the solutions being checked
+ * all at once on the block check threads. The headers marked in vSkip, already known, are not checked.
+ * Returns the index of the first invalid header, its state in state, or headers.size() if all are valid.
+ */
+static size_t CheckBlockHeadersPoW(const std::vector<CBlockHeader>& headers, const std::vector<bool>& vSkip, CValidationState& state)
+{
+    std::vector<const CBlockHeader*> vpToCheck;
+    for (size_t i = 0; i < headers.size(); i++) {
+        if (!vSkip[i])
+            vpToCheck.push_back(&headers[i]);
+    }
+
+    {
+        TRY_LOCK(cs_blockcheckqueue, lockQueue);
+        CheckEquihashSolutions(vpToCheck, Params(), nScriptCheckThreads > 1 && lockQueue ? &blockcheckqueue : NULL);
+    }
+
+    // the valid solutions are cached now, this only runs the other checks, and finds the first invalid header
+    for (size_t i = 0; i < headers.size(); i++) {
+        if (!vSkip[i] && !CheckBlockHeader(headers[i], state, flagCheckPow::ON))
+            return i;
+    }
+    return headers.size();
+}
+
+/**
+ * Run the context-free checks of the transactions and certificates of a block.
+ * When there are check threads, the checks are spread over them, each one with its own
+ * CValidationState. The results are then examined in block order, running serially the
+ * checks skipped after a failure, so that the error reported is always the one of the first
+ * invalid transaction or certificate, as with the serial checks.
+ *
+ * When the proofs are verified, the PHGR proofs of the joinsplits are gathered by the checks
+ * of the transactions and verified afterwards in batches, which are spread over the check
+ * threads too. The transactions of a batch that fails are checked again serially, with their
+ * proofs verified one by one.
+ */
+/**
+ * Verify the PHGR proofs gathered by the checks of the transactions of a block, in as many batches
+ * as check threads. The transactions whose proofs are not all verified are marked as not checked,
+ * which also includes the invalid ones with proofs: as their proofs were not verified, they might
+ * not fail for the reason the serial checks would give.
+ */
+static void VerifyBlockProofBatches(const std::vector<libzcash::PHGRProofBatch>& vProofBatches, std::vector<int>& vResults, bool fParallel)
+{
+    std::vector<size_t> vTxsWithProofs;
+    for (size_t i = 0; i < vProofBatches.size(); i++) {
+        if (vProofBatches[i].size() == 0)
+            continue;
+        if (vResults[i] == 1)
+            vTxsWithProofs.push_back(i);
+        else
+            vResults[i] = -1;
+    }
+    if (vTxsWithProofs.empty())
+        return;
+
+    // each batch takes a contiguous range of the transactions
+    const size_t nBatches = fParallel ? std::min<size_t>(nScriptCheckThreads, vTxsWithProofs.size()) : 1;
+    auto verifyBatch = [&](size_t n) -> bool {
+        const size_t nBegin = n * vTxsWithProofs.size() / nBatches;
+        const size_t nEnd = (n + 1) * vTxsWithProofs.size() / nBatches;
+        libzcash::PHGRProofBatch batch;
+        for (size_t j = nBegin; j < nEnd; j++)
+            batch.append(vProofBatches[vTxsWithProofs[j]]);
+        if (!batch.verify()) {
+            for (size_t j = nBegin; j < nEnd; j++)
+                vResults[vTxsWithProofs[j]] = -1;
+        }
+        return true;
+    };
+
+    if (nBatches > 1)
+    {
+        CCheckQueueControl<CCheckJob> control(&blockcheckqueue);
+        std::vector<CCheckJob> vChecks;
+        vChecks.reserve(nBatches);
+        for (size_t n = 0; n < nBatches; n++)
+            vChecks.push_back(CCheckJob(std::bind(verifyBatch, n)));
+        control.Add(vChecks);
+        control.Wait();
+    }
+    else
+    {
+        verifyBatch(0);
+    }
+}
+
+static bool CheckBlockTxsAndCerts(const CBlock& block, CValidationState& state, libzcash::ProofVerifier& verifier)
+{
+    const size_t nTxs = block.vtx.size();
+    const size_t nChecks = nTxs + block.vcert.size();
+    const bool fBatchProofs = verifier.isVerificationEnabled();
+
+    // -1 not run yet, 0 failed, 1 passed
+    std::vector<int> vResults(nChecks, -1);
+    std::vector<CValidationState> vStates(nChecks);
+    std::vector<libzcash::PHGRProofBatch> vProofBatches(fBatchProofs ? nTxs : 0);
+    auto runCheck = [&](size_t i, bool fBatch) -> bool {
+        bool fOk;
+        if (i >= nTxs) {
+            fOk = CheckCertificate(block.vcert[i - nTxs], vStates[i]);
+        } else if (fBatch) {
+            auto batchVerifier = libzcash::ProofVerifier::Batched(vProofBatches[i]);
+            fOk = CheckTransaction(block.vtx[i], vStates[i], batchVerifier);
+        } else {
+            vStates[i] = CValidationState();
+            fOk = CheckTransaction(block.vtx[i], vStates[i], verifier);
+        }
+        vResults[i] = fOk ? 1 : 0;
+        return fOk;
+    };
+
+    TRY_LOCK(cs_blockcheckqueue, lockQueue);
+    const bool fParallel = nScriptCheckThreads > 1 && nChecks > 1 && lockQueue;
+    if (fParallel)
+    {
+        CCheckQueueControl<CCheckJob> control(&blockcheckqueue);
+        std::vector<CCheckJob> vChecks;
+        vChecks.reserve(nChecks);
+        for (size_t i = 0; i < nChecks; i++)
+            vChecks.push_back(CCheckJob(std::bind(runCheck, i, fBatchProofs)));
+        control.Add(vChecks);
+        control.Wait();
+    }
+    else if (fBatchProofs)
+    {
+        // the proofs of the transactions after the first invalid one are not needed
+        for (size_t i = 0; i < nTxs && runCheck(i, true); i++) {}
+    }
+
+    if (fBatchProofs)
+        VerifyBlockProofBatches(vProofBatches, vResults, fParallel);
+
+    auto checkFailed = [&](size_t i) -> bool {
+        if (vResults[i] == -1)
+            runCheck(i, false);
+        if (vResults[i] == 1)
+            return false;
+        state = vStates[i];
+        return true;
+    };
+
+    for (size_t i = 0; i < nTxs; i++) {
+        if (checkFailed(i))
+            return error("CheckBlock(): CheckTransaction failed");
+    }
+
+    if(!CheckCertificatesOrdering(block.vcert, state))
+        return error("CheckBlock(): Certificate quality ordering check failed");
+
+    for (size_t i = nTxs; i < nChecks; i++) {
+        if (checkFailed(i))
+            return error("CheckBlock(): Certificate check failed");
+    }
+
+    return true;
+}
+
 bool CheckBlock(const CBlock& block, CValidationState& state,
                 libzcash::ProofVerifier& verifier,
                 flagCheckPow fCheckPOW, flagCheckMerkleRoot fCheckMerkleRoot)
@@ -5065,7 +6704,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state,
     // Check the merkle root.
     if (fCheckMerkleRoot == flagCheckMerkleRoot::ON) {
         bool mutated;
-        uint256 hashMerkleRoot2 = block.BuildMerkleTree(&mutated);
+        uint256 hashMerkleRoot2 = block.ComputeMerkleRoot(&mutated);
         if (block.hashMerkleRoot != hashMerkleRoot2)
             return state.DoS(100, error("CheckBlock(): hashMerkleRoot mismatch"),
                              CValidationState::Code::INVALID, "bad-txnmrklroot", true);
@@ -5115,21 +6754,8 @@ bool CheckBlock(const CBlock& block, CValidationState& state,
                              CValidationState::Code::INVALID, "bad-cb-multiple");
 
     // Check transactions and certificates
-    for(const CTransaction& tx: block.vtx) {
-        if (!CheckTransaction(tx, state, verifier)) {
-            return error("CheckBlock(): CheckTransaction failed");
-        }
-    }
-
-    if(!CheckCertificatesOrdering(block.vcert, state))
-        return error("CheckBlock(): Certificate quality ordering check failed");
-
-    for(const CScCertificate& cert: block.vcert)
-    {
-        if (!CheckCertificate(cert, state)) {
-            return error("CheckBlock(): Certificate check failed");
-        }
-    }
+    if (!CheckBlockTxsAndCerts(block, state, verifier))
+        return false;
 
     unsigned int nSigOps = 0;
     for(const CTransaction& tx: block.vtx) {
@@ -5293,7 +6919,8 @@ bool ContextualCheckBlock(const CBlock& block, CValidationState& state, CBlockIn
     return true;
 }
 
-bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex** ppindex, bool lookForwardTips)
+bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex** ppindex, bool lookForwardTips,
+                       flagCheckPow fCheckPOW)
 {
     dump_global_tips(10);
 
@@ -5317,7 +6944,7 @@ bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBloc
         return true;
     }
 
-    if (!CheckBlockHeader(block, state))
+    if (!CheckBlockHeader(block, state, fCheckPOW))
         return false;
 
     // Get prev block index
@@ -5380,7 +7007,7 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
 
     // See method docstring for why this is always disabled
     auto verifier = libzcash::ProofVerifier::Disabled();
-    if ((!CheckBlock(block, state, verifier)) || !ContextualCheckBlock(block, state, pindex->pprev)) {
+    if ((!block.fChecked && !CheckBlock(block, state, verifier)) || !ContextualCheckBlock(block, state, pindex->pprev)) {
         if (state.IsInvalid() && !state.CorruptionPossible()) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
             setDirtyBlockIndex.insert(pindex);
@@ -5392,15 +7019,29 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
 
     // Write block to history file
     try {
-        unsigned int nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+        // a block already on disk is known by its position, any other is encoded to reserve its room
+        std::vector<char> vBlockRecord;
+        std::vector<char> vBlockData;
+        bool fBlockCompressed = false;
+        unsigned int nBlockSize = 0;
+        if (dbp == NULL) {
+            EncodeDiskRecord(block, vBlockRecord, fBlockCompressed, &vBlockData);
+            nBlockSize = vBlockRecord.size();
+        } else
+            nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
         CDiskBlockPos blockPos;
         if (dbp != NULL)
             blockPos = *dbp;
         if (!FindBlockPos(state, blockPos, nBlockSize+8, nHeight, block.GetBlockTime(), dbp != NULL))
             return error("AcceptBlock(): FindBlockPos failed");
-        if (dbp == NULL)
-            if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart()))
+        if (dbp == NULL) {
+            if (!WriteBlockToDisk(vBlockRecord, fBlockCompressed, blockPos, chainparams.MessageStart()))
                 AbortNode(state, "Failed to write block");
+            // kept for the notifiers, as the block is likely the tip connected next
+            if (!fBlockCompressed)
+                vBlockData.swap(vBlockRecord);
+            recentBlockCache.AddRaw(pindex->GetBlockHash(), std::make_shared<const std::vector<char> >(std::move(vBlockData)));
+        }
         if (!ReceivedBlockTransactions(block, state, pindex, blockPos, sForkTips))
             return error("AcceptBlock(): ReceivedBlockTransactions failed");
     } catch (const std::runtime_error& e) {
@@ -5417,7 +7058,7 @@ bool ProcessNewBlock(CValidationState &state, CNode* pfrom, CBlock* pblock, bool
 {
     // Preliminary checks
     auto verifier = libzcash::ProofVerifier::Disabled();
-    bool checked = CheckBlock(*pblock, state, verifier);
+    bool checked = pblock->fChecked || CheckBlock(*pblock, state, verifier);
 
     BlockSet sForkTips;
 
@@ -5448,6 +7089,21 @@ bool ProcessNewBlock(CValidationState &state, CNode* pfrom, CBlock* pblock, bool
         {
             return error("%s: AcceptBlock FAILED", __func__);
         }
+
+        // A block not extending the tip is going to be connected later on (if ever): start verifying the proofs
+        // of its certificates, the block connection will then find them in the proof verification cache.
+        if (pindex && pindex->pprev != chainActive.Tip() && !pblock->vcert.empty() &&
+            GetBoolArg("-scspeculativeproofverification", true))
+        {
+            CBlockIndex* pindexLastCheckpoint = fCheckpointsEnabled ? Checkpoints::GetLastCheckpoint(Params().Checkpoints()) : nullptr;
+
+            // Proofs of blocks that are ancestors of a checkpoint are not verified at all
+            if (!pindexLastCheckpoint || pindexLastCheckpoint->GetAncestor(pindex->nHeight) != pindex)
+            {
+                CCoinsViewCache view(pcoinsTip);
+                CScAsyncProofVerifier::GetInstance().LoadBlockForSpeculativeVerification(view, *pblock);
+            }
+        }
     }
 
     bool postponeRelay = false;
@@ -5515,12 +7171,17 @@ uint64_t CalculateCurrentUsage()
     return retval;
 }
 
-/* Prune a block file (modify associated database entries)*/
-void PruneOneBlockFile(const int fileNumber)
+/* Prune block files (modify associated database entries), walking the block index once for all of them */
+void PruneBlockFiles(const std::set<int>& setFiles)
 {
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_LastBlockFile);
+    if (setFiles.empty())
+        return;
+
     for (BlockMap::iterator it = mapBlockIndex.begin(); it != mapBlockIndex.end(); ++it) {
         CBlockIndex* pindex = it->second;
-        if (pindex->nFile == fileNumber) {
+        if (setFiles.count(pindex->nFile)) {
             pindex->nStatus &= ~BLOCK_HAVE_DATA;
             pindex->nStatus &= ~BLOCK_HAVE_UNDO;
             pindex->nFile = 0;
@@ -5543,8 +7204,11 @@ void PruneOneBlockFile(const int fileNumber)
         }
     }
 
-    vinfoBlockFile[fileNumber].SetNull();
-    setDirtyFileInfo.insert(fileNumber);
+    for (int fileNumber : setFiles) {
+        vinfoBlockFile[fileNumber].SetNull();
+        setDirtyFileInfo.insert(fileNumber);
+    }
+    metricBlockFilesBytes.Set(CalculateCurrentUsage());
 }
 
 
@@ -5552,6 +7216,12 @@ void UnlinkPrunedFiles(std::set<int>& setFilesToPrune)
 {
     for (set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        {
+            LOCK(cs_LastBlockFile);
+            blockFileWriter.Discard(*it);
+        }
+        blockFileMapper.Forget(GetBlockPosFilename(pos, "blk"));
+        blockFileMapper.Forget(GetBlockPosFilename(pos, "rev"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -5571,6 +7241,9 @@ void FindFilesToPrune(std::set<int>& setFilesToPrune)
 
     unsigned int nLastBlockWeCanPrune = chainActive.Tip()->nHeight - MIN_BLOCKS_TO_KEEP;
     uint64_t nCurrentUsage = CalculateCurrentUsage();
+    // the files the pruning thread is still to delete are as good as pruned
+    for (int fileNumber : setFilesPruning)
+        nCurrentUsage -= vinfoBlockFile[fileNumber].nSize + vinfoBlockFile[fileNumber].nUndoSize;
     // We don't check to prune until after we've allocated new space for files
     // So we should leave a buffer under our target to account for another allocation
     // before the next pruning.
@@ -5582,7 +7255,7 @@ void FindFilesToPrune(std::set<int>& setFilesToPrune)
         for (int fileNumber = 0; fileNumber < nLastBlockFile; fileNumber++) {
             nBytesToPrune = vinfoBlockFile[fileNumber].nSize + vinfoBlockFile[fileNumber].nUndoSize;
 
-            if (vinfoBlockFile[fileNumber].nSize == 0)
+            if (vinfoBlockFile[fileNumber].nSize == 0 || setFilesPruning.count(fileNumber))
                 continue;
 
             if (nCurrentUsage + nBuffer < nPruneTarget)  // are we below our target?
@@ -5592,7 +7265,6 @@ void FindFilesToPrune(std::set<int>& setFilesToPrune)
             if (vinfoBlockFile[fileNumber].nHeightLast > nLastBlockWeCanPrune)
                 continue;
 
-            PruneOneBlockFile(fileNumber);
             // Queue up the files for removal
             setFilesToPrune.insert(fileNumber);
             nCurrentUsage -= nBytesToPrune;
@@ -5606,13 +7278,84 @@ void FindFilesToPrune(std::set<int>& setFilesToPrune)
            nLastBlockWeCanPrune, count);
 }
 
-bool CheckDiskSpace(uint64_t nAdditionalBytes)
+void QueueFilesToPrune(const std::set<int>& setFilesToPrune)
 {
-    uint64_t nFreeBytesAvailable = boost::filesystem::space(GetDataDir()).available;
+    AssertLockHeld(cs_LastBlockFile);
+    setFilesPruning.insert(setFilesToPrune.begin(), setFilesToPrune.end());
+    {
+        boost::unique_lock<boost::mutex> lock(csPruneQueue);
+        setPruneQueue.insert(setFilesToPrune.begin(), setFilesToPrune.end());
+    }
+    condPruneQueue.notify_one();
+}
 
-    // Check for nMinDiskSpace bytes (currently 50MB)
-    if (nFreeBytesAvailable < nMinDiskSpace + nAdditionalBytes)
-        return AbortNode("Disk space is low!", _("Error: Disk space is low!"));
+void ThreadPruneBlockFiles()
+{
+    RenameThread("horizen-prune");
+    fBackgroundPruning = true;
+    try {
+        while (true) {
+            std::set<int> setFiles;
+            {
+                boost::unique_lock<boost::mutex> lock(csPruneQueue);
+                while (setPruneQueue.empty())
+                    condPruneQueue.wait(lock);
+                setFiles.swap(setPruneQueue);
+            }
+
+            // FlushStateToDisk queued the files holding cs_main, so the chainstate it flushed is on disk by now
+            {
+                LOCK2(cs_main, cs_LastBlockFile);
+                PruneBlockFiles(setFiles);
+
+                std::vector<std::pair<int, const CBlockFileInfo*> > vFiles;
+                for (int fileNumber : setFiles) {
+                    vFiles.push_back(make_pair(fileNumber, &vinfoBlockFile[fileNumber]));
+                    setDirtyFileInfo.erase(fileNumber);
+                }
+                std::vector<const CBlockIndex*> vBlocks;
+                for (set<CBlockIndex*>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end(); ) {
+                    if ((*it)->nStatus & BLOCK_HAVE_DATA) {
+                        ++it;
+                        continue;
+                    }
+                    vBlocks.push_back(*it);
+                    setDirtyBlockIndex.erase(it++);
+                }
+                // the block index must stop pointing to the files before they are deleted
+                if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
+                    AbortNode("Failed to write to block index database");
+                    fBackgroundPruning = false;
+                    return;
+                }
+            }
+
+            UnlinkPrunedFiles(setFiles);
+            metricPrunedBlockFiles.Add(setFiles.size());
+
+            LOCK(cs_LastBlockFile);
+            for (int fileNumber : setFiles)
+                setFilesPruning.erase(fileNumber);
+        }
+    } catch (const boost::thread_interrupted&) {
+        fBackgroundPruning = false;
+        // the files still queued are left on disk with their blocks, for the next pruning to pick them again
+        LOCK(cs_LastBlockFile);
+        boost::unique_lock<boost::mutex> lock(csPruneQueue);
+        for (int fileNumber : setPruneQueue)
+            setFilesPruning.erase(fileNumber);
+        setPruneQueue.clear();
+        throw;
+    }
+}
+
+bool CheckDiskSpace(uint64_t nAdditionalBytes)
+{
+    uint64_t nFreeBytesAvailable = boost::filesystem::space(GetDataDir()).available;
+
+    // Check for nMinDiskSpace bytes (currently 50MB)
+    if (nFreeBytesAvailable < nMinDiskSpace + nAdditionalBytes)
+        return AbortNode("Disk space is low!", _("Error: Disk space is low!"));
 
     return true;
 }
@@ -5664,9 +7407,7 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    if (!pindexNew)
-        throw runtime_error("LoadBlockIndex(): new CBlockIndex failed");
+    CBlockIndex* pindexNew = blockIndexArena.Create();
     mi = mapBlockIndex.insert(make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -5681,6 +7422,10 @@ bool static LoadBlockIndexDB()
 
     boost::this_thread::interruption_point();
 
+    uint64_t nSnapshotChainTx = 0;
+    hashTxOutSetSnapshotBase.SetNull();
+    pblocktree->ReadTxOutSetSnapshotBase(hashTxOutSetSnapshotBase, nSnapshotChainTx);
+
     // Calculate nChainWork
     vector<pair<int, CBlockIndex*> > vSortedByHeight;
     vSortedByHeight.reserve(mapBlockIndex.size());
@@ -5715,6 +7460,9 @@ bool static LoadBlockIndexDB()
                 pindex->nChainTx = pindex->nTx;
                 pindex->nChainSproutValue = pindex->nSproutValue;
             }
+        } else if (pindex->GetBlockHash() == hashTxOutSetSnapshotBase) {
+            // The transactions of the chain up to a loaded snapshot are known only by their number
+            pindex->nChainTx = nSnapshotChainTx;
         }
         if (pindex->IsValid(BLOCK_VALID_TRANSACTIONS) && (pindex->nChainTx || pindex->pprev == NULL))
             setBlockIndexCandidates.insert(pindex);
@@ -5744,6 +7492,7 @@ bool static LoadBlockIndexDB()
             break;
         }
     }
+    metricBlockFilesBytes.Set(CalculateCurrentUsage());
 
     // Check presence of blk files
     LogPrintf("Checking all blk files are present...\n");
@@ -5789,10 +7538,27 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
+    // Build the balances of an address index from before they were kept along with it
+    bool fAddressBalances = false;
+    pblocktree->ReadFlag("addressbalances", fAddressBalances);
+    if (fAddressIndex && !fAddressBalances) {
+        LogPrintf("%s: building the address balances\n", __func__);
+        if (!pblocktree->BuildAddressBalances() || !pblocktree->WriteFlag("addressbalances", true))
+            return error("%s: failed to build the address balances", __func__);
+    }
+
     // Check whether we have a timestamp index
     pblocktree->ReadFlag("timestampindex", fTimestampIndex);
     LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
 
+    // Check whether we have a block filter index
+    pblocktree->ReadFlag("blockfilterindex", fBlockFilterIndex);
+    LogPrintf("%s: block filter index %s\n", __func__, fBlockFilterIndex ? "enabled" : "disabled");
+
+    // Check whether we have a sidechain activity index
+    pblocktree->ReadFlag("scindex", fScIndex);
+    LogPrintf("%s: sidechain activity index %s\n", __func__, fScIndex ? "enabled" : "disabled");
+
     // Check whether we have a spent index
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
@@ -5831,6 +7597,8 @@ bool static LoadBlockIndexDB()
     return true;
 }
 
+CVerifyDBProgress verifyDBProgress;
+
 CVerifyDB::CVerifyDB()
 {
     uiInterface.ShowProgress(_("Verifying blocks..."), 0);
@@ -5841,116 +7609,293 @@ CVerifyDB::~CVerifyDB()
     uiInterface.ShowProgress("", 100);
 }
 
-bool CVerifyDB::VerifyDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth)
+/**
+ * Levels 0 to 2 of VerifyDB for vBlocks, from the tip down, on parallel threads reading ahead of each other. The blocks
+ * are taken in order, so the ones verified before the deadline are the first ones. cs_main is held by the caller.
+ *
+ * @param nProgressEnd  the progress shown once all the blocks are verified
+ * @return the number of blocks verified, -1 on a failure
+ */
+static int VerifyBlocksData(const std::vector<CBlockIndex*>& vBlocks, int nCheckLevel, int64_t nDeadline, int nProgressEnd)
 {
-    LOCK(cs_main);
-    if (chainActive.Tip() == NULL || chainActive.Tip()->pprev == NULL)
-        return true;
+    std::atomic<size_t> nextBlock(0);
+    std::atomic<size_t> nVerified(0);
+    std::atomic<bool> fFailed(false);
+
+    auto VerifyBlocks = [&](bool fShowProgress) {
+        // No need to verify JoinSplits twice
+        auto verifier = libzcash::ProofVerifier::Disabled();
+        while (!fFailed && !ShutdownRequested() && (nDeadline == 0 || GetTimeMillis() < nDeadline)) {
+            const size_t n = nextBlock++;
+            if (n >= vBlocks.size())
+                break;
+            const CBlockIndex* pindex = vBlocks[n];
+            CBlock block;
+            CValidationState state;
+            // check level 0: read from disk
+            if (!ReadBlockFromDisk(block, pindex)) {
+                fFailed = true;
+                error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+                break;
+            }
+            // check level 1: verify block validity
+            if (nCheckLevel >= 1 && !CheckBlock(block, state, verifier)) {
+                fFailed = true;
+                error("VerifyDB(): *** found bad block at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+                break;
+            }
+            // check level 2: verify undo validity
+            if (nCheckLevel >= 2) {
+                IncludeScAttributes includeSc = IncludeScAttributes::ON;
 
-    // Verify blocks in the best chain
-    if (nCheckDepth <= 0)
-        nCheckDepth = 1000000000; // suffices until the year 19000
-    if (nCheckDepth > chainActive.Height())
-        nCheckDepth = chainActive.Height();
-    nCheckLevel = std::max(0, std::min(4, nCheckLevel));
-    LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
+                if (block.nVersion != BLOCK_VERSION_SC_SUPPORT)
+                    includeSc = IncludeScAttributes::OFF;
+
+                CBlockUndo undo(includeSc);
+
+                CDiskBlockPos pos = pindex->GetUndoPos();
+                if (!pos.IsNull() && !UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash())) {
+                    fFailed = true;
+                    error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
+                    break;
+                }
+            }
+            ++nVerified;
+            if (fShowProgress)
+                uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, (int)(nVerified * nProgressEnd / vBlocks.size()))));
+        }
+    };
+
+    int64_t nStart = GetTimeMicros();
+    boost::thread_group threads;
+    const int nThreads = std::max(1, std::min(GetNumCores(), MAX_VERIFYDB_THREADS));
+    for (int i = 1; i < nThreads; ++i)
+        threads.create_thread([&VerifyBlocks]() { VerifyBlocks(false); });
+    VerifyBlocks(true);
+    threads.join_all();
+
+    if (fFailed)
+        return -1;
+    LogPrint("bench", "%s: %u blocks verified on %d threads in %.2fms\n", __func__, nVerified, nThreads, (GetTimeMicros() - nStart) * 0.001);
+    return std::min(nextBlock.load(), vBlocks.size());
+}
+
+/**
+ * Levels 3 and 4 of VerifyDB for the last nCheckDepth blocks up to pindexTip, the best block of coinsview, taking cs_main
+ * for a block at a time. The checks stop, setting fStopped, once the deadline is over or if the best block of coinsview
+ * moves, or leaves the active chain, meanwhile: the memory-only view would not be on top of it any more.
+ */
+static bool VerifyCoinsDB(CCoinsView *coinsview, CBlockIndex* pindexTip, int nCheckLevel, int nCheckDepth, int64_t nDeadline,
+                          bool fShowProgress, bool& fStopped)
+{
     CCoinsViewCache coins(coinsview);
-    CBlockIndex* pindexState = chainActive.Tip();
+    const uint256 hashTip = pindexTip->GetBlockHash();
+    CBlockIndex* pindexState = pindexTip;
     CBlockIndex* pindexFailure = NULL;
     int nGoodTransactions = 0;
     CValidationState state;
-    // No need to verify JoinSplits twice
-    auto verifier = libzcash::ProofVerifier::Disabled();
-    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev)
-    {
-        boost::this_thread::interruption_point();
-        uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100)))));
-        if (pindex->nHeight < chainActive.Height()-nCheckDepth)
-            break;
-        CBlock block;
-        // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex))
-            return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-        // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state, verifier))
-            return error("VerifyDB(): *** found bad block at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
-        // check level 2: verify undo validity
-        if (nCheckLevel >= 2 && pindex) {
-
-            IncludeScAttributes includeSc = IncludeScAttributes::ON;
-
-            if (block.nVersion != BLOCK_VERSION_SC_SUPPORT)
-                includeSc = IncludeScAttributes::OFF;
-
-            CBlockUndo undo(includeSc);
-
-            CDiskBlockPos pos = pindex->GetUndoPos();
-            if (!pos.IsNull()) {
-                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash()))
-                    return error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
-            }
-        }
-        // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
-        if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
-            bool fClean = true;
-            if (!DisconnectBlock(block, state, pindex, coins, flagLevelDBIndexesWrite::OFF, &fClean, nullptr))
-                return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-            pindexState = pindex->pprev;
-            if (!fClean) {
-                nGoodTransactions = 0;
-                pindexFailure = pindex;
-            } else
-                nGoodTransactions += block.vtx.size() + block.vcert.size();
-        }
+    fStopped = false;
+
+    auto Stop = [&]() {
+        AssertLockHeld(cs_main);
+        if (ShutdownRequested() || (nDeadline != 0 && GetTimeMillis() >= nDeadline) ||
+            coinsview->GetBestBlock() != hashTip || !chainActive.Contains(pindexTip))
+            fStopped = true;
+        return fStopped;
+    };
 
-        if (ShutdownRequested())
+    // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
+    for (int n = 0; n < nCheckDepth && pindexState->pprev; n++) {
+        boost::this_thread::interruption_point();
+        LOCK(cs_main);
+        if (Stop())
             return true;
+        if (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage() > nCoinCacheUsage)
+            break;
+        if (fShowProgress)
+            uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, 50 + n * (nCheckLevel >= 4 ? 25 : 50) / nCheckDepth)));
 
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindexState))
+            return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindexState->nHeight, pindexState->GetBlockHash().ToString());
+        bool fClean = true;
+        if (!DisconnectBlock(block, state, pindexState, coins, flagLevelDBIndexesWrite::OFF, &fClean, nullptr))
+            return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindexState->nHeight, pindexState->GetBlockHash().ToString());
+        if (!fClean) {
+            nGoodTransactions = 0;
+            pindexFailure = pindexState;
+        } else
+            nGoodTransactions += block.vtx.size() + block.vcert.size();
+        pindexState = pindexState->pprev;
+        verifyDBProgress.nBlocksDisconnected++;
     }
 
     if (pindexFailure)
-        return error("VerifyDB(): *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", chainActive.Height() - pindexFailure->nHeight + 1, nGoodTransactions);
+        return error("VerifyDB(): *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", pindexTip->nHeight - pindexFailure->nHeight + 1, nGoodTransactions);
 
     // check level 4: try reconnecting blocks
     if (nCheckLevel >= 4) {
         CBlockIndex *pindex = pindexState;
-        CHistoricalChain chainHistorical(chainActive, pindex->nHeight - 1);
-        while (pindex != chainActive.Tip()) {
+        std::unique_ptr<CHistoricalChain> pchainHistorical;
+        while (pindex != pindexTip) {
             boost::this_thread::interruption_point();
-            uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, 100 - (int)(((double)(chainActive.Height() - pindex->nHeight)) / (double)nCheckDepth * 50))));
-            pindex = chainActive.Next(pindex);
+            LOCK(cs_main);
+            if (Stop())
+                return true;
+            if (fShowProgress)
+                uiInterface.ShowProgress(_("Verifying blocks..."), std::max(1, std::min(99, 100 - (int)(((double)(pindexTip->nHeight - pindex->nHeight)) / (double)nCheckDepth * 25))));
+            pindex = pindexTip->GetAncestor(pindex->nHeight + 1);
             CBlock block;
 
             if (!ReadBlockFromDisk(block, pindex))
                 return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
 
-            chainHistorical.SetHeight(pindex->nHeight - 1);
+            if (!pchainHistorical)
+                pchainHistorical.reset(new CHistoricalChain(chainActive, pindex->nHeight - 1));
+            pchainHistorical->SetHeight(pindex->nHeight - 1);
 
-            if (!ConnectBlock(block, state, pindex, coins, chainHistorical, flagBlockProcessingType::COMPLETE,
+            if (!ConnectBlock(block, state, pindex, coins, *pchainHistorical, flagBlockProcessingType::COMPLETE,
                               flagScRelatedChecks::ON, flagScProofVerification::ON, flagLevelDBIndexesWrite::OFF))
                 return error("VerifyDB(): *** found unconnectable block at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+            verifyDBProgress.nBlocksReconnected++;
         }
     }
 
-    LogPrintf("No coin database inconsistencies in last %i blocks (%i transactions)\n", chainActive.Height() - pindexState->nHeight, nGoodTransactions);
+    LogPrintf("No coin database inconsistencies in last %i blocks (%i transactions)\n", pindexTip->nHeight - pindexState->nHeight, nGoodTransactions);
+
+    return true;
+}
+
+bool CVerifyDB::VerifyDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth, int64_t nTimeBudget, bool fDeferCoinsChecks)
+{
+    LOCK(cs_main);
+    nCheckedDepth = 0;
+    if (chainActive.Tip() == NULL || chainActive.Tip()->pprev == NULL)
+        return true;
+
+    const int64_t nDeadline = nTimeBudget > 0 ? GetTimeMillis() + nTimeBudget * 1000 : 0;
+
+    // Verify blocks in the best chain
+    if (nCheckDepth <= 0)
+        nCheckDepth = 1000000000; // suffices until the year 19000
+    if (nCheckDepth > chainActive.Height())
+        nCheckDepth = chainActive.Height();
+    nCheckLevel = std::max(0, std::min(4, nCheckLevel));
+    LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
+
+    std::vector<CBlockIndex*> vBlocks;
+    for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev; pindex = pindex->pprev)
+    {
+        if (pindex->nHeight < chainActive.Height()-nCheckDepth)
+            break;
+        // The blocks up to a loaded txout set snapshot are not available
+        if (!hashTxOutSetSnapshotBase.IsNull() && !(pindex->nStatus & BLOCK_HAVE_DATA))
+            break;
+        vBlocks.push_back(pindex);
+    }
+
+    verifyDBProgress = CVerifyDBProgress();
+    verifyDBProgress.strState = "running";
+    verifyDBProgress.nCheckLevel = nCheckLevel;
+    verifyDBProgress.nCheckDepth = vBlocks.size();
+
+    const bool fCoinsChecks = nCheckLevel >= 3 && !fDeferCoinsChecks;
+    const int nVerified = VerifyBlocksData(vBlocks, nCheckLevel, nDeadline, fCoinsChecks ? 50 : 100);
+    if (nVerified < 0) {
+        verifyDBProgress.strState = "failed";
+        return false;
+    }
+    nCheckedDepth = nVerified;
+    verifyDBProgress.nBlocksChecked = nVerified;
+    if (ShutdownRequested())
+        return true;
+    if (nVerified < (int)vBlocks.size())
+        LogPrintf("VerifyDB(): -checkblocksseconds=%d over, %d of the last %d blocks verified\n", nTimeBudget, nVerified, vBlocks.size());
+
+    if (nCheckLevel >= 3 && fDeferCoinsChecks && nVerified > 0) {
+        // ThreadVerifyCoinsDB takes over
+        verifyDBProgress.strState = "background";
+        return true;
+    }
 
+    bool fStopped = false;
+    if (fCoinsChecks && nVerified > 0 && !VerifyCoinsDB(coinsview, chainActive.Tip(), nCheckLevel, nVerified, nDeadline, true, fStopped)) {
+        verifyDBProgress.strState = "failed";
+        return false;
+    }
+    verifyDBProgress.strState = fStopped || nVerified < (int)vBlocks.size() ? "stopped" : "done";
     return true;
 }
 
+void ThreadVerifyCoinsDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth)
+{
+    RenameThread("horizen-verifydb");
+
+    CBlockIndex* pindexTip = NULL;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator it = mapBlockIndex.find(coinsview->GetBestBlock());
+        if (it == mapBlockIndex.end() || !chainActive.Contains(it->second)) {
+            verifyDBProgress.strState = "stopped";
+            return;
+        }
+        pindexTip = it->second;
+    }
+
+    LogPrintf("%s: verifying the coins database against the last %d blocks at level %d\n", __func__, nCheckDepth, nCheckLevel);
+    bool fStopped = false;
+    bool fOk = false;
+    try {
+        fOk = VerifyCoinsDB(coinsview, pindexTip, nCheckLevel, nCheckDepth, 0, false, fStopped);
+    } catch (const boost::thread_interrupted&) {
+        LOCK(cs_main);
+        verifyDBProgress.strState = "stopped";
+        throw;
+    }
+
+    {
+        LOCK(cs_main);
+        verifyDBProgress.strState = !fOk ? "failed" : fStopped ? "stopped" : "done";
+    }
+    if (!fOk)
+        AbortNode("VerifyDB(): coins database inconsistent with the blocks", _("Corrupted block database detected, restart with -reindex"));
+    else if (fStopped)
+        LogPrintf("%s: stopped, the coins database moved on meanwhile\n", __func__);
+}
+
+//! Empties mapBlockIndex, destroying its entries, also the ones allocated on their own
+static void ClearBlockIndexEntries()
+{
+    for (BlockMap::value_type& entry : mapBlockIndex) {
+        if (!blockIndexArena.Owns(entry.second))
+            delete entry.second;
+    }
+    mapBlockIndex.clear();
+    blockIndexArena.Clear();
+}
+
 void UnloadBlockIndex()
 {
     LOCK(cs_main);
+    {
+        LOCK(cs_LastBlockFile);
+        blockFileWriter.CloseAll();
+    }
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
+    dequeReorgCache.clear();
+    hashTxOutSetSnapshotBase.SetNull();
     mempool.clear();
-    mapOrphanTransactions.clear();
-    mapOrphanTransactionsByPrev.clear();
+    ClearOrphanTxs();
     nSyncStarted = 0;
+    vHeadersRanges.clear();
+    fHeadersRangesCreated = false;
     mapBlocksUnlinked.clear();
     vinfoBlockFile.clear();
     nLastBlockFile = 0;
+    blockFileMapper.Clear();
     nBlockSequenceId = 1;
     mapBlockSource.clear();
     mapBlocksInFlight.clear();
@@ -5961,10 +7906,7 @@ void UnloadBlockIndex()
     mapNodeState.clear();
     recentRejects.reset(NULL);
 
-    BOOST_FOREACH(BlockMap::value_type& entry, mapBlockIndex) {
-        delete entry.second;
-    }
-    mapBlockIndex.clear();
+    ClearBlockIndexEntries();
     fHavePruned = false;
 }
 
@@ -6006,11 +7948,20 @@ bool InitBlockIndex() {
     // Use the provided setting for -addressindex in the new database
     fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
     pblocktree->WriteFlag("addressindex", fAddressIndex);
+    pblocktree->WriteFlag("addressbalances", fAddressIndex);
 
     // Use the provided setting for -timestampindex in the new database
     fTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
     pblocktree->WriteFlag("timestampindex", fTimestampIndex);
 
+    // Use the provided setting for -blockfilterindex in the new database
+    fBlockFilterIndex = GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+    pblocktree->WriteFlag("blockfilterindex", fBlockFilterIndex);
+
+    // Use the provided setting for -scindex in the new database
+    fScIndex = GetBoolArg("-scindex", DEFAULT_SCINDEX);
+    pblocktree->WriteFlag("scindex", fScIndex);
+
     fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
     pblocktree->WriteFlag("spentindex", fSpentIndex);
 
@@ -6052,6 +8003,7 @@ CBlock LoadBlockFrom(CBufferedFile& blkdat, CDiskBlockPos* pLastLoadedBlkPos)
         return res;
 
     int blkSize = -1;
+    uint32_t nSizeField = 0;
 
     //locate Header
     for(uint64_t nRewind = blkdat.GetPos(); !blkdat.eof() && (blkSize == -1);)
@@ -6069,11 +8021,10 @@ CBlock LoadBlockFrom(CBufferedFile& blkdat, CDiskBlockPos* pLastLoadedBlkPos)
             if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
                 continue; // just first byte of magic number matches. Keep searching
 
-            blkdat >> blkSize; // read size
-            if (blkSize < 80 || blkSize > MAX_BLOCK_SIZE) {
-                blkSize = -1;
+            blkdat >> nSizeField; // read size
+            if (!IsBlockRecordSize(nSizeField))
                 continue; // while whole magic number matches, it can't be block size. Keep searching
-            }
+            blkSize = nSizeField & ~DISK_RECORD_COMPRESSED;
         } catch (const std::exception&) {
             // no valid block header found; don't complain
             break;
@@ -6089,7 +8040,7 @@ CBlock LoadBlockFrom(CBufferedFile& blkdat, CDiskBlockPos* pLastLoadedBlkPos)
     blkdat.SetLimit(blkStartPos + blkSize);
     blkdat.SetPos(blkStartPos);
     try {
-        blkdat >> res;
+        ReadBlockRecord(blkdat, nSizeField, res);
     } catch (const std::exception& e) {
         LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
     }
@@ -6098,29 +8049,67 @@ CBlock LoadBlockFrom(CBufferedFile& blkdat, CDiskBlockPos* pLastLoadedBlkPos)
     return res;
 }
 
-bool LoadBlocksFromExternalFile(FILE* fileIn, CDiskBlockPos *dbp, bool loadHeadersOnly)
-{
-    const CChainParams& chainparams = Params();
-    // Map of disk positions for blocks with unknown parent (only used for reindex)
-    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
-    int64_t nStart = GetTimeMillis();
+/** The most bytes of block records read ahead by CBlockFileLoader and not yet processed */
+static const size_t BLOCK_LOAD_MAX_BYTES_IN_FLIGHT = 32 << 20;
+/** The most block records read ahead by CBlockFileLoader and not yet processed */
+static const size_t BLOCK_LOAD_MAX_ITEMS_IN_FLIGHT = 1000;
+/** The most threads deserializing and checking the blocks read by CBlockFileLoader */
+static const int BLOCK_LOAD_MAX_PARSER_THREADS = 8;
 
-    int nLoadedHeaders = 0;
-    int nLoadedBlocks = 0;
+/**
+ * The blocks of a block file, for LoadBlocksFromExternalFile, as a pipeline: a reader thread
+ * scans the file sequentially for block records, parser threads deserialize them and run
+ * CheckBlock (when loading the whole blocks), and the caller gets them in file order with Next()
+ * to process them. Reading ahead stops beyond BLOCK_LOAD_MAX_BYTES_IN_FLIGHT bytes or
+ * BLOCK_LOAD_MAX_ITEMS_IN_FLIGHT records not yet processed, bounding the memory used.
+ */
+class CBlockFileLoader
+{
+public:
+    struct Item
+    {
+        //! The position of the block in the file
+        unsigned int nPos;
+        //! The record size, see DISK_RECORD_COMPRESSED
+        uint32_t nSizeField;
+        std::vector<char> vStored;
+        //! The size of vStored, which is freed once parsed
+        size_t nStoredSize;
+        //! The block, with only its header if loading the headers; null if it could not be deserialized
+        std::shared_ptr<CBlock> pblock;
+        bool fParsed;
+
+        Item() : nPos(0), nSizeField(0), nStoredSize(0), fParsed(false) {}
+    };
 
-    try
+private:
+    CBufferedFile blkdat;
+    const bool fHeadersOnly;
+
+    boost::mutex mutex;
+    boost::condition_variable condReader;
+    boost::condition_variable condParser;
+    boost::condition_variable condConsumer;
+    //! The records being parsed or waiting to be processed, by sequence number in the file
+    std::map<uint64_t, Item> mapItems;
+    uint64_t nNextRead;
+    uint64_t nNextParse;
+    uint64_t nNextConsume;
+    size_t nBytesInFlight;
+    bool fReadDone;
+    bool fStop;
+    boost::thread_group threadGroup;
+
+    //! Read the next block record from blkdat into item, false at the end of the file
+    bool ReadRecord(Item& item)
     {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
         while (!blkdat.eof())
         {
-            boost::this_thread::interruption_point();
-
             blkdat.SetPos(nRewind);
             nRewind++; // start one byte further next time, in case of failure
             blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
+            uint32_t nSizeField = 0;
             try {
                 // locate a header
                 unsigned char buf[MESSAGE_START_SIZE];
@@ -6130,24 +8119,183 @@ bool LoadBlocksFromExternalFile(FILE* fileIn, CDiskBlockPos *dbp, bool loadHeade
                 if (memcmp(buf, Params().MessageStart(), MESSAGE_START_SIZE))
                     continue; //only first byte of magic number matches. Keep searching...
                 // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SIZE)
+                blkdat >> nSizeField;
+                if (!IsBlockRecordSize(nSizeField))
                     continue; //magic number matches but size can't be block one. Keep searching...
             } catch (const std::exception&) {
                 // no valid block header found; don't complain
-                break;
+                return false;
+            }
+            try {
+                // read record
+                item.nPos = blkdat.GetPos();
+                item.nSizeField = nSizeField;
+                item.nStoredSize = nSizeField & ~DISK_RECORD_COMPRESSED;
+                item.vStored.resize(item.nStoredSize);
+                blkdat.SetLimit(item.nPos + item.nStoredSize);
+                if (item.nStoredSize > 0)
+                    blkdat.read(&item.vStored[0], item.nStoredSize);
+                return true;
+            } catch (const std::exception& e) {
+                LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+            }
+        }
+        return false;
+    }
+
+    void ThreadRead()
+    {
+        Item item;
+        while (ReadRecord(item))
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!fStop && nNextRead > nNextConsume &&
+                   (nBytesInFlight >= BLOCK_LOAD_MAX_BYTES_IN_FLIGHT || nNextRead - nNextConsume >= BLOCK_LOAD_MAX_ITEMS_IN_FLIGHT))
+                condReader.wait(lock);
+            if (fStop)
+                return;
+            nBytesInFlight += item.nStoredSize;
+            std::swap(mapItems[nNextRead++], item);
+            condParser.notify_one();
+        }
+
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fReadDone = true;
+        condParser.notify_all();
+        condConsumer.notify_all();
+    }
+
+    void Parse(Item& item) const
+    {
+        item.pblock = std::make_shared<CBlock>();
+        try {
+            std::vector<char> vData;
+            const char* pdata = item.vStored.data();
+            size_t nSize = item.vStored.size();
+            if (item.nSizeField & DISK_RECORD_COMPRESSED) {
+                if (!DecompressBlockData(pdata, nSize, MAX_BLOCK_SIZE, vData))
+                    throw std::ios_base::failure("invalid compressed block record");
+                pdata = vData.data();
+                nSize = vData.size();
+            }
+
+            CSpanReader reader(pdata, nSize, SER_DISK, CLIENT_VERSION);
+            if (fHeadersOnly) {
+                CBlockHeader header;
+                reader >> header;
+                item.pblock->SetBlockHeader(header);
+            } else
+                reader >> *item.pblock;
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+            item.pblock.reset();
+            return;
+        }
+
+        if (!fHeadersOnly) {
+            // ProcessNewBlock and AcceptBlock then don't check it again
+            CValidationState state;
+            auto verifier = libzcash::ProofVerifier::Disabled();
+            item.pblock->fChecked = CheckBlock(*item.pblock, state, verifier);
+        }
+    }
+
+    void ThreadParse()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (true)
+        {
+            while (!fStop && nNextParse == nNextRead && !fReadDone)
+                condParser.wait(lock);
+            if (fStop || nNextParse == nNextRead)
+                return;
+
+            // the items of the map are not moved by the insertions and erasures of other items
+            Item& item = mapItems[nNextParse++];
+            lock.unlock();
+            Parse(item);
+            lock.lock();
+
+            item.fParsed = true;
+            std::vector<char>().swap(item.vStored);
+            condConsumer.notify_all();
+        }
+    }
+
+public:
+    //! Takes over fileIn and calls fclose() on it when destroyed
+    CBlockFileLoader(FILE* fileIn, bool fHeadersOnlyIn) :
+        blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION), fHeadersOnly(fHeadersOnlyIn),
+        nNextRead(0), nNextParse(0), nNextConsume(0), nBytesInFlight(0), fReadDone(false), fStop(false)
+    {
+        const int nParsers = std::max(1, std::min(GetNumCores() - 1, BLOCK_LOAD_MAX_PARSER_THREADS));
+        threadGroup.create_thread(boost::bind(&CBlockFileLoader::ThreadRead, this));
+        for (int i = 0; i < nParsers; i++)
+            threadGroup.create_thread(boost::bind(&CBlockFileLoader::ThreadParse, this));
+    }
+
+    ~CBlockFileLoader()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            fStop = true;
+        }
+        condReader.notify_all();
+        condParser.notify_all();
+        threadGroup.join_all();
+    }
+
+    //! The next block record of the file, false once all have been returned
+    bool Next(Item& item)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (true)
+        {
+            std::map<uint64_t, Item>::iterator it = mapItems.find(nNextConsume);
+            if (it != mapItems.end() && it->second.fParsed) {
+                std::swap(item, it->second);
+                mapItems.erase(it);
+                nNextConsume++;
+                nBytesInFlight -= item.nStoredSize;
+                condReader.notify_one();
+                return true;
             }
+            if (fReadDone && nNextConsume == nNextRead)
+                return false;
+            condConsumer.wait(lock);
+        }
+    }
+};
+
+bool LoadBlocksFromExternalFile(FILE* fileIn, CDiskBlockPos *dbp, bool loadHeadersOnly)
+{
+    const CChainParams& chainparams = Params();
+    // Map of disk positions for blocks with unknown parent (only used for reindex)
+    static std::multimap<uint256, CDiskBlockPos> mapBlocksUnknownParent;
+    int64_t nStart = GetTimeMillis();
+
+    int nLoadedHeaders = 0;
+    int nLoadedBlocks = 0;
+
+    try
+    {
+        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor.
+        // The blocks are read and parsed ahead by other threads, and processed here in file order.
+        CBlockFileLoader loader(fileIn, loadHeadersOnly);
+        CBlockFileLoader::Item item;
+        while (loader.Next(item))
+        {
+            boost::this_thread::interruption_point();
+
+            // not deserialized, as logged by the loader
+            if (!item.pblock)
+                continue;
+
             try
             {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
                 if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                CBlock loadedBlk;
-                blkdat >> loadedBlk;
-                nRewind = blkdat.GetPos();
+                    dbp->nPos = item.nPos;
+                CBlock& loadedBlk = *item.pblock;
                 // detect out of order blocks, and store them for later
                 uint256 hash = loadedBlk.GetHash();
                 if (hash != chainparams.GetConsensus().hashGenesisBlock && mapBlockIndex.find(loadedBlk.hashPrevBlock) == mapBlockIndex.end()) {
@@ -6278,102 +8426,117 @@ void static CheckBlockIndex()
     CBlockIndex* pindexFirstNotTransactionsValid = NULL; // Oldest ancestor of pindex which does not have BLOCK_VALID_TRANSACTIONS (regardless of being valid or not).
     CBlockIndex* pindexFirstNotChainValid = NULL; // Oldest ancestor of pindex which does not have BLOCK_VALID_CHAIN (regardless of being valid or not).
     CBlockIndex* pindexFirstNotScriptsValid = NULL; // Oldest ancestor of pindex which does not have BLOCK_VALID_SCRIPTS (regardless of being valid or not).
+    // The chain up to a loaded txout set snapshot has no data, breaking most of the invariants: only the blocks
+    // built on the snapshot base are checked, its ancestors standing for fully processed blocks.
+    CBlockIndex* pindexSnapshotBase = NULL;
+    if (!hashTxOutSetSnapshotBase.IsNull()) {
+        BlockMap::iterator mi = mapBlockIndex.find(hashTxOutSetSnapshotBase);
+        if (mi != mapBlockIndex.end())
+            pindexSnapshotBase = mi->second;
+    }
     while (pindex != NULL) {
         nNodes++;
-        if (pindexFirstInvalid == NULL && pindex->nStatus & BLOCK_FAILED_VALID) pindexFirstInvalid = pindex;
-        if (pindexFirstMissing == NULL && !(pindex->nStatus & BLOCK_HAVE_DATA)) pindexFirstMissing = pindex;
-        if (pindexFirstNeverProcessed == NULL && pindex->nTx == 0) pindexFirstNeverProcessed = pindex;
-        if (pindex->pprev != NULL && pindexFirstNotTreeValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_TREE) pindexFirstNotTreeValid = pindex;
-        if (pindex->pprev != NULL && pindexFirstNotTransactionsValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_TRANSACTIONS) pindexFirstNotTransactionsValid = pindex;
-        if (pindex->pprev != NULL && pindexFirstNotChainValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_CHAIN) pindexFirstNotChainValid = pindex;
-        if (pindex->pprev != NULL && pindexFirstNotScriptsValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_SCRIPTS) pindexFirstNotScriptsValid = pindex;
-
-        // Begin: actual consistency checks.
-        if (pindex->pprev == NULL) {
-            // Genesis block checks.
-            assert(pindex->GetBlockHash() == consensusParams.hashGenesisBlock); // Genesis block's hash must match.
-            assert(pindex == chainActive.Genesis()); // The current active chain's genesis block must be this block.
-        }
-        if (pindex->nChainTx == 0) assert(pindex->nSequenceId == 0);  // nSequenceId can't be set for blocks that aren't linked
-        // VALID_TRANSACTIONS is equivalent to nTx > 0 for all nodes (whether or not pruning has occurred).
-        // HAVE_DATA is only equivalent to nTx > 0 (or VALID_TRANSACTIONS) if no pruning has occurred.
-        if (!fHavePruned) {
-            // If we've never pruned, then HAVE_DATA should be equivalent to nTx > 0
-            assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
-            assert(pindexFirstMissing == pindexFirstNeverProcessed);
-        } else {
-            // If we have pruned, then we can only say that HAVE_DATA implies nTx > 0
-            if (pindex->nStatus & BLOCK_HAVE_DATA) assert(pindex->nTx > 0);
-        }
-        if (pindex->nStatus & BLOCK_HAVE_UNDO) assert(pindex->nStatus & BLOCK_HAVE_DATA);
-        assert(((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TRANSACTIONS) == (pindex->nTx > 0)); // This is pruning-independent.
-        // All parents having had data (at some point) is equivalent to all parents being VALID_TRANSACTIONS, which is equivalent to nChainTx being set.
-        assert((pindexFirstNeverProcessed != NULL) == (pindex->nChainTx == 0)); // nChainTx != 0 is used to signal that all parent blocks have been processed (but may have been pruned).
-        assert((pindexFirstNotTransactionsValid != NULL) == (pindex->nChainTx == 0));
-        assert(pindex->nHeight == nHeight); // nHeight must be consistent.
-        assert(pindex->pprev == NULL || pindex->nChainWork >= pindex->pprev->nChainWork); // For every block except the genesis block, the chainwork must be larger than the parent's.
-        assert(nHeight < 2 || (pindex->pskip && (pindex->pskip->nHeight < nHeight))); // The pskip pointer must point back for all but the first 2 blocks.
-        assert(pindexFirstNotTreeValid == NULL); // All mapBlockIndex entries must at least be TREE valid
-        if ((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TREE) assert(pindexFirstNotTreeValid == NULL); // TREE valid implies all parents are TREE valid
-        if ((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_CHAIN) assert(pindexFirstNotChainValid == NULL); // CHAIN valid implies all parents are CHAIN valid
-        if ((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_SCRIPTS) assert(pindexFirstNotScriptsValid == NULL); // SCRIPTS valid implies all parents are SCRIPTS valid
-        if (pindexFirstInvalid == NULL) {
-            // Checks for not-invalid blocks.
-            assert((pindex->nStatus & BLOCK_FAILED_MASK) == 0); // The failed mask cannot be set for blocks without invalid parents.
-        }
-        if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && pindexFirstNeverProcessed == NULL) {
+        const bool fBelowSnapshot = pindexSnapshotBase != NULL &&
+            (pindex->nHeight <= pindexSnapshotBase->nHeight || pindex->GetAncestor(pindexSnapshotBase->nHeight) != pindexSnapshotBase);
+        const bool fSnapshotChain = fBelowSnapshot && pindexSnapshotBase->GetAncestor(pindex->nHeight) == pindex;
+        if (!fSnapshotChain) {
+            if (pindexFirstInvalid == NULL && pindex->nStatus & BLOCK_FAILED_VALID) pindexFirstInvalid = pindex;
+            if (pindexFirstMissing == NULL && !(pindex->nStatus & BLOCK_HAVE_DATA)) pindexFirstMissing = pindex;
+            if (pindexFirstNeverProcessed == NULL && pindex->nTx == 0) pindexFirstNeverProcessed = pindex;
+            if (pindex->pprev != NULL && pindexFirstNotTreeValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_TREE) pindexFirstNotTreeValid = pindex;
+            if (pindex->pprev != NULL && pindexFirstNotTransactionsValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_TRANSACTIONS) pindexFirstNotTransactionsValid = pindex;
+            if (pindex->pprev != NULL && pindexFirstNotChainValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_CHAIN) pindexFirstNotChainValid = pindex;
+            if (pindex->pprev != NULL && pindexFirstNotScriptsValid == NULL && (pindex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_SCRIPTS) pindexFirstNotScriptsValid = pindex;
+
+        }
+        if (!fBelowSnapshot) {
+            // Begin: actual consistency checks.
+            if (pindex->pprev == NULL) {
+                // Genesis block checks.
+                assert(pindex->GetBlockHash() == consensusParams.hashGenesisBlock); // Genesis block's hash must match.
+                assert(pindex == chainActive.Genesis()); // The current active chain's genesis block must be this block.
+            }
+            if (pindex->nChainTx == 0) assert(pindex->nSequenceId == 0);  // nSequenceId can't be set for blocks that aren't linked
+            // VALID_TRANSACTIONS is equivalent to nTx > 0 for all nodes (whether or not pruning has occurred).
+            // HAVE_DATA is only equivalent to nTx > 0 (or VALID_TRANSACTIONS) if no pruning has occurred.
+            if (!fHavePruned) {
+                // If we've never pruned, then HAVE_DATA should be equivalent to nTx > 0
+                assert(!(pindex->nStatus & BLOCK_HAVE_DATA) == (pindex->nTx == 0));
+                assert(pindexFirstMissing == pindexFirstNeverProcessed);
+            } else {
+                // If we have pruned, then we can only say that HAVE_DATA implies nTx > 0
+                if (pindex->nStatus & BLOCK_HAVE_DATA) assert(pindex->nTx > 0);
+            }
+            if (pindex->nStatus & BLOCK_HAVE_UNDO) assert(pindex->nStatus & BLOCK_HAVE_DATA);
+            assert(((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TRANSACTIONS) == (pindex->nTx > 0)); // This is pruning-independent.
+            // All parents having had data (at some point) is equivalent to all parents being VALID_TRANSACTIONS, which is equivalent to nChainTx being set.
+            assert((pindexFirstNeverProcessed != NULL) == (pindex->nChainTx == 0)); // nChainTx != 0 is used to signal that all parent blocks have been processed (but may have been pruned).
+            assert((pindexFirstNotTransactionsValid != NULL) == (pindex->nChainTx == 0));
+            assert(pindex->nHeight == nHeight); // nHeight must be consistent.
+            assert(pindex->pprev == NULL || pindex->nChainWork >= pindex->pprev->nChainWork); // For every block except the genesis block, the chainwork must be larger than the parent's.
+            assert(nHeight < 2 || (pindex->pskip && (pindex->pskip->nHeight < nHeight))); // The pskip pointer must point back for all but the first 2 blocks.
+            assert(pindexFirstNotTreeValid == NULL); // All mapBlockIndex entries must at least be TREE valid
+            if ((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TREE) assert(pindexFirstNotTreeValid == NULL); // TREE valid implies all parents are TREE valid
+            if ((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_CHAIN) assert(pindexFirstNotChainValid == NULL); // CHAIN valid implies all parents are CHAIN valid
+            if ((pindex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_SCRIPTS) assert(pindexFirstNotScriptsValid == NULL); // SCRIPTS valid implies all parents are SCRIPTS valid
             if (pindexFirstInvalid == NULL) {
-                // If this block sorts at least as good as the current tip and
-                // is valid and we have all data for its parents, it must be in
-                // setBlockIndexCandidates.  chainActive.Tip() must also be there
-                // even if some data has been pruned.
-                if (pindexFirstMissing == NULL || pindex == chainActive.Tip()) {
-                    // LogPrintf("net","ASSERT============>%x  but  %x\n", pindex->phashBlock, chainActive.Tip()->phashBlock);
-                    assert(setBlockIndexCandidates.count(pindex));
-                }
-                // If some parent is missing, then it could be that this block was in
-                // setBlockIndexCandidates but had to be removed because of the missing data.
-                // In this case it must be in mapBlocksUnlinked -- see test below.
-            }
-        } else { // If this block sorts worse than the current tip or some ancestor's block has never been seen, it cannot be in setBlockIndexCandidates.
-            assert(setBlockIndexCandidates.count(pindex) == 0);
-        }
-        // Check whether this block is in mapBlocksUnlinked.
-        std::pair<std::multimap<CBlockIndex*,CBlockIndex*>::iterator, std::multimap<CBlockIndex*,CBlockIndex*>::iterator> rangeUnlinked = mapBlocksUnlinked.equal_range(pindex->pprev);
-        bool foundInUnlinked = false;
-        while (rangeUnlinked.first != rangeUnlinked.second) {
-            assert(rangeUnlinked.first->first == pindex->pprev);
-            if (rangeUnlinked.first->second == pindex) {
-                foundInUnlinked = true;
-                break;
+                // Checks for not-invalid blocks.
+                assert((pindex->nStatus & BLOCK_FAILED_MASK) == 0); // The failed mask cannot be set for blocks without invalid parents.
             }
-            rangeUnlinked.first++;
-        }
-        if (pindex->pprev && (pindex->nStatus & BLOCK_HAVE_DATA) && pindexFirstNeverProcessed != NULL && pindexFirstInvalid == NULL) {
-            // If this block has block data available, some parent was never received, and has no invalid parents, it must be in mapBlocksUnlinked.
-            assert(foundInUnlinked);
-        }
-        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) assert(!foundInUnlinked); // Can't be in mapBlocksUnlinked if we don't HAVE_DATA
-        if (pindexFirstMissing == NULL) assert(!foundInUnlinked); // We aren't missing data for any parent -- cannot be in mapBlocksUnlinked.
-        if (pindex->pprev && (pindex->nStatus & BLOCK_HAVE_DATA) && pindexFirstNeverProcessed == NULL && pindexFirstMissing != NULL) {
-            // We HAVE_DATA for this block, have received data for all parents at some point, but we're currently missing data for some parent.
-            assert(fHavePruned); // We must have pruned.
-            // This block may have entered mapBlocksUnlinked if:
-            //  - it has a descendant that at some point had more work than the
-            //    tip, and
-            //  - we tried switching to that descendant but were missing
-            //    data for some intermediate block between chainActive and the
-            //    tip.
-            // So if this block is itself better than chainActive.Tip() and it wasn't in
-            // setBlockIndexCandidates, then it must be in mapBlocksUnlinked.
-            if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && setBlockIndexCandidates.count(pindex) == 0) {
+            if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && pindexFirstNeverProcessed == NULL) {
                 if (pindexFirstInvalid == NULL) {
-                    assert(foundInUnlinked);
+                    // If this block sorts at least as good as the current tip and
+                    // is valid and we have all data for its parents, it must be in
+                    // setBlockIndexCandidates.  chainActive.Tip() must also be there
+                    // even if some data has been pruned.
+                    if (pindexFirstMissing == NULL || pindex == chainActive.Tip()) {
+                        // LogPrintf("net","ASSERT============>%x  but  %x\n", pindex->phashBlock, chainActive.Tip()->phashBlock);
+                        assert(setBlockIndexCandidates.count(pindex));
+                    }
+                    // If some parent is missing, then it could be that this block was in
+                    // setBlockIndexCandidates but had to be removed because of the missing data.
+                    // In this case it must be in mapBlocksUnlinked -- see test below.
+                }
+            } else { // If this block sorts worse than the current tip or some ancestor's block has never been seen, it cannot be in setBlockIndexCandidates.
+                assert(setBlockIndexCandidates.count(pindex) == 0);
+            }
+            // Check whether this block is in mapBlocksUnlinked.
+            std::pair<std::multimap<CBlockIndex*,CBlockIndex*>::iterator, std::multimap<CBlockIndex*,CBlockIndex*>::iterator> rangeUnlinked = mapBlocksUnlinked.equal_range(pindex->pprev);
+            bool foundInUnlinked = false;
+            while (rangeUnlinked.first != rangeUnlinked.second) {
+                assert(rangeUnlinked.first->first == pindex->pprev);
+                if (rangeUnlinked.first->second == pindex) {
+                    foundInUnlinked = true;
+                    break;
+                }
+                rangeUnlinked.first++;
+            }
+            if (pindex->pprev && (pindex->nStatus & BLOCK_HAVE_DATA) && pindexFirstNeverProcessed != NULL && pindexFirstInvalid == NULL) {
+                // If this block has block data available, some parent was never received, and has no invalid parents, it must be in mapBlocksUnlinked.
+                assert(foundInUnlinked);
+            }
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA)) assert(!foundInUnlinked); // Can't be in mapBlocksUnlinked if we don't HAVE_DATA
+            if (pindexFirstMissing == NULL) assert(!foundInUnlinked); // We aren't missing data for any parent -- cannot be in mapBlocksUnlinked.
+            if (pindex->pprev && (pindex->nStatus & BLOCK_HAVE_DATA) && pindexFirstNeverProcessed == NULL && pindexFirstMissing != NULL) {
+                // We HAVE_DATA for this block, have received data for all parents at some point, but we're currently missing data for some parent.
+                assert(fHavePruned); // We must have pruned.
+                // This block may have entered mapBlocksUnlinked if:
+                //  - it has a descendant that at some point had more work than the
+                //    tip, and
+                //  - we tried switching to that descendant but were missing
+                //    data for some intermediate block between chainActive and the
+                //    tip.
+                // So if this block is itself better than chainActive.Tip() and it wasn't in
+                // setBlockIndexCandidates, then it must be in mapBlocksUnlinked.
+                if (!CBlockIndexWorkComparator()(pindex, chainActive.Tip()) && setBlockIndexCandidates.count(pindex) == 0) {
+                    if (pindexFirstInvalid == NULL) {
+                        assert(foundInUnlinked);
+                    }
                 }
             }
+            // assert(pindex->GetBlockHash() == pindex->GetBlockHeader().GetHash()); // Perhaps too slow
+            // End: actual consistency checks.
         }
-        // assert(pindex->GetBlockHash() == pindex->GetBlockHeader().GetHash()); // Perhaps too slow
-        // End: actual consistency checks.
 
         // Try descending into the first subnode.
         std::pair<std::multimap<CBlockIndex*,CBlockIndex*>::iterator, std::multimap<CBlockIndex*,CBlockIndex*>::iterator> range = forward.equal_range(pindex);
@@ -6500,14 +8663,45 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
     return true;
 }
 
+static bool IsInventoryKnownBy(CNode* pnode, const CInv& inv)
+{
+    LOCK(pnode->cs_inventory);
+    return pnode->IsInventoryKnown(inv);
+}
+
+/**
+ * The "block" message of the last tip served, sent again as is to the other peers asking for it, as they
+ * do at about the same time.
+ */
+static CCriticalSection cs_recentBlockMessage;
+static uint256 hashRecentBlockMessage;
+static std::shared_ptr<const CSharedMessage> pRecentBlockMessage;
+
+/** The "block" message of rawBlock, sent from the mapping of the block file when mapped, without a copy */
+static std::shared_ptr<const CSharedMessage> MakeBlockMessage(CRawBlock& rawBlock)
+{
+    if (rawBlock.file)
+        return std::make_shared<const CSharedMessage>("block", rawBlock.file, rawBlock.begin(), rawBlock.size());
+    if (rawBlock.shared)
+        return std::make_shared<const CSharedMessage>("block", rawBlock.shared, rawBlock.begin(), rawBlock.size());
+
+    // the bytes are in the buffer of rawBlock, moved to the message
+    std::shared_ptr<std::vector<char> > buffer = std::make_shared<std::vector<char> >();
+    buffer->swap(rawBlock.vBuffer);
+    const char* pdata = rawBlock.begin();
+    size_t nSize = rawBlock.size();
+    rawBlock.SetNull();
+    return std::make_shared<const CSharedMessage>("block", buffer, pdata, nSize);
+}
+
 void static ProcessGetData(CNode* pfrom)
 {
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
 
     vector<CInv> vNotFound;
 
-    LOCK(cs_main);
-
+    // cs_main is only held to look up the blocks, not while reading them from disk, so that a peer
+    // downloading blocks does not hold up the processing of the messages of the other peers
     while (it != pfrom->vRecvGetData.end()) {
         // Don't bother if send buffer is too full to respond anyway
         if (pfrom->nSendSize >= SendBufferSize())
@@ -6518,58 +8712,101 @@ void static ProcessGetData(CNode* pfrom)
             boost::this_thread::interruption_point();
             it++;
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
             {
                 bool send = false;
-                BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
-                if (mi != mapBlockIndex.end())
+                bool fHaveData = false;
+                bool fRecent = false;
+                CDiskBlockPos blockPos;
+                uint256 hashTip;
                 {
-                    if (chainActive.Contains(mi->second)) {
-                        send = true;
-                    } else {
-                        static const int nOneMonth = 30 * 24 * 60 * 60;
-                        // To prevent fingerprinting attacks, only send blocks outside of the active
-                        // chain if they are valid, and no more than a month older (both in time, and in
-                        // best equivalent proof of work) than the best header chain we know about.
-
-                        // this is set by ConnectBlock method, when a new tip is added to the main chain
-                        bool b1 = mi->second->IsValid(BLOCK_VALID_SCRIPTS);
-                        bool b2 = (pindexBestHeader != NULL) &&
-                                  (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() < nOneMonth) &&
-                                  (GetBlockProofEquivalentTime(*pindexBestHeader, *mi->second, *pindexBestHeader, Params().GetConsensus()) < nOneMonth);
-
-                        send = b1 && b2;
-                        if (!send)
-                        {
-                            if (b2)
-                            {
-                                // BLOCK_VALID_SCRIPTS is set when connecting block on main chain, but we must
-                                // propagate also when relevant blocks are on a fork. Consider that a further check
-                                // on BLOCK_HAVE_DATA is performed below
-                                LogPrint("forks", "%s():%d: request from peer=%i: status[0x%x]\n",
-                                    __func__, __LINE__, pfrom->GetId(), mi->second->nStatus);
-                                send = true;
-                            }
-                            else
+                    LOCK(cs_main);
+                    BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
+                    if (mi != mapBlockIndex.end())
+                    {
+                        if (chainActive.Contains(mi->second)) {
+                            send = true;
+                        } else {
+                            static const int nOneMonth = 30 * 24 * 60 * 60;
+                            // To prevent fingerprinting attacks, only send blocks outside of the active
+                            // chain if they are valid, and no more than a month older (both in time, and in
+                            // best equivalent proof of work) than the best header chain we know about.
+
+                            // this is set by ConnectBlock method, when a new tip is added to the main chain
+                            bool b1 = mi->second->IsValid(BLOCK_VALID_SCRIPTS);
+                            bool b2 = (pindexBestHeader != NULL) &&
+                                      (pindexBestHeader->GetBlockTime() - mi->second->GetBlockTime() < nOneMonth) &&
+                                      (GetBlockProofEquivalentTime(*pindexBestHeader, *mi->second, *pindexBestHeader, Params().GetConsensus()) < nOneMonth);
+
+                            send = b1 && b2;
+                            if (!send)
                             {
-                                LogPrint("forks", "%s():%d: ignoring request from peer=%i: %s status[0x%x]\n",
-                                    __func__, __LINE__, pfrom->GetId(), inv.hash.ToString(), mi->second->nStatus);
+                                if (b2)
+                                {
+                                    // BLOCK_VALID_SCRIPTS is set when connecting block on main chain, but we must
+                                    // propagate also when relevant blocks are on a fork. Consider that a further check
+                                    // on BLOCK_HAVE_DATA is performed below
+                                    LogPrint("forks", "%s():%d: request from peer=%i: status[0x%x]\n",
+                                        __func__, __LINE__, pfrom->GetId(), mi->second->nStatus);
+                                    send = true;
+                                }
+                                else
+                                {
+                                    LogPrint("forks", "%s():%d: ignoring request from peer=%i: %s status[0x%x]\n",
+                                        __func__, __LINE__, pfrom->GetId(), inv.hash.ToString(), mi->second->nStatus);
+                                }
                             }
                         }
                     }
+                    // Pruned nodes may have deleted the block, so check whether
+                    // it's available before trying to send.
+                    if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
+                    {
+                        fHaveData = true;
+                        blockPos = mi->second->GetBlockPos();
+                        hashTip = chainActive.Tip()->GetBlockHash();
+                        // the mempool of the peer has the transactions of a recent block only
+                        fRecent = mi->second->nHeight >= chainActive.Height() - MAX_CMPCTBLOCK_DEPTH;
+                    }
+                    else if (send)
+                    {
+                        LogPrint("forks", "%s():%d - NOT Pushing incomplete block [%s]\n", __func__, __LINE__, inv.hash.ToString() );
+                    }
                 }
-                // Pruned nodes may have deleted the block, so check whether
-                // it's available before trying to send.
-                if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
+
+                if (fHaveData)
                 {
-                    // Send block from disk
+                    // Send block from disk, as the bytes stored there without deserializing it
                     CBlock block;
-                    if (!ReadBlockFromDisk(block, (*mi).second))
-                        assert(!"cannot load block from disk");
-                    if (inv.type == MSG_BLOCK)
+                    if (inv.type == MSG_BLOCK || (inv.type == MSG_CMPCT_BLOCK && !fRecent))
                     {
-                        LogPrint("forks", "%s():%d - Pushing block [%s]\n", __func__, __LINE__, block.GetHash().ToString() );
-                        pfrom->PushMessage("block", block);
+                        std::shared_ptr<const CSharedMessage> pmsg;
+                        {
+                            LOCK(cs_recentBlockMessage);
+                            if (hashRecentBlockMessage == inv.hash)
+                                pmsg = pRecentBlockMessage;
+                        }
+                        if (!pmsg) {
+                            CRawBlock rawBlock;
+                            if (!GetRecentRawBlock(rawBlock, inv.hash) && !ReadRawBlockFromDisk(rawBlock, blockPos, inv.hash)) {
+                                // the block may have been pruned since it was looked up
+                                LogPrintf("%s: cannot load block %s from disk\n", __func__, inv.hash.ToString());
+                                break;
+                            }
+                            pmsg = MakeBlockMessage(rawBlock);
+                            if (inv.hash == hashTip) {
+                                LOCK(cs_recentBlockMessage);
+                                hashRecentBlockMessage = inv.hash;
+                                pRecentBlockMessage = pmsg;
+                            }
+                        }
+                        LogPrint("forks", "%s():%d - Pushing block [%s]\n", __func__, __LINE__, inv.hash.ToString() );
+                        pfrom->PushSharedMessage(*pmsg);
+                    }
+                    else
+                    if (!ReadRecentBlockOrFromDisk(block, blockPos, inv.hash)) {
+                        LogPrintf("%s: cannot load block %s from disk\n", __func__, inv.hash.ToString());
+                        break;
                     }
                     else // MSG_FILTERED_BLOCK)
                     if (inv.type == MSG_FILTERED_BLOCK)
@@ -6591,13 +8828,13 @@ void static ProcessGetData(CNode* pfrom)
                                 unsigned int pos = pair.first;
                                 if (pos < block.vtx.size() )
                                 {
-                                    if (!pfrom->setInventoryKnown.count(CInv(MSG_TX, pair.second)))
+                                    if (!IsInventoryKnownBy(pfrom, CInv(MSG_TX, pair.second)))
                                         pfrom->PushMessage("tx", block.vtx[pos]);
                                 }
                                 else
                                 if ( pos < (block.vcert.size() + block.vtx.size()) )
                                 {
-                                    if (!pfrom->setInventoryKnown.count(CInv(MSG_TX, pair.second)))
+                                    if (!IsInventoryKnownBy(pfrom, CInv(MSG_TX, pair.second)))
                                     {
                                         unsigned int offset = pos - block.vtx.size();
                                         pfrom->PushMessage("tx", block.vcert[offset]);
@@ -6613,6 +8850,13 @@ void static ProcessGetData(CNode* pfrom)
                             // no response
                     }
                     else
+                    if (inv.type == MSG_CMPCT_BLOCK)
+                    {
+                        CBlockHeaderAndShortTxIDs cmpctblock(block);
+                        LogPrint("cmpctblock", "%s():%d - Pushing compact block [%s]\n", __func__, __LINE__, inv.hash.ToString());
+                        pfrom->PushMessage("cmpctblock", cmpctblock);
+                    }
+                    else
                     {
                         LogPrint("cert", "%s():%d - inv.type=%d\n", __func__, __LINE__, inv.type);
                     }
@@ -6624,61 +8868,42 @@ void static ProcessGetData(CNode* pfrom)
                         // and we want it right after the last block so they don't
                         // wait for other stuff first.
                         vector<CInv> vInv;
-                        vInv.push_back(CInv(MSG_BLOCK, chainActive.Tip()->GetBlockHash()));
+                        vInv.push_back(CInv(MSG_BLOCK, hashTip));
                         LogPrint("forks", "%s():%d - Pushing inv\n", __func__, __LINE__);
                         pfrom->PushMessage("inv", vInv);
                         pfrom->hashContinue.SetNull();
                     }
                 }
-                else
-                {
-                    if (send && !(mi->second->nStatus & BLOCK_HAVE_DATA) )
-                    {
-                        LogPrint("forks", "%s():%d - NOT Pushing incomplete block [%s]\n", __func__, __LINE__, inv.hash.ToString() );
-                    }
-                }
             }
             else if (inv.IsKnownType())
             {
-                // Send stream from relay memory
-                bool pushed = false;
+                // Send from relay memory, else from the mempool, both sharing the objects rather than copying them
+                std::shared_ptr<const CTransactionBase> txBase;
                 {
                     LOCK(cs_mapRelay);
-                    map<CInv, CDataStream>::iterator mi = mapRelay.find(inv);
-                    if (mi != mapRelay.end()) {
-                        pfrom->PushMessage(inv.GetCommand(), (*mi).second);
-                        pushed = true;
-                    }
+                    map<CInv, std::shared_ptr<const CTransactionBase> >::iterator mi = mapRelay.find(inv);
+                    if (mi != mapRelay.end())
+                        txBase = mi->second;
                 }
-                if (!pushed && inv.type == MSG_TX) {
-                    CTransaction tx;
-                    if (mempool.lookup(inv.hash, tx)) {
-                        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                        ss.reserve(1000);
-                        ss << tx;
+                if (!txBase && inv.type == MSG_TX)
+                    txBase = mempool.lookupShared(inv.hash);
+                if (txBase) {
+                    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+                    ss.reserve(txBase->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION));
+                    if (txBase->IsCertificate()) {
+                        ss << static_cast<const CScCertificate&>(*txBase);
+                        LogPrint("cert", "%s():%d - pushing certificate\n", __func__, __LINE__);
+                    } else {
+                        ss << static_cast<const CTransaction&>(*txBase);
                         LogPrint("cert", "%s():%d - pushing tx\n", __func__, __LINE__);
-                        pfrom->PushMessage("tx", ss);
-                        pushed = true;
                     }
-                    else
-                    {
-                        CScCertificate cert;
-                        if (mempool.lookup(inv.hash, cert)) {
-                            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-                            ss.reserve(1000);
-                            ss << cert;
-                            LogPrint("cert", "%s():%d - pushing certificate\n", __func__, __LINE__);
-                            pfrom->PushMessage("tx", ss);
-                            pushed = true;
-                        }
-                    }
-                }
-                if (!pushed) {
+                    pfrom->PushMessage("tx", ss);
+                } else {
                     vNotFound.push_back(inv);
                 }
             }
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
                 break;
         }
     }
@@ -6699,7 +8924,8 @@ void static ProcessGetData(CNode* pfrom)
 
 void ProcessMempoolMsg(const CTxMemPool& pool, CNode* pfrom)
 {
-    LOCK2(cs_main, pfrom->cs_filter);
+    // the mempool has its own lock, the other message handler threads need not wait for this one
+    LOCK(pfrom->cs_filter);
 
     std::vector<uint256> vtxid;
     pool.queryHashes(vtxid);
@@ -6769,8 +8995,12 @@ void ProcessTxBaseAcceptToMemoryPool(const CTransactionBase& txBase, CNode* pfro
     {
         mempool.check(pcoinsTip);
         txBase.Relay();
-        std::vector<uint256> vWorkQueue{txBase.GetHash()};
+        // Only the orphans spending an output of an accepted transaction can be connected now
+        std::vector<COutPoint> vWorkQueue;
         std::vector<uint256> vEraseQueue;
+        std::set<uint256> setOrphansProcessed;
+        for (unsigned int n = 0; n < txBase.GetVout().size(); n++)
+            vWorkQueue.push_back(COutPoint(txBase.GetHash(), n));
 
         LogPrint("mempool", "%s(): peer=%d %s: accepted %s (poolsz %u)\n", __func__,
             pfrom->id, pfrom->cleanSubVer,
@@ -6781,11 +9011,15 @@ void ProcessTxBaseAcceptToMemoryPool(const CTransactionBase& txBase, CNode* pfro
         set<NodeId> setMisbehaving;
         for (unsigned int i = 0; i < vWorkQueue.size(); i++)
         {
-            map<uint256, set<uint256> >::iterator itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue[i]);
+            map<COutPoint, set<uint256> >::iterator itByPrev = mapOrphanTransactionsByPrev.find(vWorkQueue[i]);
             if (itByPrev == mapOrphanTransactionsByPrev.end())
                 continue;
             for (const uint256& orphanHash: itByPrev->second)
             {
+                // an orphan spending several outputs of the accepted transactions is tried once
+                if (!setOrphansProcessed.insert(orphanHash).second)
+                    continue;
+
                 const CTransactionBase& orphanTx = *mapOrphanTransactions[orphanHash].tx;
                 NodeId fromPeer = mapOrphanTransactions[orphanHash].fromPeer;
                 bool fMissingInputs2 = false;
@@ -6803,7 +9037,8 @@ void ProcessTxBaseAcceptToMemoryPool(const CTransactionBase& txBase, CNode* pfro
                 {
                     LogPrint("mempool", "   accepted orphan tx %s\n", orphanHash.ToString());
                     orphanTx.Relay();
-                    vWorkQueue.push_back(orphanHash);
+                    for (unsigned int n = 0; n < orphanTx.GetVout().size(); n++)
+                        vWorkQueue.push_back(COutPoint(orphanHash, n));
                     vEraseQueue.push_back(orphanHash);
                 }
                 else if (resOrphan == MempoolReturnValue::INVALID)
@@ -6840,7 +9075,8 @@ void ProcessTxBaseAcceptToMemoryPool(const CTransactionBase& txBase, CNode* pfro
 
         // DoS prevention: do not allow mapOrphanTransactions to grow unbounded
         unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, GetArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
-        unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx);
+        size_t nMaxOrphanSize = std::max((int64_t)0, GetArg("-maxorphanpoolsize", DEFAULT_MAX_ORPHAN_POOL_SIZE)) * 1000;
+        unsigned int nEvicted = LimitOrphanTxSize(nMaxOrphanTx, nMaxOrphanSize);
         if (nEvicted > 0)
             LogPrint("mempool", "mapOrphan overflow, removed %u tx\n", nEvicted);
     }
@@ -6860,51 +9096,273 @@ void ProcessTxBaseMsg(const CTransactionBase& txBase, CNode* pfrom)
     MempoolReturnValue res = MempoolReturnValue::INVALID;
     CValidationState state;
 
-    if (!AlreadyHave(inv))
-    {
-        BatchVerificationStateFlag flag = BatchVerificationStateFlag::NOT_VERIFIED_YET;
+    if (!AlreadyHave(inv))
+    {
+        BatchVerificationStateFlag flag = BatchVerificationStateFlag::NOT_VERIFIED_YET;
+
+        // CODE USED FOR UNIT TEST ONLY [Start]
+        if (BOOST_UNLIKELY(Params().NetworkIDString() == "regtest" && GetBoolArg("-skipscproof", false)))
+        {
+            flag = BatchVerificationStateFlag::VERIFIED;
+        }
+        // CODE USED FOR UNIT TEST ONLY [End]
+
+        ProcessTxBaseAcceptToMemoryPool(txBase, pfrom, flag, state);
+    }
+    else
+    {
+        assert(recentRejects);
+        recentRejects->insert(txBase.GetHash());
+
+        if (pfrom->fWhitelisted)
+        {
+            // Always relay transactions received from whitelisted peers, even
+            // if they were already in the mempool or rejected from it due
+            // to policy, allowing the node to function as a gateway for
+            // nodes hidden behind it.
+            //
+            // Never relay transactions that we would assign a non-zero DoS
+            // score for, as we expect peers to do the same with us in that
+            // case.
+            if (!state.IsInvalid() || state.GetDoS() == 0)
+            {
+                LogPrintf("Force relaying tx %s from whitelisted peer=%d\n", txBase.GetHash().ToString(), pfrom->id);
+                txBase.Relay();
+            }
+            else
+            {
+                LogPrintf("Not relaying invalid transaction %s from whitelisted peer=%d (%s (code %d))\n",
+                    txBase.GetHash().ToString(), pfrom->id, state.GetRejectReason(), CValidationState::CodeToChar(state.GetRejectCode()));
+            }
+        }
+    }
+
+    if (state.IsInvalid())
+    {
+        RejectMemoryPoolTxBase(state, txBase, pfrom);
+    }
+}
+
+/**
+ * Process a block received from pfrom, as a "block" or rebuilt from a compact block. A peer giving
+ * us the new tip is a candidate to announce its next blocks as compact blocks.
+ */
+static void ProcessReceivedBlock(CNode* pfrom, CBlock& block, const std::string& strCommand)
+{
+    CInv inv(MSG_BLOCK, block.GetHash());
+    pfrom->AddInventoryKnown(inv);
+
+    CValidationState state;
+    // Process all blocks from whitelisted peers, even if not requested,
+    // unless we're still syncing with the network.
+    // Such an unrequested block may still be processed, subject to the
+    // conditions in AcceptBlock().
+    bool forceProcessing = pfrom->fWhitelisted && !IsInitialBlockDownload();
+    ProcessNewBlock(state, pfrom, &block, forceProcessing, NULL);
+    if (state.IsInvalid())
+    {
+        LogPrint("forks", "%s():%d - Pushing reject, DoS[%d]\n", __func__, __LINE__, state.GetDoS());
+        pfrom->PushMessage("reject", strCommand, CValidationState::CodeToChar(state.GetRejectCode()),
+                           state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash);
+        if (state.GetDoS() > 0)
+        {
+            LOCK(cs_main);
+            Misbehaving(pfrom->GetId(), state.GetDoS());
+        }
+    }
+    else
+    {
+        LOCK(cs_main);
+        if (chainActive.Tip()->GetBlockHash() == inv.hash)
+            MaybeSetPeerAsAnnouncingHeaderAndIDs(pfrom);
+    }
+}
+
+/** The range of headers requested from nodeid, if any. Requires cs_main. */
+static CHeadersRange* GetHeadersRange(NodeId nodeid)
+{
+    BOOST_FOREACH(CHeadersRange& range, vHeadersRanges) {
+        if (range.nodeid == nodeid)
+            return &range;
+    }
+    return NULL;
+}
+
+/**
+ * Connect the ranges of headers the headers sync has reached the start of. Returns whether any header
+ * was connected. Requires cs_main.
+ */
+static bool ConnectHeadersRanges()
+{
+    AssertLockHeld(cs_main);
+    bool fConnected = false;
+    // in height order, the end of a range connected is the start of the next one
+    for (std::vector<CHeadersRange>::iterator it = vHeadersRanges.begin(); it != vHeadersRanges.end(); ) {
+        if (mapBlockIndex.count(it->hashStart) == 0) {
+            ++it;
+            continue;
+        }
+
+        // the proofs of work were checked when the headers came
+        CBlockIndex* pindexLast = NULL;
+        BOOST_FOREACH(const CBlockHeader& header, it->vHeaders) {
+            CValidationState state;
+            if (!AcceptBlockHeader(header, state, &pindexLast, false, flagCheckPow::OFF)) {
+                LogPrint("net", "%s: header %s of the range %d-%d not accepted: %s\n", __func__,
+                         header.GetHash().ToString(), it->nStartHeight, it->nEndHeight, state.GetRejectReason());
+                break;
+            }
+            fConnected = true;
+        }
+        LogPrint("net", "%s: range %d-%d connected up to %d\n", __func__,
+                 it->nStartHeight, it->nEndHeight, pindexLast ? pindexLast->nHeight : it->nStartHeight);
+        it = vHeadersRanges.erase(it);
+    }
+    return fConnected;
+}
+
+/**
+ * Ask pto for the next headers of a range not assigned to another peer during the initial headers sync,
+ * so that the ranges between the checkpoints above the best header download along with it.
+ * Requires cs_main.
+ */
+static void RequestHeadersRange(CNode* pto, CNodeState& state)
+{
+    AssertLockHeld(cs_main);
+    if (nHeadersSyncPeers == 0 || !fCheckpointsEnabled || nSyncStarted == 0)
+        return;
+
+    if (!fHeadersRangesCreated) {
+        fHeadersRangesCreated = true;
+        const Checkpoints::MapCheckpoints& checkpoints = Params().Checkpoints().mapCheckpoints;
+        Checkpoints::MapCheckpoints::const_iterator itStart = checkpoints.upper_bound(pindexBestHeader->nHeight);
+        for (; itStart != checkpoints.end() && std::next(itStart) != checkpoints.end(); ++itStart) {
+            CHeadersRange range;
+            range.nStartHeight = itStart->first;
+            range.hashStart = itStart->second;
+            range.nEndHeight = std::next(itStart)->first;
+            range.hashEnd = std::next(itStart)->second;
+            range.nodeid = -1;
+            range.nRequestTime = 0;
+            vHeadersRanges.push_back(range);
+        }
+    }
+
+    const int64_t nNow = GetTime();
+    unsigned int nRequested = 0;
+    CHeadersRange* prange = NULL;
+    BOOST_FOREACH(CHeadersRange& range, vHeadersRanges) {
+        if (range.nodeid != -1 && range.nRequestTime < nNow - HEADERS_RANGE_TIMEOUT) {
+            // the late answer, if any, is ignored
+            LogPrint("net", "headers range %d-%d timed out for peer=%d\n", range.nStartHeight, range.nEndHeight, range.nodeid);
+            range.nodeid = -1;
+        }
+        if (range.nodeid != -1)
+            nRequested++;
+        else if (prange == NULL && !range.IsComplete() && pto->nStartingHeight >= range.nEndHeight)
+            prange = &range;
+    }
+    if (prange == NULL || nRequested >= nHeadersSyncPeers)
+        return;
+
+    prange->nodeid = pto->GetId();
+    prange->nRequestTime = nNow;
+    state.fHeadersRangeRequested = true;
+    const uint256 hashFrom = prange->vHeaders.empty() ? prange->hashStart : prange->vHeaders.back().GetHash();
+    LogPrint("net", "getheaders of the range %d-%d from %d to peer=%d\n", prange->nStartHeight, prange->nEndHeight,
+             prange->nStartHeight + (int)prange->vHeaders.size(), pto->id);
+    pto->PushMessage("getheaders", CBlockLocator(std::vector<uint256>(1, hashFrom)), prange->hashEnd);
+}
+
+/**
+ * Add the headers pfrom sent to the range it was asked for, and ask for the next ones if the range is not
+ * complete. The headers from nValidPoW on failed the proof of work check, with statePoW.
+ * Requires cs_main.
+ */
+static bool ProcessHeadersRange(CNode* pfrom, CNodeState& state, const std::vector<CBlockHeader>& headers,
+                                size_t nValidPoW, const CValidationState& statePoW)
+{
+    AssertLockHeld(cs_main);
+    CHeadersRange* prange = GetHeadersRange(pfrom->GetId());
+    if (prange == NULL) {
+        // the range has timed out meanwhile
+        state.fHeadersRangeRequested = false;
+        return true;
+    }
+
+    // not the answer, but headers announced meanwhile
+    const uint256 hashFrom = prange->vHeaders.empty() ? prange->hashStart : prange->vHeaders.back().GetHash();
+    if (headers[0].hashPrevBlock != hashFrom)
+        return true;
+
+    state.fHeadersRangeRequested = false;
+    prange->nodeid = -1;
+
+    for (size_t n = 0; n < headers.size() && !prange->IsComplete(); n++) {
+        if (n > 0 && headers[n].hashPrevBlock != headers[n - 1].GetHash()) {
+            Misbehaving(pfrom->GetId(), 20);
+            return error("non-continuous headers sequence");
+        }
+        if (n == nValidPoW) {
+            if (statePoW.GetDoS() > 0)
+                Misbehaving(pfrom->GetId(), statePoW.GetDoS());
+            return error("invalid header received");
+        }
+        prange->vHeaders.push_back(headers[n]);
+        if (prange->IsComplete() && headers[n].GetHash() != prange->hashEnd) {
+            // another chain than the checkpointed one
+            prange->vHeaders.clear();
+            Misbehaving(pfrom->GetId(), 100);
+            return error("headers range %d-%d does not end at the checkpoint", prange->nStartHeight, prange->nEndHeight);
+        }
+    }
+
+    LogPrint("net", "received %u headers of the range %d-%d, %d to go, from peer=%d\n", headers.size(),
+             prange->nStartHeight, prange->nEndHeight, prange->nEndHeight - prange->nStartHeight - (int)prange->vHeaders.size(), pfrom->id);
 
-        // CODE USED FOR UNIT TEST ONLY [Start]
-        if (BOOST_UNLIKELY(Params().NetworkIDString() == "regtest" && GetBoolArg("-skipscproof", false)))
-        {
-            flag = BatchVerificationStateFlag::VERIFIED;
-        }
-        // CODE USED FOR UNIT TEST ONLY [End]
+    // a shorter answer means the peer does not have more, the range is left to another peer
+    if (!prange->IsComplete() && headers.size() == MAX_HEADERS_RESULTS)
+        RequestHeadersRange(pfrom, state);
+    return true;
+}
 
-        ProcessTxBaseAcceptToMemoryPool(txBase, pfrom, flag, state);
+/**
+ * The ancestors of the block of hashStop from nStartHeight, one every nInterval blocks, for a BIP 157 request of
+ * the filters of filterType spanning at most nMaxBlocks blocks; false if the request is not to be served,
+ * disconnecting the peer whose request is invalid. The blocks are of the active chain, in order.
+ */
+static bool PrepareBlockFilterRequest(CNode* pfrom, uint8_t filterType, uint32_t nStartHeight, const uint256& hashStop,
+                                      uint32_t nMaxBlocks, int nInterval, std::vector<const CBlockIndex*>& vBlocks)
+{
+    if (!(nLocalServices & NODE_COMPACT_FILTERS) || filterType != static_cast<uint8_t>(BlockFilterType::BASIC)) {
+        LogPrint("net", "peer=%d asked for filters of unsupported type %u, disconnecting\n", pfrom->id, filterType);
+        pfrom->fDisconnect = true;
+        return false;
     }
-    else
-    {
-        assert(recentRejects);
-        recentRejects->insert(txBase.GetHash());
 
-        if (pfrom->fWhitelisted)
-        {
-            // Always relay transactions received from whitelisted peers, even
-            // if they were already in the mempool or rejected from it due
-            // to policy, allowing the node to function as a gateway for
-            // nodes hidden behind it.
-            //
-            // Never relay transactions that we would assign a non-zero DoS
-            // score for, as we expect peers to do the same with us in that
-            // case.
-            if (!state.IsInvalid() || state.GetDoS() == 0)
-            {
-                LogPrintf("Force relaying tx %s from whitelisted peer=%d\n", txBase.GetHash().ToString(), pfrom->id);
-                txBase.Relay();
-            }
-            else
-            {
-                LogPrintf("Not relaying invalid transaction %s from whitelisted peer=%d (%s (code %d))\n",
-                    txBase.GetHash().ToString(), pfrom->id, state.GetRejectReason(), CValidationState::CodeToChar(state.GetRejectCode()));
-            }
-        }
+    LOCK(cs_main);
+    BlockMap::const_iterator mi = mapBlockIndex.find(hashStop);
+    if (mi == mapBlockIndex.end()) {
+        LogPrint("net", "peer=%d asked for filters up to unknown block %s, disconnecting\n", pfrom->id, hashStop.ToString());
+        pfrom->fDisconnect = true;
+        return false;
     }
-
-    if (state.IsInvalid())
-    {
-        RejectMemoryPoolTxBase(state, txBase, pfrom);
+    const CBlockIndex* pindexStop = mi->second;
+    if (!chainActive.Contains(pindexStop)) {
+        // the filters of a block reorganized away may be asked by a peer not knowing it yet
+        LogPrint("net", "peer=%d asked for filters up to block %s not in the active chain\n", pfrom->id, hashStop.ToString());
+        return false;
+    }
+    if (nStartHeight > static_cast<uint32_t>(pindexStop->nHeight) || pindexStop->nHeight - nStartHeight >= nMaxBlocks) {
+        LogPrint("net", "peer=%d asked for the filters of invalid heights %u-%d, disconnecting\n", pfrom->id, nStartHeight, pindexStop->nHeight);
+        pfrom->fDisconnect = true;
+        return false;
     }
+
+    vBlocks.reserve((pindexStop->nHeight - nStartHeight) / nInterval + 1);
+    for (int nHeight = nStartHeight; nHeight <= pindexStop->nHeight; nHeight += nInterval)
+        vBlocks.push_back(chainActive[nHeight]);
+    return true;
 }
 
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
@@ -6978,7 +9436,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         pfrom->fClient = !(pfrom->nServices & NODE_NETWORK);
 
         // Potentially mark this peer as a preferred download peer.
-        UpdatePreferredDownload(pfrom, State(pfrom->GetId()));
+        {
+            LOCK(cs_main);
+            UpdatePreferredDownload(pfrom, State(pfrom->GetId()));
+        }
 
         // Change version
         pfrom->PushMessage("verack");
@@ -7051,6 +9512,93 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             LOCK(cs_main);
             State(pfrom->GetId())->fCurrentlyConnected = true;
         }
+
+        if (fCompactBlocks) {
+            // The configured peers announce their blocks as compact blocks from the start, the others
+            // may be asked later on, see MaybeSetPeerAsAnnouncingHeaderAndIDs
+            pfrom->PushMessage("sendcmpct", IsCompactBlockHBPeer(pfrom->addr), CMPCTBLOCKS_VERSION);
+        }
+
+        if (fTxReconciliation && pfrom->fRelayTxes) {
+            uint64_t nSalt = GetRand(std::numeric_limits<uint64_t>::max()) + 1;
+            {
+                LOCK(pfrom->cs_inventory);
+                pfrom->txReconciliation.nLocalSalt = nSalt;
+            }
+            pfrom->PushMessage("sendrecon", TXRECONCILIATION_VERSION, nSalt);
+        }
+    }
+
+
+    else if (strCommand == "sendrecon")
+    {
+        uint32_t nReconVersion = 0;
+        uint64_t nRemoteSalt = 0;
+        vRecv >> nReconVersion >> nRemoteSalt;
+        bool fSent = false;
+        {
+            LOCK(pfrom->cs_inventory);
+            fSent = pfrom->txReconciliation.nLocalSalt != 0 && !pfrom->txReconciliation.fEnabled;
+        }
+        // Other versions are ignored, as the peers not reconciling: their transactions are announced
+        if (fSent && nReconVersion == TXRECONCILIATION_VERSION && nRemoteSalt != 0)
+            EnableTxReconciliation(pfrom, nRemoteSalt);
+    }
+
+
+    else if (strCommand == "reqrecon")
+    {
+        vector<uint32_t> vRequest;
+        vRecv >> vRequest;
+        if (vRequest.size() > MAX_RECON_SET_SIZE) {
+            Misbehaving(pfrom->GetId(), 20);
+            return error("message reqrecon size() = %u", vRequest.size());
+        }
+
+        vector<uint32_t> vWanted;
+        {
+            LOCK(pfrom->cs_inventory);
+            // The peer which made the connection asks for the reconciliations
+            if (!pfrom->txReconciliation.fEnabled || !pfrom->fInbound)
+                return true;
+            vector<uint256> vAnnounce, vShared;
+            pfrom->txReconciliation.Respond(vRequest, vWanted, vAnnounce, vShared);
+            RelayReconciledTxs(pfrom, vAnnounce, vShared);
+            LogPrint("net", "reconciliation with peer=%d: %u asked, %u announced, %u shared\n", pfrom->id,
+                     vWanted.size(), vAnnounce.size(), vShared.size());
+        }
+        pfrom->PushMessage("reconcildiff", vWanted);
+    }
+
+
+    else if (strCommand == "reconcildiff")
+    {
+        vector<uint32_t> vWanted;
+        vRecv >> vWanted;
+        if (vWanted.size() > MAX_RECON_SET_SIZE) {
+            Misbehaving(pfrom->GetId(), 20);
+            return error("message reconcildiff size() = %u", vWanted.size());
+        }
+
+        LOCK(pfrom->cs_inventory);
+        vector<uint256> vAnnounce, vShared;
+        if (!pfrom->txReconciliation.fEnabled || !pfrom->txReconciliation.Complete(vWanted, vAnnounce, vShared))
+            return true;
+        RelayReconciledTxs(pfrom, vAnnounce, vShared);
+        LogPrint("net", "reconciliation with peer=%d: %u announced, %u shared\n", pfrom->id, vAnnounce.size(), vShared.size());
+    }
+
+
+    else if (strCommand == "sendcmpct")
+    {
+        bool fAnnounceUsingCMPCTBLOCK = false;
+        uint64_t nCMPCTBLOCKVersion = 0;
+        vRecv >> fAnnounceUsingCMPCTBLOCK >> nCMPCTBLOCKVersion;
+        // Other versions are ignored, the peer may send the ones it supports
+        if (nCMPCTBLOCKVersion == CMPCTBLOCKS_VERSION) {
+            pfrom->fSupportsCompactBlocks = true;
+            pfrom->fPreferHeaderAndIDs = fAnnounceUsingCMPCTBLOCK;
+        }
     }
 
 
@@ -7115,9 +9663,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     LOCK(cs_vNodes);
                     // Use deterministic randomness to send to the same nodes for 24 hours
                     // at a time so the addrKnowns of the chosen nodes prevent repeats
-                    static uint256 hashSalt;
-                    if (hashSalt.IsNull())
-                        hashSalt = GetRandHash();
+                    static const uint256 hashSalt = GetRandHash();
                     uint64_t hashAddr = addr.GetHash();
                     uint256 hashRand = ArithToUint256(UintToArith256(hashSalt) ^ (hashAddr<<32) ^ ((GetTime()+hashAddr)/(24*60*60)));
                     hashRand = Hash(BEGIN(hashRand), END(hashRand));
@@ -7141,7 +9687,6 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             if (fReachable)
                 vAddrOk.push_back(addr);
         }
-        CNodeState *nodestate = State(pfrom->GetId());
         pfrom->m_addr_processed += num_proc;
         pfrom->m_addr_rate_limited += num_rate_limit;
         LogPrint("net", "Received addr: %u addresses (%u processed, %u rate-limited) from peer=%d%s\n",
@@ -7217,8 +9762,11 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     pfrom->PushMessage("getheaders", bl, inv.hash);
                     CNodeState *nodestate = State(pfrom->GetId());
                     if (chainActive.Tip()->GetBlockTime() > GetTime() - chainparams.GetConsensus().nPowTargetSpacing * 20 &&
-                        nodestate->nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
-                        vToFetch.push_back(inv);
+                        nodestate->nBlocksInFlight < nodestate->nMaxBlocksInFlight) {
+                        if (fCompactBlocks && pfrom->fSupportsCompactBlocks)
+                            vToFetch.push_back(CInv(MSG_CMPCT_BLOCK, inv.hash));
+                        else
+                            vToFetch.push_back(inv);
                         // Mark block as in flight already, even though the actual "getdata" message only goes out
                         // later (within the same cs_main lock, though).
                         MarkBlockAsInFlight(pfrom->GetId(), inv.hash, chainparams.GetConsensus());
@@ -7348,17 +9896,32 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             // we cannot use CBlockHeaders since it won't include the 0x00 nTx count at the end
             // we cannot use CBlock, since we added Certificates and its serialization is not backward compatible
             // We must use CBlockHeaderForNetwork, and ad-hoc class for this task
-            vector<CBlockHeaderForNetwork> vHeaders;
+            // The headers of the main chain come serialized from the cache, each one followed by
+            // the empty vector of transactions of CBlockHeaderForNetwork
+            std::vector<std::shared_ptr<const std::string> > vHeaders;
             int nLimit = MAX_HEADERS_RESULTS;
+            size_t nPayloadSize = 0;
             LogPrint("net", "getheaders from h(%d) to %s from peer=%d\n", (pindex ? pindex->nHeight : -1), hashStop.ToString(), pfrom->id);
             for (; pindex; pindex = chainActive.Next(pindex))
             {
-                vHeaders.push_back(CBlockHeaderForNetwork(pindex->GetBlockHeader()) );
+                vHeaders.push_back(headerCache.GetRaw(pindex));
+                nPayloadSize += vHeaders.back()->size() + 1;
                 if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
                     break;
             }
+            CPlainDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss.reserve(nPayloadSize + 9);
+            WriteCompactSize(ss, vHeaders.size());
+            for (const std::shared_ptr<const std::string>& header : vHeaders)
+            {
+                ss.write(header->data(), header->size());
+                WriteCompactSize(ss, 0);
+            }
+            std::shared_ptr<CPlainSerializeData> payload = std::make_shared<CPlainSerializeData>();
+            payload->reserve(ss.size());
+            ss.GetAndClear(*payload);
             LogPrint("forks", "%s():%d - Pushing %d headers to node[%s]\n", __func__, __LINE__, vHeaders.size(), pfrom->addrName);
-            pfrom->PushMessage("headers", vHeaders);
+            pfrom->PushSharedMessage(CSharedMessage("headers", payload, payload->data(), payload->size()));
         }
         else
         {
@@ -7549,13 +10112,32 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
-        LOCK(cs_main);
-
         if (nCount == 0) {
             // Nothing interesting. Stop asking this peers for more headers.
+            LOCK(cs_main);
+            State(pfrom->GetId())->fHeadersRangeRequested = false;
+            CHeadersRange* prange = GetHeadersRange(pfrom->GetId());
+            if (prange)
+                prange->nodeid = -1;
             return true;
         }
 
+        // The Equihash solutions of the new headers are checked first, all at once and without cs_main
+        std::vector<bool> vKnown(nCount);
+        {
+            LOCK(cs_main);
+            for (unsigned int n = 0; n < nCount; n++)
+                vKnown[n] = mapBlockIndex.count(headers[n].GetHash()) != 0;
+        }
+        CValidationState statePoW;
+        const size_t nValidPoW = CheckBlockHeadersPoW(headers, vKnown, statePoW);
+
+        LOCK(cs_main);
+
+        CNodeState* nodestate = State(pfrom->GetId());
+        if (nodestate->fHeadersRangeRequested && mapBlockIndex.count(headers[0].hashPrevBlock) == 0)
+            return ProcessHeadersRange(pfrom, *nodestate, headers, nValidPoW, statePoW);
+
         CBlockIndex *pindexLast = NULL;
         int cnt = 0;
         BOOST_FOREACH(const CBlockHeader& header, headers) {
@@ -7568,7 +10150,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
             bool lookForwardTips = (++cnt == MAX_HEADERS_RESULTS);
 
-            if (!AcceptBlockHeader(header, state, &pindexLast, lookForwardTips))
+            if ((size_t)(cnt - 1) == nValidPoW)
+                state = statePoW;
+            if ((size_t)(cnt - 1) == nValidPoW ||
+                !AcceptBlockHeader(header, state, &pindexLast, lookForwardTips, flagCheckPow::OFF))
             {
                 if (state.IsInvalid())
                 {
@@ -7582,7 +10167,18 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         if (pindexLast)
             UpdateBlockAvailability(pfrom->GetId(), pindexLast->GetBlockHash());
 
-        if (nCount == MAX_HEADERS_RESULTS && pindexLast) {
+        // The ranges downloaded meanwhile from other peers save asking this one for their headers
+        if (ConnectHeadersRanges() && pindexLast && pindexBestHeader->GetAncestor(pindexLast->nHeight) == pindexLast)
+            pindexLast = pindexBestHeader;
+
+        if (nodestate->fHeadersRangeRequested) {
+            // the peer is not the one of the headers sync: the answer for a range connected meanwhile, or an announcement
+            if (GetHeadersRange(pfrom->GetId()) == NULL) {
+                nodestate->fHeadersRangeRequested = false;
+                RequestHeadersRange(pfrom, *nodestate);
+            }
+        }
+        else if (nCount == MAX_HEADERS_RESULTS && pindexLast) {
             // Headers message had its maximum size; the peer may have more headers.
             // TODO: optimize: if pindexLast is an ancestor of chainActive.Tip or pindexBestHeader, continue
             // from there instead.
@@ -7604,32 +10200,269 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
     else if (strCommand == "block" && !fImporting && !fReindex && !fReindexFast) // Ignore blocks received while importing
     {
+        const size_t nSize = vRecv.size();
         CBlock block;
         vRecv >> block;
 
-        CInv inv(MSG_BLOCK, block.GetHash());
-        LogPrint("net", "%s():%d - received block %s peer=%d\n", __func__, __LINE__, inv.hash.ToString(), pfrom->id);
+        LogPrint("net", "%s():%d - received block %s peer=%d\n", __func__, __LINE__, block.GetHash().ToString(), pfrom->id);
+        {
+            LOCK(cs_main);
+            UpdateBlockDownloadStats(pfrom->GetId(), block.GetHash(), nSize);
+        }
 
-        pfrom->AddInventoryKnown(inv);
+        ProcessReceivedBlock(pfrom, block, strCommand);
+    }
 
-        CValidationState state;
-        // Process all blocks from whitelisted peers, even if not requested,
-        // unless we're still syncing with the network.
-        // Such an unrequested block may still be processed, subject to the
-        // conditions in AcceptBlock().
-        bool forceProcessing = pfrom->fWhitelisted && !IsInitialBlockDownload();
-        ProcessNewBlock(state, pfrom, &block, forceProcessing, NULL);
-        if (state.IsInvalid())
-        {
-            LogPrint("forks", "%s():%d - Pushing reject, DoS[%d]\n", __func__, __LINE__, state.GetDoS());
-            pfrom->PushMessage("reject", strCommand, CValidationState::CodeToChar(state.GetRejectCode()),
-                               state.GetRejectReason().substr(0, MAX_REJECT_MESSAGE_LENGTH), inv.hash);
-            if (state.GetDoS() > 0)
-            {
-                LOCK(cs_main);
-                Misbehaving(pfrom->GetId(), state.GetDoS());
+
+    else if (strCommand == "cmpctblock" && !fImporting && !fReindex && !fReindexFast)
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
+
+        const uint256 hash = cmpctblock.header.GetHash();
+        LogPrint("cmpctblock", "%s():%d - received compact block %s peer=%d\n", __func__, __LINE__, hash.ToString(), pfrom->id);
+        pfrom->AddInventoryKnown(CInv(MSG_BLOCK, hash));
+
+        CBlock block;
+        bool fBlockReconstructed = false;
+        {
+            LOCK(cs_main);
+
+            if (mapBlockIndex.find(cmpctblock.header.hashPrevBlock) == mapBlockIndex.end()) {
+                // The block does not connect to what we know: get the headers in between first
+                if (!IsInitialBlockDownload())
+                    pfrom->PushMessage("getheaders", chainActive.GetLocator(pindexBestHeader), uint256());
+                return true;
+            }
+
+            CBlockIndex* pindex = NULL;
+            CValidationState state;
+            if (!AcceptBlockHeader(cmpctblock.header, state, &pindex)) {
+                if (state.IsInvalid()) {
+                    if (state.GetDoS() > 0)
+                        Misbehaving(pfrom->GetId(), state.GetDoS());
+                    return error("invalid header received in compact block %s", hash.ToString());
+                }
+                return true;
+            }
+            UpdateBlockAvailability(pfrom->GetId(), hash);
+
+            if (pindex->nStatus & BLOCK_HAVE_DATA)
+                return true;
+
+            map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(hash);
+            const bool fInFlightFromPeer = itInFlight != mapBlocksInFlight.end() && itInFlight->second.first == pfrom->GetId();
+            if (!fInFlightFromPeer) {
+                // Not asked for: only worth it when it is the new tip, and nobody else is already sending it
+                if (pindex->nChainWork <= chainActive.Tip()->nChainWork || itInFlight != mapBlocksInFlight.end() ||
+                    State(pfrom->GetId())->nBlocksInFlight >= State(pfrom->GetId())->nMaxBlocksInFlight)
+                    return true;
+                MarkBlockAsInFlight(pfrom->GetId(), hash, chainparams.GetConsensus(), pindex);
+                itInFlight = mapBlocksInFlight.find(hash);
+            }
+
+            QueuedBlock& queued = *itInFlight->second.second;
+            if (queued.partialBlock)
+                return true; // already being rebuilt
+            queued.partialBlock.reset(new PartiallyDownloadedBlock(&mempool));
+
+            ReadStatus status = queued.partialBlock->InitData(cmpctblock);
+            if (status == ReadStatus::INVALID) {
+                MarkBlockAsReceived(hash);
+                Misbehaving(pfrom->GetId(), 100);
+                return error("invalid compact block %s received from peer=%d", hash.ToString(), pfrom->id);
+            }
+
+            BlockTransactionsRequest req;
+            if (status == ReadStatus::OK) {
+                for (size_t i = 0; i < queued.partialBlock->GetTxCount(); i++) {
+                    if (!queued.partialBlock->IsTxAvailable(i))
+                        req.indexes.push_back(i);
+                }
+                if (req.indexes.empty()) {
+                    status = queued.partialBlock->FillBlock(block, std::vector<CTransaction>(), std::vector<CScCertificate>());
+                    fBlockReconstructed = status == ReadStatus::OK;
+                }
+            }
+
+            if (status != ReadStatus::OK) {
+                // Short id collision: the block is still expected from this peer, in full
+                queued.partialBlock.reset();
+                vector<CInv> vInv(1, CInv(MSG_BLOCK, hash));
+                pfrom->PushMessage("getdata", vInv);
+                return true;
+            }
+
+            if (fBlockReconstructed) {
+                queued.partialBlock.reset();
+            } else {
+                req.blockhash = hash;
+                LogPrint("cmpctblock", "%s():%d - requesting %u missing of compact block %s from peer=%d\n",
+                    __func__, __LINE__, req.indexes.size(), hash.ToString(), pfrom->id);
+                pfrom->PushMessage("getblocktxn", req);
+            }
+        }
+
+        if (fBlockReconstructed)
+            ProcessReceivedBlock(pfrom, block, strCommand);
+    }
+
+
+    else if (strCommand == "getblocktxn")
+    {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        CDiskBlockPos blockPos;
+        bool fSendFull = false;
+        {
+            LOCK(cs_main);
+            BlockMap::iterator mi = mapBlockIndex.find(req.blockhash);
+            if (mi == mapBlockIndex.end() || !(mi->second->nStatus & BLOCK_HAVE_DATA)) {
+                LogPrint("cmpctblock", "peer=%d asked for the transactions of unknown block %s\n", pfrom->id, req.blockhash.ToString());
+                return true;
+            }
+            // An old block is served in full, with the checks of a getdata
+            fSendFull = mi->second->nHeight < chainActive.Height() - MAX_BLOCKTXN_DEPTH;
+            blockPos = mi->second->GetBlockPos();
+        }
+
+        if (fSendFull) {
+            pfrom->vRecvGetData.push_back(CInv(MSG_BLOCK, req.blockhash));
+            ProcessGetData(pfrom);
+            return true;
+        }
+
+        CBlock block;
+        if (!ReadRecentBlockOrFromDisk(block, blockPos, req.blockhash))
+            return error("%s: cannot load block %s from disk", __func__, req.blockhash.ToString());
+
+        BlockTransactions resp(req);
+        BOOST_FOREACH(uint32_t index, req.indexes) {
+            if (index < block.vtx.size()) {
+                resp.txn.push_back(block.vtx[index]);
+            } else if (index < block.vtx.size() + block.vcert.size()) {
+                resp.certs.push_back(block.vcert[index - block.vtx.size()]);
+            } else {
+                Misbehaving(pfrom->GetId(), 100);
+                return error("getblocktxn index %u out of block %s from peer=%d", index, req.blockhash.ToString(), pfrom->id);
+            }
+        }
+        pfrom->PushMessage("blocktxn", resp);
+    }
+
+
+    else if (strCommand == "getcfilters")
+    {
+        uint8_t filterType;
+        uint32_t nStartHeight;
+        uint256 hashStop;
+        vRecv >> filterType >> nStartHeight >> hashStop;
+
+        std::vector<const CBlockIndex*> vBlocks;
+        if (!PrepareBlockFilterRequest(pfrom, filterType, nStartHeight, hashStop, MAX_GETCFILTERS_SIZE, 1, vBlocks))
+            return true;
+
+        std::vector<unsigned char> filter;
+        BOOST_FOREACH(const CBlockIndex* pindex, vBlocks) {
+            if (!CBlockFilterIndexer::LookupFilter(pindex->GetBlockHash(), filter)) {
+                // the index has not reached the block yet
+                LogPrint("net", "filter of block %s asked by peer=%d not indexed\n", pindex->GetBlockHash().ToString(), pfrom->id);
+                break;
+            }
+            pfrom->PushMessage("cfilter", filterType, pindex->GetBlockHash(), filter);
+        }
+    }
+
+
+    else if (strCommand == "getcfheaders")
+    {
+        uint8_t filterType;
+        uint32_t nStartHeight;
+        uint256 hashStop;
+        vRecv >> filterType >> nStartHeight >> hashStop;
+
+        std::vector<const CBlockIndex*> vBlocks;
+        if (!PrepareBlockFilterRequest(pfrom, filterType, nStartHeight, hashStop, MAX_GETCFHEADERS_SIZE, 1, vBlocks))
+            return true;
+
+        // the header of the filter before the first one asked, null for the genesis
+        uint256 filterHash, prevHeader, header;
+        if (vBlocks.front()->pprev != NULL &&
+            !CBlockFilterIndexer::LookupFilterHeader(vBlocks.front()->pprev->GetBlockHash(), filterHash, prevHeader)) {
+            LogPrint("net", "filter headers asked by peer=%d not indexed\n", pfrom->id);
+            return true;
+        }
+        std::vector<uint256> vFilterHashes;
+        vFilterHashes.reserve(vBlocks.size());
+        BOOST_FOREACH(const CBlockIndex* pindex, vBlocks) {
+            if (!CBlockFilterIndexer::LookupFilterHeader(pindex->GetBlockHash(), filterHash, header)) {
+                LogPrint("net", "filter headers asked by peer=%d not indexed\n", pfrom->id);
+                return true;
+            }
+            vFilterHashes.push_back(filterHash);
+        }
+        pfrom->PushMessage("cfheaders", filterType, hashStop, prevHeader, vFilterHashes);
+    }
+
+
+    else if (strCommand == "getcfcheckpt")
+    {
+        uint8_t filterType;
+        uint256 hashStop;
+        vRecv >> filterType >> hashStop;
+
+        // the headers at the heights multiple of CFCHECKPT_INTERVAL, but the genesis
+        std::vector<const CBlockIndex*> vBlocks;
+        if (!PrepareBlockFilterRequest(pfrom, filterType, 0, hashStop, std::numeric_limits<uint32_t>::max(), CFCHECKPT_INTERVAL, vBlocks))
+            return true;
+
+        std::vector<uint256> vHeaders;
+        vHeaders.reserve(vBlocks.size() - 1);
+        uint256 filterHash, header;
+        for (size_t i = 1; i < vBlocks.size(); ++i) {
+            if (!CBlockFilterIndexer::LookupFilterHeader(vBlocks[i]->GetBlockHash(), filterHash, header)) {
+                LogPrint("net", "filter checkpoints asked by peer=%d not indexed\n", pfrom->id);
+                return true;
+            }
+            vHeaders.push_back(header);
+        }
+        pfrom->PushMessage("cfcheckpt", filterType, hashStop, vHeaders);
+    }
+
+
+    else if (strCommand == "blocktxn" && !fImporting && !fReindex && !fReindexFast)
+    {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        CBlock block;
+        {
+            LOCK(cs_main);
+
+            map<uint256, pair<NodeId, list<QueuedBlock>::iterator> >::iterator itInFlight = mapBlocksInFlight.find(resp.blockhash);
+            if (itInFlight == mapBlocksInFlight.end() || itInFlight->second.first != pfrom->GetId() ||
+                !itInFlight->second.second->partialBlock) {
+                LogPrint("cmpctblock", "peer=%d sent the transactions of block %s, not asked for\n", pfrom->id, resp.blockhash.ToString());
+                return true;
+            }
+
+            QueuedBlock& queued = *itInFlight->second.second;
+            ReadStatus status = queued.partialBlock->FillBlock(block, resp.txn, resp.certs);
+            queued.partialBlock.reset();
+            if (status == ReadStatus::INVALID) {
+                MarkBlockAsReceived(resp.blockhash);
+                Misbehaving(pfrom->GetId(), 100);
+                return error("invalid transactions of compact block %s received from peer=%d", resp.blockhash.ToString(), pfrom->id);
+            } else if (status == ReadStatus::FAILED) {
+                // Short id collision: the block is still expected from this peer, in full
+                vector<CInv> vInv(1, CInv(MSG_BLOCK, resp.blockhash));
+                pfrom->PushMessage("getdata", vInv);
+                return true;
             }
         }
+
+        ProcessReceivedBlock(pfrom, block, strCommand);
     }
 
 
@@ -7648,7 +10481,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         }
         pfrom->fSentAddr = true;
 
-        pfrom->vAddrToSend.clear();
+        {
+            LOCK(pfrom->cs_inventory);
+            pfrom->vAddrToSend.clear();
+        }
         vector<CAddress> vAddr = addrman.GetAddr();
         BOOST_FOREACH(const CAddress &addr, vAddr)
             pfrom->PushAddress(addr);
@@ -7890,17 +10726,18 @@ bool ProcessMessages(CNode* pfrom)
         // Message size
         unsigned int nMessageSize = hdr.nMessageSize;
 
-        // Checksum
+        // Checksum, verified by the socket thread as the data arrived
         CDataStream& vRecv = msg.vRecv;
-        uint256 hash = Hash(vRecv.begin(), vRecv.begin() + nMessageSize);
-        unsigned int nChecksum = ReadLE32((unsigned char*)&hash);
-        if (nChecksum != hdr.nChecksum)
+        if (!msg.IsChecksumValid())
         {
             LogPrintf("%s(%s, %u bytes): CHECKSUM ERROR nChecksum=%08x hdr.nChecksum=%08x\n", __func__,
-               SanitizeString(strCommand), nMessageSize, nChecksum, hdr.nChecksum);
+               SanitizeString(strCommand), nMessageSize, msg.GetChecksum(), hdr.nChecksum);
             continue;
         }
 
+        if (messageCapture.IsOpen())
+            messageCapture.Record(pfrom, msg);
+
         // Process message
         bool fRet = false;
         try
@@ -7998,8 +10835,10 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
             BOOST_FOREACH(CNode* pnode, vNodes)
             {
                 // Periodically clear addrKnown to allow refresh broadcasts
-                if (nLastRebroadcast)
+                if (nLastRebroadcast) {
+                    LOCK(pnode->cs_inventory);
                     pnode->addrKnown.reset();
+                }
 
                 // Rebroadcast our address
                 AdvertizeLocal(pnode);
@@ -8013,6 +10852,7 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         //
         if (fSendTrickle)
         {
+            LOCK(pto->cs_inventory);
             vector<CAddress> vAddr;
             vAddr.reserve(pto->vAddrToSend.size());
             BOOST_FOREACH(const CAddress& addr, pto->vAddrToSend)
@@ -8093,6 +10933,8 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
                 }
             }
         }
+        if (!state.fSyncStarted && !state.fHeadersRangeRequested && !pto->fClient && !fImporting && !fReindex && !fReindexFast)
+            RequestHeadersRange(pto, state);
 
         // Resend wallet transactions that haven't gotten in a block yet
         // Except during reindex, importing and IBD, when old wallet
@@ -8106,47 +10948,71 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         // Message: inventory
         //
         vector<CInv> vInv;
-        vector<CInv> vInvWait;
         {
             LOCK(pto->cs_inventory);
             vInv.reserve(pto->vInventoryToSend.size());
-            vInvWait.reserve(pto->vInventoryToSend.size());
             BOOST_FOREACH(const CInv& inv, pto->vInventoryToSend)
             {
-                if (pto->setInventoryKnown.count(inv))
-                    continue;
-
-                // trickle out tx inv to protect privacy
-                if (inv.type == MSG_TX && !fSendTrickle)
+                // returns true if wasn't already contained in the set
+                if (pto->setInventoryKnown.insert(inv).second)
                 {
-                    // 1/4 of tx invs blast to all immediately
-                    static uint256 hashSalt;
-                    if (hashSalt.IsNull())
-                        hashSalt = GetRandHash();
-                    uint256 hashRand = ArithToUint256(UintToArith256(inv.hash) ^ UintToArith256(hashSalt));
-                    hashRand = Hash(BEGIN(hashRand), END(hashRand));
-                    bool fTrickleWait = ((UintToArith256(hashRand) & 3) != 0);
-
-                    if (fTrickleWait)
+                    vInv.push_back(inv);
+                    if (vInv.size() >= 1000)
                     {
-                        vInvWait.push_back(inv);
-                        continue;
+                        LogPrint("forks", "%s():%d - Pushing inv\n", __func__, __LINE__);
+                        pto->PushMessage("inv", vInv);
+                        vInv.clear();
                     }
                 }
+            }
+            pto->vInventoryToSend.clear();
 
-                // returns true if wasn't already contained in the set
-                if (pto->setInventoryKnown.insert(inv).second)
+            // trickle out tx inv to protect privacy: all of them at once, at random times for every peer,
+            // so that the order in which the peers hear of a transaction does not tell where it comes from
+            int64_t nNow = GetTimeMicros();
+
+            // the reconciliations with the outbound peers, those with the inbound ones are answered
+            CTxReconciliationState& recon = pto->txReconciliation;
+            if (recon.fEnabled && !pto->fInbound) {
+                vector<uint256> vAnnounce;
+                if (recon.nRequestTime != 0 && recon.nRequestTime < nNow - 1000000 * RECON_RESPONSE_TIMEOUT) {
+                    LogPrint("net", "reconciliation with peer=%d timed out\n", pto->id);
+                    recon.Abort(vAnnounce);
+                }
+                if (recon.nRequestTime == 0 && recon.nNextRequest < nNow) {
+                    recon.nNextRequest = PoissonNextSend(nNow, RECON_REQUEST_INTERVAL);
+                    for (std::set<uint256>::iterator it = recon.setPending.begin(); it != recon.setPending.end(); ) {
+                        if (pto->filterInventoryTxKnown.contains(*it))
+                            it = recon.setPending.erase(it);
+                        else
+                            ++it;
+                    }
+                    pto->PushMessage("reqrecon", recon.StartRequest(nNow, vAnnounce));
+                }
+                RelayReconciledTxs(pto, vAnnounce, vector<uint256>());
+            }
+            bool fSendTxs = pto->fWhitelisted;
+            if (pto->nNextInvSend < nNow)
+            {
+                fSendTxs = true;
+                pto->nNextInvSend = PoissonNextSend(nNow, INVENTORY_BROADCAST_INTERVAL >> !pto->fInbound);
+            }
+            if (fSendTxs)
+            {
+                BOOST_FOREACH(const uint256& hash, pto->setInventoryTxToSend)
                 {
-                    vInv.push_back(inv);
+                    if (pto->filterInventoryTxKnown.contains(hash))
+                        continue;
+                    pto->filterInventoryTxKnown.insert(hash);
+                    vInv.push_back(CInv(MSG_TX, hash));
                     if (vInv.size() >= 1000)
                     {
-                        LogPrint("forks", "%s():%d - Pushing inv\n", __func__, __LINE__);
                         pto->PushMessage("inv", vInv);
                         vInv.clear();
                     }
                 }
+                pto->setInventoryTxToSend.clear();
             }
-            pto->vInventoryToSend = vInvWait;
         }
         if (!vInv.empty())
         {
@@ -8190,10 +11056,11 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         // Message: getdata (blocks)
         //
         vector<CInv> vGetData;
-        if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload()) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload()) && state.nBlocksInFlight < state.nMaxBlocksInFlight) {
             vector<CBlockIndex*> vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
+            CBlockIndex* pindexStalled = NULL;
+            FindNextBlocksToDownload(pto->GetId(), state.nMaxBlocksInFlight - state.nBlocksInFlight, vToDownload, staller, pindexStalled);
             BOOST_FOREACH(CBlockIndex *pindex, vToDownload) {
                 vGetData.push_back(CInv(MSG_BLOCK, pindex->GetBlockHash()));
                 MarkBlockAsInFlight(pto->GetId(), pindex->GetBlockHash(), consensusParams, pindex);
@@ -8201,8 +11068,15 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
                     __func__, __LINE__, pindex->GetBlockHash().ToString(), pindex->nHeight, pto->id);
             }
             if (state.nBlocksInFlight == 0 && staller != -1) {
-                if (State(staller)->nStallingSince == 0) {
-                    State(staller)->nStallingSince = nNow;
+                CNodeState* stateStaller = State(staller);
+                if (state.dBlockDownloadRate > BLOCK_STALLING_RATE_FACTOR * stateStaller->dBlockDownloadRate) {
+                    // This peer is idle and faster: the block holding the window is asked from it instead
+                    LogPrint("net", "Requesting stalled block %s (%d) from peer=%d instead of peer=%d\n",
+                        pindexStalled->GetBlockHash().ToString(), pindexStalled->nHeight, pto->id, staller);
+                    vGetData.push_back(CInv(MSG_BLOCK, pindexStalled->GetBlockHash()));
+                    MarkBlockAsInFlight(pto->GetId(), pindexStalled->GetBlockHash(), consensusParams, pindexStalled);
+                } else if (stateStaller->nStallingSince == 0) {
+                    stateStaller->nStallingSince = nNow;
                     LogPrint("net", "Stall started peer=%d\n", staller);
                 }
             }
@@ -8249,14 +11123,10 @@ public:
     CMainCleanup() {}
     ~CMainCleanup() {
         // block headers
-        BlockMap::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
-        mapBlockIndex.clear();
+        ClearBlockIndexEntries();
 
         // orphan transactions
-        mapOrphanTransactions.clear();
-        mapOrphanTransactionsByPrev.clear();
+        ClearOrphanTxs();
     }
 } instance_of_cmaincleanup;
 
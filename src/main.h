@@ -26,6 +26,7 @@
 #include <algorithm>
 #include <exception>
 #include <map>
+#include <memory>
 #include <set>
 #include <stdint.h>
 #include <string>
@@ -38,9 +39,13 @@ class CTransaction;
 class CCoins;
 class CCoinsViewCache;
 class CCoinsView;
+class CCoinsViewDB;
+class CAutoFile;
+struct CTxOutSetSnapshotHeader;
 class CBlock;
 class CBlockLocator;
 class CBlockTreeDB;
+class CRawBlock;
 class CScriptCheck;
 class CValidationState;
 class CTxUndo;
@@ -74,6 +79,9 @@ enum class AddressType;
     #error "Undetectable endianness"
 #endif
 
+/** Default for -checkblockindexpow, whether the proof of work of the block index entries is checked at startup */
+static const bool DEFAULT_CHECKBLOCKINDEXPOW = true;
+
 /** Default for -blockmaxsize and -blockminsize, which control the range of sizes the mining code will create **/
 static const unsigned int DEFAULT_BLOCK_MAX_SIZE = MAX_BLOCK_SIZE;
 static const unsigned int DEFAULT_BLOCK_MAX_SIZE_BEFORE_SC = MAX_BLOCK_SIZE_BEFORE_SC;
@@ -96,20 +104,67 @@ static const unsigned int MAX_P2SH_SIGOPS = 15;
 static const unsigned int MAX_STANDARD_TX_SIGOPS = MAX_BLOCK_SIGOPS/5;
 /** Default for -minrelaytxfee, minimum relay fee for transactions */
 static const unsigned int DEFAULT_MIN_RELAY_TX_FEE = 100;
+/** Default for -blocktemplatefeegain, fees the mempool gathers on top of the latest block template before long pollers are woken up */
+static const CAmount DEFAULT_BLOCK_TEMPLATE_FEE_GAIN = 100000;
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
+/** Default for -maxorphanpoolsize, maximum kilobytes of orphan transactions kept in memory */
+static const unsigned int DEFAULT_MAX_ORPHAN_POOL_SIZE = 500;
+/** Default for -maxorphanpeersize, maximum kilobytes of orphan transactions kept in memory for a single peer */
+static const unsigned int DEFAULT_MAX_ORPHAN_PEER_SIZE = 100;
+/** Expiration time for orphan transactions in seconds */
+static const int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
+/** Minimum time between orphan transactions expire time checks in seconds */
+static const int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
+/** Default for -maxmempool, maximum megabytes of mempool memory usage (0 = no limit) */
+static const unsigned int DEFAULT_MAX_MEMPOOL_SIZE = 300;
+/** Default for -mempoolexpiry, expiration time for mempool transactions in hours (0 = no expiry) */
+static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 0;
+/** Default for -persistmempool, dump the mempool on shutdown and load it on startup */
+static const bool DEFAULT_PERSIST_MEMPOOL = true;
+/** Default for -mapblockfiles, whether the block and undo files no longer written to are read through memory mappings */
+static const bool DEFAULT_MAP_BLOCK_FILES = true;
+/** Default for -compressblockfiles, whether the blocks and undo data are written compressed to the block and undo files */
+static const bool DEFAULT_COMPRESS_BLOCK_FILES = false;
+/** Flag of the record size in the index header of the blocks and undo data, set when the record is compressed */
+static const uint32_t DISK_RECORD_COMPRESSED = 0x80000000;
+/** The maximum number of block and undo files mapped at once */
+static const size_t MAX_MAPPED_BLOCK_FILES = 256;
+/** Default for -limitancestorcount, max number of in-mempool ancestors of a tx, itself included (0 = no limit) */
+static const unsigned int DEFAULT_ANCESTOR_LIMIT = 0;
+/** Default for -limitancestorsize, max size in kilobytes of a tx together with its in-mempool ancestors (0 = no limit) */
+static const unsigned int DEFAULT_ANCESTOR_SIZE_LIMIT = 0;
+/** Default for -limitdescendantcount, max number of in-mempool descendants of a tx, itself included (0 = no limit) */
+static const unsigned int DEFAULT_DESCENDANT_LIMIT = 0;
+/** Default for -limitdescendantsize, max size in kilobytes of a tx together with its in-mempool descendants (0 = no limit) */
+static const unsigned int DEFAULT_DESCENDANT_SIZE_LIMIT = 0;
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
 static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
+/** The blk?????.dat chunks pre-allocated at once, for fewer allocations and file extents in the initial download */
+static const unsigned int BLOCKFILE_PREALLOC_CHUNKS = 4;
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 /** Maximum number of script-checking threads allowed */
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
-/** Number of blocks that can be requested at any given time from a single peer. */
+/** -proverthreads default (number of threads of the libsnark proofs, 0 = auto) */
+static const int DEFAULT_PROVER_THREADS = 0;
+/** Maximum number of threads reading in advance the inputs of the connected blocks */
+static const int MAX_COINS_PREFETCH_THREADS = 16;
+/** -coinsprefetchthreads default */
+static const int DEFAULT_COINS_PREFETCH_THREADS = 4;
+/** Number of blocks that can be requested at any given time from a single peer, until its download rate is measured. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Bounds of the number of blocks in flight from a single peer, once sized on its download rate. */
+static const int MIN_BLOCKS_IN_TRANSIT_PER_PEER = 2;
+static const int MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER = 64;
+/** Seconds of download, at the rate measured for a peer, the blocks in flight from it should amount to. */
+static const int BLOCK_DOWNLOAD_TARGET_TIME = 8;
+/** A peer this many times faster than the one stalling the download window is asked for the stalled block. */
+static const int BLOCK_STALLING_RATE_FACTOR = 2;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
 static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
@@ -124,15 +179,56 @@ static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
 static const unsigned int DATABASE_FLUSH_INTERVAL = 24 * 60 * 60;
+/** Share of the coins cache budget the adaptive cache is trimmed to when over it, in percent. */
+static const unsigned int COINS_CACHE_TRIM_PERCENT = 75;
 /** Maximum length of reject messages. */
 static const unsigned int MAX_REJECT_MESSAGE_LENGTH = 111;
 /* Maximum number of heigths meaningful when looking for block finality */
 static const int MAX_BLOCK_AGE_FOR_FINALITY = 2000;
+/** -compactblocks default */
+static const bool DEFAULT_COMPACT_BLOCKS = true;
+/** -compactblockhbpeers default: peers chosen among the fastest to announce blocks as compact blocks straight away */
+static const unsigned int DEFAULT_MAX_COMPACT_BLOCK_HB_PEERS = 3;
+/** Depth up to which a block is served as a compact block, deeper ones are not in the mempool of the peer anymore */
+static const int MAX_CMPCTBLOCK_DEPTH = 5;
+/** Depth up to which the transactions of a compact block are served by "blocktxn", the full block otherwise */
+static const int MAX_BLOCKTXN_DEPTH = 10;
+/** -headerssyncpeers default: other peers the ranges of headers between the checkpoints are downloaded from */
+static const unsigned int DEFAULT_HEADERS_SYNC_PEERS = 4;
+/** Seconds a peer has to answer the request of a range of headers, before the range goes to another peer */
+static const int64_t HEADERS_RANGE_TIMEOUT = 60;
+/** Default for -blockconnectstats, the last blocks whose connection is profiled for getblockconnectstats */
+static const unsigned int DEFAULT_BLOCK_CONNECT_STATS = 1000;
+/** Default for -reorgcachesize, the last blocks connected kept in memory with their undo data for the reorgs */
+static const unsigned int DEFAULT_REORG_CACHE_SIZE = 10;
+/** Default for -checkblocks, the last blocks verified at startup, 0 for all */
+static const int DEFAULT_CHECKBLOCKS = 288;
+/** Default for -checklevel */
+static const int DEFAULT_CHECKLEVEL = 3;
+/** Default for -checkblocksseconds, the time the verification of the blocks at startup can take, 0 for no limit */
+static const int64_t DEFAULT_CHECKBLOCKS_SECONDS = 0;
+/** Default for -checkblocksbackground, verifying the coins database against the blocks once the node is up */
+static const bool DEFAULT_CHECKBLOCKS_BACKGROUND = false;
+/** The most threads reading and checking the blocks verified at startup */
+static const int MAX_VERIFYDB_THREADS = 16;
 
 static const bool DEFAULT_TXINDEX = false;
 static const bool DEFAULT_MATURITYHEIGHTINDEX = false;
 static const bool DEFAULT_ADDRESSINDEX = false;
+/** The default number of threads looking up the addresses of a single address index rpc call */
+static const int DEFAULT_ADDRESSINDEX_THREADS = 4;
+/** The most -addressindexthreads can be */
+static const int MAX_ADDRESSINDEX_THREADS = 16;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
+static const bool DEFAULT_PEERBLOCKFILTERS = false;
+static const bool DEFAULT_SCINDEX = false;
+/** The most filters a getcfilters message can ask for, BIP 157 */
+static const unsigned int MAX_GETCFILTERS_SIZE = 1000;
+/** The most filter hashes a getcfheaders message can ask for, BIP 157 */
+static const unsigned int MAX_GETCFHEADERS_SIZE = 2000;
+/** The blocks between two filter headers of a cfcheckpt message, BIP 157 */
+static const int CFCHECKPT_INTERVAL = 1000;
 static const bool DEFAULT_SPENTINDEX = false;
 
 // Sanity check the magic numbers when we change them
@@ -166,9 +262,23 @@ extern bool fImporting;
 extern bool fReindex;
 extern bool fReindexFast;
 extern int nScriptCheckThreads;
+extern int nCoinsPrefetchThreads;
+extern bool fMapBlockFiles;
+extern bool fCompressBlockFiles;
+extern bool fCompactBlocks;
+extern unsigned int nMaxCompactBlockHBPeers;
+extern unsigned int nHeadersSyncPeers;
+extern bool fTxReconciliation;
+extern unsigned int nReconFloodPeers;
+/** The peers always asked to announce their blocks as compact blocks, from -compactblockhbpeer */
+extern std::vector<CSubNet> vCompactBlockHBRanges;
+/** Block whose ancestors (and itself) get their sidechain proofs assumed valid (-assumevalidsc), null if none */
+extern uint256 hashAssumeValidSc;
 
 extern bool fAddressIndex;
 extern bool fTimestampIndex;
+extern bool fBlockFilterIndex;
+extern bool fScIndex;
 extern bool fSpentIndex;
 extern bool fTxIndex;
 extern bool fMaturityHeightIndex;
@@ -177,7 +287,13 @@ extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
 extern bool fRegtestAllowDustOutput;
 extern size_t nCoinCacheUsage;
+//! -dbcache=auto: the coins cache is written without being emptied, evicting the cold entries when over nCoinCacheUsage
+extern bool fAdaptiveCoinsCache;
 extern CFeeRate minRelayTxFee;
+extern CAmount nBlockTemplateFeeGain;
+
+/** Record the mempool fees total (see CTxMemPool::GetFeesAdded) the latest block template was built with */
+void SetBlockTemplateFeesBaseline(const CAmount& nMempoolFeesAdded);
 
 /** Comparison function for sorting the getchaintips heads.  */
 struct CompareBlocksByHeight
@@ -195,7 +311,43 @@ struct CompareBlocksByHeight
 };
 
 typedef std::map<const CBlockIndex*, int, CompareBlocksByHeight> BlockTimeMap;
-extern BlockTimeMap mGlobalForkTips;
+
+/**
+ * The tips of the known forks, ordered by height as a BlockTimeMap, with the time each was last added or
+ * updated. They are also indexed by that time, so that adding, updating or removing a tip is O(log n) and
+ * the most recent ones are read without sorting them all.
+ */
+class CGlobalForkTips
+{
+public:
+    // the tips are read only, their time is changed through Update
+    typedef BlockTimeMap::const_iterator const_iterator;
+    typedef const_iterator iterator;
+
+    const_iterator begin() const { return mapTips.begin(); }
+    const_iterator end() const { return mapTips.end(); }
+    size_t size() const { return mapTips.size(); }
+    size_t count(const CBlockIndex* pindex) const { return mapTips.count(pindex); }
+
+    //! The time of the tip, 0 if it is not one
+    int operator[](const CBlockIndex* pindex) const;
+
+    //! Adds the tip, false if it is already there, with its time unchanged
+    bool insert(const CBlockIndex* pindex, int nTime);
+    size_t erase(const CBlockIndex* pindex);
+    void clear();
+
+    //! Sets the time of the tip, which is added if it is not there
+    void Update(const CBlockIndex* pindex, int nTime);
+
+    //! Up to nMax tips, the most recent first
+    void GetMostRecent(size_t nMax, std::vector<const CBlockIndex*>& vTips) const;
+
+private:
+    BlockTimeMap mapTips;
+    std::set<std::pair<int, const CBlockIndex*> > setByTime;
+};
+extern CGlobalForkTips mGlobalForkTips;
 
 typedef std::set<const CBlockIndex*, CompareBlocksByHeight> BlockSet;
 extern BlockSet sGlobalForkTips;
@@ -297,6 +449,10 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto, bool fSendTrickle);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the block transactions and certificates checking thread */
+void ThreadBlockCheck();
+/** Run an instance of the thread reading in advance the inputs of the connected blocks */
+void ThreadCoinsPrefetch();
 /** Try to detect Partition (network isolation) attacks against us */
 void PartitionCheck(bool (*initialDownloadCheck)(), CCriticalSection& cs, const CBlockIndex *const &bestHeader, int64_t nPowTargetSpacing);
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
@@ -342,16 +498,30 @@ CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
  * Pruning will never delete a block within a defined distance (currently 288) from the active chain's tip.
  * The block index is updated by unsetting HAVE_DATA and HAVE_UNDO for any blocks that were stored in the deleted files.
  * A db flag records the fact that at least some block files have been pruned.
+ * Only the choice of the files is made here, the block index is updated by PruneBlockFiles: on the flush path, or
+ * by ThreadPruneBlockFiles after the flush when it runs, the files it has queued being skipped meanwhile.
  *
  * @param[out]   setFilesToPrune   The set of file indices that can be unlinked will be returned
  */
 void FindFilesToPrune(std::set<int>& setFilesToPrune);
 
+/** Unset HAVE_DATA and HAVE_UNDO for the blocks stored in the specified files and clear their infos, in one pass over the block index */
+void PruneBlockFiles(const std::set<int>& setFiles);
+
 /**
  *  Actually unlink the specified files
  */
 void UnlinkPrunedFiles(std::set<int>& setFilesToPrune);
 
+/** Hand the files to prune to ThreadPruneBlockFiles, once the block index and the chainstate are flushed */
+void QueueFilesToPrune(const std::set<int>& setFilesToPrune);
+
+/**
+ * Update the block index of the files queued to prune, write it and unlink the files, out of the flush of the
+ * chainstate. While it runs the pruning is left to it.
+ */
+void ThreadPruneBlockFiles();
+
 /** Create a new block index entry for a given block hash */
 CBlockIndex * InsertBlockIndex(uint256 hash);
 /** Get statistics from node state */
@@ -379,6 +549,7 @@ enum class MempoolProofVerificationFlag
 {
     DISABLED,   /**< The proof verification is not required. */
     SYNC,       /**< The proof verification is enabled and will be performed synchronously on the calling thread. */
+    SYNC_HIGH_PRIORITY, /**< As SYNC, pausing the low priority verifications running meanwhile (latency critical submissions). */
     ASYNC       /**< The proof verification is enabled and will be performed asynchronously on a separate thread. */
 };
 
@@ -396,24 +567,48 @@ void RejectMemoryPoolTxBase(const CValidationState& state, const CTransactionBas
 
 /** (try to) add transaction to memory pool **/
 MempoolReturnValue AcceptTxBaseToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransactionBase &txBase,
-    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom = nullptr);
+    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom = nullptr,
+    int64_t nAcceptTime = 0);
 
 MempoolReturnValue AcceptTxToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransaction &tx,
-    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom = nullptr);
+    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom = nullptr,
+    int64_t nAcceptTime = 0);
 
 MempoolReturnValue AcceptCertificateToMemoryPool(CTxMemPool& pool, CValidationState &state, const CScCertificate &cert,
-    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom = nullptr);
+    LimitFreeFlag fLimitFree, RejectAbsurdFeeFlag fRejectAbsurdFee, MempoolProofVerificationFlag fProofVerification, CNode* pfrom = nullptr,
+    int64_t nAcceptTime = 0);
+
+/**
+ * @brief Loads the transactions and certificates dumped by DumpMempool() into the memory pool, with their entry
+ * times and fee deltas. The proofs which were verified before the dump are restored into the proof cache.
+ *
+ * @return true if the mempool file was read
+ */
+bool LoadMempool();
+
+/**
+ * @brief Dumps the transactions and certificates of the memory pool to mempool.dat in the data directory,
+ * with their entry times, the fee deltas and the content of the proof verification cache.
+ *
+ * @return true if the mempool file was written
+ */
+bool DumpMempool();
 
 struct CNodeStateStats {
     int nMisbehavior;
     int nSyncHeight;
     int nCommonHeight;
     std::vector<int> vHeightInFlight;
+    double dBlockDownloadRate;
+    int64_t nBlockLatency;
+    int nMaxBlocksInFlight;
 };
 
 struct COrphanTx {
     std::shared_ptr<const CTransactionBase> tx;
     NodeId fromPeer;
+    int64_t nTimeExpire;
+    unsigned int nTxSize;
 };
 
 CAmount GetMinRelayFee(const CTransactionBase& tx, unsigned int nBytes, bool fAllowFree, unsigned int block_priority_size);
@@ -460,7 +655,7 @@ unsigned int GetP2SHSigOpCount(const CTransactionBase& tx, const CCoinsViewCache
  * instead of being performed inline.
  */
 bool InputScriptCheck(const CScript& scriptPubKey, const CTransactionBase& tx, unsigned int nIn,
-                      const CChain& chain, unsigned int flags, bool cache,  CValidationState &state, std::vector<CScriptCheck> *pvChecks);
+                      const std::shared_ptr<const CChain>& chain, unsigned int flags, bool cache,  CValidationState &state, std::vector<CScriptCheck> *pvChecks);
 /**
  * Check whether all inputs (either regular and CSW) of this transaction are valid (no double spends, scripts & sigs, amounts)
  * This does not modify the UTXO set. If pvChecks is not NULL, script checks are pushed onto it
@@ -522,15 +717,15 @@ private:
     CScript scriptPubKey;
     const CTransactionBase *ptxTo;
     unsigned int nIn;
-    const CChain *chain;
+    std::shared_ptr<const CChain> chain; //!< a CBlockHashSnapshot, for the replay protection checks without cs_main
     unsigned int nFlags;
     bool cacheStore;
     ScriptError error;
 
 public:
     CScriptCheck();
-    CScriptCheck(const CCoins& txFromIn, const CTransactionBase& txToIn, unsigned int nInIn, const CChain* chainIn, unsigned int nFlagsIn, bool cacheIn);
-    CScriptCheck(const CScript& scriptPubKeyIn, const CTransactionBase& txToIn, unsigned int nInIn, const CChain* chainIn, unsigned int nFlagsIn, bool cacheIn);
+    CScriptCheck(const CCoins& txFromIn, const CTransactionBase& txToIn, unsigned int nInIn, std::shared_ptr<const CChain> chainIn, unsigned int nFlagsIn, bool cacheIn);
+    CScriptCheck(const CScript& scriptPubKeyIn, const CTransactionBase& txToIn, unsigned int nInIn, std::shared_ptr<const CChain> chainIn, unsigned int nFlagsIn, bool cacheIn);
     bool operator()();
     void swap(CScriptCheck &check);
     ScriptError GetScriptError() const;
@@ -538,9 +733,15 @@ public:
 
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+/**
+ * The spent index entries of the spent outputs among the first nOutputs of txid, by output index, as GetSpentIndex
+ * for each of them: with one range scan of the block tree db rather than a read per output.
+ */
+bool GetSpentIndexOutputs(const uint256& txid, unsigned int nOutputs, std::map<unsigned int, CSpentIndexValue> &values);
 bool GetAddressIndex(uint160 addressHash, AddressType type,
                      std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> > &addressIndex,
                      int start = 0, int end = 0);
+bool GetAddressBalance(uint160 addressHash, AddressType type, CAddressBalanceValue& balance);
 bool GetAddressUnspent(uint160 addressHash, AddressType type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
 
@@ -549,6 +750,20 @@ bool GetAddressUnspent(uint160 addressHash, AddressType type,
 bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex);
+/**
+ * The serialized bytes of the block of pindex, as stored in its block file, to be relayed or returned
+ * as they are: only its header is deserialized, to check it is the block of pindex.
+ */
+bool ReadRawBlockFromDisk(CRawBlock& rawBlock, const CBlockIndex* pindex);
+//! The same, for the block of hash at pos, which can be looked up under cs_main and read without it
+bool ReadRawBlockFromDisk(CRawBlock& rawBlock, const CDiskBlockPos& pos, const uint256& hash);
+/**
+ * The serialized bytes of the block of pindex, as ReadRawBlockFromDisk, without reading them back when it is a
+ * recent block (see CRecentBlockCache): for the notifiers publishing the tips as they are connected. Not to be called holding cs_main.
+ */
+bool GetRawBlock(CRawBlock& rawBlock, const CBlockIndex* pindex);
+//! The undo data of the block of hashBlock at pos, checking their checksum
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock);
 CBlock LoadBlockFrom(CBufferedFile& blkdat, CDiskBlockPos* pLastLoadedBlkPos);
 
 /** Functions for validating blocks and updating the block tree */
@@ -564,9 +779,11 @@ enum class flagLevelDBIndexesWrite { ON, OFF };
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  In case pfClean is provided, operation will try to be tolerant about errors, and *pfClean
  *  will be true if no problems were found. Otherwise, the return value will be false in case
- *  of problems. Note that in any case, coins may be modified. */
+ *  of problems. Note that in any case, coins may be modified. The undo data of the block is
+ *  read from disk unless pBlockUndo is provided. */
 bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& coins, flagLevelDBIndexesWrite explorerIndexesWrite,
-                     bool* pfClean = NULL, std::vector<CScCertificateStatusUpdateInfo>* pCertsStateInfo = nullptr);
+                     bool* pfClean = NULL, std::vector<CScCertificateStatusUpdateInfo>* pCertsStateInfo = nullptr,
+                     CBlockUndo* pBlockUndo = nullptr);
 
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins */
 enum class flagCheckPow             { ON, OFF };
@@ -585,11 +802,54 @@ enum class flagBlockProcessingType
     CHECK_ONLY      /**< Perofrm only the validity check and do not apply any changes. */
 };
 
+/**
+ * The time, in microseconds, spent on each stage of connecting (or disconnecting) a block to the tip, with the
+ * content of the block, as measured for the "bench" log. ConnectBlock() fills the stages it runs, ConnectTip()
+ * the others; a disconnection only has the time to load the block and its undo data, and its total.
+ */
+struct CBlockConnectStats
+{
+    uint256 hash;
+    int nHeight = 0;
+    bool fDisconnect = false;
+    bool fFromReorgCache = false;     // a disconnection served by the in-memory cache of the last blocks connected
+
+    // ConnectBlock()
+    int64_t nTimePreProc = 0;         // up to the loop on the transactions, CheckBlock() included
+    int64_t nTimeConnect = 0;         // the loop on the transactions and the certificates
+    int64_t nTimeVerify = 0;          // up to the script checks joined
+    int64_t nTimeCommTree = 0;        // the sc txs commitment, overlapped with the script checks
+    int64_t nTimeBatchVerify = 0;     // the batch of sc proofs, overlapped with the script checks
+    int64_t nTimeIndex = 0;           // writing the undo data and the indexes
+    int64_t nTimeCallbacks = 0;
+    // ConnectTip()
+    int64_t nTimeReadFromDisk = 0;
+    int64_t nTimeConnectTotal = 0;    // ConnectBlock() as a whole
+    int64_t nTimeFlush = 0;
+    int64_t nTimeChainState = 0;
+    int64_t nTimeMempoolRemoval = 0;
+    int64_t nTimePostConnect = 0;
+    int64_t nTimeTotal = 0;
+
+    unsigned int nTx = 0;
+    unsigned int nCerts = 0;
+    unsigned int nInputs = 0;
+    unsigned int nCsws = 0;
+    unsigned int nSidechains = 0;     // the sidechains the transactions and the certificates refer to
+};
+
+/** Whether the block is the -assumevalidsc block or one of its ancestors, its sidechain proofs not verified then */
+bool IsScProofAssumedValid(const CBlockIndex* pindex);
+
 bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
     CCoinsViewCache& coins, const CChain& chain, flagBlockProcessingType processingType,
     flagScRelatedChecks fScRelatedChecks, flagScProofVerification fScProofVerification,
     flagLevelDBIndexesWrite explorerIndexesWrite,
-    std::vector<CScCertificateStatusUpdateInfo>* pCertsStateInfo = nullptr);
+    std::vector<CScCertificateStatusUpdateInfo>* pCertsStateInfo = nullptr,
+    CBlockConnectStats* pStats = nullptr, CBlockUndo* pBlockUndo = nullptr);
+
+/** The profiles of the last blocks connected to or disconnected from the tip, the oldest first */
+void GetBlockConnectStats(std::vector<CBlockConnectStats>& vStats);
 
 /** Find the position in block files (blk??????.dat) in which a block must be written. */
 bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, unsigned int nAddSize, unsigned int nHeight, uint64_t nTime, bool fKnown = false);
@@ -617,7 +877,8 @@ bool TestBlockValidity(CValidationState &state, const CBlock& block, CBlockIndex
  * If dbp is non-NULL, the file is known to already reside on disk
  */
 bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex **pindex, bool fRequested, CDiskBlockPos* dbp, BlockSet* sForkTips = NULL);
-bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex **ppindex= NULL, bool lookForwardTips = false);
+bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, CBlockIndex **ppindex= NULL, bool lookForwardTips = false,
+                       flagCheckPow fCheckPOW = flagCheckPow::ON);
 
 
 class CBlockFileInfo
@@ -679,9 +940,43 @@ class CVerifyDB {
 public:
     CVerifyDB();
     ~CVerifyDB();
-    bool VerifyDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth);
+
+    /**
+     * Verify the last nCheckDepth blocks of the active chain. Levels 0 to 2 (reading the blocks, CheckBlock and
+     * reading the undo data) are checked on parallel threads, then levels 3 and 4 (disconnecting and reconnecting
+     * the blocks on a memory-only view of coinsview) on the calling one, in order.
+     *
+     * @param nTimeBudget       seconds after which no further block is verified, 0 for no limit
+     * @param fDeferCoinsChecks leave levels 3 and 4 to ThreadVerifyCoinsDB, to be started once the node is up
+     */
+    bool VerifyDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth, int64_t nTimeBudget = 0, bool fDeferCoinsChecks = false);
+
+    //! The blocks VerifyDB verified at levels 0 to 2, fewer than asked if the time budget ran out
+    int GetCheckedDepth() const { return nCheckedDepth; }
+
+private:
+    int nCheckedDepth = 0;
 };
 
+/**
+ * Levels 3 and 4 of VerifyDB for the last nCheckDepth blocks, in the background: cs_main is taken for a block at a time,
+ * and the verification stops, leaving the result unknown, if the best block of coinsview moves meanwhile. The node is
+ * aborted on an inconsistency.
+ */
+void ThreadVerifyCoinsDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth);
+
+/** Progress of the verification of the blocks at startup, for getblockchaininfo. Guarded by cs_main */
+struct CVerifyDBProgress
+{
+    std::string strState = "none"; //!< "running", "background", "done", "stopped" or "failed"
+    int nCheckLevel = 0;
+    int nCheckDepth = 0;           //!< the blocks to verify
+    int nBlocksChecked = 0;        //!< the blocks verified at levels 0 to 2
+    int nBlocksDisconnected = 0;   //!< the blocks verified at level 3
+    int nBlocksReconnected = 0;    //!< the blocks verified at level 4
+};
+extern CVerifyDBProgress verifyDBProgress;
+
 /** Find the last common block between the parameter chain and a locator. */
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator);
 
@@ -697,9 +992,19 @@ extern CChain chainActive;
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
+/** Global variable that points to the coins database below pcoinsTip (protected by cs_main) */
+extern CCoinsViewDB *pcoinsdbview;
+
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
+/**
+ * Replace the chainstate of a node without blocks with a snapshot written by dumptxoutset, whose
+ * header has already been read from file, and move the tip to the snapshot block. The header of that
+ * block must be known. The blocks up to it are neither downloaded nor validated.
+ */
+bool LoadTxOutSetSnapshot(CAutoFile& file, const CTxOutSetSnapshotHeader& header, std::string& strError);
+
 /**
  * Check if the output nIn is CF Reward
  */
@@ -8,6 +8,7 @@
 #include <stdlib.h>
 
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 
@@ -94,6 +95,19 @@ static inline size_t DynamicUsage(const std::map<X, Y>& m)
     return MallocUsage(sizeof(stl_tree_node<std::pair<const X, Y> >)) * m.size();
 }
 
+/** The reference counts of a std::shared_ptr, allocated together with the object by std::make_shared */
+struct stl_shared_counter
+{
+    size_t use_count;
+    size_t weak_count;
+};
+
+template<typename X>
+static inline size_t DynamicUsage(const std::shared_ptr<X>& p)
+{
+    return p ? MallocUsage(sizeof(X) + sizeof(stl_shared_counter)) : 0;
+}
+
 // Boost data structures
 
 template<typename X>
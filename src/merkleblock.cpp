@@ -99,7 +99,8 @@ uint256 CPartialMerkleTree::CalcHash(int height, unsigned int pos, const std::ve
     }
 }
 
-void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256> &vTxid, const std::vector<bool> &vMatch) {
+template <typename NodeHash>
+void CPartialMerkleTree::TraverseAndBuildWith(int height, unsigned int pos, const std::vector<bool> &vMatch, const NodeHash& nodeHash) {
     // determine whether this node is the parent of at least one matched txid
     bool fParentOfMatch = false;
     for (unsigned int p = pos << height; p < (pos+1) << height && p < nTransactions; p++)
@@ -108,15 +109,19 @@ void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const st
     vBits.push_back(fParentOfMatch);
     if (height==0 || !fParentOfMatch) {
         // if at height 0, or nothing interesting below, store hash and stop
-        vHash.push_back(CalcHash(height, pos, vTxid));
+        vHash.push_back(nodeHash(height, pos));
     } else {
         // otherwise, don't store any hash, but descend into the subtrees
-        TraverseAndBuild(height-1, pos*2, vTxid, vMatch);
+        TraverseAndBuildWith(height-1, pos*2, vMatch, nodeHash);
         if (pos*2+1 < CalcTreeWidth(height-1))
-            TraverseAndBuild(height-1, pos*2+1, vTxid, vMatch);
+            TraverseAndBuildWith(height-1, pos*2+1, vMatch, nodeHash);
     }
 }
 
+void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256> &vTxid, const std::vector<bool> &vMatch) {
+    TraverseAndBuildWith(height, pos, vMatch, [this, &vTxid](int h, unsigned int p) { return CalcHash(h, p, vTxid); });
+}
+
 uint256 CPartialMerkleTree::TraverseAndExtract(int height, unsigned int pos, unsigned int &nBitsUsed, unsigned int &nHashUsed, std::vector<uint256> &vMatch) {
     if (nBitsUsed >= vBits.size()) {
         // overflowed the bits array - failure
@@ -167,6 +172,17 @@ CPartialMerkleTree::CPartialMerkleTree(const std::vector<uint256> &vTxid, const
     TraverseAndBuild(nHeight, 0, vTxid, vMatch);
 }
 
+CPartialMerkleTree::CPartialMerkleTree(const std::vector<uint256> &vMerkleTree, unsigned int nTx, const std::vector<bool> &vMatch) : nTransactions(nTx), fBad(false) {
+    // the offset in vMerkleTree of the first node of every level, and the height of the tree
+    std::vector<unsigned int> vLevelOffset(1, 0);
+    while (CalcTreeWidth(vLevelOffset.size() - 1) > 1)
+        vLevelOffset.push_back(vLevelOffset.back() + CalcTreeWidth(vLevelOffset.size() - 1));
+    assert(vMerkleTree.size() == vLevelOffset.back() + 1);
+
+    TraverseAndBuildWith(vLevelOffset.size() - 1, 0, vMatch,
+                         [&vMerkleTree, &vLevelOffset](int height, unsigned int pos) { return vMerkleTree[vLevelOffset[height] + pos]; });
+}
+
 CPartialMerkleTree::CPartialMerkleTree() : nTransactions(0), fBad(true) {}
 
 uint256 CPartialMerkleTree::ExtractMatches(std::vector<uint256> &vMatch) {
@@ -201,3 +217,67 @@ uint256 CPartialMerkleTree::ExtractMatches(std::vector<uint256> &vMatch) {
         return uint256();
     return hashMerkleRoot;
 }
+
+CBlockMerkleTree::CBlockMerkleTree(const CBlock& block) : header(block.GetBlockHeader())
+{
+    block.BuildMerkleTree();
+    vMerkleTree = block.vMerkleTree;
+    nTransactions = block.vtx.size() + block.vcert.size();
+
+    mapIndex.reserve(nTransactions);
+    for (unsigned int i = 0; i < nTransactions; i++)
+        mapIndex.emplace(vMerkleTree[i], i);
+}
+
+int CBlockMerkleTree::Find(const uint256& hash) const
+{
+    std::unordered_map<uint256, unsigned int, ObjectHasher>::const_iterator it = mapIndex.find(hash);
+    return it == mapIndex.end() ? -1 : (int)it->second;
+}
+
+CMerkleBlock CBlockMerkleTree::GetMerkleBlock(const std::vector<bool>& vMatch) const
+{
+    assert(vMatch.size() == nTransactions);
+    CMerkleBlock merkleBlock;
+    merkleBlock.header = header;
+    merkleBlock.txn = CPartialMerkleTree(vMerkleTree, nTransactions, vMatch);
+    return merkleBlock;
+}
+
+std::shared_ptr<const CBlockMerkleTree> CBlockMerkleTreeCache::Get(const uint256& hashBlock)
+{
+    LOCK(cs);
+    auto it = mapTrees.find(hashBlock);
+    if (it == mapTrees.end())
+        return nullptr;
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->second;
+}
+
+std::shared_ptr<const CBlockMerkleTree> CBlockMerkleTreeCache::Insert(const CBlock& block)
+{
+    // hashed out of the lock, a block can have thousands of transactions
+    std::shared_ptr<const CBlockMerkleTree> tree = std::make_shared<const CBlockMerkleTree>(block);
+    const uint256 hash = block.GetHash();
+
+    LOCK(cs);
+    auto it = mapTrees.find(hash);
+    if (it != mapTrees.end()) {
+        // built meanwhile by another caller
+        lru.splice(lru.begin(), lru, it->second);
+        return it->second->second;
+    }
+    lru.push_front(Entry(hash, tree));
+    mapTrees[hash] = lru.begin();
+    while (lru.size() > nMaxBlocks && lru.size() > 1) {
+        mapTrees.erase(lru.back().first);
+        lru.pop_back();
+    }
+    return tree;
+}
+
+size_t CBlockMerkleTreeCache::Size() const
+{
+    LOCK(cs);
+    return lru.size();
+}
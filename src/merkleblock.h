@@ -10,7 +10,12 @@
 #include "uint256.h"
 #include "primitives/block.h"
 #include "bloom.h"
+#include "hash.h"
+#include "sync.h"
 
+#include <list>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 /** Data structure that represents a partial merkle tree.
@@ -73,6 +78,10 @@ protected:
     /** recursive function that traverses tree nodes, storing the data as bits and hashes */
     void TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256> &vTxid, const std::vector<bool> &vMatch);
 
+    /** the same, the hash of a node being nodeHash(height, pos) */
+    template <typename NodeHash>
+    void TraverseAndBuildWith(int height, unsigned int pos, const std::vector<bool> &vMatch, const NodeHash& nodeHash);
+
     /**
      * recursive function that traverses tree nodes, consuming the bits and hashes produced by TraverseAndBuild.
      * it returns the hash of the respective node.
@@ -107,6 +116,12 @@ public:
     /** Construct a partial merkle tree from a list of transaction ids, and a mask that selects a subset of them */
     CPartialMerkleTree(const std::vector<uint256> &vTxid, const std::vector<bool> &vMatch);
 
+    /**
+     * The same, from the whole merkle tree of a block of nTx transactions as CBlock::BuildMerkleTree lays it out,
+     * level by level from the txids up: its nodes are looked up rather than hashed again.
+     */
+    CPartialMerkleTree(const std::vector<uint256> &vMerkleTree, unsigned int nTx, const std::vector<bool> &vMatch);
+
     CPartialMerkleTree();
 
     /**
@@ -153,4 +168,51 @@ public:
     }
 };
 
+/** The merkle tree of a block, with its header, to build the proofs of its transactions and certificates */
+class CBlockMerkleTree
+{
+public:
+    explicit CBlockMerkleTree(const CBlock& block);
+
+    const CBlockHeader& GetHeader() const { return header; }
+    //! The index of a transaction or certificate in the block, -1 if it is not in it
+    int Find(const uint256& hash) const;
+    size_t GetTxCount() const { return nTransactions; }
+    //! The proof of the transactions and certificates matched, by index in the block
+    CMerkleBlock GetMerkleBlock(const std::vector<bool>& vMatch) const;
+
+private:
+    CBlockHeader header;
+    unsigned int nTransactions;
+    std::vector<uint256> vMerkleTree;
+    std::unordered_map<uint256, unsigned int, ObjectHasher> mapIndex;
+};
+
+/**
+ * The merkle trees of the blocks whose transactions were recently proven (gettxoutproofs): the proofs of many
+ * transactions of the same block do not read it from disk and hash it again each. Blocks do not change for a
+ * hash, so an entry is never stale; the least recently used blocks are evicted first.
+ */
+class CBlockMerkleTreeCache
+{
+public:
+    explicit CBlockMerkleTreeCache(size_t nMaxBlocksIn) : nMaxBlocks(nMaxBlocksIn) {}
+
+    //! The tree of the block, null if not cached
+    std::shared_ptr<const CBlockMerkleTree> Get(const uint256& hashBlock);
+    //! Build and cache the tree of block
+    std::shared_ptr<const CBlockMerkleTree> Insert(const CBlock& block);
+
+    size_t Size() const;
+
+private:
+    typedef std::pair<uint256, std::shared_ptr<const CBlockMerkleTree> > Entry;
+
+    mutable CCriticalSection cs;
+    size_t nMaxBlocks;
+    //! the most recently used first
+    std::list<Entry> lru;
+    std::unordered_map<uint256, std::list<Entry>::iterator, ObjectHasher> mapTrees;
+};
+
 #endif // BITCOIN_MERKLEBLOCK_H
@@ -72,6 +72,27 @@ double AtomicTimer::rate(const AtomicCounter& count)
     return duration > 0 ? (double)count.get() / duration : 0;
 }
 
+// constant initialized, before any MetricValue links itself
+static const MetricValue* pFirstMetric = nullptr;
+
+MetricValue::MetricValue(const char* nameIn, const char* helpIn, Type typeIn) :
+    name(nameIn), help(helpIn), type(typeIn), next(pFirstMetric), value(0)
+{
+    pFirstMetric = this;
+}
+
+void AppendMetric(std::string& out, std::string& strFamily, const std::string& name, const std::string& help,
+                  MetricValue::Type type, double value)
+{
+    std::string family = name.substr(0, name.find('{'));
+    if (family != strFamily) {
+        strFamily = family;
+        out += strprintf("# HELP %s %s\n", family, help);
+        out += strprintf("# TYPE %s %s\n", family, type == MetricValue::Type::COUNTER ? "counter" : "gauge");
+    }
+    out += strprintf("%s %.17g\n", name, value);
+}
+
 CCriticalSection cs_metrics;
 
 boost::synchronized_value<int64_t> nNodeStartTime;
@@ -113,6 +134,22 @@ double GetLocalSolPS()
     return miningTimer.rate(solutionTargetChecks);
 }
 
+void AppendRegisteredMetrics(std::string& out)
+{
+    std::string strFamily;
+    AppendMetric(out, strFamily, "zen_uptime_seconds", "Seconds since the node started", MetricValue::Type::GAUGE, GetUptime());
+    AppendMetric(out, strFamily, "zen_transactions_validated_total", "Transactions and certificates validated",
+                 MetricValue::Type::COUNTER, transactionsValidated.get());
+    AppendMetric(out, strFamily, "zen_ehsolver_runs_total", "Equihash solver runs of the local miner", MetricValue::Type::COUNTER, ehSolverRuns.get());
+    AppendMetric(out, strFamily, "zen_solution_target_checks_total", "Equihash solutions checked against the target by the local miner",
+                 MetricValue::Type::COUNTER, solutionTargetChecks.get());
+    AppendMetric(out, strFamily, "zen_mined_blocks_total", "Blocks mined locally", MetricValue::Type::COUNTER, minedBlocks.get());
+    AppendMetric(out, strFamily, "zen_local_solps", "Equihash solutions per second of the local miner", MetricValue::Type::GAUGE, GetLocalSolPS());
+
+    for (const MetricValue* metric = pFirstMetric; metric != nullptr; metric = metric->next)
+        AppendMetric(out, strFamily, metric->name, metric->help, metric->type, metric->Get());
+}
+
 int EstimateNetHeightInner(int height, int64_t tipmediantime,
                            int heightLastCheckpoint, int64_t timeLastCheckpoint,
                            int64_t genesisTime, int64_t targetSpacing)
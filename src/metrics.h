@@ -54,6 +54,37 @@ public:
     double rate(const AtomicCounter& count);
 };
 
+/**
+ * A counter or a gauge exported by the /metrics endpoint (-httpmetrics), in the Prometheus text format.
+ * They are defined at namespace scope, where the constructor links them into the registry, which is only
+ * read afterwards; the updates are relaxed atomic operations, cheap enough for the hot paths.
+ * The name may carry labels, like "zen_name{label=\"value\"}": the metrics of a family go next to each other.
+ */
+class MetricValue {
+public:
+    enum class Type { COUNTER, GAUGE };
+
+    MetricValue(const char* nameIn, const char* helpIn, Type typeIn = Type::COUNTER);
+
+    void Add(int64_t n = 1) { value.fetch_add(n, std::memory_order_relaxed); }
+    void Set(int64_t n) { value.store(n, std::memory_order_relaxed); }
+    int64_t Get() const { return value.load(std::memory_order_relaxed); }
+
+    const char* const name;
+    const char* const help;
+    const Type type;
+    const MetricValue* const next;
+
+private:
+    std::atomic<int64_t> value;
+};
+
+/** Append a metric in the Prometheus text format, with its HELP and TYPE lines unless strFamily already has them */
+void AppendMetric(std::string& out, std::string& strFamily, const std::string& name, const std::string& help,
+                  MetricValue::Type type, double value);
+/** Append the metrics of the registry and the counters of the metrics screen */
+void AppendRegisteredMetrics(std::string& out);
+
 extern AtomicCounter transactionsValidated;
 extern AtomicCounter ehSolverRuns;
 extern AtomicCounter solutionTargetChecks;
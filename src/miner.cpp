@@ -43,6 +43,7 @@
 #include <functional>
 #endif
 #include <mutex>
+#include <numeric>
 
 using namespace std;
 
@@ -266,6 +267,11 @@ bool AddToPriorities(const CTransactionBase& txBase, const CCoinsViewCache& view
 
         CFeeRate feeRate(nFee, nTxSize);
 
+        // its descendants, which are only taken after it, pay for it too (child pays for parent)
+        CFeeRate packageFeeRate = mempool.GetDescendantFeeRate(hash);
+        if (packageFeeRate > feeRate)
+            feeRate = packageFeeRate;
+
         LogPrint("sc", "%s():%d - adding to prio vec txObj = %s, prio=%f, feeRate=%s\n",
             __func__, __LINE__, hash.ToString(), dPriority, feeRate.ToString());
  
@@ -319,10 +325,14 @@ bool AddToPriorities(const CTransactionBase& txBase, const CCoinsViewCache& view
 }
 
 void GetBlockCertPriorityData(const CCoinsViewCache& view, int nHeight,
-                               vector<TxPriority>& vecPriority, list<COrphan>& vOrphan, map<uint256, vector<COrphan*> >& mapDependers)
+                               vector<TxPriority>& vecPriority, list<COrphan>& vOrphan, map<uint256, vector<COrphan*> >& mapDependers,
+                               const std::set<uint256>* pExcluded)
 {
     for (auto mi = mempool.mapCertificate.begin(); mi != mempool.mapCertificate.end(); ++mi)
     {
+        if (pExcluded && pExcluded->count(mi->first))
+            continue;
+
         const CScCertificate& cert = mi->second.GetCertificate();
 
         CAmount nTotalIn = 0;
@@ -353,10 +363,14 @@ void GetBlockCertPriorityData(const CCoinsViewCache& view, int nHeight,
 }
 
 void GetBlockTxPriorityData(const CCoinsViewCache& view, int nHeight, int64_t nLockTimeCutoff,
-                               vector<TxPriority>& vecPriority, list<COrphan>& vOrphan, map<uint256, vector<COrphan*> >& mapDependers)
+                               vector<TxPriority>& vecPriority, list<COrphan>& vOrphan, map<uint256, vector<COrphan*> >& mapDependers,
+                               const std::set<uint256>* pExcluded)
 {
     for (map<uint256, CTxMemPoolEntry>::iterator mi = mempool.mapTx.begin(); mi != mempool.mapTx.end(); ++mi)
     {
+        if (pExcluded && pExcluded->count(mi->first))
+            continue;
+
         const CTransaction& tx = mi->second.GetTx();
 
         if (tx.IsCoinBase() || !IsFinalTx(tx, nHeight, nLockTimeCutoff))
@@ -478,6 +492,180 @@ void GetBlockTxPriorityDataOld(const CCoinsViewCache& view, int nHeight, int64_t
     }
 }
 
+/**
+ * The txes and certificates of the last block template, in the order they were added, with what is
+ * needed to build the next template on the same tip from them (guarded by cs_main).
+ *
+ * If no limit of the block was reached, a new selection would include all of them again: they are
+ * replayed without checking their inputs again and only the other mempool entries go through the
+ * selection, to be appended after them. This holds as long as the tip, the block limits and the fee
+ * deltas are the same and all of them are still in the mempool. Certificates must be in quality order,
+ * hence a certificate not in the last template always requires a full selection.
+ */
+struct CLastBlockTemplate
+{
+    struct Entry
+    {
+        uint256 hash;
+        bool fCertificate;
+        CAmount nFee;
+        int64_t nSigOps;
+        unsigned int nSize;
+        int nComplexity;
+    };
+
+    struct Params
+    {
+        uint256 hashPrevBlock;
+        int nHeight;
+        int nVersion;
+        unsigned int nBlockMaxSize;
+        unsigned int nBlockMinSize;
+        unsigned int nBlockPrioritySize;
+        unsigned int nBlockTxPartitionMaxSize;
+        unsigned int nBlockMaxComplexitySize;
+        int64_t nLockTimeCutoff;
+        unsigned int nPrioritisationsUpdated;
+
+        bool SameBlockAs(const Params& other) const
+        {
+            // a later cutoff only makes more txes final
+            return hashPrevBlock == other.hashPrevBlock && nHeight == other.nHeight && nVersion == other.nVersion &&
+                   nBlockMaxSize == other.nBlockMaxSize && nBlockMinSize == other.nBlockMinSize &&
+                   nBlockPrioritySize == other.nBlockPrioritySize && nBlockTxPartitionMaxSize == other.nBlockTxPartitionMaxSize &&
+                   nBlockMaxComplexitySize == other.nBlockMaxComplexitySize && nLockTimeCutoff >= other.nLockTimeCutoff &&
+                   nPrioritisationsUpdated == other.nPrioritisationsUpdated;
+        }
+    };
+
+    bool fValid = false;
+    Params params;
+    std::vector<Entry> vEntries;
+    bool fSortedByFee = false;
+    bool fLimitReached = false;
+
+    bool IsReusableFor(const Params& newParams, std::set<uint256>& setEntries) const
+    {
+        if (!fValid || fLimitReached || !newParams.SameBlockAs(params))
+            return false;
+
+        for (const Entry& entry: vEntries)
+        {
+            if (entry.fCertificate ? !mempool.existsCert(entry.hash) : !mempool.existsTx(entry.hash))
+                return false;
+            setEntries.insert(entry.hash);
+        }
+        for (const auto& item: mempool.mapCertificate)
+        {
+            if (!setEntries.count(item.first))
+                return false;
+        }
+        return true;
+    }
+};
+
+static CLastBlockTemplate lastBlockTemplate;
+
+/**
+ * The last template made by a full selection, with the tip, block parameters and mempool content it was made from
+ * (guarded by cs_main). While they are the same, the templates for any payout script are copies of it with only
+ * a coinbase of their own: its txes, certificates and sc txs commitment do not depend on the coinbase.
+ */
+struct CBlockTemplateBody
+{
+    CLastBlockTemplate::Params params;
+    unsigned int nTransactionsUpdated = 0;
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+
+    bool IsReusableFor(const CLastBlockTemplate::Params& newParams, unsigned int nTransactionsUpdatedIn) const
+    {
+        return pblocktemplate && nTransactionsUpdated == nTransactionsUpdatedIn && newParams.SameBlockAs(params) &&
+               newParams.nLockTimeCutoff == params.nLockTimeCutoff;
+    }
+};
+
+static CBlockTemplateBody blockTemplateBody;
+
+/**
+ * Fill vPackage with the mempool txes and certificates txBase depends on which are not in setInBlock, each
+ * one after its own dependencies, followed by txBase itself. Returns the fee rate of all of them together,
+ * based on the modified fees.
+ */
+static CFeeRate GetAncestorPackage(const CTransactionBase& txBase, const std::set<uint256>& setInBlock,
+                                   std::vector<const CTransactionBase*>& vPackage)
+{
+    AssertLockHeld(mempool.cs);
+    std::vector<std::pair<uint64_t, const CTransactionBase*> > vAncestors;
+    CAmount nPackageFees = 0;
+    size_t nPackageSize = 0;
+
+    for (const uint256& ancestor: mempool.mempoolDependenciesFrom(txBase))
+    {
+        if (setInBlock.count(ancestor))
+            continue;
+
+        indexed_mempool_set::const_iterator it = mempool.mapIndex.find(ancestor);
+        assert(it != mempool.mapIndex.end());
+        nPackageFees += it->nModifiedFee;
+        nPackageSize += it->nSize;
+
+        const CTransactionBase* pAncestor = it->fCertificate ?
+            static_cast<const CTransactionBase*>(&mempool.mapCertificate.at(ancestor).GetCertificate()) :
+            static_cast<const CTransactionBase*>(&mempool.mapTx.at(ancestor).GetTx());
+        vAncestors.push_back(std::make_pair(it->nCountWithAncestors, pAncestor));
+    }
+
+    // An entry has more ancestors in the mempool than any of its own ancestors
+    std::stable_sort(vAncestors.begin(), vAncestors.end(),
+        [](const std::pair<uint64_t, const CTransactionBase*>& a, const std::pair<uint64_t, const CTransactionBase*>& b) {
+            return a.first < b.first;
+        });
+
+    vPackage.clear();
+    vPackage.reserve(vAncestors.size() + 1);
+    for (const auto& ancestor: vAncestors)
+        vPackage.push_back(ancestor.second);
+    vPackage.push_back(&txBase);
+
+    indexed_mempool_set::const_iterator it = mempool.mapIndex.find(txBase.GetHash());
+    assert(it != mempool.mapIndex.end());
+    nPackageFees += it->nModifiedFee;
+    nPackageSize += it->nSize;
+
+    return CFeeRate(nPackageFees, nPackageSize);
+}
+
+/** Queue the txes and certificates depending on the one just added to the block, once they depend on no other one */
+static void ReleaseDependers(const uint256& hash, map<uint256, vector<COrphan*> >& mapDependers,
+                             vector<TxPriority>& vecPriority, const TxPriorityCompare& comparer)
+{
+    if (!mapDependers.count(hash))
+        return;
+
+    LogPrint("sc", "%s():%d - tx[%s] has %d orphans\n",
+        __func__, __LINE__, hash.ToString(), mapDependers[hash].size());
+    for(COrphan* porphan: mapDependers[hash])
+    {
+        if (!porphan->setDependsOn.empty())
+        {
+            porphan->setDependsOn.erase(hash);
+            LogPrint("sc", "%s():%d - erasing tx[%s] from orphan %p\n", __func__, __LINE__, hash.ToString(), porphan);
+            if (porphan->setDependsOn.empty())
+            {
+                LogPrint("sc", "%s():%d - tx[%s] resolved all dependencies, adding to prio vec, prio=%f, feeRate=%s\n",
+                    __func__, __LINE__, porphan->ptx->GetHash().ToString(), porphan->dPriority, porphan->feeRate.ToString());
+
+                vecPriority.push_back(TxPriority(porphan->dPriority, porphan->feeRate, porphan->ptx));
+                std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
+            }
+        }
+        else
+        {
+            LogPrint("sc", "%s():%d - tx[%s] orphan %p empty\n", __func__, __LINE__, hash.ToString(), porphan);
+        }
+    }
+}
+
 CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn)
 {
     // Block complexity is a sum of block transactions complexity. Transaction complexisty equals to number of inputs squared.
@@ -486,6 +674,64 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn)
     return  CreateNewBlock(scriptPubKeyIn,  nBlockMaxComplexitySize);
 }
 
+static void RandomiseNonce(CBlock* pblock)
+{
+    arith_uint256 nonce = UintToArith256(GetRandHash());
+    // Clear the top and bottom 16 bits (for local use as thread flags and counters)
+    nonce <<= 32;
+    nonce >>= 16;
+    pblock->nNonce = ArithToUint256(nonce);
+}
+
+/** The size and sigops of the block of blocktemplate but its coinbase, and the most it can have */
+static void GetTemplateBodyLimits(const CBlockTemplate& blocktemplate, size_t& nBodySize, int64_t& nBodySigOps,
+                                  size_t& nMaxSize)
+{
+    const CBlock& block = blocktemplate.block;
+    nBodySize = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION) -
+                ::GetSerializeSize(block.vtx[0], SER_NETWORK, PROTOCOL_VERSION);
+    nBodySigOps = std::accumulate(blocktemplate.vTxSigOps.begin() + 1, blocktemplate.vTxSigOps.end(), int64_t(0)) +
+                  std::accumulate(blocktemplate.vCertSigOps.begin(), blocktemplate.vCertSigOps.end(), int64_t(0));
+    nMaxSize = block.nVersion == BLOCK_VERSION_SC_SUPPORT ? MAX_BLOCK_SIZE : MAX_BLOCK_SIZE_BEFORE_SC;
+}
+
+/**
+ * The coinbase of blocktemplate paying scriptPubKeyIn, with the same fees and community fund outputs as its own;
+ * false if the block would not fit the size and sigops limits with it
+ */
+static bool MakeTemplateCoinbase(const CBlockTemplate& blocktemplate, const CScript& scriptPubKeyIn, int nHeight,
+                                 size_t nBodySize, int64_t nBodySigOps, size_t nMaxSize,
+                                 CTransaction& txCoinbase, int64_t& nSigOps)
+{
+    txCoinbase = createCoinbase(scriptPubKeyIn, -blocktemplate.vTxFees[0], nHeight);
+    nSigOps = GetLegacySigOpCount(txCoinbase);
+    return nBodySize + ::GetSerializeSize(txCoinbase, SER_NETWORK, PROTOCOL_VERSION) < nMaxSize &&
+           nBodySigOps + nSigOps < MAX_BLOCK_SIGOPS;
+}
+
+bool GetCoinbaseVariants(const CBlockTemplate& blocktemplate, int nHeight, const std::vector<CScript>& vScriptPubKeys,
+                         std::vector<CCoinbaseVariant>& vVariants)
+{
+    size_t nBodySize, nMaxSize;
+    int64_t nBodySigOps;
+    GetTemplateBodyLimits(blocktemplate, nBodySize, nBodySigOps, nMaxSize);
+
+    // the branch of the coinbase does not depend on it
+    const std::vector<uint256> vMerkleBranch = blocktemplate.block.GetMerkleBranch(0);
+    vVariants.clear();
+    vVariants.reserve(vScriptPubKeys.size());
+    for (const CScript& scriptPubKey: vScriptPubKeys)
+    {
+        CCoinbaseVariant variant;
+        if (!MakeTemplateCoinbase(blocktemplate, scriptPubKey, nHeight, nBodySize, nBodySigOps, nMaxSize,
+                                  variant.txCoinbase, variant.nSigOps))
+            return false;
+        variant.hashMerkleRoot = CBlock::CheckMerkleBranch(variant.txCoinbase.GetHash(), vMerkleBranch, 0);
+        vVariants.push_back(variant);
+    }
+    return true;
+}
+
 CMutableTransaction createCoinbase(const CScript &scriptPubKeyIn, CAmount fees, const int nHeight)
 {
     const CChainParams& chainparams = Params();
@@ -545,7 +791,9 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
     // All the limits are defined in CommitmentBuilderGuard, and aligned with those defined in CCTPlib.
     // Doing the add on the txsCommitmentGuard is reversible and prevents throwing away and rebuild
     // the commitment tree in case of failure.
-    std::unique_ptr<SidechainTxsCommitmentBuilder> scCommBuilder(new SidechainTxsCommitmentBuilder);
+    // The builder is kept alive across calls (guarded by cs_main), so that on template refresh
+    // the txs and certs already added to the tree of the previous template are not hashed again.
+    static IncrementalSidechainTxsCommitmentBuilder scCommBuilder;
     SidechainTxsCommitmentGuard scCommGuard;
 
     // Add dummy coinbase tx as first transaction
@@ -561,6 +809,7 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
         LOCK2(cs_main, mempool.cs);
         CBlockIndex* pindexPrev = chainActive.Tip();
         const int nHeight = pindexPrev->nHeight + 1;
+        scCommBuilder.start(pindexPrev->GetBlockHash());
         pblock->nTime = GetTime();
         const int64_t nMedianTimePast = pindexPrev->GetMedianTimePast();
 
@@ -623,12 +872,6 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
                 : pblock->GetBlockTime();
 
         bool fDeprecatedGetBlockTemplate = GetBoolArg("-deprecatedgetblocktemplate", false);
-        if (fDeprecatedGetBlockTemplate)
-            GetBlockTxPriorityDataOld(view, nHeight, nLockTimeCutoff, vecPriority, vOrphan, mapDependers);
-        else
-            GetBlockTxPriorityData(view, nHeight, nLockTimeCutoff, vecPriority, vOrphan, mapDependers);
-
-        GetBlockCertPriorityData(view, nHeight, vecPriority, vOrphan, mapDependers);
 
         // Collect transactions into block
         uint64_t nBlockSize = 1000;
@@ -638,6 +881,104 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
         uint64_t nBlockCert = 0;
         int nBlockSigOps = 100;
         bool fSortedByFee = (nBlockPrioritySize <= 0);
+        bool fLimitReached = false;
+
+        CLastBlockTemplate::Params templateParams{pindexPrev->GetBlockHash(), nHeight, pblock->nVersion,
+            nBlockMaxSize, nBlockMinSize, nBlockPrioritySize, nBlockTxPartitionMaxSize, nBlockMaxComplexitySize,
+            nLockTimeCutoff, mempool.GetPrioritisationsUpdated()};
+        std::vector<CLastBlockTemplate::Entry> vTemplateEntries;
+        const unsigned int nTransactionsUpdated = mempool.GetTransactionsUpdated();
+
+        // Only the coinbase is new while the mempool is the same as for the last template
+        if (blockTemplateBody.IsReusableFor(templateParams, nTransactionsUpdated))
+        {
+            size_t nBodySize, nMaxSize;
+            int64_t nBodySigOps;
+            GetTemplateBodyLimits(*blockTemplateBody.pblocktemplate, nBodySize, nBodySigOps, nMaxSize);
+            CTransaction txCoinbase;
+            int64_t nCoinbaseSigOps;
+            if (MakeTemplateCoinbase(*blockTemplateBody.pblocktemplate, scriptPubKeyIn, nHeight, nBodySize, nBodySigOps,
+                                     nMaxSize, txCoinbase, nCoinbaseSigOps))
+            {
+                LogPrint("miner", "%s():%d - reusing the txes and certificates of the last template\n", __func__, __LINE__);
+                *pblocktemplate = *blockTemplateBody.pblocktemplate;
+                pblock->vtx[0] = txCoinbase;
+                pblocktemplate->vTxSigOps[0] = nCoinbaseSigOps;
+                RandomiseNonce(pblock);
+                UpdateTime(pblock, Params().GetConsensus(), pindexPrev);
+                pblock->nBits = GetNextWorkRequired(pindexPrev, pblock, Params().GetConsensus());
+                return pblocktemplate.release();
+            }
+        }
+
+        // Start from the entries of the last template when it is still the best start for this one
+        std::set<uint256> setReplayed;
+        if (!fDeprecatedGetBlockTemplate && lastBlockTemplate.IsReusableFor(templateParams, setReplayed))
+        {
+            for (const CLastBlockTemplate::Entry& entry: lastBlockTemplate.vEntries)
+            {
+                const CTransactionBase& txBase = entry.fCertificate ?
+                    static_cast<const CTransactionBase&>(mempool.mapCertificate.at(entry.hash).GetCertificate()) :
+                    static_cast<const CTransactionBase&>(mempool.mapTx.at(entry.hash).GetTx());
+                CTxUndo dummyUndo;
+
+                bool fReplayed = view.HaveInputs(txBase);
+                if (fReplayed && pblock->nVersion == BLOCK_VERSION_SC_SUPPORT)
+                {
+                    if (entry.fCertificate)
+                        fReplayed = scCommGuard.add(dynamic_cast<const CScCertificate&>(txBase)) &&
+                                    scCommBuilder.add(dynamic_cast<const CScCertificate&>(txBase), view);
+                    else
+                        fReplayed = scCommGuard.add(dynamic_cast<const CTransaction&>(txBase), true) &&
+                                    scCommBuilder.add(dynamic_cast<const CTransaction&>(txBase));
+                }
+                if (!fReplayed)
+                {
+                    // This should never happen, the very same entries were added to the last template
+                    LogPrintf("%s():%d - ERROR: could not replay [%s] of the last template, selecting again\n",
+                        __func__, __LINE__, entry.hash.ToString());
+                    lastBlockTemplate.fValid = false;
+                    return CreateNewBlock(scriptPubKeyIn, nBlockMaxComplexitySize);
+                }
+
+                if (entry.fCertificate)
+                {
+                    UpdateCoins(dynamic_cast<const CScCertificate&>(txBase), view, dummyUndo, nHeight, /*isBlockTopQualityCert*/true);
+                    pblock->vcert.push_back(dynamic_cast<const CScCertificate&>(txBase));
+                    pblocktemplate->vCertFees.push_back(entry.nFee);
+                    pblocktemplate->vCertSigOps.push_back(entry.nSigOps);
+                    ++nBlockCert;
+                }
+                else
+                {
+                    UpdateCoins(dynamic_cast<const CTransaction&>(txBase), view, dummyUndo, nHeight);
+                    pblock->vtx.push_back(dynamic_cast<const CTransaction&>(txBase));
+                    pblocktemplate->vTxFees.push_back(entry.nFee);
+                    pblocktemplate->vTxSigOps.push_back(entry.nSigOps);
+                    ++nBlockTx;
+                    nBlockTxPartitionSize += entry.nSize;
+                }
+                nBlockSize += entry.nSize;
+                nBlockSigOps += entry.nSigOps;
+                nFees += entry.nFee;
+                nBlockComplexity += entry.nComplexity;
+                vTemplateEntries.push_back(entry);
+            }
+            fSortedByFee = lastBlockTemplate.fSortedByFee;
+
+            LogPrint("bench", "%s():%d - replayed %u entries of the last template\n", __func__, __LINE__, vTemplateEntries.size());
+        }
+        else
+        {
+            setReplayed.clear();
+        }
+
+        if (fDeprecatedGetBlockTemplate)
+            GetBlockTxPriorityDataOld(view, nHeight, nLockTimeCutoff, vecPriority, vOrphan, mapDependers);
+        else
+            GetBlockTxPriorityData(view, nHeight, nLockTimeCutoff, vecPriority, vOrphan, mapDependers, &setReplayed);
+
+        GetBlockCertPriorityData(view, nHeight, vecPriority, vOrphan, mapDependers, &setReplayed);
 
         // Order transactions and certificates.
         // Note that vecPriority might not contain all the transactions/certificates in mempool as there might be input dependencies
@@ -645,18 +986,41 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
         TxPriorityCompare comparer(fSortedByFee);
         std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
 
-        // considering certs having a higher priority than any possible tx.
-        // An algorithm for managing tx/cert priorities could be devised
-        while (!vecPriority.empty())
+        // The entries depending on the replayed ones can be taken now
+        for (const CLastBlockTemplate::Entry& entry: vTemplateEntries)
+            ReleaseDependers(entry.hash, mapDependers, vecPriority, comparer);
+
+        // The entries added to the block so far
+        std::set<uint256> setInBlock;
+        for (const CLastBlockTemplate::Entry& entry: vTemplateEntries)
+            setInBlock.insert(entry.hash);
+
+        // Once sorting by fee, the entries still waiting for their mempool dependencies are queued as well, ranked by
+        // the fee rate of their ancestor package. The dependencies not in the block yet are then added right before
+        // them, so that a child paying for its parents gets them into the block (child pays for parent).
+        bool fPackagesQueued = false;
+        auto queuePackages = [&]()
         {
-            // Take highest priority transaction off the priority queue:
-            double dPriority = vecPriority.front().get<0>();
-            CFeeRate feeRate = vecPriority.front().get<1>();
-            const CTransactionBase& tx = *(vecPriority.front().get<2>());
+            if (fDeprecatedGetBlockTemplate || fPackagesQueued)
+                return;
+            fPackagesQueued = true;
 
-            std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
-            vecPriority.pop_back();
+            for (const COrphan& orphan: vOrphan)
+            {
+                // the other ones have already been queued when their dependencies were added
+                if (orphan.setDependsOn.empty())
+                    continue;
+                std::vector<const CTransactionBase*> vPackage;
+                CFeeRate packageFeeRate = GetAncestorPackage(*orphan.ptx, setInBlock, vPackage);
+                vecPriority.push_back(TxPriority(orphan.dPriority, packageFeeRate, orphan.ptx));
+            }
+            std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+        };
 
+        // Add a tx or certificate whose mempool dependencies are all in the block already, unless a limit
+        // of the block or a check prevents it. Returns whether it has been added.
+        auto addToBlock = [&](const CTransactionBase& tx, double dPriority, const CFeeRate& feeRate) -> bool
+        {
             // Size limits
             unsigned int nTxBaseSize = tx.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
 
@@ -667,7 +1031,8 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
                 {
                     LogPrint("sc", "%s():%d - Skipping tx[%s] because nBlockTxPartitionMaxSize %d would be exceeded (partSize=%d / txSize=%d)\n",
                         __func__, __LINE__, tx.GetHash().ToString(), nBlockTxPartitionMaxSize, nBlockTxPartitionSize, nTxBaseSize );
-                    continue;
+                    fLimitReached = true;
+                    return false;
                 }
             }
 
@@ -675,13 +1040,17 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
             {
                 LogPrint("sc", "%s():%d - Skipping %s[%s] because nBlockMaxSize %d would be exceeded (blSize=%d / txBaseSize=%d)\n",
                     __func__, __LINE__, tx.IsCertificate()?"cert":"tx", tx.GetHash().ToString(), nBlockMaxSize, nBlockSize, nTxBaseSize );
-                continue;
+                fLimitReached = true;
+                return false;
             }
 
             // Legacy limits on sigOps:
             unsigned int nTxSigOps = GetLegacySigOpCount(tx);
             if (nBlockSigOps + nTxSigOps >= MAX_BLOCK_SIGOPS)
-                continue;
+            {
+                fLimitReached = true;
+                return false;
+            }
 
             const uint256& hash = tx.GetHash();
 
@@ -693,7 +1062,7 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
             {
                 LogPrint("sc", "%s():%d - Skipping [%s] because it is free (feeDelta=%lld/feeRate=%s, blsz=%u/txsz=%u/blminsz=%u)\n",
                     __func__, __LINE__, tx.GetHash().ToString(), nFeeDelta, feeRate.ToString(), nBlockSize, nTxBaseSize, nBlockMinSize );
-                continue;
+                return false;
             }
 
             // Prioritise by fee once past the priority size or we run out of high-priority
@@ -704,18 +1073,22 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
                 fSortedByFee = true;
                 comparer = TxPriorityCompare(fSortedByFee);
                 std::make_heap(vecPriority.begin(), vecPriority.end(), comparer);
+                queuePackages();
             }
 
             // Skip transaction if max block complexity reached.
             int nTxComplexity = tx.GetComplexity();
             if (!fDeprecatedGetBlockTemplate && nBlockMaxComplexitySize > 0 && nBlockComplexity + nTxComplexity >= nBlockMaxComplexitySize)
-                continue;
+            {
+                fLimitReached = true;
+                return false;
+            }
 
             if (!view.HaveInputs(tx))
             {
                 LogPrint("sc", "%s():%d - Skipping [%s] because it has no inputs\n",
                     __func__, __LINE__, tx.GetHash().ToString() );
-                continue;
+                return false;
             }
 
             CAmount nTxFees = tx.GetFeeAmount(view.GetValueIn(tx));
@@ -724,7 +1097,8 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
             {
                 LogPrint("sc", "%s():%d - Skipping [%s] because too many sigops in block\n",
                     __func__, __LINE__, tx.GetHash().ToString() );
-                continue;
+                fLimitReached = true;
+                return false;
             }
 
             // Skip transaction if we cannot add it to the sc commitment tree
@@ -741,29 +1115,25 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
                 if (!scCommitGuardRes) {
                     LogPrint("sc", "%s():%d - Skipping [%s] because txs commitment tree guard failed\n",
                             __func__, __LINE__, tx.GetHash().ToString());
-                    continue;
+                    fLimitReached = true;
+                    return false;
                 }
 
                 // Try adding to the real commitment tree if previous step was successful
                 bool scCommitmentBuilderResult;
                 if (tx.IsCertificate()) {
-                    scCommitmentBuilderResult = scCommBuilder->add(dynamic_cast<const CScCertificate&>(tx), view);
+                    scCommitmentBuilderResult = scCommBuilder.add(dynamic_cast<const CScCertificate&>(tx), view);
                 }
                 else {
-                    scCommitmentBuilderResult = scCommBuilder->add(dynamic_cast<const CTransaction&>(tx));
+                    scCommitmentBuilderResult = scCommBuilder.add(dynamic_cast<const CTransaction&>(tx));
                 }
                 if (!scCommitmentBuilderResult)
                 {
                     LogPrint("sc", "%s():%d - Skipping [%s] because we cannot add that to the sc commitment tree\n",
                         __func__, __LINE__, tx.GetHash().ToString());
                     // We cannot undo adding all the FT / BWTR / CERT / CSW contained in the tx that just failed,
-                    // so we have to destroy the scCommBuilder and add all the txs which are currently in the
+                    // the scCommBuilder will rebuild its tree with the txs which are currently in the
                     // block proposal
-                    scCommBuilder.reset(new SidechainTxsCommitmentBuilder);
-                    for (const auto& txInPBlock : pblock->vtx)
-                        scCommBuilder->add(txInPBlock);
-                    for (const auto& certInPBlock : pblock->vcert)
-                        scCommBuilder->add(certInPBlock, view);
 
                     // Also, remove the tx/cert from the commitment guard to keep them aligned
                     if (tx.IsCertificate()) {
@@ -772,7 +1142,8 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
                         scCommGuard.rewind(dynamic_cast<const CTransaction&>(tx));
                     }
 
-                    continue;
+                    fLimitReached = true;
+                    return false;
                 }
             }
 
@@ -787,7 +1158,10 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
                 {
                     const CScCertificate& castedCert = dynamic_cast<const CScCertificate&>(tx);
                     if(!ContextualCheckCertInputs(castedCert, dummyState, view, true, chainActive, MANDATORY_SCRIPT_VERIFY_FLAGS | SCRIPT_VERIFY_CHECKBLOCKATHEIGHT, true, Params().GetConsensus()))
-                        continue;
+                    {
+                        scCommBuilder.rewind(castedCert.GetHash());
+                        return false;
+                    }
 
                     UpdateCoins(castedCert, view, dummyUndo, nHeight, /*isBlockTopQualityCert*/true);
                     pblock->vcert.push_back(castedCert);
@@ -798,7 +1172,10 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
                 {
                     const CTransaction& castedTx = dynamic_cast<const CTransaction&>(tx);
                     if (!ContextualCheckTxInputs(castedTx, dummyState, view, true, chainActive, MANDATORY_SCRIPT_VERIFY_FLAGS | SCRIPT_VERIFY_CHECKBLOCKATHEIGHT, true, Params().GetConsensus()))
-                        continue;
+                    {
+                        scCommBuilder.rewind(castedTx.GetHash());
+                        return false;
+                    }
 
                     UpdateCoins(castedTx, view, dummyUndo, nHeight);
                     pblock->vtx.push_back(castedTx);
@@ -815,6 +1192,8 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
                 nBlockSigOps += nTxSigOps;
                 nFees += nTxFees;
                 nBlockComplexity += nTxComplexity;
+                vTemplateEntries.push_back(CLastBlockTemplate::Entry{hash, tx.IsCertificate(), nTxFees, nTxSigOps, nTxBaseSize, nTxComplexity});
+                setInBlock.insert(hash);
 
                 if (fPrintPriority)
                 {
@@ -829,30 +1208,55 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
             }
 
             // Add transactions that depend on this one to the priority queue
-            if (mapDependers.count(hash))
+            ReleaseDependers(hash, mapDependers, vecPriority, comparer);
+            return true;
+        };
+
+        if (fSortedByFee)
+            queuePackages();
+
+        // considering certs having a higher priority than any possible tx.
+        // An algorithm for managing tx/cert priorities could be devised
+        while (!vecPriority.empty())
+        {
+            // Take highest priority transaction off the priority queue:
+            double dPriority = vecPriority.front().get<0>();
+            CFeeRate feeRate = vecPriority.front().get<1>();
+            const CTransactionBase& tx = *(vecPriority.front().get<2>());
+
+            std::pop_heap(vecPriority.begin(), vecPriority.end(), comparer);
+            vecPriority.pop_back();
+
+            if (!fPackagesQueued)
             {
-                LogPrint("sc", "%s():%d - tx[%s] has %d orphans\n",
-                    __func__, __LINE__, hash.ToString(), mapDependers[hash].size());
-                for(COrphan* porphan: mapDependers[hash])
-                {
-                    if (!porphan->setDependsOn.empty())
-                    {
-                        porphan->setDependsOn.erase(hash);
-                        LogPrint("sc", "%s():%d - erasing tx[%s] from orphan %p\n", __func__, __LINE__, hash.ToString(), porphan);
-                        if (porphan->setDependsOn.empty())
-                        {
-                            LogPrint("sc", "%s():%d - tx[%s] resolved all dependencies, adding to prio vec, prio=%f, feeRate=%s\n",
-                                __func__, __LINE__, porphan->ptx->GetHash().ToString(), porphan->dPriority, porphan->feeRate.ToString());
-                            
-                            vecPriority.push_back(TxPriority(porphan->dPriority, porphan->feeRate, porphan->ptx));
-                            std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
-                        }
-                    }
-                    else
-                    {
-                        LogPrint("sc", "%s():%d - tx[%s] orphan %p empty\n", __func__, __LINE__, hash.ToString(), porphan);
-                    }
-                }
+                addToBlock(tx, dPriority, feeRate);
+                continue;
+            }
+
+            // An entry may be queued more than once, and it may have been added already as a dependency
+            if (setInBlock.count(tx.GetHash()))
+                continue;
+
+            // Queue it again if its package changed since it was queued, as some of its dependencies were
+            // added to the block meanwhile or it was queued with its own fee rate
+            std::vector<const CTransactionBase*> vPackage;
+            CFeeRate packageFeeRate = GetAncestorPackage(tx, setInBlock, vPackage);
+            if (!(packageFeeRate == feeRate))
+            {
+                vecPriority.push_back(TxPriority(dPriority, packageFeeRate, &tx));
+                std::push_heap(vecPriority.begin(), vecPriority.end(), comparer);
+                continue;
+            }
+
+            if (vPackage.size() > 1)
+                LogPrint("sc", "%s():%d - adding [%s] with %d dependencies, package feeRate=%s\n",
+                    __func__, __LINE__, tx.GetHash().ToString(), vPackage.size() - 1, packageFeeRate.ToString());
+
+            // Dependencies first, the package cannot be completed past an entry which is skipped
+            for (const CTransactionBase* pPackageTx: vPackage)
+            {
+                if (!addToBlock(*pPackageTx, dPriority, packageFeeRate))
+                    break;
             }
         }
 
@@ -868,25 +1272,28 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
         pblock->vtx[0] = createCoinbase(scriptPubKeyIn, nFees, nHeight);
         pblocktemplate->vTxFees[0] = -nFees;
 
-        // Randomise nonce
-        arith_uint256 nonce = UintToArith256(GetRandHash());
-        // Clear the top and bottom 16 bits (for local use as thread flags and counters)
-        nonce <<= 32;
-        nonce >>= 16;
-        pblock->nNonce = ArithToUint256(nonce);
+        RandomiseNonce(pblock);
 
         // Fill in header
         pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
 
         if (pblock->nVersion == BLOCK_VERSION_SC_SUPPORT)
         {
-            bool retValtxsComm = pblock->UpdateScTxsCommitment(view);
-            assert(retValtxsComm);
-            // Additional check: this sc commitment must be equal to the one we built on the fly
-            const uint256& scTxsCommitment = scCommBuilder->getCommitment();
-            if (pblock->hashScTxsCommitment != scTxsCommitment) {
-                throw std::runtime_error("CreateNewBlock(): SCTxsCommitment verification failed");
+            const uint256 scTxsCommitment = scCommBuilder.getCommitment();
+            LogPrint("sc", "%s():%d - sc commitment built reusing %d txs/certs of the previous template\n",
+                __func__, __LINE__, scCommBuilder.getReusedContributions());
+
+            if (Params().DefaultConsistencyChecks())
+            {
+                // Additional check: the sc commitment built on the fly must be equal to the one built from scratch
+                bool retValtxsComm = pblock->UpdateScTxsCommitment(view);
+                assert(retValtxsComm);
+                if (pblock->hashScTxsCommitment != scTxsCommitment) {
+                    throw std::runtime_error("CreateNewBlock(): SCTxsCommitment verification failed");
+                }
             }
+
+            pblock->hashScTxsCommitment = scTxsCommitment;
         }
 
         UpdateTime(pblock, Params().GetConsensus(), pindexPrev);
@@ -896,7 +1303,20 @@ CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn,  unsigned int nBlo
 
         CValidationState state;
         if (!TestBlockValidity(state, *pblock, pindexPrev, flagCheckPow::OFF, flagCheckMerkleRoot::OFF, flagScRelatedChecks::OFF))
+        {
+            lastBlockTemplate.fValid = false;
             throw std::runtime_error("CreateNewBlock(): TestBlockValidity failed");
+        }
+
+        lastBlockTemplate.fValid = !fDeprecatedGetBlockTemplate;
+        lastBlockTemplate.params = templateParams;
+        lastBlockTemplate.vEntries.swap(vTemplateEntries);
+        lastBlockTemplate.fSortedByFee = fSortedByFee;
+        lastBlockTemplate.fLimitReached = fLimitReached;
+
+        blockTemplateBody.params = templateParams;
+        blockTemplateBody.nTransactionsUpdated = nTransactionsUpdated;
+        blockTemplateBody.pblocktemplate.reset(new CBlockTemplate(*pblocktemplate));
     }
 
     return pblocktemplate.release();
@@ -951,6 +1371,48 @@ CBlockTemplate* CreateNewBlockWithKey()
 
 #ifdef ENABLE_MINING
 
+CTrompSolver::CTrompSolver(): eq(new equi(1))
+{
+}
+
+CTrompSolver::~CTrompSolver()
+{
+}
+
+bool CTrompSolver::Solve(const eh_HashState& curr_state, const std::function<bool(std::vector<unsigned char>)>& validBlock)
+{
+    // Only the bucket sizes and the solutions need to be reset, the heaps are overwritten by each run
+    eq->setstate(&curr_state);
+
+    // Intialization done, start algo driver.
+    eq->digit0(0);
+    eq->xfull = eq->bfull = eq->hfull = 0;
+    eq->showbsizes(0);
+    for (u32 r = 1; r < WK; r++) {
+        (r&1) ? eq->digitodd(r, 0) : eq->digiteven(r, 0);
+        eq->xfull = eq->bfull = eq->hfull = 0;
+        eq->showbsizes(r);
+    }
+    eq->digitK(0);
+
+    // Convert solution indices to byte array (decompress) and pass it to validBlock method.
+    for (size_t s = 0; s < eq->nsols && s < MAXSOLS; s++) {
+        LogPrint("pow", "Checking solution %d\n", s+1);
+        std::vector<eh_index> index_vector(PROOFSIZE);
+        for (size_t i = 0; i < PROOFSIZE; i++) {
+            index_vector[i] = eq->sols[s][i];
+        }
+        std::vector<unsigned char> sol_char = GetMinimalFromIndices(index_vector, DIGITBITS);
+
+        if (validBlock(sol_char)) {
+            // If we find a POW solution, do not try other solutions
+            // because they become invalid as we created a new block in blockchain.
+            return true;
+        }
+    }
+    return false;
+}
+
 void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int& nExtraNonce)
 {
     // Update nExtraNonce
@@ -967,7 +1429,7 @@ void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int&
     assert(txCoinbase.vin[0].scriptSig.size() <= 100);
 
     pblock->vtx[0] = txCoinbase;
-    pblock->hashMerkleRoot = pblock->BuildMerkleTree();
+    pblock->hashMerkleRoot = pblock->ComputeMerkleRoot();
 #ifdef DEBUG_SC_COMMITMENT_HASH
     std::cout << "-------------------------------------------" << std::endl;
     std::cout << "  hashScTxsCommitment: " << pblock->hashScTxsCommitment.ToString() << std::endl;
@@ -1033,6 +1495,7 @@ void static BitcoinMiner()
     std::string solver = GetArg("-equihashsolver", "default");
     assert(solver == "tromp" || solver == "default");
     LogPrint("pow", "Using Equihash solver \"%s\" with n = %u, k = %u\n", solver, n, k);
+    std::unique_ptr<CTrompSolver> trompSolver;
 
     std::mutex m_cs;
     bool cancelSolver = false;
@@ -1166,37 +1629,11 @@ void static BitcoinMiner()
 
                 // TODO: factor this out into a function with the same API for each solver.
                 if (solver == "tromp") {
-                    // Create solver and initialize it.
-                    equi eq(1);
-                    eq.setstate(&curr_state);
-
-                    // Intialization done, start algo driver.
-                    eq.digit0(0);
-                    eq.xfull = eq.bfull = eq.hfull = 0;
-                    eq.showbsizes(0);
-                    for (u32 r = 1; r < WK; r++) {
-                        (r&1) ? eq.digitodd(r, 0) : eq.digiteven(r, 0);
-                        eq.xfull = eq.bfull = eq.hfull = 0;
-                        eq.showbsizes(r);
-                    }
-                    eq.digitK(0);
+                    // The solver of this thread, created on first use
+                    if (!trompSolver)
+                        trompSolver.reset(new CTrompSolver());
+                    trompSolver->Solve(curr_state, validBlock);
                     ehSolverRuns.increment();
-
-                    // Convert solution indices to byte array (decompress) and pass it to validBlock method.
-                    for (size_t s = 0; s < eq.nsols; s++) {
-                        LogPrint("pow", "Checking solution %d\n", s+1);
-                        std::vector<eh_index> index_vector(PROOFSIZE);
-                        for (size_t i = 0; i < PROOFSIZE; i++) {
-                            index_vector[i] = eq.sols[s][i];
-                        }
-                        std::vector<unsigned char> sol_char = GetMinimalFromIndices(index_vector, DIGITBITS);
-
-                        if (validBlock(sol_char)) {
-                            // If we find a POW solution, do not try other solutions
-                            // because they become invalid as we created a new block in blockchain.
-                            break;
-                        }
-                    }
                 } else {
                     try {
                         // If we find a valid block, we rebuild
@@ -7,11 +7,17 @@
 #define BITCOIN_MINER_H
 
 #include "primitives/block.h"
+#ifdef ENABLE_MINING
+#include "crypto/equihash.h"
+#endif
 
 #include <boost/tuple/tuple.hpp>
 
+#include <functional>
+#include <memory>
 #include <optional>
 #include <stdint.h>
+#include <vector>
 
 class CBlockIndex;
 class CScript;
@@ -60,15 +66,17 @@ public:
     bool operator()(const TxPriority& a, const TxPriority& b);
 };
 
-/** Retrieve mempool transactions priority info */
+/** Retrieve mempool transactions priority info, skipping the ones in pExcluded if any */
 void GetBlockTxPriorityData(const CCoinsViewCache& view, int nHeight, int64_t nLockTimeCutoff,
-                               std::vector<TxPriority>& vecPriority, std::list<COrphan>& vOrphan, std::map<uint256, std::vector<COrphan*> >& mapDependers);
+                               std::vector<TxPriority>& vecPriority, std::list<COrphan>& vOrphan, std::map<uint256, std::vector<COrphan*> >& mapDependers,
+                               const std::set<uint256>* pExcluded = nullptr);
 /** DEPRECATED. Retrieve mempool transactions priority info */
 void GetBlockTxPriorityDataOld(const CCoinsViewCache& view, int nHeight, int64_t nLockTimeCutoff,
                                std::vector<TxPriority>& vecPriority, std::list<COrphan>& vOrphan, std::map<uint256, std::vector<COrphan*> >& mapDependers);
 
 void GetBlockCertPriorityData(const CCoinsViewCache& view, int nHeight,
-                              std::vector<TxPriority>& vecPriority, std::list<COrphan>& vOrphan, std::map<uint256, std::vector<COrphan*> >& mapDependers);
+                              std::vector<TxPriority>& vecPriority, std::list<COrphan>& vOrphan, std::map<uint256, std::vector<COrphan*> >& mapDependers,
+                              const std::set<uint256>* pExcluded = nullptr);
 
 /** Generate a new block, without valid proof-of-work */
 CBlockTemplate* CreateNewBlock(const CScript& scriptPubKeyIn);
@@ -83,7 +91,45 @@ CBlockTemplate* CreateNewBlockWithKey();
 
 CMutableTransaction createCoinbase(const CScript &scriptPubKeyIn, CAmount fees, const int nHeight);
 
+/** The coinbase of a block template for another payout script, and the merkle root of the template with it */
+struct CCoinbaseVariant
+{
+    CTransaction txCoinbase;
+    int64_t nSigOps;
+    uint256 hashMerkleRoot;
+};
+
+/**
+ * The coinbases of blocktemplate, for the block at nHeight, paying each of vScriptPubKeys what its own coinbase pays to
+ * its payout script, with the same community fund outputs, and the merkle roots with each of them: the txes and
+ * certificates, so the rest of the merkle tree and the sc txs commitment, are shared. False if the block would not
+ * fit its limits with one of them.
+ */
+bool GetCoinbaseVariants(const CBlockTemplate& blocktemplate, int nHeight, const std::vector<CScript>& vScriptPubKeys,
+                         std::vector<CCoinbaseVariant>& vVariants);
+
 #ifdef ENABLE_MINING
+struct equi;
+
+/**
+ * The tromp Equihash solver of a mining thread. Its memory (a few hundred MB, backed by huge pages where
+ * the system provides them) is allocated once and reused for every nonce, instead of for each of them.
+ */
+class CTrompSolver
+{
+public:
+    CTrompSolver();
+    ~CTrompSolver();
+    CTrompSolver(const CTrompSolver&) = delete;
+    CTrompSolver& operator=(const CTrompSolver&) = delete;
+
+    /** Solve for the given state, passing each solution to validBlock until it returns true, which is then returned */
+    bool Solve(const eh_HashState& curr_state, const std::function<bool(std::vector<unsigned char>)>& validBlock);
+
+private:
+    std::unique_ptr<equi> eq;
+};
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 /** Run the miner threads */
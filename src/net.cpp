@@ -14,6 +14,7 @@
 #include "clientversion.h"
 #include "primitives/transaction.h"
 #include "scheduler.h"
+#include "socketpoller.h"
 #include "ui_interface.h"
 #include "crypto/common.h"
 #include "zen/utiltls.h"
@@ -26,8 +27,13 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
 #endif
 
+#include <atomic>
+#include <cmath>
+#include <memory>
+
 #include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 
@@ -95,8 +101,9 @@ bool fAddressesInitialized = false;
 TLSManager tlsmanager = TLSManager();
 vector<CNode*> vNodes;
 CCriticalSection cs_vNodes;
-map<CInv, CDataStream> mapRelay;
+map<CInv, std::shared_ptr<const CTransactionBase> > mapRelay;
 deque<pair<int64_t, CInv> > vRelayExpiration;
+size_t nRelayBytes = 0;
 CCriticalSection cs_mapRelay;
 LimitedMap<CInv, int64_t> mapAlreadyAskedFor(MAX_INV_SZ);
 LimitedMap<CInv, int64_t> mapAlreadyReceived(MAPRECEIVED_MAX_SZ);
@@ -698,6 +705,13 @@ void CNode::copyStats(CNodeStats &stats)
     X(fWhitelisted);
     X(m_addr_rate_limited);
     X(m_addr_processed);
+    {
+        LOCK(cs_inventory);
+        stats.fTxReconciliation = txReconciliation.fEnabled;
+        stats.fTxReconciliationFlood = txReconciliation.fFlood;
+        stats.nTxReconciliationRounds = txReconciliation.nRounds;
+        stats.nTxReconciliationShared = txReconciliation.nShared;
+    }
 
     // It is common for nodes with good ping times to suddenly become lagged,
     // due to a new block arriving or other large transfer.
@@ -757,7 +771,7 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
         nBytes -= handled;
 
         if (msg.complete()) {
-            msg.nTime = GetTimeMicros();
+            msg.SetComplete(GetTimeMicros());
             messageHandlerCondition.notify_one();
         }
     }
@@ -807,11 +821,22 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
     }
 
     memcpy(&vRecv[nDataPos], pch, nCopy);
+    hasher.Write((const unsigned char*)pch, nCopy);
     nDataPos += nCopy;
 
     return nCopy;
 }
 
+void CNetMessage::SetComplete(int64_t nTimeIn)
+{
+    assert(complete());
+    nTime = nTimeIn;
+    uint256 hash;
+    hasher.Finalize(hash.begin());
+    nChecksum = ReadLE32(hash.begin());
+    fChecksumValid = (nChecksum == hdr.nChecksum);
+}
+
 
 
 
@@ -820,18 +845,53 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 
 
 
+#ifndef WIN32
+/** Buffers of the send queue given to one sendmsg() call at most */
+static const int MAX_SEND_IOVECS = 64;
+#endif
+
+/**
+ * Send the buffers of the send queue from it on, nOffset bytes of the first one being already sent.
+ * The buffers are gathered by a single sendmsg() where available, instead of one send() each.
+ * nOffered is set to the number of bytes handed to the socket.
+ */
+static int SendBuffers(SOCKET hSocket, std::deque<CSendBuffer>::const_iterator it,
+                       std::deque<CSendBuffer>::const_iterator itEnd, size_t nOffset, size_t& nOffered)
+{
+#ifndef WIN32
+    struct iovec iov[MAX_SEND_IOVECS];
+    int nIov = 0;
+    nOffered = 0;
+    for (; it != itEnd && nIov < MAX_SEND_IOVECS; ++it, nOffset = 0) {
+        iov[nIov].iov_base = (void*)(it->pdata + nOffset);
+        iov[nIov].iov_len = it->nSize - nOffset;
+        nOffered += iov[nIov].iov_len;
+        nIov++;
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = nIov;
+    return sendmsg(hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+    nOffered = it->nSize - nOffset;
+    return send(hSocket, it->pdata + nOffset, nOffered, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
+}
+
 // requires LOCK(cs_vSend)
 void SocketSendData(CNode *pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
+    std::deque<CSendBuffer>::iterator it = pnode->vSendMsg.begin();
 
     while (it != pnode->vSendMsg.end())
     {
-        const CSerializeData &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert(it->nSize > pnode->nSendOffset);
 
         bool bIsSSL = false;
         int nBytes = 0, nRet = 0;
+        size_t nOffered = 0;
         {
             LOCK(pnode->cs_hSocket);
             
@@ -845,13 +905,15 @@ void SocketSendData(CNode *pnode)
             
             if (bIsSSL)
             {
+                // the records are encrypted one buffer at a time
                 ERR_clear_error(); // clear the error queue, otherwise we may be reading an old error that occurred previously in the current thread
-                nBytes = SSL_write(pnode->ssl, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset);
+                nOffered = it->nSize - pnode->nSendOffset;
+                nBytes = SSL_write(pnode->ssl, it->pdata + pnode->nSendOffset, nOffered);
                 nRet = SSL_get_error(pnode->ssl, nBytes);
             }
             else
             {
-                nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+                nBytes = SendBuffers(pnode->hSocket, it, pnode->vSendMsg.end(), pnode->nSendOffset, nOffered);
                 nRet = WSAGetLastError();
             }
         }
@@ -859,18 +921,21 @@ void SocketSendData(CNode *pnode)
         {
             pnode->nLastSend = GetTime();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             pnode->RecordBytesSent(nBytes);
 
-            if (pnode->nSendOffset == data.size())
+            // Drop the buffers sent in full
+            size_t nSent = pnode->nSendOffset + nBytes;
+            while (it != pnode->vSendMsg.end() && nSent >= it->nSize)
             {
-                pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
+                nSent -= it->nSize;
+                pnode->nSendSize -= it->nSize;
                 it++;
             }
-            else
+            pnode->nSendOffset = nSent;
+
+            if ((size_t)nBytes < nOffered)
             {
-                // could not send full message; stop sending more
+                // could not send everything; stop sending more
                 break;
             }
         }
@@ -1074,6 +1139,27 @@ static bool AttemptToEvictConnection(bool fPreferNewConnection) {
 }
 
 
+#ifdef USE_TLS
+/** An inbound connection whose TLS handshake is in progress, see ContinuePendingTLSAccepts */
+struct PendingTLSAccept
+{
+    SOCKET hSocket;
+    CAddress addr;
+    bool whitelisted;
+    SSL* ssl;
+    int64_t nOwnerId;   //! the id of the socket for the poller, apart from those of the nodes
+    int nWantEvents;    //! the SocketEvent the handshake waits for
+    int64_t nTimeout;   //! the time in msec the handshake must be done by
+};
+/** The inbound TLS handshakes in progress, only used by the socket handler thread */
+static std::list<PendingTLSAccept> lPendingTLSAccepts;
+static int64_t nLastPendingTLSAcceptId = -2;
+/** The inbound TLS handshakes in progress at most, the connections beyond are dropped */
+static const size_t MAX_PENDING_TLS_ACCEPTS = 64;
+#endif // USE_TLS
+
+static void AddInboundNode(SOCKET hSocket, const CAddress& addr, bool whitelisted, SSL* ssl);
+
 static void AcceptConnection(const ListenSocket& hListenSocket) {
     struct sockaddr_storage sockaddr;
     socklen_t len = sizeof(sockaddr);
@@ -1136,12 +1222,11 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
 #endif
 
 
-    SSL *ssl = NULL;
-    
     SetSocketNonBlocking(hSocket, true);
     
 #ifdef USE_TLS
     /* TCP connection is ready. Do server side SSL. */
+    bool bUseTLS = true;
     if (CNode::GetTlsFallbackNonTls())
     {
         LOCK(cs_vNonTLSNodesInbound);
@@ -1150,33 +1235,10 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
 
         NODE_ADDR nodeAddr(addr.ToStringIP());
         
-        bool bUseTLS = (find(vNonTLSNodesInbound.begin(),
-                             vNonTLSNodesInbound.end(),
-                             nodeAddr) == vNonTLSNodesInbound.end());
-        unsigned long err_code = 0;
-        if (bUseTLS)
-        {
-            ssl = tlsmanager.accept( hSocket, addr, err_code);
-            if(!ssl)
-            {
-                if (err_code == TLSManager::SELECT_TIMEDOUT)
-                {
-                    // can fail also for timeout in select on fd, that is not a ssl error and we should not
-                    // consider this node as non TLS
-                    LogPrint("tls", "%s():%d - Connection from %s timedout\n", __func__, __LINE__, addr.ToStringIP());
-                }
-                else
-                {
-                    // Further reconnection will be made in non-TLS (unencrypted) mode
-                    vNonTLSNodesInbound.push_back(NODE_ADDR(addr.ToStringIP(), GetTimeMillis()));
-                    LogPrint("tls", "%s():%d - err_code %x, adding connection from %s vNonTLSNodesInbound list (sz=%d)\n",
-                        __func__, __LINE__, err_code, addr.ToStringIP(), vNonTLSNodesInbound.size());
-                }
-                CloseSocket(hSocket);
-                return;
-            }
-        }
-        else
+        bUseTLS = (find(vNonTLSNodesInbound.begin(),
+                        vNonTLSNodesInbound.end(),
+                        nodeAddr) == vNonTLSNodesInbound.end());
+        if (!bUseTLS)
         {
             LogPrintf ("TLS: Connection from %s will be unencrypted\n", addr.ToStringIP());
             
@@ -1189,19 +1251,47 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
                     vNonTLSNodesInbound.end());
         }
     }
-    else
+
+    if (bUseTLS)
     {
+        // The handshake goes on along with the other sockets, a slow client does not hold up the socket handler
+        if (lPendingTLSAccepts.size() >= MAX_PENDING_TLS_ACCEPTS)
+        {
+            LogPrint("tls", "%s():%d - too many TLS handshakes in progress, connection from %s dropped\n",
+                __func__, __LINE__, addr.ToString());
+            CloseSocket(hSocket);
+            return;
+        }
+
         unsigned long err_code = 0;
-        ssl = tlsmanager.accept( hSocket, addr, err_code);
-        if(!ssl)
+        SSL* ssl = tlsmanager.beginAccept(hSocket, addr, err_code);
+        if (!ssl)
         {
             LogPrint("tls", "%s():%d - err_code %x, failure accepting connection from %s\n",
                 __func__, __LINE__, err_code, addr.ToStringIP());
             CloseSocket(hSocket);
             return;
         }
+
+        PendingTLSAccept pending;
+        pending.hSocket = hSocket;
+        pending.addr = addr;
+        pending.whitelisted = whitelisted;
+        pending.ssl = ssl;
+        pending.nOwnerId = nLastPendingTLSAcceptId--;
+        pending.nWantEvents = SOCKET_EVENT_RECV;
+        pending.nTimeout = GetTimeMillis() + DEFAULT_CONNECT_TIMEOUT;
+        lPendingTLSAccepts.push_back(pending);
+        return;
     }
-    
+#endif // USE_TLS
+
+    AddInboundNode(hSocket, addr, whitelisted, NULL);
+}
+
+static void AddInboundNode(SOCKET hSocket, const CAddress& addr, bool whitelisted, SSL* ssl)
+{
+#ifdef USE_TLS
     // certificate validation is disabled by default    
     if (CNode::GetTlsValidate())
     {
@@ -1227,6 +1317,53 @@ static void AcceptConnection(const ListenSocket& hListenSocket) {
     }
 }
 
+#ifdef USE_TLS
+/** Go on with the TLS handshakes of the inbound connections, after the wait of the socket handler */
+static void ContinuePendingTLSAccepts(const CSocketPoller& poller)
+{
+    int64_t nNow = GetTimeMillis();
+    for (std::list<PendingTLSAccept>::iterator it = lPendingTLSAccepts.begin(); it != lPendingTLSAccepts.end(); )
+    {
+        PendingTLSAccept& pending = *it;
+        unsigned long err_code = 0;
+        int nResult = 0;
+        if (poller.GetEvents(pending.hSocket) != 0)
+            nResult = tlsmanager.continueAccept(pending.ssl, pending.addr, pending.nWantEvents, err_code);
+        if (nResult == 0 && nNow > pending.nTimeout)
+        {
+            // can fail also for timeout, that is not a ssl error and we should not consider this node as non TLS
+            LogPrint("tls", "%s():%d - Connection from %s timedout\n", __func__, __LINE__, pending.addr.ToStringIP());
+            err_code = TLSManager::SELECT_TIMEDOUT;
+            nResult = -1;
+        }
+        if (nResult == 0)
+        {
+            ++it;
+            continue;
+        }
+
+        if (nResult == 1)
+        {
+            AddInboundNode(pending.hSocket, pending.addr, pending.whitelisted, pending.ssl);
+        }
+        else
+        {
+            if (CNode::GetTlsFallbackNonTls() && err_code != TLSManager::SELECT_TIMEDOUT)
+            {
+                // Further reconnection will be made in non-TLS (unencrypted) mode
+                LOCK(cs_vNonTLSNodesInbound);
+                vNonTLSNodesInbound.push_back(NODE_ADDR(pending.addr.ToStringIP(), GetTimeMillis()));
+                LogPrint("tls", "%s():%d - err_code %x, adding connection from %s vNonTLSNodesInbound list (sz=%d)\n",
+                    __func__, __LINE__, err_code, pending.addr.ToStringIP(), vNonTLSNodesInbound.size());
+            }
+            SSL_free(pending.ssl);
+            CloseSocket(pending.hSocket);
+        }
+        it = lPendingTLSAccepts.erase(it);
+    }
+}
+#endif // USE_TLS
+
 #if defined(USE_TLS)
 void ThreadNonTLSPoolsCleaner()
 {
@@ -1244,6 +1381,8 @@ void ThreadNonTLSPoolsCleaner()
 void ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    std::unique_ptr<CSocketPoller> poller(CSocketPoller::Create());
+    LogPrint("net", "%s: waiting for the sockets with %s\n", __func__, poller->GetName());
     while (true)
     {
         //
@@ -1312,24 +1451,19 @@ void ThreadSocketHandler()
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
         bool have_fds = false;
 
         BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket.socket);
+            poller->Watch(hListenSocket.socket, -1, SOCKET_EVENT_RECV);
+            have_fds = true;
+        }
+
+#ifdef USE_TLS
+        BOOST_FOREACH(const PendingTLSAccept& pending, lPendingTLSAccepts) {
+            poller->Watch(pending.hSocket, pending.nOwnerId, pending.nWantEvents | SOCKET_EVENT_ERROR);
             have_fds = true;
         }
+#endif // USE_TLS
 
         {
             LOCK(cs_vNodes);
@@ -1340,18 +1474,17 @@ void ThreadSocketHandler()
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
                 
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = max(hSocketMax, pnode->hSocket);
+                int nEvents = SOCKET_EVENT_ERROR;
                 have_fds = true;
 
                 // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
+                // * If there is data to send, wait for sending data. As this only
                 //   happens when optimistic write failed, we choose to first drain the
                 //   write buffer in this case before receiving more. This avoids
                 //   needlessly queueing received data, if the remote peer is not themselves
                 //   receiving data. This means properly utilizing TCP flow control signalling.
                 // * Otherwise, if there is no (complete) message in the receive buffer,
-                //   or there is space left in the buffer, select() for receiving data.
+                //   or there is space left in the buffer, wait for receiving data.
                 // * (if neither of the above applies, there is certainly one message
                 //   in the receiver buffer ready to be processed).
                 // Together, that means that at least one of the following is always possible,
@@ -1360,39 +1493,37 @@ void ThreadSocketHandler()
                 // * We wait for data to be received (and disconnect after timeout).
                 // * We process a message in the buffer (message handler thread).
 
+                bool fSend = false;
                 {
                     TRY_LOCK(pnode->cs_vSend, lockSend);
-                    if (lockSend && !pnode->vSendMsg.empty()) {
-                        FD_SET(pnode->hSocket, &fdsetSend);
-                        continue;
-                    }
+                    fSend = lockSend && !pnode->vSendMsg.empty();
                 }
-                {
+                if (fSend) {
+                    nEvents |= SOCKET_EVENT_SEND;
+                } else {
                     TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                     if (lockRecv && (
                         pnode->vRecvMsg.empty() || !pnode->vRecvMsg.front().complete() ||
                         pnode->GetTotalRecvSize() <= ReceiveFloodSize()))
-                        FD_SET(pnode->hSocket, &fdsetRecv);
+                        nEvents |= SOCKET_EVENT_RECV;
                 }
+                poller->Watch(pnode->hSocket, pnode->id, nEvents);
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        // frequency to poll pnode->vSend
+        static const int SOCKET_POLL_TIMEOUT_MS = 50;
+        bool fPolled = poller->Wait(SOCKET_POLL_TIMEOUT_MS);
         boost::this_thread::interruption_point();
 
-        if (nSelect == SOCKET_ERROR)
+        if (!fPolled)
         {
             if (have_fds)
             {
                 int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
+                LogPrintf("socket %s error %s\n", poller->GetName(), NetworkErrorString(nErr));
             }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec/1000);
+            MilliSleep(SOCKET_POLL_TIMEOUT_MS);
         }
 
         //
@@ -1400,11 +1531,14 @@ void ThreadSocketHandler()
         //
         BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && (poller->GetEvents(hListenSocket.socket) & SOCKET_EVENT_RECV))
             {
                 AcceptConnection(hListenSocket);
             }
         }
+#ifdef USE_TLS
+        ContinuePendingTLSAccepts(*poller);
+#endif // USE_TLS
 
         //
         // Service each socket
@@ -1420,7 +1554,7 @@ void ThreadSocketHandler()
         {
             boost::this_thread::interruption_point();
 
-            if (tlsmanager.threadSocketHandler(pnode,fdsetRecv,fdsetSend,fdsetError)==-1){
+            if (tlsmanager.threadSocketHandler(pnode, *poller) == -1){
                 continue;
             }
 
@@ -1515,12 +1649,23 @@ void ThreadDNSAddressSeed()
 
 
 
+//! The changes of addrman already in peers.dat, max if peers.dat has to be written anyway
+static uint64_t nAddrmanChangesDumped = std::numeric_limits<uint64_t>::max();
+
 void DumpAddresses()
 {
+    // the dumps are frequent and the tables mostly idle once the node has its peers
+    uint64_t nChanges = addrman.GetChanges();
+    if (nChanges == nAddrmanChangesDumped) {
+        LogPrint("net", "No changes of the %d addresses since the last flush to peers.dat\n", addrman.size());
+        return;
+    }
+
     int64_t nStart = GetTimeMillis();
 
     CAddrDB adb;
-    adb.Write(addrman);
+    if (adb.Write(addrman))
+        nAddrmanChangesDumped = nChanges;
 
     LogPrint("net", "Flushed %d addresses to peers.dat  %dms\n",
            addrman.size(), GetTimeMillis() - nStart);
@@ -1770,7 +1915,10 @@ bool OpenNetworkConnection(const CAddress& addrConnect, CSemaphoreGrant *grantOu
 }
 
 
-void ThreadMessageHandler()
+//! The node to trickle the inventory to in this round of the handler threads, -1 once done
+static std::atomic<NodeId> nodeTrickle(-1);
+
+void ThreadMessageHandler(int nThread, int nThreads)
 {
     boost::mutex condition_mutex;
     boost::unique_lock<boost::mutex> lock(condition_mutex);
@@ -1787,10 +1935,13 @@ void ThreadMessageHandler()
             }
         }
 
-        // Poll the connected nodes for messages
-        CNode* pnodeTrickle = nullptr;
-        if (!vNodesCopy.empty())
-            pnodeTrickle = vNodesCopy[GetRand(vNodesCopy.size())];
+        // Poll the connected nodes for messages, each handler thread starting from its own share of them.
+        // One node of all is trickled to per round, chosen by the first thread, whichever thread serves it.
+        if (!vNodesCopy.empty()) {
+            if (nThread == 0)
+                nodeTrickle = vNodesCopy[GetRand(vNodesCopy.size())]->id;
+            std::rotate(vNodesCopy.begin(), vNodesCopy.begin() + nThread * vNodesCopy.size() / nThreads, vNodesCopy.end());
+        }
 
         bool fSleep = true;
 
@@ -1799,6 +1950,12 @@ void ThreadMessageHandler()
             if (pnode->fDisconnect)
                 continue;
 
+            // A node is served by one handler thread at a time, which keeps its messages in order:
+            // the commands of different nodes only wait for each other on the locks they take
+            TRY_LOCK(pnode->cs_messageHandler, lockHandler);
+            if (!lockHandler)
+                continue;
+
             // Receive messages
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
@@ -1822,7 +1979,11 @@ void ThreadMessageHandler()
             {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
                 if (lockSend)
-                    g_signals.SendMessages(pnode, pnode == pnodeTrickle || pnode->fWhitelisted);
+                {
+                    NodeId id = pnode->id;
+                    const bool fTrickle = id == nodeTrickle && nodeTrickle.compare_exchange_strong(id, -1);
+                    g_signals.SendMessages(pnode, fTrickle || pnode->fWhitelisted);
+                }
             }
             boost::this_thread::interruption_point();
         }
@@ -2008,6 +2169,8 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
         CAddrDB adb;
         if (!adb.Read(addrman))
             LogPrintf("Invalid or missing peers.dat; recreating\n");
+        else
+            nAddrmanChangesDumped = addrman.GetChanges();
     }
     LogPrintf("Loaded %i addresses from peers.dat  %dms\n",
            addrman.size(), GetTimeMillis() - nStart);
@@ -2060,7 +2223,13 @@ void StartNode(boost::thread_group& threadGroup, CScheduler& scheduler)
     threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "opencon", &ThreadOpenConnections));
 
     // Process messages
-    threadGroup.create_thread(boost::bind(&TraceThread<void (*)()>, "msghand", &ThreadMessageHandler));
+    int nMessageHandlerThreads = GetArg("-msghandthreads", DEFAULT_MESSAGE_HANDLER_THREADS);
+    nMessageHandlerThreads = std::max(1, std::min(nMessageHandlerThreads, MAX_MESSAGE_HANDLER_THREADS));
+    LogPrintf("Using %d message handler threads\n", nMessageHandlerThreads);
+    for (int i = 0; i < nMessageHandlerThreads; i++) {
+        boost::function<void()> fn = boost::bind(&ThreadMessageHandler, i, nMessageHandlerThreads);
+        threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()> >, "msghand", fn));
+    }
 
 #if defined(USE_TLS)
     if (CNode::GetTlsFallbackNonTls())
@@ -2119,21 +2288,37 @@ void CNode::NetCleanup()
 #endif
 }
 
-void Relay(const CTransactionBase& tx, const CDataStream& ss)
+static void EraseRelayFront()
 {
+    AssertLockHeld(cs_mapRelay);
+    map<CInv, std::shared_ptr<const CTransactionBase> >::iterator mi = mapRelay.find(vRelayExpiration.front().second);
+    if (mi != mapRelay.end()) {
+        nRelayBytes -= mi->second->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+        mapRelay.erase(mi);
+    }
+    vRelayExpiration.pop_front();
+}
+
+void Relay(const std::shared_ptr<const CTransactionBase>& txBase)
+{
+    const CTransactionBase& tx = *txBase;
     CInv inv(MSG_TX, tx.GetHash());
     {
         LOCK(cs_mapRelay);
         // Expire old relay messages
         while (!vRelayExpiration.empty() && vRelayExpiration.front().first < GetTime())
-        {
-            mapRelay.erase(vRelayExpiration.front().second);
-            vRelayExpiration.pop_front();
+            EraseRelayFront();
+
+        // Keep the object, not a serialized copy: it is the one of the mempool entry, when there is one
+        if (mapRelay.insert(std::make_pair(inv, txBase)).second) {
+            nRelayBytes += tx.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+            vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
         }
 
-        // Save original serialized message so newer versions are preserved
-        mapRelay.insert(std::make_pair(inv, ss));
-        vRelayExpiration.push_back(std::make_pair(GetTime() + 15 * 60, inv));
+        // Then the oldest ones over the memory bound, the mempool still answers for those it has
+        const size_t nMaxRelayBytes = MaxRelayMemory();
+        while (nRelayBytes > nMaxRelayBytes && !vRelayExpiration.empty())
+            EraseRelayFront();
     }
     LOCK(cs_vNodes);
     BOOST_FOREACH(CNode* pnode, vNodes)
@@ -2194,21 +2379,21 @@ void CNode::Fuzz(int nChance)
     case 0:
         // xor a random byte with a random value:
         if (!ssSend.empty()) {
-            CDataStream::size_type pos = GetRand(ssSend.size());
+            CPlainDataStream::size_type pos = GetRand(ssSend.size());
             ssSend[pos] ^= (unsigned char)(GetRand(256));
         }
         break;
     case 1:
         // delete a random byte:
         if (!ssSend.empty()) {
-            CDataStream::size_type pos = GetRand(ssSend.size());
+            CPlainDataStream::size_type pos = GetRand(ssSend.size());
             ssSend.erase(ssSend.begin()+pos);
         }
         break;
     case 2:
         // insert a random byte at a random position
         {
-            CDataStream::size_type pos = GetRand(ssSend.size());
+            CPlainDataStream::size_type pos = GetRand(ssSend.size());
             char ch = (char)GetRand(256);
             ssSend.insert(ssSend.begin()+pos, ch);
         }
@@ -2322,11 +2507,19 @@ bool CAddrDB::Read(CAddrMan& addr)
 
 unsigned int ReceiveFloodSize() { return 1000*GetArg("-maxreceivebuffer", 5*1000); }
 unsigned int SendBufferSize() { return 1000*GetArg("-maxsendbuffer", 1*1000); }
+size_t MaxRelayMemory() { return 1000000 * (size_t)std::max(GetArg("-maxrelaymemory", DEFAULT_MAX_RELAY_MEMORY), (int64_t)0); }
+
+int64_t PoissonNextSend(int64_t nNow, int nAverageIntervalSeconds)
+{
+    // the exponential distribution of the delays of a Poisson process, from a uniform number in (0, 1]
+    return nNow + (int64_t)(log1p(GetRand(1ULL << 48) * -0.0000000000000035527136788 /* -1/2^48 */) * nAverageIntervalSeconds * -1000000.0 + 0.5);
+}
 
 CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNameIn, bool fInboundIn, SSL *sslIn) :
     ssSend(SER_NETWORK, INIT_PROTO_VERSION),
     addrKnown(5000, 0.001),
-    setInventoryKnown(SendBufferSize() / 1000)
+    setInventoryKnown(SendBufferSize() / 1000),
+    filterInventoryTxKnown(INVENTORY_TX_KNOWN_SZ, 0.000001)
 {
     ssl = sslIn;
     nServices = 0;
@@ -2357,11 +2550,14 @@ CNode::CNode(SOCKET hSocketIn, const CAddress& addrIn, const std::string& addrNa
     fGetAddr = false;
     fRelayTxes = false;
     fSentAddr = false;
+    fSupportsCompactBlocks = false;
+    fPreferHeaderAndIDs = false;
     pfilter = new CBloomFilter();
     nPingNonceSent = 0;
     nPingUsecStart = 0;
     nPingUsecTime = 0;
     fPingQueued = false;
+    nNextInvSend = 0;
     nMinPingUsecTime = std::numeric_limits<int64_t>::max();
     m_addr_token_timestamp = GetTimeMicros();
 
@@ -2539,13 +2735,49 @@ void CNode::EndMessage() UNLOCK_FUNCTION(cs_vSend)
 
     LogPrint("net", "(%d bytes) peer=%d\n", nSize, id);
 
-    std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-    ssSend.GetAndClear(*it);
-    nSendSize += (*it).size();
+    // The serialized message is copied to the queue in a buffer of its size, ssSend keeps its capacity for the next one
+    std::shared_ptr<CPlainSerializeData> data = std::make_shared<CPlainSerializeData>();
+    data->reserve(ssSend.size());
+    ssSend.GetAndClear(*data);
+    bool fQueueEmpty = vSendMsg.empty();
+    vSendMsg.push_back(CSendBuffer(data));
+    nSendSize += data->size();
 
     // If write queue empty, attempt "optimistic write"
-    if (it == vSendMsg.begin())
+    if (fQueueEmpty)
         SocketSendData(this);
 
     LEAVE_CRITICAL_SECTION(cs_vSend);
 }
+
+void CSharedMessage::SetPayload(const CSendBuffer& payloadIn)
+{
+    payload = payloadIn;
+    uint256 hash = Hash(payload.pdata, payload.pdata + payload.nSize);
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+}
+
+void CNode::PushSharedMessage(const CSharedMessage& msg)
+{
+    LOCK(cs_vSend);
+
+    CMessageHeader hdr(Params().MessageStart(), msg.GetCommand(), msg.GetPayload().nSize);
+    std::shared_ptr<CPlainSerializeData> header = std::make_shared<CPlainSerializeData>();
+    SerializeAppend(*header, hdr, SER_NETWORK, ssSend.GetVersion());
+    unsigned int nChecksum = msg.GetChecksum();
+    memcpy(header->data() + CMessageHeader::CHECKSUM_OFFSET, &nChecksum, sizeof(nChecksum));
+
+    LogPrint("net", "sending: %s (%d bytes, shared) peer=%d\n", SanitizeString(msg.GetCommand()), msg.GetPayload().nSize, id);
+
+    bool fQueueEmpty = vSendMsg.empty();
+    vSendMsg.push_back(CSendBuffer(header));
+    nSendSize += header->size();
+    if (msg.GetPayload().nSize > 0) {
+        vSendMsg.push_back(msg.GetPayload());
+        nSendSize += msg.GetPayload().nSize;
+    }
+
+    // If write queue empty, attempt "optimistic write"
+    if (fQueueEmpty)
+        SocketSendData(this);
+}
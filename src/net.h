@@ -16,10 +16,12 @@
 #include "random.h"
 #include "streams.h"
 #include "sync.h"
+#include "txreconciliation.h"
 #include "uint256.h"
 #include "utilstrencodings.h"
 
 #include <deque>
+#include <memory>
 #include <stdint.h>
 
 #ifndef WIN32
@@ -77,9 +79,25 @@ static const size_t SETASKFOR_MAX_SZ = 2 * MAX_INV_SZ;
 static const size_t MAPRECEIVED_MAX_SZ = 8 * 120 * 100;
 /** The maximum number of peer connections to maintain. */
 static const unsigned int DEFAULT_MAX_PEER_CONNECTIONS = 125;
+/** The default number of threads processing the messages of the peers */
+static const int DEFAULT_MESSAGE_HANDLER_THREADS = 4;
+/** Maximum number of threads processing the messages of the peers */
+static const int MAX_MESSAGE_HANDLER_THREADS = 16;
+/** Average delay between the announcements of transactions to an inbound peer, in seconds (half for outbound peers) */
+static const int INVENTORY_BROADCAST_INTERVAL = 5;
+/** The maximum number of transactions waiting to be announced to a peer */
+static const size_t MAX_INVENTORY_TX_TO_SEND = MAX_INV_SZ;
+/** The transactions known to a peer, remembered to not announce them again */
+static const unsigned int INVENTORY_TX_KNOWN_SZ = 50000;
+/** The default bound of the serialized size of the transactions kept for the requests of the relayed ones, in megabytes */
+static const unsigned int DEFAULT_MAX_RELAY_MEMORY = 32;
 
 unsigned int ReceiveFloodSize();
 unsigned int SendBufferSize();
+size_t MaxRelayMemory();
+
+/** A random time after nNow (in microseconds) for an event happening every nAverageIntervalSeconds on average */
+int64_t PoissonNextSend(int64_t nNow, int nAverageIntervalSeconds);
 
 void AddOneShot(const std::string& strDest);
 void AddressCurrentlyConnected(const CService& addr);
@@ -174,8 +192,10 @@ extern int nMaxConnections;
 
 extern std::vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
-extern std::map<CInv, CDataStream> mapRelay;
+//! The relayed transactions and certificates, shared with the mempool entries, for the getdata of their announcements
+extern std::map<CInv, std::shared_ptr<const CTransactionBase> > mapRelay;
 extern std::deque<std::pair<int64_t, CInv> > vRelayExpiration;
+extern size_t nRelayBytes; //! the serialized size of the mapRelay entries
 extern CCriticalSection cs_mapRelay;
 extern LimitedMap<CInv, int64_t> mapAlreadyAskedFor;
 extern LimitedMap<CInv, int64_t> mapAlreadyReceived;
@@ -222,6 +242,10 @@ public:
     std::string addrLocal;
     uint64_t m_addr_rate_limited;
     uint64_t m_addr_processed;
+    bool fTxReconciliation;
+    bool fTxReconciliationFlood;
+    uint64_t nTxReconciliationRounds;
+    uint64_t nTxReconciliationShared;
 };
 
 
@@ -263,12 +287,79 @@ public:
 
     int readHeader(const char *pch, unsigned int nBytes);
     int readData(const char *pch, unsigned int nBytes);
+
+    /**
+     * Record the receipt of the complete message, and whether its data match the checksum of the header: the data
+     * are hashed as they arrive, by the thread reading the socket, for the message handler not to hash them
+     */
+    void SetComplete(int64_t nTimeIn);
+
+    //! Whether the checksum of the header matches the data, once complete
+    bool IsChecksumValid() const { return fChecksumValid; }
+    uint32_t GetChecksum() const { return nChecksum; }
+
+private:
+    CHash256 hasher;                // of the data received so far
+    uint32_t nChecksum = 0;         // of the data, once complete
+    bool fChecksumValid = false;
 };
 
 
 
 
 
+/**
+ * A part of the send queue of a peer. The bytes are kept alive by their owner, which may be shared with
+ * the send queues of other peers, or be the mapping of a block file.
+ */
+struct CSendBuffer
+{
+    std::shared_ptr<const void> owner;
+    const char* pdata;
+    size_t nSize;
+
+    CSendBuffer(std::shared_ptr<const void> ownerIn, const char* pdataIn, size_t nSizeIn) :
+        owner(ownerIn), pdata(pdataIn), nSize(nSizeIn) {}
+    explicit CSendBuffer(const std::shared_ptr<const CPlainSerializeData>& data) :
+        owner(data), pdata(data->data()), nSize(data->size()) {}
+};
+
+/**
+ * A message serialized once for all the peers it is sent to: its payload, and the checksum of it, are
+ * shared by their send queues, only the header is written for each peer (see CNode::PushSharedMessage).
+ * It fits the payloads serialized the same whatever the version of the peer, as blocks.
+ */
+class CSharedMessage
+{
+public:
+    template <typename T>
+    CSharedMessage(const char* pszCommandIn, const T& obj) : strCommand(pszCommandIn), payload(nullptr, nullptr, 0)
+    {
+        // sized once, a block does not go through the reallocations of a growing stream
+        std::shared_ptr<CPlainSerializeData> data = std::make_shared<CPlainSerializeData>();
+        SerializeAppend(*data, obj, SER_NETWORK, PROTOCOL_VERSION);
+        SetPayload(CSendBuffer(data));
+    }
+
+    //! The message of the bytes pdata, not copied, kept alive by owner
+    CSharedMessage(const char* pszCommandIn, std::shared_ptr<const void> owner, const char* pdata, size_t nSize) :
+        strCommand(pszCommandIn), payload(nullptr, nullptr, 0)
+    {
+        SetPayload(CSendBuffer(owner, pdata, nSize));
+    }
+
+    const char* GetCommand() const { return strCommand.c_str(); }
+    const CSendBuffer& GetPayload() const { return payload; }
+    unsigned int GetChecksum() const { return nChecksum; }
+
+private:
+    std::string strCommand;
+    CSendBuffer payload;
+    unsigned int nChecksum;
+
+    void SetPayload(const CSendBuffer& payloadIn);
+};
+
 /** Information about a peer */
 class CNode
 {
@@ -280,16 +371,17 @@ public:
     uint64_t nServices;
     SOCKET hSocket;
     CCriticalSection cs_hSocket;
-    CDataStream ssSend;
+    CPlainDataStream ssSend;
     size_t nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes;
-    std::deque<CSerializeData> vSendMsg;
+    std::deque<CSendBuffer> vSendMsg;
     CCriticalSection cs_vSend;
 
     std::deque<CInv> vRecvGetData;
     std::deque<CNetMessage> vRecvMsg;
     CCriticalSection cs_vRecvMsg;
+    CCriticalSection cs_messageHandler; // held by the message handler thread serving this node
     uint64_t nRecvBytes;
     int nRecvVersion;
 
@@ -320,6 +412,10 @@ public:
     //    until it has initialized its bloom filter.
     bool fRelayTxes;
     bool fSentAddr;
+    // The peer announced "sendcmpct": it serves compact blocks, and sends its new blocks as compact
+    // blocks straight away if fPreferHeaderAndIDs
+    bool fSupportsCompactBlocks;
+    bool fPreferHeaderAndIDs;
     CSemaphoreGrant grantOutbound;
     CCriticalSection cs_filter;
     CBloomFilter* pfilter;
@@ -362,7 +458,7 @@ public:
     uint256 hashContinue;
     int nStartingHeight;
 
-    // flood relay
+    // flood relay, guarded by cs_inventory as any message handler thread may push addresses
     std::vector<CAddress> vAddrToSend;
     CRollingBloomFilter addrKnown;
     bool fGetAddr;
@@ -371,6 +467,14 @@ public:
     // inventory based relay
     mruset<CInv> setInventoryKnown;
     std::vector<CInv> vInventoryToSend;
+    // The transactions (and certificates) are too many for setInventoryKnown: those known to the peer are
+    // in a rolling bloom filter, and they are announced in batches at random times, see SendMessages
+    CRollingBloomFilter filterInventoryTxKnown;
+    std::set<uint256> setInventoryTxToSend;
+    int64_t nNextInvSend;
+    // The transactions to announce to a peer negotiating "sendrecon" are reconciled rather than sent in
+    // setInventoryTxToSend, see txreconciliation.h
+    CTxReconciliationState txReconciliation;
     CCriticalSection cs_inventory;
     std::set<uint256> setAskFor;
     std::multimap<int64_t, CInv> mapAskFor;
@@ -447,6 +551,7 @@ public:
 
     void AddAddressKnown(const CAddress& addr)
     {
+        LOCK(cs_inventory);
         addrKnown.insert(addr.GetKey());
     }
 
@@ -455,6 +560,7 @@ public:
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
+        LOCK(cs_inventory);
         if (addr.IsValid() && !addrKnown.contains(addr.GetKey())) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand() % vAddrToSend.size()] = addr;
@@ -469,15 +575,34 @@ public:
     {
         {
             LOCK(cs_inventory);
-            setInventoryKnown.insert(inv);
+            if (inv.type == MSG_TX)
+                filterInventoryTxKnown.insert(inv.hash);
+            else
+                setInventoryKnown.insert(inv);
         }
     }
 
+    // requires LOCK(cs_inventory)
+    bool IsInventoryKnown(const CInv& inv) const
+    {
+        if (inv.type == MSG_TX)
+            return filterInventoryTxKnown.contains(inv.hash);
+        return setInventoryKnown.count(inv) > 0;
+    }
+
     void PushInventory(const CInv& inv)
     {
         {
             LOCK(cs_inventory);
-            if (!setInventoryKnown.count(inv))
+            if (inv.type == MSG_TX) {
+                // checked against filterInventoryTxKnown when sent, the peer may learn it in between
+                if (filterInventoryTxKnown.contains(inv.hash))
+                    return;
+                if (txReconciliation.fEnabled && !txReconciliation.fFlood && txReconciliation.Add(inv.hash))
+                    return;
+                if (setInventoryTxToSend.size() < MAX_INVENTORY_TX_TO_SEND)
+                    setInventoryTxToSend.insert(inv.hash);
+            } else if (!setInventoryKnown.count(inv))
                 vInventoryToSend.push_back(inv);
         }
     }
@@ -495,6 +620,9 @@ public:
 
     void PushVersion();
 
+    //! Queue msg, sharing its payload with the other peers it is sent to
+    void PushSharedMessage(const CSharedMessage& msg);
+
 
     void PushMessage(const char* pszCommand)
     {
@@ -711,7 +839,7 @@ class CTransaction;
 class CScCertificate;
 void Relay(const CTransaction& tx);
 void Relay(const CScCertificate& cert);
-void Relay(const CTransactionBase& tx, const CDataStream& ss);
+void Relay(const std::shared_ptr<const CTransactionBase>& txBase);
 
 /** Access to the (IP) address database (peers.dat) */
 class CAddrDB
@@ -0,0 +1,195 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "netcapture.h"
+
+#include "chainparams.h"
+#include "clientversion.h"
+#include "crypto/common.h"
+#include "hash.h"
+#include "init.h"
+#include "main.h"
+#include "net.h"
+#include "streams.h"
+#include "util.h"
+
+#include <string.h>
+
+static const uint32_t MESSAGE_CAPTURE_MAGIC = 0x7061637a; // "zcap"
+static const uint32_t MESSAGE_CAPTURE_VERSION = 1;
+
+CMessageCapture messageCapture;
+
+bool CMessageCapture::Open(const boost::filesystem::path& path)
+{
+    LOCK(cs);
+    if (file != nullptr)
+        return false;
+    file = fopen(path.string().c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << MESSAGE_CAPTURE_MAGIC << MESSAGE_CAPTURE_VERSION;
+    ss.write((const char*)Params().MessageStart(), MESSAGE_START_SIZE);
+    if (fwrite(&ss[0], 1, ss.size(), file) != ss.size()) {
+        fclose(file);
+        file = nullptr;
+        return false;
+    }
+    nRecorded = 0;
+    fOpen = true;
+    return true;
+}
+
+void CMessageCapture::Close()
+{
+    LOCK(cs);
+    if (file == nullptr)
+        return;
+    fOpen = false;
+    FileCommit(file);
+    fclose(file);
+    file = nullptr;
+    LogPrintf("%s: %u messages captured\n", __func__, nRecorded);
+}
+
+void CMessageCapture::Record(const CNode* pnode, const CNetMessage& msg)
+{
+    CCapturedMessage captured;
+    captured.nTime = msg.nTime;
+    captured.nPeer = pnode->GetId();
+    captured.fInbound = pnode->fInbound;
+    captured.strCommand = msg.hdr.GetCommand();
+    captured.vPayload.assign(msg.vRecv.begin(), msg.vRecv.begin() + msg.hdr.nMessageSize);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss.reserve(captured.vPayload.size() + 64);
+    ss << captured;
+
+    LOCK(cs);
+    if (file == nullptr)
+        return;
+    if (fwrite(&ss[0], 1, ss.size(), file) != ss.size()) {
+        LogPrintf("%s: failed to write to the capture file, no more messages are captured\n", __func__);
+        fOpen = false;
+        fclose(file);
+        file = nullptr;
+        return;
+    }
+    nRecorded++;
+}
+
+uint64_t CMessageCapture::GetRecorded() const
+{
+    LOCK(cs);
+    return nRecorded;
+}
+
+//! The replies of a replayed peer go nowhere, they are dropped for the processing not to wait for the send buffer
+static void DiscardSendQueue(CNode* pnode)
+{
+    LOCK(pnode->cs_vSend);
+    pnode->vSendMsg.clear();
+    pnode->nSendSize = 0;
+    pnode->nSendOffset = 0;
+}
+
+bool ReplayCapturedMessages(const boost::filesystem::path& path, CReplayStats& stats, std::string& strError)
+{
+    if (messageCapture.IsOpen()) {
+        strError = "the node is capturing messages";
+        return false;
+    }
+
+    CAutoFile file(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        strError = strprintf("can not open %s", path.string());
+        return false;
+    }
+    try {
+        uint32_t nMagic = 0;
+        uint32_t nVersion = 0;
+        unsigned char pchMessageStart[MESSAGE_START_SIZE];
+        file >> nMagic >> nVersion;
+        file.read((char*)pchMessageStart, MESSAGE_START_SIZE);
+        if (nMagic != MESSAGE_CAPTURE_MAGIC || nVersion != MESSAGE_CAPTURE_VERSION) {
+            strError = strprintf("%s is not a message capture", path.string());
+            return false;
+        }
+        if (memcmp(pchMessageStart, Params().MessageStart(), MESSAGE_START_SIZE) != 0) {
+            strError = "the messages were captured on another network";
+            return false;
+        }
+    } catch (const std::exception&) {
+        strError = strprintf("%s is not a message capture", path.string());
+        return false;
+    }
+
+    const bool fWasProfiling = fLockProfile.exchange(true);
+    GetLockStats(true);
+
+    std::map<int32_t, CNode*> mapPeers;
+    const CAddress addrReplay(CService("127.0.0.1", Params().GetDefaultPort()));
+    while (!ShutdownRequested()) {
+        CCapturedMessage captured;
+        try {
+            file >> captured;
+        } catch (const std::ios_base::failure&) {
+            // the end of the file, or the record cut when the capturing node stopped
+            break;
+        }
+
+        CNode*& pnode = mapPeers[captured.nPeer];
+        if (pnode == nullptr) {
+            pnode = new CNode(INVALID_SOCKET, addrReplay, strprintf("replay-%d", captured.nPeer), captured.fInbound);
+            if (captured.strCommand != "version") {
+                // the capture started after the handshake with this peer
+                pnode->nVersion = PROTOCOL_VERSION;
+                pnode->SetRecvVersion(PROTOCOL_VERSION);
+                pnode->fSuccessfullyConnected = true;
+            }
+        }
+        if (pnode->fDisconnect) {
+            stats.nSkipped++;
+            continue;
+        }
+
+        CNetMessage msg(Params().MessageStart(), SER_NETWORK, pnode->nRecvVersion);
+        msg.hdr = CMessageHeader(Params().MessageStart(), captured.strCommand.c_str(), captured.vPayload.size());
+        uint256 hash = Hash(captured.vPayload.begin(), captured.vPayload.end());
+        msg.hdr.nChecksum = ReadLE32(hash.begin());
+        msg.in_data = true;
+        if (!captured.vPayload.empty())
+            msg.readData((const char*)&captured.vPayload[0], captured.vPayload.size());
+        // the checksum is verified as a socket thread would, out of the time of the processing
+        msg.SetComplete(GetTimeMicros());
+
+        const int64_t nStart = GetTimeMicros();
+        msg.nTime = nStart;
+        {
+            LOCK(pnode->cs_vRecvMsg);
+            pnode->vRecvMsg.push_back(msg);
+            // one message by call, the answers to a getdata may take a few more
+            while (!pnode->fDisconnect && (!pnode->vRecvMsg.empty() || !pnode->vRecvGetData.empty())) {
+                if (!ProcessMessages(pnode))
+                    pnode->fDisconnect = true;
+                DiscardSendQueue(pnode);
+            }
+        }
+        const int64_t nElapsed = GetTimeMicros() - nStart;
+        stats.nMessages++;
+        stats.nMicros += nElapsed;
+        stats.mapLatencies[captured.strCommand].push_back(nElapsed);
+    }
+
+    stats.vLockStats = GetLockStats(false);
+    if (!fWasProfiling)
+        fLockProfile = false;
+
+    stats.nPeers = mapPeers.size();
+    for (const std::pair<const int32_t, CNode*>& peer : mapPeers)
+        delete peer.second;
+    return true;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NETCAPTURE_H
+#define BITCOIN_NETCAPTURE_H
+
+#include "protocol.h"
+#include "serialize.h"
+#include "sync.h"
+
+#include <atomic>
+#include <map>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <boost/filesystem/path.hpp>
+
+class CNetMessage;
+class CNode;
+
+/** A message received from a peer, as recorded by -capturemessages */
+struct CCapturedMessage
+{
+    int64_t nTime = 0;    //!< of receipt, in microseconds
+    int32_t nPeer = 0;    //!< the id of the peer in the capturing node
+    bool fInbound = false;
+    std::string strCommand;
+    std::vector<unsigned char> vPayload;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(nTime);
+        READWRITE(nPeer);
+        READWRITE(fInbound);
+        READWRITE(LIMITED_STRING(strCommand, CMessageHeader::COMMAND_SIZE));
+        READWRITE(vPayload);
+    }
+};
+
+/**
+ * Records the messages the peers send, once their checksum verified, in the order they are processed, to a file
+ * ReplayCapturedMessages feeds again to the message processing of a node, a copy of the capturing one's data
+ * directory typically: the benchmarks of a release then run on the traffic of a production node.
+ *
+ * The file starts with a magic, a format version and the message start of the network, then has the messages.
+ */
+class CMessageCapture
+{
+public:
+    ~CMessageCapture() { Close(); }
+
+    bool Open(const boost::filesystem::path& path);
+    void Close();
+    bool IsOpen() const { return fOpen.load(std::memory_order_relaxed); }
+
+    void Record(const CNode* pnode, const CNetMessage& msg);
+
+    //! The messages recorded since the file was opened
+    uint64_t GetRecorded() const;
+
+private:
+    mutable CCriticalSection cs;
+    FILE* file = nullptr;
+    std::atomic<bool> fOpen{false};
+    uint64_t nRecorded = 0;
+};
+
+extern CMessageCapture messageCapture;
+
+/** What replaying the messages of a capture measured */
+struct CReplayStats
+{
+    uint64_t nMessages = 0;
+    //! of the peers disconnected during the replay, dropped
+    uint64_t nSkipped = 0;
+    size_t nPeers = 0;
+    //! processing the messages
+    int64_t nMicros = 0;
+    //! the time processing each message, by command
+    std::map<std::string, std::vector<int64_t> > mapLatencies;
+    //! the lock waits during the replay, which profiles the locks
+    std::vector<LockSiteStats> vLockStats;
+};
+
+/**
+ * Feed the messages of a capture file to ProcessMessages, as fast as they are processed, each peer of the capture by
+ * a node of its own, whose replies are discarded. The peers the capture started after the handshake of are taken as
+ * connected. The chain state and the mempool of the node change as they would have with the peers.
+ */
+bool ReplayCapturedMessages(const boost::filesystem::path& path, CReplayStats& stats, std::string& strError);
+
+#endif // BITCOIN_NETCAPTURE_H
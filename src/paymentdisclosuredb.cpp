@@ -9,6 +9,8 @@
 
 #include <boost/filesystem.hpp>
 
+#include <leveldb/write_batch.h>
+
 using namespace std;
 
 static boost::filesystem::path emptyPath;
@@ -26,8 +28,32 @@ shared_ptr<PaymentDisclosureDB> PaymentDisclosureDB::sharedInstance() {
 PaymentDisclosureDB::PaymentDisclosureDB() : PaymentDisclosureDB(emptyPath) {
 }
 
-PaymentDisclosureDB::PaymentDisclosureDB(const boost::filesystem::path& dbPath) {
-    boost::filesystem::path path(dbPath);
+PaymentDisclosureDB::PaymentDisclosureDB(const boost::filesystem::path& dbPath) : path_(dbPath) {
+    options.create_if_missing = true;
+}
+
+PaymentDisclosureDB::~PaymentDisclosureDB() {
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+
+    if (db != nullptr) {
+        delete db;
+    }
+}
+
+void PaymentDisclosureDB::Open()
+{
+    if (db != nullptr) {
+        return;
+    }
+
+    boost::filesystem::path path(path_);
     if (path.empty()) {
         path = GetDataDir() / "paymentdisclosure";
         LogPrintf("PaymentDisclosure: using default path for database: %s\n", path.string());
@@ -36,44 +62,120 @@ PaymentDisclosureDB::PaymentDisclosureDB(const boost::filesystem::path& dbPath)
     }
 
     TryCreateDirectory(path);
-    options.create_if_missing = true;
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &db);
     HandleError(status); // throws exception
     LogPrintf("PaymentDisclosure: Opened LevelDB successfully\n");
 }
 
-PaymentDisclosureDB::~PaymentDisclosureDB() {
-    if (db != nullptr) {
-        delete db;
-    }
+bool PaymentDisclosureDB::Put(const PaymentDisclosureKey& key, const PaymentDisclosureInfo& info)
+{
+    return PutBatch(std::vector<PaymentDisclosureKeyInfo>(1, PaymentDisclosureKeyInfo(key, info)));
 }
 
-bool PaymentDisclosureDB::Put(const PaymentDisclosureKey& key, const PaymentDisclosureInfo& info)
+bool PaymentDisclosureDB::PutBatch(const std::vector<PaymentDisclosureKeyInfo>& entries)
 {
-    if (db == nullptr) {
-        return false;
+    std::unique_lock<std::mutex> guard(lock_);
+    Open();
+    WriteBatch(entries);
+    return true;
+}
+
+void PaymentDisclosureDB::WriteBatch(const std::vector<PaymentDisclosureKeyInfo>& entries, std::unique_lock<std::mutex>* unlock)
+{
+    leveldb::WriteBatch batch;
+    for (const PaymentDisclosureKeyInfo& entry : entries) {
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue.reserve(ssValue.GetSerializeSize(entry.second));
+        ssValue << entry.second;
+        batch.Put(entry.first.ToString(), leveldb::Slice(&ssValue[0], ssValue.size()));
     }
 
-    std::lock_guard<std::mutex> guard(lock_);
+    if (unlock != nullptr) {
+        // the database is safe for concurrent use, the lock only guards the pointer, set once
+        unlock->unlock();
+    }
+    leveldb::Status status = db->Write(writeOptions, &batch);
+    if (unlock != nullptr) {
+        unlock->lock();
+    }
+    HandleError(status);
+}
 
-    CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-    ssValue.reserve(ssValue.GetSerializeSize(info));
-    ssValue << info;
-    leveldb::Slice slice(&ssValue[0], ssValue.size());
+void PaymentDisclosureDB::PutBatchAsync(const std::vector<PaymentDisclosureKeyInfo>& entries)
+{
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        for (const PaymentDisclosureKeyInfo& entry : entries) {
+            pending_[entry.first.ToString()] = entry.second;
+            queue_.push_back(entry);
+        }
+        if (!writer_.joinable()) {
+            writer_ = std::thread(&PaymentDisclosureDB::ThreadWrite, this);
+        }
+    }
+    cond_.notify_all();
+}
 
-    leveldb::Status status = db->Put(writeOptions, key.ToString(), slice);
-    HandleError(status);
-    return true;
+bool PaymentDisclosureDB::Flush()
+{
+    std::unique_lock<std::mutex> guard(lock_);
+    while (!queue_.empty() || writing_) {
+        cond_.wait(guard);
+    }
+    bool ret = !writeFailed_;
+    writeFailed_ = false;
+    return ret;
 }
 
-bool PaymentDisclosureDB::Get(const PaymentDisclosureKey& key, PaymentDisclosureInfo& info)
+void PaymentDisclosureDB::ThreadWrite()
 {
-    if (db == nullptr) {
-        return false;
+    RenameThread("horizen-paydisc");
+
+    std::unique_lock<std::mutex> guard(lock_);
+    while (true) {
+        while (queue_.empty() && !stop_) {
+            cond_.wait(guard);
+        }
+        if (queue_.empty()) {
+            break;
+        }
+
+        std::vector<PaymentDisclosureKeyInfo> entries;
+        entries.swap(queue_);
+        writing_ = true;
+        try {
+            Open();
+            WriteBatch(entries, &guard);
+            LogPrint("paymentdisclosure", "PaymentDisclosure: wrote %u entries\n", entries.size());
+        } catch (const std::exception& e) {
+            LogPrintf("PaymentDisclosure: could not write %u entries: %s\n", entries.size(), e.what());
+            writeFailed_ = true;
+        }
+        writing_ = false;
+
+        // the entries queued again meanwhile, with other infos, are still pending
+        for (const PaymentDisclosureKeyInfo& entry : entries) {
+            std::map<std::string, PaymentDisclosureInfo>::iterator it = pending_.find(entry.first.ToString());
+            if (it != pending_.end() && it->second == entry.second) {
+                pending_.erase(it);
+            }
+        }
+        cond_.notify_all();
     }
+}
 
+bool PaymentDisclosureDB::Get(const PaymentDisclosureKey& key, PaymentDisclosureInfo& info)
+{
     std::lock_guard<std::mutex> guard(lock_);
 
+    std::map<std::string, PaymentDisclosureInfo>::const_iterator itPending = pending_.find(key.ToString());
+    if (itPending != pending_.end()) {
+        info = itPending->second;
+        return true;
+    }
+
+    Open();
+
     std::string strValue;
     leveldb::Status status = db->Get(readOptions, key.ToString(), &strValue);
     if (!status.ok()) {
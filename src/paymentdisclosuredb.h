@@ -7,17 +7,28 @@
 
 #include "paymentdisclosure.h"
 
+#include <condition_variable>
 #include <cstdint>
+#include <map>
 #include <string>
 #include <mutex>
 #include <future>
 #include <memory>
+#include <thread>
+#include <vector>
 
+#include <boost/filesystem/path.hpp>
 #include <boost/optional.hpp>
 
 #include <leveldb/db.h>
 
 
+/**
+ * The payment disclosure database, opened on the first access.
+ *
+ * The entries of an operation are written in one batch, and can be handed to a writer thread, started
+ * on the first such batch, for the send not to wait for the database: Get finds them meanwhile.
+ */
 class PaymentDisclosureDB
 {
 protected:
@@ -27,15 +38,44 @@ protected:
     leveldb::WriteOptions writeOptions;
     mutable std::mutex lock_;
 
+    //! Open the database if not yet, throwing on failure. lock_ is held
+    void Open();
+
 public:
     static std::shared_ptr<PaymentDisclosureDB> sharedInstance();
 
     PaymentDisclosureDB();
     PaymentDisclosureDB(const boost::filesystem::path& dbPath);
+    //! Writes the batches still queued
     ~PaymentDisclosureDB();
 
     bool Put(const PaymentDisclosureKey& key, const PaymentDisclosureInfo& info);
     bool Get(const PaymentDisclosureKey& key, PaymentDisclosureInfo& info);
+
+    //! Write the entries in a single batch
+    bool PutBatch(const std::vector<PaymentDisclosureKeyInfo>& entries);
+
+    //! Queue the entries to the writer thread, to be written in a single batch
+    void PutBatchAsync(const std::vector<PaymentDisclosureKeyInfo>& entries);
+
+    //! Wait for the entries queued to be written, false if some could not be
+    bool Flush();
+
+private:
+    boost::filesystem::path path_;
+
+    //! The entries queued or being written, by key, for Get
+    std::map<std::string, PaymentDisclosureInfo> pending_;
+    std::vector<PaymentDisclosureKeyInfo> queue_;
+    bool writing_ = false;
+    bool stop_ = false;
+    bool writeFailed_ = false;
+    std::condition_variable cond_;
+    std::thread writer_;
+
+    //! Write the entries, in a batch; lock_ is held, and released while writing if unlock is given
+    void WriteBatch(const std::vector<PaymentDisclosureKeyInfo>& entries, std::unique_lock<std::mutex>* unlock = nullptr);
+    void ThreadWrite();
 };
 
 
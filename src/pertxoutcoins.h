@@ -0,0 +1,124 @@
+#ifndef BITCOIN_PERTXOUTCOINS_H
+#define BITCOIN_PERTXOUTCOINS_H
+
+#include "coins.h"
+#include "serialize.h"
+#include "uint256.h"
+
+/**
+ * Records of the per-output layout of the chainstate database. Every unspent output is stored
+ * under its own CCoinsOutputKey, while the attributes shared by the outputs of a transaction or
+ * certificate are stored once in a CCoinsHeader keyed by txid. Spending an output then only
+ * deletes its own record instead of rewriting the whole CCoins.
+ */
+struct CCoinsOutputKey {
+    uint256 txid;
+    uint32_t n;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 36;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        txid.Serialize(s, nType, nVersion);
+        // Positions are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, n);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        txid.Unserialize(s, nType, nVersion);
+        n = ser_readdata32be(s);
+    }
+
+    CCoinsOutputKey(const uint256& id, uint32_t pos) {
+        txid = id;
+        n = pos;
+    }
+
+    CCoinsOutputKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        txid.SetNull();
+        n = 0;
+    }
+};
+
+/** The creation heights sharing a bucket of the height-bucketed layout */
+static const int COINS_HEIGHT_BUCKET_SIZE = 1000;
+
+inline uint32_t CoinsHeightBucket(int nHeight) {
+    return nHeight > 0 ? nHeight / COINS_HEIGHT_BUCKET_SIZE : 0;
+}
+
+/**
+ * Key of an output in the height-bucketed variant of the per-output layout. The outputs are prefixed
+ * by the bucket of the creation height of their transaction or certificate, so that the outputs a block
+ * writes, and the recent ones blocks mostly spend, are in a narrow range of the database instead of
+ * being spread by the txid over all of it. The header, still keyed by txid, tells the bucket.
+ */
+struct CCoinsBucketOutputKey {
+    uint32_t nBucket;
+    CCoinsOutputKey output;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 40;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        // Big-endian as the positions, the buckets are sorted by height
+        ser_writedata32be(s, nBucket);
+        output.Serialize(s, nType, nVersion);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        nBucket = ser_readdata32be(s);
+        output.Unserialize(s, nType, nVersion);
+    }
+
+    CCoinsBucketOutputKey(uint32_t nBucketIn, const uint256& id, uint32_t pos): nBucket(nBucketIn), output(id, pos) {}
+
+    CCoinsBucketOutputKey(): nBucket(0) {}
+};
+
+/** CCoins attributes not bound to a single output. nOutputs is the size of the vout vector. */
+struct CCoinsHeader {
+    bool fCoinBase;
+    int nVersion;
+    int nHeight;
+    int nFirstBwtPos;
+    int nBwtMaturityHeight;
+    unsigned int nOutputs;
+
+    CCoinsHeader(): fCoinBase(false), nVersion(0), nHeight(0),
+        nFirstBwtPos(BWT_POS_UNSET), nBwtMaturityHeight(0), nOutputs(0) {}
+
+    explicit CCoinsHeader(const CCoins& coins): fCoinBase(coins.fCoinBase), nVersion(coins.nVersion),
+        nHeight(coins.nHeight), nFirstBwtPos(coins.nFirstBwtPos), nBwtMaturityHeight(coins.nBwtMaturityHeight),
+        nOutputs(coins.vout.size()) {}
+
+    /** Fill the attributes of coins and resize its outputs, leaving all of them spent. */
+    void ToCoins(CCoins& coins) const {
+        coins.fCoinBase = fCoinBase;
+        coins.nVersion = nVersion;
+        coins.nHeight = nHeight;
+        coins.nFirstBwtPos = nFirstBwtPos;
+        coins.nBwtMaturityHeight = nBwtMaturityHeight;
+        coins.vout.assign(nOutputs, CTxOut());
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(VARINT(this->nVersion));
+        READWRITE(fCoinBase);
+        READWRITE(VARINT(nHeight));
+        READWRITE(VARINT(nOutputs));
+        READWRITE(nFirstBwtPos);
+        READWRITE(nBwtMaturityHeight);
+    }
+};
+
+#endif // BITCOIN_PERTXOUTCOINS_H
@@ -325,6 +325,9 @@ CBlockPolicyEstimator::CBlockPolicyEstimator(const CFeeRate& _minRelayFee)
     }
     priStats.Initialize(vprilist, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY, "Priority");
 
+    certFeeStats.Initialize(vfeelist, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY, "CertFeeRate");
+    scTxFeeStats.Initialize(vfeelist, MAX_BLOCK_CONFIRMS, DEFAULT_DECAY, "ScTxFeeRate");
+
     feeUnlikely = CFeeRate(0);
     feeLikely = CFeeRate(INF_FEERATE);
     priUnlikely = 0;
@@ -349,6 +352,19 @@ bool CBlockPolicyEstimator::isPriDataPoint(const CFeeRate &fee, double pri)
     return false;
 }
 
+bool CBlockPolicyEstimator::IsScTxDataPoint(const CTxMemPoolEntry& entry)
+{
+    return !entry.GetTx().GetVftCcOut().empty() || !entry.GetTx().GetVBwtRequestOut().empty();
+}
+
+void CBlockPolicyEstimator::TrackEntry(const uint256& hash, unsigned int nHeight, TxConfirmStats& stats, double val)
+{
+    TxStatsInfo& info = mapMemPoolTxs[hash];
+    info.blockHeight = nHeight;
+    info.stats = &stats;
+    info.bucketIndex = stats.NewTx(nHeight, val);
+}
+
 void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, bool fCurrentEstimate)
 {
     unsigned int txHeight = entry.GetHeight();
@@ -380,6 +396,16 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     // Fees are stored and reported as BTC-per-kb:
     CFeeRate feeRate(entry.GetFee(), entry.GetTxSize());
 
+    if (IsScTxDataPoint(entry)) {
+        LogPrint("estimatefee", "Blockpolicy mempool sc tx %s ", hash.ToString().substr(0,10));
+        if (feeRate >= minTrackedFee)
+            TrackEntry(hash, txHeight, scTxFeeStats, (double)feeRate.GetFeePerK());
+        else
+            LogPrint("estimatefee", "not adding");
+        LogPrint("estimatefee", "\n");
+        return;
+    }
+
     // Want the priority of the tx at confirmation. However we don't know
     // what that will be and its too hard to continue updating it
     // so use starting priority as a proxy
@@ -426,6 +452,12 @@ void CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
     // Fees are stored and reported as BTC-per-kb:
     CFeeRate feeRate(entry.GetFee(), entry.GetTxSize());
 
+    if (IsScTxDataPoint(entry)) {
+        if (feeRate >= minTrackedFee)
+            scTxFeeStats.Record(blocksToConfirm, (double)feeRate.GetFeePerK());
+        return;
+    }
+
     // Want the priority of the tx at confirmation.  The priority when it
     // entered the mempool could easily be very small and change quickly
     double curPri = entry.GetPriority(nBlockHeight);
@@ -440,8 +472,52 @@ void CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
     }
 }
 
+void CBlockPolicyEstimator::processCertificate(const CCertificateMemPoolEntry& entry, bool fCurrentEstimate)
+{
+    unsigned int certHeight = entry.GetHeight();
+    uint256 hash = entry.GetCertificate().GetHash();
+    if (mapMemPoolTxs[hash].stats != NULL) {
+        LogPrint("estimatefee", "Blockpolicy error mempool cert %s already being tracked\n",
+                 hash.ToString().c_str());
+        return;
+    }
+
+    // Same as for transactions, ignore side chains and re-orgs and wait for the blockchain to be synced
+    if (certHeight < nBestSeenHeight || !fCurrentEstimate)
+        return;
+
+    CFeeRate feeRate(entry.GetFee(), entry.GetCertificateSize());
+
+    LogPrint("estimatefee", "Blockpolicy mempool cert %s ", hash.ToString().substr(0,10));
+    if (feeRate >= minTrackedFee)
+        TrackEntry(hash, certHeight, certFeeStats, (double)feeRate.GetFeePerK());
+    else
+        LogPrint("estimatefee", "not adding");
+    LogPrint("estimatefee", "\n");
+}
+
+void CBlockPolicyEstimator::processBlockCertificate(unsigned int nBlockHeight, const CCertificateMemPoolEntry& entry)
+{
+    int blocksToConfirm = nBlockHeight - entry.GetHeight();
+    if (blocksToConfirm <= 0) {
+        LogPrint("estimatefee", "Blockpolicy error Certificate had negative blocksToConfirm\n");
+        return;
+    }
+
+    CFeeRate feeRate(entry.GetFee(), entry.GetCertificateSize());
+    if (feeRate >= minTrackedFee)
+        certFeeStats.Record(blocksToConfirm, (double)feeRate.GetFeePerK());
+}
+
 void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
                                          std::vector<CTxMemPoolEntry>& entries, bool fCurrentEstimate)
+{
+    std::vector<CCertificateMemPoolEntry> certEntries;
+    processBlock(nBlockHeight, entries, certEntries, fCurrentEstimate);
+}
+
+void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight, std::vector<CTxMemPoolEntry>& entries,
+                                         std::vector<CCertificateMemPoolEntry>& certEntries, bool fCurrentEstimate)
 {
     if (nBlockHeight <= nBestSeenHeight) {
         // Ignore side chains and re-orgs; assuming they are random
@@ -485,26 +561,32 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     // Clear the current block states
     feeStats.ClearCurrent(nBlockHeight);
     priStats.ClearCurrent(nBlockHeight);
+    certFeeStats.ClearCurrent(nBlockHeight);
+    scTxFeeStats.ClearCurrent(nBlockHeight);
 
     // Repopulate the current block states
     for (unsigned int i = 0; i < entries.size(); i++)
         processBlockTx(nBlockHeight, entries[i]);
+    for (unsigned int i = 0; i < certEntries.size(); i++)
+        processBlockCertificate(nBlockHeight, certEntries[i]);
 
     // Update all exponential averages with the current block states
     feeStats.UpdateMovingAverages();
     priStats.UpdateMovingAverages();
+    certFeeStats.UpdateMovingAverages();
+    scTxFeeStats.UpdateMovingAverages();
 
     LogPrint("estimatefee", "Blockpolicy after updating estimates for %u confirmed entries, new mempool map size %u\n",
-             entries.size(), mapMemPoolTxs.size());
+             entries.size() + certEntries.size(), mapMemPoolTxs.size());
 }
 
-CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget)
+CFeeRate CBlockPolicyEstimator::EstimateFeeWith(TxConfirmStats& stats, int confTarget)
 {
     // Return failure if trying to analyze a target we're not tracking
-    if (confTarget <= 0 || (unsigned int)confTarget > feeStats.GetMaxConfirms())
+    if (confTarget <= 0 || (unsigned int)confTarget > stats.GetMaxConfirms())
         return CFeeRate(0);
 
-    double median = feeStats.EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, MIN_SUCCESS_PCT, true, nBestSeenHeight);
+    double median = stats.EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, MIN_SUCCESS_PCT, true, nBestSeenHeight);
 
     if (median < 0)
         return CFeeRate(0);
@@ -512,6 +594,11 @@ CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget)
     return CFeeRate(median);
 }
 
+CFeeRate CBlockPolicyEstimator::estimateFee(int confTarget)
+{
+    return EstimateFeeWith(feeStats, confTarget);
+}
+
 double CBlockPolicyEstimator::estimatePriority(int confTarget)
 {
     // Return failure if trying to analyze a target we're not tracking
@@ -521,11 +608,23 @@ double CBlockPolicyEstimator::estimatePriority(int confTarget)
     return priStats.EstimateMedianVal(confTarget, SUFFICIENT_PRITXS, MIN_SUCCESS_PCT, true, nBestSeenHeight);
 }
 
+CFeeRate CBlockPolicyEstimator::estimateCertificateFee(int confTarget)
+{
+    return EstimateFeeWith(certFeeStats, confTarget);
+}
+
+CFeeRate CBlockPolicyEstimator::estimateScTxFee(int confTarget)
+{
+    return EstimateFeeWith(scTxFeeStats, confTarget);
+}
+
 void CBlockPolicyEstimator::Write(CAutoFile& fileout)
 {
     fileout << nBestSeenHeight;
     feeStats.Write(fileout);
     priStats.Write(fileout);
+    certFeeStats.Write(fileout);
+    scTxFeeStats.Write(fileout);
 }
 
 void CBlockPolicyEstimator::Read(CAutoFile& filein)
@@ -535,4 +634,13 @@ void CBlockPolicyEstimator::Read(CAutoFile& filein)
     feeStats.Read(filein);
     priStats.Read(filein);
     nBestSeenHeight = nFileBestSeenHeight;
+
+    // Files written before certificates and sidechain txes had their own stats end here
+    try {
+        certFeeStats.Read(filein);
+        scTxFeeStats.Read(filein);
+    }
+    catch (const std::exception&) {
+        LogPrint("estimatefee", "Blockpolicy no certificate and sidechain tx estimates in file\n");
+    }
 }
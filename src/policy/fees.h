@@ -15,6 +15,7 @@
 class CAutoFile;
 class CFeeRate;
 class CTxMemPoolEntry;
+class CCertificateMemPoolEntry;
 
 /** \class CBlockPolicyEstimator
  * The BlockPolicyEstimator is used for estimating the fee or priority needed
@@ -64,6 +65,12 @@ class CTxMemPoolEntry;
  * the number of transactions we've seen in that fee bucket when calculating
  * an estimate for any number of confirmations below the number of blocks
  * they've been outstanding.
+ *
+ * Certificates and transactions carrying forward transfers or backward transfer
+ * requests are tracked by fee in their own buckets, since their inclusion does
+ * not follow the one of plain transactions: certificates are mined first, and
+ * sidechain transactions drop out of the mempool when the sidechain fees change.
+ * They are not used for the plain fee and priority estimates.
  */
 
 /** Decay of .998 is a half-life of 346 blocks or about 2.4 days */
@@ -227,16 +234,24 @@ public:
     /** Create new BlockPolicyEstimator and initialize stats tracking classes with default values */
     CBlockPolicyEstimator(const CFeeRate& minRelayFee);
 
-    /** Process all the transactions that have been included in a block */
+    /** Process all the transactions and certificates that have been included in a block */
     void processBlock(unsigned int nBlockHeight,
                       std::vector<CTxMemPoolEntry>& entries, bool fCurrentEstimate);
+    void processBlock(unsigned int nBlockHeight, std::vector<CTxMemPoolEntry>& entries,
+                      std::vector<CCertificateMemPoolEntry>& certEntries, bool fCurrentEstimate);
 
     /** Process a transaction confirmed in a block*/
     void processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry& entry);
 
+    /** Process a certificate confirmed in a block*/
+    void processBlockCertificate(unsigned int nBlockHeight, const CCertificateMemPoolEntry& entry);
+
     /** Process a transaction accepted to the mempool*/
     void processTransaction(const CTxMemPoolEntry& entry, bool fCurrentEstimate);
 
+    /** Process a certificate accepted to the mempool*/
+    void processCertificate(const CCertificateMemPoolEntry& entry, bool fCurrentEstimate);
+
     /** Remove a transaction from the mempool tracking stats*/
     void removeTx(uint256 hash);
 
@@ -252,6 +267,12 @@ public:
     /** Return a priority estimate */
     double estimatePriority(int confTarget);
 
+    /** Return a fee estimate for a certificate */
+    CFeeRate estimateCertificateFee(int confTarget);
+
+    /** Return a fee estimate for a transaction with forward transfers or backward transfer requests */
+    CFeeRate estimateScTxFee(int confTarget);
+
     /** Write estimation data to a file */
     void Write(CAutoFile& fileout);
 
@@ -276,6 +297,17 @@ private:
     /** Classes to track historical data on transaction confirmations */
     TxConfirmStats feeStats, priStats;
 
+    /** ... and on the ones of certificates and of transactions to sidechains, by fee */
+    TxConfirmStats certFeeStats, scTxFeeStats;
+
+    /** Whether a transaction is tracked in scTxFeeStats */
+    static bool IsScTxDataPoint(const CTxMemPoolEntry& entry);
+
+    /** Start tracking an entry of the mempool in the given stats */
+    void TrackEntry(const uint256& hash, unsigned int nHeight, TxConfirmStats& stats, double val);
+
+    CFeeRate EstimateFeeWith(TxConfirmStats& stats, int confTarget);
+
     /** Breakpoints to help determine whether a transaction was confirmed by priority or Fee */
     CFeeRate feeLikely, feeUnlikely;
     double priLikely, priUnlikely;
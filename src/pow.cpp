@@ -10,14 +10,73 @@
 #include "arith_uint256.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "checkqueue.h"
 #include "crypto/equihash.h"
 #include "primitives/block.h"
 #include "streams.h"
 #include "uint256.h"
 #include "util.h"
 #include <metrics.h>
+#include "random.h"
 #include "sodium.h"
 
+#include <set>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+namespace {
+
+//! A valid Equihash solution: the hash of its block, and the Equihash parameters (n, k) it is valid for
+typedef std::pair<uint256, unsigned int> EquihashCacheEntry;
+
+std::set<EquihashCacheEntry> setValidEquihash;
+boost::shared_mutex cs_equihashcache;
+
+EquihashCacheEntry GetEquihashCacheEntry(const CBlockHeader* pblock, const CChainParams& params)
+{
+    return EquihashCacheEntry(pblock->GetHash(), (params.EquihashN() << 16) | params.EquihashK());
+}
+
+bool IsEquihashCached(const EquihashCacheEntry& entry)
+{
+    boost::shared_lock<boost::shared_mutex> lock(cs_equihashcache);
+    return setValidEquihash.count(entry) > 0;
+}
+
+void AddEquihashCache(const EquihashCacheEntry& entry)
+{
+    boost::unique_lock<boost::shared_mutex> lock(cs_equihashcache);
+    while (setValidEquihash.size() >= MAX_EQUIHASH_CACHE_SIZE)
+    {
+        // Evict a random entry, as done by the proof verification cache.
+        std::set<EquihashCacheEntry>::iterator it = setValidEquihash.lower_bound(EquihashCacheEntry(GetRandHash(), 0));
+        if (it == setValidEquihash.end())
+            it = setValidEquihash.begin();
+        setValidEquihash.erase(it);
+    }
+    setValidEquihash.insert(entry);
+}
+
+//! Check the solution, without the cache
+bool VerifyEquihashSolution(const CBlockHeader *pblock, const CChainParams& params)
+{
+    unsigned int n = params.EquihashN();
+    unsigned int k = params.EquihashK();
+
+    // I = the block header minus nonce and solution.
+    CEquihashInput I{*pblock};
+    // I||V
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << I;
+    ss << pblock->nNonce;
+
+    // H(I||V||... is computed for the indices of the solution in batches
+    return EhIsValidSolutionForInput(n, k, (unsigned char*)&ss[0], ss.size(), pblock->nSolution);
+}
+
+}
+
 unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params& params)
 {
     unsigned int nProofOfWorkLimit = UintToArith256(params.powLimit).GetCompact();
@@ -81,29 +140,58 @@ unsigned int CalculateNextWorkRequired(arith_uint256 bnAvg,
 
 bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams& params)
 {
-    unsigned int n = params.EquihashN();
-    unsigned int k = params.EquihashK();
+    const EquihashCacheEntry entry = GetEquihashCacheEntry(pblock, params);
+    if (IsEquihashCached(entry))
+        return true;
 
-    // Hash state
-    crypto_generichash_blake2b_state state;
-    EhInitialiseState(n, k, state);
+    if (!VerifyEquihashSolution(pblock, params))
+        return error("CheckEquihashSolution(): invalid solution");
 
-    // I = the block header minus nonce and solution.
-    CEquihashInput I{*pblock};
-    // I||V
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss << I;
-    ss << pblock->nNonce;
+    AddEquihashCache(entry);
+    return true;
+}
 
-    // H(I||V||...
-    crypto_generichash_blake2b_update(&state, (unsigned char*)&ss[0], ss.size());
+bool CheckEquihashSolutions(const std::vector<const CBlockHeader*>& vpblock, const CChainParams& params, CCheckQueue<CCheckJob>* pqueue)
+{
+    // each job fills its own slot, the cache is only filled afterwards, by this thread
+    std::vector<EquihashCacheEntry> vEntries;
+    std::vector<const CBlockHeader*> vpToCheck;
+    for (const CBlockHeader* pblock : vpblock) {
+        EquihashCacheEntry entry = GetEquihashCacheEntry(pblock, params);
+        if (IsEquihashCached(entry))
+            continue;
+        vEntries.push_back(entry);
+        vpToCheck.push_back(pblock);
+    }
 
-    bool isValid;
-    EhIsValidSolution(n, k, state, pblock->nSolution, isValid);
-    if (!isValid)
-        return error("CheckEquihashSolution(): invalid solution");
+    std::vector<char> vValid(vpToCheck.size(), 0);
+    if (pqueue != NULL && vpToCheck.size() > 1) {
+        std::vector<CCheckJob> vJobs;
+        vJobs.reserve(vpToCheck.size());
+        for (size_t i = 0; i < vpToCheck.size(); i++)
+            vJobs.push_back(CCheckJob([&, i]() { vValid[i] = VerifyEquihashSolution(vpToCheck[i], params); return true; }));
+        CCheckQueueControl<CCheckJob> control(pqueue);
+        control.Add(vJobs);
+        control.Wait();
+    } else {
+        for (size_t i = 0; i < vpToCheck.size(); i++)
+            vValid[i] = VerifyEquihashSolution(vpToCheck[i], params);
+    }
 
-    return true;
+    bool fAllValid = true;
+    for (size_t i = 0; i < vpToCheck.size(); i++) {
+        if (vValid[i])
+            AddEquihashCache(vEntries[i]);
+        else
+            fAllValid = false;
+    }
+    return fAllValid;
+}
+
+void ClearEquihashCache()
+{
+    boost::unique_lock<boost::shared_mutex> lock(cs_equihashcache);
+    setValidEquihash.clear();
 }
 
 /** extracted from rpc command generate and reused in UTs **/
@@ -6,6 +6,7 @@
 #define BITCOIN_POW_H
 
 #include <stdint.h>
+#include <vector>
 
 namespace Consensus {
     class Params;
@@ -17,15 +18,33 @@ class CBlockIndex;
 class CChainParams;
 class uint256;
 class arith_uint256;
+class CCheckJob;
+template <typename T> class CCheckQueue;
+
+/** The number of valid Equihash solutions remembered, about 100 bytes each */
+static const unsigned int MAX_EQUIHASH_CACHE_SIZE = 100000;
 
 unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params&);
 unsigned int CalculateNextWorkRequired(arith_uint256 bnAvg,
                                        int64_t nLastBlockTime, int64_t nFirstBlockTime,
                                        const Consensus::Params&);
 
-/** Check whether the Equihash solution in a block header is valid */
+/**
+ * Check whether the Equihash solution in a block header is valid. The valid solutions are cached by block
+ * hash, as the same header is checked again when the block comes, and when it is read from disk.
+ */
 bool CheckEquihashSolution(const CBlockHeader *pblock, const CChainParams&);
 
+/**
+ * Check the Equihash solutions of a batch of headers, spread over the threads of pqueue (in this thread
+ * if NULL). The solutions already cached are not checked again, the valid ones get cached.
+ * Returns whether all the solutions are valid.
+ */
+bool CheckEquihashSolutions(const std::vector<const CBlockHeader*>& vpblock, const CChainParams&, CCheckQueue<CCheckJob>* pqueue);
+
+/** Forget the valid Equihash solutions cached */
+void ClearEquihashCache();
+
 /** extracted from rpc command generate and reused in UTs **/
 void generateEquihash(CBlock& block);
 
@@ -23,6 +23,9 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <assert.h>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
 
 typedef uint16_t u16;
 typedef uint64_t u64;
@@ -177,8 +180,8 @@ struct htalloc {
 // 7      0 2 4 6 . G G   1 3 5 7 H H
 // 8      0 2 4 6 8 . I   1 3 5 7 H H
     assert(DIGITBITS >= 16); // ensures hashes shorten by 1 unit every 2 digits
-    heap0 = (u32 *)alloc(1, sizeof(digit0));
-    heap1 = (u32 *)alloc(1, sizeof(digit1));
+    heap0 = (u32 *)allocheap(sizeof(digit0));
+    heap1 = (u32 *)allocheap(sizeof(digit1));
     for (int r=0; r<WK; r++)
       if ((r&1) == 0)
         trees0[r/2]  = (bucket0 *)(heap0 + r/2);
@@ -186,9 +189,42 @@ struct htalloc {
         trees1[r/2]  = (bucket1 *)(heap1 + r/2);
   }
   void dealloctrees() {
-    free(heap0);
-    free(heap1);
+    freeheap(heap0, sizeof(digit0));
+    freeheap(heap1, sizeof(digit1));
+  }
+#if defined(__linux__)
+  // the heaps are accessed at random, backing them with huge pages saves most of the TLB misses
+  static size_t heapmapsize(const size_t sz) {
+    const size_t hugepagesize = 2 << 20;
+    return (sz + hugepagesize - 1) & ~(hugepagesize - 1);
+  }
+  void *allocheap(const size_t sz) {
+    void *mem = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    mem = mmap(NULL, heapmapsize(sz), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (mem == MAP_FAILED) {
+      // no huge pages reserved, fall back to transparent ones
+      mem = mmap(NULL, heapmapsize(sz), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      assert(mem != MAP_FAILED);
+#ifdef MADV_HUGEPAGE
+      madvise(mem, heapmapsize(sz), MADV_HUGEPAGE);
+#endif
+    }
+    alloced += sz;
+    return mem;
+  }
+  void freeheap(void *mem, const size_t sz) {
+    munmap(mem, heapmapsize(sz));
+  }
+#else
+  void *allocheap(const size_t sz) {
+    return alloc(1, sz);
+  }
+  void freeheap(void *mem, const size_t sz) {
+    free(mem);
   }
+#endif
   void *alloc(const u32 n, const u32 sz) {
     void *mem  = calloc(n, sz);
     assert(mem);
@@ -9,9 +9,15 @@
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 #include "crypto/common.h"
+#include "crypto/sha256.h"
 #include <sc/sidechainTxsCommitmentBuilder.h>
 #include <sc/sidechainTxsCommitmentGuard.h>
 #include <serialize.h>
+
+#include <thread>
+
+/** The levels of the merkle trees with at least these pairs for each thread are hashed in parallel */
+static const size_t MERKLE_PARALLEL_MIN_PAIRS = 2048;
 // uncomment for debugging mkl root hash calculations
 //#define DEBUG_MKLTREE_HASH 1
 
@@ -121,28 +127,88 @@ uint256 CBlock::BuildMerkleTree(bool* fMutated) const
     return BuildMerkleTree(vMerkleTree, vTxBase.size(), fMutated);
 }
 
+uint256 CBlock::ComputeMerkleRoot(bool* fMutated) const
+{
+    std::vector<const CTransactionBase*> vTxBase;
+    GetTxAndCertsVector(vTxBase);
+
+    std::vector<uint256> vHashes;
+    vHashes.reserve(vTxBase.size() + 1);
+    for (const CTransactionBase* txBase : vTxBase)
+        vHashes.push_back(txBase->GetHash());
+
+    return ComputeMerkleRoot(std::move(vHashes), fMutated);
+}
+
+uint256 CBlock::ComputeMerkleRoot(std::vector<uint256> vHashes, bool* fMutated)
+{
+    // See the comment in BuildMerkleTree about the mutation of the tree
+    bool mutated = false;
+    while (vHashes.size() > 1)
+    {
+        if (vHashes.size() % 2 == 0 && vHashes[vHashes.size()-2] == vHashes.back()) {
+            // Two identical hashes at the end of the list at a particular level.
+            mutated = true;
+        }
+        if (vHashes.size() % 2 == 1)
+            vHashes.push_back(vHashes.back());
+
+        const size_t nPairs = vHashes.size() / 2;
+        const size_t nThreads = std::min<size_t>(std::thread::hardware_concurrency(), nPairs / MERKLE_PARALLEL_MIN_PAIRS);
+        if (nThreads > 1) {
+            // the ranges of the level, the last one hashed by this thread
+            std::vector<uint256> vLevel(nPairs);
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < nThreads - 1; t++) {
+                const size_t begin = nPairs * t / nThreads, end = nPairs * (t + 1) / nThreads;
+                threads.emplace_back(SHA256D64, vLevel[begin].begin(), vHashes[2*begin].begin(), end - begin);
+            }
+            const size_t begin = nPairs * (nThreads - 1) / nThreads;
+            SHA256D64(vLevel[begin].begin(), vHashes[2*begin].begin(), nPairs - begin);
+            for (std::thread& thread : threads)
+                thread.join();
+            vHashes.swap(vLevel);
+        } else {
+            // each hash of the level overwrites a pair already hashed
+            SHA256D64(vHashes[0].begin(), vHashes[0].begin(), nPairs);
+            vHashes.resize(nPairs);
+        }
+    }
+    if (fMutated) {
+        *fMutated = mutated;
+    }
+    return (vHashes.empty() ? uint256() : vHashes[0]);
+}
+
 uint256 CBlock::BuildMerkleTree(std::vector<uint256>& vMerkleTreeIn, size_t vtxSize, bool* fMutated)
 {
     int j = 0;
     bool mutated = false;
     for (int nSize = vtxSize; nSize > 1; nSize = (nSize + 1) / 2)
     {
+        if (nSize % 2 == 0 && vMerkleTreeIn[j+nSize-2] == vMerkleTreeIn[j+nSize-1]) {
+            // Two identical hashes at the end of the list at a particular level.
+            mutated = true;
+        }
+        // The pairs of the level are contiguous, all of them are hashed at once by the
+        // multi-way implementations; a last hash without a pair is hashed with itself.
+        const int nPairs = nSize / 2;
+        vMerkleTreeIn.resize(j + nSize + (nSize + 1) / 2);
+        SHA256D64(vMerkleTreeIn[j+nSize].begin(), vMerkleTreeIn[j].begin(), nPairs);
+        if (nSize % 2 == 1) {
+            vMerkleTreeIn[j+nSize+nPairs] = Hash(BEGIN(vMerkleTreeIn[j+nSize-1]), END(vMerkleTreeIn[j+nSize-1]),
+                                                 BEGIN(vMerkleTreeIn[j+nSize-1]), END(vMerkleTreeIn[j+nSize-1]));
+        }
+#ifdef DEBUG_MKLTREE_HASH
         for (int i = 0; i < nSize; i += 2)
         {
             int i2 = std::min(i+1, nSize-1);
-            if (i2 == i + 1 && i2 + 1 == nSize && vMerkleTreeIn[j+i] == vMerkleTreeIn[j+i2]) {
-                // Two identical hashes at the end of the list at a particular level.
-                mutated = true;
-            }
-            vMerkleTreeIn.push_back(Hash(BEGIN(vMerkleTreeIn[j+i]),  END(vMerkleTreeIn[j+i]),
-                                         BEGIN(vMerkleTreeIn[j+i2]), END(vMerkleTreeIn[j+i2])));
-#ifdef DEBUG_MKLTREE_HASH
             std::cout << " -------------------------------------------" << std::endl;
-            std::cout << i << ") mkl hash: " << vMerkleTreeIn.back().ToString() << std::endl;
+            std::cout << i << ") mkl hash: " << vMerkleTreeIn[j+nSize+i/2].ToString() << std::endl;
             std::cout <<      "      hash1: " << vMerkleTreeIn[j+i].ToString() << std::endl;
             std::cout <<      "      hash2: " << vMerkleTreeIn[j+i2].ToString() << std::endl;
-#endif
         }
+#endif
         j += nSize;
     }
     if (fMutated) {
@@ -120,6 +120,11 @@ public:
 
     // memory only
     mutable std::vector<uint256> vMerkleTree;
+    // memory only: CheckBlock already passed, with its default flags and no proof verification
+    mutable bool fChecked;
+    // memory only: hashScTxsCommitment is known to be the one of vtx and vcert, as for the blocks built on the
+    // templates of this node, so that ConnectBlock does not build it again
+    mutable bool fScTxsCommitmentChecked;
     
     CBlock()
     {
@@ -159,6 +164,8 @@ public:
         vtx.clear();
         vcert.clear();
         vMerkleTree.clear();
+        fChecked = false;
+        fScTxsCommitmentChecked = false;
     }
 
     CBlockHeader GetBlockHeader() const
@@ -181,6 +188,10 @@ public:
     // merkle root).
     uint256 BuildMerkleTree(bool* mutated = NULL) const;
 
+    // Compute the merkle root only, as BuildMerkleTree but without keeping the
+    // nodes of the tree: each level is hashed in place, its pairs at once.
+    uint256 ComputeMerkleRoot(bool* mutated = NULL) const;
+
     // Build / updates the sc txs commitment tree as described in zendoo paper. It is based on contribution from
     // sidechains-related txes and certificates contained in this block. Returns the status of the opeartion.
     // In case of failure hashScTxsCommitment is set to null.
@@ -199,6 +210,9 @@ public:
     // build the merkel tree storing it in the vMerkleTreeIn in/out vector and return the merkle root hash
     static uint256 BuildMerkleTree(std::vector<uint256>& vMerkleTreeIn, size_t vtxSize, bool* mutated = NULL);
 
+    // the merkle root of the given leaves, the levels of very large trees are hashed by multiple threads
+    static uint256 ComputeMerkleRoot(std::vector<uint256> vHashes, bool* mutated = NULL);
+
     static uint256 CheckMerkleBranch(uint256 hash, const std::vector<uint256>& vMerkleBranch, int nIndex);
 };
 
@@ -74,7 +74,7 @@ CScCertificate::CScCertificate(const CMutableScCertificate &cert): CTransactionB
 
 void CScCertificate::UpdateHash() const
 {
-    *const_cast<uint256*>(&hash) = SerializeHash(*this);
+    UpdateHashAndSize(*this);
 }
 
 bool CScCertificate::IsBackwardTransfer(int pos) const
@@ -308,10 +308,8 @@ void CScCertificate::AddJoinSplitToJSON(UniValue& entry) const
 
 void CScCertificate::Relay() const
 {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss.reserve(10000);
-    ss << *this;
-    ::Relay(*this, ss);
+    std::shared_ptr<const CTransactionBase> certShared = mempool.lookupShared(GetHash());
+    ::Relay(certShared ? certShared : MakeShared());
 }
 
 std::shared_ptr<const CTransactionBase>
@@ -85,6 +85,9 @@ public:
     const uint256& GetHash() const { return hash; }
 
     size_t GetSerializeSize(int nType, int nVersion) const override {
+        // the serialization is the same whatever the type and the version of the stream
+        if (nSerializedSize != 0)
+            return nSerializedSize;
         CSizeComputer s(nType, nVersion);
         NCONST_PTR(this)->SerializationOp(s, CSerActionSerialize(), nType, nVersion);
         return s.size();
@@ -98,6 +101,10 @@ public:
     void Unserialize(Stream& s, int nType, int nVersion) {
         SerializationOp(s, CSerActionUnserialize(), nType, nVersion);
     }
+    //! the size of a block or of a message holding the object does not walk through it
+    void Serialize(CSizeComputer& s, int nType, int nVersion) const {
+        s.seek(GetSerializeSize(nType, nVersion));
+    }
 
     template <typename Stream, typename Operation>
     inline void SerializationOpInternal(Stream& s, Operation ser_action, int nType, int unused) {
@@ -131,19 +138,19 @@ public:
 
             std::vector<CBackwardTransferOut> vbt_ccout_ser;
             READWRITE(*const_cast<std::vector<CBackwardTransferOut>*>(&vbt_ccout_ser));
+            (*const_cast<std::vector<CTxOut>*>(&vout)).reserve(vout.size() + vbt_ccout_ser.size());
             for (auto& btout : vbt_ccout_ser)
                 (*const_cast<std::vector<CTxOut>*>(&vout)).push_back(CTxOut(btout));
         }
         else
         {
             // reading from memory and writing to data stream
-            std::vector<CTxOut> vout_ser;
-            for(int pos = 0; pos < nFirstBwtPos; ++pos)
-                vout_ser.push_back(vout[pos]);
+            std::vector<CTxOut> vout_ser(vout.begin(), vout.begin() + nFirstBwtPos);
 
             READWRITE(*const_cast<std::vector<CTxOut>*>(&vout_ser));
 
             std::vector<CBackwardTransferOut> vbt_ccout_ser;
+            vbt_ccout_ser.reserve(vout.size() - nFirstBwtPos);
             for(int pos = nFirstBwtPos; pos < vout.size(); ++pos)
                 vbt_ccout_ser.push_back(CBackwardTransferOut(vout[pos]));
 
@@ -267,6 +274,7 @@ struct CMutableScCertificate : public CMutableTransactionBase
 
             std::vector<CBackwardTransferOut> vbt_ccout_ser;
             READWRITE(vbt_ccout_ser);
+            vout.reserve(vout.size() + vbt_ccout_ser.size());
             for (auto& btout : vbt_ccout_ser)
                 vout.push_back(CTxOut(btout));
         }
@@ -274,13 +282,12 @@ struct CMutableScCertificate : public CMutableTransactionBase
         {
             // reading from memory and writing to data stream
             // we must not modify vout
-            std::vector<CTxOut> vout_ser;
-            for(int pos = 0; pos < nFirstBwtPos; ++pos)
-                vout_ser.push_back(vout[pos]);
+            std::vector<CTxOut> vout_ser(vout.begin(), vout.begin() + nFirstBwtPos);
 
             READWRITE(vout_ser);
 
             std::vector<CBackwardTransferOut> vbt_ccout_ser;
+            vbt_ccout_ser.reserve(vout.size() - nFirstBwtPos);
             for(int pos = nFirstBwtPos; pos < vout.size(); ++pos)
                 vbt_ccout_ser.push_back(CBackwardTransferOut(vout[pos]));
 
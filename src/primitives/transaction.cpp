@@ -49,7 +49,8 @@ JSDescription::JSDescription(
     CAmount vpub_old,
     CAmount vpub_new,
     bool computeProof,
-    uint256 *esk // payment disclosure
+    uint256 *esk, // payment disclosure
+    ZCJSProofWitness *witness
 ) : vpub_old(vpub_old), vpub_new(vpub_new), anchor(anchor)
 {
     std::array<libzcash::Note, ZC_NUM_JS_OUTPUTS> notes;
@@ -70,7 +71,8 @@ JSDescription::JSDescription(
         vpub_new,
         anchor,
         computeProof,
-        esk // payment disclosure
+        esk, // payment disclosure
+        witness
     );
 }
 
@@ -93,7 +95,8 @@ JSDescription JSDescription::Randomized(
     CAmount vpub_new,
     bool computeProof,
     uint256 *esk, // payment disclosure
-    std::function<int(int)> gen
+    std::function<int(int)> gen,
+    ZCJSProofWitness *witness
 )
 {
     // Randomize the order of the inputs and outputs
@@ -109,7 +112,8 @@ JSDescription JSDescription::Randomized(
         makeGrothProof,
         params, joinSplitPubKey, anchor, inputs, outputs,
         vpub_old, vpub_new, computeProof,
-        esk // payment disclosure
+        esk, // payment disclosure
+        witness
     );
 }
 
@@ -463,13 +467,14 @@ bool CMutableTransaction::add(const CBwtRequestOut& out)        { vmbtr_out.push
 
 //--------------------------------------------------------------------------------------------------------
 CTransactionBase::CTransactionBase(int nVersionIn):
-    nVersion(nVersionIn), vin(), vout(), hash() {}
+    nVersion(nVersionIn), vin(), vout(), hash(), nSerializedSize(0) {}
 
 CTransactionBase::CTransactionBase(const CTransactionBase &tx):
-    nVersion(tx.nVersion), vin(tx.vin), vout(tx.vout), hash(tx.hash) {}
+    nVersion(tx.nVersion), vin(tx.vin), vout(tx.vout), hash(tx.hash), nSerializedSize(tx.nSerializedSize) {}
 
 CTransactionBase& CTransactionBase::operator=(const CTransactionBase &tx) {
     *const_cast<uint256*>(&hash)             = tx.hash;
+    *const_cast<size_t*>(&nSerializedSize)   = tx.nSerializedSize;
     *const_cast<int*>(&nVersion)             = tx.nVersion;
     *const_cast<std::vector<CTxIn>*>(&vin)   = tx.vin;
     *const_cast<std::vector<CTxOut>*>(&vout) = tx.vout;
@@ -477,7 +482,8 @@ CTransactionBase& CTransactionBase::operator=(const CTransactionBase &tx) {
 }
 
 CTransactionBase::CTransactionBase(const CMutableTransactionBase& mutTxBase):
-    nVersion(mutTxBase.nVersion), vin(mutTxBase.vin), vout(mutTxBase.getVout()), hash(mutTxBase.GetHash()) {}
+    nVersion(mutTxBase.nVersion), vin(mutTxBase.vin), vout(mutTxBase.getVout()), hash(mutTxBase.GetHash()),
+    nSerializedSize(0) {}
 
 CAmount CTransactionBase::GetValueOut() const
 {
@@ -739,7 +745,7 @@ CTransaction& CTransaction::operator=(const CTransaction &tx) {
 
 void CTransaction::UpdateHash() const
 {
-    *const_cast<uint256*>(&hash) = SerializeHash(*this);
+    UpdateHashAndSize(*this);
     // if any sidechain creation is taking place within this transaction, we generate the sidechain id
     for(unsigned int pos = 0; pos < vsc_ccout.size(); pos++)
         vsc_ccout[pos].GenerateScId(hash, pos);
@@ -1185,10 +1191,8 @@ std::string CTransaction::EncodeHex() const
 
 void CTransaction::Relay() const
 {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss.reserve(10000);
-    ss << *this;
-    ::Relay(*this, ss);
+    std::shared_ptr<const CTransactionBase> txShared = mempool.lookupShared(GetHash());
+    ::Relay(txShared ? txShared : MakeShared());
 }
 
 std::shared_ptr<const CTransactionBase>
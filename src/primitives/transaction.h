@@ -167,7 +167,8 @@ public:
             CAmount vpub_old,
             CAmount vpub_new,
             bool computeProof = true, // Set to false in some tests
-            uint256 *esk = nullptr // payment disclosure
+            uint256 *esk = nullptr, // payment disclosure
+            ZCJSProofWitness *witness = nullptr // to compute the proof later
     );
 
     static JSDescription Randomized(
@@ -188,7 +189,8 @@ public:
             CAmount vpub_new,
             bool computeProof = true, // Set to false in some tests
             uint256 *esk = nullptr, // payment disclosure
-            std::function<int(int)> gen = GetRandInt
+            std::function<int(int)> gen = GetRandInt,
+            ZCJSProofWitness *witness = nullptr // to compute the proof later
     );
 
     // Verifies that the JoinSplit proof is correct.
@@ -747,8 +749,19 @@ protected:
 
     /** Memory only. */
     const uint256 hash;
+    //! the size of the serialization, computed with the hash; 0 when the hash has not been computed
+    const size_t nSerializedSize;
 
     virtual void UpdateHash() const = 0;
+    //! hashes the serialization of the object, setting both hash and nSerializedSize
+    template <typename T>
+    void UpdateHashAndSize(const T& obj) const
+    {
+        CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
+        ss << obj;
+        *const_cast<uint256*>(&hash) = ss.GetHash();
+        *const_cast<size_t*>(&nSerializedSize) = ss.size();
+    }
 public:
 
     virtual size_t GetSerializeSize(int nType, int nVersion) const = 0;
@@ -906,6 +919,9 @@ public:
     CTransaction(const CMutableTransaction &tx);
 
     size_t GetSerializeSize(int nType, int nVersion) const override {
+        // the serialization is the same whatever the type and the version of the stream
+        if (nSerializedSize != 0)
+            return nSerializedSize;
         CSizeComputer s(nType, nVersion);
         NCONST_PTR(this)->SerializationOp(s, CSerActionSerialize(), nType, nVersion);
         return s.size();
@@ -919,6 +935,10 @@ public:
     void Unserialize(Stream& s, int nType, int nVersion) {
         SerializationOp(s, CSerActionUnserialize(), nType, nVersion);
     }
+    //! the size of a block or of a message holding the object does not walk through it
+    void Serialize(CSizeComputer& s, int nType, int nVersion) const {
+        s.seek(GetSerializeSize(nType, nVersion));
+    }
 
 
     template <typename Stream, typename Operation>
@@ -1068,6 +1088,7 @@ public:
     virtual uint256 GetHash() const = 0;
 
     const std::vector<CTxOut>& getVout() const                { return vout; }
+    void reserveOut(unsigned int n)                           { vout.reserve(n); }
                        CTxOut& getOut(unsigned int pos)       { return vout[pos]; }
                  const CTxOut& getOut(unsigned int pos) const { return vout[pos]; }
 
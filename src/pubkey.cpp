@@ -136,11 +136,16 @@ bool CExtPubKey::Derive(CExtPubKey &out, unsigned int nChild) const {
 
 /* static */ int ECCVerifyHandle::refcount = 0;
 
-ECCVerifyHandle::ECCVerifyHandle()
+ECCVerifyHandle::ECCVerifyHandle(int nWindow)
 {
     if (refcount == 0) {
         assert(secp256k1_context_verify == NULL);
-        secp256k1_context_verify = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+        if (nWindow == DEFAULT_SIG_VERIFY_WINDOW) {
+            secp256k1_context_verify = secp256k1_context_create(SECP256K1_CONTEXT_VERIFY);
+        } else {
+            assert(nWindow >= MIN_SIG_VERIFY_WINDOW && nWindow <= MAX_SIG_VERIFY_WINDOW);
+            secp256k1_context_verify = secp256k1_context_create_ecmult_window(SECP256K1_CONTEXT_VERIFY, nWindow);
+        }
         assert(secp256k1_context_verify != NULL);
     }
     refcount++;
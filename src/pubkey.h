@@ -216,14 +216,21 @@ struct CExtPubKey {
     bool Derive(CExtPubKey& out, unsigned int nChild) const;
 };
 
+/** The range of -sigverifywindow, the window size of the precomputed tables of the signature verification */
+static const int MIN_SIG_VERIFY_WINDOW = 2;
+static const int MAX_SIG_VERIFY_WINDOW = 24;
+/** Default for -sigverifywindow, 0 for the window libsecp256k1 is built with */
+static const int DEFAULT_SIG_VERIFY_WINDOW = 0;
+
 /** Users of this module must hold an ECCVerifyHandle. The constructor and
- *  destructor of these are not allowed to run in parallel, though. */
+ *  destructor of these are not allowed to run in parallel, though. The first
+ *  handle creates the verification context, with the tables of nWindow. */
 class ECCVerifyHandle
 {
     static int refcount;
 
 public:
-    ECCVerifyHandle();
+    ECCVerifyHandle(int nWindow = DEFAULT_SIG_VERIFY_WINDOW);
     ~ECCVerifyHandle();
 };
 
@@ -3,11 +3,16 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "blockfilemap.h"
+#include "blockfilter.h"
+#include "blockfilterindexer.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "main.h"
+#include "headercache.h"
 #include "httpserver.h"
 #include "rpc/server.h"
+#include "sc/sidechainrpc.h"
 #include "streams.h"
 #include "sync.h"
 #include "txmempool.h"
@@ -57,11 +62,14 @@ struct CCoin {
 };
 
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
-extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false, const CChain& chain = chainActive);
 extern UniValue mempoolInfoToJSON();
 extern UniValue mempoolToJSON(bool fVerbose = false);
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
-extern UniValue blockheaderToJSON(const CBlockIndex* blockindex);
+extern UniValue blockheaderToJSON(const CBlockIndex* blockindex, const CChain& chain = chainActive);
+extern void CertToJSON(const CScCertificate& cert, const uint256 hashBlock, UniValue& entry);
+extern bool FillScRecordFromInfo(const uint256& scId, const CSidechain& info, CSidechain::State scState, const CCoinsViewCache& scView,
+    UniValue& sc, bool bOnlyAlive, bool bVerbose, bool bIncludeUnconf);
 
 static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, string message)
 {
@@ -115,6 +123,219 @@ static bool CheckWarmup(HTTPRequest* req)
     return true;
 }
 
+/**
+ * The replies that depend only on the chain are tagged with the tip they were built on, so that a proxy can
+ * keep them and only revalidate them: true, with a 304 reply already sent, if the request had the same tag.
+ */
+static bool CheckTipETag(HTTPRequest* req, const uint256& hashTip)
+{
+    const std::string strETag = "\"" + hashTip.GetHex() + "\"";
+    req->WriteHeader("ETag", strETag);
+    req->WriteHeader("Cache-Control", "public, no-cache");
+
+    std::pair<bool, std::string> ifNoneMatch = req->GetHeader("If-None-Match");
+    if (ifNoneMatch.first && ifNoneMatch.second == strETag) {
+        req->WriteReply(HTTP_NOT_MODIFIED);
+        return true;
+    }
+    return false;
+}
+
+static bool rest_sidechain_topcert(HTTPRequest* req, const uint256& scId, const RetFormat rf)
+{
+    uint256 hashTip;
+    uint256 hashCert;
+    {
+        LOCK(cs_main);
+        hashTip = chainActive.Tip()->GetBlockHash();
+        CSidechain sidechain;
+        if (!pcoinsTip->GetSidechain(scId, sidechain))
+            return RESTERR(req, HTTP_NOT_FOUND, scId.GetHex() + " not found");
+        hashCert = sidechain.lastTopQualityCertHash;
+    }
+    if (hashCert.IsNull())
+        return RESTERR(req, HTTP_NOT_FOUND, "no certificate for " + scId.GetHex());
+
+    if (rf != RF_BINARY && rf != RF_HEX && rf != RF_JSON)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    if (CheckTipETag(req, hashTip))
+        return true;
+
+    CScCertificate cert;
+    uint256 hashBlock;
+    if (!GetCertificate(hashCert, cert, hashBlock, true))
+        return RESTERR(req, HTTP_NOT_FOUND, hashCert.GetHex() + " not found");
+
+    CDataStream ssCert(SER_NETWORK, PROTOCOL_VERSION);
+    ssCert << cert;
+
+    switch (rf) {
+    case RF_BINARY: {
+        string binaryCert = ssCert.str();
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, binaryCert);
+        return true;
+    }
+
+    case RF_HEX: {
+        string strHex = HexStr(ssCert.begin(), ssCert.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+
+    default: {
+        UniValue objCert(UniValue::VOBJ);
+        CertToJSON(cert, hashBlock, objCert);
+        string strJSON = objCert.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    }
+}
+
+/**
+ * The state of a sidechain in the chain, with "/topcert" its last top quality certificate. The mempool is left
+ * out, so that the reply only changes with the tip.
+ */
+static bool rest_sidechain(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() > 2 || (path.size() == 2 && path[1] != "topcert"))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/sidechain/<scid>[/topcert].<ext>");
+
+    uint256 scId;
+    if (!ParseHashStr(path[0], scId))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid scid: " + path[0]);
+
+    if (path.size() == 2)
+        return rest_sidechain_topcert(req, scId, rf);
+
+    CDataStream ssSidechain(SER_NETWORK, PROTOCOL_VERSION);
+    UniValue objSidechain(UniValue::VOBJ);
+    uint256 hashTip;
+    {
+        LOCK(cs_main);
+        hashTip = chainActive.Tip()->GetBlockHash();
+        CSidechain sidechain;
+        if (!pcoinsTip->GetSidechain(scId, sidechain))
+            return RESTERR(req, HTTP_NOT_FOUND, scId.GetHex() + " not found");
+
+        switch (rf) {
+        case RF_BINARY:
+        case RF_HEX:
+            ssSidechain << sidechain;
+            break;
+        case RF_JSON: {
+            CCoinsViewCache scView(pcoinsTip);
+            FillScRecordFromInfo(scId, sidechain, sidechain.GetState(scView), scView, objSidechain, false, true, false);
+            break;
+        }
+        default:
+            return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+        }
+    }
+
+    if (CheckTipETag(req, hashTip))
+        return true;
+
+    switch (rf) {
+    case RF_BINARY: {
+        string binarySidechain = ssSidechain.str();
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, binarySidechain);
+        return true;
+    }
+
+    case RF_HEX: {
+        string strHex = HexStr(ssSidechain.begin(), ssSidechain.end()) + "\n";
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, strHex);
+        return true;
+    }
+
+    default: {
+        string strJSON = objSidechain.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    }
+}
+
+/** Whether a csw nullifier of a sidechain is in the chain: as a single byte 0 or 1 in binary and hex */
+static bool rest_cswnullifier(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/cswnullifier/<scid>/<nullifier>.<ext>");
+
+    uint256 scId;
+    if (!ParseHashStr(path[0], scId))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid scid: " + path[0]);
+
+    std::string strError;
+    std::vector<unsigned char> vNullifier;
+    if (!Sidechain::AddScData(path[1], vNullifier, CFieldElement::ByteSize(), Sidechain::CheckSizeMode::CHECK_STRICT, strError))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid nullifier: " + strError);
+    CFieldElement nullifier{vNullifier};
+    if (!nullifier.IsValid())
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid nullifier: invalid nullifier data");
+
+    if (rf != RF_BINARY && rf != RF_HEX && rf != RF_JSON)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    uint256 hashTip;
+    bool fExists;
+    {
+        LOCK(cs_main);
+        hashTip = chainActive.Tip()->GetBlockHash();
+        fExists = pcoinsTip->HaveCswNullifier(scId, nullifier);
+    }
+
+    if (CheckTipETag(req, hashTip))
+        return true;
+
+    switch (rf) {
+    case RF_BINARY: {
+        string binaryExists(1, fExists ? '\x01' : '\x00');
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, binaryExists);
+        return true;
+    }
+
+    case RF_HEX: {
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, fExists ? "01\n" : "00\n");
+        return true;
+    }
+
+    default: {
+        UniValue objNullifier(UniValue::VOBJ);
+        objNullifier.pushKV("scid", scId.GetHex());
+        objNullifier.pushKV("nullifier", path[1]);
+        objNullifier.pushKV("exists", fExists);
+        string strJSON = objNullifier.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    }
+}
+
 static bool rest_headers(HTTPRequest* req,
                          const std::string& strURIPart)
 {
@@ -139,6 +360,7 @@ static bool rest_headers(HTTPRequest* req,
 
     std::vector<const CBlockIndex *> headers;
     headers.reserve(count);
+    string binaryHeader;
     {
         LOCK(cs_main);
         BlockMap::const_iterator it = mapBlockIndex.find(hash);
@@ -149,31 +371,35 @@ static bool rest_headers(HTTPRequest* req,
                 break;
             pindex = chainActive.Next(pindex);
         }
-    }
 
-    CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
-    BOOST_FOREACH(const CBlockIndex *pindex, headers) {
-        ssHeader << pindex->GetBlockHeader();
+        // the solutions may have to be read back from the block tree db, under cs_main
+        if (rf != RF_JSON) {
+            BOOST_FOREACH(const CBlockIndex *pindex, headers) {
+                binaryHeader += *headerCache.GetRaw(pindex);
+            }
+        }
     }
 
     switch (rf) {
     case RF_BINARY: {
-        string binaryHeader = ssHeader.str();
         req->WriteHeader("Content-Type", "application/octet-stream");
         req->WriteReply(HTTP_OK, binaryHeader);
         return true;
     }
 
     case RF_HEX: {
-        string strHex = HexStr(ssHeader.begin(), ssHeader.end()) + "\n";
+        string strHex = HexStr(binaryHeader.begin(), binaryHeader.end()) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
     }
     case RF_JSON: {
         UniValue jsonHeaders(UniValue::VARR);
-        BOOST_FOREACH(const CBlockIndex *pindex, headers) {
-            jsonHeaders.push_back(blockheaderToJSON(pindex));
+        {
+            LOCK(cs_main);
+            BOOST_FOREACH(const CBlockIndex *pindex, headers) {
+                jsonHeaders.push_back(blockheaderToJSON(pindex));
+            }
         }
         string strJSON = jsonHeaders.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
@@ -189,6 +415,149 @@ static bool rest_headers(HTTPRequest* req,
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+static bool rest_blockfilterheaders(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 3)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/blockfilterheaders/<filtertype>/<count>/<blockhash>.<ext>");
+
+    BlockFilterType filterType;
+    if (!BlockFilterTypeByName(path[0], filterType))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Unknown filter type: " + path[0]);
+    if (!fBlockFilterIndex)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block filter index not enabled (use -blockfilterindex)");
+
+    long count = strtol(path[1].c_str(), NULL, 10);
+    if (count < 1 || count > (long)MAX_GETCFHEADERS_SIZE)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Header count out of range: " + path[1]);
+
+    uint256 hash;
+    if (!ParseHashStr(path[2], hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + path[2]);
+
+    if (rf != RF_BINARY && rf != RF_HEX && rf != RF_JSON)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    std::vector<uint256> vHashes;
+    vHashes.reserve(count);
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator it = mapBlockIndex.find(hash);
+        const CBlockIndex *pindex = (it != mapBlockIndex.end()) ? it->second : NULL;
+        while (pindex != NULL && chainActive.Contains(pindex)) {
+            vHashes.push_back(pindex->GetBlockHash());
+            if (vHashes.size() == (unsigned long)count)
+                break;
+            pindex = chainActive.Next(pindex);
+        }
+    }
+
+    // the filter headers of the blocks, up to the last one indexed
+    std::vector<uint256> vHeaders;
+    vHeaders.reserve(vHashes.size());
+    uint256 filterHash, header;
+    BOOST_FOREACH(const uint256& blockHash, vHashes) {
+        if (!CBlockFilterIndexer::LookupFilterHeader(blockHash, filterHash, header))
+            break;
+        vHeaders.push_back(header);
+    }
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CDataStream ssHeader(SER_NETWORK, PROTOCOL_VERSION);
+        ssHeader.reserve(vHeaders.size() * sizeof(uint256));
+        BOOST_FOREACH(const uint256& filterHeader, vHeaders)
+            ssHeader << filterHeader;
+        if (rf == RF_BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssHeader.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssHeader.begin(), ssHeader.end()) + "\n");
+        }
+        return true;
+    }
+
+    default: {
+        UniValue jsonHeaders(UniValue::VARR);
+        BOOST_FOREACH(const uint256& filterHeader, vHeaders)
+            jsonHeaders.push_back(filterHeader.GetHex());
+        string strJSON = jsonHeaders.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    }
+}
+
+static bool rest_blockfilter(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    vector<string> params;
+    const RetFormat rf = ParseDataFormat(params, strURIPart);
+    vector<string> path;
+    boost::split(path, params[0], boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected /rest/blockfilter/<filtertype>/<blockhash>.<ext>");
+
+    BlockFilterType filterType;
+    if (!BlockFilterTypeByName(path[0], filterType))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Unknown filter type: " + path[0]);
+    if (!fBlockFilterIndex)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block filter index not enabled (use -blockfilterindex)");
+
+    uint256 hash;
+    if (!ParseHashStr(path[1], hash))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + path[1]);
+
+    if (rf != RF_BINARY && rf != RF_HEX && rf != RF_JSON)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    {
+        LOCK(cs_main);
+        if (mapBlockIndex.count(hash) == 0)
+            return RESTERR(req, HTTP_NOT_FOUND, path[1] + " not found");
+    }
+
+    std::vector<unsigned char> filter;
+    uint256 filterHash, header;
+    if (!CBlockFilterIndexer::LookupFilter(hash, filter) || !CBlockFilterIndexer::LookupFilterHeader(hash, filterHash, header))
+        return RESTERR(req, HTTP_NOT_FOUND, "Filter of block " + path[1] + " not indexed (yet)");
+
+    switch (rf) {
+    case RF_BINARY: {
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, string(filter.begin(), filter.end()));
+        return true;
+    }
+
+    case RF_HEX: {
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, HexStr(filter) + "\n");
+        return true;
+    }
+
+    default: {
+        UniValue objFilter(UniValue::VOBJ);
+        objFilter.pushKV("filter", HexStr(filter));
+        objFilter.pushKV("header", header.GetHex());
+        string strJSON = objFilter.write() + "\n";
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, strJSON);
+        return true;
+    }
+    }
+}
+
 static bool rest_block(HTTPRequest* req,
                        const std::string& strURIPart,
                        bool showTxDetails)
@@ -203,8 +572,12 @@ static bool rest_block(HTTPRequest* req,
     if (!ParseHashStr(hashStr, hash))
         return RESTERR(req, HTTP_BAD_REQUEST, "Invalid hash: " + hashStr);
 
+    // the binary and hex formats are the bytes stored on disk, the block is only deserialized for json;
+    // it is read and converted outside cs_main, against a snapshot of the active chain
     CBlock block;
+    CRawBlock rawBlock;
     CBlockIndex* pblockindex = NULL;
+    CChainSnapshot chain;
     {
         LOCK(cs_main);
         if (mapBlockIndex.count(hash) == 0)
@@ -213,31 +586,32 @@ static bool rest_block(HTTPRequest* req,
         pblockindex = mapBlockIndex[hash];
         if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
-
-        if (!ReadBlockFromDisk(block, pblockindex))
-            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+        chain.SetTip(chainActive.Tip());
     }
 
-    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-    ssBlock << block;
+    if (rf == RF_BINARY || rf == RF_HEX) {
+        if (!ReadRawBlockFromDisk(rawBlock, pblockindex))
+            return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
+    } else if (!ReadBlockFromDisk(block, pblockindex))
+        return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
 
     switch (rf) {
     case RF_BINARY: {
-        string binaryBlock = ssBlock.str();
+        string binaryBlock(rawBlock.begin(), rawBlock.end());
         req->WriteHeader("Content-Type", "application/octet-stream");
         req->WriteReply(HTTP_OK, binaryBlock);
         return true;
     }
 
     case RF_HEX: {
-        string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
+        string strHex = HexStr(rawBlock.begin(), rawBlock.end()) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
         return true;
     }
 
     case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
+        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails, chain);
         string strJSON = objBlock.write() + "\n";
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, strJSON);
@@ -491,13 +865,13 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
     std::string bitmapStringRepresentation;
     boost::dynamic_bitset<unsigned char> hits(vOutPoints.size());
     {
-        LOCK2(cs_main, mempool.cs);
+        LOCK(cs_main);
 
         CCoinsView viewDummy;
         CCoinsViewCache view(&viewDummy);
 
         CCoinsViewCache& viewChain = *pcoinsTip;
-        CCoinsViewMemPool viewMempool(&viewChain, mempool);
+        CCoinsViewMemPoolSnapshot viewMempool(&viewChain, mempool);
 
         if (fCheckMemPool)
             view.SetBackend(viewMempool); // switch cache backend to db+mempool in case user likes to query mempool
@@ -506,7 +880,7 @@ static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
             CCoins coins;
             uint256 hash = vOutPoints[i].hash;
             if (view.GetCoins(hash, coins)) {
-                mempool.pruneSpent(hash, coins);
+                viewMempool.PruneSpent(hash, coins);
                 if (coins.IsAvailable(vOutPoints[i].n)) {
                     hits[i] = true;
                     // Safe to index into vout here because IsAvailable checked if it's off the end of the array, or if
@@ -598,7 +972,11 @@ static const struct {
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
+      {"/rest/blockfilter/", rest_blockfilter},
+      {"/rest/blockfilterheaders/", rest_blockfilterheaders},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/sidechain/", rest_sidechain},
+      {"/rest/cswnullifier/", rest_cswnullifier},
 };
 
 bool StartREST()
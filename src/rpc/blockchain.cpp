@@ -6,30 +6,42 @@
 #include "addressindex.h"
 #include "amount.h"
 #include "base58.h"
+#include "blockfilemap.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
+#include "clientversion.h"
 #include "consensus/validation.h"
+#include "headercache.h"
 #include "main.h"
 #include "primitives/transaction.h"
 #include "script/script.h"
 #include "script/script_error.h"
+#include "script/sigcache.h"
 #include "script/sign.h"
 #include "script/standard.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
+#include "scactivityindexer.h"
+#include "timestampindexer.h"
 #include "util.h"
 #include "zen/delay.h"
 
 #include <stdint.h>
 
+#include <boost/filesystem.hpp>
+
 #include <univalue.h>
 
+#include <algorithm>
+#include <numeric>
 #include <regex>
 #include <optional>
 
 #include "sc/asyncproofverifier.h"
+#include "sc/proofcache.h"
 #include "sc/sidechain.h"
 #include "sc/sidechainrpc.h"
 
@@ -116,21 +128,21 @@ static UniValue ValuePoolDesc(
     return rv;
 }
 
-UniValue blockheaderToJSON(const CBlockIndex* blockindex)
+UniValue blockheaderToJSON(const CBlockIndex* blockindex, const CChain& chain = chainActive)
 {
     UniValue result(UniValue::VOBJ);
     result.pushKV("hash", blockindex->GetBlockHash().GetHex());
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    if (chain.Contains(blockindex))
+        confirmations = chain.Height() - blockindex->nHeight + 1;
     result.pushKV("confirmations", confirmations);
     result.pushKV("height", blockindex->nHeight);
     result.pushKV("version", blockindex->nVersion);
     result.pushKV("merkleroot", blockindex->hashMerkleRoot.GetHex());
     result.pushKV("time", (int64_t)blockindex->nTime);
     result.pushKV("nonce", blockindex->nNonce.GetHex());
-    result.pushKV("solution", HexStr(blockindex->nSolution));
+    result.pushKV("solution", HexStr(blockindex->GetSolution()));
     result.pushKV("bits", strprintf("%08x", blockindex->nBits));
     result.pushKV("difficulty", GetDifficulty(blockindex));
     result.pushKV("chainwork", blockindex->nChainWork.GetHex());
@@ -139,20 +151,20 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 
     if (blockindex->pprev)
         result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    CBlockIndex *pnext = chain.Next(blockindex);
     if (pnext)
         result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
     return result;
 }
 
-UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
+UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex, const CChain& chain = chainActive)
 {
     UniValue result(UniValue::VOBJ);
     result.pushKV("hash", block.GetHash().GetHex());
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex)) {
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
+    if (chain.Contains(blockindex)) {
+        confirmations = chain.Height() - blockindex->nHeight + 1;
     } else {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block is an orphan");
     }
@@ -245,80 +257,94 @@ UniValue blockToDeltasJSON(const CBlock& block, const CBlockIndex* blockindex)
 
     if (blockindex->pprev)
         result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+    CBlockIndex *pnext = chain.Next(blockindex);
     if (pnext)
         result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+/**
+ * The members of the json object of a block, written into the object open in writer: the transactions and the
+ * certificates, the largest part of a block, are converted and written one by one
+ */
+static void blockMembersToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails, const CChain& chain,
+                               JSONWriter& writer)
 {
-    UniValue result(UniValue::VOBJ);
-    result.pushKV("hash", block.GetHash().GetHex());
+    writer.KeyValue("hash", block.GetHash().GetHex());
     int confirmations = -1;
     // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
-
-    result.pushKV("confirmations", confirmations);
-    result.pushKV("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
-    result.pushKV("height", blockindex->nHeight);
-    result.pushKV("version", block.nVersion);
-    result.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
-    result.pushKV("scTxsCommitment", block.hashScTxsCommitment.GetHex());
-
-    UniValue txs(UniValue::VARR);
+    if (chain.Contains(blockindex))
+        confirmations = chain.Height() - blockindex->nHeight + 1;
+
+    writer.KeyValue("confirmations", confirmations);
+    writer.KeyValue("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    writer.KeyValue("height", blockindex->nHeight);
+    writer.KeyValue("version", block.nVersion);
+    writer.KeyValue("merkleroot", block.hashMerkleRoot.GetHex());
+    writer.KeyValue("scTxsCommitment", block.hashScTxsCommitment.GetHex());
+
+    writer.Key("tx");
+    writer.BeginArray();
     BOOST_FOREACH(const CTransaction&tx, block.vtx)
     {
         if(txDetails)
         {
             UniValue objTx(UniValue::VOBJ);
             TxToJSON(tx, uint256(), objTx);
-            txs.push_back(objTx);
+            writer.Value(objTx);
         }
         else
-            txs.push_back(tx.GetHash().GetHex());
+            writer.Value(tx.GetHash().GetHex());
     }
+    writer.EndArray();
 
-    result.pushKV("tx", txs);
     if (block.nVersion == BLOCK_VERSION_SC_SUPPORT)
     {
-        UniValue certs(UniValue::VARR);
+        writer.Key("cert");
+        writer.BeginArray();
         BOOST_FOREACH(const CScCertificate& cert, block.vcert)
         {
             if(txDetails)
             {
                 UniValue objCert(UniValue::VOBJ);
                 CertToJSON(cert, uint256(), objCert);
-                certs.push_back(objCert);
+                writer.Value(objCert);
             }
             else
             {
-                certs.push_back(cert.GetHash().GetHex());
+                writer.Value(cert.GetHash().GetHex());
             }
         }
-        result.pushKV("cert", certs);
+        writer.EndArray();
     }
 
-    result.pushKV("time", block.GetBlockTime());
-    result.pushKV("nonce", block.nNonce.GetHex());
-    result.pushKV("solution", HexStr(block.nSolution));
-    result.pushKV("bits", strprintf("%08x", block.nBits));
-    result.pushKV("difficulty", GetDifficulty(blockindex));
-    result.pushKV("chainwork", blockindex->nChainWork.GetHex());
-    result.pushKV("anchor", blockindex->hashAnchorEnd.GetHex());
-    result.pushKV("scCumTreeHash", blockindex->scCumTreeHash.GetHexRepr());
+    writer.KeyValue("time", block.GetBlockTime());
+    writer.KeyValue("nonce", block.nNonce.GetHex());
+    writer.KeyValue("solution", HexStr(block.nSolution));
+    writer.KeyValue("bits", strprintf("%08x", block.nBits));
+    writer.KeyValue("difficulty", GetDifficulty(blockindex));
+    writer.KeyValue("chainwork", blockindex->nChainWork.GetHex());
+    writer.KeyValue("anchor", blockindex->hashAnchorEnd.GetHex());
+    writer.KeyValue("scCumTreeHash", blockindex->scCumTreeHash.GetHexRepr());
 
     UniValue valuePools(UniValue::VARR);
     valuePools.push_back(ValuePoolDesc("sprout", blockindex->nChainSproutValue, blockindex->nSproutValue));
-    result.pushKV("valuePools", valuePools);
+    writer.KeyValue("valuePools", valuePools);
 
     if (blockindex->pprev)
-        result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+        writer.KeyValue("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
+    CBlockIndex *pnext = chain.Next(blockindex);
     if (pnext)
-        result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
-    return result;
+        writer.KeyValue("nextblockhash", pnext->GetBlockHash().GetHex());
+}
+
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false, const CChain& chain = chainActive)
+{
+    JSONTreeWriter writer;
+    writer.BeginObject();
+    blockMembersToJSON(block, blockindex, txDetails, chain, writer);
+    writer.EndObject();
+    return writer.GetValue();
 }
 
 UniValue getblockcount(const UniValue& params, bool fHelp)
@@ -459,18 +485,29 @@ UniValue mempoolToJSON(bool fVerbose = false)
 
 UniValue getrawmempool(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() > 1)
+    if (fHelp || params.size() > 2)
         throw runtime_error(
-            "getrawmempool ( verbose )\n"
+            "getrawmempool ( verbose mempool_sequence )\n"
             "\nReturns all transaction ids in memory pool as a json array of string transaction ids.\n"
             
             "\nArguments:\n"
             "1. verbose                   (boolean, optional, default=false) true for a json object, false for array of transaction ids\n"
+            "2. mempool_sequence          (boolean, optional, default=false) with verbose = false, also return the mempool sequence:\n"
+            "                             the changes notified by -zmqpubsequence after the ids returned are those with a greater one\n"
             "\nResult:                    (for verbose = false):\n"
             "[                            (json array of string)\n"
             "  \"transactionid\"          (string) the transaction id\n"
             "  ,...\n"
             "]\n"
+
+            "\nResult: (for verbose = false and mempool_sequence = true):\n"
+            "{                             (json object)\n"
+            "  \"txids\": [                (json array of string)\n"
+            "    \"transactionid\"         (string) the transaction id\n"
+            "    ,...\n"
+            "  ],\n"
+            "  \"mempool_sequence\": n     (numeric) the sequence of the last change of the mempool\n"
+            "}\n"
             
             "\nResult: (for verbose = true):\n"
             "{                             (json object)\n"
@@ -489,6 +526,7 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
             
             "\nExamples\n"
             + HelpExampleCli("getrawmempool", "true")
+            + HelpExampleCli("getrawmempool", "false true")
             + HelpExampleRpc("getrawmempool", "true")
         );
 
@@ -497,6 +535,20 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
     bool fVerbose = false;
     if (params.size() > 0)
         fVerbose = params[0].get_bool();
+    bool fMempoolSequence = false;
+    if (params.size() > 1)
+        fMempoolSequence = params[1].get_bool();
+    if (fVerbose && fMempoolSequence)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbose results cannot contain mempool sequence values");
+
+    if (fMempoolSequence) {
+        // the ids and the sequence of the same state of the mempool
+        LOCK(mempool.cs);
+        UniValue o(UniValue::VOBJ);
+        o.pushKV("txids", mempoolToJSON(false));
+        o.pushKV("mempool_sequence", mempool.GetSequence());
+        return o;
+    }
 
     return mempoolToJSON(fVerbose);
 }
@@ -526,19 +578,25 @@ UniValue getblockdeltas(const UniValue& params, bool fHelp)
     std::string strHash = params[0].get_str();
     uint256 hash(uint256S(strHash));
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    CChainSnapshot chain;
+    CBlockIndex* pblockindex = NULL;
+    {
+        LOCK(cs_main);
+        if (mapBlockIndex.count(hash) == 0)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+        pblockindex = mapBlockIndex[hash];
 
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+        chain.SetTip(chainActive.Tip());
+    }
 
+    CBlock block;
     if(!ReadBlockFromDisk(block, pblockindex))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
-    return blockToDeltasJSON(block, pblockindex);
+    return blockToDeltasJSON(block, pblockindex, chain);
 }
 
 UniValue getblockhashes(const UniValue& params, bool fHelp)
@@ -546,7 +604,8 @@ UniValue getblockhashes(const UniValue& params, bool fHelp)
     if (fHelp || params.size() < 2)
         throw runtime_error(
             "getblockhashes timestamp\n"
-            "\nReturns array of hashes of blocks within the timestamp range provided (requires timestampindex to be enabled).\n"
+            "\nReturns array of hashes of blocks within the timestamp range provided.\n"
+            "Without the timestampindex, or while it is being built, only the blocks of the main chain are returned.\n"
             "\nArguments:\n"
             "1. high         (numeric, required) The newer block timestamp\n"
             "2. low          (numeric, required) The older block timestamp\n"
@@ -571,10 +630,6 @@ UniValue getblockhashes(const UniValue& params, bool fHelp)
             HelpExampleCli("getblockhashes", "1231614698 1231024505 '{\"noOrphans\":false, \"logicalTimes\":true}'") + 
             HelpExampleRpc("getblockhashes", "1231614698, 1231024505, {\"noOrphans\":false, \"logicalTimes\":true}"));
 
-    if (!fTimestampIndex) {
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "timestampindex not enabled");
-    }
-
     unsigned int high = params[0].get_int();
     unsigned int low = params[1].get_int();
     bool fActiveOnly = false;
@@ -595,11 +650,18 @@ UniValue getblockhashes(const UniValue& params, bool fHelp)
 
     std::vector<std::pair<uint256, unsigned int> > blockHashes;
 
-    if (fActiveOnly)
-        LOCK(cs_main);
+    if (fTimestampIndex && pTimestampIndexer != NULL && pTimestampIndexer->IsCaughtUp()) {
+        pTimestampIndexer->SyncWithTip();
+
+        if (fActiveOnly)
+            LOCK(cs_main);
 
-    if (!GetTimestampIndex(high, low, fActiveOnly, blockHashes)) {
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
+        if (!GetTimestampIndex(high, low, fActiveOnly, blockHashes)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
+        }
+    } else {
+        LOCK(cs_main);
+        timestampRangeQuery.Query(high, low, blockHashes);
     }
 
     UniValue result(UniValue::VARR);
@@ -697,16 +759,56 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
 
     if (!fVerbose)
     {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << pblockindex->GetBlockHeader();
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        return *headerCache.GetHex(pblockindex);
     }
 
     return blockheaderToJSON(pblockindex);
 }
 
-UniValue getblock(const UniValue& params, bool fHelp)
+/**
+ * The block of strHash, a hash or a height, for the RPCs reading a block to do it outside cs_main, which only
+ * the lookups need: chain is set to a snapshot of the active chain, for the block to be converted against it
+ */
+static CBlockIndex* LookupBlock(std::string strHash, CChainSnapshot& chain)
+{
+    LOCK(cs_main);
+    chain.SetTip(chainActive.Tip());
+
+    // If height is supplied, find the hash
+    if (strHash.size() < (2 * sizeof(uint256))) {
+        // std::stoi allows characters, whereas we want to be strict
+        regex r("[[:digit:]]+");
+        if (!regex_match(strHash, r)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
+        }
+
+        int nHeight = -1;
+        try {
+            nHeight = std::stoi(strHash);
+        }
+        catch (const std::exception &e) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
+        }
+
+        if (nHeight < 0 || nHeight > chain.Height()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
+        }
+        strHash = chain[nHeight]->GetBlockHash().GetHex();
+    }
+
+    uint256 hash(uint256S(strHash));
+
+    if (mapBlockIndex.count(hash) == 0)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+    CBlockIndex* pblockindex = mapBlockIndex[hash];
+
+    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+    return pblockindex;
+}
+
+void getblock_stream(const UniValue& params, bool fHelp, JSONWriter& writer)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
@@ -769,34 +871,8 @@ UniValue getblock(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblock", "height")
         );
 
-    LOCK(cs_main);
-
     std::string strHash = params[0].get_str();
 
-    // If height is supplied, find the hash
-    if (strHash.size() < (2 * sizeof(uint256))) {
-        // std::stoi allows characters, whereas we want to be strict
-        regex r("[[:digit:]]+");
-        if (!regex_match(strHash, r)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
-
-        int nHeight = -1;
-        try {
-            nHeight = std::stoi(strHash);
-        }
-        catch (const std::exception &e) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
-
-        if (nHeight < 0 || nHeight > chainActive.Height()) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
-        }
-        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
-    }
-
-    uint256 hash(uint256S(strHash));
-
     int verbosity = 1;
     if (params.size() > 1) {
         if(params[1].isNum()) {
@@ -810,30 +886,37 @@ UniValue getblock(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 0 to 2");
     }
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-
+    CChainSnapshot chain;
+    CBlockIndex* pblockindex = LookupBlock(strHash, chain);
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
 
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+    if (verbosity == 0)
+    {
+        // the bytes stored on disk, there is no need to deserialize the block
+        CRawBlock rawBlock;
+        if (!ReadRawBlockFromDisk(rawBlock, pblockindex))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+        std::string strHex = HexStr(rawBlock.begin(), rawBlock.end());
+        writer.Value(strHex);
+        return;
+    }
 
     if(!ReadBlockFromDisk(block, pblockindex))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
-    if (verbosity == 0)
-    {
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
-    }
+    writer.BeginObject();
+    blockMembersToJSON(block, pblockindex, verbosity >= 2, chain, writer);
+    writer.EndObject();
+}
 
-    return blockToJSON(block, pblockindex, verbosity >= 2);
+UniValue getblock(const UniValue& params, bool fHelp)
+{
+    JSONTreeWriter writer;
+    getblock_stream(params, fHelp, writer);
+    return writer.GetValue();
 }
 
-UniValue getblockexpanded(const UniValue& params, bool fHelp)
+void getblockexpanded_stream(const UniValue& params, bool fHelp, JSONWriter& writer)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
@@ -908,8 +991,6 @@ UniValue getblockexpanded(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockexpanded", "height")
         );
 
-    LOCK(cs_main);
-
     std::string strHash = params[0].get_str();
 
     if (!fMaturityHeightIndex)
@@ -917,30 +998,6 @@ UniValue getblockexpanded(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_TYPE_ERROR, "maturityHeightIndex option not set: can not retrieve info");
     }
 
-    // If height is supplied, find the hash
-    if (strHash.size() < (2 * sizeof(uint256))) {
-        // std::stoi allows characters, whereas we want to be strict
-        regex r("[[:digit:]]+");
-        if (!regex_match(strHash, r)) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
-
-        int nHeight = -1;
-        try {
-            nHeight = std::stoi(strHash);
-        }
-        catch (const std::exception &e) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid block height parameter");
-        }
-
-        if (nHeight < 0 || nHeight > chainActive.Height()) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
-        }
-        strHash = chainActive[nHeight]->GetBlockHash().GetHex();
-    }
-
-    uint256 hash(uint256S(strHash));
-
     int verbosity = 1;
     if (params.size() > 1) {
         if(params[1].isNum()) {
@@ -954,19 +1011,15 @@ UniValue getblockexpanded(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbosity must be in range from 1 to 2");
     }
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-
+    CChainSnapshot chain;
+    CBlockIndex* pblockindex = LookupBlock(strHash, chain);
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
-
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
 
     if(!ReadBlockFromDisk(block, pblockindex))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
-    UniValue blockJSON = blockToJSON(block, pblockindex, verbosity >= 2);
+    writer.BeginObject();
+    blockMembersToJSON(block, pblockindex, verbosity >= 2, chain, writer);
     
     //Add certificates that became mature with this block    
     if (block.nVersion == BLOCK_VERSION_SC_SUPPORT)
@@ -1002,9 +1055,16 @@ UniValue getblockexpanded(const UniValue& params, bool fHelp)
                 matureCertificate.push_back(key.certId.GetHex());
             }
         }
-        blockJSON.pushKV("matureCertificate", matureCertificate);
+        writer.KeyValue("matureCertificate", matureCertificate);
     }
-    return blockJSON;
+    writer.EndObject();
+}
+
+UniValue getblockexpanded(const UniValue& params, bool fHelp)
+{
+    JSONTreeWriter writer;
+    getblockexpanded_stream(params, fHelp, writer);
+    return writer.GetValue();
 }
 
 UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
@@ -1013,7 +1073,7 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
         throw runtime_error(
             "gettxoutsetinfo\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "Note this call may take some time, unless the node runs with -coinscommitment.\n"
             
             "\nResult:\n"
             "{\n"
@@ -1022,8 +1082,13 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
             "  \"transactions\": n,             (numeric) the number of transactions\n"
             "  \"txouts\": n,                   (numeric) the number of output transactions\n"
             "  \"bytes_serialized\": n,         (numeric) the serialized size\n"
-            "  \"hash_serialized\": \"hash\",   (string) the serialized hash\n"
-            "  \"total_amount\": xxxx           (numeric) the total amount\n"
+            "  \"hash_serialized\": \"hash\",   (string) the MuHash of the serialized unspent outputs\n"
+            "  \"total_amount\": xxxx,          (numeric) the total amount\n"
+            "  \"cswnullifierfilter\": {        (object) the in-memory filter of the spent CSW nullifiers, if enabled\n"
+            "     \"elements\": n,              (numeric) the number of nullifiers inserted into the filter\n"
+            "     \"usage\": n,                 (numeric) the memory used by the filter, in bytes\n"
+            "     \"fprate\": x.xxx             (numeric) the estimated false positive rate of the filter\n"
+            "  }\n"
             "}\n"
             
             "\nExamples:\n"
@@ -1043,10 +1108,147 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
         ret.pushKV("bytes_serialized", (int64_t)stats.nSerializedSize);
         ret.pushKV("hash_serialized", stats.hashSerialized.GetHex());
         ret.pushKV("total_amount", ValueFromAmount(stats.nTotalAmount));
+        if (GetBoolArg("-cswnullifierfilter", DEFAULT_CSW_NULLIFIER_FILTER)) {
+            UniValue filter(UniValue::VOBJ);
+            filter.pushKV("elements", (int64_t)stats.nCswNullifierFilterElements);
+            filter.pushKV("usage", (int64_t)stats.nCswNullifierFilterUsage);
+            filter.pushKV("fprate", stats.dCswNullifierFilterFPRate);
+            ret.pushKV("cswnullifierfilter", filter);
+        }
     }
     return ret;
 }
 
+UniValue dumptxoutset(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrites the chainstate at the current tip to a snapshot file, which can be loaded by loadtxoutset.\n"
+            "Note this call may take some time.\n"
+
+            "\nArguments:\n"
+            "1. \"path\"                      (string, required) the file to write; relative paths are relative to the data directory\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"records\": n,                  (numeric) the number of database records written\n"
+            "  \"base_hash\": \"hash\",         (string) the hash of the block of the snapshot\n"
+            "  \"base_height\": n,              (numeric) the height of the block of the snapshot\n"
+            "  \"path\": \"path\",              (string) the absolute path of the snapshot file\n"
+            "  \"hash_serialized\": \"hash\",   (string) the MuHash of the unspent outputs, as reported by gettxoutsetinfo\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("dumptxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("dumptxoutset", "\"utxo.dat\"")
+        );
+
+    boost::filesystem::path path = boost::filesystem::absolute(params[0].get_str(), GetDataDir());
+    boost::filesystem::path temppath = path.string() + ".incomplete";
+    if (boost::filesystem::exists(path) || boost::filesystem::exists(temppath))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+
+    // The tip cannot move while the snapshot is taken
+    LOCK(cs_main);
+    FlushStateToDisk();
+
+    CTxOutSetSnapshotHeader header;
+    memcpy(header.pchMessageStart, Params().MessageStart(), sizeof(header.pchMessageStart));
+    header.hashBlock = chainActive.Tip()->GetBlockHash();
+    header.nHeight = chainActive.Height();
+    header.nChainTx = chainActive.Tip()->nChainTx;
+
+    uint64_t nRecords = 0;
+    {
+        CAutoFile fileout(fopen(temppath.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+        if (fileout.IsNull())
+            throw JSONRPCError(RPC_MISC_ERROR, "Cannot open " + temppath.string() + " for writing");
+
+        try {
+            if (!pcoinsdbview->DumpSnapshot(fileout, header, nRecords))
+                throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the chainstate database");
+            FileCommit(fileout.Get());
+        } catch (const std::ios_base::failure& e) {
+            fileout.fclose();
+            boost::filesystem::remove(temppath);
+            throw JSONRPCError(RPC_MISC_ERROR, std::string("Failed to write the snapshot: ") + e.what());
+        } catch (const UniValue&) {
+            fileout.fclose();
+            boost::filesystem::remove(temppath);
+            throw;
+        }
+    }
+    RenameOver(temppath, path);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("records", (int64_t)nRecords);
+    ret.pushKV("base_hash", header.hashBlock.GetHex());
+    ret.pushKV("base_height", header.nHeight);
+    ret.pushKV("path", path.string());
+    ret.pushKV("hash_serialized", header.hashSerialized.GetHex());
+    return ret;
+}
+
+UniValue loadtxoutset(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 2)
+        throw runtime_error(
+            "loadtxoutset \"path\" ( \"expectedhash\" )\n"
+            "\nReplaces the chainstate with a snapshot written by dumptxoutset and moves the tip to its block.\n"
+            "The node must have no blocks yet, run without block indexes, and know the header of the snapshot block.\n"
+            "The blocks up to the snapshot are neither downloaded nor validated: the snapshot is trusted, so its\n"
+            "hash_serialized should be checked against a trusted source, by passing it as expectedhash.\n"
+            "As the chain up to the snapshot is never validated, this is available in -regtest mode or with -unsafeloadtxoutset only.\n"
+
+            "\nArguments:\n"
+            "1. \"path\"                      (string, required) the snapshot file; relative paths are relative to the data directory\n"
+            "2. \"expectedhash\"              (string, optional) the hash_serialized the snapshot must have\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"base_hash\": \"hash\",         (string) the hash of the block of the snapshot, now the tip\n"
+            "  \"base_height\": n,              (numeric) the height of the block of the snapshot\n"
+            "  \"hash_serialized\": \"hash\",   (string) the verified MuHash of the unspent outputs\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("loadtxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("loadtxoutset", "\"utxo.dat\"")
+        );
+
+    // The chain up to the snapshot is not validated in the background, the snapshot would be trusted forever
+    if (!Params().MineBlocksOnDemand() && !GetBoolArg("-unsafeloadtxoutset", false))
+        throw runtime_error("loadtxoutset is for -regtest mode only, unless -unsafeloadtxoutset is set");
+
+    boost::filesystem::path path = boost::filesystem::absolute(params[0].get_str(), GetDataDir());
+    CAutoFile filein(fopen(path.string().c_str(), "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot open " + path.string());
+
+    CTxOutSetSnapshotHeader header;
+    try {
+        filein >> header;
+    } catch (const std::exception&) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Cannot read the snapshot header");
+    }
+
+    if (params.size() > 1 && header.hashSerialized != ParseHashV(params[1], "expectedhash"))
+        throw JSONRPCError(RPC_VERIFY_ERROR, "The snapshot hash " + header.hashSerialized.GetHex() + " is not the expected one");
+
+    LOCK(cs_main);
+    std::string strError;
+    if (!LoadTxOutSetSnapshot(filein, header, strError))
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to load the snapshot: " + strError +
+                           ". If the chainstate was modified, restart with -reindex");
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("base_hash", header.hashBlock.GetHex());
+    ret.pushKV("base_height", header.nHeight);
+    ret.pushKV("hash_serialized", header.hashSerialized.GetHex());
+    return ret;
+}
+
 UniValue gettxout(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 2 || params.size() > 4)
@@ -1104,11 +1306,10 @@ UniValue gettxout(const UniValue& params, bool fHelp)
 
     CCoins coins;
     if (fMempool) {
-        LOCK(mempool.cs);
-        CCoinsViewMemPool view(pcoinsTip, mempool);
+        CCoinsViewMemPoolSnapshot view(pcoinsTip, mempool);
         if (!view.GetCoins(hash, coins))
             return NullUniValue;
-        mempool.pruneSpent(hash, coins); // TODO: this should be done by the CCoinsViewMemPool
+        view.PruneSpent(hash, coins);
     } else {
         if (!pcoinsTip->GetCoins(hash, coins))
             return NullUniValue;
@@ -1229,6 +1430,14 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
             "  \"verificationprogress\": xxxx,  (numeric) estimate of verification progress [0..1]\n"
             "  \"chainwork\": \"xxxx\"          (string) total amount of work in active chain, in hexadecimal\n"
             "  \"commitments\": xxxxxx,         (numeric) the current number of note commitments in the commitment tree\n"
+            "  \"startupverification\": {       (object) the verification of the last blocks at startup, -checkblocks\n"
+            "     \"state\": \"xxxx\",          (string) \"none\", \"running\", \"background\", \"done\", \"stopped\" (by -checkblocksseconds or the chain moving on) or \"failed\"\n"
+            "     \"level\": xx,              (numeric) the -checklevel\n"
+            "     \"blocks\": xx,             (numeric) the blocks to verify\n"
+            "     \"checked\": xx,            (numeric) the blocks read and checked, with their undo data\n"
+            "     \"disconnected\": xx,       (numeric) the blocks disconnected from the coins database (level 3)\n"
+            "     \"reconnected\": xx         (numeric) the blocks connected again (level 4)\n"
+            "  },\n"
             "  \"softforks\": [                 (array) status of softforks in progress\n"
             "     {\n"
             "        \"id\": \"xxxx\",          (string) name of softfork\n"
@@ -1265,6 +1474,15 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
     pcoinsTip->GetAnchorAt(pcoinsTip->GetBestAnchor(), tree);
     obj.pushKV("commitments",           tree.size());
 
+    UniValue verification(UniValue::VOBJ);
+    verification.pushKV("state",        verifyDBProgress.strState);
+    verification.pushKV("level",        verifyDBProgress.nCheckLevel);
+    verification.pushKV("blocks",       verifyDBProgress.nCheckDepth);
+    verification.pushKV("checked",      verifyDBProgress.nBlocksChecked);
+    verification.pushKV("disconnected", verifyDBProgress.nBlocksDisconnected);
+    verification.pushKV("reconnected",  verifyDBProgress.nBlocksReconnected);
+    obj.pushKV("startupverification",   verification);
+
     CBlockIndex* tip = chainActive.Tip();
     UniValue valuePools(UniValue::VARR);
     valuePools.push_back(ValuePoolDesc("sprout", tip->nChainSproutValue, std::nullopt));
@@ -1414,6 +1632,10 @@ UniValue mempoolInfoToJSON()
     ret.pushKV("size", (int64_t) mempool.size());
     ret.pushKV("bytes", (int64_t) mempool.GetTotalSize());
     ret.pushKV("usage", (int64_t) mempool.DynamicMemoryUsage());
+    ret.pushKV("sharedusage", (int64_t) mempool.SharedMemoryUsage());
+    size_t maxmempool = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
+    ret.pushKV("maxmempool", (int64_t) maxmempool);
+    ret.pushKV("mempoolminfee", ValueFromAmount(mempool.GetMinFee(maxmempool).GetFeePerK()));
 
     if (Params().NetworkIDString() == "regtest") {
         ret.pushKV("fullyNotified", mempool.IsFullyNotified());
@@ -1434,6 +1656,9 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
             "  \"size\": xxxxx                (numeric) current tx count\n"
             "  \"bytes\": xxxxx               (numeric) sum of all tx sizes\n"
             "  \"usage\": xxxxx               (numeric) total memory usage for the mempool\n"
+            "  \"sharedusage\": xxxxx         (numeric) memory not duplicated by sharing the txes with the wallet notification queue\n"
+            "  \"maxmempool\": xxxxx          (numeric) maximum memory usage for the mempool\n"
+            "  \"mempoolminfee\": xxxxx       (numeric) minimum fee for a tx to be accepted\n"
             "}\n"
             
             "\nExamples:\n"
@@ -1444,6 +1669,203 @@ UniValue getmempoolinfo(const UniValue& params, bool fHelp)
     return mempoolInfoToJSON();
 }
 
+static UniValue sigCacheStatsToJSON(const SigCacheStats& stats)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("entries", stats.nEntries));
+    ret.push_back(Pair("hits", stats.nHits));
+    ret.push_back(Pair("misses", stats.nMisses));
+    const uint64_t nLookups = stats.nHits + stats.nMisses;
+    ret.push_back(Pair("hitrate", nLookups ? (double)stats.nHits / nLookups : 0.0));
+    ret.push_back(Pair("inserts", stats.nInserts));
+    ret.push_back(Pair("evictions", stats.nEvictions));
+    return ret;
+}
+
+UniValue getsigcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getsigcacheinfo\n"
+            "\nReturns details on the usage of the signature cache and of the script execution cache.\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"entries\": xxxxx             (numeric) number of signatures the cache can hold (see -maxsigcachesize)\n"
+            "  \"hits\": xxxxx                (numeric) signature checks answered by the cache\n"
+            "  \"misses\": xxxxx              (numeric) signature checks not found in the cache\n"
+            "  \"hitrate\": xxxxx             (numeric) ratio of hits over the lookups, 0 when there were none\n"
+            "  \"inserts\": xxxxx             (numeric) signatures added to the cache\n"
+            "  \"evictions\": xxxxx           (numeric) signatures dropped to make room for the added ones\n"
+            "  \"scriptexecution\": {         (json object) the same details for the cache of the transactions and certificates\n"
+            "    ...                          whose input scripts are valid, looked up when connecting blocks\n"
+            "  }\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getsigcacheinfo", "")
+            + HelpExampleRpc("getsigcacheinfo", "")
+        );
+
+    SigCacheStats stats;
+    GetSignatureCacheStats(stats);
+    UniValue ret = sigCacheStatsToJSON(stats);
+
+    GetScriptExecutionCacheStats(stats);
+    ret.push_back(Pair("scriptexecution", sigCacheStatsToJSON(stats)));
+    return ret;
+}
+
+UniValue percentilesToJSON(std::vector<int64_t> values, const std::string& strSuffix)
+{
+    UniValue ret(UniValue::VOBJ);
+    if (values.empty())
+        return ret;
+    std::sort(values.begin(), values.end());
+    const int64_t nTotal = std::accumulate(values.begin(), values.end(), (int64_t)0);
+    auto percentile = [&values](int p) { return values[(values.size() * p + 99) / 100 - 1]; };
+    ret.push_back(Pair("avg" + strSuffix, nTotal / (int64_t)values.size()));
+    ret.push_back(Pair("p50" + strSuffix, percentile(50)));
+    ret.push_back(Pair("p90" + strSuffix, percentile(90)));
+    ret.push_back(Pair("p99" + strSuffix, percentile(99)));
+    ret.push_back(Pair("max" + strSuffix, values.back()));
+    return ret;
+}
+
+UniValue getblockconnectstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "getblockconnectstats ( nblocks )\n"
+            "\nReturns percentile summaries of the time spent on each stage of connecting the last blocks to the tip\n"
+            "(at most -blockconnectstats are kept), and of their content. The percentiles are by nearest rank.\n"
+
+            "\nArguments:\n"
+            "1. nblocks                        (numeric, optional) only the last nblocks connected\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"blocks\": n,                   (numeric) the blocks connected summarized\n"
+            "  \"firstheight\": n,              (numeric) the height of the first of them, when any\n"
+            "  \"lastheight\": n,               (numeric) the height of the last of them, when any\n"
+            "  \"stages\": {                    (json object) the time of each stage, in microseconds\n"
+            "    \"stage\": {                   (json object) readfromdisk, preproc, connect, verify, commtree, batchverify,\n"
+            "                                   index, callbacks, connecttotal, flush, chainstate, mempoolremoval,\n"
+            "                                   postconnect, total\n"
+            "      \"avgus\": n,                (numeric) the average\n"
+            "      \"p50us\": n,                (numeric) the median\n"
+            "      \"p90us\": n,                (numeric) the 90th percentile\n"
+            "      \"p99us\": n,                (numeric) the 99th percentile\n"
+            "      \"maxus\": n                 (numeric) the longest\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"content\": {                   (json object) the same summaries (avg, p50, p90, p99, max) of the\n"
+            "    \"item\": { ... }, ...         txs, certs, inputs, csws and sidechains of the blocks\n"
+            "  },\n"
+            "  \"disconnects\": n,              (numeric) the blocks disconnected from the tip, among the last ones kept\n"
+            "  \"disconnecttime\": { ... },     (json object) the summary of the time to disconnect them, in microseconds\n"
+            "  \"disconnectreadtime\": { ... }, (json object) the summary of the time to load their blocks and undo data\n"
+            "  \"disconnectsfromcache\": n      (numeric) the disconnects whose block and undo data were in the reorg cache\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getblockconnectstats", "")
+            + HelpExampleCli("getblockconnectstats", "100")
+            + HelpExampleRpc("getblockconnectstats", "100")
+        );
+
+    std::vector<CBlockConnectStats> vAll;
+    GetBlockConnectStats(vAll);
+
+    std::vector<CBlockConnectStats> vStats, vDisconnects;
+    for (const CBlockConnectStats& stats : vAll)
+        (stats.fDisconnect ? vDisconnects : vStats).push_back(stats);
+    if (params.size() > 0) {
+        const int nBlocks = params[0].get_int();
+        if (nBlocks < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid nblocks, must be non negative");
+        if ((size_t)nBlocks < vStats.size())
+            vStats.erase(vStats.begin(), vStats.end() - nBlocks);
+    }
+
+    typedef std::pair<const char*, int64_t CBlockConnectStats::*> Field;
+    static const std::vector<Field> vStages = {
+        {"readfromdisk", &CBlockConnectStats::nTimeReadFromDisk}, {"preproc", &CBlockConnectStats::nTimePreProc},
+        {"connect", &CBlockConnectStats::nTimeConnect}, {"verify", &CBlockConnectStats::nTimeVerify},
+        {"commtree", &CBlockConnectStats::nTimeCommTree}, {"batchverify", &CBlockConnectStats::nTimeBatchVerify},
+        {"index", &CBlockConnectStats::nTimeIndex}, {"callbacks", &CBlockConnectStats::nTimeCallbacks},
+        {"connecttotal", &CBlockConnectStats::nTimeConnectTotal}, {"flush", &CBlockConnectStats::nTimeFlush},
+        {"chainstate", &CBlockConnectStats::nTimeChainState}, {"mempoolremoval", &CBlockConnectStats::nTimeMempoolRemoval},
+        {"postconnect", &CBlockConnectStats::nTimePostConnect}, {"total", &CBlockConnectStats::nTimeTotal},
+    };
+    typedef std::pair<const char*, unsigned int CBlockConnectStats::*> Count;
+    static const std::vector<Count> vContent = {
+        {"txs", &CBlockConnectStats::nTx}, {"certs", &CBlockConnectStats::nCerts},
+        {"inputs", &CBlockConnectStats::nInputs}, {"csws", &CBlockConnectStats::nCsws},
+        {"sidechains", &CBlockConnectStats::nSidechains},
+    };
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("blocks", (int64_t)vStats.size()));
+    if (!vStats.empty()) {
+        ret.push_back(Pair("firstheight", vStats.front().nHeight));
+        ret.push_back(Pair("lastheight", vStats.back().nHeight));
+    }
+
+    std::vector<int64_t> values;
+    UniValue stages(UniValue::VOBJ);
+    for (const Field& field : vStages) {
+        values.clear();
+        for (const CBlockConnectStats& stats : vStats)
+            values.push_back(stats.*field.second);
+        stages.push_back(Pair(field.first, percentilesToJSON(values, "us")));
+    }
+    ret.push_back(Pair("stages", stages));
+
+    UniValue content(UniValue::VOBJ);
+    for (const Count& count : vContent) {
+        values.clear();
+        for (const CBlockConnectStats& stats : vStats)
+            values.push_back(stats.*count.second);
+        content.push_back(Pair(count.first, percentilesToJSON(values, "")));
+    }
+    ret.push_back(Pair("content", content));
+
+    values.clear();
+    for (const CBlockConnectStats& stats : vDisconnects)
+        values.push_back(stats.nTimeTotal);
+    ret.push_back(Pair("disconnects", (int64_t)vDisconnects.size()));
+    ret.push_back(Pair("disconnecttime", percentilesToJSON(values, "us")));
+    values.clear();
+    for (const CBlockConnectStats& stats : vDisconnects)
+        values.push_back(stats.nTimeReadFromDisk);
+    ret.push_back(Pair("disconnectreadtime", percentilesToJSON(values, "us")));
+    ret.push_back(Pair("disconnectsfromcache", (int64_t)std::count_if(vDisconnects.begin(), vDisconnects.end(),
+                                                   [](const CBlockConnectStats& stats) { return stats.fFromReorgCache; })));
+    return ret;
+}
+
+UniValue savemempool(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "savemempool\n"
+            "\nDumps the mempool to disk, to be loaded again on the next startup.\n"
+
+            "\nResult:\n"
+            "Nothing\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("savemempool", "")
+            + HelpExampleRpc("savemempool", "")
+        );
+
+    if (!DumpMempool())
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to dump mempool to disk");
+
+    return NullUniValue;
+}
+
 UniValue invalidateblock(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -1584,8 +2006,9 @@ static void addScUnconfCcData(const uint256& scId, UniValue& sc)
     // there are no info about bwt requests in sc db, therefore we do not include them neither when they are in mempool
 }
 
+// bIncludeUnconf adds what the mempool has for the sidechain, some of it under mempool.cs
 bool FillScRecordFromInfo(const uint256& scId, const CSidechain& info, CSidechain::State scState, const CCoinsViewCache& scView, 
-    UniValue& sc, bool bOnlyAlive, bool bVerbose)
+    UniValue& sc, bool bOnlyAlive, bool bVerbose, bool bIncludeUnconf = true)
 {
     if (bOnlyAlive && (scState != CSidechain::State::ALIVE))
         return false;
@@ -1618,39 +2041,39 @@ bool FillScRecordFromInfo(const uint256& scId, const CSidechain& info, CSidechai
         sc.pushKV("activeMbtrScFee", ValueFromAmount(certView.mainchainBackwardTransferRequestScFee));
  
         // creation parameters
-        sc.pushKV("mbtrRequestDataLength", info.fixedParams.mainchainBackwardTransferRequestDataLength);
-        sc.pushKV("withdrawalEpochLength", info.fixedParams.withdrawalEpochLength);
-        sc.pushKV("version", info.fixedParams.version);
+        sc.pushKV("mbtrRequestDataLength", info.GetFixedParams().mainchainBackwardTransferRequestDataLength);
+        sc.pushKV("withdrawalEpochLength", info.GetFixedParams().withdrawalEpochLength);
+        sc.pushKV("version", info.GetFixedParams().version);
         sc.pushKV("certSubmissionWindowLength", info.GetCertSubmissionWindowLength());
  
         if (bVerbose)
         {
-            sc.pushKV("certProvingSystem", Sidechain::ProvingSystemTypeToString(info.fixedParams.wCertVk.getProvingSystemType()));
-            sc.pushKV("wCertVk", info.fixedParams.wCertVk.GetHexRepr());
-            sc.pushKV("customData", HexStr(info.fixedParams.customData));
+            sc.pushKV("certProvingSystem", Sidechain::ProvingSystemTypeToString(info.GetFixedParams().wCertVk.getProvingSystemType()));
+            sc.pushKV("wCertVk", info.GetFixedParams().wCertVk.GetHexRepr());
+            sc.pushKV("customData", HexStr(info.GetFixedParams().customData));
 
-            if (info.fixedParams.constant.has_value())
-                sc.pushKV("constant", info.fixedParams.constant->GetHexRepr());
+            if (info.GetFixedParams().constant.has_value())
+                sc.pushKV("constant", info.GetFixedParams().constant->GetHexRepr());
             else
                 sc.pushKV("constant", std::string{"NOT INITIALIZED"});
 
-            if(info.fixedParams.wCeasedVk.has_value())
+            if(info.GetFixedParams().wCeasedVk.has_value())
             {
-                sc.pushKV("cswProvingSystem", Sidechain::ProvingSystemTypeToString(info.fixedParams.wCeasedVk.value().getProvingSystemType()));
-                sc.pushKV("wCeasedVk", info.fixedParams.wCeasedVk.value().GetHexRepr());
+                sc.pushKV("cswProvingSystem", Sidechain::ProvingSystemTypeToString(info.GetFixedParams().wCeasedVk.value().getProvingSystemType()));
+                sc.pushKV("wCeasedVk", info.GetFixedParams().wCeasedVk.value().GetHexRepr());
             }
             else
                 sc.pushKV("wCeasedVk", std::string{"NOT INITIALIZED"});
 
             UniValue arrFieldElementConfig(UniValue::VARR);
-            for(const auto& cfgEntry: info.fixedParams.vFieldElementCertificateFieldConfig)
+            for(const auto& cfgEntry: info.GetFixedParams().vFieldElementCertificateFieldConfig)
             {
                 arrFieldElementConfig.push_back(cfgEntry.getBitSize());
             }
             sc.pushKV("vFieldElementCertificateFieldConfig", arrFieldElementConfig);
 
             UniValue arrBitVectorConfig(UniValue::VARR);
-            for(const auto& cfgEntry: info.fixedParams.vBitVectorCertificateFieldConfig)
+            for(const auto& cfgEntry: info.GetFixedParams().vBitVectorCertificateFieldConfig)
             {
                 UniValue singlePair(UniValue::VARR);
                 singlePair.push_back(cfgEntry.getBitVectorSizeBits());
@@ -1675,43 +2098,51 @@ bool FillScRecordFromInfo(const uint256& scId, const CSidechain& info, CSidechai
         }
         sc.pushKV("immatureAmounts", ia);
 
-        UniValue sf(UniValue::VARR);
-
-        for(const auto& entry: info.scFees)
+        if (bVerbose)
         {
-            UniValue o(UniValue::VOBJ);
-            o.pushKV("forwardTxScFee", ValueFromAmount(entry->forwardTxScFee));
-            o.pushKV("mbtrTxScFee", ValueFromAmount(entry->mbtrTxScFee));
-            std::shared_ptr<Sidechain::ScFeeData_v2> casted_entry = dynamic_pointer_cast<Sidechain::ScFeeData_v2>(entry);
-            if (casted_entry) {
-                o.pushKV("submissionHeight", casted_entry->submissionHeight);
+            UniValue sf(UniValue::VARR);
+
+            for(const auto& entry: info.scFees)
+            {
+                UniValue o(UniValue::VOBJ);
+                o.pushKV("forwardTxScFee", ValueFromAmount(entry.forwardTxScFee));
+                o.pushKV("mbtrTxScFee", ValueFromAmount(entry.mbtrTxScFee));
+                if (info.isNonCeasing()) {
+                    o.pushKV("submissionHeight", entry.submissionHeight);
+                }
+                sf.push_back(std::move(o));
             }
-            sf.push_back(std::move(o));
+
+            sc.pushKV("scFees", sf);
         }
 
-        sc.pushKV("scFees", sf);
+        if (!bIncludeUnconf)
+            return true;
 
         // get unconfirmed data if any
-        if (mempool.hasSidechainCertificate(scId))
+        std::shared_ptr<const CMempoolTopQualityCert> topQualCert = mempool.getTopQualityCert(scId, &info.GetFixedParams());
+        if (topQualCert)
         {
-            const uint256& topQualCertHash    = mempool.mapSidechains.at(scId).GetTopQualityCert()->second;
-            const CScCertificate& topQualCert = mempool.mapCertificate.at(topQualCertHash).GetCertificate();
- 
-            sc.pushKV("unconfTopQualityCertificateEpoch",    topQualCert.epochNumber);
-            sc.pushKV("unconfTopQualityCertificateHash",     topQualCertHash.GetHex());
-            sc.pushKV("unconfTopQualityCertificateQuality",  topQualCert.quality);
-            sc.pushKV("unconfTopQualityCertificateAmount",   ValueFromAmount(topQualCert.GetValueOfBackwardTransfers()));
-            sc.pushKV("unconfTopQualityCertificateDataHash", topQualCert.GetDataHash(info.fixedParams).GetHexRepr());
+            sc.pushKV("unconfTopQualityCertificateEpoch",    topQualCert->epochNumber);
+            sc.pushKV("unconfTopQualityCertificateHash",     topQualCert->hash.GetHex());
+            sc.pushKV("unconfTopQualityCertificateQuality",  topQualCert->quality);
+            sc.pushKV("unconfTopQualityCertificateAmount",   ValueFromAmount(topQualCert->bwtAmount));
+            sc.pushKV("unconfTopQualityCertificateDataHash", topQualCert->dataHash->GetHexRepr());
         }
 
         addScUnconfCcData(scId, sc);
     }
     else
     {
-        if (mempool.hasSidechainCreationTx(scId))
+        // the creation tx is taken from a snapshot of the mempool, which may change meanwhile
+        std::shared_ptr<const CMemPoolCoinsSnapshot> snapshot;
+        if (bIncludeUnconf)
+            snapshot = mempool.GetCoinsSnapshot();
+        const auto itScEntry = snapshot ? snapshot->mapSidechains.find(scId) : std::map<uint256, CSidechainMemPoolEntry>::const_iterator();
+        if (snapshot && itScEntry != snapshot->mapSidechains.end() && !itScEntry->second.scCreationTxHash.IsNull())
         {
-            const uint256& scCreationHash = mempool.mapSidechains.at(scId).scCreationTxHash;
-            const CTransaction & scCreationTx = mempool.mapTx.at(scCreationHash).GetTx();
+            const uint256& scCreationHash = itScEntry->second.scCreationTxHash;
+            const CTransaction & scCreationTx = *snapshot->mapTx.at(scCreationHash);
 
             CSidechain info;
             for (const auto& scCreation : scCreationTx.GetVscCcOut())
@@ -1719,53 +2150,54 @@ bool FillScRecordFromInfo(const uint256& scId, const CSidechain& info, CSidechai
                 if (scId == scCreation.GetScId())
                 {
                     info.creationTxHash = scCreationHash;
-                    info.fixedParams.version = scCreation.version;
-                    info.fixedParams.withdrawalEpochLength = scCreation.withdrawalEpochLength;
-                    info.fixedParams.customData = scCreation.customData;
-                    info.fixedParams.constant = scCreation.constant;
-                    info.fixedParams.wCertVk = scCreation.wCertVk;
-                    info.fixedParams.wCeasedVk = scCreation.wCeasedVk;
-                    info.fixedParams.vFieldElementCertificateFieldConfig = scCreation.vFieldElementCertificateFieldConfig;
-                    info.fixedParams.vBitVectorCertificateFieldConfig = scCreation.vBitVectorCertificateFieldConfig;
+                    Sidechain::ScFixedParameters& fixedParams = info.ModifyFixedParams();
+                    fixedParams.version = scCreation.version;
+                    fixedParams.withdrawalEpochLength = scCreation.withdrawalEpochLength;
+                    fixedParams.customData = scCreation.customData;
+                    fixedParams.constant = scCreation.constant;
+                    fixedParams.wCertVk = scCreation.wCertVk;
+                    fixedParams.wCeasedVk = scCreation.wCeasedVk;
+                    fixedParams.vFieldElementCertificateFieldConfig = scCreation.vFieldElementCertificateFieldConfig;
+                    fixedParams.vBitVectorCertificateFieldConfig = scCreation.vBitVectorCertificateFieldConfig;
                     break;
                 }
             }
 
             sc.pushKV("state", CSidechain::stateToString(CSidechain::State::UNCONFIRMED));
             sc.pushKV("unconfCreatingTxHash", info.creationTxHash.GetHex());
-            sc.pushKV("unconfWithdrawalEpochLength", info.fixedParams.withdrawalEpochLength);
-            sc.pushKV("unconfVersion", info.fixedParams.version);
+            sc.pushKV("unconfWithdrawalEpochLength", info.GetFixedParams().withdrawalEpochLength);
+            sc.pushKV("unconfVersion", info.GetFixedParams().version);
             sc.pushKV("unconfCertSubmissionWindowLength", info.GetCertSubmissionWindowLength());
 
             if (bVerbose)
             {
-                sc.pushKV("unconfCertProvingSystem", Sidechain::ProvingSystemTypeToString(info.fixedParams.wCertVk.getProvingSystemType()));
-                sc.pushKV("unconfWCertVk", info.fixedParams.wCertVk.GetHexRepr());
-                sc.pushKV("unconfCustomData", HexStr(info.fixedParams.customData));
+                sc.pushKV("unconfCertProvingSystem", Sidechain::ProvingSystemTypeToString(info.GetFixedParams().wCertVk.getProvingSystemType()));
+                sc.pushKV("unconfWCertVk", info.GetFixedParams().wCertVk.GetHexRepr());
+                sc.pushKV("unconfCustomData", HexStr(info.GetFixedParams().customData));
 
-                if(info.fixedParams.constant.has_value())
-                    sc.pushKV("unconfConstant", info.fixedParams.constant->GetHexRepr());
+                if(info.GetFixedParams().constant.has_value())
+                    sc.pushKV("unconfConstant", info.GetFixedParams().constant->GetHexRepr());
                 else
                     sc.pushKV("unconfConstant", std::string{"NOT INITIALIZED"});
 
-                if(info.fixedParams.wCeasedVk.has_value())
+                if(info.GetFixedParams().wCeasedVk.has_value())
                 {
                     sc.pushKV("unconfCswProvingSystem",
-                    Sidechain::ProvingSystemTypeToString(info.fixedParams.wCeasedVk.value().getProvingSystemType()));
-                    sc.pushKV("unconfWCeasedVk", info.fixedParams.wCeasedVk.value().GetHexRepr());
+                    Sidechain::ProvingSystemTypeToString(info.GetFixedParams().wCeasedVk.value().getProvingSystemType()));
+                    sc.pushKV("unconfWCeasedVk", info.GetFixedParams().wCeasedVk.value().GetHexRepr());
                 }
                 else
                     sc.pushKV("unconfWCeasedVk", std::string{"NOT INITIALIZED"});
 
                 UniValue arrFieldElementConfig(UniValue::VARR);
-                for(const auto& cfgEntry: info.fixedParams.vFieldElementCertificateFieldConfig)
+                for(const auto& cfgEntry: info.GetFixedParams().vFieldElementCertificateFieldConfig)
                 {
                     arrFieldElementConfig.push_back(cfgEntry.getBitSize());
                 }
                 sc.pushKV("unconfVFieldElementCertificateFieldConfig", arrFieldElementConfig);
 
                 UniValue arrBitVectorConfig(UniValue::VARR);
-                for(const auto& cfgEntry: info.fixedParams.vBitVectorCertificateFieldConfig)
+                for(const auto& cfgEntry: info.GetFixedParams().vBitVectorCertificateFieldConfig)
                 {
                     UniValue singlePair(UniValue::VARR);
                     singlePair.push_back(cfgEntry.getBitVectorSizeBits());
@@ -1799,16 +2231,23 @@ bool FillScRecord(const uint256& scId, UniValue& scRecord, bool bOnlyAlive, bool
     return FillScRecordFromInfo(scId, sidechain, scState, scView, scRecord, bOnlyAlive, bVerbose);
 }
 
-int FillScList(UniValue& scItems, bool bOnlyAlive, bool bVerbose, int from=0, int to=-1)
+/**
+ * Fill scItems with the items [from, to) of the list of the sidechains, in the order of their ids and after the
+ * cursor scid if not null, returning the size of the list. Only the records of the items returned are built.
+ */
+int FillScList(UniValue& scItems, bool bOnlyAlive, bool bVerbose, int from=0, int to=-1, const uint256& cursor = uint256())
 {
     std::set<uint256> sScIds;
+    std::shared_ptr<const CMemPoolCoinsSnapshot> snapshot = mempool.GetCoinsSnapshot();
     {
-        LOCK(mempool.cs);
-        CCoinsViewMemPool scView(pcoinsTip, mempool);
+        CCoinsViewMemPoolSnapshot scView(pcoinsTip, mempool);
 
         scView.GetScIds(sScIds);
     }
 
+    if (!cursor.IsNull())
+        sScIds.erase(sScIds.begin(), sScIds.upper_bound(cursor));
+
     if (sScIds.size() == 0)
         return 0;
 
@@ -1825,43 +2264,41 @@ int FillScList(UniValue& scItems, bool bOnlyAlive, bool bVerbose, int from=0, in
         throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid interval");
     }
 
-    UniValue totalResult(UniValue::VARR);
-    std::set<uint256>::iterator it = sScIds.begin();
-
-    while (it != sScIds.end())
-    {
-        UniValue scRecord(UniValue::VOBJ);
-        if (FillScRecord(*it, scRecord, bOnlyAlive, bVerbose))
-            totalResult.push_back(scRecord);
-        ++it;
+    // the sidechains out of the interval are only checked against the filter, as FillScRecord does,
+    // without building their records
+    CCoinsViewCache scView(pcoinsTip);
+    int totalItems = 0;
+    for (const uint256& scId : sScIds)
+    {
+        CSidechain sidechain;
+        bool bConfirmed = scView.GetSidechain(scId, sidechain);
+        CSidechain::State scState = sidechain.GetState(scView);
+        if (bOnlyAlive && (scState != CSidechain::State::ALIVE))
+            continue;
+        if (!bConfirmed && !snapshot->mapSidechains.count(scId))
+            continue;
+
+        if (totalItems >= from && totalItems < to)
+        {
+            UniValue scRecord(UniValue::VOBJ);
+            if (!FillScRecordFromInfo(scId, sidechain, scState, scView, scRecord, bOnlyAlive, bVerbose))
+                continue;
+            scItems.push_back(scRecord);
+        }
+        totalItems++;
     }
 
     // check consistency of interval in the filtered results list
     // --
-    // 'from' must be in the valid interval
-    if (from > totalResult.size())
+    // 'from' must be in the valid interval, 'to' must be a formally valid upper bound interval number
+    // (positive and greater than 'from') but it is topped anyway to the upper bound value
+    if (from > totalItems)
     {
-        LogPrint("sc", "invalid interval: from[%d] > sz[%d]\n", from, totalResult.size());
+        LogPrint("sc", "invalid interval: from[%d] > sz[%d]\n", from, totalItems);
         throw JSONRPCError(RPC_INVALID_PARAMETER, "invalid interval");
     }
 
-    // 'to' must be a formally valid upper bound interval number (positive and greater than 'from') but it is
-    // topped anyway to the upper bound value 
-    if (to > totalResult.size())
-    {
-        to = totalResult.size();
-    }
-
-    auto vec = totalResult.getValues();
-    auto first = vec.begin() + from;
-    auto last  = vec.begin() + to;
-
-    while (first != last)
-    {
-        scItems.push_back(*first++);
-    }
-
-    return vec.size(); 
+    return totalItems;
 }
 
 void FillCertDataHash(const uint256& scid, UniValue& ret)
@@ -1904,22 +2341,26 @@ void FillCeasingCumScTxCommTree(const uint256& scid, UniValue& ret)
 
 UniValue getscinfo(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() == 0 || params.size() > 5)
+    if (fHelp || params.size() == 0 || params.size() > 6)
         throw runtime_error(
-            "getscinfo (\"scid\" onlyAlive)\n"
+            "getscinfo (\"scid\" onlyAlive verbose from to \"cursor\")\n"
             "\nArguments:\n"
             "1. \"scid\"   (string, mandatory) Retrieve only information about specified scid, \"*\" means all \n"
             "2. onlyAlive (bool, optional, default=false) Retrieve only information for alive sidechains\n"
-            "3. verbose   (bool, optional, default=true) If false include only essential info in result\n"
+            "3. verbose   (bool, optional, default=true) If false include only essential info in result, without the verification keys,\n"
+            "             the custom data and fields configuration and the fee lists\n"
             "   --- meaningful if scid is not specified:\n"
             "4. from      (integer, optional, default=0) If set, limit the starting item index (0-base) in the result array to this entry (included)\n"
             "5. to        (integer, optional, default=-1) If set, limit the ending item index (0-base) in the result array to this entry (excluded) (-1 means max)\n"
+            "6. \"cursor\" (string, optional) If set, the list holds only the sidechains following this scid, in the order of the ids: pass\n"
+            "             the \"nextCursor\" of the previous page for the next one, which stays the same when sidechains are created meanwhile\n"
             "\nReturns side chain info for the given id or for all of the existing sc if the id is not given.\n"
             "\nResult:\n"
             "{\n"
             "  \"totalItems\":            xx,      (numeric) number of items found\n"
             "  \"from\":                  xx,      (numeric) index of the starting item (included in result)\n"
             "  \"to\":                    xx,      (numeric) index of the ending item (excluded in result)\n"
+            "  \"nextCursor\":            xx,      (string)  the scid of the last item, if other items follow it\n"
             "  \"items\":[\n"
             "   {\n"
             "     \"scid\":                               xxxxx,   (string)  sidechain ID\n"
@@ -1969,6 +2410,7 @@ UniValue getscinfo(const UniValue& params, bool fHelp)
             "\nExamples\n"
             + HelpExampleCli("getscinfo", "\"1a3e7ccbfd40c4e2304c3215f76d204e4de63c578ad835510f580d529516a874\"")
             + HelpExampleCli("getscinfo", "\"*\" true false 2 10")
+            + HelpExampleCli("getscinfo", "\"*\" true false 0 100 \"1a3e7ccbfd40c4e2304c3215f76d204e4de63c578ad835510f580d529516a874\"")
             + HelpExampleCli("getscinfo", "\"*\" ")
         );
 
@@ -2027,13 +2469,24 @@ UniValue getscinfo(const UniValue& params, bool fHelp)
         if (params.size() > 4)
             to = params[4].get_int();
 
+        uint256 cursor;
+        if (params.size() > 5)
+        {
+            const std::string& cursorString = params[5].get_str();
+            if (cursorString.size() != 64 || cursorString.find_first_not_of("0123456789abcdefABCDEF", 0) != std::string::npos)
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid cursor format: not an hex scid");
+            cursor.SetHex(cursorString);
+        }
+
         // throws a json rpc exception if the from/to parameters are invalid or out of the range of the
         // retrieved scItems list
-        int tot = FillScList(scItems, bOnlyAlive, bVerbose, from, to);
+        int tot = FillScList(scItems, bOnlyAlive, bVerbose, from, to, cursor);
 
         ret.pushKV("totalItems", tot);
         ret.pushKV("from", from);
         ret.pushKV("to", from + scItems.size());
+        if (!scItems.empty() && from + (int)scItems.size() < tot)
+            ret.pushKV("nextCursor", scItems[scItems.size() - 1]["scid"]);
     }
 
     ret.pushKV("items", scItems);
@@ -2106,6 +2559,127 @@ UniValue getceasingcumsccommtreehash(const UniValue& params, bool fHelp)
     return ret;
 }
 
+UniValue ScActivityEntryToJSON(const CScActivityKey& key, const CScActivityValue& value)
+{
+    UniValue entry(UniValue::VOBJ);
+    entry.pushKV("height", key.blockHeight);
+    entry.pushKV("blockhash", value.blockHash.GetHex());
+    entry.pushKV("type", ScActivityTypeName(key.type));
+    entry.pushKV(key.type == ScActivityType::CERTIFICATE ? "certid" : "txid", key.txid.GetHex());
+    if (key.type != ScActivityType::CERTIFICATE)
+        entry.pushKV("n", (int64_t)key.n);
+
+    const CBitcoinAddress mcAddress{CKeyID(value.mcAddress)};
+    switch (key.type) {
+    case ScActivityType::CREATION:
+        entry.pushKV("value", ValueFromAmount(value.nValue));
+        entry.pushKV("address", value.address.GetHex());
+        break;
+    case ScActivityType::FORWARD_TRANSFER:
+        entry.pushKV("value", ValueFromAmount(value.nValue));
+        entry.pushKV("address", value.address.GetHex());
+        entry.pushKV("mcReturnAddress", mcAddress.ToString());
+        break;
+    case ScActivityType::BWT_REQUEST:
+        entry.pushKV("scFee", ValueFromAmount(value.nValue));
+        entry.pushKV("mcDestinationAddress", mcAddress.ToString());
+        break;
+    case ScActivityType::CSW:
+        entry.pushKV("value", ValueFromAmount(value.nValue));
+        entry.pushKV("nullifier", HexStr(value.vchNullifier));
+        entry.pushKV("mcAddress", mcAddress.ToString());
+        break;
+    case ScActivityType::CERTIFICATE:
+        entry.pushKV("epoch", value.epochNumber);
+        entry.pushKV("quality", value.quality);
+        entry.pushKV("bwtAmount", ValueFromAmount(value.nValue));
+        break;
+    }
+    return entry;
+}
+
+UniValue getscactivity(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 3)
+        throw runtime_error(
+            "getscactivity \"scid\" fromheight toheight\n"
+            "\nReturns the creation, the forward transfers, the backward transfer requests, the ceased sidechain withdrawals\n"
+            "and the certificates of a sidechain in the blocks of the main chain within the height range, the oldest first.\n"
+            "It requires -scindex, and at most " + std::to_string(MAX_SC_ACTIVITY_ENTRIES) + " entries are returned by call.\n"
+            "\nArguments:\n"
+            "1. \"scid\"         (string, required) The sidechain id\n"
+            "2. fromheight     (numeric, required) The height of the first block\n"
+            "3. toheight       (numeric, required) The height of the last block, included\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"scid\": \"scid\",           (string) The sidechain id\n"
+            "  \"fromheight\": n,          (numeric) The height of the first block\n"
+            "  \"toheight\": n,            (numeric) The height of the last block, the tip at most\n"
+            "  \"activity\": [\n"
+            "    {\n"
+            "      \"height\": n,          (numeric) The height of the block\n"
+            "      \"blockhash\": \"hash\",  (string) The hash of the block\n"
+            "      \"type\": \"type\",       (string) creation, forwardtransfer, bwtrequest, csw or certificate\n"
+            "      \"txid\": \"id\",         (string) The transaction, \"certid\" for a certificate\n"
+            "      \"n\": n,               (numeric) The index of the output, or of the csw input, of its type in the transaction\n"
+            "      \"value\": x.xxx,       (numeric) The amount of a creation, a forward transfer or a csw\n"
+            "      \"address\": \"hex\",     (string) The sidechain address of a creation or a forward transfer\n"
+            "      \"mcReturnAddress\": \"address\",      (string) Of a forward transfer\n"
+            "      \"scFee\": x.xxx,                   (numeric) Of a backward transfer request\n"
+            "      \"mcDestinationAddress\": \"address\", (string) Of a backward transfer request\n"
+            "      \"nullifier\": \"hex\",               (string) Of a csw\n"
+            "      \"mcAddress\": \"address\",            (string) The receiver of a csw\n"
+            "      \"epoch\": n, \"quality\": n,         (numeric) Of a certificate\n"
+            "      \"bwtAmount\": x.xxx                (numeric) The backward transfers of a certificate\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getscactivity", "\"1a3e7ccbfd40c4e2304c3215f76d204e4de63c578ad835510f580d529516a874\" 1000 2000")
+            + HelpExampleRpc("getscactivity", "\"1a3e7ccbfd40c4e2304c3215f76d204e4de63c578ad835510f580d529516a874\", 1000, 2000")
+        );
+
+    if (!fScIndex || pScActivityIndexer == NULL)
+        throw JSONRPCError(RPC_MISC_ERROR, "Sidechain activity index not enabled (use -scindex)");
+    if (!pScActivityIndexer->IsCaughtUp())
+        throw JSONRPCError(RPC_MISC_ERROR, "Sidechain activity index still being built");
+
+    string inputString = params[0].get_str();
+    if (inputString.find_first_not_of("0123456789abcdefABCDEF", 0) != std::string::npos)
+        throw JSONRPCError(RPC_TYPE_ERROR, "Invalid scid format: not an hex");
+    uint256 scId;
+    scId.SetHex(inputString);
+
+    const int fromHeight = params[1].get_int();
+    int toHeight = params[2].get_int();
+    if (fromHeight < 0 || toHeight < fromHeight)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid height range");
+    {
+        LOCK(cs_main);
+        toHeight = std::min(toHeight, chainActive.Height());
+    }
+
+    pScActivityIndexer->SyncWithTip();
+    CScActivityIndexer::Entries entries;
+    bool fTruncated = false;
+    if (!CScActivityIndexer::Lookup(scId, fromHeight, toHeight, entries, fTruncated)) {
+        if (fTruncated)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("More than %u entries in the range, split it", MAX_SC_ACTIVITY_ENTRIES));
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Can not read the sidechain activity index");
+    }
+
+    UniValue activity(UniValue::VARR);
+    for (const std::pair<CScActivityKey, CScActivityValue>& entry : entries)
+        activity.push_back(ScActivityEntryToJSON(entry.first, entry.second));
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("scid", scId.GetHex());
+    result.pushKV("fromheight", fromHeight);
+    result.pushKV("toheight", toHeight);
+    result.pushKV("activity", activity);
+    return result;
+}
+
 UniValue getscgenesisinfo(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -2222,7 +2796,7 @@ UniValue getscgenesisinfo(const UniValue& params, bool fHelp)
 
         ScVersionInfo scVersion = {};
         scVersion.sidechainId = cert.GetScId();
-        scVersion.sidechainVersion = sc.fixedParams.version;
+        scVersion.sidechainVersion = sc.GetFixedParams().version;
 
         vSidechainVersion.push_back(scVersion);
     }
@@ -2300,20 +2874,24 @@ int64_t blocksToOvertakeTarget(const CBlockIndex* forkTip, const CBlockIndex* ta
     int64_t gap = 0;
     const int targetBlockHeight = targetBlock->nHeight;
     const int selectedTipHeight = forkTip->nHeight;
+
+    // during a node's life, there might be many tips in the container, it is not useful
+    // keeping all of them into account for calculating the finality, just consider the most recent ones.
+    // Blocks are ordered by height, stop if we exceed a safe limit in depth, lets say the max age
+    if ((chainActive.Height() - selectedTipHeight) >= MAX_BLOCK_AGE_FOR_FINALITY) {
+        LogPrint("forks", "%s():%d - exiting loop on tips, max age reached: tip h(%d), chain[%d]\n",
+                __func__, __LINE__, selectedTipHeight, chainActive.Height());
+        return LLONG_MAX;
+    }
+
+    // a skip list search, logarithmic in the height whatever the length of the fork
     const int intersectionHeight = chainActive.FindFork(forkTip)->nHeight;
 
     LogPrint("forks", "%s():%d - processing tip h(%d) [%s] forkBaseHeight[%d]\n",
             __func__, __LINE__, forkTip->nHeight, forkTip->GetBlockHash().ToString(),
             intersectionHeight);
 
-    // during a node's life, there might be many tips in the container, it is not useful
-    // keeping all of them into account for calculating the finality, just consider the most recent ones.
-    // Blocks are ordered by height, stop if we exceed a safe limit in depth, lets say the max age
-    if ((chainActive.Height() - selectedTipHeight) >= MAX_BLOCK_AGE_FOR_FINALITY) {
-        LogPrint("forks", "%s():%d - exiting loop on tips, max age reached: forkBaseHeight[%d], chain[%d]\n",
-                __func__, __LINE__, intersectionHeight, chainActive.Height());
-        gap = LLONG_MAX;
-    } else if (intersectionHeight < targetBlockHeight) {
+    if (intersectionHeight < targetBlockHeight) {
         // if the fork base is older than the input block, finality also depends on the current penalty
         // ongoing on the fork
         int64_t forkDelay = forkTip->nChainDelay;
@@ -2503,6 +3081,30 @@ UniValue getproofverifierstats(const UniValue& params, bool fHelp)
         throw runtime_error(
             "getproofverifierstats\n"
             "\nCollects statistics about the sidechain proof verification system.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"pendingCerts\": n,          (numeric) the number of certificate proofs waiting to be verified\n"
+            "  \"pendingCSWs\": n,           (numeric) the number of CSW proofs waiting to be verified\n"
+            "  \"failedCerts\": n,           (numeric) the number of certificate proofs whose verification failed\n"
+            "  \"failedCSWs\": n,            (numeric) the number of CSW proofs whose verification failed\n"
+            "  \"okCerts\": n,               (numeric) the number of certificate proofs correctly verified\n"
+            "  \"okCSWs\": n,                (numeric) the number of CSW proofs correctly verified\n"
+            "  \"batchParameters\": {        (object) the parameters triggering the async batch verification\n"
+            "    \"adaptive\": true|false,   (boolean) whether the parameters are chosen by the adaptive policy\n"
+            "    \"targetLatency\": n,       (numeric) the target latency in milliseconds (0 if adaptive batching is disabled)\n"
+            "    \"batchSize\": n,           (numeric) the number of queued proofs triggering a batch verification\n"
+            "    \"batchDelay\": n,          (numeric) the maximum queue age in milliseconds triggering a batch verification\n"
+            "    \"arrivalRate\": x.xxx,     (numeric) the estimated proof arrival rate (proofs per second)\n"
+            "    \"verificationCost\": {     (object) the estimated verification time of a single proof in milliseconds\n"
+            "      \"provingsystem\": x.xxx  (numeric) per proving system\n"
+            "    }\n"
+            "  },\n"
+            "  \"proofCache\": {             (object) the usage of the cache of verified proofs\n"
+            "    \"hits\": n,                (numeric) the number of certificates/transactions whose proofs were found in the cache\n"
+            "    \"misses\": n,              (numeric) the number of certificates/transactions whose proofs had to be verified\n"
+            "    \"size\": n                 (numeric) the number of proofs currently stored in the cache\n"
+            "  }\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getproofverifierstats", "")
             + HelpExampleRpc("getproofverifierstats", "")
@@ -2526,6 +3128,30 @@ UniValue getproofverifierstats(const UniValue& params, bool fHelp)
     obj.pushKV("okCerts",       static_cast<uint64_t>(stats.okCertCounter));
     obj.pushKV("okCSWs",        static_cast<uint64_t>(stats.okCswCounter));
 
+    AsyncProofVerifierBatchParameters batchParams = TEST_FRIEND_CScAsyncProofVerifier::GetInstance().GetBatchParameters();
+
+    UniValue costs(UniValue::VOBJ);
+    for (const auto& entry : batchParams.verificationCost)
+    {
+        costs.pushKV(Sidechain::ProvingSystemTypeToString(entry.first), entry.second);
+    }
+
+    UniValue batching(UniValue::VOBJ);
+    batching.pushKV("adaptive",         batchParams.adaptive);
+    batching.pushKV("targetLatency",    static_cast<uint64_t>(batchParams.targetLatency));
+    batching.pushKV("batchSize",        static_cast<uint64_t>(batchParams.batchSize));
+    batching.pushKV("batchDelay",       static_cast<uint64_t>(batchParams.batchDelay));
+    batching.pushKV("arrivalRate",      batchParams.arrivalRate);
+    batching.pushKV("verificationCost", costs);
+    obj.pushKV("batchParameters", batching);
+
+    ProofVerificationCacheStatistics cacheStats = CScProofVerificationCache::GetInstance().GetStatistics();
+    UniValue cache(UniValue::VOBJ);
+    cache.pushKV("hits",   cacheStats.hits);
+    cache.pushKV("misses", cacheStats.misses);
+    cache.pushKV("size",   cacheStats.size);
+    obj.pushKV("proofCache", cache);
+
     return obj;
 }
 
@@ -72,6 +72,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "walletpassphrase", 1 },
     { "getblocktemplate", 0 },
     { "getblocktemplate", 1 },
+    { "getblocktemplatepayouts", 0 },
     { "listsinceblock", 1 },
     { "listsinceblock", 2 },
     { "listsinceblock", 3 },
@@ -108,6 +109,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "gettxout", 2 },
     { "gettxout", 3 },
     { "gettxoutproof", 0 },
+    { "gettxoutproofs", 0 },
+    { "verifytxoutproofs", 0 },
     { "lockunspent", 0 },
     { "lockunspent", 1 },
     { "importprivkey", 2 },
@@ -116,8 +119,13 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "verifychain", 1 },
     { "keypoolrefill", 0 },
     { "getrawmempool", 0 },
+    { "getrawmempool", 1 },
+    { "getblockconnectstats", 0 },
+    { "getlockstats", 0 },
+    { "getlockstats", 1 },
     { "estimatefee", 0 },
     { "estimatepriority", 0 },
+    { "estimatescfee", 1 },
     { "prioritisetransaction", 1 },
     { "prioritisetransaction", 2 },
     { "setban", 2 },
@@ -134,6 +142,9 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getaddressutxos", 0 },
     { "getaddressutxos", 1 },
     { "getaddressmempool", 0 },
+    { "waitforaddressmempool", 0 },
+    { "waitforaddressmempool", 1 },
+    { "waitforaddressmempool", 2 },
 
     { "zcrawjoinsplit", 1 },
     { "zcrawjoinsplit", 2 },
@@ -141,6 +152,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "zcrawjoinsplit", 4 },
     { "zcbenchmark", 1 },
     { "zcbenchmark", 2 },
+    { "zcbenchmark", 3 },
     { "getblocksubsidy", 0 },
     { "getblockmerkleroots", 0 },
     { "getblockmerkleroots", 1 },
@@ -161,6 +173,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "z_sendmany", 2 },
     { "z_sendmany", 3 },
     { "z_sendmany", 4 },
+    { "getscactivity", 1 },
+    { "getscactivity", 2 },
     { "getscinfo", 1 },
     { "getscinfo", 2 },
     { "getscinfo", 3 },
@@ -0,0 +1,147 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/jsonwriter.h"
+
+#include <cassert>
+
+void JSONStreamWriter::Separate()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (vFirst.empty())
+        return;
+    if (!vFirst.back())
+        buffer += ',';
+    vFirst.back() = false;
+}
+
+void JSONStreamWriter::Append(const std::string& str)
+{
+    buffer += str;
+    if (buffer.size() >= nChunkSize)
+        Flush();
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    Separate();
+    buffer += '{';
+    vFirst.push_back(true);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    assert(!vFirst.empty() && !fAfterKey);
+    vFirst.pop_back();
+    Append("}");
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    Separate();
+    buffer += '[';
+    vFirst.push_back(true);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    assert(!vFirst.empty() && !fAfterKey);
+    vFirst.pop_back();
+    Append("]");
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!vFirst.empty() && !fAfterKey);
+    Separate();
+    // a string value is written escaped and quoted
+    Append(UniValue(key).write() + ":");
+    fAfterKey = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    // the members are written one by one, not to hold the text of a large value at once
+    if (value.isObject()) {
+        BeginObject();
+        const std::vector<std::string>& keys = value.getKeys();
+        const std::vector<UniValue>& values = value.getValues();
+        for (size_t i = 0; i < keys.size(); i++)
+            KeyValue(keys[i], values[i]);
+        EndObject();
+    } else if (value.isArray()) {
+        BeginArray();
+        for (const UniValue& member : value.getValues())
+            Value(member);
+        EndArray();
+    } else {
+        Separate();
+        Append(value.write());
+    }
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (buffer.empty())
+        return;
+    sink(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+void JSONTreeWriter::BeginObject()
+{
+    vOpen.push_back(UniValue(UniValue::VOBJ));
+}
+
+void JSONTreeWriter::EndObject()
+{
+    assert(!vOpen.empty() && vOpen.back().isObject());
+    Close();
+}
+
+void JSONTreeWriter::BeginArray()
+{
+    vOpen.push_back(UniValue(UniValue::VARR));
+}
+
+void JSONTreeWriter::EndArray()
+{
+    assert(!vOpen.empty() && vOpen.back().isArray());
+    Close();
+}
+
+void JSONTreeWriter::Key(const std::string& key)
+{
+    assert(!vOpen.empty() && vOpen.back().isObject());
+    vKeys.push_back(key);
+}
+
+void JSONTreeWriter::Value(const UniValue& value)
+{
+    if (vOpen.empty()) {
+        result = value;
+    } else if (vOpen.back().isObject()) {
+        assert(!vKeys.empty());
+        vOpen.back().pushKV(vKeys.back(), value);
+        vKeys.pop_back();
+    } else {
+        vOpen.back().push_back(value);
+    }
+}
+
+void JSONTreeWriter::Close()
+{
+    UniValue value = vOpen.back();
+    vOpen.pop_back();
+    Value(value);
+}
+
+const UniValue& JSONTreeWriter::GetValue() const
+{
+    assert(vOpen.empty());
+    return result;
+}
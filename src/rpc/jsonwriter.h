@@ -0,0 +1,99 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_JSONWRITER_H
+#define BITCOIN_RPC_JSONWRITER_H
+
+#include <univalue.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Writes a json value as it is produced, so that the RPCs with the largest results (the blocks with their
+ * transactions) do not need to build them whole before they are sent.
+ *
+ * Objects and arrays are opened and closed around their members; within an object every member is a Key()
+ * followed by its value. A member can also be a complete UniValue, written as it is.
+ */
+class JSONWriter
+{
+public:
+    virtual ~JSONWriter() {}
+
+    virtual void BeginObject() = 0;
+    virtual void EndObject() = 0;
+    virtual void BeginArray() = 0;
+    virtual void EndArray() = 0;
+    virtual void Key(const std::string& key) = 0;
+    virtual void Value(const UniValue& value) = 0;
+
+    //! A member of the object being written
+    void KeyValue(const std::string& key, const UniValue& value)
+    {
+        Key(key);
+        Value(value);
+    }
+};
+
+/**
+ * Serializes to a sink, in chunks of about nChunkSize bytes: the HTTP server hands them to the output
+ * buffer of the reply, so that the whole text of the value is never held in a string.
+ */
+class JSONStreamWriter : public JSONWriter
+{
+public:
+    typedef std::function<void(const char* data, size_t size)> Sink;
+
+    static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    explicit JSONStreamWriter(const Sink& sinkIn, size_t nChunkSizeIn = DEFAULT_CHUNK_SIZE) :
+        sink(sinkIn), nChunkSize(nChunkSizeIn) {}
+
+    void BeginObject() override;
+    void EndObject() override;
+    void BeginArray() override;
+    void EndArray() override;
+    void Key(const std::string& key) override;
+    void Value(const UniValue& value) override;
+
+    //! Hand what is left to the sink
+    void Flush();
+
+private:
+    Sink sink;
+    size_t nChunkSize;
+    std::string buffer;
+    //! for each object or array open, whether it has no member yet
+    std::vector<bool> vFirst;
+    bool fAfterKey = false;
+
+    void Separate();
+    void Append(const std::string& str);
+};
+
+/** Builds the value as a UniValue, for the callers of the RPCs that want one */
+class JSONTreeWriter : public JSONWriter
+{
+public:
+    void BeginObject() override;
+    void EndObject() override;
+    void BeginArray() override;
+    void EndArray() override;
+    void Key(const std::string& key) override;
+    void Value(const UniValue& value) override;
+
+    //! The value written, once its objects and arrays are all closed
+    const UniValue& GetValue() const;
+
+private:
+    UniValue result;
+    std::vector<UniValue> vOpen;
+    std::vector<std::string> vKeys;
+
+    void Close();
+};
+
+#endif // BITCOIN_RPC_JSONWRITER_H
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "amount.h"
+#include "base58.h"
 #include "chainparams.h"
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
@@ -18,6 +19,7 @@
 #include "net.h"
 #include "pow.h"
 #include "rpc/server.h"
+#include "script/standard.h"
 #include "txmempool.h"
 #include "util.h"
 #include "validationinterface.h"
@@ -26,6 +28,7 @@
 #endif
 
 #include <stdint.h>
+#include <deque>
 
 #include <boost/assign/list_of.hpp>
 
@@ -420,6 +423,119 @@ static UniValue BIP22ValidationResult(const CValidationState& state)
     return "valid?";
 }
 
+/**
+ * The last templates handed out by getblocktemplate, which passed TestBlockValidity when created. A block
+ * submitted with the same transactions and certificates, as told by its merkle root, does not need CheckBlock
+ * again, nor its sc txs commitment to be built again: only its header is new. The commitment depends on the
+ * sidechains the certificates are for, so the block must be on the same tip.
+ */
+struct CBlockTemplateFingerprint
+{
+    uint256 hashPrevBlock;
+    int32_t nVersion;
+    uint256 hashMerkleRoot;
+    uint256 hashScTxsCommitment;
+};
+
+static const size_t MAX_REMEMBERED_BLOCK_TEMPLATES = 8;
+static CCriticalSection cs_blockTemplates;
+static std::deque<CBlockTemplateFingerprint> dqBlockTemplates;
+
+static void RememberBlockTemplate(const CBlock& block)
+{
+    // the sc txs commitment of the older versions is only built when the merkle roots are requested
+    if (block.nVersion != BLOCK_VERSION_SC_SUPPORT)
+        return;
+
+    LOCK(cs_blockTemplates);
+    dqBlockTemplates.push_back(CBlockTemplateFingerprint{block.hashPrevBlock, block.nVersion, block.ComputeMerkleRoot(), block.hashScTxsCommitment});
+    if (dqBlockTemplates.size() > MAX_REMEMBERED_BLOCK_TEMPLATES)
+        dqBlockTemplates.pop_front();
+}
+
+static bool IsFromBlockTemplate(const CBlock& block)
+{
+    if (block.nVersion != BLOCK_VERSION_SC_SUPPORT)
+        return false;
+
+    // CheckBlock would refuse a mutated tree, whatever the template
+    bool fMutated;
+    const uint256 hashMerkleRoot = block.ComputeMerkleRoot(&fMutated);
+    if (fMutated || hashMerkleRoot != block.hashMerkleRoot)
+        return false;
+
+    LOCK(cs_blockTemplates);
+    for (const CBlockTemplateFingerprint& fingerprint : dqBlockTemplates) {
+        if (fingerprint.hashPrevBlock == block.hashPrevBlock && fingerprint.nVersion == block.nVersion &&
+            fingerprint.hashMerkleRoot == hashMerkleRoot &&
+            fingerprint.hashScTxsCommitment == block.hashScTxsCommitment)
+            return true;
+    }
+    return false;
+}
+
+/** The entry of the coinbase of a block template, as getblocktemplate reports it in coinbasetxn */
+static UniValue CoinbaseToTemplateJSON(const CTransaction& tx, CAmount nFee, int64_t nSigOps)
+{
+    UniValue entry(UniValue::VOBJ);
+    entry.pushKV("data", EncodeHexTx(tx));
+    entry.pushKV("hash", tx.GetHash().GetHex());
+    entry.pushKV("depends", UniValue(UniValue::VARR));
+    entry.pushKV("fee", nFee);
+    entry.pushKV("sigops", nSigOps);
+
+    // Show community reward if it is required
+    if (tx.GetVout().size() > 1) {
+        // Correct this if GetBlockTemplate changes the order
+        entry.pushKV("communityfund", (int64_t)tx.GetVout()[1].nValue);
+        if (tx.GetVout().size() > 3) {
+            entry.pushKV("securenodes", (int64_t)tx.GetVout()[2].nValue);
+            entry.pushKV("supernodes", (int64_t)tx.GetVout()[3].nValue);
+        }
+    }
+    entry.pushKV("required", true);
+    return entry;
+}
+
+/** The txes but the coinbase and the certificates of a block template, as getblocktemplate reports them */
+static void TemplateBodyToJSON(const CBlockTemplate& blocktemplate, UniValue& transactions, UniValue& certificates)
+{
+    const CBlock& block = blocktemplate.block;
+    map<uint256, int64_t> setTxIndex;
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = block.vtx[i];
+        setTxIndex[tx.GetHash()] = i;
+        if (tx.IsCoinBase())
+            continue;
+
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("data", EncodeHexTx(tx));
+        entry.pushKV("hash", tx.GetHash().GetHex());
+
+        UniValue deps(UniValue::VARR);
+        BOOST_FOREACH (const CTxIn &in, tx.GetVin())
+        {
+            if (setTxIndex.count(in.prevout.hash))
+                deps.push_back(setTxIndex[in.prevout.hash]);
+        }
+        entry.pushKV("depends", deps);
+        entry.pushKV("fee", blocktemplate.vTxFees[i]);
+        entry.pushKV("sigops", blocktemplate.vTxSigOps[i]);
+        transactions.push_back(entry);
+    }
+
+    for (size_t i = 0; i < block.vcert.size(); i++) {
+        const CScCertificate& cert = block.vcert[i];
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("data", EncodeHexCert(cert));
+        entry.pushKV("hash", cert.GetHash().GetHex());
+        // no depends for cert since there are no inputs
+        entry.pushKV("fee", blocktemplate.vCertFees[i]);
+        entry.pushKV("sigops", blocktemplate.vCertSigOps[i]);
+        certificates.push_back(entry);
+    }
+}
+
 UniValue getblocktemplate(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() > 2)
@@ -436,7 +552,8 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
             "       \"capabilities\":[                  (array, optional) a list of strings\n"
             "           \"support\"                     (string) client side supported feature, 'longpoll', 'coinbasetxn', 'coinbasevalue', 'proposal', 'serverlist', 'workid'\n"
             "           ,...\n"
-            "         ]\n"
+            "         ],\n"
+            "       \"longpollid\":\"xxxx\"             (string, optional) wait for a new block, or for -blocktemplatefeegain more mempool fees, before answering\n"
             "     }\n"
             "\n"
             "2. \"includeMerkleRoots\"                  (boolean, optional, default=false) If true, include \"merkleTree\" and \"scTxsCommitment\" fields in the result object. \n"
@@ -569,27 +686,33 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     }
 
     static unsigned int nTransactionsUpdatedLast;
+    static CAmount nFeesAddedLast;
 
     if (!lpval.isNull())
     {
-        // Wait to respond until either the best block changes, OR a minute has passed and there are more transactions
+        // Wait to respond until either the best block changes, OR the mempool gathered -blocktemplatefeegain fees,
+        // OR a minute has passed and there are more transactions
         uint256 hashWatchedChain;
         boost::system_time checktxtime;
         unsigned int nTransactionsUpdatedLastLP;
+        CAmount nFeesAddedLastLP;
 
         if (lpval.isStr())
         {
-            // Format: <hashBestChain><nTransactionsUpdatedLast>
+            // Format: <hashBestChain><nTransactionsUpdatedLast>[:<nFeesAddedLast>]
             std::string lpstr = lpval.get_str();
 
             hashWatchedChain.SetHex(lpstr.substr(0, 64));
             nTransactionsUpdatedLastLP = atoi64(lpstr.substr(64));
+            size_t nFeesPos = lpstr.find(':', 64);
+            nFeesAddedLastLP = (nFeesPos != std::string::npos) ? atoi64(lpstr.substr(nFeesPos + 1)) : nFeesAddedLast;
         }
         else
         {
             // NOTE: Spec does not specify behaviour for non-string longpollid, but this makes testing easier
             hashWatchedChain = chainActive.Tip()->GetBlockHash();
             nTransactionsUpdatedLastLP = nTransactionsUpdatedLast;
+            nFeesAddedLastLP = nFeesAddedLast;
         }
 
         // Release the wallet and main lock while waiting
@@ -600,6 +723,9 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
             boost::unique_lock<boost::mutex> lock(csBestBlock);
             while (chainActive.Tip()->GetBlockHash() == hashWatchedChain && IsRPCRunning())
             {
+                // Woken up by CheckBlockTemplateFeeGain() as soon as the mempool fees make a better template
+                if (nBlockTemplateFeeGain > 0 && mempool.GetFeesAdded() - nFeesAddedLastLP >= nBlockTemplateFeeGain)
+                    break;
                 if (!cvBlockChange.timed_wait(lock, checktxtime))
                 {
                     // Timeout: Check transactions for update
@@ -621,13 +747,16 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     static int64_t nStart;
     static CBlockTemplate* pblocktemplate;
     if (pindexPrev != chainActive.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
+        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5) ||
+        (nBlockTemplateFeeGain > 0 && mempool.GetFeesAdded() - nFeesAddedLast >= nBlockTemplateFeeGain))
     {
         // Clear pindexPrev so future calls make a new block, despite any failures from here on
         pindexPrev = NULL;
 
         // Store the pindexBest used before CreateNewBlockWithKey, to avoid races
         nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
+        nFeesAddedLast = mempool.GetFeesAdded();
+        SetBlockTemplateFeesBaseline(nFeesAddedLast);
         CBlockIndex* pindexPrevNew = chainActive.Tip();
         nStart = GetTime();
 
@@ -648,6 +777,7 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
 
         // Need to update only after we know CreateNewBlockWithKey succeeded
         pindexPrev = pindexPrevNew;
+        RememberBlockTemplate(pblocktemplate->block);
     }
     CBlock* pblock = &pblocktemplate->block; // pointer for convenience
 
@@ -657,51 +787,10 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
 
     UniValue aCaps(UniValue::VARR); aCaps.push_back("proposal");
 
-    UniValue txCoinbase = NullUniValue;
+    UniValue txCoinbase = CoinbaseToTemplateJSON(pblock->vtx[0], pblocktemplate->vTxFees[0], pblocktemplate->vTxSigOps[0]);
     UniValue transactions(UniValue::VARR);
-    map<uint256, int64_t> setTxIndex;
-    int i = 0;
-    BOOST_FOREACH (const CTransaction& tx, pblock->vtx) {
-        uint256 txHash = tx.GetHash();
-        setTxIndex[txHash] = i++;
-
-        if (tx.IsCoinBase() && !coinbasetxn)
-            continue;
-
-        UniValue entry(UniValue::VOBJ);
-
-        entry.pushKV("data", EncodeHexTx(tx));
-
-        entry.pushKV("hash", txHash.GetHex());
-
-        UniValue deps(UniValue::VARR);
-        BOOST_FOREACH (const CTxIn &in, tx.GetVin())
-        {
-            if (setTxIndex.count(in.prevout.hash))
-                deps.push_back(setTxIndex[in.prevout.hash]);
-        }
-        entry.pushKV("depends", deps);
-
-        int index_in_template = i - 1;
-        entry.pushKV("fee", pblocktemplate->vTxFees[index_in_template]);
-        entry.pushKV("sigops", pblocktemplate->vTxSigOps[index_in_template]);
-
-        if (tx.IsCoinBase()) {
-            // Show community reward if it is required
-            if (pblock->vtx[0].GetVout().size() > 1) {
-                // Correct this if GetBlockTemplate changes the order
-                entry.pushKV("communityfund", (int64_t)tx.GetVout()[1].nValue);
-                if (pblock->vtx[0].GetVout().size() > 3) {
-                    entry.pushKV("securenodes", (int64_t)tx.GetVout()[2].nValue);
-                    entry.pushKV("supernodes", (int64_t)tx.GetVout()[3].nValue);
-                }
-            }
-            entry.pushKV("required", true);
-            txCoinbase = entry;
-        } else {
-            transactions.push_back(entry);
-        }
-    }
+    UniValue certificates(UniValue::VARR);
+    TemplateBodyToJSON(*pblocktemplate, transactions, certificates);
 
     UniValue aux(UniValue::VOBJ);
     aux.pushKV("flags", HexStr(COINBASE_FLAGS.begin(), COINBASE_FLAGS.end()));
@@ -727,9 +816,10 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
 
     if (includeMerkleRoots)
     {
-        pblock->hashMerkleRoot = pblock->BuildMerkleTree();
+        pblock->hashMerkleRoot = pblock->ComputeMerkleRoot();
 
-        if (certSupported) {
+        // The txs commitment has already been built by CreateNewBlock() for blocks supporting sidechains
+        if (certSupported && pblock->nVersion != BLOCK_VERSION_SC_SUPPORT) {
             CCoinsViewCache view(pcoinsTip);
             // At this point, txs commitment tree should be valid
             bool retValtxsComm = pblock->UpdateScTxsCommitment(view);
@@ -743,24 +833,7 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     result.pushKV("previousblockhash", pblock->hashPrevBlock.GetHex());
     result.pushKV("transactions", transactions);
     if (certSupported)
-    {
-        UniValue certificates(UniValue::VARR);
-        int cert_idx_in_template = 0;
-        BOOST_FOREACH (const CScCertificate& cert, pblock->vcert) {
-            uint256 certHash = cert.GetHash();
-            UniValue entry(UniValue::VOBJ);
- 
-            entry.pushKV("data", EncodeHexCert(cert));
-            entry.pushKV("hash", certHash.GetHex());
-            // no depends for cert since there are no inputs
-            entry.pushKV("fee", pblocktemplate->vCertFees[cert_idx_in_template]);
-            entry.pushKV("sigops", pblocktemplate->vCertSigOps[cert_idx_in_template]);
-            certificates.push_back(entry);
- 
-            cert_idx_in_template++;
-        }
         result.pushKV("certificates", certificates);
-    }
 
     if (coinbasetxn) {
         assert(txCoinbase.isObject());
@@ -774,7 +847,7 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     if (pblock->nVersion != BLOCK_VERSION_SC_SUPPORT)
         block_size_limit = MAX_BLOCK_SIZE_BEFORE_SC;
 
-    result.pushKV("longpollid", chainActive.Tip()->GetBlockHash().GetHex() + i64tostr(nTransactionsUpdatedLast));
+    result.pushKV("longpollid", chainActive.Tip()->GetBlockHash().GetHex() + i64tostr(nTransactionsUpdatedLast) + ":" + i64tostr(nFeesAddedLast));
     result.pushKV("target", hashTarget.GetHex());
     result.pushKV("mintime", (int64_t)pindexPrev->GetMedianTimePast()+1);
     result.pushKV("mutable", aMutable);
@@ -788,6 +861,107 @@ UniValue getblocktemplate(const UniValue& params, bool fHelp)
     return result;
 }
 
+UniValue getblocktemplatepayouts(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "getblocktemplatepayouts [\"address\",...]\n"
+            "\nReturns the next block template for each of the payout addresses, as getblocktemplate: they have the\n"
+            "same transactions and certificates, selected once while the mempool does not change, and a coinbase each,\n"
+            "paying the address what getblocktemplate pays the miner, with the same community fund outputs.\n"
+            "\nArguments:\n"
+            "1. \"addresses\"                  (array, required) The transparent addresses to pay the block reward and fees to\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"version\" : n,                  (numeric) The block version\n"
+            "  \"previousblockhash\" : \"xxxx\",  (string) The hash of current highest block\n"
+            "  \"height\" : n,                   (numeric) The height of the next block\n"
+            "  \"curtime\" : ttt,                (numeric) current timestamp in seconds since epoch (Jan 1 1970 GMT)\n"
+            "  \"bits\" : \"xxx\",                (string) compressed target of next block\n"
+            "  \"transactions\" : [ ... ],       (array) The non-coinbase transactions, as getblocktemplate\n"
+            "  \"certificates\" : [ ... ],       (array) The certificates, as getblocktemplate, once supported\n"
+            "  \"scTxsCommitment\" : \"xxxx\",    (string) The sidechain transactions commitment, the same for every payout\n"
+            "  \"coinbasemerklebranch\" : [      (array) The merkle branch of the coinbase, the same for every payout\n"
+            "     \"hash\",                      (string) The hashes to combine the hash of a coinbase with, from the leaves up\n"
+            "     ,...\n"
+            "  ],\n"
+            "  \"payouts\" : [\n"
+            "    {\n"
+            "      \"address\" : \"addr\",          (string) The payout address\n"
+            "      \"coinbasetxn\" : { ... },     (json object) The coinbase paying it, as getblocktemplate\n"
+            "      \"merkleTree\" : \"xxxx\"        (string) The merkle root of the block with this coinbase\n"
+            "    }\n"
+            "    ,...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblocktemplatepayouts", "'[\"znXWB3XGptd9ZuAu3MbE5ME4WpVTANYKxnW\",\"zngd1mhC6EtJF8vmKzVVBnmpVjTcM3ugnG4\"]'")
+            + HelpExampleRpc("getblocktemplatepayouts", "[\"znXWB3XGptd9ZuAu3MbE5ME4WpVTANYKxnW\",\"zngd1mhC6EtJF8vmKzVVBnmpVjTcM3ugnG4\"]")
+        );
+
+    const UniValue& addresses = params[0].get_array();
+    if (addresses.empty())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, no payout address");
+    std::vector<CScript> vScriptPubKeys;
+    for (const UniValue& address : addresses.getValues()) {
+        CBitcoinAddress addr(address.get_str());
+        if (!addr.IsValid())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid payout address: " + address.get_str());
+        vScriptPubKeys.push_back(GetScriptForDestination(addr.Get(), false));
+    }
+
+    LOCK(cs_main);
+
+    /* for testing, comment this block out if using just one node */
+    if (vNodes.empty())
+        throw JSONRPCError(RPC_CLIENT_NOT_CONNECTED, "Horizen is not connected!");
+
+    if (IsInitialBlockDownload())
+        throw JSONRPCError(RPC_CLIENT_IN_INITIAL_DOWNLOAD, "Horizen is downloading blocks...");
+
+    // only the first one selects the txes and certificates, unless the mempool is the same as for the last template
+    std::unique_ptr<CBlockTemplate> pblocktemplate(CreateNewBlock(vScriptPubKeys[0]));
+    if (!pblocktemplate)
+        throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
+    const CBlock& block = pblocktemplate->block;
+    const int nHeight = chainActive.Height() + 1;
+
+    std::vector<CCoinbaseVariant> vVariants;
+    if (!GetCoinbaseVariants(*pblocktemplate, nHeight, vScriptPubKeys, vVariants))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "A payout coinbase does not fit in the block");
+
+    UniValue transactions(UniValue::VARR);
+    UniValue certificates(UniValue::VARR);
+    TemplateBodyToJSON(*pblocktemplate, transactions, certificates);
+
+    UniValue branch(UniValue::VARR);
+    for (const uint256& hash : block.GetMerkleBranch(0))
+        branch.push_back(hash.GetHex());
+
+    UniValue payouts(UniValue::VARR);
+    for (size_t i = 0; i < vVariants.size(); i++) {
+        UniValue payout(UniValue::VOBJ);
+        payout.pushKV("address", addresses[i].get_str());
+        payout.pushKV("coinbasetxn", CoinbaseToTemplateJSON(vVariants[i].txCoinbase, pblocktemplate->vTxFees[0], vVariants[i].nSigOps));
+        payout.pushKV("merkleTree", vVariants[i].hashMerkleRoot.GetHex());
+        payouts.push_back(payout);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("version", block.nVersion);
+    result.pushKV("previousblockhash", block.hashPrevBlock.GetHex());
+    result.pushKV("height", nHeight);
+    result.pushKV("curtime", block.GetBlockTime());
+    result.pushKV("bits", strprintf("%08x", block.nBits));
+    result.pushKV("transactions", transactions);
+    if (ForkManager::getInstance().areSidechainsSupported(nHeight))
+        result.pushKV("certificates", certificates);
+    result.pushKV("scTxsCommitment", block.hashScTxsCommitment.GetHex());
+    result.pushKV("coinbasemerklebranch", branch);
+    result.pushKV("payouts", payouts);
+    return result;
+}
+
 class submitblock_StateCatcher : public CValidationInterface
 {
 public:
@@ -856,6 +1030,13 @@ UniValue submitblock(const UniValue& params, bool fHelp)
         }
     }
 
+    // The header, with the proof of work, is still checked by AcceptBlockHeader and the block connected in full
+    if (IsFromBlockTemplate(block)) {
+        LogPrint("rpc", "%s: block %s built on a template of this node\n", __func__, hash.ToString());
+        block.fChecked = true;
+        block.fScTxsCommitmentChecked = true;
+    }
+
     CValidationState state;
     submitblock_StateCatcher sc(block.GetHash());
     RegisterValidationInterface(&sc);
@@ -944,6 +1125,78 @@ UniValue estimatepriority(const UniValue& params, bool fHelp)
     return mempool.estimatePriority(nBlocks);
 }
 
+UniValue estimatescfee(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 2)
+        throw runtime_error(
+            "estimatescfee \"scid\" nblocks\n"
+            "\nEstimates the fees needed by the transactions and certificates of a sidechain\n"
+            "to begin confirmation within nblocks blocks, together with the sidechain fees\n"
+            "their forward transfers and backward transfer requests must pay.\n"
+
+            "\nArguments:\n"
+            "1. \"scid\"      (string, required) the id of an alive sidechain\n"
+            "2. nblocks     (numeric, required) number of blocks\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"feerate\": n,       (numeric) estimated fee-per-kilobyte for a transaction with forward transfers or\n"
+            "                              backward transfer requests, the one of estimatefee if not enough of them have been observed\n"
+            "  \"certfeerate\": n,   (numeric) estimated fee-per-kilobyte for a certificate\n"
+            "  \"ftscfee\": n,       (numeric) forward transfers must be greater than this to enter the mempool\n"
+            "  \"minftscfee\": n,    (numeric) forward transfers must be greater than this to be mined\n"
+            "  \"mbtrscfee\": n,     (numeric) backward transfer requests must pay at least this to enter the mempool\n"
+            "  \"minmbtrscfee\": n   (numeric) backward transfer requests must pay at least this to be mined\n"
+            "}\n"
+            "\n"
+            "-1.0 is returned as a fee rate if not enough transactions and\n"
+            "blocks have been observed to make an estimate.\n"
+
+            "\nExample:\n"
+            + HelpExampleCli("estimatescfee", "\"1a3e7ccbfd40c4e2304c3215f76d204e4de63c578ad835510f580d529516a874\" 6")
+            + HelpExampleRpc("estimatescfee", "\"1a3e7ccbfd40c4e2304c3215f76d204e4de63c578ad835510f580d529516a874\", 6")
+        );
+
+    RPCTypeCheck(params, boost::assign::list_of(UniValue::VSTR)(UniValue::VNUM));
+
+    string inputString = params[0].get_str();
+    if (inputString.find_first_not_of("0123456789abcdefABCDEF", 0) != std::string::npos)
+        throw JSONRPCError(RPC_TYPE_ERROR, "Invalid scid format: not an hex");
+    uint256 scId;
+    scId.SetHex(inputString);
+
+    int nBlocks = params[1].get_int();
+    if (nBlocks < 1)
+        nBlocks = 1;
+
+    UniValue result(UniValue::VOBJ);
+
+    CFeeRate feeRate = mempool.estimateScTxFee(nBlocks);
+    if (feeRate == CFeeRate(0))
+        feeRate = mempool.estimateFee(nBlocks);
+    result.pushKV("feerate", feeRate == CFeeRate(0) ? UniValue(-1.0) : ValueFromAmount(feeRate.GetFeePerK()));
+
+    CFeeRate certFeeRate = mempool.estimateCertificateFee(nBlocks);
+    result.pushKV("certfeerate", certFeeRate == CFeeRate(0) ? UniValue(-1.0) : ValueFromAmount(certFeeRate.GetFeePerK()));
+
+    {
+        LOCK(cs_main);
+        CCoinsViewCache scView(pcoinsTip);
+        CSidechain sidechain;
+        if (!scView.GetSidechain(scId, sidechain) || sidechain.GetState(scView) != CSidechain::State::ALIVE)
+            throw JSONRPCError(RPC_INVALID_PARAMETER, string("scid not alive: ") + scId.ToString());
+
+        // the mempool checks the fees set by the active certificate, blocks the lowest ones in the fees window
+        const CScCertificateView& certView = scView.GetActiveCertView(scId);
+        result.pushKV("ftscfee", ValueFromAmount(certView.forwardTransferScFee));
+        result.pushKV("minftscfee", ValueFromAmount(sidechain.GetMinFtScFee()));
+        result.pushKV("mbtrscfee", ValueFromAmount(certView.mainchainBackwardTransferRequestScFee));
+        result.pushKV("minmbtrscfee", ValueFromAmount(sidechain.GetMinMbtrScFee()));
+    }
+
+    return result;
+}
+
 UniValue getblocksubsidy(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() > 1)
@@ -1052,7 +1305,7 @@ UniValue getblockmerkleroots(const UniValue& params, bool fHelp) {
     pblock->vcert = certs;
     CCoinsViewCache view(pcoinsTip);
 
-    uint256 merkleTree = pblock->BuildMerkleTree();
+    uint256 merkleTree = pblock->ComputeMerkleRoot();
     if (certSupported) {
         if (!pblock->BuildScTxsCommitmentGuard()) {
             LogPrint("sc", "%s():%d - scTxsCommitment guard failed. Check the number of sc or txs / cert for each sc.\n",
@@ -20,6 +20,11 @@
 
 #include <stdint.h>
 
+#include <atomic>
+#include <future>
+
+
+#include <boost/algorithm/string.hpp>
 #include <boost/assign/list_of.hpp>
 
 #include <univalue.h>
@@ -43,6 +48,9 @@ using namespace std;
  **/
 UniValue getinfo(const UniValue& params, bool fHelp)
 {
+#ifdef ENABLE_WALLET
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+#endif
     if (fHelp || params.size() != 0)
         throw runtime_error(
             "getinfo\n"
@@ -74,7 +82,7 @@ UniValue getinfo(const UniValue& params, bool fHelp)
         );
 
 #ifdef ENABLE_WALLET
-    LOCK2(cs_main, pwalletMain ? &pwalletMain->cs_wallet : NULL);
+    LOCK2(cs_main, pwallet ? &pwallet->cs_wallet : NULL);
 #else
     LOCK(cs_main);
 #endif
@@ -86,9 +94,9 @@ UniValue getinfo(const UniValue& params, bool fHelp)
     obj.pushKV("version", CLIENT_VERSION);
     obj.pushKV("protocolversion", PROTOCOL_VERSION);
 #ifdef ENABLE_WALLET
-    if (pwalletMain) {
-        obj.pushKV("walletversion", pwalletMain->GetVersion());
-        obj.pushKV("balance",       ValueFromAmount(pwalletMain->GetBalance()));
+    if (pwallet) {
+        obj.pushKV("walletversion", pwallet->GetVersion());
+        obj.pushKV("balance",       ValueFromAmount(pwallet->GetBalance()));
     }
 #endif
     obj.pushKV("blocks",        (int)chainActive.Height());
@@ -98,12 +106,12 @@ UniValue getinfo(const UniValue& params, bool fHelp)
     obj.pushKV("difficulty",    (double)GetDifficulty());
     obj.pushKV("testnet",       Params().TestnetToBeDeprecatedFieldRPC());
 #ifdef ENABLE_WALLET
-    if (pwalletMain) {
-        obj.pushKV("keypoololdest", pwalletMain->GetOldestKeyPoolTime());
-        obj.pushKV("keypoolsize",   (int)pwalletMain->GetKeyPoolSize());
+    if (pwallet) {
+        obj.pushKV("keypoololdest", pwallet->GetOldestKeyPoolTime());
+        obj.pushKV("keypoolsize",   (int)pwallet->GetKeyPoolSize());
     }
-    if (pwalletMain && pwalletMain->IsCrypted())
-        obj.pushKV("unlocked_until", nWalletUnlockTime);
+    if (pwallet && pwallet->IsCrypted())
+        obj.pushKV("unlocked_until", pwallet->nWalletUnlockTime);
     obj.pushKV("paytxfee",      ValueFromAmount(payTxFee.GetFeePerK()));
 #endif
     obj.pushKV("relayfee",      ValueFromAmount(::minRelayTxFee.GetFeePerK()));
@@ -114,14 +122,19 @@ UniValue getinfo(const UniValue& params, bool fHelp)
 #ifdef ENABLE_WALLET
 class DescribeAddressVisitor : public boost::static_visitor<UniValue>
 {
+private:
+    CWallet* const pwallet;
+
 public:
+    explicit DescribeAddressVisitor(CWallet* pwalletIn) : pwallet(pwalletIn) {}
+
     UniValue operator()(const CNoDestination &dest) const { return UniValue(UniValue::VOBJ); }
 
     UniValue operator()(const CKeyID &keyID) const {
         UniValue obj(UniValue::VOBJ);
         CPubKey vchPubKey;
         obj.pushKV("isscript", false);
-        if (pwalletMain && pwalletMain->GetPubKey(keyID, vchPubKey)) {
+        if (pwallet && pwallet->GetPubKey(keyID, vchPubKey)) {
             obj.pushKV("pubkey", HexStr(vchPubKey));
             obj.pushKV("iscompressed", vchPubKey.IsCompressed());
         }
@@ -132,7 +145,7 @@ public:
         UniValue obj(UniValue::VOBJ);
         CScript subscript;
         obj.pushKV("isscript", true);
-        if (pwalletMain && pwalletMain->GetCScript(scriptID, subscript)) {
+        if (pwallet && pwallet->GetCScript(scriptID, subscript)) {
             std::vector<CTxDestination> addresses;
             txnouttype whichType;
             int nRequired;
@@ -153,6 +166,9 @@ public:
 
 UniValue validateaddress(const UniValue& params, bool fHelp)
 {
+#ifdef ENABLE_WALLET
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+#endif
     if (fHelp || params.size() != 1)
         throw runtime_error(
             "validateaddress \"zenaddress\"\n"
@@ -180,7 +196,7 @@ UniValue validateaddress(const UniValue& params, bool fHelp)
         );
 
 #ifdef ENABLE_WALLET
-    LOCK2(cs_main, pwalletMain ? &pwalletMain->cs_wallet : NULL);
+    LOCK2(cs_main, pwallet ? &pwallet->cs_wallet : NULL);
 #else
     LOCK(cs_main);
 #endif
@@ -205,13 +221,13 @@ UniValue validateaddress(const UniValue& params, bool fHelp)
         ret.pushKV("scriptPubKey", HexStr(scriptPubKey.begin(), scriptPubKey.end()));
 
 #ifdef ENABLE_WALLET
-        isminetype mine = pwalletMain ? IsMine(*pwalletMain, dest) : ISMINE_NO;
+        isminetype mine = pwallet ? IsMine(*pwallet, dest) : ISMINE_NO;
         ret.pushKV("ismine", (mine & ISMINE_SPENDABLE) ? true : false);
         ret.pushKV("iswatchonly", (mine & ISMINE_WATCH_ONLY) ? true: false);
-        UniValue detail = boost::apply_visitor(DescribeAddressVisitor(), dest);
+        UniValue detail = boost::apply_visitor(DescribeAddressVisitor(pwallet), dest);
         ret.pushKVs(detail);
-        if (pwalletMain && pwalletMain->mapAddressBook.count(dest))
-            ret.pushKV("account", pwalletMain->mapAddressBook[dest].name);
+        if (pwallet && pwallet->mapAddressBook.count(dest))
+            ret.pushKV("account", pwallet->mapAddressBook[dest].name);
 #endif
     }
     return ret;
@@ -220,6 +236,9 @@ UniValue validateaddress(const UniValue& params, bool fHelp)
 
 UniValue z_validateaddress(const UniValue& params, bool fHelp)
 {
+#ifdef ENABLE_WALLET
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+#endif
     if (fHelp || params.size() != 1)
         throw runtime_error(
             "z_validateaddress \"zaddr\"\n"
@@ -244,7 +263,7 @@ UniValue z_validateaddress(const UniValue& params, bool fHelp)
 
 
 #ifdef ENABLE_WALLET
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 #else
     LOCK(cs_main);
 #endif
@@ -259,7 +278,7 @@ UniValue z_validateaddress(const UniValue& params, bool fHelp)
         libzcash::PaymentAddress addr = address.Get();
 
 #ifdef ENABLE_WALLET
-        isMine = pwalletMain->HaveSpendingKey(addr);
+        isMine = pwallet->HaveSpendingKey(addr);
 #endif
         payingKey = addr.a_pk.GetHex();
         transmissionKey = addr.pk_enc.GetHex();
@@ -288,6 +307,9 @@ UniValue z_validateaddress(const UniValue& params, bool fHelp)
  */
 CScript _createmultisig_redeemScript(const UniValue& params)
 {
+#ifdef ENABLE_WALLET
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+#endif
     int nRequired = params[0].get_int();
     const UniValue& keys = params[1].get_array();
 
@@ -308,14 +330,14 @@ CScript _createmultisig_redeemScript(const UniValue& params)
 #ifdef ENABLE_WALLET
         // Case 1: Bitcoin address and we have full public key:
         CBitcoinAddress address(ks);
-        if (pwalletMain && address.IsValid())
+        if (pwallet && address.IsValid())
         {
             CKeyID keyID;
             if (!address.GetKeyID(keyID))
                 throw runtime_error(
                     strprintf("%s does not refer to a key",ks));
             CPubKey vchPubKey;
-            if (!pwalletMain->GetPubKey(keyID, vchPubKey))
+            if (!pwallet->GetPubKey(keyID, vchPubKey))
                 throw runtime_error(
                     strprintf("no full public key for address %s",ks));
             if (!vchPubKey.IsFullyValid())
@@ -535,9 +557,69 @@ bool getAddressesFromParams(const UniValue& params, std::vector<std::pair<uint16
     return true;
 }
 
-bool heightComparer(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
-                    std::pair<CAddressUnspentKey, CAddressUnspentValue> b) {
-    return a.second.blockHeight < b.second.blockHeight;
+/**
+ * Run fetch(address, result) for every address, spread over up to -addressindexthreads threads: LevelDB
+ * serves concurrent reads, so the lookups of a call asking for many addresses do not wait one behind the
+ * other. results holds what was fetched for each address, in the order of addresses; false if a fetch failed.
+ */
+template <typename Result, typename Fetch>
+static bool FetchForAddresses(const std::vector<std::pair<uint160, AddressType>>& addresses, std::vector<Result>& results, Fetch fetch)
+{
+    results.assign(addresses.size(), Result());
+
+    size_t nThreads = std::max(1, std::min<int>(GetArg("-addressindexthreads", DEFAULT_ADDRESSINDEX_THREADS), MAX_ADDRESSINDEX_THREADS));
+    nThreads = std::min(nThreads, addresses.size());
+
+    std::atomic<size_t> nNext(0);
+    std::atomic<bool> fFailed(false);
+    auto worker = [&]() {
+        for (size_t i = nNext++; i < addresses.size() && !fFailed; i = nNext++) {
+            if (!fetch(addresses[i], results[i]))
+                fFailed = true;
+        }
+    };
+
+    // the calling thread is a worker too; should it throw, the futures still wait for their tasks
+    std::vector<std::future<void>> vWorkers;
+    for (size_t i = 1; i < nThreads; i++)
+        vWorkers.push_back(std::async(std::launch::async, worker));
+    worker();
+    for (std::future<void>& f : vWorkers)
+        f.get();
+
+    return !fFailed;
+}
+
+// By height, then by outpoint: a total order, so that a page of the outputs can be resumed from the last one
+bool heightComparer(const std::pair<CAddressUnspentKey, CAddressUnspentValue>& a,
+                    const std::pair<CAddressUnspentKey, CAddressUnspentValue>& b) {
+    if (a.second.blockHeight != b.second.blockHeight)
+        return a.second.blockHeight < b.second.blockHeight;
+    if (a.first.txhash != b.first.txhash)
+        return a.first.txhash < b.first.txhash;
+    return a.first.index < b.first.index;
+}
+
+//! The cursor resuming a page of getaddressutxos after an output: "<height>:<txid>:<output index>"
+static std::string UnspentCursor(const std::pair<CAddressUnspentKey, CAddressUnspentValue>& unspent)
+{
+    return strprintf("%d:%s:%u", unspent.second.blockHeight, unspent.first.txhash.GetHex(), unspent.first.index);
+}
+
+static std::pair<CAddressUnspentKey, CAddressUnspentValue> ParseUnspentCursor(const std::string& strCursor)
+{
+    std::vector<std::string> vParts;
+    boost::split(vParts, strCursor, boost::is_any_of(":"));
+    int32_t nHeight = 0, nIndex = 0;
+    if (vParts.size() != 3 || !ParseInt32(vParts[0], &nHeight) || vParts[1].size() != 64 || !IsHex(vParts[1]) ||
+        !ParseInt32(vParts[2], &nIndex) || nIndex < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+
+    std::pair<CAddressUnspentKey, CAddressUnspentValue> unspent;
+    unspent.second.blockHeight = nHeight;
+    unspent.first.txhash = uint256S(vParts[1]);
+    unspent.first.index = nIndex;
+    return unspent;
 }
 
 bool timestampComparer(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
@@ -626,6 +708,58 @@ UniValue getaddressmempool(const UniValue& params, bool fHelp)
     return result;
 }
 
+UniValue waitforaddressmempool(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 2 || params.size() > 3)
+        throw runtime_error(
+            "waitforaddressmempool\n"
+            "\nWaits for the mempool deltas of a single address or an array of addresses to change (requires addressindex to be enabled).\n"
+            "Returns at once if their generation differs from the given one. A generation of 0 just returns the current one,\n"
+            "to be taken before calling getaddressmempool.\n"
+            "\nArguments:\n"
+            "1. addresses      (string or object, required) The address or {\"addresses\": [\"address\",...]}, as in getaddressmempool\n"
+            "2. generation     (numeric, required) The generation returned by the previous call\n"
+            "3. timeout        (numeric, optional, default=30000) The maximum time to wait, in milliseconds\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"generation\"    (numeric) The current generation of the mempool deltas of the addresses\n"
+            "  \"changed\"       (boolean) Whether it differs from the given one\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("waitforaddressmempool", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}' 15")
+            + HelpExampleRpc("waitforaddressmempool", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}, 15, 60000")
+        );
+
+    if (!fAddressIndex) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Address indexing not enabled");
+    }
+
+    std::vector<std::pair<uint160, AddressType> > addresses;
+    if (!getAddressesFromParams(params, addresses)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+
+    const uint64_t nGeneration = params[1].get_int64();
+    int64_t nTimeout = params.size() > 2 ? params[2].get_int64() : 30000;
+    if (nTimeout < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative timeout");
+
+    // Wait in slices, not to hold up the shutdown
+    uint64_t nCurrent = mempool.getAddressGeneration(addresses);
+    const int64_t nDeadline = GetTimeMillis() + nTimeout;
+    while (nCurrent == nGeneration && IsRPCRunning()) {
+        int64_t nRemaining = nDeadline - GetTimeMillis();
+        if (nRemaining <= 0)
+            break;
+        nCurrent = mempool.waitForAddressChange(addresses, nGeneration, std::min<int64_t>(nRemaining, 1000));
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("generation", nCurrent);
+    result.pushKV("changed", nCurrent != nGeneration);
+    return result;
+}
+
 UniValue getaddressutxos(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
@@ -636,6 +770,8 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "{\n"
             "  \"address\"              (string) The base58check encoded address\n"
             "  \"chainInfo\"            (boolean, optional) Include chain info with results\n"
+            "  \"limit\"                (number, optional) Return at most this many outputs, as a page resumed with \"cursor\"\n"
+            "  \"cursor\"               (string, optional) Return the outputs after the page this \"next\" cursor ended\n"
             "}\n"
             "\"includeImmatureBTs\"     (bool, optional, default = false) Whether to include ImmatureBTs in the utxos list\n"
             "\nArguments (option 2):\n"
@@ -646,6 +782,8 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "      ,...\n"
             "    ],\n"
             "  \"chainInfo\"            (boolean, optional) Include chain info with results\n"
+            "  \"limit\"                (number, optional) Return at most this many outputs, as a page resumed with \"cursor\"\n"
+            "  \"cursor\"               (string, optional) Return the outputs after the page this \"next\" cursor ended\n"
             "}\n"
             "\"includeImmatureBTs\"     (bool, optional, default = false) Whether to include ImmatureBTs in the utxos list\n"
             "\nResult\n"
@@ -663,8 +801,16 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
             "    \"blocksToMaturity\"   (number) The number of blocks to be mined for achieving maturity (0 means already spendable)\n"           
             "  }\n"
             "]\n"
+            "\nResult (with chainInfo or limit):\n"
+            "{\n"
+            "  \"utxos\"              (array) The outputs, as above, sorted by height\n"
+            "  \"next\"               (string) Only with limit: the cursor of the next page, null after the last one\n"
+            "  \"hash\"               (string) Only with chainInfo: the hash of the tip\n"
+            "  \"height\"             (number) Only with chainInfo: the height of the tip\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
+            + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"], \"limit\": 1000}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
             );
 
@@ -679,11 +825,22 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
     }
 
     bool includeChainInfo = false;
+    int limit = 0;
+    std::string cursor;
     if (params[0].isObject()) {
         UniValue chainInfo = find_value(params[0].get_obj(), "chainInfo");
         if (chainInfo.isBool()) {
             includeChainInfo = chainInfo.get_bool();
         }
+        UniValue limitValue = find_value(params[0].get_obj(), "limit");
+        if (!limitValue.isNull()) {
+            limit = limitValue.get_int();
+            if (limit <= 0)
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "limit must be positive");
+        }
+        UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+        if (!cursorValue.isNull())
+            cursor = cursorValue.get_str();
     }
 
     bool includeImmatureBTs = false;
@@ -695,16 +852,29 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    std::vector<std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > > addressUnspent;
+    bool fFetched = FetchForAddresses(addresses, addressUnspent,
+        [](const std::pair<uint160, AddressType>& address, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspent) {
+            return GetAddressUnspent(address.first, address.second, unspent);
+        });
+    if (!fFetched) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
 
-    for (const auto& [addressHash, addressType] : addresses) {
-        if (!GetAddressUnspent(addressHash, addressType, unspentOutputs)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& unspent : addressUnspent) {
+        unspentOutputs.insert(unspentOutputs.end(), std::make_move_iterator(unspent.begin()), std::make_move_iterator(unspent.end()));
     }
 
     std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightComparer);
 
+    // A page starts after the output its cursor names, and is cut once it has limit outputs
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator first = unspentOutputs.begin();
+    if (!cursor.empty()) {
+        first = std::upper_bound(unspentOutputs.begin(), unspentOutputs.end(), ParseUnspentCursor(cursor), heightComparer);
+    }
+    UniValue next(UniValue::VNULL);
+
     UniValue utxos(UniValue::VARR);
     int currentTipHeight = -1;
     std::string bestHashStr;
@@ -715,7 +885,12 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         currentTipHeight = (int)chainActive.Height();
     }
 
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
+    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=first; it!=unspentOutputs.end(); it++) {
+        if (limit > 0 && utxos.size() == (size_t)limit) {
+            next = UnspentCursor(*std::prev(it));
+            break;
+        }
+
         UniValue output(UniValue::VOBJ);
         std::string address;
         if (!getAddressFromIndex(it->first.type, it->first.hashBytes, address)) {
@@ -773,12 +948,16 @@ UniValue getaddressutxos(const UniValue& params, bool fHelp)
         utxos.push_back(output);
     }
 
-    if (includeChainInfo) {
+    if (includeChainInfo || limit > 0) {
         UniValue result(UniValue::VOBJ);
         result.pushKV("utxos", utxos);
 
-        result.pushKV("hash",   bestHashStr);
-        result.pushKV("height", currentTipHeight);
+        if (limit > 0)
+            result.pushKV("next", next);
+        if (includeChainInfo) {
+            result.pushKV("hash",   bestHashStr);
+            result.pushKV("height", currentTipHeight);
+        }
         return result;
     } else {
         return utxos;
@@ -977,41 +1156,24 @@ UniValue getaddressbalance(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         includeImmatureBTs = params[1].get_bool();
 
-    std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> > addressIndex;
-
-    for (const auto& [addressHash, addressType] : addresses) {
-        if (!GetAddressIndex(addressHash, addressType, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
     CAmount balance = 0;
     CAmount received = 0;
     CAmount immature = 0;
 
     int currentTipHeight = chainActive.Tip()->nHeight;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        //If maturityHeight is negative it's superseded and we skip it
-        if (it->second.maturityHeight < 0)
-            continue;
-        //If maturityHeight > currentTipHeight it's immature and we store the immature balance
-        //and the balance only if specified
-        if (it->second.maturityHeight > currentTipHeight) {
-            immature += it->second.satoshis;
-            if (includeImmatureBTs) {
-                if (it->second.satoshis > 0) {
-                    received += it->second.satoshis;
-                }
-                balance += it->second.satoshis;
-            }
-        }
-        else {
-            if (it->second.satoshis > 0) {
-                received += it->second.satoshis;
-            }
-            balance += it->second.satoshis;
-        }
+    std::vector<CAddressBalanceValue> addressBalances;
+    bool fFetched = FetchForAddresses(addresses, addressBalances,
+        [](const std::pair<uint160, AddressType>& address, CAddressBalanceValue& addressBalance) {
+            return GetAddressBalance(address.first, address.second, addressBalance);
+        });
+    if (!fFetched) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    // The running balances kept with the address index: backward transfers maturing above the tip are immature
+    for (const CAddressBalanceValue& addressBalance : addressBalances) {
+        addressBalance.Get(currentTipHeight, includeImmatureBTs, balance, received, immature);
     }
 
     UniValue result(UniValue::VOBJ);
@@ -1081,18 +1243,20 @@ UniValue getaddresstxids(const UniValue& params, bool fHelp)
         }
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> > addressIndex;
+    std::vector<std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> > > addressIndexes;
+    bool fFetched = FetchForAddresses(addresses, addressIndexes,
+        [start, end](const std::pair<uint160, AddressType>& address, std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >& addressIndex) {
+            if (start > 0 && end > 0)
+                return GetAddressIndex(address.first, address.second, addressIndex, start, end);
+            return GetAddressIndex(address.first, address.second, addressIndex);
+        });
+    if (!fFetched) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
 
-    for (const auto& [addressHash, addressType] : addresses) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex(addressHash, addressType, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex(addressHash, addressType, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        }
+    std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> > addressIndex;
+    for (std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >& index : addressIndexes) {
+        addressIndex.insert(addressIndex.end(), std::make_move_iterator(index.begin()), std::make_move_iterator(index.end()));
     }
 
     std::set<std::pair<int, std::string> > txids;
@@ -8,11 +8,13 @@
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
+#include "netcapture.h"
 #include "protocol.h"
 #include "sync.h"
 #include "util.h"
 #include "version.h"
 #include "zen/utiltls.h"
+#include "zen/websocket_server.h"
 
 #include <boost/foreach.hpp>
 
@@ -116,7 +118,16 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
             "       n,                                   (numeric) the heights of blocks we're currently asking from this peer\n"
             "       ...\n"
             "    ],\n"
-            "    \"whitelisted\": true|false             (boolean) whether the peer is whitelisted\n"
+            "    \"blockdownloadrate\": n,               (numeric) the average download rate of the blocks from this peer, in bytes per second\n"
+            "    \"blocklatency\": n,                    (numeric) the average time from the request of a block to its arrival, in seconds\n"
+            "    \"maxblocksinflight\": n,               (numeric) the number of blocks that can be asked from this peer at once, sized on its download rate\n"
+            "    \"whitelisted\": true|false,            (boolean) whether the peer is whitelisted\n"
+            "    \"txreconciliation\": {                 (object) the reconciliation of the transactions announced, with -txreconciliation\n"
+            "       \"enabled\": true|false,             (boolean) whether the transactions are reconciled with the peer\n"
+            "       \"flood\": true|false,               (boolean) whether the transactions are also announced to the peer straight away\n"
+            "       \"rounds\": n,                       (numeric) the reconciliations completed\n"
+            "       \"shared\": n                        (numeric) the transactions both sides had, not announced\n"
+            "    }\n"
             "  }\n"
             "  ,...\n"
             "]\n"
@@ -169,10 +180,19 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
                 heights.push_back(height);
             }
             obj.pushKV("inflight", heights);
+            obj.pushKV("blockdownloadrate", statestats.dBlockDownloadRate);
+            obj.pushKV("blocklatency", statestats.nBlockLatency / 1e6);
+            obj.pushKV("maxblocksinflight", statestats.nMaxBlocksInFlight);
             obj.pushKV("addr_processed", stats.m_addr_processed);
             obj.pushKV("addr_rate_limited", stats.m_addr_rate_limited);
         }
         obj.pushKV("whitelisted", stats.fWhitelisted);
+        UniValue recon(UniValue::VOBJ);
+        recon.pushKV("enabled", stats.fTxReconciliation);
+        recon.pushKV("flood", stats.fTxReconciliationFlood);
+        recon.pushKV("rounds", stats.nTxReconciliationRounds);
+        recon.pushKV("shared", stats.nTxReconciliationShared);
+        obj.pushKV("txreconciliation", recon);
 
         ret.push_back(obj);
     }
@@ -180,6 +200,160 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
     return ret;
 }
 
+UniValue getwsinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getwsinfo\n"
+            "\nReturns data about each connection to the websocket server as a json array of objects.\n"
+
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"id\": n,                              (numeric) connection index\n"
+            "    \"addr\": \"host:port\",                (string) the ip address and port of the client\n"
+            "    \"binary\": true|false,                 (boolean) whether the blocks and the headers are sent in binary frames\n"
+            "    \"scfilter\": n,                        (numeric) the number of sidechains the client subscribed to, 0 for all\n"
+            "    \"recvframes\": n,                      (numeric) the messages received\n"
+            "    \"recvbytes\": n,                       (numeric) the bytes received\n"
+            "    \"queuedframes\": n,                    (numeric) the messages waiting to be sent\n"
+            "    \"queuedbytes\": n,                     (numeric) the bytes waiting to be sent\n"
+            "    \"maxqueuedbytes\": n,                  (numeric) the most bytes that were waiting to be sent at once\n"
+            "    \"sentframes\": n,                      (numeric) the messages sent\n"
+            "    \"sentbytes\": n,                       (numeric) the bytes sent\n"
+            "    \"coalesced\": n,                       (numeric) the tip and template events superseded by a newer one before being sent\n"
+            "    \"dropped\": n                          (numeric) the events dropped because the client was too slow (-wsslowclients=drop)\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getwsinfo", "")
+            + HelpExampleRpc("getwsinfo", "")
+        );
+
+    vector<WsConnectionStats> vstats;
+    GetWsConnectionStats(vstats);
+
+    UniValue ret(UniValue::VARR);
+
+    for (const WsConnectionStats& stats : vstats) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("id", (int64_t)stats.nId);
+        obj.pushKV("addr", stats.addr);
+        obj.pushKV("binary", stats.fBinary);
+        obj.pushKV("scfilter", (int64_t)stats.nScFilter);
+        obj.pushKV("recvframes", stats.nRecvFrames);
+        obj.pushKV("recvbytes", stats.nRecvBytes);
+        obj.pushKV("queuedframes", stats.nQueuedFrames);
+        obj.pushKV("queuedbytes", stats.nQueuedBytes);
+        obj.pushKV("maxqueuedbytes", stats.nMaxQueuedBytes);
+        obj.pushKV("sentframes", stats.nSentFrames);
+        obj.pushKV("sentbytes", stats.nSentBytes);
+        obj.pushKV("coalesced", stats.nCoalesced);
+        obj.pushKV("dropped", stats.nDropped);
+
+        ret.push_back(obj);
+    }
+
+    return ret;
+}
+
+static UniValue WsLatencyToJSON(const WsLatencyStats& latency)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("count", latency.nCount);
+    obj.pushKV("avgus", latency.nCount ? latency.nTotalMicros / latency.nCount : 0);
+    obj.pushKV("maxus", latency.nMaxMicros);
+    UniValue buckets(UniValue::VOBJ);
+    for (int i = 0; i < WsLatencyStats::BUCKETS; i++) {
+        if (latency.vBuckets[i] == 0)
+            continue;
+        buckets.pushKV(i == WsLatencyStats::BUCKETS - 1 ? std::string("inf") : std::to_string(1ULL << i), latency.vBuckets[i]);
+    }
+    obj.pushKV("buckets", buckets);
+    return obj;
+}
+
+UniValue getwsserverinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getwsserverinfo\n"
+            "\nReturns the figures of the websocket server since it started: its traffic, and the latencies of the requests\n"
+            "of each type and of the messages of each kind, as histograms of microseconds.\n"
+            "A latency is counted in the first bucket whose bound, in microseconds, is above it; \"inf\" for the longer ones.\n"
+
+            "\nResult:\n"
+            "{\n"
+            "  \"connections\": n,                     (numeric) the connections open\n"
+            "  \"totalconnections\": n,                (numeric) the connections accepted\n"
+            "  \"recvframes\": n,                      (numeric) the messages received\n"
+            "  \"recvbytes\": n,                       (numeric) the bytes received\n"
+            "  \"sentframes\": n,                      (numeric) the messages sent\n"
+            "  \"sentbytes\": n,                       (numeric) the bytes sent\n"
+            "  \"maxqueuedbytes\": n,                  (numeric) the most bytes that were waiting to be sent to a connection at once\n"
+            "  \"requests\": {                         (json object) by request type, the ones received at least once\n"
+            "    \"type\": {\n"
+            "      \"errors\": n,                       (numeric) the requests answered with an error\n"
+            "      \"parse\": {                         (json object) the time to read the request\n"
+            "        \"count\": n,                      (numeric) the requests timed\n"
+            "        \"avgus\": n,                      (numeric) the average, in microseconds\n"
+            "        \"maxus\": n,                      (numeric) the longest, in microseconds\n"
+            "        \"buckets\": { \"bound\": n, ... }  (json object) the histogram, without the empty buckets\n"
+            "      },\n"
+            "      \"handler\": { ... }                 (json object) the time to handle the request, until its answer is queued\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"output\": {                           (json object) by kind of message: response, event, tipevent, templateevent\n"
+            "    \"kind\": {\n"
+            "      \"queuewait\": { ... }               (json object) the time the messages waited to be written\n"
+            "      \"write\": { ... }                   (json object) the time to write them to the socket\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("getwsserverinfo", "")
+            + HelpExampleRpc("getwsserverinfo", "")
+        );
+
+    WsServerStats stats;
+    GetWsServerStats(stats);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("connections", stats.nConnections);
+    ret.pushKV("totalconnections", stats.nTotalConnections);
+    ret.pushKV("recvframes", stats.nRecvFrames);
+    ret.pushKV("recvbytes", stats.nRecvBytes);
+    ret.pushKV("sentframes", stats.nSentFrames);
+    ret.pushKV("sentbytes", stats.nSentBytes);
+    ret.pushKV("maxqueuedbytes", stats.nMaxQueuedBytes);
+
+    UniValue requests(UniValue::VOBJ);
+    for (const WsRequestStats& req : stats.vRequests) {
+        if (req.parse.nCount == 0)
+            continue;
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("errors", req.nErrors);
+        obj.pushKV("parse", WsLatencyToJSON(req.parse));
+        obj.pushKV("handler", WsLatencyToJSON(req.handler));
+        requests.pushKV(req.name, obj);
+    }
+    ret.pushKV("requests", requests);
+
+    UniValue output(UniValue::VOBJ);
+    for (const WsOutputStats& out : stats.vOutputs) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("queuewait", WsLatencyToJSON(out.queueWait));
+        obj.pushKV("write", WsLatencyToJSON(out.write));
+        output.pushKV(out.name, obj);
+    }
+    ret.pushKV("output", output);
+
+    return ret;
+}
+
 UniValue addnode(const UniValue& params, bool fHelp)
 {
     string strCommand;
@@ -626,3 +800,82 @@ UniValue clearbanned(const UniValue& params, bool fHelp)
 
     return NullUniValue;
 }
+
+UniValue replaymessages(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "replaymessages \"file\"\n"
+            "\nFeed the messages a node recorded with -capturemessages to the message processing, as fast as they are\n"
+            "processed, and return how long they took. The chain state and the mempool change as they did on the\n"
+            "capturing node: this is meant for a copy of its data directory, with no connections (-connect=0).\n"
+            "The locks are profiled during the replay, getlockstats starts counting again.\n"
+            "\nArguments:\n"
+            "1. \"file\"                       (string, required) the capture, relative to the data directory\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"messages\": n,                (numeric) the messages processed\n"
+            "  \"skipped\": n,                 (numeric) the messages of the peers disconnected meanwhile\n"
+            "  \"peers\": n,                   (numeric) the peers of the capture\n"
+            "  \"seconds\": x.xxx,             (numeric) processing the messages\n"
+            "  \"messagespersecond\": x.xxx,   (numeric) the throughput\n"
+            "  \"commands\": {                 (json object) the time processing a message, by command\n"
+            "    \"command\": {\n"
+            "      \"count\": n,                (numeric) the messages\n"
+            "      \"avgus\": n,                (numeric) the average, in microseconds\n"
+            "      \"p50us\": n,                (numeric) the median\n"
+            "      \"p90us\": n,                (numeric) the 90th percentile\n"
+            "      \"p99us\": n,                (numeric) the 99th percentile\n"
+            "      \"maxus\": n                 (numeric) the longest\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"lockwait\": {                 (json object) the time waiting for the locks\n"
+            "    \"totalus\": n,               (numeric) for all the locks, in microseconds\n"
+            "    \"contended\": n,             (numeric) the locks that had to wait\n"
+            "    \"cs_main\": n                (numeric) for cs_main, in microseconds\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("replaymessages", "\"capture.dat\"")
+            + HelpExampleRpc("replaymessages", "\"capture.dat\"")
+        );
+
+    boost::filesystem::path path(params[0].get_str());
+    if (!path.is_complete())
+        path = GetDataDir() / path;
+
+    CReplayStats stats;
+    std::string strError;
+    if (!ReplayCapturedMessages(path, stats, strError))
+        throw JSONRPCError(RPC_MISC_ERROR, strError);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("messages", stats.nMessages);
+    ret.pushKV("skipped", stats.nSkipped);
+    ret.pushKV("peers", (uint64_t)stats.nPeers);
+    ret.pushKV("seconds", stats.nMicros / 1000000.0);
+    ret.pushKV("messagespersecond", stats.nMicros > 0 ? stats.nMessages * 1000000.0 / stats.nMicros : 0.0);
+    UniValue commands(UniValue::VOBJ);
+    for (const auto& latencies : stats.mapLatencies) {
+        UniValue command = percentilesToJSON(latencies.second, "us");
+        command.pushKV("count", (uint64_t)latencies.second.size());
+        commands.pushKV(latencies.first, command);
+    }
+    ret.pushKV("commands", commands);
+
+    uint64_t nWaitMicros = 0;
+    uint64_t nContended = 0;
+    uint64_t nMainWaitMicros = 0;
+    for (const LockSiteStats& site : stats.vLockStats) {
+        nWaitMicros += site.wait.nTotalMicros;
+        nContended += site.nContended;
+        if (site.name == "cs_main")
+            nMainWaitMicros += site.wait.nTotalMicros;
+    }
+    UniValue lockwait(UniValue::VOBJ);
+    lockwait.pushKV("totalus", nWaitMicros);
+    lockwait.pushKV("contended", nContended);
+    lockwait.pushKV("cs_main", nMainWaitMicros);
+    ret.pushKV("lockwait", lockwait);
+    return ret;
+}
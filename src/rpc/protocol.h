@@ -18,6 +18,7 @@
 enum HTTPStatusCode
 {
     HTTP_OK                    = 200,
+    HTTP_NOT_MODIFIED          = 304,
     HTTP_BAD_REQUEST           = 400,
     HTTP_UNAUTHORIZED          = 401,
     HTTP_FORBIDDEN             = 403,
@@ -74,6 +75,7 @@ enum RPCErrorCode
     RPC_WALLET_WRONG_ENC_STATE       = -15, //! Command given in wrong wallet encryption state (encrypting an encrypted wallet etc.)
     RPC_WALLET_ENCRYPTION_FAILED     = -16, //! Failed to encrypt the wallet
     RPC_WALLET_ALREADY_UNLOCKED      = -17, //! Wallet is already unlocked
+    RPC_WALLET_NOT_FOUND             = -18, //! Invalid wallet specified
 
     //! Hard fork deprecation
     RPC_HARD_FORK_DEPRECATION        = -40  //! Method deprecated after hard fork
@@ -164,6 +164,10 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
         Sidechain::AddCeasedSidechainWithdrawalInputsToJSON(tx, entry);
     }
 
+    // the spends of all the outputs, at once
+    std::map<unsigned int, CSpentIndexValue> mapSpentInfo;
+    GetSpentIndexOutputs(txid, tx.GetVout().size(), mapSpentInfo);
+
     UniValue vout(UniValue::VARR);
     for (unsigned int i = 0; i < tx.GetVout().size(); i++) {
         const CTxOut& txout = tx.GetVout()[i];
@@ -176,12 +180,11 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
         out.pushKV("scriptPubKey", o);
 
         // Add spent information if spentindex is enabled
-        CSpentIndexValue spentInfo;
-        CSpentIndexKey spentKey(txid, i);
-        if (GetSpentIndex(spentKey, spentInfo)) {
-            out.pushKV("spentTxId", spentInfo.txid.GetHex());
-            out.pushKV("spentIndex", (int)spentInfo.inputIndex);
-            out.pushKV("spentHeight", spentInfo.blockHeight);
+        std::map<unsigned int, CSpentIndexValue>::const_iterator itSpent = mapSpentInfo.find(i);
+        if (itSpent != mapSpentInfo.end()) {
+            out.pushKV("spentTxId", itSpent->second.txid.GetHex());
+            out.pushKV("spentIndex", (int)itSpent->second.inputIndex);
+            out.pushKV("spentHeight", itSpent->second.blockHeight);
         }
 
         vout.push_back(out);
@@ -198,6 +201,8 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
     entry.pushKV("vjoinsplit", vjoinsplit);
 
     if (!hashBlock.IsNull()) {
+        // getrawtransaction converts outside cs_main, only this lookup needs it
+        LOCK(cs_main);
         entry.pushKV("blockhash", hashBlock.GetHex());
         BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
         if (mi != mapBlockIndex.end() && (*mi).second) {
@@ -249,6 +254,10 @@ void CertToJSON(const CScCertificate& cert, const uint256 hashBlock, UniValue& e
         vin.push_back(in);
     }
     entry.pushKV("vin", vin);
+    // the spends of all the outputs, at once
+    std::map<unsigned int, CSpentIndexValue> mapSpentInfo;
+    GetSpentIndexOutputs(certId, cert.GetVout().size(), mapSpentInfo);
+
     UniValue vout(UniValue::VARR);
     for (unsigned int i = 0; i < cert.GetVout().size(); i++) {
         const CTxOut& txout = cert.GetVout()[i];
@@ -261,12 +270,11 @@ void CertToJSON(const CScCertificate& cert, const uint256 hashBlock, UniValue& e
         out.pushKV("scriptPubKey", o);
 
         // Add spent information if spentindex is enabled
-        CSpentIndexValue spentInfo;
-        CSpentIndexKey spentKey(certId, i);
-        if (GetSpentIndex(spentKey, spentInfo)) {
-            out.pushKV("spentTxId", spentInfo.txid.GetHex());
-            out.pushKV("spentIndex", (int)spentInfo.inputIndex);
-            out.pushKV("spentHeight", spentInfo.blockHeight);
+        std::map<unsigned int, CSpentIndexValue>::const_iterator itSpent = mapSpentInfo.find(i);
+        if (itSpent != mapSpentInfo.end()) {
+            out.pushKV("spentTxId", itSpent->second.txid.GetHex());
+            out.pushKV("spentIndex", (int)itSpent->second.inputIndex);
+            out.pushKV("spentHeight", itSpent->second.blockHeight);
         }
 
         if (cert.IsBackwardTransfer(i))
@@ -308,6 +316,7 @@ void CertToJSON(const CScCertificate& cert, const uint256 hashBlock, UniValue& e
     entry.pushKV("vjoinsplit", vjoinsplit);
 
     if (!hashBlock.IsNull()) {
+        LOCK(cs_main);
         entry.pushKV("blockhash", hashBlock.GetHex());
         BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
         if (mi != mapBlockIndex.end() && (*mi).second) {
@@ -546,6 +555,58 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
     return result;
 }
 
+//! The merkle trees of the blocks of the transactions recently proven
+static CBlockMerkleTreeCache merkleTreeCache(16);
+
+/**
+ * The block in which txid is included: the one of hashBlock if not null, else the one of an output of txid still
+ * unspent or, with -txindex, the one the index gives. The caller must hold cs_main.
+ */
+static CBlockIndex* GetProofBlockIndex(const uint256& txid, uint256 hashBlock)
+{
+    AssertLockHeld(cs_main);
+    if (!hashBlock.IsNull())
+    {
+        BlockMap::iterator mi = mapBlockIndex.find(hashBlock);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        return mi->second;
+    }
+
+    CCoins coins;
+    if (pcoinsTip->GetCoins(txid, coins) && coins.nHeight > 0 && coins.nHeight <= chainActive.Height())
+        return chainActive[coins.nHeight];
+
+    // allocated by the callee
+    std::unique_ptr<CTransactionBase> pTxBase;
+    static const bool ALLOW_SLOW = false;
+    if (!GetTxBaseObj(txid, pTxBase, hashBlock, ALLOW_SLOW) || !pTxBase)
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction/Certificate not yet in block");
+    if (!mapBlockIndex.count(hashBlock))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Transaction/Certificate index corrupt");
+    return mapBlockIndex[hashBlock];
+}
+
+//! The merkle tree of the block of pblockindex, read from disk if not cached
+static std::shared_ptr<const CBlockMerkleTree> GetBlockMerkleTree(const CBlockIndex* pblockindex)
+{
+    std::shared_ptr<const CBlockMerkleTree> tree = merkleTreeCache.Get(pblockindex->GetBlockHash());
+    if (tree)
+        return tree;
+
+    CBlock block;
+    if(!ReadBlockFromDisk(block, pblockindex))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+    return merkleTreeCache.Insert(block);
+}
+
+static std::string EncodeMerkleBlock(const CMerkleBlock& mb)
+{
+    CDataStream ssMB(SER_NETWORK, PROTOCOL_VERSION);
+    ssMB << mb;
+    return HexStr(ssMB.begin(), ssMB.end());
+}
+
 UniValue gettxoutproof(const UniValue& params, bool fHelp)
 {
     if (fHelp || (params.size() != 1 && params.size() != 2))
@@ -590,53 +651,86 @@ UniValue gettxoutproof(const UniValue& params, bool fHelp)
 
     LOCK(cs_main);
 
-    CBlockIndex* pblockindex = NULL;
-
     uint256 hashBlock;
     if (params.size() > 1)
-    {
         hashBlock = uint256S(params[1].get_str());
-        if (!mapBlockIndex.count(hashBlock))
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-        pblockindex = mapBlockIndex[hashBlock];
-    } else {
-        CCoins coins;
-        if (pcoinsTip->GetCoins(oneTxid, coins) && coins.nHeight > 0 && coins.nHeight <= chainActive.Height())
-            pblockindex = chainActive[coins.nHeight];
+    std::shared_ptr<const CBlockMerkleTree> tree = GetBlockMerkleTree(GetProofBlockIndex(oneTxid, hashBlock));
+
+    std::vector<bool> vMatch(tree->GetTxCount(), false);
+    for (const uint256& txid : setTxids) {
+        int nIndex = tree->Find(txid);
+        if (nIndex < 0)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "(Not all) transactions/Certificates not found in specified block");
+        vMatch[nIndex] = true;
     }
 
-    if (pblockindex == NULL)
-    {
-        // allocated by the callee
-        std::unique_ptr<CTransactionBase> pTxBase;
-        static const bool ALLOW_SLOW = false;
-        if (!GetTxBaseObj(oneTxid, pTxBase, hashBlock, ALLOW_SLOW) || !pTxBase)
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction/Certificate not yet in block");
-        if (!mapBlockIndex.count(hashBlock))
-            throw JSONRPCError(RPC_INTERNAL_ERROR, "Transaction/Certificate index corrupt");
-        pblockindex = mapBlockIndex[hashBlock];
-    }
+    return EncodeMerkleBlock(tree->GetMerkleBlock(vMatch));
+}
 
-    CBlock block;
-    if(!ReadBlockFromDisk(block, pblockindex))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+UniValue gettxoutproofs(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "gettxoutproofs [{\"txid\":\"id\",\"blockhash\":\"hash\"},...]\n"
+            "\nReturns the hex-encoded proofs that transactions/certificates were included in blocks, one for each, as\n"
+            "gettxoutproof [\"txid\"] ( blockhash ) would. The blocks are read from disk once for all their proofs.\n"
+            "\nArguments:\n"
+            "1. \"outputs\"           (array, required) The transactions/certificates to prove\n"
+            "    [\n"
+            "      {\n"
+            "        \"txid\":\"id\",      (string, required) A transaction/certificate hash\n"
+            "        \"blockhash\":\"hash\" (string, optional) The block in which it is included, found as gettxoutproof does if omitted\n"
+            "      }\n"
+            "      ,...\n"
+            "    ]\n"
+            "\nResult:\n"
+            "[                        (array) In the order of the arguments\n"
+            "  {\n"
+            "    \"txid\":\"id\",          (string) The transaction/certificate hash\n"
+            "    \"blockhash\":\"hash\",   (string) The block in which it is included\n"
+            "    \"proof\":\"hex\"         (string) The serialized, hex-encoded proof\n"
+            "    \"error\": {...}        (object) Instead of blockhash and proof, the error of a transaction which can not be proven\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("gettxoutproofs", "'[{\"txid\":\"mytxid\"},{\"txid\":\"myothertxid\",\"blockhash\":\"myblockhash\"}]'")
+            + HelpExampleRpc("gettxoutproofs", "[{\"txid\":\"mytxid\"},{\"txid\":\"myothertxid\",\"blockhash\":\"myblockhash\"}]")
+        );
 
-    unsigned int ntxFound = 0;
-    for (const CTransaction& tx: block.vtx)
-        if (setTxids.count(tx.GetHash()))
-            ntxFound++;
-    for (const CScCertificate& cert: block.vcert)
-        if (setTxids.count(cert.GetHash()))
-            ntxFound++;
+    const UniValue& outputs = params[0].get_array();
+    std::vector<std::pair<uint256, uint256> > vOutputs;
+    for (size_t idx = 0; idx < outputs.size(); idx++) {
+        const UniValue& o = outputs[idx].get_obj();
+        uint256 hashBlock;
+        if (!find_value(o, "blockhash").isNull())
+            hashBlock = ParseHashO(o, "blockhash");
+        vOutputs.push_back(std::make_pair(ParseHashO(o, "txid"), hashBlock));
+    }
 
-    if (ntxFound != setTxids.size())
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "(Not all) transactions/Certificates not found in specified block");
+    LOCK(cs_main);
 
-    CDataStream ssMB(SER_NETWORK, PROTOCOL_VERSION);
-    CMerkleBlock mb(block, setTxids);
-    ssMB << mb;
-    std::string strHex = HexStr(ssMB.begin(), ssMB.end());
-    return strHex;
+    UniValue result(UniValue::VARR);
+    for (const auto& [txid, hashBlock] : vOutputs) {
+        UniValue proof(UniValue::VOBJ);
+        proof.pushKV("txid", txid.GetHex());
+        try {
+            const CBlockIndex* pblockindex = GetProofBlockIndex(txid, hashBlock);
+            std::shared_ptr<const CBlockMerkleTree> tree = GetBlockMerkleTree(pblockindex);
+            int nIndex = tree->Find(txid);
+            if (nIndex < 0)
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Transaction/Certificate not found in specified block");
+            std::vector<bool> vMatch(tree->GetTxCount(), false);
+            vMatch[nIndex] = true;
+
+            proof.pushKV("blockhash", pblockindex->GetBlockHash().GetHex());
+            proof.pushKV("proof", EncodeMerkleBlock(tree->GetMerkleBlock(vMatch)));
+        } catch (const UniValue& objError) {
+            proof.pushKV("error", objError);
+        }
+        result.push_back(proof);
+    }
+    return result;
 }
 
 UniValue verifytxoutproof(const UniValue& params, bool fHelp)
@@ -678,6 +772,62 @@ UniValue verifytxoutproof(const UniValue& params, bool fHelp)
     return res;
 }
 
+UniValue verifytxoutproofs(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "verifytxoutproofs [\"proof\",...]\n"
+            "\nVerifies proofs as verifytxoutproof does, each in turn\n"
+            "\nArguments:\n"
+            "1. \"hexproofs\"         (array, required) The hex-encoded proofs generated by gettxoutproof or gettxoutproofs\n"
+            "\nResult:\n"
+            "[                        (array) In the order of the arguments\n"
+            "  {\n"
+            "    \"txids\": [\"txid\"]    (array, strings) The txid(s) which the proof commits to, or empty array if the proof is invalid\n"
+            "    \"error\": {...}        (object) Instead of txids, the error of a proof whose block is not in our best chain\n"
+            "  }\n"
+            "  ,...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("verifytxoutproofs", "'[\"hexproof\",\"otherhexproof\"]'")
+            + HelpExampleRpc("verifytxoutproofs", "[\"hexproof\",\"otherhexproof\"]")
+        );
+
+    const UniValue& proofs = params[0].get_array();
+    std::vector<CMerkleBlock> vMerkleBlock(proofs.size());
+    for (size_t idx = 0; idx < proofs.size(); idx++) {
+        CDataStream ssMB(ParseHexV(proofs[idx], "proof"), SER_NETWORK, PROTOCOL_VERSION);
+        ssMB >> vMerkleBlock[idx];
+    }
+
+    // the proofs are checked out of the lock, only their blocks are looked up under it
+    std::vector<std::vector<uint256> > vMatches(vMerkleBlock.size());
+    std::vector<bool> vValid(vMerkleBlock.size());
+    for (size_t idx = 0; idx < vMerkleBlock.size(); idx++)
+        vValid[idx] = (vMerkleBlock[idx].txn.ExtractMatches(vMatches[idx]) == vMerkleBlock[idx].header.hashMerkleRoot);
+
+    LOCK(cs_main);
+
+    UniValue result(UniValue::VARR);
+    for (size_t idx = 0; idx < vMerkleBlock.size(); idx++) {
+        UniValue verified(UniValue::VOBJ);
+        UniValue txids(UniValue::VARR);
+        if (vValid[idx]) {
+            BlockMap::iterator mi = mapBlockIndex.find(vMerkleBlock[idx].header.GetHash());
+            if (mi == mapBlockIndex.end() || !chainActive.Contains(mi->second)) {
+                verified.pushKV("error", JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found in chain"));
+                result.push_back(verified);
+                continue;
+            }
+            for (const uint256& hash : vMatches[idx])
+                txids.push_back(hash.GetHex());
+        }
+        verified.pushKV("txids", txids);
+        result.push_back(verified);
+    }
+    return result;
+}
+
 void AddInputsToRawObject(CMutableTransactionBase& rawTxObj, const UniValue& inputs)
 {
     // inputs
@@ -721,6 +871,21 @@ void AddOutputsToRawObject(CMutableTransactionBase& rawTxObj, const UniValue& se
 
 void AddBwtOutputsToRawObject(CMutableScCertificate& rawCert, const UniValue& backwardOutputs)
 {
+    if (backwardOutputs.isStr())
+    {
+        // packed list, already checked but for the dust, which is left to cert processing as for the json list
+        std::vector<CBackwardTransferOut> vBwt;
+        std::string error;
+        if (!Sidechain::AddPackedBackwardTransfers(backwardOutputs.get_str(), vBwt, error))
+            throw JSONRPCError(RPC_INVALID_PARAMETER, string("Invalid parameter, backward transfers: ") + error);
+
+        rawCert.reserveOut(rawCert.getVout().size() + vBwt.size());
+        for (const CBackwardTransferOut& bwt : vBwt)
+            rawCert.addBwt(CTxOut(bwt.nValue, GetScriptForDestination(CKeyID(bwt.pubKeyHash), false)));
+        return;
+    }
+
+    rawCert.reserveOut(rawCert.getVout().size() + backwardOutputs.size());
     for (const UniValue& o : backwardOutputs.getValues())
     {
         if (!o.isObject())
@@ -1149,6 +1314,8 @@ UniValue createrawcertificate(const UniValue& params, bool fHelp)
             "      }\n"
             "      , ...\n"
             "    ]\n"
+            "    or, for a large number of transfers, a json string with the hex of the packed list: for each transfer the amount\n"
+            "    in zatoshi (8 bytes, little endian) followed by the pubkey hash of the receiver (20 bytes), as serialized in a certificate\n"
             "4. \"certificate parameters\" (string, required) A json object with a list of key/values\n"
             "    {\n"
             "      \"scid\":\"id\",                    (string, required) The side chain id\n"
@@ -1174,12 +1341,16 @@ UniValue createrawcertificate(const UniValue& params, bool fHelp)
 
     LOCK(cs_main);
     RPCTypeCheck(params, boost::assign::list_of 
-        (UniValue::VARR)(UniValue::VOBJ) (UniValue::VARR)(UniValue::VOBJ));
+        (UniValue::VARR)(UniValue::VOBJ));
+    if (!params[2].isArray() && !params[2].isStr())
+        throw JSONRPCError(RPC_TYPE_ERROR, strprintf("Expected type array or string, got %s", uvTypeName(params[2].type())));
+    if (!params[3].isObject())
+        throw JSONRPCError(RPC_TYPE_ERROR, strprintf("Expected type object, got %s", uvTypeName(params[3].type())));
 
-    UniValue inputs          = params[0].get_array();
-    UniValue standardOutputs = params[1].get_obj();
-    UniValue backwardOutputs = params[2].get_array();
-    UniValue cert_params     = params[3].get_obj();
+    const UniValue& inputs          = params[0].get_array();
+    const UniValue& standardOutputs = params[1].get_obj();
+    const UniValue& backwardOutputs = params[2];
+    const UniValue& cert_params     = params[3].get_obj();
 
     CMutableScCertificate rawCert;
     rawCert.nVersion = SC_CERT_VERSION;
@@ -1435,6 +1606,9 @@ static void TxCswInErrorToJSON(const CTxCeasedSidechainWithdrawalInput& txcswin,
 
 UniValue signrawtransaction(const UniValue& params, bool fHelp)
 {
+#ifdef ENABLE_WALLET
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+#endif
     if (fHelp || params.size() < 1 || params.size() > 4)
         throw runtime_error(
             "signrawtransaction \"hexstring\" ( [{\"txid\":\"id\",\"vout\":n,\"scriptPubKey\":\"hex\",\"redeemScript\":\"hex\"},...] [\"privatekey1\",...] sighashtype )\n"
@@ -1495,7 +1669,7 @@ UniValue signrawtransaction(const UniValue& params, bool fHelp)
         );
 
 #ifdef ENABLE_WALLET
-    LOCK2(cs_main, pwalletMain ? &pwalletMain->cs_wallet : NULL);
+    LOCK2(cs_main, pwallet ? &pwallet->cs_wallet : NULL);
 #else
     LOCK(cs_main);
 #endif
@@ -1544,9 +1718,8 @@ UniValue signrawtransaction(const UniValue& params, bool fHelp)
     std::vector<CTxIn> txInputs = (txVersion != SC_CERT_VERSION) ? txVariants[0].vin : certificate.vin;
     // Fetch previous transactions (inputs):
     {
-        LOCK(mempool.cs);
         CCoinsViewCache &viewChain = *pcoinsTip;
-        CCoinsViewMemPool viewMempool(&viewChain, mempool);
+        CCoinsViewMemPoolSnapshot viewMempool(&viewChain, mempool);
         view.SetBackend(viewMempool); // temporarily switch cache backend to db+mempool view
 
         BOOST_FOREACH(const CTxIn& txin, txInputs) {
@@ -1555,7 +1728,7 @@ UniValue signrawtransaction(const UniValue& params, bool fHelp)
             view.AccessCoins(prevHash); // this is certainly allowed to fail
         }
 
-        view.SetBackend(viewDummy); // switch back to avoid locking mempool for too long
+        view.SetBackend(viewDummy); // switch back, the inputs are all in the cache now
     }
 
     bool fGivenKeys = false;
@@ -1576,7 +1749,7 @@ UniValue signrawtransaction(const UniValue& params, bool fHelp)
         }
     }
 #ifdef ENABLE_WALLET
-    else if (pwalletMain)
+    else if (pwallet)
         EnsureWalletIsUnlocked();
 #endif
 
@@ -1630,7 +1803,7 @@ UniValue signrawtransaction(const UniValue& params, bool fHelp)
     }
     
 #ifdef ENABLE_WALLET
-    const CKeyStore& keystore = ((fGivenKeys || !pwalletMain) ? tempKeystore : *pwalletMain);
+    const CKeyStore& keystore = ((fGivenKeys || !pwallet) ? tempKeystore : *pwallet);
 #else
     const CKeyStore& keystore = tempKeystore;
 #endif
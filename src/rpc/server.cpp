@@ -6,15 +6,19 @@
 #include "rpc/server.h"
 
 #include "base58.h"
+#include "httpserver.h"
 #include "init.h"
 #include "random.h"
+#include "rpc/jsonwriter.h"
 #include "sync.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "utilstrencodings.h"
 #include "asyncrpcqueue.h"
 
+#include <fstream>
 #include <memory>
+#include <set>
 
 #include <univalue.h>
 
@@ -277,6 +281,139 @@ UniValue stop(const UniValue& params, bool fHelp)
     return "Zen server stopping";
 }
 
+UniValue getrpcinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getrpcinfo\n"
+            "\nReturns the activity of the threads handling the RPC and REST requests, by class of method,\n"
+            "in the order of the priority of the requests waiting for a thread.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"threads\": n,                  (numeric) the threads handling the requests (-rpcthreads)\n"
+            "  \"classes\": [\n"
+            "    {\n"
+            "      \"name\": \"xxxx\",           (string) the class: mining, cheap, wallet or heavy\n"
+            "      \"maxrunning\": n,           (numeric) the requests of the class handled at most at once\n"
+            "      \"running\": n,              (numeric) the requests of the class being handled\n"
+            "      \"queued\": n,               (numeric) the requests of the class waiting for a thread\n"
+            "      \"done\": n,                 (numeric) the requests of the class handled\n"
+            "      \"rejected\": n,             (numeric) the requests refused because the queue was full\n"
+            "      \"avgwaitmicros\": n,        (numeric) the average wait for a thread, in microseconds\n"
+            "      \"maxwaitmicros\": n,        (numeric) the longest wait for a thread, in microseconds\n"
+            "      \"avgrunmicros\": n,         (numeric) the average handling time, in microseconds\n"
+            "      \"maxrunmicros\": n          (numeric) the longest handling time, in microseconds\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcinfo", "")
+            + HelpExampleRpc("getrpcinfo", "")
+        );
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("threads", GetArg("-rpcthreads", DEFAULT_HTTP_THREADS));
+    UniValue classes(UniValue::VARR);
+    for (const HTTPWorkClassStats& stats : GetHTTPWorkClassStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", stats.name);
+        obj.pushKV("maxrunning", (uint64_t)stats.nMaxRunning);
+        obj.pushKV("running", (uint64_t)stats.nRunning);
+        obj.pushKV("queued", (uint64_t)stats.nQueued);
+        obj.pushKV("done", stats.nDone);
+        obj.pushKV("rejected", stats.nRejected);
+        uint64_t nStarted = stats.nDone + stats.nRunning;
+        obj.pushKV("avgwaitmicros", nStarted ? stats.nTotalWaitMicros / (int64_t)nStarted : 0);
+        obj.pushKV("maxwaitmicros", stats.nMaxWaitMicros);
+        obj.pushKV("avgrunmicros", stats.nDone ? stats.nTotalRunMicros / (int64_t)stats.nDone : 0);
+        obj.pushKV("maxrunmicros", stats.nMaxRunMicros);
+        classes.push_back(obj);
+    }
+    ret.pushKV("classes", classes);
+    return ret;
+}
+
+static UniValue LockTimeStatsToJSON(const LockTimeStats& times, uint64_t nCount)
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("totalus", times.nTotalMicros);
+    obj.pushKV("avgus", nCount ? times.nTotalMicros / nCount : 0);
+    obj.pushKV("maxus", times.nMaxMicros);
+    UniValue buckets(UniValue::VOBJ);
+    for (int i = 0; i < LockTimeStats::BUCKETS; i++) {
+        if (times.vBuckets[i] == 0)
+            continue;
+        buckets.pushKV(i == LockTimeStats::BUCKETS - 1 ? std::string("inf") : std::to_string(1ULL << i), times.vBuckets[i]);
+    }
+    obj.pushKV("buckets", buckets);
+    return obj;
+}
+
+UniValue getlockstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 2)
+        throw runtime_error(
+            "getlockstats ( count reset )\n"
+            "\nReturns, when the node runs with -lockprofile, how long each LOCK site of the code waited for its lock\n"
+            "and held it, the sites with the longest total wait first.\n"
+            "A time is counted in the first bucket whose bound, in microseconds, is above it; \"inf\" for the longer ones.\n"
+            "\nArguments:\n"
+            "1. count                          (numeric, optional, default=50) the sites returned at most, 0 for all\n"
+            "2. reset                          (boolean, optional, default=false) start counting again after the reply\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"enabled\": true|false,         (boolean) whether the locks are profiled (-lockprofile)\n"
+            "  \"sites\": [\n"
+            "    {\n"
+            "      \"lock\": \"xxxx\",            (string) the lock, as named at the site, e.g. cs_main\n"
+            "      \"site\": \"file:line\",       (string) where it is taken\n"
+            "      \"locks\": n,                (numeric) the times it was taken there\n"
+            "      \"contended\": n,            (numeric) the times it had to wait for another thread\n"
+            "      \"wait\": {                  (json object) the wait of the contended locks\n"
+            "        \"totalus\": n,            (numeric) in total, in microseconds\n"
+            "        \"avgus\": n,              (numeric) on average, in microseconds\n"
+            "        \"maxus\": n,              (numeric) the longest, in microseconds\n"
+            "        \"buckets\": { \"bound\": n, ... }  (json object) the histogram, without the empty buckets\n"
+            "      },\n"
+            "      \"hold\": { ... }            (json object) the same for the time the lock was held\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getlockstats", "")
+            + HelpExampleCli("getlockstats", "10 true")
+            + HelpExampleRpc("getlockstats", "10, true")
+        );
+
+    int nCount = params.size() > 0 ? params[0].get_int() : 50;
+    if (nCount < 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count, must be non negative");
+    const bool fReset = params.size() > 1 && params[1].get_bool();
+
+    std::vector<LockSiteStats> vStats = GetLockStats(fReset);
+    std::sort(vStats.begin(), vStats.end(), [](const LockSiteStats& a, const LockSiteStats& b) {
+        return a.wait.nTotalMicros > b.wait.nTotalMicros;
+    });
+    if (nCount > 0 && vStats.size() > (size_t)nCount)
+        vStats.resize(nCount);
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("enabled", fLockProfile.load());
+    UniValue sites(UniValue::VARR);
+    for (const LockSiteStats& stats : vStats) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("lock", stats.name);
+        obj.pushKV("site", strprintf("%s:%d", stats.file, stats.nLine));
+        obj.pushKV("locks", stats.nLocks);
+        obj.pushKV("contended", stats.nContended);
+        obj.pushKV("wait", LockTimeStatsToJSON(stats.wait, stats.nContended));
+        obj.pushKV("hold", LockTimeStatsToJSON(stats.hold, stats.nLocks));
+        sites.push_back(obj);
+    }
+    ret.pushKV("sites", sites);
+    return ret;
+}
+
 /**
  * Call Table
  */
@@ -287,12 +424,15 @@ static const CRPCCommand vRPCCommands[] =
     { "control",            "getinfo",                &getinfo,                true  }, /* uses wallet if enabled */
     { "control",            "help",                   &help,                   true  },
     { "control",            "stop",                   &stop,                   true  },
+    { "control",            "getrpcinfo",             &getrpcinfo,             true  },
+    { "control",            "getlockstats",           &getlockstats,           true  },
     { "control",            "dbg_log",                &dbg_log,                true  },
     { "control",            "dbg_do",                 &dbg_do,                 true  },
     { "control",            "getscinfo",              &getscinfo,              true  },
     { "control",            "getactivecertdatahash",  &getactivecertdatahash,  true  },
     { "control",            "getceasingcumsccommtreehash", &getceasingcumsccommtreehash, true  },
     { "control",            "getscgenesisinfo",       &getscgenesisinfo,       true  },
+    { "control",            "getscactivity",          &getscactivity,          true  },
     { "control",            "getproofverifierstats",  &getproofverifierstats,  true  },
     { "control",            "setproofverifierlowpriorityguard",  &setproofverifierlowpriorityguard,  true  },
 
@@ -304,6 +444,8 @@ static const CRPCCommand vRPCCommands[] =
     { "network",            "getconnectioncount",     &getconnectioncount,     true  },
     { "network",            "getnettotals",           &getnettotals,           true  },
     { "network",            "getpeerinfo",            &getpeerinfo,            true  },
+    { "network",            "getwsinfo",              &getwsinfo,              true  },
+    { "network",            "getwsserverinfo",        &getwsserverinfo,        true  },
     { "network",            "ping",                   &ping,                   true  },
     { "network",            "setban",                 &setban,                 true  },
     { "network",            "listbanned",             &listbanned,             true  },
@@ -313,8 +455,8 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
     { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
-    { "blockchain",         "getblockexpanded",       &getblockexpanded,       true  },
+    { "blockchain",         "getblock",               &getblock,               true,  &getblock_stream },
+    { "blockchain",         "getblockexpanded",       &getblockexpanded,       true,  &getblockexpanded_stream },
 
     { "blockchain",         "getblockdeltas",         &getblockdeltas,         false },
     { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
@@ -327,11 +469,18 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
+    { "blockchain",         "getsigcacheinfo",        &getsigcacheinfo,        true  },
+    { "blockchain",         "getblockconnectstats",   &getblockconnectstats,   true  },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
+    { "blockchain",         "savemempool",            &savemempool,            true  },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
     { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
+    { "blockchain",         "gettxoutproofs",         &gettxoutproofs,         true  },
+    { "blockchain",         "verifytxoutproofs",      &verifytxoutproofs,      true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           true  },
+    { "blockchain",         "loadtxoutset",           &loadtxoutset,           false },
     { "blockchain",         "verifychain",            &verifychain,            true  },
     { "blockchain",         "checkcswnullifier",      &checkcswnullifier,      true  },
     { "blockchain",         "getcertmaturityinfo",    &getcertmaturityinfo,    true  },
@@ -339,6 +488,7 @@ static const CRPCCommand vRPCCommands[] =
 
     /* Mining */
     { "mining",             "getblocktemplate",       &getblocktemplate,       true  },
+    { "mining",             "getblocktemplatepayouts", &getblocktemplatepayouts, true  },
     { "mining",             "getmininginfo",          &getmininginfo,          true  },
     { "mining",             "getlocalsolps",          &getlocalsolps,          true  },
     { "mining",             "getnetworksolps",        &getnetworksolps,        true  },
@@ -370,6 +520,7 @@ static const CRPCCommand vRPCCommands[] =
 
     /* Address index */
     { "addressindex",       "getaddressmempool",      &getaddressmempool,      true  },
+    { "addressindex",       "waitforaddressmempool",  &waitforaddressmempool,  true  },
     { "addressindex",       "getaddressutxos",        &getaddressutxos,        false },
     { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false },
     { "addressindex",       "getaddresstxids",        &getaddresstxids,        false },
@@ -381,12 +532,14 @@ static const CRPCCommand vRPCCommands[] =
     { "util",               "verifymessage",          &verifymessage,          true  },
     { "util",               "estimatefee",            &estimatefee,            true  },
     { "util",               "estimatepriority",       &estimatepriority,       true  },
+    { "util",               "estimatescfee",          &estimatescfee,          true  },
     { "util",               "z_validateaddress",      &z_validateaddress,      true  }, /* uses wallet if enabled */
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        true  },
     { "hidden",             "reconsiderblock",        &reconsiderblock,        true  },
     { "hidden",             "setmocktime",            &setmocktime,            true  },
+    { "hidden",             "replaymessages",         &replaymessages,         true  },
 #ifdef ENABLE_WALLET
     { "hidden",             "resendwallettransactions", &resendwallettransactions, true},
 #endif
@@ -414,6 +567,7 @@ static const CRPCCommand vRPCCommands[] =
     { "wallet",             "importaddress",          &importaddress,          true  },
     { "wallet",             "keypoolrefill",          &keypoolrefill,          true  },
     { "wallet",             "listaccounts",           &listaccounts,           false },
+    { "wallet",             "listwallets",            &listwallets,            true  },
     { "wallet",             "listaddressgroupings",   &listaddressgroupings,   false },
     { "wallet",             "listlockunspent",        &listlockunspent,        false },
     { "wallet",             "listreceivedbyaccount",  &listreceivedbyaccount,  false },
@@ -490,26 +644,98 @@ const CRPCCommand *CRPCTable::operator[](const std::string &name) const
     return (*it).second;
 }
 
+static boost::filesystem::path GetAsyncRPCOperationsFile()
+{
+    return GetDataDir() / "asyncops.json";
+}
+
+/** Write the calls of the async operations still waiting, so that they can be submitted again at the next start */
+static void WritePendingAsyncRPCOperations()
+{
+    std::vector<AsyncRPCRequest> vPending = getAsyncRPCQueue()->getPendingRequests();
+    if (vPending.empty())
+        return;
+
+    UniValue operations(UniValue::VARR);
+    for (const AsyncRPCRequest& pending : vPending) {
+        UniValue operation(UniValue::VOBJ);
+        operation.pushKV("method", pending.method);
+        operation.pushKV("params", pending.params);
+        operation.pushKV("uri", pending.uri);
+        operations.push_back(operation);
+    }
+
+    boost::filesystem::path filepath = GetAsyncRPCOperationsFile();
+    std::ofstream file(filepath.string().c_str());
+    if (!file.is_open()) {
+        LogPrintf("Unable to open %s for writing, %u async operations not started are lost\n", filepath.string(), vPending.size());
+        return;
+    }
+    file << operations.write(1);
+    LogPrintf("Saved %u async operations not started to %s\n", vPending.size(), filepath.string());
+}
+
+void ResubmitAsyncRPCOperations()
+{
+    boost::filesystem::path filepath = GetAsyncRPCOperationsFile();
+    std::ifstream file(filepath.string().c_str());
+    if (!file.is_open())
+        return;
+    std::string strOperations((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    UniValue operations;
+    if (!operations.read(strOperations) || !operations.isArray()) {
+        LogPrintf("%s: %s is not a json array, ignored\n", __func__, filepath.string());
+        return;
+    }
+
+    // They spend the funds of the wallet again, so only when asked
+    if (!GetBoolArg("-rpcasyncresubmit", DEFAULT_RPC_ASYNC_RESUBMIT)) {
+        LogPrintf("%u async operations had not started at shutdown, see %s or use -rpcasyncresubmit\n",
+                  operations.size(), filepath.string());
+        return;
+    }
+
+    for (const UniValue& operation : operations.getValues()) {
+        const UniValue& method = find_value(operation, "method");
+        const UniValue& params = find_value(operation, "params");
+        const UniValue& uri = find_value(operation, "uri");
+        if (!method.isStr() || !params.isArray())
+            continue;
+        try {
+            // for the same wallet, the files saved before the wallets had a URI were for the default one
+            CRPCRequestURIScope requestScope(uri.isStr() ? uri.get_str() : "/");
+            UniValue result = tableRPC.execute(method.get_str(), params);
+            LogPrintf("Resubmitted %s as %s\n", method.get_str(), result.write());
+        } catch (const UniValue& objError) {
+            LogPrintf("Resubmitting %s failed: %s\n", method.get_str(), find_value(objError, "message").write());
+        } catch (const std::exception& e) {
+            LogPrintf("Resubmitting %s failed: %s\n", method.get_str(), e.what());
+        }
+    }
+
+    boost::filesystem::remove(filepath);
+}
+
 bool StartRPC()
 {
     LogPrint("rpc", "Starting RPC\n");
     fRPCRunning = true;
     g_rpcSignals.Started();
 
-    // Launch one async rpc worker.  The ability to launch multiple workers is not recommended at present and thus the option is disabled.
-    getAsyncRPCQueue()->addWorker();
-/*
+    // Launch one async rpc worker, more being started while operations wait up to -rpcasyncthreads.
+    // Running operations in parallel is not recommended at present, hence the default of one.
     int n = GetArg("-rpcasyncthreads", 1);
-    if (n<1) {
+    if (n < 1) {
         LogPrintf("ERROR: Invalid value %d for -rpcasyncthreads.  Must be at least 1.\n", n);
-        strerr = strprintf(_("An error occurred while setting up the Async RPC threads, invalid parameter value of %d (must be at least 1)."), n);
-        uiInterface.ThreadSafeMessageBox(strerr, "", CClientUIInterface::MSG_ERROR);
-        StartShutdown();
-        return;
+        return false;
     }
-    for (int i = 0; i < n; i++)
-        getAsyncRPCQueue()->addWorker();
-*/
+    std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
+    q->setMaxWorkers(n);
+    q->setResultLimits(std::max<int64_t>(0, GetArg("-rpcasyncmaxresults", DEFAULT_RPC_ASYNC_MAX_RESULTS)),
+                       std::max<int64_t>(0, GetArg("-rpcasyncresultttl", DEFAULT_RPC_ASYNC_RESULT_TTL)));
+    q->addWorker();
     return true;
 }
 
@@ -526,7 +752,8 @@ void StopRPC()
     deadlineTimers.clear();
     g_rpcSignals.Stopped();
 
-    // Tells async queue to cancel all operations and shutdown.
+    // Save the operations not started yet, then tell async queue to cancel all operations and shutdown.
+    WritePendingAsyncRPCOperations();
     LogPrintf("%s: waiting for async rpc workers to stop\n", __func__);
     getAsyncRPCQueue()->closeAndWait();
 }
@@ -587,7 +814,25 @@ void JSONRequest::parse(const UniValue& valRequest)
         throw JSONRPCError(RPC_INVALID_REQUEST, "Params must be an array");
 }
 
-static UniValue JSONRPCExecOne(const UniValue& req)
+//! The URI of the request whose calls the thread runs
+static thread_local std::string strRPCRequestURI = "/";
+
+std::string GetRPCRequestURI()
+{
+    return strRPCRequestURI;
+}
+
+CRPCRequestURIScope::CRPCRequestURIScope(const std::string& strURI) : strPrevURI(strRPCRequestURI)
+{
+    strRPCRequestURI = strURI;
+}
+
+CRPCRequestURIScope::~CRPCRequestURIScope()
+{
+    strRPCRequestURI = strPrevURI;
+}
+
+UniValue JSONRPCExecOne(const UniValue& req)
 {
     UniValue rpc_result(UniValue::VOBJ);
 
@@ -649,6 +894,85 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
     g_rpcSignals.PostCommand(*pcmd);
 }
 
+bool CRPCTable::isReadOnly(const std::string &strMethod) const
+{
+    // the lookups of the explorers and the indexers, which can run in parallel within a batch
+    static const std::set<std::string> setReadOnly = {
+        "getinfo", "getscinfo", "getactivecertdatahash", "getceasingcumsccommtreehash", "getscgenesisinfo", "getscactivity",
+        "getnetworkinfo", "getconnectioncount", "getnettotals", "getpeerinfo",
+        "getblockchaininfo", "getbestblockhash", "getblockcount", "getblock", "getblockexpanded", "getblockdeltas",
+        "getblockhashes", "getspentinfo", "getblockhash", "getblockfinalityindex", "getblockheader", "getchaintips",
+        "getdifficulty", "getmempoolinfo", "getrawmempool", "gettxout", "gettxoutproof", "verifytxoutproof",
+        "gettxoutproofs", "verifytxoutproofs",
+        "getcertmaturityinfo", "getmininginfo", "getblocksubsidy", "getblockmerkleroots",
+        "decoderawtransaction", "decodescript", "getrawtransaction",
+        "getaddressmempool", "getaddressutxos", "getaddressdeltas", "getaddresstxids", "getaddressbalance",
+        "validateaddress", "verifymessage", "estimatefee", "estimatepriority", "z_validateaddress",
+    };
+    return setReadOnly.count(strMethod) != 0 && (*this)[strMethod] != NULL;
+}
+
+const char* RPCMethodClassName(RPCMethodClass methodClass)
+{
+    switch (methodClass) {
+    case RPCMethodClass::MINING: return "mining";
+    case RPCMethodClass::CHEAP:  return "cheap";
+    case RPCMethodClass::WALLET: return "wallet";
+    case RPCMethodClass::HEAVY:  return "heavy";
+    }
+    // not reached
+    return "";
+}
+
+RPCMethodClass CRPCTable::getMethodClass(const std::string &strMethod) const
+{
+    // the lookups of the explorers, that can take long on a large chain
+    static const std::set<std::string> setHeavy = {
+        "getblock", "getblockexpanded", "getblockdeltas", "getblockhashes", "getspentinfo", "getrawmempool",
+        "gettxoutsetinfo", "getchaintips", "getscinfo", "gettxoutproofs",
+    };
+    const CRPCCommand* pcmd = (*this)[strMethod];
+    if (!pcmd)
+        return RPCMethodClass::CHEAP;
+    if (pcmd->category == "mining")
+        return RPCMethodClass::MINING;
+    if (pcmd->category == "wallet")
+        return RPCMethodClass::WALLET;
+    if (pcmd->category == "addressindex" || setHeavy.count(strMethod))
+        return RPCMethodClass::HEAVY;
+    return RPCMethodClass::CHEAP;
+}
+
+void CRPCTable::execute(const std::string &strMethod, const UniValue &params, JSONWriter& writer) const
+{
+    const CRPCCommand *pcmd = tableRPC[strMethod];
+    if (!pcmd || !pcmd->streamActor) {
+        writer.Value(execute(strMethod, params));
+        return;
+    }
+
+    // Return immediately if in warmup
+    {
+        LOCK(cs_rpcWarmup);
+        if (fRPCInWarmup)
+            throw JSONRPCError(RPC_IN_WARMUP, rpcWarmupStatus);
+    }
+
+    g_rpcSignals.PreCommand(*pcmd);
+
+    try
+    {
+        // Execute
+        pcmd->streamActor(params, false, writer);
+    }
+    catch (const std::exception& e)
+    {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+
+    g_rpcSignals.PostCommand(*pcmd);
+}
+
 std::string HelpExampleCli(const std::string& methodname, const std::string& args)
 {
     return "> zen-cli " + methodname + " " + args + "\n";
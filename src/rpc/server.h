@@ -21,7 +21,10 @@
 
 class AsyncRPCQueue;
 class CRPCCommand;
+class JSONWriter;
 class uint256;
+struct CScActivityKey;
+struct CScActivityValue;
 
 namespace RPCServer
 {
@@ -33,6 +36,7 @@ namespace RPCServer
 
 class CBlockIndex;
 class CNetAddr;
+class CWallet;
 
 class JSONRequest
 {
@@ -45,12 +49,43 @@ public:
     void parse(const UniValue& valRequest);
 };
 
+//! The start of the URIs /wallet/<file> of the requests whose calls are for the wallet of <file>
+static const std::string WALLET_ENDPOINT_BASE = "/wallet/";
+
+/**
+ * The URI of the HTTP request whose calls the current thread runs, e.g. /wallet/<file> for the calls to
+ * the wallet of <file>: "/" for the calls not coming from one.
+ */
+std::string GetRPCRequestURI();
+
+/** Makes the calls run by the current thread be for the request sent to strURI, while the object exists */
+class CRPCRequestURIScope
+{
+private:
+    std::string strPrevURI;
+
+public:
+    explicit CRPCRequestURIScope(const std::string& strURI);
+    ~CRPCRequestURIScope();
+};
+
 /** Query whether RPC is running */
 bool IsRPCRunning();
 
 /** Get the async queue*/
 std::shared_ptr<AsyncRPCQueue> getAsyncRPCQueue();
 
+/** The finished async operations kept for z_getoperationstatus and z_getoperationresult, and for how long */
+static const size_t DEFAULT_RPC_ASYNC_MAX_RESULTS = 1000;
+static const int64_t DEFAULT_RPC_ASYNC_RESULT_TTL = 24 * 60 * 60;
+static const bool DEFAULT_RPC_ASYNC_RESUBMIT = false;
+
+/**
+ * Submit again the async operations which had not started when the node was last shut down, saved in
+ * asyncops.json, if -rpcasyncresubmit. To be called once the wallet is loaded and the warmup is over.
+ */
+void ResubmitAsyncRPCOperations();
+
 
 /**
  * Set the RPC warmup status.  When this is done, all RPC calls will error out
@@ -118,6 +153,24 @@ void RPCUnregisterTimerInterface(RPCTimerInterface *iface);
 void RPCRunLater(const std::string& name, boost::function<void(void)> func, int64_t nSeconds);
 
 typedef UniValue(*rpcfn_type)(const UniValue& params, bool fHelp);
+//! An actor writing its result as it is produced, for the commands with the largest results
+typedef void(*rpcstreamfn_type)(const UniValue& params, bool fHelp, JSONWriter& writer);
+
+/**
+ * The classes of the RPC methods, in the order of the priority of their calls waiting for a worker thread.
+ * The calls of a class are handled by at most -rpcclassthreads=<class>:<n> threads at once, so that a burst of
+ * slow lookups can not hold all the threads while getblocktemplate and submitblock wait.
+ */
+enum class RPCMethodClass : size_t
+{
+    MINING,
+    CHEAP,
+    WALLET,
+    HEAVY,
+};
+static const size_t RPC_METHOD_CLASS_COUNT = 4;
+
+const char* RPCMethodClassName(RPCMethodClass methodClass);
 
 class CRPCCommand
 {
@@ -126,6 +179,7 @@ public:
     std::string name;
     rpcfn_type actor;
     bool okSafeMode;
+    rpcstreamfn_type streamActor = NULL;
 };
 
 /**
@@ -148,6 +202,22 @@ public:
      * @throws an exception (UniValue) when an error happens.
      */
     UniValue execute(const std::string &method, const UniValue &params) const;
+
+    /**
+     * Execute a method, writing its result to writer: as it is produced by the commands with a streamActor,
+     * built whole by the others.
+     * @throws an exception (UniValue) when an error happens, possibly once a part of the result is written.
+     */
+    void execute(const std::string &method, const UniValue &params, JSONWriter& writer) const;
+
+    /**
+     * Whether a method only reads the state of the node, so that the calls of a batch to it can run at the
+     * same time; the others are run in the order of the batch, alone.
+     */
+    bool isReadOnly(const std::string &method) const;
+
+    /** The class of a method, CHEAP for the unknown ones */
+    RPCMethodClass getMethodClass(const std::string &method) const;
 };
 
 extern const CRPCTable tableRPC;
@@ -161,10 +231,13 @@ extern uint256 ParseHashO(const UniValue& o, std::string strKey);
 extern std::vector<unsigned char> ParseHexV(const UniValue& v, std::string strName);
 extern std::vector<unsigned char> ParseHexO(const UniValue& o, std::string strKey);
 
-extern int64_t nWalletUnlockTime;
 extern CAmount AmountFromValue(const UniValue& value);
 extern CAmount SignedAmountFromValue(const UniValue& value);
 extern UniValue ValueFromAmount(const CAmount& amount);
+/** The average, the median, the 90th and 99th percentiles (nearest rank) and the highest of the values */
+extern UniValue percentilesToJSON(std::vector<int64_t> values, const std::string& strSuffix);
+//! An entry of the sidechain activity index, as getscactivity returns it
+extern UniValue ScActivityEntryToJSON(const CScActivityKey& key, const CScActivityValue& value);
 extern double GetDifficulty(const CBlockIndex* blockindex = NULL);
 extern double GetNetworkDifficulty(const CBlockIndex* blockindex = NULL);
 extern int64_t blocksToOvertakeTarget(const CBlockIndex* forkTip, const CBlockIndex* targetBlock);
@@ -173,15 +246,22 @@ extern std::string HelpExampleCli(const std::string& methodname, const std::stri
 extern std::string HelpExampleRpc(const std::string& methodname, const std::string& args);
 
 extern void EnsureWalletIsUnlocked();
+/** The wallet the calls of the request are for, from its URI: pwalletMain if not for a wallet in particular (in rpcwallet.cpp) */
+extern CWallet* GetWalletForJSONRPCRequest();
 
 extern UniValue getconnectioncount(const UniValue& params, bool fHelp); // in rpcnet.cpp
 extern UniValue getaddressmempool(const UniValue& params, bool fHelp);
+extern UniValue waitforaddressmempool(const UniValue& params, bool fHelp);
 extern UniValue getaddressutxos(const UniValue& params, bool fHelp);
 extern UniValue getaddressdeltas(const UniValue& params, bool fHelp);
 extern UniValue getaddresstxids(const UniValue& params, bool fHelp);
 extern UniValue getaddressbalance(const UniValue& params, bool fHelp);
 
 extern UniValue getpeerinfo(const UniValue& params, bool fHelp);
+extern UniValue getwsinfo(const UniValue& params, bool fHelp);
+extern UniValue getwsserverinfo(const UniValue& params, bool fHelp);
+extern UniValue getrpcinfo(const UniValue& params, bool fHelp);
+extern UniValue getlockstats(const UniValue& params, bool fHelp);
 extern UniValue ping(const UniValue& params, bool fHelp);
 extern UniValue addnode(const UniValue& params, bool fHelp);
 extern UniValue disconnectnode(const UniValue& params, bool fHelp);
@@ -190,6 +270,7 @@ extern UniValue getnettotals(const UniValue& params, bool fHelp);
 extern UniValue setban(const UniValue& params, bool fHelp);
 extern UniValue listbanned(const UniValue& params, bool fHelp);
 extern UniValue clearbanned(const UniValue& params, bool fHelp);
+extern UniValue replaymessages(const UniValue& params, bool fHelp);
 
 extern UniValue dumpprivkey(const UniValue& params, bool fHelp); // in rpcdump.cpp
 extern UniValue importprivkey(const UniValue& params, bool fHelp);
@@ -206,9 +287,11 @@ extern UniValue getnetworkhashps(const UniValue& params, bool fHelp);
 extern UniValue getmininginfo(const UniValue& params, bool fHelp);
 extern UniValue prioritisetransaction(const UniValue& params, bool fHelp);
 extern UniValue getblocktemplate(const UniValue& params, bool fHelp);
+extern UniValue getblocktemplatepayouts(const UniValue& params, bool fHelp);
 extern UniValue submitblock(const UniValue& params, bool fHelp);
 extern UniValue estimatefee(const UniValue& params, bool fHelp);
 extern UniValue estimatepriority(const UniValue& params, bool fHelp);
+extern UniValue estimatescfee(const UniValue& params, bool fHelp);
 
 extern UniValue getnewaddress(const UniValue& params, bool fHelp); // in rpcwallet.cpp
 extern UniValue getaccountaddress(const UniValue& params, bool fHelp);
@@ -246,6 +329,7 @@ extern UniValue encryptwallet(const UniValue& params, bool fHelp);
 extern UniValue validateaddress(const UniValue& params, bool fHelp);
 extern UniValue getinfo(const UniValue& params, bool fHelp);
 extern UniValue getwalletinfo(const UniValue& params, bool fHelp);
+extern UniValue listwallets(const UniValue& params, bool fHelp);
 extern UniValue getblockchaininfo(const UniValue& params, bool fHelp);
 extern UniValue getnetworkinfo(const UniValue& params, bool fHelp);
 extern UniValue setmocktime(const UniValue& params, bool fHelp);
@@ -268,13 +352,18 @@ extern UniValue signrawtransaction(const UniValue& params, bool fHelp);
 extern UniValue sendrawtransaction(const UniValue& params, bool fHelp);
 extern UniValue gettxoutproof(const UniValue& params, bool fHelp);
 extern UniValue verifytxoutproof(const UniValue& params, bool fHelp);
+extern UniValue gettxoutproofs(const UniValue& params, bool fHelp);
+extern UniValue verifytxoutproofs(const UniValue& params, bool fHelp);
 
 extern UniValue getblockcount(const UniValue& params, bool fHelp); // in rpcblockchain.cpp
 extern UniValue getbestblockhash(const UniValue& params, bool fHelp);
 extern UniValue getdifficulty(const UniValue& params, bool fHelp);
 extern UniValue settxfee(const UniValue& params, bool fHelp);
 extern UniValue getmempoolinfo(const UniValue& params, bool fHelp);
+extern UniValue getsigcacheinfo(const UniValue& params, bool fHelp);
+extern UniValue getblockconnectstats(const UniValue& params, bool fHelp);
 extern UniValue getrawmempool(const UniValue& params, bool fHelp);
+extern UniValue savemempool(const UniValue& params, bool fHelp);
 
 extern UniValue getblockdeltas(const UniValue& params, bool fHelp);
 extern UniValue getblockhashes(const UniValue& params, bool fHelp);
@@ -282,9 +371,12 @@ extern UniValue getblockhashes(const UniValue& params, bool fHelp);
 extern UniValue getblockhash(const UniValue& params, bool fHelp);
 extern UniValue getblockheader(const UniValue& params, bool fHelp);
 extern UniValue getblock(const UniValue& params, bool fHelp);
+extern void getblock_stream(const UniValue& params, bool fHelp, JSONWriter& writer);
 extern UniValue getblockfinalityindex(const UniValue& params, bool fHelp);
 extern UniValue getglobaltips(const UniValue& params, bool fHelp);
 extern UniValue gettxoutsetinfo(const UniValue& params, bool fHelp);
+extern UniValue dumptxoutset(const UniValue& params, bool fHelp);
+extern UniValue loadtxoutset(const UniValue& params, bool fHelp);
 extern UniValue gettxout(const UniValue& params, bool fHelp);
 extern UniValue verifychain(const UniValue& params, bool fHelp);
 extern UniValue getchaintips(const UniValue& params, bool fHelp);
@@ -294,6 +386,7 @@ extern UniValue getcertmaturityinfo(const UniValue& params, bool fHelp);
 extern UniValue clearmempool(const UniValue& params, bool fHelp);
 extern UniValue getspentinfo(const UniValue& params, bool fHelp);
 extern UniValue getblockexpanded(const UniValue& params, bool fHelp);
+extern void getblockexpanded_stream(const UniValue& params, bool fHelp, JSONWriter& writer);
 
 extern UniValue getblocksubsidy(const UniValue& params, bool fHelp);
 extern UniValue getblockmerkleroots(const UniValue& params, bool fHelp);
@@ -320,6 +413,7 @@ extern UniValue getscinfo(const UniValue& params, bool fHelp);
 extern UniValue getactivecertdatahash(const UniValue& params, bool fHelp);
 extern UniValue getceasingcumsccommtreehash(const UniValue& params, bool fHelp);
 extern UniValue getscgenesisinfo(const UniValue& params, bool fHelp); 
+extern UniValue getscactivity(const UniValue& params, bool fHelp);
 extern UniValue checkcswnullifier(const UniValue& params, bool fHelp);
 extern UniValue z_shieldcoinbase(const UniValue& params, bool fHelp); // in rpcwallet.cpp
 extern UniValue z_getoperationstatus(const UniValue& params, bool fHelp); // in rpcwallet.cpp
@@ -340,6 +434,7 @@ extern UniValue setproofverifierlowpriorityguard(const UniValue& params, bool fH
 bool StartRPC();
 void InterruptRPC();
 void StopRPC();
+UniValue JSONRPCExecOne(const UniValue& req);
 std::string JSONRPCExecBatch(const UniValue& vReq);
 
 #endif // BITCOIN_RPCSERVER_H
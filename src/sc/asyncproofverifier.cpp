@@ -1,8 +1,13 @@
 #include "asyncproofverifier.h"
 
+#include <algorithm>
+#include <tuple>
+
 #include "coins.h"
 #include "init.h"
 #include "main.h"
+#include "metrics.h"
+#include "scheduler.h"
 #include "util.h"
 #include "primitives/certificate.h"
 
@@ -10,20 +15,464 @@ const uint32_t CScAsyncProofVerifier::BATCH_VERIFICATION_MAX_DELAY = 5000;   /**
 const uint32_t CScAsyncProofVerifier::BATCH_VERIFICATION_MAX_SIZE = 10;      /**< The threshold size of the proof queue that triggers a call to the batch verification. */
 
 
+static MetricValue metricQueuedProofs("zen_async_proof_queued", "Proofs waiting in the queue of the async proof verifier", MetricValue::Type::GAUGE);
+static MetricValue metricBatches("zen_async_proof_batches_total", "Batch verifications of the async proof verifier");
+static MetricValue metricBatchMicros("zen_async_proof_batch_microseconds_total", "Time spent in the batch verifications of the async proof verifier");
+static MetricValue metricFailedCsw("zen_async_proofs_total{type=\"csw\",result=\"failed\"}", "Proofs processed by the async proof verifier");
+static MetricValue metricPassedCsw("zen_async_proofs_total{type=\"csw\",result=\"passed\"}", "Proofs processed by the async proof verifier");
+static MetricValue metricFailedCert("zen_async_proofs_total{type=\"cert\",result=\"failed\"}", "Proofs processed by the async proof verifier");
+static MetricValue metricPassedCert("zen_async_proofs_total{type=\"cert\",result=\"passed\"}", "Proofs processed by the async proof verifier");
+
+const double CScAsyncProofVerifierBatchPolicy::DEFAULT_PROOF_COST = 50;
+const double CScAsyncProofVerifierBatchPolicy::SMOOTHING_FACTOR = 0.2;
+
+CScAsyncProofVerifierBatchPolicy::CScAsyncProofVerifierBatchPolicy(uint32_t targetLatency, uint32_t minDelay, uint32_t maxDelay, uint32_t defaultBatchSize) :
+    targetLatency(targetLatency), minDelay(std::min(minDelay, maxDelay)), maxDelay(maxDelay), defaultBatchSize(defaultBatchSize)
+{
+}
+
+/**
+ * @brief Registers the arrival of new proofs into the queue of the proof verifier.
+ * 
+ * @param provingSystem The proving system of the arrived proofs
+ * @param numberOfProofs The number of arrived proofs
+ */
+void CScAsyncProofVerifierBatchPolicy::RegisterArrivals(Sidechain::ProvingSystemType provingSystem, uint32_t numberOfProofs)
+{
+    windowArrivals[provingSystem] += numberOfProofs;
+}
+
+/**
+ * @brief Registers the time spent verifying a batch of proofs, so that the estimated
+ * cost of a single proof can be updated for each proving system involved.
+ * 
+ * Since the batch verifier doesn't provide the time spent for each proof, the elapsed time
+ * is split among the proving systems in proportion to their current cost estimates.
+ * 
+ * @param proofsPerSystem The number of verified proofs, per proving system
+ * @param elapsedMillis The time spent verifying the whole batch
+ */
+void CScAsyncProofVerifierBatchPolicy::RegisterBatch(const std::map<Sidechain::ProvingSystemType, uint32_t>& proofsPerSystem, double elapsedMillis)
+{
+    double expectedTime = 0;
+
+    for (const auto& entry : proofsPerSystem)
+    {
+        expectedTime += entry.second * GetProofCost(entry.first);
+    }
+
+    if (expectedTime <= 0)
+    {
+        return;
+    }
+
+    for (const auto& entry : proofsPerSystem)
+    {
+        if (entry.second == 0)
+        {
+            continue;
+        }
+
+        double currentCost = GetProofCost(entry.first);
+        double sampledCost = elapsedMillis * (entry.second * currentCost / expectedTime) / entry.second;
+
+        auto it = proofCost.find(entry.first);
+
+        if (it == proofCost.end())
+        {
+            proofCost[entry.first] = sampledCost;
+        }
+        else
+        {
+            it->second = SMOOTHING_FACTOR * sampledCost + (1 - SMOOTHING_FACTOR) * it->second;
+        }
+    }
+}
+
+/**
+ * @brief Updates the arrival rate estimates, closing the current sampling window if it is expired.
+ * 
+ * @param nowMillis The current time in milliseconds
+ */
+void CScAsyncProofVerifierBatchPolicy::Update(int64_t nowMillis)
+{
+    // The arrival rate is only needed for choosing the adaptive parameters.
+    if (!IsAdaptive())
+    {
+        windowArrivals.clear();
+        return;
+    }
+
+    if (windowStart < 0)
+    {
+        windowStart = nowMillis;
+        return;
+    }
+
+    int64_t windowLength = nowMillis - windowStart;
+
+    if (windowLength < ARRIVAL_RATE_WINDOW)
+    {
+        return;
+    }
+
+    // Proving systems that received no proof in the window decay towards zero.
+    for (auto& entry : arrivalRate)
+    {
+        windowArrivals.insert(std::make_pair(entry.first, 0));
+    }
+
+    for (const auto& entry : windowArrivals)
+    {
+        double sampledRate = static_cast<double>(entry.second) / windowLength;
+        auto it = arrivalRate.find(entry.first);
+
+        if (it == arrivalRate.end())
+        {
+            arrivalRate[entry.first] = sampledRate;
+        }
+        else
+        {
+            it->second = SMOOTHING_FACTOR * sampledRate + (1 - SMOOTHING_FACTOR) * it->second;
+        }
+    }
+
+    windowArrivals.clear();
+    windowStart = nowMillis;
+}
+
+/**
+ * @brief Gets the estimated verification cost of a single proof for the given proving system.
+ * 
+ * @param provingSystem The proving system
+ * @return double The estimated cost in milliseconds.
+ */
+double CScAsyncProofVerifierBatchPolicy::GetProofCost(Sidechain::ProvingSystemType provingSystem) const
+{
+    auto it = proofCost.find(provingSystem);
+    return it != proofCost.end() ? it->second : DEFAULT_PROOF_COST;
+}
+
+/**
+ * @brief Gets the parameters to be used for triggering the next batch verification.
+ * 
+ * Given the arrival rate L (proofs per ms) and the average cost C of a single proof (ms), waiting W milliseconds
+ * collects about L*W proofs that take C*L*W milliseconds to be verified; so the oldest proof is processed after
+ * W*(1 + C*L) milliseconds. The largest batch meeting the target latency T is then obtained with W = T / (1 + C*L).
+ * 
+ * @return AsyncProofVerifierBatchParameters The batch verification parameters.
+ */
+AsyncProofVerifierBatchParameters CScAsyncProofVerifierBatchPolicy::GetParameters() const
+{
+    AsyncProofVerifierBatchParameters params;
+    params.adaptive = IsAdaptive();
+    params.targetLatency = targetLatency;
+    params.batchSize = defaultBatchSize;
+    params.batchDelay = maxDelay;
+
+    double totalRate = 0;
+    double weightedCost = 0;
+
+    for (const auto& entry : arrivalRate)
+    {
+        totalRate += entry.second;
+        weightedCost += entry.second * GetProofCost(entry.first);
+    }
+
+    params.arrivalRate = totalRate * 1000;
+
+    for (const auto& entry : proofCost)
+    {
+        params.verificationCost[entry.first] = entry.second;
+    }
+
+    if (!IsAdaptive())
+    {
+        return params;
+    }
+
+    if (totalRate <= 0)
+    {
+        // Nothing is known about the incoming traffic yet, just honour the target latency.
+        params.batchDelay = std::max(minDelay, std::min(targetLatency, maxDelay));
+        return params;
+    }
+
+    double averageCost = weightedCost / totalRate;
+    double delay = targetLatency / (1 + averageCost * totalRate);
+
+    params.batchDelay = std::max(minDelay, std::min(static_cast<uint32_t>(delay), maxDelay));
+    params.batchSize = std::max(1u, static_cast<uint32_t>(totalRate * params.batchDelay));
+
+    return params;
+}
+
 #ifndef BITCOIN_TX
 void CScAsyncProofVerifier::LoadDataForCertVerification(const CCoinsViewCache& view, const CScCertificate& scCert, CNode* pfrom)
 {
     LOCK(cs_asyncQueue);
+
+    if (IsPenalizedNode(pfrom))
+    {
+        LogPrint("cert", "%s():%d - cert [%s] not queued, node [%d] sent invalid proofs\n",
+            __func__, __LINE__, scCert.GetHash().ToString(), pfrom->GetId());
+        return;
+    }
+
+    size_t previousQueueSize = proofQueue.size();
     CScProofVerifier::LoadDataForCertVerification(view, scCert, pfrom);
+
+    CFeeRate feeRate(scCert.GetFeeAmount(view.GetValueIn(scCert)), scCert.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION));
+    RegisterQueuedItem(scCert.GetHash(), previousQueueSize, feeRate);
 }
 
 void CScAsyncProofVerifier::LoadDataForCswVerification(const CCoinsViewCache& view, const CTransaction& scTx, CNode* pfrom)
 {
     LOCK(cs_asyncQueue);
+
+    if (IsPenalizedNode(pfrom))
+    {
+        LogPrint("cert", "%s():%d - tx [%s] not queued, node [%d] sent invalid proofs\n",
+            __func__, __LINE__, scTx.GetHash().ToString(), pfrom->GetId());
+        return;
+    }
+
+    size_t previousQueueSize = proofQueue.size();
     CScProofVerifier::LoadDataForCswVerification(view, scTx, pfrom);
+
+    CFeeRate feeRate(scTx.GetFeeAmount(view.GetValueIn(scTx)), scTx.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION));
+    RegisterQueuedItem(scTx.GetHash(), previousQueueSize, feeRate);
+}
+
+/**
+ * @brief Loads the proofs of the certificates included in a block that has been received
+ * but that is not going to be connected immediately (e.g. it has been downloaded out of order).
+ * 
+ * The proofs are verified speculatively, so that the verification performed when connecting
+ * the block is served by the proof verification cache. Certificates that can't be checked
+ * against the current view (e.g. referring to sidechains created by blocks not connected yet)
+ * are skipped, as well as those exceeding the limit of the speculative queue.
+ * 
+ * @param view The coins view cache of the current tip (it is needed to get Sidechain information)
+ * @param block The received block
+ */
+void CScAsyncProofVerifier::LoadBlockForSpeculativeVerification(const CCoinsViewCache& view, const CBlock& block)
+{
+    LOCK(cs_asyncQueue);
+
+    for (const CScCertificate& cert : block.vcert)
+    {
+        if (speculativeQueue.size() >= MAX_SPECULATIVE_PROOFS)
+        {
+            LogPrint("cert", "%s():%d - speculative queue full, skipping remaining certs of block [%s]\n",
+                __func__, __LINE__, block.GetHash().ToString());
+            return;
+        }
+
+        CSidechain sidechain;
+
+        if (!view.GetSidechain(cert.GetScId(), sidechain) || !Sidechain::checkCertCustomFields(sidechain, cert))
+        {
+            continue;
+        }
+
+        CProofVerifierItem item;
+        item.txHash = cert.GetHash();
+        item.parentPtr = std::make_shared<CScCertificate>(cert);
+        item.node = nullptr;
+        item.result = ProofVerificationResult::Unknown;
+        item.proofInput = CertificateToVerifierItem(cert, sidechain.GetFixedParams(), nullptr, &view);
+        speculativeQueue.insert(std::make_pair(cert.GetHash(), item));
+    }
 }
 #endif
 
+/**
+ * @brief Checks if a node has already sent proofs that failed the verification.
+ * Proofs sent by such nodes are not queued anymore, the node is going to be banned.
+ * The caller must hold cs_asyncQueue.
+ * 
+ * @param pfrom The node to be checked
+ * @return true If the node sent invalid proofs.
+ */
+bool CScAsyncProofVerifier::IsPenalizedNode(const CNode* pfrom)
+{
+    AssertLockHeld(cs_asyncQueue);
+    // Whitelisted nodes are never banned, so they can't be excluded.
+    return pfrom != nullptr && !pfrom->fWhitelisted && penalizedNodes.count(pfrom->GetId()) > 0;
+}
+
+/**
+ * @brief Counts the single proofs contained in a proof verifier item, grouping them by proving system.
+ * 
+ * @param item The proof verifier item
+ * @param proofsPerSystem The map where the number of proofs per proving system is accumulated
+ */
+void CScAsyncProofVerifier::CountProofs(const CProofVerifierItem& item, std::map<Sidechain::ProvingSystemType, uint32_t>& proofsPerSystem)
+{
+    if (item.proofInput.type() == typeid(CCertProofVerifierInput))
+    {
+        proofsPerSystem[boost::get<CCertProofVerifierInput>(item.proofInput).verificationKey.getProvingSystemType()]++;
+    }
+    else if (item.proofInput.type() == typeid(std::vector<CCswProofVerifierInput>))
+    {
+        for (const CCswProofVerifierInput& input : boost::get<std::vector<CCswProofVerifierInput>>(item.proofInput))
+        {
+            proofsPerSystem[input.verificationKey.getProvingSystemType()]++;
+        }
+    }
+}
+
+/**
+ * @brief Updates the queue accounting after an item has been loaded into the proof queue.
+ * The caller must hold cs_asyncQueue.
+ * 
+ * @param hash The hash of the certificate/transaction that has been loaded
+ * @param previousQueueSize The size of the queue before loading the item
+ * @param feeRate The fee rate of the certificate/transaction, used to prioritize its verification
+ */
+void CScAsyncProofVerifier::RegisterQueuedItem(const uint256& hash, size_t previousQueueSize, const CFeeRate& feeRate)
+{
+    AssertLockHeld(cs_asyncQueue);
+
+    // Items not inserted (verification disabled or hash already queued) don't alter the queue.
+    if (proofQueue.size() == previousQueueSize)
+    {
+        return;
+    }
+
+    std::map<Sidechain::ProvingSystemType, uint32_t> proofsPerSystem;
+    CountProofs(proofQueue.at(hash), proofsPerSystem);
+
+    for (const auto& entry : proofsPerSystem)
+    {
+        batchPolicy.RegisterArrivals(entry.first, entry.second);
+        queuedProofs += entry.second;
+    }
+    metricQueuedProofs.Set(queuedProofs);
+
+    queuedFeeRates[hash] = feeRate;
+}
+
+/**
+ * @brief Sorts a set of proof verifier items by decreasing verification priority.
+ * 
+ * Certificates having the highest quality among the ones of the same sidechain and epoch
+ * (i.e. the candidates for being included in the next block) come first, then all the other
+ * items are ordered by decreasing fee rate. Ties are broken by hash, so that the order is deterministic.
+ * 
+ * @param items The proof verifier items
+ * @param feeRates The fee rate of each item (missing items are considered as paying no fee)
+ * @return std::vector<uint256> The hashes of the items, from the highest to the lowest priority.
+ */
+std::vector<uint256> CScAsyncProofVerifier::SortByPriority(const std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& items,
+                                                           const std::map</* Cert or Tx hash */ uint256, CFeeRate>& feeRates)
+{
+    std::map<std::pair<uint256, int32_t> /* ScId, epoch */, int64_t> topQualities;
+
+    for (const auto& entry : items)
+    {
+        if (entry.second.proofInput.type() == typeid(CCertProofVerifierInput))
+        {
+            const CCertProofVerifierInput& input = boost::get<CCertProofVerifierInput>(entry.second.proofInput);
+            auto key = std::make_pair(input.scId, static_cast<int32_t>(input.epochNumber));
+            auto it = topQualities.find(key);
+
+            if (it == topQualities.end() || it->second < static_cast<int64_t>(input.quality))
+            {
+                topQualities[key] = input.quality;
+            }
+        }
+    }
+
+    // The sort key is (top quality candidate, fee per K, hash)
+    std::vector<std::tuple<bool, CAmount, uint256>> keys;
+    keys.reserve(items.size());
+
+    for (const auto& entry : items)
+    {
+        bool topQuality = false;
+
+        if (entry.second.proofInput.type() == typeid(CCertProofVerifierInput))
+        {
+            const CCertProofVerifierInput& input = boost::get<CCertProofVerifierInput>(entry.second.proofInput);
+            topQuality = topQualities.at(std::make_pair(input.scId, static_cast<int32_t>(input.epochNumber))) == static_cast<int64_t>(input.quality);
+        }
+
+        auto it = feeRates.find(entry.first);
+        CAmount feePerK = it != feeRates.end() ? it->second.GetFeePerK() : 0;
+
+        keys.push_back(std::make_tuple(topQuality, feePerK, entry.first));
+    }
+
+    std::sort(keys.begin(), keys.end(),
+              [](const std::tuple<bool, CAmount, uint256>& lhs, const std::tuple<bool, CAmount, uint256>& rhs)
+              {
+                  if (std::get<0>(lhs) != std::get<0>(rhs))
+                      return std::get<0>(lhs);
+                  if (std::get<1>(lhs) != std::get<1>(rhs))
+                      return std::get<1>(lhs) > std::get<1>(rhs);
+                  return std::get<2>(lhs) < std::get<2>(rhs);
+              });
+
+    std::vector<uint256> hashes;
+    hashes.reserve(keys.size());
+
+    for (const auto& key : keys)
+    {
+        hashes.push_back(std::get<2>(key));
+    }
+
+    return hashes;
+}
+
+/**
+ * @brief Removes from the queue the items with the highest priority, up to the given limit.
+ * The items left in the queue are going to be verified with the next batch.
+ * The caller must hold cs_asyncQueue.
+ * 
+ * @param maxItems The maximum number of items to be removed (0 means no limit)
+ * @return std::map<uint256, CProofVerifierItem> The removed items.
+ */
+std::map</* Cert or Tx hash */ uint256, CProofVerifierItem> CScAsyncProofVerifier::PopQueuedItems(size_t maxItems)
+{
+    AssertLockHeld(cs_asyncQueue);
+
+    std::map</* Cert or Tx hash */ uint256, CProofVerifierItem> items;
+
+    if (maxItems == 0 || proofQueue.size() <= maxItems)
+    {
+        items = std::move(proofQueue);
+        proofQueue.clear();
+        queuedFeeRates.clear();
+        queuedProofs = 0;
+        metricQueuedProofs.Set(0);
+        return items;
+    }
+
+    std::vector<uint256> sortedHashes = SortByPriority(proofQueue, queuedFeeRates);
+
+    for (size_t i = 0; i < maxItems; i++)
+    {
+        auto it = proofQueue.find(sortedHashes[i]);
+
+        std::map<Sidechain::ProvingSystemType, uint32_t> proofsPerSystem;
+        CountProofs(it->second, proofsPerSystem);
+
+        for (const auto& entry : proofsPerSystem)
+        {
+            queuedProofs -= entry.second;
+        }
+
+        items.insert(std::make_pair(it->first, std::move(it->second)));
+        proofQueue.erase(it);
+        queuedFeeRates.erase(sortedHashes[i]);
+    }
+    metricQueuedProofs.Set(queuedProofs);
+
+    return items;
+}
+
 uint32_t CScAsyncProofVerifier::GetCustomMaxBatchVerifyDelay()
 {
     int32_t delay = GetArg("-scproofverificationdelay", BATCH_VERIFICATION_MAX_DELAY);
@@ -48,82 +497,159 @@ uint32_t CScAsyncProofVerifier::GetCustomMaxBatchVerifyMaxSize()
     return static_cast<uint32_t>(size);
 }
 
+uint32_t CScAsyncProofVerifier::GetCustomTargetLatency()
+{
+    int32_t latency = GetArg("-scproofverificationtargetlatency", 0);
+    if (latency < 0)
+    {
+        LogPrintf("%s():%d - ERROR: scproofverificationtargetlatency=%d, must be non negative, disabling adaptive batching\n",
+            __func__, __LINE__, latency);
+        latency = 0;
+    }
+    return static_cast<uint32_t>(latency);
+}
+
 /**
- * @brief A function that periodically performs batch verification over the queued proofs.
- * It should run on a dedicated thread.
+ * @brief A function that periodically performs batch verification over the queued proofs, on the calling thread
+ * until the shutdown. The node schedules the rounds instead, see SchedulePeriodicVerification.
  */
 void CScAsyncProofVerifier::RunPeriodicVerification()
 {
-    /**
-     * The age of the queue in milliseconds.
-     * This value represents the time spent in the queue by the oldest proof in the queue.
-     */
-    uint32_t queueAge = 0;
+    while (!ShutdownRequested())
+    {
+        RunVerificationRound();
+        MilliSleep(THREAD_WAKE_UP_PERIOD);
+    }
+}
 
-    uint32_t batchVerificationMaxDelay = GetCustomMaxBatchVerifyDelay();
-    uint32_t batchVerificationMaxSize  = GetCustomMaxBatchVerifyMaxSize();
+/**
+ * @brief Schedules a verification round every THREAD_WAKE_UP_PERIOD milliseconds on a queue of its own,
+ * so that a long batch verification does not delay the other periodic tasks of the node.
+ */
+void CScAsyncProofVerifier::SchedulePeriodicVerification(CScheduler& scheduler)
+{
+    scheduler.scheduleEvery(boost::bind(&CScAsyncProofVerifier::RunVerificationRound, this),
+                            boost::chrono::milliseconds(THREAD_WAKE_UP_PERIOD), "scproofverifier");
+}
+
+/**
+ * @brief A round of the periodic verification: a batch verification over the queued proofs if they have waited
+ * long enough or are enough, a speculative one if there is none.
+ */
+void CScAsyncProofVerifier::RunVerificationRound()
+{
+    size_t currentQueueSize = proofQueue.size();
+    bool triggerBySize = false;
+    size_t maxBatchItems = batchVerificationMaxSize;
 
+    if (currentQueueSize > 0)
+    {
+        queueAge += THREAD_WAKE_UP_PERIOD;
+    }
 
-    while (!ShutdownRequested())
     {
-        size_t currentQueueSize = proofQueue.size();
+        LOCK(cs_asyncQueue);
+        batchPolicy.Update(GetTimeMillis());
 
-        if (currentQueueSize > 0)
+        if (currentQueueSize > 0 && batchPolicy.IsAdaptive())
         {
-            queueAge += THREAD_WAKE_UP_PERIOD;
-
-            /**
-             * The batch verification can be triggered by two events:
-             * 
-             * 1. The queue has grown up beyond the threshold size;
-             * 2. The oldest proof in the queue has waited for too long.
-             */
-            if (queueAge > batchVerificationMaxDelay || currentQueueSize > batchVerificationMaxSize)
-            {
-                queueAge = 0;
-                std::map</*scTxHash*/uint256, CProofVerifierItem> tempProofData;
+            AsyncProofVerifierBatchParameters params = batchPolicy.GetParameters();
+            batchVerificationMaxDelay = params.batchDelay;
+            triggerBySize = queuedProofs >= params.batchSize;
+            maxBatchItems = params.batchSize;
+        }
+        else
+        {
+            triggerBySize = currentQueueSize > batchVerificationMaxSize;
+        }
+    }
 
-                {
-                    LOCK(cs_asyncQueue);
+    if (currentQueueSize > 0)
+    {
+        /**
+         * The batch verification can be triggered by two events:
+         * 
+         * 1. The queue has grown up beyond the threshold size;
+         * 2. The oldest proof in the queue has waited for too long.
+         * 
+         * In adaptive mode both thresholds are chosen by the batch policy.
+         */
+        if (queueAge > batchVerificationMaxDelay || triggerBySize)
+        {
+            std::map</*scTxHash*/uint256, CProofVerifierItem> tempProofData;
 
-                    size_t proofQueueSize = proofQueue.size();
+            {
+                LOCK(cs_asyncQueue);
 
-                    LogPrint("cert", "%s():%d - Async verification triggered, %d proofs to be verified \n",
-                             __func__, __LINE__, proofQueueSize);
+                LogPrint("cert", "%s():%d - Async verification triggered, %d proofs to be verified \n",
+                         __func__, __LINE__, proofQueue.size());
 
-                    // Move the queued proofs into a local map, so that we can release the lock
-                    tempProofData = std::move(proofQueue);
+                // Move the queued proofs into a local map, so that we can release the lock.
+                // Under load only the highest priority proofs are taken, the other ones
+                // are left in the queue for the next round.
+                tempProofData = PopQueuedItems(maxBatchItems);
 
-                    assert(proofQueue.size() == 0);
-                    assert(tempProofData.size() == proofQueueSize);
+                if (proofQueue.empty())
+                {
+                    queueAge = 0;
                 }
+                else
+                {
+                    // Make the deferred proofs trigger the batch verification at the next wake up.
+                    LogPrint("cert", "%s():%d - %d proofs deferred to the next batch\n", __func__, __LINE__, proofQueue.size());
+                    queueAge = batchVerificationMaxDelay;
+                }
+            }
 
-                bool batchResult = BatchVerifyInternal(tempProofData);
-                ProcessVerificationOutputs(tempProofData);
+            VerifyBatch(tempProofData);
+        }
+    }
+    else
+    {
+        RunSpeculativeVerification();
+    }
+}
 
-                if (tempProofData.size() > 0)
-                {
-                    LogPrint("cert", "%s():%d - Batch verification failed, removed proofs that caused the failure and trying again... \n", __func__, __LINE__);
+/**
+ * @brief Verifies a batch of proofs popped from the queue, isolating the failing ones if the batch fails.
+ * When this function returns all the proofs have been processed and removed from the map.
+ * 
+ * @param proofs The proofs to be verified
+ */
+void CScAsyncProofVerifier::VerifyBatch(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs)
+{
+    std::map<Sidechain::ProvingSystemType, uint32_t> proofsPerSystem;
+    for (const auto& entry : proofs)
+    {
+        CountProofs(entry.second, proofsPerSystem);
+    }
 
-                    batchResult = BatchVerifyInternal(tempProofData);
-                    ProcessVerificationOutputs(tempProofData);
+    int64_t nBatchStart = GetTimeMicros();
+    ParallelBatchVerify(proofs);
+    int64_t nBatchTime = GetTimeMicros() - nBatchStart;
+    metricBatches.Add();
+    metricBatchMicros.Add(nBatchTime);
 
-                    if (tempProofData.size() > 0)
-                    {
-                        LogPrint("cert", "%s():%d - Batch verification failed again, verifying proofs one by one... \n", __func__, __LINE__);
+    {
+        LOCK(cs_asyncQueue);
+        batchPolicy.RegisterBatch(proofsPerSystem, nBatchTime * 0.001);
+    }
 
-                        // As last attempt, verify the proofs one by one.
-                        NormalVerify(tempProofData);
-                        ProcessVerificationOutputs(tempProofData);
-                    }
-                }
+    bool failuresIsolated = AnyFailed(proofs);
+    ProcessVerificationOutputs(proofs);
 
-                assert(tempProofData.size() == 0);
-            }
-        }
+    if (proofs.size() > 0)
+    {
+        LogPrint("cert", "%s():%d - Batch verification failed, isolating the proofs that caused the failure... \n", __func__, __LINE__);
 
-        MilliSleep(THREAD_WAKE_UP_PERIOD);
+        // Failing proofs are rejected (and their senders penalized) as soon as they are isolated.
+        // When the batch did not tell which proofs failed, the remaining ones are known to fail together
+        // and they are split straight away instead of being verified again as a whole.
+        BisectVerify(proofs, [this](std::map</* Tx hash */ uint256, CProofVerifierItem>& unprocessed) { ProcessVerificationOutputs(unprocessed); },
+                     !failuresIsolated);
     }
+
+    assert(proofs.size() == 0);
 }
 
 /**
@@ -162,6 +688,11 @@ void CScAsyncProofVerifier::ProcessVerificationOutputs(std::map</* Tx hash */ ui
             LogPrint("cert", "%s():%d - Post processing certificate or transaction [%s] from node [%d], result [%s] \n",
                     __func__, __LINE__, item.parentPtr->GetHash().ToString(), item.node->GetId(), ProofVerificationResultToString(item.result));
 
+            if (item.parentPtr->IsCertificate())
+                (item.result == ProofVerificationResult::Passed ? metricPassedCert : metricFailedCert).Add();
+            else
+                (item.result == ProofVerificationResult::Passed ? metricPassedCsw : metricFailedCsw).Add();
+
             // CODE USED FOR UNIT TEST ONLY [Start]
             if (BOOST_UNLIKELY(Params().NetworkIDString() == "regtest"))
             {
@@ -169,6 +700,12 @@ void CScAsyncProofVerifier::ProcessVerificationOutputs(std::map</* Tx hash */ ui
             }
             // CODE USED FOR UNIT TEST ONLY [End]
 
+            if (item.result == ProofVerificationResult::Failed && item.node != nullptr)
+            {
+                LOCK(cs_asyncQueue);
+                penalizedNodes.insert(std::make_pair(item.node->GetId(), GetTimeMillis()));
+            }
+
             CValidationState dummyState;
             mempoolCallback(*item.parentPtr.get(), item.node,
                                             item.result == ProofVerificationResult::Passed ? BatchVerificationStateFlag::VERIFIED : BatchVerificationStateFlag::FAILED,
@@ -212,3 +749,33 @@ void CScAsyncProofVerifier::UpdateStatistics(const CProofVerifierItem& item)
         }
     }
 }
+
+/**
+ * @brief Verifies the proofs waiting in the speculative queue, so that the related
+ * results are stored into the proof verification cache.
+ * 
+ * The results are not reported to anybody: proofs failing here are going to be rejected
+ * again (and their senders punished) when the block is connected.
+ */
+void CScAsyncProofVerifier::RunSpeculativeVerification()
+{
+    std::map</* Cert hash */ uint256, CProofVerifierItem> proofs;
+
+    {
+        LOCK(cs_asyncQueue);
+        proofs = std::move(speculativeQueue);
+        speculativeQueue.clear();
+    }
+
+    if (proofs.empty())
+    {
+        return;
+    }
+
+    LogPrint("cert", "%s():%d - speculative verification of %d proofs\n", __func__, __LINE__, proofs.size());
+
+    if (!ParallelBatchVerify(proofs))
+    {
+        LogPrint("cert", "%s():%d - speculative verification failed\n", __func__, __LINE__);
+    }
+}
@@ -2,17 +2,20 @@
 #define _SC_ASYNC_PROOF_VERIFIER_H
 
 #include <map>
+#include <vector>
 
 #include <boost/variant.hpp>
 
 #include "amount.h"
 #include "chainparams.h"
+#include "limitedmap.h"
 #include "main.h"
 #include "primitives/certificate.h"
 #include "primitives/transaction.h"
 #include "sc/proofverifier.h"
 #include "sc/sidechaintypes.h"
 
+class CScheduler;
 class CSidechain;
 class CScCertificate;
 class uint256;
@@ -30,6 +33,62 @@ struct AsyncProofVerifierStatistics
     uint32_t failedCswCounter = 0;  /**< The number of CSW input proofs whose verification failed. */
 };
 
+/**
+ * @brief A structure that stores the parameters currently used to trigger a batch verification.
+ * 
+ */
+struct AsyncProofVerifierBatchParameters
+{
+    bool adaptive = false;              /**< True if the parameters are chosen by the adaptive batching policy. */
+    uint32_t targetLatency = 0;         /**< The target latency in milliseconds (adaptive mode only). */
+    uint32_t batchSize = 0;             /**< The threshold number of queued proofs that triggers a batch verification. */
+    uint32_t batchDelay = 0;            /**< The maximum age in milliseconds of the queue before triggering a batch verification. */
+    double arrivalRate = 0;             /**< The estimated proof arrival rate (proofs per second). */
+    std::map<Sidechain::ProvingSystemType, double> verificationCost;   /**< The estimated verification time of a single proof (milliseconds), per proving system. */
+};
+
+/**
+ * @brief The policy used by the async proof verifier to choose the batch size and the flush deadline.
+ * 
+ * The policy estimates the proof arrival rate and the verification cost of a single proof for each proving
+ * system and chooses the largest batch that keeps the time spent by the oldest proof in the queue, plus
+ * the time needed to verify the whole batch, below the target latency.
+ * 
+ * All the timestamps are expressed in milliseconds and are passed by the caller, so that the policy
+ * doesn't depend on the system clock.
+ */
+class CScAsyncProofVerifierBatchPolicy
+{
+public:
+
+    static const uint32_t ARRIVAL_RATE_WINDOW = 1000;     /**< The length in milliseconds of the window used to sample the arrival rate. */
+    static const double DEFAULT_PROOF_COST;               /**< The verification cost in milliseconds assumed for proving systems not yet sampled. */
+    static const double SMOOTHING_FACTOR;                 /**< The weight given to new samples by the exponential moving averages. */
+
+    CScAsyncProofVerifierBatchPolicy(uint32_t targetLatency, uint32_t minDelay, uint32_t maxDelay, uint32_t defaultBatchSize);
+
+    void RegisterArrivals(Sidechain::ProvingSystemType provingSystem, uint32_t numberOfProofs);
+    void RegisterBatch(const std::map<Sidechain::ProvingSystemType, uint32_t>& proofsPerSystem, double elapsedMillis);
+    void Update(int64_t nowMillis);
+
+    bool IsAdaptive() const { return targetLatency > 0; }
+    AsyncProofVerifierBatchParameters GetParameters() const;
+
+private:
+
+    const uint32_t targetLatency;       /**< The target latency in milliseconds, 0 disables the adaptive behavior. */
+    const uint32_t minDelay;            /**< The lower bound of the flush deadline in milliseconds. */
+    const uint32_t maxDelay;            /**< The upper bound of the flush deadline in milliseconds. */
+    const uint32_t defaultBatchSize;    /**< The batch size used until the arrival rate is known (and in non adaptive mode). */
+
+    int64_t windowStart = -1;                                               /**< The beginning of the current arrival rate sampling window. */
+    std::map<Sidechain::ProvingSystemType, uint32_t> windowArrivals;        /**< The proofs arrived in the current sampling window, per proving system. */
+    std::map<Sidechain::ProvingSystemType, double> arrivalRate;             /**< The estimated arrival rate (proofs per millisecond), per proving system. */
+    std::map<Sidechain::ProvingSystemType, double> proofCost;               /**< The estimated verification time (milliseconds) of a single proof, per proving system. */
+
+    double GetProofCost(Sidechain::ProvingSystemType provingSystem) const;
+};
+
 /**
  * @brief An asynchronous version of the sidechain Proof Verifier.
  * 
@@ -50,19 +109,28 @@ public:
 
     void LoadDataForCertVerification(const CCoinsViewCache& view, const CScCertificate& scCert, CNode* pfrom = nullptr) override;
     void LoadDataForCswVerification(const CCoinsViewCache& view, const CTransaction& scTx, CNode* pfrom = nullptr) override;
+    void LoadBlockForSpeculativeVerification(const CCoinsViewCache& view, const CBlock& block);
     void RunPeriodicVerification();
+    void SchedulePeriodicVerification(CScheduler& scheduler);
 
     static const uint32_t BATCH_VERIFICATION_MAX_DELAY;   /**< The maximum delay in milliseconds between batch verification requests */
     static const uint32_t BATCH_VERIFICATION_MAX_SIZE;      /**< The threshold size of the proof queue that triggers a call to the batch verification. */
 
     static uint32_t GetCustomMaxBatchVerifyDelay();
     static uint32_t GetCustomMaxBatchVerifyMaxSize();
+    static uint32_t GetCustomTargetLatency();
+
+    static void CountProofs(const CProofVerifierItem& item, std::map<Sidechain::ProvingSystemType, uint32_t>& proofsPerSystem);
+    static std::vector<uint256> SortByPriority(const std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& items,
+                                               const std::map</* Cert or Tx hash */ uint256, CFeeRate>& feeRates);
 
 private:
 
     friend class TEST_FRIEND_CScAsyncProofVerifier;         /**< A friend class used as a proxy for private members in unit tests (Regtest mode only). */
 
     static const uint32_t THREAD_WAKE_UP_PERIOD = 100;           /**< The period of time in milliseconds after which the thread wakes up. */
+    static const uint32_t MAX_PENALIZED_NODES = 1000;            /**< The maximum number of nodes remembered for having sent invalid proofs. */
+    static const uint32_t MAX_SPECULATIVE_PROOFS = 1000;         /**< The maximum number of proofs waiting for speculative verification. */
 
     CCriticalSection cs_asyncQueue;         /**< The lock to be used for entering the critical section in async mode only. */
 
@@ -70,6 +138,23 @@ private:
     AsyncProofVerifierStatistics stats;     /**< Async proof verifier statistics. */
     // Members used for REGTEST mode only. [End]
 
+    CScAsyncProofVerifierBatchPolicy batchPolicy;   /**< The policy choosing when to trigger a batch verification (guarded by cs_asyncQueue). */
+
+    // Members used by the verification rounds only, which never run concurrently. [Start]
+    uint32_t queueAge = 0;                      /**< The time in milliseconds spent in the queue by the oldest proof in the queue. */
+    uint32_t batchVerificationMaxDelay;         /**< The delay triggering the batch verification, chosen by the batch policy in adaptive mode. */
+    uint32_t batchVerificationMaxSize;          /**< The queue size triggering the batch verification in non adaptive mode. */
+    // Members used by the verification rounds only. [End]
+    uint32_t queuedProofs = 0;                      /**< The number of single proofs currently in the queue (guarded by cs_asyncQueue). */
+    std::map</* Cert or Tx hash */ uint256, CFeeRate> queuedFeeRates;   /**< The fee rate of each queued certificate/transaction (guarded by cs_asyncQueue). */
+    LimitedMap<NodeId, int64_t> penalizedNodes;     /**< The nodes that sent proofs failing the verification, with the time of the failure (guarded by cs_asyncQueue). */
+
+    /**
+     * The proofs of certificates included in blocks received but not connected yet (guarded by cs_asyncQueue).
+     * They are verified when no mempool proof is waiting, only to fill the proof verification cache.
+     */
+    std::map</* Cert hash */ uint256, CProofVerifierItem> speculativeQueue;
+
     /**
      * @brief The function to be called to make the mempool process a certificate/transaction after the verification of the proof.
      */
@@ -77,12 +162,22 @@ private:
 
     CScAsyncProofVerifier() :
         CScProofVerifier(Verification::Strict, Priority::Low), // CScAsyncProofVerifier always executes verification with low priority
+        batchPolicy(GetCustomTargetLatency(), THREAD_WAKE_UP_PERIOD, GetCustomMaxBatchVerifyDelay(), GetCustomMaxBatchVerifyMaxSize()),
+        batchVerificationMaxDelay(GetCustomMaxBatchVerifyDelay()),
+        batchVerificationMaxSize(GetCustomMaxBatchVerifyMaxSize()),
+        penalizedNodes(MAX_PENALIZED_NODES),
         mempoolCallback(ProcessTxBaseAcceptToMemoryPool)
     {
     }
 
+    bool IsPenalizedNode(const CNode* pfrom);
+    void RegisterQueuedItem(const uint256& hash, size_t previousQueueSize, const CFeeRate& feeRate);
+    std::map</* Cert or Tx hash */ uint256, CProofVerifierItem> PopQueuedItems(size_t maxItems);
     void ProcessVerificationOutputs(std::map</* Tx hash */ uint256, CProofVerifierItem>& proofs);
     void UpdateStatistics(const CProofVerifierItem& item);
+    void RunSpeculativeVerification();
+    void RunVerificationRound();
+    void VerifyBatch(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs);
 };
 
 /**
@@ -168,6 +263,28 @@ public:
         return counter;
     }
 
+    /**
+     * @brief Gets the parameters currently used to trigger the async batch verification.
+     * 
+     * @return The batch verification parameters.
+     */
+    AsyncProofVerifierBatchParameters GetBatchParameters()
+    {
+        LOCK(CScAsyncProofVerifier::GetInstance().cs_asyncQueue);
+        return CScAsyncProofVerifier::GetInstance().batchPolicy.GetParameters();
+    }
+
+    /**
+     * @brief Gets the current number of certificate proofs waiting for speculative verification.
+     * 
+     * @return size_t The number of pending speculative proofs.
+     */
+    size_t PendingSpeculativeProofs()
+    {
+        LOCK(CScAsyncProofVerifier::GetInstance().cs_asyncQueue);
+        return CScAsyncProofVerifier::GetInstance().speculativeQueue.size();
+    }
+
     /**
      * @brief Get the max delay between async batch verifications.
      * 
@@ -186,13 +303,73 @@ public:
         CScAsyncProofVerifier& verifier = CScAsyncProofVerifier::GetInstance();
 
         verifier.stats = AsyncProofVerifierStatistics();
+
+        LOCK(verifier.cs_asyncQueue);
+        verifier.penalizedNodes.clear();
     }
 
     /**
-     * @brief Gets the async proof verifier statistics.
-     *
-     * @return The proof verifier statistics.
+     * @brief An async proof verifier whose batch and one by one verifications of the proofs are replaced
+     * by the given functions, to run the verification rounds without the cryptographic library.
      */
+    class CScAsyncProofVerifierWithOverrides : public CScAsyncProofVerifier
+    {
+    public:
+        typedef std::function<bool(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>&)> BatchVerifyFunction;
+        typedef std::function<void(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>&)> NormalVerifyFunction;
+
+        CScAsyncProofVerifierWithOverrides(const BatchVerifyFunction& batchVerify, const NormalVerifyFunction& normalVerify) :
+            batchVerifyOverride(batchVerify), normalVerifyOverride(normalVerify)
+        {
+            // Disables the call to AcceptToMemory pool, as for the singleton.
+            mempoolCallback = [](const CTransactionBase&, CNode*, BatchVerificationStateFlag, CValidationState&){};
+        }
+
+        /**
+         * @brief Runs the verification of a batch of proofs as a verification round does.
+         *
+         * @param proofs The proofs to be verified
+         */
+        void VerifyBatch(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs)
+        {
+            CScAsyncProofVerifier::VerifyBatch(proofs);
+        }
+
+        /**
+         * @brief Gets the statistics of this verifier.
+         *
+         * @return The proof verifier statistics.
+         */
+        AsyncProofVerifierStatistics GetStatistics() const
+        {
+            return stats;
+        }
+
+        /**
+         * @brief Tells whether a node has been penalized for having sent proofs failing the verification.
+         */
+        bool IsPenalizedNode(NodeId id)
+        {
+            LOCK(cs_asyncQueue);
+            return penalizedNodes.count(id) > 0;
+        }
+
+    protected:
+        bool BatchVerifyInternal(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs) override
+        {
+            return proofs.empty() || batchVerifyOverride(proofs);
+        }
+
+        void NormalVerify(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs) override
+        {
+            normalVerifyOverride(proofs);
+        }
+
+    private:
+        const BatchVerifyFunction batchVerifyOverride;
+        const NormalVerifyFunction normalVerifyOverride;
+    };
+
     void setProofVerifierLowPriorityGuard(bool isEnabled)
     {
         if(lowPrioThreadGuard != NULL)
@@ -0,0 +1,137 @@
+#include "sc/cswnullifierfilter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "hash.h"
+#include "memusage.h"
+#include "random.h"
+
+CCswNullifierFilter::Layer::Layer(uint32_t capacity, double fpRate): nCapacity(capacity), nInserted(0)
+{
+    // Optimal number of hash functions and of bits per element for the requested rate
+    nHashFuncs = std::max(1, static_cast<int>(std::round(-std::log2(fpRate))));
+    size_t nBits = static_cast<size_t>(std::ceil(capacity * nHashFuncs / M_LN2));
+    bits.assign((nBits + 63) / 64, 0);
+}
+
+double CCswNullifierFilter::Layer::FalsePositiveRate() const
+{
+    const double nBits = bits.size() * 64;
+    return std::pow(1.0 - std::exp(-static_cast<double>(nHashFuncs) * nInserted / nBits), nHashFuncs);
+}
+
+CCswNullifierFilter::CCswNullifierFilter(): nTweak(GetRand(std::numeric_limits<uint32_t>::max())) {}
+
+void CCswNullifierFilter::Hash(const CFieldElement& nullifier, uint64_t& h1, uint64_t& h2) const
+{
+    const std::vector<unsigned char>& bytes = nullifier.GetByteArray();
+    h1 = MurmurHash3(nTweak, bytes);
+    h2 = MurmurHash3(nTweak ^ 0x9E3779B9, bytes);
+}
+
+bool CCswNullifierFilter::LayerContains(const Layer& layer, uint64_t h1, uint64_t h2)
+{
+    const uint64_t nBits = layer.bits.size() * 64;
+    for (uint32_t i = 0; i < layer.nHashFuncs; ++i)
+    {
+        uint64_t pos = (h1 + i * h2) % nBits;
+        if (!(layer.bits[pos >> 6] & (uint64_t(1) << (pos & 63))))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Adds a nullifier to the filter of its sidechain, appending a new layer when the last one is full.
+ */
+void CCswNullifierFilter::Insert(const uint256& scId, const CFieldElement& nullifier)
+{
+    uint64_t h1, h2;
+    Hash(nullifier, h1, h2);
+
+    boost::unique_lock<boost::mutex> lock(cs_filter);
+    std::vector<Layer>& layers = filters[scId].layers;
+    if (layers.empty() || layers.back().nInserted >= layers.back().nCapacity)
+    {
+        // Each layer doubles the capacity and halves the false positive rate of the previous one
+        uint32_t capacity = layers.empty() ? INITIAL_CAPACITY : layers.back().nCapacity * 2;
+        layers.emplace_back(capacity, INITIAL_FP_RATE / std::pow(2.0, layers.size()));
+    }
+
+    Layer& layer = layers.back();
+    const uint64_t nBits = layer.bits.size() * 64;
+    for (uint32_t i = 0; i < layer.nHashFuncs; ++i)
+    {
+        uint64_t pos = (h1 + i * h2) % nBits;
+        layer.bits[pos >> 6] |= uint64_t(1) << (pos & 63);
+    }
+    ++layer.nInserted;
+}
+
+/**
+ * @brief Records the removal of a nullifier. Its bits cannot be cleared, so the nullifier keeps
+ * being reported as possibly contained.
+ */
+void CCswNullifierFilter::Remove(const uint256& scId, const CFieldElement& nullifier)
+{
+    boost::unique_lock<boost::mutex> lock(cs_filter);
+    std::map<uint256, SidechainFilter>::iterator it = filters.find(scId);
+    if (it != filters.end())
+        ++it->second.nRemoved;
+}
+
+/**
+ * @brief Checks whether a nullifier may have been inserted into the filter of its sidechain.
+ *
+ * @return false if the nullifier was surely never inserted, true otherwise.
+ */
+bool CCswNullifierFilter::MaybeContains(const uint256& scId, const CFieldElement& nullifier) const
+{
+    uint64_t h1, h2;
+    Hash(nullifier, h1, h2);
+
+    boost::unique_lock<boost::mutex> lock(cs_filter);
+    std::map<uint256, SidechainFilter>::const_iterator it = filters.find(scId);
+    if (it == filters.end())
+        return false;
+
+    for (const Layer& layer : it->second.layers)
+    {
+        if (LayerContains(layer, h1, h2))
+            return true;
+    }
+    return false;
+}
+
+void CCswNullifierFilter::Clear()
+{
+    boost::unique_lock<boost::mutex> lock(cs_filter);
+    filters.clear();
+}
+
+CswNullifierFilterStatistics CCswNullifierFilter::GetStatistics() const
+{
+    CswNullifierFilterStatistics stats;
+
+    boost::unique_lock<boost::mutex> lock(cs_filter);
+    stats.memoryUsage = memusage::DynamicUsage(filters);
+    for (const auto& entry : filters)
+    {
+        stats.removed += entry.second.nRemoved;
+        stats.memoryUsage += memusage::DynamicUsage(entry.second.layers);
+
+        // A lookup is a false positive if any of the layers reports one
+        double trueNegativeRate = 1.0;
+        for (const Layer& layer : entry.second.layers)
+        {
+            stats.elements += layer.nInserted;
+            stats.memoryUsage += memusage::DynamicUsage(layer.bits);
+            trueNegativeRate *= 1.0 - layer.FalsePositiveRate();
+        }
+        stats.fpRate = std::max(stats.fpRate, 1.0 - trueNegativeRate);
+    }
+
+    return stats;
+}
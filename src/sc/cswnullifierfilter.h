@@ -0,0 +1,80 @@
+#ifndef _SC_CSW_NULLIFIER_FILTER_H
+#define _SC_CSW_NULLIFIER_FILTER_H
+
+#include <map>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include "sc/sidechaintypes.h"
+#include "uint256.h"
+
+/**
+ * @brief A structure that stores statistics about the CSW nullifiers filter.
+ */
+struct CswNullifierFilterStatistics
+{
+    uint64_t elements = 0;      /**< The number of nullifiers inserted into the filter. */
+    uint64_t removed = 0;       /**< The number of nullifiers removed since the filter was built (their bits are kept). */
+    uint64_t memoryUsage = 0;   /**< The heap memory held by the filter, in bytes. */
+    double fpRate = 0.0;        /**< The estimated false positive rate of the most loaded sidechain filter. */
+};
+
+/**
+ * @brief In-memory bloom filter of the CSW nullifiers stored in the chainstate, one per sidechain.
+ *
+ * Almost all the CSW nullifiers looked up when accepting transactions or connecting blocks are
+ * fresh, so a negative answer of the filter spares the database access. The filter of a sidechain
+ * grows by appending layers of doubling capacity and halving false positive rate, so the overall
+ * rate stays bounded without having to rebuild it from the database.
+ *
+ * Bloom filters cannot forget elements: removed nullifiers (only disconnected blocks remove them)
+ * keep their bits, which just adds false positives, until the filter is rebuilt at the next start.
+ */
+class CCswNullifierFilter
+{
+public:
+
+    static constexpr uint32_t INITIAL_CAPACITY = 1024;   /**< The number of nullifiers fitting the first layer of a sidechain filter. */
+    static constexpr double INITIAL_FP_RATE = 0.001;     /**< The false positive rate of the first layer of a sidechain filter. */
+
+    CCswNullifierFilter();
+
+    CCswNullifierFilter(const CCswNullifierFilter&) = delete;
+    CCswNullifierFilter& operator=(const CCswNullifierFilter&) = delete;
+
+    void Insert(const uint256& scId, const CFieldElement& nullifier);
+    void Remove(const uint256& scId, const CFieldElement& nullifier);
+    bool MaybeContains(const uint256& scId, const CFieldElement& nullifier) const;
+    void Clear();
+
+    CswNullifierFilterStatistics GetStatistics() const;
+
+private:
+
+    struct Layer
+    {
+        std::vector<uint64_t> bits;
+        uint32_t nHashFuncs;
+        uint32_t nCapacity;
+        uint32_t nInserted;
+
+        Layer(uint32_t capacity, double fpRate);
+        double FalsePositiveRate() const;
+    };
+
+    struct SidechainFilter
+    {
+        std::vector<Layer> layers;
+        uint64_t nRemoved = 0;
+    };
+
+    static bool LayerContains(const Layer& layer, uint64_t h1, uint64_t h2);
+    void Hash(const CFieldElement& nullifier, uint64_t& h1, uint64_t& h2) const;
+
+    uint32_t nTweak;
+    std::map<uint256, SidechainFilter> filters;
+    mutable boost::mutex cs_filter;     /**< The lock guarding filters. */
+};
+
+#endif // _SC_CSW_NULLIFIER_FILTER_H
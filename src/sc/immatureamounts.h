@@ -0,0 +1,147 @@
+#ifndef _SC_IMMATURE_AMOUNTS_H
+#define _SC_IMMATURE_AMOUNTS_H
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "amount.h"
+#include "memusage.h"
+#include "serialize.h"
+
+namespace Sidechain
+{
+
+/**
+ * The amounts of a sidechain which are not mature yet, by maturity height: a map kept as a vector
+ * sorted by height, in a single allocation.
+ *
+ * Amounts are added at the current height plus the maturity, which is the highest height in the map,
+ * and they mature at the current height, which is the lowest one. Both ends are found without a search,
+ * so that a block only touches the amounts maturing at its height and the ones it adds. The map holds at
+ * most one entry per block of the maturity window, hence moving the entries when the first one is erased
+ * is cheap.
+ *
+ * It is serialized as a std::map<int, CAmount>.
+ */
+class ImmatureAmountsMap
+{
+public:
+    typedef std::pair<int, CAmount> value_type;
+    typedef std::vector<value_type>::iterator iterator;
+    typedef std::vector<value_type>::const_iterator const_iterator;
+
+private:
+    std::vector<value_type> entries;
+
+    static bool HeightLess(const value_type& entry, int height) { return entry.first < height; }
+
+public:
+    iterator begin() { return entries.begin(); }
+    iterator end() { return entries.end(); }
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    void clear() { entries.clear(); }
+
+    iterator find(int height)
+    {
+        if (entries.empty())
+            return entries.end();
+        if (entries.front().first == height)
+            return entries.begin();
+        if (entries.back().first == height)
+            return entries.end() - 1;
+        iterator it = std::lower_bound(entries.begin(), entries.end(), height, HeightLess);
+        return (it != entries.end() && it->first == height) ? it : entries.end();
+    }
+
+    const_iterator find(int height) const
+    {
+        return const_cast<ImmatureAmountsMap*>(this)->find(height);
+    }
+
+    size_t count(int height) const { return find(height) != entries.end() ? 1 : 0; }
+
+    CAmount& at(int height)
+    {
+        iterator it = find(height);
+        if (it == entries.end())
+            throw std::out_of_range("ImmatureAmountsMap::at");
+        return it->second;
+    }
+
+    const CAmount& at(int height) const
+    {
+        return const_cast<ImmatureAmountsMap*>(this)->at(height);
+    }
+
+    /** Returns the amount maturing at height, adding an empty one if there is none. */
+    CAmount& operator[](int height)
+    {
+        if (entries.empty() || entries.back().first < height)
+        {
+            entries.emplace_back(height, 0);
+            return entries.back().second;
+        }
+        if (entries.back().first == height)
+            return entries.back().second;
+
+        iterator it = std::lower_bound(entries.begin(), entries.end(), height, HeightLess);
+        if (it == entries.end() || it->first != height)
+            it = entries.emplace(it, height, 0);
+        return it->second;
+    }
+
+    void erase(iterator it) { entries.erase(it); }
+
+    size_t erase(int height)
+    {
+        iterator it = find(height);
+        if (it == entries.end())
+            return 0;
+        entries.erase(it);
+        return 1;
+    }
+
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(entries); }
+
+    inline bool operator==(const ImmatureAmountsMap& rhs) const { return entries == rhs.entries; }
+    inline bool operator!=(const ImmatureAmountsMap& rhs) const { return !(*this == rhs); }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const
+    {
+        unsigned int nSize = GetSizeOfCompactSize(entries.size());
+        for (const value_type& entry : entries)
+            nSize += ::GetSerializeSize(entry, nType, nVersion);
+        return nSize;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const
+    {
+        WriteCompactSize(s, entries.size());
+        for (const value_type& entry : entries)
+            ::Serialize(s, entry, nType, nVersion);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion)
+    {
+        entries.clear();
+        unsigned int nSize = ReadCompactSize(s);
+        for (unsigned int i = 0; i < nSize; i++)
+        {
+            value_type entry;
+            ::Unserialize(s, entry, nType, nVersion);
+            (*this)[entry.first] = entry.second;
+        }
+    }
+};
+
+}
+
+#endif // _SC_IMMATURE_AMOUNTS_H
@@ -0,0 +1,184 @@
+#include "sc/proofcache.h"
+
+#include "hash.h"
+#include "random.h"
+#include "util.h"
+
+namespace {
+
+uint256 HashBytes(const std::vector<unsigned char>& bytes)
+{
+    return Hash(bytes.begin(), bytes.end());
+}
+
+}
+
+/**
+ * @brief Gets the cache entry of a certificate proof.
+ * 
+ * @param input The verifier input of the certificate
+ * @return entry_type The cache entry, the one memoized in the input if any.
+ */
+CScProofVerificationCache::entry_type CScProofVerificationCache::GetEntry(const CCertProofVerifierInput& input)
+{
+    if (input.cacheEntry)
+        return *input.cacheEntry;
+
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << input.constant;
+    ss << input.scId;
+    ss << input.epochNumber;
+    ss << input.quality;
+
+    for (const backward_transfer_t& bt : input.bt_list)
+    {
+        ss << FLATDATA(bt.pk_dest);
+        ss << bt.amount;
+    }
+
+    ss << input.vCustomFields;
+    ss << input.endEpochCumScTxCommTreeRoot;
+    ss << input.lastCertHash;
+    ss << input.mainchainBackwardTransferRequestScFee;
+    ss << input.forwardTransferScFee;
+
+    return entry_type(HashBytes(input.proof.GetByteArray()), HashBytes(input.verificationKey.GetByteArray()), ss.GetHash());
+}
+
+/**
+ * @brief Gets the cache entry of a CSW input proof.
+ * 
+ * @param input The verifier input of the CSW
+ * @return entry_type The cache entry, the one memoized in the input if any.
+ */
+CScProofVerificationCache::entry_type CScProofVerificationCache::GetEntry(const CCswProofVerifierInput& input)
+{
+    if (input.cacheEntry)
+        return *input.cacheEntry;
+
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << input.constant;
+    ss << input.scId;
+    ss << input.nValue;
+    ss << input.nullifier;
+    ss << input.pubKeyHash;
+    ss << input.certDataHash;
+    ss << input.ceasingCumScTxCommTree;
+
+    return entry_type(HashBytes(input.proof.GetByteArray()), HashBytes(input.verificationKey.GetByteArray()), ss.GetHash());
+}
+
+bool CScProofVerificationCache::Get(const entry_type& entry)
+{
+    boost::shared_lock<boost::shared_mutex> lock(cs_proofcache);
+    return setValid.count(entry) > 0;
+}
+
+void CScProofVerificationCache::Set(const entry_type& entry)
+{
+    int64_t nMaxCacheSize = GetArg("-maxproofcachesize", DEFAULT_MAX_SIZE);
+    if (nMaxCacheSize <= 0) return;
+
+    boost::unique_lock<boost::shared_mutex> lock(cs_proofcache);
+
+    while (static_cast<int64_t>(setValid.size()) >= nMaxCacheSize)
+    {
+        // Evict a random entry, as done by the signature cache.
+        std::set<entry_type>::iterator it = setValid.lower_bound(entry_type(GetRandHash(), uint256(), uint256()));
+        if (it == setValid.end())
+            it = setValid.begin();
+        setValid.erase(it);
+    }
+
+    setValid.insert(entry);
+}
+
+/**
+ * @brief Checks if all the proofs of a proof verifier item have already been verified.
+ * 
+ * @param item The proof verifier item (a certificate or the CSW inputs of a transaction)
+ * @return true If all the proofs of the item are in the cache.
+ */
+bool CScProofVerificationCache::Contains(const CProofVerifierItem& item)
+{
+    bool found = true;
+
+    if (item.proofInput.type() == typeid(CCertProofVerifierInput))
+    {
+        found = Get(GetEntry(boost::get<CCertProofVerifierInput>(item.proofInput)));
+    }
+    else
+    {
+        for (const CCswProofVerifierInput& input : boost::get<std::vector<CCswProofVerifierInput>>(item.proofInput))
+        {
+            if (!Get(GetEntry(input)))
+            {
+                found = false;
+                break;
+            }
+        }
+    }
+
+    if (found)
+        hits++;
+    else
+        misses++;
+
+    return found;
+}
+
+/**
+ * @brief Stores all the proofs of a proof verifier item that passed the verification.
+ * 
+ * @param item The proof verifier item (a certificate or the CSW inputs of a transaction)
+ */
+void CScProofVerificationCache::Insert(const CProofVerifierItem& item)
+{
+    assert(item.result == ProofVerificationResult::Passed);
+
+    if (item.proofInput.type() == typeid(CCertProofVerifierInput))
+    {
+        Set(GetEntry(boost::get<CCertProofVerifierInput>(item.proofInput)));
+    }
+    else
+    {
+        for (const CCswProofVerifierInput& input : boost::get<std::vector<CCswProofVerifierInput>>(item.proofInput))
+        {
+            Set(GetEntry(input));
+        }
+    }
+}
+
+void CScProofVerificationCache::Clear()
+{
+    boost::unique_lock<boost::shared_mutex> lock(cs_proofcache);
+    setValid.clear();
+    hits = 0;
+    misses = 0;
+}
+
+std::vector<CScProofVerificationCache::entry_type> CScProofVerificationCache::GetEntries()
+{
+    boost::shared_lock<boost::shared_mutex> lock(cs_proofcache);
+    return std::vector<entry_type>(setValid.begin(), setValid.end());
+}
+
+void CScProofVerificationCache::AddEntries(const std::vector<entry_type>& entries)
+{
+    for (const entry_type& entry : entries)
+    {
+        Set(entry);
+    }
+}
+
+ProofVerificationCacheStatistics CScProofVerificationCache::GetStatistics()
+{
+    ProofVerificationCacheStatistics stats;
+    stats.hits = hits;
+    stats.misses = misses;
+
+    boost::shared_lock<boost::shared_mutex> lock(cs_proofcache);
+    stats.size = setValid.size();
+
+    return stats;
+}
@@ -0,0 +1,81 @@
+#ifndef _SC_PROOF_CACHE_H
+#define _SC_PROOF_CACHE_H
+
+#include <atomic>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+#include "sc/proofverifier.h"
+#include "uint256.h"
+
+/**
+ * @brief A structure that stores statistics about the usage of the proof verification cache.
+ */
+struct ProofVerificationCacheStatistics
+{
+    uint64_t hits = 0;      /**< The number of proofs found in the cache (verification skipped). */
+    uint64_t misses = 0;    /**< The number of proofs not found in the cache (verification performed). */
+    uint64_t size = 0;      /**< The number of entries currently stored in the cache. */
+};
+
+/**
+ * @brief Valid sidechain proof cache, to avoid performing the expensive zk-SNARK verification twice
+ * for every certificate and CSW input (once when accepted into the memory pool, and again when
+ * accepted into the block chain).
+ * 
+ * Entries are keyed by the hash of the proof, the hash of the verification key and the hash of
+ * all the public inputs of the proof, so that a proof is found only if it was verified against
+ * exactly the same statement.
+ */
+class CScProofVerificationCache
+{
+public:
+
+    static constexpr int64_t DEFAULT_MAX_SIZE = 20000;    /**< The default maximum number of entries (about 100 bytes each). */
+
+    //! entry_type is (proof hash, verification key hash, public input hash)
+    typedef std::tuple<uint256, uint256, uint256> entry_type;
+
+    static CScProofVerificationCache& GetInstance()
+    {
+        static CScProofVerificationCache instance;
+
+        return instance;
+    }
+
+    CScProofVerificationCache(const CScProofVerificationCache&) = delete;
+    CScProofVerificationCache& operator=(const CScProofVerificationCache&) = delete;
+
+    static entry_type GetEntry(const CCertProofVerifierInput& input);
+    static entry_type GetEntry(const CCswProofVerifierInput& input);
+
+    bool Contains(const CProofVerifierItem& item);
+    void Insert(const CProofVerifierItem& item);
+    void Clear();
+
+    /** Returns all the cached entries, to persist them across restarts. */
+    std::vector<entry_type> GetEntries();
+
+    /** Adds entries previously returned by GetEntries(), subject to the maximum size of the cache. */
+    void AddEntries(const std::vector<entry_type>& entries);
+
+    ProofVerificationCacheStatistics GetStatistics();
+
+private:
+
+    CScProofVerificationCache() = default;
+
+    bool Get(const entry_type& entry);
+    void Set(const entry_type& entry);
+
+    std::set<entry_type> setValid;          /**< The set of proofs that passed the verification. */
+    boost::shared_mutex cs_proofcache;      /**< The lock guarding setValid. */
+
+    std::atomic<uint64_t> hits{0};          /**< The number of cache hits. */
+    std::atomic<uint64_t> misses{0};        /**< The number of cache misses. */
+};
+
+#endif // _SC_PROOF_CACHE_H
@@ -1,11 +1,38 @@
 #include "sc/proofverifier.h"
 
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <set>
+
 #include "coins.h"
+#include "hash.h"
 #include "main.h"
 #include "primitives/certificate.h"
+#include "sc/proofcache.h"
+#include "sc/proofverifierpool.h"
 
 std::atomic<uint32_t> CScProofVerifier::proofIdCounter(0);
 
+namespace {
+
+/**
+ * The verifier inputs of the latest certificates, built once and copied for each further verification of the same
+ * certificate: mempool acceptance, block connection, reprocessing of the mempool after a reorg. Besides the
+ * certificate, whose hash commits to its sidechain and so to the fixed parameters, the input only depends on the
+ * last certificate of the sidechain in the view, which is part of the key. The verification key is compared on
+ * a hit nonetheless, far cheaper than hashing it.
+ */
+const size_t MAX_CACHED_CERT_INPUTS = 256;
+
+typedef std::pair<uint256, CFieldElement> CertInputKey;
+
+std::mutex cs_certInputs;
+std::map<CertInputKey, std::shared_ptr<const CCertProofVerifierInput>> mapCertInputs;   //! guarded by cs_certInputs
+std::deque<CertInputKey> certInputsByAge;                                                //! guarded by cs_certInputs
+
+}
+
 /**
  * @brief Converts a ProofVerificationResult enum to string.
  *
@@ -41,10 +68,30 @@ CCertProofVerifierInput CScProofVerifier::CertificateToVerifierItem(const CScCer
 #else
 CCertProofVerifierInput CScProofVerifier::CertificateToVerifierItem(const CScCertificate& certificate, const Sidechain::ScFixedParameters& scFixedParams, CNode* pfrom, const CCoinsViewCache* view)
 {
+    CFieldElement lastCertHash;
+    if (view && scFixedParams.version >= 2) {
+        auto const& cdh = view->GetActiveCertView(certificate.GetScId()).certDataHash;
+        lastCertHash = cdh.IsNull() ? CFieldElement::GetPhantomHash() : cdh;
+    }
+
+    // the input built without a view is not meant for a verification (e.g. the data hash of the certificate)
+    const CertInputKey key(certificate.GetHash(), lastCertHash);
+    if (view)
+    {
+        std::lock_guard<std::mutex> lock(cs_certInputs);
+        auto it = mapCertInputs.find(key);
+        if (it != mapCertInputs.end() && it->second->verificationKey.GetByteArray() == scFixedParams.wCertVk.GetByteArray())
+        {
+            CCertProofVerifierInput certData = *it->second;
+            certData.proofId = proofIdCounter++;
+            return certData;
+        }
+    }
+
     CCertProofVerifierInput certData;
 
     certData.proofId = proofIdCounter++;
-    certData.certHash = certificate.GetHash();
+    certData.certHash = key.first;
     certData.scId = certificate.GetScId();
 
     if (scFixedParams.constant.has_value())
@@ -67,15 +114,15 @@ CCertProofVerifierInput CScProofVerifier::CertificateToVerifierItem(const CScCer
 
     for (int i = 0; i < certificate.vFieldElementCertificateField.size(); i++)
     {
-        FieldElementCertificateField entry = certificate.vFieldElementCertificateField.at(i);
-        CFieldElement fe{entry.GetFieldElement(scFixedParams.vFieldElementCertificateFieldConfig.at(i), scFixedParams.version)};
+        const FieldElementCertificateField& entry = certificate.vFieldElementCertificateField.at(i);
+        const CFieldElement& fe = entry.GetFieldElement(scFixedParams.vFieldElementCertificateFieldConfig.at(i), scFixedParams.version);
         assert(fe.IsValid());
         certData.vCustomFields.push_back(fe);
     }
     for (int i = 0; i < certificate.vBitVectorCertificateField.size(); i++)
     {
-        BitVectorCertificateField entry = certificate.vBitVectorCertificateField.at(i);
-        CFieldElement fe{entry.GetFieldElement(scFixedParams.vBitVectorCertificateFieldConfig.at(i), scFixedParams.version)};
+        const BitVectorCertificateField& entry = certificate.vBitVectorCertificateField.at(i);
+        const CFieldElement& fe = entry.GetFieldElement(scFixedParams.vBitVectorCertificateFieldConfig.at(i), scFixedParams.version);
         assert(fe.IsValid());
         certData.vCustomFields.push_back(fe);
     }
@@ -86,10 +133,28 @@ CCertProofVerifierInput CScProofVerifier::CertificateToVerifierItem(const CScCer
 
     certData.proof = certificate.scProof;
     certData.verificationKey = scFixedParams.wCertVk;
+    certData.lastCertHash = lastCertHash;
 
-    if (view && scFixedParams.version >= 2) {
-        auto const& cdh = view->GetActiveCertView(certData.scId).certDataHash;
-        certData.lastCertHash = cdh.IsNull() ? CFieldElement::GetPhantomHash() : cdh;
+    if (view)
+    {
+        // hashing the proof and the verification key, for the proof cache, is done once as well
+        certData.cacheEntry = std::make_shared<const CScProofVerificationCache::entry_type>(CScProofVerificationCache::GetEntry(certData));
+
+        std::lock_guard<std::mutex> lock(cs_certInputs);
+        auto ret = mapCertInputs.emplace(key, std::make_shared<const CCertProofVerifierInput>(certData));
+        if (!ret.second)
+        {
+            ret.first->second = std::make_shared<const CCertProofVerifierInput>(certData);
+        }
+        else
+        {
+            certInputsByAge.push_back(key);
+            if (certInputsByAge.size() > MAX_CACHED_CERT_INPUTS)
+            {
+                mapCertInputs.erase(certInputsByAge.front());
+                certInputsByAge.pop_front();
+            }
+        }
     }
     return certData;
 }
@@ -128,6 +193,10 @@ CCswProofVerifierInput CScProofVerifier::CswInputToVerifierItem(const CTxCeasedS
     
     cswData.verificationKey = scFixedParams.wCeasedVk.value();
 
+    // the input is looked up in the proof cache before the verification and inserted after it
+    if (cswTransaction)
+        cswData.cacheEntry = std::make_shared<const CScProofVerificationCache::entry_type>(CScProofVerificationCache::GetEntry(cswData));
+
     return cswData;
 }
 
@@ -160,7 +229,7 @@ void CScProofVerifier::LoadDataForCertVerification(const CCoinsViewCache& view,
     item.parentPtr = std::make_shared<CScCertificate>(scCert);
     item.node = pfrom;
     item.result = ProofVerificationResult::Unknown;
-    item.proofInput = CertificateToVerifierItem(scCert, sidechain.fixedParams, pfrom, &view);
+    item.proofInput = CertificateToVerifierItem(scCert, sidechain.GetFixedParams(), pfrom, &view);
     proofQueue.insert(std::make_pair(scCert.GetHash(), item));
 }
 
@@ -185,7 +254,7 @@ void CScProofVerifier::LoadDataForCswVerification(const CCoinsViewCache& view, c
         CSidechain sidechain;
         assert(view.GetSidechain(cswInput.scId, sidechain) && "Unknown sidechain at scTx proof verification stage");
         
-        cswInputProofs.push_back(CswInputToVerifierItem(cswInput, &scTx, sidechain.fixedParams, pfrom));
+        cswInputProofs.push_back(CswInputToVerifierItem(cswInput, &scTx, sidechain.GetFixedParams(), pfrom));
     }
 
     if (!cswInputProofs.empty())
@@ -220,7 +289,113 @@ void CScProofVerifier::LoadDataForCswVerification(const CCoinsViewCache& view, c
  */
 bool CScProofVerifier::BatchVerify()
 {
-    return BatchVerifyInternal(proofQueue);
+    return ParallelBatchVerify(proofQueue);
+}
+
+/**
+ * @brief Gets the shard a proof verifier item belongs to, that is the proving system and the
+ * verification key used by its (first) proof.
+ * 
+ * @param item The proof verifier item
+ * @return ShardKey The shard key of the item.
+ */
+CScProofVerifier::ShardKey CScProofVerifier::GetShardKey(const CProofVerifierItem& item)
+{
+    const CScVKey* vk = nullptr;
+
+    if (item.proofInput.type() == typeid(CCertProofVerifierInput))
+    {
+        vk = &boost::get<CCertProofVerifierInput>(item.proofInput).verificationKey;
+    }
+    else
+    {
+        const std::vector<CCswProofVerifierInput>& cswInputs = boost::get<std::vector<CCswProofVerifierInput>>(item.proofInput);
+
+        if (cswInputs.empty())
+        {
+            return ShardKey(Sidechain::ProvingSystemType::Undefined, uint256());
+        }
+
+        vk = &cswInputs.front().verificationKey;
+    }
+
+    // the verification key hash of the proof cache entry, if already computed
+    const std::shared_ptr<const std::tuple<uint256, uint256, uint256>>& cacheEntry =
+        item.proofInput.type() == typeid(CCertProofVerifierInput) ?
+            boost::get<CCertProofVerifierInput>(item.proofInput).cacheEntry :
+            boost::get<std::vector<CCswProofVerifierInput>>(item.proofInput).front().cacheEntry;
+    if (cacheEntry)
+        return ShardKey(vk->getProvingSystemType(), std::get<1>(*cacheEntry));
+
+    const std::vector<unsigned char>& vkBytes = vk->GetByteArray();
+    return ShardKey(vk->getProvingSystemType(), Hash(vkBytes.begin(), vkBytes.end()));
+}
+
+/**
+ * @brief Runs the batch verification over a set of proofs, splitting them into shards (by proving system
+ * and verification key) that are verified in parallel by the proof verifier pool.
+ * 
+ * If the pool is not running the proofs are verified with a single batch by the calling thread.
+ * 
+ * @param proofs The map containing all the proofs of any kind to be verified
+ * 
+ * @return true If the verification succeeded for all the proofs.
+ * @return false If the verification failed for at least one proof.
+ */
+bool CScProofVerifier::ParallelBatchVerify(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs)
+{
+    CScProofVerifierPool& pool = CScProofVerifierPool::GetInstance();
+
+    if (proofs.size() < 2 || verificationMode == Verification::Loose || !pool.IsRunning())
+    {
+        return BatchVerifyInternal(proofs);
+    }
+
+    std::map</* Cert or Tx hash */ uint256, ShardKey> shardKeys;
+    std::set<ShardKey> distinctKeys;
+
+    for (const auto& entry : proofs)
+    {
+        ShardKey key = GetShardKey(entry.second);
+        shardKeys.insert(std::make_pair(entry.first, key));
+        distinctKeys.insert(key);
+    }
+
+    if (distinctKeys.size() < 2)
+    {
+        return BatchVerifyInternal(proofs);
+    }
+
+    LogPrint("cert", "%s():%d - verifying %d proofs split into %d shards\n", __func__, __LINE__, proofs.size(), distinctKeys.size());
+
+    std::map<ShardKey, std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>> shards;
+
+    for (auto& entry : proofs)
+    {
+        shards[shardKeys.at(entry.first)].insert(std::make_pair(entry.first, std::move(entry.second)));
+    }
+
+    proofs.clear();
+
+    std::vector<CScProofVerifierPool::Task> tasks;
+    std::vector<char> results(shards.size(), false);
+    size_t i = 0;
+
+    for (auto& shard : shards)
+    {
+        std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& shardProofs = shard.second;
+        char& result = results[i++];
+        tasks.push_back([this, &shardProofs, &result]() { result = BatchVerifyInternal(shardProofs); });
+    }
+
+    pool.RunTasks(tasks, verificationPriority == Priority::High);
+
+    for (auto& shard : shards)
+    {
+        proofs.insert(shard.second.begin(), shard.second.end());
+    }
+
+    return std::all_of(results.begin(), results.end(), [](char result) { return result; });
 }
 
 /**
@@ -247,6 +422,23 @@ bool CScProofVerifier::BatchVerifyInternal(std::map</* Cert or Tx hash */ uint25
         return true;
     }
 
+    // Proofs already verified (e.g. when accepted into the mempool) don't need to be verified again.
+    size_t cachedProofs = 0;
+    for (auto& proof : proofs)
+    {
+        if (CScProofVerificationCache::GetInstance().Contains(proof.second))
+        {
+            proof.second.result = ProofVerificationResult::Passed;
+            cachedProofs++;
+        }
+    }
+
+    if (cachedProofs == proofs.size())
+    {
+        LogPrint("cert", "%s():%d - all %d proof(s) found in the cache\n", __func__, __LINE__, cachedProofs);
+        return true;
+    }
+
     // The parameter in the ctor is a boolean telling mc-crypto lib if the rust verifier executing thread
     // will be a high-priority one (default is false)
     ZendooBatchProofVerifier batchVerifier(verificationPriority == Priority::High);
@@ -260,6 +452,12 @@ bool CScProofVerifier::BatchVerifyInternal(std::map</* Cert or Tx hash */ uint25
     {
         CProofVerifierItem& item = proofEntry.second;
 
+        if (item.result == ProofVerificationResult::Passed)
+        {
+            // Found in the cache.
+            continue;
+        }
+
         assert(item.result == ProofVerificationResult::Unknown);
 
         if (item.proofInput.type() == typeid(std::vector<CCswProofVerifierInput>))
@@ -397,6 +595,7 @@ bool CScProofVerifier::BatchVerifyInternal(std::map</* Cert or Tx hash */ uint25
             if (item.result == ProofVerificationResult::Unknown)
             {
                 item.result = ProofVerificationResult::Passed;
+                CScProofVerificationCache::GetInstance().Insert(item);
             }
         }
     }
@@ -427,6 +626,82 @@ bool CScProofVerifier::BatchVerifyInternal(std::map</* Cert or Tx hash */ uint25
     return !addFailure && verRes.Result();
 }
 
+/**
+ * @brief Runs the batch verification over a set of proofs isolating the ones that make the batch fail.
+ * 
+ * When the batch fails without reporting which proofs are invalid, the set is split in two halves that are
+ * verified (and, if needed, split again) independently; this way a single invalid proof costs O(log n)
+ * additional batch verifications instead of the verification of every proof one by one.
+ * 
+ * The processOutputs function is called as soon as the result of some proofs is known and it is expected
+ * to remove from the map all the proofs whose result is not ProofVerificationResult::Unknown anymore,
+ * so that failures can be attributed to the sender nodes without waiting for the whole set to be processed.
+ * 
+ * @param proofs The map containing all the proofs of any kind to be verified
+ * @param processOutputs The function processing (and removing) proofs whose verification is completed
+ * @param knownFailing Whether the caller has just seen the batch verification of this very set fail
+ * without isolating any proof, so that it is split without being verified again
+ */
+void CScProofVerifier::BisectVerify(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs,
+                                    const std::function<void(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>&)>& processOutputs,
+                                    bool knownFailing)
+{
+    if (proofs.empty())
+    {
+        return;
+    }
+
+    if (!knownFailing)
+    {
+        BatchVerifyInternal(proofs);
+        bool failuresIsolated = AnyFailed(proofs);
+        processOutputs(proofs);
+
+        if (proofs.empty())
+        {
+            return;
+        }
+
+        if (failuresIsolated)
+        {
+            // Some failing proofs have been identified (and removed), the remaining ones are likely to be valid.
+            BisectVerify(proofs, processOutputs);
+            return;
+        }
+    }
+
+    if (proofs.size() == 1)
+    {
+        // The batch verifier couldn't tell anything about a single proof, the normal verification is authoritative.
+        NormalVerify(proofs);
+        processOutputs(proofs);
+        return;
+    }
+
+    LogPrint("cert", "%s():%d - Batch verification of %d proofs failed, splitting the batch\n", __func__, __LINE__, proofs.size());
+
+    auto middle = std::next(proofs.begin(), proofs.size() / 2);
+    std::map</* Cert or Tx hash */ uint256, CProofVerifierItem> firstHalf(proofs.begin(), middle);
+    proofs.erase(proofs.begin(), middle);
+
+    BisectVerify(firstHalf, processOutputs);
+    BisectVerify(proofs, processOutputs);
+
+    proofs.insert(firstHalf.begin(), firstHalf.end());
+}
+
+/**
+ * @brief Tells whether the verification of some proofs of a set has failed.
+ * 
+ * @param proofs The map of proofs of any kind
+ * @return true If the result of at least one proof is ProofVerificationResult::Failed
+ */
+bool CScProofVerifier::AnyFailed(const std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs)
+{
+    return std::any_of(proofs.begin(), proofs.end(),
+                       [](const std::pair<const uint256, CProofVerifierItem>& entry) { return entry.second.result == ProofVerificationResult::Failed; });
+}
+
 /**
  * @brief Runs the verification for a set of proofs one by one (not batched).
  * The result of the verification for each item is stored inside the 
@@ -440,6 +715,12 @@ void CScProofVerifier::NormalVerify(std::map</* Cert or Tx hash */ uint256, CPro
     {
         CProofVerifierItem& item = proof.second;
 
+        if (verificationMode == Verification::Strict && CScProofVerificationCache::GetInstance().Contains(item))
+        {
+            item.result = ProofVerificationResult::Passed;
+            continue;
+        }
+
         if (item.proofInput.type() == typeid(std::vector<CCswProofVerifierInput>))
         {
             item.result = NormalVerifyCsw(boost::get<std::vector<CCswProofVerifierInput>>(item.proofInput));
@@ -453,6 +734,11 @@ void CScProofVerifier::NormalVerify(std::map</* Cert or Tx hash */ uint256, CPro
             // It should never happen that the proof entry is neither a certificate nor a CSW input.
             assert(false);
         }
+
+        if (item.result == ProofVerificationResult::Passed)
+        {
+            CScProofVerificationCache::GetInstance().Insert(item);
+        }
     }
 }
 
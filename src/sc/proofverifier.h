@@ -1,7 +1,10 @@
 #ifndef _SC_PROOF_VERIFIER_H
 #define _SC_PROOF_VERIFIER_H
 
+#include <functional>
 #include <map>
+#include <memory>
+#include <tuple>
 
 #include <boost/variant.hpp>
 
@@ -37,6 +40,8 @@ struct CBaseProofVerifierInput
     CScVKey verificationKey;                        /**< The key to be used for the verification. */
     uint256 scId;                                   /**< The ID of the sidechain referred by the certificate or CSW. */
     CFieldElement constant;
+    std::shared_ptr<const std::tuple<uint256, uint256, uint256>> cacheEntry;   /**< The entry of the proof verification cache (proof, verification key and public inputs hashes),
+                                                                                     computed once when the input is built for a verification, null otherwise. */
 };
 
 /**
@@ -122,13 +127,25 @@ public:
 
 protected:
 
-    bool BatchVerifyInternal(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs);
-    void NormalVerify(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs);
+    virtual bool BatchVerifyInternal(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs);
+    bool ParallelBatchVerify(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs);
+    void BisectVerify(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs,
+                      const std::function<void(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>&)>& processOutputs,
+                      bool knownFailing = false);
+    static bool AnyFailed(const std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs);
+    virtual void NormalVerify(std::map</* Cert or Tx hash */ uint256, CProofVerifierItem>& proofs);
     ProofVerificationResult NormalVerifyCertificate(CCertProofVerifierInput input) const;
     ProofVerificationResult NormalVerifyCsw(std::vector<CCswProofVerifierInput> cswInputs) const;
 
     std::map</* Cert or Tx hash */ uint256, CProofVerifierItem> proofQueue;   /**< The queue of proofs to be verified. */
 
+    /**
+     * @brief The key used to split proofs into shards that can be verified in parallel.
+     */
+    typedef std::pair<Sidechain::ProvingSystemType, uint256 /* Verification key hash */> ShardKey;
+
+    static ShardKey GetShardKey(const CProofVerifierItem& item);
+
 private:
 
     static std::atomic<uint32_t> proofIdCounter;   /**< The counter used to get a unique ID for proofs. */
@@ -0,0 +1,188 @@
+#include "sc/proofverifierpool.h"
+
+#include "util.h"
+
+CScProofVerifierPool::~CScProofVerifierPool()
+{
+    Stop();
+}
+
+/**
+ * @brief Starts the worker threads of the pool.
+ * 
+ * @param numberOfWorkers The number of worker threads; no thread is started if lower than 2
+ * @param numberOfReservedWorkers The number of workers reserved to high priority tasks
+ */
+void CScProofVerifierPool::Start(size_t numberOfWorkers, size_t numberOfReservedWorkers)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+
+    if (running || numberOfWorkers < 2)
+    {
+        return;
+    }
+
+    this->numberOfWorkers = numberOfWorkers;
+
+    // At least one worker must be able to serve low priority tasks.
+    this->numberOfReservedWorkers = std::min(numberOfReservedWorkers, numberOfWorkers - 1);
+
+    stopRequested = false;
+    running = true;
+
+    for (size_t i = 0; i < numberOfWorkers; i++)
+    {
+        workers.create_thread(boost::bind(&CScProofVerifierPool::WorkerLoop, this));
+    }
+
+    LogPrintf("%s():%d - started %d sc proof verification threads (%d reserved to block validation)\n",
+        __func__, __LINE__, this->numberOfWorkers, this->numberOfReservedWorkers);
+}
+
+/**
+ * @brief Stops the worker threads of the pool, waiting for the queued tasks to be completed.
+ */
+void CScProofVerifierPool::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+
+        if (!running)
+        {
+            return;
+        }
+
+        stopRequested = true;
+    }
+
+    newTaskAvailable.notify_all();
+    workers.join_all();
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+    running = false;
+    numberOfWorkers = 0;
+    numberOfReservedWorkers = 0;
+}
+
+bool CScProofVerifierPool::IsRunning() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return running && !stopRequested;
+}
+
+size_t CScProofVerifierPool::GetNumberOfWorkers() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return running ? numberOfWorkers : 1;
+}
+
+bool CScProofVerifierPool::HasReservedWorkers() const
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    return running && numberOfReservedWorkers > 0;
+}
+
+/**
+ * @brief Checks if a worker can pick a low priority task without invading the reserved workers.
+ * The caller must hold the mutex.
+ */
+bool CScProofVerifierPool::CanRunLowPriorityTask() const
+{
+    return !lowPriorityQueue.empty() && runningLowPriorityTasks < numberOfWorkers - numberOfReservedWorkers;
+}
+
+/**
+ * @brief Runs a group of tasks on the pool and waits for all of them to complete.
+ * 
+ * @param tasks The tasks to be executed
+ * @param highPriority True if the tasks have to be executed with high priority
+ */
+void CScProofVerifierPool::RunTasks(const std::vector<Task>& tasks, bool highPriority)
+{
+    if (!IsRunning() || tasks.size() < 2)
+    {
+        for (const Task& task : tasks)
+        {
+            task();
+        }
+        return;
+    }
+
+    boost::mutex completionMutex;
+    boost::condition_variable completionCondition;
+    size_t pendingTasks = tasks.size();
+
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        std::deque<Task>& queue = highPriority ? highPriorityQueue : lowPriorityQueue;
+
+        for (const Task& task : tasks)
+        {
+            queue.push_back([&, task]()
+            {
+                task();
+
+                boost::unique_lock<boost::mutex> completionLock(completionMutex);
+                if (--pendingTasks == 0)
+                {
+                    completionCondition.notify_all();
+                }
+            });
+        }
+    }
+
+    newTaskAvailable.notify_all();
+
+    boost::unique_lock<boost::mutex> completionLock(completionMutex);
+    while (pendingTasks > 0)
+    {
+        completionCondition.wait(completionLock);
+    }
+}
+
+/**
+ * @brief The loop executed by each worker thread.
+ */
+void CScProofVerifierPool::WorkerLoop()
+{
+    RenameThread("horizen-scproof");
+
+    boost::unique_lock<boost::mutex> lock(mutex);
+
+    while (true)
+    {
+        while (highPriorityQueue.empty() && !CanRunLowPriorityTask() && !(stopRequested && lowPriorityQueue.empty()))
+        {
+            newTaskAvailable.wait(lock);
+        }
+
+        bool highPriority = !highPriorityQueue.empty();
+
+        if (!highPriority && !CanRunLowPriorityTask())
+        {
+            // Stop requested and nothing left to do.
+            break;
+        }
+
+        std::deque<Task>& queue = highPriority ? highPriorityQueue : lowPriorityQueue;
+        Task task = std::move(queue.front());
+        queue.pop_front();
+
+        if (!highPriority)
+        {
+            runningLowPriorityTasks++;
+        }
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        if (!highPriority)
+        {
+            runningLowPriorityTasks--;
+
+            // A slot for low priority tasks has been released.
+            newTaskAvailable.notify_all();
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef _SC_PROOF_VERIFIER_POOL_H
+#define _SC_PROOF_VERIFIER_POOL_H
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+/**
+ * @brief A pool of worker threads running sidechain proof verification tasks.
+ * 
+ * Tasks are submitted in groups with low or high priority and the caller waits for the whole group to complete.
+ * High priority tasks (proofs included in a block being connected) are always served first and a number of workers
+ * is reserved to them, so that they never have to wait for the verification of the proofs received by the mempool.
+ * 
+ * When the pool is not running (for instance when a single verification thread is configured), the tasks are
+ * executed sequentially by the calling thread.
+ */
+class CScProofVerifierPool
+{
+public:
+
+    static constexpr int DEFAULT_NUMBER_OF_THREADS = 1;     /**< The default number of worker threads (1 means no pool). */
+    static constexpr int MAX_NUMBER_OF_THREADS = 64;       /**< The maximum number of worker threads. */
+
+    typedef std::function<void()> Task;
+
+    static CScProofVerifierPool& GetInstance()
+    {
+        static CScProofVerifierPool instance;
+
+        return instance;
+    }
+
+    CScProofVerifierPool(const CScProofVerifierPool&) = delete;
+    CScProofVerifierPool& operator=(const CScProofVerifierPool&) = delete;
+
+    ~CScProofVerifierPool();
+
+    void Start(size_t numberOfWorkers, size_t numberOfReservedWorkers);
+    void Stop();
+
+    bool IsRunning() const;
+    size_t GetNumberOfWorkers() const;
+    bool HasReservedWorkers() const;
+
+    void RunTasks(const std::vector<Task>& tasks, bool highPriority);
+
+private:
+
+    CScProofVerifierPool() = default;
+
+    void WorkerLoop();
+    bool CanRunLowPriorityTask() const;
+
+    mutable boost::mutex mutex;                     /**< The mutex guarding all the members below. */
+    boost::condition_variable newTaskAvailable;     /**< Notified each time a task is queued or the pool is stopped. */
+
+    boost::thread_group workers;                    /**< The worker threads. */
+    size_t numberOfWorkers = 0;                     /**< The number of worker threads. */
+    size_t numberOfReservedWorkers = 0;             /**< The number of workers that can't run low priority tasks. */
+    size_t runningLowPriorityTasks = 0;             /**< The number of low priority tasks currently being executed. */
+    bool running = false;                           /**< True if the worker threads have been started. */
+    bool stopRequested = false;                     /**< True if the workers have to stop as soon as the queues are empty. */
+
+    std::deque<Task> highPriorityQueue;             /**< The queue of high priority tasks. */
+    std::deque<Task> lowPriorityQueue;              /**< The queue of low priority tasks. */
+};
+
+#endif // _SC_PROOF_VERIFIER_POOL_H
@@ -0,0 +1,274 @@
+#ifndef _SC_FEES_BUFFER_H
+#define _SC_FEES_BUFFER_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include "amount.h"
+#include "memusage.h"
+#include "serialize.h"
+#include "sc/sidechaintypes.h"
+
+namespace Sidechain
+{
+
+/**
+ * FIFO queue stored inline in a single vector, used as a circular buffer. It only allocates when
+ * it is full, doubling its capacity, so a queue reserved for its maximum size never allocates again.
+ */
+template <typename T>
+class RingBuffer
+{
+private:
+    std::vector<T> storage;
+    size_t head;
+    size_t count;
+
+    void Relocate(size_t newCapacity)
+    {
+        std::vector<T> newStorage(newCapacity);
+        for (size_t i = 0; i < count; ++i)
+            newStorage[i] = (*this)[i];
+        storage.swap(newStorage);
+        head = 0;
+    }
+
+public:
+    RingBuffer(): head(0), count(0) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    size_t capacity() const { return storage.size(); }
+
+    T& operator[](size_t i) { assert(i < count); return storage[(head + i) % storage.size()]; }
+    const T& operator[](size_t i) const { assert(i < count); return storage[(head + i) % storage.size()]; }
+
+    T& front() { return (*this)[0]; }
+    const T& front() const { return (*this)[0]; }
+    T& back() { return (*this)[count - 1]; }
+    const T& back() const { return (*this)[count - 1]; }
+
+    void reserve(size_t n)
+    {
+        if (n > storage.size())
+            Relocate(n);
+    }
+
+    void push_back(const T& value)
+    {
+        if (count == storage.size())
+            Relocate(std::max<size_t>(1, 2 * storage.size()));
+        storage[(head + count) % storage.size()] = value;
+        ++count;
+    }
+
+    void pop_front()
+    {
+        assert(count > 0);
+        head = (head + 1) % storage.size();
+        --count;
+    }
+
+    void pop_back()
+    {
+        assert(count > 0);
+        --count;
+    }
+
+    void clear()
+    {
+        head = 0;
+        count = 0;
+    }
+
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(storage); }
+};
+
+/**
+ * The sc fees set by the last certificates of a sidechain, oldest first.
+ *
+ * The entries are kept by value in a ring buffer, and the minimum of each fee over the buffer is tracked
+ * with a monotonic queue: it holds the sequence numbers of the entries that may still become the minimum
+ * once the older ones are popped, with increasing fees. The minimum is then always the front of the queue,
+ * and every push and pop costs amortized constant time.
+ *
+ * Ceasing sidechains store no submission height (it is -1 and it is not serialized).
+ */
+class ScFeesBuffer
+{
+private:
+    RingBuffer<ScFeeData_v2> entries;
+    RingBuffer<uint64_t> minFtScFeeSeqs;
+    RingBuffer<uint64_t> minMbtrScFeeSeqs;
+    uint64_t nPushed; // sequence number of the next entry
+
+    const ScFeeData_v2& AtSeq(uint64_t seq) const { return entries[seq - (nPushed - entries.size())]; }
+
+    template <typename Fee>
+    void PushMin(RingBuffer<uint64_t>& minSeqs, uint64_t seq, Fee fee)
+    {
+        // entries not less than the new one can never be the minimum again
+        while (!minSeqs.empty() && AtSeq(minSeqs.back()).*fee >= AtSeq(seq).*fee)
+            minSeqs.pop_back();
+        minSeqs.push_back(seq);
+    }
+
+public:
+    class const_iterator
+    {
+    private:
+        const ScFeesBuffer* buffer;
+        size_t pos;
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef ScFeeData_v2 value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const ScFeeData_v2* pointer;
+        typedef const ScFeeData_v2& reference;
+
+        const_iterator(const ScFeesBuffer* bufferIn, size_t posIn): buffer(bufferIn), pos(posIn) {}
+
+        reference operator*() const { return (*buffer)[pos]; }
+        pointer operator->() const { return &(*buffer)[pos]; }
+        const_iterator& operator++() { ++pos; return *this; }
+        const_iterator operator++(int) { const_iterator copy(*this); ++pos; return copy; }
+        bool operator==(const const_iterator& other) const { return buffer == other.buffer && pos == other.pos; }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+    };
+
+    ScFeesBuffer(): nPushed(0) {}
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    const ScFeeData_v2& operator[](size_t i) const { return entries[i]; }
+    const ScFeeData_v2& front() const { return entries.front(); }
+    const ScFeeData_v2& back() const { return entries.back(); }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, entries.size()); }
+
+    /** Allocates room for n entries, so that the buffer does not allocate while it holds at most n of them. */
+    void reserve(size_t n)
+    {
+        entries.reserve(n);
+        minFtScFeeSeqs.reserve(n);
+        minMbtrScFeeSeqs.reserve(n);
+    }
+
+    void push_back(const ScFeeData_v2& entry)
+    {
+        const uint64_t seq = nPushed++;
+        entries.push_back(entry);
+        PushMin(minFtScFeeSeqs, seq, &ScFeeData::forwardTxScFee);
+        PushMin(minMbtrScFeeSeqs, seq, &ScFeeData::mbtrTxScFee);
+    }
+
+    void pop_front()
+    {
+        const uint64_t seq = nPushed - entries.size();
+        if (minFtScFeeSeqs.front() == seq)
+            minFtScFeeSeqs.pop_front();
+        if (minMbtrScFeeSeqs.front() == seq)
+            minMbtrScFeeSeqs.pop_front();
+        entries.pop_front();
+    }
+
+    /** Lowers the fees of the newest entry to the given ones, if they are lower. */
+    void LowerBackFees(CAmount ftScFee, CAmount mbtrScFee)
+    {
+        ScFeeData_v2& entry = entries.back();
+        entry.forwardTxScFee = std::min(entry.forwardTxScFee, ftScFee);
+        entry.mbtrTxScFee    = std::min(entry.mbtrTxScFee, mbtrScFee);
+
+        // the newest entry is always the back of the queues: it is pushed again at its new place
+        const uint64_t seq = nPushed - 1;
+        minFtScFeeSeqs.pop_back();
+        PushMin(minFtScFeeSeqs, seq, &ScFeeData::forwardTxScFee);
+        minMbtrScFeeSeqs.pop_back();
+        PushMin(minMbtrScFeeSeqs, seq, &ScFeeData::mbtrTxScFee);
+    }
+
+    void clear()
+    {
+        entries.clear();
+        minFtScFeeSeqs.clear();
+        minMbtrScFeeSeqs.clear();
+    }
+
+    CAmount GetMinFtScFee() const
+    {
+        assert(!empty());
+        return AtSeq(minFtScFeeSeqs.front()).forwardTxScFee;
+    }
+
+    CAmount GetMinMbtrScFee() const
+    {
+        assert(!empty());
+        return AtSeq(minMbtrScFeeSeqs.front()).mbtrTxScFee;
+    }
+
+    size_t DynamicMemoryUsage() const
+    {
+        return entries.DynamicMemoryUsage() + minFtScFeeSeqs.DynamicMemoryUsage() + minMbtrScFeeSeqs.DynamicMemoryUsage();
+    }
+
+    inline bool operator==(const ScFeesBuffer& rhs) const
+    {
+        return size() == rhs.size() && std::equal(begin(), end(), rhs.begin());
+    }
+    inline bool operator!=(const ScFeesBuffer& rhs) const { return !(*this == rhs); }
+
+    /**
+     * Serialized as a list of ScFeeData, or of ScFeeData_v2 if fWithSubmissionHeight is set, which is the
+     * format used when the entries were allocated separately.
+     */
+    template <typename Stream>
+    void Serialize(Stream& s, bool fWithSubmissionHeight, int nType, int nVersion) const
+    {
+        WriteCompactSize(s, size());
+        for (const ScFeeData_v2& entry : *this)
+        {
+            if (fWithSubmissionHeight)
+                ::Serialize(s, entry, nType, nVersion);
+            else
+                ::Serialize(s, static_cast<const ScFeeData&>(entry), nType, nVersion);
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s, bool fWithSubmissionHeight, int nType, int nVersion)
+    {
+        clear();
+        unsigned int nSize = ReadCompactSize(s);
+        for (unsigned int i = 0; i < nSize; ++i)
+        {
+            ScFeeData_v2 entry;
+            if (fWithSubmissionHeight)
+                ::Unserialize(s, entry, nType, nVersion);
+            else
+                ::Unserialize(s, static_cast<ScFeeData&>(entry), nType, nVersion);
+            push_back(entry);
+        }
+    }
+
+    template <typename Stream>
+    void SerReadWrite(Stream& s, bool fWithSubmissionHeight, int nType, int nVersion, CSerActionSerialize ser_action) const
+    {
+        Serialize(s, fWithSubmissionHeight, nType, nVersion);
+    }
+
+    template <typename Stream>
+    void SerReadWrite(Stream& s, bool fWithSubmissionHeight, int nType, int nVersion, CSerActionUnserialize ser_action)
+    {
+        Unserialize(s, fWithSubmissionHeight, nType, nVersion);
+    }
+};
+
+}
+
+#endif // _SC_FEES_BUFFER_H
@@ -13,6 +13,7 @@
 #include <main.h>
 #include "leveldbwrapper.h"
 #include <boost/filesystem.hpp>
+#include <mutex>
 
 static const boost::filesystem::path Sidechain::GetSidechainDataDir()
 {
@@ -193,7 +194,7 @@ int CSidechain::EpochFor(int targetHeight) const
 
     assert(!isNonCeasing());
 
-    return (targetHeight - creationBlockHeight) / fixedParams.withdrawalEpochLength;
+    return (targetHeight - creationBlockHeight) / GetFixedParams().withdrawalEpochLength;
 }
 
 int CSidechain::GetStartHeightForEpoch(int targetEpoch) const
@@ -201,7 +202,7 @@ int CSidechain::GetStartHeightForEpoch(int targetEpoch) const
     if (!isCreationConfirmed()) //default value
         return -1;
 
-    return creationBlockHeight + targetEpoch * fixedParams.withdrawalEpochLength;
+    return creationBlockHeight + targetEpoch * GetFixedParams().withdrawalEpochLength;
 }
 
 int CSidechain::GetEndHeightForEpoch(int targetEpoch) const
@@ -209,7 +210,7 @@ int CSidechain::GetEndHeightForEpoch(int targetEpoch) const
     if (!isCreationConfirmed() || isNonCeasing()) //default value
         return -1;
 
-    return GetStartHeightForEpoch(targetEpoch) + fixedParams.withdrawalEpochLength - 1;
+    return GetStartHeightForEpoch(targetEpoch) + GetFixedParams().withdrawalEpochLength - 1;
 }
 
 int CSidechain::GetCertSubmissionWindowStart(int certEpoch) const
@@ -233,7 +234,7 @@ int CSidechain::GetCertSubmissionWindowLength() const
     if (isNonCeasing())
         return 0;
 
-    return std::max(2,fixedParams.withdrawalEpochLength/5);
+    return std::max(2,GetFixedParams().withdrawalEpochLength/5);
 } 
 
 int CSidechain::GetCertMaturityHeight(int certEpoch, int includingBlockHeight) const
@@ -272,7 +273,7 @@ std::string CSidechain::ToString() const
                       " lastInclusionHeight=%d\n"
                       " lastTopQualityCertBwtAmount=%s\n balance=%s\n"
                       " fixedParams=[NOT PRINTED CURRENTLY]\n mImmatureAmounts=[NOT PRINTED CURRENTLY])",
-        fixedParams.version
+        GetFixedParams().version
         , creationBlockHeight
         , creationTxHash.ToString()
         , pastEpochTopQualityCertView.ToString()
@@ -288,8 +289,80 @@ std::string CSidechain::ToString() const
     return str;
 }
 
+namespace
+{
+    // Fixed parameters interned by scId; entries are weak, so that a sidechain no longer referenced by any
+    // CSidechain object releases its verification keys.
+    std::mutex internedFixedParamsMutex;
+    std::map<uint256, std::weak_ptr<const Sidechain::ScFixedParameters>> internedFixedParams;
+    size_t internedFixedParamsPurgeSize = 64;
+}
+
+const Sidechain::ScFixedParameters& CSidechain::GetFixedParams() const
+{
+    static const Sidechain::ScFixedParameters nullFixedParams;
+    return fixedParamsPtr ? *fixedParamsPtr : nullFixedParams;
+}
+
+Sidechain::ScFixedParameters& CSidechain::ModifyFixedParams()
+{
+    // An interned object may be read by InternFixedParams of another thread through the weak reference,
+    // whatever its use count: it is never written, but copied
+    if (!fixedParamsPtr || fixedParamsPtr.use_count() > 1 || fixedParamsInterned)
+    {
+        fixedParamsPtr = std::make_shared<Sidechain::ScFixedParameters>(GetFixedParams());
+        fixedParamsInterned = false;
+    }
+
+    // The object is owned by this sidechain only, and it was not created const
+    return const_cast<Sidechain::ScFixedParameters&>(*fixedParamsPtr);
+}
+
+void CSidechain::SetFixedParams(const Sidechain::ScFixedParameters& params)
+{
+    fixedParamsPtr = std::make_shared<Sidechain::ScFixedParameters>(params);
+    fixedParamsInterned = false;
+}
+
+/**
+ * @brief Makes this object share its fixed parameters with the other objects interned for the same
+ * sidechain, provided they are equal, so that all the copies read from the database keep a single
+ * instance of the verification keys.
+ *
+ * @param scId the id of the sidechain this object represents
+ */
+void CSidechain::InternFixedParams(const uint256& scId)
+{
+    if (!fixedParamsPtr)
+        return;
+
+    std::lock_guard<std::mutex> lock(internedFixedParamsMutex);
+    fixedParamsInterned = true;
+
+    std::weak_ptr<const Sidechain::ScFixedParameters>& interned = internedFixedParams[scId];
+    std::shared_ptr<const Sidechain::ScFixedParameters> internedPtr = interned.lock();
+    if (internedPtr && (internedPtr == fixedParamsPtr || *internedPtr == *fixedParamsPtr))
+    {
+        fixedParamsPtr = internedPtr;
+        return;
+    }
+    interned = fixedParamsPtr;
+
+    if (internedFixedParams.size() >= internedFixedParamsPurgeSize)
+    {
+        for (auto it = internedFixedParams.begin(); it != internedFixedParams.end();)
+        {
+            if (it->second.expired())
+                it = internedFixedParams.erase(it);
+            else
+                ++it;
+        }
+        internedFixedParamsPurgeSize = std::max<size_t>(64, 2 * internedFixedParams.size());
+    }
+}
+
 size_t CSidechain::DynamicMemoryUsage() const {
-    return memusage::DynamicUsage(mImmatureAmounts) + memusage::DynamicUsage(scFees);
+    return mImmatureAmounts.DynamicMemoryUsage() + scFees.DynamicMemoryUsage();
 }
 
 size_t CSidechainEvents::DynamicMemoryUsage() const {
@@ -632,8 +705,8 @@ bool Sidechain::checkCertSemanticValidity(const CScCertificate& cert, CValidatio
 
 bool Sidechain::checkCertCustomFields(const CSidechain& sidechain, const CScCertificate& cert)
 {
-    const std::vector<FieldElementCertificateFieldConfig>& vCfeCfg = sidechain.fixedParams.vFieldElementCertificateFieldConfig;
-    const std::vector<BitVectorCertificateFieldConfig>& vCmtCfg = sidechain.fixedParams.vBitVectorCertificateFieldConfig;
+    const std::vector<FieldElementCertificateFieldConfig>& vCfeCfg = sidechain.GetFixedParams().vFieldElementCertificateFieldConfig;
+    const std::vector<BitVectorCertificateFieldConfig>& vCmtCfg = sidechain.GetFixedParams().vBitVectorCertificateFieldConfig;
 
     const std::vector<FieldElementCertificateField>& vCfe = cert.vFieldElementCertificateField;
     const std::vector<BitVectorCertificateField>& vCmt = cert.vBitVectorCertificateField;
@@ -648,7 +721,7 @@ bool Sidechain::checkCertCustomFields(const CSidechain& sidechain, const CScCert
     for (int i = 0; i < vCfe.size(); i++)
     {
         const FieldElementCertificateField& fe = vCfe.at(i);
-        if (!fe.IsValid(vCfeCfg.at(i), sidechain.fixedParams.version))
+        if (!fe.IsValid(vCfeCfg.at(i), sidechain.GetFixedParams().version))
         {
             LogPrint("sc", "%s():%d - invalid custom field at pos %d\n", __func__, __LINE__, i);
             return false;
@@ -658,7 +731,7 @@ bool Sidechain::checkCertCustomFields(const CSidechain& sidechain, const CScCert
     for (int i = 0; i < vCmt.size(); i++)
     {
         const BitVectorCertificateField& cmt = vCmt.at(i);
-        if (!cmt.IsValid(vCmtCfg.at(i), sidechain.fixedParams.version))
+        if (!cmt.IsValid(vCmtCfg.at(i), sidechain.GetFixedParams().version))
         {
             LogPrint("sc", "%s():%d - invalid compr mkl tree field at pos %d\n", __func__, __LINE__, i);
             return false;
@@ -705,7 +778,7 @@ int CSidechain::getMaxSizeOfScFeesContainers()
     if (maxSizeOfScFeesContainers == -1) {
         const int numBlocks = getNumBlocksForScFeeCheck();
         if (!isNonCeasing()) {
-            const int epochLength = fixedParams.withdrawalEpochLength;
+            const int epochLength = GetFixedParams().withdrawalEpochLength;
             assert(epochLength > 0);
             maxSizeOfScFeesContainers = (numBlocks + epochLength - 1) / epochLength;
             // CSidechain::getNumBlocksForScFeeCheck() may return 0 for regtest...
@@ -737,14 +810,12 @@ void CSidechain::InitScFees()
         LogPrint("sc", "%s():%d - maxSizeOfScFeesContainers set to %d\n", __func__, __LINE__, maxSizeOfScFeesContainers);
 
         assert(scFees.empty());
+        scFees.reserve(maxSizeOfScFeesContainers);
 
-        if (!isNonCeasing()) {
-            scFees.emplace_back(new Sidechain::ScFeeData(lastTopQualityCertView.forwardTransferScFee,
-                                lastTopQualityCertView.mainchainBackwardTransferRequestScFee));
-        } else {
-            scFees.emplace_back(new Sidechain::ScFeeData_v2(lastTopQualityCertView.forwardTransferScFee,
-                                lastTopQualityCertView.mainchainBackwardTransferRequestScFee, lastInclusionHeight));
-        }
+        // ceasing sidechains do not track the submission height
+        const int submissionHeight = isNonCeasing() ? lastInclusionHeight : -1;
+        scFees.push_back(Sidechain::ScFeeData_v2(lastTopQualityCertView.forwardTransferScFee,
+                         lastTopQualityCertView.mainchainBackwardTransferRequestScFee, submissionHeight));
     }
 }
 
@@ -761,58 +832,41 @@ void CSidechain::UpdateScFees(const CScCertificateView& certView, int blockHeigh
 
     // Ceasable sidechain
     if (!isNonCeasing()) {
-        scFees.emplace_back(new Sidechain::ScFeeData(ftScFee, mbtrScFee));
-
         // remove from the front as many elements are needed to be within the circular buffer size
         // --
         // usually this is just one element, but in regtest a node can set the max size via a startup option
         // therefore such size might be lesser than scFee size after a node restart
         const size_t max_size { static_cast<size_t>(maxSizeOfScFeesContainers) };
-        while (scFees.size() > max_size)
+        while (scFees.size() >= max_size)
         {
-            const auto& entry = scFees.front();
             LogPrint("sc", "%s():%d - popping %s from list, as scFees maxsize has been reached\n",
-                __func__, __LINE__, entry->ToString());
+                __func__, __LINE__, scFees.front().ScFeeData::ToString());
             scFees.pop_front();
         }
+
+        scFees.push_back(Sidechain::ScFeeData_v2(ftScFee, mbtrScFee, -1));
     }
     // Non-ceasable sidechain
     else {
-        auto scFeeIt = std::find_if(scFees.begin(), scFees.end(),
-            [&blockHeight](const std::shared_ptr<Sidechain::ScFeeData> & scFeeElem) {
-                const std::shared_ptr<Sidechain::ScFeeData_v2> casted_entry = std::dynamic_pointer_cast<Sidechain::ScFeeData_v2>(scFeeElem);
-                assert(casted_entry);
-                return casted_entry->submissionHeight == blockHeight;
-            });
-
-        // We have not found a scFeeData for the current height, so we add a new one and perform all the checks
-        // on the container size / element age
-        if (scFeeIt == scFees.end()) {
-            scFees.emplace_back(new Sidechain::ScFeeData_v2(ftScFee, mbtrScFee, blockHeight));
-
-            // As for ceasable sidechains
-            const size_t max_size { static_cast<size_t>(maxSizeOfScFeesContainers) };
-
-            // Also purge all elements submitted within a block that now are too old to be considered
+        // Entries are pushed in order of submission height, so the entry for the current height, if any, is the last one
+        if (scFees.empty() || scFees.back().submissionHeight != blockHeight) {
+            // Purge all elements submitted within a block that now are too old to be considered, which are the oldest ones
             const auto threshold{blockHeight - this->maxSizeOfScFeesContainers};
-            scFees.remove_if([threshold](std::shared_ptr<Sidechain::ScFeeData> entry) {
-                const std::shared_ptr<Sidechain::ScFeeData_v2> casted_entry = std::dynamic_pointer_cast<Sidechain::ScFeeData_v2>(entry);
-                assert(casted_entry);
-                const bool testCondition = (casted_entry->submissionHeight <= threshold);
-                if (testCondition)
-                    LogPrint("sc", "%s():%d - popping %s from list, as entry is too old (threshold height was %d)\n",
-                        __func__, __LINE__, casted_entry->ToString(), threshold);
-                return testCondition;
-            });
+            while (!scFees.empty() && scFees.front().submissionHeight <= threshold)
+            {
+                LogPrint("sc", "%s():%d - popping %s from list, as entry is too old (threshold height was %d)\n",
+                    __func__, __LINE__, scFees.front().ToString(), threshold);
+                scFees.pop_front();
+            }
 
+            // We have not found a scFeeData for the current height, so we add a new one
+            scFees.push_back(Sidechain::ScFeeData_v2(ftScFee, mbtrScFee, blockHeight));
         }
         // On the other hand, if we found a scFeeData element for the current height, we just update it with lower
         // ft and/or mbtr fee rates. All the checks on the container size and element age have been performed
         // at the moment of the element insertion, hence their are not required here
         else {
-            auto scFeeEntry = scFeeIt->get();
-            scFeeEntry->forwardTxScFee = std::min(scFeeEntry->forwardTxScFee, ftScFee);
-            scFeeEntry->mbtrTxScFee    = std::min(scFeeEntry->mbtrTxScFee, mbtrScFee);
+            scFees.LowerBackFees(ftScFee, mbtrScFee);
         }
 
     }
@@ -821,20 +875,13 @@ void CSidechain::UpdateScFees(const CScCertificateView& certView, int blockHeigh
 void CSidechain::DumpScFees() const
 {
     for (const auto& entry : scFees) {
-        std::cout << entry->ToString() << std::endl;
+        std::cout << (isNonCeasing() ? entry.ToString() : entry.ScFeeData::ToString()) << std::endl;
     }
 }
 
 CAmount CSidechain::GetMinFtScFee() const
 {
-    assert(!scFees.empty());
-
-    CAmount minScFee = std::min_element(
-        scFees.begin(), scFees.end(),
-        [] (const std::shared_ptr<Sidechain::ScFeeData> &a, const std::shared_ptr<Sidechain::ScFeeData> &b) {
-            return a->forwardTxScFee < b->forwardTxScFee;
-        }
-    )->get()->forwardTxScFee;
+    CAmount minScFee = scFees.GetMinFtScFee();
 
     LogPrint("sc", "%s():%d - returning min=%lld\n", __func__, __LINE__, minScFee);
     return minScFee;
@@ -842,14 +889,7 @@ CAmount CSidechain::GetMinFtScFee() const
 
 CAmount CSidechain::GetMinMbtrScFee() const
 {
-    assert(!scFees.empty());
-
-    CAmount minScFee = std::min_element(
-        scFees.begin(), scFees.end(),
-        [] (const std::shared_ptr<Sidechain::ScFeeData> &a, const std::shared_ptr<Sidechain::ScFeeData> &b) {
-            return a->mbtrTxScFee < b->mbtrTxScFee;
-        }
-    )->get()->mbtrTxScFee;
+    CAmount minScFee = scFees.GetMinMbtrScFee();
 
     LogPrint("sc", "%s():%d - returning min=%lld\n", __func__, __LINE__, minScFee);
     return minScFee;
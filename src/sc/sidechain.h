@@ -3,6 +3,8 @@
 
 #include "amount.h"
 #include "sc/sidechaintypes.h"
+#include "sc/scfeesbuffer.h"
+#include "sc/immatureamounts.h"
 #include <primitives/certificate.h>
 
 class CValidationState;
@@ -76,7 +78,7 @@ public:
              lastTopQualityCertQuality == CScCertificate::QUALITY_NULL        &&
              lastTopQualityCertBwtAmount == 0                                 &&
              balance == 0                                                     &&
-             fixedParams.IsNull()                                             &&
+             GetFixedParams().IsNull()                                        &&
              mImmatureAmounts.empty()                                         &&
              scFees.empty());
     }
@@ -102,19 +104,24 @@ public:
     // total amount given by sum(fw transfer)-sum(bkw transfer)
     CAmount balance;
 
-    // creation data
-    Sidechain::ScFixedParameters fixedParams;
+    // creation data, immutable once the sidechain is created and shared among all the copies of this object
+    const Sidechain::ScFixedParameters& GetFixedParams() const;
+    // copies the creation data first if it is shared with other objects
+    Sidechain::ScFixedParameters& ModifyFixedParams();
+    void SetFixedParams(const Sidechain::ScFixedParameters& params);
+    // share the creation data with the other objects interned for the same sidechain
+    void InternFixedParams(const uint256& scId);
 
     // immature amounts
     // key   = height at which amount will be considered as mature and will be part of the sc balance
     // value = the immature amount
-    std::map<int, CAmount> mImmatureAmounts;
+    Sidechain::ImmatureAmountsMap mImmatureAmounts;
 
     // memory only
     int maxSizeOfScFeesContainers;
     // the last ftScFee and mbtrScFee values, as set by the active certificates
     // it behaves like a circular buffer once the max size is reached
-    std::list<std::shared_ptr<Sidechain::ScFeeData>> scFees;
+    Sidechain::ScFeesBuffer scFees;
 
     // compute the max size of the sc fee list
     int getMaxSizeOfScFeesContainers();
@@ -165,7 +172,16 @@ public:
         READWRITE(lastTopQualityCertQuality);
         READWRITE(lastTopQualityCertBwtAmount);
         READWRITE(balance);
-        READWRITE(fixedParams);
+        if (ser_action.ForRead())
+        {
+            Sidechain::ScFixedParameters params;
+            READWRITE(params);
+            SetFixedParams(params);
+        }
+        else
+        {
+            READWRITE(REF(GetFixedParams()));
+        }
         READWRITE(mImmatureAmounts);
 
         if (ser_action.ForRead())
@@ -173,13 +189,15 @@ public:
             maxSizeOfScFeesContainers = getMaxSizeOfScFeesContainers();
         }
 
+        scFees.SerReadWrite(s, isNonCeasing(), nType, nVersion, ser_action);
+        if (ser_action.ForRead())
+        {
+            scFees.reserve(maxSizeOfScFeesContainers);
+        }
+
         if (isNonCeasing()) {
-            READWRITE_POLYMORPHIC(scFees, Sidechain::ScFeeData, Sidechain::ScFeeData_v2);
             READWRITE(VARINT(lastInclusionHeight));
         }
-        else {
-            READWRITE_POLYMORPHIC(scFees, Sidechain::ScFeeData, Sidechain::ScFeeData);
-        }
     }
 
     inline bool operator==(const CSidechain& rhs) const
@@ -193,7 +211,7 @@ public:
                (this->lastTopQualityCertQuality                  == rhs.lastTopQualityCertQuality)         &&
                (this->lastTopQualityCertBwtAmount                == rhs.lastTopQualityCertBwtAmount)       &&
                (this->balance                                    == rhs.balance)                           &&
-               (this->fixedParams                                == rhs.fixedParams)                       &&
+               (this->GetFixedParams()                           == rhs.GetFixedParams())                  &&
                (this->mImmatureAmounts                           == rhs.mImmatureAmounts)                  &&
                (this->scFees                                     == rhs.scFees);
     }
@@ -220,7 +238,7 @@ public:
     }
 
     bool isNonCeasing() const {
-        return isNonCeasingSidechain(fixedParams.version, fixedParams.withdrawalEpochLength);
+        return isNonCeasingSidechain(GetFixedParams().version, GetFixedParams().withdrawalEpochLength);
     }
 
     void InitScFees();
@@ -232,6 +250,11 @@ public:
 
     // Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
+
+private:
+    std::shared_ptr<const Sidechain::ScFixedParameters> fixedParamsPtr;
+    // fixedParamsPtr may be referenced by internedFixedParams, so it is copied before being modified
+    bool fixedParamsInterned = false;
 };
 
 namespace Sidechain {
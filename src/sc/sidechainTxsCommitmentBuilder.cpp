@@ -12,6 +12,7 @@
 #ifdef BITCOIN_TX
 bool SidechainTxsCommitmentBuilder::add(const CTransaction& tx) { return true; }
 bool SidechainTxsCommitmentBuilder::add(const CScCertificate& cert, const CCoinsViewCache& view) { return true; }
+bool SidechainTxsCommitmentBuilder::add(const CScCertificate& cert, const Sidechain::ScFixedParameters& scFixedParams) { return true; }
 uint256 SidechainTxsCommitmentBuilder::getCommitment() { return uint256(); }
 SidechainTxsCommitmentBuilder::SidechainTxsCommitmentBuilder(): _cmt(nullptr) {}
 SidechainTxsCommitmentBuilder::~SidechainTxsCommitmentBuilder(){}
@@ -272,8 +273,9 @@ bool SidechainTxsCommitmentBuilder::add_cert(const CScCertificate& cert, const S
     std::vector<wrappedFieldPtr> vSptr;
     for (i = 0; i < cert.vFieldElementCertificateField.size(); i++)
     {
-        FieldElementCertificateField entry = cert.vFieldElementCertificateField.at(i);
-        CFieldElement fe{entry.GetFieldElement(scFixedParams.vFieldElementCertificateFieldConfig.at(i), scFixedParams.version)};
+        // Using the field element cached by the certificate field, its deserialization is kept for next usages
+        const FieldElementCertificateField& entry = cert.vFieldElementCertificateField.at(i);
+        const CFieldElement& fe = entry.GetFieldElement(scFixedParams.vFieldElementCertificateFieldConfig.at(i), scFixedParams.version);
         wrappedFieldPtr sptrFe = fe.GetFieldElement();
         custom_fields[i] = sptrFe.get();
         vSptr.push_back(sptrFe);
@@ -281,8 +283,8 @@ bool SidechainTxsCommitmentBuilder::add_cert(const CScCertificate& cert, const S
 
     for (int j = 0; j < cert.vBitVectorCertificateField.size(); j++)
     {
-        BitVectorCertificateField entry = cert.vBitVectorCertificateField.at(j);
-        CFieldElement fe{entry.GetFieldElement(scFixedParams.vBitVectorCertificateFieldConfig.at(j), scFixedParams.version)};
+        const BitVectorCertificateField& entry = cert.vBitVectorCertificateField.at(j);
+        const CFieldElement& fe = entry.GetFieldElement(scFixedParams.vBitVectorCertificateFieldConfig.at(j), scFixedParams.version);
         wrappedFieldPtr sptrFe = fe.GetFieldElement();
         custom_fields[i+j] = sptrFe.get();
         vSptr.push_back(sptrFe);
@@ -389,15 +391,20 @@ bool SidechainTxsCommitmentBuilder::add(const CTransaction& tx)
 }
 
 bool SidechainTxsCommitmentBuilder::add(const CScCertificate& cert, const CCoinsViewCache& view)
+{
+    CSidechain sidechain;
+    view.GetSidechain(cert.GetScId(), sidechain);
+
+    return add(cert, sidechain.GetFixedParams());
+}
+
+bool SidechainTxsCommitmentBuilder::add(const CScCertificate& cert, const Sidechain::ScFixedParameters& scFixedParams)
 {
     assert(_cmt != nullptr);
 
     CctpErrorCode ret_code = CctpErrorCode::OK;
 
-    CSidechain sidechain;
-    view.GetSidechain(cert.GetScId(), sidechain);
-
-    if (!add_cert(cert, sidechain.fixedParams, ret_code))
+    if (!add_cert(cert, scFixedParams, ret_code))
     {
         LogPrintf("%s():%d Error adding cert[%s], ret_code[%d]\n", __func__, __LINE__,
             cert.GetHash().ToString(), ret_code);
@@ -432,3 +439,155 @@ const uint256& SidechainTxsCommitmentBuilder::getEmptyCommitment()
     return value;
 }
 #endif
+
+IncrementalSidechainTxsCommitmentBuilder::IncrementalSidechainTxsCommitmentBuilder():
+    builder(new SidechainTxsCommitmentBuilder()), position(0), dirty(false), reused(0), commitmentValid(false)
+{
+}
+
+/**
+ * @brief Starts building the commitment of a new block template.
+ * 
+ * @param prevBlockHash The hash of the block the template is built on
+ */
+void IncrementalSidechainTxsCommitmentBuilder::start(const uint256& prevBlockHash)
+{
+    if (prevBlockHash != tipHash)
+    {
+        // The contributions of the previous template are most likely included in the new tip.
+        builder.reset(new SidechainTxsCommitmentBuilder());
+        contributions.clear();
+        dirty = false;
+        commitmentValid = false;
+        tipHash = prevBlockHash;
+    }
+
+    position = 0;
+    reused = 0;
+}
+
+bool IncrementalSidechainTxsCommitmentBuilder::add(const CTransaction& tx)
+{
+    if (!tx.IsScVersion())
+        return true;
+
+    if (tryReuse(tx.GetHash()))
+        return true;
+
+    Contribution contribution;
+    contribution.tx = std::make_shared<const CTransaction>(tx);
+    contribution.hash = tx.GetHash();
+
+    return append(std::move(contribution));
+}
+
+bool IncrementalSidechainTxsCommitmentBuilder::add(const CScCertificate& cert, const CCoinsViewCache& view)
+{
+    if (tryReuse(cert.GetHash()))
+        return true;
+
+    CSidechain sidechain;
+    view.GetSidechain(cert.GetScId(), sidechain);
+
+    Contribution contribution;
+    contribution.cert = std::make_shared<const CScCertificate>(cert);
+    contribution.scFixedParams = sidechain.GetFixedParams();
+    contribution.hash = cert.GetHash();
+
+    return append(std::move(contribution));
+}
+
+/**
+ * @brief Removes the last added transaction or certificate from the current template
+ * (e.g. because it has been rejected by later checks).
+ * 
+ * @param hash The hash of the transaction or certificate to be removed
+ */
+void IncrementalSidechainTxsCommitmentBuilder::rewind(const uint256& hash)
+{
+    if (position > 0 && contributions.at(position - 1).hash == hash)
+    {
+        position--;
+    }
+}
+
+uint256 IncrementalSidechainTxsCommitmentBuilder::getCommitment()
+{
+    if (dirty || position < contributions.size())
+    {
+        rebuild();
+    }
+
+    if (!commitmentValid)
+    {
+        commitment = builder->getCommitment();
+        commitmentValid = true;
+    }
+
+    return commitment;
+}
+
+/**
+ * @brief Checks if the next contribution of the previous template can be reused as is.
+ * 
+ * @param hash The hash of the transaction or certificate being added
+ * @return true If the contribution is already in the commitment tree at the expected position.
+ */
+bool IncrementalSidechainTxsCommitmentBuilder::tryReuse(const uint256& hash)
+{
+    if (dirty || position >= contributions.size() || contributions.at(position).hash != hash)
+    {
+        return false;
+    }
+
+    position++;
+    reused++;
+    return true;
+}
+
+bool IncrementalSidechainTxsCommitmentBuilder::append(Contribution&& contribution)
+{
+    if (dirty || position < contributions.size())
+    {
+        rebuild();
+    }
+
+    commitmentValid = false;
+
+    bool result = contribution.tx ? builder->add(*contribution.tx) : builder->add(*contribution.cert, contribution.scFixedParams);
+
+    if (!result)
+    {
+        // Leaves of a failed contribution can't be removed, the tree will be rebuilt on next usage.
+        dirty = true;
+        return false;
+    }
+
+    contributions.push_back(std::move(contribution));
+    position++;
+    return true;
+}
+
+/**
+ * @brief Rebuilds the commitment tree with the contributions of the current template only.
+ */
+void IncrementalSidechainTxsCommitmentBuilder::rebuild()
+{
+    LogPrint("sc", "%s():%d - rebuilding commitment tree: %d contributions kept, %d discarded\n",
+        __func__, __LINE__, position, contributions.size() - position);
+
+    contributions.erase(contributions.begin() + position, contributions.end());
+
+    builder.reset(new SidechainTxsCommitmentBuilder());
+
+    for (const Contribution& contribution : contributions)
+    {
+        bool result = contribution.tx ? builder->add(*contribution.tx) : builder->add(*contribution.cert, contribution.scFixedParams);
+
+        // Every contribution was already successfully added to a tree.
+        assert(result);
+    }
+
+    dirty = false;
+    commitmentValid = false;
+}
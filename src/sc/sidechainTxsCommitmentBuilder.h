@@ -4,6 +4,9 @@
 #include "coins.h"
 #include <sc/sidechaintypes.h>
 
+#include <memory>
+#include <vector>
+
 class CTransaction;
 class CScCertificate;
 class uint256;
@@ -25,6 +28,7 @@ public:
 
     bool add(const CTransaction& tx);
     bool add(const CScCertificate& cert, const CCoinsViewCache& view);
+    bool add(const CScCertificate& cert, const Sidechain::ScFixedParameters& scFixedParams);
     uint256 getCommitment();
 
     static const uint256& getEmptyCommitment();
@@ -43,4 +47,54 @@ private:
     bool add_cert(const CScCertificate& cert, Sidechain::ScFixedParameters scFixedParams, CctpErrorCode& ret_code);
 };
 
+/**
+ * @brief A commitment builder meant to be kept alive across block template refreshes.
+ * 
+ * The CCTP library does not allow removing leaves from a commitment tree, therefore this builder
+ * keeps track of the transactions and certificates added to its tree (in the order they were added).
+ * When a new block template is started, all the contributions that are added again in the same
+ * order are not hashed again: the tree is rebuilt only from the first contribution that differs
+ * from the previous template (or when the tip of the chain changes).
+ */
+class IncrementalSidechainTxsCommitmentBuilder
+{
+public:
+    IncrementalSidechainTxsCommitmentBuilder();
+    ~IncrementalSidechainTxsCommitmentBuilder() = default;
+
+    IncrementalSidechainTxsCommitmentBuilder(const IncrementalSidechainTxsCommitmentBuilder&) = delete;
+    IncrementalSidechainTxsCommitmentBuilder& operator=(const IncrementalSidechainTxsCommitmentBuilder&) = delete;
+
+    void start(const uint256& prevBlockHash);
+    bool add(const CTransaction& tx);
+    bool add(const CScCertificate& cert, const CCoinsViewCache& view);
+    void rewind(const uint256& hash);
+    uint256 getCommitment();
+
+    size_t getReusedContributions() const { return reused; }
+
+private:
+    struct Contribution
+    {
+        std::shared_ptr<const CTransaction> tx;                 /**< The transaction, if the contribution comes from a transaction. */
+        std::shared_ptr<const CScCertificate> cert;             /**< The certificate, if the contribution comes from a certificate. */
+        Sidechain::ScFixedParameters scFixedParams;             /**< The parameters of the sidechain the certificate refers to. */
+        uint256 hash;                                           /**< The hash of the transaction or certificate. */
+    };
+
+    bool tryReuse(const uint256& hash);
+    bool append(Contribution&& contribution);
+    void rebuild();
+
+    std::unique_ptr<SidechainTxsCommitmentBuilder> builder;     /**< The builder holding the commitment tree of all the contributions. */
+    std::vector<Contribution> contributions;                    /**< The contributions currently in the commitment tree, in insertion order. */
+    size_t position;                                            /**< The number of contributions belonging to the current block template. */
+    bool dirty;                                                 /**< Whether the commitment tree doesn't match the contributions of the current template. */
+    uint256 tipHash;                                            /**< The hash of the block the current template is built on. */
+    size_t reused;                                              /**< The number of contributions reused in the current template. */
+
+    uint256 commitment;                                         /**< The last computed commitment. */
+    bool commitmentValid;                                       /**< Whether the last computed commitment matches the commitment tree. */
+};
+
 #endif
\ No newline at end of file
@@ -203,7 +203,6 @@ bool SidechainTxsCommitmentGuard::add(const CTransaction& tx, bool autoRewind)
     // Restore CBS to a valid state if we were not able to add any of the FT / BWTR / CSW
     if (!addOK && autoRewind) {
         rewind(tx, addedFt, addedBwtr, addedCsw);
-        keepMapsClean();
     }
     
     return addOK;
@@ -222,48 +221,36 @@ bool SidechainTxsCommitmentGuard::add(const CScCertificate& cert)
     return true;
 }
 
-// Remove from the maps all the sidechains without entities
-void SidechainTxsCommitmentGuard::keepMapsClean() {
-    auto itA = cbs.cbsaMap.begin();
-    while (itA != cbs.cbsaMap.end()) {
-        if ((itA->second.bwtr == 0) && (itA->second.cert == 0) && (itA->second.ft == 0))
-            cbs.cbsaMap.erase(itA++);
-        else
-            ++itA;
-    }
-
-    auto itC = cbs.cbscMap.begin();
-    while (itC != cbs.cbscMap.end()) {
-        if (itC->second.csw == 0)
-            cbs.cbscMap.erase(itC++);
-        else
-            ++itC;
-    }
-}
-
 void SidechainTxsCommitmentGuard::rewind(const CTransaction& tx, const int addedFt, const int addedBwtr, const int addedCsw) {
     LogPrint("sc", "%s():%d Rewind scCommitmentGuard after failure %d FT, %d BWTR, %d CSW \n",
             __func__, __LINE__, addedFt, addedBwtr, addedCsw);
 
+    // The sidechains left without entities are removed from the maps, only the ones touched can be such
     for (unsigned int cswIdx = 0; cswIdx < addedCsw; ++cswIdx)
     {
         const CTxCeasedSidechainWithdrawalInput& ccin = tx.GetVcswCcIn().at(cswIdx);
-        CommitmentBuilderStatsCeasedCounter& counterRef = cbs.cbscMap[ccin.scId];
-        counterRef.csw--;
+        auto it = cbs.cbscMap.find(ccin.scId);
+        assert(it != cbs.cbscMap.end());
+        if (--it->second.csw == 0)
+            cbs.cbscMap.erase(it);
     }
 
     for (unsigned int bwtrIdx = 0; bwtrIdx < addedBwtr; ++bwtrIdx)
     {
         const CBwtRequestOut& ccout = tx.GetVBwtRequestOut().at(bwtrIdx);
-        CommitmentBuilderStatsAliveCounter& counterRef = cbs.cbsaMap[ccout.GetScId()];
-        counterRef.bwtr--;
+        auto it = cbs.cbsaMap.find(ccout.GetScId());
+        assert(it != cbs.cbsaMap.end());
+        if (--it->second.bwtr == 0)
+            cbs.eraseIfEmpty(it);
     }
 
     for (unsigned int fwtIdx = 0; fwtIdx < addedFt; ++fwtIdx)
     {
         const CTxForwardTransferOut& ccout = tx.GetVftCcOut().at(fwtIdx);
-        CommitmentBuilderStatsAliveCounter& counterRef = cbs.cbsaMap[ccout.GetScId()];
-        counterRef.ft--;
+        auto it = cbs.cbsaMap.find(ccout.GetScId());
+        assert(it != cbs.cbsaMap.end());
+        if (--it->second.ft == 0)
+            cbs.eraseIfEmpty(it);
     }
 }
 
@@ -271,16 +258,15 @@ void SidechainTxsCommitmentGuard::rewind(const CTransaction& tx) {
     LogPrint("sc", "%s():%d Rewind scCommitmentGuard after tx failure \n", __func__, __LINE__);
 
     rewind(tx, tx.GetVftCcOut().size(), tx.GetVBwtRequestOut().size(), tx.GetVcswCcIn().size());
-    keepMapsClean();
 }
 
 void SidechainTxsCommitmentGuard::rewind(const CScCertificate& cert) {
     LogPrint("sc", "%s():%d Rewind scCommitmentGuard after cert failure \n", __func__, __LINE__);
 
-    size_t bt_list_len = cert.GetVout().size() - cert.nFirstBwtPos;
-    CommitmentBuilderStatsAliveCounter& counterRef = cbs.cbsaMap[cert.GetScId()];
-    --counterRef.cert;
-    keepMapsClean();
+    auto it = cbs.cbsaMap.find(cert.GetScId());
+    assert(it != cbs.cbsaMap.end());
+    if (--it->second.cert == 0)
+        cbs.eraseIfEmpty(it);
 }
 
 
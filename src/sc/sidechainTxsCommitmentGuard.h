@@ -34,7 +34,6 @@ private:
     bool add_cert(const CScCertificate& cert);
 
     void rewind(const CTransaction& tx, const int failingFt, const int failingBwtr, const int failingCsw);
-    void keepMapsClean();
 
     // Keeping information separated to closely mimic CCTPlib structures
     struct CommitmentBuilderStatsAliveCounter {
@@ -46,8 +45,11 @@ private:
         uint32_t  csw = 0;
     };
     struct CommitmentBuilderStats {
-        std::map<uint256, CommitmentBuilderStatsAliveCounter>  cbsaMap;
-        std::map<uint256, CommitmentBuilderStatsCeasedCounter> cbscMap;
+        // Hash maps with the buckets for all the sidechains a tree can hold reserved up front, so that the add / rewind
+        // of each candidate of a block template costs a lookup and never a rehash. Rewinding erases just the
+        // counters it zeroes, as the maps must only hold the sidechains with entities.
+        std::unordered_map<uint256, CommitmentBuilderStatsAliveCounter, CCoinsKeyHasher>  cbsaMap;
+        std::unordered_map<uint256, CommitmentBuilderStatsCeasedCounter, CCoinsKeyHasher> cbscMap;
         // The following values MUST be aligned with those specified in CCTPlib!
         static const int   SC_LIMIT = 4096;
         static const int   FT_LIMIT = 4095;
@@ -56,6 +58,16 @@ private:
         static const int  CSW_LIMIT = 4095;
         static const int  BWT_LIMIT = 4095;
 
+        CommitmentBuilderStats() {
+            cbsaMap.reserve(SC_LIMIT);
+            cbscMap.reserve(SC_LIMIT);
+        }
+
+        void eraseIfEmpty(decltype(cbsaMap)::iterator it) {
+            if ((it->second.bwtr == 0) && (it->second.cert == 0) && (it->second.ft == 0))
+                cbsaMap.erase(it);
+        }
+
         bool checkAvailableSpaceAliveSC(const uint256& scid) {
             if ((cbsaMap.count(scid) == 0) && ((cbsaMap.size() + cbscMap.size()) >= SC_LIMIT)) {
                 LogPrint("sc", "%s():%d - scTxsCommitment building failed: too many sidechains, when adding scId[%s].\n",
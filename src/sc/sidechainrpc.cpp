@@ -223,6 +223,42 @@ bool AddScData(
     return true;
 }
 
+bool AddPackedBackwardTransfers(const std::string& inputString, std::vector<CBackwardTransferOut>& vBwt, std::string& error)
+{
+    static const size_t BWT_PACKED_SIZE = sizeof(CAmount) + sizeof(uint160);
+
+    std::vector<unsigned char> vBytes;
+    if (!AddScData(inputString, vBytes, 0, CheckSizeMode::CHECK_OFF, error))
+        return false;
+
+    if (vBytes.size() % BWT_PACKED_SIZE)
+    {
+        error = strprintf("Invalid length %d, must be a multiple of %d bytes", vBytes.size(), BWT_PACKED_SIZE);
+        return false;
+    }
+
+    const size_t nBwt = vBytes.size() / BWT_PACKED_SIZE;
+    vBwt.clear();
+    vBwt.reserve(nBwt);
+
+    CDataStream stream(vBytes, SER_NETWORK, PROTOCOL_VERSION);
+    for (size_t i = 0; i < nBwt; i++)
+    {
+        CBackwardTransferOut bwt;
+        stream >> bwt;
+
+        // this also rejects a legal value less than 1 ZAT, as AmountFromValue does for the json amounts
+        if (bwt.nValue <= 0 || !MoneyRange(bwt.nValue))
+        {
+            error = strprintf("Invalid amount %d of backward transfer %d, must be positive", bwt.nValue, i);
+            return false;
+        }
+        vBwt.push_back(bwt);
+    }
+
+    return true;
+}
+
 bool AddScData(const UniValue& intArray, std::vector<FieldElementCertificateFieldConfig>& vCfg)
 { 
     if (intArray.size() != 0)
@@ -880,6 +916,7 @@ void ScRpcCmd::init()
 
 void ScRpcCmd::addInputs()
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     std::vector<COutput> vAvailableCoins;
     std::vector<SelectedUTXO> vInputUtxo;
 
@@ -888,7 +925,7 @@ void ScRpcCmd::addInputs()
     const bool fIncludeCoinBase = !ForkManager::getInstance().mustCoinBaseBeShielded(chainActive.Height() + 1);
     const bool fIncludeCommunityFund = ForkManager::getInstance().canSendCommunityFundsToTransparentAddress(chainActive.Height() + 1);
 
-    pwalletMain->AvailableCoins(vAvailableCoins, fOnlyConfirmed, NULL, fIncludeZeroValue, fIncludeCoinBase, fIncludeCommunityFund);
+    pwallet->AvailableCoins(vAvailableCoins, fOnlyConfirmed, NULL, fIncludeZeroValue, fIncludeCoinBase, fIncludeCommunityFund);
 
     for (const auto& out: vAvailableCoins)
     {
@@ -987,6 +1024,7 @@ void ScRpcCmd::addInputs()
 
 void ScRpcCmd::addChange()
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     // fee must start from 0 when automatically calculated, and then its updated. It might also be set explicitly to 0
     CAmount change = _totalInputAmount - ( _totalOutputAmount + _fee);
 
@@ -1008,7 +1046,7 @@ void ScRpcCmd::addChange()
         }
         else
         {
-            CReserveKey keyChange(pwalletMain);
+            CReserveKey keyChange(pwallet);
             CPubKey vchPubKey;
 
             // bitcoin code has also KeepKey() in the CommitTransaction() for preventing the key reuse,
@@ -1062,8 +1100,12 @@ void ScRpcCmdCert::sign()
     {
         CScCertificate toEncode(_cert);
         rawcert = EncodeHexCert(toEncode);
-        LogPrint("sc", "      toEncode[%s]\n", toEncode.GetHash().ToString());
-        LogPrint("sc", "      toEncode: %s\n", toEncode.ToString());
+        // the arguments are evaluated anyway, and dumping thousands of backward transfers is not for free
+        if (LogAcceptCategory("sc"))
+        {
+            LogPrint("sc", "      toEncode[%s]\n", toEncode.GetHash().ToString());
+            LogPrint("sc", "      toEncode: %s\n", toEncode.ToString());
+        }
     }
     catch(...)
     {
@@ -1207,6 +1249,7 @@ bool ScRpcCmd::send()
 
 void ScRpcCmdCert::addBackwardTransfers()
 {
+    _cert.reserveOut(_cert.getVout().size() + _bwdParams.size());
     for (const auto& entry : _bwdParams)
     {
         CTxOut txout(entry._nAmount, entry._scriptPubKey);
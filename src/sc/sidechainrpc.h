@@ -16,6 +16,7 @@ class CTransactionBase;
 class CMutableTransaction;
 class CMutableTransactionBase;
 class CSidechain;
+class CBackwardTransferOut;
 
 namespace Sidechain
 {
@@ -37,6 +38,11 @@ bool AddCustomFieldElement(const std::string& inputString, std::vector<unsigned
 
 bool AddScData(const UniValue& intArray, std::vector<FieldElementCertificateFieldConfig>& vCfg);
 
+// Parses a packed list of backward transfers, the bulk alternative to the json array of {address, amount} objects:
+// the hex of the concatenated serializations of CBackwardTransferOut, that is 8 bytes of amount in zatoshi (little
+// endian) followed by the 20 bytes of the pubkey hash for each transfer, the same encoding they have in a certificate.
+bool AddPackedBackwardTransfers(const std::string& inputString, std::vector<CBackwardTransferOut>& vBwt, std::string& error);
+
 // used when creating a raw transaction with cc outputs
 bool AddCeasedSidechainWithdrawalInputs(UniValue& csws, CMutableTransaction& rawTx, std::string& error);
 bool AddSidechainCreationOutputs(UniValue& sc_crs, CMutableTransaction& rawTx, std::string& error);
@@ -136,10 +136,17 @@ std::string CZendooCctpObject::GetHexRepr() const
 }
 
 ///////////////////////////////// Field types //////////////////////////////////
+std::atomic<uint64_t> CFieldElement::deserializationsCount{0};
+
 #ifdef BITCOIN_TX
 void CFieldPtrDeleter::operator()(field_t* p) const {};
+// no field is ever deserialized here, copies are those of the byteVector
+CFieldElement::CFieldElement(const CFieldElement& obj): CZendooCctpObject(obj) {};
+CFieldElement& CFieldElement::operator=(const CFieldElement& obj) { CZendooCctpObject::operator=(obj); return *this; };
 CFieldElement::CFieldElement(const std::vector<unsigned char>& byteArrayIn) {};
 void CFieldElement::SetByteArray(const std::vector<unsigned char>& byteArrayIn) {};
+void CFieldElement::SetNull() { CZendooCctpObject::SetNull(); };
+void CFieldElement::ResetFieldData() {};
 CFieldElement::CFieldElement(const uint256& value) {};
 CFieldElement::CFieldElement(const wrappedFieldPtr& wrappedField) {};
 uint256 CFieldElement::GetLegacyHash() const { return uint256(); };
@@ -154,6 +161,34 @@ void CFieldPtrDeleter::operator()(field_t* p) const
     p = nullptr;
 }
 
+CFieldElement::CFieldElement(const CFieldElement& obj): CZendooCctpObject()
+{
+    std::lock_guard<std::mutex> lk(obj._mutex);
+
+    // the (lazily) deserialized field is shared, so that copies do not deserialize it again
+    byteVector = obj.byteVector;
+    fieldData = obj.fieldData;
+    deserializationFailed = obj.deserializationFailed;
+}
+
+CFieldElement& CFieldElement::operator=(const CFieldElement& obj)
+{
+    if (this != &obj)
+    {
+        // lock both mutexes without deadlock
+        std::lock(_mutex, obj._mutex);
+
+        // make sure both already-locked mutexes are unlocked at the end of scope
+        std::lock_guard<std::mutex> lhs_lk(_mutex, std::adopt_lock);
+        std::lock_guard<std::mutex> rhs_lk(obj._mutex, std::adopt_lock);
+
+        byteVector = obj.byteVector;
+        fieldData = obj.fieldData;
+        deserializationFailed = obj.deserializationFailed;
+    }
+    return *this;
+}
+
 CFieldElement::CFieldElement(const std::vector<unsigned char>& byteArrayIn): CZendooCctpObject(byteArrayIn)
 {
     assert(byteArrayIn.size() == this->ByteSize());
@@ -163,8 +198,25 @@ CFieldElement::CFieldElement(const std::vector<unsigned char>& byteArrayIn): CZe
 void CFieldElement::SetByteArray(const std::vector<unsigned char>& byteArrayIn)
 {
     assert(byteArrayIn.size() == this->ByteSize());
+    std::lock_guard<std::mutex> lk(_mutex);
     this->byteVector = byteArrayIn;
     fieldData.reset();
+    deserializationFailed = false;
+}
+
+void CFieldElement::SetNull()
+{
+    std::lock_guard<std::mutex> lk(_mutex);
+    byteVector.resize(0);
+    fieldData.reset();
+    deserializationFailed = false;
+}
+
+void CFieldElement::ResetFieldData()
+{
+    std::lock_guard<std::mutex> lk(_mutex);
+    fieldData.reset();
+    deserializationFailed = false;
 }
 
 CFieldElement::CFieldElement(const uint256& value)
@@ -205,14 +257,16 @@ wrappedFieldPtr CFieldElement::GetFieldElement() const
 
     std::lock_guard<std::mutex> lk(_mutex);
 
-    if (fieldData == nullptr)
+    if (fieldData == nullptr && !deserializationFailed)
     {
         CctpErrorCode code;
+        deserializationsCount++;
         wrappedFieldPtr ret{zendoo_deserialize_field(&this->byteVector[0], &code), theFieldPtrDeleter};
         if (code != CctpErrorCode::OK)
         {
             LogPrintf("%s():%d - could not deserialize: error code[0x%x]\n", __func__, __LINE__, code);
             assert(fieldData == nullptr);
+            deserializationFailed = true;
             return fieldData;
         }
         fieldData.swap(ret);
@@ -551,26 +605,7 @@ BitVectorCertificateFieldConfig::BitVectorCertificateFieldConfig(int32_t bitVect
 ////////////////////////////// Custom Field types //////////////////////////////
 //----------------------------------------------------------------------------------------
 FieldElementCertificateField::FieldElementCertificateField(const std::vector<unsigned char>& rawBytes)
-    :CustomCertificateField(rawBytes), pReferenceCfg{nullptr} {}
-
-FieldElementCertificateField::FieldElementCertificateField(const FieldElementCertificateField& rhs)
-    :CustomCertificateField{}, pReferenceCfg{nullptr}
-{
-    *this = rhs;
-}
-
-FieldElementCertificateField& FieldElementCertificateField::operator=(const FieldElementCertificateField& rhs)
-{
-    state = rhs.state;
-    fieldElement =  rhs.fieldElement;
-    *const_cast<std::vector<unsigned char>*>(&vRawData) = rhs.vRawData;
-
-    if (rhs.pReferenceCfg != nullptr)
-        this->pReferenceCfg = new FieldElementCertificateFieldConfig(*rhs.pReferenceCfg);
-    else
-        this->pReferenceCfg = nullptr;
-    return *this;
-}
+    :CustomCertificateField(rawBytes) {}
 
 bool FieldElementCertificateField::IsValid(const FieldElementCertificateFieldConfig& cfg, uint8_t sidechainVersion) const
 {
@@ -579,22 +614,12 @@ bool FieldElementCertificateField::IsValid(const FieldElementCertificateFieldCon
 
 const CFieldElement& FieldElementCertificateField::GetFieldElement(const FieldElementCertificateFieldConfig& cfg, uint8_t sidechainVersion) const
 {
-    if (state != VALIDATION_STATE::NOT_INITIALIZED)
-    {
-        assert(pReferenceCfg != nullptr);
-        if (*pReferenceCfg == cfg)
-        {
-            return fieldElement;
-        }
-
-        // revalidated with new cfg
-        delete this->pReferenceCfg;
-        this->pReferenceCfg = nullptr;
-    }
+    return GetValidatedFieldElement(cfg, sidechainVersion);
+}
 
-    state = VALIDATION_STATE::INVALID;
-    this->fieldElement = CFieldElement{};
-    this->pReferenceCfg = new FieldElementCertificateFieldConfig(cfg);
+CFieldElement FieldElementCertificateField::Validate(const FieldElementCertificateFieldConfig& cfg, uint8_t sidechainVersion) const
+{
+    CFieldElement fieldElement;
 
     int rem = 0;
 
@@ -649,10 +674,7 @@ const CFieldElement& FieldElementCertificateField::GetFieldElement(const FieldEl
     }
 
     fieldElement.SetByteArray(extendedRawData);
-    if (fieldElement.IsValid())
-    {
-        state = VALIDATION_STATE::VALID;
-    } else
+    if (!fieldElement.IsValid())
     {
         fieldElement = CFieldElement{};
     }
@@ -662,26 +684,7 @@ const CFieldElement& FieldElementCertificateField::GetFieldElement(const FieldEl
 
 //----------------------------------------------------------------------------------
 BitVectorCertificateField::BitVectorCertificateField(const std::vector<unsigned char>& rawBytes)
-    :CustomCertificateField(rawBytes), pReferenceCfg{nullptr} {}
-
-BitVectorCertificateField::BitVectorCertificateField(const BitVectorCertificateField& rhs)
-    :CustomCertificateField(), pReferenceCfg{nullptr}
-{
-    *this = rhs;
-}
-
-BitVectorCertificateField& BitVectorCertificateField::operator=(const BitVectorCertificateField& rhs)
-{
-    state = rhs.state;
-    fieldElement =  rhs.fieldElement;
-    *const_cast<std::vector<unsigned char>*>(&vRawData) = rhs.vRawData;
-
-    if (rhs.pReferenceCfg != nullptr)
-        this->pReferenceCfg = new BitVectorCertificateFieldConfig(*rhs.pReferenceCfg);
-    else
-        this->pReferenceCfg = nullptr;
-    return *this;
-}
+    :CustomCertificateField(rawBytes) {}
 
 bool BitVectorCertificateField::IsValid(const BitVectorCertificateFieldConfig& cfg, uint8_t sidechainVersion) const
 {
@@ -690,26 +693,14 @@ bool BitVectorCertificateField::IsValid(const BitVectorCertificateFieldConfig& c
 
 const CFieldElement& BitVectorCertificateField::GetFieldElement(const BitVectorCertificateFieldConfig& cfg, uint8_t sidechainVersion) const
 {
-    if (state != VALIDATION_STATE::NOT_INITIALIZED)
-    {
-        assert(pReferenceCfg != nullptr);
-        if (*pReferenceCfg == cfg)
-        {
-            return fieldElement;
-        }
-
-        // revalidated with new cfg
-        delete this->pReferenceCfg;
-        this->pReferenceCfg = nullptr;
-    }
-
-    state = VALIDATION_STATE::INVALID;
-    this->pReferenceCfg = new BitVectorCertificateFieldConfig(cfg);
+    return GetValidatedFieldElement(cfg, sidechainVersion);
+}
 
+CFieldElement BitVectorCertificateField::Validate(const BitVectorCertificateFieldConfig& cfg, uint8_t sidechainVersion) const
+{
     if(vRawData.size() > cfg.getMaxCompressedSizeBytes()) {
         // this is invalid and fieldElement is Null 
-        this->fieldElement = CFieldElement{};
-        return fieldElement;
+        return CFieldElement{};
     }
 
     // Reconstruct MerkleTree from the compressed raw data of vRawField
@@ -726,14 +717,10 @@ const CFieldElement& BitVectorCertificateField::GetFieldElement(const BitVectorC
     {
         LogPrint("sc", "%s():%d - ERROR(%d): could not get merkle root field el from compr bit vector of size %d, exp uncompr size %d (rem=%d)\n",
             __func__, __LINE__, (int)ret_code, vRawData.size(), nBitVectorSizeBytes, rem);
-        this->fieldElement = CFieldElement{};
-        return fieldElement;
+        return CFieldElement{};
     }
     //dumpFe(fe, "bv fe");
-    this->fieldElement = CFieldElement{wrappedFieldPtr{fe, CFieldPtrDeleter{}}};
-    state = VALIDATION_STATE::VALID;
-
-    return fieldElement;
+    return CFieldElement{wrappedFieldPtr{fe, CFieldPtrDeleter{}}};
 }
 
 ////////////////////////// End of Custom Field types ///////////////////////////
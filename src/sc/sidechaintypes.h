@@ -1,6 +1,9 @@
 #ifndef _SIDECHAIN_TYPES_H
 #define _SIDECHAIN_TYPES_H
 
+#include <atomic>
+#include <list>
+#include <memory>
 #include <vector>
 #include <string>
 #include <mutex>
@@ -132,8 +135,11 @@ class CFieldElement : public CZendooCctpObject
 public:
     CFieldElement() = default;
     ~CFieldElement() = default;
+    CFieldElement(const CFieldElement& obj);
+    CFieldElement& operator=(const CFieldElement& obj);
     explicit CFieldElement(const std::vector<unsigned char>& byteArrayIn);
     void SetByteArray(const std::vector<unsigned char>& byteArrayIn) override final;
+    void SetNull();
 
     explicit CFieldElement(const uint256& value); //Currently for backward compability with pre-sidechain fork blockHeader. To re-evaluate its necessity
     explicit CFieldElement(const wrappedFieldPtr& wrappedField);
@@ -160,15 +166,27 @@ public:
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
         READWRITE(byteVector);
+        if (ser_action.ForRead())
+            ResetFieldData();
     }
 
+    // lazily deserialized from byteVector, shared among copies; reset whenever byteVector changes
     mutable wrappedFieldPtr fieldData;
 
     // shared_ptr reference count, mainly for UT
     long getUseCount() const { return fieldData.use_count(); }
 
+    // number of field deserializations performed through the CCTP library, mainly for UT and benchmarks
+    static uint64_t GetDeserializationsCount() { return deserializationsCount; }
+
 private:
+    void ResetFieldData();
+
+    // set when the byteVector could not be deserialized, so that the CCTP library is not called again
+    mutable bool deserializationFailed = false;
+
     static CFieldPtrDeleter theFieldPtrDeleter;
+    static std::atomic<uint64_t> deserializationsCount;
 };
 
 typedef CFieldElement ScConstant;
@@ -370,14 +388,58 @@ class CustomCertificateField
 protected:
     const std::vector<unsigned char> vRawData;
     enum class VALIDATION_STATE {NOT_INITIALIZED, INVALID, VALID};
-    mutable VALIDATION_STATE state;
-    mutable CFieldElement fieldElement; // memory only, lazy-initialized
+
+    // outcome of the validation of vRawData against a config and a sidechain version
+    struct ValidatedState
+    {
+        T cfg;
+        uint8_t sidechainVersion;
+        VALIDATION_STATE state;
+        CFieldElement fieldElement;
+    };
+
+    // memory only, lazy-initialized and shared among copies of the field, so that
+    // the (possibly expensive) validation of vRawData is performed only once
+    struct ValidationCache
+    {
+        std::mutex mutex;
+        std::list<ValidatedState> states; // a list, so that returned references are not invalidated
+    };
+    mutable std::shared_ptr<ValidationCache> validationCache;
+
     virtual const CFieldElement& GetFieldElement(const T& cfg, uint8_t sidechainVersion) const = 0;
+    virtual CFieldElement Validate(const T& cfg, uint8_t sidechainVersion) const = 0;
+
+    const CFieldElement& GetValidatedFieldElement(const T& cfg, uint8_t sidechainVersion) const
+    {
+        std::lock_guard<std::mutex> lk(validationCache->mutex);
+
+        for (const ValidatedState& entry : validationCache->states)
+        {
+            if (entry.sidechainVersion == sidechainVersion && entry.cfg == cfg)
+                return entry.fieldElement;
+        }
+
+        CFieldElement fieldElement = Validate(cfg, sidechainVersion);
+        VALIDATION_STATE state = fieldElement.IsNull() ? VALIDATION_STATE::INVALID : VALIDATION_STATE::VALID;
+        validationCache->states.push_back(ValidatedState{cfg, sidechainVersion, state, fieldElement});
+
+        return validationCache->states.back().fieldElement;
+    }
+
+    void ResetValidationCache() { validationCache = std::make_shared<ValidationCache>(); }
 
 public:
-    CustomCertificateField(): state(VALIDATION_STATE::NOT_INITIALIZED) {};
+    CustomCertificateField(): validationCache(std::make_shared<ValidationCache>()) {};
     CustomCertificateField(const std::vector<unsigned char>& rawBytes)
-        :vRawData(rawBytes), state(VALIDATION_STATE::NOT_INITIALIZED) {};
+        :vRawData(rawBytes), validationCache(std::make_shared<ValidationCache>()) {};
+    CustomCertificateField(const CustomCertificateField& rhs) = default;
+    CustomCertificateField& operator=(const CustomCertificateField& rhs)
+    {
+        *const_cast<std::vector<unsigned char>*>(&vRawData) = rhs.vRawData;
+        validationCache = rhs.validationCache;
+        return *this;
+    }
     virtual ~CustomCertificateField() = default;
 
     const std::vector<unsigned char>& getVRawData() const { return vRawData; }
@@ -386,18 +448,20 @@ public:
 class FieldElementCertificateField : public CustomCertificateField<FieldElementCertificateFieldConfig>
 {
 private:
-    mutable FieldElementCertificateFieldConfig* pReferenceCfg; //mutable needed since IsValid is const
+    CFieldElement Validate(const FieldElementCertificateFieldConfig& cfg, uint8_t sidechainVersion) const override;
 public:
-    FieldElementCertificateField(): pReferenceCfg{nullptr} {};
+    FieldElementCertificateField() = default;
     FieldElementCertificateField(const std::vector<unsigned char>& rawBytes);
-    FieldElementCertificateField(const FieldElementCertificateField& rhs);
-    FieldElementCertificateField& operator=(const FieldElementCertificateField& rhs);
-    ~FieldElementCertificateField() {delete pReferenceCfg; pReferenceCfg = nullptr; };
+    FieldElementCertificateField(const FieldElementCertificateField& rhs) = default;
+    FieldElementCertificateField& operator=(const FieldElementCertificateField& rhs) = default;
+    ~FieldElementCertificateField() = default;
 
     ADD_SERIALIZE_METHODS;
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
         READWRITE(*const_cast<std::vector<unsigned char>*>(&vRawData));
+        if (ser_action.ForRead())
+            ResetValidationCache();
     }
 
     const CFieldElement& GetFieldElement(const FieldElementCertificateFieldConfig& cfg, uint8_t sidechainVersion) const override;
@@ -407,18 +471,20 @@ public:
 class BitVectorCertificateField : public CustomCertificateField<BitVectorCertificateFieldConfig>
 {
 private:
-    mutable BitVectorCertificateFieldConfig* pReferenceCfg; //mutable needed since IsValid is const
+    CFieldElement Validate(const BitVectorCertificateFieldConfig& cfg, uint8_t sidechainVersion) const override;
 public:
-    BitVectorCertificateField(): pReferenceCfg{nullptr} {};
+    BitVectorCertificateField() = default;
     BitVectorCertificateField(const std::vector<unsigned char>& rawBytes);
-    BitVectorCertificateField(const BitVectorCertificateField& rhs);
-    BitVectorCertificateField& operator=(const BitVectorCertificateField& rhs);
-    ~BitVectorCertificateField() {delete pReferenceCfg; pReferenceCfg = nullptr; };
+    BitVectorCertificateField(const BitVectorCertificateField& rhs) = default;
+    BitVectorCertificateField& operator=(const BitVectorCertificateField& rhs) = default;
+    ~BitVectorCertificateField() = default;
 
     ADD_SERIALIZE_METHODS;
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
         READWRITE(*const_cast<std::vector<unsigned char>*>(&vRawData));
+        if (ser_action.ForRead())
+            ResetValidationCache();
     }
 
     const CFieldElement& GetFieldElement(const BitVectorCertificateFieldConfig& cfg, uint8_t sidechainVersion) const override;
@@ -0,0 +1,157 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SCACTIVITYINDEX_H
+#define BITCOIN_SCACTIVITYINDEX_H
+
+#include "amount.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <vector>
+
+/** The kinds of the entries of the sidechain activity index, -scindex */
+enum class ScActivityType : uint8_t
+{
+    CREATION = 0,         /**< a CTxScCreationOut */
+    FORWARD_TRANSFER = 1, /**< a CTxForwardTransferOut */
+    BWT_REQUEST = 2,      /**< a CBwtRequestOut */
+    CSW = 3,              /**< a CTxCeasedSidechainWithdrawalInput */
+    CERTIFICATE = 4,      /**< a certificate, of out index 0 */
+};
+
+//! The name of an activity type, as in getscactivity
+const char* ScActivityTypeName(ScActivityType type);
+
+struct CScActivityIteratorKey {
+    uint256 scId;
+    int blockHeight;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 36;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        scId.Serialize(s, nType, nVersion);
+        // Heights are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, blockHeight);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        scId.Unserialize(s, nType, nVersion);
+        blockHeight = ser_readdata32be(s);
+    }
+
+    CScActivityIteratorKey(const uint256& id, int height) {
+        scId = id;
+        blockHeight = height;
+    }
+
+    CScActivityIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        scId.SetNull();
+        blockHeight = 0;
+    }
+};
+
+/**
+ * Key of the sidechain activity index: the entries of a sidechain are sorted by height, then by transaction or
+ * certificate. The type is part of the key, the outputs and the ceased sidechain withdrawal inputs of a transaction
+ * being numbered apart.
+ */
+struct CScActivityKey {
+    uint256 scId;
+    int blockHeight;
+    uint256 txid;
+    ScActivityType type;
+    uint32_t n;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 73;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        scId.Serialize(s, nType, nVersion);
+        ser_writedata32be(s, blockHeight);
+        txid.Serialize(s, nType, nVersion);
+        ser_writedata8(s, static_cast<uint8_t>(type));
+        ser_writedata32be(s, n);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        scId.Unserialize(s, nType, nVersion);
+        blockHeight = ser_readdata32be(s);
+        txid.Unserialize(s, nType, nVersion);
+        type = static_cast<ScActivityType>(ser_readdata8(s));
+        n = ser_readdata32be(s);
+    }
+
+    CScActivityKey(const uint256& id, int height, const uint256& hash, ScActivityType typeIn, uint32_t nIn) {
+        scId = id;
+        blockHeight = height;
+        txid = hash;
+        type = typeIn;
+        n = nIn;
+    }
+
+    CScActivityKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        scId.SetNull();
+        blockHeight = 0;
+        txid.SetNull();
+        type = ScActivityType::CREATION;
+        n = 0;
+    }
+};
+
+/**
+ * What a sidechain node needs of an entry, without reading the transaction: the block, for the entries of the blocks
+ * reorganized away to be told apart, the amount (the fee of a backward transfer request, the backward transfers of a
+ * certificate) and the fields of the type of the entry.
+ */
+struct CScActivityValue {
+    uint256 blockHash;
+    CAmount nValue;
+    uint256 address;                          /**< creation, forward transfer: the address in the sidechain */
+    uint160 mcAddress;                        /**< forward transfer: return, request: destination, csw: receiver */
+    std::vector<unsigned char> vchNullifier;  /**< csw */
+    int32_t epochNumber;                      /**< certificate */
+    int64_t quality;                          /**< certificate */
+
+    CScActivityValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        blockHash.SetNull();
+        nValue = 0;
+        address.SetNull();
+        mcAddress.SetNull();
+        vchNullifier.clear();
+        epochNumber = 0;
+        quality = 0;
+    }
+
+    // the type being in the key, the fields are all serialized, the ones unused of a type being null
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(blockHash);
+        READWRITE(nValue);
+        READWRITE(address);
+        READWRITE(mcAddress);
+        READWRITE(vchNullifier);
+        READWRITE(epochNumber);
+        READWRITE(quality);
+    }
+};
+
+#endif // BITCOIN_SCACTIVITYINDEX_H
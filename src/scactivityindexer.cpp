@@ -0,0 +1,129 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "scactivityindexer.h"
+
+#include "main.h"
+#include "primitives/block.h"
+#include "txdb.h"
+#include "util.h"
+
+//! Name of the block database string holding the hash of the last block of the sidechain activity index
+static const std::string SC_ACTIVITY_INDEX_BEST = "scactivityindexbest";
+
+CScActivityIndexer* pScActivityIndexer = NULL;
+
+const char* ScActivityTypeName(ScActivityType type)
+{
+    switch (type) {
+    case ScActivityType::CREATION:         return "creation";
+    case ScActivityType::FORWARD_TRANSFER: return "forwardtransfer";
+    case ScActivityType::BWT_REQUEST:      return "bwtrequest";
+    case ScActivityType::CSW:              return "csw";
+    case ScActivityType::CERTIFICATE:      return "certificate";
+    }
+    // not reached
+    return "";
+}
+
+CScActivityIndexer::CScActivityIndexer() : CBaseIndexer("sidechain activity", SC_ACTIVITY_INDEX_BEST, "horizen-scindex")
+{
+}
+
+bool CScActivityIndexer::ResetProgress()
+{
+    return CBaseIndexer::ResetProgress(SC_ACTIVITY_INDEX_BEST);
+}
+
+bool CScActivityIndexer::Lookup(const uint256& scId, int fromHeight, int toHeight, Entries& entries, bool& fTruncated)
+{
+    Entries indexed;
+    // one more, to tell a range of MAX_SC_ACTIVITY_ENTRIES from a larger one
+    if (!pblocktree->ReadScActivityIndex(scId, fromHeight, toHeight, MAX_SC_ACTIVITY_ENTRIES + 1, indexed))
+        return false;
+    fTruncated = indexed.size() > MAX_SC_ACTIVITY_ENTRIES;
+    if (fTruncated)
+        return false;
+
+    // the entries of the blocks reorganized away are kept, as the index follows the active chain
+    LOCK(cs_main);
+    entries.clear();
+    for (const std::pair<CScActivityKey, CScActivityValue>& entry : indexed) {
+        const CBlockIndex* pindex = chainActive[entry.first.blockHeight];
+        if (pindex != NULL && pindex->GetBlockHash() == entry.second.blockHash)
+            entries.push_back(entry);
+    }
+    return true;
+}
+
+bool CScActivityIndexer::LoadBlock(const CBlockIndex* pindex)
+{
+    return pblocktree->HaveScActivityBlock(pindex->GetBlockHash());
+}
+
+bool CScActivityIndexer::WriteBlock(const CBlockIndex* pindex)
+{
+    CDiskBlockPos blockPos;
+    {
+        LOCK(cs_main);
+        blockPos = pindex->GetBlockPos();
+    }
+
+    CBlock block;
+    if (!ReadBlockFromDisk(block, blockPos) || block.GetHash() != pindex->GetBlockHash())
+        return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+
+    const uint256 blockHash = pindex->GetBlockHash();
+    const int nHeight = pindex->nHeight;
+    Entries entries;
+    for (const CTransaction& tx : block.vtx) {
+        const uint256& txid = tx.GetHash();
+        for (size_t n = 0; n < tx.GetVscCcOut().size(); n++) {
+            const CTxScCreationOut& out = tx.GetVscCcOut()[n];
+            CScActivityValue value;
+            value.blockHash = blockHash;
+            value.nValue = out.nValue;
+            value.address = out.address;
+            entries.push_back(std::make_pair(CScActivityKey(out.GetScId(), nHeight, txid, ScActivityType::CREATION, n), value));
+        }
+        for (size_t n = 0; n < tx.GetVftCcOut().size(); n++) {
+            const CTxForwardTransferOut& out = tx.GetVftCcOut()[n];
+            CScActivityValue value;
+            value.blockHash = blockHash;
+            value.nValue = out.nValue;
+            value.address = out.address;
+            value.mcAddress = out.mcReturnAddress;
+            entries.push_back(std::make_pair(CScActivityKey(out.scId, nHeight, txid, ScActivityType::FORWARD_TRANSFER, n), value));
+        }
+        for (size_t n = 0; n < tx.GetVBwtRequestOut().size(); n++) {
+            const CBwtRequestOut& out = tx.GetVBwtRequestOut()[n];
+            CScActivityValue value;
+            value.blockHash = blockHash;
+            value.nValue = out.scFee;
+            value.mcAddress = out.mcDestinationAddress;
+            entries.push_back(std::make_pair(CScActivityKey(out.scId, nHeight, txid, ScActivityType::BWT_REQUEST, n), value));
+        }
+        for (size_t n = 0; n < tx.GetVcswCcIn().size(); n++) {
+            const CTxCeasedSidechainWithdrawalInput& in = tx.GetVcswCcIn()[n];
+            CScActivityValue value;
+            value.blockHash = blockHash;
+            value.nValue = in.nValue;
+            value.mcAddress = in.pubKeyHash;
+            value.vchNullifier = in.nullifier.GetByteArray();
+            entries.push_back(std::make_pair(CScActivityKey(in.scId, nHeight, txid, ScActivityType::CSW, n), value));
+        }
+    }
+    for (const CScCertificate& cert : block.vcert) {
+        CScActivityValue value;
+        value.blockHash = blockHash;
+        value.nValue = cert.GetValueOfBackwardTransfers();
+        value.epochNumber = cert.epochNumber;
+        value.quality = cert.quality;
+        entries.push_back(std::make_pair(CScActivityKey(cert.GetScId(), nHeight, cert.GetHash(), ScActivityType::CERTIFICATE, 0), value));
+    }
+
+    if (!pblocktree->WriteScActivityIndex(blockHash, entries))
+        return error("%s: failed to write sidechain activity index", __func__);
+    return true;
+}
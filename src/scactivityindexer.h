@@ -0,0 +1,48 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SCACTIVITYINDEXER_H
+#define BITCOIN_SCACTIVITYINDEXER_H
+
+#include "indexer.h"
+#include "scactivityindex.h"
+#include "uint256.h"
+
+#include <utility>
+#include <vector>
+
+//! The most entries a lookup of the sidechain activity returns, larger ranges are to be split
+static const size_t MAX_SC_ACTIVITY_ENTRIES = 10000;
+
+/**
+ * Builds the index of the activity of the sidechains in the background, see CBaseIndexer: the creations, the forward
+ * transfers, the backward transfer requests, the ceased sidechain withdrawals and the certificates of each sidechain,
+ * by height, so that a sidechain node catching up reads the entries of its sidechain rather than all the blocks.
+ */
+class CScActivityIndexer : public CBaseIndexer
+{
+public:
+    typedef std::vector<std::pair<CScActivityKey, CScActivityValue> > Entries;
+
+    CScActivityIndexer();
+    ~CScActivityIndexer() { Stop(); }
+
+    //! Forget the block the index is synced to, for it to be built from the genesis when (re)enabled
+    static bool ResetProgress();
+
+    /**
+     * The entries of scId in the blocks of the active chain from fromHeight to toHeight included, false if the index
+     * can not be read or if the range has more than MAX_SC_ACTIVITY_ENTRIES entries, with fTruncated set
+     */
+    static bool Lookup(const uint256& scId, int fromHeight, int toHeight, Entries& entries, bool& fTruncated);
+
+protected:
+    bool LoadBlock(const CBlockIndex* pindex) override;
+    bool WriteBlock(const CBlockIndex* pindex) override;
+};
+
+/** The sidechain activity indexer, running if -scindex is enabled */
+extern CScActivityIndexer* pScActivityIndexer;
+
+#endif // BITCOIN_SCACTIVITYINDEXER_H
@@ -14,6 +14,8 @@
 #include <boost/bind.hpp>
 #include <utility>
 
+const int64_t CScheduler::COALESCING_WINDOW_MS;
+
 CScheduler::CScheduler() : nThreadsServicingQueue(0), stopRequested(false), stopWhenEmpty(false)
 {
 }
@@ -24,6 +26,14 @@ CScheduler::~CScheduler()
 }
 
 
+CScheduler::TaskQueue::iterator CScheduler::nextRunnable()
+{
+    TaskQueue::iterator it = taskQueue.begin();
+    while (it != taskQueue.end() && setQueuesRunning.count(it->second.strQueue))
+        ++it;
+    return it;
+}
+
 void CScheduler::serviceQueue()
 {
     boost::unique_lock<boost::mutex> lock(newTaskMutex);
@@ -34,35 +44,48 @@ void CScheduler::serviceQueue()
     // is called.
     while (!shouldStop()) {
         try {
-            while (!shouldStop() && taskQueue.empty()) {
-                // Wait until there is something to do.
+            while (!shouldStop() && nextRunnable() == taskQueue.end()) {
+                // Wait until there is something to do, or a queue
+                // with tasks waiting is done with its running one.
                 newTaskScheduled.wait(lock);
             }
 
             // Wait until either there is a new task, or until
-            // the time of the first item on the queue:
+            // the time of the first runnable item on the queue,
+            // less the coalescing window:
 
             // Some boost versions have a conflicting overload of wait_until that returns void.
             // Explicitly use a template here to avoid hitting that overload.
-            while (!shouldStop() && !taskQueue.empty() &&
-                   newTaskScheduled.wait_until<>(lock, taskQueue.begin()->first) != boost::cv_status::timeout) {
+            TaskQueue::iterator it;
+            while (!shouldStop() && (it = nextRunnable()) != taskQueue.end() &&
+                   boost::chrono::system_clock::now() + boost::chrono::milliseconds(COALESCING_WINDOW_MS) < it->first &&
+                   newTaskScheduled.wait_until<>(lock, it->first - boost::chrono::milliseconds(COALESCING_WINDOW_MS)) != boost::cv_status::timeout) {
                 // Keep waiting until timeout
             }
 
             // If there are multiple threads, the queue can empty while we're waiting (another
             // thread may service the task we were waiting on).
-            if (shouldStop() || taskQueue.empty())
+            if (shouldStop() || (it = nextRunnable()) == taskQueue.end() ||
+                boost::chrono::system_clock::now() + boost::chrono::milliseconds(COALESCING_WINDOW_MS) < it->first)
                 continue;
 
-            Function f = taskQueue.begin()->second;
-            taskQueue.erase(taskQueue.begin());
+            Task task = it->second;
+            taskQueue.erase(it);
+            setQueuesRunning.insert(task.strQueue);
 
-            {
+            try {
                 // Unlock before calling f, so it can reschedule itself or another task
                 // without deadlocking:
                 reverse_lock<boost::unique_lock<boost::mutex> > rlock(lock);
-                f();
+                task.f();
+            } catch (...) {
+                setQueuesRunning.erase(task.strQueue);
+                newTaskScheduled.notify_all();
+                throw;
             }
+            setQueuesRunning.erase(task.strQueue);
+            // the next task of the queue, if due, may be waited for by another thread
+            newTaskScheduled.notify_all();
         } catch (...) {
             --nThreadsServicingQueue;
             throw;
@@ -83,29 +106,35 @@ void CScheduler::stop(bool drain)
     newTaskScheduled.notify_all();
 }
 
-void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t)
+void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t, const std::string& strQueue)
 {
     {
         boost::unique_lock<boost::mutex> lock(newTaskMutex);
-        taskQueue.insert(std::make_pair(t, f));
+        taskQueue.insert(std::make_pair(t, Task{f, strQueue}));
     }
-    newTaskScheduled.notify_one();
+    // all, the thread woken by notify_one could be waiting on a running queue
+    newTaskScheduled.notify_all();
 }
 
-void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaSeconds)
+void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaSeconds, const std::string& strQueue)
 {
-    schedule(f, boost::chrono::system_clock::now() + boost::chrono::seconds(deltaSeconds));
+    schedule(f, boost::chrono::system_clock::now() + boost::chrono::seconds(deltaSeconds), strQueue);
 }
 
-static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaSeconds)
+static void Repeat(CScheduler* s, CScheduler::Function f, boost::chrono::milliseconds delta, const std::string& strQueue)
 {
     f();
-    s->scheduleFromNow(boost::bind(&Repeat, s, f, deltaSeconds), deltaSeconds);
+    s->schedule(boost::bind(&Repeat, s, f, delta, strQueue), boost::chrono::system_clock::now() + delta, strQueue);
+}
+
+void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaSeconds, const std::string& strQueue)
+{
+    scheduleEvery(f, boost::chrono::milliseconds(deltaSeconds * 1000), strQueue);
 }
 
-void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaSeconds)
+void CScheduler::scheduleEvery(CScheduler::Function f, boost::chrono::milliseconds delta, const std::string& strQueue)
 {
-    scheduleFromNow(boost::bind(&Repeat, this, f, deltaSeconds), deltaSeconds);
+    schedule(boost::bind(&Repeat, this, f, delta, strQueue), boost::chrono::system_clock::now() + delta, strQueue);
 }
 
 size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
@@ -14,6 +14,8 @@
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
 #include <map>
+#include <set>
+#include <string>
 
 //
 // Simple class for background tasks that should be run
@@ -32,6 +34,16 @@
 // delete t;
 // delete s; // Must be done after thread is interrupted/joined.
 //
+// Each task belongs to a named queue, the default one if none is given.
+// The tasks of a queue are run one at a time, in the order of their times,
+// and the tasks of different queues in parallel when more than one thread
+// is servicing the scheduler, so a slow task only delays its own queue.
+//
+// The tasks due within COALESCING_WINDOW_MS of each other are run on the
+// same wakeup, the later ones slightly early.
+//
+
+static const int DEFAULT_SCHEDULER_THREADS = 3;
 
 class CScheduler
 {
@@ -41,18 +53,23 @@ public:
 
     typedef boost::function<void(void)> Function;
 
+    static const int64_t COALESCING_WINDOW_MS = 10;
+
     // Call func at/after time t
-    void schedule(Function f, boost::chrono::system_clock::time_point t);
+    void schedule(Function f, boost::chrono::system_clock::time_point t, const std::string& strQueue = "");
 
     // Convenience method: call f once deltaSeconds from now
-    void scheduleFromNow(Function f, int64_t deltaSeconds);
+    void scheduleFromNow(Function f, int64_t deltaSeconds, const std::string& strQueue = "");
 
     // Another convenience method: call f approximately
     // every deltaSeconds forever, starting deltaSeconds from now.
     // To be more precise: every time f is finished, it
     // is rescheduled to run deltaSeconds later. If you
     // need more accurate scheduling, don't use this method.
-    void scheduleEvery(Function f, int64_t deltaSeconds);
+    void scheduleEvery(Function f, int64_t deltaSeconds, const std::string& strQueue = "");
+
+    // The same, for the periodic work of less than a second
+    void scheduleEvery(Function f, boost::chrono::milliseconds delta, const std::string& strQueue = "");
 
     // To keep things as simple as possible, there is no unschedule.
 
@@ -71,13 +88,24 @@ public:
                         boost::chrono::system_clock::time_point &last) const;
 
 private:
-    std::multimap<boost::chrono::system_clock::time_point, Function> taskQueue;
+    struct Task {
+        Function f;
+        std::string strQueue;
+    };
+    typedef std::multimap<boost::chrono::system_clock::time_point, Task> TaskQueue;
+
+    TaskQueue taskQueue;
+    // the queues with a task running, whose next tasks wait for it
+    std::set<std::string> setQueuesRunning;
+    // notified when a task is scheduled, or finishes and unblocks its queue
     boost::condition_variable newTaskScheduled;
     mutable boost::mutex newTaskMutex;
     int nThreadsServicingQueue;
     bool stopRequested;
     bool stopWhenEmpty;
-    bool shouldStop() { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
+    bool shouldStop() { return stopRequested || (stopWhenEmpty && taskQueue.empty() && setQueuesRunning.empty()); }
+    // the first task in time order whose queue is not running
+    TaskQueue::iterator nextRunnable();
 };
 
 #endif
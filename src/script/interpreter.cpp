@@ -1374,15 +1374,14 @@ bool CheckReplayProtectionData(const CChain* chain, int nHeight, const std::vect
     }
 #endif
 
-    CBlockIndex* pblockindex = (*chain)[nHeight];
-    uint256 blockHash = pblockindex->GetBlockHash();
-    std::vector<unsigned char> vchBlockHash(blockHash.begin(), blockHash.end());
-
-    if (vchBlockHash.empty() || vchCompareTo.empty()) {
+    // a lookup in the recent hashes of a CBlockHashSnapshot, for the script checks
+    const uint256* pBlockHash = chain->GetBlockHash(nHeight);
+    if (pBlockHash == NULL || vchCompareTo.empty()) {
         return false;
     }
 
-    return (vchCompareTo == vchBlockHash);
+    return vchCompareTo.size() == pBlockHash->size() &&
+           std::equal(vchCompareTo.begin(), vchCompareTo.end(), pBlockHash->begin());
 }
 
 CertificateSignatureChecker::CertificateSignatureChecker(const CScCertificate* certToIn,
@@ -1440,6 +1439,101 @@ bool TransactionSignatureChecker::CheckBlockHash(const int32_t nHeight, const st
     return CheckReplayProtectionData(chain, nHeight, vchCompareTo);
 }
 
+namespace {
+
+/** Reads a push of data or of a small integer, as EvalScript would put it on the stack. */
+bool GetStandardPush(const CScript& script, CScript::const_iterator& pc, valtype& vchPush, bool fRequireMinimal)
+{
+    opcodetype opcode;
+    if (!script.GetOp(pc, opcode, vchPush))
+        return false;
+    if (0 <= opcode && opcode <= OP_PUSHDATA4)
+        return vchPush.size() <= MAX_SCRIPT_ELEMENT_SIZE && (!fRequireMinimal || CheckMinimalPush(vchPush, opcode));
+    if (opcode == OP_1NEGATE || (OP_1 <= opcode && opcode <= OP_16)) {
+        vchPush = CScriptNum((int)opcode - (int)(OP_1 - 1)).getvch();
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Verifies the spending of the standard pay-to-pubkey-hash and pay-to-pubkey scripts, also with the
+ * OP_CHECKBLOCKATHEIGHT suffix of the replay protection, straight from the pushes of the two scripts
+ * rather than through the stack machine of EvalScript.
+ * It returns false, and the input is left to the generic evaluation, if the scripts do not match these
+ * templates exactly or if any check other than the signature fails, so that the error reported is the
+ * same as always. Otherwise fResult is the outcome of VerifyScript: with anything else passing, a bad
+ * signature can only end the evaluation with SCRIPT_ERR_EVAL_FALSE.
+ */
+bool VerifyStandardScript(const CScript& scriptSig, const CScript& scriptPubKey, unsigned int flags,
+                          const BaseSignatureChecker& checker, bool& fResult)
+{
+    const bool fRequireMinimal = (flags & SCRIPT_VERIFY_MINIMALDATA) != 0;
+    valtype vchSig, vchPubKey, vchBlockHash, vchBlockIndex;
+
+    // OP_DUP OP_HASH160 <pubkey hash> OP_EQUALVERIFY OP_CHECKSIG or <pubkey> OP_CHECKSIG
+    CScript::const_iterator pc = scriptPubKey.begin();
+    const CScript::const_iterator pend = scriptPubKey.end();
+    const bool fPubKeyHash = !scriptPubKey.empty() && scriptPubKey[0] == OP_DUP;
+    if (fPubKeyHash) {
+        if (scriptPubKey.size() < 25 || scriptPubKey[1] != OP_HASH160 || scriptPubKey[2] != 0x14 ||
+            scriptPubKey[23] != OP_EQUALVERIFY || scriptPubKey[24] != OP_CHECKSIG)
+            return false;
+        pc += 25;
+    } else {
+        if (!GetStandardPush(scriptPubKey, pc, vchPubKey, fRequireMinimal) || pc == pend || *pc != OP_CHECKSIG)
+            return false;
+        ++pc;
+    }
+
+    // <block hash> <block height> OP_CHECKBLOCKATHEIGHT
+    const bool fReplayProtection = pc != pend;
+    if (fReplayProtection) {
+        if (!GetStandardPush(scriptPubKey, pc, vchBlockHash, fRequireMinimal) ||
+            !GetStandardPush(scriptPubKey, pc, vchBlockIndex, fRequireMinimal) ||
+            pc == pend || *pc != OP_CHECKBLOCKATHEIGHT || ++pc != pend)
+            return false;
+    }
+
+    // <sig> <pubkey> or <sig>, nothing else
+    pc = scriptSig.begin();
+    if (!GetStandardPush(scriptSig, pc, vchSig, fRequireMinimal))
+        return false;
+    if (fPubKeyHash && !GetStandardPush(scriptSig, pc, vchPubKey, fRequireMinimal))
+        return false;
+    if (pc != scriptSig.end())
+        return false;
+
+    if (fPubKeyHash) {
+        unsigned char hash[CHash160::OUTPUT_SIZE];
+        CHash160().Write(begin_ptr(vchPubKey), vchPubKey.size()).Finalize(hash);
+        if (memcmp(hash, &scriptPubKey[3], sizeof(hash)) != 0)
+            return false;
+    }
+
+    if (!CheckSignatureEncoding(vchSig, flags, NULL) || !CheckPubKeyEncoding(vchPubKey, flags, NULL))
+        return false;
+
+    // without the flag the parameters are just dropped
+    if (fReplayProtection && (flags & SCRIPT_VERIFY_CHECKBLOCKATHEIGHT)) {
+        if ((vchBlockIndex.size() > sizeof(int)) || (vchBlockHash.size() > 32))
+            return false;
+        int32_t nHeight;
+        try {
+            nHeight = CScriptNum(vchBlockIndex, true, 4).getint();
+        } catch (const scriptnum_error&) {
+            return false;
+        }
+        if (nHeight < 0 || !checker.CheckBlockHash(nHeight, vchBlockHash))
+            return false;
+    }
+
+    fResult = checker.CheckSig(vchSig, vchPubKey, scriptPubKey);
+    return true;
+}
+
+} // anon namespace
+
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
 {
     set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
@@ -1448,6 +1542,11 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, unsigne
         return set_error(serror, SCRIPT_ERR_SIG_PUSHONLY);
     }
 
+    // Almost every input spends one of the standard templates
+    bool fStandardResult;
+    if (VerifyStandardScript(scriptSig, scriptPubKey, flags, checker, fStandardResult))
+        return fStandardResult ? set_success(serror) : set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+
     vector<vector<unsigned char> > stack, stackCopy;
     if (!EvalScript(stack, scriptSig, flags, checker, serror))
         // serror is set
@@ -5,73 +5,282 @@
 
 #include "sigcache.h"
 
+#include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "pubkey.h"
 #include "random.h"
+#include "support/largepages.h"
 #include "uint256.h"
 #include "util.h"
 
-#include <boost/thread.hpp>
-#include <boost/tuple/tuple_comparison.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 namespace {
 
 /**
- * Valid signature cache, to avoid doing expensive ECDSA signature checking
- * twice for every transaction (once when accepted into memory pool, and
- * again when accepted into the block chain)
+ * Fixed size cache of salted 32 bytes digests, to remember the outcome of expensive checks.
+ *
+ * The digests are stored in a fixed array of 32 bytes slots, at one of NUM_LOCATIONS locations
+ * derived from the digest itself (cuckoo hashing): inserting into a full cache moves the digest
+ * of one location to one of its other locations, and so on for a bounded number of steps, the
+ * last moved digest being dropped.
+ *
+ * Lookups take no lock, they just load the slot words atomically. Inserts are serialized.
+ * A lookup concurrent with an insert may see a slot made of the words of two different
+ * digests: it could only match the looked up digest if the latter collided on 128 bits
+ * with both, the salt making this infeasible to arrange.
  */
-class CSignatureCache
+class CDigestCache
 {
 private:
-     //! sigdata_type is (signature hash, signature, public key):
-    typedef boost::tuple<uint256, std::vector<unsigned char>, CPubKey> sigdata_type;
-    std::set< sigdata_type> setValid;
-    boost::shared_mutex cs_sigcache;
+    //! The number of slots where a digest may be stored
+    static const unsigned int NUM_LOCATIONS = 8;
+
+    //! A slot, all zero when empty
+    struct Slot
+    {
+        std::atomic<uint64_t> words[4];
+    };
+
+    typedef uint64_t entry_type[4];
+
+    //! The slots are on huge pages with -largepages
+    struct SlotsDeleter
+    {
+        size_t nBytes;
+        void operator()(Slot* p) const { LargePages::Free(p, nBytes); }
+    };
+
+    std::unique_ptr<Slot[], SlotsDeleter> slots;
+    uint32_t nSlots;
+    //! The maximum number of digests moved by an insert
+    unsigned int nMaxDepth;
+    //! Salt of the digests, so that their locations can't be predicted
+    uint256 nonce;
+    std::mutex cs_insert;
+
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+    std::atomic<uint64_t> nInserts;
+    std::atomic<uint64_t> nEvictions;
+
+    void ToEntry(CSHA256& hasher, entry_type& entry) const
+    {
+        unsigned char out[CSHA256::OUTPUT_SIZE];
+        hasher.Finalize(out);
+        memcpy(entry, out, sizeof(entry_type));
+        // the all zero value marks the empty slots
+        if ((entry[0] | entry[1] | entry[2] | entry[3]) == 0)
+            entry[0] = 1;
+    }
+
+    void Locations(const entry_type& entry, uint32_t (&locs)[NUM_LOCATIONS]) const
+    {
+        // each 32 bits of the digest gives a location, scaled to the number of slots
+        for (unsigned int i = 0; i < NUM_LOCATIONS; i++)
+            locs[i] = ((entry[i / 2] >> (32 * (i % 2))) & 0xffffffff) * nSlots >> 32;
+    }
+
+    bool Matches(const Slot& slot, const entry_type& entry) const
+    {
+        for (unsigned int i = 0; i < 4; i++)
+            if (slot.words[i].load(std::memory_order_acquire) != entry[i])
+                return false;
+        return true;
+    }
+
+    bool IsEmpty(const Slot& slot) const
+    {
+        for (unsigned int i = 0; i < 4; i++)
+            if (slot.words[i].load(std::memory_order_relaxed) != 0)
+                return false;
+        return true;
+    }
+
+    bool Contains(const entry_type& entry) const
+    {
+        uint32_t locs[NUM_LOCATIONS];
+        Locations(entry, locs);
+        for (uint32_t loc : locs)
+            if (Matches(slots[loc], entry))
+                return true;
+        return false;
+    }
 
 public:
-    bool
-    Get(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    CDigestCache(const char* name, int64_t nBytes) : nSlots(0), nMaxDepth(0), nonce(GetRandHash()), nHits(0), nMisses(0), nInserts(0), nEvictions(0)
+    {
+        nSlots = (uint32_t)(std::max(nBytes, (int64_t)0) / sizeof(Slot));
+        if (nSlots == 0)
+            return;
+        const size_t nSlotsBytes = sizeof(Slot) * nSlots;
+        slots = std::unique_ptr<Slot[], SlotsDeleter>(static_cast<Slot*>(LargePages::Allocate(nSlotsBytes)), SlotsDeleter{nSlotsBytes});
+        for (uint32_t i = 0; i < nSlots; i++) {
+            new (&slots[i]) Slot;
+            for (unsigned int j = 0; j < 4; j++)
+                slots[i].words[j].store(0, std::memory_order_relaxed);
+        }
+        while ((1ULL << nMaxDepth) < nSlots)
+            nMaxDepth++;
+        nMaxDepth = std::max(nMaxDepth, 1U);
+        LogPrintf("Using %d MiB for the %s cache, able to store %u elements\n", (nBytes >> 20), name, nSlots);
+    }
+
+    //! A hasher already fed with the salt, to compute the digests from
+    CSHA256 Hasher() const
+    {
+        CSHA256 hasher;
+        hasher.Write(nonce.begin(), 32);
+        return hasher;
+    }
+
+    bool Get(CSHA256& hasher)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
+        if (nSlots == 0)
+            return false;
 
-        sigdata_type k(hash, vchSig, pubKey);
-        std::set<sigdata_type>::iterator mi = setValid.find(k);
-        if (mi != setValid.end())
+        entry_type entry;
+        ToEntry(hasher, entry);
+        if (Contains(entry)) {
+            nHits.fetch_add(1, std::memory_order_relaxed);
             return true;
+        }
+        nMisses.fetch_add(1, std::memory_order_relaxed);
         return false;
     }
 
-    void Set(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+    void Set(CSHA256& hasher)
     {
-        // DoS prevention: limit cache size to less than 10MB
-        // (~200 bytes per cache entry times 50,000 entries)
-        // Since there are a maximum of 20,000 signature operations per block
-        // 50,000 is a reasonable default.
-        int64_t nMaxCacheSize = GetArg("-maxsigcachesize", 50000);
-        if (nMaxCacheSize <= 0) return;
+        if (nSlots == 0)
+            return;
+
+        entry_type entry;
+        ToEntry(hasher, entry);
 
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
+        std::lock_guard<std::mutex> lock(cs_insert);
+        if (Contains(entry))
+            return;
+        nInserts.fetch_add(1, std::memory_order_relaxed);
 
-        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
+        uint32_t nLastLoc = nSlots;
+        for (unsigned int depth = 0; depth < nMaxDepth; depth++)
         {
-            // Evict a random entry. Random because that helps
-            // foil would-be DoS attackers who might try to pre-generate
-            // and re-use a set of valid signatures just-slightly-greater
-            // than our cache size.
-            uint256 randomHash = GetRandHash();
-            std::vector<unsigned char> unused;
-            std::set<sigdata_type>::iterator it =
-                setValid.lower_bound(sigdata_type(randomHash, unused, unused));
-            if (it == setValid.end())
-                it = setValid.begin();
-            setValid.erase(*it);
+            uint32_t locs[NUM_LOCATIONS];
+            Locations(entry, locs);
+            for (uint32_t loc : locs) {
+                if (IsEmpty(slots[loc])) {
+                    for (unsigned int i = 0; i < 4; i++)
+                        slots[loc].words[i].store(entry[i], std::memory_order_release);
+                    return;
+                }
+            }
+
+            // Move away the digest of one of the locations, but not the one just put there
+            uint32_t loc = locs[depth % NUM_LOCATIONS];
+            if (loc == nLastLoc)
+                loc = locs[(depth + 1) % NUM_LOCATIONS];
+            for (unsigned int i = 0; i < 4; i++)
+                entry[i] = slots[loc].words[i].exchange(entry[i], std::memory_order_acq_rel);
+            nLastLoc = loc;
         }
+        // the digest moved last has nowhere to go
+        nEvictions.fetch_add(1, std::memory_order_relaxed);
+    }
 
-        sigdata_type k(hash, vchSig, pubKey);
-        setValid.insert(k);
+    void GetStats(SigCacheStats& stats) const
+    {
+        stats.nEntries = nSlots;
+        stats.nHits = nHits.load(std::memory_order_relaxed);
+        stats.nMisses = nMisses.load(std::memory_order_relaxed);
+        stats.nInserts = nInserts.load(std::memory_order_relaxed);
+        stats.nEvictions = nEvictions.load(std::memory_order_relaxed);
     }
 };
 
+//! The bytes of -maxsigcachesize given to each of the signature and the script execution caches
+int64_t GetCacheBytes()
+{
+    int64_t nMaxCacheSize = std::min(std::max(GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE), (int64_t)0),
+                                     MAX_MAX_SIG_CACHE_SIZE);
+    return (nMaxCacheSize << 20) / 2;
+}
+
+/**
+ * Valid signature cache, to avoid doing expensive ECDSA signature checking
+ * twice for every transaction (once when accepted into memory pool, and
+ * again when accepted into the block chain)
+ *
+ * Its digests are of (signature hash, public key, signature). It is shared by
+ * the transaction and the certificate signature checkers.
+ */
+CDigestCache& GetSignatureCache()
+{
+    static CDigestCache signatureCache("signature", GetCacheBytes());
+    return signatureCache;
+}
+
+/**
+ * Cache of the transactions and certificates whose input scripts are all valid, so that
+ * those already checked when accepted into the memory pool have no script to run again
+ * when accepted into the block chain.
+ *
+ * Its digests are of (hash, script verification flags, block hash of the chain tip): the
+ * tip is part of it because OP_CHECKBLOCKATHEIGHT makes the validity of a script depend on
+ * the chain it is checked against.
+ */
+CDigestCache& GetScriptExecutionCache()
+{
+    static CDigestCache scriptExecutionCache("script execution", GetCacheBytes());
+    return scriptExecutionCache;
+}
+
+CSHA256 ScriptExecutionHasher(const uint256& hash, unsigned int flags, const uint256& hashTip)
+{
+    unsigned char vchFlags[4];
+    WriteLE32(vchFlags, flags);
+    CSHA256 hasher = GetScriptExecutionCache().Hasher();
+    hasher.Write(hash.begin(), 32).Write(vchFlags, sizeof(vchFlags)).Write(hashTip.begin(), 32);
+    return hasher;
+}
+
+bool GetSignatureCacheEntry(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+{
+    CSHA256 hasher = GetSignatureCache().Hasher();
+    hasher.Write(hash.begin(), 32).Write(pubKey.begin(), pubKey.size()).Write(vchSig.data(), vchSig.size());
+    return GetSignatureCache().Get(hasher);
+}
+
+void SetSignatureCacheEntry(const uint256 &hash, const std::vector<unsigned char>& vchSig, const CPubKey& pubKey)
+{
+    CSHA256 hasher = GetSignatureCache().Hasher();
+    hasher.Write(hash.begin(), 32).Write(pubKey.begin(), pubKey.size()).Write(vchSig.data(), vchSig.size());
+    GetSignatureCache().Set(hasher);
+}
+
+}
+
+void GetSignatureCacheStats(SigCacheStats& stats)
+{
+    GetSignatureCache().GetStats(stats);
+}
+
+bool IsScriptExecutionCached(const uint256& hash, unsigned int flags, const uint256& hashTip)
+{
+    CSHA256 hasher = ScriptExecutionHasher(hash, flags, hashTip);
+    return GetScriptExecutionCache().Get(hasher);
+}
+
+void AddScriptExecutionCache(const uint256& hash, unsigned int flags, const uint256& hashTip)
+{
+    CSHA256 hasher = ScriptExecutionHasher(hash, flags, hashTip);
+    GetScriptExecutionCache().Set(hasher);
+}
+
+void GetScriptExecutionCacheStats(SigCacheStats& stats)
+{
+    GetScriptExecutionCache().GetStats(stats);
 }
 
 CachingTransactionSignatureChecker::CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn,
@@ -81,16 +290,14 @@ CachingTransactionSignatureChecker::CachingTransactionSignatureChecker(const CTr
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
-    static CSignatureCache signatureCache;
-
-    if (signatureCache.Get(sighash, vchSig, pubkey))
+    if (GetSignatureCacheEntry(sighash, vchSig, pubkey))
         return true;
 
     if (!TransactionSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
         return false;
 
     if (store)
-        signatureCache.Set(sighash, vchSig, pubkey);
+        SetSignatureCacheEntry(sighash, vchSig, pubkey);
     return true;
 }
 
@@ -101,15 +308,13 @@ CachingCertificateSignatureChecker::CachingCertificateSignatureChecker(const CSc
 
 bool CachingCertificateSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
-    static CSignatureCache signatureCache;
-
-    if (signatureCache.Get(sighash, vchSig, pubkey))
+    if (GetSignatureCacheEntry(sighash, vchSig, pubkey))
         return true;
 
     if (!CertificateSignatureChecker::VerifySignature(vchSig, pubkey, sighash))
         return false;
 
     if (store)
-        signatureCache.Set(sighash, vchSig, pubkey);
+        SetSignatureCacheEntry(sighash, vchSig, pubkey);
     return true;
 }
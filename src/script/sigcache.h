@@ -10,8 +10,32 @@
 
 #include <vector>
 
+// DoS prevention: limit the signature and the script execution caches to 32MiB in total
+// (over 500000 entries of 32 bytes each)
+static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
+// Maximum sig cache size allowed, in MiB
+static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+
 class CPubKey;
 
+/** Counters of the signature or the script execution cache, see getsigcacheinfo */
+struct SigCacheStats
+{
+    uint64_t nEntries;
+    uint64_t nHits;
+    uint64_t nMisses;
+    uint64_t nInserts;
+    uint64_t nEvictions;
+};
+
+void GetSignatureCacheStats(SigCacheStats& stats);
+
+/** Whether all the input scripts of a transaction or certificate were found valid, with the flags, upon the chain ending at hashTip */
+bool IsScriptExecutionCached(const uint256& hash, unsigned int flags, const uint256& hashTip);
+/** Record that all the input scripts of a transaction or certificate are valid, with the flags, upon the chain ending at hashTip */
+void AddScriptExecutionCache(const uint256& hash, unsigned int flags, const uint256& hashTip);
+void GetScriptExecutionCacheStats(SigCacheStats& stats);
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
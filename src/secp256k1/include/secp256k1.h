@@ -177,6 +177,22 @@ SECP256K1_API secp256k1_context* secp256k1_context_create(
     unsigned int flags
 ) SECP256K1_WARN_UNUSED_RESULT;
 
+/** Create a secp256k1 context object, choosing the size of the precomputed tables for the verification.
+ *
+ *  The verification uses a table of 2^(window-2) odd multiples of the generator, or two of them with the
+ *  endomorphism optimization, of 64 bytes each: a larger window makes the verification faster, at the cost
+ *  of an exponentially larger context, slower to create. secp256k1_context_create uses the window chosen
+ *  at build time.
+ *
+ *  Returns: a newly created context object.
+ *  In:      flags:  which parts of the context to initialize.
+ *           window: window size of the verification tables, in [2..24].
+ */
+SECP256K1_API secp256k1_context* secp256k1_context_create_ecmult_window(
+    unsigned int flags,
+    unsigned int window
+) SECP256K1_WARN_UNUSED_RESULT;
+
 /** Copies a secp256k1 context object.
  *
  *  Returns: a newly created context object.
@@ -16,10 +16,17 @@ typedef struct {
 #ifdef USE_ENDOMORPHISM
     secp256k1_ge_storage (*pre_g_128)[]; /* odd multiples of 2^128*generator */
 #endif
+    int window_g;                        /* window size of the tables above */
 } secp256k1_ecmult_context;
 
+/** The range of the window sizes of the precomputed tables for the verification. */
+#define ECMULT_WINDOW_MIN 2
+#define ECMULT_WINDOW_MAX 24
+
 static void secp256k1_ecmult_context_init(secp256k1_ecmult_context *ctx);
 static void secp256k1_ecmult_context_build(secp256k1_ecmult_context *ctx, const secp256k1_callback *cb);
+/** Build the tables with the given window size, in [ECMULT_WINDOW_MIN..ECMULT_WINDOW_MAX]. */
+static void secp256k1_ecmult_context_build_window(secp256k1_ecmult_context *ctx, int window_g, const secp256k1_callback *cb);
 static void secp256k1_ecmult_context_clone(secp256k1_ecmult_context *dst,
                                            const secp256k1_ecmult_context *src, const secp256k1_callback *cb);
 static void secp256k1_ecmult_context_clear(secp256k1_ecmult_context *ctx);
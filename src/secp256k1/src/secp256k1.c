@@ -56,6 +56,10 @@ struct secp256k1_context_struct {
 };
 
 secp256k1_context* secp256k1_context_create(unsigned int flags) {
+    return secp256k1_context_create_ecmult_window(flags, WINDOW_G);
+}
+
+secp256k1_context* secp256k1_context_create_ecmult_window(unsigned int flags, unsigned int window) {
     secp256k1_context* ret = (secp256k1_context*)checked_malloc(&default_error_callback, sizeof(secp256k1_context));
     ret->illegal_callback = default_illegal_callback;
     ret->error_callback = default_error_callback;
@@ -66,6 +70,12 @@ secp256k1_context* secp256k1_context_create(unsigned int flags) {
             free(ret);
             return NULL;
     }
+    if (EXPECT(window < ECMULT_WINDOW_MIN || window > ECMULT_WINDOW_MAX, 0)) {
+            secp256k1_callback_call(&ret->illegal_callback,
+                                    "Invalid window");
+            free(ret);
+            return NULL;
+    }
 
     secp256k1_ecmult_context_init(&ret->ecmult_ctx);
     secp256k1_ecmult_gen_context_init(&ret->ecmult_gen_ctx);
@@ -74,7 +84,7 @@ secp256k1_context* secp256k1_context_create(unsigned int flags) {
         secp256k1_ecmult_gen_context_build(&ret->ecmult_gen_ctx, &ret->error_callback);
     }
     if (flags & SECP256K1_FLAGS_BIT_CONTEXT_VERIFY) {
-        secp256k1_ecmult_context_build(&ret->ecmult_ctx, &ret->error_callback);
+        secp256k1_ecmult_context_build_window(&ret->ecmult_ctx, window, &ret->error_callback);
     }
 
     return ret;
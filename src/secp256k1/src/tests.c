@@ -2327,6 +2327,37 @@ void run_ecmult_chain(void) {
     CHECK(secp256k1_gej_is_infinity(&x2));
 }
 
+void run_ecmult_window_tests(void) {
+    /* the window sizes of the verification tables give the same results as the default one */
+    static const int windows[] = {ECMULT_WINDOW_MIN, 3, 8, WINDOW_G, 17};
+    int w, i;
+    for (w = 0; w < (int)(sizeof(windows) / sizeof(windows[0])); w++) {
+        secp256k1_context *wctx = secp256k1_context_create_ecmult_window(SECP256K1_CONTEXT_VERIFY, windows[w]);
+        secp256k1_context *wclone = secp256k1_context_clone(wctx);
+        CHECK(wctx->ecmult_ctx.window_g == windows[w]);
+        CHECK(wclone->ecmult_ctx.window_g == windows[w]);
+        for (i = 0; i < count; i++) {
+            secp256k1_ge ga;
+            secp256k1_gej a, r1, r2, r3;
+            secp256k1_scalar na, ng;
+            random_group_element_test(&ga);
+            random_group_element_jacobian_test(&a, &ga);
+            random_scalar_order_test(&na);
+            random_scalar_order_test(&ng);
+            secp256k1_ecmult(&ctx->ecmult_ctx, &r1, &a, &na, &ng);
+            secp256k1_ecmult(&wctx->ecmult_ctx, &r2, &a, &na, &ng);
+            secp256k1_ecmult(&wclone->ecmult_ctx, &r3, &a, &na, &ng);
+            secp256k1_gej_neg(&r1, &r1);
+            secp256k1_gej_add_var(&r2, &r2, &r1, NULL);
+            secp256k1_gej_add_var(&r3, &r3, &r1, NULL);
+            CHECK(secp256k1_gej_is_infinity(&r2));
+            CHECK(secp256k1_gej_is_infinity(&r3));
+        }
+        secp256k1_context_destroy(wclone);
+        secp256k1_context_destroy(wctx);
+    }
+}
+
 void test_point_times_order(const secp256k1_gej *point) {
     /* X * (point + G) + (order-X) * (pointer + G) = 0 */
     secp256k1_scalar x;
@@ -4489,6 +4520,7 @@ int main(int argc, char **argv) {
     run_wnaf();
     run_point_times_order();
     run_ecmult_chain();
+    run_ecmult_window_tests();
     run_ecmult_constants();
     run_ecmult_gen_blind();
     run_ecmult_const_tests();
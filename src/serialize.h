@@ -1144,6 +1144,12 @@ public:
         return *this;
     }
 
+    //! account for nSize bytes already known, without serializing them
+    void seek(size_t nSize)
+    {
+        this->nSize += nSize;
+    }
+
     template<typename T>
     CSizeComputer& operator<<(const T& obj)
     {
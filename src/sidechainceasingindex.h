@@ -0,0 +1,45 @@
+#ifndef BITCOIN_SIDECHAINCEASINGINDEX_H
+#define BITCOIN_SIDECHAINCEASINGINDEX_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+/**
+ * Key of the index of sidechains by scheduled ceasing height, kept in the chainstate database.
+ * Non ceasing sidechains are indexed at INT_MAX.
+ */
+struct CScCeasingHeightKey {
+    int ceasingHeight;
+    uint256 scId;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 36;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s, int nType, int nVersion) const {
+        // Heights are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, ceasingHeight);
+        scId.Serialize(s, nType, nVersion);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s, int nType, int nVersion) {
+        ceasingHeight = ser_readdata32be(s);
+        scId.Unserialize(s, nType, nVersion);
+    }
+
+    CScCeasingHeightKey(int height, const uint256& id) {
+        ceasingHeight = height;
+        scId = id;
+    }
+
+    CScCeasingHeightKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        ceasingHeight = 0;
+        scId.SetNull();
+    }
+};
+
+#endif // BITCOIN_SIDECHAINCEASINGINDEX_H
@@ -15,20 +15,15 @@
 #define BASIC_RADIX2_DOMAIN_AUX_TCC_
 
 #include <cassert>
-#ifdef MULTICORE
-#include <omp.h>
-#endif
 #include "algebra/fields/field_utils.hpp"
+#include "common/parallel.hpp"
 #include "common/profiling.hpp"
 #include "common/utils.hpp"
 
 namespace libsnark {
 
-#ifdef MULTICORE
+// the parallel FFT falls back to the serial one when a single thread is set, see parallel.hpp
 #define _basic_radix2_FFT _basic_parallel_radix2_FFT
-#else
-#define _basic_radix2_FFT _basic_serial_radix2_FFT
-#endif
 
 /*
  Below we make use of pseudocode from [CLRS 2n Ed, pp. 864].
@@ -93,10 +88,7 @@ void _basic_parallel_radix2_FFT_inner(std::vector<FieldT> &a, const FieldT &omeg
         tmp[j].resize(UINT64_C(1)<<(log_m-log_cpus), FieldT::zero());
     }
 
-#ifdef MULTICORE
-    #pragma omp parallel for
-#endif
-    for (size_t j = 0; j < num_cpus; ++j)
+    parallel_for(num_cpus, [&](const size_t j)
     {
         const FieldT omega_j = omega^j;
         const FieldT omega_step = omega^(j<<(log_m - log_cpus));
@@ -113,49 +105,39 @@ void _basic_parallel_radix2_FFT_inner(std::vector<FieldT> &a, const FieldT &omeg
             }
             elt *= omega_j;
         }
-    }
+    });
     leave_block("Shuffle inputs");
 
     enter_block("Execute sub-FFTs");
     const FieldT omega_num_cpus = omega^num_cpus;
 
-#ifdef MULTICORE
-    #pragma omp parallel for
-#endif
-    for (size_t j = 0; j < num_cpus; ++j)
+    parallel_for(num_cpus, [&](const size_t j)
     {
         _basic_serial_radix2_FFT(tmp[j], omega_num_cpus);
-    }
+    });
     leave_block("Execute sub-FFTs");
 
     enter_block("Re-shuffle outputs");
 
-#ifdef MULTICORE
-    #pragma omp parallel for
-#endif
-    for (size_t i = 0; i < num_cpus; ++i)
+    parallel_for(num_cpus, [&](const size_t i)
     {
         for (size_t j = 0; j < UINT64_C(1)<<(log_m - log_cpus); ++j)
         {
             // now: i = idx >> (log_m - log_cpus) and j = idx % (1u << (log_m - log_cpus)), for idx = ((i<<(log_m-log_cpus))+j) % (1u << log_m)
             a[(j<<log_cpus) + i] = tmp[i][j];
         }
-    }
+    });
     leave_block("Re-shuffle outputs");
 }
 
 template<typename FieldT>
 void _basic_parallel_radix2_FFT(std::vector<FieldT> &a, const FieldT &omega)
 {
-#ifdef MULTICORE
-    const size_t num_cpus = omp_get_max_threads();
-#else
-    const size_t num_cpus = 1;
-#endif
+    const size_t num_cpus = get_num_threads();
     const size_t log_cpus = ((num_cpus & (num_cpus - 1)) == 0 ? log2(num_cpus) : log2(num_cpus) - 1);
 
 #ifdef DEBUG
-    print_indent(); printf("* Invoking parallel FFT on 2^%zu CPUs (omp_get_max_threads = %zu)\n", log_cpus, num_cpus);
+    print_indent(); printf("* Invoking parallel FFT on 2^%zu CPUs (get_num_threads = %zu)\n", log_cpus, num_cpus);
 #endif
 
     if (log_cpus == 0)
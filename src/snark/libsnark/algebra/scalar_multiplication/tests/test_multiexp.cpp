@@ -0,0 +1,46 @@
+/**
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+#include "common/parallel.hpp"
+#include "common/profiling.hpp"
+#include "algebra/curves/alt_bn128/alt_bn128_pp.hpp"
+#include "algebra/scalar_multiplication/multiexp.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace libsnark;
+
+template<typename GroupT, typename FieldT>
+void test_multi_exp(const size_t length)
+{
+    std::vector<GroupT> bases;
+    std::vector<FieldT> scalars;
+    for (size_t i = 0; i < length; ++i)
+    {
+        bases.emplace_back(GroupT::random_element());
+        // the zero and one scalars are the corner cases of the buckets
+        scalars.emplace_back(i % 7 == 0 ? FieldT::zero() : (i % 5 == 0 ? FieldT::one() : FieldT::random_element()));
+    }
+
+    const GroupT expected = naive_exp<GroupT, FieldT>(bases.begin(), bases.end(), scalars.begin(), scalars.end());
+    for (size_t num_threads : {1, 3, 4})
+    {
+        set_num_threads(num_threads);
+        EXPECT_EQ(expected, (multi_exp<GroupT, FieldT>(bases.begin(), bases.end(), scalars.begin(), scalars.end(), get_num_threads(), true)));
+        EXPECT_EQ(expected, (multi_exp_inner_pippenger<GroupT, FieldT>(bases.begin(), bases.end(), scalars.begin(), scalars.end())));
+    }
+    set_num_threads(1);
+}
+
+TEST(algebra, multi_exp)
+{
+    alt_bn128_pp::init_public_params();
+    for (size_t length : {0, 1, 5, 100, 1000})
+    {
+        test_multi_exp<G1<alt_bn128_pp>, Fr<alt_bn128_pp> >(length);
+        test_multi_exp<G2<alt_bn128_pp>, Fr<alt_bn128_pp> >(length);
+    }
+}
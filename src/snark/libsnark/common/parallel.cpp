@@ -0,0 +1,37 @@
+/** @file
+ *****************************************************************************
+ Implementation of the portable parallelization of the loops of the prover
+
+ See parallel.hpp .
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#include "common/parallel.hpp"
+
+#include <atomic>
+#ifdef MULTICORE
+#include <omp.h>
+#endif
+
+namespace libsnark {
+
+static std::atomic<size_t> parallel_num_threads(1);
+
+void set_num_threads(const size_t num_threads)
+{
+    parallel_num_threads = (num_threads == 0 ? 1 : num_threads);
+}
+
+size_t get_num_threads()
+{
+#ifdef MULTICORE
+    return omp_get_max_threads();
+#else
+    return parallel_num_threads;
+#endif
+}
+
+} // libsnark
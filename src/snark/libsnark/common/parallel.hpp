@@ -0,0 +1,37 @@
+/** @file
+ *****************************************************************************
+ Declaration of the portable parallelization of the loops of the prover
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef PARALLEL_HPP_
+#define PARALLEL_HPP_
+
+#include <cstddef>
+
+namespace libsnark {
+
+/**
+ * The number of threads the multi-exponentiations and the FFTs are split among, set at runtime.
+ * It is 1 by default, which runs them on the calling thread; with MULTICORE (OpenMP) it is the
+ * number of threads of OpenMP instead.
+ */
+void set_num_threads(const size_t num_threads);
+size_t get_num_threads();
+
+/**
+ * Calls f(i) for each i in [0, n), the range being split into get_num_threads() contiguous parts
+ * each run by a thread of its own, the calling thread running the first one. The calls of f must
+ * be independent of one another.
+ */
+template<typename F>
+void parallel_for(const size_t n, F f);
+
+} // libsnark
+
+#include "common/parallel.tcc"
+
+#endif // PARALLEL_HPP_
@@ -0,0 +1,65 @@
+/** @file
+ *****************************************************************************
+ Implementation of templatized parts of the portable parallelization.
+
+ See parallel.hpp .
+ *****************************************************************************
+ * @author     This file is part of libsnark, developed by SCIPR Lab
+ *             and contributors (see AUTHORS).
+ * @copyright  MIT license (see LICENSE file)
+ *****************************************************************************/
+
+#ifndef PARALLEL_TCC_
+#define PARALLEL_TCC_
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace libsnark {
+
+template<typename F>
+void parallel_for(const size_t n, F f)
+{
+#ifdef MULTICORE
+#pragma omp parallel for
+    for (size_t i = 0; i < n; ++i)
+    {
+        f(i);
+    }
+#else
+    const size_t num_threads = std::min(get_num_threads(), n);
+    if (num_threads <= 1)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            f(i);
+        }
+        return;
+    }
+
+    // the loops parallelized are few and long, starting their threads costs nothing next to them
+    auto run_part = [&f, n, num_threads](const size_t part)
+    {
+        for (size_t i = part*n/num_threads; i < (part+1)*n/num_threads; ++i)
+        {
+            f(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads-1);
+    for (size_t part = 1; part < num_threads; ++part)
+    {
+        threads.emplace_back(run_part, part);
+    }
+    run_part(0);
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+#endif
+}
+
+} // libsnark
+
+#endif // PARALLEL_TCC_
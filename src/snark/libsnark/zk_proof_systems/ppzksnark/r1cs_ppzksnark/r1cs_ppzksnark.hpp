@@ -463,6 +463,23 @@ bool r1cs_ppzksnark_online_verifier_strong_IC(const r1cs_ppzksnark_processed_ver
                                               const r1cs_ppzksnark_primary_input<ppT> &primary_input,
                                               const r1cs_ppzksnark_proof<ppT> &proof);
 
+/**
+ * A batch verifier algorithm for the R1CS ppzkSNARK that:
+ * (1) accepts a processed verification key,
+ * (2) has strong input consistency, and
+ * (3) checks many proofs at once: the pairing equations of all the proofs, each raised to a random
+ *     128-bit power, are multiplied into a single one, with a single final exponentiation.
+ *
+ * If it accepts, r1cs_ppzksnark_online_verifier_strong_IC accepts each of the proofs, except with
+ * probability 2^-128. It rejects the proofs with a point at infinity or a g_B outside of the group
+ * of order r, which the pairings could not batch soundly, so a rejected batch has to be checked
+ * again proof by proof.
+ */
+template<typename ppT>
+bool r1cs_ppzksnark_online_batch_verifier_strong_IC(const r1cs_ppzksnark_processed_verification_key<ppT> &pvk,
+                                                    const std::vector<r1cs_ppzksnark_primary_input<ppT> > &primary_inputs,
+                                                    const std::vector<r1cs_ppzksnark_proof<ppT> > &proofs);
+
 /****************************** Miscellaneous ********************************/
 
 /**
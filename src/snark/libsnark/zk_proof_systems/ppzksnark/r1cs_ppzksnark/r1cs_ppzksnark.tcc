@@ -20,6 +20,7 @@ See r1cs_ppzksnark.hpp .
 #include <iostream>
 #include <sstream>
 
+#include "common/parallel.hpp"
 #include "common/profiling.hpp"
 #include "common/utils.hpp"
 #include "algebra/scalar_multiplication/multiexp.hpp"
@@ -442,11 +443,7 @@ knowledge_commitment<T1, T2> r1cs_compute_proof_kc(const qap_witness<Fr<ppT> > &
     assert(kcv.domain_size() == qap_wit.num_variables()+2);
 #endif
 
-#ifdef MULTICORE
-    const size_t chunks = omp_get_max_threads(); // to override, set OMP_NUM_THREADS env var or call omp_set_num_threads()
-#else
-    const size_t chunks = 1;
-#endif
+    const size_t chunks = get_num_threads(); // to override, call set_num_threads()
 
     returnval = returnval + kc_multi_exp_with_mixed_addition<T1, T2, Fr<ppT> >(
         kcv,
@@ -470,11 +467,7 @@ G1<ppT> r1cs_compute_proof_K(const qap_witness<Fr<ppT>> &qap_wit, const G1_vecto
     assert(K_query.size() == qap_wit.num_variables()+4);
 #endif
 
-#ifdef MULTICORE
-    const size_t chunks = omp_get_max_threads(); // to override, set OMP_NUM_THREADS env var or call omp_set_num_threads()
-#else
-    const size_t chunks = 1;
-#endif
+    const size_t chunks = get_num_threads(); // to override, call set_num_threads()
 
     G1<ppT> g_K = K_query[0] + zk_shift;
     g_K = g_K + multi_exp_with_mixed_addition<G1<ppT>, Fr<ppT> >(
@@ -499,11 +492,7 @@ G1<ppT> r1cs_compute_proof_H(const qap_witness<Fr<ppT> > &qap_wit, const G1_vect
     assert(H_query.size() == qap_wit.degree()+1);
 #endif
 
-#ifdef MULTICORE
-    const size_t chunks = omp_get_max_threads(); // to override, set OMP_NUM_THREADS env var or call omp_set_num_threads()
-#else
-    const size_t chunks = 1;
-#endif
+    const size_t chunks = get_num_threads(); // to override, call set_num_threads()
 
     g_H = g_H + multi_exp<G1<ppT>, Fr<ppT> >(
         H_query.begin(),
@@ -780,6 +769,105 @@ bool r1cs_ppzksnark_online_verifier_strong_IC(const r1cs_ppzksnark_processed_ver
     return result;
 }
 
+template<typename ppT>
+bool r1cs_ppzksnark_online_batch_verifier_strong_IC(const r1cs_ppzksnark_processed_verification_key<ppT> &pvk,
+                                                    const std::vector<r1cs_ppzksnark_primary_input<ppT> > &primary_inputs,
+                                                    const std::vector<r1cs_ppzksnark_proof<ppT> > &proofs)
+{
+    assert(primary_inputs.size() == proofs.size());
+    enter_block("Call to r1cs_ppzksnark_online_batch_verifier_strong_IC");
+
+    /*
+      With r_A, r_B, r_C, r_QAP and r_K random for each proof, the product of the checks of
+      r1cs_ppzksnark_online_verifier_weak_IC raised to them is, grouping the terms by the points
+      of the verification key:
+
+      e(sum r_A*A, alphaA_g2) * e(sum r_C*C, alphaC_g2) * e(sum r_K*K, gamma_g2) * e(alphaB_g1, sum r_B*B)
+      * prod e(r_QAP*(A+acc), B)
+      / (e(sum r_A*A' + r_B*B' + r_C*C' + r_QAP*C, g2) * e(sum r_QAP*H, rC_Z_g2)
+         * e(sum r_K*(A+acc+C), gamma_beta_g2) * e(gamma_beta_g1, sum r_K*B))
+
+      so that a single Miller loop is left for each proof.
+    */
+    G1<ppT> sum_A = G1<ppT>::zero();
+    G1<ppT> sum_C = G1<ppT>::zero();
+    G1<ppT> sum_K = G1<ppT>::zero();
+    G1<ppT> sum_one = G1<ppT>::zero();
+    G1<ppT> sum_H = G1<ppT>::zero();
+    G1<ppT> sum_A_acc_C = G1<ppT>::zero();
+    G2<ppT> sum_B_alphaB = G2<ppT>::zero();
+    G2<ppT> sum_B_gamma_beta = G2<ppT>::zero();
+    Fqk<ppT> QAP_1 = Fqk<ppT>::one();
+
+    bool result = !proofs.empty();
+    for (size_t i = 0; result && i < proofs.size(); ++i)
+    {
+        const r1cs_ppzksnark_proof<ppT> &proof = proofs[i];
+        if (pvk.encoded_IC_query.domain_size() != primary_inputs[i].size() || !proof.is_well_formed())
+        {
+            result = false;
+            break;
+        }
+
+        const accumulation_vector<G1<ppT> > accumulated_IC = pvk.encoded_IC_query.template accumulate_chunk<Fr<ppT> >(primary_inputs[i].begin(), primary_inputs[i].end(), 0);
+        const G1<ppT> A_acc = proof.g_A.g + accumulated_IC.first;
+        const G1<ppT> A_acc_C = A_acc + proof.g_C.g;
+
+        if (proof.g_A.g.is_zero() || proof.g_A.h.is_zero() || proof.g_B.h.is_zero() || proof.g_C.g.is_zero() ||
+            proof.g_C.h.is_zero() || proof.g_H.is_zero() || proof.g_K.is_zero() || A_acc.is_zero() || A_acc_C.is_zero() ||
+            proof.g_B.g.is_zero() || !(G2<ppT>::order() * proof.g_B.g).is_zero())
+        {
+            result = false;
+            break;
+        }
+
+        bigint<2> r_A, r_B, r_C, r_QAP, r_K;
+        r_A.randomize();
+        r_B.randomize();
+        r_C.randomize();
+        r_QAP.randomize();
+        r_K.randomize();
+
+        sum_A = sum_A + r_A * proof.g_A.g;
+        sum_C = sum_C + r_C * proof.g_C.g;
+        sum_K = sum_K + r_K * proof.g_K;
+        sum_one = sum_one + r_A * proof.g_A.h + r_B * proof.g_B.h + r_C * proof.g_C.h + r_QAP * proof.g_C.g;
+        sum_H = sum_H + r_QAP * proof.g_H;
+        sum_A_acc_C = sum_A_acc_C + r_K * A_acc_C;
+        sum_B_alphaB = sum_B_alphaB + r_B * proof.g_B.g;
+        sum_B_gamma_beta = sum_B_gamma_beta + r_K * proof.g_B.g;
+
+        const G1<ppT> A_acc_QAP = r_QAP * A_acc;
+        if (A_acc_QAP.is_zero())
+        {
+            result = false;
+            break;
+        }
+        QAP_1 = QAP_1 * ppT::miller_loop(ppT::precompute_G1(A_acc_QAP), ppT::precompute_G2(proof.g_B.g));
+    }
+
+    // a sum at infinity is not paired, left to the proof by proof checks
+    if (result && (sum_A.is_zero() || sum_C.is_zero() || sum_K.is_zero() || sum_one.is_zero() || sum_H.is_zero() ||
+                   sum_A_acc_C.is_zero() || sum_B_alphaB.is_zero() || sum_B_gamma_beta.is_zero()))
+    {
+        result = false;
+    }
+
+    if (result)
+    {
+        const Fqk<ppT> num = QAP_1 *
+            ppT::double_miller_loop(ppT::precompute_G1(sum_A), pvk.vk_alphaA_g2_precomp, ppT::precompute_G1(sum_C), pvk.vk_alphaC_g2_precomp) *
+            ppT::double_miller_loop(ppT::precompute_G1(sum_K), pvk.vk_gamma_g2_precomp, pvk.vk_alphaB_g1_precomp, ppT::precompute_G2(sum_B_alphaB));
+        const Fqk<ppT> den =
+            ppT::double_miller_loop(ppT::precompute_G1(sum_one), pvk.pp_G2_one_precomp, ppT::precompute_G1(sum_H), pvk.vk_rC_Z_g2_precomp) *
+            ppT::double_miller_loop(ppT::precompute_G1(sum_A_acc_C), pvk.vk_gamma_beta_g2_precomp, pvk.vk_gamma_beta_g1_precomp, ppT::precompute_G2(sum_B_gamma_beta));
+        result = (ppT::final_exponentiation(num * den.unitary_inverse()) == GT<ppT>::one());
+    }
+
+    leave_block("Call to r1cs_ppzksnark_online_batch_verifier_strong_IC");
+    return result;
+}
+
 template<typename ppT>
 bool r1cs_ppzksnark_verifier_strong_IC(const r1cs_ppzksnark_verification_key<ppT> &vk,
                                        const r1cs_ppzksnark_primary_input<ppT> &primary_input,
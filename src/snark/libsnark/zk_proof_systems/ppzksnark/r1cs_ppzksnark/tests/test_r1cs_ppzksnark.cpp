@@ -42,3 +42,44 @@ TEST(zk_proof_systems, r1cs_ppzksnark)
 
     test_r1cs_ppzksnark<alt_bn128_pp>(1000, 20);
 }
+
+template<typename ppT>
+void test_r1cs_ppzksnark_batch_verifier(size_t num_constraints,
+                                        size_t input_size)
+{
+    print_header("(enter) Test R1CS ppzkSNARK batch verifier");
+
+    r1cs_example<Fr<ppT> > example = generate_r1cs_example_with_binary_input<Fr<ppT> >(num_constraints, input_size);
+    example.constraint_system.swap_AB_if_beneficial();
+    r1cs_ppzksnark_keypair<ppT> keypair = r1cs_ppzksnark_generator<ppT>(example.constraint_system);
+    r1cs_ppzksnark_processed_verification_key<ppT> pvk = r1cs_ppzksnark_verifier_process_vk<ppT>(keypair.vk);
+
+    // the proofs of the same statement differ by their zero-knowledge randomness
+    std::vector<r1cs_ppzksnark_primary_input<ppT> > primary_inputs(3, example.primary_input);
+    std::vector<r1cs_ppzksnark_proof<ppT> > proofs;
+    for (size_t i = 0; i < primary_inputs.size(); ++i)
+    {
+        proofs.emplace_back(r1cs_ppzksnark_prover<ppT>(keypair.pk, example.primary_input, example.auxiliary_input, example.constraint_system));
+    }
+    EXPECT_TRUE(r1cs_ppzksnark_online_batch_verifier_strong_IC<ppT>(pvk, primary_inputs, proofs));
+
+    // a batch fails with any of its proofs or inputs
+    std::vector<r1cs_ppzksnark_proof<ppT> > bad_proofs = proofs;
+    bad_proofs[1].g_H = bad_proofs[1].g_H + G1<ppT>::one();
+    EXPECT_FALSE(r1cs_ppzksnark_online_verifier_strong_IC<ppT>(pvk, example.primary_input, bad_proofs[1]));
+    EXPECT_FALSE(r1cs_ppzksnark_online_batch_verifier_strong_IC<ppT>(pvk, primary_inputs, bad_proofs));
+
+    std::vector<r1cs_ppzksnark_primary_input<ppT> > bad_inputs = primary_inputs;
+    bad_inputs[2][0] = bad_inputs[2][0] + Fr<ppT>::one();
+    EXPECT_FALSE(r1cs_ppzksnark_online_batch_verifier_strong_IC<ppT>(pvk, bad_inputs, proofs));
+
+    bad_inputs[2].pop_back();
+    EXPECT_FALSE(r1cs_ppzksnark_online_batch_verifier_strong_IC<ppT>(pvk, bad_inputs, proofs));
+
+    print_header("(leave) Test R1CS ppzkSNARK batch verifier");
+}
+
+TEST(zk_proof_systems, r1cs_ppzksnark_batch_verifier)
+{
+    test_r1cs_ppzksnark_batch_verifier<alt_bn128_pp>(100, 10);
+}
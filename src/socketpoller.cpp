@@ -0,0 +1,283 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "socketpoller.h"
+
+#include "netbase.h"
+#include "util.h"
+
+#include <errno.h>
+#include <vector>
+
+#if defined(HAVE_SYS_EPOLL_H)
+#include <sys/epoll.h>
+#elif defined(HAVE_SYS_EVENT_H)
+#include <sys/event.h>
+#include <sys/time.h>
+#endif
+
+void CSocketPoller::Watch(SOCKET hSocket, int64_t nOwnerId, int nEvents)
+{
+    std::map<SOCKET, WatchedSocket>::iterator it = mapWatched.find(hSocket);
+    if (it != mapWatched.end() && it->second.nOwnerId != nOwnerId) {
+        // the socket number was reused, the previous registration went away with the closed socket
+        if (it->second.nRegistered != -1)
+            Unregister(hSocket, it->second.nRegistered);
+        mapWatched.erase(it);
+        it = mapWatched.end();
+    }
+    if (it == mapWatched.end()) {
+        WatchedSocket watched;
+        watched.nOwnerId = nOwnerId;
+        watched.nRegistered = -1;
+        it = mapWatched.insert(std::make_pair(hSocket, watched)).first;
+    }
+    it->second.nEvents = nEvents;
+    it->second.fWatched = true;
+}
+
+bool CSocketPoller::Wait(int nTimeoutMs)
+{
+    for (std::map<SOCKET, WatchedSocket>::iterator it = mapWatched.begin(); it != mapWatched.end(); ) {
+        WatchedSocket& watched = it->second;
+        if (!watched.fWatched) {
+            if (watched.nRegistered != -1)
+                Unregister(it->first, watched.nRegistered);
+            mapWatched.erase(it++);
+            continue;
+        }
+        if (watched.nRegistered != watched.nEvents) {
+            if (Register(it->first, watched.nRegistered, watched.nEvents))
+                watched.nRegistered = watched.nEvents;
+            else
+                watched.nRegistered = -1;
+        }
+        watched.fWatched = false;
+        ++it;
+    }
+
+    mapReady.clear();
+    if (Poll(nTimeoutMs))
+        return true;
+
+    for (std::map<SOCKET, WatchedSocket>::const_iterator it = mapWatched.begin(); it != mapWatched.end(); ++it)
+        mapReady[it->first] = SOCKET_EVENT_RECV;
+    return false;
+}
+
+int CSocketPoller::GetEvents(SOCKET hSocket) const
+{
+    std::map<SOCKET, int>::const_iterator it = mapReady.find(hSocket);
+    return it != mapReady.end() ? it->second : 0;
+}
+
+/** select(), available everywhere: the sets are built again for every wait */
+class CSelectSocketPoller : public CSocketPoller
+{
+public:
+    const char* GetName() const override { return "select"; }
+
+protected:
+    bool Register(SOCKET hSocket, int nRegistered, int nEvents) override { return true; }
+    void Unregister(SOCKET hSocket, int nRegistered) override {}
+
+    bool Poll(int nTimeoutMs) override
+    {
+        struct timeval timeout;
+        timeout.tv_sec  = nTimeoutMs / 1000;
+        timeout.tv_usec = (nTimeoutMs % 1000) * 1000;
+
+        fd_set fdsetRecv;
+        fd_set fdsetSend;
+        fd_set fdsetError;
+        FD_ZERO(&fdsetRecv);
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        SOCKET hSocketMax = 0;
+
+        for (std::map<SOCKET, WatchedSocket>::const_iterator it = mapWatched.begin(); it != mapWatched.end(); ++it) {
+            if (it->second.nEvents & SOCKET_EVENT_RECV)
+                FD_SET(it->first, &fdsetRecv);
+            if (it->second.nEvents & SOCKET_EVENT_SEND)
+                FD_SET(it->first, &fdsetSend);
+            if (it->second.nEvents & SOCKET_EVENT_ERROR)
+                FD_SET(it->first, &fdsetError);
+            hSocketMax = std::max(hSocketMax, it->first);
+        }
+
+        int nSelect = select(mapWatched.empty() ? 0 : hSocketMax + 1,
+                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        if (nSelect == SOCKET_ERROR)
+            return false;
+
+        for (std::map<SOCKET, WatchedSocket>::const_iterator it = mapWatched.begin(); it != mapWatched.end(); ++it) {
+            int nEvents = 0;
+            if (FD_ISSET(it->first, &fdsetRecv))
+                nEvents |= SOCKET_EVENT_RECV;
+            if (FD_ISSET(it->first, &fdsetSend))
+                nEvents |= SOCKET_EVENT_SEND;
+            if (FD_ISSET(it->first, &fdsetError))
+                nEvents |= SOCKET_EVENT_ERROR;
+            if (nEvents != 0)
+                mapReady[it->first] = nEvents;
+        }
+        return true;
+    }
+};
+
+#if defined(HAVE_SYS_EPOLL_H)
+/**
+ * epoll, on Linux. The registrations are level-triggered: the socket handler reads at most one
+ * buffer per socket and pass, and skips the sockets it can not lock, so a readiness not consumed
+ * must be reported again by the next wait.
+ */
+class CEpollSocketPoller : public CSocketPoller
+{
+public:
+    CEpollSocketPoller() : fdEpoll(epoll_create1(EPOLL_CLOEXEC)) {}
+    ~CEpollSocketPoller() { if (fdEpoll != -1) close(fdEpoll); }
+
+    bool IsValid() const { return fdEpoll != -1; }
+    const char* GetName() const override { return "epoll"; }
+
+protected:
+    bool Register(SOCKET hSocket, int nRegistered, int nEvents) override
+    {
+        struct epoll_event event;
+        event.events = ((nEvents & SOCKET_EVENT_RECV) ? EPOLLIN : 0) |
+                       ((nEvents & SOCKET_EVENT_SEND) ? EPOLLOUT : 0);
+        event.data.fd = hSocket;
+
+        int nRet = epoll_ctl(fdEpoll, nRegistered == -1 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, hSocket, &event);
+        if (nRet == -1 && nRegistered == -1 && errno == EEXIST)
+            nRet = epoll_ctl(fdEpoll, EPOLL_CTL_MOD, hSocket, &event);
+        else if (nRet == -1 && nRegistered != -1 && errno == ENOENT)
+            nRet = epoll_ctl(fdEpoll, EPOLL_CTL_ADD, hSocket, &event);
+        if (nRet == -1) {
+            LogPrint("net", "%s: cannot watch socket %d: %s\n", __func__, hSocket, NetworkErrorString(errno));
+            return false;
+        }
+        return true;
+    }
+
+    void Unregister(SOCKET hSocket, int nRegistered) override
+    {
+        // a closed socket is removed by the kernel, there is nothing to report
+        struct epoll_event event;
+        epoll_ctl(fdEpoll, EPOLL_CTL_DEL, hSocket, &event);
+    }
+
+    bool Poll(int nTimeoutMs) override
+    {
+        vEvents.resize(std::max(mapWatched.size(), (size_t)1));
+        int nReady = epoll_wait(fdEpoll, vEvents.data(), vEvents.size(), nTimeoutMs);
+        if (nReady == -1)
+            return errno == EINTR;
+
+        for (int i = 0; i < nReady; i++) {
+            const struct epoll_event& event = vEvents[i];
+            int nEvents = 0;
+            if (event.events & (EPOLLIN | EPOLLRDHUP))
+                nEvents |= SOCKET_EVENT_RECV;
+            if (event.events & EPOLLOUT)
+                nEvents |= SOCKET_EVENT_SEND;
+            if (event.events & (EPOLLERR | EPOLLHUP))
+                nEvents |= SOCKET_EVENT_ERROR;
+            mapReady[event.data.fd] = nEvents;
+        }
+        return true;
+    }
+
+private:
+    int fdEpoll;
+    std::vector<struct epoll_event> vEvents;
+};
+#elif defined(HAVE_SYS_EVENT_H)
+/** kqueue, on the BSDs and macOS, with a filter for each direction of interest */
+class CKqueueSocketPoller : public CSocketPoller
+{
+public:
+    CKqueueSocketPoller() : fdKqueue(kqueue()) {}
+    ~CKqueueSocketPoller() { if (fdKqueue != -1) close(fdKqueue); }
+
+    bool IsValid() const { return fdKqueue != -1; }
+    const char* GetName() const override { return "kqueue"; }
+
+protected:
+    bool Register(SOCKET hSocket, int nRegistered, int nEvents) override
+    {
+        int nOld = nRegistered == -1 ? 0 : nRegistered;
+        bool fRet = true;
+        if ((nOld ^ nEvents) & SOCKET_EVENT_RECV)
+            fRet &= Change(hSocket, EVFILT_READ, (nEvents & SOCKET_EVENT_RECV) ? EV_ADD : EV_DELETE);
+        if ((nOld ^ nEvents) & SOCKET_EVENT_SEND)
+            fRet &= Change(hSocket, EVFILT_WRITE, (nEvents & SOCKET_EVENT_SEND) ? EV_ADD : EV_DELETE);
+        if (!fRet) {
+            LogPrint("net", "%s: cannot watch socket %d: %s\n", __func__, hSocket, NetworkErrorString(errno));
+            Unregister(hSocket, nRegistered);
+        }
+        return fRet;
+    }
+
+    void Unregister(SOCKET hSocket, int nRegistered) override
+    {
+        // a closed socket is removed by the kernel, there is nothing to report
+        Change(hSocket, EVFILT_READ, EV_DELETE);
+        Change(hSocket, EVFILT_WRITE, EV_DELETE);
+    }
+
+    bool Poll(int nTimeoutMs) override
+    {
+        struct timespec timeout;
+        timeout.tv_sec  = nTimeoutMs / 1000;
+        timeout.tv_nsec = (nTimeoutMs % 1000) * 1000000;
+
+        vEvents.resize(std::max(2 * mapWatched.size(), (size_t)1));
+        int nReady = kevent(fdKqueue, NULL, 0, vEvents.data(), vEvents.size(), &timeout);
+        if (nReady == -1)
+            return errno == EINTR;
+
+        for (int i = 0; i < nReady; i++) {
+            const struct kevent& event = vEvents[i];
+            int& nEvents = mapReady[(SOCKET)event.ident];
+            if (event.filter == EVFILT_READ)
+                nEvents |= SOCKET_EVENT_RECV;
+            if (event.filter == EVFILT_WRITE)
+                nEvents |= SOCKET_EVENT_SEND;
+            if (event.flags & (EV_EOF | EV_ERROR))
+                nEvents |= SOCKET_EVENT_ERROR;
+        }
+        return true;
+    }
+
+private:
+    int fdKqueue;
+    std::vector<struct kevent> vEvents;
+
+    bool Change(SOCKET hSocket, int16_t nFilter, uint16_t nFlags)
+    {
+        struct kevent change;
+        EV_SET(&change, hSocket, nFilter, nFlags, 0, 0, NULL);
+        return kevent(fdKqueue, &change, 1, NULL, 0, NULL) != -1;
+    }
+};
+#endif
+
+CSocketPoller* CSocketPoller::Create()
+{
+#if defined(HAVE_SYS_EPOLL_H)
+    CEpollSocketPoller* poller = new CEpollSocketPoller();
+    if (poller->IsValid())
+        return poller;
+    LogPrintf("%s: epoll_create1 failed (%s), using select\n", __func__, NetworkErrorString(errno));
+    delete poller;
+#elif defined(HAVE_SYS_EVENT_H)
+    CKqueueSocketPoller* poller = new CKqueueSocketPoller();
+    if (poller->IsValid())
+        return poller;
+    LogPrintf("%s: kqueue failed (%s), using select\n", __func__, NetworkErrorString(errno));
+    delete poller;
+#endif
+    return new CSelectSocketPoller();
+}
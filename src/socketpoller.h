@@ -0,0 +1,80 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SOCKETPOLLER_H
+#define BITCOIN_SOCKETPOLLER_H
+
+#if defined(HAVE_CONFIG_H)
+#include "config/bitcoin-config.h"
+#endif
+
+#include "compat.h"
+
+#include <map>
+#include <stdint.h>
+
+/** Readiness of a socket, as reported by CSocketPoller */
+enum SocketEvent
+{
+    SOCKET_EVENT_RECV = 1 << 0,
+    SOCKET_EVENT_SEND = 1 << 1,
+    SOCKET_EVENT_ERROR = 1 << 2,
+};
+
+/**
+ * Waits for the readiness of a set of sockets, for the socket handler thread.
+ *
+ * The sockets to watch, and the events each one is interested in, are declared with Watch() before
+ * every Wait(). The backends able to keep the registrations in the kernel (epoll on Linux, kqueue on
+ * the BSDs and macOS) only update them when the interest of a socket changes, instead of handing
+ * the whole set to the kernel on every wait as select() does. select() stays the fallback where
+ * neither exists, or when the kernel queue can not be created.
+ *
+ * Every socket is watched along with the id of its owner, so that a socket number reused by a
+ * new connection after the close of the previous one is registered again.
+ */
+class CSocketPoller
+{
+public:
+    //! The best backend available on this system
+    static CSocketPoller* Create();
+
+    virtual ~CSocketPoller() {}
+
+    virtual const char* GetName() const = 0;
+
+    //! Watch hSocket for the next Wait(), for the SocketEvent flags in nEvents (errors are always reported)
+    void Watch(SOCKET hSocket, int64_t nOwnerId, int nEvents);
+
+    /**
+     * Wait at most nTimeoutMs for the watched sockets to be ready. The sockets not watched again since
+     * the previous wait are forgotten. On error all the watched sockets are reported as readable,
+     * for their owners to find out which one failed.
+     */
+    bool Wait(int nTimeoutMs);
+
+    //! The SocketEvent flags of hSocket after the last Wait()
+    int GetEvents(SOCKET hSocket) const;
+
+protected:
+    struct WatchedSocket
+    {
+        int64_t nOwnerId;
+        int nEvents;
+        int nRegistered; /**< the events registered with the backend, -1 if not registered */
+        bool fWatched;   /**< watched since the last wait */
+    };
+
+    std::map<SOCKET, WatchedSocket> mapWatched;
+    std::map<SOCKET, int> mapReady;
+
+    //! Register (nRegistered == -1) or update the registration of a socket
+    virtual bool Register(SOCKET hSocket, int nRegistered, int nEvents) = 0;
+    //! Remove the registration of a socket, which may already be closed
+    virtual void Unregister(SOCKET hSocket, int nRegistered) = 0;
+    //! Wait for the registered sockets and fill mapReady, returning false on error
+    virtual bool Poll(int nTimeoutMs) = 0;
+};
+
+#endif // BITCOIN_SOCKETPOLLER_H
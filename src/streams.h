@@ -6,6 +6,7 @@
 #ifndef BITCOIN_STREAMS_H
 #define BITCOIN_STREAMS_H
 
+#include "support/allocators/nonzeroing.h"
 #include "support/allocators/zeroafterfree.h"
 #include "serialize.h"
 
@@ -343,7 +344,7 @@ public:
         return (*this);
     }
 
-    void GetAndClear(CSerializeData &d) {
+    void GetAndClear(vector_type &d) {
         d.insert(d.end(), begin(), end());
         clear();
     }
@@ -373,6 +374,13 @@ public:
 
 };
 
+/** A CDataStream for data that is not secret, whose buffer is neither zeroed when grown nor cleansed when freed */
+class CPlainDataStream : public CBaseDataStream<CPlainSerializeData>
+{
+public:
+    explicit CPlainDataStream(int nTypeIn, int nVersionIn) : CBaseDataStream(nTypeIn, nVersionIn) { }
+};
+
 
 
 
@@ -507,6 +515,107 @@ public:
     }
 };
 
+/** Stream deserializing from a span of memory it does not own, e.g. a memory mapped file,
+ *  without copying it first.
+ */
+class CSpanReader
+{
+private:
+    int nType;
+    int nVersion;
+
+    const char* pcur;
+    const char* pend;
+
+public:
+    CSpanReader(const char* pbegin, size_t nSize, int nTypeIn, int nVersionIn) :
+        nType(nTypeIn), nVersion(nVersionIn), pcur(pbegin), pend(pbegin + nSize) {}
+
+    int GetType() const          { return nType; }
+    int GetVersion() const       { return nVersion; }
+    size_t size() const          { return pend - pcur; }
+    bool empty() const           { return pcur == pend; }
+
+    CSpanReader& read(char* pch, size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CSpanReader::read: end of data");
+        memcpy(pch, pcur, nSize);
+        pcur += nSize;
+        return (*this);
+    }
+
+    CSpanReader& ignore(size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CSpanReader::ignore: end of data");
+        pcur += nSize;
+        return (*this);
+    }
+
+    template<typename T>
+    CSpanReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
+/** Stream serializing into a span of memory it does not own, sized beforehand with GetSerializeSize:
+ *  writing beyond its end is an error, not a reallocation.
+ */
+class CSpanWriter
+{
+private:
+    int nType;
+    int nVersion;
+
+    char* pcur;
+    char* pend;
+
+public:
+    CSpanWriter(char* pbegin, size_t nSize, int nTypeIn, int nVersionIn) :
+        nType(nTypeIn), nVersion(nVersionIn), pcur(pbegin), pend(pbegin + nSize) {}
+
+    int GetType() const          { return nType; }
+    int GetVersion() const       { return nVersion; }
+    //! the bytes left to write
+    size_t size() const          { return pend - pcur; }
+
+    CSpanWriter& write(const char* pch, size_t nSize)
+    {
+        if (nSize > size())
+            throw std::ios_base::failure("CSpanWriter::write: end of span");
+        memcpy(pcur, pch, nSize);
+        pcur += nSize;
+        return (*this);
+    }
+
+    template<typename T>
+    CSpanWriter& operator<<(const T& obj)
+    {
+        // Serialize to this stream
+        ::Serialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
+/**
+ * Serialize obj at the end of vch, which is grown once by the size of the serialization computed
+ * first: vch is not reallocated over and over as it would be by a stream written byte by byte.
+ */
+template<typename V, typename T>
+void SerializeAppend(V& vch, const T& obj, int nType, int nVersion)
+{
+    const size_t nOffset = vch.size();
+    const size_t nSize = ::GetSerializeSize(obj, nType, nVersion);
+    vch.resize(nOffset + nSize);
+    CSpanWriter writer(reinterpret_cast<char*>(vch.data()) + nOffset, nSize, nType, nVersion);
+    writer << obj;
+    assert(writer.size() == 0);
+}
+
 /** Non-refcounted RAII wrapper around a FILE* that implements a ring buffer to
  *  deserialize from. It guarantees the ability to rewind a given number of bytes.
  *
@@ -0,0 +1,57 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_NONZEROING_H
+#define BITCOIN_SUPPORT_ALLOCATORS_NONZEROING_H
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+/**
+ * Allocator for buffers of data that is not secret, e.g. network messages and database records:
+ * unlike zero_after_free_allocator the memory is not cleansed when freed, and the elements added
+ * by resize() are left uninitialized, to be overwritten by the serialization right after.
+ */
+template <typename T>
+struct nonzeroing_allocator : public std::allocator<T> {
+    typedef std::allocator<T> base;
+    typedef typename base::size_type size_type;
+    typedef typename base::difference_type difference_type;
+    typedef typename base::pointer pointer;
+    typedef typename base::const_pointer const_pointer;
+    typedef typename base::reference reference;
+    typedef typename base::const_reference const_reference;
+    typedef typename base::value_type value_type;
+    nonzeroing_allocator() throw() {}
+    nonzeroing_allocator(const nonzeroing_allocator& a) throw() : base(a) {}
+    template <typename U>
+    nonzeroing_allocator(const nonzeroing_allocator<U>& a) throw() : base(a)
+    {
+    }
+    ~nonzeroing_allocator() throw() {}
+    template <typename _Other>
+    struct rebind {
+        typedef nonzeroing_allocator<_Other> other;
+    };
+
+    //! default initialization, which leaves the bytes as they are
+    template <typename U>
+    void construct(U* p)
+    {
+        ::new (static_cast<void*>(p)) U;
+    }
+
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args)
+    {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+};
+
+// Byte-vector for serialized data that is not secret.
+typedef std::vector<char, nonzeroing_allocator<char> > CPlainSerializeData;
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_NONZEROING_H
@@ -6,13 +6,17 @@
 #ifndef BITCOIN_SUPPORT_ALLOCATORS_SECURE_H
 #define BITCOIN_SUPPORT_ALLOCATORS_SECURE_H
 
+#include "support/lockedpool.h"
 #include "support/pagelocker.h"
 
+#include <limits>
 #include <string>
 
 //
 // Allocator that locks its contents from being paged
 // out of memory and clears its contents before deletion.
+// The memory comes from the pool of LockedPoolManager,
+// locked once, so no system call is made per allocation.
 //
 template <typename T>
 struct secure_allocator : public std::allocator<T> {
@@ -39,20 +43,17 @@ struct secure_allocator : public std::allocator<T> {
 
     T* allocate(std::size_t n, const void* hint = 0)
     {
-        T* p;
-        p = std::allocator<T>::allocate(n, hint);
-        if (p != NULL)
-            LockedPageManager::Instance().LockRange(p, sizeof(T) * n);
-        return p;
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+            throw std::bad_alloc();
+        return static_cast<T*>(LockedPoolManager::Instance().Allocate(sizeof(T) * n));
     }
 
     void deallocate(T* p, std::size_t n)
     {
         if (p != NULL) {
             memory_cleanse(p, sizeof(T) * n);
-            LockedPageManager::Instance().UnlockRange(p, sizeof(T) * n);
+            LockedPoolManager::Instance().Free(p);
         }
-        std::allocator<T>::deallocate(p, n);
     }
 };
 
@@ -0,0 +1,192 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "support/largepages.h"
+
+#if defined(HAVE_CONFIG_H)
+#include "config/bitcoin-config.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+//! The alignment, and granularity, of the allocations carved from the regions
+const size_t BLOCK_ALIGN = 64;
+//! The larger allocations are mapped on their own
+const size_t MAX_CARVED_SIZE = LargePages::REGION_SIZE / 4;
+
+std::atomic<LargePages::Mode> mode(LargePages::Mode::OFF);
+
+std::mutex cs_largepages;
+std::map<size_t, std::vector<void*> > mapFreeBlocks;   //! guarded by cs_largepages
+char* pRegion = nullptr;                                //! guarded by cs_largepages
+size_t nRegionUsed = 0;                                 //! guarded by cs_largepages
+std::atomic<size_t> nMappedBytes(0);
+
+size_t RoundUp(size_t n, size_t align)
+{
+    return (n + align - 1) & ~(align - 1);
+}
+
+/** Prefer the NUMA node of the calling thread for the pages of [p, p + nBytes), whatever the process policy */
+void BindToLocalNode(void* p, size_t nBytes)
+{
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+    static const int MPOL_PREFERRED_ = 1;
+    unsigned int cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+        return;
+    unsigned long nodemask[1024 / (8 * sizeof(unsigned long))] = {};
+    if (node >= 8 * sizeof(nodemask))
+        return;
+    nodemask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    // a failure (no NUMA support in the kernel) leaves the default policy
+    syscall(SYS_mbind, p, nBytes, MPOL_PREFERRED_, nodemask, 8 * sizeof(nodemask), 0);
+#endif
+}
+
+/** Map nBytes, a multiple of REGION_SIZE, on huge pages */
+void* MapHugePages(size_t nBytes)
+{
+#ifdef WIN32
+    return nullptr;
+#else
+    void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    // the explicit huge pages are a reserved pool, once exhausted the transparent ones are used
+    if (mode == LargePages::Mode::EXPLICIT)
+        p = mmap(nullptr, nBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (p == MAP_FAILED) {
+        // one region more than needed, to align the mapping on a huge page boundary
+        const size_t nSpan = nBytes + LargePages::REGION_SIZE;
+        char* pSpan = static_cast<char*>(mmap(nullptr, nSpan, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (pSpan == MAP_FAILED)
+            return nullptr;
+        char* pAligned = reinterpret_cast<char*>(RoundUp(reinterpret_cast<uintptr_t>(pSpan), LargePages::REGION_SIZE));
+        if (pAligned != pSpan)
+            munmap(pSpan, pAligned - pSpan);
+        if (pAligned + nBytes != pSpan + nSpan)
+            munmap(pAligned + nBytes, (pSpan + nSpan) - (pAligned + nBytes));
+        p = pAligned;
+#ifdef MADV_HUGEPAGE
+        madvise(p, nBytes, MADV_HUGEPAGE);
+#endif
+    }
+    BindToLocalNode(p, nBytes);
+    nMappedBytes += nBytes;
+    return p;
+#endif
+}
+
+void UnmapHugePages(void* p, size_t nBytes)
+{
+#ifndef WIN32
+    munmap(p, nBytes);
+    nMappedBytes -= nBytes;
+#endif
+}
+
+} // anon namespace
+
+void LargePages::SetMode(Mode modeIn)
+{
+#ifdef WIN32
+    modeIn = Mode::OFF;
+#endif
+    mode = modeIn;
+}
+
+LargePages::Mode LargePages::GetMode()
+{
+    return mode.load(std::memory_order_relaxed);
+}
+
+bool LargePages::ParseMode(const std::string& str, Mode& modeOut)
+{
+    if (str == "off" || str == "0")
+        modeOut = Mode::OFF;
+    else if (str == "transparent" || str == "1")
+        modeOut = Mode::TRANSPARENT;
+    else if (str == "explicit")
+        modeOut = Mode::EXPLICIT;
+    else
+        return false;
+    return true;
+}
+
+size_t LargePages::Usage(size_t nBytes)
+{
+    nBytes = std::max(nBytes, (size_t)1);
+    return nBytes > MAX_CARVED_SIZE ? RoundUp(nBytes, REGION_SIZE) : RoundUp(nBytes, BLOCK_ALIGN);
+}
+
+void* LargePages::Allocate(size_t nBytes)
+{
+    if (!IsEnabled())
+        return ::operator new(nBytes);
+
+    const size_t nUsage = Usage(nBytes);
+    void* p = nullptr;
+    if (nUsage > MAX_CARVED_SIZE) {
+        p = MapHugePages(nUsage);
+    } else {
+        std::lock_guard<std::mutex> lock(cs_largepages);
+        std::vector<void*>& vFree = mapFreeBlocks[nUsage];
+        if (!vFree.empty()) {
+            p = vFree.back();
+            vFree.pop_back();
+        } else {
+            if (pRegion == nullptr || nRegionUsed + nUsage > REGION_SIZE) {
+                // the tail of the previous region is left unused, less than a carved block
+                pRegion = static_cast<char*>(MapHugePages(REGION_SIZE));
+                nRegionUsed = 0;
+            }
+            if (pRegion != nullptr) {
+                p = pRegion + nRegionUsed;
+                nRegionUsed += nUsage;
+            }
+        }
+    }
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void LargePages::Free(void* p, size_t nBytes)
+{
+    if (p == nullptr)
+        return;
+    if (!IsEnabled()) {
+        ::operator delete(p);
+        return;
+    }
+
+    const size_t nUsage = Usage(nBytes);
+    if (nUsage > MAX_CARVED_SIZE) {
+        UnmapHugePages(p, nUsage);
+    } else {
+        std::lock_guard<std::mutex> lock(cs_largepages);
+        mapFreeBlocks[nUsage].push_back(p);
+    }
+}
+
+size_t LargePages::GetMappedBytes()
+{
+    return nMappedBytes;
+}
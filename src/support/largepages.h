@@ -0,0 +1,73 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_LARGEPAGES_H
+#define BITCOIN_SUPPORT_LARGEPAGES_H
+
+#include <stddef.h>
+#include <limits>
+#include <new>
+#include <string>
+
+/**
+ * Memory of the large long-lived caches (the coins cache, the signature caches), -largepages.
+ *
+ * When enabled, the memory is taken from 2 MiB regions mapped with transparent huge pages, or with explicit
+ * ones reserved by the administrator (vm.nr_hugepages), falling back to the transparent ones when none is left.
+ * Each region is bound to the NUMA node of the thread mapping it, which for the coins cache is the validation
+ * thread inserting the coins. The allocations up to a quarter of a region are carved from the regions and kept on
+ * free lists by size when released, since the caches keep allocating blocks of the same few sizes; the others are
+ * mapped on their own and unmapped when released. The regions are never returned to the system.
+ *
+ * When disabled, everything goes to the default allocator. The mode is set once at startup, before any allocation.
+ */
+class LargePages
+{
+public:
+    enum class Mode { OFF, TRANSPARENT, EXPLICIT };
+
+    static const size_t REGION_SIZE = 2 << 20;
+
+    static void SetMode(Mode mode);
+    static Mode GetMode();
+    static bool IsEnabled() { return GetMode() != Mode::OFF; }
+
+    /** Parse the value of -largepages, returning false if it is not one of off, transparent or explicit */
+    static bool ParseMode(const std::string& str, Mode& mode);
+
+    static void* Allocate(size_t nBytes);
+    static void Free(void* p, size_t nBytes);
+
+    /** The memory an allocation of nBytes takes when enabled, for the DynamicMemoryUsage() accounting */
+    static size_t Usage(size_t nBytes);
+
+    /** The memory mapped so far */
+    static size_t GetMappedBytes();
+};
+
+/** STL allocator on LargePages, for the containers of the caches */
+template <typename T>
+struct large_pages_allocator
+{
+    typedef T value_type;
+
+    large_pages_allocator() noexcept {}
+    template <typename U>
+    large_pages_allocator(const large_pages_allocator<U>&) noexcept {}
+
+    T* allocate(size_t n)
+    {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+            throw std::bad_alloc();
+        return static_cast<T*>(LargePages::Allocate(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n) noexcept { LargePages::Free(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const large_pages_allocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const large_pages_allocator<U>&) const noexcept { return false; }
+};
+
+#endif // BITCOIN_SUPPORT_LARGEPAGES_H
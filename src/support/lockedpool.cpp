@@ -0,0 +1,127 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "support/lockedpool.h"
+#include "support/cleanse.h"
+
+#include <iterator>
+
+#if defined(HAVE_CONFIG_H)
+#include "config/bitcoin-config.h"
+#endif
+
+#ifdef WIN32
+#ifdef _WIN32_WINNT
+#undef _WIN32_WINNT
+#endif
+#define _WIN32_WINNT 0x0501
+#define WIN32_LEAN_AND_MEAN 1
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+LockedPoolManager* LockedPoolManager::_instance = NULL;
+boost::once_flag LockedPoolManager::init_flag = BOOST_ONCE_INIT;
+
+LockedArena::LockedArena(void* baseIn, size_t size) :
+    base(static_cast<char*>(baseIn)), end(static_cast<char*>(baseIn) + size), nUsed(0)
+{
+    AddFree(base, size);
+}
+
+void LockedArena::AddFree(char* p, size_t size)
+{
+    mapFreeByAddr[p] = mapFreeBySize.insert(std::make_pair(size, p));
+}
+
+void LockedArena::RemoveFree(std::map<char*, SizeToChunk::iterator>::iterator it)
+{
+    mapFreeBySize.erase(it->second);
+    mapFreeByAddr.erase(it);
+}
+
+void* LockedArena::Allocate(size_t size)
+{
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (size == 0)
+        return nullptr;
+
+    // the smallest free chunk large enough
+    SizeToChunk::iterator itFit = mapFreeBySize.lower_bound(size);
+    if (itFit == mapFreeBySize.end())
+        return nullptr;
+    const size_t nFree = itFit->first;
+    char* p = itFit->second;
+    RemoveFree(mapFreeByAddr.find(p));
+    // the secret goes at the start, the rest of the chunk stays free
+    if (nFree > size)
+        AddFree(p + size, nFree - size);
+
+    mapUsed.emplace(p, size);
+    nUsed += size;
+    return p;
+}
+
+void LockedArena::Free(void* ptr)
+{
+    std::unordered_map<char*, size_t>::iterator itUsed = mapUsed.find(static_cast<char*>(ptr));
+    assert(itUsed != mapUsed.end()); // Cannot free a chunk that was not allocated
+    char* p = itUsed->first;
+    size_t size = itUsed->second;
+    mapUsed.erase(itUsed);
+    nUsed -= size;
+
+    // merge with the free neighbours
+    std::map<char*, SizeToChunk::iterator>::iterator itNext = mapFreeByAddr.lower_bound(p);
+    if (itNext != mapFreeByAddr.begin()) {
+        std::map<char*, SizeToChunk::iterator>::iterator itPrev = std::prev(itNext);
+        if (itPrev->first + itPrev->second->first == p) {
+            p = itPrev->first;
+            size += itPrev->second->first;
+            RemoveFree(itPrev);
+        }
+    }
+    if (itNext != mapFreeByAddr.end() && p + size == itNext->first) {
+        size += itNext->second->first;
+        RemoveFree(itNext);
+    }
+    AddFree(p, size);
+}
+
+void* MemoryPageAllocator::AllocateLocked(size_t len, bool* fLocked)
+{
+#ifdef WIN32
+    void* addr = VirtualAlloc(nullptr, len, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (addr == nullptr)
+        return nullptr;
+    // VirtualLock does not provide this as a guarantee, see pagelocker.cpp
+    *fLocked = VirtualLock(addr, len) != 0;
+#else
+    void* addr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED)
+        return nullptr;
+    *fLocked = mlock(addr, len) == 0;
+#ifdef MADV_DONTDUMP
+    // keep the secrets out of the core dumps too
+    madvise(addr, len, MADV_DONTDUMP);
+#endif
+#endif
+    return addr;
+}
+
+void MemoryPageAllocator::FreeLocked(void* addr, size_t len)
+{
+    memory_cleanse(addr, len);
+#ifdef WIN32
+    VirtualUnlock(addr, len);
+    VirtualFree(addr, 0, MEM_RELEASE);
+#else
+    munlock(addr, len);
+    munmap(addr, len);
+#endif
+}
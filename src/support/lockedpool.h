@@ -0,0 +1,213 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_LOCKEDPOOL_H
+#define BITCOIN_SUPPORT_LOCKEDPOOL_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <list>
+#include <map>
+#include <memory>
+#include <new>
+#include <unordered_map>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/once.hpp>
+
+/**
+ * A span of memory from which the chunks of a LockedPool are carved.
+ *
+ * The free chunks are indexed by size, for a best fit, and by address, to merge a chunk freed with its free
+ * neighbours. The chunks are multiples of ALIGNMENT. Not thread-safe, guarded by the pool.
+ */
+class LockedArena
+{
+public:
+    static const size_t ALIGNMENT = 16;
+
+    LockedArena(void* base, size_t size);
+
+    void* Allocate(size_t size);
+    void Free(void* p);
+
+    bool Contains(const void* p) const { return p >= base && p < end; }
+    bool IsEmpty() const { return mapUsed.empty(); }
+
+    size_t GetUsedBytes() const { return nUsed; }
+    size_t GetTotalBytes() const { return end - base; }
+    size_t GetUsedChunks() const { return mapUsed.size(); }
+    size_t GetFreeChunks() const { return mapFreeByAddr.size(); }
+
+private:
+    typedef std::multimap<size_t, char*> SizeToChunk;
+
+    char* const base;
+    char* const end;
+    size_t nUsed;
+
+    SizeToChunk mapFreeBySize;
+    std::map<char*, SizeToChunk::iterator> mapFreeByAddr;
+    std::unordered_map<char*, size_t> mapUsed;
+
+    void AddFree(char* p, size_t size);
+    void RemoveFree(std::map<char*, SizeToChunk::iterator>::iterator it);
+};
+
+/**
+ * Thread-safe pool of locked (ie, non-swappable) memory, for the keys and the other secrets.
+ *
+ * The memory is taken from the OS in arenas of ARENA_SIZE, or larger for a larger allocation, locked once when
+ * the arena is created, and the allocations are then served from the arenas without any system call. Locking
+ * the pages of each allocation, as LockedPageManager does, costs an mlock/munlock pair whenever a page gets its
+ * first or loses its last secret, which the wallet does for every temporary key it creates.
+ *
+ * The arenas are kept for the lifetime of the pool, except the ones created for a single large allocation.
+ * An arena whose pages cannot be locked (e.g. RLIMIT_MEMLOCK reached) is still used, as secure_allocator did
+ * when mlock failed; GetLockedBytes() tells how much of the memory is actually locked.
+ */
+template <class Allocator>
+class LockedPoolBase
+{
+public:
+    static const size_t ARENA_SIZE = 256 * 1024;
+
+    LockedPoolBase() : nArenaBytes(0), nLockedBytes(0) {}
+
+    ~LockedPoolBase()
+    {
+        for (const Arena& arena : arenas)
+            allocator.FreeLocked(arena.pBase, arena.nSize);
+    }
+
+    /** Allocate size bytes of locked memory, throwing std::bad_alloc when the OS has none left to give */
+    void* Allocate(size_t size)
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        if (size == 0)
+            size = 1;
+        for (Arena& arena : arenas)
+            if (void* p = arena.chunks.Allocate(size))
+                return p;
+
+        const size_t nSize = size > ARENA_SIZE ? AlignUp(size) : ARENA_SIZE;
+        bool fLocked = false;
+        void* pBase = allocator.AllocateLocked(nSize, &fLocked);
+        if (pBase == nullptr)
+            throw std::bad_alloc();
+        arenas.emplace_back(pBase, nSize, fLocked);
+        nArenaBytes += nSize;
+        if (fLocked)
+            nLockedBytes += nSize;
+        return arenas.back().chunks.Allocate(size);
+    }
+
+    /** Return memory to the pool; the memory must be cleansed by the caller */
+    void Free(void* p)
+    {
+        if (p == nullptr)
+            return;
+        boost::mutex::scoped_lock lock(mutex);
+        for (typename std::list<Arena>::iterator it = arenas.begin(); it != arenas.end(); ++it) {
+            if (!it->chunks.Contains(p))
+                continue;
+            it->chunks.Free(p);
+            // the arena sized for a single large allocation is not worth keeping
+            if (it->nSize > ARENA_SIZE && it->chunks.IsEmpty()) {
+                allocator.FreeLocked(it->pBase, it->nSize);
+                nArenaBytes -= it->nSize;
+                if (it->fLocked)
+                    nLockedBytes -= it->nSize;
+                arenas.erase(it);
+            }
+            return;
+        }
+        assert(!"LockedPool: freeing memory not allocated from the pool");
+    }
+
+    //! For diagnostics and tests
+    size_t GetUsedBytes()
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        size_t nUsed = 0;
+        for (const Arena& arena : arenas)
+            nUsed += arena.chunks.GetUsedBytes();
+        return nUsed;
+    }
+    size_t GetArenaBytes()
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        return nArenaBytes;
+    }
+    size_t GetLockedBytes()
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        return nLockedBytes;
+    }
+    size_t GetArenaCount()
+    {
+        boost::mutex::scoped_lock lock(mutex);
+        return arenas.size();
+    }
+
+private:
+    struct Arena
+    {
+        Arena(void* pBaseIn, size_t nSizeIn, bool fLockedIn) :
+            pBase(pBaseIn), nSize(nSizeIn), fLocked(fLockedIn), chunks(pBaseIn, nSizeIn) {}
+
+        void* pBase;
+        size_t nSize;
+        bool fLocked;
+        LockedArena chunks;
+    };
+
+    static size_t AlignUp(size_t size) { return (size + ARENA_SIZE - 1) / ARENA_SIZE * ARENA_SIZE; }
+
+    Allocator allocator;
+    boost::mutex mutex;
+    // a list, the arenas do not move once created
+    std::list<Arena> arenas;
+    size_t nArenaBytes;
+    size_t nLockedBytes;
+};
+
+/**
+ * OS-dependent allocation of locked memory pages.
+ * Defined as policy class to make stubbing for test possible.
+ */
+class MemoryPageAllocator
+{
+public:
+    /** Allocate and lock len bytes, a multiple of the system page size; fLocked tells whether the lock succeeded */
+    void* AllocateLocked(size_t len, bool* fLocked);
+    /** Unlock and free memory allocated by AllocateLocked, after cleansing it */
+    void FreeLocked(void* addr, size_t len);
+};
+
+/**
+ * Singleton pool of locked memory, for use in secure_allocator.
+ *
+ * Created on demand for the same reason as LockedPageManager, and never destroyed: the secrets held by static
+ * objects can be freed after the destruction of any other static object.
+ */
+class LockedPoolManager : public LockedPoolBase<MemoryPageAllocator>
+{
+public:
+    static LockedPoolManager& Instance()
+    {
+        boost::call_once(LockedPoolManager::CreateInstance, LockedPoolManager::init_flag);
+        return *LockedPoolManager::_instance;
+    }
+
+private:
+    LockedPoolManager() {}
+
+    static void CreateInstance() { LockedPoolManager::_instance = new LockedPoolManager(); }
+
+    static LockedPoolManager* _instance;
+    static boost::once_flag init_flag;
+};
+
+#endif // BITCOIN_SUPPORT_LOCKEDPOOL_H
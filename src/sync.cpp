@@ -9,9 +9,129 @@
 
 #include <stdio.h>
 
+#include <chrono>
+
 #include <boost/foreach.hpp>
 #include <boost/thread.hpp>
 
+std::atomic<bool> fLockProfile(false);
+
+namespace {
+
+struct LockTimes
+{
+    std::atomic<uint64_t> nTotalMicros{0};
+    std::atomic<uint64_t> nMaxMicros{0};
+    std::atomic<uint64_t> vBuckets[LockTimeStats::BUCKETS] = {};
+
+    void Add(int64_t nMicros)
+    {
+        const uint64_t n = nMicros > 0 ? nMicros : 0;
+        nTotalMicros.fetch_add(n, std::memory_order_relaxed);
+        uint64_t nMax = nMaxMicros.load(std::memory_order_relaxed);
+        while (n > nMax && !nMaxMicros.compare_exchange_weak(nMax, n, std::memory_order_relaxed)) {}
+        int nBits = 0;
+        while (nBits < LockTimeStats::BUCKETS - 1 && (n >> nBits) != 0)
+            nBits++;
+        vBuckets[nBits].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void Get(LockTimeStats& stats, bool fReset)
+    {
+        stats.nTotalMicros = fReset ? nTotalMicros.exchange(0) : nTotalMicros.load();
+        stats.nMaxMicros = fReset ? nMaxMicros.exchange(0) : nMaxMicros.load();
+        for (int i = 0; i < LockTimeStats::BUCKETS; i++)
+            stats.vBuckets[i] = fReset ? vBuckets[i].exchange(0) : vBuckets[i].load();
+    }
+};
+
+} // namespace
+
+/**
+ * A LOCK site, claimed by the first lock taken there: state goes from empty to claimed, then ready once
+ * the site is written. The table uses no lock of its own, the profiled locks would be taken within it.
+ */
+struct LockProfileSite
+{
+    enum { EMPTY, CLAIMED, READY };
+    std::atomic<int> state{EMPTY};
+    const char* pszName = nullptr;
+    const char* pszFile = nullptr;
+    int nLine = 0;
+
+    std::atomic<uint64_t> nLocks{0};
+    std::atomic<uint64_t> nContended{0};
+    LockTimes wait;
+    LockTimes hold;
+};
+
+//! a power of two, above the count of LOCK sites in the code
+static const size_t LOCK_PROFILE_SITES = 8192;
+static LockProfileSite lockProfileSites[LOCK_PROFILE_SITES];
+
+LockProfileSite* GetLockProfileSite(const char* pszName, const char* pszFile, int nLine)
+{
+    // the file names are literals: a site is identified by the address of its file name and its line
+    size_t nHash = (reinterpret_cast<uintptr_t>(pszFile) >> 3) * 31 + nLine;
+    for (size_t i = 0; i < LOCK_PROFILE_SITES; i++) {
+        LockProfileSite& site = lockProfileSites[(nHash + i) & (LOCK_PROFILE_SITES - 1)];
+        int state = site.state.load(std::memory_order_acquire);
+        if (state == LockProfileSite::EMPTY) {
+            if (site.state.compare_exchange_strong(state, LockProfileSite::CLAIMED, std::memory_order_acquire)) {
+                site.pszName = pszName;
+                site.pszFile = pszFile;
+                site.nLine = nLine;
+                site.state.store(LockProfileSite::READY, std::memory_order_release);
+                return &site;
+            }
+        }
+        while (state == LockProfileSite::CLAIMED)
+            state = site.state.load(std::memory_order_acquire);
+        if (site.pszFile == pszFile && site.nLine == nLine)
+            return &site;
+    }
+    return nullptr;
+}
+
+int64_t LockProfileMicros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void RecordLockWait(LockProfileSite* site, int64_t nMicros, bool fContended)
+{
+    site->nLocks.fetch_add(1, std::memory_order_relaxed);
+    if (fContended) {
+        site->nContended.fetch_add(1, std::memory_order_relaxed);
+        site->wait.Add(nMicros);
+    }
+}
+
+void RecordLockHold(LockProfileSite* site, int64_t nMicros)
+{
+    site->hold.Add(nMicros);
+}
+
+std::vector<LockSiteStats> GetLockStats(bool fReset)
+{
+    std::vector<LockSiteStats> vStats;
+    for (LockProfileSite& site : lockProfileSites) {
+        if (site.state.load(std::memory_order_acquire) != LockProfileSite::READY)
+            continue;
+        LockSiteStats stats;
+        stats.name = site.pszName;
+        stats.file = site.pszFile;
+        stats.nLine = site.nLine;
+        stats.nLocks = fReset ? site.nLocks.exchange(0) : site.nLocks.load();
+        stats.nContended = fReset ? site.nContended.exchange(0) : site.nContended.load();
+        site.wait.Get(stats.wait, fReset);
+        site.hold.Get(stats.hold, fReset);
+        if (stats.nLocks != 0)
+            vStats.push_back(stats);
+    }
+    return vStats;
+}
+
 #ifdef DEBUG_LOCKCONTENTION
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 {
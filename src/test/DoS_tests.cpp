@@ -29,9 +29,10 @@
 extern bool AddOrphanTx(const CTransactionBase& tx, NodeId peer);
 extern void EraseOrphansFor(NodeId peer);
 extern unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans);
+extern unsigned int LimitOrphanTxSize(unsigned int nMaxOrphans, size_t nMaxOrphansSize);
 
 extern std::map<uint256, COrphanTx> mapOrphanTransactions;
-extern std::map<uint256, std::set<uint256> > mapOrphanTransactionsByPrev;
+extern std::map<COutPoint, std::set<uint256> > mapOrphanTransactionsByPrev;
 
 CService ip(uint32_t i)
 {
@@ -211,4 +212,53 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     BOOST_CHECK(mapOrphanTransactionsByPrev.empty());
 }
 
+BOOST_AUTO_TEST_CASE(DoS_mapOrphansLimits)
+{
+    CMutableTransaction parent;
+    parent.vin.resize(1);
+    parent.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    parent.resizeOut(2);
+
+    std::vector<CMutableTransaction> orphans(100);
+    for (unsigned int i = 0; i < orphans.size(); i++)
+    {
+        orphans[i].vin.resize(1);
+        orphans[i].vin[0].prevout = COutPoint(parent.GetHash(), i % 2);
+        orphans[i].vin[0].nSequence = i;
+        orphans[i].resizeOut(1);
+        orphans[i].getOut(0).nValue = 1*CENT;
+    }
+
+    // Orphans are indexed by the outpoint they spend
+    BOOST_CHECK(AddOrphanTx(orphans[0], 0));
+    BOOST_CHECK(AddOrphanTx(orphans[1], 0));
+    BOOST_CHECK(!AddOrphanTx(orphans[1], 1));
+    BOOST_CHECK_EQUAL(mapOrphanTransactionsByPrev.size(), 2);
+    BOOST_CHECK_EQUAL(mapOrphanTransactionsByPrev[COutPoint(parent.GetHash(), 1)].count(orphans[1].GetHash()), 1);
+
+    // A peer is not allowed past its quota, while the others still are
+    unsigned int nTxSize = mapOrphanTransactions[orphans[0].GetHash()].nTxSize;
+    mapArgs["-maxorphanpeersize"] = "1";
+    unsigned int nPeerOrphans = 1000 / nTxSize;
+    for (unsigned int i = 2; i < nPeerOrphans; i++)
+        BOOST_CHECK(AddOrphanTx(orphans[i], 0));
+    BOOST_CHECK(!AddOrphanTx(orphans[nPeerOrphans], 0));
+    BOOST_CHECK(AddOrphanTx(orphans[nPeerOrphans], 1));
+    mapArgs.erase("-maxorphanpeersize");
+
+    // The pool is bounded by size
+    LimitOrphanTxSize(1000, 2 * nTxSize);
+    BOOST_CHECK(mapOrphanTransactions.size() <= 2);
+
+    // Orphans expire
+    SetMockTime(GetTime() + ORPHAN_TX_EXPIRE_TIME + ORPHAN_TX_EXPIRE_INTERVAL);
+    BOOST_CHECK(AddOrphanTx(orphans[nPeerOrphans + 1], 2));
+    LimitOrphanTxSize(1000);
+    SetMockTime(GetTime() + ORPHAN_TX_EXPIRE_TIME + ORPHAN_TX_EXPIRE_INTERVAL);
+    LimitOrphanTxSize(1000);
+    BOOST_CHECK(mapOrphanTransactions.empty());
+    BOOST_CHECK(mapOrphanTransactionsByPrev.empty());
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
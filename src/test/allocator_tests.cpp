@@ -5,6 +5,8 @@
 #include "util.h"
 
 #include "support/allocators/secure.h"
+#include "support/largepages.h"
+#include "support/lockedpool.h"
 #include "test/test_bitcoin.h"
 
 #include <boost/test/unit_test.hpp>
@@ -117,4 +119,114 @@ BOOST_AUTO_TEST_CASE(test_LockedPageManagerBase)
     BOOST_CHECK((last_unlock_len & (test_page_size-1)) == 0); // always unlock entire pages
 }
 
+// Page allocator counting the arenas, with the locking failing past a limit as with RLIMIT_MEMLOCK
+static size_t test_arenas_allocated, test_arenas_freed;
+class TestPageAllocator
+{
+public:
+    void* AllocateLocked(size_t len, bool* fLocked)
+    {
+        *fLocked = test_arenas_allocated < 2;
+        test_arenas_allocated++;
+        return malloc(len);
+    }
+    void FreeLocked(void* addr, size_t len)
+    {
+        test_arenas_freed++;
+        free(addr);
+    }
+};
+
+BOOST_AUTO_TEST_CASE(test_LockedPoolBase)
+{
+    typedef LockedPoolBase<TestPageAllocator> Pool;
+    test_arenas_allocated = test_arenas_freed = 0;
+    {
+        Pool pool;
+        BOOST_CHECK_EQUAL(pool.GetArenaCount(), 0U);
+
+        // the small allocations are served from one arena, rounded to the alignment
+        std::vector<void*> vp;
+        for (int i = 0; i < 1000; ++i)
+            vp.push_back(pool.Allocate(33));
+        BOOST_CHECK_EQUAL(pool.GetArenaCount(), 1U);
+        BOOST_CHECK_EQUAL(pool.GetUsedBytes(), 1000U * 48);
+        for (size_t i = 0; i < vp.size(); ++i)
+            BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(vp[i]) % LockedArena::ALIGNMENT, 0U);
+
+        // freed in any order, the chunks are merged back into a free space large enough for the whole arena
+        for (size_t i = 0; i < vp.size(); i += 2)
+            pool.Free(vp[i]);
+        for (size_t i = 1; i < vp.size(); i += 2)
+            pool.Free(vp[i]);
+        BOOST_CHECK_EQUAL(pool.GetUsedBytes(), 0U);
+        void* pAll = pool.Allocate(Pool::ARENA_SIZE);
+        BOOST_CHECK_EQUAL(pool.GetArenaCount(), 1U);
+        BOOST_CHECK(pAll == vp[0]);
+
+        // a second arena when the first is full, then a dedicated one for a large allocation, released when freed
+        void* p = pool.Allocate(32);
+        BOOST_CHECK_EQUAL(pool.GetArenaCount(), 2U);
+        BOOST_CHECK_EQUAL(pool.GetLockedBytes(), 2 * Pool::ARENA_SIZE);
+        void* pLarge = pool.Allocate(Pool::ARENA_SIZE + 1);
+        BOOST_CHECK_EQUAL(pool.GetArenaCount(), 3U);
+        BOOST_CHECK_EQUAL(pool.GetArenaBytes(), 4 * Pool::ARENA_SIZE);
+        // the third arena could not be locked
+        BOOST_CHECK_EQUAL(pool.GetLockedBytes(), 2 * Pool::ARENA_SIZE);
+        pool.Free(pLarge);
+        BOOST_CHECK_EQUAL(pool.GetArenaCount(), 2U);
+        BOOST_CHECK_EQUAL(test_arenas_freed, 1U);
+
+        pool.Free(p);
+        pool.Free(pAll);
+        BOOST_CHECK_EQUAL(pool.GetUsedBytes(), 0U);
+        BOOST_CHECK_EQUAL(pool.GetArenaCount(), 2U);
+    }
+    BOOST_CHECK_EQUAL(test_arenas_freed, 3U);
+
+    // the real pool, behind secure_allocator
+    const size_t nUsed = LockedPoolManager::Instance().GetUsedBytes();
+    {
+        SecureString str("secret");
+        str.resize(100);
+        BOOST_CHECK(LockedPoolManager::Instance().GetUsedBytes() > nUsed);
+    }
+    BOOST_CHECK_EQUAL(LockedPoolManager::Instance().GetUsedBytes(), nUsed);
+}
+
+BOOST_AUTO_TEST_CASE(test_LargePages)
+{
+    LargePages::Mode mode;
+    BOOST_CHECK(LargePages::ParseMode("transparent", mode) && mode == LargePages::Mode::TRANSPARENT);
+    BOOST_CHECK(LargePages::ParseMode("off", mode) && mode == LargePages::Mode::OFF);
+    BOOST_CHECK(!LargePages::ParseMode("always", mode));
+
+    LargePages::SetMode(LargePages::Mode::TRANSPARENT);
+#ifndef WIN32
+    // the small blocks are carved from a region and reused once freed
+    BOOST_CHECK_EQUAL(LargePages::Usage(100), 128U);
+    void* p = LargePages::Allocate(100);
+    memset(p, 0xff, 100);
+    LargePages::Free(p, 100);
+    BOOST_CHECK(LargePages::Allocate(100) == p);
+    LargePages::Free(p, 100);
+
+    // the large ones are mapped on their own
+    const size_t nMapped = LargePages::GetMappedBytes();
+    BOOST_CHECK_EQUAL(LargePages::Usage(LargePages::REGION_SIZE + 1), 2 * LargePages::REGION_SIZE);
+    p = LargePages::Allocate(LargePages::REGION_SIZE + 1);
+    BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(p) % LargePages::REGION_SIZE, 0U);
+    BOOST_CHECK_EQUAL(LargePages::GetMappedBytes(), nMapped + 2 * LargePages::REGION_SIZE);
+    memset(p, 0xff, LargePages::REGION_SIZE + 1);
+    LargePages::Free(p, LargePages::REGION_SIZE + 1);
+    BOOST_CHECK_EQUAL(LargePages::GetMappedBytes(), nMapped);
+
+    {
+        std::vector<int, large_pages_allocator<int> > v(1000, 1);
+        BOOST_CHECK_EQUAL(v[999], 1);
+    }
+#endif
+    LargePages::SetMode(LargePages::Mode::OFF);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
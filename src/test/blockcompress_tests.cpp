@@ -0,0 +1,73 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcompress.h"
+#include "random.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcompress_tests, BasicTestingSetup)
+
+static std::vector<char> RandomBytes(size_t nSize)
+{
+    std::vector<char> vData(nSize);
+    if (nSize > 0)
+        GetRandBytes((unsigned char*)&vData[0], nSize);
+    return vData;
+}
+
+BOOST_AUTO_TEST_CASE(blockcompress_roundtrip)
+{
+    // a repeated key, as the verification keys of sidechain creations, among random bytes
+    const std::vector<char> vKey = RandomBytes(1500);
+    std::vector<char> vData;
+    for (int i = 0; i < 50; i++) {
+        std::vector<char> vNoise = RandomBytes(insecure_rand() % 300);
+        vData.insert(vData.end(), vNoise.begin(), vNoise.end());
+        vData.insert(vData.end(), vKey.begin(), vKey.end());
+        vData.insert(vData.end(), insecure_rand() % 100, 'z');
+    }
+
+    std::vector<char> vCompressed, vDecompressed;
+    BOOST_CHECK(CompressBlockData(vData.data(), vData.size(), vCompressed));
+    BOOST_CHECK(vCompressed.size() < vData.size() / 4);
+    BOOST_CHECK(DecompressBlockData(vCompressed.data(), vCompressed.size(), vData.size(), vDecompressed));
+    BOOST_CHECK(vDecompressed == vData);
+
+    // bounded by the maximum size
+    BOOST_CHECK(!DecompressBlockData(vCompressed.data(), vCompressed.size(), vData.size() - 1, vDecompressed));
+}
+
+BOOST_AUTO_TEST_CASE(blockcompress_incompressible)
+{
+    const std::vector<char> vData = RandomBytes(10000);
+    std::vector<char> vCompressed;
+    BOOST_CHECK(!CompressBlockData(vData.data(), vData.size(), vCompressed));
+    BOOST_CHECK(!CompressBlockData(vData.data(), 0, vCompressed));
+}
+
+BOOST_AUTO_TEST_CASE(blockcompress_corrupt)
+{
+    const std::vector<char> vData(5000, 'a');
+    std::vector<char> vCompressed, vDecompressed;
+    BOOST_CHECK(CompressBlockData(vData.data(), vData.size(), vCompressed));
+
+    // unknown method, truncated data
+    std::vector<char> vCorrupt = vCompressed;
+    vCorrupt[0] = 0;
+    BOOST_CHECK(!DecompressBlockData(vCorrupt.data(), vCorrupt.size(), vData.size(), vDecompressed));
+    BOOST_CHECK(!DecompressBlockData(vCompressed.data(), vCompressed.size() - 1, vData.size(), vDecompressed));
+
+    // whatever the altered byte, decompressing never reads or writes out of bounds
+    for (size_t i = 0; i < vCompressed.size(); i++) {
+        vCorrupt = vCompressed;
+        vCorrupt[i] ^= 1 + insecure_rand() % 255;
+        if (DecompressBlockData(vCorrupt.data(), vCorrupt.size(), vData.size(), vDecompressed))
+            BOOST_CHECK(vDecompressed.size() <= vData.size());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
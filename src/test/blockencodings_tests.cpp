@@ -0,0 +1,111 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockencodings.h"
+#include "random.h"
+#include "streams.h"
+#include "txmempool.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockencodings_tests, TestingSetup)
+
+static CBlock BuildBlock(size_t nTx)
+{
+    CBlock block;
+    for (size_t i = 0; i < nTx; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << OP_11;
+        if (i > 0)
+            tx.vin[0].prevout = COutPoint(GetRandHash(), 0);
+        tx.resizeOut(1);
+        tx.getOut(0).scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx.getOut(0).nValue = 1000LL * (i + 1);
+        block.vtx.push_back(tx);
+    }
+    block.hashMerkleRoot = block.BuildMerkleTree();
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(compact_block_roundtrip)
+{
+    CBlock block = BuildBlock(4);
+    CTxMemPool pool(CFeeRate(0));
+    pool.addUnchecked(block.vtx[1].GetHash(), CTxMemPoolEntry(block.vtx[1], 0, 0, 0.0, 1));
+    pool.addUnchecked(block.vtx[3].GetHash(), CTxMemPoolEntry(block.vtx[3], 0, 0, 0.0, 1));
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << CBlockHeaderAndShortTxIDs(block);
+    CBlockHeaderAndShortTxIDs cmpctblock;
+    stream >> cmpctblock;
+    BOOST_CHECK_EQUAL(cmpctblock.header.GetHash().ToString(), block.GetHash().ToString());
+    BOOST_CHECK_EQUAL(cmpctblock.BlockTxCount(), 4U);
+    BOOST_CHECK_EQUAL(cmpctblock.BlockCertCount(), 0U);
+
+    PartiallyDownloadedBlock partialBlock(&pool);
+    BOOST_CHECK(partialBlock.InitData(cmpctblock) == ReadStatus::OK);
+    BOOST_CHECK(partialBlock.IsTxAvailable(0)); // prefilled coinbase
+    BOOST_CHECK(partialBlock.IsTxAvailable(1));
+    BOOST_CHECK(!partialBlock.IsTxAvailable(2));
+    BOOST_CHECK(partialBlock.IsTxAvailable(3));
+
+    // a missing transaction not given is invalid
+    {
+        PartiallyDownloadedBlock partialCopy = partialBlock;
+        CBlock rebuilt;
+        BOOST_CHECK(partialCopy.FillBlock(rebuilt, std::vector<CTransaction>(), std::vector<CScCertificate>()) == ReadStatus::INVALID);
+    }
+    // a wrong one does not match the merkle root
+    {
+        PartiallyDownloadedBlock partialCopy = partialBlock;
+        CBlock rebuilt;
+        std::vector<CTransaction> vtx(1, block.vtx[1]);
+        BOOST_CHECK(partialCopy.FillBlock(rebuilt, vtx, std::vector<CScCertificate>()) == ReadStatus::FAILED);
+    }
+
+    CBlock rebuilt;
+    std::vector<CTransaction> vtx(1, block.vtx[2]);
+    BOOST_CHECK(partialBlock.FillBlock(rebuilt, vtx, std::vector<CScCertificate>()) == ReadStatus::OK);
+    BOOST_CHECK_EQUAL(rebuilt.GetHash().ToString(), block.GetHash().ToString());
+    BOOST_CHECK_EQUAL(rebuilt.vtx.size(), block.vtx.size());
+    for (size_t i = 0; i < block.vtx.size(); i++)
+        BOOST_CHECK(rebuilt.vtx[i].GetHash() == block.vtx[i].GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(compact_block_invalid)
+{
+    CBlock block = BuildBlock(2);
+    CTxMemPool pool(CFeeRate(0));
+
+    // an empty compact block has no coinbase
+    PartiallyDownloadedBlock partialBlock(&pool);
+    CBlockHeaderAndShortTxIDs empty;
+    empty.header = block.GetBlockHeader();
+    BOOST_CHECK(partialBlock.InitData(empty) == ReadStatus::INVALID);
+}
+
+BOOST_AUTO_TEST_CASE(blocktxn_request_roundtrip)
+{
+    BlockTransactionsRequest req;
+    req.blockhash = GetRandHash();
+    req.indexes.push_back(0);
+    req.indexes.push_back(1);
+    req.indexes.push_back(3);
+    req.indexes.push_back(1000);
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << req;
+    // the differences are encoded, in one byte but for the last one
+    BOOST_CHECK_EQUAL(stream.size(), 32U + 1 + 1 + 1 + 1 + 3);
+
+    BlockTransactionsRequest req2;
+    stream >> req2;
+    BOOST_CHECK(req2.blockhash == req.blockhash);
+    BOOST_CHECK(req2.indexes == req.indexes);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,73 @@
+// Copyright (c) 2012-2013 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "checkqueue.h"
+
+#include "test/test_bitcoin.h"
+
+#include <atomic>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(checkqueue_tests, BasicTestingSetup)
+
+static std::atomic<unsigned int> nChecked;
+
+static bool CountedCheck(bool fResult)
+{
+    nChecked++;
+    return fResult;
+}
+
+static void RunChecks(CCheckQueue<CCheckJob>& queue, unsigned int nChecks, unsigned int nFailAt, bool fExpected)
+{
+    nChecked = 0;
+    {
+        CCheckQueueControl<CCheckJob> control(&queue);
+        // add them in several rounds, as ConnectBlock does one round per transaction
+        for (unsigned int nAdded = 0; nAdded < nChecks; ) {
+            std::vector<CCheckJob> vChecks;
+            for (unsigned int i = 0; i < 7 && nAdded < nChecks; i++, nAdded++)
+                vChecks.push_back(CCheckJob(boost::bind(&CountedCheck, nAdded != nFailAt)));
+            control.Add(vChecks);
+        }
+        BOOST_CHECK_EQUAL(control.Wait(), fExpected);
+    }
+    if (fExpected)
+        BOOST_CHECK_EQUAL(nChecked.load(), nChecks);
+    else
+        BOOST_CHECK(nChecked.load() <= nChecks);
+    BOOST_CHECK(queue.IsIdle());
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_work_stealing)
+{
+    CCheckQueue<CCheckJob> queue(128);
+    boost::thread_group threadGroup;
+    for (int i = 0; i < 8; i++)
+        threadGroup.create_thread(boost::bind(&CCheckQueue<CCheckJob>::Thread, &queue));
+
+    // all of them are run, whatever the number and the batch size they end in
+    for (unsigned int nChecks : {0, 1, 3, 100, 1000, 50000})
+        RunChecks(queue, nChecks, nChecks, true);
+
+    // a failure is reported, and the queue is reusable afterwards
+    RunChecks(queue, 1000, 500, false);
+    RunChecks(queue, 1000, 1000, true);
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_CASE(checkqueue_master_only)
+{
+    // without workers the master runs every check itself
+    CCheckQueue<CCheckJob> queue(128);
+    RunChecks(queue, 1000, 1000, true);
+    RunChecks(queue, 10, 3, false);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "coins.h"
+#include "checkqueue.h"
 #include "random.h"
 #include "script/standard.h"
 #include "uint256.h"
@@ -154,6 +155,9 @@ public:
         BOOST_CHECK_EQUAL(DynamicMemoryUsage(), ret);
     }
 
+    bool IsCached(const uint256& txid) const { return cacheCoins.find(txid) != cacheCoins.end(); }
+
+    size_t CoinsMapUsage() const { return memusage::DynamicUsage(cacheCoins); }
 };
 
 }
@@ -732,6 +736,213 @@ BOOST_AUTO_TEST_CASE(coins_cache_simulation_test)
     BOOST_CHECK(missed_an_entry);
 }
 
+static const unsigned int NUM_MAP_BENCHMARK_COINS = 100000;
+
+// Fill a coins map the way a cache does while connecting blocks.
+template <typename Map>
+static int64_t FillCoinsMap(Map& map, const std::vector<uint256>& txids)
+{
+    int64_t nStart = GetTimeMicros();
+    for (const uint256& txid : txids) {
+        CCoinsCacheEntry& entry = map[txid];
+        entry.coins.nVersion = 1;
+        entry.coins.vout.resize(1);
+        entry.coins.vout[0].nValue = txid.GetCheapHash() & 0xFFFF;
+        entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+    }
+    for (const uint256& txid : txids)
+        assert(map.find(txid) != map.end());
+    return GetTimeMicros() - nStart;
+}
+
+// Drain a coins map the way BatchWrite does, entry by entry.
+template <typename Map>
+static int64_t DrainCoinsMap(Map& map, CAmount& nTotal)
+{
+    int64_t nStart = GetTimeMicros();
+    for (typename Map::iterator it = map.begin(); it != map.end(); ) {
+        nTotal += it->second.coins.vout[0].nValue;
+        map.erase(it++);
+    }
+    return GetTimeMicros() - nStart;
+}
+
+// Compare the flat CCoinsMap against the node based map it replaced, and check
+// that a full cache can be flushed and read back from the parent view.
+BOOST_AUTO_TEST_CASE(coins_map_benchmark)
+{
+    typedef boost::unordered_map<uint256, CCoinsCacheEntry, CCoinsKeyHasher> NodeCoinsMap;
+
+    std::vector<uint256> txids(NUM_MAP_BENCHMARK_COINS);
+    for (uint256& txid : txids)
+        txid = GetRandHash();
+
+    CCoinsMap flatMap;
+    NodeCoinsMap nodeMap;
+    int64_t nFlatFill = FillCoinsMap(flatMap, txids);
+    int64_t nNodeFill = FillCoinsMap(nodeMap, txids);
+    BOOST_CHECK_EQUAL(flatMap.size(), nodeMap.size());
+    size_t nFlatUsage = memusage::DynamicUsage(flatMap);
+    size_t nNodeUsage = memusage::DynamicUsage(nodeMap);
+
+    CAmount nFlatTotal = 0, nNodeTotal = 0;
+    int64_t nFlatDrain = DrainCoinsMap(flatMap, nFlatTotal);
+    int64_t nNodeDrain = DrainCoinsMap(nodeMap, nNodeTotal);
+    BOOST_CHECK(flatMap.empty());
+    BOOST_CHECK_EQUAL(nFlatTotal, nNodeTotal);
+
+    BOOST_TEST_MESSAGE(strprintf("%u coins: flat map fill %dus drain %dus usage %u bytes, node map fill %dus drain %dus usage %u bytes",
+        NUM_MAP_BENCHMARK_COINS, nFlatFill, nFlatDrain, nFlatUsage, nNodeFill, nNodeDrain, nNodeUsage));
+
+    CCoinsViewTest base;
+    {
+        CCoinsViewCacheTest cache(&base);
+        for (const uint256& txid : txids) {
+            CCoinsModifier entry = cache.ModifyCoins(txid);
+            entry->nVersion = 1;
+            entry->vout.resize(1);
+            entry->vout[0].nValue = txid.GetCheapHash() & 0xFFFF;
+        }
+        cache.SelfTest();
+        BOOST_CHECK_EQUAL(cache.GetCacheSize(), txids.size());
+
+        int64_t nStart = GetTimeMicros();
+        BOOST_CHECK(cache.Flush());
+        BOOST_TEST_MESSAGE(strprintf("%u coins: flush %dus", NUM_MAP_BENCHMARK_COINS, GetTimeMicros() - nStart));
+        BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+        cache.SelfTest();
+    }
+
+    CCoinsViewCacheTest readBack(&base);
+    for (const uint256& txid : txids) {
+        const CCoins* coins = readBack.AccessCoins(txid);
+        BOOST_CHECK(coins != nullptr && coins->vout[0].nValue == (CAmount)(txid.GetCheapHash() & 0xFFFF));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(coins_prefetch)
+{
+    CCoinsViewTest base;
+    std::vector<uint256> txids(100);
+    for (uint256& txid : txids)
+        txid = GetRandHash();
+    {
+        CCoinsViewCacheTest cache(&base);
+        for (const uint256& txid : txids) {
+            CCoinsModifier entry = cache.ModifyCoins(txid);
+            entry->nVersion = 1;
+            entry->vout.resize(1);
+            entry->vout[0].nValue = txid.GetCheapHash() & 0xFFFF;
+        }
+        BOOST_CHECK(cache.Flush());
+    }
+
+    // duplicated and unknown txids are harmless
+    std::vector<uint256> vPrefetch = txids;
+    vPrefetch.push_back(txids[0]);
+    vPrefetch.push_back(GetRandHash());
+
+    CCoinsViewCacheTest cache(&base);
+    cache.Prefetch(vPrefetch, std::vector<uint256>(), NULL);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+
+    // without workers the queue runs the reads in the calling thread
+    CCheckQueue<CCheckJob> queue(16);
+    cache.Prefetch(vPrefetch, std::vector<uint256>(), &queue);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), txids.size());
+    cache.SelfTest();
+    for (const uint256& txid : txids) {
+        const CCoins* coins = cache.AccessCoins(txid);
+        BOOST_CHECK(coins != nullptr && coins->vout[0].nValue == (CAmount)(txid.GetCheapHash() & 0xFFFF));
+    }
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), txids.size());
+}
+
+BOOST_AUTO_TEST_CASE(coins_flush_and_trim)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+    std::vector<uint256> txids(100);
+    for (uint256& txid : txids) {
+        txid = GetRandHash();
+        CCoinsModifier entry = cache.ModifyCoins(txid);
+        entry->nVersion = 1;
+        entry->vout.resize(1);
+        entry->vout[0].nValue = txid.GetCheapHash() & 0xFFFF;
+    }
+
+    // within the target, the coins are written and all kept
+    BOOST_CHECK(cache.FlushAndTrim(cache.CoinsEntriesUsage()));
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), txids.size());
+    cache.SelfTest();
+    CCoins coins;
+    for (const uint256& txid : txids)
+        BOOST_CHECK(base.GetCoins(txid, coins) && coins.vout[0].nValue == (CAmount)(txid.GetCheapHash() & 0xFFFF));
+
+    // over it, the coins accessed since are the ones kept
+    for (size_t i = 0; i < 10; i++)
+        BOOST_CHECK(cache.AccessCoins(txids[i]) != nullptr);
+    BOOST_CHECK(cache.FlushAndTrim(cache.CoinsEntriesUsage() / 2));
+    BOOST_CHECK(cache.GetCacheSize() >= 10 && cache.GetCacheSize() < txids.size());
+    cache.SelfTest();
+    for (size_t i = 0; i < 10; i++)
+        BOOST_CHECK(cache.IsCached(txids[i]));
+
+    // the evicted ones are read again from the base, and the spent ones leave it
+    for (const uint256& txid : txids)
+        BOOST_CHECK(cache.AccessCoins(txid) != nullptr);
+    cache.ModifyCoins(txids[0])->Clear();
+    BOOST_CHECK(cache.FlushAndTrim(0));
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    BOOST_CHECK(!base.GetCoins(txids[0], coins) || coins.IsPruned());
+    BOOST_CHECK(base.GetCoins(txids[1], coins));
+}
+
+BOOST_AUTO_TEST_CASE(coins_cache_reset)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+    const uint256 txid = GetRandHash();
+    {
+        CCoinsModifier entry = cache.ModifyCoins(txid);
+        entry->nVersion = 1;
+        entry->vout.resize(1);
+        entry->vout[0].nValue = 1;
+    }
+    BOOST_CHECK(cache.IsCached(txid));
+
+    // the modifications are dropped, not written, and the view reads the new base as a fresh one
+    const size_t nUsage = cache.CoinsMapUsage();
+    CCoinsViewTest otherBase;
+    cache.Reset(&otherBase);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    BOOST_CHECK(!cache.HaveCoins(txid));
+    CCoins coins;
+    BOOST_CHECK(!base.GetCoins(txid, coins));
+    // and the coins map kept its memory
+    BOOST_CHECK_EQUAL(cache.CoinsMapUsage(), nUsage);
+
+    // which the next coins use
+    for (int i = 0; i < 10; i++)
+        cache.ModifyCoins(GetRandHash())->vout.resize(1);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 10U);
+    cache.SelfTest();
+
+    // the views given back are reset, and leased again
+    CCoinsViewCachePool pool(1, 1 << 20);
+    CCoinsViewCache* pView = nullptr;
+    {
+        CCoinsViewCachePool::CLease lease = pool.Acquire();
+        pView = &*lease;
+        lease->SetBackend(base);
+        lease->ModifyCoins(txid)->vout.resize(1);
+    }
+    CCoinsViewCachePool::CLease lease = pool.Acquire();
+    BOOST_CHECK(&*lease == pView);
+    BOOST_CHECK_EQUAL(lease->GetCacheSize(), 0U);
+    BOOST_CHECK(!lease->HaveCoins(txid));
+}
+
 BOOST_AUTO_TEST_CASE(coins_coinbase_spends)
 {
     CCoinsViewTest base;
@@ -8,7 +8,11 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "crypto/muhash.h"
+#include "clientversion.h"
+#include "hash.h"
 #include "random.h"
+#include "streams.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
 
@@ -131,6 +135,23 @@ BOOST_AUTO_TEST_CASE(sha256_testvectors) {
     TestSHA256(test1, "a316d55510b49662420f49d145d42fb83f31ef8dc016aa4e32df049991a91e26");
 }
 
+// The multi-way implementations selected at startup are used for the first multiples of their ways
+BOOST_AUTO_TEST_CASE(sha256d64)
+{
+    for (int i = 0; i <= 32; ++i) {
+        unsigned char in[64 * 32];
+        unsigned char out1[32 * 32], out2[32 * 32];
+        for (int j = 0; j < 64 * i; ++j) {
+            in[j] = GetRandInt(256);
+        }
+        for (int j = 0; j < i; ++j) {
+            CHash256().Write(in + 64 * j, 64).Finalize(out1 + 32 * j);
+        }
+        SHA256D64(out2, in, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(sha512_testvectors) {
     TestSHA512("",
                "cf83e1357eefb8bdf1542850d66d8007d620e4050b5715dc83f4a921d36ce9ce"
@@ -248,4 +269,46 @@ BOOST_AUTO_TEST_CASE(hmac_sha512_testvectors) {
                    "b6022cac3c4982b10d5eeb55c3e4de15134676fb6de0446065c97440fa8c6a58");
 }
 
+static uint256 FinalizeMuHash(MuHash3072 muhash) {
+    uint256 hash;
+    muhash.Finalize(hash);
+    return hash;
+}
+
+BOOST_AUTO_TEST_CASE(muhash_tests) {
+    const std::vector<unsigned char> elem0(1, 0);
+    const std::vector<unsigned char> elem1(1, 1);
+    const std::vector<unsigned char> elem2(1, 2);
+
+    BOOST_CHECK(FinalizeMuHash(MuHash3072()) == uint256S("dd5ad2a105c2d29495f577245c357409002329b9f4d6182c0af3dc2f462555c8"));
+    BOOST_CHECK(FinalizeMuHash(MuHash3072(elem0)) == uint256S("21e6ba9aef674df5a83c4fa2613e283fbd4902ce0a38dfad7cf4ffcaac20a937"));
+    BOOST_CHECK(FinalizeMuHash(MuHash3072(elem0).Insert(elem1)) == uint256S("a2c6b4f0b319b241f81a32e64f2f8c0651d201559c4693357e38e72be9c7fa6c"));
+
+    // The hash of a set does not depend on the order of insertion
+    MuHash3072 set012 = MuHash3072(elem0).Insert(elem1).Insert(elem2);
+    MuHash3072 set210 = MuHash3072(elem2).Insert(elem1).Insert(elem0);
+    BOOST_CHECK(FinalizeMuHash(set012) == uint256S("5778cfb45eed42ad501bf4899b033cffde37e70b0746890bf99dd998ba10973e"));
+    BOOST_CHECK(FinalizeMuHash(set210) == FinalizeMuHash(set012));
+
+    // Removing an element undoes its insertion
+    BOOST_CHECK(FinalizeMuHash(MuHash3072(set012).Remove(elem2)) == FinalizeMuHash(MuHash3072(elem0).Insert(elem1)));
+    BOOST_CHECK(FinalizeMuHash(MuHash3072(elem0).Remove(elem0)) == FinalizeMuHash(MuHash3072()));
+
+    // Disjoint sets combine by multiplication
+    MuHash3072 combined(elem0);
+    combined *= MuHash3072(elem1).Insert(elem2);
+    BOOST_CHECK(FinalizeMuHash(combined) == FinalizeMuHash(set012));
+    combined /= MuHash3072(elem2);
+    BOOST_CHECK(FinalizeMuHash(combined) == FinalizeMuHash(MuHash3072(elem0).Insert(elem1)));
+
+    // Serialization keeps the pending division
+    MuHash3072 pending = MuHash3072(set012).Remove(elem1);
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << pending;
+    BOOST_CHECK_EQUAL(ss.size(), 2 * Num3072::BYTE_SIZE);
+    MuHash3072 deserialized;
+    ss >> deserialized;
+    BOOST_CHECK(FinalizeMuHash(deserialized) == FinalizeMuHash(MuHash3072(elem0).Insert(elem2)));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
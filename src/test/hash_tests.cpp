@@ -3,9 +3,11 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
 
+#include <limits>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -47,4 +49,27 @@ BOOST_AUTO_TEST_CASE(murmurhash3)
 #undef T
 }
 
+BOOST_AUTO_TEST_CASE(siphash)
+{
+    // the test vectors of the SipHash-2-4 reference implementation, for the key 00..0f
+    CSipHasher hasher(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0x726fdb47dd0e0e31ull);
+    static const unsigned char t0[1] = {0};
+    hasher.Write(t0, 1);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0x74f839c593dc67fdull);
+    static const unsigned char t1[7] = {1,2,3,4,5,6,7};
+    hasher.Write(t1, 7);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0x93f5f5799a932462ull);
+    hasher.Write(0x0F0E0D0C0B0A0908ULL);
+    BOOST_CHECK_EQUAL(hasher.Finalize(),  0x3f2acc7f57c29bdbull);
+
+    // the uint256 specialization hashes the same as the generic one
+    for (int i = 0; i < 16; i++) {
+        uint256 val = GetRandHash();
+        uint64_t k0 = GetRand(std::numeric_limits<uint64_t>::max());
+        uint64_t k1 = GetRand(std::numeric_limits<uint64_t>::max());
+        BOOST_CHECK_EQUAL(SipHashUint256(k0, k1, val), CSipHasher(k0, k1).Write(val.begin(), 32).Finalize());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -104,4 +104,348 @@ BOOST_AUTO_TEST_CASE(MempoolRemoveTest)
     removedTxs.clear();
 }
 
+template<typename Tag>
+static std::vector<uint256> IndexedHashes(CTxMemPool& pool)
+{
+    LOCK(pool.cs);
+    std::vector<uint256> hashes;
+    for (const CMemPoolIndexEntry& indexEntry : pool.mapIndex.get<Tag>())
+        hashes.push_back(indexEntry.hash);
+    return hashes;
+}
+
+static CMutableTransaction IndexTestTx(const uint256& prevHash, CAmount nValue)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_11;
+    tx.vin[0].prevout.hash = prevHash;
+    tx.vin[0].prevout.n = 0;
+    tx.resizeOut(1);
+    tx.getOut(0).scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+    tx.getOut(0).nValue = nValue;
+    return tx;
+}
+
+BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
+{
+    // Three independent txes of the same size, and a child of the first one paying a high fee
+    CMutableTransaction tx0 = IndexTestTx(uint256(), 10000LL);
+    CMutableTransaction tx1 = IndexTestTx(uint256(), 20000LL);
+    CMutableTransaction tx2 = IndexTestTx(uint256(), 30000LL);
+    CMutableTransaction txChild = IndexTestTx(tx0.GetHash(), 5000LL);
+
+    CTxMemPool testPool(CFeeRate(0));
+    testPool.addUnchecked(tx0.GetHash(), CTxMemPoolEntry(tx0, 1000LL, 10, 0.0, 1));
+    testPool.addUnchecked(tx1.GetHash(), CTxMemPoolEntry(tx1, 3000LL, 5, 0.0, 1));
+    testPool.addUnchecked(tx2.GetHash(), CTxMemPoolEntry(tx2, 2000LL, 20, 0.0, 1));
+    testPool.addUnchecked(txChild.GetHash(), CTxMemPoolEntry(txChild, 10000LL, 30, 0.0, 1));
+    BOOST_CHECK_EQUAL(testPool.mapIndex.size(), 4);
+
+    std::vector<uint256> expectedByFeeRate{txChild.GetHash(), tx1.GetHash(), tx2.GetHash(), tx0.GetHash()};
+    BOOST_CHECK(IndexedHashes<modified_feerate>(testPool) == expectedByFeeRate);
+
+    std::vector<uint256> expectedByTime{tx1.GetHash(), tx0.GetHash(), tx2.GetHash(), txChild.GetHash()};
+    BOOST_CHECK(IndexedHashes<entry_time>(testPool) == expectedByTime);
+
+    // The child pays for its parent
+    const size_t nTxSize = testPool.mapTx[tx0.GetHash()].GetTxSize();
+    {
+        LOCK(testPool.cs);
+        const CMemPoolIndexEntry& childEntry = *testPool.mapIndex.find(txChild.GetHash());
+        BOOST_CHECK_EQUAL(childEntry.nModFeesWithAncestors, 11000LL);
+        BOOST_CHECK_EQUAL(childEntry.nSizeWithAncestors, 2 * nTxSize);
+    }
+    std::vector<uint256> expectedByAncestorScore{txChild.GetHash(), tx1.GetHash(), tx2.GetHash(), tx0.GetHash()};
+    BOOST_CHECK(IndexedHashes<ancestor_score>(testPool) == expectedByAncestorScore);
+
+    // ... and keeps it in the mempool, the cheapest packages being the lone txes
+    {
+        LOCK(testPool.cs);
+        const CMemPoolIndexEntry& parentEntry = *testPool.mapIndex.find(tx0.GetHash());
+        BOOST_CHECK_EQUAL(parentEntry.nModFeesWithDescendants, 11000LL);
+        BOOST_CHECK_EQUAL(parentEntry.nSizeWithDescendants, 2 * nTxSize);
+    }
+    std::vector<uint256> expectedByDescendantScore{tx2.GetHash(), tx1.GetHash(), tx0.GetHash(), txChild.GetHash()};
+    BOOST_CHECK(IndexedHashes<descendant_score>(testPool) == expectedByDescendantScore);
+
+    // Prioritising the parent moves it up and raises the score of the child
+    testPool.PrioritiseTransaction(tx0.GetHash(), tx0.GetHash().ToString(), 0.0, 5000LL);
+    expectedByFeeRate = {txChild.GetHash(), tx0.GetHash(), tx1.GetHash(), tx2.GetHash()};
+    BOOST_CHECK(IndexedHashes<modified_feerate>(testPool) == expectedByFeeRate);
+    {
+        LOCK(testPool.cs);
+        BOOST_CHECK_EQUAL(testPool.mapIndex.find(txChild.GetHash())->nModFeesWithAncestors, 16000LL);
+    }
+
+    // Removing the parent alone, as when it is mined, leaves the child on its own
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    testPool.remove(tx0, removedTxs, removedCerts, false);
+    testPool.ClearPrioritisation(tx0.GetHash());
+    {
+        LOCK(testPool.cs);
+        const CMemPoolIndexEntry& childEntry = *testPool.mapIndex.find(txChild.GetHash());
+        BOOST_CHECK_EQUAL(childEntry.nModFeesWithAncestors, 10000LL);
+        BOOST_CHECK_EQUAL(childEntry.nSizeWithAncestors, nTxSize);
+    }
+
+    // Putting the parent back, as on a reorg, counts it again among the ancestors of the child
+    testPool.addUnchecked(tx0.GetHash(), CTxMemPoolEntry(tx0, 1000LL, 10, 0.0, 1));
+    {
+        LOCK(testPool.cs);
+        BOOST_CHECK_EQUAL(testPool.mapIndex.find(txChild.GetHash())->nModFeesWithAncestors, 11000LL);
+    }
+    removedTxs.clear();
+
+    // Expiring removes the old entries together with their descendants
+    BOOST_CHECK_EQUAL(testPool.Expire(15, removedTxs, removedCerts), 3);
+    BOOST_CHECK_EQUAL(testPool.size(), 1);
+    BOOST_CHECK(testPool.exists(tx2.GetHash()));
+    BOOST_CHECK_EQUAL(testPool.mapIndex.size(), 1);
+    removedTxs.clear();
+
+    // Trimming evicts the lowest fee rate packages first, raising the minimum fee to their fee rate
+    BOOST_CHECK(testPool.GetMinFee(1) == CFeeRate(0));
+    testPool.addUnchecked(tx0.GetHash(), CTxMemPoolEntry(tx0, 1000LL, 10, 0.0, 1));
+    testPool.addUnchecked(tx1.GetHash(), CTxMemPoolEntry(tx1, 3000LL, 5, 0.0, 1));
+    testPool.TrimToSize(testPool.DynamicMemoryUsage() - 1, removedTxs, removedCerts);
+    BOOST_CHECK(!testPool.exists(tx0.GetHash()));
+    BOOST_CHECK(testPool.exists(tx1.GetHash()));
+    BOOST_CHECK(testPool.exists(tx2.GetHash()));
+    BOOST_CHECK(testPool.GetMinFee(1) == CFeeRate(1000LL, nTxSize));
+
+    testPool.TrimToSize(0, removedTxs, removedCerts);
+    BOOST_CHECK_EQUAL(testPool.size(), 0);
+    BOOST_CHECK_EQUAL(testPool.mapIndex.size(), 0);
+    BOOST_CHECK(testPool.GetMinFee(1) == CFeeRate(3000LL, nTxSize));
+
+    // After a block the minimum fee decays, down to zero
+    std::list<CTransaction> conflictingTxs;
+    std::list<CScCertificate> conflictingCerts;
+    testPool.removeForBlock(std::vector<CTransaction>(), 2, conflictingTxs, conflictingCerts);
+    SetMockTime(GetTime() + 30 * CTxMemPool::ROLLING_FEE_HALFLIFE);
+    BOOST_CHECK(testPool.GetMinFee(1) == CFeeRate(0));
+    SetMockTime(0);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolRemoveForConnectedBlockTest)
+{
+    CTxMemPool testPool(CFeeRate(0));
+    CCoinsView dummyBase;
+    CCoinsViewCache view(&dummyBase);
+
+    // A confirmed tx with two outputs, spent by the mempool and the block
+    uint256 confirmedHash = uint256S("aa");
+    {
+        CCoinsModifier coins = view.ModifyCoins(confirmedHash);
+        coins->nVersion = 1;
+        coins->nHeight = 1;
+        coins->vout.resize(2, CTxOut(10000LL, CScript() << OP_11 << OP_EQUAL));
+    }
+
+    CMutableTransaction txConflicting = IndexTestTx(confirmedHash, 9000LL);
+    CMutableTransaction txChild = IndexTestTx(txConflicting.GetHash(), 8000LL);
+    CMutableTransaction txMined = IndexTestTx(confirmedHash, 7000LL);
+    txMined.vin[0].prevout.n = 1;
+    // spending coins which are not in the view, hence stale
+    CMutableTransaction txStale = IndexTestTx(uint256S("bb"), 6000LL);
+
+    testPool.addUnchecked(txConflicting.GetHash(), CTxMemPoolEntry(txConflicting, 0, 0, 0.0, 1));
+    testPool.addUnchecked(txChild.GetHash(), CTxMemPoolEntry(txChild, 0, 0, 0.0, 1));
+    testPool.addUnchecked(txMined.GetHash(), CTxMemPoolEntry(txMined, 0, 0, 0.0, 1));
+    testPool.addUnchecked(txStale.GetHash(), CTxMemPoolEntry(txStale, 0, 0, 0.0, 1));
+    BOOST_CHECK_EQUAL(testPool.size(), 4);
+
+    // The block double spends the first output of the confirmed tx
+    CMutableTransaction txDoubleSpend = IndexTestTx(confirmedHash, 5000LL);
+    std::vector<CTransaction> vtx;
+    vtx.push_back(txDoubleSpend);
+    vtx.push_back(txMined);
+
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    testPool.removeForBlock(vtx, std::vector<CScCertificate>(), 2, &view, removedTxs, removedCerts);
+
+    // The mined tx is not reported, the conflicting one goes with its child, and the stale one too
+    BOOST_CHECK_EQUAL(testPool.size(), 0);
+    BOOST_CHECK_EQUAL(testPool.mapIndex.size(), 0);
+    BOOST_CHECK_EQUAL(removedTxs.size(), 3);
+    BOOST_CHECK(removedCerts.empty());
+    for (const CTransaction& tx : removedTxs)
+        BOOST_CHECK(tx.GetHash() != txMined.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolFeesAddedTest)
+{
+    CTxMemPool testPool(CFeeRate(0));
+    BOOST_CHECK_EQUAL(testPool.GetFeesAdded(), 0);
+
+    CMutableTransaction txParent = IndexTestTx(uint256S("aa"), 9000LL);
+    CMutableTransaction txChild = IndexTestTx(txParent.GetHash(), 8000LL);
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 1000LL, 0, 0.0, 1));
+    testPool.addUnchecked(txChild.GetHash(), CTxMemPoolEntry(txChild, 250LL, 0, 0.0, 1));
+    BOOST_CHECK_EQUAL(testPool.GetFeesAdded(), 1250LL);
+
+    // Fees of removed entries are still accounted for, so that gains can be measured against any past total
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    testPool.remove(txParent, removedTxs, removedCerts, true);
+    BOOST_CHECK_EQUAL(testPool.size(), 0);
+    BOOST_CHECK_EQUAL(testPool.GetFeesAdded(), 1250LL);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolCoinsSnapshotTest)
+{
+    CTxMemPool testPool(CFeeRate(0));
+    CMutableTransaction txParent = IndexTestTx(uint256S("aa"), 9000LL);
+    CMutableTransaction txChild = IndexTestTx(txParent.GetHash(), 8000LL);
+    testPool.addUnchecked(txParent.GetHash(), CTxMemPoolEntry(txParent, 0, 0, 0.0, 1));
+    testPool.addUnchecked(txChild.GetHash(), CTxMemPoolEntry(txChild, 0, 0, 0.0, 1));
+
+    // The same snapshot is shared until the mempool changes
+    std::shared_ptr<const CMemPoolCoinsSnapshot> snapshot = testPool.GetCoinsSnapshot();
+    BOOST_CHECK(testPool.GetCoinsSnapshot() == snapshot);
+    BOOST_CHECK_EQUAL(snapshot->mapTx.size(), 2);
+    BOOST_CHECK_EQUAL(snapshot->setSpent.count(COutPoint(txParent.GetHash(), 0)), 1);
+
+    CCoinsView viewDummy;
+    CCoinsViewMemPoolSnapshot view(&viewDummy, testPool);
+    CCoins coins;
+    BOOST_CHECK(view.HaveCoins(txParent.GetHash()));
+    BOOST_CHECK(view.GetCoins(txParent.GetHash(), coins));
+    BOOST_CHECK(coins.IsAvailable(0));
+    view.PruneSpent(txParent.GetHash(), coins);
+    BOOST_CHECK(!coins.IsAvailable(0));
+    BOOST_CHECK(!view.HaveCoins(uint256S("aa")));
+
+    // A change gives a new snapshot, the views on the previous one are not affected
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    testPool.remove(txChild, removedTxs, removedCerts, true);
+    BOOST_CHECK(testPool.GetCoinsSnapshot() != snapshot);
+    BOOST_CHECK_EQUAL(testPool.GetCoinsSnapshot()->mapTx.size(), 1);
+    BOOST_CHECK_EQUAL(testPool.GetCoinsSnapshot()->setSpent.count(COutPoint(txParent.GetHash(), 0)), 0);
+    BOOST_CHECK(view.HaveCoins(txChild.GetHash()));
+    BOOST_CHECK(!CCoinsViewMemPoolSnapshot(&viewDummy, testPool).HaveCoins(txChild.GetHash()));
+}
+
+BOOST_AUTO_TEST_CASE(MempoolNotifyRecentlyAddedTest)
+{
+    CTxMemPool testPool(CFeeRate(0));
+    CMutableTransaction tx1 = IndexTestTx(uint256S("aa"), 9000LL);
+    CMutableTransaction tx2 = IndexTestTx(uint256S("bb"), 9000LL);
+    CMutableTransaction tx3 = IndexTestTx(uint256S("cc"), 9000LL);
+
+    // the entries added before the scheduler is set ask for a notification at once
+    testPool.addUnchecked(tx1.GetHash(), CTxMemPoolEntry(tx1, 0, 0, 0.0, 1));
+    int nScheduled = 0;
+    testPool.SetNotifyScheduler([&nScheduled]() { nScheduled++; });
+    BOOST_CHECK_EQUAL(nScheduled, 1);
+
+    // one notification for the entries added until it runs
+    testPool.addUnchecked(tx2.GetHash(), CTxMemPoolEntry(tx2, 0, 0, 0.0, 1));
+    BOOST_CHECK_EQUAL(nScheduled, 1);
+    testPool.NotifyRecentlyAdded();
+
+    // the next entry asks for the next batch
+    testPool.addUnchecked(tx3.GetHash(), CTxMemPoolEntry(tx3, 0, 0, 0.0, 1));
+    BOOST_CHECK_EQUAL(nScheduled, 2);
+    testPool.NotifyRecentlyAdded();
+
+    // nothing is asked for with no entry added
+    testPool.NotifyRecentlyAdded();
+    BOOST_CHECK_EQUAL(nScheduled, 2);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolPackageLimitsTest)
+{
+    // A chain of three txes, and a fourth one spending the last
+    CMutableTransaction tx0 = IndexTestTx(uint256(), 10000LL);
+    CMutableTransaction tx1 = IndexTestTx(tx0.GetHash(), 9000LL);
+    CMutableTransaction tx2 = IndexTestTx(tx1.GetHash(), 8000LL);
+    CMutableTransaction tx3 = IndexTestTx(tx2.GetHash(), 7000LL);
+
+    CTxMemPool testPool(CFeeRate(0));
+    testPool.addUnchecked(tx0.GetHash(), CTxMemPoolEntry(tx0, 1000LL, 0, 0.0, 1));
+    testPool.addUnchecked(tx1.GetHash(), CTxMemPoolEntry(tx1, 1000LL, 0, 0.0, 1));
+    testPool.addUnchecked(tx2.GetHash(), CTxMemPoolEntry(tx2, 1000LL, 0, 0.0, 1));
+    const size_t nTxSize = testPool.mapTx[tx0.GetHash()].GetTxSize();
+
+    {
+        LOCK(testPool.cs);
+        BOOST_CHECK_EQUAL(testPool.mapIndex.find(tx0.GetHash())->nCountWithDescendants, 3);
+        BOOST_CHECK_EQUAL(testPool.mapIndex.find(tx0.GetHash())->nCountWithAncestors, 1);
+        BOOST_CHECK_EQUAL(testPool.mapIndex.find(tx1.GetHash())->nCountWithDescendants, 2);
+        BOOST_CHECK_EQUAL(testPool.mapIndex.find(tx2.GetHash())->nCountWithAncestors, 3);
+        BOOST_CHECK_EQUAL(testPool.mapIndex.find(tx2.GetHash())->nSizeWithAncestors, 3 * nTxSize);
+    }
+
+    std::string errString;
+    BOOST_CHECK(testPool.checkPackageLimits(tx3, nTxSize, 0, 0, 0, 0, errString));
+    BOOST_CHECK(testPool.checkPackageLimits(tx3, nTxSize, 4, 4 * nTxSize, 4, 4 * nTxSize, errString));
+    BOOST_CHECK(!testPool.checkPackageLimits(tx3, nTxSize, 3, 0, 0, 0, errString));
+    BOOST_CHECK(!testPool.checkPackageLimits(tx3, nTxSize, 0, 4 * nTxSize - 1, 0, 0, errString));
+    BOOST_CHECK(!testPool.checkPackageLimits(tx3, nTxSize, 0, 0, 3, 0, errString));
+    BOOST_CHECK(!testPool.checkPackageLimits(tx3, nTxSize, 0, 0, 0, 4 * nTxSize - 1, errString));
+
+    // Removing the middle of the chain updates the counts of its ancestors
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    testPool.remove(tx1, removedTxs, removedCerts, true);
+    BOOST_CHECK_EQUAL(removedTxs.size(), 2);
+    {
+        LOCK(testPool.cs);
+        const CMemPoolIndexEntry& rootEntry = *testPool.mapIndex.find(tx0.GetHash());
+        BOOST_CHECK_EQUAL(rootEntry.nCountWithDescendants, 1);
+        BOOST_CHECK_EQUAL(rootEntry.nSizeWithDescendants, nTxSize);
+        BOOST_CHECK_EQUAL(rootEntry.nModFeesWithDescendants, 1000LL);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(MempoolAddressIndexTest)
+{
+    CTxMemPool testPool(CFeeRate(0));
+    CCoinsView dummyBase;
+    CCoinsViewCache view(&dummyBase);
+    bool fAddressIndexOld = fAddressIndex;
+    fAddressIndex = true;
+
+    CKeyID keyId(uint160S("1234"));
+    std::vector<std::pair<uint160, AddressType> > addresses(1, std::make_pair(uint160(keyId), AddressType::PUBKEY));
+
+    // Two outputs to the same address, from a tx without inputs
+    CMutableTransaction tx;
+    tx.resizeOut(2);
+    for (int i = 0; i < 2; i++)
+    {
+        tx.getOut(i).scriptPubKey = CScript() << OP_DUP << OP_HASH160 << ToByteVector(keyId) << OP_EQUALVERIFY << OP_CHECKSIG;
+        tx.getOut(i).nValue = 1000LL * (i + 1);
+    }
+
+    uint64_t nGeneration = testPool.getAddressGeneration(addresses);
+    testPool.addAddressIndex(CTransaction(tx), 100, view);
+
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > deltas;
+    BOOST_CHECK(testPool.getAddressIndex(addresses, deltas));
+    BOOST_CHECK_EQUAL(deltas.size(), 2);
+    BOOST_CHECK(deltas[0].first.txhash == tx.GetHash());
+    BOOST_CHECK_EQUAL(deltas[1].second.amount, 2000LL);
+    BOOST_CHECK_EQUAL(deltas[1].second.time, 100);
+
+    // The generation moved past the one seen before the change, and a wait on the current one times out
+    uint64_t nAdded = testPool.getAddressGeneration(addresses);
+    BOOST_CHECK(nAdded > nGeneration);
+    BOOST_CHECK_EQUAL(testPool.waitForAddressChange(addresses, nGeneration, 0), nAdded);
+    BOOST_CHECK_EQUAL(testPool.waitForAddressChange(addresses, nAdded, 10), nAdded);
+
+    testPool.removeAddressIndex(tx.GetHash());
+    deltas.clear();
+    BOOST_CHECK(testPool.getAddressIndex(addresses, deltas));
+    BOOST_CHECK(deltas.empty());
+    BOOST_CHECK(testPool.getAddressGeneration(addresses) > nAdded);
+
+    fAddressIndex = fAddressIndexOld;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
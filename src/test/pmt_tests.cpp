@@ -77,6 +77,12 @@ BOOST_AUTO_TEST_CASE(pmt_test1)
             CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
             ss << pmt1;
 
+            // the same tree, built from the nodes of the whole merkle tree
+            CPartialMerkleTree pmt1b(block.vMerkleTree, nTx, vMatch);
+            CDataStream ssb(SER_NETWORK, PROTOCOL_VERSION);
+            ssb << pmt1b;
+            BOOST_CHECK(ss.str() == ssb.str());
+
             // verify CPartialMerkleTree's size guarantees
             unsigned int n = std::min<unsigned int>(nTx, 1 + vMatchTxid1.size()*nHeight);
             BOOST_CHECK(ss.size() <= 10 + (258*n+7)/8);
@@ -124,4 +130,28 @@ BOOST_AUTO_TEST_CASE(pmt_malleability)
     BOOST_CHECK(tree.ExtractMatches(vTxid).IsNull());
 }
 
+// The root only computation, sequential and parallel, against the levels of the whole tree
+BOOST_AUTO_TEST_CASE(compute_merkle_root)
+{
+    static const unsigned int nLeafCounts[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 31, 64, 513, 40000};
+    for (unsigned int nLeaves : nLeafCounts) {
+        std::vector<uint256> vLeaves;
+        for (unsigned int j = 0; j < nLeaves; j++)
+            vLeaves.push_back(GetRandHash());
+
+        std::vector<uint256> vMerkleTree(vLeaves);
+        bool fMutatedTree = true, fMutatedRoot = true;
+        const uint256 hashTree = CBlock::BuildMerkleTree(vMerkleTree, vLeaves.size(), &fMutatedTree);
+        BOOST_CHECK(CBlock::ComputeMerkleRoot(vLeaves, &fMutatedRoot) == hashTree);
+        BOOST_CHECK(!fMutatedTree && !fMutatedRoot);
+
+        // an odd number of leaves with the last one repeated has the same root, but is mutated
+        if (nLeaves % 2 == 1) {
+            vLeaves.push_back(vLeaves.back());
+            BOOST_CHECK(CBlock::ComputeMerkleRoot(vLeaves, &fMutatedRoot) == hashTree);
+            BOOST_CHECK(fMutatedRoot);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
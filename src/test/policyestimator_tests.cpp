@@ -185,6 +185,36 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
 }
 
 
+BOOST_AUTO_TEST_CASE(ScTxEstimatesAreSeparate)
+{
+    CTxMemPool mpool(CFeeRate(1000));
+    std::list<CTransaction>   dummyTxs;
+    std::list<CScCertificate> dummyCerts;
+
+    // Transactions with a forward transfer, all of them mined in the next block
+    CMutableTransaction tx;
+    tx.nVersion = SC_TX_VERSION;
+    tx.vin.resize(1);
+    tx.resizeOut(1);
+    tx.vft_ccout.push_back(CTxForwardTransferOut(uint256S("aaa"), CAmount(10), uint256(), uint160()));
+    for (int blocknum = 0; blocknum < 50; ) {
+        std::vector<CTransaction> block;
+        for (int k = 0; k < 5; k++) {
+            tx.vin[0].prevout.n = 100*blocknum+k;
+            uint256 hash = tx.GetHash();
+            mpool.addUnchecked(hash, CTxMemPoolEntry(tx, CAmount(20000), GetTime(), 0, blocknum, mpool.HasNoInputsOf(tx)));
+            CTransaction btx;
+            BOOST_CHECK(mpool.lookup(hash, btx));
+            block.push_back(btx);
+        }
+        mpool.removeForBlock(block, ++blocknum, dummyTxs, dummyCerts);
+    }
+
+    BOOST_CHECK(mpool.estimateScTxFee(1) > CFeeRate(0));
+    BOOST_CHECK(mpool.estimateFee(1) == CFeeRate(0));
+    BOOST_CHECK(mpool.estimateCertificateFee(1) == CFeeRate(0));
+}
+
 BOOST_AUTO_TEST_CASE(TxConfirmStats_FindBucketIndex)
 {
     std::vector<double> buckets {0.0, 3.5, 42.0};
@@ -826,6 +826,126 @@ BOOST_AUTO_TEST_CASE(rpc_wallet_async_operations_parallel_cancel)
     BOOST_CHECK(ids.size()==0);
 }
 
+// The PriorityOperation appends its tag to this global when run
+std::mutex gRunOrderMutex;
+std::vector<int> gRunOrder;
+
+class PriorityOperation : public AsyncRPCOperation {
+public:
+    int priority;
+    int tag;
+    PriorityOperation(int p, int t) : priority(p), tag(t) {}
+    virtual ~PriorityOperation() {}
+    virtual int getPriority() const {
+        return priority;
+    }
+    virtual void main() {
+        set_state(OperationStatus::EXECUTING);
+        {
+            std::lock_guard<std::mutex> guard(gRunOrderMutex);
+            gRunOrder.push_back(tag);
+        }
+        set_state(OperationStatus::SUCCESS);
+    }
+};
+
+// This tests the operations of a higher priority running first, the others in the order they were added
+BOOST_AUTO_TEST_CASE(rpc_wallet_async_operations_priority)
+{
+    gRunOrder.clear();
+
+    std::shared_ptr<AsyncRPCQueue> q = std::make_shared<AsyncRPCQueue>();
+    q->addOperation(std::shared_ptr<AsyncRPCOperation>(new PriorityOperation(0, 1)));
+    q->addOperation(std::shared_ptr<AsyncRPCOperation>(new PriorityOperation(1, 2)));
+    q->addOperation(std::shared_ptr<AsyncRPCOperation>(new PriorityOperation(0, 3)));
+    q->addOperation(std::shared_ptr<AsyncRPCOperation>(new PriorityOperation(2, 4)));
+    BOOST_CHECK(q->getOperationCount() == 4);
+
+    q->addWorker();
+    q->finishAndWait();
+    std::vector<int> expected = {4, 2, 1, 3};
+    BOOST_CHECK(gRunOrder == expected);
+}
+
+// This tests the workers started while operations wait
+BOOST_AUTO_TEST_CASE(rpc_wallet_async_operations_on_demand_workers)
+{
+    gCounter = 0;
+
+    std::shared_ptr<AsyncRPCQueue> q = std::make_shared<AsyncRPCQueue>();
+    q->setMaxWorkers(3);
+    q->addWorker();
+    BOOST_CHECK(q->getNumberOfWorkers() == 1);
+
+    int64_t numOperations = 6;      // 6 * 1000ms / 3 = 2 secs to finish
+    for (int i=0; i<numOperations; i++) {
+        std::shared_ptr<AsyncRPCOperation> op(new CountOperation());
+        q->addOperation(op);
+    }
+    BOOST_CHECK(q->getNumberOfWorkers() == 3);
+
+    q->finishAndWait();
+    BOOST_CHECK_EQUAL(numOperations, gCounter.load());
+}
+
+// This tests the bounds of the finished operations kept
+BOOST_AUTO_TEST_CASE(rpc_wallet_async_operations_result_limits)
+{
+    std::shared_ptr<AsyncRPCQueue> q = std::make_shared<AsyncRPCQueue>();
+    q->setResultLimits(2, 0);
+
+    std::vector<AsyncRPCOperationId> added;
+    for (int i=0; i<4; i++) {
+        std::shared_ptr<AsyncRPCOperation> op = std::make_shared<AsyncRPCOperation>();
+        q->addOperation(op);
+        added.push_back(op->getId());
+    }
+    q->addWorker();
+    q->finishAndWait();
+
+    // the oldest finished are forgotten
+    std::vector<AsyncRPCOperationId> ids = q->getAllOperationIds();
+    std::set<AsyncRPCOperationId> opids(ids.begin(), ids.end());
+    BOOST_CHECK(opids.size() == 2);
+    BOOST_CHECK(opids.count(added[2]) == 1);
+    BOOST_CHECK(opids.count(added[3]) == 1);
+
+    // and so are those older than the ttl
+    std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+    q->setResultLimits(0, 1);
+    BOOST_CHECK(q->getAllOperationIds().size() == 0);
+}
+
+// This tests the calls saved for the operations not started yet
+BOOST_AUTO_TEST_CASE(rpc_wallet_async_operations_pending_requests)
+{
+    std::shared_ptr<AsyncRPCQueue> q = std::make_shared<AsyncRPCQueue>();
+
+    UniValue params(UniValue::VARR);
+    params.push_back("ztaddress");
+    std::shared_ptr<AsyncRPCOperation> op1 = std::make_shared<AsyncRPCOperation>();
+    op1->setRequest("z_sendmany", params);
+    q->addOperation(op1);
+    std::shared_ptr<AsyncRPCOperation> op2 = std::make_shared<AsyncRPCOperation>();
+    q->addOperation(op2);   // no call to save
+    std::shared_ptr<AsyncRPCOperation> op3 = std::make_shared<AsyncRPCOperation>();
+    op3->setRequest("z_shieldcoinbase", params);
+    q->addOperation(op3);
+    op3->cancel();
+    std::shared_ptr<AsyncRPCOperation> op4 = std::make_shared<AsyncRPCOperation>();
+    op4->setRequest("z_mergetoaddress", params, "/wallet/w2.dat");
+    q->addOperation(op4);
+
+    std::vector<AsyncRPCRequest> pending = q->getPendingRequests();
+    BOOST_CHECK(pending.size() == 2);
+    BOOST_CHECK_EQUAL(pending[0].method, "z_sendmany");
+    BOOST_CHECK_EQUAL(pending[0].params.write(), params.write());
+    BOOST_CHECK_EQUAL(pending[0].uri, "/");
+    BOOST_CHECK_EQUAL(pending[1].method, "z_mergetoaddress");
+    BOOST_CHECK_EQUAL(pending[1].uri, "/wallet/w2.dat");
+    q->closeAndWait();
+}
+
 // This tests z_getoperationstatus, z_getoperationresult, z_listoperationids
 BOOST_AUTO_TEST_CASE(rpc_z_getoperations)
 {
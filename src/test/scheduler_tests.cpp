@@ -109,4 +109,77 @@ BOOST_AUTO_TEST_CASE(manythreads)
     BOOST_CHECK_EQUAL(counterSum, 200);
 }
 
+// Records the order of the tasks of a queue and whether two of them ever overlapped
+static void queueTask(boost::mutex& mutex, int& running, int& maxRunning, std::vector<int>& order, int n)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        maxRunning = std::max(maxRunning, ++running);
+    }
+    MicroSleep(200);
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        order.push_back(n);
+        --running;
+    }
+}
+
+static void blockingTask(boost::mutex& mutex, boost::condition_variable& cond, bool& released)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (!released)
+        cond.wait(lock);
+}
+
+BOOST_AUTO_TEST_CASE(namedqueues)
+{
+    CScheduler scheduler;
+    boost::chrono::system_clock::time_point now = boost::chrono::system_clock::now();
+
+    // a queue blocked by its running task does not hold up the others
+    boost::mutex blockMutex;
+    boost::condition_variable blockCond;
+    bool released = false;
+    scheduler.schedule(boost::bind(&blockingTask, boost::ref(blockMutex), boost::ref(blockCond), boost::ref(released)), now, "blocked");
+
+    boost::mutex mutex[2];
+    int running[2] = { 0, 0 };
+    int maxRunning[2] = { 0, 0 };
+    std::vector<int> order[2];
+    const std::string queues[2] = { "a", "b" };
+    for (int n = 0; n < 20; n++)
+        for (int q = 0; q < 2; q++)
+            scheduler.schedule(boost::bind(&queueTask, boost::ref(mutex[q]), boost::ref(running[q]), boost::ref(maxRunning[q]),
+                                           boost::ref(order[q]), n), now + boost::chrono::microseconds(n * 10), queues[q]);
+
+    boost::thread_group threads;
+    for (int i = 0; i < 4; i++)
+        threads.create_thread(boost::bind(&CScheduler::serviceQueue, &scheduler));
+
+    // the other queues are drained while the first task is still running
+    for (int i = 0; i < 1000; i++) {
+        boost::chrono::system_clock::time_point first, last;
+        if (scheduler.getQueueInfo(first, last) == 0)
+            break;
+        MicroSleep(1000);
+    }
+    {
+        boost::unique_lock<boost::mutex> lock(blockMutex);
+        BOOST_CHECK(!released);
+        released = true;
+    }
+    blockCond.notify_all();
+
+    scheduler.stop(true);
+    threads.join_all();
+
+    for (int q = 0; q < 2; q++) {
+        // serial, in order, within a queue
+        BOOST_CHECK_EQUAL(maxRunning[q], 1);
+        BOOST_CHECK_EQUAL(order[q].size(), 20U);
+        for (size_t n = 0; n < order[q].size(); n++)
+            BOOST_CHECK_EQUAL(order[q][n], (int)n);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
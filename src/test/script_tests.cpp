@@ -47,6 +47,7 @@ static const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC;
 
 unsigned int ParseScriptFlags(string strFlags);
 string FormatScriptFlags(unsigned int flags);
+bool CastToBool(const valtype& vch);
 
 UniValue
 read_json(const std::string& jsondata)
@@ -1054,4 +1055,146 @@ BOOST_AUTO_TEST_CASE(script_csw_inputs)
 
 }
 
+/** Accepts a single signature and a single block hash, for any transaction. */
+class StandardTemplateChecker : public BaseSignatureChecker
+{
+public:
+    valtype vchGoodSig;
+    valtype vchGoodPubKey;
+    valtype vchGoodBlockHash;
+
+    bool CheckSig(const valtype& vchSig, const valtype& vchPubKey, const CScript& scriptCode) const
+    {
+        return vchSig == vchGoodSig && vchPubKey == vchGoodPubKey;
+    }
+
+    bool CheckBlockHash(const int32_t nHeight, const valtype& vchBlockHash) const
+    {
+        return nHeight == 100 && vchBlockHash == vchGoodBlockHash;
+    }
+};
+
+// VerifyScript as it is by the opcode loop alone, for the scripts that are not P2SH
+static bool VerifyScriptByEval(const CScript& scriptSig, const CScript& scriptPubKey, unsigned int flags,
+                               const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    if ((flags & SCRIPT_VERIFY_SIGPUSHONLY) != 0 && !scriptSig.IsPushOnly()) {
+        *serror = SCRIPT_ERR_SIG_PUSHONLY;
+        return false;
+    }
+    vector<valtype> stack;
+    if (!EvalScript(stack, scriptSig, flags, checker, serror) || !EvalScript(stack, scriptPubKey, flags, checker, serror))
+        return false;
+    *serror = SCRIPT_ERR_EVAL_FALSE;
+    if (stack.empty() || !CastToBool(stack.back()))
+        return false;
+    *serror = SCRIPT_ERR_CLEANSTACK;
+    if ((flags & SCRIPT_VERIFY_CLEANSTACK) != 0 && stack.size() != 1)
+        return false;
+    *serror = SCRIPT_ERR_OK;
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE(script_standard_templates)
+{
+    // The shortcut of VerifyScript for P2PKH and P2PK, with and without the replay protection, must give
+    // the result and error of the opcode loop for every variation of the templates
+    CKey key, otherKey;
+    key.MakeNewKey(true);
+    otherKey.MakeNewKey(false);
+    const uint256 sighash = uint256S("1234");
+
+    StandardTemplateChecker checker;
+    BOOST_CHECK(key.Sign(sighash, checker.vchGoodSig));
+    checker.vchGoodSig.push_back(SIGHASH_ALL);
+    checker.vchGoodPubKey = ToByteVector(key.GetPubKey());
+    checker.vchGoodBlockHash = ToByteVector(uint256S("abcd"));
+
+    valtype vchOtherSig;
+    BOOST_CHECK(otherKey.Sign(sighash, vchOtherSig));
+    vchOtherSig.push_back(SIGHASH_ALL);
+    valtype vchBadEncodingSig(checker.vchGoodSig);
+    vchBadEncodingSig[0] = 0x31;
+    const valtype vchOtherPubKey = ToByteVector(otherKey.GetPubKey());
+    auto nonMinimalPush = [](const valtype& data) {
+        valtype raw{OP_PUSHDATA1, (unsigned char)data.size()};
+        raw.insert(raw.end(), data.begin(), data.end());
+        return CScript(raw.begin(), raw.end());
+    };
+
+    vector<CScript> replaySuffixes;
+    replaySuffixes.push_back(CScript());
+    replaySuffixes.push_back(CScript() << checker.vchGoodBlockHash << 100 << OP_CHECKBLOCKATHEIGHT);
+    replaySuffixes.push_back(CScript() << ToByteVector(uint256S("dcba")) << 100 << OP_CHECKBLOCKATHEIGHT);
+    replaySuffixes.push_back(CScript() << checker.vchGoodBlockHash << 101 << OP_CHECKBLOCKATHEIGHT);
+    replaySuffixes.push_back(CScript() << checker.vchGoodBlockHash << 5 << OP_CHECKBLOCKATHEIGHT);
+    replaySuffixes.push_back(CScript() << checker.vchGoodBlockHash << -1 << OP_CHECKBLOCKATHEIGHT);
+    replaySuffixes.push_back((CScript() << checker.vchGoodBlockHash) + nonMinimalPush(valtype{100}) + (CScript() << OP_CHECKBLOCKATHEIGHT));
+    replaySuffixes.push_back(CScript() << checker.vchGoodBlockHash << valtype{100, 0} << OP_CHECKBLOCKATHEIGHT);
+    replaySuffixes.push_back(CScript() << checker.vchGoodBlockHash << valtype(5, 1) << OP_CHECKBLOCKATHEIGHT);
+    replaySuffixes.push_back(CScript() << valtype(33, 1) << 100 << OP_CHECKBLOCKATHEIGHT);
+    replaySuffixes.push_back(CScript() << 100 << OP_CHECKBLOCKATHEIGHT);
+    replaySuffixes.push_back(CScript() << checker.vchGoodBlockHash << 100 << OP_CHECKBLOCKATHEIGHT << OP_NOP);
+    replaySuffixes.push_back(CScript() << checker.vchGoodBlockHash << 100 << OP_NOP);
+
+    vector<CScript> scriptPubKeys;
+    for (const CScript& suffix : replaySuffixes) {
+        for (const CScript& script : {
+                CScript() << OP_DUP << OP_HASH160 << ToByteVector(key.GetPubKey().GetID()) << OP_EQUALVERIFY << OP_CHECKSIG,
+                CScript() << OP_DUP << OP_HASH160 << ToByteVector(otherKey.GetPubKey().GetID()) << OP_EQUALVERIFY << OP_CHECKSIG,
+                CScript() << OP_DUP << OP_HASH160 << ToByteVector(key.GetPubKey().GetID()) << OP_EQUAL << OP_CHECKSIG,
+                CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG,
+                CScript() << vchOtherPubKey << OP_CHECKSIG,
+                CScript() << OP_5 << OP_CHECKSIG,
+                CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIGVERIFY}) {
+            scriptPubKeys.push_back(script + suffix);
+        }
+    }
+
+    vector<CScript> scriptSigs;
+    for (const CScript& keyPush : {
+            CScript(),
+            CScript() << checker.vchGoodPubKey,
+            CScript() << vchOtherPubKey,
+            CScript() << OP_5,
+            CScript() << checker.vchGoodPubKey << OP_NOP,
+            CScript() << checker.vchGoodPubKey << OP_0}) {
+        for (const CScript& sigPush : {
+                CScript() << checker.vchGoodSig,
+                CScript() << vchOtherSig,
+                CScript() << vchBadEncodingSig,
+                CScript() << OP_0,
+                CScript() << OP_DUP,
+                nonMinimalPush(checker.vchGoodSig)}) {
+            scriptSigs.push_back(sigPush + keyPush);
+        }
+    }
+
+    const unsigned int testFlags[] = {
+        SCRIPT_VERIFY_NONE,
+        SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC,
+        SCRIPT_VERIFY_CHECKBLOCKATHEIGHT,
+        SCRIPT_VERIFY_MINIMALDATA | SCRIPT_VERIFY_CHECKBLOCKATHEIGHT,
+        SCRIPT_VERIFY_SIGPUSHONLY | SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_CLEANSTACK,
+        STANDARD_NONCONTEXTUAL_SCRIPT_VERIFY_FLAGS,
+        STANDARD_CONTEXTUAL_SCRIPT_VERIFY_FLAGS
+    };
+
+    int nPassed = 0;
+    for (const CScript& scriptPubKey : scriptPubKeys) {
+        for (const CScript& scriptSig : scriptSigs) {
+            for (unsigned int scriptFlags : testFlags) {
+                ScriptError err, errByEval;
+                const bool fResult = VerifyScript(scriptSig, scriptPubKey, scriptFlags, checker, &err);
+                const bool fResultByEval = VerifyScriptByEval(scriptSig, scriptPubKey, scriptFlags, checker, &errByEval);
+                BOOST_CHECK_MESSAGE(fResult == fResultByEval && err == errByEval,
+                                    "scriptSig " << FormatScript(scriptSig) << ", scriptPubKey " << FormatScript(scriptPubKey) <<
+                                    ", flags " << scriptFlags << ": " << ScriptErrorString(err) << " instead of " << ScriptErrorString(errByEval));
+                nPassed += fResult;
+            }
+        }
+    }
+    BOOST_CHECK(nPassed > 0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -346,4 +346,32 @@ BOOST_AUTO_TEST_CASE(insert_delete)
     BOOST_CHECK_EQUAL(ss.size(), 0);
 }
 
+BOOST_AUTO_TEST_CASE(span_writer)
+{
+    std::vector<std::string> vStrings = {"a", std::string(300, 'b'), ""};
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << vStrings << (uint32_t)0x01020304;
+
+    // appended to what the buffer holds, the same bytes as the stream
+    CPlainSerializeData vch(1, 'x');
+    SerializeAppend(vch, vStrings, SER_DISK, PROTOCOL_VERSION);
+    SerializeAppend(vch, (uint32_t)0x01020304, SER_DISK, PROTOCOL_VERSION);
+    BOOST_CHECK_EQUAL(vch.size(), ss.size() + 1);
+    BOOST_CHECK(vch[0] == 'x');
+    BOOST_CHECK(std::equal(ss.begin(), ss.end(), vch.begin() + 1));
+
+    std::vector<std::string> vRead;
+    uint32_t nRead;
+    CSpanReader reader(vch.data() + 1, vch.size() - 1, SER_DISK, PROTOCOL_VERSION);
+    reader >> vRead >> nRead;
+    BOOST_CHECK(reader.empty());
+    BOOST_CHECK(vRead == vStrings);
+    BOOST_CHECK_EQUAL(nRead, 0x01020304);
+
+    // a span too short for the object
+    std::vector<char> vShort(ss.size() - 1);
+    CSpanWriter writer(vShort.data(), vShort.size(), SER_DISK, PROTOCOL_VERSION);
+    BOOST_CHECK_THROW(writer << vStrings << (uint32_t)0x01020304, std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -100,4 +100,196 @@ BOOST_AUTO_TEST_CASE(getlocator_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(findfork_test)
+{
+    // A main chain 10000 blocks long, with a branch of 100 blocks stemming from every 500th block
+    std::vector<CBlockIndex> vBlocksMain(10000);
+    for (unsigned int i=0; i<vBlocksMain.size(); i++) {
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : NULL;
+        vBlocksMain[i].BuildSkip();
+    }
+    std::vector<std::vector<CBlockIndex> > vBranches(vBlocksMain.size() / 500, std::vector<CBlockIndex>(100));
+    for (unsigned int b=0; b<vBranches.size(); b++) {
+        for (unsigned int i=0; i<vBranches[b].size(); i++) {
+            CBlockIndex* pprev = i ? &vBranches[b][i - 1] : &vBlocksMain[b * 500];
+            vBranches[b][i].nHeight = pprev->nHeight + 1;
+            vBranches[b][i].pprev = pprev;
+            vBranches[b][i].BuildSkip();
+        }
+    }
+
+    CChain chain;
+    chain.SetTip(&vBlocksMain.back());
+
+    BOOST_CHECK(chain.FindFork(&vBlocksMain[1234]) == &vBlocksMain[1234]);
+    BOOST_CHECK(chain.FindFork(&vBlocksMain[0]) == &vBlocksMain[0]);
+    for (unsigned int b=0; b<vBranches.size(); b++) {
+        for (int n=0; n<10; n++) {
+            const CBlockIndex* pindex = &vBranches[b][insecure_rand() % vBranches[b].size()];
+            BOOST_CHECK(chain.FindFork(pindex) == &vBlocksMain[b * 500]);
+        }
+    }
+
+    // the fork with a chain shorter than the branch, and with a chain that is the branch itself
+    CChain shortChain;
+    shortChain.SetTip(&vBlocksMain[520]);
+    BOOST_CHECK(shortChain.FindFork(&vBranches[1].back()) == &vBlocksMain[500]);
+    BOOST_CHECK(shortChain.FindFork(&vBranches[2].back()) == &vBlocksMain[520]);
+
+    CChain branchChain;
+    branchChain.SetTip(&vBranches[3][50]);
+    BOOST_CHECK(branchChain.FindFork(&vBranches[3].back()) == &vBranches[3][50]);
+    BOOST_CHECK(branchChain.FindFork(&vBranches[3][10]) == &vBranches[3][10]);
+    BOOST_CHECK(branchChain.FindFork(&vBlocksMain.back()) == &vBlocksMain[1500]);
+
+    // no common block with an empty chain or a disjoint tree
+    CChain emptyChain;
+    BOOST_CHECK(emptyChain.FindFork(&vBlocksMain[100]) == NULL);
+    CBlockIndex disjoint[2];
+    disjoint[0].nHeight = 0;
+    disjoint[1].nHeight = 1;
+    disjoint[1].pprev = &disjoint[0];
+    disjoint[1].BuildSkip();
+    BOOST_CHECK(chain.FindFork(&disjoint[1]) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(chainsnapshot_test)
+{
+    // A main chain 1000 blocks long, and a branch splitting off at block 499, 1000 blocks long.
+    std::vector<CBlockIndex> vBlocksMain(1000);
+    for (unsigned int i=0; i<vBlocksMain.size(); i++) {
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : NULL;
+        vBlocksMain[i].BuildSkip();
+    }
+    std::vector<CBlockIndex> vBlocksSide(1000);
+    for (unsigned int i=0; i<vBlocksSide.size(); i++) {
+        vBlocksSide[i].nHeight = i + 500;
+        vBlocksSide[i].pprev = i ? &vBlocksSide[i - 1] : &vBlocksMain[499];
+        vBlocksSide[i].BuildSkip();
+    }
+
+    CChain chain;
+    chain.SetTip(&vBlocksMain.back());
+    CChainSnapshot snapshot(chain);
+
+    // The chain reorganizes onto the branch, the snapshot still sees the main chain.
+    chain.SetTip(&vBlocksSide.back());
+
+    BOOST_CHECK_EQUAL(snapshot.Height(), 999);
+    BOOST_CHECK(snapshot.Tip() == &vBlocksMain.back());
+    BOOST_CHECK(snapshot.Genesis() == &vBlocksMain[0]);
+    BOOST_CHECK(snapshot[-1] == NULL);
+    BOOST_CHECK(snapshot[1000] == NULL);
+    for (int n=0; n<100; n++) {
+        int nHeight = insecure_rand() % 1000;
+        BOOST_CHECK(snapshot[nHeight] == &vBlocksMain[nHeight]);
+        BOOST_CHECK(snapshot.Contains(&vBlocksMain[nHeight]));
+        BOOST_CHECK(snapshot.Contains(&vBlocksSide[nHeight]) == false);
+        BOOST_CHECK(chain.Contains(&vBlocksMain[nHeight]) == (nHeight < 500));
+    }
+    BOOST_CHECK(snapshot.Next(&vBlocksMain[499]) == &vBlocksMain[500]);
+    BOOST_CHECK(snapshot.Next(&vBlocksSide[0]) == NULL);
+    BOOST_CHECK(snapshot.Next(snapshot.Tip()) == NULL);
+
+    CChainSnapshot empty;
+    BOOST_CHECK_EQUAL(empty.Height(), -1);
+    BOOST_CHECK(empty.Tip() == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(blockhashsnapshot_test)
+{
+    // A main chain 1000 blocks long, and a branch splitting off at block 899, 200 blocks long.
+    std::vector<uint256> vHashesMain(1000), vHashesSide(200);
+    std::vector<CBlockIndex> vBlocksMain(1000);
+    for (unsigned int i=0; i<vBlocksMain.size(); i++) {
+        vHashesMain[i] = GetRandHash();
+        vBlocksMain[i].phashBlock = &vHashesMain[i];
+        vBlocksMain[i].nHeight = i;
+        vBlocksMain[i].pprev = i ? &vBlocksMain[i - 1] : NULL;
+        vBlocksMain[i].BuildSkip();
+    }
+    std::vector<CBlockIndex> vBlocksSide(200);
+    for (unsigned int i=0; i<vBlocksSide.size(); i++) {
+        vHashesSide[i] = GetRandHash();
+        vBlocksSide[i].phashBlock = &vHashesSide[i];
+        vBlocksSide[i].nHeight = i + 900;
+        vBlocksSide[i].pprev = i ? &vBlocksSide[i - 1] : &vBlocksMain[899];
+        vBlocksSide[i].BuildSkip();
+    }
+
+    CChain chain;
+    chain.SetTip(&vBlocksMain[949]);
+    CBlockHashSnapshot snapshot(chain, 100);
+    BOOST_CHECK_EQUAL(snapshot.Height(), 949);
+    BOOST_CHECK_EQUAL(snapshot.GetFirstHeight(), 850);
+    BOOST_CHECK(snapshot.GetBlockHash(950) == NULL);
+    for (int nHeight = 0; nHeight < 950; nHeight++)
+        BOOST_CHECK(*snapshot.GetBlockHash(nHeight) == vHashesMain[nHeight]);
+
+    // The chain moves on, and then reorganizes onto the branch, the hashes still in it are copied.
+    chain.SetTip(&vBlocksMain.back());
+    CBlockHashSnapshot next(chain, 100, &snapshot);
+    BOOST_CHECK_EQUAL(next.GetFirstHeight(), 900);
+    for (int nHeight = 0; nHeight < 1000; nHeight++)
+        BOOST_CHECK(*next.GetBlockHash(nHeight) == vHashesMain[nHeight]);
+
+    chain.SetTip(&vBlocksSide[49]);
+    CBlockHashSnapshot reorged(chain, 100, &next);
+    BOOST_CHECK_EQUAL(reorged.Height(), 949);
+    BOOST_CHECK_EQUAL(reorged.GetFirstHeight(), 850);
+    for (int nHeight = 0; nHeight < 950; nHeight++)
+        BOOST_CHECK(*reorged.GetBlockHash(nHeight) == (nHeight < 900 ? vHashesMain[nHeight] : vHashesSide[nHeight - 900]));
+
+    // None held with no depth, and none at all in an empty chain.
+    CBlockHashSnapshot nodepth(chain, 0);
+    BOOST_CHECK_EQUAL(nodepth.GetFirstHeight(), 950);
+    BOOST_CHECK(*nodepth.GetBlockHash(949) == vHashesSide[49]);
+
+    CChain emptyChain;
+    CBlockHashSnapshot empty(emptyChain, 100, &reorged);
+    BOOST_CHECK_EQUAL(empty.Height(), -1);
+    BOOST_CHECK(empty.GetBlockHash(0) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(blockindexarena_test)
+{
+    CBlockIndexArena arena;
+    BOOST_CHECK_EQUAL(arena.Size(), 0U);
+
+    // more than a chunk, the entries keep their address and content while the arena grows
+    std::vector<CBlockIndex*> vIndex;
+    for (size_t i = 0; i < CBlockIndexArena::CHUNK_SIZE * 2 + 10; i++) {
+        CBlockHeader header;
+        header.nTime = i;
+        CBlockIndex* pindex = arena.Create(header);
+        pindex->nHeight = i;
+        pindex->pprev = vIndex.empty() ? NULL : vIndex.back();
+        pindex->BuildSkip();
+        vIndex.push_back(pindex);
+    }
+    BOOST_CHECK_EQUAL(arena.Size(), vIndex.size());
+
+    for (size_t i = 0; i < vIndex.size(); i++) {
+        BOOST_CHECK(arena.Owns(vIndex[i]));
+        BOOST_CHECK_EQUAL(vIndex[i]->nTime, i);
+        BOOST_CHECK(vIndex[i]->phashBlock == NULL);
+        BOOST_CHECK(vIndex.back()->GetAncestor(i) == vIndex[i]);
+    }
+    // in a row within a chunk
+    BOOST_CHECK(vIndex[1] == vIndex[0] + 1);
+
+    CBlockIndex index;
+    std::unique_ptr<CBlockIndex> pindexAlone(new CBlockIndex());
+    BOOST_CHECK(!arena.Owns(&index));
+    BOOST_CHECK(!arena.Owns(pindexAlone.get()));
+
+    arena.Clear();
+    BOOST_CHECK_EQUAL(arena.Size(), 0U);
+    BOOST_CHECK(!arena.Owns(vIndex[0]));
+    BOOST_CHECK(arena.Create()->nHeight == 0);
+    BOOST_CHECK_EQUAL(arena.Size(), 1U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -754,4 +754,37 @@ BOOST_AUTO_TEST_CASE(test_IsStandardV2)
     verifyTxVersions(CBaseChainParams::MAIN, 455555);
 }
 
+BOOST_AUTO_TEST_CASE(test_cached_serialize_size)
+{
+    CBasicKeyStore keystore;
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins(&coinsDummy);
+    std::vector<CMutableTransaction> dummyTransactions = SetupDummyInputs(keystore, coins);
+
+    for (const CMutableTransaction& mtx : dummyTransactions) {
+        // the size set with the hash is the one of the serialization
+        const CTransaction tx(mtx);
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << tx;
+        BOOST_CHECK_EQUAL(tx.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION), ss.size());
+        BOOST_CHECK_EQUAL(tx.GetSerializeSize(SER_DISK, CLIENT_VERSION), ss.size());
+        BOOST_CHECK_EQUAL(::GetSerializeSize(std::vector<CTransaction>(2, tx), SER_NETWORK, PROTOCOL_VERSION), 1 + 2 * ss.size());
+
+        // the copies and the deserialized transactions keep it
+        CTransaction txRead;
+        ss >> txRead;
+        BOOST_CHECK(txRead == tx);
+        BOOST_CHECK_EQUAL(txRead.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION), tx.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION));
+        CTransaction txCopy;
+        txCopy = tx;
+        BOOST_CHECK_EQUAL(txCopy.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION), tx.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION));
+    }
+
+    // without a hash the size is computed
+    const CTransaction txNull;
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << txNull;
+    BOOST_CHECK_EQUAL(txNull.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION), ss.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
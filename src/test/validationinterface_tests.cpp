@@ -0,0 +1,80 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "validationinterface.h"
+#include "primitives/block.h"
+#include "test/test_bitcoin.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, BasicTestingSetup)
+
+class CRecordingInterface : public CValidationInterface
+{
+public:
+    std::vector<uint256> vTxids;
+    std::vector<bool> vInBlock;
+    std::thread::id threadId;
+
+protected:
+    void SyncTransaction(const CTransaction& tx, const CBlock* pblock) override
+    {
+        vTxids.push_back(tx.GetHash());
+        vInBlock.push_back(pblock != NULL && pblock->vtx.size() == 2);
+        threadId = std::this_thread::get_id();
+    }
+};
+
+BOOST_AUTO_TEST_CASE(async_interface_queue)
+{
+    CBlock block;
+    for (int i = 0; i < 2; i++) {
+        CMutableTransaction mtx;
+        mtx.nLockTime = i;
+        block.vtx.push_back(CTransaction(mtx));
+    }
+    CMutableTransaction mtx;
+    mtx.nLockTime = 2;
+    CTransaction mempoolTx(mtx);
+
+    // not started, the updates are delivered at once
+    CRecordingInterface sync;
+    RegisterValidationInterface(&sync, true);
+    SyncWithWallets(mempoolTx, NULL);
+    BOOST_CHECK_EQUAL(sync.vTxids.size(), 1);
+    BOOST_CHECK(sync.threadId == std::this_thread::get_id());
+    UnregisterValidationInterface(&sync);
+
+    StartValidationInterfaceQueue();
+    CRecordingInterface async;
+    RegisterValidationInterface(&async, true);
+    {
+        // the block can go: the update refers to a copy of it
+        CBlock copy(block);
+        for (const CTransaction& tx : copy.vtx)
+            SyncWithWallets(tx, &copy);
+    }
+    SyncWithWallets(mempoolTx, NULL);
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(GetValidationInterfaceQueueSize(), 0);
+
+    // delivered in order, by the thread of the queue
+    BOOST_CHECK_EQUAL(async.vTxids.size(), 3);
+    BOOST_CHECK(async.vTxids[0] == block.vtx[0].GetHash());
+    BOOST_CHECK(async.vTxids[1] == block.vtx[1].GetHash());
+    BOOST_CHECK(async.vTxids[2] == mempoolTx.GetHash());
+    BOOST_CHECK(async.vInBlock[0] && async.vInBlock[1] && !async.vInBlock[2]);
+    BOOST_CHECK(async.threadId != std::this_thread::get_id());
+
+    UnregisterValidationInterface(&async);
+    SyncWithWallets(mempoolTx, NULL);
+    StopValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(async.vTxids.size(), 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
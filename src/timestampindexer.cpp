@@ -0,0 +1,109 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "timestampindexer.h"
+
+#include "main.h"
+#include "timestampindex.h"
+#include "txdb.h"
+#include "util.h"
+
+#include <algorithm>
+
+//! Name of the block database string holding the hash of the last block of the timestamp index
+static const std::string TIMESTAMP_INDEX_BEST = "timestampindexbest";
+
+CTimestampIndexer* pTimestampIndexer = NULL;
+CTimestampRangeQuery timestampRangeQuery;
+
+CTimestampIndexer::CTimestampIndexer() : CBaseIndexer("timestamp", TIMESTAMP_INDEX_BEST, "horizen-tsindex")
+{
+}
+
+bool CTimestampIndexer::ResetProgress()
+{
+    return CBaseIndexer::ResetProgress(TIMESTAMP_INDEX_BEST);
+}
+
+const CBlockIndex* CTimestampIndexer::GetUnrecordedBest()
+{
+    // an index built while connecting the blocks, before the indexer, is synced to the tip
+    return chainActive.Tip();
+}
+
+bool CTimestampIndexer::LoadBlock(const CBlockIndex* pindex)
+{
+    nBestLogicalTS = 0;
+    return pblocktree->ReadTimestampBlockIndex(pindex->GetBlockHash(), nBestLogicalTS);
+}
+
+bool CTimestampIndexer::WriteBlock(const CBlockIndex* pindex)
+{
+    unsigned int logicalTS = pindex->nTime;
+    unsigned int prevLogicalTS = pindex->pprev != NULL ? nBestLogicalTS : 0;
+
+    if (logicalTS <= prevLogicalTS) {
+        logicalTS = prevLogicalTS + 1;
+        LogPrint("timestampindex", "%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n",
+                 __func__, pindex->nTime, prevLogicalTS, logicalTS);
+    }
+
+    if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
+        return error("%s: failed to write timestamp index", __func__);
+    if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
+        return error("%s: failed to write blockhash index", __func__);
+
+    nBestLogicalTS = logicalTS;
+    return true;
+}
+
+void CTimestampRangeQuery::SyncWithChain()
+{
+    AssertLockHeld(cs_main);
+    if (pindexTip == chainActive.Tip())
+        return;
+
+    const CBlockIndex* pindexFork = pindexTip != NULL ? chainActive.FindFork(pindexTip) : NULL;
+    vLogicalTS.resize(pindexFork != NULL ? pindexFork->nHeight + 1 : 0);
+    vLogicalTS.reserve(chainActive.Height() + 1);
+    for (int nHeight = vLogicalTS.size(); nHeight <= chainActive.Height(); nHeight++) {
+        unsigned int logicalTS = chainActive[nHeight]->nTime;
+        if (nHeight > 0 && logicalTS <= vLogicalTS.back())
+            logicalTS = vLogicalTS.back() + 1;
+        vLogicalTS.push_back(logicalTS);
+    }
+
+    pindexTip = chainActive.Tip();
+    mapCache.clear();
+    dequeCached.clear();
+}
+
+void CTimestampRangeQuery::Query(unsigned int high, unsigned int low, Result& hashes)
+{
+    SyncWithChain();
+
+    const std::pair<unsigned int, unsigned int> key(high, low);
+    std::map<std::pair<unsigned int, unsigned int>, Result>::const_iterator it = mapCache.find(key);
+    if (it != mapCache.end()) {
+        hashes.insert(hashes.end(), it->second.begin(), it->second.end());
+        return;
+    }
+
+    Result result;
+    if (low < high) {
+        std::vector<unsigned int>::const_iterator itBegin = std::lower_bound(vLogicalTS.cbegin(), vLogicalTS.cend(), low);
+        std::vector<unsigned int>::const_iterator itEnd = std::lower_bound(itBegin, vLogicalTS.cend(), high);
+        result.reserve(itEnd - itBegin);
+        for (std::vector<unsigned int>::const_iterator itTS = itBegin; itTS != itEnd; ++itTS)
+            result.push_back(std::make_pair(chainActive[itTS - vLogicalTS.cbegin()]->GetBlockHash(), *itTS));
+    }
+
+    if (dequeCached.size() >= MAX_CACHED_QUERIES) {
+        mapCache.erase(dequeCached.front());
+        dequeCached.pop_front();
+    }
+    dequeCached.push_back(key);
+    hashes.insert(hashes.end(), result.begin(), result.end());
+    mapCache[key].swap(result);
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TIMESTAMPINDEXER_H
+#define BITCOIN_TIMESTAMPINDEXER_H
+
+#include "indexer.h"
+#include "uint256.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+/**
+ * Builds the timestamp index in the background, see CBaseIndexer.
+ *
+ * The index only depends on the block headers: the logical timestamp of a block is its time,
+ * raised above the logical timestamp of its parent if needed.
+ */
+class CTimestampIndexer : public CBaseIndexer
+{
+public:
+    CTimestampIndexer();
+    ~CTimestampIndexer() { Stop(); }
+
+    //! Forget the block the index is synced to, for it to be built from the genesis when (re)enabled
+    static bool ResetProgress();
+
+protected:
+    const CBlockIndex* GetUnrecordedBest() override;
+    bool LoadBlock(const CBlockIndex* pindex) override;
+    bool WriteBlock(const CBlockIndex* pindex) override;
+
+private:
+    //! The logical timestamp of the last block indexed, only accessed by the indexer thread once started
+    unsigned int nBestLogicalTS = 0;
+};
+
+/** The timestamp indexer, running if -timestampindex is enabled */
+extern CTimestampIndexer* pTimestampIndexer;
+
+/**
+ * Answers the timestamp range queries from the active chain in memory, for when the timestamp index is disabled or
+ * still being built.
+ *
+ * The logical timestamps, as the index computes them, are strictly increasing along a chain: they are kept by height
+ * for the active chain, recomputed from the fork point on reorganizations, and the range is found by binary search.
+ * Unlike the index, which keeps the blocks reorganized away, only the blocks of the active chain are known.
+ * The last results are cached until the tip changes. All the methods need cs_main held.
+ */
+class CTimestampRangeQuery
+{
+public:
+    typedef std::vector<std::pair<uint256, unsigned int> > Result;
+
+    //! The blocks of the active chain with a logical timestamp in [low, high), the oldest first, with their timestamps
+    void Query(unsigned int high, unsigned int low, Result& hashes);
+
+private:
+    static const size_t MAX_CACHED_QUERIES = 64;
+
+    //! The logical timestamps of the blocks of the active chain up to pindexTip, by height
+    std::vector<unsigned int> vLogicalTS;
+    const CBlockIndex* pindexTip = nullptr;
+
+    std::map<std::pair<unsigned int, unsigned int>, Result> mapCache;
+    std::deque<std::pair<unsigned int, unsigned int> > dequeCached; /**< the keys of mapCache, the oldest first */
+
+    void SyncWithChain();
+};
+
+/** Guarded by cs_main */
+extern CTimestampRangeQuery timestampRangeQuery;
+
+#endif // BITCOIN_TIMESTAMPINDEXER_H
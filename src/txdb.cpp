@@ -7,16 +7,24 @@
 
 #include "chainparams.h"
 #include "hash.h"
+#include "init.h"
 #include "main.h"
 #include "pow.h"
+#include "ui_interface.h"
 #include "uint256.h"
 
 #include <stdint.h>
 
+#include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
 #include <sc/sidechaintypes.h>
 #include "utilmoneystr.h"
 #include "maturityheightindex.h"
+#include "scactivityindex.h"
+#include "sidechainceasingindex.h"
+#include "pertxoutcoins.h"
+
+#include <atomic>
 
 using namespace std;
 
@@ -30,9 +38,14 @@ static const char DB_TXINDEX = 't';
 
 static const char DB_ADDRESSINDEX = 'D';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSBALANCE = 'K';
 static const char DB_TIMESTAMPINDEX = 'T';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
+static const char DB_BLOCKFILTER = 'G';
+static const char DB_BLOCKFILTERHEADER = 'g';
+static const char DB_SCACTIVITY = 'y';
+static const char DB_SCACTIVITYBLOCK = 'Y';
 
 static const char DB_BLOCK_INDEX = 'b';
 static const char DB_BEST_BLOCK = 'B';
@@ -43,6 +56,16 @@ static const char DB_FAST_REINDEX_FLAG = 'S';
 static const char DB_LAST_BLOCK = 'l';
 static const char DB_CSW_NULLIFIER = 'n';
 static const char DB_MATURITY_HEIGHT = 'h';
+static const char DB_SC_CEASING_HEIGHT = 'e';
+static const char DB_COINS_HEADER = 'C';
+static const char DB_COINS_OUTPUT = 'o';
+static const char DB_COINS_COMMITMENT = 'M';
+static const char DB_COINS_BUCKET_OUTPUT = 'O';
+
+static const std::string SC_CEASING_INDEX_FLAG = "scceasingindex";
+static const std::string PER_TXOUT_COINS_FLAG = "pertxoutcoins";
+static const std::string HEIGHT_BUCKET_COINS_FLAG = "heightbucketcoins";
+static const std::string TXOUTSET_SNAPSHOT_BASE = "txoutsetsnapshot";
 
 
 void static BatchWriteAnchor(CLevelDBBatch &batch,
@@ -71,14 +94,29 @@ void static BatchWriteCoins(CLevelDBBatch &batch, const uint256 &hash, const CCo
         batch.Write(make_pair(DB_COINS, hash), coins);
 }
 
-void static BatchSidechains(CLevelDBBatch &batch, const uint256 &scId, const CSidechainsCacheEntry &sidechain) {
+void static BatchScCeasingIndex(CLevelDBBatch &batch, const uint256 &scId, const CSidechain* pOldSidechain, const CSidechain* pNewSidechain) {
+    int oldHeight = (pOldSidechain && pOldSidechain->isCreationConfirmed()) ? pOldSidechain->GetScheduledCeasingHeight() : -1;
+    int newHeight = (pNewSidechain && pNewSidechain->isCreationConfirmed()) ? pNewSidechain->GetScheduledCeasingHeight() : -1;
+
+    if (oldHeight == newHeight)
+        return;
+
+    if (oldHeight >= 0)
+        batch.Erase(make_pair(DB_SC_CEASING_HEIGHT, CScCeasingHeightKey(oldHeight, scId)));
+    if (newHeight >= 0)
+        batch.Write(make_pair(DB_SC_CEASING_HEIGHT, CScCeasingHeightKey(newHeight, scId)), true);
+}
+
+void static BatchSidechains(CLevelDBBatch &batch, const uint256 &scId, const CSidechainsCacheEntry &sidechain, const CSidechain* pOldSidechain) {
     switch (sidechain.flag) {
         case CSidechainsCacheEntry::Flags::FRESH:
         case CSidechainsCacheEntry::Flags::DIRTY:
             batch.Write(make_pair(DB_SIDECHAINS, scId), sidechain.sidechain);
+            BatchScCeasingIndex(batch, scId, pOldSidechain, &sidechain.sidechain);
             break;
         case CSidechainsCacheEntry::Flags::ERASED:
             batch.Erase(make_pair(DB_SIDECHAINS, scId));
+            BatchScCeasingIndex(batch, scId, pOldSidechain, nullptr);
             break;
         case CSidechainsCacheEntry::Flags::DEFAULT:
         default:
@@ -127,10 +165,267 @@ void static BatchWriteCswNullifier(CLevelDBBatch &batch, const uint256 &scId, co
     }
 }
 
-CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, int maxOpenFiles, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, maxOpenFiles, fMemory, fWipe) {
+CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, int maxOpenFiles, bool fMemory, bool fWipe,
+                           const CLevelDBTuning& tuning) : db(GetDataDir() / dbName, nCacheSize, maxOpenFiles, fMemory, fWipe, tuning) {
+    InitCoinsLayout();
+}
+
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, int maxOpenFiles, bool fMemory, bool fWipe,
+                           const CLevelDBTuning& tuning) : db(GetDataDir() / "chainstate", nCacheSize, maxOpenFiles, fMemory, fWipe, tuning) {
+    InitCoinsLayout();
+}
+
+CCoinsViewDB::~CCoinsViewDB()
+{
+    if (!fAsyncFlush)
+        return;
+
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        fStopFlush = true;
+    }
+    flushCondition.notify_all();
+    flushThread.join();
+}
+
+/**
+ * @brief Makes BatchWrite return as soon as its batch is built, leaving the database write to a
+ * background thread. Only one batch is in flight at a time: the next BatchWrite waits for it.
+ */
+void CCoinsViewDB::StartAsyncFlush()
+{
+    if (fAsyncFlush)
+        return;
+
+    fAsyncFlush = true;
+    flushThread = boost::thread(&CCoinsViewDB::ThreadFlush, this);
+}
+
+void CCoinsViewDB::ThreadFlush()
+{
+    RenameThread("horizen-coinsflush");
+
+    boost::unique_lock<boost::mutex> lock(flushMutex);
+
+    while (true)
+    {
+        while (!pendingBatch && !fStopFlush)
+        {
+            flushCondition.wait(lock);
+        }
+
+        if (!pendingBatch)
+        {
+            // Stop requested and nothing left to write.
+            break;
+        }
+
+        std::unique_ptr<CLevelDBBatch> batch = std::move(pendingBatch);
+        lock.unlock();
+
+        int64_t nStart = GetTimeMicros();
+        bool fOk = false;
+        try {
+            fOk = WriteFlushBatch(*batch);
+        } catch (const std::exception& e) {
+            LogPrintf("%s():%d - error writing the coins database: %s\n", __func__, __LINE__, e.what());
+        }
+
+        lock.lock();
+        if (!fOk)
+        {
+            // The cache the batch comes from has been emptied already: the in-flight entries are the only copy
+            // of the batch left, keep serving the reads from them while the node shuts down. The next BatchWrite
+            // fails, no other batch is handed over.
+            fFlushFailed = true;
+            fFlushInFlight = false;
+            flushCondition.notify_all();
+            lock.unlock();
+
+            strMiscWarning = _("Error: Failed to write to the coins database");
+            LogPrintf("*** %s\n", strMiscWarning);
+            uiInterface.ThreadSafeMessageBox(
+                _("Error: A fatal internal error occurred, see debug.log for details"), "", CClientUIInterface::MSG_ERROR);
+            StartShutdown();
+
+            lock.lock();
+            continue;
+        }
+        LogPrint("coindb", "%s():%d - batch written in %.2fms\n", __func__, __LINE__, (GetTimeMicros() - nStart) * 0.001);
+
+        inFlightCoins.clear();
+        inFlightAnchors.clear();
+        inFlightNullifiers.clear();
+        inFlightSidechains.clear();
+        inFlightSidechainEvents.clear();
+        inFlightCswNullifiers.clear();
+        inFlightBestBlock.SetNull();
+        inFlightBestAnchor.SetNull();
+        fFlushInFlight = false;
+        flushCondition.notify_all();
+    }
+}
+
+bool CCoinsViewDB::WriteFlushBatch(CLevelDBBatch& batch)
+{
+    return db.WriteBatch(batch);
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, int maxOpenFiles, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, maxOpenFiles, fMemory, fWipe) {
+bool CCoinsViewDB::WaitForFlush() const
+{
+    boost::unique_lock<boost::mutex> lock(flushMutex);
+    while (fFlushInFlight)
+    {
+        flushCondition.wait(lock);
+    }
+    return !fFlushFailed;
+}
+
+bool CCoinsViewDB::Sync()
+{
+    return WaitForFlush();
+}
+
+void CCoinsViewDB::InitCoinsLayout()
+{
+    fPerTxOutCoins = false;
+    db.Read(make_pair(DB_FLAG, PER_TXOUT_COINS_FLAG), fPerTxOutCoins);
+    fLegacyCoinsLeft = fPerTxOutCoins && HasRecords(DB_COINS);
+    fHeightBucketCoins = false;
+    if (fPerTxOutCoins)
+        db.Read(make_pair(DB_FLAG, HEIGHT_BUCKET_COINS_FLAG), fHeightBucketCoins);
+    fUnbucketedOutputsLeft = fHeightBucketCoins && HasRecords(DB_COINS_OUTPUT);
+}
+
+bool CCoinsViewDB::HasRecords(char chType) const
+{
+    std::unique_ptr<leveldb::Iterator> it(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << chType;
+    it->Seek(ssKeySet.str());
+
+    return it->Valid() && it->key().size() > 0 && it->key()[0] == chType;
+}
+
+void CCoinsViewDB::ReadCoinsOutputs(const uint256 &txid, std::map<uint32_t, std::string>& outputs) const
+{
+    std::unique_ptr<leveldb::Iterator> it(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair(DB_COINS_OUTPUT, CCoinsOutputKey(txid, 0));
+
+    for (it->Seek(ssKeySet.str()); it->Valid(); it->Next())
+    {
+        leveldb::Slice slKey = it->key();
+        CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+
+        char chType;
+        ssKey >> chType;
+        if (chType != DB_COINS_OUTPUT)
+            break;
+
+        CCoinsOutputKey outputKey;
+        ssKey >> outputKey;
+        if (outputKey.txid != txid)
+            break;
+
+        outputs[outputKey.n] = it->value().ToString();
+    }
+}
+
+void CCoinsViewDB::ReadBucketOutputs(uint32_t nBucket, const uint256 &txid, std::map<uint32_t, std::string>& outputs) const
+{
+    std::unique_ptr<leveldb::Iterator> it(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair(DB_COINS_BUCKET_OUTPUT, CCoinsBucketOutputKey(nBucket, txid, 0));
+    // The type, the bucket and the txid
+    const std::string strPrefix = ssKeySet.str().substr(0, 37);
+
+    for (it->Seek(ssKeySet.str()); it->Valid() && it->key().starts_with(strPrefix); it->Next())
+    {
+        leveldb::Slice slKey = it->key();
+        CDataStream ssKey(slKey.data() + 1, slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+        CCoinsBucketOutputKey outputKey;
+        ssKey >> outputKey;
+        outputs[outputKey.output.n] = it->value().ToString();
+    }
+}
+
+/**
+ * @brief Writes a cache entry in the per-output layout. Only the outputs whose persisted record
+ * differs from the cached one are written or erased, so spending a single output of a large
+ * transaction or certificate deletes a single record. With the height buckets, the outputs are
+ * moved altogether when the height of the coins changes bucket.
+ */
+void CCoinsViewDB::BatchWritePerTxOutCoins(CLevelDBBatch &batch, const uint256 &txid, const CCoinsCacheEntry &entry) const
+{
+    const CCoins& coins = entry.coins;
+    const uint32_t nBucket = CoinsHeightBucket(coins.nHeight);
+
+    // Fresh entries have no persisted record, neither per output nor legacy
+    std::map<uint32_t, std::string> storedOutputs;
+    if (!(entry.flags & CCoinsCacheEntry::FRESH)) {
+        if (fHeightBucketCoins) {
+            CCoinsHeader storedHeader;
+            if (db.Read(make_pair(DB_COINS_HEADER, txid), storedHeader)) {
+                const uint32_t nStoredBucket = CoinsHeightBucket(storedHeader.nHeight);
+                ReadBucketOutputs(nStoredBucket, txid, storedOutputs);
+                if (nStoredBucket != nBucket) {
+                    for (const std::pair<const uint32_t, std::string>& output : storedOutputs)
+                        batch.Erase(make_pair(DB_COINS_BUCKET_OUTPUT, CCoinsBucketOutputKey(nStoredBucket, txid, output.first)));
+                    storedOutputs.clear();
+                }
+            }
+            // The outputs not moved yet are written again below, in their bucket
+            if (fUnbucketedOutputsLeft) {
+                std::map<uint32_t, std::string> unbucketedOutputs;
+                ReadCoinsOutputs(txid, unbucketedOutputs);
+                for (const std::pair<const uint32_t, std::string>& output : unbucketedOutputs)
+                    batch.Erase(make_pair(DB_COINS_OUTPUT, CCoinsOutputKey(txid, output.first)));
+            }
+        } else {
+            ReadCoinsOutputs(txid, storedOutputs);
+        }
+        if (fLegacyCoinsLeft)
+            batch.Erase(make_pair(DB_COINS, txid));
+    }
+
+    auto EraseOutput = [&](uint32_t n) {
+        if (fHeightBucketCoins)
+            batch.Erase(make_pair(DB_COINS_BUCKET_OUTPUT, CCoinsBucketOutputKey(nBucket, txid, n)));
+        else
+            batch.Erase(make_pair(DB_COINS_OUTPUT, CCoinsOutputKey(txid, n)));
+    };
+
+    if (coins.IsPruned())
+        batch.Erase(make_pair(DB_COINS_HEADER, txid));
+    else
+        batch.Write(make_pair(DB_COINS_HEADER, txid), CCoinsHeader(coins));
+
+    for (unsigned int n = 0; n < coins.vout.size(); n++) {
+        std::map<uint32_t, std::string>::iterator itStored = storedOutputs.find(n);
+        if (coins.vout[n].IsNull()) {
+            if (itStored != storedOutputs.end())
+                EraseOutput(n);
+            continue;
+        }
+
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue << CTxOutCompressor(REF(coins.vout[n]));
+        if (itStored != storedOutputs.end() && itStored->second == ssValue.str())
+            continue;
+        if (fHeightBucketCoins)
+            batch.Write(make_pair(DB_COINS_BUCKET_OUTPUT, CCoinsBucketOutputKey(nBucket, txid, n)), CTxOutCompressor(REF(coins.vout[n])));
+        else
+            batch.Write(make_pair(DB_COINS_OUTPUT, CCoinsOutputKey(txid, n)), CTxOutCompressor(REF(coins.vout[n])));
+    }
+
+    // Trailing spent outputs are dropped from vout by CCoins::Cleanup
+    for (std::map<uint32_t, std::string>::const_iterator itStored = storedOutputs.lower_bound(coins.vout.size());
+         itStored != storedOutputs.end(); ++itStored)
+        EraseOutput(itStored->first);
 }
 
 
@@ -141,12 +436,29 @@ bool CCoinsViewDB::GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tree)
         return true;
     }
 
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        CAnchorsMap::const_iterator it = inFlightAnchors.find(rt);
+        if (it != inFlightAnchors.end()) {
+            if (it->second.entered)
+                tree = it->second.tree;
+            return it->second.entered;
+        }
+    }
+
     bool read = db.Read(make_pair(DB_ANCHOR, rt), tree);
 
     return read;
 }
 
 bool CCoinsViewDB::GetNullifier(const uint256 &nf) const {
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        CNullifiersMap::const_iterator it = inFlightNullifiers.find(nf);
+        if (it != inFlightNullifiers.end())
+            return it->second.entered;
+    }
+
     bool spent = false;
     bool read = db.Read(make_pair(DB_NULLIFIER, nf), spent);
 
@@ -154,35 +466,136 @@ bool CCoinsViewDB::GetNullifier(const uint256 &nf) const {
 }
 
 bool CCoinsViewDB::GetCoins(const uint256 &txid, CCoins &coins) const {
-    return db.Read(make_pair(DB_COINS, txid), coins);
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        CCoinsMap::const_iterator it = inFlightCoins.find(txid);
+        if (it != inFlightCoins.end()) {
+            if (it->second.coins.IsPruned())
+                return false;
+            coins = it->second.coins;
+            return true;
+        }
+    }
+
+    if (!fPerTxOutCoins)
+        return db.Read(make_pair(DB_COINS, txid), coins);
+
+    CCoinsHeader header;
+    if (!db.Read(make_pair(DB_COINS_HEADER, txid), header))
+        return fLegacyCoinsLeft && db.Read(make_pair(DB_COINS, txid), coins);
+
+    header.ToCoins(coins);
+    std::map<uint32_t, std::string> storedOutputs;
+    if (fHeightBucketCoins)
+        ReadBucketOutputs(CoinsHeightBucket(header.nHeight), txid, storedOutputs);
+    if (!fHeightBucketCoins || fUnbucketedOutputsLeft)
+        ReadCoinsOutputs(txid, storedOutputs);
+    for (const std::pair<const uint32_t, std::string>& output : storedOutputs) {
+        if (output.first >= coins.vout.size())
+            return error("%s: output %u of %s beyond its header size %u", __func__, output.first, txid.ToString(), coins.vout.size());
+        CDataStream ssValue(output.second.data(), output.second.data() + output.second.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> REF(CTxOutCompressor(coins.vout[output.first]));
+    }
+    coins.Cleanup();
+    return true;
 }
 
 bool CCoinsViewDB::HaveCoins(const uint256 &txid) const {
-    return db.Exists(make_pair(DB_COINS, txid));
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        CCoinsMap::const_iterator it = inFlightCoins.find(txid);
+        if (it != inFlightCoins.end())
+            return !it->second.coins.IsPruned();
+    }
+
+    if (!fPerTxOutCoins)
+        return db.Exists(make_pair(DB_COINS, txid));
+
+    return db.Exists(make_pair(DB_COINS_HEADER, txid)) || (fLegacyCoinsLeft && db.Exists(make_pair(DB_COINS, txid)));
 }
 
 bool CCoinsViewDB::GetSidechain(const uint256& scId, CSidechain& info) const
 {
-    return db.Read(std::make_pair(DB_SIDECHAINS, scId), info);
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        CSidechainsMap::const_iterator it = inFlightSidechains.find(scId);
+        if (it != inFlightSidechains.end()) {
+            if (it->second.flag == CSidechainsCacheEntry::Flags::ERASED)
+                return false;
+            info = it->second.sidechain;
+            return true;
+        }
+    }
+
+    if (!db.Read(std::make_pair(DB_SIDECHAINS, scId), info))
+        return false;
+
+    info.InternFixedParams(scId);
+    return true;
 }
 
 bool CCoinsViewDB::HaveSidechain(const uint256& scId) const
 {
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        CSidechainsMap::const_iterator it = inFlightSidechains.find(scId);
+        if (it != inFlightSidechains.end())
+            return it->second.flag != CSidechainsCacheEntry::Flags::ERASED;
+    }
+
     return db.Exists(std::make_pair(DB_SIDECHAINS, scId));
 }
 
+bool CCoinsViewDB::MayHaveSidechainEvents(int height) const
+{
+    // the caller holds flushMutex
+    if (!fSidechainEventsHeights)
+        return true;
+    return height >= 0 && height < (int)vSidechainEventsHeights.size() && vSidechainEventsHeights[height];
+}
+
 bool CCoinsViewDB::HaveSidechainEvents(int height) const
 {
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        CSidechainEventsMap::const_iterator it = inFlightSidechainEvents.find(height);
+        if (it != inFlightSidechainEvents.end())
+            return it->second.flag != CSidechainEventsCacheEntry::Flags::ERASED;
+        // Heights written by BatchWrite are set in the bitmap, so a negative answer is final
+        if (!MayHaveSidechainEvents(height))
+            return false;
+    }
+
     return db.Exists(std::make_pair(DB_CEASEDSCS, height));
 }
 
 bool CCoinsViewDB::GetSidechainEvents(int height, CSidechainEvents& ceasingScs) const
 {
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        CSidechainEventsMap::const_iterator it = inFlightSidechainEvents.find(height);
+        if (it != inFlightSidechainEvents.end()) {
+            if (it->second.flag == CSidechainEventsCacheEntry::Flags::ERASED)
+                return false;
+            ceasingScs = it->second.scEvents;
+            return true;
+        }
+        if (!MayHaveSidechainEvents(height))
+            return false;
+    }
+
     return db.Read(std::make_pair(DB_CEASEDSCS, height), ceasingScs);
 }
 
 void CCoinsViewDB::GetScIds(std::set<uint256>& scIdsList) const
 {
+    // Copied before reading the database, which may meanwhile receive the in-flight batch
+    CSidechainsMap sidechainsInFlight;
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        sidechainsInFlight = inFlightSidechains;
+    }
+
     std::unique_ptr<leveldb::Iterator> it(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
     static const std::string scIdsPrefix = std::string(1,DB_SIDECHAINS);
 
@@ -198,10 +611,339 @@ void CCoinsViewDB::GetScIds(std::set<uint256>& scIdsList) const
         scIdsList.insert(keyScId);
     }
 
+    for (const auto& entry : sidechainsInFlight)
+    {
+        if (entry.second.flag == CSidechainsCacheEntry::Flags::ERASED)
+            scIdsList.erase(entry.first);
+        else
+            scIdsList.insert(entry.first);
+    }
+
     return;
 }
 
+void CCoinsViewDB::GetScIdsByCeasingHeight(int minHeight, int maxHeight, std::set<uint256>& scIdsList) const
+{
+    // Copied before reading the database, which may meanwhile receive the in-flight batch
+    CSidechainsMap sidechainsInFlight;
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        sidechainsInFlight = inFlightSidechains;
+    }
+
+    std::unique_ptr<leveldb::Iterator> it(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair(DB_SC_CEASING_HEIGHT, CScCeasingHeightKey(std::max(minHeight, 0), uint256()));
+
+    for (it->Seek(ssKeySet.str()); it->Valid(); it->Next())
+    {
+        boost::this_thread::interruption_point();
+
+        leveldb::Slice slKey = it->key();
+        CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+
+        char chType;
+        ssKey >> chType;
+        if (chType != DB_SC_CEASING_HEIGHT)
+            break;
+
+        CScCeasingHeightKey indexKey;
+        ssKey >> indexKey;
+        if (indexKey.ceasingHeight > maxHeight)
+            break;
+
+        scIdsList.insert(indexKey.scId);
+    }
+
+    // In-flight sidechains override the persisted ones, whose ceasing height may have changed
+    for (const auto& entry : sidechainsInFlight)
+    {
+        scIdsList.erase(entry.first);
+
+        if (entry.second.flag == CSidechainsCacheEntry::Flags::ERASED || !entry.second.sidechain.isCreationConfirmed())
+            continue;
+
+        int ceasingHeight = entry.second.sidechain.GetScheduledCeasingHeight();
+
+        if (ceasingHeight >= minHeight && ceasingHeight <= maxHeight)
+            scIdsList.insert(entry.first);
+    }
+}
+
+/**
+ * @brief Builds the index of sidechains by ceasing height, if the database has been created
+ * by a version not maintaining it yet. It is a no-op for databases already having it.
+ *
+ * @return true if the index is available.
+ */
+bool CCoinsViewDB::BuildScCeasingIndex()
+{
+    bool fBuilt = false;
+    if (db.Read(make_pair(DB_FLAG, SC_CEASING_INDEX_FLAG), fBuilt) && fBuilt)
+        return true;
+
+    std::set<uint256> scIds;
+    GetScIds(scIds);
+
+    LogPrintf("%s():%d - building the sidechains ceasing height index for %d sidechains\n", __func__, __LINE__, scIds.size());
+
+    CLevelDBBatch batch;
+    for (const uint256& scId : scIds)
+    {
+        CSidechain sidechain;
+        if (GetSidechain(scId, sidechain))
+            BatchScCeasingIndex(batch, scId, nullptr, &sidechain);
+    }
+    batch.Write(make_pair(DB_FLAG, SC_CEASING_INDEX_FLAG), true);
+
+    return db.WriteBatch(batch, true);
+}
+
+/**
+ * @brief Builds the CSW nullifiers filter from the database and starts consulting it in HaveCswNullifier.
+ * Must be called before any BatchWrite is in flight.
+ *
+ * @return true if all the nullifiers could be read.
+ */
+bool CCoinsViewDB::LoadCswNullifierFilter()
+{
+    cswNullifierFilter.Clear();
+
+    std::unique_ptr<leveldb::Iterator> it(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << DB_CSW_NULLIFIER;
+
+    size_t nLoaded = 0;
+    for (it->Seek(ssKeySet.str()); it->Valid(); it->Next()) {
+        boost::this_thread::interruption_point();
+
+        leveldb::Slice slKey = it->key();
+        CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+        char chType;
+        ssKey >> chType;
+        if (chType != DB_CSW_NULLIFIER)
+            break;
+
+        std::pair<uint256, CFieldElement> position;
+        try {
+            ssKey >> position;
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+        cswNullifierFilter.Insert(position.first, position.second);
+        ++nLoaded;
+    }
+
+    LogPrintf("%s():%d - loaded %d CSW nullifiers into the filter\n", __func__, __LINE__, nLoaded);
+    fCswNullifierFilter = true;
+    return true;
+}
+
+/**
+ * @brief Builds the bitmap of the heights having sidechain events from the database and starts consulting
+ * it in HaveSidechainEvents and GetSidechainEvents. Must be called before any BatchWrite is in flight.
+ *
+ * @return true if all the heights could be read.
+ */
+bool CCoinsViewDB::LoadSidechainEventsHeights()
+{
+    std::vector<bool> vHeights;
+
+    std::unique_ptr<leveldb::Iterator> it(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << DB_CEASEDSCS;
+
+    size_t nLoaded = 0;
+    for (it->Seek(ssKeySet.str()); it->Valid(); it->Next()) {
+        boost::this_thread::interruption_point();
+
+        leveldb::Slice slKey = it->key();
+        CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+        char chType;
+        ssKey >> chType;
+        if (chType != DB_CEASEDSCS)
+            break;
+
+        int height;
+        try {
+            ssKey >> height;
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+        if (height < 0)
+            return error("%s: invalid sidechain events height %d", __func__, height);
+        if (height >= (int)vHeights.size())
+            vHeights.resize(height + 1);
+        vHeights[height] = true;
+        ++nLoaded;
+    }
+
+    LogPrintf("%s():%d - loaded %d heights with sidechain events\n", __func__, __LINE__, nLoaded);
+    boost::unique_lock<boost::mutex> lock(flushMutex);
+    vSidechainEventsHeights.swap(vHeights);
+    fSidechainEventsHeights = true;
+    return true;
+}
+
+/**
+ * @brief Moves the chainstate to the per-output coins layout. The layout flag is persisted before
+ * converting any record and both layouts are readable meanwhile, so an interrupted upgrade is
+ * simply resumed at the next start. The legacy layout is not restored: downgrading requires a reindex.
+ *
+ * @return true if the whole coins set is in the per-output layout.
+ */
+bool CCoinsViewDB::UpgradeToPerTxOutCoins()
+{
+    if (!fPerTxOutCoins) {
+        if (!db.Write(make_pair(DB_FLAG, PER_TXOUT_COINS_FLAG), true, true))
+            return false;
+        fPerTxOutCoins = true;
+        fLegacyCoinsLeft = HasRecords(DB_COINS);
+    }
+
+    if (!fLegacyCoinsLeft)
+        return true;
+
+    LogPrintf("%s():%d - converting the coins database to the per-output layout\n", __func__, __LINE__);
+
+    static const size_t UPGRADE_BATCH_RECORDS = 10000;
+    size_t nConverted = 0;
+    while (true) {
+        boost::this_thread::interruption_point();
+
+        std::unique_ptr<leveldb::Iterator> it(db.NewIterator());
+        CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+        ssKeySet << DB_COINS;
+
+        CLevelDBBatch batch;
+        size_t nBatched = 0;
+        for (it->Seek(ssKeySet.str()); it->Valid() && nBatched < UPGRADE_BATCH_RECORDS; it->Next()) {
+            leveldb::Slice slKey = it->key();
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            ssKey >> chType;
+            if (chType != DB_COINS)
+                break;
+
+            uint256 txid;
+            ssKey >> txid;
+            leveldb::Slice slValue = it->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            CCoinsCacheEntry entry;
+            try {
+                ssValue >> entry.coins;
+            } catch (const std::exception& e) {
+                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            }
+
+            // The legacy record is the only one for this txid
+            entry.flags = CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH;
+            BatchWritePerTxOutCoins(batch, txid, entry);
+            batch.Erase(make_pair(DB_COINS, txid));
+            nBatched++;
+        }
+        it.reset();
+
+        if (nBatched == 0)
+            break;
+        if (!db.WriteBatch(batch))
+            return false;
+        nConverted += nBatched;
+        LogPrint("coindb", "%s():%d - converted %u transactions\n", __func__, __LINE__, nConverted);
+    }
+
+    fLegacyCoinsLeft = false;
+    LogPrintf("%s():%d - converted %u transactions to the per-output layout\n", __func__, __LINE__, nConverted);
+    return db.Sync();
+}
+
+/**
+ * @brief Moves the outputs of the per-output layout under the bucket of the creation height of their
+ * coins, upgrading to the per-output layout first if needed. As for that upgrade, the flag is persisted
+ * first and the outputs are looked up in both places meanwhile, so an interrupted upgrade is resumed
+ * at the next start; going back requires a reindex.
+ *
+ * @return true if all the outputs are in their height bucket.
+ */
+bool CCoinsViewDB::UpgradeToHeightBucketCoins()
+{
+    if (!UpgradeToPerTxOutCoins())
+        return false;
+
+    if (!fHeightBucketCoins) {
+        if (!db.Write(make_pair(DB_FLAG, HEIGHT_BUCKET_COINS_FLAG), true, true))
+            return false;
+        fHeightBucketCoins = true;
+        fUnbucketedOutputsLeft = HasRecords(DB_COINS_OUTPUT);
+    }
+
+    if (!fUnbucketedOutputsLeft)
+        return true;
+
+    LogPrintf("%s():%d - moving the coins outputs to their height buckets\n", __func__, __LINE__);
+
+    static const size_t UPGRADE_BATCH_RECORDS = 10000;
+    size_t nMoved = 0;
+    while (true) {
+        boost::this_thread::interruption_point();
+
+        std::unique_ptr<leveldb::Iterator> it(db.NewIterator());
+        CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+        ssKeySet << DB_COINS_OUTPUT;
+
+        CLevelDBBatch batch;
+        size_t nBatched = 0;
+        uint256 txidHeader;
+        CCoinsHeader header;
+        for (it->Seek(ssKeySet.str()); it->Valid() && nBatched < UPGRADE_BATCH_RECORDS; it->Next()) {
+            leveldb::Slice slKey = it->key();
+            if (slKey.size() == 0 || slKey[0] != DB_COINS_OUTPUT)
+                break;
+
+            CCoinsOutputKey outputKey;
+            try {
+                CDataStream ssKey(slKey.data() + 1, slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+                ssKey >> outputKey;
+            } catch (const std::exception& e) {
+                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            }
+
+            // The outputs of a txid are consecutive, their header is read once
+            if (nBatched == 0 || outputKey.txid != txidHeader) {
+                if (!db.Read(make_pair(DB_COINS_HEADER, outputKey.txid), header))
+                    return error("%s: output of %s without header", __func__, outputKey.txid.ToString());
+                txidHeader = outputKey.txid;
+            }
+
+            CDataStream ssNewKey(SER_DISK, CLIENT_VERSION);
+            ssNewKey << make_pair(DB_COINS_BUCKET_OUTPUT, CCoinsBucketOutputKey(CoinsHeightBucket(header.nHeight), outputKey.txid, outputKey.n));
+            batch.WriteRaw(ssNewKey.str(), it->value());
+            batch.EraseRaw(slKey);
+            nBatched++;
+        }
+        it.reset();
+
+        if (nBatched == 0)
+            break;
+        if (!db.WriteBatch(batch))
+            return false;
+        nMoved += nBatched;
+        LogPrint("coindb", "%s():%d - moved %u outputs\n", __func__, __LINE__, nMoved);
+    }
+
+    fUnbucketedOutputsLeft = false;
+    LogPrintf("%s():%d - moved %u outputs to their height buckets\n", __func__, __LINE__, nMoved);
+    return db.Sync();
+}
+
 uint256 CCoinsViewDB::GetBestBlock() const {
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        if (!inFlightBestBlock.IsNull())
+            return inFlightBestBlock;
+    }
+
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -209,6 +951,12 @@ uint256 CCoinsViewDB::GetBestBlock() const {
 }
 
 uint256 CCoinsViewDB::GetBestAnchor() const {
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        if (!inFlightBestAnchor.IsNull())
+            return inFlightBestAnchor;
+    }
+
     uint256 hashBestAnchor;
     if (!db.Read(DB_BEST_ANCHOR, hashBestAnchor))
         return ZCIncrementalMerkleTree::empty_root();
@@ -217,6 +965,18 @@ uint256 CCoinsViewDB::GetBestAnchor() const {
 
 bool CCoinsViewDB::HaveCswNullifier(const uint256& scId, const CFieldElement &nullifier) const {
     std::pair<uint256, CFieldElement> position = std::make_pair(scId, nullifier);
+
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        CCswNullifiersMap::const_iterator it = inFlightCswNullifiers.find(position);
+        if (it != inFlightCswNullifiers.end())
+            return it->second.flag != CCswNullifiersCacheEntry::Flags::ERASED;
+    }
+
+    // Nullifiers written by BatchWrite are inserted into the filter, so a negative answer is final
+    if (fCswNullifierFilter && !cswNullifierFilter.MaybeContains(scId, nullifier))
+        return false;
+
     return db.Exists(make_pair(DB_CSW_NULLIFIER, position));
 }
 
@@ -228,45 +988,102 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
                               CSidechainsMap& mapSidechains,
                               CSidechainEventsMap& mapSidechainEvents,
                               CCswNullifiersMap& cswNullifies) {
-    CLevelDBBatch batch;
+    // Only one batch is in flight: the entries to be written are read from the database below
+    if (fAsyncFlush && !WaitForFlush())
+        return false;
+
+    // In asynchronous mode the written entries are kept, to serve reads until the batch is persisted
+    std::unique_ptr<CLevelDBBatch> pbatch(new CLevelDBBatch());
+    CLevelDBBatch& batch = *pbatch;
     size_t count = 0;
     size_t changed = 0;
+    // The commitment is updated on a copy, published once the batch is handed over
+    std::unique_ptr<CCoinsSetCommitment> pcommitment;
+    if (fCoinsCommitment)
+        pcommitment.reset(new CCoinsSetCommitment(coinsCommitment));
     for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
-        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
-            BatchWriteCoins(batch, it->first, it->second.coins);
+        bool fWritten = it->second.flags & CCoinsCacheEntry::DIRTY;
+        if (fWritten) {
+            if (pcommitment) {
+                CCoins oldCoins;
+                if (!(it->second.flags & CCoinsCacheEntry::FRESH) && GetCoins(it->first, oldCoins))
+                    pcommitment->Remove(it->first, oldCoins);
+                pcommitment->Add(it->first, it->second.coins);
+            }
+            if (fPerTxOutCoins)
+                BatchWritePerTxOutCoins(batch, it->first, it->second);
+            else
+                BatchWriteCoins(batch, it->first, it->second.coins);
             changed++;
         }
         count++;
+        if (fAsyncFlush && fWritten) {
+            ++it;
+            continue;
+        }
         CCoinsMap::iterator itOld = it++;
         mapCoins.erase(itOld);
     }
 
     for (CAnchorsMap::iterator it = mapAnchors.begin(); it != mapAnchors.end();) {
-        if (it->second.flags & CAnchorsCacheEntry::DIRTY) {
+        bool fWritten = it->second.flags & CAnchorsCacheEntry::DIRTY;
+        if (fWritten) {
             BatchWriteAnchor(batch, it->first, it->second.tree, it->second.entered);
             // TODO: changed++?
         }
+        if (fAsyncFlush && fWritten) {
+            ++it;
+            continue;
+        }
         CAnchorsMap::iterator itOld = it++;
         mapAnchors.erase(itOld);
     }
 
     for (CNullifiersMap::iterator it = mapNullifiers.begin(); it != mapNullifiers.end();) {
-        if (it->second.flags & CNullifiersCacheEntry::DIRTY) {
+        bool fWritten = it->second.flags & CNullifiersCacheEntry::DIRTY;
+        if (fWritten) {
             BatchWriteNullifier(batch, it->first, it->second.entered);
             // TODO: changed++?
         }
+        if (fAsyncFlush && fWritten) {
+            ++it;
+            continue;
+        }
         CNullifiersMap::iterator itOld = it++;
         mapNullifiers.erase(itOld);
     }
 
     for (CSidechainsMap::iterator it = mapSidechains.begin(); it != mapSidechains.end();) {
-        BatchSidechains(batch, it->first, it->second);
+        // The persisted version is needed to move the sidechain entry within the ceasing height index
+        CSidechain oldSidechain;
+        bool hasOldSidechain = it->second.flag != CSidechainsCacheEntry::Flags::DEFAULT && GetSidechain(it->first, oldSidechain);
+        BatchSidechains(batch, it->first, it->second, hasOldSidechain ? &oldSidechain : nullptr);
+        if (fAsyncFlush && it->second.flag != CSidechainsCacheEntry::Flags::DEFAULT) {
+            ++it;
+            continue;
+        }
         CSidechainsMap::iterator itOld = it++;
         mapSidechains.erase(itOld);
     }
 
     for (CSidechainEventsMap::iterator it = mapSidechainEvents.begin(); it != mapSidechainEvents.end();) {
         BatchCeasedScs(batch, it->first, it->second);
+        if (fSidechainEventsHeights && it->second.flag != CSidechainEventsCacheEntry::Flags::DEFAULT) {
+            // set before the batch is persisted, the reads meanwhile are served by the in-flight entries
+            boost::unique_lock<boost::mutex> lock(flushMutex);
+            const int height = it->first;
+            if (it->second.flag != CSidechainEventsCacheEntry::Flags::ERASED) {
+                if (height >= (int)vSidechainEventsHeights.size())
+                    vSidechainEventsHeights.resize(height + 1);
+                vSidechainEventsHeights[height] = true;
+            } else if (height < (int)vSidechainEventsHeights.size()) {
+                vSidechainEventsHeights[height] = false;
+            }
+        }
+        if (fAsyncFlush && it->second.flag != CSidechainEventsCacheEntry::Flags::DEFAULT) {
+            ++it;
+            continue;
+        }
         CSidechainEventsMap::iterator itOld = it++;
         mapSidechainEvents.erase(itOld);
     }
@@ -274,119 +1091,697 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
     for (CCswNullifiersMap::iterator it = cswNullifies.begin(); it != cswNullifies.end();) {
         const std::pair<uint256, CFieldElement>& position = it->first;
         BatchWriteCswNullifier(batch, position.first, position.second, it->second);
+        if (fCswNullifierFilter) {
+            if (it->second.flag == CCswNullifiersCacheEntry::Flags::FRESH)
+                cswNullifierFilter.Insert(position.first, position.second);
+            else if (it->second.flag == CCswNullifiersCacheEntry::Flags::ERASED)
+                cswNullifierFilter.Remove(position.first, position.second);
+        }
+        if (fAsyncFlush && it->second.flag != CCswNullifiersCacheEntry::Flags::DEFAULT) {
+            ++it;
+            continue;
+        }
         CCswNullifiersMap::iterator itOld = it++;
         cswNullifies.erase(itOld);
     }
 
-    if (!hashBlock.IsNull())
-        BatchWriteHashBestChain(batch, hashBlock);
-    if (!hashAnchor.IsNull())
-        BatchWriteHashBestAnchor(batch, hashAnchor);
+    if (!hashBlock.IsNull())
+        BatchWriteHashBestChain(batch, hashBlock);
+    if (!hashAnchor.IsNull())
+        BatchWriteHashBestAnchor(batch, hashAnchor);
+
+    if (pcommitment) {
+        if (!hashBlock.IsNull())
+            pcommitment->hashBlock = hashBlock;
+        batch.Write(DB_COINS_COMMITMENT, *pcommitment);
+    }
+
+    LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
+    if (!fAsyncFlush) {
+        if (!db.WriteBatch(batch))
+            return false;
+        if (pcommitment)
+            SetCoinsCommitment(*pcommitment);
+        return true;
+    }
+
+    {
+        boost::unique_lock<boost::mutex> lock(flushMutex);
+        // The in-flight maps have been emptied by the previous write, swapping leaves the caller's ones empty
+        inFlightCoins.swap(mapCoins);
+        inFlightAnchors.swap(mapAnchors);
+        inFlightNullifiers.swap(mapNullifiers);
+        inFlightSidechains.swap(mapSidechains);
+        inFlightSidechainEvents.swap(mapSidechainEvents);
+        inFlightCswNullifiers.swap(cswNullifies);
+        inFlightBestBlock = hashBlock;
+        inFlightBestAnchor = hashAnchor;
+        pendingBatch = std::move(pbatch);
+        fFlushInFlight = true;
+    }
+    flushCondition.notify_all();
+    if (pcommitment)
+        SetCoinsCommitment(*pcommitment);
+    return true;
+}
+
+void CCoinsViewDB::SetCoinsCommitment(const CCoinsSetCommitment& commitment)
+{
+    boost::unique_lock<boost::mutex> lock(commitmentMutex);
+    coinsCommitment = commitment;
+    fCommitmentHashValid = false;
+}
+
+//! The directories of the separate explorer index databases, under blocks/indexes/, by ExplorerIndex
+static const char* const INDEX_DB_NAMES[static_cast<int>(ExplorerIndex::COUNT)] = {
+    "tx", "maturityheight", "address", "spent", "timestamp", "blockfilter", "scactivity"
+};
+
+//! The number of index writes queued for the index writer thread above which the writers wait
+static const size_t MAX_PENDING_INDEX_WRITES = 1000;
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, int maxOpenFiles, bool fMemory, bool fWipe,
+                           bool fSeparateIndexes, size_t nIndexCacheSize, size_t nIndexWriteBufferSize,
+                           const CLevelDBTuning& tuning) :
+    CLevelDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, maxOpenFiles, fMemory, fWipe, tuning)
+{
+    const boost::filesystem::path indexesDir = GetDataDir() / "blocks" / "indexes";
+
+    // the layout of a new block database is the requested one, that of an existing one is kept
+    bool fSeparate = false;
+    const bool fNew = fWipe || IsEmpty();
+    if (fNew) {
+        fSeparate = fSeparateIndexes;
+        WriteFlag("separateindexdbs", fSeparate);
+        if (!fSeparate && !fMemory && boost::filesystem::exists(indexesDir)) {
+            LogPrintf("%s: removing the stale index databases in %s\n", __func__, indexesDir.string());
+            boost::filesystem::remove_all(indexesDir);
+        }
+    } else {
+        ReadFlag("separateindexdbs", fSeparate);
+        if (fSeparate != fSeparateIndexes)
+            LogPrintf("%s: the explorer indexes are kept %s the block database, -reindex to change it\n",
+                      __func__, fSeparate ? "apart from" : "in");
+    }
+
+    if (!fSeparate)
+        return;
+
+    CLevelDBTuning indexTuning = tuning;
+    indexTuning.nWriteBufferSize = nIndexWriteBufferSize;
+    for (int i = 0; i < static_cast<int>(ExplorerIndex::COUNT); i++)
+        indexDB[i].reset(new CLevelDBWrapper(indexesDir / INDEX_DB_NAMES[i], nIndexCacheSize, maxOpenFiles,
+                                             fMemory, fNew, indexTuning));
+}
+
+CBlockTreeDB::~CBlockTreeDB()
+{
+    if (!fAsyncIndexWrites)
+        return;
+
+    {
+        boost::unique_lock<boost::mutex> lock(indexMutex);
+        fStopIndexWrites = true;
+    }
+    indexCondition.notify_all();
+    indexThread.join();
+}
+
+CLevelDBWrapper& CBlockTreeDB::IndexDB(ExplorerIndex index)
+{
+    CLevelDBWrapper* pdb = indexDB[static_cast<int>(index)].get();
+    return pdb ? *pdb : *this;
+}
+
+/**
+ * @brief Makes the explorer index writes return once queued, leaving them to a background thread
+ * which applies them in order. The index reads wait for the queue to be drained, so that they
+ * always see all the writes made before them.
+ */
+void CBlockTreeDB::StartAsyncIndexWrites()
+{
+    if (fAsyncIndexWrites)
+        return;
+
+    fAsyncIndexWrites = true;
+    indexThread = boost::thread(&CBlockTreeDB::ThreadIndexWrites, this);
+}
+
+void CBlockTreeDB::ThreadIndexWrites()
+{
+    RenameThread("horizen-indexwrite");
+
+    boost::unique_lock<boost::mutex> lock(indexMutex);
+
+    while (true)
+    {
+        while (pendingIndexWrites.empty() && !fStopIndexWrites)
+        {
+            indexCondition.wait(lock);
+        }
+
+        if (pendingIndexWrites.empty())
+        {
+            // Stop requested and nothing left to write.
+            break;
+        }
+
+        std::function<bool()> write = std::move(pendingIndexWrites.front());
+        pendingIndexWrites.pop_front();
+        fIndexWriteInFlight = true;
+        lock.unlock();
+
+        bool fOk = false;
+        try {
+            fOk = write();
+        } catch (const std::exception& e) {
+            LogPrintf("%s():%d - error writing an index: %s\n", __func__, __LINE__, e.what());
+        }
+
+        lock.lock();
+        if (!fOk)
+            fIndexWriteFailed = true;
+        fIndexWriteInFlight = false;
+        indexCondition.notify_all();
+    }
+}
+
+/** Run write now, or queue it for the index writer thread; false if it, or a queued write before it, failed */
+bool CBlockTreeDB::QueueIndexWrite(std::function<bool()> write)
+{
+    if (!fAsyncIndexWrites)
+        return write();
+
+    boost::unique_lock<boost::mutex> lock(indexMutex);
+    while (pendingIndexWrites.size() >= MAX_PENDING_INDEX_WRITES && !fIndexWriteFailed)
+    {
+        indexCondition.wait(lock);
+    }
+    if (fIndexWriteFailed)
+        return false;
+
+    pendingIndexWrites.push_back(std::move(write));
+    indexCondition.notify_all();
+    return true;
+}
+
+bool CBlockTreeDB::WaitForIndexWrites()
+{
+    if (!fAsyncIndexWrites)
+        return true;
+
+    boost::unique_lock<boost::mutex> lock(indexMutex);
+    while (!pendingIndexWrites.empty() || fIndexWriteInFlight)
+    {
+        indexCondition.wait(lock);
+    }
+    return !fIndexWriteFailed;
+}
+
+bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
+    return Read(make_pair(DB_BLOCK_FILES, nFile), info);
+}
+
+bool CBlockTreeDB::WriteReindexing(bool fReindexing) {
+    if (fReindexing)
+        return Write(DB_REINDEX_FLAG, '1');
+    else
+        return Erase(DB_REINDEX_FLAG);
+}
+
+bool CBlockTreeDB::ReadReindexing(bool &fReindexing) {
+    fReindexing = Exists(DB_REINDEX_FLAG);
+    return true;
+}
+
+bool CBlockTreeDB::WriteFastReindexing(bool fReindexFast) {
+    if (fReindexFast)
+        return Write(DB_FAST_REINDEX_FLAG, '1');
+    else
+        return Erase(DB_FAST_REINDEX_FLAG);
+}
+bool CBlockTreeDB::ReadFastReindexing(bool &fReindexFast) {
+	fReindexFast = Exists(DB_FAST_REINDEX_FLAG);
+    return true;
+}
+
+bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
+    return Read(DB_LAST_BLOCK, nFile);
+}
+
+/**
+ * @brief Serializes the coins of a transaction as an element of the coins set commitment.
+ */
+static std::vector<unsigned char> CoinsCommitmentElement(const uint256& txid, const CCoins& coins, uint64_t& nOutputs, CAmount& nAmount)
+{
+    CDataStream ss(SER_GETHASH, PROTOCOL_VERSION);
+    ss << txid;
+    ss << VARINT(coins.nVersion);
+    ss << (coins.fCoinBase ? 'c' : 'n');
+    ss << VARINT(coins.nHeight);
+
+    // cert attributes are meaningful only in this case
+    if (coins.IsFromCert()) {
+        ss << coins.nFirstBwtPos;
+        ss << coins.nBwtMaturityHeight;
+    }
+
+    // - transactions and certificates are lumped together
+    // - nTotalAmount includes certificate valid bwt amounts (not-null, as for low-quality certs)
+    //   even if not yet matured, as it is done currently with coinbase vouts
+    nOutputs = 0;
+    nAmount = 0;
+    for (unsigned int i=0; i<coins.vout.size(); i++) {
+        const CTxOut &out = coins.vout[i];
+        if (!out.IsNull()) {
+            nOutputs++;
+            ss << VARINT(i+1);
+            ss << out;
+            nAmount += out.nValue;
+        }
+    }
+    ss << VARINT(0);
+
+    return std::vector<unsigned char>(ss.begin(), ss.end());
+}
+
+void CCoinsSetCommitment::Add(const uint256& txid, const CCoins& coins)
+{
+    if (coins.IsPruned())
+        return;
+
+    uint64_t nOutputs;
+    CAmount nAmount;
+    muhash.Insert(CoinsCommitmentElement(txid, coins, nOutputs, nAmount));
+    nTransactions++;
+    nTransactionOutputs += nOutputs;
+    nSerializedSize += 32 + ::GetSerializeSize(coins, SER_DISK, CLIENT_VERSION);
+    nTotalAmount += nAmount;
+}
+
+void CCoinsSetCommitment::Remove(const uint256& txid, const CCoins& coins)
+{
+    if (coins.IsPruned())
+        return;
+
+    uint64_t nOutputs;
+    CAmount nAmount;
+    muhash.Remove(CoinsCommitmentElement(txid, coins, nOutputs, nAmount));
+    nTransactions--;
+    nTransactionOutputs -= nOutputs;
+    nSerializedSize -= 32 + ::GetSerializeSize(coins, SER_DISK, CLIENT_VERSION);
+    nTotalAmount -= nAmount;
+}
+
+void CCoinsSetCommitment::Combine(const CCoinsSetCommitment& other)
+{
+    muhash *= other.muhash;
+    nTransactions += other.nTransactions;
+    nTransactionOutputs += other.nTransactionOutputs;
+    nSerializedSize += other.nSerializedSize;
+    nTotalAmount += other.nTotalAmount;
+}
+
+/**
+ * @brief Adds to commitment the coins whose txid starts with a byte in [lo, hi), as stored in snapshot
+ * with any layout. The outputs in height buckets are not sorted by txid, they are sought for each header.
+ */
+bool CCoinsViewDB::ScanCoinsShard(const leveldb::Snapshot* snapshot, unsigned int lo, unsigned int hi, CCoinsSetCommitment& commitment) const
+{
+    CLevelDBWrapper& dbw = const_cast<CLevelDBWrapper&>(db);
+    // Keys are the record type followed by the txid, the first txid byte selects the shard
+    auto InShard = [hi](const leveldb::Slice& slKey, char chType, size_t nSize) {
+        return slKey.size() == nSize && slKey[0] == chType && static_cast<unsigned char>(slKey[1]) < hi;
+    };
+    auto ShardStart = [lo](char chType) {
+        return std::string(1, chType) + static_cast<char>(lo);
+    };
+
+    try {
+        std::unique_ptr<leveldb::Iterator> it(dbw.NewIterator(snapshot));
+        for (it->Seek(ShardStart(DB_COINS)); it->Valid() && InShard(it->key(), DB_COINS, 33); it->Next()) {
+            leveldb::Slice slKey = it->key();
+            CDataStream ssKey(slKey.data() + 1, slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            uint256 txid;
+            ssKey >> txid;
+            leveldb::Slice slValue = it->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CCoins coins;
+            ssValue >> coins;
+            commitment.Add(txid, coins);
+        }
+
+        // Headers and outputs are both sorted by txid, so they are merged walking two iterators
+        std::unique_ptr<leveldb::Iterator> itHeader(dbw.NewIterator(snapshot));
+        std::unique_ptr<leveldb::Iterator> itOutput(dbw.NewIterator(snapshot));
+        std::unique_ptr<leveldb::Iterator> itBucketOutput(dbw.NewIterator(snapshot));
+        itOutput->Seek(ShardStart(DB_COINS_OUTPUT));
+        for (itHeader->Seek(ShardStart(DB_COINS_HEADER)); itHeader->Valid() && InShard(itHeader->key(), DB_COINS_HEADER, 33); itHeader->Next()) {
+            leveldb::Slice slKey = itHeader->key();
+            CDataStream ssKey(slKey.data() + 1, slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            uint256 txid;
+            ssKey >> txid;
+            leveldb::Slice slValue = itHeader->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CCoinsHeader header;
+            ssValue >> header;
+            CCoins coins;
+            header.ToCoins(coins);
+
+            for (; itOutput->Valid() && InShard(itOutput->key(), DB_COINS_OUTPUT, 37); itOutput->Next()) {
+                leveldb::Slice slOutputKey = itOutput->key();
+                int cmp = memcmp(slOutputKey.data() + 1, slKey.data() + 1, 32);
+                if (cmp > 0)
+                    break;
+                if (cmp < 0)
+                    return error("%s: output of %s without header", __func__, uint256(std::vector<unsigned char>(slOutputKey.data() + 1, slOutputKey.data() + 33)).ToString());
+
+                CDataStream ssOutputKey(slOutputKey.data() + 1, slOutputKey.data() + slOutputKey.size(), SER_DISK, CLIENT_VERSION);
+                CCoinsOutputKey outputKey;
+                ssOutputKey >> outputKey;
+                if (outputKey.n >= coins.vout.size())
+                    return error("%s: output %u of %s beyond its header size %u", __func__, outputKey.n, txid.ToString(), coins.vout.size());
+                leveldb::Slice slOutputValue = itOutput->value();
+                CDataStream ssOutputValue(slOutputValue.data(), slOutputValue.data() + slOutputValue.size(), SER_DISK, CLIENT_VERSION);
+                ssOutputValue >> REF(CTxOutCompressor(coins.vout[outputKey.n]));
+            }
+
+            if (fHeightBucketCoins) {
+                CDataStream ssSeek(SER_DISK, CLIENT_VERSION);
+                ssSeek << make_pair(DB_COINS_BUCKET_OUTPUT, CCoinsBucketOutputKey(CoinsHeightBucket(header.nHeight), txid, 0));
+                const std::string strPrefix = ssSeek.str().substr(0, 37);
+                for (itBucketOutput->Seek(ssSeek.str()); itBucketOutput->Valid() && itBucketOutput->key().starts_with(strPrefix); itBucketOutput->Next()) {
+                    leveldb::Slice slOutputKey = itBucketOutput->key();
+                    CDataStream ssOutputKey(slOutputKey.data() + 1, slOutputKey.data() + slOutputKey.size(), SER_DISK, CLIENT_VERSION);
+                    CCoinsBucketOutputKey outputKey;
+                    ssOutputKey >> outputKey;
+                    if (outputKey.output.n >= coins.vout.size())
+                        return error("%s: output %u of %s beyond its header size %u", __func__, outputKey.output.n, txid.ToString(), coins.vout.size());
+                    leveldb::Slice slOutputValue = itBucketOutput->value();
+                    CDataStream ssOutputValue(slOutputValue.data(), slOutputValue.data() + slOutputValue.size(), SER_DISK, CLIENT_VERSION);
+                    ssOutputValue >> REF(CTxOutCompressor(coins.vout[outputKey.output.n]));
+                }
+            }
+            coins.Cleanup();
+            commitment.Add(txid, coins);
+        }
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    return true;
+}
+
+/**
+ * @brief Computes the commitment to the whole coins set, scanning shards of the txid space on
+ * parallel threads over a single snapshot of the database.
+ *
+ * @param snapshot The database snapshot to scan, or nullptr to take (and release) one.
+ */
+bool CCoinsViewDB::ComputeCoinsCommitment(const leveldb::Snapshot* snapshotIn, CCoinsSetCommitment& commitment) const
+{
+    static const unsigned int SHARDS = 16;
+
+    const leveldb::Snapshot* snapshot = snapshotIn ? snapshotIn : const_cast<CLevelDBWrapper&>(db).GetSnapshot();
+
+    // The best block is read from the snapshot too, to match the scanned coins
+    commitment = CCoinsSetCommitment();
+    {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << DB_BEST_BLOCK;
+        std::unique_ptr<leveldb::Iterator> it(const_cast<CLevelDBWrapper&>(db).NewIterator(snapshot));
+        it->Seek(ssKey.str());
+        if (it->Valid() && it->key() == ssKey.str()) {
+            leveldb::Slice slValue = it->value();
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> commitment.hashBlock;
+        }
+    }
+
+    std::vector<CCoinsSetCommitment> shardCommitments(SHARDS);
+    std::vector<char> shardResults(SHARDS, false);
+    std::atomic<unsigned int> nextShard(0);
+
+    auto ScanShards = [&]() {
+        unsigned int shard;
+        while ((shard = nextShard++) < SHARDS)
+            shardResults[shard] = ScanCoinsShard(snapshot, shard * 256 / SHARDS, (shard + 1) * 256 / SHARDS, shardCommitments[shard]);
+    };
+
+    int64_t nStart = GetTimeMicros();
+    boost::thread_group threads;
+    unsigned int nThreads = std::max(1, std::min(GetNumCores(), static_cast<int>(SHARDS)));
+    for (unsigned int i = 0; i < nThreads; ++i)
+        threads.create_thread(ScanShards);
+    threads.join_all();
+
+    if (!snapshotIn)
+        const_cast<CLevelDBWrapper&>(db).ReleaseSnapshot(snapshot);
+
+    for (unsigned int shard = 0; shard < SHARDS; ++shard) {
+        if (!shardResults[shard])
+            return false;
+        commitment.Combine(shardCommitments[shard]);
+    }
 
-    LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
-    return db.WriteBatch(batch);
+    LogPrint("coindb", "%s():%d - coins set scanned on %u threads in %.2fms\n", __func__, __LINE__, nThreads, (GetTimeMicros() - nStart) * 0.001);
+    return true;
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, int maxOpenFiles, bool fMemory, bool fWipe) : CLevelDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, maxOpenFiles, fMemory, fWipe) {
-}
+/**
+ * @brief Loads the running coins set commitment, computing it if it is missing or stale (e.g. written
+ * by a node running without -coinscommitment). Must be called before any BatchWrite is in flight.
+ *
+ * @return true if the commitment is up to date with the database.
+ */
+bool CCoinsViewDB::LoadCoinsCommitment()
+{
+    CCoinsSetCommitment commitment;
+    if (!db.Read(DB_COINS_COMMITMENT, commitment) || commitment.hashBlock != GetBestBlock()) {
+        LogPrintf("%s():%d - computing the coins set commitment\n", __func__, __LINE__);
+        if (!ComputeCoinsCommitment(nullptr, commitment) || !db.Write(DB_COINS_COMMITMENT, commitment, true))
+            return false;
+    }
 
-bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
-    return Read(make_pair(DB_BLOCK_FILES, nFile), info);
+    SetCoinsCommitment(commitment);
+    fCoinsCommitment = true;
+    return true;
 }
 
-bool CBlockTreeDB::WriteReindexing(bool fReindexing) {
-    if (fReindexing)
-        return Write(DB_REINDEX_FLAG, '1');
-    else
-        return Erase(DB_REINDEX_FLAG);
-}
+static const size_t SNAPSHOT_CHUNK_RECORDS = 10000;
 
-bool CBlockTreeDB::ReadReindexing(bool &fReindexing) {
-    fReindexing = Exists(DB_REINDEX_FLAG);
-    return true;
-}
+/**
+ * @brief Erases every record of the coins database.
+ */
+bool CCoinsViewDB::EraseAll()
+{
+    while (true) {
+        boost::this_thread::interruption_point();
 
-bool CBlockTreeDB::WriteFastReindexing(bool fReindexFast) {
-    if (fReindexFast)
-        return Write(DB_FAST_REINDEX_FLAG, '1');
-    else
-        return Erase(DB_FAST_REINDEX_FLAG);
-}
-bool CBlockTreeDB::ReadFastReindexing(bool &fReindexFast) {
-	fReindexFast = Exists(DB_FAST_REINDEX_FLAG);
-    return true;
+        std::unique_ptr<leveldb::Iterator> it(db.NewIterator());
+        CLevelDBBatch batch;
+        size_t nErased = 0;
+        for (it->SeekToFirst(); it->Valid() && nErased < SNAPSHOT_CHUNK_RECORDS; it->Next()) {
+            batch.EraseRaw(it->key());
+            nErased++;
+        }
+        if (nErased == 0)
+            return true;
+        if (!db.WriteBatch(batch))
+            return false;
+    }
 }
 
-bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
-    return Read(DB_LAST_BLOCK, nFile);
+/**
+ * @brief Writes all the records of the database to file, from a single snapshot. The commitment
+ * to the dumped coins is computed on the same snapshot and stored in the header, which is written
+ * before the records.
+ *
+ * @param header The header of the file, whose hashBlock must match the best block of the database.
+ * @param nRecords Set to the number of records written.
+ * @return true if the whole snapshot has been written.
+ */
+bool CCoinsViewDB::DumpSnapshot(CAutoFile& file, CTxOutSetSnapshotHeader& header, uint64_t& nRecords) const
+{
+    if (!WaitForFlush())
+        return false;
+
+    CLevelDBWrapper& dbw = const_cast<CLevelDBWrapper&>(db);
+    const leveldb::Snapshot* snapshot = dbw.GetSnapshot();
+    bool fOk = false;
+    nRecords = 0;
+
+    try {
+        CCoinsSetCommitment commitment;
+        if (!ComputeCoinsCommitment(snapshot, commitment))
+            throw std::runtime_error("cannot compute the coins commitment");
+        if (commitment.hashBlock != header.hashBlock)
+            throw std::runtime_error("best block changed");
+        commitment.muhash.Finalize(header.hashSerialized);
+        file << header;
+
+        CDataStream ssKeyCommitment(SER_DISK, CLIENT_VERSION);
+        ssKeyCommitment << DB_COINS_COMMITMENT;
+
+        std::unique_ptr<leveldb::Iterator> it(dbw.NewIterator(snapshot));
+        it->SeekToFirst();
+        while (true) {
+            boost::this_thread::interruption_point();
+
+            // The commitment record is not dumped: it is recomputed (and verified) by LoadSnapshot
+            CDataStream ssChunk(SER_DISK, CLIENT_VERSION);
+            uint32_t nChunkRecords = 0;
+            for (; it->Valid() && nChunkRecords < SNAPSHOT_CHUNK_RECORDS; it->Next()) {
+                if (it->key() == ssKeyCommitment.str())
+                    continue;
+                ssChunk << it->key().ToString() << it->value().ToString();
+                nChunkRecords++;
+            }
+
+            std::vector<unsigned char> vChunk(ssChunk.begin(), ssChunk.end());
+            file << nChunkRecords << vChunk << Hash(vChunk.begin(), vChunk.end());
+            nRecords += nChunkRecords;
+            if (nChunkRecords == 0)
+                break;
+        }
+        fOk = true;
+    } catch (const std::exception& e) {
+        error("%s: %s", __func__, e.what());
+    }
+
+    dbw.ReleaseSnapshot(snapshot);
+    return fOk;
 }
 
-bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
-    /* It seems that there are no "const iterators" for LevelDB.  Since we
-       only need read operations on it, use a const-cast to get around
-       that restriction.  */
-    boost::scoped_ptr<leveldb::Iterator> pcursor(const_cast<CLevelDBWrapper*>(&db)->NewIterator());
-    pcursor->SeekToFirst();
-
-    CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = GetBestBlock();
-    ss << stats.hashBlock;
-    CAmount nTotalAmount = 0;
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        try {
-            leveldb::Slice slKey = pcursor->key();
-            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
-            char chType;
-            ssKey >> chType;
-            if (chType == DB_COINS) {
-                leveldb::Slice slValue = pcursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
-                CCoins coins;
-                ssValue >> coins;
-                uint256 txhash;
-                ssKey >> txhash;
-                ss << txhash;
-                ss << VARINT(coins.nVersion);
-                ss << (coins.fCoinBase ? 'c' : 'n');
-                ss << VARINT(coins.nHeight);
-
-                // add cert attribute to the hash writer obj, such values are meaningful only in this case 
-                // the size of the hash writer obj buffer is different anyway (larger) from the actual serialized size
-                // because the coin serialization is compressed 
-                if (coins.IsFromCert()) {
-                    ss << coins.nFirstBwtPos;
-                    ss << coins.nBwtMaturityHeight;
-                }
+/**
+ * @brief Replaces the content of the database with the records of a snapshot file, whose header has
+ * already been read. All the chunks are checked against their hash and the coins against the
+ * commitment in the header; the best block is written last, so that an aborted load leaves an
+ * empty chainstate behind (any previous content is erased first).
+ */
+bool CCoinsViewDB::LoadSnapshot(CAutoFile& file, const CTxOutSetSnapshotHeader& header, std::string& strError)
+{
+    if (!WaitForFlush() || !EraseAll()) {
+        strError = "cannot clear the coins database";
+        return false;
+    }
 
-                // - transactions and certificates are lumped together 
-                // - nTotalAmount includes certificate valid bwt amounts (not-null, as for low-quality certs)
-                //   even if not yet matured, as it is done currently with coinbase vouts
-                stats.nTransactions++;
-                for (unsigned int i=0; i<coins.vout.size(); i++) {
-                    const CTxOut &out = coins.vout[i];
-                    if (!out.IsNull()) {
-                        stats.nTransactionOutputs++;
-                        ss << VARINT(i+1);
-                        ss << out;
-                        nTotalAmount += out.nValue;
-                    }
-                }
-                
-                stats.nSerializedSize += 32 + slValue.size();
-                ss << VARINT(0);
+    CDataStream ssKeyBestBlock(SER_DISK, CLIENT_VERSION);
+    ssKeyBestBlock << DB_BEST_BLOCK;
+    CDataStream ssKeyCommitment(SER_DISK, CLIENT_VERSION);
+    ssKeyCommitment << DB_COINS_COMMITMENT;
+
+    std::string strBestBlock;
+    uint64_t nRecords = 0;
+    try {
+        while (true) {
+            boost::this_thread::interruption_point();
+
+            uint32_t nChunkRecords;
+            std::vector<unsigned char> vChunk;
+            uint256 hashChunk;
+            file >> nChunkRecords >> vChunk >> hashChunk;
+            if (Hash(vChunk.begin(), vChunk.end()) != hashChunk)
+                throw std::runtime_error(strprintf("checksum mismatch in the chunk after %d records", nRecords));
+            if (nChunkRecords == 0)
+                break;
+
+            CDataStream ssChunk(vChunk, SER_DISK, CLIENT_VERSION);
+            CLevelDBBatch batch;
+            for (uint32_t i = 0; i < nChunkRecords; i++) {
+                std::string strKey, strValue;
+                ssChunk >> strKey >> strValue;
+                if (strKey == ssKeyBestBlock.str())
+                    strBestBlock = strValue;
+                else if (strKey != ssKeyCommitment.str())
+                    batch.WriteRaw(strKey, strValue);
             }
-            pcursor->Next();
-        } catch (const std::exception& e) {
-            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            if (!db.WriteBatch(batch))
+                throw std::runtime_error("cannot write to the coins database");
+            nRecords += nChunkRecords;
+        }
+
+        uint256 hashBestBlock;
+        CDataStream ssBestBlock(strBestBlock.data(), strBestBlock.data() + strBestBlock.size(), SER_DISK, CLIENT_VERSION);
+        ssBestBlock >> hashBestBlock;
+        if (hashBestBlock != header.hashBlock)
+            throw std::runtime_error("the best block of the records does not match the header");
+
+        InitCoinsLayout();
+        CCoinsSetCommitment commitment;
+        uint256 hashSerialized;
+        if (!ComputeCoinsCommitment(nullptr, commitment))
+            throw std::runtime_error("cannot compute the coins commitment");
+        commitment.hashBlock = hashBestBlock;
+        commitment.muhash.Finalize(hashSerialized);
+        if (hashSerialized != header.hashSerialized)
+            throw std::runtime_error("the coins do not match the commitment in the header");
+
+        CLevelDBBatch batch;
+        batch.WriteRaw(ssKeyBestBlock.str(), strBestBlock);
+        if (fCoinsCommitment)
+            batch.Write(DB_COINS_COMMITMENT, commitment);
+        if (!db.WriteBatch(batch, true))
+            throw std::runtime_error("cannot write to the coins database");
+        if (fCoinsCommitment)
+            SetCoinsCommitment(commitment);
+        if (fCswNullifierFilter && !LoadCswNullifierFilter())
+            throw std::runtime_error("cannot load the CSW nullifiers filter");
+        if (fSidechainEventsHeights && !LoadSidechainEventsHeights())
+            throw std::runtime_error("cannot load the sidechain events heights");
+    } catch (const std::exception& e) {
+        strError = strprintf("invalid snapshot: %s", e.what());
+        LogPrintf("%s():%d - %s\n", __func__, __LINE__, strError);
+        EraseAll();
+        InitCoinsLayout();
+        if (fCoinsCommitment)
+            SetCoinsCommitment(CCoinsSetCommitment());
+        cswNullifierFilter.Clear();
+        if (fSidechainEventsHeights) {
+            boost::unique_lock<boost::mutex> lock(flushMutex);
+            vSidechainEventsHeights.clear();
+        }
+        return false;
+    }
+
+    LogPrintf("%s():%d - loaded %d records of the snapshot at block %s\n", __func__, __LINE__, nRecords, header.hashBlock.ToString());
+    return true;
+}
+
+bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
+    CCoinsSetCommitment commitment;
+    if (fCoinsCommitment) {
+        boost::unique_lock<boost::mutex> lock(commitmentMutex);
+        commitment = coinsCommitment;
+        if (!fCommitmentHashValid) {
+            commitment.muhash.Finalize(commitmentHash);
+            fCommitmentHashValid = true;
         }
+        stats.hashSerialized = commitmentHash;
+    } else {
+        if (!WaitForFlush())
+            return false;
+        if (!ComputeCoinsCommitment(nullptr, commitment))
+            return false;
+        commitment.muhash.Finalize(stats.hashSerialized);
     }
+
+    stats.hashBlock = commitment.hashBlock;
+    stats.nTransactions = commitment.nTransactions;
+    stats.nTransactionOutputs = commitment.nTransactionOutputs;
+    stats.nSerializedSize = commitment.nSerializedSize;
+    stats.nTotalAmount = commitment.nTotalAmount;
     {
         LOCK(cs_main);
-        stats.nHeight = mapBlockIndex.find(stats.hashBlock)->second->nHeight;
+        BlockMap::const_iterator it = mapBlockIndex.find(stats.hashBlock);
+        stats.nHeight = it != mapBlockIndex.end() ? it->second->nHeight : 0;
+    }
+
+    if (fCswNullifierFilter) {
+        CswNullifierFilterStatistics filterStats = cswNullifierFilter.GetStatistics();
+        stats.nCswNullifierFilterElements = filterStats.elements;
+        stats.nCswNullifierFilterUsage = filterStats.memoryUsage;
+        stats.dCswNullifierFilterFPRate = filterStats.fpRate;
     }
-    stats.hashSerialized = ss.GetHash();
-    stats.nTotalAmount = nTotalAmount;
     return true;
 }
 
@@ -416,7 +1811,7 @@ void CCoinsViewDB::Dump_info()  const
                 << "  creating block height: " << info.creationBlockHeight  << std::endl
                 << "  creating tx hash: " << info.creationTxHash.ToString() << std::endl
                 // creation parameters
-                << "  withdrawalEpochLength: " << info.fixedParams.withdrawalEpochLength << std::endl;
+                << "  withdrawalEpochLength: " << info.GetFixedParams().withdrawalEpochLength << std::endl;
         }
         else
         {
@@ -437,19 +1832,29 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::ReadDiskBlockIndex(const uint256 &blockhash, CDiskBlockIndex &dbindex) {
+    return Read(make_pair(DB_BLOCK_INDEX, blockhash), dbindex);
+}
+
 bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CTxIndexValue &val) {
-    return Read(make_pair(DB_TXINDEX, txid), val);
+    if (!WaitForIndexWrites())
+        return false;
+    return IndexDB(ExplorerIndex::TX).Read(make_pair(DB_TXINDEX, txid), val);
 }
 
 bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CTxIndexValue> >&vect) {
-    CLevelDBBatch batch;
-    for (std::vector<std::pair<uint256,CTxIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(make_pair(DB_TXINDEX, it->first), it->second);
-    return WriteBatch(batch);
+    return QueueIndexWrite([this, vect]() {
+        CLevelDBBatch batch;
+        for (std::vector<std::pair<uint256,CTxIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+            batch.Write(make_pair(DB_TXINDEX, it->first), it->second);
+        return IndexDB(ExplorerIndex::TX).WriteBatch(batch);
+    });
 }
 
 bool CBlockTreeDB::ReadMaturityHeightIndex(const int height, std::vector<CMaturityHeightKey> &val) {
-    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+    if (!WaitForIndexWrites())
+        return false;
+    boost::scoped_ptr<leveldb::Iterator> pcursor(IndexDB(ExplorerIndex::MATURITY_HEIGHT).NewIterator());
 
     CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
     ssKeySet << make_pair(DB_MATURITY_HEIGHT, CMaturityHeightIteratorKey(height));
@@ -487,49 +1892,95 @@ bool CBlockTreeDB::ReadMaturityHeightIndex(const int height, std::vector<CMaturi
 }
 
 bool CBlockTreeDB::UpdateMaturityHeightIndex(const std::vector<std::pair<CMaturityHeightKey,CMaturityHeightValue>> &vect) {
-    CLevelDBBatch batch;
-    for (std::vector<std::pair<CMaturityHeightKey,CMaturityHeightValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        //If the value is null we mean we want to erase the pair from the DB otherwise we persist it
-        if (it->second.IsNull()) {
-            batch.Erase(make_pair(DB_MATURITY_HEIGHT, it->first));
-        } else {
-            batch.Write(make_pair(DB_MATURITY_HEIGHT, it->first), it->second);
-        }
-    return WriteBatch(batch);
+    return QueueIndexWrite([this, vect]() {
+        CLevelDBBatch batch;
+        for (std::vector<std::pair<CMaturityHeightKey,CMaturityHeightValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+            //If the value is null we mean we want to erase the pair from the DB otherwise we persist it
+            if (it->second.IsNull()) {
+                batch.Erase(make_pair(DB_MATURITY_HEIGHT, it->first));
+            } else {
+                batch.Write(make_pair(DB_MATURITY_HEIGHT, it->first), it->second);
+            }
+        return IndexDB(ExplorerIndex::MATURITY_HEIGHT).WriteBatch(batch);
+    });
 }
 
 bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(make_pair(DB_SPENTINDEX, key), value);
+    if (!WaitForIndexWrites())
+        return false;
+    return IndexDB(ExplorerIndex::SPENT).Read(make_pair(DB_SPENTINDEX, key), value);
 }
 
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CLevelDBBatch batch;
-    for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(make_pair(DB_SPENTINDEX, it->first));
-        } else {
-            batch.Write(make_pair(DB_SPENTINDEX, it->first), it->second);
+bool CBlockTreeDB::ReadSpentIndexOutputs(const uint256 &txid, std::map<unsigned int, CSpentIndexValue> &values) {
+    if (!WaitForIndexWrites())
+        return false;
+    boost::scoped_ptr<leveldb::Iterator> pcursor(IndexDB(ExplorerIndex::SPENT).NewIterator());
+
+    // the output index follows the txid in the key, any output of txid sorts after the first one
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair(DB_SPENTINDEX, CSpentIndexKey(txid, 0));
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CSpentIndexKey indexKey;
+            ssKey >> chType;
+            ssKey >> indexKey;
+            if (chType != DB_SPENTINDEX || indexKey.txid != txid)
+                break;
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            CSpentIndexValue value;
+            ssValue >> value;
+            values[indexKey.outputIndex] = value;
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            return error("failed to get spent index value");
         }
     }
-    return WriteBatch(batch);
+
+    return true;
+}
+
+bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
+    return QueueIndexWrite([this, vect]() {
+        CLevelDBBatch batch;
+        for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+            if (it->second.IsNull()) {
+                batch.Erase(make_pair(DB_SPENTINDEX, it->first));
+            } else {
+                batch.Write(make_pair(DB_SPENTINDEX, it->first), it->second);
+            }
+        }
+        return IndexDB(ExplorerIndex::SPENT).WriteBatch(batch);
+    });
 }
 
 bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CLevelDBBatch batch;
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
-        } else {
-            batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+    return QueueIndexWrite([this, vect]() {
+        CLevelDBBatch batch;
+        for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+            if (it->second.IsNull()) {
+                batch.Erase(make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
+            } else {
+                batch.Write(make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+            }
         }
-    }
-    return WriteBatch(batch);
+        return IndexDB(ExplorerIndex::ADDRESS).WriteBatch(batch);
+    });
 }
 
 bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, AddressType type,
                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
 
-    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+    if (!WaitForIndexWrites())
+        return false;
+    boost::scoped_ptr<leveldb::Iterator> pcursor(IndexDB(ExplorerIndex::ADDRESS).NewIterator());
 
     CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
     ssKeySet << make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash));
@@ -566,44 +2017,199 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, AddressType type
     return true;
 }
 
-bool CBlockTreeDB::UpdateAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> > &vect)
+/**
+ * Write to batch the address balances changed by the address index entries in vect, which are
+ * written (or erased, when null or fErase) to it as well: each entry moves the balance of its
+ * address by the difference between its new value and the one it replaces.
+ */
+bool CBlockTreeDB::UpdateAddressBalances(CLevelDBBatch& batch,
+                                         const std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> > &vect, bool fErase)
 {
-    CLevelDBBatch batch;
+    // read straight from the database: this runs within the index writes, which the index reads wait for
+    CLevelDBWrapper& db = IndexDB(ExplorerIndex::ADDRESS);
+
+    // the entries already changed by vect, by their database key
+    std::map<std::string, CAddressIndexValue> mapChanged;
+    std::map<std::pair<AddressType, uint160>, CAddressBalanceValue> mapBalances;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+    for (const auto& [indexKey, indexValue] : vect)
     {
-        if (it->second.IsNull())
-        {
-            batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << make_pair(DB_ADDRESSINDEX, indexKey);
+        const std::string strKey = ssKey.str();
+
+        CAddressIndexValue oldValue;
+        std::map<std::string, CAddressIndexValue>::const_iterator itChanged = mapChanged.find(strKey);
+        if (itChanged != mapChanged.end())
+            oldValue = itChanged->second;
+        else if (!db.Read(make_pair(DB_ADDRESSINDEX, indexKey), oldValue))
+            oldValue.SetNull();
+        const CAddressIndexValue newValue = fErase ? CAddressIndexValue() : indexValue;
+        mapChanged[strKey] = newValue;
+
+        const std::pair<AddressType, uint160> address(indexKey.type, indexKey.hashBytes);
+        auto itBalance = mapBalances.find(address);
+        if (itBalance == mapBalances.end()) {
+            itBalance = mapBalances.insert(std::make_pair(address, CAddressBalanceValue())).first;
+            const CAddressIndexIteratorKey balanceKey(indexKey.type, indexKey.hashBytes);
+            if (!db.Read(make_pair(DB_ADDRESSBALANCE, balanceKey), itBalance->second))
+                itBalance->second.SetNull();
         }
+        itBalance->second.Add(oldValue, -1);
+        itBalance->second.Add(newValue, 1);
+    }
+
+    for (const auto& [address, balance] : mapBalances)
+    {
+        const CAddressIndexIteratorKey balanceKey(address.first, address.second);
+        if (balance.IsNull())
+            batch.Erase(make_pair(DB_ADDRESSBALANCE, balanceKey));
         else
+            batch.Write(make_pair(DB_ADDRESSBALANCE, balanceKey), balance);
+    }
+
+    return true;
+}
+
+bool CBlockTreeDB::UpdateAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> > &vect)
+{
+    return QueueIndexWrite([this, vect]() {
+        CLevelDBBatch batch;
+
+        if (!UpdateAddressBalances(batch, vect, false))
+            return false;
+
+        for (std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         {
-            batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
+            if (it->second.IsNull())
+            {
+                batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
+            }
+            else
+            {
+                batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
+            }
         }
-    }
 
-    return WriteBatch(batch);
+        return IndexDB(ExplorerIndex::ADDRESS).WriteBatch(batch);
+    });
 }
 
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >&vect) {
-    CLevelDBBatch batch;
-    for (std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
+    return QueueIndexWrite([this, vect]() {
+        CLevelDBBatch batch;
+        if (!UpdateAddressBalances(batch, vect, false))
+            return false;
+        for (std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+            batch.Write(make_pair(DB_ADDRESSINDEX, it->first), it->second);
+        return IndexDB(ExplorerIndex::ADDRESS).WriteBatch(batch);
+    });
 }
 
 bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >&vect) {
+    return QueueIndexWrite([this, vect]() {
+        CLevelDBBatch batch;
+        if (!UpdateAddressBalances(batch, vect, true))
+            return false;
+        for (std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+            batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
+        return IndexDB(ExplorerIndex::ADDRESS).WriteBatch(batch);
+    });
+}
+
+bool CBlockTreeDB::ReadAddressBalance(uint160 addressHash, AddressType type, CAddressBalanceValue &balance) {
+    if (!WaitForIndexWrites())
+        return false;
+    return IndexDB(ExplorerIndex::ADDRESS).Read(make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), balance);
+}
+
+/** Build the address balances of the whole address index, for an index from before they were kept */
+bool CBlockTreeDB::BuildAddressBalances()
+{
+    static const size_t BATCH_ADDRESSES = 10000;
+
+    if (!WaitForIndexWrites())
+        return false;
+    CLevelDBWrapper& db = IndexDB(ExplorerIndex::ADDRESS);
+    boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << DB_ADDRESSINDEX;
+    pcursor->Seek(ssKeySet.str());
+
     CLevelDBBatch batch;
-    for (std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
+    size_t nBatchAddresses = 0;
+    size_t nAddresses = 0;
+    bool fAddress = false;
+    CAddressIndexIteratorKey addressKey;
+    CAddressBalanceValue balance;
+
+    // the entries are sorted by address, the balance of each is written once the next one starts
+    while (true) {
+        boost::this_thread::interruption_point();
+
+        bool fEntry = false;
+        CAddressIndexKey indexKey;
+        if (pcursor->Valid()) {
+            try {
+                leveldb::Slice slKey = pcursor->key();
+                CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+                char chType;
+                ssKey >> chType;
+                if (chType == DB_ADDRESSINDEX) {
+                    ssKey >> indexKey;
+                    fEntry = true;
+                }
+            } catch (const std::exception& e) {
+                return error("%s: failed to get address index key - %s", __func__, e.what());
+            }
+        }
+
+        if (fAddress && (!fEntry || indexKey.type != addressKey.type || indexKey.hashBytes != addressKey.hashBytes)) {
+            if (!balance.IsNull())
+                batch.Write(make_pair(DB_ADDRESSBALANCE, addressKey), balance);
+            nAddresses++;
+            if (++nBatchAddresses >= BATCH_ADDRESSES) {
+                if (!db.WriteBatch(batch))
+                    return error("%s: failed to write address balances", __func__);
+                batch.Clear();
+                nBatchAddresses = 0;
+            }
+            fAddress = false;
+        }
+        if (!fEntry)
+            break;
+
+        if (!fAddress) {
+            addressKey = CAddressIndexIteratorKey(indexKey.type, indexKey.hashBytes);
+            balance.SetNull();
+            fAddress = true;
+        }
+        try {
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            CAddressIndexValue indexValue;
+            ssValue >> indexValue;
+            balance.Add(indexValue, 1);
+        } catch (const std::exception& e) {
+            return error("%s: failed to get address index value - %s", __func__, e.what());
+        }
+        pcursor->Next();
+    }
+
+    if (!db.WriteBatch(batch))
+        return error("%s: failed to write address balances", __func__);
+    LogPrintf("%s: built the balances of %u addresses\n", __func__, nAddresses);
+    return true;
 }
 
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, AddressType type,
                                     std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> > &addressIndex,
                                     int start, int end) {
 
-    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+    if (!WaitForIndexWrites())
+        return false;
+    boost::scoped_ptr<leveldb::Iterator> pcursor(IndexDB(ExplorerIndex::ADDRESS).NewIterator());
 
     CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
     if (start > 0 && end > 0) {
@@ -649,14 +2255,18 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, AddressType type,
 }
 
 bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CLevelDBBatch batch;
-    batch.Write(make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
-    return WriteBatch(batch);
+    return QueueIndexWrite([this, timestampIndex]() {
+        CLevelDBBatch batch;
+        batch.Write(make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
+        return IndexDB(ExplorerIndex::TIMESTAMP).WriteBatch(batch);
+    });
 }
 
 bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes) {
 
-    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+    if (!WaitForIndexWrites())
+        return false;
+    boost::scoped_ptr<leveldb::Iterator> pcursor(IndexDB(ExplorerIndex::TIMESTAMP).NewIterator());
 
     CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
     ssKeySet << make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low));
@@ -693,21 +2303,106 @@ bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned i
 }
 
 bool CBlockTreeDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts) {
-    CLevelDBBatch batch;
-    batch.Write(make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
-    return WriteBatch(batch);
+    return QueueIndexWrite([this, blockhashIndex, logicalts]() {
+        CLevelDBBatch batch;
+        batch.Write(make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
+        return IndexDB(ExplorerIndex::TIMESTAMP).WriteBatch(batch);
+    });
 }
 
 bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) {
 
+    if (!WaitForIndexWrites())
+        return false;
     CTimestampBlockIndexValue(lts);
-    if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
+    if (!IndexDB(ExplorerIndex::TIMESTAMP).Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
 	return false;
 
     ltimestamp = lts.ltimestamp;
     return true;
 }
 
+bool CBlockTreeDB::WriteBlockFilterIndex(const uint256 &blockHash, const uint256 &filterHash, const uint256 &filterHeader,
+                                         const std::vector<unsigned char> &filter) {
+    return QueueIndexWrite([this, blockHash, filterHash, filterHeader, filter]() {
+        // the headers apart, for a request of headers not to read the filters
+        CLevelDBBatch batch;
+        batch.Write(make_pair(DB_BLOCKFILTER, blockHash), filter);
+        batch.Write(make_pair(DB_BLOCKFILTERHEADER, blockHash), make_pair(filterHash, filterHeader));
+        return IndexDB(ExplorerIndex::BLOCK_FILTER).WriteBatch(batch);
+    });
+}
+
+bool CBlockTreeDB::ReadBlockFilter(const uint256 &blockHash, std::vector<unsigned char> &filter) {
+    if (!WaitForIndexWrites())
+        return false;
+    return IndexDB(ExplorerIndex::BLOCK_FILTER).Read(make_pair(DB_BLOCKFILTER, blockHash), filter);
+}
+
+bool CBlockTreeDB::ReadBlockFilterHeader(const uint256 &blockHash, uint256 &filterHash, uint256 &filterHeader) {
+    if (!WaitForIndexWrites())
+        return false;
+    std::pair<uint256, uint256> value;
+    if (!IndexDB(ExplorerIndex::BLOCK_FILTER).Read(make_pair(DB_BLOCKFILTERHEADER, blockHash), value))
+        return false;
+    filterHash = value.first;
+    filterHeader = value.second;
+    return true;
+}
+
+bool CBlockTreeDB::WriteScActivityIndex(const uint256 &blockHash,
+                                        const std::vector<std::pair<CScActivityKey, CScActivityValue> > &vect) {
+    return QueueIndexWrite([this, blockHash, vect]() {
+        CLevelDBBatch batch;
+        for (const std::pair<CScActivityKey, CScActivityValue>& entry : vect)
+            batch.Write(make_pair(DB_SCACTIVITY, entry.first), entry.second);
+        batch.Write(make_pair(DB_SCACTIVITYBLOCK, blockHash), static_cast<uint32_t>(vect.size()));
+        return IndexDB(ExplorerIndex::SC_ACTIVITY).WriteBatch(batch);
+    });
+}
+
+bool CBlockTreeDB::HaveScActivityBlock(const uint256 &blockHash) {
+    if (!WaitForIndexWrites())
+        return false;
+    return IndexDB(ExplorerIndex::SC_ACTIVITY).Exists(make_pair(DB_SCACTIVITYBLOCK, blockHash));
+}
+
+bool CBlockTreeDB::ReadScActivityIndex(const uint256 &scId, int fromHeight, int toHeight, size_t nMax,
+                                       std::vector<std::pair<CScActivityKey, CScActivityValue> > &vect) {
+    if (!WaitForIndexWrites())
+        return false;
+    boost::scoped_ptr<leveldb::Iterator> pcursor(IndexDB(ExplorerIndex::SC_ACTIVITY).NewIterator());
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair(DB_SCACTIVITY, CScActivityIteratorKey(scId, fromHeight));
+    pcursor->Seek(ssKeySet.str());
+
+    while (pcursor->Valid() && vect.size() < nMax) {
+        boost::this_thread::interruption_point();
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            CScActivityKey indexKey;
+            ssKey >> chType;
+            ssKey >> indexKey;
+            if (chType != DB_SCACTIVITY || indexKey.scId != scId || indexKey.blockHeight > toHeight)
+                break;
+
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+            CScActivityValue indexValue;
+            ssValue >> indexValue;
+            vect.push_back(std::make_pair(indexKey, indexValue));
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            return error("%s: failed to get sidechain activity value - %s", __func__, e.what());
+        }
+    }
+
+    return true;
+}
+
 bool CBlockTreeDB::blockOnchainActive(const uint256 &hash) {
     BlockMap::iterator mi = mapBlockIndex.find(hash);
 
@@ -729,6 +2424,19 @@ bool CBlockTreeDB::ReadString(const std::string &name, std::string &sValue) {
     return true;
 }
 
+bool CBlockTreeDB::WriteTxOutSetSnapshotBase(const uint256 &hash, uint64_t nChainTx) {
+    return Write(std::make_pair(DB_FLAG, TXOUTSET_SNAPSHOT_BASE), std::make_pair(hash, nChainTx), true);
+}
+
+bool CBlockTreeDB::ReadTxOutSetSnapshotBase(uint256 &hash, uint64_t &nChainTx) {
+    std::pair<uint256, uint64_t> base;
+    if (!Read(std::make_pair(DB_FLAG, TXOUTSET_SNAPSHOT_BASE), base))
+        return false;
+    hash = base.first;
+    nChainTx = base.second;
+    return true;
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -741,62 +2449,120 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+//! The number of block index records read, then decoded on all the cores at once, by LoadBlockIndexGuts
+static const size_t BLOCK_INDEX_LOAD_CHUNK_RECORDS = 10000;
+
 bool CBlockTreeDB::LoadBlockIndexGuts()
 {
+    // Unless told to trust the local index, every header is hashed again to check its proof of work
+    const bool fCheckPow = GetBoolArg("-checkblockindexpow", DEFAULT_CHECKBLOCKINDEXPOW);
+    const unsigned int nThreads = std::max(1, GetNumCores());
+
     boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
 
     CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
     ssKeySet << make_pair(DB_BLOCK_INDEX, uint256());
     pcursor->Seek(ssKeySet.str());
 
-    // Load mapBlockIndex
-    while (pcursor->Valid()) {
+    // Load mapBlockIndex, a chunk of records at a time: they are read serially from the cursor, decoded
+    // and checked in parallel, then merged serially in key order, so that the result does not depend
+    // on the threads scheduling.
+    int64_t nStart = GetTimeMicros();
+    size_t nLoaded = 0;
+    std::vector<std::pair<uint256, std::string>> vRecords;
+    std::vector<CDiskBlockIndex> vDiskIndexes;
+    std::vector<std::string> vErrors;
+    bool fDone = false;
+    while (!fDone) {
         boost::this_thread::interruption_point();
+
+        vRecords.clear();
         try {
-            leveldb::Slice slKey = pcursor->key();
-            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
-            char chType;
-            ssKey >> chType;
-            if (chType == DB_BLOCK_INDEX) {
-                leveldb::Slice slValue = pcursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
-                CDiskBlockIndex diskindex;
-                ssValue >> diskindex;
-
-                // Construct block index object
-                CBlockIndex* pindexNew = InsertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = InsertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->hashAnchor     = diskindex.hashAnchor;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nSolution      = diskindex.nSolution;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-                pindexNew->nSproutValue   = diskindex.nSproutValue;
-                pindexNew->hashScTxsCommitment = diskindex.hashScTxsCommitment;
-                pindexNew->scCumTreeHash  = diskindex.scCumTreeHash;
-
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus()))
-                    return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
-
-                if (!pindexNew->scCumTreeHash.IsNull() && ForkManager::getInstance().isNonCeasingSidechainActive(pindexNew->nHeight))
-                    mapCumtreeHeight.insert(std::make_pair(pindexNew->scCumTreeHash.GetLegacyHash(), pindexNew->nHeight));
+            while (pcursor->Valid() && vRecords.size() < BLOCK_INDEX_LOAD_CHUNK_RECORDS) {
+                leveldb::Slice slKey = pcursor->key();
+                CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+                char chType;
+                ssKey >> chType;
+                if (chType != DB_BLOCK_INDEX) {
+                    fDone = true; // finished loading block index
+                    break;
+                }
+                uint256 hash;
+                ssKey >> hash;
+                vRecords.push_back(std::make_pair(hash, pcursor->value().ToString()));
                 pcursor->Next();
-            } else {
-                break; // if shutdown requested or finished loading block index
             }
         } catch (const std::exception& e) {
             return error("%s: Deserialize or I/O error - %s", __func__, e.what());
         }
+        if (!pcursor->Valid())
+            fDone = true;
+        if (vRecords.empty())
+            break;
+
+        vDiskIndexes.clear();
+        vDiskIndexes.resize(vRecords.size());
+        vErrors.assign(vRecords.size(), std::string());
+        std::atomic<size_t> nextRecord(0);
+
+        auto DecodeRecords = [&]() {
+            size_t i;
+            while ((i = nextRecord++) < vRecords.size()) {
+                try {
+                    const std::string& strValue = vRecords[i].second;
+                    CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+                    ssValue >> vDiskIndexes[i];
+                } catch (const std::exception& e) {
+                    vErrors[i] = strprintf("Deserialize or I/O error - %s", e.what());
+                    continue;
+                }
+                if (fCheckPow) {
+                    const uint256 hash = vDiskIndexes[i].GetBlockHash();
+                    if (hash != vRecords[i].first || !CheckProofOfWork(hash, vDiskIndexes[i].nBits, Params().GetConsensus()))
+                        vErrors[i] = strprintf("CheckProofOfWork failed: block %s, height %d", vRecords[i].first.ToString(), vDiskIndexes[i].nHeight);
+                }
+            }
+        };
+
+        boost::thread_group threads;
+        for (unsigned int i = 0; i < nThreads; ++i)
+            threads.create_thread(DecodeRecords);
+        threads.join_all();
+
+        for (size_t i = 0; i < vRecords.size(); i++) {
+            if (!vErrors[i].empty())
+                return error("LoadBlockIndex(): %s", vErrors[i]);
+
+            const CDiskBlockIndex& diskindex = vDiskIndexes[i];
+
+            // Construct block index object
+            CBlockIndex* pindexNew = InsertBlockIndex(vRecords[i].first);
+            pindexNew->pprev          = InsertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->hashAnchor     = diskindex.hashAnchor;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            // nSolution is left on disk, see CBlockIndex::GetSolution
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+            pindexNew->nSproutValue   = diskindex.nSproutValue;
+            pindexNew->hashScTxsCommitment = diskindex.hashScTxsCommitment;
+            pindexNew->scCumTreeHash  = diskindex.scCumTreeHash;
+
+            if (!pindexNew->scCumTreeHash.IsNull() && ForkManager::getInstance().isNonCeasingSidechainActive(pindexNew->nHeight))
+                mapCumtreeHeight.insert(std::make_pair(pindexNew->scCumTreeHash.GetLegacyHash(), pindexNew->nHeight));
+        }
+        nLoaded += vRecords.size();
     }
 
+    LogPrintf("%s: loaded %u block index entries on %u threads in %.2fms%s\n", __func__, nLoaded, nThreads,
+              (GetTimeMicros() - nStart) * 0.001, fCheckPow ? "" : " (proof of work not checked)");
     return true;
 }
 
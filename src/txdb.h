@@ -8,13 +8,21 @@
 
 #include "chain.h"
 #include "coins.h"
+#include "crypto/muhash.h"
 #include "leveldbwrapper.h"
+#include "sc/cswnullifierfilter.h"
 
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <deque>
+#include <functional>
+
+#include <boost/thread.hpp>
+
 class CBlockFileInfo;
 class CBlockIndex;
 struct CTxIndexValue;
@@ -29,12 +37,15 @@ struct CAddressIndexKey;
 struct CAddressIndexValue;
 struct CAddressIndexIteratorKey;
 struct CAddressIndexIteratorHeightKey;
+struct CAddressBalanceValue;
 struct CTimestampIndexKey;
 struct CTimestampIndexIteratorKey;
 struct CTimestampBlockIndexKey;
 struct CTimestampBlockIndexValue;
 struct CSpentIndexKey;
 struct CSpentIndexValue;
+struct CScActivityKey;
+struct CScActivityValue;
 
 class uint256;
 
@@ -44,6 +55,20 @@ static const int64_t nDefaultDbCache = 450;
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache in (MiB)
 static const int64_t nMinDbCache = 4;
+//! -asynccoinsflush default
+static const bool DEFAULT_ASYNC_COINS_FLUSH = true;
+//! -coinscommitment default
+static const bool DEFAULT_COINS_COMMITMENT = false;
+//! -cswnullifierfilter default
+static const bool DEFAULT_CSW_NULLIFIER_FILTER = true;
+//! -separateindexdbs default
+static const bool DEFAULT_SEPARATE_INDEX_DBS = false;
+//! -indexdbcache default, for each of the separate index databases (MiB)
+static const int64_t DEFAULT_INDEX_DB_CACHE = 64;
+//! -indexdbwritebuffer default, for each of the separate index databases (MiB, 0 for a quarter of the cache)
+static const int64_t DEFAULT_INDEX_DB_WRITE_BUFFER = 0;
+//! -asyncindexwrites default
+static const bool DEFAULT_ASYNC_INDEX_WRITES = true;
 
 static const std::string DEFAULT_INDEX_VERSION_STR = "0.0";
 static const std::string CURRENT_INDEX_VERSION_STR = "1.0";
@@ -119,14 +144,83 @@ struct CTxIndexValue {
     }
 };
 
+/**
+ * Statistics of the coins set together with a MuHash of its content. Being combinable, they can
+ * be computed in parallel over disjoint parts of the set and kept up to date as coins are written.
+ */
+struct CCoinsSetCommitment
+{
+    uint256 hashBlock;
+    MuHash3072 muhash;
+    uint64_t nTransactions = 0;
+    uint64_t nTransactionOutputs = 0;
+    uint64_t nSerializedSize = 0;
+    CAmount nTotalAmount = 0;
+
+    void Add(const uint256& txid, const CCoins& coins);
+    void Remove(const uint256& txid, const CCoins& coins);
+    void Combine(const CCoinsSetCommitment& other);
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(hashBlock);
+        READWRITE(muhash);
+        READWRITE(nTransactions);
+        READWRITE(nTransactionOutputs);
+        READWRITE(nSerializedSize);
+        READWRITE(nTotalAmount);
+    }
+};
+
+/**
+ * Header of a coins database snapshot file, as written by dumptxoutset. It is followed by chunks of
+ * raw database records, each one made of the number of records, the serialized records and their
+ * hash, ending with an empty chunk.
+ */
+struct CTxOutSetSnapshotHeader
+{
+    static const int CURRENT_VERSION = 1;
+
+    unsigned char pchMessageStart[4];
+    int nVersion;
+    uint256 hashBlock;      /**< The best block of the snapshot */
+    int nHeight;
+    uint64_t nChainTx;      /**< The number of transactions in the chain up to hashBlock */
+    uint256 hashSerialized; /**< The finalized MuHash of the coins in the snapshot, as reported by gettxoutsetinfo */
+
+    CTxOutSetSnapshotHeader(): nVersion(CURRENT_VERSION), nHeight(0), nChainTx(0) {
+        memset(pchMessageStart, 0, sizeof(pchMessageStart));
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(FLATDATA(pchMessageStart));
+        READWRITE(this->nVersion);
+        READWRITE(hashBlock);
+        READWRITE(nHeight);
+        READWRITE(nChainTx);
+        READWRITE(hashSerialized);
+    }
+};
+
 /** CCoinsView backed by the LevelDB coin database (chainstate/) */
 class CCoinsViewDB : public CCoinsView
 {
 protected:
     CLevelDBWrapper db;
-    CCoinsViewDB(std::string dbName, size_t nCacheSize, int maxOpenFiles, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(std::string dbName, size_t nCacheSize, int maxOpenFiles, bool fMemory = false, bool fWipe = false,
+                 const CLevelDBTuning& tuning = CLevelDBTuning());
+
+    //! Writes a batch handed over to flushThread
+    virtual bool WriteFlushBatch(CLevelDBBatch& batch);
 public:
-    CCoinsViewDB(size_t nCacheSize, int maxOpenFiles, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(size_t nCacheSize, int maxOpenFiles, bool fMemory = false, bool fWipe = false,
+                 const CLevelDBTuning& tuning = CLevelDBTuning());
+    ~CCoinsViewDB();
 
     bool GetAnchorAt(const uint256 &rt, ZCIncrementalMerkleTree &tree)   const override;
     bool GetNullifier(const uint256 &nf)                                 const override;
@@ -137,6 +231,8 @@ public:
     bool HaveSidechainEvents(int height)                                 const override;
     bool GetSidechainEvents(int height, CSidechainEvents& ceasingScs)    const override;
     void GetScIds(std::set<uint256>& scIdsList)                          const override;
+    void GetScIdsByCeasingHeight(int minHeight, int maxHeight,
+                                 std::set<uint256>& scIdsList)           const override;
     uint256 GetBestBlock()                                               const override;
     uint256 GetBestAnchor()                                              const override;
     bool HaveCswNullifier(const uint256& scId,
@@ -151,19 +247,151 @@ public:
                     CSidechainEventsMap& mapSidechainEvents,
                     CCswNullifiersMap& cswNullifies)                           override;
     bool GetStats(CCoinsStats &stats)                                    const override;
+    bool Sync()                                                                override;
     void Dump_info() const;
+
+    void StartAsyncFlush();
+
+    bool BuildScCeasingIndex();
+    bool UpgradeToPerTxOutCoins();
+    bool IsPerTxOutCoins() const { return fPerTxOutCoins; }
+    bool UpgradeToHeightBucketCoins();
+    bool IsHeightBucketCoins() const { return fHeightBucketCoins; }
+    bool LoadCswNullifierFilter();
+    bool LoadSidechainEventsHeights();
+    bool LoadCoinsCommitment();
+
+    bool DumpSnapshot(CAutoFile& file, CTxOutSetSnapshotHeader& header, uint64_t& nRecords) const;
+    bool LoadSnapshot(CAutoFile& file, const CTxOutSetSnapshotHeader& header, std::string& strError);
+
+private:
+    bool fPerTxOutCoins;   /**< true if coins are stored with one record per output */
+    bool fLegacyCoinsLeft; /**< true if an upgrade to the per-output layout has still to convert some records */
+    bool fHeightBucketCoins;     /**< true if the outputs of the per-output layout are keyed by creation height bucket */
+    bool fUnbucketedOutputsLeft; /**< true if an upgrade to the height buckets has still to move some outputs */
+
+    /**
+     * Bloom filter of the CSW nullifiers stored in the database (in-flight ones included), consulted
+     * by HaveCswNullifier before the database once loaded.
+     */
+    bool fCswNullifierFilter = false;
+    CCswNullifierFilter cswNullifierFilter;
+
+    /**
+     * Bitmap of the heights having sidechain events in the database (in-flight ones included), consulted by
+     * HaveSidechainEvents and GetSidechainEvents before the database once loaded: the events are checked at
+     * every connected and disconnected block, and only a few heights have any.
+     */
+    bool fSidechainEventsHeights = false;
+    std::vector<bool> vSidechainEventsHeights;   //! guarded by flushMutex once loaded
+    bool MayHaveSidechainEvents(int height) const;
+
+    /**
+     * Running commitment to the coins set, updated by BatchWrite and persisted with every batch,
+     * which lets GetStats answer without scanning the database once loaded.
+     */
+    bool fCoinsCommitment = false;
+    mutable boost::mutex commitmentMutex;
+    CCoinsSetCommitment coinsCommitment;
+    mutable uint256 commitmentHash;          /**< The finalized coinsCommitment.muhash, valid if fCommitmentHashValid */
+    mutable bool fCommitmentHashValid = false;
+
+    void SetCoinsCommitment(const CCoinsSetCommitment& commitment);
+    bool ComputeCoinsCommitment(const leveldb::Snapshot* snapshot, CCoinsSetCommitment& commitment) const;
+    bool EraseAll();
+    bool ScanCoinsShard(const leveldb::Snapshot* snapshot, unsigned int lo, unsigned int hi, CCoinsSetCommitment& commitment) const;
+
+    /**
+     * State of the asynchronous flush. BatchWrite hands the batch over to flushThread and keeps
+     * the written entries in the inFlight* maps, which reads check before the database until
+     * the batch is persisted.
+     */
+    bool fAsyncFlush = false;
+    mutable boost::mutex flushMutex;
+    mutable boost::condition_variable flushCondition;
+    boost::thread flushThread;
+    std::unique_ptr<CLevelDBBatch> pendingBatch; /**< The batch waiting for flushThread */
+    bool fFlushInFlight = false;                 /**< true until the last handed over batch is persisted */
+    bool fFlushFailed = false;                   /**< true if flushThread failed writing a batch, its entries kept in flight */
+    bool fStopFlush = false;
+    CCoinsMap inFlightCoins;
+    CAnchorsMap inFlightAnchors;
+    CNullifiersMap inFlightNullifiers;
+    CSidechainsMap inFlightSidechains;
+    CSidechainEventsMap inFlightSidechainEvents;
+    CCswNullifiersMap inFlightCswNullifiers;
+    uint256 inFlightBestBlock;
+    uint256 inFlightBestAnchor;
+
+    void ThreadFlush();
+    bool WaitForFlush() const;
+
+    void InitCoinsLayout();
+    bool HasRecords(char chType) const;
+    void ReadCoinsOutputs(const uint256 &txid, std::map<uint32_t, std::string>& outputs) const;
+    void ReadBucketOutputs(uint32_t nBucket, const uint256 &txid, std::map<uint32_t, std::string>& outputs) const;
+    void BatchWritePerTxOutCoins(CLevelDBBatch &batch, const uint256 &txid, const CCoinsCacheEntry &entry) const;
+};
+
+/** The explorer indexes kept by CBlockTreeDB, which may each have a database of its own */
+enum class ExplorerIndex
+{
+    TX,              /**< -txindex */
+    MATURITY_HEIGHT, /**< the maturity height index of -txindex */
+    ADDRESS,         /**< -addressindex, with its unspent outputs and balances */
+    SPENT,           /**< -spentindex */
+    TIMESTAMP,       /**< -timestampindex, with its block hash to logical timestamp index */
+    BLOCK_FILTER,    /**< -blockfilterindex, the compact filters of the blocks and their headers */
+    SC_ACTIVITY,     /**< -scindex, the activity of the sidechains by height */
+    COUNT
 };
 
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CLevelDBWrapper
 {
 public:
-    CBlockTreeDB(size_t nCacheSize, int maxOpenFiles, bool fMemory = false, bool fWipe = false);
+    /**
+     * With fSeparateIndexes each explorer index is kept in a database of its own (blocks/indexes/<name>),
+     * of nIndexCacheSize cache and nIndexWriteBufferSize write buffer, so that its writes are not
+     * compacted together with those of the block index and of the other indexes.
+     * The layout is chosen when the block database is created and kept afterwards.
+     * The compactions of all the databases follow tuning.
+     */
+    CBlockTreeDB(size_t nCacheSize, int maxOpenFiles, bool fMemory = false, bool fWipe = false,
+                 bool fSeparateIndexes = false, size_t nIndexCacheSize = 0, size_t nIndexWriteBufferSize = 0,
+                 const CLevelDBTuning& tuning = CLevelDBTuning());
+    ~CBlockTreeDB();
 private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
+    bool UpdateAddressBalances(CLevelDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> > &vect, bool fErase);
+
+    //! the databases of the separate explorer indexes, null for the ones kept in the block database
+    std::unique_ptr<CLevelDBWrapper> indexDB[static_cast<int>(ExplorerIndex::COUNT)];
+    CLevelDBWrapper& IndexDB(ExplorerIndex index);
+
+    /**
+     * State of the asynchronous index writes. The index write methods queue their write for
+     * indexThread, in order, and the index read methods wait for the queue to be drained.
+     */
+    bool fAsyncIndexWrites = false;
+    boost::mutex indexMutex;
+    boost::condition_variable indexCondition;
+    boost::thread indexThread;
+    std::deque<std::function<bool()> > pendingIndexWrites;
+    bool fIndexWriteInFlight = false; /**< true while indexThread is writing the front of the queue */
+    bool fIndexWriteFailed = false;   /**< true if indexThread failed an index write */
+    bool fStopIndexWrites = false;
+
+    void ThreadIndexWrites();
+    bool QueueIndexWrite(std::function<bool()> write);
 public:
+    void StartAsyncIndexWrites();
+    //! Wait for the queued index writes, false if any of them failed
+    bool WaitForIndexWrites();
+
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
+    bool ReadDiskBlockIndex(const uint256 &blockhash, CDiskBlockIndex &dbindex);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &fileinfo);
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindex);
@@ -176,6 +404,8 @@ public:
     bool UpdateMaturityHeightIndex(const std::vector<std::pair<CMaturityHeightKey, CMaturityHeightValue>> &maturityHeightList);
 
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+    //! The entries of all the spent outputs of txid, by output index, with a single scan of the keys prefixed by txid
+    bool ReadSpentIndexOutputs(const uint256 &txid, std::map<unsigned int, CSpentIndexValue> &values);
     bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, AddressType type,
@@ -186,12 +416,27 @@ public:
     bool ReadAddressIndex(uint160 addressHash, AddressType type,
                           std::vector<std::pair<CAddressIndexKey, CAddressIndexValue> > &addressIndex,
                           int start = 0, int end = 0);
+    bool ReadAddressBalance(uint160 addressHash, AddressType type, CAddressBalanceValue &balance);
+    bool BuildAddressBalances();
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
     bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
     bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
     bool blockOnchainActive(const uint256 &hash);
+    //! The basic filter of a block, with its hash and its header, see BlockFilter
+    bool WriteBlockFilterIndex(const uint256 &blockHash, const uint256 &filterHash, const uint256 &filterHeader,
+                               const std::vector<unsigned char> &filter);
+    bool ReadBlockFilter(const uint256 &blockHash, std::vector<unsigned char> &filter);
+    bool ReadBlockFilterHeader(const uint256 &blockHash, uint256 &filterHash, uint256 &filterHeader);
+    //! The sidechain activity of a block, with the record of the block being indexed, see CScActivityIndexer
+    bool WriteScActivityIndex(const uint256 &blockHash, const std::vector<std::pair<CScActivityKey, CScActivityValue> > &vect);
+    bool HaveScActivityBlock(const uint256 &blockHash);
+    //! The entries of scId from fromHeight to toHeight included, of the active chain or not, at most nMax
+    bool ReadScActivityIndex(const uint256 &scId, int fromHeight, int toHeight, size_t nMax,
+                             std::vector<std::pair<CScActivityKey, CScActivityValue> > &vect);
 
+    bool WriteTxOutSetSnapshotBase(const uint256 &hash, uint64_t nChainTx);
+    bool ReadTxOutSetSnapshotBase(uint256 &hash, uint64_t &nChainTx);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool WriteString(const std::string &name, std::string fValue);
@@ -9,7 +9,9 @@
 #include "consensus/consensus.h"
 #include "consensus/validation.h"
 #include "main.h"
+#include "metrics.h"
 #include "policy/fees.h"
+#include "random.h"
 #include "streams.h"
 #include "util.h"
 #include "utilmoneystr.h"
@@ -17,6 +19,13 @@
 #include "validationinterface.h"
 #include <undo.h>
 
+#include <cmath>
+
+static MetricValue metricNotifyBatches("zen_mempool_notify_batches_total", "Batches of recently added transactions and certificates notified to the wallets");
+static MetricValue metricNotified("zen_mempool_notified_total", "Recently added transactions and certificates notified to the wallets");
+static MetricValue metricNotifyLag("zen_mempool_notify_lag_microseconds", "Time from the addition of the oldest entry of the last batch to the end of its notification",
+                                   MetricValue::Type::GAUGE);
+
 CMemPoolEntry::CMemPoolEntry():
     nFee(0), nModSize(0), nUsageSize(0), nTime(0), dPriority(0.0)
 {
@@ -28,24 +37,31 @@ CMemPoolEntry::CMemPoolEntry(const CAmount& _nFee, int64_t _nTime, double _dPrio
 {
 }
 
-CTxMemPoolEntry::CTxMemPoolEntry(): nTxSize(0), hadNoDependencies(false)
+CTxMemPoolEntry::CTxMemPoolEntry(): tx(std::make_shared<const CTransaction>()), nTxSize(0), hadNoDependencies(false)
 {
 }
 
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee,
                                  int64_t _nTime, double _dPriority,
                                  unsigned int _nHeight, bool poolHasNoInputsOf):
+    CTxMemPoolEntry(std::make_shared<const CTransaction>(_tx), _nFee, _nTime, _dPriority, _nHeight, poolHasNoInputsOf)
+{
+}
+
+CTxMemPoolEntry::CTxMemPoolEntry(const std::shared_ptr<const CTransaction>& _tx, const CAmount& _nFee,
+                                 int64_t _nTime, double _dPriority,
+                                 unsigned int _nHeight, bool poolHasNoInputsOf):
     CMemPoolEntry(_nFee, _nTime, _dPriority, _nHeight),
     tx(_tx), hadNoDependencies(poolHasNoInputsOf)
 {
-    nTxSize = tx.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
-    nModSize = tx.CalculateModifiedSize(nTxSize);
-    nUsageSize = RecursiveDynamicUsage(tx);
+    nTxSize = tx->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+    nModSize = tx->CalculateModifiedSize(nTxSize);
+    nUsageSize = RecursiveDynamicUsage(*tx) + memusage::DynamicUsage(tx);
 }
 
 double CTxMemPoolEntry::GetPriority(unsigned int currentHeight) const
 {
-    CAmount nValueIn = tx.GetValueOut()+nFee;
+    CAmount nValueIn = tx->GetValueOut()+nFee;
     // tx.GetValueOut() + nFee indirectly account for csw inputs amounts too.
 
     double deltaPriority = ((double)(currentHeight-nHeight)*nValueIn)/nModSize;
@@ -55,22 +71,29 @@ double CTxMemPoolEntry::GetPriority(unsigned int currentHeight) const
     return dResult;
 }
 
-CCertificateMemPoolEntry::CCertificateMemPoolEntry(): nCertificateSize(0){}
+CCertificateMemPoolEntry::CCertificateMemPoolEntry(): cert(std::make_shared<const CScCertificate>()), nCertificateSize(0){}
 
 CCertificateMemPoolEntry::CCertificateMemPoolEntry(const CScCertificate& _cert, const CAmount& _nFee,
                                  int64_t _nTime, double _dPriority,
                                  unsigned int _nHeight):
+    CCertificateMemPoolEntry(std::make_shared<const CScCertificate>(_cert), _nFee, _nTime, _dPriority, _nHeight)
+{
+}
+
+CCertificateMemPoolEntry::CCertificateMemPoolEntry(const std::shared_ptr<const CScCertificate>& _cert, const CAmount& _nFee,
+                                 int64_t _nTime, double _dPriority,
+                                 unsigned int _nHeight):
     CMemPoolEntry(_nFee, _nTime, _dPriority, _nHeight),
-    cert(_cert) 
+    cert(_cert)
 {
-    nCertificateSize = cert.GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
-    nModSize = cert.CalculateModifiedSize(nCertificateSize);
-    nUsageSize = RecursiveDynamicUsage(cert);
+    nCertificateSize = cert->GetSerializeSize(SER_NETWORK, PROTOCOL_VERSION);
+    nModSize = cert->CalculateModifiedSize(nCertificateSize);
+    nUsageSize = RecursiveDynamicUsage(*cert) + memusage::DynamicUsage(cert);
 }
 
 double CCertificateMemPoolEntry::GetPriority(unsigned int currentHeight) const
 {
-    CAmount nValueIn = cert.GetValueOfChange()+nFee;
+    CAmount nValueIn = cert->GetValueOfChange()+nFee;
     double deltaPriority = ((double)(currentHeight-nHeight)*nValueIn)/nModSize;
     double dResult = dPriority + deltaPriority;
     LogPrint("mempool", "%s():%d - prioIn[%22.8f] + delta[%22.8f] = prioOut[%22.8f]\n",
@@ -83,26 +106,32 @@ const std::map<int64_t, uint256>::const_reverse_iterator CSidechainMemPoolEntry:
     return mBackwardCertificates.crbegin();
 }
 
+void CSidechainMemPoolEntry::AddCert(int64_t quality, const uint256& hash)
+{
+    assert(mBackwardCertificates.count(quality) == 0);
+    mBackwardCertificates[quality] = hash;
+    mCertQualities[hash] = quality;
+}
+
 void CSidechainMemPoolEntry::EraseCert(const uint256& hash)
 {
-    for(auto it = mBackwardCertificates.begin(); it != mBackwardCertificates.end(); )
-    {
-        if(it->second == hash)
-        {
-            LogPrint("mempool", "%s():%d - removing cert [%s] from mBackwardCertificates\n",
-                __func__, __LINE__, hash.ToString());
-            it = mBackwardCertificates.erase(it);
-        }
-        else
-            ++it;
-    }
+    auto itQuality = mCertQualities.find(hash);
+    if (itQuality == mCertQualities.end())
+        return;
+
+    LogPrint("mempool", "%s():%d - removing cert [%s] from mBackwardCertificates\n",
+        __func__, __LINE__, hash.ToString());
+    mBackwardCertificates.erase(itQuality->second);
+    mCertQualities.erase(itQuality);
 }
 
 const std::map<int64_t, uint256>::const_iterator CSidechainMemPoolEntry::GetCert(const uint256& hash) const
 {
-    // Find certificate with given hash in mapSidechains
-    return std::find_if(mBackwardCertificates.begin( ), mBackwardCertificates.end(),
-        [&hash](const std::map<int64_t, uint256>::value_type& item) { return hash == item.second; });
+    // Find certificate with given hash through its quality, both maps being ordered
+    auto itQuality = mCertQualities.find(hash);
+    if (itQuality == mCertQualities.end())
+        return mBackwardCertificates.end();
+    return mBackwardCertificates.find(itQuality->second);
 }
 
 bool CSidechainMemPoolEntry::HasCert(const uint256& hash) const
@@ -110,8 +139,21 @@ bool CSidechainMemPoolEntry::HasCert(const uint256& hash) const
     return GetCert(hash) != mBackwardCertificates.end();
 }
 
+CMempoolAddressKeyHasher::CMempoolAddressKeyHasher() : salt(GetRandHash()) {}
+
+size_t CMempoolAddressKeyHasher::operator()(const CMempoolAddressKey& key) const
+{
+    uint256 padded;
+    memcpy(padded.begin(), key.addressBytes.begin(), key.addressBytes.size());
+    *(padded.end() - 1) = static_cast<unsigned char>(key.type);
+    return padded.GetHash(salt);
+}
+
+CSpentIndexKeyHasher::CSpentIndexKeyHasher() : salt(GetRandHash()) {}
+
 CTxMemPool::CTxMemPool(const CFeeRate& _minRelayFee) :
-    nTransactionsUpdated(0), nCertificatesUpdated(0), cachedInnerUsage(0)
+    nTransactionsUpdated(0), nPrioritisationsUpdated(0), nCertificatesUpdated(0), nFeesAdded(0), cachedInnerUsage(0), minReasonableRelayFee(_minRelayFee),
+    rollingMinimumFeeRate(0), lastRollingFeeUpdate(GetTime()), blockSinceLastRollingFeeBump(false)
 {
     // Sanity checks off by default for performance, because otherwise
     // accepting transactions becomes O(N^2) where N is the number
@@ -145,6 +187,18 @@ unsigned int CTxMemPool::GetTransactionsUpdated() const
     return nTransactionsUpdated + nCertificatesUpdated;
 }
 
+unsigned int CTxMemPool::GetPrioritisationsUpdated() const
+{
+    LOCK(cs);
+    return nPrioritisationsUpdated;
+}
+
+CAmount CTxMemPool::GetFeesAdded() const
+{
+    LOCK(cs);
+    return nFeesAdded;
+}
+
 void CTxMemPool::AddTransactionsUpdated(unsigned int n)
 {
     LOCK(cs);
@@ -161,8 +215,7 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     mapTx[hash] = entry;
     const CTransaction& tx = mapTx[hash].GetTx();
 
-    mapRecentlyAddedTxBase[tx.GetHash()] = std::shared_ptr<CTransactionBase>(new CTransaction(tx));
-    nRecentlyAddedSequence += 1;
+    AddRecentlyAdded(mapTx[hash].GetSharedTx());
 
     for (unsigned int i = 0; i < tx.GetVin().size(); i++)
         mapNextTx[tx.GetVin()[i].prevout] = CInPoint(&tx, i);
@@ -198,11 +251,16 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
         mapSidechains[btr.scId].mcBtrsTxHashes.insert(hash);
     }
 
+    addToIndex(tx, entry.GetTime(), entry.GetFee(), entry.GetTxSize());
+
     nTransactionsUpdated++;
+    nFeesAdded += entry.GetFee();
     totalTxSize += entry.GetTxSize();
     cachedInnerUsage += entry.DynamicMemoryUsage();
     minerPolicyEstimator->processTransaction(entry, fCurrentEstimate);
 
+    GetMainSignals().TransactionAddedToMempool(hash, ++nSequence);
+
     return true;
 }
 
@@ -212,8 +270,7 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CCertificateMemPoolEntr
     mapCertificate[hash] = entry;
     const CScCertificate& cert = mapCertificate[hash].GetCertificate();
 
-    mapRecentlyAddedTxBase[cert.GetHash()] = std::shared_ptr<CTransactionBase>(new CScCertificate(cert));
-    nRecentlyAddedSequence += 1;
+    AddRecentlyAdded(mapCertificate[hash].GetSharedCertificate());
 
     for (unsigned int i = 0; i < cert.GetVin().size(); i++)
         mapNextTx[cert.GetVin()[i].prevout] = CInPoint(&cert, i);
@@ -222,15 +279,283 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CCertificateMemPoolEntr
         cert.GetHash().ToString(), cert.quality);
 
     auto& sideChain = mapSidechains[cert.GetScId()]; // Creates new element if key does not exist
-    assert(sideChain.mBackwardCertificates.count(cert.quality) == 0);
-    sideChain.mBackwardCertificates[cert.quality] = hash;
+    sideChain.AddCert(cert.quality, hash);
+    updateTopQualityCert(cert.GetScId());
+
+    addToIndex(cert, entry.GetTime(), entry.GetFee(), entry.GetCertificateSize());
 
     nCertificatesUpdated++;
+    nFeesAdded += entry.GetFee();
     totalCertificateSize += entry.GetCertificateSize();
     cachedInnerUsage += entry.DynamicMemoryUsage();
-    // TODO cert: for the time being skip the part on policy estimator, certificates currently have maximum priority
-    // minerPolicyEstimator->processTransaction(entry, fCurrentEstimate);
+    minerPolicyEstimator->processCertificate(entry, fCurrentEstimate);
     LogPrint("mempool", "%s():%d - cert [%s] added in mempool\n", __func__, __LINE__, hash.ToString() );
+
+    GetMainSignals().TransactionAddedToMempool(hash, ++nSequence);
+    return true;
+}
+
+void CTxMemPool::updateTopQualityCert(const uint256& scId)
+{
+    AssertLockHeld(cs);
+    CSidechainMemPoolEntry& sidechain = mapSidechains.at(scId);
+    if (sidechain.mBackwardCertificates.empty())
+    {
+        sidechain.topQualityCert.reset();
+        return;
+    }
+
+    const uint256& hash = sidechain.GetTopQualityCert()->second;
+    if (sidechain.topQualityCert && sidechain.topQualityCert->hash == hash)
+        return;
+
+    const CCertificateMemPoolEntry& entry = mapCertificate.at(hash);
+    std::shared_ptr<CMempoolTopQualityCert> topQualityCert = std::make_shared<CMempoolTopQualityCert>();
+    topQualityCert->cert = entry.GetSharedCertificate();
+    topQualityCert->hash = hash;
+    topQualityCert->epochNumber = entry.GetCertificate().epochNumber;
+    topQualityCert->quality = entry.GetCertificate().quality;
+    topQualityCert->fee = entry.GetFee();
+    topQualityCert->bwtAmount = entry.GetCertificate().GetValueOfBackwardTransfers();
+    sidechain.topQualityCert = topQualityCert;
+}
+
+std::shared_ptr<const CMempoolTopQualityCert> CTxMemPool::getTopQualityCert(const uint256& scId,
+        const Sidechain::ScFixedParameters* scFixedParams) const
+{
+    LOCK(cs);
+    auto it = mapSidechains.find(scId);
+    if (it == mapSidechains.end() || !it->second.topQualityCert)
+        return nullptr;
+
+    const std::shared_ptr<const CMempoolTopQualityCert>& topQualityCert = it->second.topQualityCert;
+    if (scFixedParams && !topQualityCert->dataHash)
+        topQualityCert->dataHash = std::make_shared<const CFieldElement>(topQualityCert->cert->GetDataHash(*scFixedParams));
+    return topQualityCert;
+}
+
+const CTransactionBase* CTxMemPool::lookupTxBase(const uint256& hash) const
+{
+    AssertLockHeld(cs);
+    std::map<uint256, CTxMemPoolEntry>::const_iterator itTx = mapTx.find(hash);
+    if (itTx != mapTx.end())
+        return &itTx->second.GetTx();
+
+    std::map<uint256, CCertificateMemPoolEntry>::const_iterator itCert = mapCertificate.find(hash);
+    if (itCert != mapCertificate.end())
+        return &itCert->second.GetCertificate();
+
+    return nullptr;
+}
+
+void CTxMemPool::addToIndex(const CTransactionBase& txBase, int64_t nTime, const CAmount& nFee, size_t nSize)
+{
+    AssertLockHeld(cs);
+    CAmount nModifiedFee = nFee;
+    std::map<uint256, std::pair<double, CAmount> >::const_iterator pos = mapDeltas.find(txBase.GetHash());
+    if (pos != mapDeltas.end())
+        nModifiedFee += pos->second.second;
+
+    CMemPoolIndexEntry indexEntry(txBase.GetHash(), txBase.IsCertificate(), nTime, nModifiedFee, nSize);
+    const std::vector<uint256> ancestors = mempoolDependenciesFrom(txBase);
+    for(const uint256& ancestor : ancestors)
+    {
+        indexed_mempool_set::const_iterator itAncestor = mapIndex.find(ancestor);
+        assert(itAncestor != mapIndex.end());
+        indexEntry.nModFeesWithAncestors += itAncestor->nModifiedFee;
+        indexEntry.nSizeWithAncestors += itAncestor->nSize;
+        indexEntry.nCountWithAncestors++;
+    }
+    mapIndex.insert(indexEntry);
+
+    for(const uint256& ancestor : ancestors)
+        modifyDescendantState(ancestor, nModifiedFee, nSize, 1);
+
+    // Usually nothing in the mempool depends on a new entry, but a tx put back in the mempool when a block
+    // is disconnected may create a sidechain the mempool fwds and btrs are directed to. Its ancestors may
+    // then reach them through it too, hence the states of both sides are recomputed.
+    const std::vector<uint256> descendants = mempoolDependenciesOf(txBase);
+    if (!descendants.empty())
+    {
+        updateDescendantState(txBase);
+        updatePackageStates(ancestors, descendants);
+    }
+}
+
+void CTxMemPool::modifyAncestorState(const uint256& hash, const CAmount& nFeeDiff, int64_t nSizeDiff, int64_t nCountDiff)
+{
+    AssertLockHeld(cs);
+    indexed_mempool_set::iterator it = mapIndex.find(hash);
+    assert(it != mapIndex.end());
+    mapIndex.modify(it, [nFeeDiff, nSizeDiff, nCountDiff](CMemPoolIndexEntry& indexEntry) {
+        indexEntry.nModFeesWithAncestors += nFeeDiff;
+        indexEntry.nSizeWithAncestors += nSizeDiff;
+        indexEntry.nCountWithAncestors += nCountDiff;
+    });
+}
+
+void CTxMemPool::modifyDescendantState(const uint256& hash, const CAmount& nFeeDiff, int64_t nSizeDiff, int64_t nCountDiff)
+{
+    AssertLockHeld(cs);
+    indexed_mempool_set::iterator it = mapIndex.find(hash);
+    assert(it != mapIndex.end());
+    mapIndex.modify(it, [nFeeDiff, nSizeDiff, nCountDiff](CMemPoolIndexEntry& indexEntry) {
+        indexEntry.nModFeesWithDescendants += nFeeDiff;
+        indexEntry.nSizeWithDescendants += nSizeDiff;
+        indexEntry.nCountWithDescendants += nCountDiff;
+    });
+}
+
+void CTxMemPool::updateAncestorState(const CTransactionBase& txBase)
+{
+    AssertLockHeld(cs);
+    indexed_mempool_set::iterator it = mapIndex.find(txBase.GetHash());
+    assert(it != mapIndex.end());
+
+    CAmount nModFeesWithAncestors = it->nModifiedFee;
+    size_t nSizeWithAncestors = it->nSize;
+    uint64_t nCountWithAncestors = 1;
+    for(const uint256& ancestor : mempoolDependenciesFrom(txBase))
+    {
+        indexed_mempool_set::const_iterator itAncestor = mapIndex.find(ancestor);
+        assert(itAncestor != mapIndex.end());
+        nModFeesWithAncestors += itAncestor->nModifiedFee;
+        nSizeWithAncestors += itAncestor->nSize;
+        nCountWithAncestors++;
+    }
+
+    mapIndex.modify(it, [nModFeesWithAncestors, nSizeWithAncestors, nCountWithAncestors](CMemPoolIndexEntry& indexEntry) {
+        indexEntry.nModFeesWithAncestors = nModFeesWithAncestors;
+        indexEntry.nSizeWithAncestors = nSizeWithAncestors;
+        indexEntry.nCountWithAncestors = nCountWithAncestors;
+    });
+}
+
+void CTxMemPool::updateDescendantState(const CTransactionBase& txBase)
+{
+    AssertLockHeld(cs);
+    indexed_mempool_set::iterator it = mapIndex.find(txBase.GetHash());
+    assert(it != mapIndex.end());
+
+    CAmount nModFeesWithDescendants = it->nModifiedFee;
+    size_t nSizeWithDescendants = it->nSize;
+    uint64_t nCountWithDescendants = 1;
+    for(const uint256& descendant : mempoolDependenciesOf(txBase))
+    {
+        indexed_mempool_set::const_iterator itDescendant = mapIndex.find(descendant);
+        assert(itDescendant != mapIndex.end());
+        nModFeesWithDescendants += itDescendant->nModifiedFee;
+        nSizeWithDescendants += itDescendant->nSize;
+        nCountWithDescendants++;
+    }
+
+    mapIndex.modify(it, [nModFeesWithDescendants, nSizeWithDescendants, nCountWithDescendants](CMemPoolIndexEntry& indexEntry) {
+        indexEntry.nModFeesWithDescendants = nModFeesWithDescendants;
+        indexEntry.nSizeWithDescendants = nSizeWithDescendants;
+        indexEntry.nCountWithDescendants = nCountWithDescendants;
+    });
+}
+
+void CTxMemPool::updatePackageStates(const std::vector<uint256>& ancestors, const std::vector<uint256>& descendants)
+{
+    // the entries may have left the mempool meanwhile
+    AssertLockHeld(cs);
+    for(const uint256& ancestor : ancestors)
+    {
+        const CTransactionBase* pTxBase = lookupTxBase(ancestor);
+        if (pTxBase != nullptr)
+            updateDescendantState(*pTxBase);
+    }
+
+    for(const uint256& descendant : descendants)
+    {
+        const CTransactionBase* pTxBase = lookupTxBase(descendant);
+        if (pTxBase != nullptr)
+            updateAncestorState(*pTxBase);
+    }
+}
+
+void CTxMemPool::applyFeeDelta(const uint256& hash, const CAmount& nFeeDelta)
+{
+    AssertLockHeld(cs);
+    indexed_mempool_set::iterator it = mapIndex.find(hash);
+    if (it == mapIndex.end() || nFeeDelta == 0)
+        return;
+
+    mapIndex.modify(it, [nFeeDelta](CMemPoolIndexEntry& indexEntry) {
+        indexEntry.nModifiedFee += nFeeDelta;
+        indexEntry.nModFeesWithAncestors += nFeeDelta;
+        indexEntry.nModFeesWithDescendants += nFeeDelta;
+    });
+
+    const CTransactionBase* pTxBase = lookupTxBase(hash);
+    assert(pTxBase != nullptr);
+    for(const uint256& ancestor : mempoolDependenciesFrom(*pTxBase))
+        modifyDescendantState(ancestor, nFeeDelta, 0, 0);
+    for(const uint256& descendant : mempoolDependenciesOf(*pTxBase))
+        modifyAncestorState(descendant, nFeeDelta, 0, 0);
+}
+
+CFeeRate CTxMemPool::GetDescendantFeeRate(const uint256& hash) const
+{
+    LOCK(cs);
+    indexed_mempool_set::const_iterator it = mapIndex.find(hash);
+    if (it == mapIndex.end())
+        return CFeeRate(0);
+    return CFeeRate(it->nModFeesWithDescendants, it->nSizeWithDescendants);
+}
+
+bool CTxMemPool::checkPackageLimits(const CTransactionBase& txBase, size_t nSize,
+    uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize,
+    std::string& errString) const
+{
+    LOCK(cs);
+    const std::vector<uint256> ancestors = mempoolDependenciesFrom(txBase);
+    if (limitAncestorCount > 0 && ancestors.size() + 1 > limitAncestorCount)
+    {
+        errString = strprintf("too many unconfirmed ancestors [limit: %u]", limitAncestorCount);
+        return false;
+    }
+
+    size_t nSizeWithAncestors = nSize;
+    for(const uint256& ancestor : ancestors)
+    {
+        // the cached totals make each ancestor cost a lookup, whatever the size of its package
+        indexed_mempool_set::const_iterator itAncestor = mapIndex.find(ancestor);
+        assert(itAncestor != mapIndex.end());
+        nSizeWithAncestors += itAncestor->nSize;
+
+        if (limitDescendantCount > 0 && itAncestor->nCountWithDescendants + 1 > limitDescendantCount)
+        {
+            errString = strprintf("too many descendants for tx %s [limit: %u]", ancestor.ToString(), limitDescendantCount);
+            return false;
+        }
+        if (limitDescendantSize > 0 && itAncestor->nSizeWithDescendants + nSize > limitDescendantSize)
+        {
+            errString = strprintf("exceeds descendant size limit for tx %s [limit: %u]", ancestor.ToString(), limitDescendantSize);
+            return false;
+        }
+    }
+
+    if (limitAncestorSize > 0 && nSizeWithAncestors > limitAncestorSize)
+    {
+        errString = strprintf("exceeds ancestor size limit [limit: %u]", limitAncestorSize);
+        return false;
+    }
+    return true;
+}
+
+bool CTxMemPool::isEvictable(const CTransactionBase& txBase) const
+{
+    AssertLockHeld(cs);
+    if (txBase.IsCertificate())
+        return false;
+
+    for(const uint256& descendant : mempoolDependenciesOf(txBase))
+    {
+        if (mapCertificate.count(descendant))
+            return false;
+    }
     return true;
 }
 
@@ -238,6 +563,7 @@ void CTxMemPool::addAddressIndex(const CTransactionBase &txBase, int64_t nTime,
 {
     LOCK(cs);
     std::vector<CMempoolAddressDeltaKey> inserted;
+    const uint64_t nGeneration = ++nAddressGeneration;
 
     const uint256& txBaseHash = txBase.GetHash();
     for (unsigned int j = 0; j < txBase.GetVin().size(); j++) {
@@ -251,7 +577,9 @@ void CTxMemPool::addAddressIndex(const CTransactionBase &txBase, int64_t nTime,
 
         CMempoolAddressDeltaKey key(addressType, prevout.scriptPubKey.AddressHash(), txBaseHash, j, 1);
         CMempoolAddressDelta delta(nTime, prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-        mapAddress.insert(std::make_pair(key, delta));
+        CMempoolAddressDeltas& bucket = mapAddress[CMempoolAddressKey(key)];
+        bucket.deltas.push_back(std::make_pair(key, delta));
+        bucket.nGeneration = nGeneration;
         inserted.push_back(key);
     }
 
@@ -308,7 +636,7 @@ void CTxMemPool::addAddressIndex(const CTransactionBase &txBase, int64_t nTime,
                 const AddressType addressType = fromScriptTypeToAddressType(scriptType);
 
                 CMempoolAddressDeltaKey key(addressType, out.scriptPubKey.AddressHash(), certSuperseededHash, m, 0);
-                mapAddress[key].outStatus = CMempoolAddressDelta::OutputStatus::LOW_QUALITY_CERT_BACKWARD_TRANSFER;
+                setAddressOutStatus(key, CMempoolAddressDelta::OutputStatus::LOW_QUALITY_CERT_BACKWARD_TRANSFER);
 
             }
         }
@@ -332,11 +660,14 @@ void CTxMemPool::addAddressIndex(const CTransactionBase &txBase, int64_t nTime,
         const AddressType addressType = fromScriptTypeToAddressType(scriptType);
 
         CMempoolAddressDeltaKey key(addressType, out.scriptPubKey.AddressHash(), txBaseHash, k, 0);
-        mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(nTime, out.nValue, outStatus)));
+        CMempoolAddressDeltas& bucket = mapAddress[CMempoolAddressKey(key)];
+        bucket.deltas.push_back(std::make_pair(key, CMempoolAddressDelta(nTime, out.nValue, outStatus)));
+        bucket.nGeneration = nGeneration;
         inserted.push_back(key);
     }
 
     mapAddressInserted.insert(std::make_pair(txBaseHash, inserted));
+    notifyAddressChange();
 }
 
 void CTxMemPool::updateTopQualCertAddressIndex(const uint256& scid)
@@ -359,8 +690,9 @@ void CTxMemPool::updateTopQualCertAddressIndex(const uint256& scid)
             const AddressType addressType = fromScriptTypeToAddressType(scriptType);
 
             CMempoolAddressDeltaKey key(addressType, out.scriptPubKey.AddressHash(), topQualHash, m, 0);
-            mapAddress[key].outStatus = CMempoolAddressDelta::OutputStatus::TOP_QUALITY_CERT_BACKWARD_TRANSFER;
+            setAddressOutStatus(key, CMempoolAddressDelta::OutputStatus::TOP_QUALITY_CERT_BACKWARD_TRANSFER);
         }
+        notifyAddressChange();
     }
 }
 
@@ -372,11 +704,9 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, AddressType> > &
         
     LOCK(cs);
     for (const auto& [addressHash, addressType] : addresses) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey(addressType, addressHash));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == addressHash && (*ait).first.type == addressType) {
-            results.push_back(*ait);
-            ait++;
-        }
+        addressDeltaMap::const_iterator ait = mapAddress.find(CMempoolAddressKey(addressType, addressHash));
+        if (ait != mapAddress.end())
+            results.insert(results.end(), ait->second.deltas.begin(), ait->second.deltas.end());
     }
     return true;
 }
@@ -387,16 +717,89 @@ bool CTxMemPool::removeAddressIndex(const uint256& txBaseHash)
     addressDeltaMapInserted::iterator it = mapAddressInserted.find(txBaseHash);
 
     if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
+        const uint64_t nGeneration = ++nAddressGeneration;
+        for (const CMempoolAddressDeltaKey& key : it->second) {
+            addressDeltaMap::iterator ait = mapAddress.find(CMempoolAddressKey(key));
+            // all the deltas of the tx in the bucket are removed at its first key
+            if (ait == mapAddress.end() || ait->second.nGeneration == nGeneration)
+                continue;
+
+            std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> >& deltas = ait->second.deltas;
+            deltas.erase(std::remove_if(deltas.begin(), deltas.end(),
+                                        [&txBaseHash](const std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta>& delta)
+                                        { return delta.first.txhash == txBaseHash; }),
+                         deltas.end());
+            if (deltas.empty()) {
+                mapAddress.erase(ait);
+                nAddressEmptiedGeneration = nGeneration;
+            } else {
+                ait->second.nGeneration = nGeneration;
+            }
         }
         mapAddressInserted.erase(it);
+        notifyAddressChange();
     }
 
     return true;
 }
 
+void CTxMemPool::setAddressOutStatus(const CMempoolAddressDeltaKey& key, CMempoolAddressDelta::OutputStatus outStatus)
+{
+    addressDeltaMap::iterator ait = mapAddress.find(CMempoolAddressKey(key));
+    if (ait == mapAddress.end())
+        return;
+
+    for (auto& delta : ait->second.deltas) {
+        if (delta.first.txhash == key.txhash && delta.first.index == key.index && delta.first.spending == key.spending) {
+            if (delta.second.outStatus != outStatus) {
+                delta.second.outStatus = outStatus;
+                ait->second.nGeneration = ++nAddressGeneration;
+            }
+            return;
+        }
+    }
+}
+
+void CTxMemPool::notifyAddressChange()
+{
+    // Taking the lock orders the notification after the check of a waiter about to sleep
+    {
+        boost::unique_lock<boost::mutex> lock(csAddressChange);
+    }
+    cvAddressChange.notify_all();
+}
+
+uint64_t CTxMemPool::getAddressGeneration(const std::vector<std::pair<uint160, AddressType> >& addresses) const
+{
+    LOCK(cs);
+    uint64_t nGeneration = 0;
+    for (const auto& [addressHash, addressType] : addresses) {
+        addressDeltaMap::const_iterator ait = mapAddress.find(CMempoolAddressKey(addressType, addressHash));
+        nGeneration = std::max(nGeneration, ait != mapAddress.end() ? ait->second.nGeneration : nAddressEmptiedGeneration);
+    }
+    return nGeneration;
+}
+
+uint64_t CTxMemPool::waitForAddressChange(const std::vector<std::pair<uint160, AddressType> >& addresses,
+                                          uint64_t nGeneration, int64_t nTimeoutMillis)
+{
+    boost::system_time deadline = boost::get_system_time() + boost::posix_time::milliseconds(nTimeoutMillis);
+    uint64_t nCurrent = getAddressGeneration(addresses);
+    while (nCurrent == nGeneration) {
+        // Any change of the index is waited for, then the generation of the addresses is checked again
+        uint64_t nSeen = nAddressGeneration;
+        {
+            boost::unique_lock<boost::mutex> lock(csAddressChange);
+            while (nAddressGeneration == nSeen) {
+                if (!cvAddressChange.timed_wait(lock, deadline))
+                    return getAddressGeneration(addresses);
+            }
+        }
+        nCurrent = getAddressGeneration(addresses);
+    }
+    return nCurrent;
+}
+
 void CTxMemPool::addSpentIndex(const CTransactionBase &txBase, const CCoinsViewCache &view)
 {
     LOCK(cs);
@@ -434,6 +837,18 @@ bool CTxMemPool::getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     return false;
 }
 
+void CTxMemPool::getSpentIndexOutputs(const uint256& txid, unsigned int nOutputs, std::map<unsigned int, CSpentIndexValue> &values)
+{
+    LOCK(cs);
+    if (mapSpent.empty())
+        return;
+    for (unsigned int i = 0; i < nOutputs; i++) {
+        mapSpentIndex::const_iterator it = mapSpent.find(CSpentIndexKey(txid, i));
+        if (it != mapSpent.end())
+            values[i] = it->second;
+    }
+}
+
 bool CTxMemPool::removeSpentIndex(const uint256& txBaseHash)
 {
     LOCK(cs);
@@ -491,6 +906,8 @@ std::vector<uint256> CTxMemPool::mempoolDependenciesFrom(const CTransactionBase&
     AssertLockHeld(cs);
     std::vector<uint256> res = mempoolDirectDependenciesFrom(originTx);
     std::deque<uint256> toVisit{res.begin(), res.end()};
+    std::set<uint256> visited{res.begin(), res.end()}; // toVisit and res, for lookups in logarithmic time
+    std::set<uint256> found;
     res.clear();
 
     while(!toVisit.empty())
@@ -505,13 +922,12 @@ std::vector<uint256> CTxMemPool::mempoolDependenciesFrom(const CTransactionBase&
             assert(pCurrentNode);
 
         toVisit.pop_back();
-        if (std::find(res.begin(), res.end(), pCurrentNode->GetHash()) == res.end())
+        if (found.insert(pCurrentNode->GetHash()).second)
             res.push_back(pCurrentNode->GetHash());
 
         std::vector<uint256> directAncestors = mempoolDirectDependenciesFrom(*pCurrentNode);
         for(const uint256& ancestor : directAncestors) {
-            if ( (std::find(toVisit.begin(), toVisit.end(), ancestor) == toVisit.end()) &&
-                 (std::find(res.begin(), res.end(), ancestor) == res.end()))
+            if (visited.insert(ancestor).second)
                 toVisit.push_front(ancestor);
         }
     }
@@ -565,6 +981,8 @@ std::vector<uint256> CTxMemPool::mempoolDependenciesOf(const CTransactionBase& o
     AssertLockHeld(cs);
     std::vector<uint256> res = mempoolDirectDependenciesOf(origTx);
     std::deque<uint256> toVisit{res.begin(), res.end()};
+    std::set<uint256> visited{res.begin(), res.end()}; // toVisit and res, for lookups in logarithmic time
+    std::set<uint256> found;
     res.clear();
 
     while(!toVisit.empty())
@@ -579,30 +997,59 @@ std::vector<uint256> CTxMemPool::mempoolDependenciesOf(const CTransactionBase& o
             assert(pCurrentRoot);
 
         toVisit.pop_front();
-        if (std::find(res.begin(), res.end(), pCurrentRoot->GetHash()) == res.end())
+        if (found.insert(pCurrentRoot->GetHash()).second)
             res.push_back(pCurrentRoot->GetHash());
 
         std::vector<uint256> directDescendants = mempoolDirectDependenciesOf(*pCurrentRoot);
         for(const uint256& dep : directDescendants)
-            if ((std::find(toVisit.begin(), toVisit.end(),dep) == toVisit.end()) &&
-                (std::find(res.begin(), res.end(),dep) == res.end()))
+            if (visited.insert(dep).second)
                 toVisit.push_front(dep);
     }
 
     return res;
 }
 
-void CTxMemPool::remove(const CTransactionBase& origTx, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts, bool fRecursive)
+void CTxMemPool::remove(const CTransactionBase& origTx, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts, bool fRecursive,
+                        MemPoolRemovalReason reason)
 {
     // Remove transaction from memory pool
     LOCK(cs);
     std::vector<uint256> objToRemove{};
 
+    // the descendants are left in the mempool if not removed recursively, without origTx among their ancestors,
+    // while the ancestors of the removed objects lose them as descendants
+    std::vector<uint256> remainingDescendants{};
+    std::vector<uint256> ancestors{};
+
     if (fRecursive)
         objToRemove = mempoolDependenciesOf(origTx);
+    else if (mapIndex.count(origTx.GetHash()))
+        remainingDescendants = mempoolDependenciesOf(origTx);
 
     objToRemove.insert(objToRemove.begin(), origTx.GetHash());
 
+    if (remainingDescendants.empty())
+    {
+        // Nothing left in the mempool depends on the removed objects, so each of their ancestors just loses
+        // them from its descendants
+        const std::set<uint256> removing(objToRemove.begin(), objToRemove.end());
+        for(const uint256& hash : objToRemove)
+        {
+            indexed_mempool_set::const_iterator it = mapIndex.find(hash);
+            if (it == mapIndex.end())
+                continue;
+            for(const uint256& ancestor : mempoolDependenciesFrom(*lookupTxBase(hash)))
+            {
+                if (removing.count(ancestor) == 0)
+                    modifyDescendantState(ancestor, -it->nModifiedFee, -(int64_t)it->nSize, -1);
+            }
+        }
+    } else
+    {
+        // The ancestors of origTx may have reached the remaining descendants only through it
+        ancestors = mempoolDependenciesFrom(origTx);
+    }
+
     for(const uint256& hash : objToRemove)
     {
         if (mapTx.count(hash))
@@ -670,9 +1117,11 @@ void CTxMemPool::remove(const CTransactionBase& origTx, std::list<CTransaction>&
 
             LogPrint("mempool", "%s():%d - removing tx [%s] from mempool\n", __func__, __LINE__, hash.ToString() );
             mapTx.erase(hash);
+            mapIndex.erase(hash);
 
             nTransactionsUpdated++;
             minerPolicyEstimator->removeTx(hash);
+            GetMainSignals().TransactionRemovedFromMempool(hash, reason, ++nSequence);
 
             if (fAddressIndex)
                 removeAddressIndex(hash);
@@ -699,6 +1148,7 @@ void CTxMemPool::remove(const CTransactionBase& origTx, std::list<CTransaction>&
             LogPrint("mempool", "%s():%d - removing cert [%s] from mapSidechain[%s]\n",
                 __func__, __LINE__, hash.ToString(), scid.ToString());
             mapSidechains.at(scid).EraseCert(hash);
+            updateTopQualityCert(scid);
 
             if (mapSidechains.at(scid).IsNull())
             {
@@ -712,7 +1162,10 @@ void CTxMemPool::remove(const CTransactionBase& origTx, std::list<CTransaction>&
             cachedInnerUsage -= mapCertificate[hash].DynamicMemoryUsage();
             LogPrint("mempool", "%s():%d - removing cert [%s] from mempool\n", __func__, __LINE__, hash.ToString() );
             mapCertificate.erase(hash);
+            mapIndex.erase(hash);
             nCertificatesUpdated++;
+            minerPolicyEstimator->removeTx(hash);
+            GetMainSignals().TransactionRemovedFromMempool(hash, reason, ++nSequence);
 
             if (fAddressIndex) {
                 removeAddressIndex(hash);
@@ -727,6 +1180,8 @@ void CTxMemPool::remove(const CTransactionBase& origTx, std::list<CTransaction>&
                 removeSpentIndex(hash);
         }
     }
+
+    updatePackageStates(ancestors, remainingDescendants);
 }
 
 inline bool CTxMemPool::checkTxImmatureExpenditures(const CTransaction& tx, const CCoinsViewCache * const pcoins)
@@ -857,18 +1312,16 @@ void CTxMemPool::removeCertificatesWithoutRef(const CCoinsViewCache * const pCoi
         if (cert_it != mapCertificate.end())
         {
             const CScCertificate& cert = cert_it->second.GetCertificate();
-            remove(cert, dummyTxs, outdatedCerts, true);
+            remove(cert, dummyTxs, outdatedCerts, true, MemPoolRemovalReason::STALE);
         }
     }
     LogPrint("mempool", "%s():%d - removed %zu certs and %zu txes\n", __func__, __LINE__, outdatedCerts.size(), dummyTxs.size());
 
 }
 
-void CTxMemPool::removeStaleCertificates(const CCoinsViewCache * const pCoinsView,
-                                         std::list<CScCertificate>& outdatedCerts)
+void CTxMemPool::collectStaleCertificates(const CCoinsViewCache * const pCoinsView, std::set<uint256>& certsToRemove)
 {
-    LOCK(cs);
-    std::set<uint256> certsToRemove;
+    AssertLockHeld(cs);
 
     // Remove certificates referring to this block as end epoch
     for (std::map<uint256, CCertificateMemPoolEntry>::const_iterator itCert = mapCertificate.begin(); itCert != mapCertificate.end(); itCert++)
@@ -912,17 +1365,17 @@ void CTxMemPool::removeStaleCertificates(const CCoinsViewCache * const pCoinsVie
         }
 
     }
+}
+
+void CTxMemPool::removeStaleCertificates(const CCoinsViewCache * const pCoinsView,
+                                         std::list<CScCertificate>& outdatedCerts)
+{
+    LOCK(cs);
+    std::set<uint256> certsToRemove;
+    collectStaleCertificates(pCoinsView, certsToRemove);
 
     std::list<CTransaction> dummyTxs;
-    for(const auto& hash: certsToRemove)
-    {
-        // there can be dependancy also between certs, so check that a cert is still in map during the loop
-        if (mapCertificate.count(hash))
-        {
-            const CScCertificate& cert = mapCertificate.at(hash).GetCertificate();
-            remove(cert, dummyTxs, outdatedCerts, true);
-        }
-    }
+    removeRecursively(certsToRemove, dummyTxs, outdatedCerts, MemPoolRemovalReason::STALE);
     LogPrint("mempool", "%s():%d - removed %d certs and %d txes\n", __func__, __LINE__, outdatedCerts.size(), dummyTxs.size());
 }
 
@@ -949,15 +1402,16 @@ void CTxMemPool::removeWithAnchor(const uint256 &invalidRoot)
     BOOST_FOREACH(const CTransaction& tx, transactionsToRemove) {
         std::list<CTransaction> dummyTxs;
         std::list<CScCertificate> dummyCerts;
-        remove(tx, dummyTxs, dummyCerts, true);
+        remove(tx, dummyTxs, dummyCerts, true, MemPoolRemovalReason::STALE);
     }
 }
 
-void CTxMemPool::removeOutOfScBalanceCsw(const CCoinsViewCache * const pCoinsView, std::list<CTransaction> &removedTxs, std::list<CScCertificate> &removedCerts)
+void CTxMemPool::collectOutOfScBalanceCsw(const CCoinsViewCache * const pCoinsView, std::set<uint256>& txesToRemove) const
 {
+    AssertLockHeld(cs);
+
     // Remove CSWs that try to withdraw more coins than belongs to the sidechain.
     // Note: if there is a CSW values conflict (may occur only if CSW circuit is broken or malicious) -> remove all CSWs for given sidechain.
-    std::set<uint256> txesToRemove;
     for (std::map<uint256, CSidechainMemPoolEntry>::const_iterator sIt = mapSidechains.begin(); sIt != mapSidechains.end(); sIt++)
     {
         const CSidechainMemPoolEntry &sidechainEntry = sIt->second;
@@ -971,80 +1425,86 @@ void CTxMemPool::removeOutOfScBalanceCsw(const CCoinsViewCache * const pCoinsVie
 
         for (auto nIt = sidechainEntry.cswNullifiers.begin(); nIt != sidechainEntry.cswNullifiers.end(); nIt++)
         {
-            const uint256 &txHash = nIt->second;
-            const CTransaction &tx = mapTx[txHash].GetTx();
-            txesToRemove.insert(tx.GetHash());
+            txesToRemove.insert(nIt->second);
         }
     }
+}
 
-    for(const auto& hash: txesToRemove)
+void CTxMemPool::removeOutOfScBalanceCsw(const CCoinsViewCache * const pCoinsView, std::list<CTransaction> &removedTxs, std::list<CScCertificate> &removedCerts)
+{
+    LOCK(cs);
+    std::set<uint256> txesToRemove;
+    collectOutOfScBalanceCsw(pCoinsView, txesToRemove);
+    removeRecursively(txesToRemove, removedTxs, removedCerts, MemPoolRemovalReason::STALE);
+}
+
+void CTxMemPool::removeRecursively(const std::set<uint256>& hashes, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts,
+                                   MemPoolRemovalReason reason)
+{
+    AssertLockHeld(cs);
+
+    for(const uint256& hash: hashes)
     {
-        // there can be dependancy also between txes, so check that a tx is still in map during the loop
-        if (mapTx.count(hash))
-        {
-            const CTransaction& tx = mapTx.at(hash).GetTx();
-            remove(tx, removedTxs, removedCerts, true);
-        }
+        // there can be dependancies between the entries, so check that each one is still in the mempool during the loop
+        const CTransactionBase* txBase = lookupTxBase(hash);
+        if (txBase != nullptr)
+            remove(*txBase, removedTxs, removedCerts, true, reason);
     }
 }
 
-void CTxMemPool::removeConflicts(const CTransaction &tx, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts)
+void CTxMemPool::collectConflicts(const CTransaction &tx, std::set<uint256>& conflicts) const
 {
-    LOCK(cs);
+    AssertLockHeld(cs);
+    const uint256& hash = tx.GetHash();
 
     for(const CTxIn &txin: tx.GetVin())
     {
-        std::map<COutPoint, CInPoint>::iterator it = mapNextTx.find(txin.prevout);
-        if (it == mapNextTx.end())
-            continue;
-
-        const CTransactionBase &txConflict = *it->second.ptx;
-        if (txConflict != tx)
-            remove(txConflict, removedTxs, removedCerts, true);
+        std::map<COutPoint, CInPoint>::const_iterator it = mapNextTx.find(txin.prevout);
+        if (it != mapNextTx.end() && it->second.ptx->GetHash() != hash)
+            conflicts.insert(it->second.ptx->GetHash());
     }
 
     for(const JSDescription &joinsplit: tx.GetVjoinsplit())
     {
         for(const uint256 &nf: joinsplit.nullifiers)
         {
-            std::map<uint256, const CTransaction*>::iterator it = mapNullifiers.find(nf);
-            if (it == mapNullifiers.end())
-                continue;
-
-            const CTransactionBase &txConflict = *it->second;
-            if (txConflict != tx)
-                remove(txConflict, removedTxs, removedCerts, true);
-
+            std::map<uint256, const CTransaction*>::const_iterator it = mapNullifiers.find(nf);
+            if (it != mapNullifiers.end() && it->second->GetHash() != hash)
+                conflicts.insert(it->second->GetHash());
         }
     }
 
     for(const CTxCeasedSidechainWithdrawalInput& csw: tx.GetVcswCcIn())
     {
-        if (mapSidechains.count(csw.scId) == 0)
+        const auto& scIt = mapSidechains.find(csw.scId);
+        if (scIt == mapSidechains.end())
             continue;
 
-        const auto& cswNullifierTx = mapSidechains.at(csw.scId).cswNullifiers.find(csw.nullifier);
-        if(cswNullifierTx == mapSidechains.at(csw.scId).cswNullifiers.end())
+        const auto& cswNullifierTx = scIt->second.cswNullifiers.find(csw.nullifier);
+        if(cswNullifierTx == scIt->second.cswNullifiers.end())
             continue;
 
-        const uint256& txHash = cswNullifierTx->second;
-        const auto& it = mapTx.find(txHash);
         // If CSW nullifier was present in cswNullifers, the containing tx must be present in the mempool.
-        assert(it != mapTx.end());
-
-        const CTransaction &txConflict = it->second.GetTx();
-        if (txConflict != tx)
-            remove(txConflict, removedTxs, removedCerts, true);
+        assert(mapTx.count(cswNullifierTx->second));
+        if (cswNullifierTx->second != hash)
+            conflicts.insert(cswNullifierTx->second);
     }
+}
+
+void CTxMemPool::removeConflicts(const CTransaction &tx, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts)
+{
+    LOCK(cs);
+
+    std::set<uint256> conflicts;
+    collectConflicts(tx, conflicts);
+    removeRecursively(conflicts, removedTxs, removedCerts, MemPoolRemovalReason::CONFLICT);
 
     removeOutOfScBalanceCsw(pcoinsTip, removedTxs, removedCerts);
 }
 
-void CTxMemPool::removeStaleTransactions(const CCoinsViewCache * const pCoinsView,
-                                         std::list<CTransaction>& outdatedTxs, std::list<CScCertificate>& outdatedCerts)
+void CTxMemPool::collectStaleTransactions(const CCoinsViewCache * const pCoinsView, std::set<uint256>& txesToRemove)
 {
-    LOCK(cs);
-    std::set<uint256> txesToRemove;
+    AssertLockHeld(cs);
 
     for (std::map<uint256, CTxMemPoolEntry>::const_iterator it = mapTx.begin(); it != mapTx.end(); it++)
     {
@@ -1093,17 +1553,16 @@ void CTxMemPool::removeStaleTransactions(const CCoinsViewCache * const pCoinsVie
             }
         }
     }
+}
+
+void CTxMemPool::removeStaleTransactions(const CCoinsViewCache * const pCoinsView,
+                                         std::list<CTransaction>& outdatedTxs, std::list<CScCertificate>& outdatedCerts)
+{
+    LOCK(cs);
+    std::set<uint256> txesToRemove;
+    collectStaleTransactions(pCoinsView, txesToRemove);
+    removeRecursively(txesToRemove, outdatedTxs, outdatedCerts, MemPoolRemovalReason::STALE);
 
-    for(const auto& hash: txesToRemove)
-    {
-        // there can be dependancy also between txes, so check that a tx is still in map during the loop
-        if (mapTx.count(hash))
-        {
-            const CTransaction& tx = mapTx.at(hash).GetTx();
-            remove(tx, outdatedTxs, outdatedCerts, true);
-        }
-    }
-    
     LogPrint("mempool", "%s():%d - removed %d certs and %d txes\n", __func__, __LINE__, outdatedCerts.size(), outdatedTxs.size());
 }
 
@@ -1128,37 +1587,42 @@ void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, unsigned i
     {
         std::list<CTransaction> dummyTxs;
         std::list<CScCertificate> dummyCerts;
-        remove(tx, dummyTxs, dummyCerts, /*fRecursive*/false);
+        remove(tx, dummyTxs, dummyCerts, /*fRecursive*/false, MemPoolRemovalReason::BLOCK);
         removeConflicts(tx, conflictingTxs, conflictingCerts);
         ClearPrioritisation(tx.GetHash());
     }
     // After the txs in the new block have been removed from the mempool, update policy estimates
     minerPolicyEstimator->processBlock(nBlockHeight, entries, fCurrentEstimate);
+
+    // the rolling minimum fee starts decaying
+    lastRollingFeeUpdate = GetTime();
+    blockSinceLastRollingFeeBump = true;
 }
 
-void CTxMemPool::removeConflicts(const CScCertificate &cert, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts) {
-    LOCK(cs);
+void CTxMemPool::collectConflicts(const CScCertificate &cert, std::set<uint256>& conflicts) const
+{
+    AssertLockHeld(cs);
+
     for(const CTxIn &txin: cert.GetVin()) {
-        std::map<COutPoint, CInPoint>::iterator it = mapNextTx.find(txin.prevout);
+        std::map<COutPoint, CInPoint>::const_iterator it = mapNextTx.find(txin.prevout);
         if (it != mapNextTx.end()) {
             const CTransactionBase &txConflict = *it->second.ptx;
             if (txConflict.GetHash() != cert.GetHash())
             {
                 LogPrint("mempool", "%s():%d - removing [%s] conflicting with cert [%s]\n",
                     __func__, __LINE__, txConflict.GetHash().ToString(), cert.GetHash().ToString());
-                remove(txConflict, removedTxs, removedCerts, true);
+                conflicts.insert(txConflict.GetHash());
             }
         }
     }
 
-    const uint256& scId = cert.GetScId();
-    if (mapSidechains.count(scId) == 0)
+    const auto& scIt = mapSidechains.find(cert.GetScId());
+    if (scIt == mapSidechains.end())
         return;
 
     // cert has been confirmed in a block, therefore any other cert in mempool for this scid
     // with equal or lower quality is deemed conflicting and must be removed
-    std::set<uint256> lowerQualCerts;
-    for (auto entry :  mapSidechains.at(cert.GetScId()).mBackwardCertificates)
+    for (const auto& entry : scIt->second.mBackwardCertificates)
     {
         const uint256& memPoolCertHash = entry.second;
         const CScCertificate& memPoolCert = mapCertificate.at(memPoolCertHash).GetCertificate();
@@ -1167,19 +1631,17 @@ void CTxMemPool::removeConflicts(const CScCertificate &cert, std::list<CTransact
         {
             LogPrint("mempool", "%s():%d - mempool cert[%s] q=%d conflicting with cert[%s] q=%d\n",
                 __func__, __LINE__, memPoolCertHash.ToString(), memPoolCert.quality, cert.GetHash().ToString(), cert.quality);
-            lowerQualCerts.insert(memPoolCert.GetHash());
+            conflicts.insert(memPoolCertHash);
         }
     }
+}
 
-    for(const auto& hash: lowerQualCerts)
-    {
-        // there can be dependancy also between certs, so check that a cert is still in map during the loop
-        if (mapCertificate.count(hash))
-        {
-            const CScCertificate& cert = mapCertificate.at(hash).GetCertificate();
-            remove(cert, removedTxs, removedCerts, true);
-        }
-    }
+void CTxMemPool::removeConflicts(const CScCertificate &cert, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts) {
+    LOCK(cs);
+
+    std::set<uint256> conflicts;
+    collectConflicts(cert, conflicts);
+    removeRecursively(conflicts, removedTxs, removedCerts, MemPoolRemovalReason::CONFLICT);
 }
 
 void CTxMemPool::removeForBlock(const std::vector<CScCertificate>& vcert, unsigned int nBlockHeight,
@@ -1193,12 +1655,173 @@ void CTxMemPool::removeForBlock(const std::vector<CScCertificate>& vcert, unsign
     std::list<CScCertificate> dummyCerts;
     for (const auto& cert : vcert)
     {
-        remove(cert, dummyTxs, dummyCerts, /*fRecursive*/false);
+        remove(cert, dummyTxs, dummyCerts, /*fRecursive*/false, MemPoolRemovalReason::BLOCK);
         removeConflicts(cert, removedTxs, removedCerts);
         ClearPrioritisation(cert.GetHash());
     }
 }
 
+/**
+ * Called when a block is connected, in place of removeForBlock for its txes and certificates followed by
+ * removeStaleTransactions and removeStaleCertificates. The conflicts of the whole block are collected
+ * and removed at once, then the sidechain balances and the stale entries are checked in a single walk.
+ */
+void CTxMemPool::removeForBlock(const std::vector<CTransaction>& vtx, const std::vector<CScCertificate>& vcert,
+                                unsigned int nBlockHeight, const CCoinsViewCache * const pCoinsView,
+                                std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts, bool fCurrentEstimate)
+{
+    LOCK(cs);
+    int64_t nStart = GetTimeMicros();
+
+    std::vector<CTxMemPoolEntry> entries;
+    for(const CTransaction& tx: vtx)
+    {
+        std::map<uint256, CTxMemPoolEntry>::const_iterator it = mapTx.find(tx.GetHash());
+        if (it != mapTx.end())
+            entries.push_back(it->second);
+    }
+    std::vector<CCertificateMemPoolEntry> certEntries;
+    for(const CScCertificate& cert: vcert)
+    {
+        std::map<uint256, CCertificateMemPoolEntry>::const_iterator it = mapCertificate.find(cert.GetHash());
+        if (it != mapCertificate.end())
+            certEntries.push_back(it->second);
+    }
+
+    // dummy lists: they contain exactly the entries that were in the mempool and now are in the block.
+    // The caller is not interested in them because they will be synced with the block
+    std::list<CTransaction> dummyTxs;
+    std::list<CScCertificate> dummyCerts;
+    for(const CTransaction& tx: vtx)
+    {
+        remove(tx, dummyTxs, dummyCerts, /*fRecursive*/false, MemPoolRemovalReason::BLOCK);
+        ClearPrioritisation(tx.GetHash());
+    }
+    for(const CScCertificate& cert: vcert)
+    {
+        remove(cert, dummyTxs, dummyCerts, /*fRecursive*/false, MemPoolRemovalReason::BLOCK);
+        ClearPrioritisation(cert.GetHash());
+    }
+
+    std::set<uint256> toRemove;
+    for(const CTransaction& tx: vtx)
+        collectConflicts(tx, toRemove);
+    for(const CScCertificate& cert: vcert)
+        collectConflicts(cert, toRemove);
+    removeRecursively(toRemove, removedTxs, removedCerts, MemPoolRemovalReason::CONFLICT);
+    size_t nConflicts = removedTxs.size() + removedCerts.size();
+    int64_t nConflictsTime = GetTimeMicros();
+
+    // the CSW totals are checked once the conflicting CSWs are gone
+    toRemove.clear();
+    collectOutOfScBalanceCsw(pCoinsView, toRemove);
+    collectStaleTransactions(pCoinsView, toRemove);
+    collectStaleCertificates(pCoinsView, toRemove);
+    removeRecursively(toRemove, removedTxs, removedCerts, MemPoolRemovalReason::STALE);
+
+    // After the txs in the new block have been removed from the mempool, update policy estimates
+    minerPolicyEstimator->processBlock(nBlockHeight, entries, certEntries, fCurrentEstimate);
+
+    // the rolling minimum fee starts decaying
+    lastRollingFeeUpdate = GetTime();
+    blockSinceLastRollingFeeBump = true;
+
+    LogPrint("bench", "    - Mempool block cleanup: %zu mined, %zu conflicting (%.2fms), %zu stale (%.2fms)\n",
+        dummyTxs.size() + dummyCerts.size(), nConflicts, (nConflictsTime - nStart) * 0.001,
+        removedTxs.size() + removedCerts.size() - nConflicts, (GetTimeMicros() - nConflictsTime) * 0.001);
+}
+
+int CTxMemPool::Expire(int64_t time, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts)
+{
+    LOCK(cs);
+    std::vector<uint256> toRemove;
+    const indexed_mempool_set::index<entry_time>::type& byEntryTime = mapIndex.get<entry_time>();
+    for(indexed_mempool_set::index<entry_time>::type::const_iterator it = byEntryTime.begin();
+        it != byEntryTime.end() && it->nTime < time; ++it)
+    {
+        if (isEvictable(*lookupTxBase(it->hash)))
+            toRemove.push_back(it->hash);
+    }
+
+    size_t nRemoved = removedTxs.size() + removedCerts.size();
+    for(const uint256& hash : toRemove)
+    {
+        // it may have been removed already, as a descendant of a previous one
+        if (mapTx.count(hash))
+        {
+            const CTransaction tx = mapTx.at(hash).GetTx();
+            remove(tx, removedTxs, removedCerts, /*fRecursive*/true, MemPoolRemovalReason::EXPIRY);
+        }
+    }
+    return removedTxs.size() + removedCerts.size() - nRemoved;
+}
+
+void CTxMemPool::TrimToSize(size_t sizelimit, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts)
+{
+    LOCK(cs);
+    const indexed_mempool_set::index<descendant_score>::type& byDescendantScore = mapIndex.get<descendant_score>();
+    indexed_mempool_set::index<descendant_score>::type::const_iterator it = byDescendantScore.begin();
+    while (it != byDescendantScore.end() && DynamicMemoryUsage() > sizelimit)
+    {
+        const CTransactionBase* pTxBase = lookupTxBase(it->hash);
+        if (!isEvictable(*pTxBase))
+        {
+            ++it;
+            continue;
+        }
+
+        // a tx must pay more than the package it replaces, by at least the relay fee
+        CFeeRate removed(it->nModFeesWithDescendants, it->nSizeWithDescendants);
+        trackPackageRemoved(CFeeRate(removed.GetFeePerK() + minReasonableRelayFee.GetFeePerK()));
+
+        LogPrint("mempool", "%s():%d - trimming [%s] and its descendants from mempool, fee rate %s\n",
+            __func__, __LINE__, it->hash.ToString(), removed.ToString());
+        const CTransaction tx = mapTx.at(it->hash).GetTx();
+        remove(tx, removedTxs, removedCerts, /*fRecursive*/true, MemPoolRemovalReason::SIZELIMIT);
+
+        // the removal updates the scores of the ancestors, hence their position
+        it = byDescendantScore.begin();
+    }
+}
+
+void CTxMemPool::trackPackageRemoved(const CFeeRate& rate)
+{
+    AssertLockHeld(cs);
+    if (rate.GetFeePerK() > rollingMinimumFeeRate)
+    {
+        rollingMinimumFeeRate = rate.GetFeePerK();
+        blockSinceLastRollingFeeBump = false;
+    }
+}
+
+CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const
+{
+    LOCK(cs);
+    if (!blockSinceLastRollingFeeBump || rollingMinimumFeeRate == 0)
+        return CFeeRate(rollingMinimumFeeRate);
+
+    int64_t time = GetTime();
+    if (time > lastRollingFeeUpdate + 10)
+    {
+        double halflife = ROLLING_FEE_HALFLIFE;
+        size_t usage = DynamicMemoryUsage();
+        if (usage < sizelimit / 4)
+            halflife /= 4;
+        else if (usage < sizelimit / 2)
+            halflife /= 2;
+
+        rollingMinimumFeeRate = rollingMinimumFeeRate / pow(2.0, (time - lastRollingFeeUpdate) / halflife);
+        lastRollingFeeUpdate = time;
+
+        if (rollingMinimumFeeRate < (double)minReasonableRelayFee.GetFeePerK() / 2)
+        {
+            rollingMinimumFeeRate = 0;
+            return CFeeRate(0);
+        }
+    }
+    return std::max(CFeeRate(rollingMinimumFeeRate), minReasonableRelayFee);
+}
+
 void CTxMemPool::clear()
 {
     LOCK(cs);
@@ -1206,6 +1829,7 @@ void CTxMemPool::clear()
     mapTx.clear();
     mapCertificate.clear();
     mapDeltas.clear();
+    mapIndex.clear();
     mapNextTx.clear();
     mapSidechains.clear();
     mapNullifiers.clear();
@@ -1215,6 +1839,8 @@ void CTxMemPool::clear()
     mapAddressInserted.clear();
     mapSpent.clear();
     mapSpentInserted.clear();
+    nAddressEmptiedGeneration = ++nAddressGeneration;
+    notifyAddressChange();
 
     totalTxSize = 0;
     totalCertificateSize = 0;
@@ -1428,6 +2054,7 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
         //certificate must be duly recorded in mapSidechain
         assert(mapSidechains.count(cert.GetScId()) != 0);
         assert(mapSidechains.at(cert.GetScId()).HasCert(cert.GetHash()) );
+        assert(mapSidechains.at(cert.GetScId()).GetCert(cert.GetHash())->first == cert.quality);
 
         bool fDependsWait = false;
         BOOST_FOREACH(const CTxIn &txin, cert.GetVin()) {
@@ -1526,6 +2153,38 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
 
     assert((totalTxSize+totalCertificateSize) == checkTotal);
     assert(innerUsage == cachedInnerUsage);
+
+    assert(mapIndex.size() == mapTx.size() + mapCertificate.size());
+    for(const CMemPoolIndexEntry& indexEntry : mapIndex)
+    {
+        const CTransactionBase* pTxBase = lookupTxBase(indexEntry.hash);
+        assert(pTxBase != nullptr);
+        assert(indexEntry.fCertificate == pTxBase->IsCertificate());
+
+        const std::vector<uint256> ancestors = mempoolDependenciesFrom(*pTxBase);
+        CAmount nModFeesWithAncestors = indexEntry.nModifiedFee;
+        size_t nSizeWithAncestors = indexEntry.nSize;
+        for(const uint256& ancestor : ancestors)
+        {
+            nModFeesWithAncestors += mapIndex.find(ancestor)->nModifiedFee;
+            nSizeWithAncestors += mapIndex.find(ancestor)->nSize;
+        }
+        assert(indexEntry.nModFeesWithAncestors == nModFeesWithAncestors);
+        assert(indexEntry.nSizeWithAncestors == nSizeWithAncestors);
+        assert(indexEntry.nCountWithAncestors == ancestors.size() + 1);
+
+        const std::vector<uint256> descendants = mempoolDependenciesOf(*pTxBase);
+        CAmount nModFeesWithDescendants = indexEntry.nModifiedFee;
+        size_t nSizeWithDescendants = indexEntry.nSize;
+        for(const uint256& descendant : descendants)
+        {
+            nModFeesWithDescendants += mapIndex.find(descendant)->nModifiedFee;
+            nSizeWithDescendants += mapIndex.find(descendant)->nSize;
+        }
+        assert(indexEntry.nModFeesWithDescendants == nModFeesWithDescendants);
+        assert(indexEntry.nSizeWithDescendants == nSizeWithDescendants);
+        assert(indexEntry.nCountWithDescendants == descendants.size() + 1);
+    }
 }
 
 bool CTxMemPool::checkCswInputsPerScLimit(const CTransaction& incomingTx) const
@@ -1602,10 +2261,14 @@ bool CTxMemPool::checkIncomingTxConflicts(const CTransaction& incomingTx) const
         }
     }
 
-    // Check if this tx does CSW with the nullifier already present in the mempool
+    // Check if this tx does CSW with the nullifier already present in the mempool, the inputs usually all
+    // withdrawing from the same sidechain, whose entry is looked up once
+    auto itCswSc = mapSidechains.end();
     for(const CTxCeasedSidechainWithdrawalInput& csw: incomingTx.GetVcswCcIn())
     {
-        if (HaveCswNullifier(csw.scId, csw.nullifier)) {
+        if (itCswSc == mapSidechains.end() || itCswSc->first != csw.scId)
+            itCswSc = mapSidechains.find(csw.scId);
+        if (itCswSc != mapSidechains.end() && itCswSc->second.cswNullifiers.count(csw.nullifier) != 0) {
             LogPrint("sc", "%s():%d - Dropping txid [%s]: CSW input nullifier is already in mempool\n",
                     __func__, __LINE__, hash.ToString());
             return false;
@@ -1690,6 +2353,12 @@ void CTxMemPool::queryHashes(std::vector<uint256>& vtxid) const
         vtxid.push_back(mapCertEntry.first);
 }
 
+uint64_t CTxMemPool::GetSequence() const
+{
+    LOCK(cs);
+    return nSequence;
+}
+
 int CTxMemPool::getNumOfCswInputs(const uint256& scId) const
 {
     LOCK(cs);
@@ -1717,6 +2386,45 @@ bool CTxMemPool::lookup(const uint256& hash, CScCertificate& result) const
     return true;
 }
 
+std::shared_ptr<const CTransactionBase> CTxMemPool::lookupShared(const uint256& hash) const
+{
+    LOCK(cs);
+    std::map<uint256, CTxMemPoolEntry>::const_iterator i = mapTx.find(hash);
+    if (i != mapTx.end())
+        return i->second.GetSharedTx();
+    std::map<uint256, CCertificateMemPoolEntry>::const_iterator j = mapCertificate.find(hash);
+    if (j != mapCertificate.end())
+        return j->second.GetSharedCertificate();
+    return std::shared_ptr<const CTransactionBase>();
+}
+
+std::shared_ptr<const CMemPoolCoinsSnapshot> CTxMemPool::GetCoinsSnapshot() const
+{
+    LOCK(cs);
+    const unsigned int nEpoch = GetTransactionsUpdated();
+    if (coinsSnapshot && coinsSnapshot->nEpoch == nEpoch)
+        return coinsSnapshot;
+
+    // the previous snapshot is left to its readers, a new one is made
+    std::shared_ptr<CMemPoolCoinsSnapshot> snapshot = std::make_shared<CMemPoolCoinsSnapshot>();
+    snapshot->nEpoch = nEpoch;
+    for (const auto& entry : mapTx)
+        snapshot->mapTx.emplace_hint(snapshot->mapTx.end(), entry.first, entry.second.GetSharedTx());
+    for (const auto& entry : mapCertificate) {
+        const CScCertificate& cert = entry.second.GetCertificate();
+        const bool isTopQuality = mapSidechains.at(cert.GetScId()).GetTopQualityCert()->second == entry.first;
+        snapshot->mapCertificate.emplace_hint(snapshot->mapCertificate.end(), entry.first,
+                                              std::make_pair(entry.second.GetSharedCertificate(), isTopQuality));
+    }
+    for (const auto& entry : mapNextTx)
+        snapshot->setSpent.insert(snapshot->setSpent.end(), entry.first);
+    for (const auto& entry : mapNullifiers)
+        snapshot->setNullifiers.insert(snapshot->setNullifiers.end(), entry.first);
+    snapshot->mapSidechains = mapSidechains;
+    coinsSnapshot = snapshot;
+    return coinsSnapshot;
+}
+
 void CTxMemPool::CertQualityStatusString(const CScCertificate& cert, std::string& statusString) const
 {
     const uint256& scid = cert.GetScId();
@@ -1751,6 +2459,16 @@ double CTxMemPool::estimatePriority(int nBlocks) const
     LOCK(cs);
     return minerPolicyEstimator->estimatePriority(nBlocks);
 }
+CFeeRate CTxMemPool::estimateCertificateFee(int nBlocks) const
+{
+    LOCK(cs);
+    return minerPolicyEstimator->estimateCertificateFee(nBlocks);
+}
+CFeeRate CTxMemPool::estimateScTxFee(int nBlocks) const
+{
+    LOCK(cs);
+    return minerPolicyEstimator->estimateScTxFee(nBlocks);
+}
 
 bool
 CTxMemPool::WriteFeeEstimates(CAutoFile& fileout) const
@@ -1794,6 +2512,10 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const std::string& s
         std::pair<double, CAmount> &deltas = mapDeltas[hash];
         deltas.first += dPriorityDelta;
         deltas.second += nFeeDelta;
+        applyFeeDelta(hash, nFeeDelta);
+        // block templates built before do not reflect the new deltas
+        nTransactionsUpdated++;
+        nPrioritisationsUpdated++;
     }
     LogPrintf("PrioritiseTransaction: %s priority += %f, fee += %d\n", strHash, dPriorityDelta, FormatMoney(nFeeDelta));
 }
@@ -1812,7 +2534,11 @@ void CTxMemPool::ApplyDeltas(const uint256& hash, double &dPriorityDelta, CAmoun
 void CTxMemPool::ClearPrioritisation(const uint256& hash)
 {
     LOCK(cs);
-    mapDeltas.erase(hash);
+    std::map<uint256, std::pair<double, CAmount> >::iterator pos = mapDeltas.find(hash);
+    if (pos == mapDeltas.end())
+        return;
+    applyFeeDelta(hash, -pos->second.second);
+    mapDeltas.erase(pos);
 }
 
 bool CTxMemPool::HasNoInputsOf(const CTransaction &tx) const
@@ -1824,17 +2550,47 @@ bool CTxMemPool::HasNoInputsOf(const CTransaction &tx) const
 
 }
 
+void CTxMemPool::AddRecentlyAdded(const std::shared_ptr<const CTransactionBase>& txBase)
+{
+    AssertLockHeld(cs);
+    mapRecentlyAddedTxBase[txBase->GetHash()] = txBase;
+    nRecentlyAddedSequence += 1;
+    if (!fNotifyScheduled) {
+        nRecentlyAddedFirstMicros = GetTimeMicros();
+        if (scheduleNotify) {
+            fNotifyScheduled = true;
+            scheduleNotify();
+        }
+    }
+}
+
+void CTxMemPool::SetNotifyScheduler(std::function<void()> scheduleNotifyIn)
+{
+    LOCK(cs);
+    scheduleNotify = scheduleNotifyIn;
+    fNotifyScheduled = false;
+    // the entries added before, e.g. by the load of the mempool
+    if (scheduleNotify && !mapRecentlyAddedTxBase.empty()) {
+        fNotifyScheduled = true;
+        scheduleNotify();
+    }
+}
+
 void CTxMemPool::NotifyRecentlyAdded()
 {
     uint64_t recentlyAddedSequence;
-    std::vector<std::shared_ptr<CTransactionBase> > vTxBase;
+    int64_t nFirstAddedMicros;
+    std::vector<std::shared_ptr<const CTransactionBase> > vTxBase;
     {
         LOCK(cs);
         recentlyAddedSequence = nRecentlyAddedSequence;
+        nFirstAddedMicros = nRecentlyAddedFirstMicros;
         for (const auto& kv : mapRecentlyAddedTxBase) {
             vTxBase.push_back(kv.second);
         }
         mapRecentlyAddedTxBase.clear();
+        // the entries added from now on ask for the next batch
+        fNotifyScheduled = false;
     }
 
     // A race condition can occur here between these SyncWithWallets calls, and
@@ -1864,6 +2620,12 @@ void CTxMemPool::NotifyRecentlyAdded()
         }
     }
 
+    if (!vTxBase.empty()) {
+        metricNotifyBatches.Add();
+        metricNotified.Add(vTxBase.size());
+        metricNotifyLag.Set(GetTimeMicros() - nFirstAddedMicros);
+    }
+
     // Update the notified sequence number. We only need this in regtest mode,
     // and should not lock on cs after calling SyncWithWallets otherwise.
     if (Params().NetworkIDString() == "regtest") {
@@ -1878,6 +2640,65 @@ bool CTxMemPool::IsFullyNotified() {
     return nRecentlyAddedSequence == nNotifiedSequence;
 }
 
+/** The sidechain created by scCreationTx, which does not appear in a block yet */
+static void FillSidechainFromCreationTx(const CTransaction& scCreationTx, const uint256& scId, CSidechain& info)
+{
+    for (const auto& scCreation : scCreationTx.GetVscCcOut())
+    {
+        if (scId == scCreation.GetScId())
+        {
+            //info.creationBlockHash doesn't exist here!
+            info.creationBlockHeight = -1; //default null value for creationBlockHeight
+            info.creationTxHash = scCreationTx.GetHash();
+            Sidechain::ScFixedParameters& fixedParams = info.ModifyFixedParams();
+            fixedParams.version = scCreation.version;
+            fixedParams.withdrawalEpochLength = scCreation.withdrawalEpochLength;
+            fixedParams.customData = scCreation.customData;
+            fixedParams.constant = scCreation.constant;
+            fixedParams.wCertVk = scCreation.wCertVk;
+            fixedParams.wCeasedVk = scCreation.wCeasedVk;
+            fixedParams.vFieldElementCertificateFieldConfig = scCreation.vFieldElementCertificateFieldConfig;
+            fixedParams.vBitVectorCertificateFieldConfig = scCreation.vBitVectorCertificateFieldConfig;
+            info.lastTopQualityCertView.forwardTransferScFee = scCreation.forwardTransferScFee;
+            info.lastTopQualityCertView.mainchainBackwardTransferRequestScFee = scCreation.mainchainBackwardTransferRequestScFee;
+            fixedParams.mainchainBackwardTransferRequestDataLength = scCreation.mainchainBackwardTransferRequestDataLength;
+            // This sidechain does not appear in a block yet, use default null values
+            info.lastInclusionHeight               = -1;
+            info.lastTopQualityCertReferencedEpoch = -1;
+            break;
+        }
+    }
+}
+
+/** Update the sidechain info with the unconfirmed txes and certificates of sc, whose top quality certificate is pCertTopQual */
+static void ApplySidechainMemPoolEntry(const CSidechainMemPoolEntry& sc, const CScCertificate* pCertTopQual, CSidechain& info)
+{
+    // Consider mempool Tx CSW amount for sidechain balance
+    if (sc.cswTotalAmount > 0)
+    {
+        info.balance -= sc.cswTotalAmount;
+    }
+
+    // Update sidechain info with data from the unconfirmed certificates
+    // This is useful for non-ceasing sidechains only as they can have
+    // certificates of later epochs.
+    if (info.isNonCeasing() && pCertTopQual != nullptr) {
+        const CScCertificate& certTopQual = *pCertTopQual;
+        info.lastTopQualityCertView.certDataHash = certTopQual.GetDataHash(info.GetFixedParams());
+        info.lastTopQualityCertView.forwardTransferScFee = certTopQual.forwardTransferScFee;
+        info.lastTopQualityCertView.mainchainBackwardTransferRequestScFee = certTopQual.mainchainBackwardTransferRequestScFee;
+
+        const auto map_it = mapCumtreeHeight.find(certTopQual.endEpochCumScTxCommTreeRoot.GetLegacyHash());
+        if (map_it == mapCumtreeHeight.end())
+        {
+            LogPrint("mempool", "%s():%d - could not find referenced block for certTopQual %s. This is a problem.\n", __func__, __LINE__, certTopQual.GetHash().ToString());
+            assert(false);
+        }
+
+        info.lastTopQualityCertReferencedEpoch = certTopQual.epochNumber;
+    }
+}
+
 CCoinsViewMemPool::CCoinsViewMemPool(CCoinsView *baseIn, CTxMemPool &mempoolIn) : CCoinsViewBacked(baseIn), mempool(mempoolIn) { }
 
 bool CCoinsViewMemPool::GetNullifier(const uint256 &nf) const {
@@ -1917,31 +2738,7 @@ bool CCoinsViewMemPool::GetSidechain(const uint256& scId, CSidechain& info) cons
     {
         //build sidechain from txs in mempool
         const uint256& scCreationHash = mempool.mapSidechains.at(scId).scCreationTxHash;
-        const CTransaction & scCreationTx = mempool.mapTx.at(scCreationHash).GetTx();
-        for (const auto& scCreation : scCreationTx.GetVscCcOut())
-        {
-            if (scId == scCreation.GetScId())
-            {
-                //info.creationBlockHash doesn't exist here!
-                info.creationBlockHeight = -1; //default null value for creationBlockHeight
-                info.creationTxHash = scCreationHash;
-                info.fixedParams.version = scCreation.version;
-                info.fixedParams.withdrawalEpochLength = scCreation.withdrawalEpochLength;
-                info.fixedParams.customData = scCreation.customData;
-                info.fixedParams.constant = scCreation.constant;
-                info.fixedParams.wCertVk = scCreation.wCertVk;
-                info.fixedParams.wCeasedVk = scCreation.wCeasedVk;
-                info.fixedParams.vFieldElementCertificateFieldConfig = scCreation.vFieldElementCertificateFieldConfig;
-                info.fixedParams.vBitVectorCertificateFieldConfig = scCreation.vBitVectorCertificateFieldConfig;
-                info.lastTopQualityCertView.forwardTransferScFee = scCreation.forwardTransferScFee;
-                info.lastTopQualityCertView.mainchainBackwardTransferRequestScFee = scCreation.mainchainBackwardTransferRequestScFee;
-                info.fixedParams.mainchainBackwardTransferRequestDataLength = scCreation.mainchainBackwardTransferRequestDataLength;
-                // This sidechain does not appear in a block yet, use default null values
-                info.lastInclusionHeight               = -1;
-                info.lastTopQualityCertReferencedEpoch = -1;
-                break;
-            }
-        }
+        FillSidechainFromCreationTx(mempool.mapTx.at(scCreationHash).GetTx(), scId, info);
     } else if (!base->GetSidechain(scId, info))
         return false;
 
@@ -1949,32 +2746,11 @@ bool CCoinsViewMemPool::GetSidechain(const uint256& scId, CSidechain& info) cons
     const auto sc_it = mempool.mapSidechains.find(scId);
     if (sc_it != mempool.mapSidechains.end())
     {
-        // Consider mempool Tx CSW amount for sidechain balance
         const CSidechainMemPoolEntry& sc = sc_it->second;
-        if (sc.cswTotalAmount > 0)
-        {
-            info.balance -= sc.cswTotalAmount;
-        }
-
-        // Update sidechain info with data from the unconfirmed certificates
-        // This is useful for non-ceasing sidechains only as they can have
-        // certificates of later epochs.
-        if (info.isNonCeasing() && !sc.mBackwardCertificates.empty()) {
-            const uint256& topQualHash = sc.GetTopQualityCert()->second;
-            const CScCertificate& certTopQual = mempool.mapCertificate[topQualHash].GetCertificate();
-            info.lastTopQualityCertView.certDataHash = certTopQual.GetDataHash(info.fixedParams);
-            info.lastTopQualityCertView.forwardTransferScFee = certTopQual.forwardTransferScFee;
-            info.lastTopQualityCertView.mainchainBackwardTransferRequestScFee = certTopQual.mainchainBackwardTransferRequestScFee;
-
-            const auto map_it = mapCumtreeHeight.find(certTopQual.endEpochCumScTxCommTreeRoot.GetLegacyHash());
-            if (map_it == mapCumtreeHeight.end())
-            {
-                LogPrint("mempool", "%s():%d - could not find referenced block for certTopQual %s. This is a problem.\n", __func__, __LINE__, certTopQual.GetHash().ToString());
-                assert(false);
-            }
-
-            info.lastTopQualityCertReferencedEpoch = certTopQual.epochNumber;
-        }
+        const CScCertificate* pCertTopQual = nullptr;
+        if (!sc.mBackwardCertificates.empty())
+            pCertTopQual = &mempool.mapCertificate[sc.GetTopQualityCert()->second].GetCertificate();
+        ApplySidechainMemPoolEntry(sc, pCertTopQual, info);
     }
 
     return true;
@@ -1998,6 +2774,79 @@ bool CCoinsViewMemPool::HaveCswNullifier(const uint256& scId, const CFieldElemen
     return mempool.HaveCswNullifier(scId, nullifier) || base->HaveCswNullifier(scId, nullifier);
 }
 
+CCoinsViewMemPoolSnapshot::CCoinsViewMemPoolSnapshot(CCoinsView *baseIn, const CTxMemPool &mempoolIn) :
+    CCoinsViewBacked(baseIn), snapshot(mempoolIn.GetCoinsSnapshot()) { }
+
+bool CCoinsViewMemPoolSnapshot::GetNullifier(const uint256 &nf) const {
+    return snapshot->setNullifiers.count(nf) || base->GetNullifier(nf);
+}
+
+bool CCoinsViewMemPoolSnapshot::GetCoins(const uint256 &txid, CCoins &coins) const {
+    // the entries in the mempool first, as CCoinsViewMemPool::GetCoins()
+    const auto tx_it = snapshot->mapTx.find(txid);
+    if (tx_it != snapshot->mapTx.end()) {
+        coins = CCoins(*tx_it->second, MEMPOOL_HEIGHT);
+        return true;
+    }
+
+    const auto cert_it = snapshot->mapCertificate.find(txid);
+    if (cert_it != snapshot->mapCertificate.end()) {
+        coins = CCoins(*cert_it->second.first, MEMPOOL_HEIGHT, MEMPOOL_HEIGHT, cert_it->second.second);
+        return true;
+    }
+    return (base->GetCoins(txid, coins) && !coins.IsPruned());
+}
+
+bool CCoinsViewMemPoolSnapshot::HaveCoins(const uint256 &txid) const {
+    return snapshot->mapTx.count(txid) || snapshot->mapCertificate.count(txid) || base->HaveCoins(txid);
+}
+
+bool CCoinsViewMemPoolSnapshot::GetSidechain(const uint256& scId, CSidechain& info) const {
+    const auto sc_it = snapshot->mapSidechains.find(scId);
+    if (sc_it != snapshot->mapSidechains.end() && !sc_it->second.scCreationTxHash.IsNull())
+        FillSidechainFromCreationTx(*snapshot->mapTx.at(sc_it->second.scCreationTxHash), scId, info);
+    else if (!base->GetSidechain(scId, info))
+        return false;
+
+    if (sc_it != snapshot->mapSidechains.end())
+    {
+        const CSidechainMemPoolEntry& sc = sc_it->second;
+        const CScCertificate* pCertTopQual = nullptr;
+        if (!sc.mBackwardCertificates.empty())
+            pCertTopQual = snapshot->mapCertificate.at(sc.GetTopQualityCert()->second).first.get();
+        ApplySidechainMemPoolEntry(sc, pCertTopQual, info);
+    }
+
+    return true;
+}
+
+void CCoinsViewMemPoolSnapshot::GetScIds(std::set<uint256>& scIds) const {
+    base->GetScIds(scIds);
+    for (const auto& entry : snapshot->mapSidechains)
+    {
+        if (!entry.second.scCreationTxHash.IsNull())
+            scIds.insert(entry.first);
+    }
+}
+
+bool CCoinsViewMemPoolSnapshot::HaveSidechain(const uint256& scId) const {
+    const auto sc_it = snapshot->mapSidechains.find(scId);
+    return (sc_it != snapshot->mapSidechains.end() && !sc_it->second.scCreationTxHash.IsNull()) || base->HaveSidechain(scId);
+}
+
+bool CCoinsViewMemPoolSnapshot::HaveCswNullifier(const uint256& scId, const CFieldElement &nullifier) const
+{
+    const auto sc_it = snapshot->mapSidechains.find(scId);
+    return (sc_it != snapshot->mapSidechains.end() && sc_it->second.cswNullifiers.count(nullifier)) ||
+           base->HaveCswNullifier(scId, nullifier);
+}
+
+void CCoinsViewMemPoolSnapshot::PruneSpent(const uint256 &hashTx, CCoins &coins) const
+{
+    for (auto it = snapshot->setSpent.lower_bound(COutPoint(hashTx, 0)); it != snapshot->setSpent.end() && it->hash == hashTx; ++it)
+        coins.Spend(it->n);
+}
+
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     return
@@ -2006,22 +2855,39 @@ size_t CTxMemPool::DynamicMemoryUsage() const {
           memusage::DynamicUsage(mapDeltas) +
           memusage::DynamicUsage(mapCertificate) +
           memusage::DynamicUsage(mapSidechains) +
+          memusage::DynamicUsage(mapRecentlyAddedTxBase) +
+          // the hashed index takes about 3 pointers per entry, and each ordered index 3 more
+          memusage::MallocUsage(sizeof(CMemPoolIndexEntry) + 15 * sizeof(void*)) * mapIndex.size() +
           cachedInnerUsage);
 }
 
+size_t CTxMemPool::SharedMemoryUsage() const {
+    LOCK(cs);
+    size_t nShared = 0;
+    for (const auto& kv : mapRecentlyAddedTxBase) {
+        std::map<uint256, CTxMemPoolEntry>::const_iterator txIt = mapTx.find(kv.first);
+        if (txIt != mapTx.end() && txIt->second.GetSharedTx() == kv.second) {
+            nShared += txIt->second.DynamicMemoryUsage();
+            continue;
+        }
+        std::map<uint256, CCertificateMemPoolEntry>::const_iterator certIt = mapCertificate.find(kv.first);
+        if (certIt != mapCertificate.end() && certIt->second.GetSharedCertificate() == kv.second)
+            nShared += certIt->second.DynamicMemoryUsage();
+    }
+    return nShared;
+}
+
 std::pair<uint256, CAmount> CTxMemPool::FindCertWithQuality(const uint256& scId, int64_t certQuality) const
 {
     LOCK(cs);
 
     auto sc_it = mapSidechains.find(scId);
     if (sc_it != mapSidechains.end()) {
-        for (const auto& mempoolCertEntry : sc_it->second.mBackwardCertificates)
-        {
-            const auto& certEntry = mapCertificate.at(mempoolCertEntry.second);
-            const CScCertificate& mempoolCert = certEntry.GetCertificate();
-            if (mempoolCert.quality == certQuality) {
-                return std::make_pair(mempoolCert.GetHash(), certEntry.GetFee());
-            }
+        // the certs of the sidechain are indexed by quality, at most one per quality
+        auto itCert = sc_it->second.mBackwardCertificates.find(certQuality);
+        if (itCert != sc_it->second.mBackwardCertificates.end()) {
+            const auto& certEntry = mapCertificate.at(itCert->second);
+            return std::make_pair(itCert->second, certEntry.GetFee());
         }
     }
 
@@ -2038,7 +2904,7 @@ bool CTxMemPool::RemoveCertAndSync(const uint256& certToRmHash)
     CScCertificate certToRm = mapCertificate.at(certToRmHash).GetCertificate();
     std::list<CTransaction> conflictingTxs;
     std::list<CScCertificate> conflictingCerts;
-    remove(certToRm, conflictingTxs, conflictingCerts, true);
+    remove(certToRm, conflictingTxs, conflictingCerts, true, MemPoolRemovalReason::REPLACED);
 
     // Tell wallet about transactions and certificates that went from mempool to conflicted:
     for(const auto &t: conflictingTxs) {
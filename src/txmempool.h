@@ -6,7 +6,10 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <atomic>
+#include <functional>
 #include <list>
+#include <unordered_map>
 
 #if defined(HAVE_CONFIG_H)
 #include "config/bitcoin-config.h"
@@ -21,6 +24,12 @@
 #include "primitives/certificate.h"
 #include "sync.h"
 
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/identity.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
 class CAutoFile;
 
 inline double AllowFreeThreshold()
@@ -38,6 +47,18 @@ inline bool AllowFree(double dPriority)
     return dPriority > AllowFreeThreshold();
 }
 
+/** Why an entry left the mempool, as notified to the validation interface */
+enum class MemPoolRemovalReason : uint8_t {
+    UNKNOWN = 0, //! removed by the caller
+    EXPIRY,      //! expired from the mempool
+    SIZELIMIT,   //! trimmed to keep the mempool within -maxmempool
+    REORG,       //! an entry of a block disconnected, not valid in the mempool
+    BLOCK,       //! included in a block connected
+    CONFLICT,    //! conflicting with an entry of a block connected
+    REPLACED,    //! replaced by a certificate of the same quality paying more
+    STALE,       //! no longer valid on top of the tip: sidechain state, balance or anchors
+};
+
 /** Fake height value used in CCoins to signify they are only in the memory pool (since 0.8) */
 static const unsigned int MEMPOOL_HEIGHT = 0x7FFFFFFF;
 
@@ -67,15 +88,17 @@ public:
 class CTxMemPoolEntry : public CMemPoolEntry
 {
 private:
-    CTransaction tx;
+    std::shared_ptr<const CTransaction> tx; //! Shared with the copies of the entry and the recently added map
     size_t nTxSize; //! ... and avoid recomputing tx size
     bool hadNoDependencies; //! Not dependent on any other txs when it entered the mempool
 
 public:
     CTxMemPoolEntry(const CTransaction& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight, bool poolHasNoInputsOf = false);
+    CTxMemPoolEntry(const std::shared_ptr<const CTransaction>& _tx, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight, bool poolHasNoInputsOf = false);
     CTxMemPoolEntry();
 
-    const CTransaction& GetTx() const { return this->tx; }
+    const CTransaction& GetTx() const { return *this->tx; }
+    const std::shared_ptr<const CTransaction>& GetSharedTx() const { return this->tx; }
     double GetPriority(unsigned int currentHeight) const override;
     size_t GetTxSize() const { return nTxSize; }
     bool WasClearAtEntry() const { return hadNoDependencies; }
@@ -84,19 +107,181 @@ public:
 class CCertificateMemPoolEntry : public CMemPoolEntry
 {
 private:
-    CScCertificate cert;
+    std::shared_ptr<const CScCertificate> cert; //! Shared with the copies of the entry and the recently added map
     size_t nCertificateSize; //! ... and avoid recomputing tx size
 
 public:
     CCertificateMemPoolEntry(
         const CScCertificate& _cert, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight);
+    CCertificateMemPoolEntry(
+        const std::shared_ptr<const CScCertificate>& _cert, const CAmount& _nFee, int64_t _nTime, double _dPriority, unsigned int _nHeight);
     CCertificateMemPoolEntry();
 
-    const CScCertificate& GetCertificate() const { return this->cert; }
+    const CScCertificate& GetCertificate() const { return *this->cert; }
+    const std::shared_ptr<const CScCertificate>& GetSharedCertificate() const { return this->cert; }
     double GetPriority(unsigned int currentHeight) const override;
     size_t GetCertificateSize() const { return nCertificateSize; }
 };
 
+/**
+ * The ordering data of a mempool tx or certificate, kept in CTxMemPool::mapIndex beside the entry itself.
+ * The fee is the modified one, including the PrioritiseTransaction delta. The ancestor totals also count
+ * the txes and certificates in the mempool it depends on, and the descendant totals the ones depending on it.
+ * They are updated incrementally as the entries related to it enter and leave the mempool.
+ */
+struct CMemPoolIndexEntry
+{
+    uint256 hash;
+    bool fCertificate;
+    int64_t nTime;
+    CAmount nModifiedFee;
+    size_t nSize;
+    CAmount nModFeesWithAncestors;
+    size_t nSizeWithAncestors;
+    uint64_t nCountWithAncestors;
+    CAmount nModFeesWithDescendants;
+    size_t nSizeWithDescendants;
+    uint64_t nCountWithDescendants;
+
+    CMemPoolIndexEntry(const uint256& _hash, bool _fCertificate, int64_t _nTime, const CAmount& _nModifiedFee, size_t _nSize):
+        hash(_hash), fCertificate(_fCertificate), nTime(_nTime), nModifiedFee(_nModifiedFee), nSize(_nSize),
+        nModFeesWithAncestors(_nModifiedFee), nSizeWithAncestors(_nSize), nCountWithAncestors(1),
+        nModFeesWithDescendants(_nModifiedFee), nSizeWithDescendants(_nSize), nCountWithDescendants(1) {}
+};
+
+/** Sort by modified fee rate, highest first, then by hash */
+class CompareMemPoolEntryByFeeRate
+{
+public:
+    bool operator()(const CMemPoolIndexEntry& a, const CMemPoolIndexEntry& b) const
+    {
+        double f1 = (double)a.nModifiedFee * b.nSize;
+        double f2 = (double)b.nModifiedFee * a.nSize;
+        if (f1 == f2)
+            return a.hash < b.hash;
+        return f1 > f2;
+    }
+};
+
+/** Sort by the fee rate of the entry together with its ancestors, highest first, then by hash */
+class CompareMemPoolEntryByAncestorScore
+{
+public:
+    bool operator()(const CMemPoolIndexEntry& a, const CMemPoolIndexEntry& b) const
+    {
+        double f1 = (double)a.nModFeesWithAncestors * b.nSizeWithAncestors;
+        double f2 = (double)b.nModFeesWithAncestors * a.nSizeWithAncestors;
+        if (f1 == f2)
+            return a.hash < b.hash;
+        return f1 > f2;
+    }
+};
+
+/**
+ * Sort by the lowest of the fee rate of the entry and the fee rate of the entry together with its descendants,
+ * lowest first, then by hash: the first entry is the package worth the least to keep in the mempool
+ */
+class CompareMemPoolEntryByDescendantScore
+{
+public:
+    bool operator()(const CMemPoolIndexEntry& a, const CMemPoolIndexEntry& b) const
+    {
+        double f1 = GetScore(a) * b.nSize * b.nSizeWithDescendants;
+        double f2 = GetScore(b) * a.nSize * a.nSizeWithDescendants;
+        if (f1 == f2)
+            return a.hash < b.hash;
+        return f1 < f2;
+    }
+
+    // the fee rate used, scaled by the size of the entry and the size with descendants
+    static double GetScore(const CMemPoolIndexEntry& a)
+    {
+        return std::max((double)a.nModifiedFee * a.nSizeWithDescendants, (double)a.nModFeesWithDescendants * a.nSize);
+    }
+};
+
+/** Sort by entry time, oldest first, then by hash */
+class CompareMemPoolEntryByEntryTime
+{
+public:
+    bool operator()(const CMemPoolIndexEntry& a, const CMemPoolIndexEntry& b) const
+    {
+        if (a.nTime == b.nTime)
+            return a.hash < b.hash;
+        return a.nTime < b.nTime;
+    }
+};
+
+// Tags of the mapIndex orderings
+struct modified_feerate {};
+struct entry_time {};
+struct ancestor_score {};
+struct descendant_score {};
+
+typedef boost::multi_index_container<
+    CMemPoolIndexEntry,
+    boost::multi_index::indexed_by<
+        // sorted by hash
+        boost::multi_index::hashed_unique<
+            boost::multi_index::member<CMemPoolIndexEntry, uint256, &CMemPoolIndexEntry::hash>,
+            CCoinsKeyHasher>,
+        // sorted by modified fee rate
+        boost::multi_index::ordered_unique<
+            boost::multi_index::tag<modified_feerate>,
+            boost::multi_index::identity<CMemPoolIndexEntry>,
+            CompareMemPoolEntryByFeeRate>,
+        // sorted by entry time
+        boost::multi_index::ordered_unique<
+            boost::multi_index::tag<entry_time>,
+            boost::multi_index::identity<CMemPoolIndexEntry>,
+            CompareMemPoolEntryByEntryTime>,
+        // sorted by fee rate with ancestors
+        boost::multi_index::ordered_unique<
+            boost::multi_index::tag<ancestor_score>,
+            boost::multi_index::identity<CMemPoolIndexEntry>,
+            CompareMemPoolEntryByAncestorScore>,
+        // sorted by fee rate with descendants
+        boost::multi_index::ordered_unique<
+            boost::multi_index::tag<descendant_score>,
+            boost::multi_index::identity<CMemPoolIndexEntry>,
+            CompareMemPoolEntryByDescendantScore>
+    >
+> indexed_mempool_set;
+
+class CMempoolAddressKeyHasher
+{
+private:
+    uint256 salt;
+
+public:
+    CMempoolAddressKeyHasher();
+
+    size_t operator()(const CMempoolAddressKey& key) const;
+};
+
+class CSpentIndexKeyHasher
+{
+private:
+    uint256 salt;
+
+public:
+    CSpentIndexKeyHasher();
+
+    size_t operator()(const CSpentIndexKey& key) const {
+        return key.txid.GetHash(salt) + key.outputIndex;
+    }
+};
+
+/**
+ * The mempool deltas of an address, in insertion order, with the generation of the address index at
+ * their last change.
+ */
+struct CMempoolAddressDeltas
+{
+    std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > deltas;
+    uint64_t nGeneration = 0;
+};
+
 class CBlockPolicyEstimator;
 
 /** An inpoint - a combination of a transaction and an index n into its vin */
@@ -113,14 +298,32 @@ public:
     size_t DynamicMemoryUsage() const { return 0; }
 };
 
+/**
+ * The top quality certificate of a sidechain in the mempool, as reported to the sidechain nodes polling it at
+ * every block (GET_TOP_QUALITY_CERTIFICATES over the websocket, getscinfo). It is built when the top quality
+ * certificate changes; its data hash, which needs the fixed parameters of the sidechain, on the first request.
+ */
+struct CMempoolTopQualityCert
+{
+    std::shared_ptr<const CScCertificate> cert;
+    uint256 hash;
+    int32_t epochNumber;
+    int64_t quality;
+    CAmount fee;
+    CAmount bwtAmount;
+    mutable std::shared_ptr<const CFieldElement> dataHash; //! guarded by the cs of the mempool
+};
+
 struct CSidechainMemPoolEntry
 {
     uint256 scCreationTxHash;
     std::set<uint256> fwdTxHashes; 
     std::map<int64_t, uint256> mBackwardCertificates; // quality -> certHash
+    std::map<uint256, int64_t> mCertQualities; // certHash -> quality, the reverse of mBackwardCertificates
     std::set<uint256> mcBtrsTxHashes;
     std::map<CFieldElement, uint256> cswNullifiers; // csw nullifier -> containing Tx hash
     CAmount cswTotalAmount;
+    std::shared_ptr<const CMempoolTopQualityCert> topQualityCert; // the summary of mBackwardCertificates.crbegin()
 
     // Note: in fwdTxHashes and mcBtrsTxHashes, a tx is registered only once,
     // even if sends multiple fwts/btrs founds to a sidechain.
@@ -137,10 +340,27 @@ struct CSidechainMemPoolEntry
     const std::map<int64_t, uint256>::const_reverse_iterator GetTopQualityCert() const;
     const std::map<int64_t, uint256>::const_iterator GetCert(const uint256& hash) const;
 
+    //! Records the cert in both mBackwardCertificates and mCertQualities
+    void AddCert(int64_t quality, const uint256& hash);
     void EraseCert(const uint256& hash);
     bool HasCert(const uint256& hash) const;
 };
 
+/**
+ * An immutable copy of what the coins views read from the mempool, taken at an epoch of its contents (the
+ * GetTransactionsUpdated() counter). The transactions and the certificates are shared with the mempool entries, and
+ * a copy is only made on the first request after a change, whatever the readers: they use it without the mempool lock.
+ */
+struct CMemPoolCoinsSnapshot
+{
+    unsigned int nEpoch = 0;
+    std::map<uint256, std::shared_ptr<const CTransaction> > mapTx;
+    std::map<uint256, std::pair<std::shared_ptr<const CScCertificate>, bool> > mapCertificate; // with whether it is top quality
+    std::set<COutPoint> setSpent;
+    std::set<uint256> setNullifiers;
+    std::map<uint256, CSidechainMemPoolEntry> mapSidechains;
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain
  * transactions that may be included in the next block.
@@ -156,8 +376,11 @@ class CTxMemPool
 private:
     bool fSanityCheck; //! Normally false, true if -checkmempool or -regtest
     unsigned int nTransactionsUpdated;
+    unsigned int nPrioritisationsUpdated;
     unsigned int nCertificatesUpdated;
+    CAmount nFeesAdded; //! running total of the fees of every entry ever added, used to measure block template fee gains
     CBlockPolicyEstimator* minerPolicyEstimator;
+    mutable std::shared_ptr<const CMemPoolCoinsSnapshot> coinsSnapshot; //! the last one taken, until the mempool changes
 
     uint64_t totalTxSize = 0; //! sum of all mempool tx' byte sizes
     uint64_t totalCertificateSize = 0; //! sum of all mempool tx' byte sizes
@@ -166,22 +389,68 @@ private:
     bool checkTxImmatureExpenditures(const CTransaction& tx, const CCoinsViewCache * const pcoins);
     bool checkCertImmatureExpenditures(const CScCertificate& cert, const CCoinsViewCache * const pcoins);
 
-    std::map<uint256, std::shared_ptr<CTransactionBase> > mapRecentlyAddedTxBase;
+    std::map<uint256, std::shared_ptr<const CTransactionBase> > mapRecentlyAddedTxBase;
     uint64_t nRecentlyAddedSequence = 0;
     uint64_t nNotifiedSequence = 0;
-
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
+    //! asks for a NotifyRecentlyAdded, called with the first entry added after one took the entries
+    std::function<void()> scheduleNotify;
+    bool fNotifyScheduled = false;
+    //! when the oldest entry not taken by NotifyRecentlyAdded yet was added, for the notification lag
+    int64_t nRecentlyAddedFirstMicros = 0;
+    void AddRecentlyAdded(const std::shared_ptr<const CTransactionBase>& txBase);
+    //! bumped for each entry added or removed, and notified with it (see GetSequence)
+    uint64_t nSequence = 0;
+
+    typedef std::unordered_map<CMempoolAddressKey, CMempoolAddressDeltas, CMempoolAddressKeyHasher> addressDeltaMap;
     addressDeltaMap mapAddress;
 
     typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
     addressDeltaMapInserted mapAddressInserted;
 
-    typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
+    //! bumped on every change of the address index, the generations of the addresses are taken from it
+    std::atomic<uint64_t> nAddressGeneration{0};
+    //! the generation at which an address was last left without deltas, and its bucket erased
+    uint64_t nAddressEmptiedGeneration = 0;
+    CWaitableCriticalSection csAddressChange;
+    CConditionVariable cvAddressChange;
+
+    void setAddressOutStatus(const CMempoolAddressDeltaKey& key, CMempoolAddressDelta::OutputStatus outStatus);
+    void notifyAddressChange();
+
+    typedef std::unordered_map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyHasher> mapSpentIndex;
     mapSpentIndex mapSpent;
 
     typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
     mapSpentIndexInserted mapSpentInserted;
 
+    const CTransactionBase* lookupTxBase(const uint256& hash) const;
+    void addToIndex(const CTransactionBase& txBase, int64_t nTime, const CAmount& nFee, size_t nSize);
+    void updateTopQualityCert(const uint256& scId);
+    void modifyAncestorState(const uint256& hash, const CAmount& nFeeDiff, int64_t nSizeDiff, int64_t nCountDiff);
+    void modifyDescendantState(const uint256& hash, const CAmount& nFeeDiff, int64_t nSizeDiff, int64_t nCountDiff);
+    void updateAncestorState(const CTransactionBase& txBase);
+    void updateDescendantState(const CTransactionBase& txBase);
+    void updatePackageStates(const std::vector<uint256>& ancestors, const std::vector<uint256>& descendants);
+    void applyFeeDelta(const uint256& hash, const CAmount& nFeeDelta);
+    bool isEvictable(const CTransactionBase& txBase) const;
+
+    void collectConflicts(const CTransaction& tx, std::set<uint256>& conflicts) const;
+    void collectConflicts(const CScCertificate& cert, std::set<uint256>& conflicts) const;
+    void collectOutOfScBalanceCsw(const CCoinsViewCache * const pCoinsView, std::set<uint256>& txesToRemove) const;
+    void collectStaleTransactions(const CCoinsViewCache * const pCoinsView, std::set<uint256>& txesToRemove);
+    void collectStaleCertificates(const CCoinsViewCache * const pCoinsView, std::set<uint256>& certsToRemove);
+    void removeRecursively(const std::set<uint256>& hashes, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts,
+                           MemPoolRemovalReason reason);
+
+    CFeeRate minReasonableRelayFee;
+
+    //! the fee rate of the packages evicted by TrimToSize, decaying back to zero after each block
+    mutable double rollingMinimumFeeRate;
+    mutable int64_t lastRollingFeeUpdate;
+    mutable bool blockSinceLastRollingFeeBump;
+
+    void trackPackageRemoved(const CFeeRate& rate);
+
 public:
     mutable CCriticalSection cs;
     std::map<uint256, CTxMemPoolEntry> mapTx;
@@ -191,6 +460,13 @@ public:
     std::map<uint256, const CTransaction*> mapNullifiers;
     std::map<uint256, std::pair<double, CAmount> > mapDeltas;
 
+    /**
+     * The txes in mapTx and the certificates in mapCertificate, by hash, modified fee rate, entry time,
+     * ancestor score and descendant score, so that the cheapest, the oldest or the best paying packages
+     * are found in logarithmic time.
+     */
+    indexed_mempool_set mapIndex;
+
     CTxMemPool(const CFeeRate& _minRelayFee);
     ~CTxMemPool();
 
@@ -225,8 +501,23 @@ public:
     bool removeAddressIndex(const uint256& txBaseHash);
     void updateTopQualCertAddressIndex(const uint256& scid);
 
+    /**
+     * Returns the generation of the mempool deltas of the given addresses: it grows whenever any of them
+     * changes, possibly also when other addresses do.
+     */
+    uint64_t getAddressGeneration(const std::vector<std::pair<uint160, AddressType> >& addresses) const;
+
+    /**
+     * Waits up to nTimeoutMillis for the generation of the given addresses to differ from nGeneration,
+     * and returns the current one.
+     */
+    uint64_t waitForAddressChange(const std::vector<std::pair<uint160, AddressType> >& addresses,
+                                  uint64_t nGeneration, int64_t nTimeoutMillis);
+
     void addSpentIndex(const CTransactionBase& txBase, const CCoinsViewCache &view);
     bool getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+    //! Add the spends in the mempool of the first nOutputs outputs of txid to values, by output index
+    void getSpentIndexOutputs(const uint256& txid, unsigned int nOutputs, std::map<unsigned int, CSpentIndexValue> &values);
     bool removeSpentIndex(const uint256& txBaseHash);
 
     std::vector<uint256> mempoolDirectDependenciesFrom(const CTransactionBase& root) const;
@@ -235,10 +526,17 @@ public:
     std::vector<uint256> mempoolDependenciesFrom(const CTransactionBase& origTx) const;
     std::vector<uint256> mempoolDependenciesOf(const CTransactionBase& origTx) const;
 
-    void remove(const CTransactionBase& origTx, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts, bool fRecursive = false);
+    void remove(const CTransactionBase& origTx, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts, bool fRecursive = false,
+                MemPoolRemovalReason reason = MemPoolRemovalReason::UNKNOWN);
 
     void removeWithAnchor(const uint256 &invalidRoot);
 
+    // BLOCK CLEANUP METHODS
+    void removeForBlock(const std::vector<CTransaction>& vtx, const std::vector<CScCertificate>& vcert,
+                        unsigned int nBlockHeight, const CCoinsViewCache * const pCoinsView,
+                        std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts, bool fCurrentEstimate = true);
+    // END OF BLOCK CLEANUP METHODS
+
     // UNCONFIRMED TRANSACTIONS CLEANUP METHODS
     void removeForBlock(const std::vector<CTransaction>& vtx, unsigned int nBlockHeight,
                         std::list<CTransaction>& conflictingTxs, std::list<CScCertificate>& removedCerts, bool fCurrentEstimate = true);
@@ -261,10 +559,50 @@ public:
                                  std::list<CScCertificate>& outdatedCerts);
     // END OF UNCONFIRMED CERTIFICATES CLEANUP METHODS
 
+    static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12; // 12 hours
+
+    /**
+     * Remove the txes which entered the mempool before time, together with their descendants.
+     * Certificates, and the txes they depend on, are kept.
+     */
+    int Expire(int64_t time, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts);
+
+    /**
+     * Remove the packages with the lowest descendant score until the mempool dynamic memory usage is not above
+     * sizelimit, raising the rolling minimum fee to the fee rate of the removed packages.
+     * Certificates, and the txes they depend on, are never removed, so that the quality ordering of the
+     * certificates of a sidechain is not altered by the memory bound.
+     */
+    void TrimToSize(size_t sizelimit, std::list<CTransaction>& removedTxs, std::list<CScCertificate>& removedCerts);
+
+    /**
+     * The minimum fee rate to get into the mempool, which is raised when the mempool is trimmed and halves
+     * every ROLLING_FEE_HALFLIFE after the next block (faster when the mempool is far below sizelimit).
+     */
+    CFeeRate GetMinFee(size_t sizelimit) const;
+
+    /** The fee rate of an entry together with its descendants, or zero if it is not in the mempool */
+    CFeeRate GetDescendantFeeRate(const uint256& hash) const;
+
+    /**
+     * Check that adding txBase, of nSize bytes, keeps its package and the packages of its ancestors within the
+     * given limits (0 = no limit). Otherwise returns false and sets errString.
+     */
+    bool checkPackageLimits(const CTransactionBase& txBase, size_t nSize,
+        uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize,
+        std::string& errString) const;
+
     void clear();
     void queryHashes(std::vector<uint256>& vtxid) const;
+    /**
+     * The sequence of the last entry added or removed: the notifications of the changes after what mempool.cs
+     * guards are those with a greater sequence.
+     */
+    uint64_t GetSequence() const;
     void pruneSpent(const uint256& hash, CCoins &coins);
     unsigned int GetTransactionsUpdated() const;
+    unsigned int GetPrioritisationsUpdated() const;
+    CAmount GetFeesAdded() const;
     void AddTransactionsUpdated(unsigned int n);
     /**
      * Check that none of this transactions inputs are in the mempool, and thus
@@ -277,7 +615,12 @@ public:
     void ApplyDeltas(const uint256& hash, double &dPriorityDelta, CAmount &nFeeDelta);
     void ClearPrioritisation(const uint256& hash);
 
+    /**
+     * Notify the wallets of the transactions and certificates added since the last call, in one batch.
+     * Called on demand, as soon as entries are added, once SetNotifyScheduler has set how to ask for it.
+     */
     void NotifyRecentlyAdded();
+    void SetNotifyScheduler(std::function<void()> scheduleNotifyIn);
     bool IsFullyNotified();
 
     unsigned long sizeTx()
@@ -339,6 +682,13 @@ public:
         return (mapSidechains.count(scId) != 0) && (!mapSidechains.at(scId).mBackwardCertificates.empty());
     }
 
+    /**
+     * The top quality certificate of scId in the mempool, if any, with its data hash computed from scFixedParams,
+     * when given, once. The summary is shared: it stays valid when the mempool changes.
+     */
+    std::shared_ptr<const CMempoolTopQualityCert> getTopQualityCert(const uint256& scId,
+            const Sidechain::ScFixedParameters* scFixedParams = nullptr) const;
+
     bool hasSidechainCreationTx(const uint256& scId) const
     {
         LOCK(cs);
@@ -367,6 +717,11 @@ public:
 
     bool lookup(const uint256& hash, CTransaction& result) const;
     bool lookup(const uint256& hash, CScCertificate& result) const;
+    //! The transaction or certificate of the entry, shared rather than copied; null if none
+    std::shared_ptr<const CTransactionBase> lookupShared(const uint256& hash) const;
+
+    /** The coins snapshot of the current contents, shared by the readers until the next change */
+    std::shared_ptr<const CMemPoolCoinsSnapshot> GetCoinsSnapshot() const;
 
     void CertQualityStatusString(const CScCertificate& cert, std::string& statusString) const;
 
@@ -375,12 +730,23 @@ public:
 
     /** Estimate priority needed to get into the next nBlocks */
     double estimatePriority(int nBlocks) const;
+
+    /** Estimate fee rate needed for a certificate to get into the next nBlocks */
+    CFeeRate estimateCertificateFee(int nBlocks) const;
+
+    /** Estimate fee rate needed for a tx with forward transfers or backward transfer requests to get into the next nBlocks */
+    CFeeRate estimateScTxFee(int nBlocks) const;
     
     /** Write/Read estimates to disk */
     bool WriteFeeEstimates(CAutoFile& fileout) const;
     bool ReadFeeEstimates(CAutoFile& filein);
 
     size_t DynamicMemoryUsage() const;
+    /**
+     * The memory the txes and certificates waiting for the wallet notification would take if they were not
+     * shared with their mempool entries.
+     */
+    size_t SharedMemoryUsage() const;
 };
 
 /** 
@@ -405,4 +771,29 @@ public:
                           const CFieldElement &nullifier) const override;
 };
 
+/**
+ * The same view on a snapshot of the mempool, which needs no mempool lock: the RPC reads do not wait for the
+ * transactions being accepted, and are not affected by them.
+ */
+class CCoinsViewMemPoolSnapshot : public CCoinsViewBacked
+{
+protected:
+    std::shared_ptr<const CMemPoolCoinsSnapshot> snapshot;
+
+public:
+    CCoinsViewMemPoolSnapshot(CCoinsView *baseIn, const CTxMemPool &mempoolIn);
+
+    bool GetNullifier(const uint256 &txid)                              const override;
+    bool GetCoins(const uint256 &txid, CCoins &coins)                   const override;
+    bool HaveCoins(const uint256 &txid)                                 const override;
+    bool GetSidechain(const uint256& scId, CSidechain& info)            const override;
+    bool HaveSidechain(const uint256& scId)                             const override;
+    void GetScIds(std::set<uint256>& scIdsList)                         const override;
+    bool HaveCswNullifier(const uint256& scId,
+                          const CFieldElement &nullifier) const override;
+
+    /** Mark as spent the outputs of hashTx spent in the snapshot, as CTxMemPool::pruneSpent() */
+    void PruneSpent(const uint256 &hashTx, CCoins &coins) const;
+};
+
 #endif // BITCOIN_TXMEMPOOL_H
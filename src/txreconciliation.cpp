@@ -0,0 +1,114 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txreconciliation.h"
+
+#include "crypto/common.h"
+#include "hash.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+//! The tag of the hash of the salts the keys of the short ids come from, as BIP 330
+static const std::string RECON_SALT_TAG = "Tx Relay Salting";
+
+void CTxReconciliationState::Enable(uint64_t nRemoteSalt)
+{
+    // the same keys on both sides, whichever sent its salt first
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << RECON_SALT_TAG << std::min(nLocalSalt, nRemoteSalt) << std::max(nLocalSalt, nRemoteSalt);
+    const uint256 hash = ss.GetHash();
+    k0 = ReadLE64(hash.begin());
+    k1 = ReadLE64(hash.begin() + 8);
+    fEnabled = true;
+}
+
+uint32_t CTxReconciliationState::GetShortID(const uint256& hash) const
+{
+    return static_cast<uint32_t>(SipHashUint256(k0, k1, hash));
+}
+
+bool CTxReconciliationState::Add(const uint256& hash)
+{
+    if (setPending.size() >= MAX_RECON_SET_SIZE)
+        return setPending.count(hash) != 0;
+    setPending.insert(hash);
+    return true;
+}
+
+std::vector<uint32_t> CTxReconciliationState::StartRequest(int64_t nNow, std::vector<uint256>& vAnnounce)
+{
+    std::vector<uint32_t> vRequest;
+    vRequest.reserve(setPending.size());
+    for (const uint256& hash : setPending) {
+        const uint32_t nShortID = GetShortID(hash);
+        if (mapInFlight.insert(std::make_pair(nShortID, hash)).second)
+            vRequest.push_back(nShortID);
+        else
+            vAnnounce.push_back(hash);
+    }
+    setPending.clear();
+    nRequestTime = nNow;
+    return vRequest;
+}
+
+void CTxReconciliationState::Respond(const std::vector<uint32_t>& vRequest, std::vector<uint32_t>& vWanted,
+                                     std::vector<uint256>& vAnnounce, std::vector<uint256>& vShared)
+{
+    std::unordered_map<uint32_t, uint256> mapLocal;
+    mapLocal.reserve(setPending.size());
+    for (const uint256& hash : setPending) {
+        if (!mapLocal.insert(std::make_pair(GetShortID(hash), hash)).second)
+            vAnnounce.push_back(hash);
+    }
+    setPending.clear();
+
+    for (const uint32_t nShortID : vRequest) {
+        std::unordered_map<uint32_t, uint256>::iterator it = mapLocal.find(nShortID);
+        if (it == mapLocal.end()) {
+            vWanted.push_back(nShortID);
+        } else {
+            vShared.push_back(it->second);
+            mapLocal.erase(it);
+        }
+    }
+    for (const std::pair<const uint32_t, uint256>& entry : mapLocal)
+        vAnnounce.push_back(entry.second);
+
+    nRounds++;
+    nShared += vShared.size();
+}
+
+bool CTxReconciliationState::Complete(const std::vector<uint32_t>& vWanted, std::vector<uint256>& vAnnounce,
+                                      std::vector<uint256>& vShared)
+{
+    if (nRequestTime == 0)
+        return false;
+
+    for (const uint32_t nShortID : vWanted) {
+        std::map<uint32_t, uint256>::iterator it = mapInFlight.find(nShortID);
+        if (it != mapInFlight.end()) {
+            vAnnounce.push_back(it->second);
+            mapInFlight.erase(it);
+        }
+    }
+    // the peer has all the others
+    for (const std::pair<const uint32_t, uint256>& entry : mapInFlight)
+        vShared.push_back(entry.second);
+    mapInFlight.clear();
+    nRequestTime = 0;
+
+    nRounds++;
+    nShared += vShared.size();
+    return true;
+}
+
+void CTxReconciliationState::Abort(std::vector<uint256>& vAnnounce)
+{
+    for (const std::pair<const uint32_t, uint256>& entry : mapInFlight)
+        vAnnounce.push_back(entry.second);
+    mapInFlight.clear();
+    nRequestTime = 0;
+}
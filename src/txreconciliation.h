@@ -0,0 +1,92 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TXRECONCILIATION_H
+#define BITCOIN_TXRECONCILIATION_H
+
+#include "uint256.h"
+
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+/** The version of the transaction reconciliation protocol, negotiated with "sendrecon" */
+static const uint32_t TXRECONCILIATION_VERSION = 1;
+/** Default for -txreconciliation */
+static const bool DEFAULT_TXRECONCILIATION = false;
+/** Default for -reconfloodpeers, the outbound reconciling peers the transactions are still flooded to */
+static const int DEFAULT_RECON_FLOOD_PEERS = 2;
+/** Average delay between two reconciliations with an outbound peer, in seconds */
+static const int RECON_REQUEST_INTERVAL = 8;
+/** Delay after which an unanswered reconciliation falls back to announcing its transactions, in seconds */
+static const int RECON_RESPONSE_TIMEOUT = 60;
+/** The most transactions waiting for a reconciliation with a peer, the next ones are announced */
+static const size_t MAX_RECON_SET_SIZE = 10000;
+
+/**
+ * The reconciliation of the transactions (and certificates) announced to a peer, instead of an inv of each of them
+ * in both directions: a simplified Erlay (BIP 330), without the sketches.
+ *
+ * Both peers send "sendrecon" (version, salt) after "verack". Once both are received, the transactions to announce
+ * to the peer are added to its reconciliation set rather than announced, but for the few outbound peers they are
+ * still flooded to, for the latency. Every RECON_REQUEST_INTERVAL on average the peer which made the connection
+ * sends "reqrecon" with the 4 bytes short ids of its set; the other peer answers with "reconcildiff", the short ids
+ * of the transactions it is missing, and announces with an inv those of its own set the request had not. The
+ * initiator then announces the ones asked. The transactions both sets have are not announced at all.
+ *
+ * The short ids are SipHash of the transaction hashes, keyed by the salts of both peers. The transactions of a set
+ * whose short id collides, or over MAX_RECON_SET_SIZE, are announced.
+ */
+class CTxReconciliationState
+{
+public:
+    //! The salt sent to the peer, 0 if "sendrecon" was not sent
+    uint64_t nLocalSalt = 0;
+    //! Both peers sent "sendrecon"
+    bool fEnabled = false;
+    //! The transactions are also flooded to the peer
+    bool fFlood = false;
+
+    //! The transactions to reconcile with the peer
+    std::set<uint256> setPending;
+    //! The initiator's set of the reconciliation in flight, by short id
+    std::map<uint32_t, uint256> mapInFlight;
+    int64_t nRequestTime = 0;
+    int64_t nNextRequest = 0;
+
+    //! Reconciliations completed, and the announcements they saved the peers, as the transactions both sets had
+    uint64_t nRounds = 0;
+    uint64_t nShared = 0;
+
+    //! Start reconciling, with the keys of the short ids from the salts
+    void Enable(uint64_t nRemoteSalt);
+
+    uint32_t GetShortID(const uint256& hash) const;
+
+    //! Add a transaction to the set, false if it is full: it is to be announced
+    bool Add(const uint256& hash);
+
+    //! The short ids of the set, which is moved in flight; the transactions whose short id collides go to vAnnounce
+    std::vector<uint32_t> StartRequest(int64_t nNow, std::vector<uint256>& vAnnounce);
+
+    /**
+     * Answer the short ids of the initiator's set, emptying the set: vWanted are the ones not in the set, vAnnounce
+     * the transactions of the set not in the request, vShared those in both
+     */
+    void Respond(const std::vector<uint32_t>& vRequest, std::vector<uint32_t>& vWanted,
+                 std::vector<uint256>& vAnnounce, std::vector<uint256>& vShared);
+
+    //! Complete the reconciliation in flight with the answer, false if none was: as Respond, for the initiator
+    bool Complete(const std::vector<uint32_t>& vWanted, std::vector<uint256>& vAnnounce, std::vector<uint256>& vShared);
+
+    //! Give up on the reconciliation in flight, its transactions are to be announced
+    void Abort(std::vector<uint256>& vAnnounce);
+
+private:
+    uint64_t k0 = 0;
+    uint64_t k1 = 0;
+};
+
+#endif // BITCOIN_TXRECONCILIATION_H
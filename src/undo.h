@@ -148,7 +148,7 @@ struct CSidechainUndoData
 
     // CROSS_EPOCH_CERT_DATA section
     CScCertificateView pastEpochTopQualityCertView;
-    std::list<std::shared_ptr<Sidechain::ScFeeData>> scFees;
+    Sidechain::ScFeesBuffer scFees;
 
     // ANY_EPOCH_CERT_DATA section
     uint256 prevTopCommittedCertHash;
@@ -222,10 +222,10 @@ struct CSidechainUndoData
         {
             ::Serialize(s, pastEpochTopQualityCertView, nType, nVersion);
             if (contentBitMask & AvailableSections::NONCEASING_CERT_DATA) {
-                ::Serialize<decltype(s), Sidechain::ScFeeData, decltype(scFees), Sidechain::ScFeeData_v2>(s, scFees, nType, nVersion);
+                scFees.Serialize(s, /*fWithSubmissionHeight*/true, nType, nVersion);
             }
             else {
-                ::Serialize<decltype(s), Sidechain::ScFeeData, decltype(scFees), Sidechain::ScFeeData>(s, scFees, nType, nVersion);
+                scFees.Serialize(s, /*fWithSubmissionHeight*/false, nType, nVersion);
             }
         }
         if (contentBitMask & AvailableSections::ANY_EPOCH_CERT_DATA)
@@ -264,10 +264,10 @@ struct CSidechainUndoData
         {
             ::Unserialize(s, pastEpochTopQualityCertView, nType, nVersion);
             if (contentBitMask & AvailableSections::NONCEASING_CERT_DATA) {
-                ::Unserialize<decltype(s), Sidechain::ScFeeData, decltype(scFees), Sidechain::ScFeeData_v2>(s, scFees, nType, nVersion);
+                scFees.Unserialize(s, /*fWithSubmissionHeight*/true, nType, nVersion);
             }
             else {
-                ::Unserialize<decltype(s), Sidechain::ScFeeData, decltype(scFees), Sidechain::ScFeeData>(s, scFees, nType, nVersion);
+                scFees.Unserialize(s, /*fWithSubmissionHeight*/false, nType, nVersion);
             }
 
         }
@@ -306,12 +306,11 @@ struct CSidechainUndoData
             res += strprintf("pastEpochTopQualityCertView=%s\n", pastEpochTopQualityCertView.ToString());
             res += strprintf("scFees.size()=%u\n", scFees.size());
             for(const auto& entry: scFees) {
-                res += strprintf("scFtFee=%d.%08d - ", entry->forwardTxScFee / COIN, entry->forwardTxScFee % COIN);
-                res += strprintf("scMbtrFee=%d.%08d\n", entry->mbtrTxScFee / COIN, entry->mbtrTxScFee % COIN);
+                res += strprintf("scFtFee=%d.%08d - ", entry.forwardTxScFee / COIN, entry.forwardTxScFee % COIN);
+                res += strprintf("scMbtrFee=%d.%08d\n", entry.mbtrTxScFee / COIN, entry.mbtrTxScFee % COIN);
                 // Only for v2 non-ceasable sidechains
-                std::shared_ptr<Sidechain::ScFeeData_v2> casted_entry = std::dynamic_pointer_cast<Sidechain::ScFeeData_v2>(entry);
-                if (casted_entry) {
-                    res += strprintf("submissionHeight=%d\n", casted_entry->submissionHeight);
+                if (contentBitMask & AvailableSections::NONCEASING_CERT_DATA) {
+                    res += strprintf("submissionHeight=%d\n", entry.submissionHeight);
                 }
             }
         }
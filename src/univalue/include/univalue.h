@@ -12,6 +12,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <unordered_map>
 #include <cassert>
 
 #include <utility>        // std::pair
@@ -49,6 +51,10 @@ public:
         std::string s(val_);
         setStr(s);
     }
+    UniValue(const UniValue& other);
+    UniValue(UniValue&& other) = default;
+    UniValue& operator=(const UniValue& other);
+    UniValue& operator=(UniValue&& other) = default;
 
     void clear();
     void reserve(size_t n) {
@@ -98,10 +104,13 @@ public:
     bool isObject() const { return (typ == VOBJ); }
 
     bool push_back(const UniValue& val);
+    bool push_back(UniValue&& val);
     bool push_backV(const std::vector<UniValue>& vec);
 
     void _pushKV(const std::string& key, const UniValue& val);
+    void _pushKV(const std::string& key, UniValue&& val);
     bool pushKV(const std::string& key, const UniValue& val);
+    bool pushKV(const std::string& key, UniValue&& val);
     bool pushKVs(const UniValue& obj);
 
     std::string write(unsigned int prettyIndent = 0,
@@ -118,8 +127,15 @@ private:
     std::string val;                       // numbers are stored as C++ strings
     std::vector<std::string> keys;
     std::vector<UniValue> values;
+    // the position of the keys of an object with more than INDEX_MIN_KEYS of them, so that looking a
+    // key up does not scan them all; a key found twice is at its first position, as findKey() scans
+    std::unique_ptr<std::unordered_map<std::string, size_t> > index;
 
+    static const size_t INDEX_MIN_KEYS = 16;
+
+    void indexLastKey();
     bool findKey(const std::string& key, size_t& retIdx) const;
+    void write(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
 
@@ -12,12 +12,28 @@
 
 const UniValue NullUniValue;
 
+UniValue::UniValue(const UniValue& other) :
+    typ(other.typ), val(other.val), keys(other.keys), values(other.values)
+{
+    if (other.index)
+        index.reset(new std::unordered_map<std::string, size_t>(*other.index));
+}
+
+UniValue& UniValue::operator=(const UniValue& other)
+{
+    // through a copy, other can be a member of this value
+    UniValue tmp(other);
+    *this = std::move(tmp);
+    return *this;
+}
+
 void UniValue::clear()
 {
     typ = VNULL;
     val.clear();
     keys.clear();
     values.clear();
+    index.reset();
 }
 
 bool UniValue::setNull()
@@ -125,6 +141,15 @@ bool UniValue::push_back(const UniValue& val_)
     return true;
 }
 
+bool UniValue::push_back(UniValue&& val_)
+{
+    if (typ != VARR)
+        return false;
+
+    values.push_back(std::move(val_));
+    return true;
+}
+
 bool UniValue::push_backV(const std::vector<UniValue>& vec)
 {
     if (typ != VARR)
@@ -139,6 +164,14 @@ void UniValue::_pushKV(const std::string& key, const UniValue& val_)
 {
     keys.push_back(key);
     values.push_back(val_);
+    indexLastKey();
+}
+
+void UniValue::_pushKV(const std::string& key, UniValue&& val_)
+{
+    keys.push_back(key);
+    values.push_back(std::move(val_));
+    indexLastKey();
 }
 
 bool UniValue::pushKV(const std::string& key, const UniValue& val_)
@@ -154,6 +187,19 @@ bool UniValue::pushKV(const std::string& key, const UniValue& val_)
     return true;
 }
 
+bool UniValue::pushKV(const std::string& key, UniValue&& val_)
+{
+    if (typ != VOBJ)
+        return false;
+
+    size_t idx;
+    if (findKey(key, idx))
+        values[idx] = std::move(val_);
+    else
+        _pushKV(key, std::move(val_));
+    return true;
+}
+
 bool UniValue::pushKVs(const UniValue& obj)
 {
     if (typ != VOBJ || obj.typ != VOBJ)
@@ -175,8 +221,28 @@ void UniValue::getObjMap(std::map<std::string,UniValue>& kv) const
         kv[keys[i]] = values[i];
 }
 
+void UniValue::indexLastKey()
+{
+    if (index) {
+        index->emplace(keys.back(), keys.size() - 1);
+    } else if (keys.size() > INDEX_MIN_KEYS) {
+        index.reset(new std::unordered_map<std::string, size_t>());
+        index->reserve(keys.size() * 2);
+        for (size_t i = 0; i < keys.size(); i++)
+            index->emplace(keys[i], i);
+    }
+}
+
 bool UniValue::findKey(const std::string& key, size_t& retIdx) const
 {
+    if (index) {
+        std::unordered_map<std::string, size_t>::const_iterator it = index->find(key);
+        if (it == index->end())
+            return false;
+        retIdx = it->second;
+        return true;
+    }
+
     for (size_t i = 0; i < keys.size(); i++) {
         if (keys[i] == key) {
             retIdx = i;
@@ -244,9 +310,9 @@ const char *uvTypeName(UniValue::VType t)
 
 const UniValue& find_value(const UniValue& obj, const std::string& name)
 {
-    for (unsigned int i = 0; i < obj.keys.size(); i++)
-        if (obj.keys[i] == name)
-            return obj.values.at(i);
+    size_t i;
+    if (obj.findKey(name, i))
+        return obj.values.at(i);
 
     return NullUniValue;
 }
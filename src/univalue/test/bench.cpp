@@ -0,0 +1,91 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://opensource.org/licenses/mit-license.php.
+
+// Times the parsing and the writing of a large value shaped like a verbose block, and the lookups in an
+// object with many keys. Not run by "make check": ./test/bench [rounds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+#include "univalue.h"
+
+static UniValue makeBlock(int nTx)
+{
+    UniValue block(UniValue::VOBJ);
+    block.pushKV("hash", std::string(64, 'a'));
+    block.pushKV("height", 100000);
+    UniValue txs(UniValue::VARR);
+    for (int i = 0; i < nTx; i++) {
+        UniValue tx(UniValue::VOBJ);
+        tx.pushKV("txid", std::string(64, 'b'));
+        tx.pushKV("version", 1);
+        tx.pushKV("locktime", 0);
+        UniValue vin(UniValue::VARR);
+        for (int j = 0; j < 2; j++) {
+            UniValue in(UniValue::VOBJ);
+            in.pushKV("txid", std::string(64, 'c'));
+            in.pushKV("vout", j);
+            UniValue sig(UniValue::VOBJ);
+            sig.pushKV("asm", std::string(140, 'd'));
+            sig.pushKV("hex", std::string(214, 'e'));
+            in.pushKV("scriptSig", sig);
+            in.pushKV("sequence", (int64_t)4294967295LL);
+            vin.push_back(in);
+        }
+        tx.pushKV("vin", vin);
+        UniValue vout(UniValue::VARR);
+        for (int j = 0; j < 2; j++) {
+            UniValue out(UniValue::VOBJ);
+            out.pushKV("value", 12.5);
+            out.pushKV("n", j);
+            UniValue script(UniValue::VOBJ);
+            script.pushKV("asm", std::string(80, 'f'));
+            script.pushKV("hex", std::string(50, '0'));
+            script.pushKV("type", "pubkeyhash");
+            out.pushKV("scriptPubKey", script);
+            vout.push_back(out);
+        }
+        tx.pushKV("vout", vout);
+        txs.push_back(tx);
+    }
+    block.pushKV("tx", txs);
+    return block;
+}
+
+template <typename F>
+static double timeMillis(int rounds, F f)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; i++)
+        f();
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / rounds;
+}
+
+int main(int argc, char *argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 10;
+    if (rounds <= 0)
+        rounds = 1;
+
+    UniValue block = makeBlock(5000);
+    std::string json = block.write();
+    size_t nCheck = 0;
+
+    double writeMs = timeMillis(rounds, [&]{ nCheck += block.write().size(); });
+    double readMs = timeMillis(rounds, [&]{ UniValue v; nCheck += v.read(json); });
+
+    UniValue wide(UniValue::VOBJ);
+    for (int i = 0; i < 10000; i++)
+        wide.pushKV("address" + std::to_string(i), i);
+    double lookupMs = timeMillis(rounds, [&]{
+        for (int i = 0; i < 10000; i++)
+            nCheck += wide["address" + std::to_string(i)].get_int();
+    });
+
+    printf("block of %u bytes: write %.3f ms, read %.3f ms\n", (unsigned)json.size(), writeMs, readMs);
+    printf("object of %u keys: %.3f ms for a lookup of each key\n", (unsigned)wide.size(), lookupMs);
+    return nCheck == 0;
+}
@@ -352,6 +352,46 @@ BOOST_AUTO_TEST_CASE(univalue_object)
 
 }
 
+BOOST_AUTO_TEST_CASE(univalue_largeobject)
+{
+    // enough keys for the lookups to go through the index
+    UniValue obj(UniValue::VOBJ);
+    for (int i = 0; i < 100; i++) {
+        std::string key = "key" + std::to_string(i);
+        BOOST_CHECK(obj.pushKV(key, i));
+    }
+    BOOST_CHECK_EQUAL(obj.size(), 100);
+    BOOST_CHECK_EQUAL(obj["key0"].get_int(), 0);
+    BOOST_CHECK_EQUAL(obj["key99"].get_int(), 99);
+    BOOST_CHECK_EQUAL(find_value(obj, "key42").get_int(), 42);
+    BOOST_CHECK(!obj.exists("key100"));
+
+    BOOST_CHECK(obj.pushKV("key42", "replaced"));
+    BOOST_CHECK_EQUAL(obj.size(), 100);
+    BOOST_CHECK_EQUAL(obj["key42"].get_str(), "replaced");
+
+    // the first of two members with the same key is found
+    obj._pushKV("key7", "duplicate");
+    BOOST_CHECK_EQUAL(obj.size(), 101);
+    BOOST_CHECK_EQUAL(obj["key7"].get_int(), 7);
+
+    UniValue copy = obj;
+    BOOST_CHECK(copy.pushKV("key100", 100));
+    BOOST_CHECK_EQUAL(copy["key100"].get_int(), 100);
+    BOOST_CHECK(!obj.exists("key100"));
+
+    UniValue parsed;
+    BOOST_CHECK(parsed.read(obj.write()));
+    BOOST_CHECK_EQUAL(parsed.size(), 101);
+    BOOST_CHECK_EQUAL(parsed["key7"].get_int(), 7);
+    BOOST_CHECK_EQUAL(parsed["key99"].get_int(), 99);
+    BOOST_CHECK_EQUAL(parsed.write(), obj.write());
+
+    obj.setArray();
+    BOOST_CHECK(!obj.exists("key0"));
+    BOOST_CHECK(obj["key0"].isNull());
+}
+
 static const char *json1 =
 "[1.10000000,{\"key1\":\"str\\u0000\",\"key2\":800,\"key3\":{\"name\":\"martian http://test.com\"}}]";
 
@@ -407,6 +447,7 @@ int main (int argc, char *argv[])
     univalue_set();
     univalue_array();
     univalue_object();
+    univalue_largeobject();
     univalue_readwrite();
     return 0;
 }
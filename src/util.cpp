@@ -935,6 +935,27 @@ int GetNumCores()
     return boost::thread::physical_concurrency();
 }
 
+int64_t GetAvailableMemory()
+{
+#ifdef WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (!GlobalMemoryStatusEx(&status))
+        return 0;
+    return status.ullAvailPhys;
+#else
+#ifdef _SC_AVPHYS_PAGES
+    long nPages = sysconf(_SC_AVPHYS_PAGES);
+#else
+    long nPages = sysconf(_SC_PHYS_PAGES);
+#endif
+    long nPageSize = sysconf(_SC_PAGESIZE);
+    if (nPages <= 0 || nPageSize <= 0)
+        return 0;
+    return (int64_t)nPages * nPageSize;
+#endif
+}
+
 /**
  * @brief Get the Leading Zero Bits in a byte
  * (e.g 00000100 => 5 trailing zero bits).
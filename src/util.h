@@ -232,6 +232,12 @@ std::string HelpMessageOpt(const std::string& option, const std::string& message
  */
 int GetNumCores();
 
+/**
+ * Return the physical memory available on the current system in bytes, or the total one
+ * when the platform does not tell the available one; 0 if unknown.
+ */
+int64_t GetAvailableMemory();
+
 void SetThreadPriority(int nPriority);
 void RenameThread(const char* name);
 
@@ -6,52 +6,351 @@
 #include "validationinterface.h"
 #include <primitives/certificate.h>
 
+#include "chain.h"
+#include "consensus/validation.h"
+#include "sc/sidechain.h"
+#include "util.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <set>
+#include <thread>
+
 using namespace boost::placeholders;
 
 static CMainSignals g_signals;
+//! The signals of the interfaces registered with fAsync, fired by the thread of the queue
+static CMainSignals g_asyncSignals;
 
 CMainSignals& GetMainSignals()
 {
     return g_signals;
 }
 
-void RegisterValidationInterface(CValidationInterface* pwalletIn) {
-    g_signals.UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
-    g_signals.SyncTransaction.connect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2));
-    g_signals.EraseTransaction.connect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
-    g_signals.UpdatedTransaction.connect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
-    g_signals.ChainTip.connect(boost::bind(&CValidationInterface::ChainTip, pwalletIn, _1, _2, _3, _4));
-    g_signals.SetBestChain.connect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
-    g_signals.Broadcast.connect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
-    g_signals.BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
-    g_signals.SyncCertificate.connect(boost::bind(&CValidationInterface::SyncCertificate, pwalletIn, _1, _2, _3));
-    g_signals.SyncCertStatus.connect(boost::bind(&CValidationInterface::SyncCertStatusInfo, pwalletIn, _1));
+/** A single thread calling the updates queued, in order */
+class CValidationInterfaceQueue
+{
+public:
+    void Start()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fRunning)
+            return;
+        fRunning = true;
+        fStop = false;
+        thread = std::thread(&CValidationInterfaceQueue::Thread, this);
+    }
+
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!fRunning)
+                return;
+            fStop = true;
+        }
+        cond.notify_all();
+        thread.join();
+        std::lock_guard<std::mutex> lock(mutex);
+        fRunning = false;
+    }
+
+    //! Queue call, or make it at once if the thread is not running
+    void Enqueue(std::function<void()>&& call)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (fRunning && !fStop) {
+                queue.push_back(std::move(call));
+                cond.notify_one();
+                return;
+            }
+        }
+        call();
+    }
+
+    void Sync()
+    {
+        // the updates queued before are delivered when this one is
+        if (std::this_thread::get_id() == thread.get_id())
+            return;
+        std::promise<void> delivered;
+        std::future<void> future = delivered.get_future();
+        Enqueue([&delivered]() { delivered.set_value(); });
+        future.wait();
+    }
+
+    size_t Size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return queue.size();
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::function<void()> > queue;
+    bool fRunning = false;
+    bool fStop = false;
+    std::thread thread;
+
+    void Thread()
+    {
+        RenameThread("horizen-notify");
+        while (true) {
+            std::function<void()> call;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait(lock, [this]() { return fStop || !queue.empty(); });
+                // what was queued is delivered before stopping
+                if (queue.empty())
+                    return;
+                call = std::move(queue.front());
+                queue.pop_front();
+            }
+            try {
+                call();
+            } catch (const std::exception& e) {
+                PrintExceptionContinue(&e, "horizen-notify");
+            } catch (...) {
+                PrintExceptionContinue(NULL, "horizen-notify");
+            }
+        }
+    }
+};
+
+static CValidationInterfaceQueue g_queue;
+
+//! Guards the registrations with fAsync and the copies of the last block fired
+static std::mutex g_asyncMutex;
+static std::set<CValidationInterface*> g_asyncInterfaces;
+static bool g_fRelayConnected = false;
+static std::shared_ptr<const CBlock> g_lastBlockCopy;
+static const CBlock* g_lastBlock = NULL;
+
+/**
+ * A copy of *pblock to be read by the thread of the queue, shared by the updates about the same block: its
+ * transactions and certificates are fired one by one.
+ */
+static std::shared_ptr<const CBlock> ShareBlock(const CBlock* pblock)
+{
+    if (pblock == NULL)
+        return nullptr;
+    std::lock_guard<std::mutex> lock(g_asyncMutex);
+    // the address of a block freed since can be reused, by another block or the same one with another nonce
+    if (pblock != g_lastBlock || !g_lastBlockCopy || g_lastBlockCopy->hashMerkleRoot != pblock->hashMerkleRoot ||
+        g_lastBlockCopy->hashPrevBlock != pblock->hashPrevBlock || g_lastBlockCopy->nNonce != pblock->nNonce ||
+        g_lastBlockCopy->nTime != pblock->nTime) {
+        g_lastBlockCopy = std::make_shared<const CBlock>(*pblock);
+        g_lastBlock = pblock;
+    }
+    return g_lastBlockCopy;
+}
+
+//! The index of an element of v, -1 if elem is not one
+template <typename T>
+static int IndexIn(const std::vector<T>& v, const T& elem)
+{
+    std::less<const T*> less;
+    if (v.empty() || less(&elem, &v.front()) || less(&v.back(), &elem))
+        return -1;
+    return &elem - &v.front();
+}
+
+/** Connected to g_signals, fires g_asyncSignals on the queue with copies of what the updates refer to */
+static void ConnectRelay()
+{
+    g_signals.UpdatedBlockTip.connect([](const CBlockIndex* pindex) {
+        if (!g_asyncSignals.UpdatedBlockTip.empty())
+            g_queue.Enqueue([pindex]() { g_asyncSignals.UpdatedBlockTip(pindex); });
+    });
+    g_signals.SyncTransaction.connect([](const CTransaction& tx, const CBlock* pblock) {
+        if (g_asyncSignals.SyncTransaction.empty())
+            return;
+        std::shared_ptr<const CBlock> block = ShareBlock(pblock);
+        int nIndex = block ? IndexIn(pblock->vtx, tx) : -1;
+        if (nIndex >= 0) {
+            g_queue.Enqueue([block, nIndex]() { g_asyncSignals.SyncTransaction(block->vtx[nIndex], block.get()); });
+        } else {
+            std::shared_ptr<const CTransaction> ptx = std::make_shared<const CTransaction>(tx);
+            g_queue.Enqueue([ptx, block]() { g_asyncSignals.SyncTransaction(*ptx, block.get()); });
+        }
+    });
+    g_signals.EraseTransaction.connect([](const uint256& hash) {
+        if (!g_asyncSignals.EraseTransaction.empty())
+            g_queue.Enqueue([hash]() { g_asyncSignals.EraseTransaction(hash); });
+    });
+    g_signals.UpdatedTransaction.connect([](const uint256& hash) {
+        if (!g_asyncSignals.UpdatedTransaction.empty())
+            g_queue.Enqueue([hash]() { g_asyncSignals.UpdatedTransaction(hash); });
+    });
+    g_signals.BlockSyncBegin.connect([]() {
+        if (!g_asyncSignals.BlockSyncBegin.empty())
+            g_queue.Enqueue([]() { g_asyncSignals.BlockSyncBegin(); });
+    });
+    g_signals.ChainTip.connect([](const CBlockIndex* pindex, const CBlock* pblock, ZCIncrementalMerkleTree tree, bool added) {
+        if (g_asyncSignals.ChainTip.empty())
+            return;
+        std::shared_ptr<const CBlock> block = ShareBlock(pblock);
+        g_queue.Enqueue([pindex, block, tree, added]() { g_asyncSignals.ChainTip(pindex, block.get(), tree, added); });
+    });
+    g_signals.SetBestChain.connect([](const CBlockLocator& locator) {
+        if (!g_asyncSignals.SetBestChain.empty())
+            g_queue.Enqueue([locator]() { g_asyncSignals.SetBestChain(locator); });
+    });
+    g_signals.Broadcast.connect([](int64_t nBestBlockTime) {
+        if (!g_asyncSignals.Broadcast.empty())
+            g_queue.Enqueue([nBestBlockTime]() { g_asyncSignals.Broadcast(nBestBlockTime); });
+    });
+    g_signals.BlockChecked.connect([](const CBlock& block, const CValidationState& state) {
+        if (g_asyncSignals.BlockChecked.empty())
+            return;
+        std::shared_ptr<const CBlock> pblock = ShareBlock(&block);
+        g_queue.Enqueue([pblock, state]() { g_asyncSignals.BlockChecked(*pblock, state); });
+    });
+    g_signals.SyncCertificate.connect([](const CScCertificate& cert, const CBlock* pblock, int bwtMaturityDepth) {
+        if (g_asyncSignals.SyncCertificate.empty())
+            return;
+        std::shared_ptr<const CBlock> block = ShareBlock(pblock);
+        int nIndex = block ? IndexIn(pblock->vcert, cert) : -1;
+        if (nIndex >= 0) {
+            g_queue.Enqueue([block, nIndex, bwtMaturityDepth]() {
+                g_asyncSignals.SyncCertificate(block->vcert[nIndex], block.get(), bwtMaturityDepth);
+            });
+        } else {
+            std::shared_ptr<const CScCertificate> pcert = std::make_shared<const CScCertificate>(cert);
+            g_queue.Enqueue([pcert, block, bwtMaturityDepth]() { g_asyncSignals.SyncCertificate(*pcert, block.get(), bwtMaturityDepth); });
+        }
+    });
+    g_signals.SyncCertStatus.connect([](const CScCertificateStatusUpdateInfo& certStatusInfo) {
+        if (!g_asyncSignals.SyncCertStatus.empty())
+            g_queue.Enqueue([certStatusInfo]() { g_asyncSignals.SyncCertStatus(certStatusInfo); });
+    });
+    g_signals.SyncSidechainEvents.connect([](int nHeight, const CSidechainEvents& scEvents, bool fConnected) {
+        if (!g_asyncSignals.SyncSidechainEvents.empty())
+            g_queue.Enqueue([nHeight, scEvents, fConnected]() { g_asyncSignals.SyncSidechainEvents(nHeight, scEvents, fConnected); });
+    });
+    g_signals.TransactionAddedToMempool.connect([](const uint256& hash, uint64_t nMempoolSequence) {
+        if (!g_asyncSignals.TransactionAddedToMempool.empty())
+            g_queue.Enqueue([hash, nMempoolSequence]() { g_asyncSignals.TransactionAddedToMempool(hash, nMempoolSequence); });
+    });
+    g_signals.TransactionRemovedFromMempool.connect([](const uint256& hash, MemPoolRemovalReason reason, uint64_t nMempoolSequence) {
+        if (!g_asyncSignals.TransactionRemovedFromMempool.empty())
+            g_queue.Enqueue([hash, reason, nMempoolSequence]() {
+                g_asyncSignals.TransactionRemovedFromMempool(hash, reason, nMempoolSequence);
+            });
+    });
+    g_signals.UpdatedBlockTemplate.connect([](const CBlockIndex* pindexPrev, const CAmount& nFeeGain) {
+        if (!g_asyncSignals.UpdatedBlockTemplate.empty())
+            g_queue.Enqueue([pindexPrev, nFeeGain]() { g_asyncSignals.UpdatedBlockTemplate(pindexPrev, nFeeGain); });
+    });
+}
+
+void RegisterValidationInterface(CValidationInterface* pwalletIn, bool fAsync) {
+    if (fAsync) {
+        std::lock_guard<std::mutex> lock(g_asyncMutex);
+        g_asyncInterfaces.insert(pwalletIn);
+        if (!g_fRelayConnected) {
+            ConnectRelay();
+            g_fRelayConnected = true;
+        }
+    }
+
+    CMainSignals& signals = fAsync ? g_asyncSignals : g_signals;
+    signals.UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
+    signals.SyncTransaction.connect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2));
+    signals.EraseTransaction.connect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
+    signals.UpdatedTransaction.connect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
+    signals.BlockSyncBegin.connect(boost::bind(&CValidationInterface::BlockSyncBegin, pwalletIn));
+    signals.ChainTip.connect(boost::bind(&CValidationInterface::ChainTip, pwalletIn, _1, _2, _3, _4));
+    signals.SetBestChain.connect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
+    signals.Broadcast.connect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
+    signals.BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
+    signals.SyncCertificate.connect(boost::bind(&CValidationInterface::SyncCertificate, pwalletIn, _1, _2, _3));
+    signals.SyncCertStatus.connect(boost::bind(&CValidationInterface::SyncCertStatusInfo, pwalletIn, _1));
+    signals.SyncSidechainEvents.connect(boost::bind(&CValidationInterface::SyncSidechainEvents, pwalletIn, _1, _2, _3));
+    signals.TransactionAddedToMempool.connect(boost::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, _1, _2));
+    signals.TransactionRemovedFromMempool.connect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1, _2, _3));
+    signals.UpdatedBlockTemplate.connect(boost::bind(&CValidationInterface::UpdatedBlockTemplate, pwalletIn, _1, _2));
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
-    g_signals.SyncCertStatus.disconnect(boost::bind(&CValidationInterface::SyncCertStatusInfo, pwalletIn, _1));
-    g_signals.SyncCertificate.disconnect(boost::bind(&CValidationInterface::SyncCertificate, pwalletIn, _1, _2, _3));
-    g_signals.BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
-    g_signals.Broadcast.disconnect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
-    g_signals.ChainTip.disconnect(boost::bind(&CValidationInterface::ChainTip, pwalletIn, _1, _2, _3, _4));
-    g_signals.SetBestChain.disconnect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
-    g_signals.UpdatedTransaction.disconnect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
-    g_signals.EraseTransaction.disconnect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
-    g_signals.SyncTransaction.disconnect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2));
-    g_signals.UpdatedBlockTip.disconnect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
+    bool fAsync = false;
+    {
+        std::lock_guard<std::mutex> lock(g_asyncMutex);
+        fAsync = (g_asyncInterfaces.erase(pwalletIn) > 0);
+    }
+
+    CMainSignals& signals = fAsync ? g_asyncSignals : g_signals;
+    signals.UpdatedBlockTemplate.disconnect(boost::bind(&CValidationInterface::UpdatedBlockTemplate, pwalletIn, _1, _2));
+    signals.TransactionRemovedFromMempool.disconnect(boost::bind(&CValidationInterface::TransactionRemovedFromMempool, pwalletIn, _1, _2, _3));
+    signals.TransactionAddedToMempool.disconnect(boost::bind(&CValidationInterface::TransactionAddedToMempool, pwalletIn, _1, _2));
+    signals.SyncSidechainEvents.disconnect(boost::bind(&CValidationInterface::SyncSidechainEvents, pwalletIn, _1, _2, _3));
+    signals.SyncCertStatus.disconnect(boost::bind(&CValidationInterface::SyncCertStatusInfo, pwalletIn, _1));
+    signals.SyncCertificate.disconnect(boost::bind(&CValidationInterface::SyncCertificate, pwalletIn, _1, _2, _3));
+    signals.BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
+    signals.Broadcast.disconnect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
+    signals.ChainTip.disconnect(boost::bind(&CValidationInterface::ChainTip, pwalletIn, _1, _2, _3, _4));
+    signals.BlockSyncBegin.disconnect(boost::bind(&CValidationInterface::BlockSyncBegin, pwalletIn));
+    signals.SetBestChain.disconnect(boost::bind(&CValidationInterface::SetBestChain, pwalletIn, _1));
+    signals.UpdatedTransaction.disconnect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
+    signals.EraseTransaction.disconnect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
+    signals.SyncTransaction.disconnect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2));
+    signals.UpdatedBlockTip.disconnect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
+
+    // an update being delivered to it may still use it
+    if (fAsync)
+        g_queue.Sync();
+}
+
+static void DisconnectAll(CMainSignals& signals) {
+    signals.UpdatedBlockTemplate.disconnect_all_slots();
+    signals.SyncCertificate.disconnect_all_slots();
+    signals.SyncCertStatus.disconnect_all_slots();
+    signals.SyncSidechainEvents.disconnect_all_slots();
+    signals.TransactionAddedToMempool.disconnect_all_slots();
+    signals.TransactionRemovedFromMempool.disconnect_all_slots();
+    signals.BlockChecked.disconnect_all_slots();
+    signals.Broadcast.disconnect_all_slots();
+    signals.ChainTip.disconnect_all_slots();
+    signals.BlockSyncBegin.disconnect_all_slots();
+    signals.SetBestChain.disconnect_all_slots();
+    signals.UpdatedTransaction.disconnect_all_slots();
+    signals.EraseTransaction.disconnect_all_slots();
+    signals.SyncTransaction.disconnect_all_slots();
+    signals.UpdatedBlockTip.disconnect_all_slots();
 }
 
 void UnregisterAllValidationInterfaces() {
-    g_signals.SyncCertificate.disconnect_all_slots();
-    g_signals.SyncCertStatus.disconnect_all_slots();
-    g_signals.BlockChecked.disconnect_all_slots();
-    g_signals.Broadcast.disconnect_all_slots();
-    g_signals.ChainTip.disconnect_all_slots();
-    g_signals.SetBestChain.disconnect_all_slots();
-    g_signals.UpdatedTransaction.disconnect_all_slots();
-    g_signals.EraseTransaction.disconnect_all_slots();
-    g_signals.SyncTransaction.disconnect_all_slots();
-    g_signals.UpdatedBlockTip.disconnect_all_slots();
+    DisconnectAll(g_signals);
+    DisconnectAll(g_asyncSignals);
+    {
+        std::lock_guard<std::mutex> lock(g_asyncMutex);
+        g_asyncInterfaces.clear();
+        g_fRelayConnected = false;
+        g_lastBlockCopy.reset();
+        g_lastBlock = NULL;
+    }
+    g_queue.Sync();
+}
+
+void StartValidationInterfaceQueue() {
+    g_queue.Start();
+}
+
+void StopValidationInterfaceQueue() {
+    g_queue.Stop();
+}
+
+void SyncWithValidationInterfaceQueue() {
+    g_queue.Sync();
+}
+
+size_t GetValidationInterfaceQueueSize() {
+    return g_queue.Size();
 }
 
 void SyncWithWallets(const CTransaction &tx, const CBlock *pblock) {
@@ -65,3 +364,7 @@ void SyncWithWallets(const CScCertificate &cert, const CBlock *pblock, int bwtMa
 void SyncCertStatusUpdate(const CScCertificateStatusUpdateInfo& certStatusInfo) {
     g_signals.SyncCertStatus(certStatusInfo);
 }
+
+void SyncSidechainEventsUpdate(int nHeight, const CSidechainEvents& scEvents, bool fConnected) {
+    g_signals.SyncSidechainEvents(nHeight, scEvents, fConnected);
+}
@@ -8,6 +8,7 @@
 
 #include <boost/signals2/signal.hpp>
 
+#include "amount.h"
 #include "zcash/IncrementalMerkleTree.hpp"
 
 class CBlock;
@@ -20,12 +21,18 @@ class CValidationState;
 class uint256;
 struct CMinimalSidechain;
 struct CScCertificateStatusUpdateInfo;
+class CSidechainEvents;
+enum class MemPoolRemovalReason : uint8_t;
 
 // These functions dispatch to one or all registered wallets
 
-/** Register a wallet to receive updates from core */
-void RegisterValidationInterface(CValidationInterface* pwalletIn);
-/** Unregister a wallet from core */
+/**
+ * Register a wallet to receive updates from core. With fAsync they are delivered in order on the thread of
+ * the validation interface queue, not by the thread connecting the blocks, under cs_main: for the subscribers
+ * only publishing them, which block connection does not need to wait for.
+ */
+void RegisterValidationInterface(CValidationInterface* pwalletIn, bool fAsync = false);
+/** Unregister a wallet from core; for one registered with fAsync, once what was queued for it is delivered */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllValidationInterfaces();
@@ -35,6 +42,20 @@ void SyncWithWallets(const CTransaction& tx, const CBlock* pblock = NULL);
 void SyncWithWallets(const CScCertificate& cert, const CBlock* pblock = NULL, int bwtMaturityDepth = -1);
 /** Push to wallets updates about bwt state and related sidechain information */
 void SyncCertStatusUpdate(const CScCertificateStatusUpdateInfo& certStatusInfo);
+/** Push the sidechains maturing and ceasing at nHeight, when the block is connected or, with !fConnected, disconnected */
+void SyncSidechainEventsUpdate(int nHeight, const CSidechainEvents& scEvents, bool fConnected);
+
+/** Start the thread delivering the updates to the interfaces registered with fAsync; until then they get them at once */
+void StartValidationInterfaceQueue();
+/** Deliver what is queued, then stop the thread */
+void StopValidationInterfaceQueue();
+/**
+ * Wait for the updates queued so far to be delivered, e.g. for an rpc the effects of a block on the notifiers.
+ * Not to be called holding cs_main, which the subscribers may need.
+ */
+void SyncWithValidationInterfaceQueue();
+/** The number of updates waiting to be delivered */
+size_t GetValidationInterfaceQueueSize();
 
 class CValidationInterface {
 protected:
@@ -43,13 +64,18 @@ protected:
     virtual void SyncTransaction(const CTransaction &tx, const CBlock *pblock) {}
     virtual void SyncCertificate(const CScCertificate &tx, const CBlock *pblock, int bwtMaturityDepth) {}
     virtual void SyncCertStatusInfo(const CScCertificateStatusUpdateInfo& certStatusInfo) {}
+    virtual void SyncSidechainEvents(int nHeight, const CSidechainEvents& scEvents, bool fConnected) {}
+    virtual void TransactionAddedToMempool(const uint256& hash, uint64_t nMempoolSequence) {}
+    virtual void TransactionRemovedFromMempool(const uint256& hash, MemPoolRemovalReason reason, uint64_t nMempoolSequence) {}
     virtual void EraseFromWallet(const uint256 &hash) {}
+    virtual void BlockSyncBegin() {}
     virtual void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added) {}
     virtual void SetBestChain(const CBlockLocator &locator) {}
     virtual void UpdatedTransaction(const uint256 &hash) {}
     virtual void ResendWalletTransactions(int64_t nBestBlockTime) {}
     virtual void BlockChecked(const CBlock&, const CValidationState&) {}
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    virtual void UpdatedBlockTemplate(const CBlockIndex *pindexPrev, const CAmount& nFeeGain) {}
+    friend void ::RegisterValidationInterface(CValidationInterface*, bool);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
 };
@@ -63,6 +89,11 @@ struct CMainSignals {
     boost::signals2::signal<void (const uint256 &)> EraseTransaction;
     /** Notifies listeners of an updated transaction without new data (for now: a coinbase potentially becoming visible). */
     boost::signals2::signal<void (const uint256 &)> UpdatedTransaction;
+    /**
+     * Notifies listeners that the updates about a block connected or disconnected follow, up to its ChainTip: they
+     * may be gathered, e.g. in a single database transaction.
+     */
+    boost::signals2::signal<void ()> BlockSyncBegin;
     /** Notifies listeners of a change to the tip of the active block chain. */
     boost::signals2::signal<void (const CBlockIndex *, const CBlock *, ZCIncrementalMerkleTree, bool)> ChainTip;
     /** Notifies listeners of a new active block chain. */
@@ -75,6 +106,16 @@ struct CMainSignals {
     boost::signals2::signal<void (const CScCertificate &, const CBlock *, int bwtMaturityDepth)> SyncCertificate;
     /** Notifies listeners of updated bwts for given certificate.*/
     boost::signals2::signal<void (const CScCertificateStatusUpdateInfo& certStatusInfo)> SyncCertStatus;
+    /** Notifies listeners of the sidechains maturing and ceasing at a height connected or disconnected */
+    boost::signals2::signal<void (int nHeight, const CSidechainEvents& scEvents, bool fConnected)> SyncSidechainEvents;
+    /**
+     * Notifies listeners of a transaction or certificate added to the mempool, and of one removed, with the mempool
+     * sequence the change bumped it to. Fired holding mempool.cs, in the order of the sequence.
+     */
+    boost::signals2::signal<void (const uint256 &, uint64_t)> TransactionAddedToMempool;
+    boost::signals2::signal<void (const uint256 &, MemPoolRemovalReason, uint64_t)> TransactionRemovedFromMempool;
+    /** Notifies listeners that the mempool gathered enough fees on top of pindexPrev for a better block template */
+    boost::signals2::signal<void (const CBlockIndex *, const CAmount&)> UpdatedBlockTemplate;
 };
 
 CMainSignals& GetMainSignals();
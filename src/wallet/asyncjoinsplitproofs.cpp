@@ -0,0 +1,81 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "asyncjoinsplitproofs.h"
+
+#include "init.h"
+#include "util.h"
+#include "utiltime.h"
+
+static int GetProofThreads()
+{
+    int nThreads = GetArg("-joinsplitproofthreads", DEFAULT_JOINSPLIT_PROOF_THREADS);
+    if (nThreads <= 0)
+        nThreads = GetNumCores();
+    return nThreads;
+}
+
+static CSemaphore& GetProofSemaphore()
+{
+    static CSemaphore semProofs(GetProofThreads());
+    return semProofs;
+}
+
+void CAsyncJoinSplitProofs::Add(size_t nIndex, const ZCJSProofWitness& witness)
+{
+    LOCK(cs);
+    if (nProofs++ == 0)
+        nStartTime = GetTimeMicros();
+
+    vPending.push_back(std::make_pair(nIndex, std::async(std::launch::async, [witness]() {
+        CSemaphoreGrant grant(GetProofSemaphore());
+        int64_t nTimeStart = GetTimeMicros();
+        libzcash::SproutProof proof = pzcashParams->prove(witness);
+        return std::make_pair(proof, GetTimeMicros() - nTimeStart);
+    })));
+}
+
+bool CAsyncJoinSplitProofs::IsEmpty() const
+{
+    LOCK(cs);
+    return nProofs == 0;
+}
+
+void CAsyncJoinSplitProofs::SetProofs(CMutableTransaction& mtx)
+{
+    // the status can be read meanwhile, the lock is not held while waiting
+    std::vector<std::pair<size_t, std::future<std::pair<libzcash::SproutProof, int64_t> > > > vProofs;
+    {
+        LOCK(cs);
+        vProofs.swap(vPending);
+    }
+
+    std::vector<int64_t> vTimes;
+    for (auto& entry : vProofs) {
+        std::pair<libzcash::SproutProof, int64_t> result = entry.second.get();
+        assert(entry.first < mtx.vjoinsplit.size());
+        mtx.vjoinsplit[entry.first].proof = result.first;
+        vTimes.push_back(result.second);
+    }
+
+    LOCK(cs);
+    vProofTimes.insert(vProofTimes.end(), vTimes.begin(), vTimes.end());
+    nWallTime = GetTimeMicros() - nStartTime;
+}
+
+UniValue CAsyncJoinSplitProofs::GetTimings() const
+{
+    LOCK(cs);
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("count", (uint64_t)nProofs);
+    obj.pushKV("threads", GetProofThreads());
+    if (!vProofTimes.empty()) {
+        UniValue times(UniValue::VARR);
+        for (int64_t nTime : vProofTimes)
+            times.push_back(nTime * 0.000001);
+        obj.pushKV("proofseconds", times);
+        obj.pushKV("wallseconds", nWallTime * 0.000001);
+    }
+    return obj;
+}
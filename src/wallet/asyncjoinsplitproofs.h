@@ -0,0 +1,57 @@
+// Copyright (c) 2017 The Zen Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef ASYNCJOINSPLITPROOFS_H
+#define ASYNCJOINSPLITPROOFS_H
+
+#include "primitives/transaction.h"
+#include "sync.h"
+#include "zcash/JoinSplit.hpp"
+
+#include <future>
+#include <utility>
+#include <vector>
+
+#include <univalue.h>
+
+//! -joinsplitproofthreads default, 0 meaning as many as the cores
+static const int DEFAULT_JOINSPLIT_PROOF_THREADS = 2;
+
+/**
+ * The SNARK proofs of the joinsplits of a transaction being created, generated concurrently.
+ *
+ * A joinsplit is created with its notes, commitments and ciphertexts but without its proof, which is
+ * then computed in the background from the witness sampled with the notes: the next joinsplit, even
+ * one spending the change of the previous, only needs the commitments to witness its inputs against
+ * the intermediate anchor. The proofs of all the asynchronous operations are limited together to
+ * -joinsplitproofthreads at a time, each of them takes memory and a core for a long time.
+ */
+class CAsyncJoinSplitProofs
+{
+public:
+    CAsyncJoinSplitProofs() : nProofs(0), nStartTime(0), nWallTime(0) {}
+
+    //! Starts the proof of the joinsplit at nIndex of the transaction
+    void Add(size_t nIndex, const ZCJSProofWitness& witness);
+
+    //! Whether no proof was ever started
+    bool IsEmpty() const;
+
+    //! Waits for the proofs and sets them in the joinsplits of mtx, throws the error of a failed proof
+    void SetProofs(CMutableTransaction& mtx);
+
+    //! The proofs started and, once they are set, the time taken by each and by all of them
+    UniValue GetTimings() const;
+
+private:
+    mutable CCriticalSection cs;
+    size_t nProofs;
+    int64_t nStartTime;
+    int64_t nWallTime;
+    std::vector<int64_t> vProofTimes;
+    // Last, the tasks still running are waited for by their futures before the members above go
+    std::vector<std::pair<size_t, std::future<std::pair<libzcash::SproutProof, int64_t> > > > vPending;
+};
+
+#endif // ASYNCJOINSPLITPROOFS_H
@@ -111,6 +111,9 @@ AsyncRPCOperation_mergetoaddress::~AsyncRPCOperation_mergetoaddress()
 
 void AsyncRPCOperation_mergetoaddress::main()
 {
+    // the calls made for the operation are for the wallet of the request which created it
+    CRPCRequestURIScope requestScope(getRequestURI());
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (isCancelled()) {
         unlock_utxos(); // clean up
         unlock_notes();
@@ -183,15 +186,15 @@ void AsyncRPCOperation_mergetoaddress::main()
     // !!! Payment disclosure START
     if (success && paymentDisclosureMode && paymentDisclosureData_.size() > 0) {
         uint256 txidhash = tx_.GetHash();
-        std::shared_ptr<PaymentDisclosureDB> db = PaymentDisclosureDB::sharedInstance();
+        std::vector<PaymentDisclosureKeyInfo> entries;
+        entries.reserve(paymentDisclosureData_.size());
         for (PaymentDisclosureKeyInfo p : paymentDisclosureData_) {
             p.first.hash = txidhash;
-            if (!db->Put(p.first, p.second)) {
-                LogPrint("paymentdisclosure", "%s: Payment Disclosure: Error writing entry to database for key %s\n", getId(), p.first.ToString());
-            } else {
-                LogPrint("paymentdisclosure", "%s: Payment Disclosure: Successfully added entry to database for key %s\n", getId(), p.first.ToString());
-            }
+            entries.push_back(p);
         }
+        // written in the background, in one batch
+        PaymentDisclosureDB::sharedInstance()->PutBatchAsync(entries);
+        LogPrint("paymentdisclosure", "%s: Payment Disclosure: Queued %u entries to the database for tx %s\n", getId(), entries.size(), txidhash.ToString());
     }
     // !!! Payment disclosure END
 }
@@ -201,6 +204,7 @@ void AsyncRPCOperation_mergetoaddress::main()
 // 2. #1277 Spendable notes are not locked, so an operation running in parallel could also try to use them
 bool AsyncRPCOperation_mergetoaddress::main_impl()
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     assert(isToTaddr_ != isToZaddr_);
 
     bool isPureTaddrOnlyTx = (noteInputs_.empty() && isToTaddr_);
@@ -307,6 +311,7 @@ bool AsyncRPCOperation_mergetoaddress::main_impl()
 
         UniValue obj(UniValue::VOBJ);
         obj = perform_joinsplit(info);
+        obj = sign_joinsplits(obj);
         sign_send_raw_transaction(obj);
         return true;
     }
@@ -322,13 +327,13 @@ bool AsyncRPCOperation_mergetoaddress::main_impl()
     // change upon arrival of new blocks which contain joinsplit transactions.  This is likely
     // to happen as creating a chained joinsplit transaction can take longer than the block interval.
     {
-        LOCK2(cs_main, pwalletMain->cs_wallet);
+        LOCK2(cs_main, pwallet->cs_wallet);
         for (auto t : noteInputs_) {
             JSOutPoint jso = std::get<0>(t);
             std::vector<JSOutPoint> vOutPoints = {jso};
             uint256 inputAnchor;
             std::vector<std::optional<ZCIncrementalWitness>> vInputWitnesses;
-            pwalletMain->GetNoteWitnesses(vOutPoints, vInputWitnesses, inputAnchor);
+            pwallet->GetNoteWitnesses(vOutPoints, vInputWitnesses, inputAnchor);
             jsopWitnessAnchorMap[jso.ToString()] = MergeToAddressWitnessAnchorData{vInputWitnesses[0], inputAnchor};
         }
     }
@@ -410,7 +415,7 @@ bool AsyncRPCOperation_mergetoaddress::main_impl()
         // Consume change as the first input of the JoinSplit.
         //
         if (jsChange > 0) {
-            LOCK2(cs_main, pwalletMain->cs_wallet);
+            LOCK2(cs_main, pwallet->cs_wallet);
 
             // Update tree state with previous joinsplit
             ZCIncrementalMerkleTree tree;
@@ -500,8 +505,8 @@ bool AsyncRPCOperation_mergetoaddress::main_impl()
             int wtxHeight = -1;
             int wtxDepth = -1;
             {
-                LOCK2(cs_main, pwalletMain->cs_wallet);
-                const CWalletTransactionBase& wtx = *(pwalletMain->getMapWallet().at(jso.hash));
+                LOCK2(cs_main, pwallet->cs_wallet);
+                const CWalletTransactionBase& wtx = *(pwallet->getMapWallet().at(jso.hash));
                 // Zero confirmation notes belong to transactions which have not yet been mined
                 if (mapBlockIndex.find(wtx.hashBlock) == mapBlockIndex.end()) {
                     throw JSONRPCError(RPC_WALLET_ERROR, strprintf("mapBlockIndex does not contain block hash %s", wtx.hashBlock.ToString()));
@@ -603,11 +608,59 @@ bool AsyncRPCOperation_mergetoaddress::main_impl()
     assert(zInputsDeque.size() == 0);
     assert(vpubNewProcessed);
 
+    obj = sign_joinsplits(obj);
     sign_send_raw_transaction(obj);
     return true;
 }
 
 
+/**
+ * Set the proofs of the joinsplits once they are all generated, then verify the joinsplits and sign
+ * them, since the signature covers the proofs.
+ * Returns the object of the last joinsplit with the raw transaction signed.
+ */
+UniValue AsyncRPCOperation_mergetoaddress::sign_joinsplits(UniValue obj)
+{
+    CMutableTransaction mtx(tx_);
+    jsProofs_.SetProofs(mtx);
+
+    UniValue timings = jsProofs_.GetTimings();
+    if (timings.exists("wallseconds")) {
+        LogPrint("zrpc", "%s: generated %d joinsplit proofs in %.3fs\n",
+                 getId(), timings["count"].get_int(), timings["wallseconds"].get_real());
+    }
+
+    auto verifier = libzcash::ProofVerifier::Strict();
+    for (const JSDescription& jsdesc : mtx.vjoinsplit) {
+        if (!(jsdesc.Verify(*pzcashParams, verifier, joinSplitPubKey_))) {
+            throw std::runtime_error("error verifying joinsplit");
+        }
+    }
+
+    // Empty output script.
+    CScript scriptCode;
+    CTransaction signTx(mtx);
+    uint256 dataToBeSigned = SignatureHash(scriptCode, signTx, NOT_AN_INPUT, SIGHASH_ALL);
+
+    // Add the signature
+    if (!(crypto_sign_detached(&mtx.joinSplitSig[0], NULL,
+                               dataToBeSigned.begin(), 32,
+                               joinSplitPrivKey_) == 0)) {
+        throw std::runtime_error("crypto_sign_detached failed");
+    }
+
+    // Sanity check
+    if (!(crypto_sign_verify_detached(&mtx.joinSplitSig[0],
+                                      dataToBeSigned.begin(), 32,
+                                      mtx.joinSplitPubKey.begin()) == 0)) {
+        throw std::runtime_error("crypto_sign_verify_detached failed");
+    }
+
+    tx_ = CTransaction(mtx);
+    obj.pushKV("rawtxn", EncodeHexTx(tx_));
+    return obj;
+}
+
 /**
  * Sign and send a raw transaction.
  * Raw transaction as hex string should be in object field "rawtxn"
@@ -689,11 +742,12 @@ UniValue AsyncRPCOperation_mergetoaddress::perform_joinsplit(MergeToAddressJSInf
 
 UniValue AsyncRPCOperation_mergetoaddress::perform_joinsplit(MergeToAddressJSInfo& info, std::vector<JSOutPoint>& outPoints)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     std::vector<std::optional<ZCIncrementalWitness>> witnesses;
     uint256 anchor;
     {
         LOCK(cs_main);
-        pwalletMain->GetNoteWitnesses(outPoints, witnesses, anchor);
+        pwallet->GetNoteWitnesses(outPoints, witnesses, anchor);
     }
     return perform_joinsplit(info, witnesses, anchor);
 }
@@ -744,13 +798,14 @@ UniValue AsyncRPCOperation_mergetoaddress::perform_joinsplit(
              FormatMoney(info.vjsin[0].note.value()), FormatMoney(info.vjsin[1].note.value()),
              FormatMoney(info.vjsout[0].value), FormatMoney(info.vjsout[1].value));
 
-    // Generate the proof, this can take over a minute.
+    // The proof, which can take over a minute, is generated along with the ones of the other joinsplits
     std::array<libzcash::JSInput, ZC_NUM_JS_INPUTS> inputs{info.vjsin[0], info.vjsin[1]};
     std::array<libzcash::JSOutput, ZC_NUM_JS_OUTPUTS> outputs{info.vjsout[0], info.vjsout[1]};
     std::array<uint64_t, ZC_NUM_JS_INPUTS> inputMap;
     std::array<uint64_t, ZC_NUM_JS_OUTPUTS> outputMap;
 
     uint256 esk; // payment disclosure - secret
+    ZCJSProofWitness proofWitness;
 
     JSDescription jsdesc = JSDescription::Randomized(
         mtx.nVersion == GROTH_TX_VERSION,
@@ -763,36 +818,24 @@ UniValue AsyncRPCOperation_mergetoaddress::perform_joinsplit(
         outputMap,
         info.vpub_old,
         info.vpub_new,
-        !this->testmode,
-        &esk); // parameter expects pointer to esk, so pass in address
-    {
+        false,
+        &esk, // parameter expects pointer to esk, so pass in address
+        GetRandInt,
+        &proofWitness);
+
+    if (this->testmode) {
+        // No proof is generated, the joinsplit is verified as it is
         auto verifier = libzcash::ProofVerifier::Strict();
         if (!(jsdesc.Verify(*pzcashParams, verifier, joinSplitPubKey_))) {
             throw std::runtime_error("error verifying joinsplit");
         }
+    } else {
+        jsProofs_.Add(mtx.vjoinsplit.size(), proofWitness);
     }
 
     mtx.vjoinsplit.push_back(jsdesc);
 
-    // Empty output script.
-    CScript scriptCode;
-    CTransaction signTx(mtx);
-    uint256 dataToBeSigned = SignatureHash(scriptCode, signTx, NOT_AN_INPUT, SIGHASH_ALL);
-
-    // Add the signature
-    if (!(crypto_sign_detached(&mtx.joinSplitSig[0], NULL,
-                               dataToBeSigned.begin(), 32,
-                               joinSplitPrivKey_) == 0)) {
-        throw std::runtime_error("crypto_sign_detached failed");
-    }
-
-    // Sanity check
-    if (!(crypto_sign_verify_detached(&mtx.joinSplitSig[0],
-                                      dataToBeSigned.begin(), 32,
-                                      mtx.joinSplitPubKey.begin()) == 0)) {
-        throw std::runtime_error("crypto_sign_verify_detached failed");
-    }
-
+    // Signed by sign_joinsplits() once the proofs are set
     CTransaction rawTx(mtx);
     tx_ = rawTx;
 
@@ -895,6 +938,9 @@ UniValue AsyncRPCOperation_mergetoaddress::getStatus() const
     UniValue obj = v.get_obj();
     obj.pushKV("method", "z_mergetoaddress");
     obj.pushKV("params", contextinfo_);
+    if (!jsProofs_.IsEmpty()) {
+        obj.pushKV("joinsplitproofs", jsProofs_.GetTimings());
+    }
     return obj;
 }
 
@@ -902,9 +948,10 @@ UniValue AsyncRPCOperation_mergetoaddress::getStatus() const
  * Lock input utxos
  */
  void AsyncRPCOperation_mergetoaddress::lock_utxos() {
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    LOCK2(cs_main, pwallet->cs_wallet);
     for (auto utxo : utxoInputs_) {
-        pwalletMain->LockCoin(std::get<0>(utxo));
+        pwallet->LockCoin(std::get<0>(utxo));
     }
 }
 
@@ -912,9 +959,10 @@ UniValue AsyncRPCOperation_mergetoaddress::getStatus() const
  * Unlock input utxos
  */
 void AsyncRPCOperation_mergetoaddress::unlock_utxos() {
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    LOCK2(cs_main, pwallet->cs_wallet);
     for (auto utxo : utxoInputs_) {
-        pwalletMain->UnlockCoin(std::get<0>(utxo));
+        pwallet->UnlockCoin(std::get<0>(utxo));
     }
 }
 
@@ -923,9 +971,10 @@ void AsyncRPCOperation_mergetoaddress::unlock_utxos() {
  * Lock input notes
  */
  void AsyncRPCOperation_mergetoaddress::lock_notes() {
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    LOCK2(cs_main, pwallet->cs_wallet);
     for (auto note : noteInputs_) {
-        pwalletMain->LockNote(std::get<0>(note));
+        pwallet->LockNote(std::get<0>(note));
     }
 }
 
@@ -933,8 +982,9 @@ void AsyncRPCOperation_mergetoaddress::unlock_utxos() {
  * Unlock input notes
  */
 void AsyncRPCOperation_mergetoaddress::unlock_notes() {
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    LOCK2(cs_main, pwallet->cs_wallet);
     for (auto note : noteInputs_) {
-        pwalletMain->UnlockNote(std::get<0>(note));
+        pwallet->UnlockNote(std::get<0>(note));
     }
 }
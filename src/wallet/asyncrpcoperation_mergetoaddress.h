@@ -6,6 +6,7 @@
 #define ASYNCRPCOPERATION_MERGETOADDRESS_H
 
 #include "amount.h"
+#include "asyncjoinsplitproofs.h"
 #include "asyncrpcoperation.h"
 #include "base58.h"
 #include "paymentdisclosure.h"
@@ -115,6 +116,9 @@ private:
         std::vector<std::optional<ZCIncrementalWitness>> witnesses,
         uint256 anchor);
 
+    // Sets the proofs of the joinsplits created and signs them
+    UniValue sign_joinsplits(UniValue obj);
+
     void sign_send_raw_transaction(const UniValue& obj); // throws exception if there was an error
 
     void lock_utxos();
@@ -127,6 +131,9 @@ private:
 
     // payment disclosure!
     std::vector<PaymentDisclosureKeyInfo> paymentDisclosureData_;
+
+    // The proofs of the joinsplits of tx_ being generated
+    CAsyncJoinSplitProofs jsProofs_;
 };
 
 
@@ -59,6 +59,7 @@ AsyncRPCOperation_sendmany::AsyncRPCOperation_sendmany(
         bool sendChangeToSource) :
         tx_(contextualTx), fromaddress_(fromAddress), t_outputs_(tOutputs), z_outputs_(zOutputs), mindepth_(minDepth), fee_(fee), contextinfo_(contextInfo), sendChangeToSource_(sendChangeToSource)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     assert(fee_ >= 0);
 
     if (minDepth < 0) {
@@ -84,7 +85,7 @@ AsyncRPCOperation_sendmany::AsyncRPCOperation_sendmany(
 
             // We don't need to lock on the wallet as spending key related methods are thread-safe
             SpendingKey key;
-            if (!pwalletMain->GetSpendingKey(addr, key)) {
+            if (!pwallet->GetSpendingKey(addr, key)) {
                 throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid from address, no spending key found for zaddr");
             }
 
@@ -116,6 +117,9 @@ AsyncRPCOperation_sendmany::~AsyncRPCOperation_sendmany() {
 }
 
 void AsyncRPCOperation_sendmany::main() {
+    // the calls made for the operation are for the wallet of the request which created it
+    CRPCRequestURIScope requestScope(getRequestURI());
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (isCancelled())
         return;
 
@@ -180,15 +184,15 @@ void AsyncRPCOperation_sendmany::main() {
     // !!! Payment disclosure START
     if (success && paymentDisclosureMode && paymentDisclosureData_.size()>0) {
         uint256 txidhash = tx_.GetHash();
-        std::shared_ptr<PaymentDisclosureDB> db = PaymentDisclosureDB::sharedInstance();
+        std::vector<PaymentDisclosureKeyInfo> entries;
+        entries.reserve(paymentDisclosureData_.size());
         for (PaymentDisclosureKeyInfo p : paymentDisclosureData_) {
             p.first.hash = txidhash;
-            if (!db->Put(p.first, p.second)) {
-                LogPrint("paymentdisclosure", "%s: Payment Disclosure: Error writing entry to database for key %s\n", getId(), p.first.ToString());
-            } else {
-                LogPrint("paymentdisclosure", "%s: Payment Disclosure: Successfully added entry to database for key %s\n", getId(), p.first.ToString());
-            }
+            entries.push_back(p);
         }
+        // written in the background, in one batch
+        PaymentDisclosureDB::sharedInstance()->PutBatchAsync(entries);
+        LogPrint("paymentdisclosure", "%s: Payment Disclosure: Queued %u entries to the database for tx %s\n", getId(), entries.size(), txidhash.ToString());
     }
     // !!! Payment disclosure END
 }
@@ -198,6 +202,7 @@ void AsyncRPCOperation_sendmany::main() {
 // 2. #1360 Note selection is not optimal
 // 3. #1277 Spendable notes are not locked, so an operation running in parallel could also try to use them
 bool AsyncRPCOperation_sendmany::main_impl() {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
 
     assert(isfromtaddr_ != isfromzaddr_);
 
@@ -394,13 +399,13 @@ bool AsyncRPCOperation_sendmany::main_impl() {
     // change upon arrival of new blocks which contain joinsplit transactions.  This is likely
     // to happen as creating a chained joinsplit transaction can take longer than the block interval.
     if (z_inputs_.size() > 0) {
-        LOCK2(cs_main, pwalletMain->cs_wallet);
+        LOCK2(cs_main, pwallet->cs_wallet);
         for (auto t : z_inputs_) {
             JSOutPoint jso = std::get<0>(t);
             std::vector<JSOutPoint> vOutPoints = { jso };
             uint256 inputAnchor;
             std::vector<std::optional<ZCIncrementalWitness>> vInputWitnesses;
-            pwalletMain->GetNoteWitnesses(vOutPoints, vInputWitnesses, inputAnchor);
+            pwallet->GetNoteWitnesses(vOutPoints, vInputWitnesses, inputAnchor);
             jsopWitnessAnchorMap[ jso.ToString() ] = WitnessAnchorData{ vInputWitnesses[0], inputAnchor };
         }
     }
@@ -466,6 +471,7 @@ bool AsyncRPCOperation_sendmany::main_impl() {
             }
             obj = perform_joinsplit(info);
         }
+        obj = sign_joinsplits(obj);
         sign_send_raw_transaction(obj);
         return true;
     }
@@ -525,7 +531,7 @@ bool AsyncRPCOperation_sendmany::main_impl() {
         // Consume change as the first input of the JoinSplit.
         //
         if (jsChange > 0) {
-            LOCK2(cs_main, pwalletMain->cs_wallet);
+            LOCK2(cs_main, pwallet->cs_wallet);
 
             // Update tree state with previous joinsplit
             ZCIncrementalMerkleTree tree;
@@ -612,8 +618,8 @@ bool AsyncRPCOperation_sendmany::main_impl() {
             int wtxHeight = -1;
             int wtxDepth = -1;
             {
-                LOCK2(cs_main, pwalletMain->cs_wallet);
-                const CWalletTransactionBase& wtx = *(pwalletMain->getMapWallet().at(jso.hash));
+                LOCK2(cs_main, pwallet->cs_wallet);
+                const CWalletTransactionBase& wtx = *(pwallet->getMapWallet().at(jso.hash));
                 // Zero confirmaton notes belong to transactions which have not yet been mined
                 if (mapBlockIndex.find(wtx.hashBlock) == mapBlockIndex.end()) {
                     throw JSONRPCError(RPC_WALLET_ERROR, strprintf("mapBlockIndex does not contain block hash %s", wtx.hashBlock.ToString()));
@@ -743,6 +749,7 @@ bool AsyncRPCOperation_sendmany::main_impl() {
     assert(zOutputsDeque.size() == 0);
     assert(vpubNewProcessed);
 
+    obj = sign_joinsplits(obj);
     sign_send_raw_transaction(obj);
     return true;
 }
@@ -816,12 +823,13 @@ void AsyncRPCOperation_sendmany::sign_send_raw_transaction(UniValue obj)
 
 
 bool AsyncRPCOperation_sendmany::find_utxos(bool fAcceptCoinbase=false) {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     set<CBitcoinAddress> setAddress = {fromtaddr_};
     vector<COutput> vecOutputs;
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
-    pwalletMain->AvailableCoins(vecOutputs, false, NULL, true, fAcceptCoinbase, fAcceptCoinbase);
+    pwallet->AvailableCoins(vecOutputs, false, NULL, true, fAcceptCoinbase, fAcceptCoinbase);
 
     BOOST_FOREACH(const COutput& out, vecOutputs) {
         if (!out.fSpendable) {
@@ -864,10 +872,11 @@ bool AsyncRPCOperation_sendmany::find_utxos(bool fAcceptCoinbase=false) {
 
 
 bool AsyncRPCOperation_sendmany::find_unspent_notes() {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     std::vector<CNotePlaintextEntry> entries;
     {
-        LOCK2(cs_main, pwalletMain->cs_wallet);
-        pwalletMain->GetFilteredNotes(entries, fromaddress_, mindepth_);
+        LOCK2(cs_main, pwallet->cs_wallet);
+        pwallet->GetFilteredNotes(entries, fromaddress_, mindepth_);
     }
 
     for (CNotePlaintextEntry & entry : entries) {
@@ -907,11 +916,12 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(AsyncJoinSplitInfo & info
 
 
 UniValue AsyncRPCOperation_sendmany::perform_joinsplit(AsyncJoinSplitInfo & info, std::vector<JSOutPoint> & outPoints) {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     std::vector<std::optional < ZCIncrementalWitness>> witnesses;
     uint256 anchor;
     {
         LOCK(cs_main);
-        pwalletMain->GetNoteWitnesses(outPoints, witnesses, anchor);
+        pwallet->GetNoteWitnesses(outPoints, witnesses, anchor);
     }
     return perform_joinsplit(info, witnesses, anchor);
 }
@@ -959,7 +969,7 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
             FormatMoney(info.vjsout[0].value), FormatMoney(info.vjsout[1].value)
             );
 
-    // Generate the proof, this can take over a minute.
+    // The proof, which can take over a minute, is generated along with the ones of the other joinsplits
     std::array<libzcash::JSInput, ZC_NUM_JS_INPUTS> inputs
             {info.vjsin[0], info.vjsin[1]};
     std::array<libzcash::JSOutput, ZC_NUM_JS_OUTPUTS> outputs
@@ -973,6 +983,7 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
         #endif
 
     uint256 esk; // payment disclosure - secret
+    ZCJSProofWitness proofWitness;
 
     JSDescription jsdesc = JSDescription::Randomized(
             mtx.nVersion == GROTH_TX_VERSION,
@@ -985,40 +996,24 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
             outputMap,
             info.vpub_old,
             info.vpub_new,
-            !this->testmode,
-            &esk); // parameter expects pointer to esk, so pass in address
-    {
+            false,
+            &esk, // parameter expects pointer to esk, so pass in address
+            GetRandInt,
+            &proofWitness);
+
+    if (this->testmode) {
+        // No proof is generated, the joinsplit is verified as it is
         auto verifier = libzcash::ProofVerifier::Strict();
         if (!(jsdesc.Verify(*pzcashParams, verifier, joinSplitPubKey_))) {
             throw std::runtime_error("error verifying joinsplit");
         }
+    } else {
+        jsProofs_.Add(mtx.vjoinsplit.size(), proofWitness);
     }
 
     mtx.vjoinsplit.push_back(jsdesc);
 
-    // Empty output script.
-    CScript scriptCode;
-    CTransaction signTx(mtx);
-    uint256 dataToBeSigned = SignatureHash(scriptCode, signTx, NOT_AN_INPUT, SIGHASH_ALL);
-
-    // Add the signature
-    if (!(crypto_sign_detached(&mtx.joinSplitSig[0], NULL,
-            dataToBeSigned.begin(), 32,
-            joinSplitPrivKey_
-            ) == 0))
-    {
-        throw std::runtime_error("crypto_sign_detached failed");
-    }
-
-    // Sanity check
-    if (!(crypto_sign_verify_detached(&mtx.joinSplitSig[0],
-            dataToBeSigned.begin(), 32,
-            mtx.joinSplitPubKey.begin()
-            ) == 0))
-    {
-        throw std::runtime_error("crypto_sign_verify_detached failed");
-    }
-
+    // Signed by sign_joinsplits() once the proofs are set
     CTransaction rawTx(mtx);
     tx_ = rawTx;
 
@@ -1086,6 +1081,57 @@ UniValue AsyncRPCOperation_sendmany::perform_joinsplit(
     return obj;
 }
 
+/**
+ * Set the proofs of the joinsplits once they are all generated, then verify the joinsplits and sign
+ * them, since the signature covers the proofs.
+ * Returns the object of the last joinsplit with the raw transaction signed.
+ */
+UniValue AsyncRPCOperation_sendmany::sign_joinsplits(UniValue obj)
+{
+    CMutableTransaction mtx(tx_);
+    jsProofs_.SetProofs(mtx);
+
+    UniValue timings = jsProofs_.GetTimings();
+    if (timings.exists("wallseconds")) {
+        LogPrint("zrpc", "%s: generated %d joinsplit proofs in %.3fs\n",
+                getId(), timings["count"].get_int(), timings["wallseconds"].get_real());
+    }
+
+    auto verifier = libzcash::ProofVerifier::Strict();
+    for (const JSDescription& jsdesc : mtx.vjoinsplit) {
+        if (!(jsdesc.Verify(*pzcashParams, verifier, joinSplitPubKey_))) {
+            throw std::runtime_error("error verifying joinsplit");
+        }
+    }
+
+    // Empty output script.
+    CScript scriptCode;
+    CTransaction signTx(mtx);
+    uint256 dataToBeSigned = SignatureHash(scriptCode, signTx, NOT_AN_INPUT, SIGHASH_ALL);
+
+    // Add the signature
+    if (!(crypto_sign_detached(&mtx.joinSplitSig[0], NULL,
+            dataToBeSigned.begin(), 32,
+            joinSplitPrivKey_
+            ) == 0))
+    {
+        throw std::runtime_error("crypto_sign_detached failed");
+    }
+
+    // Sanity check
+    if (!(crypto_sign_verify_detached(&mtx.joinSplitSig[0],
+            dataToBeSigned.begin(), 32,
+            mtx.joinSplitPubKey.begin()
+            ) == 0))
+    {
+        throw std::runtime_error("crypto_sign_verify_detached failed");
+    }
+
+    tx_ = CTransaction(mtx);
+    obj.pushKV("rawtxn", EncodeHexTx(tx_));
+    return obj;
+}
+
 void AsyncRPCOperation_sendmany::add_taddr_outputs_to_tx() {
 
     CMutableTransaction rawTx(tx_);
@@ -1107,8 +1153,9 @@ void AsyncRPCOperation_sendmany::add_taddr_outputs_to_tx() {
 }
 
 void AsyncRPCOperation_sendmany::add_taddr_change_output_to_tx(CAmount amount, bool sendChangeToSource) {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
     CTxOut out;
@@ -1117,7 +1164,7 @@ void AsyncRPCOperation_sendmany::add_taddr_change_output_to_tx(CAmount amount, b
         out = CTxOut(amount, scriptPubKey);
     }
     else {
-        CReserveKey keyChange(pwalletMain);
+        CReserveKey keyChange(pwallet);
         CPubKey vchPubKey;
         bool ret = keyChange.GetReservedKey(vchPubKey);
         if (!ret) {
@@ -1167,6 +1214,9 @@ UniValue AsyncRPCOperation_sendmany::getStatus() const {
     UniValue obj = v.get_obj();
     obj.pushKV("method", "z_sendmany");
     obj.pushKV("params", contextinfo_ );
+    if (!jsProofs_.IsEmpty()) {
+        obj.pushKV("joinsplitproofs", jsProofs_.GetTimings());
+    }
     return obj;
 }
 
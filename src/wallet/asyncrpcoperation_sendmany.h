@@ -7,6 +7,7 @@
 
 #include "asyncrpcoperation.h"
 #include "amount.h"
+#include "asyncjoinsplitproofs.h"
 #include "base58.h"
 #include "primitives/transaction.h"
 #include "zcash/JoinSplit.hpp"
@@ -64,6 +65,11 @@ public:
 
     virtual UniValue getStatus() const;
 
+    // A payment is waited for, it goes before the sweeps of z_shieldcoinbase and z_mergetoaddress
+    virtual int getPriority() const {
+        return 1;
+    }
+
     bool testmode = false;  // Set to true to disable sending txs and generating proofs
 
     bool paymentDisclosureMode = false; // Set to true to save esk for encrypted notes in payment disclosure database.
@@ -115,10 +121,16 @@ private:
         std::vector<std::optional < ZCIncrementalWitness>> witnesses,
         uint256 anchor);
 
+    // Sets the proofs of the joinsplits created and signs them
+    UniValue sign_joinsplits(UniValue obj);
+
     void sign_send_raw_transaction(UniValue obj);     // throws exception if there was an error
 
     // payment disclosure!
     std::vector<PaymentDisclosureKeyInfo> paymentDisclosureData_;
+
+    // The proofs of the joinsplits of tx_ being generated
+    CAsyncJoinSplitProofs jsProofs_;
 };
 
 
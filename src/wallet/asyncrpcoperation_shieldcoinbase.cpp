@@ -88,6 +88,9 @@ AsyncRPCOperation_shieldcoinbase::~AsyncRPCOperation_shieldcoinbase() {
 }
 
 void AsyncRPCOperation_shieldcoinbase::main() {
+    // the calls made for the operation are for the wallet of the request which created it
+    CRPCRequestURIScope requestScope(getRequestURI());
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (isCancelled()) {
         unlock_utxos(); // clean up
         return;
@@ -432,10 +435,11 @@ UniValue AsyncRPCOperation_shieldcoinbase::getStatus() const {
  * Lock input utxos
  */
  void AsyncRPCOperation_shieldcoinbase::lock_utxos() {
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    LOCK2(cs_main, pwallet->cs_wallet);
     for (auto utxo : inputs_) {
         COutPoint outpt(utxo.txid, utxo.vout);
-        pwalletMain->LockCoin(outpt);
+        pwallet->LockCoin(outpt);
     }
 }
 
@@ -443,9 +447,10 @@ UniValue AsyncRPCOperation_shieldcoinbase::getStatus() const {
  * Unlock input utxos
  */
 void AsyncRPCOperation_shieldcoinbase::unlock_utxos() {
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    LOCK2(cs_main, pwallet->cs_wallet);
     for (auto utxo : inputs_) {
         COutPoint outpt(utxo.txid, utxo.vout);
-        pwalletMain->UnlockCoin(outpt);
+        pwallet->UnlockCoin(outpt);
     }
 }
@@ -424,6 +424,29 @@ TEST_F(WalletTest, FindMyNotes) {
     EXPECT_EQ(nd, noteMap[jsoutpt]);
 }
 
+TEST_F(WalletTest, FindMyNotesWithDecryptors) {
+    CWallet wallet;
+
+    auto sk = libzcash::SpendingKey::random();
+    wallet.AddSpendingKey(sk);
+
+    auto wtx = GetValidReceive(sk, 10, true);
+    auto note = GetNote(sk, wtx.getWrappedTx(), 0, 1);
+
+    // Only the decryptors given are tried, as by the rescan threads
+    NoteDecryptorMap decryptors;
+    EXPECT_EQ(0, wallet.FindMyNotes(wtx.getWrappedTx(), decryptors).size());
+
+    decryptors.insert(std::make_pair(sk.address(), ZCNoteDecryption(sk.receiving_key())));
+    auto noteMap = wallet.FindMyNotes(wtx.getWrappedTx(), decryptors);
+    EXPECT_EQ(2, noteMap.size());
+    EXPECT_EQ(noteMap, wallet.FindMyNotes(wtx.getWrappedTx()));
+
+    JSOutPoint jsoutpt {wtx.getWrappedTx().GetHash(), 0, 1};
+    CNoteData nd {sk.address(), note.nullifier(sk)};
+    EXPECT_EQ(nd, noteMap[jsoutpt]);
+}
+
 TEST_F(WalletTest, FindMyNotesInEncryptedWallet) {
     TestWallet wallet;
     uint256 r {GetRandHash()};
@@ -855,6 +878,83 @@ TEST_F(WalletTest, CachedWitnessesCleanIndex) {
     }
 }
 
+TEST_F(WalletTest, SpentNotesAreNoLongerWitnessed) {
+    TestWallet wallet;
+
+    auto sk = libzcash::SpendingKey::random();
+    wallet.AddSpendingKey(sk);
+
+    auto wtx = GetValidReceive(sk, 10, true);
+    auto hash = wtx.getWrappedTx().GetHash();
+    auto note = GetNote(sk, wtx.getWrappedTx(), 0, 0);
+    auto note2 = GetNote(sk, wtx.getWrappedTx(), 0, 1);
+
+    mapNoteData_t noteData;
+    JSOutPoint jsoutpt {hash, 0, 0};
+    JSOutPoint jsoutpt2 {hash, 0, 1};
+    noteData[jsoutpt] = CNoteData {sk.address(), note.nullifier(sk)};
+    noteData[jsoutpt2] = CNoteData {sk.address(), note2.nullifier(sk)};
+    wtx.SetNoteData(noteData);
+    wallet.AddToWallet(wtx, true, NULL);
+    EXPECT_EQ(2, wallet.setWitnessedNotes.size());
+
+    CBlock block1;
+    block1.vtx.push_back(wtx.getWrappedTx());
+    CBlockIndex index1(block1);
+    index1.nHeight = 1;
+    ZCIncrementalMerkleTree tree;
+    wallet.IncrementNoteWitnesses(&index1, &block1, tree);
+
+    std::vector<JSOutPoint> notes {jsoutpt, jsoutpt2};
+    std::vector<std::optional<ZCIncrementalWitness>> witnesses;
+    uint256 anchor;
+    wallet.GetNoteWitnesses(notes, witnesses, anchor);
+    EXPECT_TRUE((bool) witnesses[0]);
+    EXPECT_TRUE((bool) witnesses[1]);
+
+    // Fake-mine a spend of the second note, as deep as the witness cache
+    auto wtx2 = GetValidSpend(sk, note2, 5);
+    CBlock block2;
+    block2.vtx.push_back(wtx2.getWrappedTx());
+    block2.hashMerkleRoot = block2.BuildMerkleTree();
+    auto blockHash = block2.GetHash();
+    CBlockIndex index2(block2);
+    index2.nHeight = 2;
+    mapBlockIndex.insert(std::make_pair(blockHash, &index2));
+    std::vector<CBlockIndex> descendants(WITNESS_CACHE_SIZE - 1);
+    for (size_t i = 0; i < descendants.size(); i++) {
+        descendants[i].pprev = i ? &descendants[i - 1] : &index2;
+        descendants[i].nHeight = descendants[i].pprev->nHeight + 1;
+    }
+    chainActive.SetTip(&descendants.back());
+
+    wtx2.SetMerkleBranch(block2);
+    wallet.AddToWallet(wtx2, true, NULL);
+    EXPECT_TRUE(wallet.IsSpent(note2.nullifier(sk)));
+    EXPECT_EQ(WITNESS_CACHE_SIZE, wallet.getMapWallet().at(wtx2.getWrappedTx().GetHash())->GetDepthInMainChain());
+
+    // Only the unspent note is witnessed after the spending block
+    wallet.IncrementNoteWitnesses(&index2, &block2, tree);
+    witnesses.clear();
+    wallet.GetNoteWitnesses(notes, witnesses, anchor);
+    EXPECT_TRUE((bool) witnesses[0]);
+    EXPECT_FALSE((bool) witnesses[1]);
+    EXPECT_EQ(1, wallet.setWitnessedNotes.size());
+    EXPECT_EQ(1, wallet.setWitnessedNotes.count(jsoutpt));
+    EXPECT_EQ(1, wallet.setPrunedWitnessTxs.count(hash));
+
+    // and the spent one is not touched by the blocks that follow
+    CBlock block3;
+    wallet.IncrementNoteWitnesses(&descendants[0], &block3, tree);
+    EXPECT_EQ(3, wallet.getMapWallet().at(hash)->mapNoteData.at(jsoutpt).witnessHeight);
+    EXPECT_EQ(-1, wallet.getMapWallet().at(hash)->mapNoteData.at(jsoutpt2).witnessHeight);
+    EXPECT_TRUE(wallet.getMapWallet().at(hash)->mapNoteData.at(jsoutpt2).witnesses.empty());
+
+    // Tear down
+    chainActive.SetTip(NULL);
+    mapBlockIndex.erase(blockHash);
+}
+
 TEST_F(WalletTest, ClearNoteWitnessCache) {
     TestWallet wallet;
 
@@ -1102,6 +1202,60 @@ TEST_F(WalletTest, MarkAffectedTransactionsDirty) {
     EXPECT_FALSE(wallet.getMapWallet().at(hash)->GetfDebitCached());
 }
 
+TEST_F(WalletTest, AvailableCoinsFollowTheSpends) {
+    TestWallet wallet;
+
+    CKey key;
+    key.MakeNewKey(true);
+    wallet.AddKeyPubKey(key, key.GetPubKey());
+    CScript scriptMine = GetScriptForDestination(key.GetPubKey().GetID(), false);
+    CScript scriptOther = GetScriptForDestination(CKeyID(uint160(ParseHex("0102030405060708090a0b0c0d0e0f1011121314"))), false);
+
+    CMutableTransaction mtx;
+    mtx.nVersion = TRANSPARENT_TX_VERSION;
+    mtx.vin.push_back(CTxIn(COutPoint(GetRandHash(), 0)));
+    mtx.addOut(CTxOut(10, scriptMine));
+    mtx.addOut(CTxOut(20, scriptOther));
+    mtx.addOut(CTxOut(30, scriptMine));
+    CTransaction tx(mtx);
+
+    CMutableTransaction mspend;
+    mspend.nVersion = TRANSPARENT_TX_VERSION;
+    mspend.vin.push_back(CTxIn(COutPoint(tx.GetHash(), 0)));
+    mspend.vin.push_back(CTxIn(COutPoint(tx.GetHash(), 2)));
+    mspend.addOut(CTxOut(35, scriptOther));
+    CTransaction spend(mspend);
+
+    // both unconfirmed, they count only while in the mempool
+    mempool.addUnchecked(tx.GetHash(), CTxMemPoolEntry(tx, 0, 0, 0.0, 0), false);
+    wallet.AddToWallet(CWalletTx(&wallet, tx), true, NULL);
+
+    std::vector<COutput> vCoins;
+    wallet.AvailableCoins(vCoins, false);
+    ASSERT_EQ(2, vCoins.size());
+    EXPECT_EQ(0, vCoins[0].pos);
+    EXPECT_EQ(2, vCoins[1].pos);
+
+    mempool.addUnchecked(spend.GetHash(), CTxMemPoolEntry(spend, 5, 0, 0.0, 0), false);
+    wallet.AddToWallet(CWalletTx(&wallet, spend), true, NULL);
+    wallet.AvailableCoins(vCoins, false);
+    EXPECT_EQ(0, vCoins.size());
+    // a second time, once the spent transaction no longer needs to be looked at
+    wallet.AvailableCoins(vCoins, false);
+    EXPECT_EQ(0, vCoins.size());
+
+    // the spend is dropped, e.g. by a conflict: the outputs are available again
+    std::list<CTransaction> removedTxs;
+    std::list<CScCertificate> removedCerts;
+    mempool.remove(spend, removedTxs, removedCerts, false);
+    wallet.MarkAffectedTransactionsDirty(spend);
+    wallet.AvailableCoins(vCoins, false);
+    EXPECT_EQ(2, vCoins.size());
+
+    // Tear down
+    mempool.remove(tx, removedTxs, removedCerts, false);
+}
+
 TEST_F(WalletTest, SetBestChainIgnoresTxsWithoutShieldedData) {
     SelectParams(CBaseChainParams::REGTEST);
 
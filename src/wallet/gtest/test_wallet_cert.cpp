@@ -890,6 +890,42 @@ TEST_F(SidechainsCertInWalletTestSuite, GetImmatureCredit_CoinBase)
     }
 }
 
+// The credits stay cached while the outputs are immature, until the tip crosses the maturity height in either direction
+TEST_F(SidechainsCertInWalletTestSuite, GetAvailableCredit_CoinBase_CachedUntilMaturity)
+{
+    CAmount coinBaseAmount = 10;
+    CTransaction coinBase = txCreationUtils::createCoinBase(coinBaseAmount);
+    SetLockingScriptFor(coinBase);
+
+    chainSettingUtils::ExtendChainActiveToHeight(/*startHeight*/100);
+    CWalletTx walletCoinBase(pWallet, coinBase);
+    CBlock coinBaseBlock;
+    coinBaseBlock.vtx.push_back(coinBase);
+    walletCoinBase.hashBlock = coinBaseBlock.GetHash();
+    walletCoinBase.SetMerkleBranch(coinBaseBlock);
+    walletCoinBase.fMerkleVerified = true; //shortcut
+
+    chainSettingUtils::ExtendChainActiveWithBlock(coinBaseBlock);
+    int coinBaseCreationHeight = chainActive.Height();
+    EXPECT_TRUE(walletCoinBase.GetMaturityHeight() == coinBaseCreationHeight + COINBASE_MATURITY);
+
+    for(int height = coinBaseCreationHeight; height < coinBaseCreationHeight + COINBASE_MATURITY; ++height)
+    {
+        chainSettingUtils::ExtendChainActiveToHeight(height);
+        EXPECT_TRUE(CAmount(0) == walletCoinBase.GetAvailableCredit(/*fUseCache*/true)) <<"at height "<< height;
+        EXPECT_TRUE(coinBaseAmount == walletCoinBase.GetImmatureCredit(/*fUseCache*/true)) <<"at height "<< height;
+    }
+
+    chainSettingUtils::ExtendChainActiveToHeight(coinBaseCreationHeight + COINBASE_MATURITY);
+    EXPECT_TRUE(coinBaseAmount == walletCoinBase.GetAvailableCredit(/*fUseCache*/true));
+    EXPECT_TRUE(CAmount(0) == walletCoinBase.GetImmatureCredit(/*fUseCache*/true));
+
+    // a reorg taking the tip back below the maturity height
+    chainSettingUtils::ExtendChainActiveToHeight(coinBaseCreationHeight + COINBASE_MATURITY - 1);
+    EXPECT_TRUE(CAmount(0) == walletCoinBase.GetAvailableCredit(/*fUseCache*/true));
+    EXPECT_TRUE(coinBaseAmount == walletCoinBase.GetImmatureCredit(/*fUseCache*/true));
+}
+
 TEST_F(SidechainsCertInWalletTestSuite, GetImmatureCredit_FullCertificate_NotVoided)
 {
     //Create certificate
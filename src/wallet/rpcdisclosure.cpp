@@ -38,6 +38,7 @@ bool EnsureWalletIsAvailable(bool avoidException);
  */
 UniValue z_getpaymentdisclosure(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -72,7 +73,7 @@ UniValue z_getpaymentdisclosure(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_WALLET_ERROR, "Error: payment disclosure is disabled.");
     }
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
@@ -95,11 +96,11 @@ UniValue z_getpaymentdisclosure(const UniValue& params, bool fHelp)
     }
 
     // Check is mine
-    if (!pwalletMain->getMapWallet().count(hash)) {
+    if (!pwallet->getMapWallet().count(hash)) {
         throw JSONRPCError(RPC_MISC_ERROR, "Transaction does not belong to the wallet");
     }
 
-    const CWalletTransactionBase& wtx = *(pwalletMain->getMapWallet().at(hash));
+    const CWalletTransactionBase& wtx = *(pwallet->getMapWallet().at(hash));
 
     // Check if shielded tx
     if (wtx.getTxBase()->GetVjoinsplit().size() == 0) {
@@ -152,6 +153,7 @@ UniValue z_getpaymentdisclosure(const UniValue& params, bool fHelp)
  */
 UniValue z_validatepaymentdisclosure(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -197,7 +199,7 @@ UniValue z_validatepaymentdisclosure(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_WALLET_ERROR, "Error: payment disclosure is disabled.");
     }
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
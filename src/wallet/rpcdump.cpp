@@ -75,6 +75,7 @@ std::string DecodeDumpString(const std::string &str) {
 
 UniValue importprivkey(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -103,7 +104,7 @@ UniValue importprivkey(const UniValue& params, bool fHelp)
             + HelpExampleRpc("importprivkey", "\"mykey\", \"testing\", false")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
@@ -129,24 +130,24 @@ UniValue importprivkey(const UniValue& params, bool fHelp)
     assert(key.VerifyPubKey(pubkey));
     CKeyID vchAddress = pubkey.GetID();
     {
-        pwalletMain->MarkDirty();
-        pwalletMain->SetAddressBook(vchAddress, strLabel, "receive");
+        pwallet->MarkDirty();
+        pwallet->SetAddressBook(vchAddress, strLabel, "receive");
 
         // Don't throw error in case a key is already there
-        if (pwalletMain->HaveKey(vchAddress)) {
+        if (pwallet->HaveKey(vchAddress)) {
             return CBitcoinAddress(vchAddress).ToString();
         }
 
-        pwalletMain->mapKeyMetadata[vchAddress].nCreateTime = 1;
+        pwallet->mapKeyMetadata[vchAddress].nCreateTime = 1;
 
-        if (!pwalletMain->AddKeyPubKey(key, pubkey))
+        if (!pwallet->AddKeyPubKey(key, pubkey))
             throw JSONRPCError(RPC_WALLET_ERROR, "Error adding key to wallet");
 
         // whenever a key is imported, we need to scan the whole chain
-        pwalletMain->nTimeFirstKey = 1; // 0 would be considered 'no value'
+        pwallet->nTimeFirstKey = 1; // 0 would be considered 'no value'
 
         if (fRescan) {
-            pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
+            pwallet->ScanForWalletTransactions(chainActive.Genesis(), true);
         }
     }
 
@@ -155,6 +156,7 @@ UniValue importprivkey(const UniValue& params, bool fHelp)
 
 UniValue importaddress(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -181,7 +183,7 @@ UniValue importaddress(const UniValue& params, bool fHelp)
             + HelpExampleRpc("importaddress", "\"myaddress\", \"testing\", false")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     CScript script;
 
@@ -205,26 +207,26 @@ UniValue importaddress(const UniValue& params, bool fHelp)
         fRescan = params[2].get_bool();
 
     {
-        if (::IsMine(*pwalletMain, script) == ISMINE_SPENDABLE)
+        if (::IsMine(*pwallet, script) == ISMINE_SPENDABLE)
             throw JSONRPCError(RPC_WALLET_ERROR, "The wallet already contains the private key for this address or script");
 
         // add to address book or update label
         if (address.IsValid())
-            pwalletMain->SetAddressBook(address.Get(), strLabel, "receive");
+            pwallet->SetAddressBook(address.Get(), strLabel, "receive");
 
         // Don't throw error in case an address is already there
-        if (pwalletMain->HaveWatchOnly(script))
+        if (pwallet->HaveWatchOnly(script))
             return NullUniValue;
 
-        pwalletMain->MarkDirty();
+        pwallet->MarkDirty();
 
-        if (!pwalletMain->AddWatchOnly(script))
+        if (!pwallet->AddWatchOnly(script))
             throw JSONRPCError(RPC_WALLET_ERROR, "Error adding address to wallet");
 
         if (fRescan)
         {
-            pwalletMain->ScanForWalletTransactions(chainActive.Genesis(), true);
-            pwalletMain->ReacceptWalletTransactions();
+            pwallet->ScanForWalletTransactions(chainActive.Genesis(), true);
+            pwallet->ReacceptWalletTransactions();
         }
     }
 
@@ -289,7 +291,8 @@ UniValue importwallet(const UniValue& params, bool fHelp)
 
 UniValue importwallet_impl(const UniValue& params, bool fHelp, bool fImportZKeys)
 {
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
@@ -305,9 +308,9 @@ UniValue importwallet_impl(const UniValue& params, bool fHelp, bool fImportZKeys
     int64_t nFilesize = std::max((int64_t)1, (int64_t)file.tellg());
     file.seekg(0, file.beg);
 
-    pwalletMain->ShowProgress(_("Importing..."), 0); // show progress dialog in GUI
+    pwallet->ShowProgress(_("Importing..."), 0); // show progress dialog in GUI
     while (file.good()) {
-        pwalletMain->ShowProgress("", std::max(1, std::min(99, (int)(((double)file.tellg() / (double)nFilesize) * 100))));
+        pwallet->ShowProgress("", std::max(1, std::min(99, (int)(((double)file.tellg() / (double)nFilesize) * 100))));
         std::string line;
         std::getline(file, line);
         if (line.empty() || line[0] == '#')
@@ -325,19 +328,19 @@ UniValue importwallet_impl(const UniValue& params, bool fHelp, bool fImportZKeys
                 CZCSpendingKey spendingkey(vstr[0]);
                 libzcash::SpendingKey key = spendingkey.Get();
                 libzcash::PaymentAddress addr = key.address();
-                if (pwalletMain->HaveSpendingKey(addr)) {
+                if (pwallet->HaveSpendingKey(addr)) {
                     LogPrint("zrpc", "Skipping import of zaddr %s (key already present)\n", CZCPaymentAddress(addr).ToString());
                     continue;
                 }
                 int64_t nTime = DecodeDumpTime(vstr[1]);
                 LogPrint("zrpc", "Importing zaddr %s...\n", CZCPaymentAddress(addr).ToString());
-                if (!pwalletMain->AddZKey(key)) {
+                if (!pwallet->AddZKey(key)) {
                     // Something went wrong
                     fGood = false;
                     continue;
                 }
                 // Successfully imported zaddr.  Now import the metadata.
-                pwalletMain->mapZKeyMetadata[addr].nCreateTime = nTime;
+                pwallet->mapZKeyMetadata[addr].nCreateTime = nTime;
                 continue;
             }
             catch (const std::runtime_error &e) {
@@ -355,7 +358,7 @@ UniValue importwallet_impl(const UniValue& params, bool fHelp, bool fImportZKeys
         CPubKey pubkey = key.GetPubKey();
         assert(key.VerifyPubKey(pubkey));
         CKeyID keyid = pubkey.GetID();
-        if (pwalletMain->HaveKey(keyid)) {
+        if (pwallet->HaveKey(keyid)) {
             LogPrintf("Skipping import of %s (key already present)\n", CBitcoinAddress(keyid).ToString());
             continue;
         }
@@ -375,28 +378,28 @@ UniValue importwallet_impl(const UniValue& params, bool fHelp, bool fImportZKeys
             }
         }
         LogPrintf("Importing %s...\n", CBitcoinAddress(keyid).ToString());
-        if (!pwalletMain->AddKeyPubKey(key, pubkey)) {
+        if (!pwallet->AddKeyPubKey(key, pubkey)) {
             fGood = false;
             continue;
         }
-        pwalletMain->mapKeyMetadata[keyid].nCreateTime = nTime;
+        pwallet->mapKeyMetadata[keyid].nCreateTime = nTime;
         if (fLabel)
-            pwalletMain->SetAddressBook(keyid, strLabel, "receive");
+            pwallet->SetAddressBook(keyid, strLabel, "receive");
         nTimeBegin = std::min(nTimeBegin, nTime);
     }
     file.close();
-    pwalletMain->ShowProgress("", 100); // hide progress dialog in GUI
+    pwallet->ShowProgress("", 100); // hide progress dialog in GUI
 
     CBlockIndex *pindex = chainActive.Tip();
     while (pindex && pindex->pprev && pindex->GetBlockTime() > nTimeBegin - TIMESTAMP_WINDOW)
         pindex = pindex->pprev;
 
-    if (!pwalletMain->nTimeFirstKey || nTimeBegin < pwalletMain->nTimeFirstKey)
-        pwalletMain->nTimeFirstKey = nTimeBegin;
+    if (!pwallet->nTimeFirstKey || nTimeBegin < pwallet->nTimeFirstKey)
+        pwallet->nTimeFirstKey = nTimeBegin;
 
     LogPrintf("Rescanning last %i blocks\n", chainActive.Height() - pindex->nHeight + 1);
-    pwalletMain->ScanForWalletTransactions(pindex, false);
-    pwalletMain->MarkDirty();
+    pwallet->ScanForWalletTransactions(pindex, false);
+    pwallet->MarkDirty();
 
     if (!fGood)
         throw JSONRPCError(RPC_WALLET_ERROR, "Error adding some keys to wallet");
@@ -406,6 +409,7 @@ UniValue importwallet_impl(const UniValue& params, bool fHelp, bool fImportZKeys
 
 UniValue dumpprivkey(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -427,7 +431,7 @@ UniValue dumpprivkey(const UniValue& params, bool fHelp)
             + HelpExampleRpc("dumpprivkey", "\"myaddress\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
@@ -439,7 +443,7 @@ UniValue dumpprivkey(const UniValue& params, bool fHelp)
     if (!address.GetKeyID(keyID))
         throw JSONRPCError(RPC_TYPE_ERROR, "Address does not refer to a key");
     CKey vchSecret;
-    if (!pwalletMain->GetKey(keyID, vchSecret))
+    if (!pwallet->GetKey(keyID, vchSecret))
         throw JSONRPCError(RPC_WALLET_ERROR, "Private key for address " + strAddress + " is not known");
     return CBitcoinSecret(vchSecret).ToString();
 }
@@ -496,7 +500,8 @@ UniValue dumpwallet(const UniValue& params, bool fHelp)
 
 UniValue dumpwallet_impl(const UniValue& params, bool fHelp, bool fDumpZKeys)
 {
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
@@ -527,8 +532,8 @@ UniValue dumpwallet_impl(const UniValue& params, bool fHelp, bool fDumpZKeys)
 
     std::map<CKeyID, int64_t> mapKeyBirth;
     std::set<CKeyID> setKeyPool;
-    pwalletMain->GetKeyBirthTimes(mapKeyBirth);
-    pwalletMain->GetAllReserveKeys(setKeyPool);
+    pwallet->GetKeyBirthTimes(mapKeyBirth);
+    pwallet->GetAllReserveKeys(setKeyPool);
 
     // sort time/key pairs
     std::vector<std::pair<int64_t, CKeyID> > vKeyBirth;
@@ -549,9 +554,9 @@ UniValue dumpwallet_impl(const UniValue& params, bool fHelp, bool fDumpZKeys)
         std::string strTime = EncodeDumpTime(it->first);
         std::string strAddr = CBitcoinAddress(keyid).ToString();
         CKey key;
-        if (pwalletMain->GetKey(keyid, key)) {
-            if (pwalletMain->mapAddressBook.count(keyid)) {
-                file << strprintf("%s %s label=%s # addr=%s\n", CBitcoinSecret(key).ToString(), strTime, EncodeDumpString(pwalletMain->mapAddressBook[keyid].name), strAddr);
+        if (pwallet->GetKey(keyid, key)) {
+            if (pwallet->mapAddressBook.count(keyid)) {
+                file << strprintf("%s %s label=%s # addr=%s\n", CBitcoinSecret(key).ToString(), strTime, EncodeDumpString(pwallet->mapAddressBook[keyid].name), strAddr);
             } else if (setKeyPool.count(keyid)) {
                 file << strprintf("%s %s reserve=1 # addr=%s\n", CBitcoinSecret(key).ToString(), strTime, strAddr);
             } else {
@@ -563,14 +568,14 @@ UniValue dumpwallet_impl(const UniValue& params, bool fHelp, bool fDumpZKeys)
 
     if (fDumpZKeys) {
         std::set<libzcash::PaymentAddress> addresses;
-        pwalletMain->GetPaymentAddresses(addresses);
+        pwallet->GetPaymentAddresses(addresses);
         file << "\n";
         file << "# Zkeys\n";
         file << "\n";
         for (auto addr : addresses ) {
             libzcash::SpendingKey key;
-            if (pwalletMain->GetSpendingKey(addr, key)) {
-                std::string strTime = EncodeDumpTime(pwalletMain->mapZKeyMetadata[addr].nCreateTime);
+            if (pwallet->GetSpendingKey(addr, key)) {
+                std::string strTime = EncodeDumpTime(pwallet->mapZKeyMetadata[addr].nCreateTime);
                 file << strprintf("%s %s # zaddr=%s\n", CZCSpendingKey(key).ToString(), strTime, CZCPaymentAddress(addr).ToString());
             }
         }
@@ -586,6 +591,7 @@ UniValue dumpwallet_impl(const UniValue& params, bool fHelp, bool fDumpZKeys)
 
 UniValue z_importkey(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -616,7 +622,7 @@ UniValue z_importkey(const UniValue& params, bool fHelp)
             + HelpExampleRpc("z_importkey", "\"zkey\", \"no\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
@@ -660,25 +666,25 @@ UniValue z_importkey(const UniValue& params, bool fHelp)
 
     {
         // Don't throw error in case a key is already there
-        if (pwalletMain->HaveSpendingKey(addr)) {
+        if (pwallet->HaveSpendingKey(addr)) {
             if (fIgnoreExistingKey) {
                 return NullUniValue;
             }
         } else {
-            pwalletMain->MarkDirty();
+            pwallet->MarkDirty();
 
-            if (!pwalletMain-> AddZKey(key))
+            if (!pwallet-> AddZKey(key))
                 throw JSONRPCError(RPC_WALLET_ERROR, "Error adding spending key to wallet");
 
-            pwalletMain->mapZKeyMetadata[addr].nCreateTime = 1;
+            pwallet->mapZKeyMetadata[addr].nCreateTime = 1;
         }
 
         // whenever a key is imported, we need to scan the whole chain
-        pwalletMain->nTimeFirstKey = 1; // 0 would be considered 'no value'
+        pwallet->nTimeFirstKey = 1; // 0 would be considered 'no value'
 
         // We want to scan for transactions and notes
         if (fRescan) {
-            pwalletMain->ScanForWalletTransactions(chainActive[nRescanHeight], true);
+            pwallet->ScanForWalletTransactions(chainActive[nRescanHeight], true);
         }
     }
 
@@ -687,6 +693,7 @@ UniValue z_importkey(const UniValue& params, bool fHelp)
 
 UniValue z_importviewingkey(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -714,7 +721,7 @@ UniValue z_importviewingkey(const UniValue& params, bool fHelp)
             + HelpExampleRpc("z_importviewingkey", "\"vkey\", \"no\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
@@ -750,26 +757,26 @@ UniValue z_importviewingkey(const UniValue& params, bool fHelp)
     auto addr = vkey.address();
 
     {
-        if (pwalletMain->HaveSpendingKey(addr)) {
+        if (pwallet->HaveSpendingKey(addr)) {
             throw JSONRPCError(RPC_WALLET_ERROR, "The wallet already contains the private key for this viewing key");
         }
 
         // Don't throw error in case a viewing key is already there
-        if (pwalletMain->HaveViewingKey(addr)) {
+        if (pwallet->HaveViewingKey(addr)) {
             if (fIgnoreExistingKey) {
                 return NullUniValue;
             }
         } else {
-            pwalletMain->MarkDirty();
+            pwallet->MarkDirty();
 
-            if (!pwalletMain->AddViewingKey(vkey)) {
+            if (!pwallet->AddViewingKey(vkey)) {
                 throw JSONRPCError(RPC_WALLET_ERROR, "Error adding viewing key to wallet");
             }
         }
 
         // We want to scan for transactions and notes
         if (fRescan) {
-            pwalletMain->ScanForWalletTransactions(chainActive[nRescanHeight], true);
+            pwallet->ScanForWalletTransactions(chainActive[nRescanHeight], true);
         }
     }
 
@@ -778,6 +785,7 @@ UniValue z_importviewingkey(const UniValue& params, bool fHelp)
 
 UniValue z_exportkey(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -799,7 +807,7 @@ UniValue z_exportkey(const UniValue& params, bool fHelp)
             + HelpExampleRpc("z_exportkey", "\"zaddr\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
@@ -809,7 +817,7 @@ UniValue z_exportkey(const UniValue& params, bool fHelp)
     auto addr = address.Get();
 
     libzcash::SpendingKey k;
-    if (!pwalletMain->GetSpendingKey(addr, k))
+    if (!pwallet->GetSpendingKey(addr, k))
         throw JSONRPCError(RPC_WALLET_ERROR, "Wallet does not hold private zkey for this zaddr");
 
     CZCSpendingKey spendingkey(k);
@@ -818,6 +826,7 @@ UniValue z_exportkey(const UniValue& params, bool fHelp)
 
 UniValue z_exportviewingkey(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -837,7 +846,7 @@ UniValue z_exportviewingkey(const UniValue& params, bool fHelp)
             + HelpExampleRpc("z_exportviewingkey", "\"zaddr\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
@@ -847,9 +856,9 @@ UniValue z_exportviewingkey(const UniValue& params, bool fHelp)
     auto addr = address.Get();
 
     libzcash::ViewingKey vk;
-    if (!pwalletMain->GetViewingKey(addr, vk)) {
+    if (!pwallet->GetViewingKey(addr, vk)) {
         libzcash::SpendingKey k;
-        if (!pwalletMain->GetSpendingKey(addr, k)) {
+        if (!pwallet->GetSpendingKey(addr, k)) {
             throw JSONRPCError(RPC_WALLET_ERROR, "Wallet does not hold private key or viewing key for this zaddr");
         }
         vk = k.viewing_key();
@@ -98,7 +98,6 @@ namespace{
 
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 
-int64_t nWalletUnlockTime;
 static CCriticalSection cs_nWalletUnlockTime;
 
 // transaction.h comment: spending taddr output requires CTxIn >= 148 bytes and typical taddr txout is 34 bytes
@@ -110,14 +109,30 @@ UniValue z_getoperationstatus_IMPL(const UniValue&, bool);
 
 std::string HelpRequiringPassphrase()
 {
-    return pwalletMain && pwalletMain->IsCrypted()
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    return pwallet && pwallet->IsCrypted()
         ? "\nRequires wallet passphrase to be set with walletpassphrase call."
         : "";
 }
 
+CWallet* GetWalletForJSONRPCRequest()
+{
+    const std::string strURI = GetRPCRequestURI();
+    if (strURI.compare(0, WALLET_ENDPOINT_BASE.size(), WALLET_ENDPOINT_BASE) != 0)
+        return pwalletMain;
+
+    const std::string strWalletFile = strURI.substr(WALLET_ENDPOINT_BASE.size());
+    for (CWallet* pwallet : vpwallets) {
+        if (pwallet->strWalletFile == strWalletFile)
+            return pwallet;
+    }
+    throw JSONRPCError(RPC_WALLET_NOT_FOUND, "Requested wallet does not exist or is not loaded");
+}
+
 bool EnsureWalletIsAvailable(bool avoidException)
 {
-    if (!pwalletMain)
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    if (!pwallet)
     {
         if (!avoidException)
             throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found (disabled)");
@@ -129,12 +144,14 @@ bool EnsureWalletIsAvailable(bool avoidException)
 
 void EnsureWalletIsUnlocked()
 {
-    if (pwalletMain->IsLocked())
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    if (pwallet->IsLocked())
         throw JSONRPCError(RPC_WALLET_UNLOCK_NEEDED, "Error: Please enter the wallet passphrase with walletpassphrase first.");
 }
 
 void AddVinExpandedToJSON(const CWalletTransactionBase& tx, UniValue& entry)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!tx.getTxBase()->IsCertificate() )
         entry.pushKV("locktime", (int64_t)tx.getTxBase()->GetLockTime());
     UniValue vinArr(UniValue::VARR);
@@ -157,8 +174,8 @@ void AddVinExpandedToJSON(const CWalletTransactionBase& tx, UniValue& entry)
             o.pushKV("hex", HexStr(txin.scriptSig.begin(), txin.scriptSig.end()));
             in.pushKV("scriptSig", o);
 
-            auto mi = pwalletMain->getMapWallet().find(inputTxHash);
-            if (mi != pwalletMain->getMapWallet().end() )
+            auto mi = pwallet->getMapWallet().find(inputTxHash);
+            if (mi != pwallet->getMapWallet().end() )
             {
                 if ((*mi).second->getTxBase()->GetHash() == inputTxHash)
                 {
@@ -382,6 +399,7 @@ string AccountFromValue(const UniValue& value)
 
 UniValue getnewaddress(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -400,7 +418,7 @@ UniValue getnewaddress(const UniValue& params, bool fHelp)
             + HelpExampleCli("getnewaddress", "")
             + HelpExampleRpc("getnewaddress", "")
         );
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     // Parse the account first so we don't generate a key if there's an error
     string strAccount;
@@ -408,16 +426,16 @@ UniValue getnewaddress(const UniValue& params, bool fHelp)
     if (params.size() > 0)
         strAccount = AccountFromValue(params[0]);
 
-    if (!pwalletMain->IsLocked())
-        pwalletMain->TopUpKeyPool();
+    if (!pwallet->IsLocked())
+        pwallet->TopUpKeyPool();
 
     // Generate a new key that is added to wallet
     CPubKey newKey;
-    if (!pwalletMain->GetKeyFromPool(newKey))
+    if (!pwallet->GetKeyFromPool(newKey))
         throw JSONRPCError(RPC_WALLET_KEYPOOL_RAN_OUT, "Error: Keypool ran out, please call keypoolrefill first");
     CKeyID keyID = newKey.GetID();
 
-    pwalletMain->SetAddressBook(keyID, strAccount, "receive");
+    pwallet->SetAddressBook(keyID, strAccount, "receive");
 
     // return the taddr string
     return CBitcoinAddress(keyID).ToString();
@@ -425,7 +443,8 @@ UniValue getnewaddress(const UniValue& params, bool fHelp)
 
 CBitcoinAddress GetAccountAddress(string strAccount, bool bForceNew=false)
 {
-    CWalletDB walletdb(pwalletMain->strWalletFile);
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    CWalletDB walletdb(pwallet->strWalletFile);
 
     CAccount account;
     walletdb.ReadAccount(strAccount, account);
@@ -437,8 +456,8 @@ CBitcoinAddress GetAccountAddress(string strAccount, bool bForceNew=false)
     {
         /* Get script for addr without OP_CHECKBLOCKATHEIGHT, cause we will use it only for searching */
         CScript scriptPubKey = GetScriptForDestination(account.vchPubKey.GetID(), false);
-        for (auto it = pwalletMain->getMapWallet().begin();
-             it != pwalletMain->getMapWallet().end() && account.vchPubKey.IsValid();
+        for (auto it = pwallet->getMapWallet().begin();
+             it != pwallet->getMapWallet().end() && account.vchPubKey.IsValid();
              ++it)
         {
 #if 0
@@ -461,10 +480,10 @@ CBitcoinAddress GetAccountAddress(string strAccount, bool bForceNew=false)
     // Generate a new key
     if (!account.vchPubKey.IsValid() || bForceNew || bKeyUsed)
     {
-        if (!pwalletMain->GetKeyFromPool(account.vchPubKey))
+        if (!pwallet->GetKeyFromPool(account.vchPubKey))
             throw JSONRPCError(RPC_WALLET_KEYPOOL_RAN_OUT, "Error: Keypool ran out, please call keypoolrefill first");
 
-        pwalletMain->SetAddressBook(account.vchPubKey.GetID(), strAccount, "receive");
+        pwallet->SetAddressBook(account.vchPubKey.GetID(), strAccount, "receive");
         walletdb.WriteAccount(strAccount, account);
     }
 
@@ -473,6 +492,7 @@ CBitcoinAddress GetAccountAddress(string strAccount, bool bForceNew=false)
 
 UniValue getaccountaddress(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -494,7 +514,7 @@ UniValue getaccountaddress(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getaccountaddress", "\"myaccount\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     // Parse the account first so we don't generate a key if there's an error
     string strAccount = AccountFromValue(params[0]);
@@ -508,6 +528,7 @@ UniValue getaccountaddress(const UniValue& params, bool fHelp)
 
 UniValue getrawchangeaddress(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -525,12 +546,12 @@ UniValue getrawchangeaddress(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getrawchangeaddress", "")
        );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
-    if (!pwalletMain->IsLocked())
-        pwalletMain->TopUpKeyPool();
+    if (!pwallet->IsLocked())
+        pwallet->TopUpKeyPool();
 
-    CReserveKey reservekey(pwalletMain);
+    CReserveKey reservekey(pwallet);
     CPubKey vchPubKey;
     if (!reservekey.GetReservedKey(vchPubKey))
         throw JSONRPCError(RPC_WALLET_KEYPOOL_RAN_OUT, "Error: Keypool ran out, please call keypoolrefill first");
@@ -545,6 +566,7 @@ UniValue getrawchangeaddress(const UniValue& params, bool fHelp)
 
 UniValue setaccount(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -565,7 +587,7 @@ UniValue setaccount(const UniValue& params, bool fHelp)
             + HelpExampleRpc("setaccount", "\"horizenaddress\", \"tabby\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     CBitcoinAddress address(params[0].get_str());
     if (!address.IsValid())
@@ -576,16 +598,16 @@ UniValue setaccount(const UniValue& params, bool fHelp)
         strAccount = AccountFromValue(params[1]);
 
     // Only add the account if the address is yours.
-    if (IsMine(*pwalletMain, address.Get()))
+    if (IsMine(*pwallet, address.Get()))
     {
         // Detect when changing the account of an address that is the 'unused current key' of another account:
-        if (pwalletMain->mapAddressBook.count(address.Get()))
+        if (pwallet->mapAddressBook.count(address.Get()))
         {
-            string strOldAccount = pwalletMain->mapAddressBook[address.Get()].name;
+            string strOldAccount = pwallet->mapAddressBook[address.Get()].name;
             if (address == GetAccountAddress(strOldAccount))
                 GetAccountAddress(strOldAccount, true);
         }
-        pwalletMain->SetAddressBook(address.Get(), strAccount, "receive");
+        pwallet->SetAddressBook(address.Get(), strAccount, "receive");
     }
     else
         throw JSONRPCError(RPC_MISC_ERROR, "setaccount can only be used with own address");
@@ -596,6 +618,7 @@ UniValue setaccount(const UniValue& params, bool fHelp)
 
 UniValue getaccount(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -615,15 +638,15 @@ UniValue getaccount(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getaccount", "\"horizenaddress\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     CBitcoinAddress address(params[0].get_str());
     if (!address.IsValid())
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Zen address");
 
     string strAccount;
-    map<CTxDestination, CAddressBookData>::iterator mi = pwalletMain->mapAddressBook.find(address.Get());
-    if (mi != pwalletMain->mapAddressBook.end() && !(*mi).second.name.empty())
+    map<CTxDestination, CAddressBookData>::iterator mi = pwallet->mapAddressBook.find(address.Get());
+    if (mi != pwallet->mapAddressBook.end() && !(*mi).second.name.empty())
         strAccount = (*mi).second.name;
     return strAccount;
 }
@@ -631,6 +654,7 @@ UniValue getaccount(const UniValue& params, bool fHelp)
 
 UniValue getaddressesbyaccount(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -653,13 +677,13 @@ UniValue getaddressesbyaccount(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getaddressesbyaccount", "\"tabby\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     string strAccount = AccountFromValue(params[0]);
 
     // Find all addresses that have the given account
     UniValue ret(UniValue::VARR);
-    BOOST_FOREACH(const PAIRTYPE(CBitcoinAddress, CAddressBookData)& item, pwalletMain->mapAddressBook)
+    BOOST_FOREACH(const PAIRTYPE(CBitcoinAddress, CAddressBookData)& item, pwallet->mapAddressBook)
     {
         const CBitcoinAddress& address = item.first;
         const string& strName = item.second.name;
@@ -671,6 +695,7 @@ UniValue getaddressesbyaccount(const UniValue& params, bool fHelp)
 
 UniValue listaddresses(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -690,10 +715,10 @@ UniValue listaddresses(const UniValue& params, bool fHelp)
                 + HelpExampleRpc("listaddresses", "")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     UniValue ret(UniValue::VARR);
-    BOOST_FOREACH(const PAIRTYPE(CBitcoinAddress, CAddressBookData)& item, pwalletMain->mapAddressBook)
+    BOOST_FOREACH(const PAIRTYPE(CBitcoinAddress, CAddressBookData)& item, pwallet->mapAddressBook)
     {
         const CBitcoinAddress& address = item.first;
         const string& strName = item.second.name;
@@ -705,7 +730,8 @@ UniValue listaddresses(const UniValue& params, bool fHelp)
 
 static void SendMoney(const CTxDestination &address, CAmount nValue, bool fSubtractFeeFromAmount, CWalletTx& wtxNew)
 {
-    CAmount curBalance = pwalletMain->GetBalance();
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    CAmount curBalance = pwallet->GetBalance();
 
     // Check amount
     if (nValue <= 0)
@@ -718,7 +744,7 @@ static void SendMoney(const CTxDestination &address, CAmount nValue, bool fSubtr
     CScript scriptPubKey = GetScriptForDestination(address);
 
     // Create and send the transaction
-    CReserveKey reservekey(pwalletMain);
+    CReserveKey reservekey(pwallet);
     CAmount nFeeRequired;
     std::string strError;
     vector<CRecipient> vecSend;
@@ -728,10 +754,10 @@ static void SendMoney(const CTxDestination &address, CAmount nValue, bool fSubtr
     int nChangePosRet = -1;
     CRecipient recipient = {scriptPubKey, nValue, fSubtractFeeFromAmount};
     vecSend.push_back(recipient);
-    if (!pwalletMain->CreateTransaction(vecSend, vecScSend, vecFtSend, vecBwtRequest,
+    if (!pwallet->CreateTransaction(vecSend, vecScSend, vecFtSend, vecBwtRequest,
             wtxNew, reservekey, nFeeRequired, nChangePosRet, strError))
     {
-        if (!fSubtractFeeFromAmount && nValue + nFeeRequired > pwalletMain->GetBalance())
+        if (!fSubtractFeeFromAmount && nValue + nFeeRequired > pwallet->GetBalance())
         {
             unsigned int nBytes = ::GetSerializeSize(*wtxNew.getTxBase(), SER_NETWORK, PROTOCOL_VERSION);
             strError = strprintf(
@@ -740,12 +766,13 @@ static void SendMoney(const CTxDestination &address, CAmount nValue, bool fSubtr
         }
         throw JSONRPCError(RPC_WALLET_ERROR, strError);
     }
-    if (!pwalletMain->CommitTransaction(wtxNew, reservekey))
+    if (!pwallet->CommitTransaction(wtxNew, reservekey))
         throw JSONRPCError(RPC_WALLET_ERROR, "Error: The transaction was rejected! This might happen if some of the coins in your wallet were already spent, such as if you used a copy of wallet.dat and coins were spent in the copy but not marked as spent here.");
 }
 
 UniValue sendtoaddress(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -775,7 +802,7 @@ UniValue sendtoaddress(const UniValue& params, bool fHelp)
             + HelpExampleRpc("sendtoaddress", "\"znnwwojWQJp1ARgbi1dqYtmnNMfihmg8m1b\", 0.1, \"donation\", \"ZenCash outpost\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     CBitcoinAddress address(params[0].get_str());
     if (!address.IsValid())
@@ -806,6 +833,7 @@ UniValue sendtoaddress(const UniValue& params, bool fHelp)
 
 UniValue sc_create(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -849,7 +877,7 @@ UniValue sc_create(const UniValue& params, bool fHelp)
             + HelpExampleCli("sc_create", "'{\"toaddress\": \"8aaddc9671dc5c8d33a3494df262883411935f4f54002fe283745fb394be508a\" ,\"amount\": 5.0, \"wCertVk\": abcd..ef}'")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     // valid input keywords
     static const std::set<std::string> validKeyArgs =
@@ -947,7 +975,7 @@ UniValue sc_create(const UniValue& params, bool fHelp)
         {
             throw JSONRPCError(RPC_INVALID_PARAMETER, string("Invalid parameter, unknown changeaddress format: ")+inputString );
         }
-        if (!IsMine(*pwalletMain, GetScriptForDestination(changeaddress.Get())))
+        if (!IsMine(*pwallet, GetScriptForDestination(changeaddress.Get())))
             throw JSONRPCError(RPC_INVALID_PARAMETER, string("Invalid parameter, changeaddress is not mine: ")+inputString );
     }
 
@@ -1201,6 +1229,7 @@ UniValue sc_create(const UniValue& params, bool fHelp)
 
 UniValue sc_send(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -1229,7 +1258,7 @@ UniValue sc_send(const UniValue& params, bool fHelp)
             + HelpExampleCli("sc_send", "'[{ \"toaddress\": \"abcd\", \"amount\": 3.0, \"scid\": \"13a3083bdcf42635c8ce5d46c2cae26cfed7dc889d9b4ac0b9939c6631a73bdc\", \"mcReturnAddress\": \"taddr\"}]'")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
     RPCTypeCheck(params, boost::assign::list_of (UniValue::VARR)(UniValue::VOBJ));
 
     // valid keywords in optional params
@@ -1313,8 +1342,7 @@ UniValue sc_send(const UniValue& params, bool fHelp)
         }
 
         {
-            LOCK(mempool.cs);
-            CCoinsViewMemPool scView(pcoinsTip, mempool);
+            CCoinsViewMemPoolSnapshot scView(pcoinsTip, mempool);
             if (!scView.HaveSidechain(scId))
             {
                 LogPrint("sc", "scid[%s] not yet created\n", scId.ToString() );
@@ -1390,7 +1418,7 @@ UniValue sc_send(const UniValue& params, bool fHelp)
             {
                 throw JSONRPCError(RPC_INVALID_PARAMETER, string("Invalid parameter, unknown changeaddress format: ")+inputString );
             }
-            if (!IsMine(*pwalletMain, GetScriptForDestination(changeaddress.Get())))
+            if (!IsMine(*pwallet, GetScriptForDestination(changeaddress.Get())))
                 throw JSONRPCError(RPC_INVALID_PARAMETER, string("Invalid parameter, changeaddress is not mine: ")+inputString );
         }
  
@@ -1435,6 +1463,7 @@ UniValue sc_send(const UniValue& params, bool fHelp)
 // request a backward transfer (BWT)
 UniValue sc_request_transfer(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -1466,7 +1495,7 @@ UniValue sc_request_transfer(const UniValue& params, bool fHelp)
             + HelpExampleCli("sc_request_transfer", "'[{ \"mcDestinationAddress\": \"taddr\", \"vScRequestData\": [\"06f75b4e1c1f49e6f329aa23f57e42bf305644b5b85c4d4ac60d7ef3b50679e8\"], \"scid\": \"13a3083bdcf42635c8ce5d46c2cae26cfed7dc889d9b4ac0b9939c6631a73bdc\", \"scFee\": 19.0 }]'")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
     RPCTypeCheck(params, boost::assign::list_of (UniValue::VARR)(UniValue::VOBJ));
 
     // valid keywords in cmd arguments
@@ -1517,8 +1546,7 @@ UniValue sc_request_transfer(const UniValue& params, bool fHelp)
         }
 
         {
-            LOCK(mempool.cs);
-            CCoinsViewMemPool scView(pcoinsTip, mempool);
+            CCoinsViewMemPoolSnapshot scView(pcoinsTip, mempool);
             if (!scView.HaveSidechain(scId))
             {
                 LogPrint("sc", "scid[%s] not yet created\n", scId.ToString() );
@@ -1656,7 +1684,7 @@ UniValue sc_request_transfer(const UniValue& params, bool fHelp)
             {
                 throw JSONRPCError(RPC_INVALID_PARAMETER, string("Invalid parameter, unknown changeaddress format: ")+inputString );
             }
-            if (!IsMine(*pwalletMain, GetScriptForDestination(changeaddress.Get())))
+            if (!IsMine(*pwallet, GetScriptForDestination(changeaddress.Get())))
                 throw JSONRPCError(RPC_INVALID_PARAMETER, string("Invalid parameter, changeaddress is not mine: ")+inputString );
         }
  
@@ -1697,6 +1725,7 @@ UniValue sc_request_transfer(const UniValue& params, bool fHelp)
 
 UniValue listaddressgroupings(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -1725,11 +1754,11 @@ UniValue listaddressgroupings(const UniValue& params, bool fHelp)
             + HelpExampleRpc("listaddressgroupings", "")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     UniValue jsonGroupings(UniValue::VARR);
-    map<CTxDestination, CAmount> balances = pwalletMain->GetAddressBalances();
-    BOOST_FOREACH(set<CTxDestination> grouping, pwalletMain->GetAddressGroupings())
+    map<CTxDestination, CAmount> balances = pwallet->GetAddressBalances();
+    BOOST_FOREACH(set<CTxDestination> grouping, pwallet->GetAddressGroupings())
     {
         UniValue jsonGrouping(UniValue::VARR);
         BOOST_FOREACH(CTxDestination address, grouping)
@@ -1738,8 +1767,8 @@ UniValue listaddressgroupings(const UniValue& params, bool fHelp)
             addressInfo.push_back(CBitcoinAddress(address).ToString());
             addressInfo.push_back(ValueFromAmount(balances[address]));
             {
-                if (pwalletMain->mapAddressBook.find(CBitcoinAddress(address).Get()) != pwalletMain->mapAddressBook.end())
-                    addressInfo.push_back(pwalletMain->mapAddressBook.find(CBitcoinAddress(address).Get())->second.name);
+                if (pwallet->mapAddressBook.find(CBitcoinAddress(address).Get()) != pwallet->mapAddressBook.end())
+                    addressInfo.push_back(pwallet->mapAddressBook.find(CBitcoinAddress(address).Get())->second.name);
             }
             jsonGrouping.push_back(addressInfo);
         }
@@ -1750,6 +1779,7 @@ UniValue listaddressgroupings(const UniValue& params, bool fHelp)
 
 UniValue signmessage(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -1777,7 +1807,7 @@ UniValue signmessage(const UniValue& params, bool fHelp)
             + HelpExampleRpc("signmessage", "\"znnwwojWQJp1ARgbi1dqYtmnNMfihmg8m1b\", \"my message\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
@@ -1793,7 +1823,7 @@ UniValue signmessage(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_TYPE_ERROR, "Address does not refer to key");
 
     CKey key;
-    if (!pwalletMain->GetKey(keyID, key))
+    if (!pwallet->GetKey(keyID, key))
         throw JSONRPCError(RPC_WALLET_ERROR, "Private key not available");
 
     CHashWriter ss(SER_GETHASH, 0);
@@ -1809,6 +1839,7 @@ UniValue signmessage(const UniValue& params, bool fHelp)
 
 UniValue getreceivedbyaddress(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -1835,7 +1866,7 @@ UniValue getreceivedbyaddress(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getreceivedbyaddress", "\"znnwwojWQJp1ARgbi1dqYtmnNMfihmg8m1b\", 6")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     // Bitcoin address
     CBitcoinAddress address = CBitcoinAddress(params[0].get_str());
@@ -1844,7 +1875,7 @@ UniValue getreceivedbyaddress(const UniValue& params, bool fHelp)
 
     /* Get script for addr without OP_CHECKBLOCKATHEIGHT, cause we will use it only for searching */
     CScript scriptPubKey = GetScriptForDestination(address.Get(), false);
-    if (!IsMine(*pwalletMain, scriptPubKey))
+    if (!IsMine(*pwallet, scriptPubKey))
         return (double)0.0;
 
     // Minimum confirmations
@@ -1854,7 +1885,7 @@ UniValue getreceivedbyaddress(const UniValue& params, bool fHelp)
 
     // Tally
     CAmount nAmount = 0;
-    for (auto it = pwalletMain->getMapWallet().begin(); it != pwalletMain->getMapWallet().end(); ++it)
+    for (auto it = pwallet->getMapWallet().begin(); it != pwallet->getMapWallet().end(); ++it)
     {
         const CWalletTransactionBase& wtx = *((*it).second);
         if (wtx.getTxBase()->IsCoinBase() || !CheckFinalTx(*wtx.getTxBase()))
@@ -1885,6 +1916,7 @@ UniValue getreceivedbyaddress(const UniValue& params, bool fHelp)
 
 UniValue getreceivedbyaccount(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -1911,7 +1943,7 @@ UniValue getreceivedbyaccount(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getreceivedbyaccount", "\"tabby\", 6")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     // Minimum confirmations
     int nMinDepth = 1;
@@ -1920,12 +1952,12 @@ UniValue getreceivedbyaccount(const UniValue& params, bool fHelp)
 
     // Get the set of pub keys assigned to account
     string strAccount = AccountFromValue(params[0]);
-    set<CTxDestination> setAddress = pwalletMain->GetAccountAddresses(strAccount);
+    set<CTxDestination> setAddress = pwallet->GetAccountAddresses(strAccount);
 
     // Tally
     CAmount nAmount = 0;
 
-    for (auto it = pwalletMain->getMapWallet().begin(); it != pwalletMain->getMapWallet().end(); ++it)
+    for (auto it = pwallet->getMapWallet().begin(); it != pwallet->getMapWallet().end(); ++it)
     {
         const CWalletTransactionBase& wtx = *((*it).second);
         if (wtx.getTxBase()->IsCoinBase() || !CheckFinalTx(*wtx.getTxBase()))
@@ -1941,7 +1973,7 @@ UniValue getreceivedbyaccount(const UniValue& params, bool fHelp)
             }
 
             CTxDestination address;
-            if (ExtractDestination(txout.scriptPubKey, address) && IsMine(*pwalletMain, address) && setAddress.count(address))
+            if (ExtractDestination(txout.scriptPubKey, address) && IsMine(*pwallet, address) && setAddress.count(address))
                 if (wtx.GetDepthInMainChain() >= nMinDepth)
                     nAmount += txout.nValue;
         }
@@ -1953,10 +1985,11 @@ UniValue getreceivedbyaccount(const UniValue& params, bool fHelp)
 
 CAmount GetAccountBalance(CWalletDB& walletdb, const string& strAccount, int nMinDepth, const isminefilter& filter)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     CAmount nBalance = 0;
 
     // Tally wallet transactions
-    for (auto it = pwalletMain->getMapWallet().begin(); it != pwalletMain->getMapWallet().end(); ++it)
+    for (auto it = pwallet->getMapWallet().begin(); it != pwallet->getMapWallet().end(); ++it)
     {
         const CWalletTransactionBase& wtx = *((*it).second);
         if (!CheckFinalTx(*wtx.getTxBase()) || (wtx.getTxBase()->IsCoinBase() && !wtx.HasMatureOutputs()) || wtx.GetDepthInMainChain() < 0)
@@ -1978,13 +2011,15 @@ CAmount GetAccountBalance(CWalletDB& walletdb, const string& strAccount, int nMi
 
 CAmount GetAccountBalance(const string& strAccount, int nMinDepth, const isminefilter& filter)
 {
-    CWalletDB walletdb(pwalletMain->strWalletFile);
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    CWalletDB walletdb(pwallet->strWalletFile);
     return GetAccountBalance(walletdb, strAccount, nMinDepth, filter);
 }
 
 
 UniValue getbalance(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -2010,10 +2045,10 @@ UniValue getbalance(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getbalance", "\"*\", 6")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     if (params.size() == 0)
-        return  ValueFromAmount(pwalletMain->GetBalance());
+        return  ValueFromAmount(pwallet->GetBalance());
 
     int nMinDepth = 1;
     if (params.size() > 1)
@@ -2029,7 +2064,7 @@ UniValue getbalance(const UniValue& params, bool fHelp)
         // (GetBalance() sums up all unspent TxOuts)
         // getbalance and "getbalance * 1 true" should return the same number
         CAmount nBalance = 0;
-        for (auto it = pwalletMain->getMapWallet().begin(); it != pwalletMain->getMapWallet().end(); ++it)
+        for (auto it = pwallet->getMapWallet().begin(); it != pwallet->getMapWallet().end(); ++it)
         {
             const CWalletTransactionBase* wtx = it->second.get();
             if (!CheckFinalTx(*wtx->getTxBase()) || (wtx->getTxBase()->IsCoinBase() && !wtx->HasMatureOutputs()) || wtx->GetDepthInMainChain() < 0)
@@ -2063,6 +2098,7 @@ UniValue getbalance(const UniValue& params, bool fHelp)
 
 UniValue getunconfirmedbalance(const UniValue &params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -2079,14 +2115,15 @@ UniValue getunconfirmedbalance(const UniValue &params, bool fHelp)
             + HelpExampleRpc("getunconfirmedbalance", "")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
-    return ValueFromAmount(pwalletMain->GetUnconfirmedBalance());
+    return ValueFromAmount(pwallet->GetUnconfirmedBalance());
 }
 
 
 UniValue movecmd(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -2114,7 +2151,7 @@ UniValue movecmd(const UniValue& params, bool fHelp)
             + HelpExampleRpc("move", "\"timotei\", \"akiko\", 0.01, 6, \"happy birthday!\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     string strFrom = AccountFromValue(params[0]);
     string strTo = AccountFromValue(params[1]);
@@ -2128,7 +2165,7 @@ UniValue movecmd(const UniValue& params, bool fHelp)
     if (params.size() > 4)
         strComment = params[4].get_str();
 
-    CWalletDB walletdb(pwalletMain->strWalletFile);
+    CWalletDB walletdb(pwallet->strWalletFile);
     if (!walletdb.TxnBegin())
         throw JSONRPCError(RPC_DATABASE_ERROR, "database error");
 
@@ -2136,23 +2173,23 @@ UniValue movecmd(const UniValue& params, bool fHelp)
 
     // Debit
     CAccountingEntry debit;
-    debit.nOrderPos = pwalletMain->IncOrderPosNext(&walletdb);
+    debit.nOrderPos = pwallet->IncOrderPosNext(&walletdb);
     debit.strAccount = strFrom;
     debit.nCreditDebit = -nAmount;
     debit.nTime = nNow;
     debit.strOtherAccount = strTo;
     debit.strComment = strComment;
-    pwalletMain->AddAccountingEntry(debit, walletdb);
+    pwallet->AddAccountingEntry(debit, walletdb);
 
     // Credit
     CAccountingEntry credit;
-    credit.nOrderPos = pwalletMain->IncOrderPosNext(&walletdb);
+    credit.nOrderPos = pwallet->IncOrderPosNext(&walletdb);
     credit.strAccount = strTo;
     credit.nCreditDebit = nAmount;
     credit.nTime = nNow;
     credit.strOtherAccount = strFrom;
     credit.strComment = strComment;
-    pwalletMain->AddAccountingEntry(credit, walletdb);
+    pwallet->AddAccountingEntry(credit, walletdb);
 
     if (!walletdb.TxnCommit())
         throw JSONRPCError(RPC_DATABASE_ERROR, "database error");
@@ -2163,6 +2200,7 @@ UniValue movecmd(const UniValue& params, bool fHelp)
 
 UniValue sendfrom(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -2196,7 +2234,7 @@ UniValue sendfrom(const UniValue& params, bool fHelp)
             + HelpExampleRpc("sendfrom", "\"tabby\", \"znnwwojWQJp1ARgbi1dqYtmnNMfihmg8m1b\", 0.01, 6, \"donation\", \"ZenCash outpost\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     string strAccount = AccountFromValue(params[0]);
     CBitcoinAddress address(params[1].get_str());
@@ -2231,6 +2269,7 @@ UniValue sendfrom(const UniValue& params, bool fHelp)
 
 UniValue sendmany(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -2273,7 +2312,7 @@ UniValue sendmany(const UniValue& params, bool fHelp)
             + HelpExampleRpc("sendmany", "\"\", \"{\\\"znnwwojWQJp1ARgbi1dqYtmnNMfihmg8m1b\\\":0.01,\\\"znYHqyumkLY3zVwgaHq3sbtHXuP8GxsNws3\\\":0.02}\", 6, \"testing\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     string strAccount = AccountFromValue(params[0]);
     UniValue sendTo = params[1].get_obj();
@@ -2330,7 +2369,7 @@ UniValue sendmany(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, "Account has insufficient funds");
 
     // Send
-    CReserveKey keyChange(pwalletMain);
+    CReserveKey keyChange(pwallet);
     CAmount nFeeRequired = 0;
     int nChangePosRet = -1;
     string strFailReason;
@@ -2338,11 +2377,11 @@ UniValue sendmany(const UniValue& params, bool fHelp)
     vector<CRecipientForwardTransfer> dumVecFtSend;
     vector<CRecipientBwtRequest> dumVecBwtRequest;
 
-    bool fCreated = pwalletMain->CreateTransaction(vecSend, dumVecScSend, dumVecFtSend, dumVecBwtRequest,
+    bool fCreated = pwallet->CreateTransaction(vecSend, dumVecScSend, dumVecFtSend, dumVecBwtRequest,
         wtx, keyChange, nFeeRequired, nChangePosRet, strFailReason);
     if (!fCreated)
         throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, strFailReason);
-    if (!pwalletMain->CommitTransaction(wtx, keyChange))
+    if (!pwallet->CommitTransaction(wtx, keyChange))
         throw JSONRPCError(RPC_WALLET_ERROR, "Transaction commit failed");
 
     return wtx.getWrappedTx().GetHash().GetHex();
@@ -2353,6 +2392,7 @@ extern CScript _createmultisig_redeemScript(const UniValue& params);
 
 UniValue addmultisigaddress(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -2384,7 +2424,7 @@ UniValue addmultisigaddress(const UniValue& params, bool fHelp)
         throw runtime_error(msg);
     }
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     string strAccount;
     if (params.size() > 2)
@@ -2393,9 +2433,9 @@ UniValue addmultisigaddress(const UniValue& params, bool fHelp)
     // Construct using pay-to-script-hash:
     CScript inner = _createmultisig_redeemScript(params);
     CScriptID innerID(inner);
-    pwalletMain->AddCScript(inner);
+    pwallet->AddCScript(inner);
 
-    pwalletMain->SetAddressBook(innerID, strAccount, "send");
+    pwallet->SetAddressBook(innerID, strAccount, "send");
     return CBitcoinAddress(innerID).ToString();
 }
 
@@ -2416,6 +2456,7 @@ struct tallyitem
 
 UniValue ListReceived(const UniValue& params, bool fByAccounts)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     // Minimum confirmations
     int nMinDepth = 1;
     if (params.size() > 0)
@@ -2433,7 +2474,7 @@ UniValue ListReceived(const UniValue& params, bool fByAccounts)
 
     // Tally
     map<CBitcoinAddress, tallyitem> mapTally;
-    for (auto it = pwalletMain->getMapWallet().begin(); it != pwalletMain->getMapWallet().end(); ++it)
+    for (auto it = pwallet->getMapWallet().begin(); it != pwallet->getMapWallet().end(); ++it)
     {
         const CWalletTransactionBase& wtx = *((*it).second);
         if (wtx.getTxBase()->IsCoinBase() || !CheckFinalTx(*wtx.getTxBase()) )
@@ -2449,7 +2490,7 @@ UniValue ListReceived(const UniValue& params, bool fByAccounts)
             if (!ExtractDestination(txout.scriptPubKey, address))
                 continue;
 
-            isminefilter mine = IsMine(*pwalletMain, address);
+            isminefilter mine = IsMine(*pwallet, address);
             if(!(mine & filter))
                 continue;
 
@@ -2465,7 +2506,7 @@ UniValue ListReceived(const UniValue& params, bool fByAccounts)
     // Reply
     UniValue ret(UniValue::VARR);
     map<string, tallyitem> mapAccountTally;
-    BOOST_FOREACH(const PAIRTYPE(CBitcoinAddress, CAddressBookData)& item, pwalletMain->mapAddressBook)
+    BOOST_FOREACH(const PAIRTYPE(CBitcoinAddress, CAddressBookData)& item, pwallet->mapAddressBook)
     {
         const CBitcoinAddress& address = item.first;
         const string& strAccount = item.second.name;
@@ -2533,6 +2574,7 @@ UniValue ListReceived(const UniValue& params, bool fByAccounts)
 
 UniValue listreceivedbyaddress(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -2564,13 +2606,14 @@ UniValue listreceivedbyaddress(const UniValue& params, bool fHelp)
             + HelpExampleRpc("listreceivedbyaddress", "6, true, true")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     return ListReceived(params, false);
 }
 
 UniValue listreceivedbyaccount(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -2601,7 +2644,7 @@ UniValue listreceivedbyaccount(const UniValue& params, bool fHelp)
             + HelpExampleRpc("listreceivedbyaccount", "6, true, true")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     return ListReceived(params, true);
 }
@@ -2619,6 +2662,7 @@ void ListTransactions(
     UniValue& transactions, const isminefilter& filter, bool includeImmatureBTs,
     bool minedInRange = true, bool certMaturingInRange = false)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     CAmount nFee;
     string strSentAccount;
     list<COutputEntry> listReceived;
@@ -2635,7 +2679,7 @@ void ListTransactions(
         BOOST_FOREACH(const COutputEntry& s, listSent)
         {
             UniValue entry(UniValue::VOBJ);
-            if(involvesWatchonly || (::IsMine(*pwalletMain, s.destination) & ISMINE_WATCH_ONLY))
+            if(involvesWatchonly || (::IsMine(*pwallet, s.destination) & ISMINE_WATCH_ONLY))
                 entry.pushKV("involvesWatchonly", true);
             entry.pushKV("account", strSentAccount);
             MaybePushAddress(entry, s.destination);
@@ -2665,12 +2709,12 @@ void ListTransactions(
             }
 
             string account;
-            if (pwalletMain->mapAddressBook.count(r.destination))
-                account = pwalletMain->mapAddressBook[r.destination].name;
+            if (pwallet->mapAddressBook.count(r.destination))
+                account = pwallet->mapAddressBook[r.destination].name;
             if (fAllAccounts || (account == strAccount))
             {
                 UniValue entry(UniValue::VOBJ);
-                if(involvesWatchonly || (::IsMine(*pwalletMain, r.destination) & ISMINE_WATCH_ONLY))
+                if(involvesWatchonly || (::IsMine(*pwallet, r.destination) & ISMINE_WATCH_ONLY))
                     entry.pushKV("involvesWatchonly", true);
                 entry.pushKV("account", account);
                 MaybePushAddress(entry, r.destination);
@@ -2736,6 +2780,7 @@ void AcentryToJSON(const CAccountingEntry& acentry, const string& strAccount, Un
 
 UniValue listtransactions(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -2796,7 +2841,7 @@ UniValue listtransactions(const UniValue& params, bool fHelp)
             + HelpExampleRpc("listtransactions", "\"*\", 20, 100")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     string strAccount("*");
     if (params.size() > 0)
@@ -2838,7 +2883,7 @@ UniValue listtransactions(const UniValue& params, bool fHelp)
             includeImmatureBTs = true;
 
     UniValue ret(UniValue::VARR);
-    const TxItems & txOrdered = pwalletMain->wtxOrdered;
+    const TxItems & txOrdered = pwallet->wtxOrdered;
     // iterate backwards until we have nCount items to return:
     for (TxItems::const_reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
     {
@@ -2889,6 +2934,7 @@ UniValue listtransactions(const UniValue& params, bool fHelp)
 
 UniValue getunconfirmedtxdata(const UniValue &params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -2908,7 +2954,7 @@ UniValue getunconfirmedtxdata(const UniValue &params, bool fHelp)
             + HelpExampleCli("getunconfirmedtxdata", "\"ztZ5M1P9ucj3P5JaW5xtY2hWTkp6JsToiHP\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     string address = params[0].get_str();
     CBitcoinAddress taddr = CBitcoinAddress(address);
@@ -2941,7 +2987,7 @@ UniValue getunconfirmedtxdata(const UniValue &params, bool fHelp)
     CAmount unconfInput = 0;
     CAmount unconfOutput = 0;
     CAmount bwtImmatureOutput = 0;
-    pwalletMain->GetUnconfirmedData(address, n, unconfInput, unconfOutput, bwtImmatureOutput,
+    pwallet->GetUnconfirmedData(address, n, unconfInput, unconfOutput, bwtImmatureOutput,
         zconfchangeusage, fIncludeNonFinal);
 
     UniValue ret(UniValue::VOBJ);
@@ -2955,6 +3001,7 @@ UniValue getunconfirmedtxdata(const UniValue &params, bool fHelp)
 
 UniValue listtxesbyaddress(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -2978,7 +3025,7 @@ UniValue listtxesbyaddress(const UniValue& params, bool fHelp)
             + HelpExampleCli("listtxesbyaddress", "\"ztZ5M1P9ucj3P5JaW5xtY2hWTkp6JsToiHP\" 20")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     string address = params[0].get_str();
     CBitcoinAddress taddr = CBitcoinAddress(address);
@@ -3005,7 +3052,7 @@ UniValue listtxesbyaddress(const UniValue& params, bool fHelp)
     std::list<CAccountingEntry> unused;
 
     // tx are ordered in this vector from the oldest to the newest
-    vTxWithInputs txOrdered = pwalletMain->OrderedTxWithInputs(address);
+    vTxWithInputs txOrdered = pwallet->OrderedTxWithInputs(address);
 
     // iterate backwards until we have nCount items to return:
     for (vTxWithInputs::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
@@ -3044,6 +3091,7 @@ UniValue listtxesbyaddress(const UniValue& params, bool fHelp)
 
 UniValue listaccounts(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -3073,7 +3121,7 @@ UniValue listaccounts(const UniValue& params, bool fHelp)
             + HelpExampleRpc("listaccounts", "6")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     int nMinDepth = 1;
     if (params.size() > 0)
@@ -3084,12 +3132,12 @@ UniValue listaccounts(const UniValue& params, bool fHelp)
             includeWatchonly = includeWatchonly | ISMINE_WATCH_ONLY;
 
     map<string, CAmount> mapAccountBalances;
-    BOOST_FOREACH(const PAIRTYPE(CTxDestination, CAddressBookData)& entry, pwalletMain->mapAddressBook) {
-        if (IsMine(*pwalletMain, entry.first) & includeWatchonly) // This address belongs to me
+    BOOST_FOREACH(const PAIRTYPE(CTxDestination, CAddressBookData)& entry, pwallet->mapAddressBook) {
+        if (IsMine(*pwallet, entry.first) & includeWatchonly) // This address belongs to me
             mapAccountBalances[entry.second.name] = 0;
     }
 
-    for (auto it = pwalletMain->getMapWallet().begin(); it != pwalletMain->getMapWallet().end(); ++it)
+    for (auto it = pwallet->getMapWallet().begin(); it != pwallet->getMapWallet().end(); ++it)
     {
         const CWalletTransactionBase& wtx = *((*it).second);
 
@@ -3113,15 +3161,15 @@ UniValue listaccounts(const UniValue& params, bool fHelp)
                 if (r.maturity == CCoins::outputMaturity::IMMATURE)
                     continue;
 
-                if (pwalletMain->mapAddressBook.count(r.destination))
-                    mapAccountBalances[pwalletMain->mapAddressBook[r.destination].name] += r.amount;
+                if (pwallet->mapAddressBook.count(r.destination))
+                    mapAccountBalances[pwallet->mapAddressBook[r.destination].name] += r.amount;
                 else
                     mapAccountBalances[""] += r.amount;
             }
         }
     }
 
-    const list<CAccountingEntry> & acentries = pwalletMain->laccentries;
+    const list<CAccountingEntry> & acentries = pwallet->laccentries;
     BOOST_FOREACH(const CAccountingEntry& entry, acentries)
         mapAccountBalances[entry.strAccount] += entry.nCreditDebit;
 
@@ -3134,6 +3182,7 @@ UniValue listaccounts(const UniValue& params, bool fHelp)
 
 UniValue listsinceblock(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -3177,7 +3226,7 @@ UniValue listsinceblock(const UniValue& params, bool fHelp)
             + HelpExampleRpc("listsinceblock", "\"000000000000000bacf66f7497b7dc45ef753ee9a7d38571037cdb1a57f663ad\", 6")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     CBlockIndex *pindex = NULL;
     int target_confirms = 1;
@@ -3218,7 +3267,7 @@ UniValue listsinceblock(const UniValue& params, bool fHelp)
 
     UniValue transactions(UniValue::VARR);
 
-    for (auto it = pwalletMain->getMapWallet().begin(); it != pwalletMain->getMapWallet().end(); ++it)
+    for (auto it = pwallet->getMapWallet().begin(); it != pwallet->getMapWallet().end(); ++it)
     {
         const CWalletTransactionBase& tx = *((*it).second);
         int depthInMainChain = tx.GetDepthInMainChain();
@@ -3258,6 +3307,7 @@ UniValue listsinceblock(const UniValue& params, bool fHelp)
 
 UniValue gettransaction(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -3376,7 +3426,7 @@ UniValue gettransaction(const UniValue& params, bool fHelp)
             + HelpExampleRpc("gettransaction", "\"1075db55d416d3ca199f55b6084e2115b9345e16c5cf302fc80e9d5fbf5d48d\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     uint256 hash;
     hash.SetHex(params[0].get_str());
@@ -3392,10 +3442,10 @@ UniValue gettransaction(const UniValue& params, bool fHelp)
             includeImmatureBTs = true;
 
     UniValue entry(UniValue::VOBJ);
-    if (!pwalletMain->getMapWallet().count(hash))
+    if (!pwallet->getMapWallet().count(hash))
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid or non-wallet transaction id");
 
-    const CWalletTransactionBase& wtx = *(pwalletMain->getMapWallet().at(hash));
+    const CWalletTransactionBase& wtx = *(pwallet->getMapWallet().at(hash));
 
     CAmount nCredit = wtx.GetCredit(filter);
     CAmount nDebit = wtx.GetDebit(filter);
@@ -3429,6 +3479,7 @@ UniValue gettransaction(const UniValue& params, bool fHelp)
 
 UniValue backupwallet(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -3448,7 +3499,7 @@ UniValue backupwallet(const UniValue& params, bool fHelp)
             + HelpExampleRpc("backupwallet", "\"destination\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     boost::filesystem::path exportdir;
     try {
@@ -3466,7 +3517,7 @@ UniValue backupwallet(const UniValue& params, bool fHelp)
     }
     boost::filesystem::path exportfilepath = exportdir / clean;
 
-    if (!BackupWallet(*pwalletMain, exportfilepath.string()))
+    if (!BackupWallet(*pwallet, exportfilepath.string()))
         throw JSONRPCError(RPC_WALLET_ERROR, "Error: Wallet backup failed!");
 
     return exportfilepath.string();
@@ -3475,6 +3526,7 @@ UniValue backupwallet(const UniValue& params, bool fHelp)
 
 UniValue keypoolrefill(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -3495,7 +3547,7 @@ UniValue keypoolrefill(const UniValue& params, bool fHelp)
             + HelpExampleRpc("keypoolrefill", "")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     // 0 is interpreted by TopUpKeyPool() as the default keypool size given by -keypool
     unsigned int kpSize = 0;
@@ -3506,9 +3558,9 @@ UniValue keypoolrefill(const UniValue& params, bool fHelp)
     }
 
     EnsureWalletIsUnlocked();
-    pwalletMain->TopUpKeyPool(kpSize);
+    pwallet->TopUpKeyPool(kpSize);
 
-    if (pwalletMain->GetKeyPoolSize() < kpSize)
+    if (pwallet->GetKeyPoolSize() < kpSize)
         throw JSONRPCError(RPC_WALLET_ERROR, "Error refreshing keypool.");
 
     return NullUniValue;
@@ -3518,16 +3570,17 @@ UniValue keypoolrefill(const UniValue& params, bool fHelp)
 static void LockWallet(CWallet* pWallet)
 {
     LOCK(cs_nWalletUnlockTime);
-    nWalletUnlockTime = 0;
+    pWallet->nWalletUnlockTime = 0;
     pWallet->Lock();
 }
 
 UniValue walletpassphrase(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
-    if (pwalletMain->IsCrypted() && (fHelp || params.size() != 2))
+    if (pwallet->IsCrypted() && (fHelp || params.size() != 2))
         throw runtime_error(
             "walletpassphrase \"passphrase\" timeout\n"
             "\nStores the wallet decryption key in memory for 'timeout' seconds.\n"
@@ -3547,11 +3600,11 @@ UniValue walletpassphrase(const UniValue& params, bool fHelp)
             + HelpExampleRpc("walletpassphrase", "\"my pass phrase\", 60")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     if (fHelp)
         return true;
-    if (!pwalletMain->IsCrypted())
+    if (!pwallet->IsCrypted())
         throw JSONRPCError(RPC_WALLET_WRONG_ENC_STATE, "Error: running with an unencrypted wallet, but walletpassphrase was called.");
 
     // Note that the walletpassphrase is stored in params[0] which is not mlock()ed
@@ -3563,7 +3616,7 @@ UniValue walletpassphrase(const UniValue& params, bool fHelp)
 
     if (strWalletPass.length() > 0)
     {
-        if (!pwalletMain->Unlock(strWalletPass))
+        if (!pwallet->Unlock(strWalletPass))
             throw JSONRPCError(RPC_WALLET_PASSPHRASE_INCORRECT, "Error: The wallet passphrase entered was incorrect.");
     }
     else
@@ -3572,13 +3625,14 @@ UniValue walletpassphrase(const UniValue& params, bool fHelp)
             "Stores the wallet decryption key in memory for <timeout> seconds.");
 
     // No need to check return values, because the wallet was unlocked above
-    pwalletMain->UpdateNullifierNoteMap();
-    pwalletMain->TopUpKeyPool();
+    pwallet->UpdateNullifierNoteMap();
+    pwallet->TopUpKeyPool();
 
     int64_t nSleepTime = params[1].get_int64();
     LOCK(cs_nWalletUnlockTime);
-    nWalletUnlockTime = GetTime() + nSleepTime;
-    RPCRunLater("lockwallet", boost::bind(LockWallet, pwalletMain), nSleepTime);
+    pwallet->nWalletUnlockTime = GetTime() + nSleepTime;
+    // a timer for each wallet, the others stay unlocked as long as they were asked
+    RPCRunLater("lockwallet(" + pwallet->strWalletFile + ")", boost::bind(LockWallet, pwallet), nSleepTime);
 
     return NullUniValue;
 }
@@ -3586,10 +3640,11 @@ UniValue walletpassphrase(const UniValue& params, bool fHelp)
 
 UniValue walletpassphrasechange(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
-    if (pwalletMain->IsCrypted() && (fHelp || params.size() != 2))
+    if (pwallet->IsCrypted() && (fHelp || params.size() != 2))
         throw runtime_error(
             "walletpassphrasechange \"oldpassphrase\" \"newpassphrase\"\n"
             "\nChanges the wallet passphrase from 'oldpassphrase' to 'newpassphrase'.\n"
@@ -3601,11 +3656,11 @@ UniValue walletpassphrasechange(const UniValue& params, bool fHelp)
             + HelpExampleRpc("walletpassphrasechange", "\"old one\", \"new one\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     if (fHelp)
         return true;
-    if (!pwalletMain->IsCrypted())
+    if (!pwallet->IsCrypted())
         throw JSONRPCError(RPC_WALLET_WRONG_ENC_STATE, "Error: running with an unencrypted wallet, but walletpassphrasechange was called.");
 
     // TODO: get rid of these .c_str() calls by implementing SecureString::operator=(std::string)
@@ -3623,7 +3678,7 @@ UniValue walletpassphrasechange(const UniValue& params, bool fHelp)
             "walletpassphrasechange <oldpassphrase> <newpassphrase>\n"
             "Changes the wallet passphrase from <oldpassphrase> to <newpassphrase>.");
 
-    if (!pwalletMain->ChangeWalletPassphrase(strOldWalletPass, strNewWalletPass))
+    if (!pwallet->ChangeWalletPassphrase(strOldWalletPass, strNewWalletPass))
         throw JSONRPCError(RPC_WALLET_PASSPHRASE_INCORRECT, "Error: The wallet passphrase entered was incorrect.");
 
     return NullUniValue;
@@ -3632,10 +3687,11 @@ UniValue walletpassphrasechange(const UniValue& params, bool fHelp)
 
 UniValue walletlock(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
-    if (pwalletMain->IsCrypted() && (fHelp || params.size() != 0))
+    if (pwallet->IsCrypted() && (fHelp || params.size() != 0))
         throw runtime_error(
             "walletlock\n"
             "\nRemoves the wallet encryption key from memory, locking the wallet.\n"
@@ -3652,17 +3708,17 @@ UniValue walletlock(const UniValue& params, bool fHelp)
             + HelpExampleRpc("walletlock", "")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     if (fHelp)
         return true;
-    if (!pwalletMain->IsCrypted())
+    if (!pwallet->IsCrypted())
         throw JSONRPCError(RPC_WALLET_WRONG_ENC_STATE, "Error: running with an unencrypted wallet, but walletlock was called.");
 
     {
         LOCK(cs_nWalletUnlockTime);
-        pwalletMain->Lock();
-        nWalletUnlockTime = 0;
+        pwallet->Lock();
+        pwallet->nWalletUnlockTime = 0;
     }
 
     return NullUniValue;
@@ -3671,6 +3727,7 @@ UniValue walletlock(const UniValue& params, bool fHelp)
 
 UniValue encryptwallet(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -3681,7 +3738,7 @@ UniValue encryptwallet(const UniValue& params, bool fHelp)
         strWalletEncryptionDisabledMsg = "\nWARNING: Wallet encryption is DISABLED. This call always fails.\n";
     }
 
-    if (!pwalletMain->IsCrypted() && (fHelp || params.size() != 1))
+    if (!pwallet->IsCrypted() && (fHelp || params.size() != 1))
         throw runtime_error(
             "encryptwallet \"passphrase\"\n"
             + strWalletEncryptionDisabledMsg +
@@ -3711,14 +3768,14 @@ UniValue encryptwallet(const UniValue& params, bool fHelp)
             + HelpExampleRpc("encryptwallet", "\"my pass phrase\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     if (fHelp)
         return true;
     if (!fEnableWalletEncryption) {
         throw JSONRPCError(RPC_WALLET_ENCRYPTION_FAILED, "Error: wallet encryption is disabled.");
     }
-    if (pwalletMain->IsCrypted())
+    if (pwallet->IsCrypted())
         throw JSONRPCError(RPC_WALLET_WRONG_ENC_STATE, "Error: running with an encrypted wallet, but encryptwallet was called.");
 
     // TODO: get rid of this .c_str() by implementing SecureString::operator=(std::string)
@@ -3732,7 +3789,7 @@ UniValue encryptwallet(const UniValue& params, bool fHelp)
             "encryptwallet <passphrase>\n"
             "Encrypts the wallet with <passphrase>.");
 
-    if (!pwalletMain->EncryptWallet(strWalletPass))
+    if (!pwallet->EncryptWallet(strWalletPass))
         throw JSONRPCError(RPC_WALLET_ENCRYPTION_FAILED, "Error: Failed to encrypt the wallet.");
 
     // BDB seems to have a bad habit of writing old data into
@@ -3744,6 +3801,7 @@ UniValue encryptwallet(const UniValue& params, bool fHelp)
 
 UniValue lockunspent(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -3784,7 +3842,7 @@ UniValue lockunspent(const UniValue& params, bool fHelp)
             + HelpExampleRpc("lockunspent", "false, \"[{\\\"txid\\\":\\\"a08e6907dbbd3d809776dbfc5d82e371b764ed838b5655e72f463568df1aadf0\\\",\\\"vout\\\":1}]\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     if (params.size() == 1)
         RPCTypeCheck(params, boost::assign::list_of(UniValue::VBOOL));
@@ -3795,7 +3853,7 @@ UniValue lockunspent(const UniValue& params, bool fHelp)
 
     if (params.size() == 1) {
         if (fUnlock)
-            pwalletMain->UnlockAllCoins();
+            pwallet->UnlockAllCoins();
         return true;
     }
 
@@ -3819,9 +3877,9 @@ UniValue lockunspent(const UniValue& params, bool fHelp)
         COutPoint outpt(uint256S(txid), nOutput);
 
         if (fUnlock)
-            pwalletMain->UnlockCoin(outpt);
+            pwallet->UnlockCoin(outpt);
         else
-            pwalletMain->LockCoin(outpt);
+            pwallet->LockCoin(outpt);
     }
 
     return true;
@@ -3829,6 +3887,7 @@ UniValue lockunspent(const UniValue& params, bool fHelp)
 
 UniValue listlockunspent(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -3860,10 +3919,10 @@ UniValue listlockunspent(const UniValue& params, bool fHelp)
             + HelpExampleRpc("listlockunspent", "")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     vector<COutPoint> vOutpts;
-    pwalletMain->ListLockedCoins(vOutpts);
+    pwallet->ListLockedCoins(vOutpts);
 
     UniValue ret(UniValue::VARR);
 
@@ -3880,6 +3939,7 @@ UniValue listlockunspent(const UniValue& params, bool fHelp)
 
 UniValue settxfee(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -3899,7 +3959,7 @@ UniValue settxfee(const UniValue& params, bool fHelp)
             + HelpExampleRpc("settxfee", "0.00001")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     // Amount
     CAmount nAmount = AmountFromValue(params[0]);
@@ -3910,6 +3970,7 @@ UniValue settxfee(const UniValue& params, bool fHelp)
 
 UniValue getwalletinfo(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -3936,24 +3997,49 @@ UniValue getwalletinfo(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getwalletinfo", "")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     UniValue obj(UniValue::VOBJ);
-    obj.pushKV("walletversion", pwalletMain->GetVersion());
-    obj.pushKV("balance",       ValueFromAmount(pwalletMain->GetBalance()));
-    obj.pushKV("unconfirmed_balance", ValueFromAmount(pwalletMain->GetUnconfirmedBalance()));
-    obj.pushKV("immature_balance",    ValueFromAmount(pwalletMain->GetImmatureBalance()));
-    obj.pushKV("txcount",       (int)pwalletMain->getMapWallet().size());
-    obj.pushKV("keypoololdest", pwalletMain->GetOldestKeyPoolTime());
-    obj.pushKV("keypoolsize",   (int)pwalletMain->GetKeyPoolSize());
-    if (pwalletMain->IsCrypted())
-        obj.pushKV("unlocked_until", nWalletUnlockTime);
+    obj.pushKV("walletversion", pwallet->GetVersion());
+    obj.pushKV("balance",       ValueFromAmount(pwallet->GetBalance()));
+    obj.pushKV("unconfirmed_balance", ValueFromAmount(pwallet->GetUnconfirmedBalance()));
+    obj.pushKV("immature_balance",    ValueFromAmount(pwallet->GetImmatureBalance()));
+    obj.pushKV("txcount",       (int)pwallet->getMapWallet().size());
+    obj.pushKV("keypoololdest", pwallet->GetOldestKeyPoolTime());
+    obj.pushKV("keypoolsize",   (int)pwallet->GetKeyPoolSize());
+    if (pwallet->IsCrypted())
+        obj.pushKV("unlocked_until", pwallet->nWalletUnlockTime);
     obj.pushKV("paytxfee",      ValueFromAmount(payTxFee.GetFeePerK()));
     return obj;
 }
 
+UniValue listwallets(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "listwallets\n"
+            "Returns the files of the wallets loaded, the first one serving the calls not sent to /wallet/<file>.\n"
+
+            "\nResult:\n"
+            "[                         (json array of strings)\n"
+            "  \"walletname\"            (string) the wallet file, within the data directory\n"
+            "  ,...\n"
+            "]\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("listwallets", "")
+            + HelpExampleRpc("listwallets", "")
+        );
+
+    UniValue ret(UniValue::VARR);
+    for (const CWallet* pwallet : vpwallets)
+        ret.push_back(pwallet->strWalletFile);
+    return ret;
+}
+
 UniValue resendwallettransactions(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -3966,9 +4052,9 @@ UniValue resendwallettransactions(const UniValue& params, bool fHelp)
             "Returns array of transaction ids that were re-broadcast.\n"
             );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
-    std::vector<uint256> txids = pwalletMain->ResendWalletTransactionsBefore(GetTime());
+    std::vector<uint256> txids = pwallet->ResendWalletTransactionsBefore(GetTime());
     UniValue result(UniValue::VARR);
     BOOST_FOREACH(const uint256& txid, txids)
     {
@@ -3979,6 +4065,7 @@ UniValue resendwallettransactions(const UniValue& params, bool fHelp)
 
 UniValue listunspent(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -4046,9 +4133,9 @@ UniValue listunspent(const UniValue& params, bool fHelp)
 
     UniValue results(UniValue::VARR);
     vector<COutput> vecOutputs;
-    assert(pwalletMain != NULL);
-    LOCK2(cs_main, pwalletMain->cs_wallet);
-    pwalletMain->AvailableCoins(vecOutputs, false, NULL, true, true);
+    assert(pwallet != NULL);
+    LOCK2(cs_main, pwallet->cs_wallet);
+    pwallet->AvailableCoins(vecOutputs, false, NULL, true, true);
     for(const COutput& out: vecOutputs) {
         if (out.nDepth < nMinDepth || out.nDepth > nMaxDepth)
             continue;
@@ -4073,8 +4160,8 @@ UniValue listunspent(const UniValue& params, bool fHelp)
         CTxDestination address;
         if (ExtractDestination(out.tx->getTxBase()->GetVout()[out.pos].scriptPubKey, address)) {
             entry.pushKV("address", CBitcoinAddress(address).ToString());
-            if (pwalletMain->mapAddressBook.count(address))
-                entry.pushKV("account", pwalletMain->mapAddressBook[address].name);
+            if (pwallet->mapAddressBook.count(address))
+                entry.pushKV("account", pwallet->mapAddressBook[address].name);
         }
         entry.pushKV("scriptPubKey", HexStr(pk.begin(), pk.end()));
         if (pk.IsPayToScriptHash()) {
@@ -4082,7 +4169,7 @@ UniValue listunspent(const UniValue& params, bool fHelp)
             if (ExtractDestination(pk, address)) {
                 const CScriptID& hash = boost::get<CScriptID>(address);
                 CScript redeemScript;
-                if (pwalletMain->GetCScript(hash, redeemScript))
+                if (pwallet->GetCScript(hash, redeemScript))
                     entry.pushKV("redeemScript", HexStr(redeemScript.begin(), redeemScript.end()));
             }
         }
@@ -4099,6 +4186,7 @@ UniValue listunspent(const UniValue& params, bool fHelp)
 
 UniValue z_listunspent(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -4165,7 +4253,7 @@ UniValue z_listunspent(const UniValue& params, bool fHelp)
         fIncludeWatchonly = params[2].get_bool();
     }
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     // User has supplied zaddrs to filter on
     if (params.size() > 3) {
@@ -4185,7 +4273,7 @@ UniValue z_listunspent(const UniValue& params, bool fHelp)
             try {
                 CZCPaymentAddress zaddr(address);
                 libzcash::PaymentAddress addr = zaddr.Get();
-                if (!fIncludeWatchonly && !pwalletMain->HaveSpendingKey(addr)) {
+                if (!fIncludeWatchonly && !pwallet->HaveSpendingKey(addr)) {
                     throw JSONRPCError(RPC_INVALID_PARAMETER, string("Invalid parameter, spending key for address does not belong to wallet: ") + address);
                 }
                 zaddrs.insert(addr);
@@ -4201,21 +4289,21 @@ UniValue z_listunspent(const UniValue& params, bool fHelp)
     }
     else {
         // User did not provide zaddrs, so use default i.e. all addresses
-        pwalletMain->GetPaymentAddresses(zaddrs);
+        pwallet->GetPaymentAddresses(zaddrs);
     }
 
     UniValue results(UniValue::VARR);
 
     if (zaddrs.size() > 0) {
         std::vector<CUnspentNotePlaintextEntry> entries;
-        pwalletMain->GetUnspentFilteredNotes(entries, zaddrs, nMinDepth, nMaxDepth, !fIncludeWatchonly);
+        pwallet->GetUnspentFilteredNotes(entries, zaddrs, nMinDepth, nMaxDepth, !fIncludeWatchonly);
         for (CUnspentNotePlaintextEntry & entry : entries) {
             UniValue obj(UniValue::VOBJ);
             obj.pushKV("txid",entry.jsop.hash.ToString());
             obj.pushKV("jsindex", (int)entry.jsop.js );
             obj.pushKV("jsoutindex", (int)entry.jsop.n);
             obj.pushKV("confirmations", entry.nHeight);
-            obj.pushKV("spendable", pwalletMain->HaveSpendingKey(entry.address));
+            obj.pushKV("spendable", pwallet->HaveSpendingKey(entry.address));
             obj.pushKV("address", CZCPaymentAddress(entry.address).ToString());
             obj.pushKV("amount", ValueFromAmount(CAmount(entry.plaintext.value())));
             std::string data(entry.plaintext.memo().begin(), entry.plaintext.memo().end());
@@ -4230,6 +4318,7 @@ UniValue z_listunspent(const UniValue& params, bool fHelp)
 
 UniValue fundrawtransaction(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -4275,7 +4364,7 @@ UniValue fundrawtransaction(const UniValue& params, bool fHelp)
     CAmount nFee;
     string strFailReason;
     int nChangePos = -1;
-    if(!pwalletMain->FundTransaction(tx, nFee, nChangePos, strFailReason))
+    if(!pwallet->FundTransaction(tx, nFee, nChangePos, strFailReason))
         throw JSONRPCError(RPC_INTERNAL_ERROR, strFailReason);
 
     UniValue result(UniValue::VOBJ);
@@ -4345,8 +4434,16 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
             "parameterloading\n"
             "createjoinsplit\n"
             "solveequihash\n"
+            "solveequihashrate (solutions per second of the tromp solver, optional args: nthreads, nnonces)\n"
             "verifyequihash\n"
+            "verifyequihashbatch (optional args: nheaders, nthreads)\n"
             "validatelargetx\n"
+            "sccommitmentcerts\n"
+            "verifyscproof\n"
+            "verifyscproofsbatch\n"
+            "verifycswproof\n"
+            "sccommitmenttree\n"
+            "scfieldhash\n"
             "trydecryptnotes\n"
             "incnotewitnesses\n"
             "connectblockslow\n"
@@ -4386,6 +4483,7 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
     }
 
     std::vector<double> sample_times;
+    std::vector<double> sample_rates_reused;
 
     JSDescription samplejoinsplit = JSDescription::getNewInstance(shieldedTxVersion == GROTH_TX_VERSION);
 
@@ -4421,11 +4519,52 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
                 std::vector<double> vals = benchmark_solve_equihash_threaded(nThreads);
                 sample_times.insert(sample_times.end(), vals.begin(), vals.end());
             }
+        } else if (benchmarktype == "solveequihashrate") {
+            int nThreads = params.size() > 2 ? params[2].get_int() : 1;
+            int nNonces = params.size() > 3 ? params[3].get_int() : 1;
+            if (nThreads < 1 || nNonces < 1) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Thread and nonce counts must be positive");
+            }
+            // the same runs, with a solver allocated for each nonce and with one solver per thread
+            std::vector<double> vals = benchmark_solve_equihash_threaded(nThreads, nNonces, false);
+            sample_times.push_back(std::accumulate(vals.begin(), vals.end(), 0.0));
+            vals = benchmark_solve_equihash_threaded(nThreads, nNonces, true);
+            sample_rates_reused.push_back(std::accumulate(vals.begin(), vals.end(), 0.0));
 #endif
         } else if (benchmarktype == "verifyequihash") {
             sample_times.push_back(benchmark_verify_equihash());
+        } else if (benchmarktype == "verifyequihashbatch") {
+            int nHeaders = params.size() > 2 ? params[2].get_int() : MAX_HEADERS_RESULTS;
+            int nThreads = params.size() > 3 ? params[3].get_int() : GetNumCores();
+            if (nHeaders < 1 || nHeaders > (int)MAX_HEADERS_RESULTS) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Batch size must be between 1 and %u", MAX_HEADERS_RESULTS));
+            }
+            if (nThreads < 1) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "The number of threads must be positive");
+            }
+            sample_times.push_back(benchmark_verify_equihash_batch(nHeaders, nThreads));
         } else if (benchmarktype == "validatelargetx") {
             sample_times.push_back(benchmark_large_tx());
+        } else if (benchmarktype == "sccommitmentcerts") {
+            int nCerts = params[2].get_int();
+            sample_times.push_back(benchmark_sc_commitment_certs(nCerts));
+        } else if (benchmarktype == "verifyscproof") {
+            sample_times.push_back(benchmark_verify_sc_cert_proof());
+        } else if (benchmarktype == "verifyscproofsbatch") {
+            int nProofs = params[2].get_int();
+            if (nProofs < 1 || nProofs > 256) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Batch size must be between 1 and 256");
+            }
+            sample_times.push_back(benchmark_verify_sc_cert_proofs_batch(nProofs));
+        } else if (benchmarktype == "verifycswproof") {
+            sample_times.push_back(benchmark_verify_sc_csw_proof());
+        } else if (benchmarktype == "sccommitmenttree") {
+            int nSidechains = params[2].get_int();
+            int nOutputs = params[3].get_int();
+            sample_times.push_back(benchmark_sc_commitment_tree(nSidechains, nOutputs));
+        } else if (benchmarktype == "scfieldhash") {
+            int nHashes = params[2].get_int();
+            sample_times.push_back(benchmark_sc_field_hash(nHashes));
         } else if (benchmarktype == "trydecryptnotes") {
             int nAddrs = params[2].get_int();
             sample_times.push_back(benchmark_try_decrypt_notes(nAddrs));
@@ -4456,6 +4595,16 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
     }
 
     UniValue results(UniValue::VARR);
+    if (benchmarktype == "solveequihashrate") {
+        for (size_t i = 0; i < sample_times.size(); i++) {
+            UniValue result(UniValue::VOBJ);
+            result.pushKV("solspersecond", sample_times[i]);
+            result.pushKV("solspersecondreused", sample_rates_reused[i]);
+            results.push_back(result);
+        }
+        return results;
+    }
+
     for (auto time : sample_times) {
         UniValue result(UniValue::VOBJ);
         result.pushKV("runningtime", time);
@@ -4467,6 +4616,7 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp)
 
 UniValue zc_raw_receive(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp)) {
         return NullUniValue;
     }
@@ -4532,11 +4682,11 @@ UniValue zc_raw_receive(const UniValue& params, bool fHelp)
     PaymentAddress payment_addr = k.address();
     Note decrypted_note = npt.note(payment_addr);
 
-    assert(pwalletMain != NULL);
+    assert(pwallet != NULL);
     std::vector<std::optional<ZCIncrementalWitness>> witnesses;
     uint256 anchor;
     uint256 commitment = decrypted_note.cm();
-    pwalletMain->WitnessNoteCommitment(
+    pwallet->WitnessNoteCommitment(
         {commitment},
         witnesses,
         anchor
@@ -4556,6 +4706,7 @@ UniValue zc_raw_receive(const UniValue& params, bool fHelp)
 
 UniValue zc_raw_joinsplit(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp)) {
         return NullUniValue;
     }
@@ -4634,7 +4785,7 @@ UniValue zc_raw_joinsplit(const UniValue& params, bool fHelp)
 
     uint256 anchor;
     std::vector<std::optional<ZCIncrementalWitness>> witnesses;
-    pwalletMain->WitnessNoteCommitment(commitments, witnesses, anchor);
+    pwallet->WitnessNoteCommitment(commitments, witnesses, anchor);
 
     assert(witnesses.size() == notes.size());
     assert(notes.size() == keys.size());
@@ -4787,6 +4938,7 @@ UniValue zc_raw_keygen(const UniValue& params, bool fHelp)
 
 UniValue z_getnewaddress(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -4803,11 +4955,11 @@ UniValue z_getnewaddress(const UniValue& params, bool fHelp)
             + HelpExampleRpc("z_getnewaddress", "")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     EnsureWalletIsUnlocked();
 
-    CZCPaymentAddress pubaddr = pwalletMain->GenerateNewZKey();
+    CZCPaymentAddress pubaddr = pwallet->GenerateNewZKey();
     std::string result = pubaddr.ToString();
     return result;
 }
@@ -4815,6 +4967,7 @@ UniValue z_getnewaddress(const UniValue& params, bool fHelp)
 
 UniValue z_listaddresses(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -4837,7 +4990,7 @@ UniValue z_listaddresses(const UniValue& params, bool fHelp)
             + HelpExampleRpc("z_listaddresses", "")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     bool fIncludeWatchonly = false;
     if (params.size() > 0) {
@@ -4846,9 +4999,9 @@ UniValue z_listaddresses(const UniValue& params, bool fHelp)
 
     UniValue ret(UniValue::VARR);
     std::set<libzcash::PaymentAddress> addresses;
-    pwalletMain->GetPaymentAddresses(addresses);
+    pwallet->GetPaymentAddresses(addresses);
     for (auto addr : addresses ) {
-        if (fIncludeWatchonly || pwalletMain->HaveSpendingKey(addr)) {
+        if (fIncludeWatchonly || pwallet->HaveSpendingKey(addr)) {
             ret.push_back(CZCPaymentAddress(addr).ToString());
         }
     }
@@ -4856,6 +5009,7 @@ UniValue z_listaddresses(const UniValue& params, bool fHelp)
 }
 
 CAmount getBalanceTaddr(std::string transparentAddress, int minDepth=1, bool ignoreUnspendable=true) {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     set<CBitcoinAddress> setAddress;
     vector<COutput> vecOutputs;
     CAmount balance = 0;
@@ -4868,9 +5022,9 @@ CAmount getBalanceTaddr(std::string transparentAddress, int minDepth=1, bool ign
         setAddress.insert(taddr);
     }
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
-    pwalletMain->AvailableCoins(vecOutputs, false, NULL, true, true);
+    pwallet->AvailableCoins(vecOutputs, false, NULL, true, true);
 
     BOOST_FOREACH(const COutput& out, vecOutputs) {
         if (out.nDepth < minDepth) {
@@ -4899,10 +5053,11 @@ CAmount getBalanceTaddr(std::string transparentAddress, int minDepth=1, bool ign
 }
 
 CAmount getBalanceZaddr(std::string address, int minDepth = 1, bool ignoreUnspendable=true) {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     CAmount balance = 0;
     std::vector<CNotePlaintextEntry> entries;
-    LOCK2(cs_main, pwalletMain->cs_wallet);
-    pwalletMain->GetFilteredNotes(entries, address, minDepth, true, ignoreUnspendable);
+    LOCK2(cs_main, pwallet->cs_wallet);
+    pwallet->GetFilteredNotes(entries, address, minDepth, true, ignoreUnspendable);
     for (auto & entry : entries) {
         balance += CAmount(entry.plaintext.value());
     }
@@ -4912,6 +5067,7 @@ CAmount getBalanceZaddr(std::string address, int minDepth = 1, bool ignoreUnspen
 
 UniValue z_listreceivedbyaddress(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -4938,7 +5094,7 @@ UniValue z_listreceivedbyaddress(const UniValue& params, bool fHelp)
             + HelpExampleRpc("z_listreceivedbyaddress", "\"ztfaW34Gj9FrnGUEf833ywDVL62NWXBM81u6EQnM6VR45eYnXhwztecW1SjxA7JrmAXKJhxhj3vDNEpVCQoSvVoSpmbhtjf\"")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     int nMinDepth = 1;
     if (params.size() > 1) {
@@ -4959,14 +5115,14 @@ UniValue z_listreceivedbyaddress(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid zaddr.");
     }
 
-    if (!(pwalletMain->HaveSpendingKey(zaddr) || pwalletMain->HaveViewingKey(zaddr))) {
+    if (!(pwallet->HaveSpendingKey(zaddr) || pwallet->HaveViewingKey(zaddr))) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "From address does not belong to this node, zaddr spending key or viewing key not found.");
     }
 
 
     UniValue result(UniValue::VARR);
     std::vector<CNotePlaintextEntry> entries;
-    pwalletMain->GetFilteredNotes(entries, fromaddress, nMinDepth, false, false);
+    pwallet->GetFilteredNotes(entries, fromaddress, nMinDepth, false, false);
     for (CNotePlaintextEntry & entry : entries) {
         UniValue obj(UniValue::VOBJ);
         obj.pushKV("txid",entry.jsop.hash.ToString());
@@ -4984,6 +5140,7 @@ UniValue z_listreceivedbyaddress(const UniValue& params, bool fHelp)
 
 UniValue z_getbalance(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -5010,7 +5167,7 @@ UniValue z_getbalance(const UniValue& params, bool fHelp)
             + HelpExampleRpc("z_getbalance", "\"myaddress\", 5")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     int nMinDepth = 1;
     if (params.size() > 1) {
@@ -5033,7 +5190,7 @@ UniValue z_getbalance(const UniValue& params, bool fHelp)
         } catch (const std::runtime_error&) {
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid from address, should be a taddr or zaddr.");
         }
-        if (!(pwalletMain->HaveSpendingKey(zaddr) || pwalletMain->HaveViewingKey(zaddr))) {
+        if (!(pwallet->HaveSpendingKey(zaddr) || pwallet->HaveViewingKey(zaddr))) {
              throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "From address does not belong to this node, zaddr spending key or viewing key not found.");
         }
     }
@@ -5051,6 +5208,7 @@ UniValue z_getbalance(const UniValue& params, bool fHelp)
 
 UniValue z_gettotalbalance(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -5081,7 +5239,7 @@ UniValue z_gettotalbalance(const UniValue& params, bool fHelp)
             + HelpExampleRpc("z_gettotalbalance", "5")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     int nMinDepth = 1;
     if (params.size() > 0) {
@@ -5098,7 +5256,7 @@ UniValue z_gettotalbalance(const UniValue& params, bool fHelp)
 
     // getbalance and "getbalance * 1 true" should return the same number
     // but they don't because wtx.GetAmounts() does not handle tx where there are no outputs
-    // pwalletMain->GetBalance() does not accept min depth parameter
+    // pwallet->GetBalance() does not accept min depth parameter
     // so we use our own method to get balance of utxos.
     CAmount nBalance = getBalanceTaddr("", nMinDepth, !fIncludeWatchonly);
     CAmount nPrivateBalance = getBalanceZaddr("", nMinDepth, !fIncludeWatchonly);
@@ -5181,7 +5339,8 @@ UniValue z_getoperationstatus(const UniValue& params, bool fHelp)
 
 UniValue z_getoperationstatus_IMPL(const UniValue& params, bool fRemoveFinishedOperations=false)
 {
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     std::set<AsyncRPCOperationId> filter;
     if (params.size()==1) {
@@ -5245,6 +5404,7 @@ UniValue z_getoperationstatus_IMPL(const UniValue& params, bool fRemoveFinishedO
 
 UniValue z_sendmany(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -5283,7 +5443,7 @@ UniValue z_sendmany(const UniValue& params, bool fHelp)
             + HelpExampleRpc("z_sendmany", "\"znnwwojWQJp1ARgbi1dqYtmnNMfihmg8m1b\", [{\"address\": \"ztfaW34Gj9FrnGUEf833ywDVL62NWXBM81u6EQnM6VR45eYnXhwztecW1SjxA7JrmAXKJhxhj3vDNEpVCQoSvVoSpmbhtjf\" ,\"amount\": 5.0}]")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     // Check that the from address is valid.
     auto fromaddress = params[0].get_str();
@@ -5303,7 +5463,7 @@ UniValue z_sendmany(const UniValue& params, bool fHelp)
 
     // Check that we have the spending key
     if (!fromTaddr) {
-        if (!pwalletMain->HaveSpendingKey(zaddr)) {
+        if (!pwallet->HaveSpendingKey(zaddr)) {
              throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "From address does not belong to this node, zaddr spending key not found.");
         }
     }
@@ -5450,6 +5610,7 @@ UniValue z_sendmany(const UniValue& params, bool fHelp)
     // Create operation and add to global queue
     std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
     std::shared_ptr<AsyncRPCOperation> operation( new AsyncRPCOperation_sendmany(contextualTx, fromaddress, taddrRecipients, zaddrRecipients, nMinDepth, nFee, contextInfo, sendChangeToSource) );
+    operation->setRequest("z_sendmany", params, GetRPCRequestURI());
     q->addOperation(operation);
     AsyncRPCOperationId operationId = operation->getId();
     return operationId;
@@ -5457,6 +5618,7 @@ UniValue z_sendmany(const UniValue& params, bool fHelp)
 
 UniValue sc_send_certificate(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -5475,6 +5637,8 @@ UniValue sc_send_certificate(const UniValue& params, bool fHelp)
             "       \"address\":\"address\"      (string, required) The Horizen mainchain address of the receiver\n"
             "       \"amount\":amount            (numeric, required) The numeric amount in ZEN\n"
             "     }, ... ]\n"
+            "    or, for a large number of transfers, a json string with the hex of the packed list: for each transfer the amount\n"
+            "    in zatoshi (8 bytes, little endian) followed by the pubkey hash of the receiver (20 bytes), as serialized in a certificate\n"
             " 7. forwardTransferScFee            (numeric, required) The amount of fee due to sidechain actors when creating a FT\n"
             " 8. mainchainBackwardTransferScFee  (numeric, required) The amount of fee due to sidechain actors when creating a MBTR\n"
             " 9. fee                             (numeric, optional) The fee amount of the certificate in " + CURRENCY_UNIT + ". If it is not specified or has a negative value it is automatically computed using a fixed fee rate (default is 1Zat/Byte)\n"
@@ -5495,7 +5659,7 @@ UniValue sc_send_certificate(const UniValue& params, bool fHelp)
 
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     CMutableScCertificate cert;
     cert.nVersion = SC_CERT_VERSION;
@@ -5512,7 +5676,7 @@ UniValue sc_send_certificate(const UniValue& params, bool fHelp)
     // sanity check of the side chain ID
     CCoinsView dummy;
     CCoinsViewCache scView(&dummy);
-    CCoinsViewMemPool vm(pcoinsTip, mempool);
+    CCoinsViewMemPoolSnapshot vm(pcoinsTip, mempool);
     scView.SetBackend(vm);
     CSidechain sidechain;
     if (!scView.GetSidechain(scId, sidechain))
@@ -5605,12 +5769,32 @@ UniValue sc_send_certificate(const UniValue& params, bool fHelp)
 
     //--------------------------------------------------------------------------
     // can be empty
-    const UniValue& outputs = params[5].get_array();
+    if (!params[5].isArray() && !params[5].isStr())
+        throw JSONRPCError(RPC_TYPE_ERROR, strprintf("Expected type array or string, got %s", uvTypeName(params[5].type())));
 
     // Recipients
     CAmount nTotalOut = 0;
 
     std::vector<ScRpcCmdCert::sBwdParams> vBackwardTransfers;
+    if (params[5].isStr())
+    {
+        std::vector<CBackwardTransferOut> vBwt;
+        if (!Sidechain::AddPackedBackwardTransfers(params[5].get_str(), vBwt, errorStr))
+            throw JSONRPCError(RPC_INVALID_PARAMETER, string("Invalid parameter, transfers: ") + errorStr);
+
+        vBackwardTransfers.reserve(vBwt.size());
+        for (const CBackwardTransferOut& bwt : vBwt)
+        {
+            vBackwardTransfers.push_back(ScRpcCmdCert::sBwdParams(GetScriptForDestination(CKeyID(bwt.pubKeyHash), false), bwt.nValue));
+            nTotalOut += bwt.nValue;
+            if (!MoneyRange(nTotalOut))
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, total amount of the transfers out of range");
+        }
+    }
+
+    static const UniValue noOutputs(UniValue::VARR);
+    const UniValue& outputs = params[5].isArray() ? params[5] : noOutputs;
+    vBackwardTransfers.reserve(vBackwardTransfers.size() + outputs.size());
     for (const UniValue& o : outputs.getValues())
     {
         if (!o.isObject())
@@ -5713,7 +5897,7 @@ UniValue sc_send_certificate(const UniValue& params, bool fHelp)
     }
     //--------------------------------------------------------------------------
     // get fe cfg from creation params if any
-    const auto & vFieldElementCertificateFieldConfig = sidechain.fixedParams.vFieldElementCertificateFieldConfig;
+    const auto & vFieldElementCertificateFieldConfig = sidechain.GetFixedParams().vFieldElementCertificateFieldConfig;
     std::vector<FieldElementCertificateField> vFieldElementCertificateField;
     UniValue feArray(UniValue::VARR);
     if (params.size() > 10)
@@ -5759,7 +5943,7 @@ UniValue sc_send_certificate(const UniValue& params, bool fHelp)
     }
 
     //--------------------------------------------------------------------------
-    const auto & vBitVectorCertificateFieldConfig = sidechain.fixedParams.vBitVectorCertificateFieldConfig;
+    const auto & vBitVectorCertificateFieldConfig = sidechain.GetFixedParams().vBitVectorCertificateFieldConfig;
     std::vector<BitVectorCertificateField> vBitVectorCertificateField;
     UniValue cmtArray(UniValue::VARR);
     if (params.size() > 11)
@@ -5848,6 +6032,7 @@ When estimating the number of coinbase utxos we can shield in a single transacti
 
 UniValue z_shieldcoinbase(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -5890,7 +6075,7 @@ UniValue z_shieldcoinbase(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_HARD_FORK_DEPRECATION, shieldedPoolDeprecationErrorMessage);
     }
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     // Validate the from address
     auto fromaddress = params[0].get_str();
@@ -5947,7 +6132,7 @@ UniValue z_shieldcoinbase(const UniValue& params, bool fHelp)
 
     // Get available utxos
     vector<COutput> vecOutputs;
-    pwalletMain->AvailableCoins(vecOutputs, true, NULL, false, true);
+    pwallet->AvailableCoins(vecOutputs, true, NULL, false, true);
 
     // Find unspent coinbase utxos and update estimated size
     BOOST_FOREACH(const COutput& out, vecOutputs) {
@@ -6026,6 +6211,7 @@ UniValue z_shieldcoinbase(const UniValue& params, bool fHelp)
     // Create operation and add to global queue
     std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
     std::shared_ptr<AsyncRPCOperation> operation( new AsyncRPCOperation_shieldcoinbase(contextualTx, inputs, destaddress, nFee, contextInfo) );
+    operation->setRequest("z_shieldcoinbase", params, GetRPCRequestURI());
     q->addOperation(operation);
     AsyncRPCOperationId operationId = operation->getId();
 
@@ -6045,6 +6231,7 @@ UniValue z_shieldcoinbase(const UniValue& params, bool fHelp)
 
 UniValue z_mergetoaddress(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -6113,7 +6300,7 @@ UniValue z_mergetoaddress(const UniValue& params, bool fHelp)
     const int shieldedTxVersion = ForkManager::getInstance().getShieldedTxVersion(chainActive.Height() + 1);
     LogPrintf("z_mergetoaddress shieldedTxVersion (Forkmanager): %d\n", shieldedTxVersion);
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     bool useAny = false;
     bool useAnyUTXO = false;
@@ -6262,7 +6449,7 @@ UniValue z_mergetoaddress(const UniValue& params, bool fHelp)
             fIncludeCommunityFund = ForkManager::getInstance().canSendCommunityFundsToTransparentAddress(chainActive.Height() + 1);
         }
 
-        pwalletMain->AvailableCoins(vecOutputs, true, NULL, false, fIncludeCoinBase, fIncludeCommunityFund);
+        pwallet->AvailableCoins(vecOutputs, true, NULL, false, fIncludeCoinBase, fIncludeCommunityFund);
 
         // Find unspent utxos and update estimated size
         for (const COutput& out : vecOutputs) {
@@ -6306,7 +6493,7 @@ UniValue z_mergetoaddress(const UniValue& params, bool fHelp)
     if (useAny || useAnyNote || zaddrs.size() > 0) {
         // Get available notes
         std::vector<CNotePlaintextEntry> entries;
-        pwalletMain->GetFilteredNotes(entries, zaddrs);
+        pwallet->GetFilteredNotes(entries, zaddrs);
 
         // Find unspent notes and update estimated size
         for (CNotePlaintextEntry& entry : entries) {
@@ -6324,7 +6511,7 @@ UniValue z_mergetoaddress(const UniValue& params, bool fHelp)
                 } else {
                     estimatedTxSize += increase;
                     SpendingKey zkey;
-                    pwalletMain->GetSpendingKey(entry.address, zkey);
+                    pwallet->GetSpendingKey(entry.address, zkey);
                     noteInputs.emplace_back(entry.jsop, entry.plaintext.note(entry.address), nValue, zkey);
                     mergedNoteValue += nValue;
                 }
@@ -6381,6 +6568,7 @@ UniValue z_mergetoaddress(const UniValue& params, bool fHelp)
     std::shared_ptr<AsyncRPCQueue> q = getAsyncRPCQueue();
     std::shared_ptr<AsyncRPCOperation> operation(
         new AsyncRPCOperation_mergetoaddress(contextualTx, utxoInputs, noteInputs, recipient, nFee, contextInfo) );
+    operation->setRequest("z_mergetoaddress", params, GetRPCRequestURI());
     q->addOperation(operation);
     AsyncRPCOperationId operationId = operation->getId();
 
@@ -6401,6 +6589,7 @@ UniValue z_mergetoaddress(const UniValue& params, bool fHelp)
 
 UniValue z_listoperationids(const UniValue& params, bool fHelp)
 {
+    CWallet* const pwallet = GetWalletForJSONRPCRequest();
     if (!EnsureWalletIsAvailable(fHelp))
         return NullUniValue;
 
@@ -6423,7 +6612,7 @@ UniValue z_listoperationids(const UniValue& params, bool fHelp)
             + HelpExampleRpc("z_listoperationids", "")
         );
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    LOCK2(cs_main, pwallet->cs_wallet);
 
     std::string filter;
     bool useFilter = false;
@@ -311,4 +311,45 @@ BOOST_AUTO_TEST_CASE(coin_selection_tests)
     empty_wallet();
 }
 
+BOOST_AUTO_TEST_CASE(coin_selection_changeless_tests)
+{
+    CoinSet setCoinsRet;
+    CAmount nValueRet;
+
+    LOCK(wallet.cs_wallet);
+
+    for (int i = 0; i < RUN_TESTS; i++)
+    {
+        empty_wallet();
+
+        add_coin(3*CENT);
+        add_coin(4*CENT + 10);
+        add_coin(1*COIN);
+
+        // 3+4 cents exceed 7 cents by less than the dust a change output would be, so no change is needed,
+        // rather than spending the whole coin for 93 cents of change
+        BOOST_CHECK( wallet.SelectCoinsMinConf(7 * CENT, 1, 1, vCoins, setCoinsRet, nValueRet));
+        BOOST_CHECK_EQUAL(nValueRet, 7 * CENT + 10);
+        BOOST_CHECK_EQUAL(setCoinsRet.size(), 2U);
+
+        add_coin(2*CENT);
+        add_coin(5*CENT);
+
+        // an exact match is better than a changeless excess
+        BOOST_CHECK( wallet.SelectCoinsMinConf(7 * CENT, 1, 1, vCoins, setCoinsRet, nValueRet));
+        BOOST_CHECK_EQUAL(nValueRet, 7 * CENT);
+        BOOST_CHECK_EQUAL(setCoinsRet.size(), 2U);
+
+        // many equal coins do not exhaust the search
+        empty_wallet();
+        for (int i2 = 0; i2 < 200; i2++)
+            add_coin(3*CENT);
+        add_coin(2*CENT);
+        BOOST_CHECK( wallet.SelectCoinsMinConf(305 * CENT, 1, 1, vCoins, setCoinsRet, nValueRet));
+        BOOST_CHECK_EQUAL(nValueRet, 305 * CENT);
+        BOOST_CHECK_EQUAL(setCoinsRet.size(), 102U);
+    }
+    empty_wallet();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -25,6 +25,7 @@ using namespace zen;
 
 #include <algorithm>
 #include <assert.h>
+#include <atomic>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
@@ -133,7 +134,7 @@ bool CWallet::AddZKey(const libzcash::SpendingKey &key)
     return true;
 }
 
-CPubKey CWallet::GenerateNewKey()
+CPubKey CWallet::GenerateNewKey(CWalletDB* pwalletdb)
 {
     AssertLockHeld(cs_wallet); // mapKeyMetadata
     bool fCompressed = CanSupportFeature(FEATURE_COMPRPUBKEY); // default to compressed public keys if we want 0.6.0 wallets
@@ -143,7 +144,7 @@ CPubKey CWallet::GenerateNewKey()
 
     // Compressed public keys were introduced in version 0.6.0
     if (fCompressed)
-        SetMinVersion(FEATURE_COMPRPUBKEY);
+        SetMinVersion(FEATURE_COMPRPUBKEY, pwalletdb);
 
     CPubKey pubkey = secret.GetPubKey();
     assert(secret.VerifyPubKey(pubkey));
@@ -154,15 +155,28 @@ CPubKey CWallet::GenerateNewKey()
     if (!nTimeFirstKey || nCreationTime < nTimeFirstKey)
         nTimeFirstKey = nCreationTime;
 
-    if (!AddKeyPubKey(secret, pubkey))
+    if (!AddKeyPubKeyWithDB(secret, pubkey, pwalletdb))
         throw std::runtime_error("CWallet::GenerateNewKey(): AddKey failed");
     return pubkey;
 }
 
 bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
+{
+    return AddKeyPubKeyWithDB(secret, pubkey, NULL);
+}
+
+bool CWallet::AddKeyPubKeyWithDB(const CKey& secret, const CPubKey &pubkey, CWalletDB* pwalletdb)
 {
     AssertLockHeld(cs_wallet); // mapKeyMetadata
-    if (!CCryptoKeyStore::AddKeyPubKey(secret, pubkey))
+    // CCryptoKeyStore saves an encrypted key through AddCryptedKey(): pwalletdb is
+    // tunneled to it, a second database handle would wait for its transaction
+    bool fTunneled = pwalletdb && !pwalletdbEncryption;
+    if (fTunneled)
+        pwalletdbEncryption = pwalletdb;
+    bool fAdded = CCryptoKeyStore::AddKeyPubKey(secret, pubkey);
+    if (fTunneled)
+        pwalletdbEncryption = NULL;
+    if (!fAdded)
         return false;
 
     // check if we need to remove from watch-only
@@ -174,6 +188,8 @@ bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
     if (!fFileBacked)
         return true;
     if (!IsCrypted()) {
+        if (pwalletdb)
+            return pwalletdb->WriteKey(pubkey, secret.GetPrivKey(), mapKeyMetadata[pubkey.GetID()]);
         return CWalletDB(strWalletFile).WriteKey(pubkey,
                                                  secret.GetPrivKey(),
                                                  mapKeyMetadata[pubkey.GetID()]);
@@ -413,6 +429,12 @@ bool CWallet::ChangeWalletPassphrase(const SecureString& strOldWalletPassphrase,
     return false;
 }
 
+void CWallet::BlockSyncBegin()
+{
+    LOCK(cs_wallet);
+    fBlockSyncInProgress = true;
+}
+
 void CWallet::ChainTip(const CBlockIndex *pindex, const CBlock *pblock,
                        ZCIncrementalMerkleTree tree, bool added)
 {
@@ -421,12 +443,47 @@ void CWallet::ChainTip(const CBlockIndex *pindex, const CBlock *pblock,
     } else {
         DecrementNoteWitnesses(pindex);
     }
+
+    // the last update about the block
+    LOCK(cs_wallet);
+    fBlockSyncInProgress = false;
+    WriteBlockSyncChanges();
+}
+
+void CWallet::WriteBlockSyncChanges()
+{
+    AssertLockHeld(cs_wallet);
+    if (setBlockSyncTxs.empty() && setBlockSyncSidechains.empty())
+        return;
+
+    if (fFileBacked) {
+        // not flushed on close, MaybeFlushWalletDB takes care of it
+        CWalletDB walletdb(strWalletFile, "r+", false);
+        bool fTxn = walletdb.TxnBegin();
+        for (const uint256& hash : setBlockSyncTxs) {
+            MAP_WALLET_CONST_IT it = mapWallet.find(hash);
+            if (it != mapWallet.end() && !it->second->WriteToDisk(&walletdb))
+                LogPrintf("%s():%d - ERROR in writing obj[%s] to db\n", __func__, __LINE__, hash.ToString());
+        }
+        for (const uint256& scId : setBlockSyncSidechains)
+            walletdb.WriteSidechain(mapSidechains.at(scId));
+        walletdb.WriteOrderPosNext(nOrderPosNext);
+        if (fTxn && !walletdb.TxnCommit())
+            LogPrintf("%s():%d - ERROR in committing %d objects to db\n", __func__, __LINE__, setBlockSyncTxs.size());
+    }
+
+    LogPrint("db", "%s():%d - written %d objects and %d sidechains\n", __func__, __LINE__,
+        setBlockSyncTxs.size(), setBlockSyncSidechains.size());
+    setBlockSyncTxs.clear();
+    setBlockSyncSidechains.clear();
 }
 
 void CWallet::SetBestChain(const CBlockLocator& loc)
 {
     LogPrint("db", "%s():%d - called\n", __func__, __LINE__);
     LOCK(cs_wallet);
+    // the transactions of the blocks up to the locator go first
+    WriteBlockSyncChanges();
     CWalletDB walletdb(strWalletFile);
     SetBestChainINTERNAL(walletdb, loc);
 }
@@ -684,39 +741,95 @@ void CWallet::ClearNoteWitnessCache()
             item.second.witnesses.clear();
             item.second.witnessHeight = -1;
         }
+        // the notes are witnessed again from scratch, spent or not
+        AddToWitnessedNotes(*(wtxItem.second));
     }
     nWitnessCacheSize = 0;
 }
 
+void CWallet::AddToWitnessedNotes(const CWalletTransactionBase& wtx)
+{
+    LOCK(cs_wallet);
+    for (const mapNoteData_t::value_type& item : wtx.mapNoteData)
+        setWitnessedNotes.insert(item.first);
+}
+
+std::vector<CNoteData*> CWallet::GetWitnessedNotes()
+{
+    AssertLockHeld(cs_wallet);
+    std::vector<CNoteData*> vNotes;
+    vNotes.reserve(setWitnessedNotes.size());
+    for (std::set<JSOutPoint>::iterator it = setWitnessedNotes.begin(); it != setWitnessedNotes.end();) {
+        MAP_WALLET_CONST_IT mi = mapWallet.find(it->hash);
+        if (mi == mapWallet.end()) {
+            it = setWitnessedNotes.erase(it);
+            continue;
+        }
+        mapNoteData_t::iterator ni = mi->second->mapNoteData.find(*it);
+        if (ni == mi->second->mapNoteData.end()) {
+            it = setWitnessedNotes.erase(it);
+            continue;
+        }
+        vNotes.push_back(&(ni->second));
+        ++it;
+    }
+    return vNotes;
+}
+
+void CWallet::PruneSpentNoteWitnesses()
+{
+    AssertLockHeld(cs_wallet);
+    for (std::set<JSOutPoint>::iterator it = setWitnessedNotes.begin(); it != setWitnessedNotes.end();) {
+        CNoteData& nd = mapWallet.at(it->hash)->mapNoteData.at(*it);
+        // the nullifiers of a locked wallet may not be known yet
+        bool fSpentDeep = false;
+        if (nd.nullifier) {
+            std::pair<TxNullifiers::const_iterator, TxNullifiers::const_iterator> range = mapTxNullifiers.equal_range(*nd.nullifier);
+            for (TxNullifiers::const_iterator ni = range.first; ni != range.second && !fSpentDeep; ++ni) {
+                const MAP_WALLET_CONST_IT mi = mapWallet.find(ni->second);
+                fSpentDeep = mi != mapWallet.end() && mi->second->GetDepthInMainChain() >= (int)WITNESS_CACHE_SIZE;
+            }
+        }
+        if (!fSpentDeep) {
+            ++it;
+            continue;
+        }
+
+        // the note is left as if it was never witnessed, which it would be again after a rescan
+        LogPrint("zrpc", "%s():%d - note %s spent, its witnesses are no longer maintained\n", __func__, __LINE__, it->ToString());
+        nd.witnesses.clear();
+        nd.witnessHeight = -1;
+        setPrunedWitnessTxs.insert(it->hash);
+        it = setWitnessedNotes.erase(it);
+    }
+}
+
 void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                                      const CBlock* pblockIn,
                                      ZCIncrementalMerkleTree& tree)
 {
     {
         LOCK(cs_wallet);
-        for (auto& wtxItem : mapWallet)
-        {
-            for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
-                CNoteData* nd = &(item.second);
-                // Only increment witnesses that are behind the current height
-                if (nd->witnessHeight < pindex->nHeight) {
-                    // Check the validity of the cache
-                    // The only time a note witnessed above the current height
-                    // would be invalid here is during a reindex when blocks
-                    // have been decremented, and we are incrementing the blocks
-                    // immediately after.
-                    assert(nWitnessCacheSize >= nd->witnesses.size());
-                    // Witnesses being incremented should always be either -1
-                    // (never incremented or decremented) or one below pindex
-                    assert((nd->witnessHeight == -1) ||
-                           (nd->witnessHeight == pindex->nHeight - 1));
-                    // Copy the witness for the previous block if we have one
-                    if (nd->witnesses.size() > 0) {
-                        nd->witnesses.push_front(nd->witnesses.front());
-                    }
-                    if (nd->witnesses.size() > WITNESS_CACHE_SIZE) {
-                        nd->witnesses.pop_back();
-                    }
+        const std::vector<CNoteData*> vNotes = GetWitnessedNotes();
+        for (CNoteData* nd : vNotes) {
+            // Only increment witnesses that are behind the current height
+            if (nd->witnessHeight < pindex->nHeight) {
+                // Check the validity of the cache
+                // The only time a note witnessed above the current height
+                // would be invalid here is during a reindex when blocks
+                // have been decremented, and we are incrementing the blocks
+                // immediately after.
+                assert(nWitnessCacheSize >= nd->witnesses.size());
+                // Witnesses being incremented should always be either -1
+                // (never incremented or decremented) or one below pindex
+                assert((nd->witnessHeight == -1) ||
+                       (nd->witnessHeight == pindex->nHeight - 1));
+                // Copy the witness for the previous block if we have one
+                if (nd->witnesses.size() > 0) {
+                    nd->witnesses.push_front(nd->witnesses.front());
+                }
+                if (nd->witnesses.size() > WITNESS_CACHE_SIZE) {
+                    nd->witnesses.pop_back();
                 }
             }
         }
@@ -741,24 +854,21 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
                     tree.append(note_commitment);
 
                     // Increment existing witnesses
-                    for (auto& wtxItem : mapWallet)
-                    {
-                        for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
-                            CNoteData* nd = &(item.second);
-                            if (nd->witnessHeight < pindex->nHeight &&
-                                    nd->witnesses.size() > 0) {
-                                // Check the validity of the cache
-                                // See earlier comment about validity.
-                                assert(nWitnessCacheSize >= nd->witnesses.size());
-                                nd->witnesses.front().append(note_commitment);
-                            }
+                    for (CNoteData* nd : vNotes) {
+                        if (nd->witnessHeight < pindex->nHeight &&
+                                nd->witnesses.size() > 0) {
+                            // Check the validity of the cache
+                            // See earlier comment about validity.
+                            assert(nWitnessCacheSize >= nd->witnesses.size());
+                            nd->witnesses.front().append(note_commitment);
                         }
                     }
 
                     // If this is our note, witness it
                     if (txIsOurs) {
                         JSOutPoint jsoutpt {hash, i, j};
-                        if (mapWallet[hash]->mapNoteData.count(jsoutpt) &&
+                        if (setWitnessedNotes.count(jsoutpt) &&
+                                mapWallet[hash]->mapNoteData.count(jsoutpt) &&
                                 mapWallet[hash]->mapNoteData[jsoutpt].witnessHeight < pindex->nHeight) {
                             CNoteData* nd = &(mapWallet[hash]->mapNoteData[jsoutpt]);
                             if (nd->witnesses.size() > 0) {
@@ -790,19 +900,17 @@ void CWallet::IncrementNoteWitnesses(const CBlockIndex* pindex,
         }
 
         // Update witness heights
-        for (auto& wtxItem : mapWallet)
-        {
-            for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
-                CNoteData* nd = &(item.second);
-                if (nd->witnessHeight < pindex->nHeight) {
-                    nd->witnessHeight = pindex->nHeight;
-                    // Check the validity of the cache
-                    // See earlier comment about validity.
-                    assert(nWitnessCacheSize >= nd->witnesses.size());
-                }
+        for (CNoteData* nd : vNotes) {
+            if (nd->witnessHeight < pindex->nHeight) {
+                nd->witnessHeight = pindex->nHeight;
+                // Check the validity of the cache
+                // See earlier comment about validity.
+                assert(nWitnessCacheSize >= nd->witnesses.size());
             }
         }
 
+        PruneSpentNoteWitnesses();
+
         // For performance reasons, we write out the witness cache in
         // CWallet::SetBestChain() (which also ensures that overall consistency
         // of the wallet.dat is maintained).
@@ -813,47 +921,40 @@ void CWallet::DecrementNoteWitnesses(const CBlockIndex* pindex)
 {
     {
         LOCK(cs_wallet);
-        for (auto& wtxItem : mapWallet)
-        {
-            for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
-                CNoteData* nd = &(item.second);
-                // Only increment witnesses that are not above the current height
-                if (nd->witnessHeight <= pindex->nHeight) {
-                    // Check the validity of the cache
-                    // See comment below (this would be invalid if there was a
-                    // prior decrement).
-                    assert(nWitnessCacheSize >= nd->witnesses.size());
-                    // Witnesses being decremented should always be either -1
-                    // (never incremented or decremented) or equal to pindex
-                    assert((nd->witnessHeight == -1) ||
-                           (nd->witnessHeight == pindex->nHeight));
-                    if (nd->witnesses.size() > 0) {
-                        nd->witnesses.pop_front();
-                    }
-                    // pindex is the block being removed, so the new witness cache
-                    // height is one below it.
-                    nd->witnessHeight = pindex->nHeight - 1;
+        const std::vector<CNoteData*> vNotes = GetWitnessedNotes();
+        for (CNoteData* nd : vNotes) {
+            // Only increment witnesses that are not above the current height
+            if (nd->witnessHeight <= pindex->nHeight) {
+                // Check the validity of the cache
+                // See comment below (this would be invalid if there was a
+                // prior decrement).
+                assert(nWitnessCacheSize >= nd->witnesses.size());
+                // Witnesses being decremented should always be either -1
+                // (never incremented or decremented) or equal to pindex
+                assert((nd->witnessHeight == -1) ||
+                       (nd->witnessHeight == pindex->nHeight));
+                if (nd->witnesses.size() > 0) {
+                    nd->witnesses.pop_front();
                 }
+                // pindex is the block being removed, so the new witness cache
+                // height is one below it.
+                nd->witnessHeight = pindex->nHeight - 1;
             }
         }
         nWitnessCacheSize -= 1;
-        for (auto& wtxItem : mapWallet)
-        {
-            for (mapNoteData_t::value_type& item : wtxItem.second->mapNoteData) {
-                CNoteData* nd = &(item.second);
-                // Check the validity of the cache
-                // Technically if there are notes witnessed above the current
-                // height, their cache will now be invalid (relative to the new
-                // value of nWitnessCacheSize). However, this would only occur
-                // during a reindex, and by the time the reindex reaches the tip
-                // of the chain again, the existing witness caches will be valid
-                // again.
-                // We don't set nWitnessCacheSize to zero at the start of the
-                // reindex because the on-disk blocks had already resulted in a
-                // chain that didn't trigger the assertion below.
-                if (nd->witnessHeight < pindex->nHeight) {
-                    assert(nWitnessCacheSize >= nd->witnesses.size());
-                }
+        for (CNoteData* nd : vNotes) {
+            // Check the validity of the cache
+            // Technically if there are notes witnessed above the current
+            // height, their cache will now be invalid (relative to the new
+            // value of nWitnessCacheSize). However, this would only occur
+            // during a reindex, and by the time the reindex reaches the tip
+            // of the chain again, the existing witness caches will be valid
+            // again.
+            // We don't set nWitnessCacheSize to zero at the start of the
+            // reindex because the on-disk blocks had already resulted in a
+            // chain that didn't trigger the assertion below.
+            if (nd->witnessHeight < pindex->nHeight) {
+                assert(nWitnessCacheSize >= nd->witnesses.size());
             }
         }
         // TODO: If nWitnessCache is zero, we need to regenerate the caches (#1302)
@@ -960,7 +1061,9 @@ int64_t CWallet::IncOrderPosNext(CWalletDB *pwalletdb)
 {
     AssertLockHeld(cs_wallet); // nOrderPosNext
     int64_t nRet = nOrderPosNext++;
-    if (pwalletdb) {
+    if (fBlockSyncInProgress) {
+        // written with the other changes of the block
+    } else if (pwalletdb) {
         pwalletdb->WriteOrderPosNext(nOrderPosNext);
     } else {
         CWalletDB(strWalletFile).WriteOrderPosNext(nOrderPosNext);
@@ -1020,8 +1123,11 @@ void CWallet::MarkDirty()
 {
     {
         LOCK(cs_wallet);
-        for (auto& item: mapWallet)
+        // the keys may have changed too, which outputs are ours with them
+        for (auto& item: mapWallet) {
             item.second->MarkDirty();
+            setUnspentTxs.insert(setUnspentTxs.end(), item.first);
+        }
     }
 }
 
@@ -1093,7 +1199,10 @@ bool CWallet::AddToWallet(const CWalletTransactionBase& wtxIn, bool fFromLoadWal
         wtx.BindWallet(this);
         wtxOrdered.insert(make_pair(wtx.nOrderPos, TxPair(&wtx, (CAccountingEntry*)0)));
         UpdateNullifierNoteMapWithTx(*(mapWallet[hash]));
+        AddToWitnessedNotes(wtx);
         AddToSpends(hash);
+        // the keys and the spending objects may not be loaded yet, AvailableCoins() sorts it out
+        setUnspentTxs.insert(hash);
     }
     else
     {
@@ -1156,6 +1265,7 @@ bool CWallet::AddToWallet(const CWalletTransactionBase& wtxIn, bool fFromLoadWal
                              wtxIn.hashBlock.ToString());
             }
             AddToSpends(hash);
+            setUnspentTxs.insert(hash);
         }
 
         bool fUpdated = false;
@@ -1189,14 +1299,19 @@ bool CWallet::AddToWallet(const CWalletTransactionBase& wtxIn, bool fFromLoadWal
 
             wtx.bwtMaturityDepth = wtxIn.bwtMaturityDepth;
         }
+        // after the merge, which may have added notes
+        AddToWitnessedNotes(wtx);
 
         //// debug print
         LogPrintf("AddToWallet %s  %s%s\n", wtxIn.getTxBase()->GetHash().ToString(), (fInsertedNew ? "new" : ""), (fUpdated ? "update" : ""));
 
-        // Write to disk
-        if (fInsertedNew || fUpdated)
-            if (!wtx.WriteToDisk(pwalletdb))
+        // Write to disk, with the other changes of the block during its updates
+        if (fInsertedNew || fUpdated) {
+            if (fBlockSyncInProgress)
+                setBlockSyncTxs.insert(hash);
+            else if (!wtx.WriteToDisk(pwalletdb))
                 return false;
+        }
 
         // Break debit/credit balance caches:
         wtx.MarkDirty();
@@ -1273,6 +1388,10 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransactionBase& obj, const CBlock
                 if (pblock)
                     sobj->SetMerkleBranch(*pblock);
  
+                // the updates about a block are written together once over
+                if (fBlockSyncInProgress)
+                    return AddToWallet(*sobj, false, NULL);
+
                 // Do not flush the wallet here for performance reasons
                 // this is safe, as in case of a crash, we rescan the necessary blocks on startup through our SetBestChain-mechanism
                 CWalletDB walletdb(strWalletFile, "r+", false);
@@ -1323,7 +1442,10 @@ void CWallet::SyncCertStatusInfo(const CScCertificateStatusUpdateInfo& certStatu
     if (certStatusInfo.bwtState == CScCertificateStatusUpdateInfo::BwtState::BWT_ON)
     {
         mapSidechains[certStatusInfo.scId] = certStatusInfo;
-        walletdb.WriteSidechain(certStatusInfo);
+        if (fBlockSyncInProgress)
+            setBlockSyncSidechains.insert(certStatusInfo.scId);
+        else
+            walletdb.WriteSidechain(certStatusInfo);
     }
 
     std::map<uint256, std::shared_ptr<CWalletTransactionBase>>::iterator itCert = mapWallet.find(certStatusInfo.certHash);
@@ -1342,9 +1464,13 @@ void CWallet::SyncCertStatusInfo(const CScCertificateStatusUpdateInfo& certStatu
     }
    
     itCert->second.get()->bwtAreStripped = (certStatusInfo.bwtState != CScCertificateStatusUpdateInfo::BwtState::BWT_ON);
+    itCert->second->MarkDirty();
+    setUnspentTxs.insert(certStatusInfo.certHash);
 
     // Write to disk
-    if (!itCert->second->WriteToDisk(&walletdb))
+    if (fBlockSyncInProgress)
+        setBlockSyncTxs.insert(certStatusInfo.certHash);
+    else if (!itCert->second->WriteToDisk(&walletdb))
         LogPrintf("%s():%d - ERROR in writing to db\n", __func__, __LINE__);
 }
 
@@ -1372,6 +1498,7 @@ void CWallet::MarkAffectedTransactionsDirty(const CTransactionBase& tx)
         if (mapWallet.count(txin.prevout.hash))
             mapWallet[txin.prevout.hash]->MarkDirty();
     }
+    AddSpentToUnspentTxs(tx);
 
     for (const JSDescription& jsdesc : tx.GetVjoinsplit()) {
         for (const uint256& nullifier : jsdesc.nullifiers) {
@@ -1391,12 +1518,30 @@ void CWallet::EraseFromWallet(const uint256 &hash)
         LOCK(cs_wallet);
         LogPrint("cert", "%s():%d - called for obj[%s]\n", __func__, __LINE__, hash.ToString());
 
-        if (mapWallet.erase(hash))
-            CWalletDB(strWalletFile).EraseWalletTxBase(hash);
+        MAP_WALLET_CONST_IT it = mapWallet.find(hash);
+        if (it == mapWallet.end())
+            return;
+        // the outputs it spent are available again
+        AddSpentToUnspentTxs(*it->second->getTxBase());
+        setUnspentTxs.erase(hash);
+        mapWallet.erase(hash);
+        CWalletDB(strWalletFile).EraseWalletTxBase(hash);
     }
     return;
 }
 
+void CWallet::AddSpentToUnspentTxs(const CTransactionBase& tx)
+{
+    AssertLockHeld(cs_wallet);
+    if (tx.IsCoinBase())
+        return;
+
+    for (const CTxIn& txin : tx.GetVin()) {
+        if (mapWallet.count(txin.prevout.hash))
+            setUnspentTxs.insert(txin.prevout.hash);
+    }
+}
+
 
 /**
  * Returns a nullifier if the SpendingKey is available
@@ -1443,36 +1588,54 @@ std::optional<uint256> CWallet::GetNoteNullifier(const JSDescription& jsdesc,
 mapNoteData_t CWallet::FindMyNotes(const CTransactionBase& tx) const
 {
     LOCK(cs_SpendingKeyStore);
+    return FindMyNotes(tx, mapNoteDecryptors);
+}
+
+mapNoteData_t CWallet::FindMyNotes(const CTransactionBase& tx, const NoteDecryptorMap& decryptors) const
+{
     uint256 hash = tx.GetHash();
 
     mapNoteData_t noteData;
     for (size_t i = 0; i < tx.GetVjoinsplit().size(); i++) {
-        auto hSig = tx.GetVjoinsplit()[i].h_sig(*pzcashParams, tx.GetJoinSplitPubKey());
-        for (uint8_t j = 0; j < tx.GetVjoinsplit()[i].ciphertexts.size(); j++) {
-            for (const NoteDecryptorMap::value_type& item : mapNoteDecryptors) {
-                try {
+        const JSDescription& jsdesc = tx.GetVjoinsplit()[i];
+        auto hSig = jsdesc.h_sig(*pzcashParams, tx.GetJoinSplitPubKey());
+        // Each decryptor tries all the ciphertexts together, sharing the key agreement. As before, a
+        // note belongs to the first decryptor able to decrypt it, and the ones left are not tried
+        // once all the notes are found.
+        std::vector<bool> vFound(jsdesc.ciphertexts.size(), false);
+        size_t nFound = 0;
+        for (const NoteDecryptorMap::value_type& item : decryptors) {
+            if (nFound == jsdesc.ciphertexts.size())
+                break;
+            try {
+                auto plaintexts = item.second.try_decrypt_all(jsdesc.ciphertexts.data(), jsdesc.ciphertexts.size(),
+                                                              jsdesc.ephemeralKey, hSig);
+                for (uint8_t j = 0; j < plaintexts.size(); j++) {
+                    if (vFound[j] || !plaintexts[j])
+                        continue;
                     auto address = item.first;
-                    JSOutPoint jsoutpt {hash, i, j};
-                    auto nullifier = GetNoteNullifier(
-                        tx.GetVjoinsplit()[i],
-                        address,
-                        item.second,
-                        hSig, j);
-                    if (nullifier) {
-                        CNoteData nd {address, *nullifier};
-                        noteData.insert(std::make_pair(jsoutpt, nd));
-                    } else {
-                        CNoteData nd {address};
-                        noteData.insert(std::make_pair(jsoutpt, nd));
+                    auto note = libzcash::NotePlaintext::from_plaintext(*plaintexts[j]).note(address);
+                    // Check note plaintext against note commitment
+                    if (note.cm() != jsdesc.commitments[j])
+                        continue;
+
+                    CNoteData nd {address};
+                    // SpendingKeys are only available if:
+                    // - We have them (this isn't a viewing key)
+                    // - The wallet is unlocked
+                    libzcash::SpendingKey key;
+                    if (GetSpendingKey(address, key)) {
+                        nd.nullifier = note.nullifier(key);
                     }
-                    break;
-                } catch (const note_decryption_failed &err) {
-                    // Couldn't decrypt with this decryptor
-                } catch (const std::exception &exc) {
-                    // Unexpected failure
-                    LogPrintf("FindMyNotes(): Unexpected error while testing decrypt:\n");
-                    LogPrintf("%s\n", exc.what());
+                    JSOutPoint jsoutpt {hash, i, j};
+                    noteData.insert(std::make_pair(jsoutpt, nd));
+                    vFound[j] = true;
+                    nFound++;
                 }
+            } catch (const std::exception &exc) {
+                // Unexpected failure
+                LogPrintf("FindMyNotes(): Unexpected error while testing decrypt:\n");
+                LogPrintf("%s\n", exc.what());
             }
         }
     }
@@ -1638,7 +1801,8 @@ CAmount CWallet::GetDebit(const CTransactionBase& txBase, const isminefilter& fi
 CAmount CWallet::GetCredit(const CWalletTransactionBase& txWalletBase, const isminefilter& filter,
                            bool& fCanBeCached, bool keepImmatureVoutsOnly) const
 {
-    // If al least one vout is immature, result cannot be cached
+    // If al least one vout is not applicable, result cannot be cached. With immature vouts it is cached
+    // until the tip crosses the maturity height (see CWalletTransactionBase::CheckMaturityCache())
     // Sum over mature vouts only or immature vouts only depending on keepImmatureVoutsOnly flag
 
     CAmount nCredit = 0;
@@ -1652,7 +1816,6 @@ CAmount CWallet::GetCredit(const CWalletTransactionBase& txWalletBase, const ism
         }
 
         if (outputMaturity == CCoins::outputMaturity::IMMATURE) {
-            fCanBeCached = false;
             if (!keepImmatureVoutsOnly) continue;
         } else {
             if (keepImmatureVoutsOnly) continue;
@@ -1979,10 +2142,72 @@ void CWallet::WitnessNoteCommitment(std::vector<uint256> commitments,
     }
 }
 
+/** What the rescan threads found in a transaction or certificate, to tell later whether it involves the wallet */
+struct CRescanTxMatch
+{
+    uint256 hash;
+    bool fIsMine;
+    bool fHasNotes;
+    //! the transactions of the outputs spent, and the nullifiers of the notes spent
+    std::vector<uint256> vPrevTxHashes;
+    std::vector<uint256> vNullifiers;
+    //! the nullifiers of the notes of the wallet, when known
+    std::vector<uint256> vNoteNullifiers;
+};
+
+struct CRescanBlockMatch
+{
+    bool fRead = false;
+    bool fHasCommitments = false;
+    std::vector<CRescanTxMatch> vTxMatches;
+};
+
+static void MatchRescanTx(const CWallet& wallet, const NoteDecryptorMap& decryptors, const CTransactionBase& obj,
+                          CRescanBlockMatch& match)
+{
+    CRescanTxMatch txMatch;
+    txMatch.hash = obj.GetHash();
+    txMatch.fIsMine = wallet.IsMine(obj);
+    for (const CTxIn& txin : obj.GetVin())
+        txMatch.vPrevTxHashes.push_back(txin.prevout.hash);
+    for (const JSDescription& jsdesc : obj.GetVjoinsplit()) {
+        txMatch.vNullifiers.insert(txMatch.vNullifiers.end(), jsdesc.nullifiers.begin(), jsdesc.nullifiers.end());
+        match.fHasCommitments |= !jsdesc.commitments.empty();
+    }
+    // the trial decryption, the most of the time of a rescan
+    const mapNoteData_t noteData = wallet.FindMyNotes(obj, decryptors);
+    txMatch.fHasNotes = !noteData.empty();
+    for (const mapNoteData_t::value_type& item : noteData)
+        if (item.second.nullifier)
+            txMatch.vNoteNullifiers.push_back(*item.second.nullifier);
+    match.vTxMatches.push_back(txMatch);
+}
+
+/** Reads a block and matches it against the keys of the wallet, with no lock held */
+static void MatchRescanBlock(const CWallet& wallet, const NoteDecryptorMap& decryptors, const CDiskBlockPos& pos,
+                             CRescanBlockMatch& match)
+{
+    CBlock block;
+    match.fRead = ReadBlockFromDisk(block, pos);
+    if (!match.fRead)
+        return;
+    for (const CTransaction& tx : block.vtx)
+        MatchRescanTx(wallet, decryptors, tx, match);
+    for (const CScCertificate& cert : block.vcert)
+        MatchRescanTx(wallet, decryptors, cert, match);
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
+ *
+ * The blocks are first read and matched against the keys of the wallet by -rescanthreads threads,
+ * in batches of RESCAN_BATCH_BLOCKS, holding no lock: the wallet lock is only taken between the
+ * batches to follow, in height order, the transactions spending the ones found. The blocks are then
+ * connected to the wallet in height order under the locks, reading again only the ones involving
+ * the wallet or with note commitments to witness. The locks are not released in between: the note
+ * witnesses must be incremented block after block, with no tip connected in the middle.
  */
 int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
@@ -1992,99 +2217,131 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 
     CBlockIndex* pindex = pindexStart;
     CBlockIndex* pindexLast = pindexStart;
+    double dProgressStart = 0.0, dProgressTip = 0.0;
     {
-        LOCK2(cs_main, cs_wallet);
+        LOCK(cs_main);
 
         // no need to read and scan block, if block was created before
         // our wallet birthday (as adjusted for block time variability)
         while (pindex && nTimeFirstKey && (pindex->GetBlockTime() < (nTimeFirstKey - TIMESTAMP_WINDOW)))
             pindex = chainActive.Next(pindex);
 
-        ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
-        double dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
-        while (pindex)
-        {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+        dProgressStart = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false);
+        dProgressTip = Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), chainActive.Tip(), false);
+    }
+    ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
 
-            CBlock block;
-            ReadBlockFromDisk(block, pindex);
-  
-            for(const CTransaction& tx: block.vtx)
-            {
-                if (AddToWalletIfInvolvingMe(tx, &block, -1, fUpdate))
-                    ret++;
+    NoteDecryptorMap decryptors;
+    {
+        LOCK(cs_SpendingKeyStore);
+        decryptors = mapNoteDecryptors;
+    }
+    int nThreads = GetArg("-rescanthreads", DEFAULT_RESCAN_THREADS);
+    if (nThreads <= 0)
+        nThreads = GetNumCores();
+
+    // The blocks matched, with whether they must be read again to be connected to the wallet
+    std::vector<std::pair<CBlockIndex*, bool> > vMatched;
+    std::set<uint256> setFoundTxs, setFoundNullifiers;
+    CBlockIndex* pindexNext = pindex;
+    while (pindexNext)
+    {
+        std::vector<CBlockIndex*> vBatch;
+        std::vector<CDiskBlockPos> vPos;
+        {
+            LOCK(cs_main);
+            // a block reorganized away ends the matching, the blocks from the fork are scanned afterwards
+            if (!vMatched.empty())
+                pindexNext = chainActive.Next(vMatched.back().first);
+            for (; pindexNext && vBatch.size() < RESCAN_BATCH_BLOCKS; pindexNext = chainActive.Next(pindexNext)) {
+                vBatch.push_back(pindexNext);
+                vPos.push_back(pindexNext->GetBlockPos());
             }
+        }
+        if (vBatch.empty())
+            break;
+
+        std::vector<CRescanBlockMatch> vMatches(vBatch.size());
+        std::atomic<size_t> nNextBlock(0);
+        auto matcher = [&]() {
+            for (size_t n = nNextBlock++; n < vPos.size(); n = nNextBlock++)
+                MatchRescanBlock(*this, decryptors, vPos[n], vMatches[n]);
+        };
+        boost::thread_group threadGroup;
+        for (int i = 1; i < nThreads; i++)
+            threadGroup.create_thread(matcher);
+        matcher();
+        threadGroup.join_all();
 
-            std::set<uint256> visitedScIds;
-            // It's safe to process certs backward despite possible spending dependencies of certs in block
-            // since at this stage no transaction creation is allowed
-            for(auto itCert = block.vcert.rbegin(); itCert != block.vcert.rend(); ++itCert)
+        {
+            LOCK(cs_wallet);
+            for (size_t n = 0; n < vBatch.size(); n++)
             {
-                // The ReadSidechain() call can fail if no certificates for that sc are currently in the wallet.
-                // This can happen for instance when we are called from an importwallet rpc cmd or when the
-                // node is started after a while.
-                bool prevScDataAvailable = false;
-                CScCertificateStatusUpdateInfo prevScData;
-                if (ReadSidechain(itCert->GetScId(), prevScData))
+                // a superset of the ones AddToWalletIfInvolvingMe adds, which decides when they are connected
+                bool fInvolvesMe = false;
+                for (const CRescanTxMatch& txMatch : vMatches[n].vTxMatches)
                 {
-                     prevScDataAvailable = true;
-                }
-
-                int nHeight = pindex->nHeight;
-                CSidechain sidechain;
-                assert(pcoinsTip->GetSidechain(itCert->GetScId(), sidechain));
-
-                bool bTopQualityCert = visitedScIds.count(itCert->GetScId()) == 0 || sidechain.isNonCeasing();
-                visitedScIds.insert(itCert->GetScId());
-
-                int bwtMaxDepth = sidechain.GetCertMaturityHeight(itCert->epochNumber, pindex->nHeight) - nHeight;
+                    bool fCandidate = txMatch.fIsMine || txMatch.fHasNotes || mapWallet.count(txMatch.hash);
+                    for (const uint256& hash : txMatch.vPrevTxHashes)
+                        fCandidate = fCandidate || mapWallet.count(hash) || setFoundTxs.count(hash);
+                    for (const uint256& nullifier : txMatch.vNullifiers)
+                        fCandidate = fCandidate || mapNullifiersToNotes.count(nullifier) || setFoundNullifiers.count(nullifier);
+                    if (!fCandidate)
+                        continue;
 
-                if (AddToWalletIfInvolvingMe(*itCert, &block, bwtMaxDepth, fUpdate))
-                {
-                    ret++;
-                    // this call will add sc data into the wallet
-                    SyncCertStatusInfo(CScCertificateStatusUpdateInfo(itCert->GetScId(), itCert->GetHash(),
-                                                                        itCert->epochNumber, itCert->quality,
-                                                                        bTopQualityCert ? CScCertificateStatusUpdateInfo::BwtState::BWT_ON:
-                                                                                                            CScCertificateStatusUpdateInfo::BwtState::BWT_OFF));
-
-                    if (prevScDataAvailable)
-                    {
-                        if (bTopQualityCert && (prevScData.certEpoch == itCert->epochNumber) && (prevScData.certQuality < itCert->quality))
-                        {
-                            SyncCertStatusInfo(CScCertificateStatusUpdateInfo(prevScData.scId, prevScData.certHash,
-                                                                            prevScData.certEpoch, prevScData.certQuality,
-                                                                            CScCertificateStatusUpdateInfo::BwtState::BWT_OFF));
-                        }
-                    }
+                    fInvolvesMe = true;
+                    setFoundTxs.insert(txMatch.hash);
+                    setFoundNullifiers.insert(txMatch.vNoteNullifiers.begin(), txMatch.vNoteNullifiers.end());
                 }
+                // a block which could not be read is read again, as it always was
+                vMatched.push_back(std::make_pair(vBatch[n], fInvolvesMe || vMatches[n].fHasCommitments || !vMatches[n].fRead));
             }
+        }
+
+        CBlockIndex* pindexBatch = vBatch.back();
+        if (dProgressTip - dProgressStart > 0.0)
+            ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindexBatch, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
+        if (GetTime() >= nNow + 60) {
+            nNow = GetTime();
+            LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindexBatch->nHeight, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindexBatch));
+        }
+    }
 
-            ZCIncrementalMerkleTree tree;
-            // This should never fail: we should always be able to get the tree
-            // state on the path to the tip of our chain
-            assert(pcoinsTip->GetAnchorAt(pindex->hashAnchor, tree));
-            // Increment note witness caches
-            IncrementNoteWitnesses(pindex, &block, tree);
+    {
+        LOCK2(cs_main, cs_wallet);
 
+        LogPrint("db", "%s():%d - %u blocks matched, %u transactions found\n", __func__, __LINE__, vMatched.size(), setFoundTxs.size());
+        const CBlockIndex* pindexConnected = nullptr;
+        for (const std::pair<CBlockIndex*, bool>& matched : vMatched)
+        {
+            if (!chainActive.Contains(matched.first))
+                break;
+            CBlock block;
+            if (matched.second)
+                ReadBlockFromDisk(block, matched.first);
+            ret += RescanBlock(matched.first, block, fUpdate);
+            pindexConnected = matched.first;
             // will be the pindex of last rescanned block once rescan is finished
+            pindexLast = matched.first;
+        }
+
+        // The blocks connected to the tip or reorganized during the matching
+        pindex = pindexConnected ? chainActive.Next(pindexConnected) : pindex;
+        if (pindex && !chainActive.Contains(pindex))
+            pindex = chainActive.Next(chainActive.FindFork(pindex));
+        while (pindex)
+        {
+            CBlock block;
+            ReadBlockFromDisk(block, pindex);
+            ret += RescanBlock(pindex, block, fUpdate);
             pindexLast = pindex;
             pindex = chainActive.Next(pindex);
-            if (pindex)
-            {
-                if (GetTime() >= nNow + 60) {
-                    nNow = GetTime();
-                    LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex));
-                }
-            }
         }
 
         // Once processed all blocks till chainActive.Tip(), void last cert of ceased sidechains
-        std::set<uint256> allScIds;
-        pcoinsTip->GetScIds(allScIds);
-        for(const auto& scId: allScIds)
+        std::set<uint256> ceasedScIds;
+        pcoinsTip->GetScIdsByCeasingHeight(0, pcoinsTip->GetHeight(), ceasedScIds);
+        for(const auto& scId: ceasedScIds)
         {
             CSidechain sidechain;
             assert(pcoinsTip->GetSidechain(scId, sidechain));
@@ -2117,6 +2374,72 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
     return ret;
 }
 
+int CWallet::RescanBlock(const CBlockIndex* pindex, const CBlock& block, bool fUpdate)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+    int ret = 0;
+
+    for(const CTransaction& tx: block.vtx)
+    {
+        if (AddToWalletIfInvolvingMe(tx, &block, -1, fUpdate))
+            ret++;
+    }
+
+    std::set<uint256> visitedScIds;
+    // It's safe to process certs backward despite possible spending dependencies of certs in block
+    // since at this stage no transaction creation is allowed
+    for(auto itCert = block.vcert.rbegin(); itCert != block.vcert.rend(); ++itCert)
+    {
+        // The ReadSidechain() call can fail if no certificates for that sc are currently in the wallet.
+        // This can happen for instance when we are called from an importwallet rpc cmd or when the
+        // node is started after a while.
+        bool prevScDataAvailable = false;
+        CScCertificateStatusUpdateInfo prevScData;
+        if (ReadSidechain(itCert->GetScId(), prevScData))
+        {
+             prevScDataAvailable = true;
+        }
+
+        int nHeight = pindex->nHeight;
+        CSidechain sidechain;
+        assert(pcoinsTip->GetSidechain(itCert->GetScId(), sidechain));
+
+        bool bTopQualityCert = visitedScIds.count(itCert->GetScId()) == 0 || sidechain.isNonCeasing();
+        visitedScIds.insert(itCert->GetScId());
+
+        int bwtMaxDepth = sidechain.GetCertMaturityHeight(itCert->epochNumber, pindex->nHeight) - nHeight;
+
+        if (AddToWalletIfInvolvingMe(*itCert, &block, bwtMaxDepth, fUpdate))
+        {
+            ret++;
+            // this call will add sc data into the wallet
+            SyncCertStatusInfo(CScCertificateStatusUpdateInfo(itCert->GetScId(), itCert->GetHash(),
+                                                                itCert->epochNumber, itCert->quality,
+                                                                bTopQualityCert ? CScCertificateStatusUpdateInfo::BwtState::BWT_ON:
+                                                                                                    CScCertificateStatusUpdateInfo::BwtState::BWT_OFF));
+
+            if (prevScDataAvailable)
+            {
+                if (bTopQualityCert && (prevScData.certEpoch == itCert->epochNumber) && (prevScData.certQuality < itCert->quality))
+                {
+                    SyncCertStatusInfo(CScCertificateStatusUpdateInfo(prevScData.scId, prevScData.certHash,
+                                                                    prevScData.certEpoch, prevScData.certQuality,
+                                                                    CScCertificateStatusUpdateInfo::BwtState::BWT_OFF));
+                }
+            }
+        }
+    }
+
+    ZCIncrementalMerkleTree tree;
+    // This should never fail: we should always be able to get the tree
+    // state on the path to the tip of our chain
+    assert(pcoinsTip->GetAnchorAt(pindex->hashAnchor, tree));
+    // Increment note witness caches; a block not read again has no commitments
+    IncrementNoteWitnesses(pindex, &block, tree);
+    return ret;
+}
+
 void CWallet::ReacceptWalletTransactions()
 {
     // If transactions aren't being broadcasted, don't let them into local mempool either
@@ -2320,14 +2643,48 @@ CCoins::outputMaturity CWalletTransactionBase::IsOutputMature(unsigned int vOutP
         return CCoins::outputMaturity::MATURE;
 }
 
-CAmount CWalletTransactionBase::GetCredit(const isminefilter& filter) const
+int CWalletTransactionBase::GetMaturityHeight() const
 {
-    int64_t credit = 0;
-    if ((this->getTxBase()->IsCoinBase() || this->getTxBase()->IsCertificate()) && this->HasImmatureOutputs())
-    {
+    if (!getTxBase()->IsCoinBase() && !getTxBase()->IsCertificate())
+        return -1;
+
+    // immature as long as the depth is not over the maturity depth, see IsOutputMature()
+    int nDepth = GetDepthInMainChain();
+    if (nDepth <= 0)
+        return -1;
+    int nBlockHeight = chainActive.Height() - nDepth + 1;
+
+    if (getTxBase()->IsCoinBase())
+        return nBlockHeight + COINBASE_MATURITY;
+
+    if (bwtAreStripped || bwtMaturityDepth < 0)
+        return -1;
+    return nBlockHeight + bwtMaturityDepth;
+}
+
+void CWalletTransactionBase::CheckMaturityCache() const
+{
+    if (!getTxBase()->IsCoinBase() && !getTxBase()->IsCertificate())
+        return;
+
+    int nMaturityHeight = GetMaturityHeight();
+    bool fMaturityReached = nMaturityHeight >= 0 && chainActive.Height() >= nMaturityHeight;
+    if (nMaturityHeight != nCachedMaturityHeight || fMaturityReached != fCachedMaturityReached) {
         fCreditCached = false;
+        fImmatureCreditCached = false;
+        fAvailableCreditCached = false;
         fWatchCreditCached = false;
+        fImmatureWatchCreditCached = false;
+        fAvailableWatchCreditCached = false;
+        nCachedMaturityHeight = nMaturityHeight;
+        fCachedMaturityReached = fMaturityReached;
     }
+}
+
+CAmount CWalletTransactionBase::GetCredit(const isminefilter& filter) const
+{
+    int64_t credit = 0;
+    CheckMaturityCache();
 
     if (filter & ISMINE_SPENDABLE) {
         // It used to be that GetBalance can assume transactions in mapWallet won't change
@@ -2353,8 +2710,9 @@ CAmount CWalletTransactionBase::GetCredit(const isminefilter& filter) const
 
 CAmount CWalletTransactionBase::GetImmatureCredit(bool fUseCache) const
 {
-    if ((this->getTxBase()->IsCoinBase() || this->getTxBase()->IsCertificate()) && this->HasImmatureOutputs())
+    if (this->getTxBase()->IsCoinBase() || this->getTxBase()->IsCertificate())
     {
+        CheckMaturityCache();
         if (fUseCache && fImmatureCreditCached)
             return nImmatureCreditCached;
 
@@ -2367,8 +2725,9 @@ CAmount CWalletTransactionBase::GetImmatureCredit(bool fUseCache) const
 
 CAmount CWalletTransactionBase::GetImmatureWatchOnlyCredit(const bool& fUseCache) const
 {
-    if ((this->getTxBase()->IsCoinBase() || this->getTxBase()->IsCertificate()) && this->HasImmatureOutputs())
+    if (this->getTxBase()->IsCoinBase() || this->getTxBase()->IsCertificate())
     {
+        CheckMaturityCache();
         if (fUseCache && fImmatureWatchCreditCached)
             return nImmatureWatchCreditCached;
 
@@ -2384,11 +2743,7 @@ CAmount CWalletTransactionBase::GetAvailableCredit(bool fUseCache) const
     if (pwallet == 0)
         return 0;
 
-    if ((this->getTxBase()->IsCoinBase() || this->getTxBase()->IsCertificate()) && this->HasImmatureOutputs())
-    {
-        fAvailableCreditCached = false;
-    }
-
+    CheckMaturityCache();
     if (fUseCache && fAvailableCreditCached)
         return nAvailableCreditCached;
 
@@ -2401,8 +2756,8 @@ CAmount CWalletTransactionBase::GetAvailableCredit(bool fUseCache) const
             continue;
         }
 
+        // cached until the maturity as well
         if (outputMaturity == CCoins::outputMaturity::IMMATURE) {
-            fAvailableCreditCached = false;
             continue;
         }
 
@@ -2425,11 +2780,7 @@ CAmount CWalletTransactionBase::GetAvailableWatchOnlyCredit(const bool& fUseCach
     if (pwallet == 0)
         return 0;
 
-    if ((this->getTxBase()->IsCoinBase() || this->getTxBase()->IsCertificate()) && this->HasImmatureOutputs())
-    {
-        fAvailableWatchCreditCached = false;
-    }
-
+    CheckMaturityCache();
     if (fUseCache && fAvailableWatchCreditCached)
         return nAvailableWatchCreditCached;
 
@@ -2442,8 +2793,8 @@ CAmount CWalletTransactionBase::GetAvailableWatchOnlyCredit(const bool& fUseCach
             continue;
         }
 
+        // cached until the maturity as well
         if (outputMaturity == CCoins::outputMaturity::IMMATURE) {
-            fAvailableWatchCreditCached = false;
             continue;
         }
 
@@ -2465,6 +2816,7 @@ CAmount CWalletTransactionBase::GetAvailableWatchOnlyCredit(const bool& fUseCach
 void CWalletTransactionBase::MarkDirty()
 {
     fCreditCached = false;
+    fImmatureCreditCached = false;
     fAvailableCreditCached = false;
     fWatchDebitCached = false;
     fWatchCreditCached = false;
@@ -2506,6 +2858,8 @@ void CWalletTransactionBase::Reset(const CWallet* pwalletIn)
     nAvailableWatchCreditCached = 0;
     nImmatureWatchCreditCached = 0;
     nChangeCached = 0;
+    nCachedMaturityHeight = -1;
+    fCachedMaturityReached = false;
     nOrderPos = -1;
 
     bwtMaturityDepth = -1;
@@ -2856,8 +3210,15 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (MAP_WALLET_CONST_IT it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (std::set<uint256>::iterator itUnspent = setUnspentTxs.begin(); itUnspent != setUnspentTxs.end();)
         {
+            MAP_WALLET_CONST_IT it = mapWallet.find(*itUnspent);
+            if (it == mapWallet.end()) {
+                itUnspent = setUnspentTxs.erase(itUnspent);
+                continue;
+            }
+            ++itUnspent;
+
             const uint256& wtxid = it->first;
             const CWalletTransactionBase* pcoin = (*it).second.get();
             if (!CheckFinalTx(*pcoin->getTxBase()))
@@ -2872,11 +3233,13 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
             if (!pcoin->HasMatureOutputs())
                 continue;
 
+            bool fHasUnspent = false;
             for (unsigned int voutPos = 0; voutPos < pcoin->getTxBase()->GetVout().size(); voutPos++) {
                 isminetype mine = IsMine(pcoin->getTxBase()->GetVout()[voutPos]);
-                if (!IsSpent(wtxid, voutPos) &&
-                     mine != ISMINE_NO &&
-                    !IsLockedCoin((*it).first, voutPos) &&
+                if (mine == ISMINE_NO || IsSpent(wtxid, voutPos))
+                    continue;
+                fHasUnspent = true;
+                if (!IsLockedCoin((*it).first, voutPos) &&
                     (pcoin->getTxBase()->GetVout()[voutPos].nValue > 0 || fIncludeZeroValue) &&
                     (!coinControl || !coinControl->HasSelected() ||
                       coinControl->fAllowOtherInputs || coinControl->IsSelected((*it).first, voutPos)
@@ -2905,12 +3268,14 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
                 }
 
             }
+            if (!fHasUnspent)
+                setUnspentTxs.erase(wtxid);
         }
     }
 }
 
 static void ApproximateBestSubset(
-    vector<pair<CAmount, pair<const CWalletTransactionBase*,unsigned int> > >vValue, const CAmount& nTotalLower, const CAmount& nTargetValue,
+    const vector<pair<CAmount, pair<const CWalletTransactionBase*,unsigned int> > >& vValue, const CAmount& nTotalLower, const CAmount& nTargetValue,
     vector<char>& vfBest, CAmount& nBest, int iterations = 1000)
 {
     vector<char> vfIncluded;
@@ -2956,7 +3321,64 @@ static void ApproximateBestSubset(
     }
 }
 
-bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, vector<COutput> vCoins,
+/**
+ * Searches by branch and bound a subset of vValue, sorted by decreasing value, whose total is at
+ * least nTargetValue and exceeds it by no more than nMaxExcess, so that no change is needed. The
+ * subset with the lowest excess is returned, stopping at the first exact match or after
+ * BNB_MAX_TRIES steps. A branch is cut as soon as it exceeds the window or cannot reach the target
+ * with the coins left, and a coin is not tried in place of an equal one just left out.
+ */
+static bool SelectCoinsBnB(
+    const vector<pair<CAmount, pair<const CWalletTransactionBase*,unsigned int> > >& vValue, const CAmount& nTotalLower,
+    const CAmount& nTargetValue, const CAmount& nMaxExcess, vector<char>& vfBest, CAmount& nBest)
+{
+    static const int BNB_MAX_TRIES = 100000;
+
+    vector<char> vfIncluded(vValue.size(), false);
+    CAmount nTotal = 0;
+    // the total of the coins not decided yet, the ones from pos onwards
+    CAmount nRemaining = nTotalLower;
+    CAmount nBestExcess = std::numeric_limits<CAmount>::max();
+    size_t pos = 0;
+
+    for (int nTries = 0; nTries < BNB_MAX_TRIES; nTries++)
+    {
+        bool fBacktrack = false;
+        if (nTotal + nRemaining < nTargetValue || nTotal > nTargetValue + nMaxExcess) {
+            fBacktrack = true;
+        } else if (nTotal >= nTargetValue) {
+            if (nTotal - nTargetValue < nBestExcess) {
+                nBestExcess = nTotal - nTargetValue;
+                nBest = nTotal;
+                vfBest = vfIncluded;
+                if (nBestExcess == 0)
+                    break;
+            }
+            fBacktrack = true;
+        }
+
+        if (fBacktrack) {
+            // leave out the last coin included, giving back the ones undecided after it
+            while (pos > 0 && !vfIncluded[pos - 1])
+                nRemaining += vValue[--pos].first;
+            if (pos == 0)
+                break;
+            vfIncluded[pos - 1] = false;
+            nTotal -= vValue[pos - 1].first;
+        } else if (pos > 0 && !vfIncluded[pos - 1] && vValue[pos].first == vValue[pos - 1].first) {
+            // the same subsets as with the equal coin just left out
+            nRemaining -= vValue[pos++].first;
+        } else {
+            vfIncluded[pos] = true;
+            nTotal += vValue[pos].first;
+            nRemaining -= vValue[pos++].first;
+        }
+    }
+
+    return nBestExcess != std::numeric_limits<CAmount>::max();
+}
+
+bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, const vector<COutput>& vCoins,
                                  set<pair<const CWalletTransactionBase*,unsigned int> >& setCoinsRet, CAmount& nValueRet) const
 {
     setCoinsRet.clear();
@@ -2969,18 +3391,27 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int
     vector<pair<CAmount, pair<const CWalletTransactionBase*,unsigned int> > > vValue;
     CAmount nTotalLower = 0;
 
-    std::shuffle(vCoins.begin(), vCoins.end(), ZcashRandomEngine());
-
-    BOOST_FOREACH(const COutput &output, vCoins)
+    // the candidates are shuffled by reference, the coins themselves are not copied
+    vector<const COutput*> vCandidates;
+    vCandidates.reserve(vCoins.size());
+    for (const COutput& output : vCoins)
     {
         if (!output.fSpendable)
             continue;
 
-        const CWalletTransactionBase *pcoin = output.tx;
-
-        if (output.nDepth < (pcoin->IsFromMe(ISMINE_ALL) ? nConfMine : nConfTheirs))
+        if (output.nDepth < (output.tx->IsFromMe(ISMINE_ALL) ? nConfMine : nConfTheirs))
             continue;
 
+        vCandidates.push_back(&output);
+    }
+
+    std::shuffle(vCandidates.begin(), vCandidates.end(), ZcashRandomEngine());
+
+    for (const COutput* poutput : vCandidates)
+    {
+        const COutput& output = *poutput;
+        const CWalletTransactionBase *pcoin = output.tx;
+
         CAmount n = pcoin->getTxBase()->GetVout()[output.pos].nValue;
 
         pair<CAmount,pair<const CWalletTransactionBase*,unsigned int> > coin = make_pair(n,make_pair(pcoin, output.pos));
@@ -3021,11 +3452,27 @@ bool CWallet::SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int
         return true;
     }
 
-    // Solve subset sum by stochastic approximation
     sort(vValue.rbegin(), vValue.rend(), CompareValueOnly());
     vector<char> vfBest;
     CAmount nBest;
 
+    // A subset needing no change, up to the dust CreateTransaction would add to the fee anyway
+    const CAmount nMaxExcess = CTxOut(0, GetScriptForDestination(CKeyID(), false)).GetDustThreshold(::minRelayTxFee) - 1;
+    if (SelectCoinsBnB(vValue, nTotalLower, nTargetValue, nMaxExcess, vfBest, nBest))
+    {
+        for (unsigned int i = 0; i < vValue.size(); i++)
+            if (vfBest[i])
+            {
+                setCoinsRet.insert(vValue[i].second);
+                nValueRet += vValue[i].first;
+            }
+
+        LogPrint("selectcoins", "SelectCoins() changeless subset of %d coins: total %s\n",
+            setCoinsRet.size(), FormatMoney(nBest));
+        return true;
+    }
+
+    // Solve subset sum by stochastic approximation
     ApproximateBestSubset(vValue, nTotalLower, nTargetValue, vfBest, nBest, 1000);
     if (nBest != nTargetValue && nTotalLower >= nTargetValue + CENT)
         ApproximateBestSubset(vValue, nTotalLower, nTargetValue + CENT, vfBest, nBest, 1000);
@@ -3833,7 +4280,8 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         if (IsLocked())
             return false;
 
-        CWalletDB walletdb(strWalletFile);
+        // not flushed on close, MaybeFlushWalletDB takes care of it
+        CWalletDB walletdb(strWalletFile, "r+", false);
 
         // Top up key pool
         unsigned int nTargetSize;
@@ -3842,16 +4290,20 @@ bool CWallet::TopUpKeyPool(unsigned int kpSize)
         else
             nTargetSize = max(GetArg("-keypool", 100), (int64_t) 0);
 
+        // the keys and the pool entries are written in a single database transaction
+        bool fTxn = setKeyPool.size() < (nTargetSize + 1) && walletdb.TxnBegin();
         while (setKeyPool.size() < (nTargetSize + 1))
         {
             int64_t nEnd = 1;
             if (!setKeyPool.empty())
                 nEnd = *(--setKeyPool.end()) + 1;
-            if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey())))
+            if (!walletdb.WritePool(nEnd, CKeyPool(GenerateNewKey(&walletdb))))
                 throw runtime_error("TopUpKeyPool(): writing generated key failed");
             setKeyPool.insert(nEnd);
             LogPrintf("keypool added key %d, size=%u\n", nEnd, setKeyPool.size());
         }
+        if (fTxn && !walletdb.TxnCommit())
+            throw runtime_error("TopUpKeyPool(): committing generated keys failed");
     }
     return true;
 }
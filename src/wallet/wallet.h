@@ -62,6 +62,10 @@ static const unsigned int MAX_FREE_TRANSACTION_CREATE_SIZE = 1000;
 //  Should be large enough that we can expect not to reorg beyond our cache
 //  unless there is some exceptional network disruption.
 static const unsigned int WITNESS_CACHE_SIZE = COINBASE_MATURITY;
+//! -rescanthreads default, 0 meaning as many as the cores
+static const int DEFAULT_RESCAN_THREADS = 0;
+//! Blocks read and matched by the rescan threads between two takes of the wallet lock
+static const unsigned int RESCAN_BATCH_BLOCKS = 100;
 
 class CBlockIndex;
 class CCoinControl;
@@ -341,6 +345,13 @@ private:
     mutable CAmount nImmatureWatchCreditCached;
     mutable CAmount nAvailableWatchCreditCached;
     mutable CAmount nChangeCached;
+    // The maturity height, and whether the tip had reached it, when the credits were cached: the
+    // credits of a coinbase or a certificate with immature outputs stay cached until the tip crosses it
+    mutable int nCachedMaturityHeight;
+    mutable bool fCachedMaturityReached;
+
+    //! Drops the credits cached on the other side of the maturity height, an O(1) check of the depth
+    void CheckMaturityCache() const;
 public:
     void SetfDebitCached(bool val) {fDebitCached = val;} //for UTs only
     void SetnDebitCached(CAmount val) {nDebitCached = val;} //for UTs only
@@ -397,6 +408,9 @@ public:
     bool HasImmatureOutputs() const;
     bool HasMatureOutputs() const;
     CCoins::outputMaturity IsOutputMature(unsigned int pos) const;
+    //! The height of the tip at which the outputs of a coinbase or the backward transfers of a certificate
+    //! in the chain become mature, and before which they are immature again; -1 if they have none
+    int GetMaturityHeight() const;
     CAmount GetCredit(const isminefilter& filter) const;
     CAmount GetImmatureCredit(bool fUseCache=true) const;
     CAmount GetImmatureWatchOnlyCredit(const bool& fUseCache=true) const;
@@ -738,6 +752,18 @@ private:
 
     CWalletDB *pwalletdbEncryption;
 
+    /*
+     * Between BlockSyncBegin() and ChainTip(), the wallet objects and the sidechains changed by the updates
+     * about a block, written together in a single database transaction once they are over rather than one
+     * write each. A crash before loses nothing the rescan from the best block locator does not recover.
+     */
+    bool fBlockSyncInProgress;
+    std::set<uint256> setBlockSyncTxs;
+    std::set<uint256> setBlockSyncSidechains;
+
+    //! Writes what the updates about the block changed so far
+    void WriteBlockSyncChanges();
+
     //! the current wallet version: clients below this version are not able to load the wallet
     int nWalletVersion;
 
@@ -776,6 +802,21 @@ public:
      */
     int64_t nWitnessCacheSize;
 
+    /*
+     * The notes of mapWallet whose witnesses are maintained as blocks are connected and
+     * disconnected, so that each block costs as much as the notes not yet spent rather than as
+     * the whole history of the wallet. A note leaves the set when the transaction spending it is
+     * as deep as the witness cache, and its witnesses are dropped: a reorg deep enough to unspend
+     * it would exceed the cache anyway. Memory only, rebuilt as the wallet is loaded.
+     */
+    std::set<JSOutPoint> setWitnessedNotes;
+
+    /*
+     * The transactions whose witnesses were dropped since the last SetBestChain(), to be written
+     * once more: afterwards they do not change with the chain anymore.
+     */
+    std::set<uint256> setPrunedWitnessTxs;
+
     void ClearNoteWitnessCache();
 
 protected:
@@ -790,6 +831,13 @@ protected:
      */
     void DecrementNoteWitnesses(const CBlockIndex* pindex);
 
+    //! Adds the notes of wtx to the ones witnessed
+    void AddToWitnessedNotes(const CWalletTransactionBase& wtx);
+    //! The notes witnessed, dropping the ones no longer in mapWallet
+    std::vector<CNoteData*> GetWitnessedNotes();
+    //! Stops witnessing the notes spent as deep as the witness cache
+    void PruneSpentNoteWitnesses();
+
     template <typename WalletDB>
     void SetBestChainINTERNAL(WalletDB& walletdb, const CBlockLocator& loc) {
         if (!walletdb.TxnBegin()) {
@@ -798,18 +846,21 @@ protected:
             return;
         }
         try {
-            for (auto& wtxItem : mapWallet) {
-                auto wtx = wtxItem.second.get();
-                // We skip transactions for which mapSproutNoteData is empty.
-                //This covers transactions that have no Sprout
-                // (i.e. are purely transparent), as well as shielding and unshielding
-                // transactions in which we only have transparent addresses involved.
-                if (!(wtx->mapNoteData.empty())) {
-                    if (!walletdb.WriteWalletTxBase(wtxItem.first, *wtx)) {
-                        LogPrintf("SetBestChain(): Failed to write CWalletTx, aborting atomic write\n");
-                        walletdb.TxnAbort();
-                        return;
-                   }
+            // Only the transactions with witnessed notes change with the chain, besides the
+            // ones whose witnesses were just dropped. This skips transactions that have no
+            // Sprout notes of ours (i.e. are purely transparent), as well as shielding and
+            // unshielding transactions in which we only have transparent addresses involved.
+            std::set<uint256> setTxs(setPrunedWitnessTxs);
+            for (const JSOutPoint& jsop : setWitnessedNotes)
+                setTxs.insert(jsop.hash);
+            for (const uint256& hash : setTxs) {
+                auto mi = mapWallet.find(hash);
+                if (mi == mapWallet.end())
+                    continue;
+                if (!walletdb.WriteWalletTxBase(hash, *(mi->second))) {
+                    LogPrintf("SetBestChain(): Failed to write CWalletTx, aborting atomic write\n");
+                    walletdb.TxnAbort();
+                    return;
                 }
             }
             if (!walletdb.WriteWitnessCacheSize(nWitnessCacheSize)) {
@@ -834,6 +885,7 @@ protected:
             LogPrintf("SetBestChain(): Couldn't commit atomic write\n");
             return;
         }
+        setPrunedWitnessTxs.clear();
     }
 
 private:
@@ -895,8 +947,10 @@ public:
         nNextResend = 0;
         nLastResend = 0;
         nTimeFirstKey = 0;
+        nWalletUnlockTime = 0;
         fBroadcastTransactions = false;
         nWitnessCacheSize = 0;
+        fBlockSyncInProgress = false;
     }
 
     /**
@@ -952,6 +1006,20 @@ public:
 private:
     std::map<uint256, std::shared_ptr<CWalletTransactionBase> > mapWallet;
     std::map<uint256, CScCertificateStatusUpdateInfo> mapSidechains;
+
+    /*
+     * The transactions and certificates of mapWallet which may still have outputs of ours not
+     * spent, the only ones AvailableCoins() looks at, so that coin selection and listunspent cost
+     * as much as the unspent outputs rather than as the whole history of the wallet. Every object
+     * enters it as it is added to the wallet, and AvailableCoins() drops it once none of its
+     * outputs is ours and unspent. It enters again whenever that may change: when a transaction
+     * spending it changes state or is erased, and when the keys change (see MarkDirty()).
+     * Memory only, rebuilt as the wallet is loaded.
+     */
+    mutable std::set<uint256> setUnspentTxs;
+
+    //! Adds back to setUnspentTxs the wallet objects whose outputs are spent by tx
+    void AddSpentToUnspentTxs(const CTransactionBase& tx);
 public:
     const std::map<uint256, std::shared_ptr<CWalletTransactionBase> > & getMapWallet() const  {return mapWallet;}
     //No need for mapWallet setter, meaning that mapWallet is only read outside CWallet class
@@ -971,13 +1039,16 @@ public:
 
     int64_t nTimeFirstKey;
 
+    //! The time walletpassphrase unlocked the wallet until, 0 once locked: guarded by cs_nWalletUnlockTime of the RPCs
+    int64_t nWalletUnlockTime;
+
     const CWalletTransactionBase* GetWalletTx(const uint256& hash) const;
 
     //! check whether we are allowed to upgrade (or already support) to the named feature
     bool CanSupportFeature(enum WalletFeature wf) { AssertLockHeld(cs_wallet); return nWalletMaxVersion >= wf; }
 
     void AvailableCoins(std::vector<COutput>& vCoins, bool fOnlyConfirmed=true, const CCoinControl *coinControl = nullptr, bool fIncludeZeroValue=false, bool fIncludeCoinBase=true, bool fIncludeCommunityFund=true) const;
-    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, std::vector<COutput> vCoins,
+    bool SelectCoinsMinConf(const CAmount& nTargetValue, int nConfMine, int nConfTheirs, const std::vector<COutput>& vCoins,
         std::set<std::pair<const CWalletTransactionBase*,unsigned int> >& setCoinsRet, CAmount& nValueRet) const;
 
     bool IsSpent(const uint256& hash, unsigned int n) const;
@@ -1001,9 +1072,11 @@ public:
      * keystore implementation
      * Generate a new key
      */
-    CPubKey GenerateNewKey();
+    CPubKey GenerateNewKey(CWalletDB* pwalletdb = NULL);
     //! Adds a key to the store, and saves it to disk.
     bool AddKeyPubKey(const CKey& key, const CPubKey &pubkey) override;
+    //! Adds a key to the store, and saves it with pwalletdb if not NULL, e.g. in its ongoing transaction
+    bool AddKeyPubKeyWithDB(const CKey& key, const CPubKey &pubkey, CWalletDB* pwalletdb);
     //! Adds a key to the store, without saving it to disk (used by LoadWallet)
     bool LoadKey(const CKey& key, const CPubKey &pubkey) { return CCryptoKeyStore::AddKeyPubKey(key, pubkey); }
     //! Load metadata (used by LoadWallet)
@@ -1084,6 +1157,8 @@ public:
          std::vector<std::optional<ZCIncrementalWitness>>& witnesses,
          uint256 &final_anchor);
     int ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate);
+    //! Adds to the wallet the transactions and certificates of a block rescanned, and increments the witnesses with it
+    int RescanBlock(const CBlockIndex* pindex, const CBlock& block, bool fUpdate);
     void ReacceptWalletTransactions();
     void ResendWalletTransactions(int64_t nBestBlockTime) override;
     std::vector<uint256> ResendWalletTransactionsBefore(int64_t nTime);
@@ -1140,6 +1215,8 @@ public:
         const uint256& hSig,
         uint8_t n) const;
     mapNoteData_t FindMyNotes(const CTransactionBase& tx) const;
+    //! As FindMyNotes, trying only the decryptors given, copied by the callers not to hold the key store lock
+    mapNoteData_t FindMyNotes(const CTransactionBase& tx, const NoteDecryptorMap& decryptors) const;
     bool IsFromMe(const uint256& nullifier) const;
     void GetNoteWitnesses(
          std::vector<JSOutPoint> notes,
@@ -1161,6 +1238,7 @@ public:
                       bool& fCanBeCached, bool keepImmatureVoutsOnly) const;
     CAmount GetChange(const CTransactionBase& txBase) const;
 
+    void BlockSyncBegin() override;
     void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added) override;
     /** Saves witness caches and best block locator to disk. */
     void SetBestChain(const CBlockLocator& loc) override;
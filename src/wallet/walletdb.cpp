@@ -488,8 +488,10 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
             ssKey >> hash;
             CWalletTx wtx;
             ssValue >> wtx;
+            // The joinsplit proofs were verified when the transaction was accepted, and the wallet file is
+            // trusted as much as the keys in it: verifying them again took most of the load of a shielded wallet
             CValidationState state;
-            auto verifier = libzcash::ProofVerifier::Strict();
+            auto verifier = libzcash::ProofVerifier::Disabled();
             if (!(CheckTransaction(wtx.getWrappedTx(), state, verifier) && (wtx.getWrappedTx().GetHash() == hash) && state.IsValid()))
             {
                 LogPrintf("%s():%d - failure: tx id = %s, reject code = %d\n",
@@ -1031,62 +1033,53 @@ DBErrors CWalletDB::ZapWalletTx(CWallet* pwallet, std::vector<std::shared_ptr<CW
     return DB_LOAD_OK;
 }
 
-void ThreadFlushWalletDB(const string& strFile)
+void MaybeFlushWalletDB(const std::vector<std::string>& vFiles)
 {
-    // Make this thread recognisable as the wallet flushing thread
-    RenameThread("horizen-wallet");
-
-    static bool fOneThread;
-    if (fOneThread)
-        return;
-    fOneThread = true;
-    if (!GetBoolArg("-flushwallet", true))
-        return;
-
-    unsigned int nLastSeen = nWalletDBUpdated;
-    unsigned int nLastFlushed = nWalletDBUpdated;
-    int64_t nLastWalletUpdate = GetTime();
-    while (true)
-    {
-        MilliSleep(500);
+    // run by the scheduler on a queue of its own, never concurrently
+    static unsigned int nLastSeen = nWalletDBUpdated;
+    static unsigned int nLastFlushed = nWalletDBUpdated;
+    static int64_t nLastWalletUpdate = GetTime();
 
-        if (nLastSeen != nWalletDBUpdated)
-        {
-            nLastSeen = nWalletDBUpdated;
-            nLastWalletUpdate = GetTime();
-        }
+    if (nLastSeen != nWalletDBUpdated)
+    {
+        nLastSeen = nWalletDBUpdated;
+        nLastWalletUpdate = GetTime();
+    }
 
-        if (nLastFlushed != nWalletDBUpdated && GetTime() - nLastWalletUpdate >= 2)
+    if (nLastFlushed != nWalletDBUpdated && GetTime() - nLastWalletUpdate >= 2)
+    {
+        TRY_LOCK(bitdb.cs_db,lockDb);
+        if (lockDb)
         {
-            TRY_LOCK(bitdb.cs_db,lockDb);
-            if (lockDb)
+            // Don't do this if any databases are in use
+            int nRefCount = 0;
+            map<string, int>::iterator mi = bitdb.mapFileUseCount.begin();
+            while (mi != bitdb.mapFileUseCount.end())
             {
-                // Don't do this if any databases are in use
-                int nRefCount = 0;
-                map<string, int>::iterator mi = bitdb.mapFileUseCount.begin();
-                while (mi != bitdb.mapFileUseCount.end())
-                {
-                    nRefCount += (*mi).second;
-                    mi++;
-                }
+                nRefCount += (*mi).second;
+                mi++;
+            }
 
-                if (nRefCount == 0)
+            if (nRefCount == 0)
+            {
+                boost::this_thread::interruption_point();
+                nLastFlushed = nWalletDBUpdated;
+                // the wallets loaded all share the environment, and the updates counter
+                for (const std::string& strFile : vFiles)
                 {
-                    boost::this_thread::interruption_point();
                     map<string, int>::iterator ki = bitdb.mapFileUseCount.find(strFile);
-                    if (ki != bitdb.mapFileUseCount.end())
-                    {
-                        LogPrint("db", "Flushing wallet.dat\n");
-                        nLastFlushed = nWalletDBUpdated;
-                        int64_t nStart = GetTimeMillis();
+                    if (ki == bitdb.mapFileUseCount.end())
+                        continue;
 
-                        // Flush wallet.dat so it's self contained
-                        bitdb.CloseDb(strFile);
-                        bitdb.CheckpointLSN(strFile);
+                    LogPrint("db", "Flushing %s\n", strFile);
+                    int64_t nStart = GetTimeMillis();
 
-                        bitdb.mapFileUseCount.erase(ki++);
-                        LogPrint("db", "Flushed wallet.dat %dms\n", GetTimeMillis() - nStart);
-                    }
+                    // Flush wallet.dat so it's self contained
+                    bitdb.CloseDb(strFile);
+                    bitdb.CheckpointLSN(strFile);
+
+                    bitdb.mapFileUseCount.erase(ki);
+                    LogPrint("db", "Flushed %s %dms\n", strFile, GetTimeMillis() - nStart);
                 }
             }
         }
@@ -160,6 +160,7 @@ private:
 };
 
 bool BackupWallet(const CWallet& wallet, const std::string& strDest);
-void ThreadFlushWalletDB(const std::string& strFile);
+/** Flush the wallet files 2 seconds after their last update, if no database is in use; called every 500ms */
+void MaybeFlushWalletDB(const std::vector<std::string>& vFiles);
 
 #endif // BITCOIN_WALLET_WALLETDB_H
@@ -10,9 +10,8 @@
 namespace libzcash {
 
 uint256 PaymentAddress::GetHash() const {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss << *this;
-    return Hash(ss.begin(), ss.end());
+    // hashed as it is serialized, without the buffer of a stream
+    return SerializeHash(*this, SER_NETWORK, PROTOCOL_VERSION);
 }
 
 uint256 ReceivingKey::pk_enc() const {
@@ -134,6 +134,12 @@ void IncrementalMerkleTree<Depth, Hash>::append(Hash obj) {
         throw std::runtime_error("tree is full");
     }
 
+    cached_root = std::nullopt;
+    append_leaf(obj);
+}
+
+template<size_t Depth, typename Hash>
+void IncrementalMerkleTree<Depth, Hash>::append_leaf(const Hash& obj) {
     if (!left) {
         // Set the left leaf
         left = obj;
@@ -325,6 +331,8 @@ std::deque<Hash> IncrementalWitness<Depth, Hash>::partial_path() const {
 
 template<size_t Depth, typename Hash>
 void IncrementalWitness<Depth, Hash>::append(Hash obj) {
+    cached_root = std::nullopt;
+
     if (cursor) {
         cursor->append(obj);
 
@@ -3,7 +3,9 @@
 
 #include <array>
 #include <deque>
+#include <iterator>
 #include <optional>
+#include <stdexcept>
 
 #include <boost/static_assert.hpp>
 
@@ -102,8 +104,27 @@ public:
     size_t size() const;
 
     void append(Hash obj);
+
+    // Appends all the leaves of a range, checking only once that they fit in the tree
+    template<typename Iterator>
+    void append(Iterator first, Iterator last) {
+        const size_t count = std::distance(first, last);
+        if (count > (UINT64_C(1) << Depth) - size()) {
+            throw std::runtime_error("tree is full");
+        }
+        cached_root = std::nullopt;
+        for (; first != last; ++first) {
+            append_leaf(*first);
+        }
+    }
+
+    // The root is cached until the next append, as it is asked for
+    // many times for the same tree (anchors, witnesses).
     Hash root() const {
-        return root(Depth, std::deque<Hash>());
+        if (!cached_root) {
+            cached_root = root(Depth, std::deque<Hash>());
+        }
+        return *cached_root;
     }
     Hash last() const;
 
@@ -118,6 +139,9 @@ public:
         READWRITE(left);
         READWRITE(right);
         READWRITE(parents);
+        if (ser_action.ForRead()) {
+            cached_root = std::nullopt;
+        }
 
         wfcheck();
     }
@@ -137,6 +161,9 @@ private:
 
     // Collapsed "left" subtrees ordered toward the root of the tree.
     std::vector<std::optional<Hash>> parents;
+    // Not part of the state of the tree, see root()
+    mutable std::optional<Hash> cached_root;
+    void append_leaf(const Hash& obj);
     MerklePath path(std::deque<Hash> filler_hashes = std::deque<Hash>()) const;
     Hash root(size_t depth, std::deque<Hash> filler_hashes = std::deque<Hash>()) const;
     bool is_complete(size_t depth = Depth) const;
@@ -175,12 +202,23 @@ public:
         return tree.size() - 1;
     }
 
+    // Cached until the next append, like the root of the tree
     Hash root() const {
-        return tree.root(Depth, partial_path());
+        if (!cached_root) {
+            cached_root = tree.root(Depth, partial_path());
+        }
+        return *cached_root;
     }
 
     void append(Hash obj);
 
+    template<typename Iterator>
+    void append(Iterator first, Iterator last) {
+        for (; first != last; ++first) {
+            append(*first);
+        }
+    }
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -188,6 +226,9 @@ public:
         READWRITE(tree);
         READWRITE(filled);
         READWRITE(cursor);
+        if (ser_action.ForRead()) {
+            cached_root = std::nullopt;
+        }
 
         cursor_depth = tree.next_depth(filled.size());
     }
@@ -201,6 +242,7 @@ private:
     std::vector<Hash> filled;
     std::optional<IncrementalMerkleTree<Depth, Hash>> cursor;
     size_t cursor_depth = 0;
+    mutable std::optional<Hash> cached_root;
     std::deque<Hash> partial_path() const;
     IncrementalWitness(IncrementalMerkleTree<Depth, Hash> tree) : tree(tree) {}
 };
@@ -155,7 +155,8 @@ public:
         uint64_t vpub_new,
         const uint256& rt,
         bool computeProof,
-        uint256 *out_esk // Payment disclosure
+        uint256 *out_esk, // Payment disclosure
+        JSProofWitness<NumInputs, NumOutputs> *out_witness
     ) {
         if (vpub_old > MAX_MONEY) {
             throw std::invalid_argument("nonsensical vpub_old value");
@@ -271,11 +272,35 @@ public:
             out_macs[i] = PRF_pk(inputs[i].key, i, h_sig);
         }
 
-        if (makeGrothProof) {
-            if (!computeProof) {
+        JSProofWitness<NumInputs, NumOutputs> witness;
+        witness.makeGrothProof = makeGrothProof;
+        witness.phi = phi;
+        witness.rt = rt;
+        witness.h_sig = h_sig;
+        witness.inputs = inputs;
+        witness.notes = out_notes;
+        witness.vpub_old = vpub_old;
+        witness.vpub_new = vpub_new;
+
+        if (out_witness != nullptr) {
+            *out_witness = witness;
+        }
+
+        if (!computeProof) {
+            if (makeGrothProof) {
                 return GrothProof();
             }
+            return PHGRProof();
+        }
 
+        return prove(witness);
+    }
+
+    SproutProof prove(const JSProofWitness<NumInputs, NumOutputs>& witness) {
+        const std::array<JSInput, NumInputs>& inputs = witness.inputs;
+        const std::array<Note, NumOutputs>& out_notes = witness.notes;
+
+        if (witness.makeGrothProof) {
             GrothProof proof;
 
             CDataStream ss1(SER_NETWORK, PROTOCOL_VERSION);
@@ -289,9 +314,9 @@ public:
             librustzcash_sprout_prove(
                 proof.begin(),
 
-                phi.begin(),
-                rt.begin(),
-                h_sig.begin(),
+                witness.phi.begin(),
+                witness.rt.begin(),
+                witness.h_sig.begin(),
 
                 inputs[0].key.begin(),
                 inputs[0].note.value(),
@@ -313,29 +338,25 @@ public:
                 out_notes[1].value(),
                 out_notes[1].r.begin(),
 
-                vpub_old,
-                vpub_new
+                witness.vpub_old,
+                witness.vpub_new
             );
 
             return proof;
         }
 
-        if (!computeProof) {
-            return PHGRProof();
-        }
-
         protoboard<FieldT> pb;
         {
             joinsplit_gadget<FieldT, NumInputs, NumOutputs> g(pb);
             g.generate_r1cs_constraints();
             g.generate_r1cs_witness(
-                phi,
-                rt,
-                h_sig,
+                witness.phi,
+                witness.rt,
+                witness.h_sig,
                 inputs,
                 out_notes,
-                vpub_old,
-                vpub_new
+                witness.vpub_old,
+                witness.vpub_new
             );
         }
 
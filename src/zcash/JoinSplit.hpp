@@ -51,6 +51,20 @@ public:
     Note note(const uint252& phi, const uint256& r, size_t i, const uint256& h_sig) const;
 };
 
+// What the SNARK proof of a joinsplit is computed from, once its notes are sampled:
+// the proof can then be generated apart from the notes and ciphertexts it proves
+template<size_t NumInputs, size_t NumOutputs>
+struct JSProofWitness {
+    bool makeGrothProof = false;
+    uint252 phi;
+    uint256 rt;
+    uint256 h_sig;
+    std::array<JSInput, NumInputs> inputs;
+    std::array<Note, NumOutputs> notes;
+    uint64_t vpub_old = 0;
+    uint64_t vpub_new = 0;
+};
+
 template<size_t NumInputs, size_t NumOutputs>
 class JoinSplit {
 public:
@@ -87,9 +101,14 @@ public:
         // For paymentdisclosure, we need to retrieve the esk.
         // Reference as non-const parameter with default value leads to compile error.
         // So use pointer for simplicity.
-        uint256 *out_esk = nullptr
+        uint256 *out_esk = nullptr,
+        // The proof can be computed later from the witness, for example without computeProof
+        JSProofWitness<NumInputs, NumOutputs> *out_witness = nullptr
     ) = 0;
 
+    // Compute only the SNARK proof, from the witness given by the method above
+    virtual SproutProof prove(const JSProofWitness<NumInputs, NumOutputs>& witness) = 0;
+
     virtual bool verify(
         const PHGRProof& proof,
         ProofVerifier& verifier,
@@ -111,5 +130,7 @@ protected:
 
 typedef libzcash::JoinSplit<ZC_NUM_JS_INPUTS,
                             ZC_NUM_JS_OUTPUTS> ZCJoinSplit;
+typedef libzcash::JSProofWitness<ZC_NUM_JS_INPUTS,
+                                 ZC_NUM_JS_OUTPUTS> ZCJSProofWitness;
 
 #endif // ZC_JOINSPLIT_H_
@@ -61,8 +61,11 @@ NotePlaintext NotePlaintext::decrypt(const ZCNoteDecryption& decryptor,
                                      unsigned char nonce
                                     )
 {
-    auto plaintext = decryptor.decrypt(ciphertext, ephemeralKey, h_sig, nonce);
+    return from_plaintext(decryptor.decrypt(ciphertext, ephemeralKey, h_sig, nonce));
+}
 
+NotePlaintext NotePlaintext::from_plaintext(const ZCNoteDecryption::Plaintext& plaintext)
+{
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     ss << plaintext;
 
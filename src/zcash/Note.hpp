@@ -91,6 +91,9 @@ public:
                                  unsigned char nonce
                                 );
 
+    // The note of a plaintext decrypted, as by ZCNoteDecryption::try_decrypt_all
+    static NotePlaintext from_plaintext(const ZCNoteDecryption::Plaintext& plaintext);
+
     ZCNoteEncryption::Ciphertext encrypt(ZCNoteEncryption& encryptor,
                                          const uint256& pk_enc
                                         ) const;
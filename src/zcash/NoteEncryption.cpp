@@ -135,6 +135,42 @@ typename NoteDecryption<MLEN>::Plaintext NoteDecryption<MLEN>::decrypt
     return plaintext;
 }
 
+template<size_t MLEN>
+std::vector<std::optional<typename NoteDecryption<MLEN>::Plaintext>> NoteDecryption<MLEN>::try_decrypt_all
+                                         (const NoteDecryption<MLEN>::Ciphertext *ciphertexts,
+                                          size_t nCiphertexts,
+                                          const uint256 &epk,
+                                          const uint256 &hSig
+                                         ) const
+{
+    uint256 dhsecret;
+
+    if (crypto_scalarmult(dhsecret.begin(), sk_enc.begin(), epk.begin()) != 0) {
+        throw std::logic_error("Could not create DH secret");
+    }
+
+    // The nonce is zero because we never reuse keys
+    unsigned char cipher_nonce[crypto_aead_chacha20poly1305_IETF_NPUBBYTES] = {};
+
+    std::vector<std::optional<NoteDecryption<MLEN>::Plaintext>> plaintexts(nCiphertexts);
+    for (size_t i = 0; i < nCiphertexts; i++) {
+        unsigned char K[NOTEENCRYPTION_CIPHER_KEYSIZE];
+        KDF(K, dhsecret, epk, pk_enc, hSig, (unsigned char) i);
+
+        NoteDecryption<MLEN>::Plaintext plaintext;
+        if (crypto_aead_chacha20poly1305_ietf_decrypt(plaintext.begin(), NULL,
+                                                 NULL,
+                                                 ciphertexts[i].begin(), NoteDecryption<MLEN>::CLEN,
+                                                 NULL,
+                                                 0,
+                                                 cipher_nonce, K) == 0) {
+            plaintexts[i] = plaintext;
+        }
+    }
+
+    return plaintexts;
+}
+
 //
 // Payment disclosure - decrypt with esk
 //
@@ -14,6 +14,8 @@ https://github.com/zcash/zips/blob/master/protocol/protocol.pdf
 #include "zcash/Address.hpp"
 
 #include <array>
+#include <optional>
+#include <vector>
 
 namespace libzcash {
 
@@ -78,6 +80,16 @@ public:
                       unsigned char nonce
                      ) const;
 
+    // Tries to decrypt the ciphertexts sent with the same ephemeral key, as
+    // the ones of a JoinSplit, the i-th with nonce i. The key agreement, the
+    // most of the cost of a trial decryption, is performed once for them all,
+    // and the ciphertexts not for this key are left empty instead of throwing.
+    std::vector<std::optional<Plaintext>> try_decrypt_all(const Ciphertext *ciphertexts,
+                                                          size_t nCiphertexts,
+                                                          const uint256 &epk,
+                                                          const uint256 &hSig
+                                                         ) const;
+
     friend inline bool operator==(const NoteDecryption& a, const NoteDecryption& b) {
         return a.sk_enc == b.sk_enc && a.pk_enc == b.pk_enc;
     }
@@ -233,6 +233,56 @@ ProofVerifier ProofVerifier::Disabled() {
     return ProofVerifier(false);
 }
 
+ProofVerifier ProofVerifier::Batched(PHGRProofBatch& batch) {
+    initialize_curve_params();
+    return ProofVerifier(true, &batch);
+}
+
+struct PHGRProofBatch::Entries {
+    // all the proofs of a batch must be of the same key
+    const r1cs_ppzksnark_processed_verification_key<curve_pp>* pvk = nullptr;
+    bool fMixedKeys = false;
+    std::vector<r1cs_primary_input<curve_Fr>> primary_inputs;
+    std::vector<r1cs_ppzksnark_proof<curve_pp>> proofs;
+
+    void add(const r1cs_ppzksnark_processed_verification_key<curve_pp>* pvkIn)
+    {
+        if (pvk == nullptr)
+            pvk = pvkIn;
+        else if (pvk != pvkIn)
+            fMixedKeys = true;
+    }
+};
+
+PHGRProofBatch::PHGRProofBatch() : entries(new Entries()) { }
+
+PHGRProofBatch::~PHGRProofBatch() { }
+
+void PHGRProofBatch::append(const PHGRProofBatch& other)
+{
+    if (other.entries->pvk == nullptr)
+        return;
+
+    entries->add(other.entries->pvk);
+    entries->fMixedKeys |= other.entries->fMixedKeys;
+    entries->primary_inputs.insert(entries->primary_inputs.end(), other.entries->primary_inputs.begin(), other.entries->primary_inputs.end());
+    entries->proofs.insert(entries->proofs.end(), other.entries->proofs.begin(), other.entries->proofs.end());
+}
+
+size_t PHGRProofBatch::size() const
+{
+    return entries->proofs.size();
+}
+
+bool PHGRProofBatch::verify() const
+{
+    if (entries->proofs.empty())
+        return true;
+    if (entries->fMixedKeys)
+        return false;
+    return r1cs_ppzksnark_online_batch_verifier_strong_IC<curve_pp>(*entries->pvk, entries->primary_inputs, entries->proofs);
+}
+
 template<>
 bool ProofVerifier::check(
     const r1cs_ppzksnark_verification_key<curve_pp>& vk,
@@ -241,7 +291,12 @@ bool ProofVerifier::check(
     const r1cs_ppzksnark_proof<curve_pp>& proof
 )
 {
-    if (perform_verification) {
+    if (perform_verification && batch != nullptr) {
+        batch->entries->add(&pvk);
+        batch->entries->primary_inputs.push_back(primary_input);
+        batch->entries->proofs.push_back(proof);
+        return true;
+    } else if (perform_verification) {
         return r1cs_ppzksnark_online_verifier_strong_IC<curve_pp>(pvk, primary_input, proof);
     } else {
         return true;
@@ -4,6 +4,8 @@
 #include "serialize.h"
 #include "uint256.h"
 
+#include <memory>
+
 namespace libzcash {
 
 const unsigned char G1_PREFIX_MASK = 0x02;
@@ -237,11 +239,36 @@ public:
 
 void initialize_curve_params();
 
+// PHGR proofs gathered by a ProofVerifier::Batched() verifier, to be verified all at once
+class PHGRProofBatch {
+private:
+    friend class ProofVerifier;
+    struct Entries;
+    std::unique_ptr<Entries> entries;
+
+public:
+    PHGRProofBatch();
+    ~PHGRProofBatch();
+    PHGRProofBatch(const PHGRProofBatch&) = delete;
+    PHGRProofBatch& operator=(const PHGRProofBatch&) = delete;
+
+    // Adds the proofs gathered by another batch to this one
+    void append(const PHGRProofBatch& other);
+
+    size_t size() const;
+
+    // Returns true if all the proofs are valid. A false result means that
+    // some of them may not be, to be found verifying them one by one.
+    bool verify() const;
+};
+
 class ProofVerifier {
 private:
     bool perform_verification;
+    PHGRProofBatch* batch;
 
-    ProofVerifier(bool perform_verification) : perform_verification(perform_verification) { }
+    ProofVerifier(bool perform_verification, PHGRProofBatch* batch = nullptr) :
+        perform_verification(perform_verification), batch(batch) { }
 
 public:
     // ProofVerifier should never be copied
@@ -259,6 +286,11 @@ public:
     // such as during reindexing.
     static ProofVerifier Disabled();
 
+    // Creates a verification context that only adds the PHGR proofs
+    // to a batch, which must then be verified in their place. The
+    // Groth proofs are still verified.
+    static ProofVerifier Batched(PHGRProofBatch& batch);
+
     template <typename VerificationKey,
               typename ProcessedVerificationKey,
               typename PrimaryInput,
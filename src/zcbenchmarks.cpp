@@ -1,23 +1,32 @@
+#include <algorithm>
 #include <cstdio>
+#include <fstream>
 #include <future>
 #include <map>
+#include <set>
 #include <thread>
 #include <unistd.h>
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
 
 #include "coins.h"
 #include "util.h"
 #include "init.h"
+#include "primitives/certificate.h"
 #include "primitives/transaction.h"
 #include "base58.h"
 #include "crypto/equihash.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "checkqueue.h"
 #include "consensus/validation.h"
 #include "main.h"
 #include "miner.h"
 #include "pow.h"
 #include "rpc/server.h"
+#include "sc/proofcache.h"
+#include "sc/proofverifier.h"
+#include "sc/sidechainTxsCommitmentBuilder.h"
 #include "script/sign.h"
 #include "sodium.h"
 #include "streams.h"
@@ -31,6 +40,15 @@
 #include "zcash/IncrementalMerkleTree.hpp"
 
 using namespace libzcash;
+
+// The sample field element of the unit tests
+static const std::vector<unsigned char> SAMPLE_FIELD = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x3f
+};
+
 // This method is based on Shutdown from init.cpp
 void pre_wallet_load()
 {
@@ -48,6 +66,7 @@ void pre_wallet_load()
         pwalletMain->Flush(true);
 
     UnregisterValidationInterface(pwalletMain);
+    vpwallets.erase(std::remove(vpwallets.begin(), vpwallets.end(), pwalletMain), vpwallets.end());
     delete pwalletMain;
     pwalletMain = NULL;
     bitdb.Reset();
@@ -56,6 +75,7 @@ void pre_wallet_load()
 }
 
 void post_wallet_load(){
+    vpwallets.insert(vpwallets.begin(), pwalletMain);
     RegisterValidationInterface(pwalletMain);
 #ifdef ENABLE_MINING
     // Generate coins in the background
@@ -209,6 +229,67 @@ std::vector<double> benchmark_solve_equihash_threaded(int nThreads)
     }
     return ret;
 }
+
+double benchmark_solve_equihash_rate(int nNonces, bool fReuseSolver)
+{
+    CBlock pblock;
+    CEquihashInput I{pblock};
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << I;
+
+    unsigned int n = Params(CBaseChainParams::MAIN).EquihashN();
+    unsigned int k = Params(CBaseChainParams::MAIN).EquihashK();
+    crypto_generichash_blake2b_state eh_state;
+    EhInitialiseState(n, k, eh_state);
+    crypto_generichash_blake2b_update(&eh_state, (unsigned char*)&ss[0], ss.size());
+
+    uint256 nonce;
+    randombytes_buf(nonce.begin(), 32);
+
+    size_t nSolutions = 0;
+    std::function<bool(std::vector<unsigned char>)> countSolution = [&nSolutions](std::vector<unsigned char> soln) {
+        ++nSolutions;
+        return false;
+    };
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    std::unique_ptr<CTrompSolver> solver;
+    for (int i = 0; i < nNonces; i++) {
+        crypto_generichash_blake2b_state curr_state = eh_state;
+        crypto_generichash_blake2b_update(&curr_state,
+                                        nonce.begin(),
+                                        nonce.size());
+        // without reuse, each nonce pays for the allocation of the solver memory as the miner used to do
+        if (!fReuseSolver)
+            solver.reset();
+        if (!solver)
+            solver.reset(new CTrompSolver());
+        solver->Solve(curr_state, countSolution);
+        nonce = ArithToUint256(UintToArith256(nonce) + 1);
+    }
+    return nSolutions / timer_stop(tv_start);
+}
+
+std::vector<double> benchmark_solve_equihash_threaded(int nThreads, int nNonces, bool fReuseSolver)
+{
+    std::vector<double> ret;
+    std::vector<std::future<double>> tasks;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < nThreads; i++) {
+        std::packaged_task<double(void)> task(std::bind(&benchmark_solve_equihash_rate, nNonces, fReuseSolver));
+        tasks.emplace_back(task.get_future());
+        threads.emplace_back(std::move(task));
+    }
+    for (auto it = tasks.begin(); it != tasks.end(); it++) {
+        it->wait();
+        ret.push_back(it->get());
+    }
+    for (auto it = threads.begin(); it != threads.end(); it++) {
+        it->join();
+    }
+    return ret;
+}
 #endif // ENABLE_MINING
 
 double benchmark_verify_equihash()
@@ -216,12 +297,37 @@ double benchmark_verify_equihash()
     CChainParams params = Params(CBaseChainParams::MAIN);
     CBlock genesis = Params(CBaseChainParams::MAIN).GenesisBlock();
     CBlockHeader genesis_header = genesis.GetBlockHeader();
+    ClearEquihashCache();
     struct timeval tv_start;
     timer_start(tv_start);
     CheckEquihashSolution(&genesis_header, params);
     return timer_stop(tv_start);
 }
 
+double benchmark_verify_equihash_batch(size_t nHeaders, int nThreads)
+{
+    CChainParams params = Params(CBaseChainParams::MAIN);
+    const CBlockHeader genesis_header = Params(CBaseChainParams::MAIN).GenesisBlock().GetBlockHeader();
+
+    // The same header is checked nHeaders times: none is in the cache when the batch starts
+    const std::vector<const CBlockHeader*> vpblock(nHeaders, &genesis_header);
+    ClearEquihashCache();
+
+    CCheckQueue<CCheckJob> queue(1);
+    boost::thread_group threads;
+    for (int i = 1; i < nThreads; i++)
+        threads.create_thread(boost::bind(&CCheckQueue<CCheckJob>::Thread, &queue));
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    assert(CheckEquihashSolutions(vpblock, params, &queue));
+    double ret = timer_stop(tv_start);
+
+    threads.interrupt_all();
+    threads.join_all();
+    return ret;
+}
+
 double benchmark_large_tx()
 {
     // Number of inputs in the spending transaction that we will simulate
@@ -282,6 +388,321 @@ double benchmark_large_tx()
     return timer_stop(tv_start);
 }
 
+double benchmark_sc_commitment_certs(size_t nCerts)
+{
+    // Number of custom fields of each certificate
+    const size_t NUM_CUSTOM_FIELDS = 16;
+
+    Sidechain::ScFixedParameters scFixedParams;
+    scFixedParams.version = 0;
+    for (size_t i = 0; i < NUM_CUSTOM_FIELDS; i++) {
+        scFixedParams.vFieldElementCertificateFieldConfig.push_back(FieldElementCertificateFieldConfig(255));
+    }
+
+    std::vector<CScCertificate> certs;
+    for (size_t n = 0; n < nCerts; n++) {
+        CMutableScCertificate mcert;
+        mcert.scId = uint256S(strprintf("%x", n + 1));
+        mcert.epochNumber = 0;
+        mcert.quality = n;
+        mcert.endEpochCumScTxCommTreeRoot = CFieldElement{std::vector<unsigned char>(CFieldElement::ByteSize(), 0x00)};
+
+        for (size_t i = 0; i < NUM_CUSTOM_FIELDS; i++) {
+            std::vector<unsigned char> rawBytes(CFieldElement::ByteSize(), 0x00);
+            rawBytes[0] = i;
+            rawBytes[1] = n;
+            mcert.vFieldElementCertificateField.push_back(FieldElementCertificateField(rawBytes));
+        }
+
+        certs.push_back(CScCertificate(mcert));
+    }
+
+    uint64_t nDeserializations = CFieldElement::GetDeserializationsCount();
+
+    // Build the sc txs commitment twice, as done when creating the block template
+    // and when connecting the block
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (int round = 0; round < 2; round++) {
+        SidechainTxsCommitmentBuilder builder;
+        for (const CScCertificate& cert : certs) {
+            assert(builder.add(cert, scFixedParams));
+        }
+        builder.getCommitment();
+    }
+    double elapsed = timer_stop(tv_start);
+
+    LogPrintf("%s():%d - %d certs, %d field deserializations\n", __func__, __LINE__,
+        nCerts, CFieldElement::GetDeserializationsCount() - nDeserializations);
+
+    return elapsed;
+}
+
+/**
+ * @brief A proof verifier whose queue can be filled directly with prebuilt items,
+ * so that only the verification itself is measured.
+ */
+class CBenchmarkProofVerifier : public CScProofVerifier
+{
+public:
+    CBenchmarkProofVerifier() :
+    CScProofVerifier(Verification::Strict, Priority::High)
+    {
+    }
+
+    void AddItem(const CProofVerifierItem& item)
+    {
+        proofQueue[item.txHash] = item;
+    }
+
+    bool Verify(bool batch)
+    {
+        if (batch)
+        {
+            return BatchVerify();
+        }
+
+        NormalVerify(proofQueue);
+
+        return std::all_of(proofQueue.begin(), proofQueue.end(),
+                           [](const std::pair<const uint256, CProofVerifierItem>& entry)
+                           { return entry.second.result == ProofVerificationResult::Passed; });
+    }
+};
+
+/**
+ * @brief Gets the folder where the test keys and proofs used by the benchmarks are stored,
+ * in the data directory next to the other benchmark files, creating it the first time it is requested.
+ * The folder is kept, so that the keys are generated by the first run only.
+ */
+static const boost::filesystem::path& GetScBenchmarkFolder()
+{
+    static boost::filesystem::path folder;
+
+    if (folder.empty())
+    {
+        folder = GetDataDir() / "benchmark" / "sc";
+        boost::filesystem::create_directories(folder);
+    }
+
+    return folder;
+}
+
+static std::vector<unsigned char> ReadScBenchmarkFile(const std::string& filepath)
+{
+    std::ifstream input(filepath, std::ios::binary);
+    return std::vector<unsigned char>((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+}
+
+/**
+ * @brief Generates (only the first time) the Darlin test keys for the given circuit type
+ * and returns the common prefix of their file paths.
+ */
+static std::string GetScBenchmarkKeysPath(TestCircuitType circuitType)
+{
+    static std::set<TestCircuitType> generated;
+    std::string path = GetScBenchmarkFolder().string();
+    std::string prefix = path + (circuitType == TestCircuitType::Certificate ? "/darlin_cert_test_" : "/darlin_csw_test_");
+
+    // the keys of a previous run are reused
+    if (generated.count(circuitType) == 0 &&
+        !(boost::filesystem::exists(prefix + "pk") && boost::filesystem::exists(prefix + "vk")))
+    {
+        CctpErrorCode errorCode;
+        bool ret = zendoo_generate_mc_test_params(circuitType, ProvingSystem::Darlin, 1 << 10, false,
+                                                  (path_char_t*)path.c_str(), path.size(), &errorCode);
+        assert(ret);
+    }
+    generated.insert(circuitType);
+
+    return prefix;
+}
+
+/**
+ * @brief Creates a certificate verifier input (with the same default values used by the unit tests)
+ * together with a valid test proof.
+ */
+static CCertProofVerifierInput CreateScBenchmarkCertInput()
+{
+    std::string keysPath = GetScBenchmarkKeysPath(TestCircuitType::Certificate);
+    std::string proofPath = keysPath + "proof";
+
+    CCertProofVerifierInput input;
+    input.certHash = uint256S("cccc");
+    input.scId = uint256S("aaaa");
+    input.constant = CFieldElement(SAMPLE_FIELD);
+    input.epochNumber = 7;
+    input.quality = 10;
+    input.endEpochCumScTxCommTreeRoot = CFieldElement(SAMPLE_FIELD);
+    input.mainchainBackwardTransferRequestScFee = 1;
+    input.forwardTransferScFee = 1;
+
+    wrappedFieldPtr sptrScId = CFieldElement(input.scId).GetFieldElement();
+    wrappedFieldPtr sptrConst = input.constant.GetFieldElement();
+    wrappedFieldPtr sptrCum = input.endEpochCumScTxCommTreeRoot.GetFieldElement();
+    wrappedFieldPtr sptrPHash = input.lastCertHash.GetFieldElement();
+
+    CctpErrorCode errorCode;
+    sc_pk_t* provingKey = zendoo_deserialize_sc_pk_from_file((path_char_t*)(keysPath + "pk").c_str(), (keysPath + "pk").size(),
+                                                             true, &errorCode);
+    assert(provingKey != nullptr);
+
+    bool ret = zendoo_create_cert_test_proof(false, sptrConst.get(), sptrScId.get(), input.epochNumber, input.quality,
+                                             nullptr, 0, nullptr, 0, sptrCum.get(),
+                                             input.mainchainBackwardTransferRequestScFee, input.forwardTransferScFee,
+                                             provingKey, (path_char_t*)proofPath.c_str(), proofPath.size(),
+                                             1 << 10, sptrPHash.get(), &errorCode);
+    assert(ret);
+    zendoo_sc_pk_free(provingKey);
+
+    input.verificationKey = CScVKey(ReadScBenchmarkFile(keysPath + "vk"));
+    input.proof = CScProof(ReadScBenchmarkFile(proofPath));
+
+    return input;
+}
+
+/**
+ * @brief Creates a CSW verifier input (with the same default values used by the unit tests)
+ * together with a valid test proof.
+ */
+static CCswProofVerifierInput CreateScBenchmarkCswInput()
+{
+    std::string keysPath = GetScBenchmarkKeysPath(TestCircuitType::CSW);
+    std::string proofPath = keysPath + "proof";
+
+    CCswProofVerifierInput input;
+    input.scId = uint256S("aaaa");
+    input.constant = CFieldElement(SAMPLE_FIELD);
+    input.ceasingCumScTxCommTree = CFieldElement(SAMPLE_FIELD);
+    input.certDataHash = CFieldElement(SAMPLE_FIELD);
+    input.nValue = CAmount(15);
+    input.nullifier = CFieldElement(SAMPLE_FIELD);
+
+    wrappedFieldPtr sptrScId = CFieldElement(input.scId).GetFieldElement();
+    wrappedFieldPtr sptrConst = input.constant.GetFieldElement();
+    wrappedFieldPtr sptrCdh = input.certDataHash.GetFieldElement();
+    wrappedFieldPtr sptrCum = input.ceasingCumScTxCommTree.GetFieldElement();
+    wrappedFieldPtr sptrNullifier = input.nullifier.GetFieldElement();
+    BufferWithSize bwsPkHash(input.pubKeyHash.begin(), input.pubKeyHash.size());
+
+    CctpErrorCode errorCode;
+    sc_pk_t* provingKey = zendoo_deserialize_sc_pk_from_file((path_char_t*)(keysPath + "pk").c_str(), (keysPath + "pk").size(),
+                                                             true, &errorCode);
+    assert(provingKey != nullptr);
+
+    bool ret = zendoo_create_csw_test_proof(false, input.nValue, sptrConst.get(), sptrScId.get(), sptrNullifier.get(),
+                                            &bwsPkHash, sptrCdh.get(), sptrCum.get(), provingKey,
+                                            (path_char_t*)proofPath.c_str(), proofPath.size(), 1 << 10, &errorCode);
+    assert(ret);
+    zendoo_sc_pk_free(provingKey);
+
+    input.verificationKey = CScVKey(ReadScBenchmarkFile(keysPath + "vk"));
+    input.proof = CScProof(ReadScBenchmarkFile(proofPath));
+
+    return input;
+}
+
+static CProofVerifierItem CreateScBenchmarkItem(const uint256& hash)
+{
+    CProofVerifierItem item;
+    item.txHash = hash;
+    item.node = nullptr;
+    item.result = ProofVerificationResult::Unknown;
+    return item;
+}
+
+double benchmark_verify_sc_cert_proof()
+{
+    static const CCertProofVerifierInput input = CreateScBenchmarkCertInput();
+
+    CBenchmarkProofVerifier verifier;
+    CProofVerifierItem item = CreateScBenchmarkItem(input.certHash);
+    item.proofInput = input;
+    verifier.AddItem(item);
+
+    // Proofs verified by a previous sample must not be served by the cache
+    CScProofVerificationCache::GetInstance().Clear();
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    assert(verifier.Verify(false));
+    return timer_stop(tv_start);
+}
+
+double benchmark_verify_sc_cert_proofs_batch(size_t nProofs)
+{
+    static const CCertProofVerifierInput input = CreateScBenchmarkCertInput();
+
+    // The same proof is queued under different hashes: the batch verifier
+    // processes each entry as a separate proof anyway.
+    CBenchmarkProofVerifier verifier;
+    for (size_t n = 0; n < nProofs; n++) {
+        CProofVerifierItem item = CreateScBenchmarkItem(uint256S(strprintf("%x", n + 1)));
+        item.proofInput = input;
+        verifier.AddItem(item);
+    }
+
+    CScProofVerificationCache::GetInstance().Clear();
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    assert(verifier.Verify(true));
+    return timer_stop(tv_start);
+}
+
+double benchmark_verify_sc_csw_proof()
+{
+    static const CCswProofVerifierInput input = CreateScBenchmarkCswInput();
+
+    CBenchmarkProofVerifier verifier;
+    CProofVerifierItem item = CreateScBenchmarkItem(uint256S("dddd"));
+    item.proofInput = std::vector<CCswProofVerifierInput>{input};
+    verifier.AddItem(item);
+
+    CScProofVerificationCache::GetInstance().Clear();
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    assert(verifier.Verify(false));
+    return timer_stop(tv_start);
+}
+
+double benchmark_sc_commitment_tree(size_t nSidechains, size_t nOutputs)
+{
+    CMutableTransaction mtx;
+    mtx.nVersion = SC_TX_VERSION;
+    for (size_t sc = 0; sc < nSidechains; sc++) {
+        uint256 scId = uint256S(strprintf("%x", sc + 1));
+        for (size_t n = 0; n < nOutputs; n++) {
+            mtx.vft_ccout.push_back(CTxForwardTransferOut(scId, CAmount(n + 1), uint256S(strprintf("%x", n)), uint160()));
+        }
+    }
+    CTransaction tx(mtx);
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    SidechainTxsCommitmentBuilder builder;
+    assert(builder.add(tx));
+    builder.getCommitment();
+    return timer_stop(tv_start);
+}
+
+double benchmark_sc_field_hash(size_t nHashes)
+{
+    CFieldElement lhs{SAMPLE_FIELD};
+    CFieldElement rhs{SAMPLE_FIELD};
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (size_t n = 0; n < nHashes; n++) {
+        lhs = CFieldElement::ComputeHash(lhs, rhs);
+    }
+    double elapsed = timer_stop(tv_start);
+
+    assert(lhs.IsValid());
+    return elapsed;
+}
+
 double benchmark_try_decrypt_notes(size_t nAddrs)
 {
     CWallet wallet;
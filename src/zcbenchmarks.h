@@ -10,9 +10,20 @@ extern double benchmark_create_joinsplit();
 extern std::vector<double> benchmark_create_joinsplit_threaded(int nThreads);
 extern double benchmark_solve_equihash();
 extern std::vector<double> benchmark_solve_equihash_threaded(int nThreads);
+/** Solutions per second of the tromp solver over nNonces runs, with the solver memory allocated once or for each run */
+extern double benchmark_solve_equihash_rate(int nNonces, bool fReuseSolver);
+extern std::vector<double> benchmark_solve_equihash_threaded(int nThreads, int nNonces, bool fReuseSolver);
 extern double benchmark_verify_joinsplit(const JSDescription &joinsplit);
 extern double benchmark_verify_equihash();
+/** The Equihash solutions of a batch of nHeaders headers, checked on nThreads threads */
+extern double benchmark_verify_equihash_batch(size_t nHeaders, int nThreads);
 extern double benchmark_large_tx();
+extern double benchmark_sc_commitment_certs(size_t nCerts);
+extern double benchmark_verify_sc_cert_proof();
+extern double benchmark_verify_sc_cert_proofs_batch(size_t nProofs);
+extern double benchmark_verify_sc_csw_proof();
+extern double benchmark_sc_commitment_tree(size_t nSidechains, size_t nOutputs);
+extern double benchmark_sc_field_hash(size_t nHashes);
 extern double benchmark_try_decrypt_notes(size_t nAddrs);
 extern double benchmark_increment_note_witnesses(size_t nTxs);
 extern double benchmark_connectblock_slow();
@@ -3,6 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "forkmanager.h"
+
+#include <algorithm>
+#include <limits>
+
 #include "forks/fork.h"
 #include "forks/fork0_originalfork.h"
 #include "forks/fork1_chainsplitfork.h"
@@ -43,6 +47,7 @@ const Fork* ForkManager::getHighestFork() const
  */
 void ForkManager::selectNetwork(const CBaseChainParams::Network network) {
     currentNetwork = network;
+    buildForkTable();
 }
 
 /**
@@ -241,21 +246,18 @@ ForkManager::~ForkManager() {
  */
 const Fork* ForkManager::getForkAtHeight(int height) const {
     
-    if (forks.empty()) {
+    if (forkTable.empty()) {
         printf("no registered forks! returning nullptr!\n");
         return nullptr;
     }
 
-    // Iterate through all the forks until fork height is higher than block height or there are no more forks
-    std::list<Fork*>::const_iterator lastIterator = forks.begin();
-    for (std::list<Fork*>::const_iterator iterator = forks.begin();iterator != forks.end();iterator++) {
-        if ((*iterator)->getHeight(currentNetwork) > height) {
-            break;
-        }
-        lastIterator = iterator;
-    }
+    // The first fork whose height is higher than block height, see buildForkTable
+    std::vector<std::pair<int, const Fork*>>::const_iterator iterator = std::upper_bound(forkTable.begin(), forkTable.end(), height,
+        [](int height, const std::pair<int, const Fork*>& entry) { return height < entry.first; });
     // return the last fork before that fork
-    return *lastIterator;
+    if (iterator != forkTable.begin())
+        iterator--;
+    return iterator->second;
 }
 
 /**
@@ -267,6 +269,21 @@ void ForkManager::registerFork(Fork* fork) {
     forks.push_back(fork);
     // sort list by height in the MAIN network. We assume that forks will always keep the same relative height order regardless of the network used
     forks.sort([](Fork* fork1, Fork* fork2) { return fork1->getHeight(CBaseChainParams::Network::MAIN) < fork2->getHeight(CBaseChainParams::Network::MAIN); });
+    buildForkTable();
+}
+
+/**
+ * @brief buildForkTable fills forkTable for the current network, in the order of the forks list, with the highest
+ * height of the forks up to each one: this is ascending even if a network did not keep the relative order of the forks,
+ * and its first entry higher than the block height is the first fork of the list higher than that height
+ */
+void ForkManager::buildForkTable() {
+    forkTable.clear();
+    int maxHeight = std::numeric_limits<int>::min();
+    for (const Fork* fork : forks) {
+        maxHeight = std::max(maxHeight, fork->getHeight(currentNetwork));
+        forkTable.push_back(std::make_pair(maxHeight, fork));
+    }
 }
 
 }
@@ -8,6 +8,7 @@
 #include "chainparamsbase.h"
 #include "amount.h"
 #include <list>
+#include <vector>
 #include "zen/replayprotectionlevel.h"
 #include "script/standard.h"
 #include "forks/fork.h"
@@ -156,11 +157,21 @@ private:
      * @brief registerFork used internally to register a new fork
      */
     void registerFork(Fork* fork);
+
+    /**
+     * @brief buildForkTable used internally to index the forks by height in the current network
+     */
+    void buildForkTable();
     
     /**
      * @brief forks stores the list of all forks sorted by ascending height
      */
     std::list<Fork*> forks;
+
+    /**
+     * @brief forkTable the forks in the same order, each with the height from which getForkAtHeight returns it
+     */
+    std::vector<std::pair<int, const Fork*>> forkTable;
     
     /**
      * @brief currentNetwork currently selected network
@@ -16,6 +16,61 @@ using namespace std;
 namespace zen
 {
 
+/** The client sessions by server address, owned until resumed or dropped */
+static CCriticalSection cs_clientSessions;
+static std::map<std::string, SSL_SESSION*> mapClientSessions;
+
+/** The address of the peer of ssl, as the key of mapClientSessions */
+static std::string GetSessionKey(SSL* ssl)
+{
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    CService addr;
+    if (getpeername(SSL_get_fd(ssl), (struct sockaddr*)&sockaddr, &len) != 0 || !addr.SetSockAddr((const struct sockaddr*)&sockaddr))
+        return std::string();
+    return addr.ToStringIPPort();
+}
+
+/**
+ * Keep the sessions the servers give us, for the next connection to them to be resumed without a full
+ * handshake. With TLS 1.3 they come as tickets after the handshake, possibly more than one.
+ */
+static int newClientSessionCallback(SSL* ssl, SSL_SESSION* session)
+{
+    std::string strKey = GetSessionKey(ssl);
+    if (strKey.empty())
+        return 0;
+
+    LOCK(cs_clientSessions);
+    std::map<std::string, SSL_SESSION*>::iterator it = mapClientSessions.find(strKey);
+    if (it != mapClientSessions.end()) {
+        SSL_SESSION_free(it->second);
+        it->second = session;
+    } else {
+        if (mapClientSessions.size() >= TLSManager::MAX_CLIENT_SESSIONS) {
+            SSL_SESSION_free(mapClientSessions.begin()->second);
+            mapClientSessions.erase(mapClientSessions.begin());
+        }
+        mapClientSessions[strKey] = session;
+    }
+    // the session is ours now
+    return 1;
+}
+
+/** Try to resume the session of the last connection to addr, which may have expired */
+static void UseClientSession(SSL* ssl, const CAddress& addr)
+{
+    LOCK(cs_clientSessions);
+    std::map<std::string, SSL_SESSION*>::iterator it = mapClientSessions.find(addr.ToStringIPPort());
+    if (it == mapClientSessions.end())
+        return;
+    if (SSL_SESSION_is_resumable(it->second) && SSL_set_session(ssl, it->second) == 1)
+        LogPrint("tls", "TLS: resuming the session with %s\n", addr.ToString());
+    // a TLS 1.3 ticket is used only once, and a failed connection may come from a stale session
+    SSL_SESSION_free(it->second);
+    mapClientSessions.erase(it);
+}
+
 // this is the 'dh crypto environment' to be shared between two peers and it is meant to be public, therefore
 // it is OK to hard code it (or as an alternative to read it from a file)
 // ----
@@ -346,6 +401,7 @@ SSL* TLSManager::connect(SOCKET hSocket, const CAddress& addrConnect, unsigned l
 
     if ((ssl = SSL_new(tls_ctx_client))) {
         if (SSL_set_fd(ssl, hSocket)) {
+            UseClientSession(ssl, addrConnect);
             int ret = TLSManager::waitFor(SSL_CONNECT, hSocket, ssl, (DEFAULT_CONNECT_TIMEOUT / 1000), err_code);
             if (ret == 1)
             {
@@ -363,8 +419,9 @@ SSL* TLSManager::connect(SOCKET hSocket, const CAddress& addrConnect, unsigned l
 
 
     if (bConnectedTLS) {
-        LogPrintf("TLS: connection to %s has been established (tlsv = %s 0x%04x / ssl = %s 0x%x ). Using cipher: %s\n",
-            addrConnect.ToString(), SSL_get_version(ssl), SSL_version(ssl), OpenSSL_version(OPENSSL_VERSION), OpenSSL_version_num(), SSL_get_cipher(ssl));
+        LogPrintf("TLS: connection to %s has been established (tlsv = %s 0x%04x / ssl = %s 0x%x ). Using cipher: %s%s\n",
+            addrConnect.ToString(), SSL_get_version(ssl), SSL_version(ssl), OpenSSL_version(OPENSSL_VERSION), OpenSSL_version_num(), SSL_get_cipher(ssl),
+            SSL_session_reused(ssl) ? " (resumed)" : "");
     } else {
         LogPrintf("TLS: %s: %s():%d - TLS connection to %s failed (err_code 0x%X)\n",
             __FILE__, __func__, __LINE__, addrConnect.ToString(), err_code);
@@ -434,7 +491,21 @@ SSL_CTX* TLSManager::initCtx(
 
             LogPrintf("TLS: %s: %s():%d - setting dh callback\n", __FILE__, __func__, __LINE__);
             SSL_CTX_set_tmp_dh_callback(tlsCtx, tmp_dh_callback);
+
+            // Let the peers reconnecting resume their session, by ticket or by session id, skipping the key
+            // exchange and the certificate checks. A session id context is required with SSL_VERIFY_PEER.
+            static const unsigned char sessionIdContext[] = "zend";
+            SSL_CTX_set_session_id_context(tlsCtx, sessionIdContext, sizeof(sessionIdContext) - 1);
+            SSL_CTX_set_session_cache_mode(tlsCtx, SSL_SESS_CACHE_SERVER);
+            SSL_CTX_sess_set_cache_size(tlsCtx, SERVER_SESSION_CACHE_SIZE);
         }
+        else
+        {
+            // the sessions are kept by server address, see newClientSessionCallback
+            SSL_CTX_set_session_cache_mode(tlsCtx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+            SSL_CTX_sess_set_new_cb(tlsCtx, newClientSessionCallback);
+        }
+        SSL_CTX_set_timeout(tlsCtx, SESSION_TIMEOUT);
 
         // Fix for Secure Client-Initiated Renegotiation DoS threat
         SSL_CTX_set_options(tlsCtx, SSL_OP_NO_RENEGOTIATION);
@@ -520,58 +591,73 @@ bool TLSManager::prepareCredentials()
     return bPrepared;
 }
 /**
- * @brief accept a TLS connection
+ * @brief start accepting a TLS connection, the handshake is then driven by continueAccept
  * 
- * @param hSocket the TLS socket.
+ * @param hSocket the TLS socket, non blocking.
  * @param addr incoming address.
- * @param tls_ctx_server TLS server context.
  * @return SSL* returns pointer to the ssl object if successful, otherwise returns NULL
  */
-SSL* TLSManager::accept(SOCKET hSocket, const CAddress& addr, unsigned long& err_code)
+SSL* TLSManager::beginAccept(SOCKET hSocket, const CAddress& addr, unsigned long& err_code)
 {
     LogPrint("tls", "TLS: accepting connection from %s (tid = %X)\n", addr.ToString(), pthread_self());
 
     err_code = 0; 
-    SSL* ssl = NULL;
-    bool bAcceptedTLS = false;
-
-    if ((ssl = SSL_new(tls_ctx_server))) {
-        if (SSL_set_fd(ssl, hSocket)) {
-            int ret = TLSManager::waitFor(SSL_ACCEPT, hSocket, ssl, (DEFAULT_CONNECT_TIMEOUT / 1000), err_code);
-            if (ret == 1)
-            {
-                bAcceptedTLS = true;
-            }
-        }
-    }
-    else
-    {
+    SSL* ssl = SSL_new(tls_ctx_server);
+    if (!ssl) {
         err_code = ERR_get_error();
         const char* error_str = ERR_error_string(err_code, NULL);
         LogPrint("tls", "TLS: %s: %s():%d - SSL_new failed err: %s\n",
             __FILE__, __func__, __LINE__, error_str);
+        return NULL;
     }
+    if (!SSL_set_fd(ssl, hSocket)) {
+        err_code = ERR_get_error();
+        LogPrint("tls", "TLS: %s: %s():%d - SSL_set_fd failed\n", __FILE__, __func__, __LINE__);
+        SSL_free(ssl);
+        return NULL;
+    }
+    return ssl;
+}
+/**
+ * @brief run the server side of the handshake as far as it goes without blocking
+ * 
+ * @param ssl the ssl object from beginAccept.
+ * @param addr incoming address.
+ * @param nWantEvents set to the SocketEvent the socket has to wait for, while in progress.
+ * @return int returns 1 if the connection is accepted, 0 while in progress, -1 on failure.
+ */
+int TLSManager::continueAccept(SSL* ssl, const CAddress& addr, int& nWantEvents, unsigned long& err_code)
+{
+    err_code = 0;
+    ERR_clear_error(); // clear the error queue, otherwise we may be reading an old error that occurred previously in the current thread
 
-    if (bAcceptedTLS) {
-        LogPrintf("TLS: connection from %s has been accepted (tlsv = %s 0x%04x / ssl = %s 0x%x ). Using cipher: %s\n",
-            addr.ToString(), SSL_get_version(ssl), SSL_version(ssl), OpenSSL_version(OPENSSL_VERSION), OpenSSL_version_num(), SSL_get_cipher(ssl));
-
-        STACK_OF(SSL_CIPHER) *sk = SSL_get_ciphers(ssl); 
-        for (int i = 0; i < sk_SSL_CIPHER_num(sk); i++) {
-            const SSL_CIPHER *c = sk_SSL_CIPHER_value(sk, i);
-            LogPrint("tls", "TLS: supporting cipher: %s\n", SSL_CIPHER_get_name(c));
+    int retOp = SSL_accept(ssl);
+    if (retOp != 1) {
+        int sslErr = SSL_get_error(ssl, retOp);
+        if (sslErr == SSL_ERROR_WANT_READ || sslErr == SSL_ERROR_WANT_WRITE) {
+            nWantEvents = (sslErr == SSL_ERROR_WANT_READ) ? SOCKET_EVENT_RECV : SOCKET_EVENT_SEND;
+            return 0;
         }
-    } else {
+
+        err_code = ERR_get_error();
+        const char* error_str = ERR_error_string(err_code, NULL);
+        LogPrint("tls", "TLS: WARNING: %s: %s():%d - SSL_ACCEPT sslErr[0x%x], retOp[%d], err: %s\n",
+            __FILE__, __func__, __LINE__, sslErr, retOp, error_str);
         LogPrintf("TLS: %s: %s():%d - TLS connection from %s failed (err_code 0x%X)\n",
             __FILE__, __func__, __LINE__, addr.ToString(), err_code);
-
-        if (ssl) {
-            SSL_free(ssl);
-            ssl = NULL;
-        }
+        return -1;
     }
 
-    return ssl;
+    LogPrintf("TLS: connection from %s has been accepted (tlsv = %s 0x%04x / ssl = %s 0x%x ). Using cipher: %s%s\n",
+        addr.ToString(), SSL_get_version(ssl), SSL_version(ssl), OpenSSL_version(OPENSSL_VERSION), OpenSSL_version_num(), SSL_get_cipher(ssl),
+        SSL_session_reused(ssl) ? " (resumed)" : "");
+
+    STACK_OF(SSL_CIPHER) *sk = SSL_get_ciphers(ssl); 
+    for (int i = 0; i < sk_SSL_CIPHER_num(sk); i++) {
+        const SSL_CIPHER *c = sk_SSL_CIPHER_value(sk, i);
+        LogPrint("tls", "TLS: supporting cipher: %s\n", SSL_CIPHER_get_name(c));
+    }
+    return 1;
 }
 /**
  * @brief Determines whether a string exists in the non-TLS address pool.
@@ -620,12 +706,10 @@ void TLSManager::cleanNonTLSPool(std::vector<NODE_ADDR>& vPool, CCriticalSection
  * @brief Handles send and recieve functionality in TLS Sockets.
  * 
  * @param pnode reference to the CNode object.
- * @param fdsetRecv 
- * @param fdsetSend 
- * @param fdsetError 
+ * @param poller the socket poller, after its wait.
  * @return int returns -1 when socket is invalid. returns 0 otherwise.
  */
-int TLSManager::threadSocketHandler(CNode* pnode, fd_set& fdsetRecv, fd_set& fdsetSend, fd_set& fdsetError)
+int TLSManager::threadSocketHandler(CNode* pnode, const CSocketPoller& poller)
 {
     //
     // Receive
@@ -638,9 +722,10 @@ int TLSManager::threadSocketHandler(CNode* pnode, fd_set& fdsetRecv, fd_set& fds
         if (pnode->hSocket == INVALID_SOCKET)
             return -1;
 
-        recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-        sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-        errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+        int nEvents = poller.GetEvents(pnode->hSocket);
+        recvSet = (nEvents & SOCKET_EVENT_RECV) != 0;
+        sendSet = (nEvents & SOCKET_EVENT_SEND) != 0;
+        errorSet = (nEvents & SOCKET_EVENT_ERROR) != 0;
     }
 
     if (recvSet || errorSet) {
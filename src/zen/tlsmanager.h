@@ -6,6 +6,7 @@
 #include <boost/thread.hpp>
 #include "../util.h"
 #include "../net.h"
+#include "../socketpoller.h"
 #include "sync.h"
 #include <boost/filesystem/path.hpp>
 #include <boost/foreach.hpp>
@@ -43,6 +44,12 @@ public:
         function code and reason code. */
      static const long SELECT_TIMEDOUT = 0xFFFFFFFF;
 
+     /* The TLS sessions of the servers kept by the client context, to resume them on reconnection */
+     static const size_t MAX_CLIENT_SESSIONS = 1000;
+     /* The sessions kept by the server context, and their lifetime in seconds */
+     static const long SERVER_SESSION_CACHE_SIZE = 1000;
+     static const long SESSION_TIMEOUT = 2 * 60 * 60;
+
      int waitFor(SSLConnectionRoutine eRoutine, SOCKET hSocket, SSL* ssl, int timeoutSec, unsigned long& err_code);
 
      SSL* connect(SOCKET hSocket, const CAddress& addrConnect, unsigned long& err_code);
@@ -53,10 +60,11 @@ public:
         const std::vector<boost::filesystem::path>& trustedDirs);
 
      bool prepareCredentials();
-     SSL* accept(SOCKET hSocket, const CAddress& addr, unsigned long& err_code);
+     SSL* beginAccept(SOCKET hSocket, const CAddress& addr, unsigned long& err_code);
+     int continueAccept(SSL* ssl, const CAddress& addr, int& nWantEvents, unsigned long& err_code);
      bool isNonTLSAddr(const string& strAddr, const vector<NODE_ADDR>& vPool, CCriticalSection& cs);
      void cleanNonTLSPool(std::vector<NODE_ADDR>& vPool, CCriticalSection& cs);
-     int threadSocketHandler(CNode* pnode, fd_set& fdsetRecv, fd_set& fdsetSend, fd_set& fdsetError);
+     int threadSocketHandler(CNode* pnode, const CSocketPoller& poller);
      bool initialize();
 };
 }
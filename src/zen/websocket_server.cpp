@@ -1,3 +1,4 @@
+#include "websocket_server.h"
 #include "../util.h"
 #include <univalue.h>
 #include <boost/unordered_map.hpp>
@@ -12,18 +13,25 @@
 #include <thread>
 #include <boost/thread.hpp>
 #include <boost/asio.hpp>
-#include <boost/lockfree/queue.hpp>
-#include <boost/lockfree/spsc_queue.hpp>
-#include <queue>
+#include <boost/asio/strand.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <deque>
+#include <memory>
 #include "validationinterface.h"
 #include "main.h"
 #include "consensus/validation.h"
 #include <univalue.h>
 #include "uint256.h"
 #include "utilmoneystr.h"
+#include "headercache.h"
+#include "chainparams.h"
+#include "txmempool.h"
+#include "rpc/server.h"
+#include "scactivityindexer.h"
 
 extern UniValue sc_send_certificate(const UniValue& params, bool fHelp);
 extern CAmount AmountFromValue(const UniValue& value);
+extern UniValue ValueFromAmount(const CAmount& amount);
 
 using tcp = boost::asio::ip::tcp;
 
@@ -31,26 +39,40 @@ namespace websocket = boost::beast::websocket;
 namespace http = boost::beast::http;
 
 namespace net = boost::asio;
-net::io_context ioc;
 
 static int MAX_BLOCKS_REQUEST = 100;
 static int MAX_HEADERS_REQUEST = 50;
 static int MAX_SIDECHAINS_REQUEST = 50;
+static int MAX_BLOCK_RANGE_REQUEST = 10000;
+//! the blocks of a range sent before the client grants more credit, by default and at most
+static int DEFAULT_BLOCK_RANGE_CREDIT = 10;
+static int MAX_BLOCK_RANGE_CREDIT = 100;
+//! the blocks of a range read from disk ahead of the socket
+static unsigned int BLOCK_RANGE_PREFETCH = 4;
 static int tot_connections = 0;
 
 class WsNotificationInterface;
 class WsHandler;
 
-static int getblock(const CBlockIndex *pindex, std::string& blockHexStr);
+static int getblock(const CBlockIndex *pindex, CBlock& block);
+static int getheader(const CBlockIndex *pindex, CDataStream& ss);
 static int getheader(const CBlockIndex *pindex, std::string& blockHexStr);
 static void ws_updatetip(const CBlockIndex *pindex);
+static void ws_updatetemplate(const CBlockIndex *pindexPrev, const CAmount& nFeeGain);
 
 static boost::shared_ptr<WsNotificationInterface> wsNotificationInterface;
 static std::list< boost::shared_ptr<WsHandler> > listWsHandler;
 
-std::atomic<bool> exit_ws_thread{false};
-boost::thread ws_thread;
+/** All the connections are served by the same io_context, from a small pool of threads */
+static std::unique_ptr<net::io_context> wsIoContext;
+static std::unique_ptr<tcp::acceptor> wsAcceptor;
+static boost::thread_group wsThreadGroup;
+//! the bytes queued for a connection at most, and what happens to a slow connection going beyond
+static uint64_t nWsMaxQueueBytes = DEFAULT_WS_MAX_QUEUE_BYTES;
+static bool fWsDropSlowClientEvents = false;
 std::mutex wsmtx;
+//! set under wsmtx when the server stops, for the connections accepted meanwhile to be dropped
+static bool fWsStopping = false;
 
 static void dumpUniValueError(const UniValue& error, std::string& outMsg)
 {
@@ -83,6 +105,9 @@ protected:
     virtual void UpdatedBlockTip(const CBlockIndex *pindex) {
         ws_updatetip(pindex);
     };
+    virtual void UpdatedBlockTemplate(const CBlockIndex *pindexPrev, const CAmount& nFeeGain) {
+        ws_updatetemplate(pindexPrev, nFeeGain);
+    };
 public:
     ~WsNotificationInterface() 
     {
@@ -95,6 +120,7 @@ class WsEvent
 public:
     enum WsEventType {
         UPDATE_TIP = 0,
+        NEW_BLOCK_TEMPLATE = 1,
         EVT_UNDEFINED = 0xff
     };
     enum WsRequestType {
@@ -105,6 +131,12 @@ public:
         GET_MULTIPLE_BLOCK_HEADERS = 4,
         GET_TOP_QUALITY_CERTIFICATES = 5,
         GET_SIDECHAIN_VERSIONS = 6,
+        SET_BINARY_MODE = 7,
+        GET_BLOCK_RANGE = 8,
+        BLOCK_RANGE_CREDIT = 9,
+        SET_SC_FILTER = 10,
+        SUBMIT_CERTIFICATE = 11,
+        GET_SC_ACTIVITY = 12,
         REQ_UNDEFINED = 0xff
     };
     
@@ -132,43 +164,378 @@ private:
     UniValue payload;
 };
 
+/**
+ * The figures of the whole server, for getwsserverinfo, under cs_wsMetrics: the requests by type, the last
+ * entry for the unknown ones, and the frames by kind of WsHandler::FrameKind. Reset when the server starts.
+ */
+static std::mutex cs_wsMetrics;
+static WsServerStats wsMetrics;
 
+void WsLatencyStats::Add(int64_t nMicros)
+{
+    uint64_t n = std::max(nMicros, (int64_t)0);
+    int nBucket = 0;
+    while (nBucket < BUCKETS - 1 && (n >> nBucket) != 0)
+        nBucket++;
+    nCount++;
+    nTotalMicros += n;
+    nMaxMicros = std::max(nMaxMicros, n);
+    vBuckets[nBucket]++;
+}
 
-class WsHandler
+static const char* wsRequestTypeName(int reqType)
 {
-private:
-    std::condition_variable writeCV;
-    std::mutex writeMutex;
+    switch (reqType)
+    {
+        case WsEvent::GET_SINGLE_BLOCK:             return "getsingleblock";
+        case WsEvent::GET_MULTIPLE_BLOCK_HASHES:    return "getmultipleblockhashes";
+        case WsEvent::GET_NEW_BLOCK_HASHES:         return "getnewblockhashes";
+        case WsEvent::SEND_CERTIFICATE:             return "sendcertificate";
+        case WsEvent::GET_MULTIPLE_BLOCK_HEADERS:   return "getmultipleblockheaders";
+        case WsEvent::GET_TOP_QUALITY_CERTIFICATES: return "gettopqualitycertificates";
+        case WsEvent::GET_SIDECHAIN_VERSIONS:       return "getsidechainversions";
+        case WsEvent::SET_BINARY_MODE:              return "setbinarymode";
+        case WsEvent::GET_BLOCK_RANGE:              return "getblockrange";
+        case WsEvent::BLOCK_RANGE_CREDIT:           return "blockrangecredit";
+        case WsEvent::SET_SC_FILTER:                return "setscfilter";
+        case WsEvent::SUBMIT_CERTIFICATE:           return "submitcertificate";
+        case WsEvent::GET_SC_ACTIVITY:              return "getscactivity";
+        default:                                    return "unknown";
+    }
+}
+
+static void resetWsMetrics()
+{
+    std::unique_lock<std::mutex> lck(cs_wsMetrics);
+    wsMetrics = WsServerStats();
+    for (int reqType = 0; reqType <= WsEvent::GET_SC_ACTIVITY + 1; reqType++)
+    {
+        wsMetrics.vRequests.emplace_back();
+        wsMetrics.vRequests.back().name = wsRequestTypeName(reqType);
+    }
+    for (const char* name : { "response", "event", "tipevent", "templateevent" })
+    {
+        wsMetrics.vOutputs.emplace_back();
+        wsMetrics.vOutputs.back().name = name;
+    }
+}
+
+//! A request read from a connection, in nParseMicros and nHandlerMicros; a negative nHandlerMicros when it is timed apart
+static void recordWsRequest(int reqType, size_t nBytes, bool fError, int64_t nParseMicros, int64_t nHandlerMicros)
+{
+    std::unique_lock<std::mutex> lck(cs_wsMetrics);
+    if (wsMetrics.vRequests.empty())
+        return;
+    WsRequestStats& req = wsMetrics.vRequests[std::min(std::max(reqType, 0), (int)wsMetrics.vRequests.size() - 1)];
+    wsMetrics.nRecvFrames++;
+    wsMetrics.nRecvBytes += nBytes;
+    if (fError)
+        req.nErrors++;
+    req.parse.Add(nParseMicros);
+    if (nHandlerMicros >= 0)
+        req.handler.Add(nHandlerMicros);
+}
+
+static void recordWsRequestHandler(int reqType, int64_t nHandlerMicros)
+{
+    std::unique_lock<std::mutex> lck(cs_wsMetrics);
+    if (!wsMetrics.vRequests.empty())
+        wsMetrics.vRequests[std::min(std::max(reqType, 0), (int)wsMetrics.vRequests.size() - 1)].handler.Add(nHandlerMicros);
+}
+
+static void recordWsOutput(int kind, size_t nBytes, uint64_t nMaxQueuedBytes, int64_t nQueueWaitMicros, int64_t nWriteMicros)
+{
+    std::unique_lock<std::mutex> lck(cs_wsMetrics);
+    if (kind < 0 || kind >= (int)wsMetrics.vOutputs.size())
+        return;
+    wsMetrics.nSentFrames++;
+    wsMetrics.nSentBytes += nBytes;
+    wsMetrics.nMaxQueuedBytes = std::max(wsMetrics.nMaxQueuedBytes, nMaxQueuedBytes);
+    wsMetrics.vOutputs[kind].queueWait.Add(nQueueWaitMicros);
+    wsMetrics.vOutputs[kind].write.Add(nWriteMicros);
+}
+
+typedef std::set<uint256> ScFilter;
+
+/**
+ * A block filtered for the sidechains a connection subscribed to: the header, the number of transactions and
+ * certificates of the block, and the ones touching the sidechains (creations, forward transfers, backward transfer
+ * requests and ceased sidechain withdrawals, certificates), each with its index in the block and its merkle branch
+ * to the hashMerkleRoot of the header.
+ */
+struct WsFilteredBlock
+{
+    CBlockHeader header;
+    uint32_t nTxCount;
+    std::vector<uint32_t> vtxIndex;
+    std::vector<CTransaction> vtx;
+    std::vector<std::vector<uint256>> vtxMerkleBranch;
+    std::vector<uint32_t> vcertIndex;
+    std::vector<CScCertificate> vcert;
+    std::vector<std::vector<uint256>> vcertMerkleBranch;
+
+    WsFilteredBlock(const CBlock& block, const ScFilter& filter) :
+        header(block.GetBlockHeader()), nTxCount(block.vtx.size() + block.vcert.size())
+    {
+        for (size_t i = 0; i < block.vtx.size(); i++)
+        {
+            if (IsRelevant(block.vtx[i], filter))
+            {
+                vtxIndex.push_back(i);
+                vtx.push_back(block.vtx[i]);
+                vtxMerkleBranch.push_back(block.GetMerkleBranch(i));
+            }
+        }
+        for (size_t i = 0; i < block.vcert.size(); i++)
+        {
+            if (filter.count(block.vcert[i].GetScId()))
+            {
+                // the certificates follow the transactions in the merkle tree
+                vcertIndex.push_back(block.vtx.size() + i);
+                vcert.push_back(block.vcert[i]);
+                vcertMerkleBranch.push_back(block.GetMerkleBranch(block.vtx.size() + i));
+            }
+        }
+    }
+
+    static bool IsRelevant(const CTransaction& tx, const ScFilter& filter)
+    {
+        for (size_t i = 0; i < tx.GetVscCcOut().size(); i++)
+            if (filter.count(tx.GetScIdFromScCcOut(i)))
+                return true;
+        for (const CTxForwardTransferOut& ft : tx.GetVftCcOut())
+            if (filter.count(ft.GetScId()))
+                return true;
+        for (const CBwtRequestOut& mbtr : tx.GetVBwtRequestOut())
+            if (filter.count(mbtr.GetScId()))
+                return true;
+        for (const CTxCeasedSidechainWithdrawalInput& csw : tx.GetVcswCcIn())
+            if (filter.count(csw.scId))
+                return true;
+        return false;
+    }
+
+    UniValue ToJSON(int height) const
+    {
+        UniValue ret(UniValue::VOBJ);
+        ret.pushKV("height", height);
+        ret.pushKV("hash", header.GetHash().GetHex());
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << header;
+        ret.pushKV("header", HexStr(ss.begin(), ss.end()));
+        ret.pushKV("txCount", (uint64_t)nTxCount);
+        ret.pushKV("txs", EntriesToJSON(vtxIndex, vtx, vtxMerkleBranch, "tx"));
+        ret.pushKV("certs", EntriesToJSON(vcertIndex, vcert, vcertMerkleBranch, "cert"));
+        return ret;
+    }
+
+    template <typename T>
+    static UniValue EntriesToJSON(const std::vector<uint32_t>& vIndex, const std::vector<T>& vEntry,
+            const std::vector<std::vector<uint256>>& vMerkleBranch, const std::string& strName)
+    {
+        UniValue entries(UniValue::VARR);
+        for (size_t i = 0; i < vEntry.size(); i++)
+        {
+            UniValue entry(UniValue::VOBJ);
+            entry.pushKV("index", (uint64_t)vIndex[i]);
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << vEntry[i];
+            entry.pushKV(strName, HexStr(ss.begin(), ss.end()));
+            UniValue branch(UniValue::VARR);
+            for (const uint256& hash : vMerkleBranch[i])
+                branch.push_back(hash.GetHex());
+            entry.pushKV("merkleBranch", branch);
+            entries.push_back(entry);
+        }
+        return entries;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(header);
+        READWRITE(nTxCount);
+        READWRITE(vtxIndex);
+        READWRITE(vtx);
+        READWRITE(vtxMerkleBranch);
+        READWRITE(vcertIndex);
+        READWRITE(vcert);
+        READWRITE(vcertMerkleBranch);
+    }
+};
 
+/**
+ * A connection, served asynchronously: every operation on its socket completes on the strand of the
+ * socket, so the handlers of a connection never run concurrently and need no locking. The handler is
+ * kept alive by its pending operations, and by listWsHandler until it is closed.
+ */
+class WsHandler : public boost::enable_shared_from_this<WsHandler>
+{
+private:
     boost::shared_ptr< websocket::stream<tcp::socket>> localWs;
-    boost::lockfree::queue<WsEvent*, boost::lockfree::capacity<1024>> wsq;
-    std::atomic<bool> exit_rwhandler_thread_flag { false };
+    boost::beast::flat_buffer readBuffer;
+    //! how a queued frame is given up when the connection is slow: the answers never are, a newer tip or
+    //! template event supersedes the queued one, every event can be dropped when the budget is exceeded
+    enum FrameKind
+    {
+        FRAME_RESPONSE,
+        FRAME_EVENT,
+        FRAME_TIP_EVENT,
+        FRAME_TEMPLATE_EVENT,
+    };
+
+    struct WsFrame
+    {
+        std::shared_ptr<const std::string> msg;
+        bool fBinary;
+        FrameKind kind;
+        int64_t nQueuedTime; //!< when the frame was handed to the strand, in microseconds
+    };
+
+    //! the messages not yet written, in order; only accessed on the strand. The events are shared by all the connections.
+    std::deque<WsFrame> writeQueue;
+    //! set on the strand once the websocket handshake is over, while the front of writeQueue is being written,
+    //! and when the connection is closed
+    bool fAccepted = false;
+    bool fWriting = false;
+    bool fClosed = false;
+    //! when the front of writeQueue started being written, and the end of the parsing of the request being read
+    int64_t nWriteStart = 0;
+    int64_t nParseEnd = 0;
+
+    //! the figures of the input and the output of the connection, updated on the strand, for getwsinfo
+    std::string strPeer;
+    std::atomic<uint64_t> nRecvFrames { 0 };
+    std::atomic<uint64_t> nRecvBytes { 0 };
+    std::atomic<uint64_t> nQueuedFrames { 0 };
+    std::atomic<uint64_t> nQueuedBytes { 0 };
+    std::atomic<uint64_t> nMaxQueuedBytes { 0 };
+    std::atomic<uint64_t> nSentFrames { 0 };
+    std::atomic<uint64_t> nSentBytes { 0 };
+    std::atomic<uint64_t> nCoalesced { 0 };
+    std::atomic<uint64_t> nDropped { 0 };
+    //! the blocks and the headers are sent in binary frames, see makeBinaryFrame()
+    std::atomic<bool> fBinary { false };
+
+    /**
+     * A GET_BLOCK_RANGE being streamed, only accessed on the strand. The blocks are read from disk on the
+     * threads of the pool, a few ahead of the socket, and sent as long as the client has credit for them.
+     */
+    struct BlockRange
+    {
+        std::string requestId;
+        int nNextHeight;  //!< the next block to read
+        int nEndHeight;
+        int nCredit;
+        bool fReading;
+        std::deque<WsFrame> vReady;
+    };
+    std::unique_ptr<BlockRange> blockRange;
+
+    //! the sidechains the blocks are filtered for, none if empty; read by the threads of the validation interface too
+    std::shared_ptr<const ScFilter> scFilter { std::make_shared<const ScFilter>() };
+
+    //! Serialize the message, and delete it
+    static std::shared_ptr<const std::string> makeFrame(WsEvent* wse)
+    {
+        std::shared_ptr<const std::string> msg = std::make_shared<const std::string>(wse->getPayload()->write());
+        LogPrint("ws", "%s():%d - deleting %p\n", __func__, __LINE__, wse);
+        delete wse;
+        return msg;
+    }
 
     void write(WsEvent* wse)
     {
-        wsq.push(wse);
-        writeCV.notify_one();
+        writeFrame(makeFrame(wse));
     }
-    void sendBlockEvent(int height, const std::string& strHash, const std::string& blockHex, WsEvent::WsEventType eventType)
+
+    void writeFrame(const std::shared_ptr<const std::string>& msg, bool fBinaryFrame = false, FrameKind kind = FRAME_RESPONSE)
     {
-        // Send a message to the client:  type = eventType
-        WsEvent* wse = new WsEvent(WsEvent::MSG_EVENT);
-        LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
-        UniValue rspPayload(UniValue::VOBJ);
-        rspPayload.pushKV("height", height);
-        rspPayload.pushKV("hash", strHash);
-        rspPayload.pushKV("block", blockHex);
+        // the events come from the threads of the validation interface too: hand the message over to
+        // the strand, which starts writing right away if it was idle
+        net::post(localWs->get_executor(),
+            boost::beast::bind_front_handler(&WsHandler::queueWrite, shared_from_this(), WsFrame { msg, fBinaryFrame, kind, GetTimeMicros() }));
+    }
 
-        UniValue* rv = wse->getPayload();
-        rv->pushKV("eventType", eventType);
-        rv->pushKV("eventPayload", rspPayload);
-        write(wse);
+    void queueWrite(const WsFrame& frame)
+    {
+        if (fClosed)
+            return;
+
+        if (frame.kind == FRAME_TIP_EVENT || frame.kind == FRAME_TEMPLATE_EVENT)
+        {
+            // only the latest tip, or template, matters: the one still waiting is superseded
+            for (auto it = writeQueue.begin() + (fWriting ? 1 : 0); it != writeQueue.end(); ++it)
+            {
+                if (it->kind == frame.kind)
+                {
+                    nQueuedBytes -= it->msg->size();
+                    writeQueue.erase(it);
+                    nCoalesced++;
+                    break;
+                }
+            }
+        }
+
+        // a single frame larger than the budget still goes, once the queue is empty
+        if (!writeQueue.empty() && nQueuedBytes + frame.msg->size() > nWsMaxQueueBytes)
+        {
+            if (frame.kind != FRAME_RESPONSE && fWsDropSlowClientEvents)
+            {
+                LogPrint("ws", "%s():%d - connection[%u] slow, %u bytes queued: event dropped\n", __func__, __LINE__,
+                    t_id, nQueuedBytes);
+                nDropped++;
+                return;
+            }
+            LogPrintf("websocket connection[%u] from %s too slow, %u bytes queued: disconnecting\n",
+                t_id, strPeer, nQueuedBytes);
+            close();
+            return;
+        }
+
+        writeQueue.push_back(frame);
+        nQueuedFrames = writeQueue.size();
+        nQueuedBytes += frame.msg->size();
+        nMaxQueuedBytes = std::max(nMaxQueuedBytes.load(), nQueuedBytes.load());
+        if (fAccepted && !fWriting)
+            doWrite();
     }
 
-    void sendBlock(int height, const std::string& strHash, const std::string& blockHex,
-            WsEvent::WsMsgType msgType, std::string clientRequestId = "")
+    void doWrite()
     {
-        // Send a message to the client:  type = eventType
+        fWriting = true;
+        nWriteStart = GetTimeMicros();
+        localWs->binary(writeQueue.front().fBinary);
+        localWs->async_write(net::buffer(*writeQueue.front().msg),
+            boost::beast::bind_front_handler(&WsHandler::onWrite, shared_from_this()));
+    }
+
+    void onWrite(boost::beast::error_code ec, std::size_t bytes)
+    {
+        if (ec)
+        {
+            LogPrint("ws", "%s():%d - err[%d]: %s\n", __func__, __LINE__, ec.value(), ec.message());
+            close();
+            return;
+        }
+        LogPrint("ws", "%s():%d - msg of size=%d written on client socket\n", __func__, __LINE__, bytes);
+        fWriting = false;
+        const WsFrame& frame = writeQueue.front();
+        recordWsOutput(frame.kind, bytes, nMaxQueuedBytes, nWriteStart - frame.nQueuedTime, GetTimeMicros() - nWriteStart);
+        nQueuedBytes -= frame.msg->size();
+        nSentFrames++;
+        nSentBytes += bytes;
+        writeQueue.pop_front();
+        nQueuedFrames = writeQueue.size();
+        if (!fClosed && !writeQueue.empty())
+            doWrite();
+    }
+
+    static std::shared_ptr<const std::string> makeBlockResponse(int height, const std::string& strHash, const std::string& blockHex,
+            WsEvent::WsMsgType msgType, const std::string& clientRequestId)
+    {
+        // A message to the client:  type = eventType
         WsEvent* wse = new WsEvent(msgType);
         LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
         UniValue rspPayload(UniValue::VOBJ);
@@ -180,7 +547,7 @@ private:
         if (!clientRequestId.empty())
             rv->pushKV("requestId", clientRequestId);
         rv->pushKV("responsePayload", rspPayload);
-        write(wse);
+        return makeFrame(wse);
     }
 
     void sendHashes(int height, std::list<CBlockIndex*>& listBlock,
@@ -273,6 +640,229 @@ private:
         write(wse);
     }
 
+    void sendScActivity(const uint256& scId, int fromHeight, int toHeight, const UniValue& activity,
+                        WsEvent::WsMsgType msgType, std::string clientRequestId = "")
+    {
+        WsEvent* wse = new WsEvent(msgType);
+        LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
+        UniValue rspPayload(UniValue::VOBJ);
+        rspPayload.pushKV("scid", scId.GetHex());
+        rspPayload.pushKV("fromHeight", fromHeight);
+        rspPayload.pushKV("toHeight", toHeight);
+        rspPayload.pushKV("activity", activity);
+
+        UniValue* rv = wse->getPayload();
+        if (!clientRequestId.empty())
+            rv->pushKV("requestId", clientRequestId);
+        rv->pushKV("responsePayload", rspPayload);
+        write(wse);
+    }
+
+    void sendBinaryMode(bool fBinaryMode, WsEvent::WsMsgType msgType, std::string clientRequestId = "")
+    {
+        // the answer is always a text frame
+        WsEvent* wse = new WsEvent(msgType);
+        LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
+        UniValue rspPayload(UniValue::VOBJ);
+        rspPayload.pushKV("binary", fBinaryMode);
+
+        UniValue* rv = wse->getPayload();
+        if (!clientRequestId.empty())
+            rv->pushKV("requestId", clientRequestId);
+        rv->pushKV("responsePayload", rspPayload);
+        write(wse);
+    }
+
+    void sendError(int res, const std::string& msgError, const std::string& clientRequestId)
+    {
+        WsEvent* wse = new WsEvent(WsEvent::MSG_ERROR);
+        LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
+        UniValue* rv = wse->getPayload();
+        if (!clientRequestId.empty())
+            rv->pushKV("requestId", clientRequestId);
+        rv->pushKV("errorCode", res);
+        rv->pushKV("message", msgError);
+        write(wse);
+    }
+
+    int sendBlockRange(const std::string& strHeight, const std::string& strLimit, const std::string& strCredit,
+            const std::string& clientRequestId, std::string& outMsg)
+    {
+        if (blockRange)
+        {
+            outMsg = "range " + blockRange->requestId + " still in progress";
+            return INVALID_PARAMETER;
+        }
+
+        int nHeight = -1, nLimit = -1, nCredit = DEFAULT_BLOCK_RANGE_CREDIT;
+        try {
+            nHeight = std::stoi(strHeight);
+            nLimit = std::stoi(strLimit);
+            if (!strCredit.empty())
+                nCredit = std::stoi(strCredit);
+        } catch (const std::exception &e) {
+            LogPrint("ws", "%s():%d - %s\n", __func__, __LINE__, e.what());
+            return INVALID_PARAMETER;
+        }
+        if (nLimit <= 0 || nLimit > MAX_BLOCK_RANGE_REQUEST || nCredit <= 0 || nCredit > MAX_BLOCK_RANGE_CREDIT) {
+            LogPrint("ws", "%s():%d - invalid limit %d or credit %d (max are %d and %d)\n", __func__, __LINE__,
+                nLimit, nCredit, MAX_BLOCK_RANGE_REQUEST, MAX_BLOCK_RANGE_CREDIT);
+            return INVALID_PARAMETER;
+        }
+
+        int nEndHeight = -1;
+        {
+            LOCK(cs_main);
+            if (nHeight < 0 || nHeight > chainActive.Height()) {
+                LogPrint("ws", "%s():%d - invalid height %d\n", __func__, __LINE__, nHeight);
+                return INVALID_PARAMETER;
+            }
+            nEndHeight = std::min(nHeight + nLimit - 1, chainActive.Height());
+        }
+
+        LogPrint("ws", "%s():%d - range[%s] of blocks %d to %d, credit %d\n", __func__, __LINE__,
+            clientRequestId, nHeight, nEndHeight, nCredit);
+        blockRange.reset(new BlockRange { clientRequestId, nHeight, nEndHeight, nCredit, false, {} });
+        pumpBlockRange();
+        return OK;
+    }
+
+    int addBlockRangeCredit(const std::string& strCredit, const std::string& clientRequestId)
+    {
+        if (!blockRange || blockRange->requestId != clientRequestId)
+        {
+            LogPrint("ws", "%s():%d - no range[%s] in progress\n", __func__, __LINE__, clientRequestId);
+            return INVALID_PARAMETER;
+        }
+        int nCredit = -1;
+        try {
+            nCredit = std::stoi(strCredit);
+        } catch (const std::exception &e) {
+            LogPrint("ws", "%s():%d - %s\n", __func__, __LINE__, e.what());
+            return INVALID_PARAMETER;
+        }
+        if (nCredit <= 0 || blockRange->nCredit + nCredit > MAX_BLOCK_RANGE_CREDIT) {
+            LogPrint("ws", "%s():%d - invalid credit %d (max is %d)\n", __func__, __LINE__, nCredit, MAX_BLOCK_RANGE_CREDIT);
+            return INVALID_PARAMETER;
+        }
+        blockRange->nCredit += nCredit;
+        pumpBlockRange();
+        return OK;
+    }
+
+    //! On the strand: send the blocks read the client has credit for, and read the next ones
+    void pumpBlockRange()
+    {
+        if (!blockRange || fClosed)
+            return;
+
+        while (blockRange->nCredit > 0 && !blockRange->vReady.empty())
+        {
+            writeFrame(blockRange->vReady.front().msg, blockRange->vReady.front().fBinary);
+            blockRange->vReady.pop_front();
+            blockRange->nCredit--;
+        }
+
+        if (blockRange->fReading)
+            return;
+
+        if (blockRange->nNextHeight > blockRange->nEndHeight)
+        {
+            if (blockRange->vReady.empty())
+            {
+                // the end of the range, in a text frame
+                WsEvent* wse = new WsEvent(WsEvent::MSG_RESPONSE);
+                LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
+                UniValue rspPayload(UniValue::VOBJ);
+                rspPayload.pushKV("endHeight", blockRange->nEndHeight);
+                rspPayload.pushKV("completed", true);
+
+                UniValue* rv = wse->getPayload();
+                rv->pushKV("requestId", blockRange->requestId);
+                rv->pushKV("responsePayload", rspPayload);
+                write(wse);
+                blockRange.reset();
+            }
+            return;
+        }
+
+        if (blockRange->vReady.size() < BLOCK_RANGE_PREFETCH)
+        {
+            blockRange->fReading = true;
+            net::post(*wsIoContext, boost::beast::bind_front_handler(&WsHandler::readBlockRange, shared_from_this(),
+                    blockRange->nNextHeight, blockRange->requestId, (bool)fBinary));
+        }
+    }
+
+    //! On any thread of the pool: read a block of the range, and hand it over to the strand
+    void readBlockRange(int nHeight, const std::string& clientRequestId, bool fBinaryFrame)
+    {
+        std::shared_ptr<const std::string> frame;
+        const CBlockIndex* pindex = NULL;
+        {
+            LOCK(cs_main);
+            pindex = chainActive[nHeight];
+        }
+        CBlock block;
+        if (pindex != NULL && getblock(pindex, block) == OK)
+        {
+            frame = makeBlockFrame(block, WsEvent::MSG_RESPONSE, WsEvent::GET_BLOCK_RANGE, clientRequestId,
+                    nHeight, *getScFilter(), fBinaryFrame);
+        }
+        net::post(localWs->get_executor(),
+            boost::beast::bind_front_handler(&WsHandler::onBlockRangeRead, shared_from_this(), WsFrame { frame, fBinaryFrame }));
+    }
+
+    void onBlockRangeRead(const WsFrame& frame)
+    {
+        if (!blockRange || fClosed)
+            return;
+        blockRange->fReading = false;
+        if (!frame.msg)
+        {
+            // the chain got shorter meanwhile
+            LogPrint("ws", "%s():%d - can not read block %d of range[%s]\n", __func__, __LINE__,
+                blockRange->nNextHeight, blockRange->requestId);
+            sendError(INVALID_PARAMETER, "On requestType[" + std::to_string(WsEvent::GET_BLOCK_RANGE) + "]: Invalid parameter"
+                      " - Details: block " + std::to_string(blockRange->nNextHeight) + " not found", blockRange->requestId);
+            blockRange.reset();
+            return;
+        }
+        blockRange->vReady.push_back(frame);
+        blockRange->nNextHeight++;
+        pumpBlockRange();
+    }
+
+    int setScFilter(const UniValue& scIds, const std::string& clientRequestId)
+    {
+        if (scIds.size() > MAX_SIDECHAINS_REQUEST) {
+            LogPrint("ws", "%s():%d - invalid scIds amount %d (max is %d)\n", __func__, __LINE__, scIds.size(), MAX_SIDECHAINS_REQUEST);
+            return INVALID_PARAMETER;
+        }
+
+        std::shared_ptr<ScFilter> filter = std::make_shared<ScFilter>();
+        for (const UniValue& o : scIds.getValues()) {
+            if (!o.isStr() || o.get_str().size() != 64 || !IsHex(o.get_str())) {
+                LogPrint("ws", "%s():%d - invalid scId\n", __func__, __LINE__);
+                return INVALID_PARAMETER;
+            }
+            filter->insert(uint256S(o.get_str()));
+        }
+        std::atomic_store(&scFilter, std::shared_ptr<const ScFilter>(filter));
+
+        LogPrint("ws", "%s():%d - blocks filtered for %d sidechains\n", __func__, __LINE__, filter->size());
+        WsEvent* wse = new WsEvent(WsEvent::MSG_RESPONSE);
+        LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
+        UniValue rspPayload(UniValue::VOBJ);
+        rspPayload.pushKV("scIds", (uint64_t)filter->size());
+
+        UniValue* rv = wse->getPayload();
+        rv->pushKV("requestId", clientRequestId);
+        rv->pushKV("responsePayload", rspPayload);
+        write(wse);
+        return OK;
+    }
+
     int getHashByHeight(std::string height, std::string& strHash)
     {
         int nHeight = -1;
@@ -320,13 +910,15 @@ private:
             LogPrint("ws", "%s():%d - block index not found for hash[%s]\n", __func__, __LINE__, strHash);
             return INVALID_PARAMETER;
         }
-        std::string block;
+        CBlock block;
         int ret = getblock(pblockindex, block);
         if (ret != OK)
         {
             return ret;
         }
-        sendBlock(pblockindex->nHeight, strHash, block, WsEvent::MSG_RESPONSE, clientRequestId);
+        bool fBinaryFrame = fBinary;
+        writeFrame(makeBlockFrame(block, WsEvent::MSG_RESPONSE, WsEvent::GET_SINGLE_BLOCK, clientRequestId,
+                pblockindex->nHeight, *getScFilter(), fBinaryFrame), fBinaryFrame);
         return OK;
     }
 
@@ -485,6 +1077,62 @@ private:
         return OK;
     }
 
+    /**
+     * SUBMIT_CERTIFICATE, for the validators racing the end of a withdrawal epoch: the certificate is already
+     * signed and comes serialized in a binary frame (see parseClientBinaryMessage). It is accepted to the mempool
+     * on the pool, with its proof verified at high priority, while the connection goes on reading; the answer,
+     * the same as for SEND_CERTIFICATE, or the error, is sent once the mempool accepted or refused it.
+     */
+    void submitCertificate(const std::shared_ptr<const CScCertificate>& cert, const std::string& clientRequestId)
+    {
+        net::post(*wsIoContext,
+            boost::beast::bind_front_handler(&WsHandler::acceptCertificate, shared_from_this(), cert, clientRequestId));
+    }
+
+    void acceptCertificate(const std::shared_ptr<const CScCertificate>& cert, const std::string& clientRequestId)
+    {
+        const uint256& hash = cert->GetHash();
+        std::string strError;
+        int64_t nStart = GetTimeMicros();
+        {
+            LOCK(cs_main);
+            if (pcoinsTip->AccessCoins(hash))
+            {
+                strError = "certificate already in block chain";
+            }
+            else if (!mempool.existsCert(hash))
+            {
+                CValidationState state;
+                MempoolProofVerificationFlag flag = MempoolProofVerificationFlag::SYNC_HIGH_PRIORITY;
+                if (BOOST_UNLIKELY(Params().NetworkIDString() == "regtest" && GetBoolArg("-skipscproof", false)))
+                    flag = MempoolProofVerificationFlag::DISABLED;
+
+                MempoolReturnValue res = AcceptCertificateToMemoryPool(mempool, state, *cert, LimitFreeFlag::OFF,
+                        RejectAbsurdFeeFlag::ON, flag);
+                if (res == MempoolReturnValue::MISSING_INPUT)
+                    strError = "Missing inputs";
+                else if (res == MempoolReturnValue::INVALID && state.IsInvalid())
+                    strError = strprintf("%i: %s", CValidationState::CodeToChar(state.GetRejectCode()), state.GetRejectReason());
+                else if (res == MempoolReturnValue::INVALID)
+                    strError = "certificate not accepted to mempool";
+            }
+            if (strError.empty())
+                cert->Relay();
+        }
+        int64_t nElapsed = GetTimeMicros() - nStart;
+        recordWsRequestHandler(WsEvent::SUBMIT_CERTIFICATE, nElapsed);
+        LogPrint("ws", "%s():%d - connection[%u] cert[%s] processed in %.2fms: %s\n", __func__, __LINE__,
+            t_id, hash.ToString(), nElapsed * 0.001, strError.empty() ? "accepted" : strError);
+
+        if (!strError.empty())
+        {
+            sendError(INVALID_PARAMETER, "On requestType[" + std::to_string(WsEvent::SUBMIT_CERTIFICATE) +
+                "]: Invalid parameter - Details: " + strError, clientRequestId);
+            return;
+        }
+        sendCertificateHash(hash.GetHex(), WsEvent::MSG_RESPONSE, clientRequestId);
+    }
+
     int sendHeadersFromHashes(const UniValue& hashes, const std::string& clientRequestId)
     {
         if (hashes.size() > MAX_HEADERS_REQUEST) {
@@ -492,8 +1140,8 @@ private:
             return INVALID_PARAMETER;
         }
             
-        UniValue headers(UniValue::VARR);
-            
+        std::vector<CBlockIndex*> vBlockIndex;
+
         for (const UniValue& o : hashes.getValues()) {
             if (o.isObject()) {
                 LogPrint("ws", "%s():%d - invalid obj\n", __func__, __LINE__);
@@ -518,6 +1166,31 @@ private:
                 return INVALID_PARAMETER;
             }
 
+            vBlockIndex.push_back(pblockindex);
+        }
+
+        if (fBinary)
+        {
+            // the height and the hash of the first header, then the headers as a vector
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            WriteCompactSize(ss, vBlockIndex.size());
+            for (const CBlockIndex* pblockindex : vBlockIndex)
+            {
+                int ret = getheader(pblockindex, ss);
+                if (ret != OK)
+                {
+                    return ret;
+                }
+            }
+            writeFrame(makeBinaryFrame(WsEvent::MSG_RESPONSE, WsEvent::GET_MULTIPLE_BLOCK_HEADERS, clientRequestId,
+                    vBlockIndex.empty() ? -1 : vBlockIndex[0]->nHeight,
+                    vBlockIndex.empty() ? uint256() : vBlockIndex[0]->GetBlockHash(), ss), true);
+            return OK;
+        }
+
+        UniValue headers(UniValue::VARR);
+        for (const CBlockIndex* pblockindex : vBlockIndex)
+        {
             std::string header;
             int ret = getheader(pblockindex, header);
             if (ret != OK)
@@ -545,29 +1218,23 @@ private:
 
         {
             LOCK(cs_main);
-            if (!view.HaveSidechain(scId)) {
+            CSidechain sidechainInfo;
+            if (!view.GetSidechain(scId, sidechainInfo)) {
                 LogPrint("ws", "%s():%d - sidechain id not found[%s]\n", __func__, __LINE__, scIdString);
                 return INVALID_PARAMETER;
             }
-        
-            if (mempool.hasSidechainCertificate(scId))
+
+            // maintained by the mempool as its certificates come and go
+            std::shared_ptr<const CMempoolTopQualityCert> topQualCert = mempool.getTopQualityCert(scId);
+            if (topQualCert)
             {
-                const uint256& topQualCertHash = mempool.mapSidechains.at(scId).GetTopQualityCert()->second;
-                const CScCertificate& topQualCert = mempool.mapCertificate.at(topQualCertHash).GetCertificate();
-                const CAmount certFee = mempool.mapCertificate.at(topQualCertHash).GetFee();
-                CDataStream ssCert(SER_NETWORK, PROTOCOL_VERSION);
-                ssCert << topQualCert;
-                std::string certHex = HexStr(ssCert.begin(), ssCert.end());
-     
-                mempoolTopQualityCert.push_back(Pair("quality", topQualCert.quality));
-                mempoolTopQualityCert.push_back(Pair("epoch", topQualCert.epochNumber));
-                mempoolTopQualityCert.push_back(Pair("certHash", topQualCertHash.GetHex()));
-                mempoolTopQualityCert.push_back(Pair("fee", FormatMoney(certFee)));
+                mempoolTopQualityCert.push_back(Pair("quality", topQualCert->quality));
+                mempoolTopQualityCert.push_back(Pair("epoch", topQualCert->epochNumber));
+                mempoolTopQualityCert.push_back(Pair("certHash", topQualCert->hash.GetHex()));
+                mempoolTopQualityCert.push_back(Pair("fee", FormatMoney(topQualCert->fee)));
             }
 
-            CSidechain sidechainInfo;
-
-            if (view.GetSidechain(scId, sidechainInfo) && !sidechainInfo.lastTopQualityCertHash.IsNull()) {
+            if (!sidechainInfo.lastTopQualityCertHash.IsNull()) {
                 const int topQualityCertQuality = sidechainInfo.lastTopQualityCertQuality;
                 CScCertificate topQualCert;
                 uint256 blockHash;
@@ -583,6 +1250,53 @@ private:
         return OK;
     }
 
+    int sendScActivityFromIndex(const std::string& strScId, const std::string& strFromHeight, const std::string& strToHeight,
+                                const std::string& clientRequestId, std::string& outMsg)
+    {
+        if (!fScIndex || pScActivityIndexer == NULL || !pScActivityIndexer->IsCaughtUp()) {
+            outMsg = "sidechain activity index not enabled or still being built";
+            return INVALID_COMMAND;
+        }
+        if (strScId.find_first_not_of("0123456789abcdefABCDEF", 0) != std::string::npos) {
+            LogPrint("ws", "%s():%d - invalid scid[%s]\n", __func__, __LINE__, strScId);
+            return INVALID_PARAMETER;
+        }
+        uint256 scId;
+        scId.SetHex(strScId);
+
+        int fromHeight = -1, toHeight = -1;
+        try {
+            fromHeight = std::stoi(strFromHeight);
+            toHeight = std::stoi(strToHeight);
+        } catch (const std::exception &e) {
+            LogPrint("ws", "%s():%d - %s\n", __func__, __LINE__, e.what());
+            return INVALID_PARAMETER;
+        }
+        if (fromHeight < 0 || toHeight < fromHeight) {
+            LogPrint("ws", "%s():%d - invalid range %d to %d\n", __func__, __LINE__, fromHeight, toHeight);
+            return INVALID_PARAMETER;
+        }
+        {
+            LOCK(cs_main);
+            toHeight = std::min(toHeight, chainActive.Height());
+        }
+
+        pScActivityIndexer->SyncWithTip();
+        CScActivityIndexer::Entries entries;
+        bool fTruncated = false;
+        if (!CScActivityIndexer::Lookup(scId, fromHeight, toHeight, entries, fTruncated)) {
+            outMsg = fTruncated ? strprintf("more than %u entries in the range, split it", MAX_SC_ACTIVITY_ENTRIES) :
+                                  "can not read the sidechain activity index";
+            return INVALID_PARAMETER;
+        }
+
+        UniValue activity(UniValue::VARR);
+        for (const std::pair<CScActivityKey, CScActivityValue>& entry : entries)
+            activity.push_back(ScActivityEntryToJSON(entry.first, entry.second));
+        sendScActivity(scId, fromHeight, toHeight, activity, WsEvent::MSG_RESPONSE, clientRequestId);
+        return OK;
+    }
+
     int sendSidechainVersionsFromId(const UniValue& sidechainIds, const std::string& clientRequestId)
     {
         if (sidechainIds.size() > MAX_SIDECHAINS_REQUEST)
@@ -622,7 +1336,7 @@ private:
                 {
                     UniValue sidechainEntry(UniValue::VOBJ);
                     sidechainEntry.push_back(Pair("scId", strScId));
-                    sidechainEntry.push_back(Pair("version", sidechainInfo.fixedParams.version));
+                    sidechainEntry.push_back(Pair("version", sidechainInfo.GetFixedParams().version));
 
                     versions.push_back(sidechainEntry);
                 }
@@ -644,82 +1358,61 @@ private:
         wsq->push(wse);
     }*/
 
-    void writeLoop()
+    /**
+     * The binary frames a client can send, with no JSON to parse: requestType (1 byte), requestId (compact size
+     * length and chars), then the payload. Only SUBMIT_CERTIFICATE is sent this way, the payload being the
+     * serialized certificate.
+     */
+    int parseClientBinaryMessage(const std::string& msg, WsEvent::WsRequestType& reqType, std::string& clientRequestId, std::string& outMsg)
     {
-        localWs->text(localWs->got_text());
-
-        while (!exit_rwhandler_thread_flag)
+        CDataStream ss(msg.data(), msg.data() + msg.size(), SER_NETWORK, PROTOCOL_VERSION);
+        uint8_t requestType = WsEvent::REQ_UNDEFINED;
+        std::shared_ptr<CScCertificate> cert = std::make_shared<CScCertificate>();
+        try
         {
-            std::unique_lock<std::mutex> lk(writeMutex);
-            // Wait upto 1 sec and check the queue in any case
-            writeCV.wait_for(lk, std::chrono::seconds(1));
-
-            WsEvent* wse;
-            while (wsq.pop(wse) && wse != NULL)
+            ss >> requestType >> clientRequestId;
+            if (requestType != WsEvent::SUBMIT_CERTIFICATE)
             {
-                std::string msg = wse->getPayload()->write();
-                LogPrint("ws", "%s():%d - deleting %p\n", __func__, __LINE__, wse);
-                delete wse;
-                if (localWs->is_open())
-                {
-                    boost::beast::error_code ec;
-                    localWs->write(boost::asio::buffer(msg), ec);
-
-                    if (ec == websocket::error::closed)
-                    {
-                        LogPrint("ws", "%s():%d - err[%d]: %s\n", __func__, __LINE__,ec.value(), ec.message());
-                        break;
-                    }
-                    else
-                    if (ec.value() != boost::system::errc::success)
-                    {
-                        LogPrint("ws", "%s():%d - err[%d]: %s\n", __func__, __LINE__, ec.value(), ec.message());
-                        break;
-                    }
-                    LogPrint("ws", "%s():%d - msg[%s] written on client socket\n", __func__, __LINE__, msg);
-                }
-                else
-                {
-                    LogPrint("ws", "%s():%d - ws is closed\n", __func__, __LINE__);
-                    break;
-                }
+                LogPrint("ws", "%s():%d - requestType[%d] not allowed in a binary frame\n", __func__, __LINE__, requestType);
+                return INVALID_COMMAND;
+            }
+            reqType = WsEvent::SUBMIT_CERTIFICATE;
+            if (clientRequestId.empty()) {
+                LogPrint("ws", "%s():%d - clientRequestId empty\n", __func__, __LINE__);
+                return MISSING_REQID;
             }
+            ss >> *cert;
         }
-        LogPrint("ws", "%s():%d - write thread exit (this=%p)\n", __func__, __LINE__, this);
+        catch (const std::exception& e)
+        {
+            LogPrint("ws", "%s():%d - cannot read binary frame of size %d: %s\n", __func__, __LINE__, msg.size(), e.what());
+            outMsg = "cannot read the certificate";
+            return INVALID_PARAMETER;
+        }
+        if (!ss.empty())
+        {
+            outMsg = "data after the certificate";
+            return INVALID_PARAMETER;
+        }
+        nParseEnd = GetTimeMicros();
+
+        submitCertificate(cert, clientRequestId);
+        return OK;
     }
 
-    int parseClientMessage(WsEvent::WsRequestType& reqType, std::string& clientRequestId, std::string& outMsg) 
+    int parseClientMessage(const std::string& msg, WsEvent::WsRequestType& reqType, std::string& clientRequestId, std::string& outMsg) 
     {
         try
         {
             std::string msgType;
             std::string requestType;
-            boost::beast::multi_buffer buffer;
-            boost::beast::error_code ec;
 
-            localWs->read(buffer, ec);
-            if (ec == websocket::error::closed || ec == websocket::error::no_connection)
-            {
-                // graceful disconnection
-                LogPrint("ws", "%s():%d - code[%d]: %s\n", __func__, __LINE__,ec.value(), ec.message());
-                return READ_ERROR;
-            }
-            else
-            if (ec.value() != boost::system::errc::success)
-            {
-                // any other error but success
-                LogPrint("ws", "%s():%d - connection is open[%s], err[%d]: %s\n", __func__, __LINE__,
-                    (localWs->is_open()?"Y":"N") , ec.value(), ec.message());
-                return READ_ERROR;
-            }
-            LogPrint("ws", "%s():%d - client message received of size=%d\n", __func__, __LINE__, buffer.size());
-
-            std::string msg = boost::beast::buffers_to_string(buffer.data());
             UniValue request;
             if (!request.read(msg)) {
                 LogPrint("ws", "%s():%d - error parsing message from websocket: [%s]\n", __func__, __LINE__, msg);
                 return INVALID_JSON_FORMAT;
             }
+            nParseEnd = GetTimeMicros();
 
             msgType         = findFieldValue("msgType", request);
             clientRequestId = findFieldValue("requestId", request);
@@ -1070,6 +1763,127 @@ private:
                 return sendSidechainVersionsFromId(scIds, clientRequestId);
             }
 
+            if (requestType == std::to_string(WsEvent::SET_BINARY_MODE))
+            {
+                reqType = WsEvent::SET_BINARY_MODE;
+                if (clientRequestId.empty()) {
+                    LogPrint("ws", "%s():%d - clientRequestId empty: msg[%s]\n", __func__, __LINE__, msg);
+                    return MISSING_REQID;
+                }
+                const UniValue& reqPayload = find_value(request, "requestPayload");
+                if (reqPayload.isNull())
+                {
+                    LogPrint("ws", "%s():%d - requestPayload null: msg[%s]\n", __func__, __LINE__, msg);
+                    return INVALID_JSON_FORMAT;
+                }
+
+                const UniValue& binary = find_value(reqPayload, "binary");
+                if (!binary.isBool()) {
+                    LogPrint("ws", "%s():%d - binary not a boolean: msg[%s]\n", __func__, __LINE__, msg);
+                    return MISSING_PARAMETER;
+                }
+
+                fBinary = binary.get_bool();
+                sendBinaryMode(fBinary, WsEvent::MSG_RESPONSE, clientRequestId);
+                return OK;
+            }
+
+            if (requestType == std::to_string(WsEvent::SET_SC_FILTER))
+            {
+                reqType = WsEvent::SET_SC_FILTER;
+                if (clientRequestId.empty()) {
+                    LogPrint("ws", "%s():%d - clientRequestId empty: msg[%s]\n", __func__, __LINE__, msg);
+                    return MISSING_REQID;
+                }
+                const UniValue& reqPayload = find_value(request, "requestPayload");
+                if (reqPayload.isNull())
+                {
+                    LogPrint("ws", "%s():%d - requestPayload null: msg[%s]\n", __func__, __LINE__, msg);
+                    return INVALID_JSON_FORMAT;
+                }
+
+                const UniValue& scIdArray = find_value(reqPayload, "scIds");
+                if (!scIdArray.isArray()) {
+                    LogPrint("ws", "%s():%d - scIds not an array: msg[%s]\n", __func__, __LINE__, msg);
+                    return MISSING_PARAMETER;
+                }
+
+                return setScFilter(scIdArray, clientRequestId);
+            }
+
+            if (requestType == std::to_string(WsEvent::GET_BLOCK_RANGE))
+            {
+                reqType = WsEvent::GET_BLOCK_RANGE;
+                if (clientRequestId.empty()) {
+                    LogPrint("ws", "%s():%d - clientRequestId empty: msg[%s]\n", __func__, __LINE__, msg);
+                    return MISSING_REQID;
+                }
+                const UniValue& reqPayload = find_value(request, "requestPayload");
+                if (reqPayload.isNull())
+                {
+                    LogPrint("ws", "%s():%d - requestPayload null: msg[%s]\n", __func__, __LINE__, msg);
+                    return INVALID_JSON_FORMAT;
+                }
+
+                std::string strHeight = findFieldValue("height", reqPayload);
+                std::string strLimit = findFieldValue("limit", reqPayload);
+                if (strHeight.empty() || strLimit.empty()) {
+                    LogPrint("ws", "%s():%d - height/limit param null: msg[%s]\n", __func__, __LINE__, msg);
+                    return MISSING_PARAMETER;
+                }
+
+                return sendBlockRange(strHeight, strLimit, findFieldValue("credit", reqPayload), clientRequestId, outMsg);
+            }
+
+            if (requestType == std::to_string(WsEvent::BLOCK_RANGE_CREDIT))
+            {
+                reqType = WsEvent::BLOCK_RANGE_CREDIT;
+                if (clientRequestId.empty()) {
+                    LogPrint("ws", "%s():%d - clientRequestId empty: msg[%s]\n", __func__, __LINE__, msg);
+                    return MISSING_REQID;
+                }
+                const UniValue& reqPayload = find_value(request, "requestPayload");
+                if (reqPayload.isNull())
+                {
+                    LogPrint("ws", "%s():%d - requestPayload null: msg[%s]\n", __func__, __LINE__, msg);
+                    return INVALID_JSON_FORMAT;
+                }
+
+                std::string strCredit = findFieldValue("credit", reqPayload);
+                if (strCredit.empty()) {
+                    LogPrint("ws", "%s():%d - credit param null: msg[%s]\n", __func__, __LINE__, msg);
+                    return MISSING_PARAMETER;
+                }
+
+                // granting credit is not answered, the blocks are
+                return addBlockRangeCredit(strCredit, clientRequestId);
+            }
+
+            if (requestType == std::to_string(WsEvent::GET_SC_ACTIVITY))
+            {
+                reqType = WsEvent::GET_SC_ACTIVITY;
+                if (clientRequestId.empty()) {
+                    LogPrint("ws", "%s():%d - clientRequestId empty: msg[%s]\n", __func__, __LINE__, msg);
+                    return MISSING_REQID;
+                }
+                const UniValue& reqPayload = find_value(request, "requestPayload");
+                if (reqPayload.isNull())
+                {
+                    LogPrint("ws", "%s():%d - requestPayload null: msg[%s]\n", __func__, __LINE__, msg);
+                    return INVALID_JSON_FORMAT;
+                }
+
+                std::string strScId = findFieldValue("scid", reqPayload);
+                std::string strFromHeight = findFieldValue("fromHeight", reqPayload);
+                std::string strToHeight = findFieldValue("toHeight", reqPayload);
+                if (strScId.empty() || strFromHeight.empty() || strToHeight.empty()) {
+                    LogPrint("ws", "%s():%d - scid/fromHeight/toHeight param null: msg[%s]\n", __func__, __LINE__, msg);
+                    return MISSING_PARAMETER;
+                }
+
+                return sendScActivityFromIndex(strScId, strFromHeight, strToHeight, clientRequestId, outMsg);
+            }
+
             // if we are here that means it is no valid request type, and reqType is an enum defaulting to 255
             *((int*)(&reqType)) = std::stoi(requestType);
 
@@ -1093,58 +1907,147 @@ private:
         }
     }
 
-    void readLoop()
+    void doRead()
+    {
+        localWs->async_read(readBuffer,
+            boost::beast::bind_front_handler(&WsHandler::onRead, shared_from_this()));
+    }
+
+    void onRead(boost::beast::error_code ec, std::size_t bytes)
     {
-        while (!exit_rwhandler_thread_flag)
+        if (ec == websocket::error::closed || ec == websocket::error::no_connection)
+        {
+            // graceful disconnection
+            LogPrint("ws", "%s():%d - code[%d]: %s\n", __func__, __LINE__,ec.value(), ec.message());
+            close();
+            return;
+        }
+        if (ec)
+        {
+            LogPrint("ws", "%s():%d - connection is open[%s], err[%d]: %s\n", __func__, __LINE__,
+                (localWs->is_open()?"Y":"N") , ec.value(), ec.message());
+            close();
+            return;
+        }
+        LogPrint("ws", "%s():%d - client message received of size=%d\n", __func__, __LINE__, bytes);
+
+        std::string msg = boost::beast::buffers_to_string(readBuffer.data());
+        readBuffer.consume(readBuffer.size());
+        nRecvFrames++;
+        nRecvBytes += bytes;
+
+        // the parsers mark the end of the parsing, what follows is the handler of the request
+        WsEvent::WsRequestType reqType = WsEvent::REQ_UNDEFINED;
+        std::string clientRequestId = "";
+        std::string outMsg;
+        int64_t nStart = GetTimeMicros();
+        nParseEnd = 0;
+        int res = localWs->got_binary() ? parseClientBinaryMessage(msg, reqType, clientRequestId, outMsg) :
+                                          parseClientMessage(msg, reqType, clientRequestId, outMsg);
+        int64_t nEnd = GetTimeMicros();
+        if (nParseEnd == 0)
+            nParseEnd = nEnd;
+        // the certificates submitted are accepted on the pool, and timed there
+        recordWsRequest(reqType, bytes, res != OK, nParseEnd - nStart,
+            (reqType == WsEvent::SUBMIT_CERTIFICATE && res == OK) ? -1 : nEnd - nParseEnd);
+        if (res == READ_ERROR)
+        {
+            LogPrint("ws", "%s():%d - websocket closed exit reading loop\n", __func__, __LINE__);
+            close();
+            return;
+        }
+
+        if (res != OK)
         {
-            WsEvent::WsRequestType reqType = WsEvent::REQ_UNDEFINED;
-            std::string clientRequestId = "";
-            std::string outMsg;
-            int res = parseClientMessage(reqType, clientRequestId, outMsg);
-            if (res == READ_ERROR)
+            std::string msgError = "On requestType[" + std::to_string(reqType) + "]: ";
+            switch (res)
             {
-                LogPrint("ws", "%s():%d - websocket closed exit reading loop\n", __func__, __LINE__);
+            case INVALID_PARAMETER:
+                msgError += "Invalid parameter";
+                break;
+            case MISSING_PARAMETER:
+                msgError += "Missing parameter";
+                break;
+            case MISSING_REQID:
+                msgError += "Missing requestId";
                 break;
+            case INVALID_COMMAND:
+                msgError += "Invalid command";
+                break;
+            case INVALID_JSON_FORMAT:
+                msgError += "Invalid JSON format";
+                break;
+            default:
+                msgError += "Generic error";
             }
+            if (!outMsg.empty())
+                msgError += " - Details: " + outMsg;
 
-            if (res != OK)
+            // Send a message error to the client:  type = -1
+            sendError(res, msgError, clientRequestId);
+        }
+
+        if (!fClosed)
+            doRead();
+    }
+
+    void onStart()
+    {
+        localWs->set_option(
+            websocket::stream_base::decorator(
+                [](websocket::response_type& res)
+                    {
+                        res.set(http::field::server,
+                        std::string(BOOST_BEAST_VERSION_STRING) + " Horizen-sidechain-connector");
+                    }));
+
+        localWs->control_callback(
+            [](websocket::frame_type kind, boost::string_view payload)
             {
-                std::string msgError = "On requestType[" + std::to_string(reqType) + "]: ";
-                switch (res)
+                if (kind == websocket::frame_type::ping)
                 {
-                case INVALID_PARAMETER:
-                    msgError += "Invalid parameter";
-                    break;
-                case MISSING_PARAMETER:
-                    msgError += "Missing parameter";
-                    break;
-                case MISSING_REQID:
-                    msgError += "Missing requestId";
-                    break;
-                case INVALID_COMMAND:
-                    msgError += "Invalid command";
-                    break;
-                case INVALID_JSON_FORMAT:
-                    msgError += "Invalid JSON format";
-                    break;
-                default:
-                    msgError += "Generic error";
+                    std::string payl(payload);
+                    LogPrint("ws", "%s():%d - ping received... payload[%s]\n", __func__, __LINE__, payl);
                 }
-                if (!outMsg.empty())
-                    msgError += " - Details: " + outMsg;
+                // Do something with the payload
+                boost::ignore_unused(kind, payload);
+            });
 
-                // Send a message error to the client:  type = -1
-                WsEvent* wse = new WsEvent(WsEvent::MSG_ERROR);
-                LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
-                UniValue* rv = wse->getPayload();
-                if (!clientRequestId.empty())
-                    rv->pushKV("requestId", clientRequestId);
-                rv->pushKV("errorCode", res);
-                rv->pushKV("message", msgError);
-                write(wse);
-            }
+        localWs->async_accept(boost::beast::bind_front_handler(&WsHandler::onAccept, shared_from_this()));
+    }
+
+    void onAccept(boost::beast::error_code ec)
+    {
+        if (ec)
+        {
+            LogPrint("ws", "%s():%d - handshake failed, err[%d]: %s\n", __func__, __LINE__, ec.value(), ec.message());
+            close();
+            return;
         }
-        LogPrint("ws", "%s():%d - exit reading loop\n", __func__, __LINE__);
+        if (fClosed)
+            return;
+
+        fAccepted = true;
+        // the events queued during the handshake
+        if (!writeQueue.empty())
+            doWrite();
+        doRead();
+    }
+
+    //! On the strand: close the socket, the pending operations complete with an error
+    void close()
+    {
+        if (fClosed)
+            return;
+        fClosed = true;
+
+        boost::beast::error_code ec;
+        localWs->next_layer().close(ec);
+
+        std::unique_lock<std::mutex> lck(wsmtx);
+        tot_connections--;
+        LogPrint("ws", "%s():%d - connection[%u] closed: tot[%d]\n", __func__, __LINE__, t_id, tot_connections);
+        listWsHandler.remove(shared_from_this());
     }
 
 public:
@@ -1161,7 +2064,8 @@ public:
 
     unsigned int t_id = 0;
 
-    WsHandler() {}
+    WsHandler(tcp::socket&& socket, unsigned int t_id, const std::string& strPeer) :
+        localWs(new websocket::stream<tcp::socket> { std::move(socket) }), strPeer(strPeer), t_id(t_id) {}
     ~WsHandler() {
         LogPrint("ws", "%s():%d - called this=%p\n", __func__, __LINE__, this);
     }
@@ -1177,231 +2081,348 @@ public:
         id = addr + ":" + port;
     }
 
-    void do_session(tcp::socket& socket, unsigned int t_id)
+    //! Start the websocket handshake, on the strand of the socket
+    void start()
     {
-        // will be referenced when shutting down in order not destroying ptr while executing this thread
-        boost::shared_ptr<WsHandler> thisRef;
+        net::dispatch(localWs->get_executor(),
+            boost::beast::bind_front_handler(&WsHandler::onStart, shared_from_this()));
+    }
 
-        this->t_id = t_id;
+    static std::shared_ptr<const std::string> makeBlockEvent(int height, const std::string& strHash, const std::string& blockHex,
+            WsEvent::WsEventType eventType)
+    {
+        // A message to the clients:  type = eventType
+        WsEvent* wse = new WsEvent(WsEvent::MSG_EVENT);
+        LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
+        UniValue rspPayload(UniValue::VOBJ);
+        rspPayload.pushKV("height", height);
+        rspPayload.pushKV("hash", strHash);
+        rspPayload.pushKV("block", blockHex);
 
-        try
-        {
-            localWs.reset(new websocket::stream<tcp::socket> { std::move(socket) });
-            LogPrint("ws", "%s():%d - allocated localWs %p\n", __func__, __LINE__, localWs.get());
-
-            localWs->set_option(
-                websocket::stream_base::decorator(
-                    [](websocket::response_type& res)
-                        {
-                            res.set(http::field::server,
-                            std::string(BOOST_BEAST_VERSION_STRING) + " Horizen-sidechain-connector");
-                        }));
-
-            localWs->control_callback(
-                [](websocket::frame_type kind, boost::string_view payload)
-                {
-                    if (kind == websocket::frame_type::ping)
-                    {
-                        std::string payl(payload);
-                        LogPrint("ws", "%s():%d - ping received... payload[%s]\n", __func__, __LINE__, payl);
-                    }
-                    // Do something with the payload
-                    boost::ignore_unused(kind, payload);
-                });
+        UniValue* rv = wse->getPayload();
+        rv->pushKV("eventType", eventType);
+        rv->pushKV("eventPayload", rspPayload);
+        return makeFrame(wse);
+    }
 
-            localWs->accept();
+    static std::shared_ptr<const std::string> makeTemplateEvent(int height, const std::string& strPrevHash, const CAmount& nFeeGain)
+    {
+        // A message to the clients:  type = NEW_BLOCK_TEMPLATE
+        WsEvent* wse = new WsEvent(WsEvent::MSG_EVENT);
+        LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
+        UniValue rspPayload(UniValue::VOBJ);
+        rspPayload.pushKV("height", height);
+        rspPayload.pushKV("prevHash", strPrevHash);
+        rspPayload.pushKV("feeGain", ValueFromAmount(nFeeGain));
 
-            std::thread write_t(&WsHandler::writeLoop, this);
-            readLoop();
-            exit_rwhandler_thread_flag = true;
-            write_t.join();
-            socket.close();
-        }
-        catch (boost::system::system_error const& se)
+        UniValue* rv = wse->getPayload();
+        rv->pushKV("eventType", WsEvent::NEW_BLOCK_TEMPLATE);
+        rv->pushKV("eventPayload", rspPayload);
+        return makeFrame(wse);
+    }
+
+    /**
+     * The binary frames, negotiated with SET_BINARY_MODE, carry the blocks of the single block responses and
+     * of the tip events, and the headers of the multiple headers responses, as raw serialized bytes instead of
+     * hex in JSON. The frame starts with a compact header:
+     *   msgType (1 byte), then the eventType of an event or the requestType of a response (1 byte),
+     *   requestId (compact size length and chars, empty for an event), height (int32, little endian),
+     *   hash (32 bytes, in the serialization order)
+     * followed by the payload: the serialized block, or the compact size count and the serialized headers.
+     * All the other messages, and the errors, are JSON text frames in any case.
+     */
+    static std::shared_ptr<const std::string> makeBinaryFrame(WsEvent::WsMsgType msgType, int type,
+            const std::string& clientRequestId, int height, const uint256& hash, const CDataStream& payload)
+    {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << (uint8_t)msgType << (uint8_t)type << clientRequestId << height << hash;
+        if (!payload.empty())
+            ss.write(&payload[0], payload.size());
+        return std::make_shared<const std::string>(ss.begin(), ss.end());
+    }
+
+    /**
+     * The frame of a block for a connection, as a binary frame or as JSON: in full, or filtered for the
+     * sidechains of filter when not empty (see WsFilteredBlock)
+     */
+    static std::shared_ptr<const std::string> makeBlockFrame(const CBlock& block, WsEvent::WsMsgType msgType, int type,
+            const std::string& clientRequestId, int height, const ScFilter& filter, bool fBinaryFrame)
+    {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        if (!filter.empty())
         {
-            if (se.code() != websocket::error::closed)
+            WsFilteredBlock filtered(block, filter);
+            if (fBinaryFrame)
             {
-                LogPrint("ws", "%s():%d - boost error %s\n", __func__, __LINE__, se.code().message());
+                ss << filtered;
+                return makeBinaryFrame(msgType, type, clientRequestId, height, block.GetHash(), ss);
             }
-            LogPrint("ws", "%s():%d - websocket close\n", __func__, __LINE__);
-        }
-        catch (std::exception const& e)
-        {
-            LogPrint("ws", "%s():%d - error: %s\n", __func__, __LINE__, std::string(e.what()));
-        }
-        LogPrint("ws", "%s():%d - exit thread final\n", __func__, __LINE__);
-        {
-            std::unique_lock<std::mutex> lck(wsmtx);
-            this->shutdown();
-            tot_connections--;
-            LogPrint("ws", "%s():%d - connection[%u] closed: tot[%d]\n", __func__, __LINE__, t_id, tot_connections);
 
-            auto it = listWsHandler.begin();
-            while (it != listWsHandler.end())
+            WsEvent* wse = new WsEvent(msgType);
+            LogPrint("ws", "%s():%d - allocated %p\n", __func__, __LINE__, wse);
+            UniValue* rv = wse->getPayload();
+            if (msgType == WsEvent::MSG_EVENT)
             {
-                if (this == (*it).get() )
-                {
-                    thisRef = (*it);
-                    LogPrint("ws", "%s():%d - removing handler obj from list\n", __func__, __LINE__);
-                    listWsHandler.erase(it++);
-                }
-                else
-                {
-                    ++it;
-                }
+                rv->pushKV("eventType", type);
+                rv->pushKV("eventPayload", filtered.ToJSON(height));
+            }
+            else
+            {
+                if (!clientRequestId.empty())
+                    rv->pushKV("requestId", clientRequestId);
+                rv->pushKV("responsePayload", filtered.ToJSON(height));
             }
+            return makeFrame(wse);
         }
+
+        ss << block;
+        if (fBinaryFrame)
+            return makeBinaryFrame(msgType, type, clientRequestId, height, block.GetHash(), ss);
+        if (msgType == WsEvent::MSG_EVENT)
+            return makeBlockEvent(height, block.GetHash().GetHex(), HexStr(ss.begin(), ss.end()), (WsEvent::WsEventType)type);
+        return makeBlockResponse(height, block.GetHash().GetHex(), HexStr(ss.begin(), ss.end()), msgType, clientRequestId);
     }
 
-    void send_tip_update(int height, const std::string& strHash, const std::string& blockHex)
+    bool isBinary() const
     {
-        sendBlockEvent(height, strHash, blockHex, WsEvent::UPDATE_TIP);
+        return fBinary;
+    }
+
+    std::shared_ptr<const ScFilter> getScFilter() const
+    {
+        return std::atomic_load(&scFilter);
+    }
+
+    void send_tip_update(const std::shared_ptr<const std::string>& tipEvent, bool fBinaryFrame)
+    {
+        writeFrame(tipEvent, fBinaryFrame, FRAME_TIP_EVENT);
+    }
+
+    void send_template_update(const std::shared_ptr<const std::string>& templateEvent)
+    {
+        writeFrame(templateEvent, false, FRAME_TEMPLATE_EVENT);
+    }
+
+    void GetStats(WsConnectionStats& stats) const
+    {
+        stats.nId = t_id;
+        stats.addr = strPeer;
+        stats.fBinary = fBinary;
+        stats.nScFilter = getScFilter()->size();
+        stats.nRecvFrames = nRecvFrames;
+        stats.nRecvBytes = nRecvBytes;
+        stats.nQueuedFrames = nQueuedFrames;
+        stats.nQueuedBytes = nQueuedBytes;
+        stats.nMaxQueuedBytes = nMaxQueuedBytes;
+        stats.nSentFrames = nSentFrames;
+        stats.nSentBytes = nSentBytes;
+        stats.nCoalesced = nCoalesced;
+        stats.nDropped = nDropped;
     }
 
     void shutdown()
     {
-        try
-        {
-            exit_rwhandler_thread_flag = true;
-            if (this->localWs)
-            {
-                LogPrint("ws", "%s():%d - closing socket\n", __func__, __LINE__);
-                this->localWs->next_layer().close();
-            }
-        }
-        catch (std::exception const& e)
-        {
-            LogPrint("ws", "%s():%d - error: %s\n", __func__, __LINE__, e.what());
-        }
+        net::post(localWs->get_executor(),
+            boost::beast::bind_front_handler(&WsHandler::close, shared_from_this()));
     }
 };
 
 
-static int getblock(const CBlockIndex *pindex, std::string& strHex)
+static int getblock(const CBlockIndex *pindex, CBlock& block)
 {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if (!ReadBlockFromDisk(block, pindex)) {
-            LogPrint("ws", "%s():%d - error: could not read block from disk\n", __func__, __LINE__);
-            return WsHandler::READ_ERROR;
-        }
-        ss << block;
-        strHex = HexStr(ss.begin(), ss.end());
+    LOCK(cs_main);
+    if (!ReadBlockFromDisk(block, pindex)) {
+        LogPrint("ws", "%s():%d - error: could not read block from disk\n", __func__, __LINE__);
+        return WsHandler::READ_ERROR;
     }
     return WsHandler::OK;
 }
 
 
+static int getheader(const CBlockIndex *pindex, CDataStream& ss)
+{
+    LOCK(cs_main);
+    std::shared_ptr<const std::string> raw = headerCache.GetRaw(pindex);
+    ss.write(raw->data(), raw->size());
+    return WsHandler::OK;
+}
+
 static int getheader(const CBlockIndex *pindex, std::string& strHex)
 {
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        ss << pindex->GetBlockHeader();
-        strHex = HexStr(ss.begin(), ss.end());
-    }
+    LOCK(cs_main);
+    strHex = *headerCache.GetHex(pindex);
     return WsHandler::OK;
 }
 
 
+//! The connected handlers, copied under wsmtx for the events to be sent without holding it
+static std::vector< boost::shared_ptr<WsHandler> > getWsHandlers()
+{
+    std::unique_lock<std::mutex> lck(wsmtx);
+    return std::vector< boost::shared_ptr<WsHandler> >(listWsHandler.begin(), listWsHandler.end());
+}
+
 static void ws_updatetip(const CBlockIndex *pindex)
 {
-    std::string strHex;
-    int ret = getblock(pindex, strHex);
+    std::vector< boost::shared_ptr<WsHandler> > vWsHandler = getWsHandlers();
+    if (vWsHandler.empty())
+    {
+        LogPrint("ws", "%s():%d - there are no connected ws clients\n", __func__, __LINE__);
+        return;
+    }
+
+    CBlock block;
+    int ret = getblock(pindex, block);
     if (ret != WsHandler::OK)
     {
         // should not happen
         LogPrint("ws", "%s():%d - ERROR: can not update tip\n", __func__, __LINE__);
         return;
     }
+
+    // each kind of event, full or filtered for a set of sidechains, is serialized once and shared by all
+    // the connections wanting it
+    std::map<std::pair<bool, ScFilter>, std::shared_ptr<const std::string>> mapTipEvents;
+    LogPrint("ws", "%s():%d - update tip loop on ws clients\n", __func__, __LINE__);
+    for (auto& wsHandler : vWsHandler)
     {
-        std::unique_lock<std::mutex> lck(wsmtx);
-        if (listWsHandler.size() )
-        {
-            LogPrint("ws", "%s():%d - update tip loop on ws clients\n", __func__, __LINE__);
-            auto it = listWsHandler.begin();
-            while (it != listWsHandler.end())
-            {
-                LogPrint("ws", "%s():%d - call wshandler_send_tip_update to connection[%u]\n", __func__, __LINE__, (*it)->t_id);
-                (*it)->send_tip_update(pindex->nHeight, pindex->GetBlockHash().GetHex(), strHex);
-                ++it;
-            }
-        }
-        else
+        bool fBinary = wsHandler->isBinary();
+        std::shared_ptr<const ScFilter> filter = wsHandler->getScFilter();
+        std::shared_ptr<const std::string>& tipEvent = mapTipEvents[std::make_pair(fBinary, *filter)];
+        if (!tipEvent)
         {
-            LogPrint("ws", "%s():%d - there are no connected ws clients\n", __func__, __LINE__);
+            tipEvent = WsHandler::makeBlockFrame(block, WsEvent::MSG_EVENT, WsEvent::UPDATE_TIP, "",
+                    pindex->nHeight, *filter, fBinary);
         }
+        LogPrint("ws", "%s():%d - call wshandler_send_tip_update to connection[%u]\n", __func__, __LINE__, wsHandler->t_id);
+        wsHandler->send_tip_update(tipEvent, fBinary);
     }
 }
 
+static void ws_updatetemplate(const CBlockIndex *pindexPrev, const CAmount& nFeeGain)
+{
+    std::vector< boost::shared_ptr<WsHandler> > vWsHandler = getWsHandlers();
+    if (vWsHandler.empty())
+    {
+        LogPrint("ws", "%s():%d - there are no connected ws clients\n", __func__, __LINE__);
+        return;
+    }
 
-//------------------------------------------------------------------------------
+    std::shared_ptr<const std::string> templateEvent =
+        WsHandler::makeTemplateEvent(pindexPrev->nHeight + 1, pindexPrev->GetBlockHash().GetHex(), nFeeGain);
+    LogPrint("ws", "%s():%d - block template update loop on ws clients\n", __func__, __LINE__);
+    for (auto& wsHandler : vWsHandler)
+    {
+        wsHandler->send_template_update(templateEvent);
+    }
+}
 
-static tcp::acceptor* acceptor = NULL;
-void ws_main(std::string strAddressWs, int portWs)
-{
-    std::string peerId;
 
-    try {
-        LogPrint("ws", "start websocket service address: %s \n", strAddressWs);
-        LogPrint("ws", "start websocket service port: %s \n", portWs);
+//------------------------------------------------------------------------------
 
-        auto const address = boost::asio::ip::make_address(strAddressWs);
-        auto const port = static_cast<unsigned short>(portWs);
+static void ws_accept();
 
-        net::io_context ioc { 1 };
-        tcp::acceptor _acceptor = tcp::acceptor { ioc, { address, port } };
-        acceptor = &_acceptor;
-        LogPrint("ws", "%s():%d - assigned %p\n", __func__, __LINE__, acceptor);
-        unsigned int t_id = 0;
+static void ws_on_accept(boost::beast::error_code ec, tcp::socket socket)
+{
+    static unsigned int t_id = 0;
 
-        while (!exit_ws_thread)
+    if (ec == net::error::operation_aborted)
+    {
+        LogPrint("ws", "%s():%d - websocket service stop\n", __func__, __LINE__);
+        return;
+    }
+    if (ec)
+    {
+        LogPrint("ws", "%s():%d - error: %s\n", __func__, __LINE__, ec.message());
+    }
+    else
+    {
+        try
         {
-            tcp::socket socket { ioc };
-
-            // TODO //  - possible DoS, limit number of connections
-            LogPrint("ws", "%s():%d - waiting to get a new connection\n", __func__, __LINE__);
-            acceptor->accept(socket);
+            std::string peerId;
             WsHandler::getPeerIdentity(socket, peerId);
 
-            boost::shared_ptr<WsHandler> w(new WsHandler());
+            // TODO //  - possible DoS, limit number of connections
+            boost::shared_ptr<WsHandler> w(new WsHandler(std::move(socket), t_id, peerId));
             LogPrint("ws", "%s():%d - allocated ws handler %p\n", __func__, __LINE__, w.get());
-
-            std::thread { std::bind(&WsHandler::do_session, w.get(),
-                    std::move(socket), t_id) }.detach();
             {
                 std::unique_lock<std::mutex> lck(wsmtx);
+                if (fWsStopping)
+                    return;
                 listWsHandler.push_back(w);
                 tot_connections++;
             }
+            {
+                std::unique_lock<std::mutex> lck(cs_wsMetrics);
+                wsMetrics.nTotalConnections++;
+            }
+            w->start();
             t_id++;
 
             LogPrint("ws", "%s():%d - new connection[%u] received from %s: tot[%d]\n",
                 __func__, __LINE__, t_id, peerId, tot_connections);
         }
+        catch (const std::exception& e)
+        {
+            LogPrint("ws", "%s():%d - error: %s\n", __func__, __LINE__, std::string(e.what()));
+        }
+    }
+    ws_accept();
+}
+
+static void ws_accept()
+{
+    // every connection gets its own strand
+    LogPrint("ws", "%s():%d - waiting to get a new connection\n", __func__, __LINE__);
+    wsAcceptor->async_accept(net::make_strand(*wsIoContext), &ws_on_accept);
+}
+
+static void ws_thread()
+{
+    RenameThread("horizen-ws");
+    try
+    {
+        wsIoContext->run();
     }
     catch (const std::exception& e)
     {
         LogPrint("ws", "%s():%d - error: %s\n", __func__, __LINE__, std::string(e.what()));
     }
-    LogPrint("ws", "%s():%d - websocket service stop\n", __func__, __LINE__);
+    LogPrint("ws", "%s():%d - websocket thread exit\n", __func__, __LINE__);
+}
+
+void GetWsConnectionStats(std::vector<WsConnectionStats>& vstats)
+{
+    vstats.clear();
+    for (const auto& wsHandler : getWsHandlers())
+    {
+        WsConnectionStats stats;
+        wsHandler->GetStats(stats);
+        vstats.push_back(stats);
+    }
+}
+
+void GetWsServerStats(WsServerStats& stats)
+{
+    {
+        std::unique_lock<std::mutex> lck(cs_wsMetrics);
+        stats = wsMetrics;
+    }
+    std::unique_lock<std::mutex> lck(wsmtx);
+    stats.nConnections = listWsHandler.size();
 }
 
 static void shutdown()
 {
+    std::unique_lock<std::mutex> lck(wsmtx);
+    fWsStopping = true;
     if (listWsHandler.size() != 0)
     {
-        // list objects are smart_ptrs and will clean up when they go out of scope
-        LogPrint("ws", "%s():%d - shutdown %d threads/sockets thread... \n", __func__, __LINE__, listWsHandler.size());
-        std::unique_lock<std::mutex> lck(wsmtx);
-        auto it = listWsHandler.begin();
-        while (it != listWsHandler.end())
+        LogPrint("ws", "%s():%d - shutdown %d sockets... \n", __func__, __LINE__, listWsHandler.size());
+        for (auto& wsHandler : listWsHandler)
         {
-            LogPrint("ws", "%s():%d - calling shutdown on handler connection[%u]\n", __func__, __LINE__, (*it)->t_id);
-            (*it)->shutdown();
-            ++it;
+            LogPrint("ws", "%s():%d - calling shutdown on handler connection[%u]\n", __func__, __LINE__, wsHandler->t_id);
+            wsHandler->shutdown();
         }
     }
 }
@@ -1413,14 +2434,32 @@ bool StartWsServer()
         // websocket is still unauthenticated, care must be taken to not expose it publicly
         std::string strAddress = GetArg("-wsaddress", "127.0.0.1");
         int port = GetArg("-wsport", 8888);
+        int nThreads = std::max((int)GetArg("-wsthreads", DEFAULT_WS_THREADS), 1);
+        nWsMaxQueueBytes = std::max((int64_t)GetArg("-wsmaxqueuebytes", DEFAULT_WS_MAX_QUEUE_BYTES), (int64_t)0);
+        std::string strSlowClients = GetArg("-wsslowclients", DEFAULT_WS_SLOW_CLIENTS);
+        if (strSlowClients != "disconnect" && strSlowClients != "drop")
+        {
+            LogPrintf("%s: unknown -wsslowclients=%s, the slow clients are disconnected\n", __func__, strSlowClients);
+            strSlowClients = "disconnect";
+        }
+        fWsDropSlowClientEvents = (strSlowClients == "drop");
+
+        resetWsMetrics();
+
+        LogPrint("ws", "start websocket service address: %s \n", strAddress);
+        LogPrint("ws", "start websocket service port: %s \n", port);
 
-        ws_thread = boost::thread(ws_main, strAddress, port);
-        ws_thread.detach();
+        wsIoContext.reset(new net::io_context { nThreads });
+        wsAcceptor.reset(new tcp::acceptor { *wsIoContext,
+                { boost::asio::ip::make_address(strAddress), static_cast<unsigned short>(port) } });
+        ws_accept();
+        for (int i = 0; i < nThreads; i++)
+            wsThreadGroup.create_thread(&ws_thread);
 
         wsNotificationInterface.reset(new WsNotificationInterface());
         LogPrint("ws", "%s():%d - starting server at %s:%d, allocated notif if %p\n",
             __func__, __LINE__, strAddress, port, wsNotificationInterface.get());
-        RegisterValidationInterface(wsNotificationInterface.get());
+        RegisterValidationInterface(wsNotificationInterface.get(), true);
     }
     catch (const std::exception& e)
     {
@@ -1434,18 +2473,31 @@ bool StopWsServer()
 {
     try
     {
-        shutdown();
-        exit_ws_thread = true;
-        if (acceptor != NULL)
-        {
-            LogPrint("ws", "%s():%d - closing static acceptor %p\n", __func__, __LINE__, acceptor);
-            acceptor->close();
-            acceptor = NULL;
-        }
         if (wsNotificationInterface.get() != NULL)
         {
             UnregisterValidationInterface(wsNotificationInterface.get());
         }
+        if (!wsIoContext)
+            return true;
+
+        // close the acceptor and the connections on their strands, then let the threads
+        // finish what is left, the io_context runs out of work with the last socket
+        shutdown();
+        net::post(*wsIoContext, []()
+            {
+                LogPrint("ws", "%s():%d - closing acceptor\n", __func__, __LINE__);
+                boost::beast::error_code ec;
+                wsAcceptor->close(ec);
+            });
+        wsThreadGroup.join_all();
+
+        {
+            std::unique_lock<std::mutex> lck(wsmtx);
+            listWsHandler.clear();
+        }
+        wsAcceptor.reset();
+        wsIoContext.reset();
+        fWsStopping = false;
     }
     catch (const std::exception& e)
     {
@@ -13,7 +13,83 @@
 //
 //------------------------------------------------------------------------------
 
+#include <stdint.h>
+#include <string>
+#include <vector>
 
+/** Number of threads serving the websocket connections */
+static const int DEFAULT_WS_THREADS = 2;
+/** The bytes waiting to be sent to a connection at most, before it is handled as slow */
+static const uint64_t DEFAULT_WS_MAX_QUEUE_BYTES = 32 * 1024 * 1024;
+/** What happens to a slow connection: "disconnect", or "drop" its events */
+static const char* const DEFAULT_WS_SLOW_CLIENTS = "disconnect";
+
+/** The output of a websocket connection, for getwsinfo */
+struct WsConnectionStats
+{
+    unsigned int nId;
+    std::string addr;
+    bool fBinary;
+    size_t nScFilter;
+    uint64_t nRecvFrames;
+    uint64_t nRecvBytes;
+    uint64_t nQueuedFrames;
+    uint64_t nQueuedBytes;
+    uint64_t nMaxQueuedBytes;
+    uint64_t nSentFrames;
+    uint64_t nSentBytes;
+    uint64_t nCoalesced;
+    uint64_t nDropped;
+};
+
+/**
+ * Latencies in microseconds, for getwsserverinfo: bucket i counts the ones needing i bits, that is below 2^i
+ * and at least 2^(i-1), the last bucket everything longer
+ */
+struct WsLatencyStats
+{
+    static const int BUCKETS = 25;
+
+    uint64_t nCount = 0;
+    uint64_t nTotalMicros = 0;
+    uint64_t nMaxMicros = 0;
+    uint64_t vBuckets[BUCKETS] = {};
+
+    void Add(int64_t nMicros);
+};
+
+/** The requests of one type: the time to parse them, and to handle them up to their answer being queued */
+struct WsRequestStats
+{
+    std::string name;
+    uint64_t nErrors = 0;
+    WsLatencyStats parse;
+    WsLatencyStats handler;
+};
+
+/** The frames of one kind (responses, events, ...): the time they waited in the queue, and to write them */
+struct WsOutputStats
+{
+    std::string name;
+    WsLatencyStats queueWait;
+    WsLatencyStats write;
+};
+
+/** The figures of the whole websocket server, since it started */
+struct WsServerStats
+{
+    uint64_t nConnections = 0;
+    uint64_t nTotalConnections = 0;
+    uint64_t nRecvFrames = 0;
+    uint64_t nRecvBytes = 0;
+    uint64_t nSentFrames = 0;
+    uint64_t nSentBytes = 0;
+    uint64_t nMaxQueuedBytes = 0;
+    std::vector<WsRequestStats> vRequests;
+    std::vector<WsOutputStats> vOutputs;
+};
 
 bool StartWsServer();
 bool StopWsServer();
+void GetWsConnectionStats(std::vector<WsConnectionStats>& vstats);
+void GetWsServerStats(WsServerStats& stats);
@@ -20,3 +20,33 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyCertificate(const CScCertificate &/*certificate*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyCertStatus(const CScCertificateStatusUpdateInfo &/*certStatusInfo*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifySidechainEvents(int /*nHeight*/, const CSidechainEvents &/*scEvents*/, bool /*fConnected*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyBlockConnection(const CBlockIndex * /*pindex*/, bool /*fConnected*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyTransactionAcceptance(const uint256 &/*hash*/, uint64_t /*nMempoolSequence*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyTransactionRemoval(const uint256 &/*hash*/, MemPoolRemovalReason /*reason*/, uint64_t /*nMempoolSequence*/)
+{
+    return true;
+}
@@ -8,6 +8,9 @@
 #include "zmqconfig.h"
 
 class CBlockIndex;
+class CSidechainEvents;
+struct CScCertificateStatusUpdateInfo;
+enum class MemPoolRemovalReason : uint8_t;
 class CZMQAbstractNotifier;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
@@ -34,6 +37,15 @@ public:
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyCertificate(const CScCertificate &certificate);
+    //! A certificate became the top quality one of its epoch, or stopped being it
+    virtual bool NotifyCertStatus(const CScCertificateStatusUpdateInfo &certStatusInfo);
+    //! Sidechains matured or ceased at nHeight, or no more with !fConnected
+    virtual bool NotifySidechainEvents(int nHeight, const CSidechainEvents &scEvents, bool fConnected);
+    //! A block connected to the active chain, or disconnected with !fConnected
+    virtual bool NotifyBlockConnection(const CBlockIndex *pindex, bool fConnected);
+    virtual bool NotifyTransactionAcceptance(const uint256 &hash, uint64_t nMempoolSequence);
+    virtual bool NotifyTransactionRemoval(const uint256 &hash, MemPoolRemovalReason reason, uint64_t nMempoolSequence);
 
 protected:
     void *psocket;
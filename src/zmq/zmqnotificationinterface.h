@@ -26,6 +26,12 @@ protected:
     // CValidationInterface
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock);
     void UpdatedBlockTip(const CBlockIndex *pindex);
+    void SyncCertificate(const CScCertificate &cert, const CBlock *pblock, int bwtMaturityDepth);
+    void SyncCertStatusInfo(const CScCertificateStatusUpdateInfo &certStatusInfo);
+    void SyncSidechainEvents(int nHeight, const CSidechainEvents &scEvents, bool fConnected);
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, ZCIncrementalMerkleTree tree, bool added);
+    void TransactionAddedToMempool(const uint256 &hash, uint64_t nMempoolSequence);
+    void TransactionRemovedFromMempool(const uint256 &hash, MemPoolRemovalReason reason, uint64_t nMempoolSequence);
 
 private:
     CZMQNotificationInterface();
@@ -3,7 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "zmqpublishnotifier.h"
+#include "blockfilemap.h"
 #include "main.h"
+#include "sc/sidechain.h"
+#include "txmempool.h"
 #include "util.h"
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
@@ -12,6 +15,22 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_HASHCERT  = "hashcert";
+static const char *MSG_RAWCERT   = "rawcert";
+static const char *MSG_SCEVENT   = "scevent";
+static const char *MSG_SEQUENCE  = "sequence";
+
+//! The first byte of a scevent message
+static const unsigned char SCEVENT_CERT_STATUS = 0;
+static const unsigned char SCEVENT_MATURED     = 1;
+static const unsigned char SCEVENT_CEASED      = 2;
+
+//! Append hash in RPC byte order, as the hashes of the other messages
+static void AppendHash(std::vector<unsigned char> &data, const uint256 &hash)
+{
+    for (unsigned int i = 0; i < 32; i++)
+        data.push_back(hash.begin()[31 - i]);
+}
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -163,20 +182,14 @@ bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
 
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
+    // the bytes of the block as accepted, shared with the other notifiers, when it is the last one
+    CRawBlock rawBlock;
+    if (!GetRawBlock(rawBlock, pindex)) {
+        zmqError("Can't read block from disk");
+        return false;
     }
 
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_RAWBLOCK, rawBlock.begin(), rawBlock.size());
 }
 
 bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
@@ -187,3 +200,100 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+bool CZMQPublishHashCertificateNotifier::NotifyCertificate(const CScCertificate &certificate)
+{
+    uint256 hash = certificate.GetHash();
+    LogPrint("zmq", "zmq: Publish hashcert %s\n", hash.GetHex());
+    char data[32];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    return SendMessage(MSG_HASHCERT, data, 32);
+}
+
+bool CZMQPublishRawCertificateNotifier::NotifyCertificate(const CScCertificate &certificate)
+{
+    uint256 hash = certificate.GetHash();
+    LogPrint("zmq", "zmq: Publish rawcert %s\n", hash.GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << certificate;
+    return SendMessage(MSG_RAWCERT, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishSidechainEventNotifier::NotifyCertStatus(const CScCertificateStatusUpdateInfo &certStatusInfo)
+{
+    LogPrint("zmq", "zmq: Publish scevent for certificate %s of sidechain %s\n", certStatusInfo.certHash.GetHex(), certStatusInfo.scId.GetHex());
+    std::vector<unsigned char> data(1, SCEVENT_CERT_STATUS);
+    AppendHash(data, certStatusInfo.scId);
+    AppendHash(data, certStatusInfo.certHash);
+    unsigned char buf[8];
+    WriteLE32(buf, certStatusInfo.certEpoch);
+    data.insert(data.end(), buf, buf + 4);
+    WriteLE64(buf, certStatusInfo.certQuality);
+    data.insert(data.end(), buf, buf + 8);
+    data.push_back(certStatusInfo.bwtState);
+    return SendMessage(MSG_SCEVENT, data.data(), data.size());
+}
+
+static bool SendSidechainEvents(CZMQAbstractPublishNotifier *notifier, const std::set<uint256> &scIds, unsigned char type, int nHeight, bool fConnected)
+{
+    for (const uint256 &scId : scIds) {
+        LogPrint("zmq", "zmq: Publish scevent %d for sidechain %s at height %d%s\n", (int)type, scId.GetHex(), nHeight, fConnected ? "" : " (disconnected)");
+        std::vector<unsigned char> data(1, type);
+        AppendHash(data, scId);
+        unsigned char buf[4];
+        WriteLE32(buf, nHeight);
+        data.insert(data.end(), buf, buf + 4);
+        data.push_back(fConnected ? 1 : 0);
+        if (!notifier->SendMessage(MSG_SCEVENT, data.data(), data.size()))
+            return false;
+    }
+    return true;
+}
+
+bool CZMQPublishSidechainEventNotifier::NotifySidechainEvents(int nHeight, const CSidechainEvents &scEvents, bool fConnected)
+{
+    return SendSidechainEvents(this, scEvents.maturingScs, SCEVENT_MATURED, nHeight, fConnected) &&
+           SendSidechainEvents(this, scEvents.ceasingScs, SCEVENT_CEASED, nHeight, fConnected);
+}
+
+/** A sequence message: the hash, the label of the change and, for the mempool ones, the sequence (and the reason) */
+static std::vector<unsigned char> SequenceMessage(const uint256 &hash, char label)
+{
+    std::vector<unsigned char> data;
+    AppendHash(data, hash);
+    data.push_back(label);
+    return data;
+}
+
+static void AppendSequence(std::vector<unsigned char> &data, uint64_t nMempoolSequence)
+{
+    unsigned char buf[8];
+    WriteLE64(buf, nMempoolSequence);
+    data.insert(data.end(), buf, buf + 8);
+}
+
+bool CZMQPublishSequenceNotifier::NotifyBlockConnection(const CBlockIndex *pindex, bool fConnected)
+{
+    uint256 hash = pindex->GetBlockHash();
+    LogPrint("zmq", "zmq: Publish sequence block %s %s\n", fConnected ? "connect" : "disconnect", hash.GetHex());
+    std::vector<unsigned char> data = SequenceMessage(hash, fConnected ? 'C' : 'D');
+    return SendMessage(MSG_SEQUENCE, data.data(), data.size());
+}
+
+bool CZMQPublishSequenceNotifier::NotifyTransactionAcceptance(const uint256 &hash, uint64_t nMempoolSequence)
+{
+    LogPrint("zmq", "zmq: Publish sequence mempool acceptance %s (sequence %d)\n", hash.GetHex(), nMempoolSequence);
+    std::vector<unsigned char> data = SequenceMessage(hash, 'A');
+    AppendSequence(data, nMempoolSequence);
+    return SendMessage(MSG_SEQUENCE, data.data(), data.size());
+}
+
+bool CZMQPublishSequenceNotifier::NotifyTransactionRemoval(const uint256 &hash, MemPoolRemovalReason reason, uint64_t nMempoolSequence)
+{
+    LogPrint("zmq", "zmq: Publish sequence mempool removal %s (sequence %d, reason %d)\n", hash.GetHex(), nMempoolSequence, (int)reason);
+    std::vector<unsigned char> data = SequenceMessage(hash, 'R');
+    AppendSequence(data, nMempoolSequence);
+    data.push_back(static_cast<unsigned char>(reason));
+    return SendMessage(MSG_SEQUENCE, data.data(), data.size());
+}
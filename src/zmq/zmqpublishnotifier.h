@@ -52,4 +52,39 @@ public:
     bool NotifyTransaction(const CTransaction &transaction);
 };
 
+class CZMQPublishHashCertificateNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyCertificate(const CScCertificate &certificate);
+};
+
+class CZMQPublishRawCertificateNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyCertificate(const CScCertificate &certificate);
+};
+
+/**
+ * "scevent": a message per sidechain maturing or ceasing, and per certificate becoming or no more being the
+ * top quality one of its epoch, as the sidechains can be followed without polling getscinfo.
+ */
+class CZMQPublishSidechainEventNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyCertStatus(const CScCertificateStatusUpdateInfo &certStatusInfo);
+    bool NotifySidechainEvents(int nHeight, const CSidechainEvents &scEvents, bool fConnected);
+};
+
+/**
+ * "sequence": the changes of the mempool, each with the mempool sequence it bumped, and the blocks connected and
+ * disconnected, as a mirror of the mempool is kept from a getrawmempool with its sequence.
+ */
+class CZMQPublishSequenceNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockConnection(const CBlockIndex *pindex, bool fConnected);
+    bool NotifyTransactionAcceptance(const uint256 &hash, uint64_t nMempoolSequence);
+    bool NotifyTransactionRemoval(const uint256 &hash, MemPoolRemovalReason reason, uint64_t nMempoolSequence);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H